@@ -58,6 +58,26 @@ template <typename FloatingType> struct FloatDoubleType<AudioBuffer<FloatPlaceho
 namespace GraphRenderingOps
 {
 
+// <Open-Ephys>
+// Modified by Open-Ephys.
+// =======================================================================
+/** The shared buffers touched by a rendering op, used to find the ops that can be
+    performed concurrently. A buffer that is both read and written is only listed as written.
+*/
+struct RenderingOpResources
+{
+    void readsChannel (const int channel)       { reads.add (channel * 2); }
+    void writesChannel (const int channel)      { writes.add (channel * 2); }
+    void readsMidiBuffer (const int buffer)     { reads.add (buffer * 2 + 1); }
+    void writesMidiBuffer (const int buffer)    { writes.add (buffer * 2 + 1); }
+
+    /** The graph's own input and output buffers, used by the AudioGraphIOProcessor nodes. */
+    void writesGraphIO()                        { writes.add (-1); }
+
+    Array<int> reads, writes;
+};
+// =======================================================================
+
 struct AudioGraphRenderingOpBase
 {
     AudioGraphRenderingOpBase() noexcept {}
@@ -71,6 +91,12 @@ struct AudioGraphRenderingOpBase
                           const OwnedArray<MidiBuffer>& sharedMidiBuffers,
                           const int numSamples) = 0;
 
+    // <Open-Ephys>
+    // Modified by Open-Ephys.
+    // =======================================================================
+    virtual void addResources (RenderingOpResources&) const = 0;
+    // =======================================================================
+
     JUCE_LEAK_DETECTOR (AudioGraphRenderingOpBase)
 };
 
@@ -104,6 +130,12 @@ struct ClearChannelOp  : public AudioGraphRenderingOp<ClearChannelOp>
         sharedBufferChans.clear (channelNum, 0, numSamples);
     }
 
+    // <Open-Ephys>
+    // Modified by Open-Ephys.
+    // =======================================================================
+    void addResources (RenderingOpResources& r) const override  { r.writesChannel (channelNum); }
+    // =======================================================================
+
     const int channelNum;
 
     JUCE_DECLARE_NON_COPYABLE (ClearChannelOp)
@@ -122,6 +154,16 @@ struct CopyChannelOp  : public AudioGraphRenderingOp<CopyChannelOp>
         sharedBufferChans.copyFrom (dstChannelNum, 0, sharedBufferChans, srcChannelNum, 0, numSamples);
     }
 
+    // <Open-Ephys>
+    // Modified by Open-Ephys.
+    // =======================================================================
+    void addResources (RenderingOpResources& r) const override
+    {
+        r.readsChannel (srcChannelNum);
+        r.writesChannel (dstChannelNum);
+    }
+    // =======================================================================
+
     const int srcChannelNum, dstChannelNum;
 
     JUCE_DECLARE_NON_COPYABLE (CopyChannelOp)
@@ -140,6 +182,16 @@ struct AddChannelOp  : public AudioGraphRenderingOp<AddChannelOp>
         sharedBufferChans.addFrom (dstChannelNum, 0, sharedBufferChans, srcChannelNum, 0, numSamples);
     }
 
+    // <Open-Ephys>
+    // Modified by Open-Ephys.
+    // =======================================================================
+    void addResources (RenderingOpResources& r) const override
+    {
+        r.readsChannel (srcChannelNum);
+        r.writesChannel (dstChannelNum);
+    }
+    // =======================================================================
+
     const int srcChannelNum, dstChannelNum;
 
     JUCE_DECLARE_NON_COPYABLE (AddChannelOp)
@@ -156,6 +208,12 @@ struct ClearMidiBufferOp  : public AudioGraphRenderingOp<ClearMidiBufferOp>
         sharedMidiBuffers.getUnchecked (bufferNum)->clear();
     }
 
+    // <Open-Ephys>
+    // Modified by Open-Ephys.
+    // =======================================================================
+    void addResources (RenderingOpResources& r) const override  { r.writesMidiBuffer (bufferNum); }
+    // =======================================================================
+
     const int bufferNum;
 
     JUCE_DECLARE_NON_COPYABLE (ClearMidiBufferOp)
@@ -174,6 +232,16 @@ struct CopyMidiBufferOp  : public AudioGraphRenderingOp<CopyMidiBufferOp>
         *sharedMidiBuffers.getUnchecked (dstBufferNum) = *sharedMidiBuffers.getUnchecked (srcBufferNum);
     }
 
+    // <Open-Ephys>
+    // Modified by Open-Ephys.
+    // =======================================================================
+    void addResources (RenderingOpResources& r) const override
+    {
+        r.readsMidiBuffer (srcBufferNum);
+        r.writesMidiBuffer (dstBufferNum);
+    }
+    // =======================================================================
+
     const int srcBufferNum, dstBufferNum;
 
     JUCE_DECLARE_NON_COPYABLE (CopyMidiBufferOp)
@@ -193,6 +261,16 @@ struct AddMidiBufferOp  : public AudioGraphRenderingOp<AddMidiBufferOp>
             ->addEvents (*sharedMidiBuffers.getUnchecked (srcBufferNum), 0, numSamples, 0);
     }
 
+    // <Open-Ephys>
+    // Modified by Open-Ephys.
+    // =======================================================================
+    void addResources (RenderingOpResources& r) const override
+    {
+        r.readsMidiBuffer (srcBufferNum);
+        r.writesMidiBuffer (dstBufferNum);
+    }
+    // =======================================================================
+
     const int srcBufferNum, dstBufferNum;
 
     JUCE_DECLARE_NON_COPYABLE (AddMidiBufferOp)
@@ -226,6 +304,12 @@ struct DelayChannelOp  : public AudioGraphRenderingOp<DelayChannelOp>
         }
     }
 
+    // <Open-Ephys>
+    // Modified by Open-Ephys.
+    // =======================================================================
+    void addResources (RenderingOpResources& r) const override  { r.writesChannel (channel); }
+    // =======================================================================
+
 private:
     FloatAndDoubleComposition<HeapBlock<FloatPlaceholder> > buffer;
     const int channel, bufferSize;
@@ -290,6 +374,22 @@ struct ProcessBufferOp   : public AudioGraphRenderingOp<ProcessBufferOp>
         }
     }
 
+    // <Open-Ephys>
+    // Modified by Open-Ephys.
+    // =======================================================================
+    void addResources (RenderingOpResources& r) const override
+    {
+        // processors get write pointers to all their channels, including padding ones
+        for (int i = 0; i < totalChans; ++i)
+            r.writesChannel (audioChannelsToUse.getUnchecked (i));
+
+        r.writesMidiBuffer (midiBufferToUse);
+
+        if (dynamic_cast<AudioProcessorGraph::AudioGraphIOProcessor*> (processor) != nullptr)
+            r.writesGraphIO();
+    }
+    // =======================================================================
+
     const AudioProcessorGraph::Node::Ptr node;
     AudioProcessor* const processor;
 
@@ -413,6 +513,7 @@ private:
             }
 
             int bufIndex = -1;
+            bool isAliased = false;
 
             if (sourceNodes.size() == 0)
             {
@@ -444,22 +545,37 @@ private:
                     jassert (bufIndex >= 0);
                 }
 
+                const int nodeDelay = getNodeDelay (srcNode);
+
                 if (inputChan < numOuts
                      && isBufferNeededLater (ourRenderingIndex,
                                              inputChan,
                                              srcNode, srcChan))
                 {
-                    // can't mess up this channel because it's needed later by another node, so we
-                    // need to use a copy of it..
-                    const int newFreeBuffer = getFreeBuffer (false);
+                    // <Open-Ephys>
+                    // Modified by Open-Ephys.
+                    // =======================================================================
+                    // a node leaving the channel untouched can read the buffer itself, which
+                    // then holds its output too
+                    if (bufIndex != getReadOnlyEmptyBuffer()
+                         && nodeDelay >= maxLatency
+                         && graph.isPassThroughChannel (node, inputChan))
+                    {
+                        isAliased = true;
+                    }
+                    // =======================================================================
+                    else
+                    {
+                        // can't mess up this channel because it's needed later by another node, so we
+                        // need to use a copy of it..
+                        const int newFreeBuffer = getFreeBuffer (false);
 
-                    renderingOps.add (new CopyChannelOp (bufIndex, newFreeBuffer));
+                        renderingOps.add (new CopyChannelOp (bufIndex, newFreeBuffer));
 
-                    bufIndex = newFreeBuffer;
+                        bufIndex = newFreeBuffer;
+                    }
                 }
 
-                const int nodeDelay = getNodeDelay (srcNode);
-
                 if (nodeDelay < maxLatency)
                     renderingOps.add (new DelayChannelOp (bufIndex, maxLatency - nodeDelay));
             }
@@ -554,7 +670,9 @@ private:
             jassert (bufIndex >= 0);
             audioChannelsToUse.add (bufIndex);
 
-            if (inputChan < numOuts)
+            if (isAliased)
+                addChannelAlias (node.nodeId, inputChan, sourceNodes.getUnchecked (0), sourceOutputChans.getUnchecked (0));
+            else if (inputChan < numOuts)
                 markBufferAsContaining (bufIndex, node.nodeId, inputChan);
         }
 
@@ -705,8 +823,11 @@ private:
         return 0;
     }
 
-    int getBufferContaining (const uint32 nodeId, const int outputChannel) const noexcept
+    int getBufferContaining (uint32 nodeId, int outputChannel) const noexcept
     {
+        if (outputChannel != AudioProcessorGraph::midiChannelIndex)
+            resolveChannelAlias (nodeId, outputChannel);
+
         if (outputChannel == AudioProcessorGraph::midiChannelIndex)
         {
             for (int i = midiNodeIds.size(); --i >= 0;)
@@ -749,7 +870,73 @@ private:
         }
     }
 
+    // <Open-Ephys>
+    // Modified by Open-Ephys.
+    // =======================================================================
+    /** An output channel of a pass-through node, held by the buffer of the output channel it
+        was read from rather than by a buffer of its own. */
+    struct ChannelAlias
+    {
+        uint32 nodeId;
+        int channel;
+        uint32 sourceNodeId;    // the output the buffer is marked as containing
+        int sourceChannel;
+    };
+
+    Array<ChannelAlias> channelAliases;
+
+    /** Replaces an aliased output channel with the one its buffer is marked as containing */
+    void resolveChannelAlias (uint32& nodeId, int& channel) const noexcept
+    {
+        for (int i = channelAliases.size(); --i >= 0;)
+        {
+            const ChannelAlias& a = channelAliases.getReference (i);
+
+            if (a.nodeId == nodeId && a.channel == channel)
+            {
+                nodeId = a.sourceNodeId;
+                channel = a.sourceChannel;
+                return;
+            }
+        }
+    }
+
+    void addChannelAlias (uint32 nodeId, int channel, uint32 sourceNodeId, int sourceChannel)
+    {
+        resolveChannelAlias (sourceNodeId, sourceChannel);
+
+        const ChannelAlias alias = { nodeId, channel, sourceNodeId, sourceChannel };
+        channelAliases.add (alias);
+    }
+
+    /** A buffer is needed as long as the output it contains, or any output aliased to it, is */
     bool isBufferNeededLater (int stepIndexToSearchFrom,
+                              int inputChannelOfIndexToIgnore,
+                              uint32 nodeId,
+                              int outputChanIndex) const
+    {
+        if (outputChanIndex == AudioProcessorGraph::midiChannelIndex || channelAliases.size() == 0)
+            return isOutputNeededLater (stepIndexToSearchFrom, inputChannelOfIndexToIgnore, nodeId, outputChanIndex);
+
+        resolveChannelAlias (nodeId, outputChanIndex);
+
+        if (isOutputNeededLater (stepIndexToSearchFrom, inputChannelOfIndexToIgnore, nodeId, outputChanIndex))
+            return true;
+
+        for (int i = 0; i < channelAliases.size(); ++i)
+        {
+            const ChannelAlias& a = channelAliases.getReference (i);
+
+            if (a.sourceNodeId == nodeId && a.sourceChannel == outputChanIndex
+                 && isOutputNeededLater (stepIndexToSearchFrom, inputChannelOfIndexToIgnore, a.nodeId, a.channel))
+                return true;
+        }
+
+        return false;
+    }
+    // =======================================================================
+
+    bool isOutputNeededLater (int stepIndexToSearchFrom,
                               int inputChannelOfIndexToIgnore,
                               const uint32 nodeId,
                               const int outputChanIndex) const
@@ -931,6 +1118,122 @@ struct ConnectionSorter
     }
 };
 
+// <Open-Ephys>
+// Modified by Open-Ephys.
+// =======================================================================
+/** Groups the ops into stages whose ops don't touch any buffer written by another op of
+    the same stage, each op being placed in the first stage after everything it depends on.
+    Inside a stage the buffer copies come first, followed by the node-processing ops.
+*/
+static void scheduleRenderingOps (const Array<void*>& ops, Array<void*>& scheduledOps, Array<int>& stages)
+{
+    HashMap<int, int> lastWrite, lastRead;
+    Array<int> opStages;
+    int numStages = 0;
+
+    for (int i = 0; i < ops.size(); ++i)
+    {
+        RenderingOpResources r;
+        static_cast<const AudioGraphRenderingOpBase*> (ops.getUnchecked (i))->addResources (r);
+
+        int stage = 0;
+
+        for (int j = 0; j < r.reads.size(); ++j)
+            stage = jmax (stage, lastWrite [r.reads.getUnchecked (j)]);
+
+        for (int j = 0; j < r.writes.size(); ++j)
+            stage = jmax (stage, lastWrite [r.writes.getUnchecked (j)], lastRead [r.writes.getUnchecked (j)]);
+
+        ++stage;
+
+        for (int j = 0; j < r.reads.size(); ++j)
+            lastRead.set (r.reads.getUnchecked (j), jmax (stage, lastRead [r.reads.getUnchecked (j)]));
+
+        for (int j = 0; j < r.writes.size(); ++j)
+            lastWrite.set (r.writes.getUnchecked (j), stage);
+
+        opStages.add (stage);
+        numStages = jmax (numStages, stage);
+    }
+
+    for (int stage = 1; stage <= numStages; ++stage)
+    {
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            for (int i = 0; i < ops.size(); ++i)
+            {
+                const bool isProcessOp = dynamic_cast<ProcessBufferOp*> (static_cast<AudioGraphRenderingOpBase*> (ops.getUnchecked (i))) != nullptr;
+
+                if (opStages.getUnchecked (i) == stage && isProcessOp == (pass == 1))
+                    scheduledOps.add (ops.getUnchecked (i));
+            }
+
+            stages.add (scheduledOps.size());
+        }
+    }
+}
+
+/** Lists, for each op, the earlier ops it has to wait for: the last op to write a buffer it
+    touches and, for a buffer it writes, the ops that read that buffer since. The dependencies
+    of op i are dependencies[firstDependency[i]] to dependencies[firstDependency[i + 1]] excluded.
+*/
+static void findOpDependencies (const Array<void*>& ops, Array<int>& firstDependency, Array<int>& dependencies)
+{
+    HashMap<int, int> lastWrite, readerList;
+    OwnedArray<Array<int> > readers;
+
+    for (int i = 0; i < ops.size(); ++i)
+    {
+        RenderingOpResources r;
+        static_cast<const AudioGraphRenderingOpBase*> (ops.getUnchecked (i))->addResources (r);
+
+        SortedSet<int> deps;
+
+        for (int j = 0; j < r.reads.size(); ++j)
+        {
+            const int resource = r.reads.getUnchecked (j);
+
+            if (lastWrite.contains (resource))
+                deps.add (lastWrite [resource]);
+
+            if (! readerList.contains (resource))
+            {
+                readerList.set (resource, readers.size());
+                readers.add (new Array<int>());
+            }
+
+            readers.getUnchecked (readerList [resource])->add (i);
+        }
+
+        for (int j = 0; j < r.writes.size(); ++j)
+        {
+            const int resource = r.writes.getUnchecked (j);
+
+            if (lastWrite.contains (resource))
+                deps.add (lastWrite [resource]);
+
+            if (readerList.contains (resource))
+            {
+                Array<int>& readersSinceWrite = *readers.getUnchecked (readerList [resource]);
+                for (int k = 0; k < readersSinceWrite.size(); ++k)
+                    deps.add (readersSinceWrite.getUnchecked (k));
+                readersSinceWrite.clearQuick();
+            }
+
+            lastWrite.set (resource, i);
+        }
+
+        deps.removeValue (i);
+
+        firstDependency.add (dependencies.size());
+        for (int j = 0; j < deps.size(); ++j)
+            dependencies.add (deps.getUnchecked (j));
+    }
+
+    firstDependency.add (dependencies.size());
+}
+// =======================================================================
+
 }
 
 //==============================================================================
@@ -1032,9 +1335,295 @@ struct AudioProcessorGraph::AudioProcessorGraphBufferHelpers
     FloatAndDoubleComposition<AudioBuffer<FloatPlaceholder> > currentAudioOutputBuffer;
 };
 
+// <Open-Ephys>
+// Modified by Open-Ephys.
+// =======================================================================
+/** Threads helping the rendering thread to perform the ops of a stage.
+
+    The ops of a job are claimed one at a time through a single counter holding the job
+    number in its upper half and the next op index in its lower half, so that a thread that
+    wakes up late can never take an op from a job other than the current one. The two most
+    recent jobs have a slot each, and a slot is only reused once its job has finished.
+*/
+struct AudioProcessorGraph::RenderingThreadPool
+{
+    RenderingThreadPool (const int numThreads)  : remaining (0)
+    {
+        for (int i = 0; i < numThreads; ++i)
+        {
+            threads.add (new RenderingThread (*this));
+            threads.getLast()->startThread (9);
+        }
+    }
+
+    int getNumThreads() const noexcept          { return threads.size(); }
+
+    template <typename FloatType>
+    void performAll (void* const* ops, const int numOps, AudioBuffer<FloatType>& buffers,
+                     const OwnedArray<MidiBuffer>& midiBuffers, const int numSamples)
+    {
+        const int64 jobNumber = (state.get() >> 32) + 1;
+        Job& job = jobs [jobNumber & 1];
+
+        job.ops = ops;
+        job.numOps = numOps;
+        job.setBuffers (buffers);
+        job.midiBuffers = &midiBuffers;
+        job.numSamples = numSamples;
+
+        remaining = numOps;
+        state = jobNumber << 32;
+
+        for (int i = 0; i < threads.size(); ++i)
+            threads.getUnchecked (i)->notify();
+
+        helpWithCurrentJob();
+
+        while (remaining.get() > 0)
+            jobFinished.wait();
+    }
+
+private:
+    struct Job
+    {
+        Job() noexcept  : ops (nullptr), numOps (0), floatBuffers (nullptr), doubleBuffers (nullptr),
+                          midiBuffers (nullptr), numSamples (0) {}
+
+        void setBuffers (AudioBuffer<float>& b) noexcept     { floatBuffers = &b; doubleBuffers = nullptr; }
+        void setBuffers (AudioBuffer<double>& b) noexcept    { doubleBuffers = &b; floatBuffers = nullptr; }
+
+        void perform (const int index) const
+        {
+            GraphRenderingOps::AudioGraphRenderingOpBase* const op
+                = static_cast<GraphRenderingOps::AudioGraphRenderingOpBase*> (ops[index]);
+
+            if (floatBuffers != nullptr)
+                op->perform (*floatBuffers, *midiBuffers, numSamples);
+            else
+                op->perform (*doubleBuffers, *midiBuffers, numSamples);
+        }
+
+        void* const* ops;
+        int numOps;
+        AudioBuffer<float>* floatBuffers;
+        AudioBuffer<double>* doubleBuffers;
+        const OwnedArray<MidiBuffer>* midiBuffers;
+        int numSamples;
+    };
+
+    struct RenderingThread  : public Thread
+    {
+        RenderingThread (RenderingThreadPool& p)  : Thread ("Graph rendering thread"), pool (p) {}
+        ~RenderingThread()                         { stopThread (4000); }
+
+        void run() override
+        {
+            FloatVectorOperations::disableDenormalisedNumberSupport();
+
+            while (! threadShouldExit())
+            {
+                wait (-1);
+
+                if (! threadShouldExit())
+                    pool.helpWithCurrentJob();
+            }
+        }
+
+        RenderingThreadPool& pool;
+
+        JUCE_DECLARE_NON_COPYABLE (RenderingThread)
+    };
+
+    void helpWithCurrentJob()
+    {
+        for (;;)
+        {
+            const int64 s = state.get();
+            const Job& job = jobs [(s >> 32) & 1];
+            const int index = (int) (s & 0xffffffff);
+
+            if (index >= job.numOps)
+                return;
+
+            if (state.compareAndSetBool (s + 1, s))
+            {
+                job.perform (index);
+
+                if (--remaining == 0)
+                    jobFinished.signal();
+            }
+        }
+    }
+
+    Job jobs[2];
+    Atomic<int64> state;
+    Atomic<int> remaining;
+    WaitableEvent jobFinished;
+    OwnedArray<RenderingThread> threads;
+
+    JUCE_DECLARE_NON_COPYABLE (RenderingThreadPool)
+};
+
+/** Performs the ops of each chain on a thread of its own, and those of no chain on the
+    rendering thread.
+
+    Each thread performs its ops in their order in the sequence, and before each one waits for
+    the ops it depends on to be done in the current block, which, as every op only depends on
+    earlier ones, can never deadlock. An op another thread depends on wakes every thread when
+    it is done; the ops of a chain mostly depend on each other, so this is rare but for the sinks.
+*/
+struct AudioProcessorGraph::ChainRenderer
+{
+    ChainRenderer (const Array<void*>& sequence, const Array<int>& firstDependency,
+                   const Array<int>& dependencies, const Array<int>& opChains, const int numChains)
+        : ops (sequence), firstDependencies (firstDependency), allDependencies (dependencies),
+          block (0), remaining (0)
+    {
+        done.calloc ((size_t) ops.size());
+        wakesOthers.calloc ((size_t) ops.size());
+
+        for (int chain = -1; chain < numChains; ++chain)
+        {
+            chainOps.add (new Array<int>());
+            wakeEvents.add (new WaitableEvent());
+        }
+
+        for (int i = 0; i < ops.size(); ++i)
+        {
+            chainOps.getUnchecked (opChains.getUnchecked (i) + 1)->add (i);
+
+            for (int j = firstDependencies.getUnchecked (i); j < firstDependencies.getUnchecked (i + 1); ++j)
+            {
+                const int dependency = allDependencies.getUnchecked (j);
+
+                if (opChains.getUnchecked (dependency) != opChains.getUnchecked (i))
+                    wakesOthers[dependency] = true;
+            }
+        }
+
+        for (int chain = 0; chain < numChains; ++chain)
+        {
+            threads.add (new ChainThread (*this, chain));
+            threads.getLast()->startThread (9);
+        }
+    }
+
+    ~ChainRenderer()
+    {
+        threads.clear();
+    }
+
+    int getNumChains() const noexcept           { return threads.size(); }
+
+    template <typename FloatType>
+    void perform (AudioBuffer<FloatType>& buffers, const OwnedArray<MidiBuffer>& midiBuffers, const int numSamples)
+    {
+        setBuffers (buffers);
+        this->midiBuffers = &midiBuffers;
+        this->numSamples = numSamples;
+
+        ++block;
+        remaining = threads.size();
+
+        for (int i = 0; i < threads.size(); ++i)
+            threads.getUnchecked (i)->notify();
+
+        performChain (-1);
+
+        while (remaining.get() > 0)
+            chainsFinished.wait();
+    }
+
+private:
+    struct ChainThread  : public Thread
+    {
+        ChainThread (ChainRenderer& r, const int c)  : Thread ("Signal chain thread " + String (c + 1)), renderer (r), chain (c) {}
+        ~ChainThread()                                { stopThread (4000); }
+
+        void run() override
+        {
+            FloatVectorOperations::disableDenormalisedNumberSupport();
+
+            while (! threadShouldExit())
+            {
+                wait (-1);
+
+                if (threadShouldExit())
+                    break;
+
+                renderer.performChain (chain);
+
+                if (--renderer.remaining == 0)
+                    renderer.chainsFinished.signal();
+            }
+        }
+
+        ChainRenderer& renderer;
+        const int chain;
+
+        JUCE_DECLARE_NON_COPYABLE (ChainThread)
+    };
+
+    void setBuffers (AudioBuffer<float>& b) noexcept     { floatBuffers = &b; doubleBuffers = nullptr; }
+    void setBuffers (AudioBuffer<double>& b) noexcept    { doubleBuffers = &b; floatBuffers = nullptr; }
+
+    void performChain (const int chain)
+    {
+        const Array<int>& indexes = *chainOps.getUnchecked (chain + 1);
+        WaitableEvent& wakeEvent = *wakeEvents.getUnchecked (chain + 1);
+        const int currentBlock = block.get();
+
+        for (int k = 0; k < indexes.size(); ++k)
+        {
+            const int i = indexes.getUnchecked (k);
+
+            for (int j = firstDependencies.getUnchecked (i); j < firstDependencies.getUnchecked (i + 1); ++j)
+            {
+                // the event stays signalled if the dependency was done before waiting
+                while (done[allDependencies.getUnchecked (j)].get() != currentBlock)
+                    wakeEvent.wait (-1);
+            }
+
+            GraphRenderingOps::AudioGraphRenderingOpBase* const op
+                = static_cast<GraphRenderingOps::AudioGraphRenderingOpBase*> (ops.getUnchecked (i));
+
+            if (floatBuffers != nullptr)
+                op->perform (*floatBuffers, *midiBuffers, numSamples);
+            else
+                op->perform (*doubleBuffers, *midiBuffers, numSamples);
+
+            done[i] = currentBlock;
+
+            if (wakesOthers[i])
+                for (int e = 0; e < wakeEvents.size(); ++e)
+                    wakeEvents.getUnchecked (e)->signal();
+        }
+    }
+
+    const Array<void*> ops;
+    const Array<int> firstDependencies, allDependencies;
+    OwnedArray<Array<int> > chainOps;          // the ops of each chain, those of no chain first
+    OwnedArray<WaitableEvent> wakeEvents;      // likewise
+    HeapBlock<Atomic<int> > done;              // the last block each op was performed in
+    HeapBlock<bool> wakesOthers;
+
+    AudioBuffer<float>* floatBuffers = nullptr;
+    AudioBuffer<double>* doubleBuffers = nullptr;
+    const OwnedArray<MidiBuffer>* midiBuffers = nullptr;
+    int numSamples = 0;
+
+    Atomic<int> block;
+    Atomic<int> remaining;
+    WaitableEvent chainsFinished;
+    OwnedArray<ChainThread> threads;
+
+    JUCE_DECLARE_NON_COPYABLE (ChainRenderer)
+};
+// =======================================================================
+
 //==============================================================================
 AudioProcessorGraph::AudioProcessorGraph()
-    : lastNodeId (0), audioBuffers (new AudioProcessorGraphBufferHelpers),
+    : lastNodeId (0), chainThreadingEnabled (false), audioBuffers (new AudioProcessorGraphBufferHelpers),
       currentMidiInputBuffer (nullptr)
 {
 }
@@ -1294,12 +1883,22 @@ static void deleteRenderOpArray (Array<void*>& ops)
 void AudioProcessorGraph::clearRenderingSequence()
 {
     Array<void*> oldOps;
+    ScopedPointer<ChainRenderer> oldChainRenderer;
 
     {
         const ScopedLock sl (getCallbackLock());
         renderingOps.swapWith (oldOps);
+
+        // <Open-Ephys>
+        // Modified by Open-Ephys.
+        // =======================================================================
+        scheduledOps.clear();
+        scheduledStages.clear();
+        chainRenderer.swapWith (oldChainRenderer);
+        // =======================================================================
     }
 
+    oldChainRenderer = nullptr;
     deleteRenderOpArray (oldOps);
 }
 
@@ -1358,6 +1957,17 @@ void AudioProcessorGraph::buildRenderingSequence()
         numMidiBuffersNeeded = calculator.getNumMidiBuffersNeeded();
     }
 
+    // <Open-Ephys>
+    // Modified by Open-Ephys.
+    // =======================================================================
+    Array<void*> newScheduledOps;
+    Array<int> newScheduledStages;
+    GraphRenderingOps::scheduleRenderingOps (newRenderingOps, newScheduledOps, newScheduledStages);
+
+    ScopedPointer<ChainRenderer> newChainRenderer (chainThreadingEnabled ? createChainRenderer (newRenderingOps)
+                                                                         : nullptr);
+    // =======================================================================
+
     {
         // swap over to the new rendering sequence..
         const ScopedLock sl (getCallbackLock());
@@ -1371,8 +1981,23 @@ void AudioProcessorGraph::buildRenderingSequence()
             midiBuffers.add (new MidiBuffer());
 
         renderingOps.swapWith (newRenderingOps);
+
+        // <Open-Ephys>
+        // Modified by Open-Ephys.
+        // =======================================================================
+        scheduledOps.swapWith (newScheduledOps);
+        scheduledStages.swapWith (newScheduledStages);
+        chainRenderer.swapWith (newChainRenderer);
+        // =======================================================================
     }
 
+    // <Open-Ephys>
+    // Modified by Open-Ephys.
+    // =======================================================================
+    // the old renderer's threads are stopped before the ops they refer to are deleted
+    newChainRenderer = nullptr;
+    // =======================================================================
+
     // delete the old ones..
     deleteRenderOpArray (newRenderingOps);
 }
@@ -1439,6 +2064,182 @@ void AudioProcessorGraph::setPlayHead (AudioPlayHead* audioPlayHead)
         nodes.getUnchecked(i)->getProcessor()->setPlayHead (audioPlayHead);
 }
 
+// <Open-Ephys>
+// Modified by Open-Ephys.
+// =======================================================================
+void AudioProcessorGraph::setNumRenderingThreads (const int numThreads)
+{
+    if (numThreads == getNumRenderingThreads())
+        return;
+
+    ScopedPointer<RenderingThreadPool> newThreads (numThreads > 0 ? new RenderingThreadPool (numThreads)
+                                                                  : nullptr);
+
+    {
+        const ScopedLock sl (getCallbackLock());
+        renderingThreads.swapWith (newThreads);
+    }
+
+    // the old threads are stopped here, outside the callback lock
+}
+
+int AudioProcessorGraph::getNumRenderingThreads() const noexcept
+{
+    return renderingThreads != nullptr ? renderingThreads->getNumThreads() : 0;
+}
+
+bool AudioProcessorGraph::isPassThroughChannel (const Node&, int) const
+{
+    return false;
+}
+
+void AudioProcessorGraph::setChainThreadingEnabled (const bool enabled)
+{
+    if (enabled == chainThreadingEnabled)
+        return;
+
+    chainThreadingEnabled = enabled;
+
+    // the threads are created or deleted along with the next rendering sequence
+    triggerAsyncUpdate();
+}
+
+bool AudioProcessorGraph::isChainThreadingEnabled() const noexcept
+{
+    return chainThreadingEnabled;
+}
+
+int AudioProcessorGraph::getNumChainThreads() const noexcept
+{
+    return chainRenderer != nullptr ? chainRenderer->getNumChains() : 0;
+}
+
+bool AudioProcessorGraph::isChainSink (const Node&) const
+{
+    return false;
+}
+
+AudioProcessorGraph::ChainRenderer* AudioProcessorGraph::createChainRenderer (const Array<void*>& ops) const
+{
+    // nodes linked by a connection belong to the same chain, unless one of them is a sink
+    Array<int> parents;
+    Array<bool> sinks;
+
+    for (int i = 0; i < nodes.size(); ++i)
+    {
+        const Node* const node = nodes.getUnchecked (i);
+
+        parents.add (i);
+        sinks.add (isChainSink (*node) || dynamic_cast<AudioGraphIOProcessor*> (node->getProcessor()) != nullptr);
+    }
+
+    struct UnionFind
+    {
+        static int findRoot (Array<int>& parents, int i)
+        {
+            while (parents.getUnchecked (i) != i)
+            {
+                parents.set (i, parents.getUnchecked (parents.getUnchecked (i)));
+                i = parents.getUnchecked (i);
+            }
+
+            return i;
+        }
+    };
+
+    for (int i = 0; i < connections.size(); ++i)
+    {
+        const Connection* const c = connections.getUnchecked (i);
+        const int source = nodes.indexOf (getNodeForId (c->sourceNodeId));
+        const int dest = nodes.indexOf (getNodeForId (c->destNodeId));
+
+        if (source >= 0 && dest >= 0 && ! sinks.getUnchecked (source) && ! sinks.getUnchecked (dest))
+            parents.set (UnionFind::findRoot (parents, source), UnionFind::findRoot (parents, dest));
+    }
+
+    Array<int> firstDependency, dependencies;
+    GraphRenderingOps::findOpDependencies (ops, firstDependency, dependencies);
+
+    // node-processing ops go with their node's chain, numbered in the order of the sequence
+    HashMap<int, int> rootChains;
+    Array<int> opChains;
+    int numChains = 0;
+
+    for (int i = 0; i < ops.size(); ++i)
+    {
+        int chain = -1;
+
+        if (const GraphRenderingOps::ProcessBufferOp* const p
+                = dynamic_cast<const GraphRenderingOps::ProcessBufferOp*> (static_cast<GraphRenderingOps::AudioGraphRenderingOpBase*> (ops.getUnchecked (i))))
+        {
+            const int node = nodes.indexOf (p->node);
+
+            if (node >= 0 && ! sinks.getUnchecked (node))
+            {
+                const int root = UnionFind::findRoot (parents, node);
+
+                if (! rootChains.contains (root))
+                    rootChains.set (root, numChains++);
+
+                chain = rootChains [root];
+            }
+        }
+
+        opChains.add (chain);
+    }
+
+    if (numChains == 0)
+        return nullptr;
+
+    // buffer copies go with the first op depending on them, or on the rendering thread if none does
+    Array<int> firstDependent;
+    firstDependent.insertMultiple (0, -1, ops.size());
+
+    for (int i = 0; i < ops.size(); ++i)
+        for (int j = firstDependency.getUnchecked (i); j < firstDependency.getUnchecked (i + 1); ++j)
+            if (firstDependent.getUnchecked (dependencies.getUnchecked (j)) < 0)
+                firstDependent.set (dependencies.getUnchecked (j), i);
+
+    for (int i = ops.size(); --i >= 0;)
+    {
+        if (dynamic_cast<const GraphRenderingOps::ProcessBufferOp*> (static_cast<GraphRenderingOps::AudioGraphRenderingOpBase*> (ops.getUnchecked (i))) == nullptr)
+            opChains.set (i, firstDependent.getUnchecked (i) >= 0 ? opChains.getUnchecked (firstDependent.getUnchecked (i)) : -1);
+    }
+
+    return new ChainRenderer (ops, firstDependency, dependencies, opChains, numChains);
+}
+
+template <typename FloatType>
+void AudioProcessorGraph::performScheduledOps (AudioBuffer<FloatType>& renderingBuffers, const int numSamples)
+{
+    int start = 0;
+
+    for (int i = 0; i < scheduledStages.size(); i += 2)
+    {
+        const int firstProcessOp = scheduledStages.getUnchecked (i);
+        const int end = scheduledStages.getUnchecked (i + 1);
+
+        if (end - firstProcessOp > 1)
+        {
+            for (int j = start; j < firstProcessOp; ++j)
+                static_cast<GraphRenderingOps::AudioGraphRenderingOpBase*> (scheduledOps.getUnchecked (j))
+                    ->perform (renderingBuffers, midiBuffers, numSamples);
+
+            renderingThreads->performAll (scheduledOps.begin() + firstProcessOp, end - firstProcessOp,
+                                          renderingBuffers, midiBuffers, numSamples);
+        }
+        else
+        {
+            for (int j = start; j < end; ++j)
+                static_cast<GraphRenderingOps::AudioGraphRenderingOpBase*> (scheduledOps.getUnchecked (j))
+                    ->perform (renderingBuffers, midiBuffers, numSamples);
+        }
+
+        start = end;
+    }
+}
+// =======================================================================
+
 template <typename FloatType>
 void AudioProcessorGraph::processAudio (AudioBuffer<FloatType>& buffer, MidiBuffer& midiMessages)
 {
@@ -1454,6 +2255,19 @@ void AudioProcessorGraph::processAudio (AudioBuffer<FloatType>& buffer, MidiBuff
     currentMidiInputBuffer = &midiMessages;
     currentMidiOutputBuffer.clear();
 
+    // <Open-Ephys>
+    // Modified by Open-Ephys.
+    // =======================================================================
+    if (chainRenderer != nullptr)
+    {
+        chainRenderer->perform (renderingBuffers, midiBuffers, numSamples);
+    }
+    else if (renderingThreads != nullptr)
+    {
+        performScheduledOps (renderingBuffers, numSamples);
+    }
+    else
+    // =======================================================================
     for (int i = 0; i < renderingOps.size(); ++i)
     {
         GraphRenderingOps::AudioGraphRenderingOpBase* const op
@@ -373,11 +373,75 @@ public:
     void getStateInformation (juce::MemoryBlock&) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
+    // <Open-Ephys>
+    // Modified by Open-Ephys.
+    // =======================================================================
+    /** Sets the number of extra threads used to render the graph.
+
+        With one or more threads, nodes that don't share any buffer with each other (for
+        example the branches of a split signal chain) are processed concurrently, the
+        calling thread taking part in the work. Each group of independent nodes is finished
+        before anything that depends on it starts, so every node still sees exactly the
+        audio and midi it would see when rendering serially.
+
+        Only enable this if the processors in the graph can safely run on different
+        threads at the same time. Zero, the default, renders everything on the calling thread.
+    */
+    void setNumRenderingThreads (int numThreads);
+
+    /** Returns the number of extra threads set by setNumRenderingThreads(). */
+    int getNumRenderingThreads() const noexcept;
+
+    /** Processes each independent chain of nodes on a thread of its own.
+
+        A chain is a group of nodes linked by connections, leaving out the nodes for which
+        isChainSink() returns true; those, with the graph's I/O nodes, gather the outputs of
+        several chains and are processed on the calling thread. There are no stages: every op
+        only waits for the earlier ops it shares a buffer with, so a chain slower than the
+        others only holds up the sinks, and nodes still see exactly the audio and midi they
+        would see when rendering serially. The threads are created along with the rendering
+        sequence, one per chain.
+
+        Only enable this if the processors of different chains can safely run at the same
+        time. It takes precedence over setNumRenderingThreads().
+    */
+    void setChainThreadingEnabled (bool enabled);
+
+    bool isChainThreadingEnabled() const noexcept;
+
+    /** Returns the number of chains processed on threads of their own, 0 if chain threading
+        is disabled. */
+    int getNumChainThreads() const noexcept;
+
+    /** Returns true if a node gathers the outputs of several chains, rather than belonging to
+        one. Only asked when the rendering sequence is rebuilt. The default returns false.
+    */
+    virtual bool isChainSink (const Node& node) const;
+
+    /** Returns true if the processor of a node leaves an output channel holding the samples
+        that came in on its input channel of the same index.
+
+        When the source of such a channel is also needed by other nodes, the rendering gives
+        the processor the source's buffer itself instead of a copy of it, and the nodes
+        reading that output read the same buffer. The answer must only change along with the
+        connections, as it is only asked when the rendering sequence is rebuilt. The default
+        returns false, processors being free to change their channels in place.
+    */
+    virtual bool isPassThroughChannel (const Node& node, int channel) const;
+    // =======================================================================
+
 private:
     //==============================================================================
     template <typename floatType>
     void processAudio (AudioBuffer<floatType>& buffer, MidiBuffer& midiMessages);
 
+    // <Open-Ephys>
+    // Modified by Open-Ephys.
+    // =======================================================================
+    template <typename floatType>
+    void performScheduledOps (AudioBuffer<floatType>& renderingBuffers, int numSamples);
+    // =======================================================================
+
     //==============================================================================
     ReferenceCountedArray<Node> nodes;
     OwnedArray<Connection> connections;
@@ -385,6 +449,26 @@ private:
     OwnedArray<MidiBuffer> midiBuffers;
     Array<void*> renderingOps;
 
+    // <Open-Ephys>
+    // Modified by Open-Ephys.
+    // =======================================================================
+    /** The rendering ops grouped in stages of ops that don't depend on each other. For each
+        stage, scheduledStages holds the index of its first node-processing op followed by
+        its end; the ops before the first node-processing op are cheap buffer copies. */
+    Array<void*> scheduledOps;
+    Array<int> scheduledStages;
+
+    struct RenderingThreadPool;
+    ScopedPointer<RenderingThreadPool> renderingThreads;
+
+    struct ChainRenderer;
+    ScopedPointer<ChainRenderer> chainRenderer;
+    bool chainThreadingEnabled;
+
+    /** Returns the chain renderer for a new sequence of ops, or nullptr if there are no chains */
+    ChainRenderer* createChainRenderer (const Array<void*>& ops) const;
+    // =======================================================================
+
     friend class AudioGraphIOProcessor;
     struct AudioProcessorGraphBufferHelpers;
     ScopedPointer<AudioProcessorGraphBufferHelpers> audioBuffers;
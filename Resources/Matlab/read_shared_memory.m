@@ -0,0 +1,85 @@
+function [timestamps, samples, events, shm] = read_shared_memory(filename, numSamples)
+% READ_SHARED_MEMORY Read the last samples and events written by the
+% Shared Memory sink of the Open Ephys GUI.
+%
+%   [timestamps, samples, events, shm] = read_shared_memory(filename, numSamples)
+%
+% returns the timestamps (1 x n) and the samples (channels x n, in
+% microvolts) of the last numSamples samples still in the ring, and the
+% events in it (a struct array with timestamp, sourceID, line and state).
+% shm holds the header of the file, its status being 0 while starting,
+% 1 when acquiring, 2 when stopped and 3 when closed by the GUI.
+%
+% The file is mapped with memmapfile, which keeps it open while shm.map is
+% in use. The layout is described with SharedMemoryHeader in
+% Source/Plugins/EventBroadcaster/SharedMemoryOutput.h.
+
+header = memmapfile(filename, 'Writable', false, 'Repeat', 1, 'Format', { ...
+    'uint8',  [1 8], 'magic'; ...
+    'uint32', [1 1], 'version'; ...
+    'uint32', [1 1], 'headerBytes'; ...
+    'uint32', [1 1], 'numChannels'; ...
+    'uint32', [1 1], 'ringSamples'; ...
+    'single', [1 1], 'sampleRate'; ...
+    'uint32', [1 1], 'sourceID'; ...
+    'uint32', [1 1], 'eventBytes'; ...
+    'uint32', [1 1], 'ringEvents'; ...
+    'uint64', [1 1], 'timestampsOffset'; ...
+    'uint64', [1 1], 'samplesOffset'; ...
+    'uint64', [1 1], 'eventsOffset'; ...
+    'uint64', [1 1], 'totalBytes'; ...
+    'int64',  [1 1], 'samplesWritten'; ...
+    'int64',  [1 1], 'eventsWritten'; ...
+    'int32',  [1 1], 'status'; ...
+    'int32',  [1 1], 'reserved'});
+
+h = header.Data;
+if ~strcmp(char(h.magic(1:7)), 'OESHMEM') || h.version ~= 1
+    error('read_shared_memory:format', '%s is not an Open Ephys shared memory file', filename);
+end
+
+numChannels = double(h.numChannels);
+ringSamples = double(h.ringSamples);
+ringEvents = double(h.ringEvents);
+
+shm = struct('map', header, 'numChannels', numChannels, 'ringSamples', ringSamples, ...
+    'sampleRate', double(h.sampleRate), 'sourceID', h.sourceID, 'status', h.status);
+
+tsMap = memmapfile(filename, 'Writable', false, 'Offset', double(h.timestampsOffset), ...
+    'Format', 'int64', 'Repeat', ringSamples);
+sampleMap = memmapfile(filename, 'Writable', false, 'Offset', double(h.samplesOffset), ...
+    'Format', {'single', [ringSamples numChannels], 'x'}, 'Repeat', 1);
+eventMap = memmapfile(filename, 'Writable', false, 'Offset', double(h.eventsOffset), ...
+    'Repeat', ringEvents, 'Format', { ...
+    'int64',  [1 1], 'timestamp'; ...
+    'uint32', [1 1], 'sourceID'; ...
+    'uint16', [1 1], 'line'; ...
+    'uint8',  [1 1], 'state'; ...
+    'uint8',  [1 1], 'reserved'});
+
+% samples from the first to the last written, as long as they are in the ring
+written = double(header.Data.samplesWritten);
+first = max(written - numSamples, max(0, written - ringSamples));
+index = mod(first:(written - 1), ringSamples) + 1;
+
+timestamps = tsMap.Data(index)';
+samples = sampleMap.Data.x(index, :)';
+
+% the oldest samples may have been overwritten while being copied
+lost = double(header.Data.samplesWritten) - ringSamples - first;
+if lost > 0
+    timestamps = timestamps(lost + 1:end);
+    samples = samples(:, lost + 1:end);
+end
+
+eventsWritten = double(header.Data.eventsWritten);
+firstEvent = max(0, eventsWritten - ringEvents);
+events = eventMap.Data(mod(firstEvent:(eventsWritten - 1), ringEvents) + 1);
+
+lost = double(header.Data.eventsWritten) - ringEvents - firstEvent;
+if lost > 0
+    events = events(lost + 1:end);
+end
+
+shm.samplesWritten = written;
+shm.eventsWritten = eventsWritten;
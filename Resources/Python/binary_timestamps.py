@@ -0,0 +1,61 @@
+"""
+Continuous timestamps of recordings made with the Binary record engine.
+
+With the "Implicit continuous timestamps" option, each continuous folder holds
+timestamp_discontinuities.npy instead of timestamps.npy: an (N, 2) int64 array
+with one (sample index, timestamp) row for every sample whose timestamp doesn't
+follow on from the previous one. The samples in between count up by one from
+the row before them. The last row is one past the final sample, so its index
+is the number of samples.
+
+    python binary_timestamps.py <recording folder> [...]
+
+writes the per-sample timestamps.npy of every continuous folder of each
+recording given (the folders holding a structure.oebin file).
+"""
+from __future__ import print_function
+import json
+import os
+import sys
+
+import numpy as np
+
+
+def expand_discontinuities(records):
+    """Returns the timestamp of every sample from the discontinuity records."""
+    records = np.asarray(records, dtype=np.int64).reshape(-1, 2)
+    if records.shape[0] < 2:
+        return np.zeros(0, dtype=np.int64)
+    runs, end = records[:-1], records[-1]
+    indices = np.arange(end[0], dtype=np.int64)
+    run = np.searchsorted(runs[:, 0], indices, side='right') - 1
+    return runs[run, 1] + (indices - runs[run, 0])
+
+
+def load_timestamps(folder):
+    """Returns the continuous timestamps of a continuous folder, whichever way they were stored."""
+    path = os.path.join(folder, 'timestamps.npy')
+    if os.path.exists(path):
+        return np.load(path)
+    return expand_discontinuities(np.load(os.path.join(folder, 'timestamp_discontinuities.npy')))
+
+
+def write_timestamps(recording):
+    """Writes timestamps.npy for every continuous folder of a recording with implicit timestamps."""
+    with open(os.path.join(recording, 'structure.oebin')) as f:
+        structure = json.load(f)
+    for entry in structure.get('continuous', []):
+        if not entry.get('implicit_timestamps', False):
+            continue
+        folder = os.path.join(recording, 'continuous', *entry['folder_name'].split('/'))
+        timestamps = load_timestamps(folder)
+        np.save(os.path.join(folder, 'timestamps.npy'), timestamps)
+        print('Wrote %d timestamps to %s' % (len(timestamps), folder))
+
+
+if __name__ == '__main__':
+    if len(sys.argv) < 2:
+        print(__doc__)
+        sys.exit(1)
+    for recording in sys.argv[1:]:
+        write_timestamps(recording)
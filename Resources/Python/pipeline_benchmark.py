@@ -0,0 +1,283 @@
+"""
+    Runs the benchmark chains of Resources/Configs/Benchmarks in a headless GUI, with the
+    Synthetic Source at several channel counts, and writes the time each processor takes per
+    block, the sustained real-time factor of the chain and the peak memory, as JSON that can
+    be compared across commits:
+
+        python pipeline_benchmark.py --binary Builds/Linux/build/open-ephys --output new.json
+        python pipeline_benchmark.py --output new.json --baseline old.json --tolerance 10
+
+    With a baseline, the mean and p99 times of every processor and of the whole chain are
+    compared to it, and the script exits with 1 if any got slower by more than the tolerance.
+    The real-time factor is how many times faster than the data arrive the chain processes
+    them: 2 means a block takes half its duration. Peak memory needs a Unix system.
+"""
+
+from __future__ import print_function
+
+import argparse
+import datetime
+import json
+import os
+import platform
+import shutil
+import subprocess
+import sys
+import tempfile
+import xml.etree.ElementTree as ElementTree
+
+
+REPO_ROOT = os.path.abspath(os.path.join(os.path.dirname(__file__), '..', '..'))
+PRESET_DIR = os.path.join(REPO_ROOT, 'Resources', 'Configs', 'Benchmarks')
+DEFAULT_BINARY = os.path.join(REPO_ROOT, 'Builds', 'Linux', 'build', 'open-ephys')
+
+CHANNEL_COUNTS = [64, 384, 1024, 4096]
+CHANNELS_PER_ELECTRODE = 4
+
+
+def write_preset(preset, channels, record_path, path):
+    """ Writes the preset with the channel count and the record path, and one tetrode for
+        every four channels in its spike detectors """
+
+    tree = ElementTree.parse(preset)
+
+    for processor in tree.iter('PROCESSOR'):
+        name = processor.get('pluginName')
+
+        if name == 'Synthetic Source':
+            processor.find('EDITOR').set('Channels', str(channels))
+
+        elif name == 'Spike Detector':
+            for electrode in processor.findall('ELECTRODE'):
+                processor.remove(electrode)
+
+            for e in range(channels // CHANNELS_PER_ELECTRODE):
+                electrode = ElementTree.SubElement(processor, 'ELECTRODE', {
+                    'name': 'Tetrode %d' % (e + 1),
+                    'numChannels': str(CHANNELS_PER_ELECTRODE),
+                    'prePeakSamples': '8',
+                    'postPeakSamples': '32',
+                    'electrodeID': str(e + 1)})
+
+                for c in range(CHANNELS_PER_ELECTRODE):
+                    ElementTree.SubElement(electrode, 'SUBCHANNEL', {
+                        'ch': str(e * CHANNELS_PER_ELECTRODE + c),
+                        'thresh': '50',
+                        'isActive': '1'})
+
+    control_panel = tree.find('CONTROLPANEL')
+    if control_panel is not None:
+        control_panel.set('recordPath', record_path)
+
+    tree.write(path)
+
+
+def sample_rate_of(preset):
+    for processor in ElementTree.parse(preset).iter('PROCESSOR'):
+        if processor.get('pluginName') == 'Synthetic Source':
+            return float(processor.find('EDITOR').get('SampleRate', '30000'))
+
+    return 30000.
+
+
+def records(preset):
+    """ If the preset is meant to be run recording, which its BENCHMARK element tells """
+
+    benchmark = ElementTree.parse(preset).find('BENCHMARK')
+    return benchmark is not None and benchmark.get('record') == '1'
+
+
+def run_gui(binary, settings, duration, record, timings):
+    """ Runs a headless GUI until it exits, and returns its exit code and peak resident
+        memory in MB, None where the system cannot tell """
+
+    command = [binary, '--headless', settings, '--duration', str(duration), '--timings', timings]
+    if record:
+        command.append('--record')
+
+    child = subprocess.Popen(command, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+    output = child.stdout.read()
+    child.stdout.close()
+
+    # the child is reaped here rather than by wait(), for its resource usage
+    peak_rss_mb = None
+    if hasattr(os, 'wait4'):
+        _, status, usage = os.wait4(child.pid, 0)
+        child.returncode = os.WEXITSTATUS(status) if os.WIFEXITED(status) else -1
+        # kilobytes on Linux, bytes on macOS
+        peak_rss_mb = usage.ru_maxrss / (1024. * 1024. if sys.platform == 'darwin' else 1024.)
+    else:
+        child.wait()
+
+    return child.returncode, peak_rss_mb, output.decode('utf-8', 'replace')
+
+
+def summarize(timings, sample_rate, duration):
+    processors = []
+    inverse_throughput = 0.
+    total_mean_ms = 0.
+    total_p99_ms = 0.
+    num_blocks = 0
+
+    for p in timings['processors']:
+        if p['count'] == 0:
+            continue
+
+        processors.append({
+            'name': p['name'],
+            'processor_id': p['processor_id'],
+            'blocks': p['count'],
+            'mean_ms': p['mean_ms'],
+            'p99_ms': p['p99_ms'],
+            'max_ms': p['max_ms'],
+            'memory_bytes': p.get('memory_bytes')})
+
+        total_mean_ms += p['mean_ms']
+        total_p99_ms += p['p99_ms']
+        num_blocks = max(num_blocks, p['count'])
+
+        if p['samples_per_second'] > 0:
+            inverse_throughput += 1. / p['samples_per_second']
+
+    # the processors run one after the other, so the chain's throughput adds up their times
+    chain_samples_per_second = 1. / inverse_throughput if inverse_throughput > 0 else 0.
+
+    return {
+        'processors': processors,
+        'blocks': num_blocks,
+        'block_ms': duration * 1000. / num_blocks if num_blocks > 0 else 0.,
+        'total_mean_ms': total_mean_ms,
+        # an upper bound, the slowest blocks of each processor not being the same blocks
+        'total_p99_ms': total_p99_ms,
+        'real_time_factor': chain_samples_per_second / sample_rate,
+        'memory_bytes': timings.get('memory_bytes')}
+
+
+def compare(baseline, result, tolerance):
+    """ Returns the times that got slower than the baseline by more than the tolerance, in % """
+
+    previous = {}
+    for run in baseline['runs']:
+        previous[(run['preset'], run['channels'])] = run
+
+    regressions = []
+
+    def check(what, old, new):
+        if old > 0 and (new - old) / old * 100. > tolerance:
+            regressions.append('%s: %.3f -> %.3f ms (+%.1f%%)' % (what, old, new, (new - old) / old * 100.))
+
+    for run in result['runs']:
+        old = previous.get((run['preset'], run['channels']))
+        if old is None or 'total_mean_ms' not in old or 'total_mean_ms' not in run:
+            continue
+
+        label = '%s, %d channels' % (run['preset'], run['channels'])
+        check(label + ', total mean', old['total_mean_ms'], run['total_mean_ms'])
+        check(label + ', total p99', old['total_p99_ms'], run['total_p99_ms'])
+
+        old_processors = dict((p['name'], p) for p in old['processors'])
+        for p in run['processors']:
+            o = old_processors.get(p['name'])
+            if o is not None:
+                check('%s, %s mean' % (label, p['name']), o['mean_ms'], p['mean_ms'])
+                check('%s, %s p99' % (label, p['name']), o['p99_ms'], p['p99_ms'])
+
+    return regressions
+
+
+def git_commit():
+    try:
+        return subprocess.check_output(['git', 'rev-parse', 'HEAD'], cwd=REPO_ROOT).decode().strip()
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Benchmarks signal chains in a headless GUI')
+    parser.add_argument('--binary', default=DEFAULT_BINARY, help='the open-ephys executable')
+    parser.add_argument('--presets', nargs='*', default=['full_chain', 'filter_car'],
+                        help='presets of Resources/Configs/Benchmarks, without the .xml')
+    parser.add_argument('--channels', nargs='*', type=int, default=CHANNEL_COUNTS)
+    parser.add_argument('--duration', type=float, default=20., help='seconds of acquisition per run')
+    parser.add_argument('--no-record', action='store_true', help='do not record, even for presets that do')
+    parser.add_argument('--output', default='pipeline_benchmark.json')
+    parser.add_argument('--baseline', help='the output of a previous run to compare to')
+    parser.add_argument('--tolerance', type=float, default=10., help='in % of the baseline times')
+    args = parser.parse_args()
+
+    result = {
+        'commit': git_commit(),
+        'date': datetime.datetime.now().isoformat(),
+        'host': platform.node(),
+        'platform': platform.platform(),
+        'processor': platform.processor(),
+        'duration_s': args.duration,
+        'runs': []}
+
+    work_dir = tempfile.mkdtemp(prefix='oe_benchmark_')
+
+    try:
+        for preset_name in args.presets:
+            preset = os.path.join(PRESET_DIR, preset_name + '.xml')
+            sample_rate = sample_rate_of(preset)
+            record = records(preset) and not args.no_record
+
+            for channels in args.channels:
+                settings = os.path.join(work_dir, '%s_%d.xml' % (preset_name, channels))
+                timings = os.path.join(work_dir, '%s_%d.json' % (preset_name, channels))
+                record_path = os.path.join(work_dir, 'recordings')
+                if not os.path.isdir(record_path):
+                    os.makedirs(record_path)
+
+                write_preset(preset, channels, record_path, settings)
+
+                print('%s, %d channels...' % (preset_name, channels))
+                exit_code, peak_rss_mb, output = run_gui(args.binary, settings, args.duration, record, timings)
+
+                run = {
+                    'preset': preset_name,
+                    'channels': channels,
+                    'sample_rate': sample_rate,
+                    'recorded': record,
+                    'exit_code': exit_code,
+                    'peak_rss_mb': peak_rss_mb}
+
+                if exit_code == 0 and os.path.isfile(timings):
+                    with open(timings) as f:
+                        run.update(summarize(json.load(f), sample_rate, args.duration))
+
+                    print('    %.3f ms per block (p99 %.3f ms), real-time factor %.1f, peak %s MB' % (
+                        run['total_mean_ms'], run['total_p99_ms'], run['real_time_factor'],
+                        '%.0f' % peak_rss_mb if peak_rss_mb is not None else '?'))
+                else:
+                    print('    failed with exit code %d:' % exit_code)
+                    print(output[-2000:])
+
+                result['runs'].append(run)
+
+                shutil.rmtree(record_path, ignore_errors=True)
+    finally:
+        shutil.rmtree(work_dir, ignore_errors=True)
+
+    with open(args.output, 'w') as f:
+        json.dump(result, f, indent=2)
+
+    print('Written to', args.output)
+
+    failed = [run for run in result['runs'] if run['exit_code'] != 0]
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            regressions = compare(json.load(f), result, args.tolerance)
+
+        for regression in regressions:
+            print('Regression:', regression)
+
+        if regressions:
+            return 1
+
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
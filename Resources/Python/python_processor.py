@@ -0,0 +1,195 @@
+"""Runs a script for the Python Processor of the Open Ephys GUI.
+
+The GUI starts it when acquisition starts, as
+
+    python3 -u python_processor.py <shared file> <script>
+
+and it calls the script on each block the GUI hands over in the shared file,
+whose layout is described with PythonBlockHeader in
+Source/Plugins/PythonProcessor/PythonProcessor.h. The script defines
+
+    process(data, events)
+        data is a float32 array of one row of samples per channel, in
+        microvolts, to overwrite with the output in place. It is a view of the
+        shared file, so nothing is copied. events is a structured array of the
+        TTL events of the block, with the fields of EVENT below.
+
+and may define start(sample_rate, num_channels), called before the first
+block, and stop(), called once acquisition stops. What it prints shows in the
+console of the GUI.
+
+The output of a block replaces the next one, so process() has the length of a
+block to return: past that, the GUI passes the block through, or silences it,
+and skips blocks until the script catches up. See exampleProcessor.py next to
+the plugin.
+"""
+from __future__ import print_function, division
+import ctypes
+import importlib
+import mmap
+import os
+import platform
+import sys
+import time
+
+import numpy as np
+
+
+STARTING = 0
+ACQUIRING = 1
+STOPPED = 2
+CLOSED = 3
+
+FREE = 0
+READY = 1
+DONE = 2
+
+SLOT_HEADER_BYTES = 64
+
+HEADER = np.dtype([('magic', 'S8'),
+                   ('version', '<u4'),
+                   ('header_bytes', '<u4'),
+                   ('num_channels', '<u4'),
+                   ('max_samples', '<u4'),
+                   ('max_events', '<u4'),
+                   ('event_bytes', '<u4'),
+                   ('sample_rate', '<f4'),
+                   ('num_slots', '<u4'),
+                   ('slot_bytes', '<u8'),
+                   ('slots_offset', '<u8'),
+                   ('status', '<i4'),
+                   ('sequence', '<i4')])
+
+SLOT = np.dtype([('block_number', '<i8'),
+                 ('timestamp', '<i8'),
+                 ('state', '<i4'),
+                 ('num_samples', '<i4'),
+                 ('num_events', '<i4'),
+                 ('reserved', '<i4')])
+
+EVENT = np.dtype([('timestamp', '<i8'),
+                  ('sample_number', '<i4'),
+                  ('line', '<u2'),
+                  ('state', 'u1'),
+                  ('reserved', 'u1')])
+
+# numbers of the futex system call, for the machines the GUI runs on
+FUTEX_SYSCALLS = {'x86_64': 202, 'amd64': 202, 'aarch64': 98,
+                  'i386': 240, 'i686': 240, 'armv7l': 240}
+FUTEX_WAIT = 0
+WAIT_SECONDS = 0.1
+
+
+class Timespec(ctypes.Structure):
+    _fields_ = [('tv_sec', ctypes.c_long), ('tv_nsec', ctypes.c_long)]
+
+
+class SharedBlocks(object):
+
+    def __init__(self, path):
+        with open(path, 'r+b') as f:
+            self._map = mmap.mmap(f.fileno(), 0)
+
+        self.header = np.frombuffer(self._map, HEADER, 1)
+        if self.header['magic'][0] != b'OEPYBLK':
+            raise ValueError('%s is not an Open Ephys Python block file' % path)
+        if self.header['version'][0] != 1:
+            raise ValueError('Unknown block file version %d' % self.header['version'][0])
+
+        self.num_channels = int(self.header['num_channels'][0])
+        self.max_samples = int(self.header['max_samples'][0])
+        self.sample_rate = float(self.header['sample_rate'][0])
+
+        max_events = int(self.header['max_events'][0])
+        samples_bytes = self.num_channels * self.max_samples * 4
+        events_offset = SLOT_HEADER_BYTES + ((samples_bytes + 7) & ~7)
+
+        # views of the file, which the GUI keeps writing to
+        self.slots, self.samples, self.events = [], [], []
+        for i in range(int(self.header['num_slots'][0])):
+            offset = int(self.header['slots_offset'][0]) + i * int(self.header['slot_bytes'][0])
+            self.slots.append(np.frombuffer(self._map, SLOT, 1, offset))
+            self.samples.append(np.frombuffer(
+                self._map, '<f4', self.num_channels * self.max_samples,
+                offset + SLOT_HEADER_BYTES).reshape(self.num_channels, self.max_samples))
+            self.events.append(np.frombuffer(self._map, EVENT, max_events,
+                                             offset + events_offset))
+
+        self._futex = None
+        syscall = FUTEX_SYSCALLS.get(platform.machine().lower())
+        if sys.platform.startswith('linux') and syscall is not None:
+            libc = ctypes.CDLL(None, use_errno=True)
+            self._futex = (libc.syscall, syscall,
+                           self.header.ctypes.data + HEADER.fields['sequence'][1])
+
+    @property
+    def status(self):
+        return int(self.header['status'][0])
+
+    @property
+    def sequence(self):
+        return int(self.header['sequence'][0])
+
+    def wait(self, sequence):
+        """Returns once the sequence may have moved on from the value read"""
+        if self._futex is None:
+            time.sleep(0.0005)
+            return
+        call, number, address = self._futex
+        timeout = Timespec(0, int(WAIT_SECONDS * 1e9))
+        call(ctypes.c_long(number), ctypes.c_void_p(address), FUTEX_WAIT,
+             ctypes.c_int(sequence), ctypes.byref(timeout), None, 0)
+
+    def ready_slots(self):
+        """The indices of the slots holding a block, oldest first"""
+        ready = [i for i, slot in enumerate(self.slots) if slot['state'][0] == READY]
+        return sorted(ready, key=lambda i: self.slots[i]['block_number'][0])
+
+    def close(self):
+        self.header = self.slots = self.samples = self.events = None
+        self._map.close()
+
+
+def load_script(path):
+    directory, name = os.path.split(os.path.abspath(path))
+    sys.path.insert(0, directory)
+    return importlib.import_module(os.path.splitext(name)[0])
+
+
+def run(path, script_path):
+    blocks = SharedBlocks(path)
+    script = load_script(script_path)
+    print('%s on %d channels at %g Hz' %
+          (os.path.basename(script_path), blocks.num_channels, blocks.sample_rate))
+
+    if hasattr(script, 'start'):
+        script.start(blocks.sample_rate, blocks.num_channels)
+
+    while True:
+        # read first, so that a block coming in while checking wakes the wait up
+        sequence = blocks.sequence
+        if blocks.status in (STOPPED, CLOSED):
+            break
+
+        ready = blocks.ready_slots()
+        if not ready:
+            blocks.wait(sequence)
+            continue
+
+        # behind: the GUI already passed the older blocks on
+        for i in ready[:-1]:
+            blocks.slots[i]['state'][0] = DONE
+
+        i = ready[-1]
+        slot = blocks.slots[i]
+        script.process(blocks.samples[i][:, :int(slot['num_samples'][0])],
+                       blocks.events[i][:int(slot['num_events'][0])])
+        slot['state'][0] = DONE
+
+    if hasattr(script, 'stop'):
+        script.stop()
+    blocks.close()
+
+
+if __name__ == '__main__':
+    run(sys.argv[1], sys.argv[2])
@@ -0,0 +1,156 @@
+"""Reads the file written by the Shared Memory sink of the Open Ephys GUI.
+
+The samples are read in place, in the memory the GUI writes, without any copy
+or system call. The layout of the file is described with SharedMemoryHeader in
+Source/Plugins/EventBroadcaster/SharedMemoryOutput.h.
+
+Example, printing the mean of each channel over the last 100 ms:
+
+    reader = SharedMemoryReader('/dev/shm/open-ephys-105.shm')
+    while True:
+        timestamps, samples = reader.latest(int(reader.sample_rate / 10))
+        print(timestamps[-1], samples.mean(axis=1))
+        time.sleep(0.1)
+"""
+from __future__ import print_function, division
+import mmap
+import sys
+import time
+
+import numpy as np
+
+
+STARTING = 0
+ACQUIRING = 1
+STOPPED = 2
+CLOSED = 3
+
+HEADER = np.dtype([('magic', 'S8'),
+                   ('version', '<u4'),
+                   ('header_bytes', '<u4'),
+                   ('num_channels', '<u4'),
+                   ('ring_samples', '<u4'),
+                   ('sample_rate', '<f4'),
+                   ('source_id', '<u4'),
+                   ('event_bytes', '<u4'),
+                   ('ring_events', '<u4'),
+                   ('timestamps_offset', '<u8'),
+                   ('samples_offset', '<u8'),
+                   ('events_offset', '<u8'),
+                   ('total_bytes', '<u8'),
+                   ('samples_written', '<i8'),
+                   ('events_written', '<i8'),
+                   ('status', '<i4'),
+                   ('reserved', '<i4')])
+
+EVENT = np.dtype([('timestamp', '<i8'),
+                  ('source_id', '<u4'),
+                  ('line', '<u2'),
+                  ('state', 'u1'),
+                  ('reserved', 'u1')])
+
+
+class SharedMemoryReader(object):
+
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            self._map = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+
+        self._header = np.frombuffer(self._map, HEADER, 1)[0]
+        if self._header['magic'] != b'OESHMEM':
+            raise ValueError('%s is not an Open Ephys shared memory file' % path)
+        if self._header['version'] != 1:
+            raise ValueError('Unknown shared memory version %d' % self._header['version'])
+
+        self.num_channels = int(self._header['num_channels'])
+        self.ring_samples = int(self._header['ring_samples'])
+        self.ring_events = int(self._header['ring_events'])
+        self.sample_rate = float(self._header['sample_rate'])
+        self.source_id = int(self._header['source_id'])
+
+        # views of the file, which the GUI keeps writing to
+        self.timestamps = np.frombuffer(self._map, '<i8', self.ring_samples,
+                                        int(self._header['timestamps_offset']))
+        self.samples = np.frombuffer(
+            self._map, '<f4', self.num_channels * self.ring_samples,
+            int(self._header['samples_offset'])).reshape(
+                self.num_channels, self.ring_samples)
+        self.events = np.frombuffer(self._map, EVENT, self.ring_events,
+                                    int(self._header['events_offset']))
+
+    @property
+    def status(self):
+        return int(self._header['status'])
+
+    @property
+    def samples_written(self):
+        return int(self._header['samples_written'])
+
+    @property
+    def events_written(self):
+        return int(self._header['events_written'])
+
+    def read(self, first, count):
+        """Copies samples first to first + count - 1, counted from the start of
+        acquisition, returning (timestamps, samples) of those still in the ring
+        once copied, which are the last ones of the range."""
+        written = self.samples_written
+        first = max(first, written - self.ring_samples)
+        count = min(count, written - first)
+        if count <= 0:
+            return (np.empty(0, np.int64),
+                    np.empty((self.num_channels, 0), np.float32))
+
+        index = np.arange(first, first + count) % self.ring_samples
+        timestamps = self.timestamps[index]
+        samples = self.samples[:, index]
+
+        # the oldest samples may have been overwritten while being copied
+        lost = self.samples_written - self.ring_samples - first
+        if lost > 0:
+            timestamps = timestamps[lost:]
+            samples = samples[:, lost:]
+        return timestamps, samples
+
+    def latest(self, count):
+        """Copies the last count samples, as with read()"""
+        return self.read(self.samples_written - count, count)
+
+    def read_events(self, first):
+        """Copies the events from number first on, returning them with the number
+        of the next event to read"""
+        written = self.events_written
+        first = max(first, written - self.ring_events)
+        events = self.events[np.arange(first, written) % self.ring_events]
+
+        lost = self.events_written - self.ring_events - first
+        if lost > 0:
+            events = events[lost:]
+        return events, written
+
+    def close(self):
+        self.timestamps = self.samples = self.events = self._header = None
+        self._map.close()
+
+
+def run(path):
+    reader = SharedMemoryReader(path)
+    print('%d channels at %g Hz, %d samples in the ring' %
+          (reader.num_channels, reader.sample_rate, reader.ring_samples))
+
+    next_sample = reader.samples_written
+    next_event = reader.events_written
+    while reader.status in (STARTING, ACQUIRING):
+        time.sleep(0.1)
+        timestamps, samples = reader.read(next_sample, reader.ring_samples)
+        events, next_event = reader.read_events(next_event)
+        if len(timestamps):
+            next_sample = reader.samples_written
+            print('%d samples up to %d, %d events' %
+                  (len(timestamps), timestamps[-1], len(events)))
+
+    reader.close()
+
+
+if __name__ == '__main__':
+    run(sys.argv[1])
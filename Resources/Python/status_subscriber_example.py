@@ -0,0 +1,44 @@
+"""
+    A zmq client that sends a batch of commands to the open-ephys GUI and then
+    follows its status as it is published, without polling
+"""
+
+import zmq
+import json
+
+
+def run_client():
+
+    ip = '127.0.0.1'
+    command_port = 5556
+    status_port = 5560
+    timeout = 1.
+
+    with zmq.Context() as context:
+
+        # a batch is answered with the list of the replies to its commands
+        with context.socket(zmq.REQ) as socket:
+            socket.RCVTIMEO = int(timeout * 1000)  # timeout in milliseconds
+            socket.connect("tcp://%s:%d" % (ip, command_port))
+
+            socket.send(json.dumps(['IsAcquiring', 'IsRecording', 'GetRecordingPath']))
+            print "Replies:", json.loads(socket.recv())
+
+        # snapshots are published ten times per second
+        with context.socket(zmq.SUB) as socket:
+            socket.setsockopt(zmq.SUBSCRIBE, '')
+            socket.connect("tcp://%s:%d" % (ip, status_port))
+
+            while True:
+                status = json.loads(socket.recv())
+
+                print "acquiring: %s, recording: %s, cpu: %.2f, buffer: %.2f, dropped: %d" % (
+                    status['acquiring'], status['recording'], status['cpu_load'],
+                    status['buffer_fill'], status['dropped_samples'])
+
+                for p in status['processors']:
+                    print "    %s (%d): p99 %.3f ms" % (p['name'], p['processor_id'], p['p99_ms'])
+
+
+if __name__ == '__main__':
+    run_client()
@@ -0,0 +1,55 @@
+"""Receives the spikes and TTL events sent by the UDP Events sink of the Open
+Ephys GUI, and prints them with the datagrams lost on the way.
+
+The layout of the datagrams is described with UdpEventHeader in
+Source/Plugins/EventBroadcaster/UdpEventOutput.h.
+
+    python udp_event_receiver.py [port]
+"""
+from __future__ import print_function
+import socket
+import struct
+import sys
+
+
+HEADER = struct.Struct('<4sHHII')
+RECORD = struct.Struct('<qHBBHH4f')
+
+SPIKE = 1
+TTL = 2
+
+
+def run(port):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(('', port))
+    print('Listening on port %d' % port)
+
+    expected = None
+    lost = 0
+    while True:
+        data = sock.recv(65536)
+        magic, version, num_records, sequence, _ = HEADER.unpack_from(data)
+        if magic != b'OEUE' or version != 1:
+            continue
+
+        # a new acquisition starts again from 0
+        if expected is not None and sequence > expected:
+            lost += sequence - expected
+            print('lost %d datagrams (%d in total)' % (sequence - expected, lost))
+        expected = sequence + 1
+
+        for i in range(num_records):
+            (timestamp, source, kind, num_features, electrode, sorted_id,
+             f0, f1, f2, f3) = RECORD.unpack_from(data, HEADER.size + i * RECORD.size)
+            if kind == SPIKE:
+                features = (f0, f1, f2, f3)[:num_features]
+                print('spike  %d  source %d  electrode %d  unit %d  %s' %
+                      (timestamp, source, electrode, sorted_id,
+                       ' '.join('%.1f' % f for f in features)))
+            elif kind == TTL:
+                print('ttl    %d  source %d  line %d  %s' %
+                      (timestamp, source, electrode, 'on' if sorted_id else 'off'))
+
+
+if __name__ == '__main__':
+    run(int(sys.argv[1]) if len(sys.argv) > 1 else 5560)
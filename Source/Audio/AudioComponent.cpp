@@ -23,17 +23,21 @@
 
 
 #include "AudioComponent.h"
+#include "DataClockDevice.h"
 #include <stdio.h>
 
-AudioComponent::AudioComponent() : isPlaying(false)
+AudioComponent::AudioComponent(bool dataClockOnly) : isPlaying(false)
 {
     // if this is nonempty, we got an error
-    String error = deviceManager.initialise(0,  // numInputChannelsNeeded
-                                            2,  // numOutputChannelsNeeded
-                                            0,  // *savedState (XmlElement)
-                                            true, // selectDefaultDeviceOnFailure
-                                            String::empty, // preferred device
-                                            0); // preferred device setup options
+    String error;
+
+    if (!dataClockOnly)
+        error = deviceManager.initialise(0,  // numInputChannelsNeeded
+                                         2,  // numOutputChannelsNeeded
+                                         0,  // *savedState (XmlElement)
+                                         true, // selectDefaultDeviceOnFailure
+                                         String::empty, // preferred device
+                                         0); // preferred device setup options
     if (error != String::empty)
     {
         String titleMessage = String("Audio device initialization error");
@@ -57,19 +61,30 @@ AudioComponent::AudioComponent() : isPlaying(false)
         }
     }
 
+    // added after initialise(), so that it is never picked as the default device type
+    dataClockType = new DataClockDeviceType();
+    deviceManager.addAudioDeviceType(dataClockType);
 
     AudioIODevice* aIOd = deviceManager.getCurrentAudioDevice();
 
+    if (dataClockOnly)
+    {
+        deviceManager.setCurrentAudioDeviceType(DataClockDeviceType::typeName, true);
+        aIOd = deviceManager.getCurrentAudioDevice();
+    }
     // the error string doesn't tell you if there's no audio device found...
-    if (aIOd == 0)
+    else if (aIOd == 0)
     {
+        deviceManager.setCurrentAudioDeviceType(DataClockDeviceType::typeName, true);
+        aIOd = deviceManager.getCurrentAudioDevice();
+
         String titleMessage = String("No audio device found");
         String contentMessage = String("Couldn't find an audio device. ") +
-                                String("Perhaps some other program has control of the default one.");
-        AlertWindow::showMessageBox(AlertWindow::InfoIcon,
-                                    titleMessage,
-                                    contentMessage);
-        JUCEApplication::quit();
+                                String("Perhaps some other program has control of the default one.\n") +
+                                String("Acquisition will be driven by the incoming data, without audio monitoring.");
+        AlertWindow::showMessageBoxAsync(AlertWindow::InfoIcon,
+                                         titleMessage,
+                                         contentMessage);
     }
 
 
@@ -157,6 +172,8 @@ void AudioComponent::connectToProcessorGraph(AudioProcessorGraph* processorGraph
 
     graphPlayer->setProcessor(processorGraph);
 
+    dataClockType->setDataSource(dynamic_cast<DataClockSource*>(processorGraph));
+
 }
 
 void AudioComponent::disconnectProcessorGraph()
@@ -164,6 +181,8 @@ void AudioComponent::disconnectProcessorGraph()
 
     graphPlayer->setProcessor(0);
 
+    dataClockType->setDataSource(nullptr);
+
 }
 
 bool AudioComponent::callbacksAreActive()
@@ -183,11 +202,42 @@ void AudioComponent::stopDevice()
     deviceManager.closeAudioDevice();
 }
 
+void AudioComponent::switchToDataClock()
+{
+    deviceManager.getAudioDeviceSetup(savedDeviceSetup);
+    savedDeviceType = deviceManager.getCurrentAudioDeviceType();
+
+    std::cout << "Switching to the data clock to pace the file playback." << std::endl;
+
+    AudioDeviceManager::AudioDeviceSetup setup = savedDeviceSetup;
+    setup.outputDeviceName = String::empty;
+    setup.inputDeviceName = String::empty;
+
+    deviceManager.setCurrentAudioDeviceType(DataClockDeviceType::typeName, true);
+    deviceManager.setAudioDeviceSetup(setup, false);
+}
+
+void AudioComponent::restoreSavedDevice()
+{
+    std::cout << "Switching back to audio device type " << savedDeviceType << std::endl;
+
+    deviceManager.setCurrentAudioDeviceType(savedDeviceType, true);
+    deviceManager.setAudioDeviceSetup(savedDeviceSetup, false);
+    savedDeviceType = String::empty;
+
+    stopDevice();
+}
+
 void AudioComponent::beginCallbacks()
 {
 
     if (!isPlaying)
     {
+        // offline runs and playback at other than real time are paced by the data clock, whatever the selected device
+        DataClockSource* source = dataClockType->getDataSource();
+        if (source != nullptr && (source->isFreeRunning() || source->getClockSpeed() != 1.0)
+            && deviceManager.getCurrentAudioDeviceType() != DataClockDeviceType::typeName)
+            switchToDataClock();
 
         //const MessageManagerLock mmLock;
         // MessageManagerLock mml (Thread::getCurrentThread());
@@ -265,6 +315,9 @@ void AudioComponent::endCallbacks()
 
     stopDevice();
 
+    if (savedDeviceType.isNotEmpty())
+        restoreSavedDevice();
+
     int64 ms = Time::getCurrentTime().toMilliseconds();
 
     while (Time::getCurrentTime().toMilliseconds() - ms < 50)
@@ -26,6 +26,8 @@
 
 #include "../../JuceLibraryCode/JuceHeader.h"
 
+class DataClockDeviceType;
+
 /**
 
   Interfaces with system audio hardware.
@@ -35,6 +37,10 @@
 
   Sends output to the audio card for audio monitoring.
 
+  Instead of a sound card, the "Data clock" device type can drive the callbacks
+  as soon as the sources have delivered a block of samples (see DataClockDeviceType).
+  It is selected automatically when there is no audio device.
+
   Determines the initial size of the sample buffer (crucial for
   real-time feedback latency).
 
@@ -47,8 +53,9 @@ class AudioComponent
 
 public:
     /** Constructor. Finds the audio component (if there is one), and sets the
-    default sample rate and buffer size.*/
-    AudioComponent();
+    default sample rate and buffer size. With dataClockOnly, as when running
+    headless, no audio device is looked for and the data clock drives the callbacks.*/
+    AudioComponent(bool dataClockOnly = false);
     ~AudioComponent();
 
     /** Begins the audio callbacks that drive data acquisition.*/
@@ -93,6 +100,16 @@ private:
 
     ScopedPointer<AudioProcessorPlayer> graphPlayer;
 
+    /** Owned by the deviceManager */
+    DataClockDeviceType* dataClockType;
+
+    /** Switches to the data clock for an offline or sped up run, saving the device to go back to afterwards */
+    void switchToDataClock();
+    void restoreSavedDevice();
+
+    String savedDeviceType;
+    AudioDeviceManager::AudioDeviceSetup savedDeviceSetup;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioComponent);
 
 };
@@ -0,0 +1,372 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "DataClockDevice.h"
+#include <thread>
+#include <chrono>
+
+const char* const DataClockDeviceType::typeName = "Data clock";
+
+static const char* const dataClockDeviceName = "Data-driven clock (no sound card)";
+
+
+/** Plays the signal produced by the data clock on the default sound card, if there is one.*/
+class DataClockMonitor : public AudioIODeviceCallback
+{
+public:
+    DataClockMonitor(double sampleRate, int blockSize)
+        : fifo(jmax(4 * blockSize, 8192))
+        , fifoBuffer(2, fifo.getTotalSize())
+    {
+        fifoBuffer.clear();
+
+        String error = deviceManager.initialise(0, 2, nullptr, true);
+
+        if (error.isEmpty() && deviceManager.getCurrentAudioDevice() != nullptr)
+        {
+            AudioDeviceManager::AudioDeviceSetup setup;
+            deviceManager.getAudioDeviceSetup(setup);
+            setup.sampleRate = sampleRate;
+            deviceManager.setAudioDeviceSetup(setup, false);
+
+            std::cout << "Data clock monitor output: " << deviceManager.getCurrentAudioDevice()->getName() << std::endl;
+            deviceManager.addAudioCallback(this);
+        }
+        else
+        {
+            std::cout << "Data clock: no sound card found, audio monitoring is disabled." << std::endl;
+        }
+    }
+
+    ~DataClockMonitor()
+    {
+        deviceManager.removeAudioCallback(this);
+        deviceManager.closeAudioDevice();
+    }
+
+    /** Called by the clock thread. Samples that don't fit are dropped.*/
+    void write(const float* const* channels, int numChannels, int numSamples)
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+
+        for (int ch = 0; ch < 2; ch++)
+        {
+            const float* src = channels[jmin(ch, numChannels - 1)];
+
+            if (size1 > 0)
+                fifoBuffer.copyFrom(ch, start1, src, size1);
+
+            if (size2 > 0)
+                fifoBuffer.copyFrom(ch, start2, src + size1, size2);
+        }
+
+        fifo.finishedWrite(size1 + size2);
+    }
+
+    void audioDeviceIOCallback(const float**, int, float** outputChannelData, int numOutputChannels, int numSamples) override
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(numSamples, start1, size1, start2, size2);
+
+        for (int ch = 0; ch < numOutputChannels; ch++)
+        {
+            float* dst = outputChannelData[ch];
+
+            if (dst == nullptr)
+                continue;
+
+            if (ch < 2)
+            {
+                if (size1 > 0)
+                    FloatVectorOperations::copy(dst, fifoBuffer.getReadPointer(ch, start1), size1);
+
+                if (size2 > 0)
+                    FloatVectorOperations::copy(dst + size1, fifoBuffer.getReadPointer(ch, start2), size2);
+
+                // silence if the clock fell behind
+                FloatVectorOperations::clear(dst + size1 + size2, numSamples - size1 - size2);
+            }
+            else
+            {
+                FloatVectorOperations::clear(dst, numSamples);
+            }
+        }
+
+        fifo.finishedRead(size1 + size2);
+    }
+
+    void audioDeviceAboutToStart(AudioIODevice*) override {}
+    void audioDeviceStopped() override {}
+
+private:
+    AudioDeviceManager deviceManager;
+    AbstractFifo fifo;
+    AudioSampleBuffer fifoBuffer;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DataClockMonitor);
+};
+
+
+class DataClockDevice : public AudioIODevice
+                      , private Thread
+{
+public:
+    DataClockDevice(const DataClockDeviceType& deviceType)
+        : AudioIODevice(dataClockDeviceName, DataClockDeviceType::typeName)
+        , Thread("Data clock")
+        , type(deviceType)
+        , deviceOpen(false)
+        , currentSampleRate(44100.0)
+        , currentBufferSize(1024)
+        , callback(nullptr)
+    {
+    }
+
+    ~DataClockDevice()
+    {
+        close();
+    }
+
+    StringArray getOutputChannelNames() override
+    {
+        StringArray names;
+        names.add("Left");
+        names.add("Right");
+        return names;
+    }
+
+    StringArray getInputChannelNames() override
+    {
+        return StringArray();
+    }
+
+    Array<double> getAvailableSampleRates() override
+    {
+        const double rates[] = { 44100.0, 48000.0, 88200.0, 96000.0 };
+        return Array<double>(rates, numElementsInArray(rates));
+    }
+
+    Array<int> getAvailableBufferSizes() override
+    {
+        const int sizes[] = { 16, 32, 44, 48, 64, 88, 96, 128, 256, 512, 1024, 2048 };
+        return Array<int>(sizes, numElementsInArray(sizes));
+    }
+
+    int getDefaultBufferSize() override
+    {
+        return 1024;
+    }
+
+    String open(const BigInteger&, const BigInteger&, double sampleRate, int bufferSizeSamples) override
+    {
+        close();
+
+        currentSampleRate = sampleRate > 0 ? sampleRate : 44100.0;
+        currentBufferSize = bufferSizeSamples > 0 ? bufferSizeSamples : getDefaultBufferSize();
+
+        outputBuffer.setSize(2, currentBufferSize);
+
+        // offline runs are muted, so the sound card is left alone
+        DataClockSource* const dataSource = type.getDataSource();
+        if (dataSource == nullptr || ! dataSource->isFreeRunning())
+            monitor = new DataClockMonitor(currentSampleRate, currentBufferSize);
+
+        deviceOpen = true;
+
+        return String::empty;
+    }
+
+    void close() override
+    {
+        stop();
+        monitor = nullptr;
+        deviceOpen = false;
+    }
+
+    bool isOpen() override
+    {
+        return deviceOpen;
+    }
+
+    void start(AudioIODeviceCallback* newCallback) override
+    {
+        if (! deviceOpen || newCallback == nullptr)
+            return;
+
+        stop();
+
+        newCallback->audioDeviceAboutToStart(this);
+
+        {
+            const ScopedLock sl(callbackLock);
+            callback = newCallback;
+        }
+
+        startThread(9);
+    }
+
+    void stop() override
+    {
+        stopThread(2000);
+
+        AudioIODeviceCallback* oldCallback;
+
+        {
+            const ScopedLock sl(callbackLock);
+            oldCallback = callback;
+            callback = nullptr;
+        }
+
+        if (oldCallback != nullptr)
+            oldCallback->audioDeviceStopped();
+    }
+
+    bool isPlaying() override
+    {
+        return callback != nullptr;
+    }
+
+    String getLastError() override                      { return String::empty; }
+    int getCurrentBufferSizeSamples() override          { return currentBufferSize; }
+    double getCurrentSampleRate() override              { return currentSampleRate; }
+    int getCurrentBitDepth() override                   { return 32; }
+    BigInteger getActiveOutputChannels() const override { return BigInteger(3); }
+    BigInteger getActiveInputChannels() const override  { return BigInteger(); }
+    int getOutputLatencyInSamples() override            { return 0; }
+    int getInputLatencyInSamples() override             { return 0; }
+
+private:
+    void run() override
+    {
+        const double blockSeconds = currentBufferSize / currentSampleRate;
+        const double ticksPerSecond = (double) Time::getHighResolutionTicksPerSecond();
+        int64 lastBlockTicks = Time::getHighResolutionTicks();
+
+        while (! threadShouldExit())
+        {
+            DataClockSource* const dataSource = type.getDataSource();
+            const bool freeRunning = dataSource != nullptr && dataSource->isFreeRunning();
+            const bool hasSources = dataSource != nullptr && dataSource->hasDataSources();
+            const double speed = dataSource != nullptr ? dataSource->getClockSpeed() : 1.0;
+            const int64 maxWaitTicks = (int64) (blockSeconds * (hasSources ? 4 : 1) * ticksPerSecond / speed);
+
+            while (! threadShouldExit()
+                   && ! freeRunning
+                   && ! (hasSources && dataSource->hasSamplesForBlock(currentBufferSize, currentSampleRate))
+                   && Time::getHighResolutionTicks() - lastBlockTicks < maxWaitTicks)
+            {
+                // finer than Thread::sleep, so that blocks of a millisecond or two keep their pace
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+
+            if (threadShouldExit())
+                break;
+
+            lastBlockTicks = Time::getHighResolutionTicks();
+
+            outputBuffer.clear();
+
+            {
+                const ScopedLock sl(callbackLock);
+
+                if (callback != nullptr)
+                    callback->audioDeviceIOCallback(nullptr, 0, outputBuffer.getArrayOfWritePointers(), 2, currentBufferSize);
+            }
+
+            if (monitor != nullptr)
+                monitor->write(outputBuffer.getArrayOfReadPointers(), 2, currentBufferSize);
+        }
+    }
+
+    const DataClockDeviceType& type;
+    bool deviceOpen;
+    double currentSampleRate;
+    int currentBufferSize;
+
+    CriticalSection callbackLock;
+    AudioIODeviceCallback* callback;
+
+    AudioSampleBuffer outputBuffer;
+    ScopedPointer<DataClockMonitor> monitor;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DataClockDevice);
+};
+
+
+DataClockDeviceType::DataClockDeviceType()
+    : AudioIODeviceType(typeName)
+    , dataSource(nullptr)
+{
+}
+
+DataClockDeviceType::~DataClockDeviceType()
+{
+}
+
+void DataClockDeviceType::setDataSource(DataClockSource* source)
+{
+    dataSource = source;
+}
+
+DataClockSource* DataClockDeviceType::getDataSource() const
+{
+    return dataSource.get();
+}
+
+void DataClockDeviceType::scanForDevices()
+{
+}
+
+StringArray DataClockDeviceType::getDeviceNames(bool wantInputNames) const
+{
+    StringArray names;
+
+    if (! wantInputNames)
+        names.add(dataClockDeviceName);
+
+    return names;
+}
+
+int DataClockDeviceType::getDefaultDeviceIndex(bool) const
+{
+    return 0;
+}
+
+int DataClockDeviceType::getIndexOfDevice(AudioIODevice* device, bool asInput) const
+{
+    return (! asInput && dynamic_cast<DataClockDevice*>(device) != nullptr) ? 0 : -1;
+}
+
+bool DataClockDeviceType::hasSeparateInputsAndOutputs() const
+{
+    return false;
+}
+
+AudioIODevice* DataClockDeviceType::createDevice(const String& outputDeviceName, const String& inputDeviceName)
+{
+    if (outputDeviceName == dataClockDeviceName || (outputDeviceName.isEmpty() && inputDeviceName.isEmpty()))
+        return new DataClockDevice(*this);
+
+    return nullptr;
+}
@@ -0,0 +1,106 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __DATACLOCKDEVICE_H_5F0C3A91__
+#define __DATACLOCKDEVICE_H_5F0C3A91__
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  Tells the data clock whether the sources of the signal chain hold enough samples
+  for its next block.
+
+  @see DataClockDeviceType
+
+*/
+
+class DataClockSource
+{
+public:
+    virtual ~DataClockSource() {}
+
+    /** Returns true if there is at least one source the clock can wait for.*/
+    virtual bool hasDataSources() = 0;
+
+    /** Returns true if every source holds the samples covering blockSize samples at sampleRate,
+    that is, as many samples as it can deliver in a block of that duration.*/
+    virtual bool hasSamplesForBlock(int blockSize, double sampleRate) = 0;
+
+    /** Returns true if the chain is reprocessing recorded data offline, in which case blocks are
+    run back to back, as fast as the chain processes them, and nothing is monitored.*/
+    virtual bool isFreeRunning() = 0;
+
+    /** Returns how many times faster than their duration blocks are to be run, when the
+    sources are played back from files rather than acquired live. 1 otherwise.*/
+    virtual double getClockSpeed() = 0;
+};
+
+/**
+
+  An audio device type with a single device that is not a sound card.
+
+  The device runs the audio callback from a thread of its own, as soon as the
+  DataClockSource reports that a block worth of samples has arrived, instead of at the
+  pace of a sound card. The block size can therefore be as small as the data allows, and
+  acquisition runs on machines with no audio hardware at all. If the sources stall, or
+  there are none, a block is still run once its duration has elapsed several times over
+  (once, without sources), so that the rest of the chain keeps going. When the source is
+  free running, blocks are run without waiting at all, and files played back at other than
+  their recorded speed have their blocks run that many times faster.
+
+  The output of the callback (the AudioNode's monitor signal) is passed through a FIFO to
+  the default sound card, if there is one, which plays it at its own pace.
+
+  @see AudioComponent
+
+*/
+
+class DataClockDeviceType : public AudioIODeviceType
+{
+public:
+    DataClockDeviceType();
+    ~DataClockDeviceType();
+
+    /** Sets the source that the devices wait for. Can be null.*/
+    void setDataSource(DataClockSource* source);
+
+    DataClockSource* getDataSource() const;
+
+    void scanForDevices() override;
+    StringArray getDeviceNames(bool wantInputNames = false) const override;
+    int getDefaultDeviceIndex(bool forInput) const override;
+    int getIndexOfDevice(AudioIODevice* device, bool asInput) const override;
+    bool hasSeparateInputsAndOutputs() const override;
+    AudioIODevice* createDevice(const String& outputDeviceName, const String& inputDeviceName) override;
+
+    static const char* const typeName;
+
+private:
+    Atomic<DataClockSource*> dataSource;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DataClockDeviceType);
+};
+
+
+#endif  // __DATACLOCKDEVICE_H_5F0C3A91__
@@ -27,6 +27,8 @@
 
 #include "Processors/ProcessorGraph/ProcessorGraph.h"
 #include "Processors/RecordNode/RecordNode.h"
+#include "Processors/SourceNode/SourceNode.h"
+#include "Audio/AudioComponent.h"
 #include "UI/EditorViewport.h"
 #include "UI/ControlPanel.h"
 #include "Processors/MessageCenter/MessageCenterEditor.h"
@@ -97,6 +99,11 @@ float getSoftwareSampleRate()
 	return getProcessorGraph()->getGlobalSampleRate(true);
 }
 
+bool isOfflineProcessing()
+{
+	return getProcessorGraph()->isFreeRunning();
+}
+
 void setRecordingDirectory(String dir)
 {
     getControlPanel()->setRecordingDirectory(dir);
@@ -157,6 +164,11 @@ int getExperimentNumber()
 	return getProcessorGraph()->getRecordNode()->getExperimentNumber();
 }
 
+void setRecordGate(const EventChannel* channel, int line, float preMs, float postMs)
+{
+	getProcessorGraph()->getRecordNode()->setRecordGate(channel, line, preMs, postMs);
+}
+
 void writeSpike(const SpikeEvent* spike, const SpikeChannel* chan)
 {
     getProcessorGraph()->getRecordNode()->writeSpike(spike, chan);
@@ -198,4 +210,86 @@ String getGUIVersion()
 	return STR_DEF(JUCE_APP_VERSION);
 }
 
+var getStatusSnapshot()
+{
+	ProcessorGraph* graph = getProcessorGraph();
+	const bool acquiring = getAcquisitionStatus();
+
+	DynamicObject::Ptr status = new DynamicObject();
+	status->setProperty("acquiring", acquiring);
+	status->setProperty("recording", getRecordingStatus());
+	status->setProperty("timestamp", getGlobalTimestamp());
+	status->setProperty("sample_rate", getGlobalSampleRate());
+	status->setProperty("cpu_load", acquiring ? getAudioComponent()->deviceManager.getCpuUsage() : 0.0);
+
+	// as summed up by the buffer meter of the control panel
+	float peakFill = 0.0f;
+	int64 droppedSamples = 0;
+	float latencyMs = 0.0f;
+	Array<var> processors;
+	Array<GenericProcessor*> list = graph->getListOfProcessors();
+
+	for (int i = 0; i < list.size(); i++)
+	{
+		GenericProcessor* p = list[i];
+
+		if (SourceNode* source = dynamic_cast<SourceNode*>(p))
+		{
+			float fill, latency;
+			int64 dropped;
+			source->getBufferStatistics(fill, dropped, latency);
+			peakFill = jmax(peakFill, fill);
+			droppedSamples += dropped;
+			latencyMs = jmax(latencyMs, latency);
+		}
+
+		const ProcessorTimingStats::Snapshot s = p->getTimingStats().getSnapshot();
+
+		DynamicObject::Ptr entry = new DynamicObject();
+		entry->setProperty("processor_id", p->getNodeId());
+		entry->setProperty("name", p->getName());
+		entry->setProperty("count", s.numBlocks);
+		entry->setProperty("mean_ms", s.meanMs);
+		entry->setProperty("p99_ms", s.p99Ms);
+		entry->setProperty("max_ms", s.maxMs);
+
+		const var info = p->getStatusInfo();
+		if (!info.isVoid())
+			entry->setProperty("info", info);
+		processors.add(var(entry.get()));
+	}
+
+	status->setProperty("buffer_fill", peakFill);
+	status->setProperty("dropped_samples", droppedSamples);
+	status->setProperty("buffer_latency_ms", latencyMs);
+	status->setProperty("processors", processors);
+
+	::RecordNode* recordNode = graph->getRecordNode();
+	const File dataDirectory = recordNode->getDataDirectory();
+
+	DynamicObject::Ptr disk = new DynamicObject();
+	disk->setProperty("path", dataDirectory.getFullPathName());
+	disk->setProperty("used_fraction", recordNode->getFreeSpace());
+	disk->setProperty("free_bytes", dataDirectory.getBytesFreeOnVolume());
+
+	StringArray engines;
+	Array<float> backlogs, speedRatios;
+	recordNode->getRecordBacklogs(engines, backlogs, speedRatios);
+
+	Array<var> engineStatus;
+	for (int i = 0; i < engines.size(); i++)
+	{
+		DynamicObject::Ptr entry = new DynamicObject();
+		entry->setProperty("engine", engines[i]);
+		entry->setProperty("backlog", backlogs[i]);
+		entry->setProperty("speed_ratio", speedRatios[i]);       // times faster than the data comes, 0 if unknown
+		engineStatus.add(var(entry.get()));
+	}
+	disk->setProperty("engines", engineStatus);
+
+	status->setProperty("disk", var(disk.get()));
+
+	return var(status.get());
+}
+
 };
\ No newline at end of file
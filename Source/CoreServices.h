@@ -30,6 +30,7 @@
 class GenericEditor;
 class GenericProcessor;
 class SpikeChannel;
+class EventChannel;
 class SpikeEvent;
 
 namespace CoreServices
@@ -74,6 +75,10 @@ PLUGIN_API int64 getSoftwareTimestamp();
 /** Gets the ticker frequency of the software timestamp clock*/
 PLUGIN_API float getSoftwareSampleRate();
 
+/** Returns true while recorded data is being reprocessed offline, faster than real time.
+Displays should only update now and then, as blocks come far faster than they can be drawn*/
+PLUGIN_API bool isOfflineProcessing();
+
 /** Set new recording directory */
 PLUGIN_API void setRecordingDirectory(String dir);
 
@@ -107,6 +112,10 @@ PLUGIN_API File getRecordingPath();
 PLUGIN_API int getRecordingNumber();
 PLUGIN_API int getExperimentNumber();
 
+/** Makes the next recordings keep only the continuous data around the rising edges of a TTL line.
+See RecordNode::setRecordGate */
+PLUGIN_API void setRecordGate(const EventChannel* channel, int line, float preMs, float postMs);
+
 /* Spike related methods. See record engine documentation */
 
 PLUGIN_API void writeSpike(const SpikeEvent* spike, const SpikeChannel* chan);
@@ -122,6 +131,13 @@ PLUGIN_API File getDefaultUserSaveDirectory();
 /** Gets the GUI version */
 PLUGIN_API String getGUIVersion();
 
+/** Gathers what the control panel shows, along with the timing of every processor, for
+remote monitoring: acquisition and recording state, CPU load, the fill of the source buffers
+and the samples they dropped, disk space and the write backlog of each record engine.
+Processors returning something from GenericProcessor::getStatusInfo() have it under "info".
+To be called from the message thread. */
+PLUGIN_API var getStatusSnapshot();
+
 };
 
 
@@ -0,0 +1,228 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "HeadlessRunner.h"
+#include "AccessClass.h"
+#include "CoreServices.h"
+#include "UI/UIComponent.h"
+#include "UI/EditorViewport.h"
+#include "Audio/AudioComponent.h"
+#include "Processors/ProcessorGraph/ProcessorGraph.h"
+#include "Processors/GenericProcessor/TraceRecorder.h"
+#include <stdio.h>
+
+HeadlessRunner::Options::Options()
+    : durationSeconds(0), record(false)
+{
+}
+
+static String getOptionValue(const StringArray& parameters, const String& option)
+{
+    const int index = parameters.indexOf(option);
+
+    if (index < 0 || index + 1 >= parameters.size() || parameters[index + 1].startsWith("--"))
+        return String::empty;
+
+    return parameters[index + 1].unquoted();
+}
+
+bool HeadlessRunner::parseCommandLine(const StringArray& parameters, Options& options, String& error)
+{
+    if (!parameters.contains("--headless"))
+        return false;
+
+    const String settingsPath = getOptionValue(parameters, "--headless");
+
+    if (settingsPath.isEmpty())
+    {
+        error = "--headless needs the settings file of the signal chain.";
+        return true;
+    }
+
+    options.settingsFile = File::getCurrentWorkingDirectory().getChildFile(settingsPath);
+
+    if (!options.settingsFile.existsAsFile())
+    {
+        error = "Settings file " + options.settingsFile.getFullPathName() + " not found.";
+        return true;
+    }
+
+    if (parameters.contains("--duration"))
+    {
+        options.durationSeconds = getOptionValue(parameters, "--duration").getDoubleValue();
+
+        if (options.durationSeconds <= 0)
+        {
+            error = "--duration needs a number of seconds.";
+            return true;
+        }
+    }
+
+    options.record = parameters.contains("--record");
+
+    if (parameters.contains("--timings"))
+    {
+        const String timingsPath = getOptionValue(parameters, "--timings");
+
+        if (timingsPath.isEmpty())
+        {
+            error = "--timings needs a file name.";
+            return true;
+        }
+
+        options.timingsFile = File::getCurrentWorkingDirectory().getChildFile(timingsPath);
+    }
+
+    if (parameters.contains("--trace"))
+    {
+        const String tracePath = getOptionValue(parameters, "--trace");
+
+        if (tracePath.isEmpty())
+        {
+            error = "--trace needs a file name.";
+            return true;
+        }
+
+        options.traceFile = File::getCurrentWorkingDirectory().getChildFile(tracePath);
+    }
+
+    return true;
+}
+
+HeadlessRunner::HeadlessRunner(const Options& options_)
+    : options(options_), started(false), finished(false), startTime(0)
+{
+    processorGraph = new ProcessorGraph();
+    std::cout << "Created processor graph." << std::endl;
+
+    // no sound card is opened, the data clock driving the callbacks
+    audioComponent = new AudioComponent(true);
+    std::cout << "Created audio component." << std::endl;
+
+    audioComponent->connectToProcessorGraph(processorGraph);
+
+    ui = new UIComponent(nullptr, processorGraph, audioComponent);
+    AccessClass::getBroadcaster()->addActionListener(this);
+
+    const String result = ui->getEditorViewport()->loadState(options.settingsFile);
+    std::cout << result << std::endl;
+
+    if (!result.startsWith("Opened"))
+    {
+        finished = true;
+        JUCEApplication::getInstance()->setApplicationReturnValue(1);
+        JUCEApplication::quit();
+        return;
+    }
+
+    // acquisition starts once the messages posted while loading have been handled
+    startTimer(100);
+}
+
+HeadlessRunner::~HeadlessRunner()
+{
+    stopTimer();
+
+    if (audioComponent->callbacksAreActive())
+    {
+        audioComponent->endCallbacks();
+        processorGraph->disableProcessors();
+    }
+
+    audioComponent->disconnectProcessorGraph();
+    ui->disableDataViewport();
+
+    if (ActionBroadcaster* broadcaster = AccessClass::getBroadcaster())
+        broadcaster->removeActionListener(this);
+}
+
+void HeadlessRunner::timerCallback()
+{
+    if (!started)
+    {
+        started = true;
+
+        if (options.traceFile != File())
+            TraceRecorder::setEnabled(true);
+
+        CoreServices::setAcquisitionStatus(true);
+
+        if (!audioComponent->callbacksAreActive())
+        {
+            std::cout << "The signal chain could not be started." << std::endl;
+            finish(1);
+            return;
+        }
+
+        if (options.record)
+            CoreServices::setRecordingStatus(true);
+
+        startTime = Time::getMillisecondCounter();
+        std::cout << "Acquisition started." << std::endl;
+        return;
+    }
+
+    // stopped by the end of an offline file, by a remote command or by a processor
+    if (!audioComponent->callbacksAreActive())
+    {
+        finish(0);
+        return;
+    }
+
+    if (options.durationSeconds > 0
+        && Time::getMillisecondCounter() - startTime >= uint32(options.durationSeconds * 1000.0))
+        finish(0);
+}
+
+void HeadlessRunner::actionListenerCallback(const String& message)
+{
+    std::cout << message << std::endl;
+}
+
+void HeadlessRunner::finish(int exitCode)
+{
+    if (finished)
+        return;
+
+    finished = true;
+    stopTimer();
+
+    // ends the recording as well
+    if (CoreServices::getAcquisitionStatus())
+        CoreServices::setAcquisitionStatus(false);
+
+    if (startTime != 0)
+        std::cout << "Acquisition ran for " << (Time::getMillisecondCounter() - startTime) / 1000.0 << " s." << std::endl;
+
+    if (options.timingsFile != File())
+        std::cout << processorGraph->exportTimingStats(options.timingsFile) << std::endl;
+
+    if (options.traceFile != File())
+    {
+        TraceRecorder::setEnabled(false);
+        std::cout << TraceRecorder::exportChromeTrace(options.traceFile) << std::endl;
+    }
+
+    JUCEApplication::getInstance()->setApplicationReturnValue(exitCode);
+    JUCEApplication::quit();
+}
@@ -0,0 +1,107 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __HEADLESSRUNNER_H__
+#define __HEADLESSRUNNER_H__
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+class UIComponent;
+class AudioComponent;
+class ProcessorGraph;
+
+/**
+  Runs a saved signal chain without any window, for instance on a compute node
+  with no display.
+
+  Started with --headless <settings.xml>, the GUI creates a HeadlessRunner instead of
+  the MainWindow. It creates the ProcessorGraph, the AudioComponent and a UIComponent
+  that is never shown, whose editors load the chain as usual, and starts acquisition on
+  the data clock rather than a sound card. The run ends when acquisition stops, be it
+  at the end of an offline File Reader, after the --duration, or through a remote
+  StopAcquisition command to a Network Events processor in the chain. The application
+  then quits, with a non-zero exit code if the chain could not be started.
+
+  Options:
+    --duration <seconds>    stops acquisition after that long
+    --record                records from the start of acquisition
+    --timings <file>        exports the processor timings (.csv or .json) at the end
+    --trace <file>          records a timeline of the threads, saved as a Chrome trace at the end
+
+  Status messages are printed to the standard output.
+
+  @see MainWindow
+
+*/
+
+class HeadlessRunner : private Timer,
+    private ActionListener
+{
+public:
+
+    struct Options
+    {
+        Options();
+
+        File settingsFile;
+        double durationSeconds;
+        bool record;
+        File timingsFile;
+        File traceFile;
+    };
+
+    /** Returns true if the command line asks for a headless run, filling the options.
+        error is set if they are invalid. */
+    static bool parseCommandLine(const StringArray& parameters, Options& options, String& error);
+
+    /** Creates the graph and the UIComponent, loads the chain and starts acquisition. */
+    HeadlessRunner(const Options& options);
+
+    /** Stops acquisition if it is still running and destroys the graph. */
+    ~HeadlessRunner();
+
+private:
+
+    /** Checks whether the run is over */
+    void timerCallback() override;
+
+    void actionListenerCallback(const String& message) override;
+
+    /** Stops acquisition, exports the timings and quits the application. */
+    void finish(int exitCode);
+
+    Options options;
+    bool started;
+    bool finished;
+    uint32 startTime;
+
+    ScopedPointer<UIComponent> ui;
+    ScopedPointer<AudioComponent> audioComponent;
+    ScopedPointer<ProcessorGraph> processorGraph;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(HeadlessRunner)
+
+};
+
+
+#endif  // __HEADLESSRUNNER_H__
@@ -26,6 +26,8 @@
 #endif
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "MainWindow.h"
+#include "HeadlessRunner.h"
+#include "MicroBenchmarks.h"
 #include "UI/LookAndFeel/CustomLookAndFeel.h"
 
 #include <stdio.h>
@@ -38,7 +40,8 @@
   Launches the application and creates the CustomLookAndFeelClass.
 
   The OpenEphysApplication class own the application's MainWindow (via
-  a ScopedPointer).
+  a ScopedPointer), or the HeadlessRunner when started with --headless. With
+  --microbenchmarks, it runs the MicroBenchmarks and quits.
 
   @see MainWindow
 
@@ -85,13 +88,46 @@ public:
         customLookAndFeel = new CustomLookAndFeel();
         LookAndFeel::setDefaultLookAndFeel(customLookAndFeel);
 
+        String error;
+
+        MicroBenchmarks::Options benchmarkOptions;
+
+        if (MicroBenchmarks::parseCommandLine(parameters, benchmarkOptions, error))
+        {
+            if (error.isNotEmpty())
+                std::cout << error << std::endl;
+
+            setApplicationReturnValue(error.isNotEmpty() ? 1 : MicroBenchmarks::run(benchmarkOptions));
+            quit();
+            return;
+        }
+
+        HeadlessRunner::Options headlessOptions;
+
+        if (HeadlessRunner::parseCommandLine(parameters, headlessOptions, error))
+        {
+            if (error.isNotEmpty())
+            {
+                std::cout << error << std::endl;
+                setApplicationReturnValue(1);
+                quit();
+                return;
+            }
+
+            headlessRunner = new HeadlessRunner(headlessOptions);
+            return;
+        }
+
         mainWindow = new MainWindow();
 
 
 
     }
 
-    void shutdown() { }
+    void shutdown()
+    {
+        headlessRunner = nullptr;
+    }
 
     //==============================================================================
     void systemRequestedQuit()
@@ -118,6 +154,7 @@ public:
 
 private:
     ScopedPointer <MainWindow> mainWindow;
+    ScopedPointer <HeadlessRunner> headlessRunner;
     ScopedPointer <CustomLookAndFeel> customLookAndFeel;
     std::ofstream console_out;
 };
@@ -144,6 +144,8 @@ void MainWindow::saveWindowBounds()
 
 	xml->setAttribute("version", JUCEApplication::getInstance()->getApplicationVersion());
 	xml->setAttribute("shouldReloadOnStartup", shouldReloadOnStartup);
+	xml->setAttribute("parallelRendering", processorGraph->isParallelRenderingEnabled());
+	xml->setAttribute("chainThreading", processorGraph->isChainThreadingEnabled());
 
 	XmlElement* bounds = new XmlElement("BOUNDS");
 	bounds->setAttribute("x",getScreenX());
@@ -154,6 +156,10 @@ void MainWindow::saveWindowBounds()
 
 	xml->addChildElement(bounds);
 
+	XmlElement* watchdog = new XmlElement("OVERRUNWATCHDOG");
+	processorGraph->getOverrunWatchdog().savePolicy(watchdog);
+	xml->addChildElement(watchdog);
+
 	XmlElement* recentDirectories = new XmlElement("RECENTDIRECTORYNAMES");
 
 	UIComponent* ui = (UIComponent*) getContentComponent();
@@ -203,6 +209,8 @@ void MainWindow::loadWindowBounds()
 		String description;
 
 		shouldReloadOnStartup = xml->getBoolAttribute("shouldReloadOnStartup", false);
+		processorGraph->setParallelRendering(xml->getBoolAttribute("parallelRendering", false));
+		processorGraph->setChainThreading(xml->getBoolAttribute("chainThreading", false));
 
 		forEachXmlChildElement(*xml, e)
 		{
@@ -226,6 +234,10 @@ void MainWindow::loadWindowBounds()
 				getContentComponent()->setBounds(0,0,w-10,h-33);
 				//setFullScreen(fs);
 			}
+			else if (e->hasTagName("OVERRUNWATCHDOG"))
+			{
+				processorGraph->getOverrunWatchdog().loadPolicy(e);
+			}
 			else if (e->hasTagName("RECENTDIRECTORYNAMES"))
 			{
 
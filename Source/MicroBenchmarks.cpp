@@ -0,0 +1,650 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "MicroBenchmarks.h"
+#include "Processors/Dsp/Dsp.h"
+#include "Processors/DataThreads/DataBuffer.h"
+#include "Processors/RecordNode/DataQueue.h"
+#include "Processors/GenericProcessor/GenericProcessor.h"
+#include "Processors/Events/Events.h"
+#include <stdio.h>
+
+MicroBenchmarks::Options::Options()
+    : minSeconds(0.2)
+{
+}
+
+static String getOptionValue(const StringArray& parameters, const String& option)
+{
+    const int index = parameters.indexOf(option);
+
+    if (index < 0 || index + 1 >= parameters.size() || parameters[index + 1].startsWith("--"))
+        return String::empty;
+
+    return parameters[index + 1].unquoted();
+}
+
+bool MicroBenchmarks::parseCommandLine(const StringArray& parameters, Options& options, String& error)
+{
+    if (!parameters.contains("--microbenchmarks"))
+        return false;
+
+    options.pattern = getOptionValue(parameters, "--microbenchmarks");
+
+    if (parameters.contains("--benchmark-min-time"))
+    {
+        options.minSeconds = getOptionValue(parameters, "--benchmark-min-time").getDoubleValue();
+
+        if (options.minSeconds <= 0)
+        {
+            error = "--benchmark-min-time needs a positive number of seconds.";
+            return true;
+        }
+    }
+
+    if (parameters.contains("--benchmark-out"))
+    {
+        const String outputPath = getOptionValue(parameters, "--benchmark-out");
+
+        if (outputPath.isEmpty())
+        {
+            error = "--benchmark-out needs a file name.";
+            return true;
+        }
+
+        options.outputFile = File::getCurrentWorkingDirectory().getChildFile(outputPath);
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------
+
+MicroBenchmarks::State::State(int64 iterations_, const Array<int>& arguments_)
+    : iterations(iterations_), remaining(iterations_), arguments(arguments_), started(false),
+      startTicks(0), elapsedTicks(0), itemsProcessed(0), bytesProcessed(0)
+{
+}
+
+bool MicroBenchmarks::State::keepRunning()
+{
+    if (!started)
+    {
+        started = true;
+        startTicks = Time::getHighResolutionTicks();
+    }
+
+    if (remaining == 0)
+    {
+        pauseTiming();
+        return false;
+    }
+
+    --remaining;
+    return true;
+}
+
+void MicroBenchmarks::State::pauseTiming()
+{
+    elapsedTicks += Time::getHighResolutionTicks() - startTicks;
+}
+
+void MicroBenchmarks::State::resumeTiming()
+{
+    startTicks = Time::getHighResolutionTicks();
+}
+
+int MicroBenchmarks::State::getArgument(int index) const { return arguments[index]; }
+void MicroBenchmarks::State::setItemsProcessed(int64 items) { itemsProcessed = items; }
+void MicroBenchmarks::State::setBytesProcessed(int64 bytes) { bytesProcessed = bytes; }
+int64 MicroBenchmarks::State::getIterations() const { return iterations; }
+double MicroBenchmarks::State::getSeconds() const { return Time::highResolutionTicksToSeconds(elapsedTicks); }
+int64 MicroBenchmarks::State::getItemsProcessed() const { return itemsProcessed; }
+int64 MicroBenchmarks::State::getBytesProcessed() const { return bytesProcessed; }
+
+//------------------------------------------------------------------
+
+namespace
+{
+    typedef MicroBenchmarks::State State;
+
+    const double sampleRate = 30000.0;
+
+    void fillWithNoise(float* data, int numItems)
+    {
+        Random random(1234);
+
+        for (int i = 0; i < numItems; i++)
+            data[i] = (random.nextFloat() - 0.5f) * 200.0f;
+    }
+
+    /** Keeps the compiler from optimizing a result away */
+    volatile float sink;
+
+    //------------------------------------------------------------------
+    // Dsp: the designs of Processors/Dsp as band-passes of the spike band, order 4
+
+    struct Butterworth
+    {
+        typedef Dsp::Butterworth::BandPass<4> Design;
+        static void setup(Design& d) { d.setup(4, sampleRate, 3150, 5700); }
+    };
+
+    struct ChebyshevI
+    {
+        typedef Dsp::ChebyshevI::BandPass<4> Design;
+        static void setup(Design& d) { d.setup(4, sampleRate, 3150, 5700, 1); }
+    };
+
+    struct ChebyshevII
+    {
+        typedef Dsp::ChebyshevII::BandPass<4> Design;
+        static void setup(Design& d) { d.setup(4, sampleRate, 3150, 5700, 40); }
+    };
+
+    struct Elliptic
+    {
+        typedef Dsp::Elliptic::BandPass<4> Design;
+        static void setup(Design& d) { d.setup(4, sampleRate, 3150, 5700, 1, 0.1); }
+    };
+
+    struct Bessel
+    {
+        typedef Dsp::Bessel::BandPass<4> Design;
+        static void setup(Design& d) { d.setup(4, sampleRate, 3150, 5700); }
+    };
+
+    struct Legendre
+    {
+        typedef Dsp::Legendre::BandPass<4> Design;
+        static void setup(Design& d) { d.setup(4, sampleRate, 3150, 5700); }
+    };
+
+    struct RBJ
+    {
+        typedef Dsp::RBJ::BandPass2 Design;
+        static void setup(Design& d) { d.setup(sampleRate, 3150, 5700); }
+    };
+
+    /** Arguments: channels, samples per block */
+    template <class Traits>
+    void benchmarkCascade(State& state)
+    {
+        const int numChannels = state.getArgument(0);
+        const int numSamples = state.getArgument(1);
+
+        typedef Dsp::SimpleFilter<typename Traits::Design, 1> FilterType;
+        OwnedArray<FilterType> filters;
+
+        for (int c = 0; c < numChannels; c++)
+            Traits::setup(*filters.add(new FilterType()));
+
+        AudioSampleBuffer buffer(numChannels, numSamples);
+        for (int c = 0; c < numChannels; c++)
+            fillWithNoise(buffer.getWritePointer(c), numSamples);
+
+        while (state.keepRunning())
+        {
+            for (int c = 0; c < numChannels; c++)
+            {
+                float* data = buffer.getWritePointer(c);
+                filters[c]->process(numSamples, &data);
+            }
+        }
+
+        sink = buffer.getSample(0, 0);
+        state.setItemsProcessed(state.getIterations() * numChannels * numSamples);
+    }
+
+    //------------------------------------------------------------------
+    // DataBuffer: a DataThread's writes and its SourceNode's reads
+
+    struct DataBufferFixture
+    {
+        DataBufferFixture(int numChannels_, int numSamples_, bool channelMajor)
+            : numChannels(numChannels_), numSamples(numSamples_),
+              chunkSize(channelMajor ? numSamples_ : 1),
+              dataBuffer(numChannels_, numSamples_ * 4),
+              output(numChannels_, numSamples_),
+              samples(numChannels_ * numSamples_), timestamps(numSamples_), eventCodes(numSamples_),
+              readEventCodes(numSamples_), nextTimestamp(0)
+        {
+            fillWithNoise(samples, numChannels * numSamples);
+            eventCodes.clear(numSamples);
+        }
+
+        void add()
+        {
+            for (int i = 0; i < numSamples; i++)
+                timestamps[i] = nextTimestamp++;
+
+            dataBuffer.addToBuffer(samples, timestamps, eventCodes, numSamples, chunkSize);
+        }
+
+        void read()
+        {
+            uint64 timestamp;
+            dataBuffer.readAllFromBuffer(output, &timestamp, readEventCodes, numSamples);
+        }
+
+        const int numChannels;
+        const int numSamples;
+        const int chunkSize;
+        DataBuffer dataBuffer;
+        AudioSampleBuffer output;
+        HeapBlock<float> samples;
+        HeapBlock<int64> timestamps;
+        HeapBlock<uint64> eventCodes;
+        HeapBlock<uint64> readEventCodes;
+        int64 nextTimestamp;
+    };
+
+    /** Arguments: channels, samples per block, channel-major chunks (1) or interleaved samples (0) */
+    void benchmarkDataBufferAdd(State& state)
+    {
+        DataBufferFixture f(state.getArgument(0), state.getArgument(1), state.getArgument(2) != 0);
+
+        while (state.keepRunning())
+        {
+            f.add();
+
+            state.pauseTiming();
+            f.read();
+            state.resumeTiming();
+        }
+
+        state.setItemsProcessed(state.getIterations() * f.numChannels * f.numSamples);
+    }
+
+    void benchmarkDataBufferRead(State& state)
+    {
+        DataBufferFixture f(state.getArgument(0), state.getArgument(1), state.getArgument(2) != 0);
+
+        while (state.keepRunning())
+        {
+            state.pauseTiming();
+            f.add();
+            state.resumeTiming();
+
+            f.read();
+        }
+
+        state.setItemsProcessed(state.getIterations() * f.numChannels * f.numSamples);
+    }
+
+    //------------------------------------------------------------------
+    // DataQueue: the RecordNode's writes and a RecordThread's reads, a group per subprocessor
+
+    /** Arguments: channels, samples per block, channels per group */
+    void benchmarkDataQueue(State& state)
+    {
+        const int numChannels = state.getArgument(0);
+        const int numSamples = state.getArgument(1);
+        const int channelsPerGroup = state.getArgument(2);
+        const int numGroups = (numChannels + channelsPerGroup - 1) / channelsPerGroup;
+
+        DataQueue queue(numSamples, 16);
+
+        Array<int> channelGroups;
+        for (int c = 0; c < numChannels; c++)
+            channelGroups.add(c / channelsPerGroup);
+
+        queue.setChannels(channelGroups);
+        queue.setNumReaders(1);
+
+        AudioSampleBuffer buffer(numChannels, numSamples);
+        for (int c = 0; c < numChannels; c++)
+            fillWithNoise(buffer.getWritePointer(c), numSamples);
+
+        Array<int> sourceChannels;
+        for (int c = 0; c < numChannels; c++)
+            sourceChannels.add(c);
+
+        Array<CircularBufferIndexes> indexes;
+        Array<int64> timestamps;
+        int64 timestamp = 0;
+
+        while (state.keepRunning())
+        {
+            for (int g = 0; g < numGroups; g++)
+                queue.writeGroup(buffer, g, sourceChannels.getRawDataPointer() + g * channelsPerGroup,
+                                 nullptr, numSamples, timestamp);
+
+            timestamp += numSamples;
+
+            queue.startRead(0, indexes, timestamps, numSamples);
+            queue.stopRead(0);
+        }
+
+        state.setItemsProcessed(state.getIterations() * numChannels * numSamples);
+    }
+
+    //------------------------------------------------------------------
+    // Events: their channels belong to a processor that is never part of a graph
+
+    class BenchmarkProcessor : public GenericProcessor
+    {
+    public:
+        BenchmarkProcessor()
+            : GenericProcessor("Benchmark")
+        {
+            setNodeId(100);
+        }
+
+        void process(AudioSampleBuffer&) override {}
+    };
+
+    struct EventFixture
+    {
+        EventFixture()
+            : ttlChannel(EventChannel::TTL, 8, 1, (float) sampleRate, &processor)
+        {
+            for (int i = 0; i < 4; i++)
+                dataChannels.add(new DataChannel(DataChannel::HEADSTAGE_CHANNEL, (float) sampleRate, &processor));
+
+            Array<const DataChannel*> sources;
+            for (int i = 0; i < dataChannels.size(); i++)
+                sources.add(dataChannels[i]);
+
+            spikeChannel = new SpikeChannel(SpikeChannel::TETRODE, &processor, sources);
+
+            for (int i = 0; i < 4; i++)
+                thresholds.add(-50.0f);
+
+            waveform.allocate(spikeChannel->getTotalSamples(), true);
+            fillWithNoise(waveform, (int) spikeChannel->getTotalSamples());
+        }
+
+        BenchmarkProcessor processor;
+        EventChannel ttlChannel;
+        OwnedArray<DataChannel> dataChannels;
+        ScopedPointer<SpikeChannel> spikeChannel;
+        Array<float> thresholds;
+        HeapBlock<float> waveform;
+    };
+
+    /** As GenericProcessor::addSpike() allocates it, the thresholds following the waveforms */
+    size_t getSpikeSize(const SpikeChannel& channel)
+    {
+        return channel.getDataSize() + channel.getTotalEventMetaDataSize() + SPIKE_BASE_SIZE
+            + channel.getNumChannels() * sizeof(float);
+    }
+
+    void benchmarkTTLCreateAndSerialize(State& state)
+    {
+        EventFixture f;
+        const size_t size = f.ttlChannel.getDataSize() + EVENT_BASE_SIZE;
+        HeapBlock<char> buffer(size);
+        uint8 word = 1;
+        int64 timestamp = 0;
+
+        while (state.keepRunning())
+        {
+            TTLEventPtr event = TTLEvent::createTTLEvent(&f.ttlChannel, timestamp++, &word, sizeof(word), 0);
+            event->serialize(buffer, size);
+        }
+
+        state.setItemsProcessed(state.getIterations());
+    }
+
+    /** What GenericProcessor::addTTLEvent() does, with no event object */
+    void benchmarkTTLSerializeInPlace(State& state)
+    {
+        EventFixture f;
+        const size_t size = f.ttlChannel.getDataSize() + EVENT_BASE_SIZE;
+        HeapBlock<char> buffer(size);
+        uint8 word = 1;
+        int64 timestamp = 0;
+
+        while (state.keepRunning())
+            TTLEvent::serializeTTLEvent(buffer, size, &f.ttlChannel, timestamp++, &word, 0);
+
+        state.setItemsProcessed(state.getIterations());
+    }
+
+    void benchmarkTTLDeserialize(State& state)
+    {
+        EventFixture f;
+        const size_t size = f.ttlChannel.getDataSize() + EVENT_BASE_SIZE;
+        HeapBlock<char> buffer(size);
+        uint8 word = 1;
+        TTLEvent::serializeTTLEvent(buffer, size, &f.ttlChannel, 0, &word, 0);
+        const MidiMessage message(buffer, (int) size);
+
+        while (state.keepRunning())
+        {
+            TTLEventPtr event = TTLEvent::deserializeFromMessage(message, &f.ttlChannel);
+            sink = (float) event->getState();
+        }
+
+        state.setItemsProcessed(state.getIterations());
+    }
+
+    void benchmarkSpikeCreateAndSerialize(State& state)
+    {
+        EventFixture f;
+        const size_t size = getSpikeSize(*f.spikeChannel);
+        HeapBlock<char> buffer(size);
+        int64 timestamp = 0;
+
+        while (state.keepRunning())
+        {
+            SpikeEvent::SpikeBuffer spikeData(f.spikeChannel);
+            for (int c = 0; c < 4; c++)
+                spikeData.set(c, f.waveform + c * f.spikeChannel->getTotalSamples() / 4,
+                              (int) f.spikeChannel->getTotalSamples() / 4);
+
+            SpikeEventPtr spike = SpikeEvent::createSpikeEvent(f.spikeChannel, timestamp++, f.thresholds, spikeData, 0);
+            spike->serialize(buffer, size);
+        }
+
+        state.setItemsProcessed(state.getIterations());
+        state.setBytesProcessed(state.getIterations() * (int64) size);
+    }
+
+    /** With the owning deserialization (0) or a SpikeEventView (1) */
+    void benchmarkSpikeDeserialize(State& state)
+    {
+        EventFixture f;
+        const size_t size = getSpikeSize(*f.spikeChannel);
+        HeapBlock<char> buffer(size);
+
+        SpikeEvent::SpikeBuffer spikeData(f.spikeChannel);
+        SpikeEventPtr spike = SpikeEvent::createSpikeEvent(f.spikeChannel, 0, f.thresholds, spikeData, 0);
+        spike->serialize(buffer, size);
+        const MidiMessage message(buffer, (int) size);
+
+        const bool asView = state.getArgument(0) != 0;
+
+        while (state.keepRunning())
+        {
+            if (asView)
+            {
+                SpikeEventView view(message, f.spikeChannel);
+                sink = view.getDataPointer()[0];
+            }
+            else
+            {
+                SpikeEventPtr event = SpikeEvent::deserializeFromMessage(message, f.spikeChannel);
+                sink = event->getDataPointer()[0];
+            }
+        }
+
+        state.setItemsProcessed(state.getIterations());
+        state.setBytesProcessed(state.getIterations() * (int64) size);
+    }
+
+    //------------------------------------------------------------------
+
+    struct BenchmarkCase
+    {
+        String name;
+        void (*function)(State&);
+        Array<int> arguments;
+    };
+
+    void addCase(Array<BenchmarkCase>& cases, const String& name, void (*function)(State&),
+                 int argument0 = -1, int argument1 = -1, int argument2 = -1)
+    {
+        BenchmarkCase c;
+        c.name = name;
+        c.function = function;
+
+        const int arguments[] = { argument0, argument1, argument2 };
+        for (int i = 0; i < 3 && arguments[i] >= 0; i++)
+        {
+            c.arguments.add(arguments[i]);
+            c.name << "/" << arguments[i];
+        }
+
+        cases.add(c);
+    }
+
+    Array<BenchmarkCase> getCases()
+    {
+        Array<BenchmarkCase> cases;
+        const int channelCounts[] = { 1, 64, 384 };
+        const int blockSizes[] = { 64, 1024 };
+
+        for (int c = 0; c < 3; c++)
+        {
+            for (int b = 0; b < 2; b++)
+            {
+                const int n = channelCounts[c], s = blockSizes[b];
+                addCase(cases, "Dsp/Butterworth/BandPass4", benchmarkCascade<Butterworth>, n, s);
+                addCase(cases, "Dsp/ChebyshevI/BandPass4", benchmarkCascade<ChebyshevI>, n, s);
+                addCase(cases, "Dsp/ChebyshevII/BandPass4", benchmarkCascade<ChebyshevII>, n, s);
+                addCase(cases, "Dsp/Elliptic/BandPass4", benchmarkCascade<Elliptic>, n, s);
+                addCase(cases, "Dsp/Bessel/BandPass4", benchmarkCascade<Bessel>, n, s);
+                addCase(cases, "Dsp/Legendre/BandPass4", benchmarkCascade<Legendre>, n, s);
+                addCase(cases, "Dsp/RBJ/BandPass2", benchmarkCascade<RBJ>, n, s);
+            }
+        }
+
+        const int bufferChannels[] = { 64, 384, 1024 };
+
+        for (int c = 0; c < 3; c++)
+        {
+            for (int layout = 0; layout < 2; layout++)
+            {
+                addCase(cases, "DataBuffer/Add", benchmarkDataBufferAdd, bufferChannels[c], 256, layout);
+                addCase(cases, "DataBuffer/Read", benchmarkDataBufferRead, bufferChannels[c], 256, layout);
+            }
+
+            addCase(cases, "DataQueue/WriteAndRead", benchmarkDataQueue, bufferChannels[c], 1024, bufferChannels[c]);
+            addCase(cases, "DataQueue/WriteAndRead", benchmarkDataQueue, bufferChannels[c], 1024, 1);
+        }
+
+        addCase(cases, "Events/TTL/CreateAndSerialize", benchmarkTTLCreateAndSerialize);
+        addCase(cases, "Events/TTL/SerializeInPlace", benchmarkTTLSerializeInPlace);
+        addCase(cases, "Events/TTL/Deserialize", benchmarkTTLDeserialize);
+        addCase(cases, "Events/Spike/CreateAndSerialize", benchmarkSpikeCreateAndSerialize);
+        addCase(cases, "Events/Spike/Deserialize", benchmarkSpikeDeserialize, 0);
+        addCase(cases, "Events/Spike/Deserialize", benchmarkSpikeDeserialize, 1);
+
+        return cases;
+    }
+}
+
+int MicroBenchmarks::run(const Options& options)
+{
+    const Array<BenchmarkCase> cases = getCases();
+    Array<var> results;
+
+    printf("%-48s %14s %14s %16s\n", "Benchmark", "Time (ns)", "Iterations", "Items/s");
+
+    for (int i = 0; i < cases.size(); i++)
+    {
+        const BenchmarkCase& c = cases.getReference(i);
+
+        if (options.pattern.isNotEmpty() && !c.name.matchesWildcard(options.pattern, true))
+            continue;
+
+        // grows the iterations until a run lasts the minimum time, as Google Benchmark does
+        int64 iterations = 1;
+        ScopedPointer<State> state;
+
+        for (;;)
+        {
+            state = new State(iterations, c.arguments);
+            c.function(*state);
+
+            const double seconds = state->getSeconds();
+
+            if (seconds >= options.minSeconds || iterations >= 1000000000)
+                break;
+
+            const double multiplier = seconds > 0 ? options.minSeconds * 1.4 / seconds : 10.0;
+            iterations = jmax(iterations + 1, int64(iterations * jmin(10.0, multiplier)));
+        }
+
+        const double nanoseconds = state->getSeconds() * 1e9 / state->getIterations();
+        const double itemsPerSecond = state->getItemsProcessed() / state->getSeconds();
+
+        printf("%-48s %14.1f %14lld %16.4g\n", c.name.toRawUTF8(), nanoseconds,
+               (long long) state->getIterations(), itemsPerSecond);
+        fflush(stdout);
+
+        DynamicObject::Ptr result = new DynamicObject();
+        result->setProperty("name", c.name);
+        result->setProperty("run_type", "iteration");
+        result->setProperty("iterations", state->getIterations());
+        result->setProperty("real_time", nanoseconds);
+        result->setProperty("cpu_time", nanoseconds);
+        result->setProperty("time_unit", "ns");
+        if (state->getItemsProcessed() > 0)
+            result->setProperty("items_per_second", itemsPerSecond);
+        if (state->getBytesProcessed() > 0)
+            result->setProperty("bytes_per_second", state->getBytesProcessed() / state->getSeconds());
+        results.add(var(result));
+    }
+
+    if (options.outputFile != File())
+    {
+        DynamicObject::Ptr context = new DynamicObject();
+        context->setProperty("date", Time::getCurrentTime().toISO8601(true));
+        context->setProperty("executable", File::getSpecialLocation(File::currentExecutableFile).getFullPathName());
+        context->setProperty("num_cpus", SystemStats::getNumCpus());
+        context->setProperty("mhz_per_cpu", SystemStats::getCpuSpeedInMegaherz());
+        context->setProperty("library_build_type",
+#if JUCE_DEBUG
+                             "debug"
+#else
+                             "release"
+#endif
+                             );
+        context->setProperty("version", JUCEApplication::getInstance()->getApplicationVersion());
+
+        DynamicObject::Ptr root = new DynamicObject();
+        root->setProperty("context", var(context));
+        root->setProperty("benchmarks", results);
+
+        if (!options.outputFile.replaceWithText(JSON::toString(var(root))))
+        {
+            std::cout << "Could not write " << options.outputFile.getFullPathName() << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,114 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __MICROBENCHMARKS_H__
+#define __MICROBENCHMARKS_H__
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+/**
+  Micro-benchmarks of the primitives on the hot path of acquisition: the Dsp filter
+  cascades of every design, the DataBuffer between a DataThread and its source, the
+  DataQueue between the RecordNode and the RecordThread, and the creation and
+  (de)serialization of TTL and spike events.
+
+  Started with --microbenchmarks, the GUI runs them instead of opening a window, then
+  quits. Like Google Benchmark, each case repeats its loop with a growing number of
+  iterations until a run lasts the minimum time, then reports the time per iteration
+  and the items (samples or events) processed per second. Cases are named after the
+  primitive and their arguments, e.g. "DataBuffer/AddAndRead/384/256" for 384 channels
+  and 256 samples per block.
+
+  Options:
+    --microbenchmarks [pattern]     runs the cases matching the wildcard pattern, all by default
+    --benchmark-min-time <seconds>  the minimum time of a run, 0.2 s by default
+    --benchmark-out <file.json>     also writes the results, in the JSON format of Google
+                                    Benchmark so that its comparison tools can be used
+
+  @see HeadlessRunner
+
+*/
+
+class MicroBenchmarks
+{
+public:
+
+    struct Options
+    {
+        Options();
+
+        String pattern;
+        double minSeconds;
+        File outputFile;
+    };
+
+    /** Returns true if the command line asks for the micro-benchmarks, filling the options.
+        error is set if they are invalid. */
+    static bool parseCommandLine(const StringArray& parameters, Options& options, String& error);
+
+    /** Runs the matching cases, printing their results, and returns the exit code. */
+    static int run(const Options& options);
+
+    /** What a case gets to time its loop, which runs while keepRunning() returns true. */
+    class State
+    {
+    public:
+        State(int64 iterations, const Array<int>& arguments);
+
+        /** Starts the clock on the first call and stops it on the last one. */
+        bool keepRunning();
+
+        /** Leaves the work between the two calls out of the measured time. */
+        void pauseTiming();
+        void resumeTiming();
+
+        int getArgument(int index) const;
+
+        /** The number of samples or events processed over all iterations. */
+        void setItemsProcessed(int64 items);
+        void setBytesProcessed(int64 bytes);
+
+        int64 getIterations() const;
+        double getSeconds() const;
+        int64 getItemsProcessed() const;
+        int64 getBytesProcessed() const;
+
+    private:
+        int64 iterations;
+        int64 remaining;
+        Array<int> arguments;
+        bool started;
+        int64 startTicks;
+        int64 elapsedTicks;
+        int64 itemsProcessed;
+        int64 bytesProcessed;
+    };
+
+private:
+
+    MicroBenchmarks() = delete;
+
+};
+
+
+#endif  // __MICROBENCHMARKS_H__
@@ -25,12 +25,14 @@
 #include <exception>         // For exception class
 #include <stdlib.h>          // For atoi
 
+#include "../Processors/PluginManager/OpenEphysPlugin.h"
+
 using namespace std;
 
 /**
  *   Signals a problem with the execution of a socket call.
  */
-class SocketException : public exception
+class PLUGIN_API SocketException : public exception
 {
 public:
     /**
@@ -59,7 +61,7 @@ private:
 /**
  *   Base class representing basic communication endpoint
  */
-class Socket
+class PLUGIN_API Socket
 {
 public:
     /**
@@ -138,7 +140,7 @@ protected:
 /**
  *   Socket which is able to connect, send, and receive
  */
-class CommunicatingSocket : public Socket
+class PLUGIN_API CommunicatingSocket : public Socket
 {
 public:
     /**
@@ -192,7 +194,7 @@ protected:
 /**
  *   TCP socket for communication with other TCP sockets
  */
-class TCPSocket : public CommunicatingSocket
+class PLUGIN_API TCPSocket : public CommunicatingSocket
 {
 public:
     /**
@@ -220,7 +222,7 @@ private:
 /**
  *   TCP socket class for servers
  */
-class TCPServerSocket : public Socket
+class PLUGIN_API TCPServerSocket : public Socket
 {
 public:
     /**
@@ -261,7 +263,7 @@ private:
 /**
   *   UDP socket class
   */
-class UDPSocket : public CommunicatingSocket
+class PLUGIN_API UDPSocket : public CommunicatingSocket
 {
 public:
     /**
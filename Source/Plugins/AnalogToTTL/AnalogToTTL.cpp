@@ -0,0 +1,324 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "AnalogToTTL.h"
+#include "AnalogToTTLEditor.h"
+
+
+AnalogToTTL::AnalogToTTL()
+    : GenericProcessor  ("Analog to TTL")
+    , debounceMs        (ANALOGTOTTL_DEFAULT_DEBOUNCE_MS)
+{
+    setProcessorType (PROCESSOR_TYPE_FILTER);
+}
+
+
+AnalogToTTL::~AnalogToTTL()
+{
+}
+
+
+AudioProcessorEditor* AnalogToTTL::createEditor()
+{
+    editor = new AnalogToTTLEditor (this, true);
+    return editor;
+}
+
+
+float AnalogToTTL::getHighThreshold (int channel) const
+{
+    return isPositiveAndBelow (channel, highThresholds.size()) ? highThresholds[channel] : float (ANALOGTOTTL_DEFAULT_HIGH);
+}
+
+
+float AnalogToTTL::getLowThreshold (int channel) const
+{
+    return isPositiveAndBelow (channel, lowThresholds.size()) ? lowThresholds[channel] : float (ANALOGTOTTL_DEFAULT_LOW);
+}
+
+
+float AnalogToTTL::getDebounceMs() const
+{
+    return debounceMs;
+}
+
+
+void AnalogToTTL::setParameter (int parameterIndex, float newValue)
+{
+    if (parameterIndex == 0 && isPositiveAndBelow (currentChannel, highThresholds.size()))
+    {
+        highThresholds.set (currentChannel, newValue);
+    }
+    else if (parameterIndex == 1 && isPositiveAndBelow (currentChannel, lowThresholds.size()))
+    {
+        lowThresholds.set (currentChannel, newValue);
+    }
+    else if (parameterIndex == 2)
+    {
+        debounceMs = jlimit (0.0f, 1000.0f, newValue);
+        updateDebounce();
+    }
+}
+
+
+void AnalogToTTL::updateDebounce()
+{
+    for (int s = 0; s < sources.size(); ++s)
+        sources[s]->debounceSamples = jmax (1, roundFloatToInt (debounceMs * sources[s]->sampleRate / 1000.0f));
+}
+
+
+int AnalogToTTL::findSource (int channel) const
+{
+    const DataChannel* input = getDataChannel (channel);
+
+    if (input == nullptr)
+        return -1;
+
+    const uint32 sourceId = getProcessorFullId (input->getSourceNodeID(), input->getSubProcessorIdx());
+
+    for (int s = 0; s < sources.size(); ++s)
+    {
+        if (sources[s]->sourceId == sourceId)
+            return s;
+    }
+
+    return -1;
+}
+
+
+void AnalogToTTL::updateSettings()
+{
+    sources.clear();
+    converters.clearQuick();
+
+    // channels keep their thresholds, new ones get the defaults
+    const int numChannels = dataChannelArray.size();
+
+    highThresholds.resize (jmin (highThresholds.size(), numChannels));
+    lowThresholds.resize (jmin (lowThresholds.size(), numChannels));
+
+    while (highThresholds.size() < numChannels)
+        highThresholds.add (ANALOGTOTTL_DEFAULT_HIGH);
+
+    while (lowThresholds.size() < numChannels)
+        lowThresholds.add (ANALOGTOTTL_DEFAULT_LOW);
+
+    Array<int> numLines;
+
+    for (int i = 0; i < numChannels; ++i)
+    {
+        int s = findSource (i);
+
+        if (s < 0)
+        {
+            const DataChannel* input = dataChannelArray[i];
+
+            ConverterSource* source = sources.add (new ConverterSource());
+            source->sourceId = getProcessorFullId (input->getSourceNodeID(), input->getSubProcessorIdx());
+            source->sampleRate = input->getSampleRate();
+            source->eventChannel = nullptr;
+            source->debounceSamples = 1;
+            numLines.add (0);
+            s = sources.size() - 1;
+        }
+
+        numLines.set (s, numLines[s] + 1);
+    }
+
+    for (int s = 0; s < sources.size(); ++s)
+    {
+        ConverterSource& source = *sources[s];
+
+        EventChannel* ev = new EventChannel (EventChannel::TTL, numLines[s], 1, source.sampleRate, this);
+        ev->setName ("Analog to TTL output " + String (s + 1));
+        ev->setDescription ("Line i is on while the i-th input channel is above its thresholds");
+        ev->setIdentifier ("dataderived.threshold.ttl");
+        eventChannelArray.add (ev);
+
+        source.eventChannel = ev;
+        source.ttlWord.calloc (ev->getDataSize());
+        source.pendingEvents.ensureStorageAllocated (64);
+    }
+
+    updateDebounce();
+}
+
+
+bool AnalogToTTL::enable()
+{
+    converters.clearQuick();
+
+    Array<int> lineCounts;
+    lineCounts.insertMultiple (0, 0, sources.size());
+
+    Array<int> lines;
+
+    // the line of every input channel, in the order of the event channel
+    for (int i = 0; i < dataChannelArray.size(); ++i)
+    {
+        const int s = findSource (i);
+        lines.add (lineCounts[s]);
+        lineCounts.set (s, lineCounts[s] + 1);
+    }
+
+    const Array<int> selected = getEditor()->getActiveChannels();
+
+    for (int n = 0; n < selected.size(); ++n)
+    {
+        const int ch = selected[n];
+        const int s = findSource (ch);
+
+        if (s < 0)
+            continue;
+
+        Converter converter = { ch, s, lines[ch], false, 0 };
+        converters.add (converter);
+    }
+
+    for (int s = 0; s < sources.size(); ++s)
+    {
+        ConverterSource& source = *sources[s];
+
+        zeromem (source.ttlWord, source.eventChannel->getDataSize());
+        source.pendingEvents.clearQuick();
+    }
+
+    return true;
+}
+
+
+int AnalogToTTL::PendingEventSorter::compareElements (const PendingEvent& first, const PendingEvent& second)
+{
+    if (first.sampleNum != second.sampleNum)
+        return first.sampleNum - second.sampleNum;
+
+    return first.line - second.line;
+}
+
+
+void AnalogToTTL::process (AudioSampleBuffer& buffer)
+{
+    for (int c = 0; c < converters.size(); ++c)
+    {
+        Converter& converter = converters.getReference (c);
+        convertChannel (converter, buffer.getReadPointer (converter.channel), getNumSamples (converter.channel));
+    }
+
+    // the lines of a source share a TTL word, so its events are added in sample order
+    PendingEventSorter sorter;
+
+    for (int s = 0; s < sources.size(); ++s)
+    {
+        ConverterSource& source = *sources.getUnchecked (s);
+
+        if (source.pendingEvents.size() == 0)
+            continue;
+
+        source.pendingEvents.sort (sorter, true);
+
+        const int64 timestamp = int64 (getSourceTimestamp (source.sourceId));
+
+        for (int n = 0; n < source.pendingEvents.size(); ++n)
+        {
+            const PendingEvent& pending = source.pendingEvents.getReference (n);
+            const uint8 bit = uint8 (1 << (pending.line & 7));
+
+            if (pending.state)
+                source.ttlWord[pending.line >> 3] |= bit;
+            else
+                source.ttlWord[pending.line >> 3] &= ~bit;
+
+            addTTLEvent (source.eventChannel, timestamp + pending.sampleNum, source.ttlWord, uint16 (pending.line), pending.sampleNum);
+        }
+
+        source.pendingEvents.clearQuick();
+    }
+}
+
+
+void AnalogToTTL::convertChannel (Converter& converter, const float* samples, int numSamples)
+{
+    ConverterSource& source = *sources.getUnchecked (converter.source);
+
+    const float high = highThresholds[converter.channel];
+    const float low = jmin (lowThresholds[converter.channel], high);
+
+    int i = 0;
+
+    while (i < numSamples)
+    {
+        if (converter.holdoff > 0)
+        {
+            const int skipped = jmin (converter.holdoff, numSamples - i);
+            converter.holdoff -= skipped;
+            i += skipped;
+            continue;
+        }
+
+        // only the level that would change the line is searched for
+        i = converter.state ? ThresholdDetector::findFirstCrossing (samples, i, numSamples, low, ThresholdDetector::BELOW)
+                            : ThresholdDetector::findFirstCrossing (samples, i, numSamples, high, ThresholdDetector::ABOVE);
+
+        if (i >= numSamples)
+            break;
+
+        converter.state = ! converter.state;
+
+        const PendingEvent event = { i, converter.line, converter.state };
+        source.pendingEvents.add (event);
+
+        converter.holdoff = source.debounceSamples - 1;
+        ++i;
+    }
+}
+
+
+void AnalogToTTL::saveCustomChannelParametersToXml (XmlElement* channelInfo, int channelNumber, InfoObjectCommon::InfoObjectType channelType)
+{
+    if (channelType == InfoObjectCommon::DATA_CHANNEL && isPositiveAndBelow (channelNumber, highThresholds.size()))
+    {
+        XmlElement* channelParams = channelInfo->createNewChildElement ("PARAMETERS");
+        channelParams->setAttribute ("high", highThresholds[channelNumber]);
+        channelParams->setAttribute ("low", lowThresholds[channelNumber]);
+    }
+}
+
+
+void AnalogToTTL::loadCustomChannelParametersFromXml (XmlElement* channelInfo, InfoObjectCommon::InfoObjectType channelType)
+{
+    const int channelNum = channelInfo->getIntAttribute ("number");
+
+    if (channelType != InfoObjectCommon::DATA_CHANNEL || ! isPositiveAndBelow (channelNum, highThresholds.size()))
+        return;
+
+    forEachXmlChildElement (*channelInfo, subNode)
+    {
+        if (subNode->hasTagName ("PARAMETERS"))
+        {
+            highThresholds.set (channelNum, float (subNode->getDoubleAttribute ("high", ANALOGTOTTL_DEFAULT_HIGH)));
+            lowThresholds.set (channelNum, float (subNode->getDoubleAttribute ("low", ANALOGTOTTL_DEFAULT_LOW)));
+        }
+    }
+}
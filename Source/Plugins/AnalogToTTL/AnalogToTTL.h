@@ -0,0 +1,153 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef ANALOGTOTTL_H_INCLUDED
+#define ANALOGTOTTL_H_INCLUDED
+
+
+#ifdef _WIN32
+    #include <Windows.h>
+#endif
+
+#include <ProcessorHeaders.h>
+#include <SpikeLib.h>
+
+
+#define ANALOGTOTTL_DEFAULT_HIGH 2.5
+#define ANALOGTOTTL_DEFAULT_LOW 1.0
+#define ANALOGTOTTL_DEFAULT_DEBOUNCE_MS 1
+
+
+/**
+    Turns analog channels carrying digital pulses, such as sync lines wired to ADC inputs,
+    into TTL events at the sample they change at.
+
+    Each channel has two thresholds in its own units: its line turns on once the signal goes
+    above the high one and off once it goes below the low one, so that noise around a single
+    level can't make it toggle. After each change, the channel is ignored for the debounce
+    time, which swallows the bounces of mechanical switches and the ringing of long cables.
+
+    Pulses are rare next to the samples, so a channel is never stepped through sample by
+    sample: ThresholdDetector::findFirstCrossing() searches for the level that would change the
+    line, four samples at a time with SSE2 or NEON, and the state machine only runs at what it
+    finds. Dozens of sync lines cost little more than reading them.
+
+    Each source gets a TTL event channel whose line i follows its i-th input channel. The
+    channels converted are those selected in the channel selector when acquisition starts.
+    The input channels are passed through unchanged.
+
+    @see ThresholdDetector
+*/
+class AnalogToTTL : public GenericProcessor
+{
+public:
+    /** The class constructor, used to initialize any members. */
+    AnalogToTTL();
+
+    /** The class destructor, used to deallocate memory */
+    ~AnalogToTTL();
+
+    /** Converts the channels, then adds their events in sample order */
+    void process (AudioSampleBuffer& buffer) override;
+
+    bool isDataPassThrough() const override { return true; }
+    bool isPassThroughChannel (int) const override { return true; }
+
+    AudioProcessorEditor* createEditor() override;
+
+    bool hasEditor() const override { return true; }
+
+    /** Adds a TTL event channel per source, and gives new channels the default thresholds */
+    void updateSettings() override;
+
+    /** Starts the channels selected in the editor with their lines off */
+    bool enable() override;
+
+    /** Sets the high (0) or low (1) threshold of the current channel, or the debounce time in
+        ms (2). Can be changed during acquisition through queueParameterChange(). */
+    void setParameter (int parameterIndex, float newValue) override;
+
+    float getHighThreshold (int channel) const;
+    float getLowThreshold (int channel) const;
+    float getDebounceMs() const;
+
+    void saveCustomChannelParametersToXml (XmlElement* channelInfo, int channelNumber, InfoObjectCommon::InfoObjectType channelType) override;
+    void loadCustomChannelParametersFromXml (XmlElement* channelInfo, InfoObjectCommon::InfoObjectType channelType) override;
+
+
+private:
+    /** A change of line found in a channel, added by process() once all channels are done */
+    struct PendingEvent
+    {
+        int sampleNum;
+        int line;
+        bool state;
+    };
+
+    struct PendingEventSorter
+    {
+        static int compareElements (const PendingEvent& first, const PendingEvent& second);
+    };
+
+    /** The event channel of the channels sharing a source */
+    struct ConverterSource
+    {
+        uint32 sourceId;
+        float sampleRate;
+        const EventChannel* eventChannel;
+        HeapBlock<uint8> ttlWord;
+        int debounceSamples;
+        Array<PendingEvent> pendingEvents;
+    };
+
+    struct Converter
+    {
+        int channel;
+        int source;
+        int line;
+        bool state;
+        int holdoff;                // samples still ignored after the last change
+    };
+
+    /** Returns the source of a channel, or -1 */
+    int findSource (int channel) const;
+
+    /** Computes the debounce time of every source in samples */
+    void updateDebounce();
+
+    /** Finds the changes of a converter's line in a block */
+    void convertChannel (Converter& converter, const float* samples, int numSamples);
+
+    Array<float> highThresholds;
+    Array<float> lowThresholds;
+    float debounceMs;
+
+    OwnedArray<ConverterSource> sources;
+    Array<Converter> converters;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AnalogToTTL);
+};
+
+
+
+#endif  // ANALOGTOTTL_H_INCLUDED
@@ -0,0 +1,149 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "AnalogToTTLEditor.h"
+#include "AnalogToTTL.h"
+
+
+AnalogToTTLEditor::AnalogToTTLEditor (GenericProcessor* parentNode, bool useDefaultParameterEditors)
+    : GenericEditor (parentNode, useDefaultParameterEditors)
+{
+    desiredWidth = 170;
+
+    highValue     = addValue ("High:", 10, 25, ANALOGTOTTL_DEFAULT_HIGH, "The line turns on above this level, in the units of the selected channels");
+    lowValue      = addValue ("Low:", 10, 65, ANALOGTOTTL_DEFAULT_LOW, "The line turns off below this level, in the units of the selected channels");
+    debounceValue = addValue ("Debounce (ms):", 80, 25, ANALOGTOTTL_DEFAULT_DEBOUNCE_MS, "How long a channel is ignored after its line changes");
+}
+
+
+AnalogToTTLEditor::~AnalogToTTLEditor()
+{
+}
+
+
+Label* AnalogToTTLEditor::addValue (const String& name, int x, int y, float value, const String& tooltip)
+{
+    Label* caption = captions.add (new Label (name, name));
+    caption->setBounds (x, y, 80, 15);
+    caption->setFont (Font ("Small Text", 12, Font::plain));
+    caption->setColour (Label::textColourId, Colours::darkgrey);
+    addAndMakeVisible (caption);
+
+    Label* label = new Label (name, String (value));
+    label->setBounds (x + 5, y + 17, 55, 18);
+    label->setFont (Font ("Default", 15, Font::plain));
+    label->setColour (Label::textColourId, Colours::white);
+    label->setColour (Label::backgroundColourId, Colours::grey);
+    label->setEditable (true);
+    label->setTooltip (tooltip);
+    label->addListener (this);
+    addAndMakeVisible (label);
+
+    return label;
+}
+
+
+int AnalogToTTLEditor::getParameterIndex (Label* label) const
+{
+    if (label == highValue)     return 0;
+    if (label == lowValue)      return 1;
+    if (label == debounceValue) return 2;
+
+    return -1;
+}
+
+
+void AnalogToTTLEditor::updateValues (int channel)
+{
+    AnalogToTTL* processor = static_cast<AnalogToTTL*> (getProcessor());
+
+    highValue->setText (String (processor->getHighThreshold (channel)), dontSendNotification);
+    lowValue->setText (String (processor->getLowThreshold (channel)), dontSendNotification);
+    debounceValue->setText (String (processor->getDebounceMs()), dontSendNotification);
+}
+
+
+void AnalogToTTLEditor::labelTextChanged (Label* label)
+{
+    const int index = getParameterIndex (label);
+
+    if (index < 0)
+        return;
+
+    const float value = label->getText().getFloatValue();
+    const Array<int> channels = getActiveChannels();
+
+    // values are only checked here; during acquisition they are applied at the next block
+    if (index == 2)
+    {
+        if (value < 0)
+            CoreServices::sendStatusMessage ("Value out of range.");
+        else
+            getProcessor()->queueParameterChange (2, value);
+    }
+    else
+    {
+        for (int n = 0; n < channels.size(); ++n)
+            getProcessor()->queueParameterChange (index, value, channels[n]);
+    }
+
+    // a change queued during acquisition isn't applied yet, so the label keeps what was typed
+    if (! CoreServices::getAcquisitionStatus())
+        updateValues (channels.size() > 0 ? channels[0] : 0);
+}
+
+
+void AnalogToTTLEditor::channelChanged (int channel, bool /*newState*/)
+{
+    updateValues (channel);
+}
+
+
+void AnalogToTTLEditor::stopAcquisition()
+{
+    const Array<int> channels = getActiveChannels();
+    updateValues (channels.size() > 0 ? channels[0] : 0);
+}
+
+
+void AnalogToTTLEditor::saveCustomParameters (XmlElement* xml)
+{
+    xml->setAttribute ("Type", "AnalogToTTLEditor");
+
+    XmlElement* values = xml->createNewChildElement ("VALUES");
+    values->setAttribute ("Debounce", static_cast<AnalogToTTL*> (getProcessor())->getDebounceMs());
+}
+
+
+void AnalogToTTLEditor::loadCustomParameters (XmlElement* xml)
+{
+    forEachXmlChildElement (*xml, xmlNode)
+    {
+        if (xmlNode->hasTagName ("VALUES"))
+            getProcessor()->setParameter (2, float (xmlNode->getDoubleAttribute ("Debounce", ANALOGTOTTL_DEFAULT_DEBOUNCE_MS)));
+    }
+
+    const Array<int> channels = getActiveChannels();
+    updateValues (channels.size() > 0 ? channels[0] : 0);
+}
@@ -0,0 +1,75 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef ANALOGTOTTLEDITOR_H_INCLUDED
+#define ANALOGTOTTLEDITOR_H_INCLUDED
+
+
+#include <EditorHeaders.h>
+
+
+/**
+    User interface for the Analog to TTL, setting the thresholds of the channels selected in
+    the channel selector and the debounce time. The channels it converts are those selected
+    when acquisition starts.
+
+    @see AnalogToTTL
+*/
+class AnalogToTTLEditor : public GenericEditor
+                        , public Label::Listener
+{
+public:
+    AnalogToTTLEditor (GenericProcessor* parentNode, bool useDefaultParameterEditors);
+    ~AnalogToTTLEditor();
+
+    void labelTextChanged (Label* label) override;
+
+    /** Shows the thresholds of the channel */
+    void channelChanged (int channel, bool newState) override;
+
+    void stopAcquisition() override;
+
+    void saveCustomParameters (XmlElement* xml) override;
+    void loadCustomParameters (XmlElement* xml) override;
+
+
+private:
+    /** Adds a caption at the given position, the editable value being added below it */
+    Label* addValue (const String& name, int x, int y, float value, const String& tooltip);
+
+    /** The parameter index of an editable value, or -1 */
+    int getParameterIndex (Label* label) const;
+
+    /** Shows the parameters of the processor, the thresholds being those of a channel */
+    void updateValues (int channel);
+
+    OwnedArray<Label>       captions;
+    ScopedPointer<Label>    highValue;
+    ScopedPointer<Label>    lowValue;
+    ScopedPointer<Label>    debounceValue;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AnalogToTTLEditor);
+};
+
+
+#endif  // ANALOGTOTTLEDITOR_H_INCLUDED
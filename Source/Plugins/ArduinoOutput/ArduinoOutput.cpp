@@ -32,6 +32,8 @@ ArduinoOutput::ArduinoOutput()
     , outputChannel         (13)
     , inputChannel          (-1)
     , gateChannel           (-1)
+    , serialWorker          ("Arduino Output")
+    , armedChannel          (-1)
     , state                 (true)
     , acquisitionIsActive   (false)
     , deviceSelected        (false)
@@ -42,6 +44,8 @@ ArduinoOutput::ArduinoOutput()
 
 ArduinoOutput::~ArduinoOutput()
 {
+    arduino.stopSerialWorker();
+
     if (arduino.isInitialized())
         arduino.disconnect();
 }
@@ -124,7 +128,11 @@ void ArduinoOutput::handleEvent (const EventChannel* eventInfo, const MidiMessag
         {
             if (inputChannel == -1 || eventChannel == inputChannel)
             {
-                if (eventId == 0)
+                if (outputChannel == armedChannel)
+                {
+                    serialWorker.trigger (eventId);
+                }
+                else if (eventId == 0)
                 {
                     arduino.sendDigital (outputChannel, ARD_LOW);
                 }
@@ -132,6 +140,8 @@ void ArduinoOutput::handleEvent (const EventChannel* eventInfo, const MidiMessag
                 {
                     arduino.sendDigital (outputChannel, ARD_HIGH);
                 }
+
+                measureEventLatency (eventInfo);
             }
         }
     }
@@ -140,11 +150,12 @@ void ArduinoOutput::handleEvent (const EventChannel* eventInfo, const MidiMessag
 
 void ArduinoOutput::setParameter (int parameterIndex, float newValue)
 {
-    // make sure current output channel is off:
-    arduino.sendDigital(outputChannel, ARD_LOW);
+    // make sure current output channel is off, whatever the armed commands left it at:
+    arduino.sendDigital(outputChannel, ARD_LOW, armedChannel == outputChannel);
 
     if (parameterIndex == 0)
     {
+        // the new channel is set with sendDigital(), the armed commands being for the previous one
         outputChannel = (int) newValue;
     }
     else if (parameterIndex == 1)
@@ -185,19 +196,57 @@ bool ArduinoOutput::enable()
 {
     acquisitionIsActive = true;
 
+    if (deviceSelected)
+    {
+        unsigned char message[3];
+
+        serialWorker.disarmAll();
+        arduino.getDigitalMessage (outputChannel, ARD_LOW, message);
+        serialWorker.arm (0, message, 3);
+        arduino.getDigitalMessage (outputChannel, ARD_HIGH, message);
+        serialWorker.arm (1, message, 3);
+        armedChannel = outputChannel;
+
+        arduino.startSerialWorker (&serialWorker);
+    }
+
     return deviceSelected;
 }
 
 
 bool ArduinoOutput::disable()
 {
-    arduino.sendDigital (outputChannel, ARD_LOW);
+    // forced, as the armed commands do not update the state of the pin
+    arduino.sendDigital (outputChannel, ARD_LOW, true);
+
+    // after the last bytes are written
+    arduino.stopSerialWorker();
+    armedChannel = -1;
     acquisitionIsActive = false;
 
+    if (serialWorker.hasFailed() || serialWorker.getNumDroppedBytes() > 0)
+        CoreServices::sendStatusMessage ("Arduino Output: some outputs could not be sent.");
+
+    const ProcessorTimingStats::Snapshot latency = serialWorker.getTriggerLatencyStats().getSnapshot();
+
+    if (latency.numBlocks > 0)
+    {
+        const String summary = "Arduino Output latency over " + String (latency.numBlocks) + " changes: "
+                               + latency.getSummary() + "  max " + String (latency.maxMs, 2) + " ms";
+        std::cout << summary << std::endl;
+        CoreServices::sendStatusMessage (summary);
+    }
+
     return true;
 }
 
 
+const ProcessorTimingStats& ArduinoOutput::getTriggerLatencyStats() const
+{
+    return serialWorker.getTriggerLatencyStats();
+}
+
+
 void ArduinoOutput::process (AudioSampleBuffer& buffer)
 {
     checkForEvents ();
@@ -48,6 +48,8 @@ public:
     /** Searches for events and triggers the Arduino output when appropriate. */
     void process (AudioSampleBuffer& buffer) override;
 
+    bool isPassThroughChannel (int) const override { return true; }
+
     /** Currently unused. Future uses may include changing the TTL trigger channel
     or the output channel of the Arduino. */
     void setParameter (int parameterIndex, float newValue) override;
@@ -70,6 +72,9 @@ public:
 
     void setDevice (String deviceString);
 
+    /** The time from each change of the output until it was sent to the Arduino, during the last acquisition. */
+    const ProcessorTimingStats& getTriggerLatencyStats() const;
+
     int outputChannel;
     int inputChannel;
     int gateChannel;
@@ -79,6 +84,13 @@ private:
     /** An open-frameworks Arduino object. */
     ofArduino arduino;
 
+    /** Writes to the Arduino during acquisition, so that handleEvent() never waits for the port.
+        Setting the output low and high are its pre-armed commands 0 and 1. */
+    SerialWorker serialWorker;
+
+    /** The output channel the commands of serialWorker were armed for, -1 if none */
+    int armedChannel;
+
     bool state;
     bool acquisitionIsActive;
     bool deviceSelected;
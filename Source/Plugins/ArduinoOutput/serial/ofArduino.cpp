@@ -56,6 +56,7 @@
 ofArduino::ofArduino()
 {
     _portStatus=-1;
+    _worker=nullptr;
     _waitForData=0;
     _analogHistoryLength = 2;
     _digitalHistoryLength = 2;
@@ -186,9 +187,26 @@ void ofArduino::setStringHistoryLength(int length)
 
 void ofArduino::disconnect()
 {
+    stopSerialWorker();
     _port.close();
 }
 
+void ofArduino::startSerialWorker(SerialWorker* worker)
+{
+    stopSerialWorker();
+    _worker=worker;
+    _worker->start(&_port, false, 10); // the highest priority, for the triggers
+}
+
+void ofArduino::stopSerialWorker()
+{
+    if (_worker!=nullptr)
+    {
+        _worker->stop();
+        _worker=nullptr;
+    }
+}
+
 void ofArduino::update()
 {
     static vector<unsigned char> bytesToProcess;
@@ -255,37 +273,7 @@ void ofArduino::sendDigital(int pin, int value, bool force)
 
         int port=0;
         int bit=0;
-        int port1Offset;
-        int port2Offset;
-
-        // support Firmata 2.3/Arduino 1.0 with backwards compatibility
-        // to previous protocol versions
-        if (_firmwareVersionSum >= FIRMWARE2_3)
-        {
-            port1Offset = 16;
-            port2Offset = 20;
-        }
-        else
-        {
-            port1Offset = 14;
-            port2Offset = 22;
-        }
-
-        if (pin < 8 && pin >1)
-        {
-            port=0;
-            bit = pin;
-        }
-        else if (pin>7 && pin <port1Offset)
-        {
-            port = 1;
-            bit = pin-8;
-        }
-        else if (pin>15 && pin <port2Offset)
-        {
-            port = 2;
-            bit = pin-16;
-        }
+        getDigitalPortAndBit(pin, port, bit);
 
         // set the bit
         if (value==1)
@@ -301,6 +289,60 @@ void ofArduino::sendDigital(int pin, int value, bool force)
     }
 }
 
+void ofArduino::getDigitalPortAndBit(int pin, int& port, int& bit)
+{
+    int port1Offset;
+    int port2Offset;
+
+    // support Firmata 2.3/Arduino 1.0 with backwards compatibility
+    // to previous protocol versions
+    if (_firmwareVersionSum >= FIRMWARE2_3)
+    {
+        port1Offset = 16;
+        port2Offset = 20;
+    }
+    else
+    {
+        port1Offset = 14;
+        port2Offset = 22;
+    }
+
+    if (pin < 8 && pin >1)
+    {
+        port=0;
+        bit = pin;
+    }
+    else if (pin>7 && pin <port1Offset)
+    {
+        port = 1;
+        bit = pin-8;
+    }
+    else if (pin>15 && pin <port2Offset)
+    {
+        port = 2;
+        bit = pin-16;
+    }
+}
+
+void ofArduino::getDigitalMessage(int pin, int value, unsigned char* message)
+{
+    int port=0;
+    int bit=0;
+    getDigitalPortAndBit(pin, port, bit);
+
+    // the other pins of the port keep their current values
+    int portValue = _digitalPortValue[port];
+
+    if (value==1)
+        portValue |= (1 << bit);
+    else
+        portValue &= ~(1 << bit);
+
+    message[0] = (unsigned char) (FIRMATA_DIGITAL_MESSAGE+port);
+    message[1] = (unsigned char) (portValue & 127); // LSB
+    message[2] = (unsigned char) (portValue >> 7 & 127); // MSB
+}
+
 void ofArduino::sendPwm(int pin, int value, bool force)
 {
     if (_digitalPinMode[pin]==ARD_PWM && (_digitalPinValue[pin]!=value || force))
@@ -853,7 +895,10 @@ void ofArduino::sendByte(unsigned char byte)
     //char msg[100];
     //sprintf(msg, "Sending Byte: %i", byte);
     //Logger::get("Application").information(msg);
-    _port.writeByte(byte);
+    if (_worker!=nullptr)
+        _worker->write(&byte, 1);
+    else
+        _port.writeByte(byte);
 }
 
 // in Firmata (and MIDI) data bytes are 7-bits. The 8th bit serves as a flag to mark a byte as either command or data.
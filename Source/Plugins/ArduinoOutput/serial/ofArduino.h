@@ -173,6 +173,12 @@ public:
     void update();
     // polls data from the serial port, this has to be called periodically
 
+    void startSerialWorker(SerialWorker* worker);
+    // hands the serial port over to worker, through which everything is then sent
+    // and nothing is received, until stopSerialWorker()
+
+    void stopSerialWorker();
+
     bool isInitialized();
     // returns true if a succesfull connection has been established and the Arduino has reported a firmware
 
@@ -200,6 +206,10 @@ public:
     // the pins mode has to be set to ARD_OUTPUT or ARD_INPUT (in the latter mode pull-up resistors are enabled/disabled)
     // Note: pin 16-21 can also be used if analog inputs 0-5 are used as digital pins
 
+    void getDigitalMessage(int pin, int value, unsigned char* message);
+    // formats in message the 3 bytes sendDigital(pin, value, true) would send, without
+    // sending them, so that they can be sent later with as little delay as possible
+
     void sendPwm(int pin, int value, bool force = false);
     // pin: 3, 5, 6, 9, 10 and 11
     // value: 0 (always off) to 255 (always on).
@@ -349,6 +359,8 @@ protected:
     void initPins();
     int _totalDigitalPins;
 
+    void getDigitalPortAndBit(int pin, int& port, int& bit);
+
     void sendDigitalPinReporting(int pin, int mode);
     // sets pin reporting to ARD_ON or ARD_OFF
     // enables / disables reporting for the pins port
@@ -366,6 +378,7 @@ protected:
 
     ofSerial _port;
     int _portStatus;
+    SerialWorker* _worker;
 
     // --- history variables
     int _analogHistoryLength;
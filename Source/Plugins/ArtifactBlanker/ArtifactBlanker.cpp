@@ -0,0 +1,405 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <stdio.h>
+#include "ArtifactBlanker.h"
+#include "ArtifactBlankerEditor.h"
+
+
+ArtifactBlanker::ArtifactBlanker()
+    : GenericProcessor  ("Artifact Blanker")
+    , stimulusLine      (-1)
+    , preMs             (ARTIFACT_BLANKER_DEFAULT_PRE_MS)
+    , postMs            (ARTIFACT_BLANKER_DEFAULT_POST_MS)
+    , mode              (INTERPOLATE_MODE)
+{
+    setProcessorType (PROCESSOR_TYPE_FILTER);
+
+    stimuli.ensureStorageAllocated (ARTIFACT_BLANKER_MAX_STIMULI);
+}
+
+
+ArtifactBlanker::~ArtifactBlanker()
+{
+}
+
+
+AudioProcessorEditor* ArtifactBlanker::createEditor()
+{
+    editor = new ArtifactBlankerEditor (this, true);
+    return editor;
+}
+
+
+int ArtifactBlanker::getStimulusLine() const
+{
+    return stimulusLine;
+}
+
+
+float ArtifactBlanker::getPreMs() const
+{
+    return preMs;
+}
+
+
+float ArtifactBlanker::getPostMs() const
+{
+    return postMs;
+}
+
+
+ArtifactBlanker::BlankingMode ArtifactBlanker::getMode() const
+{
+    return BlankingMode (mode);
+}
+
+
+int ArtifactBlanker::getDelaySamples (int subProcessorIdx) const
+{
+    if (isPositiveAndBelow (subProcessorIdx, sources.size()))
+        return sources[subProcessorIdx]->delaySamples;
+
+    return 0;
+}
+
+
+void ArtifactBlanker::setParameter (int parameterIndex, float newValue)
+{
+    if (parameterIndex == 0)
+        stimulusLine = jmax (-1, roundFloatToInt (newValue));
+    else if (parameterIndex == 1)
+        preMs = jlimit (0.0f, ARTIFACT_BLANKER_MAX_MS, newValue);
+    else if (parameterIndex == 2)
+        postMs = jlimit (0.0f, ARTIFACT_BLANKER_MAX_MS, newValue);
+    else if (parameterIndex == 3)
+        mode = jlimit (int (HOLD_MODE), int (TEMPLATE_MODE), roundFloatToInt (newValue));
+}
+
+
+int ArtifactBlanker::getNumSubProcessors() const
+{
+    return jmax (1, sources.size());
+}
+
+
+float ArtifactBlanker::getSampleRate (int subProcessorIdx) const
+{
+    if (subProcessorIdx < sources.size())
+        return sources[subProcessorIdx]->sampleRate;
+
+    return getDefaultSampleRate();
+}
+
+
+void ArtifactBlanker::updateSettings()
+{
+    sources.clear();
+    channelStates.clear();
+
+    for (int i = 0; i < dataChannelArray.size(); ++i)
+    {
+        const DataChannel* input = dataChannelArray[i];
+        const uint32 sourceId = getProcessorFullId (input->getSourceNodeID(), input->getSubProcessorIdx());
+
+        int sub = 0;
+        while (sub < sources.size() && sources[sub]->sourceId != sourceId)
+            ++sub;
+
+        if (sub == sources.size())
+        {
+            const float sampleRate = input->getSampleRate();
+
+            BlankingSource* source = sources.add (new BlankingSource());
+            source->sourceId = sourceId;
+            source->sampleRate = sampleRate;
+            source->preSamples = roundFloatToInt (preMs * sampleRate / 1000.0f);
+            source->windowSamples = jmax (1, roundFloatToInt ((preMs + postMs) * sampleRate / 1000.0f));
+
+            // the samples before the TTL, and up to the one after the window to interpolate towards it
+            source->delaySamples = (mode == INTERPOLATE_MODE) ? source->windowSamples + 1 : source->preSamples;
+
+            source->windows.ensureStorageAllocated (ARTIFACT_BLANKER_MAX_STIMULI + 1);
+            source->segments.ensureStorageAllocated (ARTIFACT_BLANKER_MAX_STIMULI + 1);
+        }
+
+        const BlankingSource& source = *sources[sub];
+
+        DataChannel* output = new DataChannel (input->getChannelType(), input->getSampleRate(), this, uint16 (sub));
+        output->setName (input->getName());
+        output->setBitVolts (input->getBitVolts());
+        output->setDataUnits (input->getDataUnits());
+        output->setRecordState (input->getRecordState());
+        output->setMonitored (input->isMonitored());
+        output->addToHistoricString (input->getHistoricString());
+
+        ChannelState* state = channelStates.add (new ChannelState());
+        state->source = sub;
+        state->history.calloc (jmax (1, source.delaySamples));
+        state->incoming.calloc (jmax (1, source.delaySamples));
+        state->artifactTemplate.calloc (source.windowSamples);
+
+        dataChannelArray.set (i, output);
+    }
+
+    resetStates();
+}
+
+
+bool ArtifactBlanker::enable()
+{
+    resetStates();
+    return true;
+}
+
+
+void ArtifactBlanker::resetStates()
+{
+    stimuli.clearQuick();
+
+    for (int s = 0; s < sources.size(); ++s)
+    {
+        BlankingSource& source = *sources[s];
+
+        source.hasTimestamp = false;
+        source.nextTimestamp = 0;
+        source.windows.clearQuick();
+        source.segments.clearQuick();
+        source.numTemplateEvents = 0;
+        source.templateWeight = 1.0f;
+    }
+
+    for (int ch = 0; ch < channelStates.size(); ++ch)
+    {
+        ChannelState& state = *channelStates[ch];
+        const BlankingSource& source = *sources[state.source];
+
+        FloatVectorOperations::clear (state.history.getData(), jmax (1, source.delaySamples));
+        FloatVectorOperations::clear (state.artifactTemplate.getData(), source.windowSamples);
+        state.lastOutput = 0;
+        state.before = 0;
+        state.after = 0;
+    }
+}
+
+
+void ArtifactBlanker::handleEvent (const EventChannel* eventInfo, const MidiMessage& event, int samplePosition)
+{
+    if (stimulusLine < 0 || Event::getEventType (event) != EventChannel::TTL)
+        return;
+
+    TTLEventPtr ttl = TTLEvent::deserializeFromMessage (event, eventInfo);
+
+    if (ttl->getChannel() == stimulusLine && ttl->getState() && stimuli.size() < ARTIFACT_BLANKER_MAX_STIMULI)
+        stimuli.add (ttl->getTimestamp());
+}
+
+
+void ArtifactBlanker::process (AudioSampleBuffer& buffer)
+{
+    if (channelStates.size() == 0)
+        return;
+
+    stimuli.clearQuick();
+    checkForEvents();
+
+    // TTLs from several event channels may come out of order
+    stimuli.sort();
+
+    for (int s = 0; s < sources.size(); ++s)
+    {
+        BlankingSource& source = *sources[s];
+        const uint64 timestamp = getSourceTimestamp (source.sourceId);
+
+        if (! source.hasTimestamp)
+        {
+            source.nextTimestamp = (timestamp > uint64 (source.delaySamples)) ? timestamp - source.delaySamples : 0;
+            source.hasTimestamp = true;
+        }
+
+        for (int n = 0; n < stimuli.size(); ++n)
+        {
+            Window window;
+            window.start = stimuli[n] - source.preSamples;
+            window.end = window.start + source.windowSamples;
+            window.started = false;
+
+            // windows do not overlap, a stimulus inside the last one being part of its artifact
+            if (source.windows.size() > 0 && window.start < source.windows.getLast().end)
+                continue;
+
+            if (source.windows.size() <= ARTIFACT_BLANKER_MAX_STIMULI)
+                source.windows.add (window);
+        }
+
+        updateSegments (source, getNumSourceSamples (source.sourceId));
+    }
+
+    processChannelsInParallel (buffer, jmin (buffer.getNumChannels(), channelStates.size()));
+
+    for (int s = 0; s < sources.size(); ++s)
+    {
+        BlankingSource& source = *sources[s];
+        const int numSamples = getNumSourceSamples (source.sourceId);
+
+        setTimestampAndSamples (source.nextTimestamp, numSamples, s);
+        source.nextTimestamp += numSamples;
+    }
+}
+
+
+void ArtifactBlanker::updateSegments (BlankingSource& source, int numSamples)
+{
+    const int64 blockStart = int64 (source.nextTimestamp);
+    const int64 blockEnd = blockStart + numSamples;
+
+    source.segments.clearQuick();
+
+    int numFinished = 0;
+
+    for (int w = 0; w < source.windows.size(); ++w)
+    {
+        Window& window = source.windows.getReference (w);
+
+        if (window.start >= blockEnd)
+            break;
+
+        const int64 first = jmax (window.start, blockStart);
+        const int64 last = jmin (window.end, blockEnd);
+
+        if (first < last)
+        {
+            Segment segment;
+            segment.first = int (first - blockStart);
+            segment.last = int (last - blockStart);
+            segment.offset = int (first - window.start);
+            segment.startsWindow = ! window.started;
+            source.segments.add (segment);
+
+            window.started = true;
+
+            if (segment.startsWindow)
+            {
+                source.templateWeight = 1.0f / float (jmin (source.numTemplateEvents + 1, ARTIFACT_BLANKER_TEMPLATE_EVENTS));
+                ++source.numTemplateEvents;
+            }
+        }
+
+        if (window.end <= blockEnd)
+            ++numFinished;
+    }
+
+    source.windows.removeRange (0, numFinished);
+}
+
+
+void ArtifactBlanker::processChannels (AudioSampleBuffer& buffer, int firstChannel, int lastChannel)
+{
+    for (int ch = firstChannel; ch < lastChannel; ++ch)
+    {
+        ChannelState& state = *channelStates.getUnchecked (ch);
+        const BlankingSource& source = *sources.getUnchecked (state.source);
+
+        float* data = buffer.getWritePointer (ch);
+        const int numSamples = getNumSourceSamples (source.sourceId);
+
+        if (source.delaySamples > 0)
+            delayChannel (state, data, numSamples, source.delaySamples);
+
+        for (int n = 0; n < source.segments.size(); ++n)
+            blankSegment (state, source, source.segments.getReference (n), data, numSamples);
+
+        if (numSamples > 0)
+            state.lastOutput = data[numSamples - 1];
+    }
+}
+
+
+void ArtifactBlanker::delayChannel (ChannelState& state, float* data, int numSamples, int delaySamples)
+{
+    if (numSamples >= delaySamples)
+    {
+        // the block's last samples become the delay line, and the delay line the block's first samples
+        FloatVectorOperations::copy (state.incoming.getData(), data + numSamples - delaySamples, delaySamples);
+        memmove (data + delaySamples, data, sizeof (float) * size_t (numSamples - delaySamples));
+        FloatVectorOperations::copy (data, state.history.getData(), delaySamples);
+        state.history.swapWith (state.incoming);
+    }
+    else
+    {
+        FloatVectorOperations::copy (state.incoming.getData(), data, numSamples);
+        FloatVectorOperations::copy (data, state.history.getData(), numSamples);
+        memmove (state.history.getData(), state.history + numSamples, sizeof (float) * size_t (delaySamples - numSamples));
+        FloatVectorOperations::copy (state.history + delaySamples - numSamples, state.incoming.getData(), numSamples);
+    }
+}
+
+
+void ArtifactBlanker::blankSegment (ChannelState& state, const BlankingSource& source, const Segment& segment,
+                                    float* data, int numSamples)
+{
+    if (segment.startsWindow)
+    {
+        state.before = (segment.first > 0) ? data[segment.first - 1] : state.lastOutput;
+
+        if (mode == INTERPOLATE_MODE)
+        {
+            // already in the block or still in the delay line, which holds the samples following it
+            const int after = segment.first - segment.offset + source.windowSamples;
+
+            if (after < numSamples)
+                state.after = data[after];
+            else
+                state.after = state.history[jmin (after - numSamples, source.delaySamples - 1)];
+        }
+    }
+
+    float* out = data + segment.first;
+    const int count = segment.last - segment.first;
+
+    if (mode == HOLD_MODE)
+    {
+        FloatVectorOperations::fill (out, state.before, count);
+    }
+    else if (mode == INTERPOLATE_MODE)
+    {
+        const float step = (state.after - state.before) / float (source.windowSamples + 1);
+        const float start = state.before + step * float (segment.offset + 1);
+
+        for (int i = 0; i < count; ++i)
+            out[i] = start + step * float (i);
+    }
+    else
+    {
+        // the template is updated before being subtracted, so the first window is held
+        float* artifact = state.artifactTemplate + segment.offset;
+        const float weight = source.templateWeight;
+
+        for (int i = 0; i < count; ++i)
+        {
+            artifact[i] += weight * (out[i] - state.before - artifact[i]);
+            out[i] -= artifact[i];
+        }
+    }
+}
@@ -0,0 +1,189 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef ARTIFACTBLANKER_H_INCLUDED
+#define ARTIFACTBLANKER_H_INCLUDED
+
+
+#ifdef _WIN32
+    #include <Windows.h>
+#endif
+
+#include <ProcessorHeaders.h>
+
+
+#define ARTIFACT_BLANKER_DEFAULT_PRE_MS 0.5f
+#define ARTIFACT_BLANKER_DEFAULT_POST_MS 2.0f
+#define ARTIFACT_BLANKER_MAX_MS 50.0f
+
+/** Stimuli a template is averaged over, the later ones being weighted as much as the last of those */
+#define ARTIFACT_BLANKER_TEMPLATE_EVENTS 20
+
+/** Stimuli a block can start windows for */
+#define ARTIFACT_BLANKER_MAX_STIMULI 64
+
+
+/**
+    Removes stimulation artifacts from the channels before they reach the filters and the
+    spike detectors, replacing a window around each rising edge of a stimulus TTL line.
+
+    A window runs from a set time before the TTL to a set time after it. Its samples are
+    either held at the last sample before it, linearly interpolated between the samples on
+    either side of it, or have a template of the artifact subtracted. The template of each
+    channel is the mean of its last windows, taken relative to the sample before them, so
+    the first stimulus is held and the later ones keep the signal under the artifact.
+
+    Seeing the samples before a TTL, and after the window when interpolating, takes a
+    lookahead, so the channels are delayed by a delay line of that many samples: the time
+    before the TTL, plus the window and one sample when interpolating. Each source of the
+    input channels becomes a subprocessor of the Artifact Blanker, whose timestamps are
+    shifted back by the delay, so that the samples keep their timestamps and the TTLs and
+    spikes from upstream stay aligned with them.
+
+    A stimulus falling inside the window of the previous one is part of the same artifact.
+    The TTL timestamps are taken to be in the clock of every source, which is the case when
+    the stimulus line is recorded by the acquisition board.
+*/
+class ArtifactBlanker : public GenericProcessor
+{
+public:
+    /** The class constructor, used to initialize any members. */
+    ArtifactBlanker();
+
+    /** The class destructor, used to deallocate memory */
+    ~ArtifactBlanker();
+
+    /** Collects the block's stimuli, then delays and blanks every channel */
+    void process (AudioSampleBuffer& buffer) override;
+
+    /** Channels are delayed and blanked independently, so they can be split across threads.*/
+    bool isChannelParallelSafe() const override { return true; }
+
+    void processChannels (AudioSampleBuffer& buffer, int firstChannel, int lastChannel) override;
+
+    void handleEvent (const EventChannel* eventInfo, const MidiMessage& event, int samplePosition) override;
+
+    AudioProcessorEditor* createEditor() override;
+
+    bool hasEditor() const override { return true; }
+
+    /** Replaces the input channels with channels of the Artifact Blanker's subprocessors */
+    void updateSettings() override;
+
+    int getNumSubProcessors() const override;
+
+    float getSampleRate (int subProcessorIdx = 0) const override;
+
+    bool enable() override;
+
+    enum BlankingMode
+    {
+        HOLD_MODE = 0,
+        INTERPOLATE_MODE,
+        TEMPLATE_MODE
+    };
+
+    int getStimulusLine() const;
+    float getPreMs() const;
+    float getPostMs() const;
+    BlankingMode getMode() const;
+
+    /** Returns the delay of the channels of a subprocessor, in samples */
+    int getDelaySamples (int subProcessorIdx) const;
+
+    /** Sets the TTL line of the stimuli (0), -1 for none, which can be changed during acquisition,
+        and the time before (1) and after (2) them in ms and the mode (3), which take effect at the
+        next update of the signal chain. */
+    void setParameter (int parameterIndex, float newValue) override;
+
+
+private:
+    /** A window, in the timestamps of the source, the end excluded */
+    struct Window
+    {
+        int64 start;
+        int64 end;
+        bool started;               // if it has had samples of a block, a late one starting in the middle
+    };
+
+    /** A window's part in the block, in output samples */
+    struct Segment
+    {
+        int first;
+        int last;                   // excluded
+        int offset;                 // of the first sample in the window
+        bool startsWindow;
+    };
+
+    struct BlankingSource
+    {
+        uint32 sourceId;
+        float sampleRate;
+        int preSamples;
+        int windowSamples;
+        int delaySamples;
+        bool hasTimestamp;
+        uint64 nextTimestamp;       // of the block's first output sample
+        Array<Window> windows;      // started or to start, in order
+        Array<Segment> segments;    // those of the block
+        int numTemplateEvents;
+        float templateWeight;
+    };
+
+    struct ChannelState
+    {
+        int source;
+        HeapBlock<float> history;   // the delayed samples, oldest first
+        HeapBlock<float> incoming;
+        HeapBlock<float> artifactTemplate;
+        float lastOutput;
+        float before;               // the sample before the current window
+        float after;                // and the one after it, when interpolating
+    };
+
+    /** Clears the delay lines, windows and templates */
+    void resetStates();
+
+    /** Lays out the windows of a source over the block's output samples */
+    void updateSegments (BlankingSource& source, int numSamples);
+
+    void delayChannel (ChannelState& state, float* data, int numSamples, int delaySamples);
+    void blankSegment (ChannelState& state, const BlankingSource& source, const Segment& segment,
+                       float* data, int numSamples);
+
+    int stimulusLine;
+    float preMs;
+    float postMs;
+    int mode;
+
+    Array<int64> stimuli;           // timestamps of the block's stimuli
+
+    OwnedArray<BlankingSource> sources;
+    OwnedArray<ChannelState> channelStates;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ArtifactBlanker);
+};
+
+
+
+#endif  // ARTIFACTBLANKER_H_INCLUDED
@@ -0,0 +1,189 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "ArtifactBlankerEditor.h"
+#include "ArtifactBlanker.h"
+
+
+ArtifactBlankerEditor::ArtifactBlankerEditor (GenericProcessor* parentNode, bool useDefaultParameterEditors)
+    : GenericEditor (parentNode, useDefaultParameterEditors)
+{
+    desiredWidth = 190;
+
+    // item ids are the line plus two, 1 being none, and the mode plus one
+    lineSelector = addSelector ("Stimulus TTL:", 10, 25, "TTL line whose rising edges are the stimuli");
+    lineSelector->addItem ("None", 1);
+    for (int line = 0; line < 16; ++line)
+        lineSelector->addItem (String (line + 1), line + 2);
+    lineSelector->setSelectedId (1, dontSendNotification);
+
+    modeSelector = addSelector ("Replace with:", 10, 65, "What the samples of the window around each stimulus are replaced with");
+    modeSelector->addItem ("Hold", ArtifactBlanker::HOLD_MODE + 1);
+    modeSelector->addItem ("Interpolation", ArtifactBlanker::INTERPOLATE_MODE + 1);
+    modeSelector->addItem ("Template", ArtifactBlanker::TEMPLATE_MODE + 1);
+    modeSelector->setSelectedId (ArtifactBlanker::INTERPOLATE_MODE + 1, dontSendNotification);
+
+    preValue  = addValue ("Pre (ms):", 110, 25, ARTIFACT_BLANKER_DEFAULT_PRE_MS, "Start of the window, before the stimulus");
+    postValue = addValue ("Post (ms):", 110, 65, ARTIFACT_BLANKER_DEFAULT_POST_MS, "End of the window, after the stimulus");
+}
+
+
+ArtifactBlankerEditor::~ArtifactBlankerEditor()
+{
+}
+
+
+void ArtifactBlankerEditor::addCaption (const String& name, int x, int y)
+{
+    Label* caption = captions.add (new Label (name, name));
+    caption->setBounds (x, y, 90, 15);
+    caption->setFont (Font ("Small Text", 12, Font::plain));
+    caption->setColour (Label::textColourId, Colours::darkgrey);
+    addAndMakeVisible (caption);
+}
+
+
+Label* ArtifactBlankerEditor::addValue (const String& name, int x, int y, float value, const String& tooltip)
+{
+    addCaption (name, x, y);
+
+    Label* label = new Label (name, String (value));
+    label->setBounds (x + 5, y + 17, 55, 18);
+    label->setFont (Font ("Default", 15, Font::plain));
+    label->setColour (Label::textColourId, Colours::white);
+    label->setColour (Label::backgroundColourId, Colours::grey);
+    label->setEditable (true);
+    label->setTooltip (tooltip);
+    label->addListener (this);
+    addAndMakeVisible (label);
+
+    return label;
+}
+
+
+ComboBox* ArtifactBlankerEditor::addSelector (const String& name, int x, int y, const String& tooltip)
+{
+    addCaption (name, x, y);
+
+    ComboBox* selector = new ComboBox (name);
+    selector->setBounds (x + 5, y + 17, 90, 18);
+    selector->setTooltip (tooltip);
+    selector->addListener (this);
+    addAndMakeVisible (selector);
+
+    return selector;
+}
+
+
+void ArtifactBlankerEditor::labelTextChanged (Label* label)
+{
+    ArtifactBlanker* processor = static_cast<ArtifactBlanker*> (getProcessor());
+    const float value = label->getText().getFloatValue();
+
+    if (value < 0 || value > ARTIFACT_BLANKER_MAX_MS)
+        CoreServices::sendStatusMessage ("Value out of range.");
+    else if (label == preValue)
+        processor->setParameter (1, value);
+    else if (label == postValue)
+        processor->setParameter (2, value);
+
+    preValue->setText (String (processor->getPreMs()), dontSendNotification);
+    postValue->setText (String (processor->getPostMs()), dontSendNotification);
+
+    // the delay of the channels changes
+    CoreServices::updateSignalChain (this);
+}
+
+
+void ArtifactBlankerEditor::comboBoxChanged (ComboBox* comboBox)
+{
+    if (comboBox == lineSelector)
+    {
+        // can change during acquisition
+        getProcessor()->queueParameterChange (0, float (lineSelector->getSelectedId() - 2));
+    }
+    else if (comboBox == modeSelector)
+    {
+        getProcessor()->setParameter (3, float (modeSelector->getSelectedId() - 1));
+        CoreServices::updateSignalChain (this);
+    }
+}
+
+
+void ArtifactBlankerEditor::startAcquisition()
+{
+    modeSelector->setEnabled (false);
+    preValue->setEnabled (false);
+    postValue->setEnabled (false);
+}
+
+
+void ArtifactBlankerEditor::stopAcquisition()
+{
+    modeSelector->setEnabled (true);
+    preValue->setEnabled (true);
+    postValue->setEnabled (true);
+}
+
+
+void ArtifactBlankerEditor::saveCustomParameters (XmlElement* xml)
+{
+    xml->setAttribute ("Type", "ArtifactBlankerEditor");
+
+    ArtifactBlanker* processor = static_cast<ArtifactBlanker*> (getProcessor());
+
+    XmlElement* values = xml->createNewChildElement ("VALUES");
+    values->setAttribute ("Line", processor->getStimulusLine());
+    values->setAttribute ("Mode", int (processor->getMode()));
+    values->setAttribute ("Pre", processor->getPreMs());
+    values->setAttribute ("Post", processor->getPostMs());
+}
+
+
+void ArtifactBlankerEditor::loadCustomParameters (XmlElement* xml)
+{
+    ArtifactBlanker* processor = static_cast<ArtifactBlanker*> (getProcessor());
+
+    forEachXmlChildElement (*xml, xmlNode)
+    {
+        if (xmlNode->hasTagName ("VALUES"))
+        {
+            // the signal chain is updated once the whole configuration is loaded
+            const int line = xmlNode->getIntAttribute ("Line", -1) + 2;
+            lineSelector->setSelectedId (lineSelector->indexOfItemId (line) >= 0 ? line : 1, dontSendNotification);
+            processor->setParameter (0, float (lineSelector->getSelectedId() - 2));
+
+            const int mode = xmlNode->getIntAttribute ("Mode", ArtifactBlanker::INTERPOLATE_MODE) + 1;
+            modeSelector->setSelectedId (modeSelector->indexOfItemId (mode) >= 0 ? mode : ArtifactBlanker::INTERPOLATE_MODE + 1,
+                                         dontSendNotification);
+            processor->setParameter (3, float (modeSelector->getSelectedId() - 1));
+
+            processor->setParameter (1, float (xmlNode->getDoubleAttribute ("Pre", ARTIFACT_BLANKER_DEFAULT_PRE_MS)));
+            processor->setParameter (2, float (xmlNode->getDoubleAttribute ("Post", ARTIFACT_BLANKER_DEFAULT_POST_MS)));
+
+            preValue->setText (String (processor->getPreMs()), dontSendNotification);
+            postValue->setText (String (processor->getPostMs()), dontSendNotification);
+        }
+    }
+}
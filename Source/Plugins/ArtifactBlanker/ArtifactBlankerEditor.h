@@ -0,0 +1,71 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef ARTIFACTBLANKEREDITOR_H_INCLUDED
+#define ARTIFACTBLANKEREDITOR_H_INCLUDED
+
+
+#include <EditorHeaders.h>
+
+
+/**
+    User interface for the Artifact Blanker, choosing the stimulus TTL line, the window
+    around each stimulus and how it is replaced.
+
+    @see ArtifactBlanker
+*/
+class ArtifactBlankerEditor : public GenericEditor
+                            , public ComboBox::Listener
+                            , public Label::Listener
+{
+public:
+    ArtifactBlankerEditor (GenericProcessor* parentNode, bool useDefaultParameterEditors);
+    ~ArtifactBlankerEditor();
+
+    void comboBoxChanged (ComboBox* comboBox) override;
+    void labelTextChanged (Label* label) override;
+
+    void startAcquisition() override;
+    void stopAcquisition() override;
+
+    void saveCustomParameters (XmlElement* xml) override;
+    void loadCustomParameters (XmlElement* xml) override;
+
+
+private:
+    /** Adds a caption at the given position, the control being placed below it */
+    void addCaption (const String& name, int x, int y);
+    Label* addValue (const String& name, int x, int y, float value, const String& tooltip);
+    ComboBox* addSelector (const String& name, int x, int y, const String& tooltip);
+
+    OwnedArray<Label>       captions;
+    ScopedPointer<ComboBox> lineSelector;
+    ScopedPointer<ComboBox> modeSelector;
+    ScopedPointer<Label>    preValue;
+    ScopedPointer<Label>    postValue;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ArtifactBlankerEditor);
+};
+
+
+#endif  // ARTIFACTBLANKEREDITOR_H_INCLUDED
@@ -0,0 +1,429 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <stdio.h>
+#include <cmath>
+#include "BandPower.h"
+#include "BandPowerEditor.h"
+
+namespace
+{
+    /** Slides the bins of a channel by one sample, delta being the new sample minus the one leaving the window */
+    inline void slideBins (double* real, double* imag, const double* cosines, const double* sines, int numBins, double delta)
+    {
+        for (int k = 0; k < numBins; ++k)
+        {
+            const double a = real[k] + delta;
+            const double b = imag[k];
+
+            real[k] = a * cosines[k] - b * sines[k];
+            imag[k] = a * sines[k] + b * cosines[k];
+        }
+    }
+
+    String formatHz (float value)
+    {
+        return (value == std::floor (value)) ? String (int (value)) : String (value, 1);
+    }
+}
+
+
+BandPower::BandPower()
+    : GenericProcessor  ("Band Power")
+    , frameRate         (BANDPOWER_DEFAULT_FRAME_RATE)
+    , windowMs          (BANDPOWER_DEFAULT_WINDOW_MS)
+    , outputMode        (POWER_OUTPUT)
+    , firstBandChannel  (0)
+{
+    setProcessorType (PROCESSOR_TYPE_FILTER);
+
+    setBands (BANDPOWER_DEFAULT_BANDS);
+}
+
+
+BandPower::~BandPower()
+{
+}
+
+
+AudioProcessorEditor* BandPower::createEditor()
+{
+    editor = new BandPowerEditor (this, true);
+    return editor;
+}
+
+
+float BandPower::getFrameRate() const
+{
+    return frameRate;
+}
+
+
+float BandPower::getWindowMs() const
+{
+    return windowMs;
+}
+
+
+BandPower::OutputMode BandPower::getOutputMode() const
+{
+    return OutputMode (outputMode);
+}
+
+
+const Array<Range<float> >& BandPower::getBands() const
+{
+    return bands;
+}
+
+
+bool BandPower::setBands (const String& bandList)
+{
+    StringArray tokens;
+    tokens.addTokens (bandList, ",;", String());
+    tokens.trim();
+    tokens.removeEmptyStrings();
+
+    if (tokens.size() == 0 || tokens.size() > BANDPOWER_MAX_BANDS)
+        return false;
+
+    Array<Range<float> > newBands;
+
+    for (int i = 0; i < tokens.size(); ++i)
+    {
+        if (! tokens[i].containsChar ('-'))
+            return false;
+
+        const float low  = tokens[i].upToFirstOccurrenceOf ("-", false, false).trim().getFloatValue();
+        const float high = tokens[i].fromFirstOccurrenceOf ("-", false, false).trim().getFloatValue();
+
+        if (low <= 0 || high <= low)
+            return false;
+
+        newBands.add (Range<float> (low, high));
+    }
+
+    bands.swapWith (newBands);
+    return true;
+}
+
+
+String BandPower::getBandList() const
+{
+    StringArray list;
+
+    for (int b = 0; b < bands.size(); ++b)
+        list.add (formatHz (bands[b].getStart()) + "-" + formatHz (bands[b].getEnd()));
+
+    return list.joinIntoString (", ");
+}
+
+
+void BandPower::setParameter (int parameterIndex, float newValue)
+{
+    if (parameterIndex == 0)
+        frameRate = jlimit (1.0f, 1000.0f, newValue);
+    else if (parameterIndex == 1)
+        windowMs = jlimit (10.0f, 10000.0f, newValue);
+    else if (parameterIndex == 2)
+        outputMode = jlimit (int (POWER_OUTPUT), int (DECIBEL_OUTPUT), roundFloatToInt (newValue));
+}
+
+
+int BandPower::getNumSubProcessors() const
+{
+    return jmax (1, sources.size());
+}
+
+
+float BandPower::getSampleRate (int subProcessorIdx) const
+{
+    if (subProcessorIdx < sources.size())
+        return sources[subProcessorIdx]->outputSampleRate;
+
+    return getDefaultSampleRate();
+}
+
+
+void BandPower::updateSettings()
+{
+    sources.clear();
+    channelStates.clear();
+
+    const int numInputs = dataChannelArray.size();
+    const int numBands = bands.size();
+
+    firstBandChannel = numInputs;
+
+    for (int i = 0; i < numInputs; ++i)
+    {
+        const DataChannel* input = dataChannelArray[i];
+        const uint32 sourceId = getProcessorFullId (input->getSourceNodeID(), input->getSubProcessorIdx());
+
+        int sub = 0;
+        while (sub < sources.size() && sources[sub]->sourceId != sourceId)
+            ++sub;
+
+        if (sub == sources.size())
+        {
+            const double sampleRate = input->getSampleRate();
+
+            FrameSource* source = sources.add (new FrameSource());
+            source->sourceId = sourceId;
+            source->frameSamples = sampleRate / jmin (double (frameRate), sampleRate);
+            source->outputSampleRate = float (sampleRate / source->frameSamples);
+            source->windowSamples = jmax (8, roundDoubleToInt (windowMs * sampleRate / 1000.0));
+            source->hasTimestamp = false;
+            source->nextFrame = 0;
+            source->frameEnds.ensureStorageAllocated (1024);
+
+            // the bins from the lowest to the highest inside each band, at least the nearest one to its centre,
+            // between DC and Nyquist exclusive so that their neighbours are bins too
+            const int N = source->windowSamples;
+            const int maxBin = N / 2 - 1;
+            int kLow[BANDPOWER_MAX_BANDS];
+
+            source->numBins = 0;
+
+            for (int b = 0; b < numBands; ++b)
+            {
+                int low  = jmax (1, (int) std::ceil (bands[b].getStart() * N / sampleRate));
+                int high = jmin (maxBin, (int) std::floor (bands[b].getEnd() * N / sampleRate));
+
+                if (high < low)
+                    low = high = jlimit (1, maxBin, roundDoubleToInt (0.5 * (bands[b].getStart() + bands[b].getEnd()) * N / sampleRate));
+
+                kLow[b] = low;
+                source->firstBin[b] = source->numBins;
+                source->bandBins[b] = high - low + 1;
+                source->numBins += source->bandBins[b] + 2;
+            }
+
+            source->cosines.malloc (jmax (1, source->numBins));
+            source->sines.malloc (jmax (1, source->numBins));
+
+            for (int b = 0; b < numBands; ++b)
+            {
+                for (int j = 0; j < source->bandBins[b] + 2; ++j)
+                {
+                    const double theta = 2.0 * double_Pi * (kLow[b] - 1 + j) / N;
+                    source->cosines[source->firstBin[b] + j] = std::cos (theta);
+                    source->sines[source->firstBin[b] + j] = std::sin (theta);
+                }
+            }
+
+            // one-sided, over the mean square of the Hann window, 3/8
+            source->scale = 2.0 / (0.375 * double (N) * double (N));
+        }
+
+        const FrameSource& source = *sources[sub];
+
+        ChannelState* state = channelStates.add (new ChannelState());
+        state->source = sub;
+        state->outputChannel = firstBandChannel + i * numBands;
+        state->history.calloc (source.windowSamples);
+        state->position = 0;
+        state->real.calloc (jmax (1, source.numBins));
+        state->imag.calloc (jmax (1, source.numBins));
+    }
+
+    for (int i = 0; i < numInputs; ++i)
+    {
+        const DataChannel* input = dataChannelArray[i];
+        const int sub = channelStates[i]->source;
+
+        for (int b = 0; b < numBands; ++b)
+        {
+            DataChannel* output = new DataChannel (DataChannel::AUX_CHANNEL, sources[sub]->outputSampleRate, this, uint16 (sub));
+            output->setName (input->getName() + " " + formatHz (bands[b].getStart()) + "-" + formatHz (bands[b].getEnd()) + " Hz");
+
+            if (outputMode == DECIBEL_OUTPUT)
+            {
+                output->setBitVolts (0.01f);
+                output->setDataUnits ("dB");
+            }
+            else
+            {
+                output->setBitVolts (input->getBitVolts());
+                output->setDataUnits (outputMode == POWER_OUTPUT ? input->getDataUnits() + "^2" : input->getDataUnits());
+            }
+
+            output->addToHistoricString (getName());
+            dataChannelArray.add (output);
+        }
+    }
+
+    settings.numOutputs = dataChannelArray.size();
+
+    resetStates();
+}
+
+
+bool BandPower::enable()
+{
+    resetStates();
+    return true;
+}
+
+
+void BandPower::resetStates()
+{
+    for (int s = 0; s < sources.size(); ++s)
+    {
+        sources[s]->hasTimestamp = false;
+        sources[s]->nextFrame = 0;
+        sources[s]->frameEnds.clearQuick();
+    }
+
+    for (int ch = 0; ch < channelStates.size(); ++ch)
+    {
+        ChannelState& state = *channelStates[ch];
+        const FrameSource& source = *sources[state.source];
+
+        FloatVectorOperations::clear (state.history.getData(), source.windowSamples);
+        state.position = 0;
+
+        for (int k = 0; k < source.numBins; ++k)
+            state.real[k] = state.imag[k] = 0.0;
+    }
+}
+
+
+void BandPower::process (AudioSampleBuffer& buffer)
+{
+    const int numSamples = buffer.getNumSamples();
+
+    if (channelStates.size() == 0 || bands.size() == 0 || numSamples == 0
+        || buffer.getNumChannels() < firstBandChannel + channelStates.size() * bands.size())
+        return;
+
+    // the samples after which each frame ending in the block is taken, at most one per sample of the buffer
+    for (int s = 0; s < sources.size(); ++s)
+    {
+        FrameSource& source = *sources[s];
+        const int64 timestamp = int64 (getSourceTimestamp (source.sourceId));
+        const int64 end = timestamp + getNumSourceSamples (source.sourceId);
+
+        if (! source.hasTimestamp)
+        {
+            source.nextFrame = int64 (std::floor (timestamp / source.frameSamples));
+            source.hasTimestamp = true;
+        }
+
+        source.frameEnds.clearQuick();
+
+        for (int64 frame = source.nextFrame; source.frameEnds.size() < numSamples; ++frame)
+        {
+            const int64 last = int64 (std::ceil ((frame + 1) * source.frameSamples)) - 1;
+
+            if (last >= end)
+                break;
+
+            source.frameEnds.add (int (jmax (int64 (0), last - timestamp)));
+        }
+    }
+
+    processChannelsInParallel (buffer, channelStates.size());
+
+    for (int s = 0; s < sources.size(); ++s)
+    {
+        FrameSource& source = *sources[s];
+
+        setTimestampAndSamples (uint64 (source.nextFrame), source.frameEnds.size(), s);
+        source.nextFrame += source.frameEnds.size();
+    }
+}
+
+
+void BandPower::processChannels (AudioSampleBuffer& buffer, int firstChannel, int lastChannel)
+{
+    const int numBands = bands.size();
+
+    for (int ch = firstChannel; ch < lastChannel; ++ch)
+    {
+        ChannelState& state = *channelStates.getUnchecked (ch);
+        const FrameSource& source = *sources.getUnchecked (state.source);
+
+        const float* data = buffer.getReadPointer (ch);
+        const int numInputs = getNumSourceSamples (source.sourceId);
+        const int numFrames = source.frameEnds.size();
+        const int* frameEnds = source.frameEnds.begin();
+
+        double* real = state.real;
+        double* imag = state.imag;
+        float* history = state.history;
+        int frame = 0;
+
+        for (int i = 0; i < numInputs; ++i)
+        {
+            const float x = data[i];
+            const double delta = double (x) - double (history[state.position]);
+
+            history[state.position] = x;
+            if (++state.position == source.windowSamples)
+                state.position = 0;
+
+            slideBins (real, imag, source.cosines, source.sines, source.numBins, delta);
+
+            while (frame < numFrames && frameEnds[frame] <= i)
+                takeFrame (source, state, buffer, frame++);
+        }
+
+        while (frame < numFrames)
+            takeFrame (source, state, buffer, frame++);
+
+        for (int b = 0; b < numBands; ++b)
+            FloatVectorOperations::clear (buffer.getWritePointer (state.outputChannel + b) + numFrames,
+                                          buffer.getNumSamples() - numFrames);
+    }
+}
+
+
+void BandPower::takeFrame (const FrameSource& source, const ChannelState& state, AudioSampleBuffer& buffer, int frame) const
+{
+    for (int b = 0; b < bands.size(); ++b)
+    {
+        const double* real = state.real + source.firstBin[b];
+        const double* imag = state.imag + source.firstBin[b];
+        double sum = 0;
+
+        // the Hann window, as the bin less a quarter of each neighbour, over two
+        for (int k = 1; k <= source.bandBins[b]; ++k)
+        {
+            const double re = 0.5 * real[k] - 0.25 * (real[k - 1] + real[k + 1]);
+            const double im = 0.5 * imag[k] - 0.25 * (imag[k - 1] + imag[k + 1]);
+            sum += re * re + im * im;
+        }
+
+        const double power = sum * source.scale;
+        double value = power;
+
+        if (outputMode == AMPLITUDE_OUTPUT)
+            value = std::sqrt (power);
+        else if (outputMode == DECIBEL_OUTPUT)
+            value = 10.0 * std::log10 (jmax (power, 1e-20));
+
+        buffer.getWritePointer (state.outputChannel + b)[frame] = float (value);
+    }
+}
@@ -0,0 +1,172 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef BANDPOWER_H_INCLUDED
+#define BANDPOWER_H_INCLUDED
+
+
+#ifdef _WIN32
+    #include <Windows.h>
+#endif
+
+#include <ProcessorHeaders.h>
+
+
+#define BANDPOWER_MAX_BANDS 8
+#define BANDPOWER_DEFAULT_FRAME_RATE 100
+#define BANDPOWER_DEFAULT_WINDOW_MS 250
+#define BANDPOWER_DEFAULT_BANDS "6-10, 30-80"
+
+
+/**
+    Computes the power of each input channel in a few frequency bands, a set number of times
+    per second, for closed-loop decoders that would otherwise need a filter, a rectifier and
+    a smoothing stage per band.
+
+    The power of a band is that of the DFT bins it spans over a Hann window of past samples.
+    Only those bins are computed, by a sliding DFT: every sample rotates each bin by one step
+    and adds the difference between the new sample and the one leaving the window, so the
+    cost per sample is a complex multiply per bin, whatever the frame rate. The Hann window
+    is applied to the bins when a frame is taken, as a combination of each one with its two
+    neighbours, which are computed for that purpose. The bins are kept in double precision,
+    so that the rounding errors of the recursion stay far below the signal over a session.
+
+    The band channels, a channel per input channel and band, are added after the input
+    channels, which are passed through unchanged. Those of the channels from one source make
+    up a subprocessor of the Band Power, whose sample rate is the frame rate and whose
+    timestamps count the frames since the source's first sample. Channels are independent,
+    so they are processed on the channel thread pool.
+
+    The cost grows with the number of bins, the window length over the sample period, so
+    wide bands on wideband data are best computed after a Decimator.
+*/
+class BandPower : public GenericProcessor
+{
+public:
+    /** The class constructor, used to initialize any members. */
+    BandPower();
+
+    /** The class destructor, used to deallocate memory */
+    ~BandPower();
+
+    /** Runs the block's samples through the bins of every channel and sets the timestamp and
+        number of frames of each subprocessor. */
+    void process (AudioSampleBuffer& buffer) override;
+
+    /** Channels are transformed independently, so they can be split across threads.*/
+    bool isChannelParallelSafe() const override { return true; }
+
+    /** The range is one of input channels, each writing its own band channels */
+    void processChannels (AudioSampleBuffer& buffer, int firstChannel, int lastChannel) override;
+
+    AudioProcessorEditor* createEditor() override;
+
+    bool hasEditor() const override { return true; }
+
+    /** Adds the band channels after the input channels */
+    void updateSettings() override;
+
+    int getNumSubProcessors() const override;
+
+    float getSampleRate (int subProcessorIdx = 0) const override;
+
+    bool enable() override;
+
+    enum OutputMode
+    {
+        POWER_OUTPUT = 0,       // mean square of the band, in the input units squared
+        AMPLITUDE_OUTPUT,       // its square root, the RMS amplitude of the band
+        DECIBEL_OUTPUT          // 10 log10 of the power
+    };
+
+    float getFrameRate() const;
+    float getWindowMs() const;
+    OutputMode getOutputMode() const;
+
+    /** The bands, as pairs of edges in Hz */
+    const Array<Range<float> >& getBands() const;
+
+    /** Sets the bands from a list such as "6-10, 30-80", and returns false, changing nothing,
+        if it has none or a band is not a valid range. Takes effect at the next update of the
+        signal chain. */
+    bool setBands (const String& bandList);
+
+    /** Returns the bands as a list setBands() can read */
+    String getBandList() const;
+
+    /** Sets the frame rate in Hz (0), the window in ms (1) and the output mode (2), which
+        take effect at the next update of the signal chain. */
+    void setParameter (int parameterIndex, float newValue) override;
+
+
+private:
+    /** The frames of the channels sharing a source, and the bins they compute */
+    struct FrameSource
+    {
+        uint32 sourceId;
+        float outputSampleRate;
+        double frameSamples;        // source samples per frame
+        int windowSamples;
+        HeapBlock<double> cosines;  // rotation of each bin over one sample
+        HeapBlock<double> sines;
+        int numBins;
+        int firstBin[BANDPOWER_MAX_BANDS];  // each band's bins, preceded and followed by a neighbour
+        int bandBins[BANDPOWER_MAX_BANDS];  // bins of the band proper
+        double scale;               // from the summed squared bins to the mean square of the band
+        bool hasTimestamp;
+        int64 nextFrame;            // frame ending in the block, or after it
+        Array<int> frameEnds;       // samples of the block each frame is taken after
+    };
+
+    struct ChannelState
+    {
+        int source;
+        int outputChannel;          // buffer index of its first band channel
+        HeapBlock<float> history;   // the window of past samples
+        int position;
+        HeapBlock<double> real;
+        HeapBlock<double> imag;
+    };
+
+    /** Clears the window and bins of every channel */
+    void resetStates();
+
+    /** Writes the output value of each band for the current bins of a channel */
+    void takeFrame (const FrameSource& source, const ChannelState& state, AudioSampleBuffer& buffer, int frame) const;
+
+    Array<Range<float> > bands;
+    float frameRate;
+    float windowMs;
+    int outputMode;
+
+    int firstBandChannel;           // buffer index of the first band channel
+
+    OwnedArray<FrameSource> sources;
+    OwnedArray<ChannelState> channelStates;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BandPower);
+};
+
+
+
+#endif  // BANDPOWER_H_INCLUDED
@@ -0,0 +1,187 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "BandPowerEditor.h"
+#include "BandPower.h"
+
+
+BandPowerEditor::BandPowerEditor (GenericProcessor* parentNode, bool useDefaultParameterEditors)
+    : GenericEditor (parentNode, useDefaultParameterEditors)
+{
+    desiredWidth = 260;
+
+    BandPower* processor = static_cast<BandPower*> (parentNode);
+
+    Label* bandsLabel = labels.add (new Label ("Bands (Hz):", "Bands (Hz):"));
+    bandsLabel->setBounds (10, 25, 100, 15);
+    bandsLabel->setFont (Font ("Small Text", 12, Font::plain));
+    bandsLabel->setColour (Label::textColourId, Colours::darkgrey);
+    addAndMakeVisible (bandsLabel);
+
+    bandsValue = new Label ("bands", processor->getBandList());
+    bandsValue->setBounds (15, 40, 110, 18);
+    bandsValue->setFont (Font ("Default", 14, Font::plain));
+    bandsValue->setColour (Label::textColourId, Colours::white);
+    bandsValue->setColour (Label::backgroundColourId, Colours::grey);
+    bandsValue->setEditable (true);
+    bandsValue->setTooltip ("Bands as low-high pairs in Hz, separated by commas, at most " + String (BANDPOWER_MAX_BANDS));
+    bandsValue->addListener (this);
+    addAndMakeVisible (bandsValue);
+
+    // item ids are the values, or the output mode plus one
+    outputSelector = addSelector ("Output:", 10, 65, "What each band channel gives, at each frame");
+    outputSelector->addItem ("Power", BandPower::POWER_OUTPUT + 1);
+    outputSelector->addItem ("Amplitude (RMS)", BandPower::AMPLITUDE_OUTPUT + 1);
+    outputSelector->addItem ("Power (dB)", BandPower::DECIBEL_OUTPUT + 1);
+    outputSelector->setSelectedId (BandPower::POWER_OUTPUT + 1, dontSendNotification);
+
+    frameRateSelector = addSelector ("Frame rate (Hz):", 135, 25, "Band powers given per second, one sample of the band channels each");
+    const int rates[] = { 10, 20, 50, 100, 200, 250, 500 };
+    for (int i = 0; i < numElementsInArray (rates); ++i)
+        frameRateSelector->addItem (String (rates[i]), rates[i]);
+    frameRateSelector->setSelectedId (BANDPOWER_DEFAULT_FRAME_RATE, dontSendNotification);
+
+    windowSelector = addSelector ("Window (ms):", 135, 65, "Length of the Hann window each frame is computed over, setting the frequency resolution");
+    const int windows[] = { 50, 100, 200, 250, 500, 1000, 2000 };
+    for (int i = 0; i < numElementsInArray (windows); ++i)
+        windowSelector->addItem (String (windows[i]), windows[i]);
+    windowSelector->setSelectedId (BANDPOWER_DEFAULT_WINDOW_MS, dontSendNotification);
+}
+
+
+BandPowerEditor::~BandPowerEditor()
+{
+}
+
+
+ComboBox* BandPowerEditor::addSelector (const String& name, int x, int y, const String& tooltip)
+{
+    Label* label = labels.add (new Label (name, name));
+    label->setBounds (x, y, 110, 15);
+    label->setFont (Font ("Small Text", 12, Font::plain));
+    label->setColour (Label::textColourId, Colours::darkgrey);
+    addAndMakeVisible (label);
+
+    ComboBox* selector = new ComboBox (name);
+    selector->setBounds (x + 5, y + 15, 110, 18);
+    selector->setTooltip (tooltip);
+    selector->addListener (this);
+    addAndMakeVisible (selector);
+
+    return selector;
+}
+
+
+void BandPowerEditor::labelTextChanged (Label* label)
+{
+    if (label != bandsValue)
+        return;
+
+    BandPower* processor = static_cast<BandPower*> (getProcessor());
+
+    // an invalid list leaves the bands as they were
+    if (processor->setBands (label->getText()))
+        CoreServices::updateSignalChain (this);
+    else
+        CoreServices::sendStatusMessage ("Invalid bands, expected e.g. 6-10, 30-80");
+
+    label->setText (processor->getBandList(), dontSendNotification);
+}
+
+
+void BandPowerEditor::comboBoxChanged (ComboBox* comboBox)
+{
+    if (comboBox == frameRateSelector)
+        getProcessor()->setParameter (0, float (frameRateSelector->getSelectedId()));
+    else if (comboBox == windowSelector)
+        getProcessor()->setParameter (1, float (windowSelector->getSelectedId()));
+    else if (comboBox == outputSelector)
+        getProcessor()->setParameter (2, float (outputSelector->getSelectedId() - 1));
+    else
+        return;
+
+    // the band channels downstream change rate, bins or units
+    CoreServices::updateSignalChain (this);
+}
+
+
+void BandPowerEditor::startAcquisition()
+{
+    bandsValue->setEnabled (false);
+    frameRateSelector->setEnabled (false);
+    windowSelector->setEnabled (false);
+    outputSelector->setEnabled (false);
+}
+
+
+void BandPowerEditor::stopAcquisition()
+{
+    bandsValue->setEnabled (true);
+    frameRateSelector->setEnabled (true);
+    windowSelector->setEnabled (true);
+    outputSelector->setEnabled (true);
+}
+
+
+void BandPowerEditor::saveCustomParameters (XmlElement* xml)
+{
+    xml->setAttribute ("Type", "BandPowerEditor");
+
+    XmlElement* values = xml->createNewChildElement ("VALUES");
+    values->setAttribute ("Bands", static_cast<BandPower*> (getProcessor())->getBandList());
+    values->setAttribute ("FrameRate", frameRateSelector->getSelectedId());
+    values->setAttribute ("Window", windowSelector->getSelectedId());
+    values->setAttribute ("Output", outputSelector->getSelectedId() - 1);
+}
+
+
+void BandPowerEditor::loadCustomParameters (XmlElement* xml)
+{
+    BandPower* processor = static_cast<BandPower*> (getProcessor());
+
+    forEachXmlChildElement (*xml, xmlNode)
+    {
+        if (xmlNode->hasTagName ("VALUES"))
+        {
+            // the signal chain is updated once the whole configuration is loaded
+            processor->setBands (xmlNode->getStringAttribute ("Bands", BANDPOWER_DEFAULT_BANDS));
+            bandsValue->setText (processor->getBandList(), dontSendNotification);
+
+            const int rate = xmlNode->getIntAttribute ("FrameRate", BANDPOWER_DEFAULT_FRAME_RATE);
+            frameRateSelector->setSelectedId (frameRateSelector->indexOfItemId (rate) >= 0 ? rate : BANDPOWER_DEFAULT_FRAME_RATE,
+                                              dontSendNotification);
+            processor->setParameter (0, float (frameRateSelector->getSelectedId()));
+
+            const int window = xmlNode->getIntAttribute ("Window", BANDPOWER_DEFAULT_WINDOW_MS);
+            windowSelector->setSelectedId (windowSelector->indexOfItemId (window) >= 0 ? window : BANDPOWER_DEFAULT_WINDOW_MS,
+                                           dontSendNotification);
+            processor->setParameter (1, float (windowSelector->getSelectedId()));
+
+            const int output = xmlNode->getIntAttribute ("Output", BandPower::POWER_OUTPUT) + 1;
+            outputSelector->setSelectedId (outputSelector->indexOfItemId (output) >= 0 ? output : BandPower::POWER_OUTPUT + 1,
+                                           dontSendNotification);
+            processor->setParameter (2, float (outputSelector->getSelectedId() - 1));
+        }
+    }
+}
@@ -0,0 +1,69 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef BANDPOWEREDITOR_H_INCLUDED
+#define BANDPOWEREDITOR_H_INCLUDED
+
+
+#include <EditorHeaders.h>
+
+
+/**
+    User interface for the Band Power, setting the bands, the frame rate, the window and
+    what is output for each band.
+
+    @see BandPower
+*/
+class BandPowerEditor : public GenericEditor
+                      , public ComboBox::Listener
+                      , public Label::Listener
+{
+public:
+    BandPowerEditor (GenericProcessor* parentNode, bool useDefaultParameterEditors);
+    ~BandPowerEditor();
+
+    void comboBoxChanged (ComboBox* comboBox) override;
+    void labelTextChanged (Label* label) override;
+
+    void startAcquisition() override;
+    void stopAcquisition() override;
+
+    void saveCustomParameters (XmlElement* xml) override;
+    void loadCustomParameters (XmlElement* xml) override;
+
+
+private:
+    /** Adds a label and, below it, a combo box */
+    ComboBox* addSelector (const String& name, int x, int y, const String& tooltip);
+
+    OwnedArray<Label>       labels;
+    ScopedPointer<Label>    bandsValue;
+    ScopedPointer<ComboBox> frameRateSelector;
+    ScopedPointer<ComboBox> windowSelector;
+    ScopedPointer<ComboBox> outputSelector;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BandPowerEditor);
+};
+
+
+#endif  // BANDPOWEREDITOR_H_INCLUDED
@@ -32,6 +32,7 @@ SpikeDetector::SpikeDetector()
       overflowBufferSize    (100)
     , currentElectrode      (-1)
     , uniqueID              (0)
+    , thresholdMultiplier   (0.0f)
 {
     setProcessorType (PROCESSOR_TYPE_FILTER);
 
@@ -83,6 +84,11 @@ AudioProcessorEditor* SpikeDetector::createEditor()
 
 void SpikeDetector::createSpikeChannels()
 {
+	int maxChannels = 1;
+	for (int i = 0; i < electrodes.size(); ++i)
+		maxChannels = jmax(maxChannels, electrodes[i]->numChannels);
+	spikeFeatures.malloc(maxChannels * SPIKE_FEATURES_PER_CHANNEL);
+
 	for (int i = 0; i < electrodes.size(); ++i)
 	{
 		SimpleElectrode* elec = electrodes[i];
@@ -100,6 +106,7 @@ void SpikeDetector::createSpikeChannels()
 		}
 		SpikeChannel* spk = new SpikeChannel(SpikeChannel::typeFromNumChannels(nChans), this, chans);
 		spk->setNumSamples(elec->prePeakSamples, elec->postPeakSamples);
+		spk->addEventMetaData(SpikeFeatures::createDescriptor(nChans));
 		spikeChannelArray.add(spk);
 	}
 }
@@ -171,6 +178,7 @@ bool SpikeDetector::addElectrode (int nChans, int electrodeID)
         *(newElectrode->channels + i) = firstChan+i;
         *(newElectrode->thresholds + i) = getDefaultThreshold();
         *(newElectrode->isActive + i) = true;
+        newElectrode->noiseEstimators.add (new NoiseEstimator());
     }
 
     if (electrodeID > 0) 
@@ -321,6 +329,24 @@ double SpikeDetector::getChannelThreshold(int electrodeNum, int channelNum) cons
 }
 
 
+void SpikeDetector::setThresholdMultiplier (float multiplier)
+{
+    thresholdMultiplier = jmax (0.0f, multiplier);
+}
+
+
+float SpikeDetector::getThresholdMultiplier() const
+{
+    return thresholdMultiplier;
+}
+
+
+float SpikeDetector::getChannelNoiseLevel (int electrodeNum, int channelNum) const
+{
+    return electrodes[electrodeNum]->noiseEstimators[channelNum]->getNoiseLevel();
+}
+
+
 void SpikeDetector::setParameter (int parameterIndex, float newValue)
 {
     //editor->updateParameterButtons(parameterIndex);
@@ -346,8 +372,18 @@ bool SpikeDetector::enable()
     useOverflowBuffer.clear();
 
     for (int i = 0; i < electrodes.size(); ++i)
+    {
         useOverflowBuffer.add (false);
 
+        for (int j = 0; j < electrodes[i]->numChannels; ++j)
+        {
+            const DataChannel* channel = getDataChannel (*(electrodes[i]->channels + j));
+
+            if (channel != nullptr)
+                electrodes[i]->noiseEstimators[j]->setSampleRate (channel->getSampleRate());
+        }
+    }
+
     return true;
 }
 
@@ -414,77 +450,96 @@ void SpikeDetector::process (AudioSampleBuffer& buffer)
 
         electrode = electrodes[i];
 
-        // refresh buffer index for this electrode
-        sampleIndex = electrode->lastBufferIndex - 1; // subtract 1 to account for
-        // increment at start of getNextSample()
-
         const int nSamples = getNumSamples (*electrode->channels);
 
-        // cycle through samples
-        while (samplesAvailable (nSamples))
-        {
-            ++sampleIndex;
+        // samples are searched from the electrode's buffer index up to this one
+        const int lastIndex = nSamples - overflowBufferSize / 2 + 1;
+
+        thresholdDetector.setNumChannels (electrode->numChannels);
 
-            // cycle through channels
-            for (int chan = 0; chan < electrode->numChannels; ++chan)
+        for (int chan = 0; chan < electrode->numChannels; ++chan)
+        {
+            if (*(electrode->isActive + chan))
             {
-                // std::cout << "  channel " << chan << std::endl;
-                if (*(electrode->isActive + chan))
-                {
-                    int currentChannel = *(electrode->channels + chan);
+                const int currentChannel = *(electrode->channels + chan);
+                NoiseEstimator* noiseEstimator = electrode->noiseEstimators[chan];
 
-                    if (-getNextSample (currentChannel) > *(electrode->thresholds + chan)) // trigger spike
-                    {
-                        //std::cout << "Spike detected on electrode " << i << std::endl;
-                        // find the peak
-                        int peakIndex = sampleIndex;
-
-                        while (-getCurrentSample(currentChannel) < -getNextSample(currentChannel)
-                               && sampleIndex < peakIndex + electrode->postPeakSamples)
-                        {
-                            ++sampleIndex;
-                        }
-
-                        peakIndex = sampleIndex;
-                        sampleIndex -= (electrode->prePeakSamples + 1);
-
-						const SpikeChannel* spikeChan = getSpikeChannel(i);
-						SpikeEvent::SpikeBuffer spikeData(spikeChan);
-						Array<float> thresholds;
-						for (int channel = 0; channel < electrode->numChannels; ++channel)
-						{
-							addWaveformToSpikeObject(spikeData,
-								peakIndex,
-								i,
-								channel);
-							thresholds.add((int)*(electrode->thresholds + channel));
-						}
-						int64 timestamp = getTimestamp(electrode->channels[0]) + peakIndex;
-						SpikeEventPtr newSpike = SpikeEvent::createSpikeEvent(spikeChan, timestamp, thresholds, spikeData, 0);
-
-                        // package spikes;
-                        
-						addSpike(spikeChan, newSpike, peakIndex);
-
-
-                        // advance the sample index
-                        sampleIndex = peakIndex + electrode->postPeakSamples;
-
-                        // quit spike "for" loop
-                        break;
-
-                    // end spike trigger
-                    }
+                noiseEstimator->pushSamples (buffer.getReadPointer (currentChannel), getNumSamples (currentChannel));
 
-                // end if channel is active
-                }
+                if (thresholdMultiplier > 0 && noiseEstimator->isReady())
+                    *(electrode->thresholds + chan) = thresholdMultiplier * noiseEstimator->getNoiseLevel();
 
-            // end cycle through channels on electrode
+                // a spike is triggered where -sample > threshold
+                thresholdDetector.setChannel (chan,
+                                              overflowBuffer.getReadPointer (currentChannel), overflowBufferSize,
+                                              buffer.getReadPointer (currentChannel), getNumSamples (currentChannel),
+                                              -*(electrode->thresholds + chan), ThresholdDetector::BELOW);
             }
+        }
+
+        int nextIndex = electrode->lastBufferIndex;
+        int crossingIndex, crossingChannel;
+
+        // jump from one threshold crossing to the next
+        while (nextIndex <= lastIndex
+               && thresholdDetector.findNextCrossing (nextIndex, lastIndex, crossingIndex, crossingChannel))
+        {
+            sampleIndex = crossingIndex;
+
+            int currentChannel = *(electrode->channels + crossingChannel);
+
+            //std::cout << "Spike detected on electrode " << i << std::endl;
+            // find the peak
+            int peakIndex = sampleIndex;
+
+            while (-getCurrentSample(currentChannel) < -getNextSample(currentChannel)
+                   && sampleIndex < peakIndex + electrode->postPeakSamples)
+            {
+                ++sampleIndex;
+            }
+
+            peakIndex = sampleIndex;
+            sampleIndex -= (electrode->prePeakSamples + 1);
+
+			const SpikeChannel* spikeChan = getSpikeChannel(i);
+			SpikeEvent::SpikeBuffer spikeData(spikeChan);
+			Array<float> thresholds;
+			const int spikeLength = electrode->prePeakSamples + electrode->postPeakSamples;
+			for (int channel = 0; channel < electrode->numChannels; ++channel)
+			{
+				const int chan = *(electrode->channels + channel);
+
+				// the waveforms nearly always lie within the block, and are then copied whole
+				if (sampleIndex >= 0 && sampleIndex + spikeLength <= (int) getNumSamples(chan) && isChannelActive(i, channel))
+					spikeData.set(channel, buffer.getReadPointer(chan, sampleIndex), spikeLength);
+				else
+					addWaveformToSpikeObject(spikeData,
+						peakIndex,
+						i,
+						channel);
+				thresholds.add((int)*(electrode->thresholds + channel));
+			}
+			int64 timestamp = getTimestamp(electrode->channels[0]) + peakIndex;
+
+			// computed once here for every consumer downstream
+			SpikeFeatures::compute(spikeData.getRawPointer(), electrode->numChannels, spikeChan->getTotalSamples(), spikeFeatures);
+			MetaDataValueArray md;
+			md.add(new MetaDataValue(MetaDataDescriptor::FLOAT, electrode->numChannels * SPIKE_FEATURES_PER_CHANNEL, spikeFeatures.getData()));
+			SpikeEventPtr newSpike = SpikeEvent::createSpikeEvent(spikeChan, timestamp, thresholds, spikeData, 0, md);
+
+            // package spikes;
+            
+			addSpike(spikeChan, newSpike, peakIndex);
 
-        // end cycle through samples
+
+            // advance the sample index
+            sampleIndex = peakIndex + electrode->postPeakSamples;
+            nextIndex = sampleIndex + 1;
         }
 
+        // the last sample searched, searched again with the next buffer
+        sampleIndex = jmax (nextIndex, lastIndex + 1) - 1;
+
         electrode->lastBufferIndex = sampleIndex - nSamples; // should be negative
 
         if (nSamples > overflowBufferSize)
@@ -546,19 +601,6 @@ float SpikeDetector::getCurrentSample (int& chan)
 }
 
 
-bool SpikeDetector::samplesAvailable (int nSamples)
-{
-    if (sampleIndex > nSamples - overflowBufferSize/2)
-    {
-        return false;
-    }
-    else
-    {
-        return true;
-    }
-}
-
-
 void SpikeDetector::saveCustomParametersToXml (XmlElement* parentElement)
 {
     for (int i = 0; i < electrodes.size(); ++i)
@@ -578,6 +620,9 @@ void SpikeDetector::saveCustomParametersToXml (XmlElement* parentElement)
             channelNode->setAttribute ("isActive",  *(electrodes[i]->isActive + j));
         }
     }
+
+    XmlElement* thresholdNode = parentElement->createNewChildElement ("ADAPTIVE_THRESHOLD");
+    thresholdNode->setAttribute ("multiplier", thresholdMultiplier);
 }
 
 
@@ -623,6 +668,10 @@ void SpikeDetector::loadCustomParametersFromXml()
                     }
                 }
             }
+            else if (xmlNode->hasTagName ("ADAPTIVE_THRESHOLD"))
+            {
+                setThresholdMultiplier ((float) xmlNode->getDoubleAttribute ("multiplier"));
+            }
         }
 
         sde->checkSettings();
@@ -25,6 +25,7 @@
 #define __SPIKEDETECTOR_H_3F920F95__
 
 #include <ProcessorHeaders.h>
+#include <SpikeLib.h>
 #include "SpikeDetectorEditor.h"
 
 
@@ -44,6 +45,9 @@ struct SimpleElectrode
     HeapBlock<int> channels;
     HeapBlock<double> thresholds;
     HeapBlock<bool> isActive;
+
+    /** The noise level of each channel, which adaptive thresholds follow */
+    OwnedArray<NoiseEstimator> noiseEstimators;
 };
 
 
@@ -143,6 +147,14 @@ public:
 
     double getChannelThreshold (int electrodeNum, int channelNum) const;
 
+    /** Makes every active channel's threshold follow this multiple of its noise level,
+        median(|x|) / 0.6745, or keeps the thresholds set by hand if 0. */
+    void setThresholdMultiplier (float multiplier);
+    float getThresholdMultiplier() const;
+
+    /** Returns the noise level of a channel, or 0 until enough samples were seen */
+    float getChannelNoiseLevel (int electrodeNum, int channelNum) const;
+
 
 private:
 
@@ -150,7 +162,6 @@ private:
 
     float getNextSample (int& chan);
     float getCurrentSample (int& chan);
-    bool samplesAvailable (int nSamples);
 
       void addWaveformToSpikeObject (SpikeEvent::SpikeBuffer& s,
                                    int& peakIndex,
@@ -175,6 +186,14 @@ private:
     OwnedArray<SimpleElectrode> electrodes;
     int uniqueID;
 
+    /** Finds the threshold crossings of the electrode being processed */
+    ThresholdDetector thresholdDetector;
+
+    /** The features of the spike being created, sent along as its metadata */
+    HeapBlock<float> spikeFeatures;
+
+    float thresholdMultiplier;
+
     // void createSpikeEvent(int& peakIndex,
     // 					  int& electrodeNumber,
     // 					  int& currentChannel,
@@ -112,6 +112,12 @@ SpikeDetectorEditor::SpikeDetectorEditor(GenericProcessor* parentNode, bool useD
     Array<double> v;
     thresholdSlider->setValues(v);
 
+    autoThresholdButton = new ElectrodeEditorButton("AUTO",font);
+    autoThresholdButton->addListener(this);
+    autoThresholdButton->setTooltip("Thresholds following a multiple of each channel's noise level");
+    addAndMakeVisible(autoThresholdButton);
+    autoThresholdButton->setBounds(240,25,40,10);
+
     thresholdLabel = new Label("Name","Threshold");
     font.setHeight(10);
     thresholdLabel->setFont(font);
@@ -363,6 +369,11 @@ void SpikeDetectorEditor::buttonEvent(Button* button)
 
         return;
     }
+    else if (button == autoThresholdButton)
+    {
+        showAutoThresholdMenu();
+        return;
+    }
     else if (button == electrodeEditorButtons[2])   // DELETE
     {
         if (acquisitionIsActive)
@@ -541,8 +552,31 @@ void SpikeDetectorEditor::comboBoxChanged(ComboBox* comboBox)
     thresholdSlider->setActive(false);
 }
 
+void SpikeDetectorEditor::showAutoThresholdMenu()
+{
+    SpikeDetector* processor = (SpikeDetector*) getProcessor();
+    const float multiplier = processor->getThresholdMultiplier();
+
+    PopupMenu menu;
+    menu.addItem(1, "Set by hand", true, multiplier == 0);
+
+    for (int k = 3; k <= 6; k++)
+        menu.addItem(k, String(k) + " x noise level", true, multiplier == k);
+
+    const int result = menu.show();
+
+    if (result > 0)
+    {
+        processor->setThresholdMultiplier(result == 1 ? 0.0f : (float) result);
+        autoThresholdButton->setToggleState(result != 1, dontSendNotification);
+    }
+}
+
 void SpikeDetectorEditor::checkSettings()
 {
+    SpikeDetector* processor = (SpikeDetector*) getProcessor();
+    autoThresholdButton->setToggleState(processor->getThresholdMultiplier() > 0, dontSendNotification);
+
     electrodeList->setSelectedId(0);
     drawElectrodeButtons(0);
 
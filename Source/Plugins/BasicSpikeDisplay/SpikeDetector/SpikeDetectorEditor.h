@@ -70,6 +70,9 @@ private:
 
     void drawElectrodeButtons(int);
 
+    /** Lets the user pick the multiple of the noise level thresholds follow */
+    void showAutoThresholdMenu();
+
     ComboBox* electrodeTypes;
     ComboBox* electrodeList;
     Label* numElectrodes;
@@ -77,6 +80,7 @@ private:
     TriangleButton* upButton;
     TriangleButton* downButton;
     UtilityButton* plusButton;
+    ElectrodeEditorButton* autoThresholdButton;
 
     ThresholdSlider* thresholdSlider;
 
@@ -22,6 +22,7 @@
 */
 
 #include "SpikeDisplayCanvas.h"
+#include <SpikeLib.h>
 
 
 SpikeDisplayCanvas::SpikeDisplayCanvas(SpikeDisplayNode* n) :
@@ -867,14 +868,15 @@ WaveAxes::WaveAxes(int channel) : GenericAxes(channel),
     drawGrid(true),
     displayThresholdLevel(0.0f),
     detectorThresholdLevel(0.0f),
-    spikesReceivedSinceLastRedraw(0),
     spikeIndex(0),
     bufferSize(5),
     range(250.0f),
     isOverThresholdSlider(false),
     isDraggingThresholdSlider(false),
     thresholdCoordinator(nullptr),
-    spikesInverted(false)
+    spikesInverted(false),
+    waveImageIsValid(false),
+    lastFadeTime(Time::currentTimeMillis())
 
 {
 
@@ -896,10 +898,17 @@ void WaveAxes::setRange(float r)
     std::cout << "Setting range to " << r << std::endl;
 
     range = r;
+    waveImageIsValid = false;
 
     repaint();
 }
 
+void WaveAxes::resized()
+{
+    waveImage = Image(Image::ARGB, jmax(1, getWidth()), jmax(1, getHeight()), true);
+    waveImageIsValid = false;
+}
+
 void WaveAxes::paint(Graphics& g)
 {
     g.setColour(Colours::black);
@@ -923,23 +932,63 @@ void WaveAxes::paint(Graphics& g)
     }
 
 
-    for (int spikeNum = 0; spikeNum < bufferSize; spikeNum++)
+    updateWaveImage();
+
+    g.drawImageAt(waveImage, 0, 0);
+
+}
+
+void WaveAxes::updateWaveImage()
+{
+    OwnedArray<SpikeEvent> newSpikes;
+
+    {
+        const TraceRecorder::ScopedTracedLock<CriticalSection> sl(pendingSpikesLock, "Wait for pending spikes");
+        newSpikes.swapWith(pendingSpikes);
+    }
+
+    if (waveImage.isNull())
+        resized();
+
+    const int64 now = Time::currentTimeMillis();
+
+    Graphics g(waveImage);
+
+    if (!waveImageIsValid)
     {
+        // the recent spikes, oldest first
+        waveImage.clear(waveImage.getBounds());
+
+        for (int n = 1; n <= bufferSize; n++)
+            plotSpike(spikeBuffer[(spikeIndex + n) % bufferSize], g);
 
-        if (spikeNum != spikeIndex)
+        waveImageIsValid = true;
+        lastFadeTime = now;
+    }
+    else
+    {
+        const int fades = (int) ((now - lastFadeTime) / SPIKE_FADE_INTERVAL_MS);
+
+        if (fades > 0)
         {
-            g.setColour(Colours::grey);
-            plotSpike(spikeBuffer[spikeNum], g);
+            waveImage.multiplyAllAlphas(std::pow(WAVE_FADE_FACTOR, (float) fades));
+            lastFadeTime += fades * SPIKE_FADE_INTERVAL_MS;
         }
-
     }
 
-    
-    plotSpike(spikeBuffer[spikeIndex], g);
+    for (int n = 0; n < newSpikes.size(); n++)
+    {
+        SpikeEvent* spike = newSpikes.getUnchecked(n);
 
+        plotSpike(spike, g);
 
-    spikesReceivedSinceLastRedraw = 0;
+        spikeIndex++;
+        spikeIndex %= bufferSize;
+
+        spikeBuffer.set(spikeIndex, spike);
+    }
 
+    newSpikes.clear(false); // now owned by spikeBuffer
 }
 
 void WaveAxes::plotSpike(const SpikeEvent* s, Graphics& g)
@@ -956,7 +1005,7 @@ void WaveAxes::plotSpike(const SpikeEvent* s, Graphics& g)
 	//if (s.sortedId > 0)
     //   g.setColour(Colour(s.color[0],s.color[1],s.color[2]));
     //else
-       g.setColour(Colours::white);
+       g.setColour(Colours::white.withAlpha(0.8f)); // blended over the older spikes
 
     // type corresponds to channel so we need to calculate the starting
     // sample based upon which channel is getting plotted
@@ -1051,19 +1100,11 @@ bool WaveAxes::updateSpikeData(const SpikeEvent* s)
         gotFirstSpike = true;
     }
 
-    if (spikesReceivedSinceLastRedraw < bufferSize)
-    {
+    const TraceRecorder::ScopedTracedLock<CriticalSection> sl(pendingSpikesLock, "Wait for pending spikes");
 
-        SpikeEvent* newSpike = new SpikeEvent(*s);
-
-        spikeIndex++;
-        spikeIndex %= bufferSize;
-
-        spikeBuffer.set(spikeIndex, newSpike);
-
-        spikesReceivedSinceLastRedraw++;
-
-    }
+    // no more spikes are kept in between two paints than are drawn
+    if (pendingSpikes.size() < bufferSize)
+        pendingSpikes.add(new SpikeEvent(*s));
 
     return true;
 
@@ -1093,6 +1134,11 @@ bool WaveAxes::checkThreshold(const SpikeEvent* s)
 void WaveAxes::clear()
 {
 
+    {
+        const ScopedLock sl(pendingSpikesLock);
+        pendingSpikes.clear();
+    }
+
     spikeBuffer.clear();
     spikeIndex = 0;
 
@@ -1101,6 +1147,8 @@ void WaveAxes::clear()
         spikeBuffer.add(nullptr);
     }
 
+    waveImageIsValid = false;
+
     repaint();
 }
 
@@ -1234,10 +1282,11 @@ void WaveAxes::setDisplayThreshold(float threshold)
 
 // --------------------------------------------------
 
-ProjectionAxes::ProjectionAxes(int projectionNum) : GenericAxes(projectionNum), imageDim(500),
+ProjectionAxes::ProjectionAxes(int projectionNum) : GenericAxes(projectionNum), lastFadeTime(Time::currentTimeMillis()), imageDim(500),
     rangeX(250), rangeY(250), spikesReceivedSinceLastRedraw(0)
 {
     projectionImage = Image(Image::RGB, imageDim, imageDim, true);
+    pendingPeaks.ensureStorageAllocated(MAX_PENDING_PEAKS);
 
     clear();
     //Graphics g(projectionImage);
@@ -1264,6 +1313,8 @@ void ProjectionAxes::paint(Graphics& g)
     //g.setColour(Colours::orange);
     //g.fillRect(5,5,getWidth()-5, getHeight()-5);
 
+    drawPendingPeaks();
+
     g.drawImage(projectionImage,
                 0, 0, getWidth(), getHeight(),
                 0, imageDim-rangeY, rangeX, rangeY);
@@ -1276,24 +1327,55 @@ bool ProjectionAxes::updateSpikeData(const SpikeEvent* s)
         gotFirstSpike = true;
     }
 
-    int idx1, idx2;
-    calcWaveformPeakIdx(s, ampDim1, ampDim2, &idx1, &idx2);
+    // the peaks come with the spike's features when the processor creating it computed them,
+    // and are otherwise found here (electrodes have at most four channels)
+    float workspace[4 * SPIKE_FEATURES_PER_CHANNEL];
+    const float* features = SpikeFeatures::getFeatures(s, SpikeFeatures::findFeatures(s->getChannelInfo()), workspace);
+    const float peak1 = features[ampDim1 * SPIKE_FEATURES_PER_CHANNEL + SpikeFeatures::PEAK];
+    const float peak2 = features[ampDim2 * SPIKE_FEATURES_PER_CHANNEL + SpikeFeatures::PEAK];
 
-    // add peaks to image
-    Colour col;
+    // the peaks are added to the image when painting, on the message thread
+    const ScopedLock sl(pendingPeaksLock);
 
-	//Again, fix this adding proper metadata check
-    //if (s.sortedId > 0)
-    //    col = Colour(s.color[0], s.color[1], s.color[2]);
-    //else
-        col = Colours::white;
-
-	const float* data = s->getDataPointer();
-    updateProjectionImage(data[idx1], data[idx2], 1, col);
+    if (pendingPeaks.size() < MAX_PENDING_PEAKS)
+        pendingPeaks.add(Point<float>(peak1, peak2));
 
     return true;
 }
 
+void ProjectionAxes::drawPendingPeaks()
+{
+    const int64 now = Time::currentTimeMillis();
+    const int fades = (int) ((now - lastFadeTime) / SPIKE_FADE_INTERVAL_MS);
+
+    if (fades > 0)
+    {
+        // older peaks fade into the background
+        Graphics g(projectionImage);
+        g.fillAll(Colours::black.withAlpha(jmin(1.0f, fades * PROJECTION_FADE_ALPHA)));
+
+        lastFadeTime += fades * SPIKE_FADE_INTERVAL_MS;
+    }
+
+    const ScopedLock sl(pendingPeaksLock);
+
+    for (int n = 0; n < pendingPeaks.size(); n++)
+    {
+        // add peaks to image
+        Colour col;
+
+        //Again, fix this adding proper metadata check
+        //if (s.sortedId > 0)
+        //    col = Colour(s.color[0], s.color[1], s.color[2]);
+        //else
+            col = Colours::white;
+
+        updateProjectionImage(pendingPeaks.getReference(n).x, pendingPeaks.getReference(n).y, 1, col);
+    }
+
+    pendingPeaks.clearQuick();
+}
+
 void ProjectionAxes::updateProjectionImage(float x, float y, float gain, Colour col)
 {
     Graphics g(projectionImage);
@@ -1311,33 +1393,13 @@ void ProjectionAxes::updateProjectionImage(float x, float y, float gain, Colour
 
 }
 
-void ProjectionAxes::calcWaveformPeakIdx(const SpikeEvent* s, int d1, int d2, int* idx1, int* idx2)
+void ProjectionAxes::clear()
 {
-
-    float max1 = -1*pow(2.0,15);
-    float max2 = max1;
-	int nSamples = s->getChannelInfo()->getTotalSamples();
-	const float* data = s->getDataPointer();
-
-    for (int i = 0; i < nSamples; i++)
     {
-        if (data[d1*nSamples + i] > max1)
-        {
-            *idx1 = d1*nSamples+i;
-            max1 = data[*idx1];
-        }
-        if (data[d2*nSamples+i] > max2)
-        {
-            *idx2 = d2*nSamples+i;
-            max2 = data[*idx2];
-        }
+        const ScopedLock sl(pendingPeaksLock);
+        pendingPeaks.clearQuick();
     }
-}
 
-
-
-void ProjectionAxes::clear()
-{
     projectionImage.clear(Rectangle<int>(0, 0, projectionImage.getWidth(), projectionImage.getHeight()),
                           Colours::black);
 
@@ -48,6 +48,11 @@
 #define MAX_NUMBER_OF_SPIKE_SOURCES 128
 #define MAX_N_CHAN 4
 
+#define SPIKE_FADE_INTERVAL_MS 100      // how often the plotted spikes are dimmed
+#define WAVE_FADE_FACTOR 0.85f          // the waveforms left after each dim pass
+#define PROJECTION_FADE_ALPHA 0.012f    // the black laid over the projections at each dim pass
+#define MAX_PENDING_PEAKS 256           // per projection, in between two paints
+
 class SpikeDisplayNode;
 
 class SpikeDisplay;
@@ -328,6 +333,7 @@ public:
     bool checkThreshold(const SpikeEvent* spike);
 
     void paint(Graphics& g);
+    void resized();
 
     void plotSpike(const SpikeEvent* s, Graphics& g);
 
@@ -356,11 +362,16 @@ public:
     void invertSpikes(bool shouldInvert)
     {
         spikesInverted = shouldInvert;
+        waveImageIsValid = false;
         repaint();
     }
 
 private:
 
+    /** Draws the spikes received since the last paint onto waveImage, after fading the older
+        ones, or redraws the recent spikes if the image is no longer valid */
+    void updateWaveImage();
+
     Colour waveColour;
     Colour thresholdColour;
     Colour gridColour;
@@ -374,11 +385,14 @@ private:
 
     void drawThresholdSlider(Graphics& g);
 
-    int spikesReceivedSinceLastRedraw;
-
     Font font;
 
-   OwnedArray<SpikeEvent> spikeBuffer;
+   OwnedArray<SpikeEvent> spikeBuffer;      // the most recent spikes, only used by the message thread
+
+    // spikes are handed over by the processing thread and drawn onto waveImage when painting,
+    // so that each paint only draws the new ones
+    OwnedArray<SpikeEvent> pendingSpikes;
+    CriticalSection pendingSpikesLock;
 
     int spikeIndex;
     int bufferSize;
@@ -393,6 +407,10 @@ private:
 
     bool spikesInverted;
 
+    Image waveImage;
+    bool waveImageIsValid;
+    int64 lastFadeTime;
+
 };
 
 
@@ -425,11 +443,16 @@ private:
 
     void updateProjectionImage(float, float, float, Colour);
 
-    void calcWaveformPeakIdx(const SpikeEvent*, int, int, int*, int*);
+    /** Fades projectionImage and draws the peaks received since the last paint onto it */
+    void drawPendingPeaks();
 
     int ampDim1, ampDim2;
 
     Image projectionImage;
+    int64 lastFadeTime;
+
+    Array<Point<float> > pendingPeaks;      // handed over by the processing thread
+    CriticalSection pendingPeaksLock;
 
     Colour pointColour;
     Colour gridColour;
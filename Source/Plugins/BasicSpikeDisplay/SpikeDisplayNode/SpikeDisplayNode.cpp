@@ -23,6 +23,7 @@
 
 #include "SpikeDisplayNode.h"
 #include "SpikeDisplayCanvas.h"
+#include <SpikeLib.h>
 
 #include <stdio.h>
 
@@ -62,7 +63,11 @@ void SpikeDisplayNode::updateSettings()
 		elec->bitVolts = spikeChannelArray[i]->getChannelBitVolts(0); //lets assume all channels have the same bitvolts
 		elec->name = spikeChannelArray[i]->getName();
 		elec->currentSpikeIndex = 0;
-		elec->mostRecentSpikes.ensureStorageAllocated(displayBufferSize);
+		elec->numBufferedSpikes = 0;
+		elec->spikePlot = nullptr;
+
+		for (int j = 0; j < displayBufferSize; ++j)
+			elec->mostRecentSpikes.add(nullptr);
 
 		for (int j = 0; j < elec->numChannels; ++j)
 		{
@@ -172,10 +177,12 @@ void SpikeDisplayNode::setParameter (int param, float val)
     if (param == 0) // stop recording
     {
         isRecording = false;
+        updateIdleState();
     }
     else if (param == 1)   // start recording
     {
         isRecording = true;
+        updateIdleState();
     }
     else if (param == 2)   // redraw
     {
@@ -184,9 +191,21 @@ void SpikeDisplayNode::setParameter (int param, float val)
 }
 
 
+bool SpikeDisplayNode::isIdle() const
+{
+    const SpikeDisplayEditor* ed = (const SpikeDisplayEditor*) getEditor();
+
+    return ! isRecording && ed != nullptr && ! ed->isCanvasOpen();
+}
+
+
 void SpikeDisplayNode::process (AudioSampleBuffer& buffer)
 {
-    checkForEvents (true); // automatically calls 'handleEvent
+    // the spikes are read in place, one electrode at a time
+    const EventBlockIndex& events = getBlockEvents();
+
+    for (int i = 0; i < getNumElectrodes(); ++i)
+        handleElectrodeSpikes (i, events.getSpikes (i));
 
     if (redrawRequested)
     {
@@ -204,13 +223,16 @@ void SpikeDisplayNode::process (AudioSampleBuffer& buffer)
                 e->spikePlot->setDetectorThresholdForChannel (j, e->detectorThresholds[j]);
             }
 
-            // transfer buffered spikes to spike plot
-            for (int j = 0; j < e->currentSpikeIndex; ++j)
+            // transfer buffered spikes to spike plot, oldest first
+            const int first = e->currentSpikeIndex - e->numBufferedSpikes + displayBufferSize;
+
+            for (int j = 0; j < e->numBufferedSpikes; ++j)
             {
                 //std::cout << "Transferring spikes." << std::endl;
-                e->spikePlot->processSpikeObject (e->mostRecentSpikes[j]);
-                e->currentSpikeIndex = 0;
+                e->spikePlot->processSpikeObject (e->mostRecentSpikes[(first + j) % displayBufferSize]);
             }
+
+            e->numBufferedSpikes = 0;
         }
 
         redrawRequested = false;
@@ -218,57 +240,84 @@ void SpikeDisplayNode::process (AudioSampleBuffer& buffer)
 }
 
 
-void SpikeDisplayNode::handleSpike(const SpikeChannel* spikeInfo, const MidiMessage& event, int samplePosition)
+void SpikeDisplayNode::handleElectrodeSpikes (int electrodeIndex, const EventBlockIndex::Range& spikes)
 {
-	SpikeEventPtr newSpike = SpikeEvent::deserializeFromMessage(event, spikeInfo);
-	if (!newSpike) return;
+	if (spikes.isEmpty()) return;
 
-	int electrodeNum = getSpikeChannelIndex(newSpike);
+	Electrode* e = electrodes[electrodeIndex];
+	const SpikeChannel* spikeInfo = spikeChannelArray[electrodeIndex];
 
-	Electrode* e = electrodes[electrodeNum];
-	// std::cout << electrodeNum << std::endl;
+	e->blockSpikes.clearQuick();
 
-	bool aboveThreshold = false;
+	for (const BlockEvent& ev : spikes)
+		e->blockSpikes.add(&ev);
 
-	// update threshold / check threshold
-	for (int i = 0; i < e->numChannels; ++i)
+	// the detector thresholds are those of the latest spike
+	for (int j = e->blockSpikes.size() - 1; j >= 0; --j)
 	{
-		e->detectorThresholds.set(i, float(newSpike->getThreshold(i))); // / float(newSpike.gain[i]));
+		SpikeEventView latest(e->blockSpikes[j]->getData(), e->blockSpikes[j]->getDataSize(), spikeInfo);
 
-		aboveThreshold = aboveThreshold | checkThreshold(i, e->displayThresholds[i], newSpike);
+		if (latest.isValid())
+		{
+			for (int i = 0; i < e->numChannels; ++i)
+				e->detectorThresholds.set(i, float(latest.getThreshold(i))); // / float(latest.gain[i]));
+			break;
+		}
 	}
 
-	if (aboveThreshold)
+	// most spikes are below the display thresholds, and unless recording, only the latest
+	// displayBufferSize spikes above them need to be found, searching back from the end
+	e->keptSpikes.clearQuick();
+
+	for (int j = e->blockSpikes.size() - 1; j >= 0; --j)
 	{
+		if (!isRecording && e->keptSpikes.size() >= displayBufferSize)
+			break;
+
+		SpikeEventView newSpike(e->blockSpikes[j]->getData(), e->blockSpikes[j]->getDataSize(), spikeInfo);
+		if (!newSpike.isValid()) continue;
+
+		bool aboveThreshold = false;
+
+		for (int i = 0; i < e->numChannels && !aboveThreshold; ++i)
+			aboveThreshold = checkThreshold(i, e->displayThresholds[i], newSpike);
+
+		if (aboveThreshold)
+			e->keptSpikes.add(j);
+	}
+
+	// copied in order, so that spikes are recorded as they came and the ring ends with the latest
+	for (int k = e->keptSpikes.size() - 1; k >= 0; --k)
+	{
+		const BlockEvent* ev = e->blockSpikes[e->keptSpikes[k]];
+		SpikeEventPtr spikeCopy = SpikeEventView(ev->getData(), ev->getDataSize(), spikeInfo).createSpikeEvent();
+		if (!spikeCopy) continue;
+
 		// save spike
 		if (isRecording)
 		{
-			CoreServices::RecordNode::writeSpike(newSpike, spikeInfo);
+			CoreServices::RecordNode::writeSpike(spikeCopy, spikeInfo);
 		}
-		// add to buffer
-		if (e->currentSpikeIndex < displayBufferSize)
+
+		// add to buffer, replacing the oldest spike once full
+		if (k < displayBufferSize)
 		{
 			//This releases the spike from the smart pointer to avoid copies, so it's done latest.
-			e->mostRecentSpikes.set(e->currentSpikeIndex, newSpike.release());
-			e->currentSpikeIndex++;
+			e->mostRecentSpikes.set(e->currentSpikeIndex, spikeCopy.release());
+			e->currentSpikeIndex = (e->currentSpikeIndex + 1) % displayBufferSize;
+			e->numBufferedSpikes = jmin(e->numBufferedSpikes + 1, displayBufferSize);
 		}
-
-		
 	}
 }
 
 
-bool SpikeDisplayNode::checkThreshold (int chan, float thresh, SpikeEvent* s)
+bool SpikeDisplayNode::checkThreshold (int chan, float thresh, const SpikeEventView& s)
 {
-	int nSamples = getSpikeChannel(getSpikeChannelIndex(s))->getTotalSamples();
+	int nSamples = s.getChannelInfo()->getTotalSamples();
+	const float* samples = s.getDataPointer(chan);
 
-    for (int i = 0; i < nSamples-1; ++i)
-    {
-        if  (s->getDataPointer(chan)[i]  > thresh)
-        {
-            return true;
-        }
-    }
+	// four samples are compared at a time, the last sample being left out as before
+	const int last = nSamples - 1;
 
-    return false;
+	return last > 0 && ThresholdDetector::findFirstCrossing(samples, 0, last, thresh, ThresholdDetector::ABOVE) < last;
 }
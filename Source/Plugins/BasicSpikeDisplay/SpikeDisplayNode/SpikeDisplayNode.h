@@ -35,6 +35,11 @@ class SpikePlot;
   Takes in MidiEvents and extracts SpikeObjects from the MidiEvent buffers.
   Those Events are then held in a queue until they are pulled by the SpikeDisplayCanvas.
 
+  The spikes of each electrode are read in place from the block's event index, once per block.
+  Only the displayBufferSize most recent spikes above the display thresholds are kept for the
+  next redraw, so unless recording, the spikes copied depend on the refresh rate rather than on
+  the firing rate, earlier spikes of the block being skipped without their thresholds checked.
+
   @see GenericProcessor, SpikeDisplayEditor, SpikeDisplayCanvas
 */
 class SpikeDisplayNode :  public GenericProcessor
@@ -47,9 +52,13 @@ public:
 
     void process (AudioSampleBuffer& buffer) override;
 
-    void setParameter (int parameterIndex, float newValue) override;
+    /** Writes the spikes it shows while recording, so can only be skipped when not */
+    bool isDisplayOnly() const override { return ! isRecording; }
+
+    /** Idle unless recording or shown in a tab or window */
+    bool isIdle() const override;
 
-	void handleSpike(const SpikeChannel* spikeInfo, const MidiMessage& event, int samplePosition) override;
+    void setParameter (int parameterIndex, float newValue) override;
 
     void updateSettings() override;
 
@@ -66,23 +75,30 @@ public:
     void addSpikePlotForElectrode (SpikePlot* sp, int i);
     void removeSpikePlots();
 
-    bool checkThreshold (int, float, SpikeEvent*);
+    bool checkThreshold (int, float, const SpikeEventView&);
 
 
 private:
+    /** Records and buffers for display the block's spikes of one electrode */
+    void handleElectrodeSpikes (int electrodeIndex, const EventBlockIndex::Range& spikes);
+
     struct Electrode
     {
         String name;
 
         int numChannels;
         int recordIndex;
-        int currentSpikeIndex;
+        int currentSpikeIndex;      // next slot of mostRecentSpikes, used as a ring
+        int numBufferedSpikes;
 
         Array<float> displayThresholds;
         Array<float> detectorThresholds;
 
         OwnedArray<SpikeEvent> mostRecentSpikes;
 
+        Array<const BlockEvent*> blockSpikes;   // this block's spikes, reused
+        Array<int> keptSpikes;                  // those above threshold, latest first
+
 		float bitVolts;
 
         SpikePlot* spikePlot;
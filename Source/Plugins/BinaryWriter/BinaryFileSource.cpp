@@ -0,0 +1,383 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2017 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "BinaryFileSource.h"
+
+using namespace BinaryRecordingEngine;
+
+namespace
+{
+	/** Loads a NUMPY v1 file, returning the offset of its data and its header, or 0 if it isn't one */
+	size_t loadNpyFile(const File& file, MemoryBlock& contents, String& header)
+	{
+		if (!file.existsAsFile() || !file.loadFileAsData(contents) || contents.getSize() < 10)
+			return 0;
+
+		//magic, two version bytes and the little endian length of the text that follows
+		const uint8* bytes = static_cast<const uint8*>(contents.getData());
+		size_t dataStart = 10 + ByteOrder::littleEndianShort(bytes + 8);
+		if (bytes[0] != 0x93 || dataStart > contents.getSize())
+			return 0;
+
+		header = String::fromUTF8(reinterpret_cast<const char*>(bytes + 10), int(dataStart - 10));
+		return dataStart;
+	}
+}
+
+BinaryFileSource::BinaryFileSource() :
+	m_numChannels(0),
+	m_samplePos(0),
+	m_recordStart(0)
+{
+}
+
+BinaryFileSource::~BinaryFileSource()
+{
+}
+
+bool BinaryFileSource::Open(File file)
+{
+	m_file = file;
+	m_info = RecordInfo();
+	if (!readStructure(m_info))
+	{
+		std::cerr << "No structure.oebin entry found for " << file.getFullPathName() << std::endl;
+		return false;
+	}
+	m_numChannels = m_info.channels.size();
+
+	m_map = new MemoryMappedFile(file, MemoryMappedFile::readOnly);
+	if (m_map->getData() == nullptr)
+	{
+		std::cerr << "Could not map " << file.getFullPathName() << std::endl;
+		m_map = nullptr;
+		return false;
+	}
+
+	//a frame cut short by a crash is dropped
+	m_info.numSamples = int64(m_map->getSize()) / (int64(m_numChannels) * sizeof(int16));
+	readSegments();
+	return true;
+}
+
+void BinaryFileSource::readSegments()
+{
+	m_segmentStarts.clearQuick();
+	m_segmentTimestamps.clearQuick();
+	File segmentFile = m_file.getParentDirectory().getChildFile("segments.npy");
+	if (!segmentFile.existsAsFile())
+		return;
+
+	MemoryBlock contents;
+	if (!segmentFile.loadFileAsData(contents) || contents.getSize() < 10)
+		return;
+
+	//NUMPY v1 header: magic, two version bytes and the little endian length of the text that follows
+	const uint8* bytes = static_cast<const uint8*>(contents.getData());
+	size_t dataStart = 10 + ByteOrder::littleEndianShort(bytes + 8);
+	if (bytes[0] != 0x93 || dataStart > contents.getSize())
+		return;
+
+	//(first sample, timestamp) pairs. The count is taken from the size, so that a file left without its final header still reads
+	size_t numRecords = (contents.getSize() - dataStart) / (2 * sizeof(int64));
+	for (size_t i = 0; i < numRecords; i++)
+	{
+		int64 start = int64(ByteOrder::littleEndianInt64(bytes + dataStart + i * 2 * sizeof(int64)));
+		//the closing record points one past the last sample
+		if (start >= 0 && start < m_info.numSamples && (m_segmentStarts.size() == 0 || start > m_segmentStarts.getLast()))
+		{
+			m_segmentStarts.add(start);
+			m_segmentTimestamps.add(int64(ByteOrder::littleEndianInt64(bytes + dataStart + i * 2 * sizeof(int64) + sizeof(int64))));
+		}
+	}
+}
+
+bool BinaryFileSource::readStructure(RecordInfo& info) const
+{
+	//<recording>/continuous/<processor folder>/continuous.dat
+	File processorFolder = m_file.getParentDirectory();
+	File structureFile = processorFolder.getParentDirectory().getParentDirectory().getChildFile("structure.oebin");
+	if (!structureFile.existsAsFile())
+		return false;
+
+	var structure = JSON::parse(structureFile);
+	const Array<var>* continuous = structure["continuous"].getArray();
+	if (continuous == nullptr)
+		return false;
+
+	for (int i = 0; i < continuous->size(); i++)
+	{
+		const var& entry = continuous->getReference(i);
+		String folder = entry["folder_name"].toString().trimCharactersAtEnd("/");
+		if (folder.fromLastOccurrenceOf("/", false, false) != processorFolder.getFileName())
+			continue;
+
+		int numChannels = entry["num_channels"];
+		if (numChannels <= 0)
+			return false;
+
+		info.sampleRate = float(entry["sample_rate"]);
+		info.name = entry["source_processor_name"].toString() + " " + folder;
+		const Array<var>* channels = entry["channels"].getArray();
+		for (int c = 0; c < numChannels; c++)
+		{
+			RecordedChannelInfo chan;
+			chan.name = "CH" + String(c + 1);
+			chan.bitVolts = 1.0f;
+			if (channels != nullptr && c < channels->size())
+			{
+				chan.name = channels->getReference(c)["channel_name"].toString();
+				chan.bitVolts = float(channels->getReference(c)["bit_volts"]);
+			}
+			info.channels.add(chan);
+		}
+		return true;
+	}
+	return false;
+}
+
+void BinaryFileSource::fillRecordInfo()
+{
+	if (m_segmentStarts.size() < 2)
+	{
+		infoArray.add(m_info);
+		numRecords = 1;
+		return;
+	}
+
+	for (int i = 0; i < m_segmentStarts.size(); i++)
+	{
+		RecordInfo info = m_info;
+		int64 end = (i + 1 < m_segmentStarts.size()) ? m_segmentStarts[i + 1] : m_info.numSamples;
+		info.name = m_info.name + " segment " + String(i + 1);
+		info.numSamples = end - m_segmentStarts[i];
+		infoArray.add(info);
+	}
+	numRecords = m_segmentStarts.size();
+}
+
+void BinaryFileSource::updateActiveRecord()
+{
+	m_samplePos = 0;
+	m_recordStart = (m_segmentStarts.size() < 2) ? 0 : m_segmentStarts[activeRecord.get()];
+}
+
+void BinaryFileSource::fillEventInfo()
+{
+	//<recording>/continuous/<processor folder>/continuous.dat, with the events in <recording>/events/<event folder>
+	File recordingFolder = m_file.getParentDirectory().getParentDirectory().getParentDirectory();
+	var structure = JSON::parse(recordingFolder.getChildFile("structure.oebin"));
+	const Array<var>* events = structure["events"].getArray();
+	if (events == nullptr)
+		return;
+
+	readTimestampAnchors();
+	if (m_anchorSamples.size() == 0)
+		return;
+
+	for (int i = 0; i < events->size(); i++)
+	{
+		const var& entry = events->getReference(i);
+		String folder = entry["folder_name"].toString().trimCharactersAtEnd("/");
+		readEventFolder(recordingFolder.getChildFile("events").getChildFile(folder), entry);
+	}
+}
+
+void BinaryFileSource::readTimestampAnchors()
+{
+	m_anchorSamples.clearQuick();
+	m_anchorTimestamps.clearQuick();
+
+	//each window of a gated recording starts at a timestamp of its own
+	if (m_segmentStarts.size() > 0)
+	{
+		m_anchorSamples.addArray(m_segmentStarts);
+		m_anchorTimestamps.addArray(m_segmentTimestamps);
+		return;
+	}
+
+	File dataFolder = m_file.getParentDirectory();
+	MemoryBlock contents;
+	String header;
+
+	//(sample, timestamp) pairs where the timestamps jump, written instead of timestamps.npy
+	size_t dataStart = loadNpyFile(dataFolder.getChildFile("timestamp_discontinuities.npy"), contents, header);
+	if (dataStart > 0)
+	{
+		const uint8* bytes = static_cast<const uint8*>(contents.getData()) + dataStart;
+		size_t numPairs = (contents.getSize() - dataStart) / (2 * sizeof(int64));
+		for (size_t i = 0; i < numPairs; i++)
+		{
+			int64 sample = int64(ByteOrder::littleEndianInt64(bytes + i * 2 * sizeof(int64)));
+			if (m_anchorSamples.size() == 0 || sample > m_anchorSamples.getLast())
+			{
+				m_anchorSamples.add(sample);
+				m_anchorTimestamps.add(int64(ByteOrder::littleEndianInt64(bytes + i * 2 * sizeof(int64) + sizeof(int64))));
+			}
+		}
+		return;
+	}
+
+	//only the first timestamp is needed, so the file isn't loaded whole
+	FileInputStream stream(dataFolder.getChildFile("timestamps.npy"));
+	uint8 start[10];
+	if (stream.failedToOpen() || stream.read(start, 10) != 10 || start[0] != 0x93)
+		return;
+
+	int64 dataPos = 10 + ByteOrder::littleEndianShort(start + 8);
+	if (!stream.setPosition(dataPos) || stream.getTotalLength() < dataPos + int64(sizeof(int64)))
+		return;
+
+	m_anchorSamples.add(0);
+	m_anchorTimestamps.add(stream.readInt64());
+}
+
+bool BinaryFileSource::findEventSample(int64 timestamp, int& record, int64& sample) const
+{
+	//the last anchor at or before the timestamp
+	int anchor = int(std::upper_bound(m_anchorTimestamps.begin(), m_anchorTimestamps.end(), timestamp) - m_anchorTimestamps.begin()) - 1;
+	if (anchor < 0)
+		return false;
+
+	int64 position = m_anchorSamples[anchor] + (timestamp - m_anchorTimestamps[anchor]);
+	//between the windows of a gated recording, or past a jump of the timestamps
+	if (anchor + 1 < m_anchorSamples.size() && position >= m_anchorSamples[anchor + 1])
+		return false;
+
+	if (m_segmentStarts.size() < 2)
+	{
+		record = 0;
+		sample = position;
+	}
+	else
+	{
+		record = int(std::upper_bound(m_segmentStarts.begin(), m_segmentStarts.end(), position) - m_segmentStarts.begin()) - 1;
+		if (record < 0)
+			return false;
+		sample = position - m_segmentStarts[record];
+	}
+	return true;
+}
+
+void BinaryFileSource::readEventFolder(const File& folder, const var& info)
+{
+	bool isTTL = folder.getChildFile("channel_states.npy").existsAsFile();
+	File dataFile = folder.getChildFile(isTTL ? "channel_states.npy" : "text.npy");
+
+	MemoryBlock timestamps, data;
+	String timestampHeader, dataHeader;
+	size_t timestampStart = loadNpyFile(folder.getChildFile("timestamps.npy"), timestamps, timestampHeader);
+	size_t dataStart = loadNpyFile(dataFile, data, dataHeader);
+	if (timestampStart == 0 || dataStart == 0)
+		return;
+
+	//TTL states are int16, texts fixed size byte strings described as 'S<size>'
+	size_t itemBytes = sizeof(int16);
+	if (!isTTL)
+	{
+		String descr = dataHeader.fromFirstOccurrenceOf("'descr':", false, false).fromFirstOccurrenceOf("'", false, false).upToFirstOccurrenceOf("'", false, false);
+		if (!descr.startsWith("S") && !descr.startsWith("|S"))
+			return;
+		itemBytes = size_t(descr.fromFirstOccurrenceOf("S", false, false).getIntValue());
+		if (itemBytes == 0)
+			return;
+	}
+
+	size_t numEvents = jmin((timestamps.getSize() - timestampStart) / sizeof(int64), (data.getSize() - dataStart) / itemBytes);
+	const uint8* timestampBytes = static_cast<const uint8*>(timestamps.getData()) + timestampStart;
+	const char* dataBytes = static_cast<const char*>(data.getData()) + dataStart;
+
+	String name = info["channel_name"].toString();
+	if (name.isEmpty())
+		name = folder.getParentDirectory().getFileName() + " " + folder.getFileName();
+
+	int track = isTTL
+		? addEventTrack(RecordedEventTrack::TTL, name, jlimit(1, 64, int(info["num_channels"])))
+		: addEventTrack(RecordedEventTrack::TEXT, name, 1);
+
+	for (size_t i = 0; i < numEvents; i++)
+	{
+		int record;
+		int64 sample;
+		if (!findEventSample(int64(ByteOrder::littleEndianInt64(timestampBytes + i * sizeof(int64))), record, sample))
+			continue;
+
+		if (isTTL)
+		{
+			//(line + 1), negated when the line goes low
+			int state = int16(ByteOrder::littleEndianShort(dataBytes + i * itemBytes));
+			int line = std::abs(state) - 1;
+			if (line >= 0 && line < 64)
+			{
+				eventTracks.getReference(track).size = jmax(eventTracks[track].size, line + 1);
+				addTTLEvent(record, track, sample, line, state > 0);
+			}
+		}
+		else
+		{
+			const char* text = dataBytes + i * itemBytes;
+			addTextEvent(record, track, sample, String::fromUTF8(text, int(strnlen(text, itemBytes))));
+		}
+	}
+}
+
+void BinaryFileSource::seekTo(int64 sample)
+{
+	//an empty recording has no position to wrap around
+	const int64 numSamples = getActiveNumSamples();
+	m_samplePos = (numSamples > 0) ? sample % numSamples : 0;
+}
+
+const int16* BinaryFileSource::getMappedData(int64 sample, int64 nSamples)
+{
+	if (m_map == nullptr || sample < 0 || nSamples < 0 || sample + nSamples > getActiveNumSamples())
+		return nullptr;
+	return static_cast<const int16*>(m_map->getData()) + (m_recordStart + sample) * m_numChannels;
+}
+
+int BinaryFileSource::readData(int16* buffer, int nSamples)
+{
+	int samplesRead = int(jmin(int64(nSamples), getActiveNumSamples() - m_samplePos));
+	if (samplesRead <= 0)
+		return 0;
+	memcpy(buffer, getMappedData(m_samplePos, samplesRead), size_t(samplesRead) * m_numChannels * sizeof(int16));
+	m_samplePos += samplesRead;
+	return samplesRead;
+}
+
+void BinaryFileSource::processChannelData(int16* inBuffer, float* outBuffer, int channel, int64 numSamples)
+{
+	int n = m_numChannels;
+	float bitVolts = getChannelInfo(channel).bitVolts;
+
+	for (int i = 0; i < numSamples; i++)
+	{
+		*(outBuffer + i) = *(inBuffer + (n*i) + channel) * bitVolts;
+	}
+}
+
+void BinaryFileSource::processAllChannelsData(int16* inBuffer, float* const* outBuffers, int64 numSamples)
+{
+	deinterleaveChannels(inBuffer, outBuffers, activeBitVolts.getRawDataPointer(), m_numChannels, numSamples);
+}
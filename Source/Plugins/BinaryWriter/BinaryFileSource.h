@@ -0,0 +1,91 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2017 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef BINARYFILESOURCE_H
+#define BINARYFILESOURCE_H
+
+#include <FileSourceHeaders.h>
+
+namespace BinaryRecordingEngine
+{
+	/** Reads the uncompressed continuous.dat files of the Binary engine in the File Reader.
+
+	The file is memory-mapped, so seeking is only a change of position and the File Reader takes the
+	samples straight from the mapping through getMappedData. The interleaved int16 data has no header,
+	so the number of channels, along with their names and bit volts, comes from the structure.oebin file
+	of the recording. The windows of a gated recording, listed in its segments.npy file, are shown as
+	separate records.
+
+	The TTL and text events of the recording, in its events folder, become event tracks. Their timestamps
+	are turned into samples of the records through the first timestamp of the data, or the timestamp
+	discontinuities or segments it was written with.*/
+	class BinaryFileSource : public FileSource
+	{
+	public:
+		BinaryFileSource();
+		~BinaryFileSource();
+
+		int readData(int16* buffer, int nSamples) override;
+		void seekTo(int64 sample) override;
+		void processChannelData(int16* inBuffer, float* outBuffer, int channel, int64 numSamples) override;
+		void processAllChannelsData(int16* inBuffer, float* const* outBuffers, int64 numSamples) override;
+		const int16* getMappedData(int64 sample, int64 nSamples) override;
+
+	private:
+		bool Open(File file) override;
+		void fillRecordInfo() override;
+		void updateActiveRecord() override;
+		void fillEventInfo() override;
+
+		/** Fills the record info from the entry of the data folder in structure.oebin */
+		bool readStructure(RecordInfo& info) const;
+
+		/** Reads the first sample of each window from segments.npy, if the recording was gated */
+		void readSegments();
+
+		/** Reads the (sample, timestamp) pairs the timestamps of the data can be worked out from */
+		void readTimestampAnchors();
+
+		/** Finds the record and sample of a timestamp. Returns false if it isn't within the data */
+		bool findEventSample(int64 timestamp, int& record, int64& sample) const;
+
+		/** Adds the events of a TTL or text folder of the events folder */
+		void readEventFolder(const File& folder, const var& info);
+
+		File m_file;
+		ScopedPointer<MemoryMappedFile> m_map;
+		RecordInfo m_info;
+		int m_numChannels;
+		int64 m_samplePos;
+		Array<int64> m_segmentStarts;
+		Array<int64> m_segmentTimestamps;
+		Array<int64> m_anchorSamples;
+		Array<int64> m_anchorTimestamps;
+		int64 m_recordStart;
+
+		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BinaryFileSource);
+	};
+}
+
+#endif
@@ -24,6 +24,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "BinaryRecording.h"
 
 #define MAX_BUFFER_SIZE 40960
+//Records of single file spike groups, and the waveforms within them, start on multiples of this
+#define SPIKE_RECORD_ALIGNMENT 32
 
 using namespace BinaryRecordingEngine;
 
@@ -32,6 +34,10 @@ BinaryRecording::BinaryRecording()
 	m_scaledBuffer.malloc(MAX_BUFFER_SIZE);
 	m_intBuffer.malloc(MAX_BUFFER_SIZE);
 	m_tsBuffer.malloc(MAX_BUFFER_SIZE);
+	m_flushThreads.add(new BlockFlushThread());
+	m_flushThreads[0]->startThread();
+	m_checkpointThread = new CheckpointThread();
+	m_checkpointThread->startThread();
 }
 
 BinaryRecording::~BinaryRecording()
@@ -61,9 +67,27 @@ String BinaryRecording::getProcessorString(const InfoObjectCommon* channelInfo)
 
 void BinaryRecording::openFiles(File rootFolder, int experimentNumber, int recordingNumber)
 {
-	String basepath = rootFolder.getFullPathName() + rootFolder.separatorString + "experiment" + String(experimentNumber)
-		+ File::separatorString + "recording" + String(recordingNumber + 1) + File::separatorString;
-	String contPath = basepath + "continuous" + File::separatorString;
+	String recordingPath = "experiment" + String(experimentNumber) + File::separatorString + "recording" + String(recordingNumber + 1) + File::separatorString;
+	String basepath = rootFolder.getFullPathName() + rootFolder.separatorString + recordingPath;
+	String contPath = "continuous" + File::separatorString;
+
+	//the same root folder name is used on every volume
+	m_volumeFolders.clearQuick();
+	m_volumeBasePaths.clearQuick();
+	m_volumeFolders.add(rootFolder.getParentDirectory().getFullPathName());
+	m_volumeBasePaths.add(basepath);
+	{
+		const ScopedLock sl(m_extraFoldersLock);
+		for (int i = 0; i < m_extraFolders.size(); i++)
+		{
+			m_volumeFolders.add(m_extraFolders[i].getFullPathName());
+			m_volumeBasePaths.add(m_extraFolders[i].getChildFile(rootFolder.getFileName()).getFullPathName() + File::separatorString + recordingPath);
+		}
+	}
+	int nVolumes = m_volumeFolders.size();
+	while (m_flushThreads.size() < nVolumes)
+		m_flushThreads.add(new BlockFlushThread())->startThread();
+	m_gated = isRecordGated();
 	//Open channel files
 	int nProcessors = getNumRecordedProcessors();
 
@@ -72,6 +96,7 @@ void BinaryRecording::openFiles(File rootFolder, int experimentNumber, int recor
 
 	Array<const DataChannel*> indexedDataChannels;
 	Array<unsigned int> indexedChannelCount;
+	Array<int> indexedDecimations;
 	Array<var> jsonContinuousfiles;
 	Array<var> jsonChannels;
 	StringArray continuousFileNames;
@@ -88,6 +113,7 @@ void BinaryRecording::openFiles(File rootFolder, int experimentNumber, int recor
 			const DataChannel* channelInfo = getDataChannel(realChan);
 			int sourceId = channelInfo->getSourceNodeID();
 			int sourceSubIdx = channelInfo->getSubProcessorIdx();
+			int decimation = getRecordDecimation(recordedChan);
 			int nInfoArrays = indexedDataChannels.size();
 			bool found = false;
 			DynamicObject::Ptr jsonChan = new DynamicObject();
@@ -102,7 +128,8 @@ void BinaryRecording::openFiles(File rootFolder, int experimentNumber, int recor
 			createChannelMetaData(channelInfo, jsonChan);
 			for (int i = lastId; i < nInfoArrays; i++)
 			{
-				if (sourceId == indexedDataChannels[i]->getSourceNodeID() && sourceSubIdx == indexedDataChannels[i]->getSubProcessorIdx())
+				if (sourceId == indexedDataChannels[i]->getSourceNodeID() && sourceSubIdx == indexedDataChannels[i]->getSubProcessorIdx()
+					&& decimation == indexedDecimations[i])
 				{
 					unsigned int count = indexedChannelCount[i];
 					m_channelIndexes.set(recordedChan, count);
@@ -116,22 +143,40 @@ void BinaryRecording::openFiles(File rootFolder, int experimentNumber, int recor
 			if (!found)
 			{
 				String datPath = getProcessorString(channelInfo);
-				continuousFileNames.add(contPath + datPath + "continuous.dat");
+				//the channels of a source recorded at a lower rate get a folder of their own
+				if (decimation > 1)
+					datPath = datPath.dropLastCharacters(File::separatorString.length()) + "_decimated" + String(decimation) + File::separatorString;
+				continuousFileNames.add(contPath + datPath + (m_compressContinuous ? "continuous.cdat" : "continuous.dat"));
 				
-				ScopedPointer<NpyFile> tFile = new NpyFile(contPath + datPath + "timestamps.npy", NpyType(BaseType::INT64,1));
+				ScopedPointer<NpyFile> tFile;
+				if (m_implicitTimestamps)
+					tFile = new NpyFile(openAsyncFile(basepath + contPath + datPath + "timestamp_discontinuities.npy"), NpyType(BaseType::INT64, 2));
+				else
+					tFile = new NpyFile(openAsyncFile(basepath + contPath + datPath + "timestamps.npy"), NpyType(BaseType::INT64,1));
 				m_dataTimestampFiles.add(tFile.release());
+				if (m_gated)
+					m_segmentFiles.add(new NpyFile(openAsyncFile(basepath + contPath + datPath + "segments.npy"), NpyType(BaseType::INT64, 2)));
+				m_timestampSampleCounts.add(0);
+				m_nextTimestamps.add(-1);
 
 				m_fileIndexes.set(recordedChan, nInfoArrays);
 				m_channelIndexes.set(recordedChan, 0);
 				indexedChannelCount.add(1);
 				indexedDataChannels.add(channelInfo);
+				indexedDecimations.add(decimation);
 
 				Array<var> jsonChanArray;
 				jsonChanArray.add(var(jsonChan));
 				jsonChannels.add(var(jsonChanArray));
 				DynamicObject::Ptr jsonFile = new DynamicObject();
 				jsonFile->setProperty("folder_name", datPath.replace(File::separatorString, "/")); //to make it more system agnostic, replace separator with only one slash
-				jsonFile->setProperty("sample_rate", channelInfo->getSampleRate());
+				jsonFile->setProperty("sample_rate", channelInfo->getSampleRate() / decimation);
+				if (decimation > 1)
+					jsonFile->setProperty("decimation", decimation);
+				jsonFile->setProperty("implicit_timestamps", m_implicitTimestamps);
+				jsonFile->setProperty("gated", m_gated);
+				if (m_compressContinuous)
+					jsonFile->setProperty("compression", "delta-rice");
 				jsonFile->setProperty("source_processor_name", channelInfo->getSourceName());
 				jsonFile->setProperty("source_processor_id", channelInfo->getSourceNodeID());
 				jsonFile->setProperty("source_processor_sub_idx", channelInfo->getSubProcessorIdx());
@@ -143,16 +188,36 @@ void BinaryRecording::openFiles(File rootFolder, int experimentNumber, int recor
 		lastId = indexedDataChannels.size();
 	}
 	int nFiles = continuousFileNames.size();
+	//each flush thread compresses the blocks of its volume, so they get a compressor each, sharing the cores
+	if (m_compressContinuous)
+	{
+		while (m_compressors.size() < nVolumes)
+			m_compressors.add(new BlockCompressor(jmax(1, (SystemStats::getNumCpus() - 1) / nVolumes)));
+	}
+
+	Array<double> fileRates;
+	for (int i = 0; i < nFiles; i++)
+		fileRates.add(double(jsonChannels.getReference(i).size()) * indexedDataChannels[i]->getSampleRate() / indexedDecimations[i] * sizeof(int16));
+	m_fileVolumes = assignVolumes(fileRates, getVolumeThroughputs());
+
 	for (int i = 0; i < nFiles; i++)
 	{
 		int numChannels = jsonChannels.getReference(i).size();
-		ScopedPointer<SequentialBlockFile> bFile = new SequentialBlockFile(numChannels, samplesPerBlock);
-		if (bFile->openFile(continuousFileNames[i]))
+		int volume = m_fileVolumes[i];
+		m_fileChannels.add(Array<int>());
+		m_fileChannels.getReference(i).insertMultiple(0, -1, numChannels);
+		ScopedPointer<SequentialBlockFile> bFile = new SequentialBlockFile(numChannels, samplesPerBlock, m_flushThreads[volume]);
+		if (m_compressContinuous)
+			bFile->setCompression(m_compressors[volume], indexedDataChannels[i]->getSampleRate() / indexedDecimations[i]);
+		int64 preallocateBytes = int64(m_preallocateMinutes * 60.0 * indexedDataChannels[i]->getSampleRate() / indexedDecimations[i]) * numChannels * sizeof(int16);
+		if (bFile->openFile(m_volumeBasePaths[volume] + continuousFileNames[i], m_unbufferedWrites, preallocateBytes))
 			m_DataFiles.add(bFile.release());
 		else
 			m_DataFiles.add(nullptr);
 		DynamicObject::Ptr jsonFile = jsonContinuousfiles.getReference(i).getDynamicObject();
 		jsonFile->setProperty("num_channels", numChannels);
+		if (nVolumes > 1)
+			jsonFile->setProperty("volume", volume);
 		jsonFile->setProperty("channels", jsonChannels.getReference(i));
 	}
 
@@ -162,7 +227,12 @@ void BinaryRecording::openFiles(File rootFolder, int experimentNumber, int recor
 	for (int i = 0; i < nChans; i++)
 	{
 		m_startTS.add(getTimestamp(i));
+		m_samplePositions.add(0);
+		m_fileChannels.getReference(m_fileIndexes[i]).set(m_channelIndexes[i], i);
 	}
+	m_blockSamples.malloc(size_t(jmax(nChans, 1)) * samplesPerBlock);
+	m_blockSampleCounts.insertMultiple(0, 0, nChans);
+	m_blockStartPositions.insertMultiple(0, 0, nChans);
 
 	int nEvents = getNumRecordedEvents();
 	String eventPath(basepath + "events" + File::separatorString);
@@ -196,12 +266,14 @@ void BinaryRecording::openFiles(File rootFolder, int experimentNumber, int recor
 		eventName += "_" + String(chan->getSourceIndex() + 1) + File::separatorString;
 		ScopedPointer<EventRecording> rec = new EventRecording();
 		
-		rec->mainFile = new NpyFile(eventPath + eventName + dataFileName + ".npy", type);
-		rec->timestampFile = new NpyFile(eventPath + eventName + "timestamps.npy", NpyType(BaseType::INT64, 1));
-		rec->channelFile = new NpyFile(eventPath + eventName + "channels.npy", NpyType(BaseType::UINT16, 1));
+		rec->mainFile = new NpyFile(openAsyncFile(eventPath + eventName + dataFileName + ".npy"), type);
+		rec->timestampFile = new NpyFile(openAsyncFile(eventPath + eventName + "timestamps.npy"), NpyType(BaseType::INT64, 1));
+		rec->channelFile = new NpyFile(openAsyncFile(eventPath + eventName + "channels.npy"), NpyType(BaseType::UINT16, 1));
+		if (isClockSyncEnabled())
+			rec->syncTimestampFile = new NpyFile(openAsyncFile(eventPath + eventName + "synchronized_timestamps.npy"), NpyType(BaseType::INT64, 1));
 		if (chan->getChannelType() == EventChannel::TTL && m_saveTTLWords)
 		{
-			rec->extraFile = new NpyFile(eventPath + eventName + "full_words.npy", NpyType(BaseType::UINT8, chan->getDataSize()));
+			rec->extraFile = new NpyFile(openAsyncFile(eventPath + eventName + "full_words.npy"), NpyType(BaseType::UINT8, chan->getDataSize()));
 		}
 
 		DynamicObject::Ptr jsonChannel = new DynamicObject();
@@ -282,10 +354,34 @@ void BinaryRecording::openFiles(File rootFolder, int experimentNumber, int recor
 
 			String spikeName = getProcessorString(ch) + "spike_group_" + String(groupIndex) + File::separatorString;
 
-			rec->mainFile = new NpyFile(spikePath + spikeName + "spike_waveforms.npy", NpyType(BaseType::INT16, ch->getTotalSamples()), ch->getNumChannels());
-			rec->timestampFile = new NpyFile(spikePath + spikeName + "spike_times.npy", NpyType(BaseType::INT64, 1));
-			rec->channelFile = new NpyFile(spikePath + spikeName + "spike_electrode_indices.npy", NpyType(BaseType::UINT16, 1));
-			rec->extraFile = new NpyFile(spikePath + spikeName + "spike_clusters.npy", NpyType(BaseType::UINT16, 1));
+			if (m_singleSpikeFiles)
+			{
+				//the fixed fields fill the first SPIKE_RECORD_ALIGNMENT bytes, so the waveforms of every record start aligned
+				int waveformSamples = ch->getTotalSamples() * ch->getNumChannels();
+				size_t waveformBytes = waveformSamples * sizeof(int16);
+				size_t paddedBytes = ((waveformBytes + SPIKE_RECORD_ALIGNMENT - 1) / SPIKE_RECORD_ALIGNMENT) * SPIKE_RECORD_ALIGNMENT;
+				Array<NpyType> recordTypes;
+				recordTypes.add(NpyType("timestamp", BaseType::INT64, 1));
+				recordTypes.add(NpyType("synchronized_timestamp", BaseType::INT64, 1));
+				recordTypes.add(NpyType("electrode_index", BaseType::UINT16, 1));
+				recordTypes.add(NpyType("cluster", BaseType::UINT16, 1));
+				recordTypes.add(NpyType("padding", BaseType::UINT8, SPIKE_RECORD_ALIGNMENT - 20));
+				recordTypes.add(NpyType("waveform", BaseType::INT16, waveformSamples));
+				if (paddedBytes > waveformBytes)
+					recordTypes.add(NpyType("waveform_padding", BaseType::UINT8, paddedBytes - waveformBytes));
+				rec->spikeRecordBytes = SPIKE_RECORD_ALIGNMENT + paddedBytes;
+				m_spikeRecordSize = jmax(m_spikeRecordSize, rec->spikeRecordBytes);
+				rec->mainFile = new NpyFile(openAsyncFile(spikePath + spikeName + "spikes.npy"), recordTypes);
+			}
+			else
+			{
+				rec->mainFile = new NpyFile(openAsyncFile(spikePath + spikeName + "spike_waveforms.npy"), NpyType(BaseType::INT16, ch->getTotalSamples()), ch->getNumChannels());
+				rec->timestampFile = new NpyFile(openAsyncFile(spikePath + spikeName + "spike_times.npy"), NpyType(BaseType::INT64, 1));
+				rec->channelFile = new NpyFile(openAsyncFile(spikePath + spikeName + "spike_electrode_indices.npy"), NpyType(BaseType::UINT16, 1));
+				if (isClockSyncEnabled())
+					rec->syncTimestampFile = new NpyFile(openAsyncFile(spikePath + spikeName + "synchronized_spike_times.npy"), NpyType(BaseType::INT64, 1));
+				rec->extraFile = new NpyFile(openAsyncFile(spikePath + spikeName + "spike_clusters.npy"), NpyType(BaseType::UINT16, 1));
+			}
 			Array<NpyType> tsTypes;
 			
 			Array<var> jsonChanArray;
@@ -299,12 +395,20 @@ void BinaryRecording::openFiles(File rootFolder, int experimentNumber, int recor
 			jsonFile->setProperty("num_channels", (int)numSpikeChannels);
 			jsonFile->setProperty("pre_peak_samples", (int)ch->getPrePeakSamples());
 			jsonFile->setProperty("post_peak_samples", (int)ch->getPostPeakSamples());
+			if (m_singleSpikeFiles)
+			{
+				jsonFile->setProperty("layout", "single_file");
+				jsonFile->setProperty("record_bytes", (int)rec->spikeRecordBytes);
+				jsonFile->setProperty("waveform_offset", SPIKE_RECORD_ALIGNMENT);
+			}
 			
 			rec->metaDataFile = createEventMetadataFile(ch, spikePath + spikeName + "metadata.npy", jsonFile);
 			m_spikeFiles.add(rec.release());
 			jsonSpikeFiles.add(var(jsonFile));
 		}
 	}
+	if (m_spikeRecordSize > 0)
+		m_spikeRecord.calloc(m_spikeRecordSize);
 	int nSpikeFiles = jsonSpikeFiles.size();
 	for (int i = 0; i < nSpikeFiles; i++)
 	{
@@ -332,9 +436,44 @@ void BinaryRecording::openFiles(File rootFolder, int experimentNumber, int recor
 	jsonSettingsFile->setProperty("continuous", jsonContinuousfiles);
 	jsonSettingsFile->setProperty("events", jsonEventFiles);
 	jsonSettingsFile->setProperty("spikes", jsonSpikeFiles);
-	FileOutputStream settingsFileStream(File(basepath + "structure.oebin"));
+	if (nVolumes > 1)
+	{
+		//the recording folder on each volume, the continuous files being under the one of their "volume"
+		Array<var> jsonVolumes;
+		for (int v = 0; v < nVolumes; v++)
+			jsonVolumes.add(m_volumeBasePaths[v]);
+		jsonSettingsFile->setProperty("volumes", jsonVolumes);
+	}
 
-	jsonSettingsFile->writeAsJSON(settingsFileStream, 2, false);
+	//every volume holding data gets a copy, so that its files can be read on their own
+	for (int v = 0; v < nVolumes; v++)
+	{
+		if (v > 0 && !m_fileVolumes.contains(v))
+			continue;
+		FileOutputStream settingsFileStream(File(m_volumeBasePaths[v] + "structure.oebin"));
+		jsonSettingsFile->writeAsJSON(settingsFileStream, 2, false);
+	}
+
+	m_checkpointing = m_checkpointSeconds > 0;
+	if (m_checkpointing)
+	{
+		m_checkpointJournal = File(basepath + "checkpoint.json");
+		m_checkpointThread->startRecording(m_checkpointJournal);
+		for (int i = 0; i < nFiles; i++)
+		{
+			if (m_DataFiles[i])
+				m_checkpointThread->addDataFile(File(m_volumeBasePaths[m_fileVolumes[i]] + continuousFileNames[i]), m_DataFiles[i]);
+		}
+		for (int i = 0; i < m_dataTimestampFiles.size(); i++)
+			m_checkpointThread->addNpyFile(m_dataTimestampFiles[i]);
+		for (int i = 0; i < m_segmentFiles.size(); i++)
+			m_checkpointThread->addNpyFile(m_segmentFiles[i]);
+		for (int i = 0; i < m_eventFiles.size(); i++)
+			m_eventFiles[i]->addToCheckpoints(*m_checkpointThread);
+		for (int i = 0; i < m_spikeFiles.size(); i++)
+			m_spikeFiles[i]->addToCheckpoints(*m_checkpointThread);
+		m_lastCheckpoint = Time::getMillisecondCounter();
+	}
 }
 
 NpyFile* BinaryRecording::createEventMetadataFile(const MetaDataEventObject* channel, String filename, DynamicObject* jsonFile)
@@ -358,7 +497,7 @@ NpyFile* BinaryRecording::createEventMetadataFile(const MetaDataEventObject* cha
 	}
 	if (jsonFile)
 		jsonFile->setProperty("event_metadata", jsonMetaData);
-	return new NpyFile(filename, types);
+	return new NpyFile(openAsyncFile(filename), types);
 }
 
 template <typename TO, typename FROM>
@@ -445,20 +584,60 @@ void BinaryRecording::createChannelMetaData(const MetaDataInfoObject* channel, D
 
 void BinaryRecording::closeFiles()
 {
+	if (m_checkpointing)
+		m_checkpointThread->stopRecording();
+	//the final estimates, for aligning the data timestamps offline
+	if (m_syncTextFile && isClockSyncEnabled())
+		m_syncTextFile->writeText(getClockSyncDescription(), false, false);
+	//a last record one past the final sample closes the last run, so readers know how many samples there are
+	for (int i = 0; i < m_dataTimestampFiles.size(); i++)
+	{
+		int64 record[2] = { m_timestampSampleCounts[i], m_nextTimestamps[i] };
+		if (m_implicitTimestamps)
+		{
+			m_dataTimestampFiles[i]->writeData(record, sizeof(record));
+			m_dataTimestampFiles[i]->increaseRecordCount();
+		}
+		if (m_gated)
+		{
+			m_segmentFiles[i]->writeData(record, sizeof(record));
+			m_segmentFiles[i]->increaseRecordCount();
+		}
+	}
+	//the data files are still open, so their write statistics are available
+	measureVolumeThroughputs();
 	resetChannels();
+	//the files are complete, so the journal no longer describes them
+	if (m_checkpointing)
+	{
+		m_checkpointJournal.deleteFile();
+		m_checkpointJournal.getSiblingFile(m_checkpointJournal.getFileName() + ".tmp").deleteFile();
+		m_checkpointing = false;
+	}
 }
 
 void BinaryRecording::resetChannels()
 {
 	m_DataFiles.clear();
+	m_spikeRecordSize = 0;
 	m_channelIndexes.clear();
 	m_fileIndexes.clear();
+	m_fileChannels.clear();
+	m_blockSamples.free();
+	m_blockSampleCounts.clear();
+	m_blockStartPositions.clear();
 	m_dataTimestampFiles.clear();
+	m_segmentFiles.clear();
+	m_samplePositions.clear();
+	m_timestampSampleCounts.clear();
+	m_nextTimestamps.clear();
 	m_eventFiles.clear();
 	m_spikeChannelIndexes.clear();
 	m_spikeFileIndexes.clear();
 	m_spikeFiles.clear();
 	m_syncTextFile = nullptr;
+	//the npy files above have queued their final header updates
+	closeAsyncFiles();
 
 	m_scaledBuffer.malloc(MAX_BUFFER_SIZE);
 	m_intBuffer.malloc(MAX_BUFFER_SIZE);
@@ -477,13 +656,84 @@ void BinaryRecording::writeData(int writeChannel, int realChannel, const float*
 		m_intBuffer.malloc(size);
 		m_tsBuffer.malloc(size);
 	}
-	double multFactor = 1 / (float(0x7fff) * getDataChannel(realChannel)->getBitVolts());
+	double multFactor = 1 / (float(0x7fff) * getDataChannelTable().bitVolts[realChannel]);
 	FloatVectorOperations::copyWithMultiply(m_scaledBuffer.getData(), buffer, multFactor, size);
 	AudioDataConverters::convertFloatToInt16LE(m_scaledBuffer.getData(), m_intBuffer.getData(), size);
+	writeIntData(writeChannel, m_intBuffer.getData(), size);
+}
+
+void BinaryRecording::writeDataInt16(int writeChannel, int realChannel, const float* buffer, const int16* samples, int size)
+{
+	//Either the original codes or samples converted by the record node, exactly what the scaled conversion would produce, so skip it
+	writeIntData(writeChannel, samples, size);
+}
+
+bool BinaryRecording::storesInt16Samples() const
+{
+	return true;
+}
+
+bool BinaryRecording::supportsRecordDecimation() const
+{
+	return true;
+}
+
+void BinaryRecording::writeIntData(int writeChannel, const int16* intBuffer, int size)
+{
+	if (size > m_bufferSize)
+	{
+		std::cerr << "Write buffer overrun, resizing to" << size << std::endl;
+		m_bufferSize = size;
+		m_scaledBuffer.malloc(size);
+		m_intBuffer.malloc(size);
+		m_tsBuffer.malloc(size);
+	}
 	int fileIndex = m_fileIndexes[writeChannel];
-	m_DataFiles[fileIndex]->writeChannel(getTimestamp(writeChannel) - m_startTS[writeChannel], m_channelIndexes[writeChannel], m_intBuffer.getData(), size);
+	//the samples of a gated recording are packed, or the gaps between the windows would take as much space as the data
+	uint64 startPos = m_gated ? m_samplePositions[writeChannel] : getTimestamp(writeChannel) - m_startTS[writeChannel];
+	if (m_gated)
+		m_samplePositions.set(writeChannel, startPos + size);
+
+	//Keep the samples until the end of the channel block, so that all the channels of a file are interleaved together
+	int count = m_blockSampleCounts[writeChannel];
+	if (count > 0 && (m_blockStartPositions[writeChannel] + count != startPos || count + size > samplesPerBlock))
+	{
+		flushChannel(writeChannel);
+		count = 0;
+	}
+	if (size > samplesPerBlock)
+		m_DataFiles[fileIndex]->writeChannel(startPos, m_channelIndexes[writeChannel], intBuffer, size);
+	else
+	{
+		if (count == 0)
+			m_blockStartPositions.set(writeChannel, startPos);
+		memcpy(m_blockSamples + size_t(writeChannel) * samplesPerBlock + count, intBuffer, size * sizeof(int16));
+		m_blockSampleCounts.set(writeChannel, count + size);
+	}
 
-	if (m_channelIndexes[writeChannel] == 0)
+	if (m_channelIndexes[writeChannel] == 0 && (m_implicitTimestamps || m_gated))
+	{
+		//sample i of the file has the timestamp of the last record at or before it, plus the samples since that record
+		int64 baseTS = getTimestamp(writeChannel);
+		int64 sampleIndex = m_timestampSampleCounts[fileIndex];
+		if (baseTS != m_nextTimestamps[fileIndex])
+		{
+			int64 record[2] = { sampleIndex, baseTS };
+			if (m_implicitTimestamps)
+			{
+				m_dataTimestampFiles[fileIndex]->writeData(record, sizeof(record));
+				m_dataTimestampFiles[fileIndex]->increaseRecordCount();
+			}
+			if (m_gated)
+			{
+				m_segmentFiles[fileIndex]->writeData(record, sizeof(record));
+				m_segmentFiles[fileIndex]->increaseRecordCount();
+			}
+		}
+		m_timestampSampleCounts.set(fileIndex, sampleIndex + size);
+		m_nextTimestamps.set(fileIndex, baseTS + size);
+	}
+	if (m_channelIndexes[writeChannel] == 0 && !m_implicitTimestamps)
 	{
 		int64 baseTS = getTimestamp(writeChannel);
 		//Let's hope that the compiler is smart enough to vectorize this. 
@@ -497,6 +747,93 @@ void BinaryRecording::writeData(int writeChannel, int realChannel, const float*
 }
 
 
+void BinaryRecording::flushChannel(int writeChannel)
+{
+	m_DataFiles[m_fileIndexes[writeChannel]]->writeChannel(m_blockStartPositions[writeChannel], m_channelIndexes[writeChannel],
+		m_blockSamples + size_t(writeChannel) * samplesPerBlock, m_blockSampleCounts[writeChannel]);
+	m_blockSampleCounts.set(writeChannel, 0);
+}
+
+void BinaryRecording::endChannelBlock(bool lastBlock)
+{
+	int nFiles = m_fileChannels.size();
+	for (int f = 0; f < nFiles; f++)
+	{
+		const Array<int>& channels = m_fileChannels.getReference(f);
+		int nChannels = channels.size();
+		int count = m_blockSampleCounts[channels[0]];
+		uint64 startPos = m_blockStartPositions[channels[0]];
+		bool aligned = count > 0;
+		for (int c = 1; c < nChannels && aligned; c++)
+		{
+			aligned = m_blockSampleCounts[channels[c]] == count && m_blockStartPositions[channels[c]] == startPos;
+		}
+
+		if (aligned)
+		{
+			m_blockPointers.clearQuick();
+			for (int c = 0; c < nChannels; c++)
+				m_blockPointers.add(m_blockSamples + size_t(channels[c]) * samplesPerBlock);
+			m_DataFiles[f]->writeChannels(startPos, m_blockPointers.getRawDataPointer(), nChannels, count);
+			for (int c = 0; c < nChannels; c++)
+				m_blockSampleCounts.set(channels[c], 0);
+		}
+		else
+		{
+			//channels out of step with each other, which the data queue doesn't produce, are written one by one
+			for (int c = 0; c < nChannels; c++)
+			{
+				if (m_blockSampleCounts[channels[c]] > 0)
+					flushChannel(channels[c]);
+			}
+		}
+	}
+	uint32 now = Time::getMillisecondCounter();
+	if (now - m_lastStaleCheck > NPY_FLUSH_INTERVAL_MS)
+	{
+		m_lastStaleCheck = now;
+		flushStaleFiles();
+	}
+	//a checkpoint skipped because the previous one was still syncing waits for the next interval
+	if (m_checkpointing && now - m_lastCheckpoint >= uint32(m_checkpointSeconds) * 1000)
+	{
+		m_lastCheckpoint = now;
+		m_checkpointThread->checkpoint();
+	}
+}
+
+void BinaryRecording::flushStaleFiles()
+{
+	for (int i = 0; i < m_dataTimestampFiles.size(); i++)
+		m_dataTimestampFiles[i]->flushIfStale();
+	for (int i = 0; i < m_segmentFiles.size(); i++)
+		m_segmentFiles[i]->flushIfStale();
+	for (int i = 0; i < m_eventFiles.size(); i++)
+		m_eventFiles[i]->flushIfStale();
+	for (int i = 0; i < m_spikeFiles.size(); i++)
+		m_spikeFiles[i]->flushIfStale();
+}
+
+void BinaryRecording::EventRecording::flushIfStale()
+{
+	mainFile->flushIfStale();
+	if (timestampFile) timestampFile->flushIfStale();
+	if (metaDataFile) metaDataFile->flushIfStale();
+	if (channelFile) channelFile->flushIfStale();
+	if (extraFile) extraFile->flushIfStale();
+	if (syncTimestampFile) syncTimestampFile->flushIfStale();
+}
+
+void BinaryRecording::EventRecording::addToCheckpoints(CheckpointThread& checkpoints)
+{
+	checkpoints.addNpyFile(mainFile);
+	checkpoints.addNpyFile(timestampFile);
+	checkpoints.addNpyFile(metaDataFile);
+	checkpoints.addNpyFile(channelFile);
+	checkpoints.addNpyFile(extraFile);
+	checkpoints.addNpyFile(syncTimestampFile);
+}
+
 void BinaryRecording::addSpikeElectrode(int index, const SpikeChannel* elec)
 {
 }
@@ -520,6 +857,11 @@ void BinaryRecording::writeEvent(int eventIndex, const MidiMessage& event)
 	const EventChannel* info = getEventChannel(eventIndex);
 	int64 ts = ev->getTimestamp();
 	rec->timestampFile->writeData(&ts, sizeof(int64));
+	if (rec->syncTimestampFile)
+	{
+		int64 syncTs = getSynchronizedTimestamp(ev->getSourceID(), ev->getSubProcessorIdx(), ts);
+		rec->syncTimestampFile->writeData(&syncTs, sizeof(int64));
+	}
 
 	uint16 chan = ev->getChannel() +1;
 	rec->channelFile->writeData(&chan, sizeof(uint16));
@@ -568,11 +910,37 @@ void BinaryRecording::writeSpike(int electrodeIndex, const SpikeEvent* spike)
 	}
 	double multFactor = 1 / (float(0x7fff) * channel->getChannelBitVolts(0));
 	FloatVectorOperations::copyWithMultiply(m_scaledBuffer.getData(), spike->getDataPointer(), multFactor, totalSamples);
+	int64 ts = spike->getTimestamp();
+	if (rec->spikeRecordBytes > 0)
+	{
+		char* record = m_spikeRecord.getData();
+		int64 syncTs = -1;
+		const Array<SourceChannelInfo>& sources = channel->getSourceChannelInfo();
+		if (isClockSyncEnabled() && sources.size() > 0)
+			syncTs = getSynchronizedTimestamp(sources.getReference(0).processorID, sources.getReference(0).subProcessorID, ts);
+		uint16 sortedID = spike->getSortedID();
+		memcpy(record, &ts, sizeof(int64));
+		memcpy(record + 8, &syncTs, sizeof(int64));
+		memcpy(record + 16, &spikeChannel, sizeof(uint16));
+		memcpy(record + 18, &sortedID, sizeof(uint16));
+		//the padding bytes stay zeroed from the allocation, as the samples of each group always fill the same span
+		AudioDataConverters::convertFloatToInt16LE(m_scaledBuffer.getData(), record + SPIKE_RECORD_ALIGNMENT, totalSamples);
+		rec->mainFile->writeData(record, rec->spikeRecordBytes);
+		writeEventMetaData(spike, rec->metaDataFile);
+		increaseEventCounts(rec);
+		return;
+	}
 	AudioDataConverters::convertFloatToInt16LE(m_scaledBuffer.getData(), m_intBuffer.getData(), totalSamples);
 	rec->mainFile->writeData(m_intBuffer.getData(), totalSamples*sizeof(int16));
 	
-	int64 ts = spike->getTimestamp();
 	rec->timestampFile->writeData(&ts, sizeof(int64));
+	if (rec->syncTimestampFile)
+	{
+		//spike times follow the clock of the data the spikes were detected in
+		const Array<SourceChannelInfo>& sources = channel->getSourceChannelInfo();
+		int64 syncTs = sources.size() > 0 ? getSynchronizedTimestamp(sources.getReference(0).processorID, sources.getReference(0).subProcessorID, ts) : -1;
+		rec->syncTimestampFile->writeData(&syncTs, sizeof(int64));
+	}
 
 	rec->channelFile->writeData(&spikeChannel, sizeof(uint16));
 
@@ -586,10 +954,11 @@ void BinaryRecording::writeSpike(int electrodeIndex, const SpikeEvent* spike)
 void BinaryRecording::increaseEventCounts(EventRecording* rec)
 {
 	rec->mainFile->increaseRecordCount();
-	rec->timestampFile->increaseRecordCount();
+	if (rec->timestampFile) rec->timestampFile->increaseRecordCount();
 	if (rec->extraFile) rec->extraFile->increaseRecordCount();
 	if (rec->channelFile) rec->channelFile->increaseRecordCount();
 	if (rec->metaDataFile) rec->metaDataFile->increaseRecordCount();
+	if (rec->syncTimestampFile) rec->syncTimestampFile->increaseRecordCount();
 }
 
 RecordEngineManager* BinaryRecording::getEngineManager()
@@ -598,6 +967,20 @@ RecordEngineManager* BinaryRecording::getEngineManager()
 	EngineParameter* param;
 	param = new EngineParameter(EngineParameter::BOOL, 0, "Record TTL full words", true);
 	man->addParameter(param);
+	param = new EngineParameter(EngineParameter::BOOL, 1, "Unbuffered continuous writes", false);
+	man->addParameter(param);
+	param = new EngineParameter(EngineParameter::INT, 2, "Preallocate continuous files for (minutes)", 0, 0, 1440);
+	man->addParameter(param);
+	param = new EngineParameter(EngineParameter::BOOL, 3, "Implicit continuous timestamps", false);
+	man->addParameter(param);
+	param = new EngineParameter(EngineParameter::BOOL, 4, "Compress continuous data", false);
+	man->addParameter(param);
+	param = new EngineParameter(EngineParameter::STR, 5, "Extra data folders (separated by ;)", String::empty);
+	man->addParameter(param);
+	param = new EngineParameter(EngineParameter::BOOL, 6, "Single file spike groups", false);
+	man->addParameter(param);
+	param = new EngineParameter(EngineParameter::INT, 7, "Checkpoint files every (seconds, 0 to disable)", 10, 0, 3600);
+	man->addParameter(param);
 	
 	return man;
 }
@@ -605,6 +988,126 @@ RecordEngineManager* BinaryRecording::getEngineManager()
 void BinaryRecording::setParameter(EngineParameter& parameter)
 {
 	boolParameter(0, m_saveTTLWords);
+	else boolParameter(1, m_unbufferedWrites);
+	else intParameter(2, m_preallocateMinutes);
+	else boolParameter(3, m_implicitTimestamps);
+	else boolParameter(4, m_compressContinuous);
+	else boolParameter(6, m_singleSpikeFiles);
+	else intParameter(7, m_checkpointSeconds);
+	else if ((parameter.id == 5) && (parameter.type == EngineParameter::STR))
+	{
+		StringArray folders;
+		folders.addTokens(parameter.strParam.value, ";", "\"");
+		folders.trim();
+		folders.removeEmptyStrings();
+
+		const ScopedLock sl(m_extraFoldersLock);
+		m_extraFolders.clear();
+		for (int i = 0; i < folders.size(); i++)
+		{
+			if (File::isAbsolutePath(folders[i]))
+				m_extraFolders.addIfNotAlreadyThere(File(folders[i]));
+			else
+				std::cerr << "Binary: ignoring extra data folder " << folders[i] << ", it must be an absolute path" << std::endl;
+		}
+	}
+}
+
+Array<File> BinaryRecording::getExtraDataDirectories() const
+{
+	const ScopedLock sl(m_extraFoldersLock);
+	return m_extraFolders;
+}
+
+Array<int> BinaryRecording::assignVolumes(const Array<double>& fileRates, const Array<double>& volumeThroughputs)
+{
+	int nFiles = fileRates.size();
+	int nVolumes = volumeThroughputs.size();
+	Array<int> volumes;
+	volumes.insertMultiple(0, 0, nFiles);
+	if (nVolumes < 2)
+		return volumes;
+
+	//largest first, each to the volume that would then take the least time to write its load
+	Array<int> order;
+	for (int i = 0; i < nFiles; i++)
+	{
+		int pos = 0;
+		while (pos < order.size() && fileRates[order[pos]] >= fileRates[i])
+			pos++;
+		order.insert(pos, i);
+	}
+	Array<double> loads;
+	loads.insertMultiple(0, 0.0, nVolumes);
+	for (int i = 0; i < nFiles; i++)
+	{
+		int file = order[i];
+		int best = 0;
+		double bestTime = 0;
+		for (int v = 0; v < nVolumes; v++)
+		{
+			double time = (loads[v] + fileRates[file]) / volumeThroughputs[v];
+			if (v == 0 || time < bestTime)
+			{
+				best = v;
+				bestTime = time;
+			}
+		}
+		loads.set(best, loads[best] + fileRates[file]);
+		volumes.set(file, best);
+	}
+	return volumes;
+}
+
+Array<double> BinaryRecording::getVolumeThroughputs() const
+{
+	int nVolumes = m_volumeFolders.size();
+	double total = 0;
+	int known = 0;
+	for (int v = 0; v < nVolumes; v++)
+	{
+		if (m_volumeThroughputs.contains(m_volumeFolders[v]))
+		{
+			total += m_volumeThroughputs[m_volumeFolders[v]];
+			known++;
+		}
+	}
+	//volumes not measured yet are assumed to be as fast as the average of the others
+	double estimate = (known > 0) ? total / known : 1.0;
+
+	Array<double> throughputs;
+	for (int v = 0; v < nVolumes; v++)
+		throughputs.add(m_volumeThroughputs.contains(m_volumeFolders[v]) ? m_volumeThroughputs[m_volumeFolders[v]] : estimate);
+	return throughputs;
+}
+
+void BinaryRecording::measureVolumeThroughputs()
+{
+	int nVolumes = m_volumeFolders.size();
+	if (nVolumes < 2)
+		return;
+
+	Array<int64> bytes;
+	Array<double> seconds;
+	bytes.insertMultiple(0, 0, nVolumes);
+	seconds.insertMultiple(0, 0.0, nVolumes);
+	for (int i = 0; i < m_DataFiles.size(); i++)
+	{
+		if (!m_DataFiles[i] || i >= m_fileVolumes.size())
+			continue;
+		int v = m_fileVolumes[i];
+		bytes.set(v, bytes[v] + m_DataFiles[i]->getBytesWritten());
+		seconds.set(v, seconds[v] + m_DataFiles[i]->getWriteSeconds());
+	}
+	for (int v = 0; v < nVolumes; v++)
+	{
+		//too little data to be meaningful, keep the previous measurement
+		if (bytes[v] < (int64(1) << 24) || seconds[v] <= 0)
+			continue;
+		double throughput = bytes[v] / seconds[v];
+		m_volumeThroughputs.set(m_volumeFolders[v], throughput);
+		std::cout << "Binary: " << m_volumeFolders[v] << " written at " << throughput / (1024 * 1024) << " MB/s" << std::endl;
+	}
 }
 
 String BinaryRecording::jsonTypeValue(BaseType type)
@@ -25,12 +25,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <RecordingLib.h>
 #include "SequentialBlockFile.h"
+#include "CheckpointThread.h"
 #include "NpyFile.h"
 
 namespace BinaryRecordingEngine
 {
 
-	class BinaryRecording : public RecordEngine
+	class BinaryRecording : public AsyncRecordEngine
 	{
 	public:
 		BinaryRecording();
@@ -40,12 +41,17 @@ namespace BinaryRecordingEngine
 		void openFiles(File rootFolder, int experimentNumber, int recordingNumber) override;
 		void closeFiles() override;
 		void writeData(int writeChannel, int realChannel, const float* buffer, int size) override;
+		void writeDataInt16(int writeChannel, int realChannel, const float* buffer, const int16* samples, int size) override;
+		bool storesInt16Samples() const override;
+		bool supportsRecordDecimation() const override;
+		void endChannelBlock(bool lastBlock) override;
 		void writeEvent(int eventIndex, const MidiMessage& event) override;
 		void resetChannels() override;
 		void addSpikeElectrode(int index, const SpikeChannel* elec) override;
 		void writeSpike(int electrodeIndex, const SpikeEvent* spike) override;
 		void writeTimestampSyncText(uint16 sourceID, uint16 sourceIdx, int64 timestamp, float, String text) override;
 		void setParameter(EngineParameter& parameter) override;
+		Array<File> getExtraDataDirectories() const override;
 
 		static RecordEngineManager* getEngineManager();
 
@@ -59,6 +65,12 @@ namespace BinaryRecordingEngine
 			ScopedPointer<NpyFile> metaDataFile;
 			ScopedPointer<NpyFile> channelFile;
 			ScopedPointer<NpyFile> extraFile;
+			/** Timestamps mapped onto the global timestamp source, when clock synchronization is enabled */
+			ScopedPointer<NpyFile> syncTimestampFile;
+			/** Size of each record of a single file spike group, 0 when the spike data is spread over several files */
+			size_t spikeRecordBytes{ 0 };
+			void flushIfStale();
+			void addToCheckpoints(CheckpointThread& checkpoints);
 		};
 		
 
@@ -66,22 +78,86 @@ namespace BinaryRecordingEngine
 		void createChannelMetaData(const MetaDataInfoObject* channel, DynamicObject* jsonObject);
 		void writeEventMetaData(const MetaDataEvent* event, NpyFile* file);
 		void increaseEventCounts(EventRecording* rec);
+		void writeIntData(int writeChannel, const int16* intBuffer, int size);
+		void flushChannel(int writeChannel);
+		/** Flushes the npy files whose buffered appends have waited too long, so that sparse events still reach the disk */
+		void flushStaleFiles();
 		static String jsonTypeValue(BaseType type);
 		static String getProcessorString(const InfoObjectCommon* channelInfo);
+		/** Spreads files with the given data rates over volumes with the given throughputs, so that all
+		of them are equally busy. Returns the volume of each file */
+		static Array<int> assignVolumes(const Array<double>& fileRates, const Array<double>& volumeThroughputs);
+		/** Returns the last measured throughput of each volume of the current recording, estimating the unknown ones */
+		Array<double> getVolumeThroughputs() const;
+		/** Updates the volume throughputs with the writes of the data files just closed */
+		void measureVolumeThroughputs();
 
 		bool m_saveTTLWords{ true };
+		/** Write the continuous data bypassing the OS page cache */
+		bool m_unbufferedWrites{ false };
+		/** Expected session length used to preallocate the continuous files, 0 to disable */
+		int m_preallocateMinutes{ 0 };
+		/** Store only the (sample index, timestamp) pairs where the continuous timestamps don't follow on, instead of one timestamp per sample */
+		bool m_implicitTimestamps{ false };
+		/** Write the continuous data as losslessly compressed, indexed continuous.cdat files */
+		bool m_compressContinuous{ false };
+		/** Write each spike group as a single spikes.npy file of fixed size, aligned records */
+		bool m_singleSpikeFiles{ false };
+		/** Seconds between checkpoints of the files, 0 to disable them */
+		int m_checkpointSeconds{ 10 };
+		bool m_checkpointing{ false };
+		uint32 m_lastCheckpoint{ 0 };
+		File m_checkpointJournal;
+		/** One record of a single file spike group, built before being written at once */
+		HeapBlock<char> m_spikeRecord;
+		size_t m_spikeRecordSize{ 0 };
+		/** Data folders on other volumes the continuous files are spread over, along with the selected one */
+		Array<File> m_extraFolders;
+		mutable CriticalSection m_extraFoldersLock;
+		/** The data folder of each volume, the recording folder on it, and the volume of each data file */
+		StringArray m_volumeFolders;
+		StringArray m_volumeBasePaths;
+		Array<int> m_fileVolumes;
+		/** Write throughput in bytes per second measured on each data folder, kept across recordings */
+		HashMap<String, double> m_volumeThroughputs;
 	
 		HeapBlock<float> m_scaledBuffer;
 		HeapBlock<int16> m_intBuffer;
 		HeapBlock<int64> m_tsBuffer;
 		int m_bufferSize;
 
+		/** Write the completed blocks of the data files, one thread per volume so that the disks work in parallel.
+		Declared before the files, so they outlive their last writes */
+		OwnedArray<BlockFlushThread> m_flushThreads;
+		/** Syncs the files and writes their journal at each checkpoint */
+		ScopedPointer<CheckpointThread> m_checkpointThread;
+		/** One per flush thread, as a compressor is only used by one thread at a time. Created on the first
+		compressed recording, and also declared before the data files */
+		OwnedArray<BlockCompressor> m_compressors;
 		OwnedArray<SequentialBlockFile>  m_DataFiles;
 		Array<unsigned int> m_channelIndexes;
 		Array<unsigned int> m_fileIndexes;
+		/** The recorded channels of each data file, in file order */
+		Array<Array<int>> m_fileChannels;
+
+		/** The samples of each channel in the current channel block, interleaved into their file all at once
+		by endChannelBlock(). Each channel has room for samplesPerBlock samples */
+		HeapBlock<int16> m_blockSamples;
+		Array<int> m_blockSampleCounts;
+		Array<uint64> m_blockStartPositions;
+		Array<const int16*> m_blockPointers;
 		OwnedArray<EventRecording> m_eventFiles;
 		OwnedArray<EventRecording> m_spikeFiles;
 		OwnedArray<NpyFile> m_dataTimestampFiles;
+		uint32 m_lastStaleCheck{ 0 };
+		/** For implicit timestamps or gated recordings, the number of samples written to each data file and the timestamp its next sample would follow on with */
+		Array<int64> m_timestampSampleCounts;
+		Array<int64> m_nextTimestamps;
+		/** In a gated recording the windows are written one after the other, and segments.npy lists where each one starts in the
+		data file, with its timestamp, like timestamp_discontinuities.npy does, followed by a record one past the last sample */
+		bool m_gated{ false };
+		OwnedArray<NpyFile> m_segmentFiles;
+		Array<int64> m_samplePositions;
 		ScopedPointer<FileOutputStream> m_syncTextFile;
 
 		Array<unsigned int> m_spikeFileIndexes;
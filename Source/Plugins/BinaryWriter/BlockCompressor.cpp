@@ -0,0 +1,345 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2017 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "BlockCompressor.h"
+
+using namespace BinaryRecordingEngine;
+
+namespace
+{
+	//Channels per job below which splitting a block further isn't worth the scheduling
+	const int minChannelsPerJob = 8;
+
+	int getCompressionThreads(int numThreads)
+	{
+		if (numThreads > 0)
+			return numThreads;
+		return jmax(1, SystemStats::getNumCpus() - 1);
+	}
+
+	class BitWriter
+	{
+	public:
+		explicit BitWriter(uint8* out) : m_out(out), m_start(out), m_acc(0), m_bits(0) {}
+
+		//n may be up to 32
+		inline void put(uint32 value, int n)
+		{
+			m_acc |= uint64(value) << m_bits;
+			m_bits += n;
+			if (m_bits >= 32)
+			{
+				uint32 word = ByteOrder::swapIfBigEndian(uint32(m_acc));
+				memcpy(m_out, &word, sizeof(uint32));
+				m_out += sizeof(uint32);
+				m_acc >>= 32;
+				m_bits -= 32;
+			}
+		}
+
+		size_t finish()
+		{
+			while (m_bits > 0)
+			{
+				*m_out++ = uint8(m_acc);
+				m_acc >>= 8;
+				m_bits -= 8;
+			}
+			m_acc = 0;
+			m_bits = 0;
+			return size_t(m_out - m_start);
+		}
+
+	private:
+		uint8* m_out;
+		uint8* m_start;
+		uint64 m_acc;
+		int m_bits;
+	};
+
+	class BitReader
+	{
+	public:
+		BitReader(const uint8* data, size_t size) : m_data(data), m_end(data + size), m_acc(0), m_bits(0) {}
+
+		//n may be up to 32. Returns false past the end of the data
+		inline bool get(int n, uint32& value)
+		{
+			while (m_bits < n)
+			{
+				if (m_data == m_end)
+					return false;
+				m_acc |= uint64(*m_data++) << m_bits;
+				m_bits += 8;
+			}
+			value = uint32(m_acc & ((uint64(1) << n) - 1));
+			m_acc >>= n;
+			m_bits -= n;
+			return true;
+		}
+
+		//Counts and consumes the one bits before the next zero, up to max (which are then all consumed)
+		inline bool getUnary(int max, int& count)
+		{
+			count = 0;
+			uint32 bit;
+			while (count < max)
+			{
+				if (!get(1, bit))
+					return false;
+				if (bit == 0)
+					return true;
+				count++;
+			}
+			return true;
+		}
+
+	private:
+		const uint8* m_data;
+		const uint8* const m_end;
+		uint64 m_acc;
+		int m_bits;
+	};
+
+	inline uint32 zigzag(int32 v) { return (uint32(v) << 1) ^ uint32(v >> 31); }
+	inline int32 unzigzag(uint32 v) { return int32(v >> 1) ^ -int32(v & 1); }
+}
+
+BlockCompressor::CompressJob::CompressJob() : ThreadPoolJob("Binary block compression")
+{
+}
+
+ThreadPoolJob::JobStatus BlockCompressor::CompressJob::runJob()
+{
+	for (int c = firstChannel; c < lastChannel; c++)
+		channelBytes[c] = uint32(compressChannel(data + c, nChannels, nFrames, out + c*channelStride));
+	return jobHasFinished;
+}
+
+BlockCompressor::BlockCompressor(int numThreads) :
+	m_pool(jmax(1, getCompressionThreads(numThreads) - 1)),
+	m_scratchSize(0),
+	m_channelBytesSize(0)
+{
+	for (int i = 0; i < getCompressionThreads(numThreads); i++)
+		m_jobs.add(new CompressJob());
+}
+
+BlockCompressor::~BlockCompressor()
+{
+	m_pool.removeAllJobs(true, -1);
+}
+
+size_t BlockCompressor::getMaxChannelBytes(int nFrames)
+{
+	//the raw fallback bounds the result, but the coder only checks its size every 64 samples, which can overshoot it
+	return 3 + size_t(jmax(nFrames, 1)) * sizeof(int16) + (64 * (COMPRESSED_ESCAPE_BITS + 17) + 7) / 8;
+}
+
+size_t BlockCompressor::compressChannel(const int16* data, int stride, int nFrames, uint8* out)
+{
+	if (nFrames <= 0)
+		return 0;
+
+	//Pick k from the mean of the mapped differences
+	uint64 sum = 0;
+	for (int i = 1; i < nFrames; i++)
+		sum += zigzag(int32(data[i*stride]) - int32(data[(i - 1)*stride]));
+	int k = 0;
+	while (k < 16 && (uint64(nFrames - 1) << (k + 1)) <= sum)
+		k++;
+
+	const size_t rawBytes = 1 + size_t(nFrames) * sizeof(int16);
+	//Rice coding can grow past the raw size on noisy data, so stop as soon as it does and store the channel raw
+	uint8* payload = out + 3;
+	BitWriter writer(payload);
+	size_t written = 0;
+	out[0] = uint8(k);
+	int16 first = ByteOrder::swapIfBigEndian(uint16(data[0]));
+	memcpy(out + 1, &first, sizeof(int16));
+	bool raw = false;
+	const uint32 lowMask = (uint32(1) << k) - 1;
+	for (int i = 1; i < nFrames; i++)
+	{
+		uint32 v = zigzag(int32(data[i*stride]) - int32(data[(i - 1)*stride]));
+		uint32 q = v >> k;
+		if (q < COMPRESSED_ESCAPE_BITS)
+		{
+			writer.put((uint32(1) << q) - 1, int(q) + 1);
+			writer.put(v & lowMask, k);
+		}
+		else
+		{
+			writer.put((uint32(1) << COMPRESSED_ESCAPE_BITS) - 1, COMPRESSED_ESCAPE_BITS);
+			writer.put(v, 17);
+		}
+		//checked every few samples so that a channel never overruns the buffer
+		if ((i & 63) == 0)
+		{
+			written += writer.finish();
+			if (3 + written >= rawBytes)
+			{
+				raw = true;
+				break;
+			}
+			writer = BitWriter(payload + written);
+		}
+	}
+	if (!raw)
+	{
+		written += writer.finish();
+		if (3 + written < rawBytes)
+			return 3 + written;
+	}
+
+	out[0] = COMPRESSED_RAW_CHANNEL;
+	for (int i = 0; i < nFrames; i++)
+	{
+		int16 s = ByteOrder::swapIfBigEndian(uint16(data[i*stride]));
+		memcpy(out + 1 + i*sizeof(int16), &s, sizeof(int16));
+	}
+	return rawBytes;
+}
+
+bool BlockCompressor::decompressChannel(const uint8* data, size_t size, int nFrames, int16* dst, int stride)
+{
+	if (nFrames <= 0)
+		return true;
+	if (size < 1)
+		return false;
+
+	int k = data[0];
+	if (k == COMPRESSED_RAW_CHANNEL)
+	{
+		if (size < 1 + size_t(nFrames) * sizeof(int16))
+			return false;
+		for (int i = 0; i < nFrames; i++)
+		{
+			uint16 s;
+			memcpy(&s, data + 1 + i*sizeof(int16), sizeof(int16));
+			dst[i*stride] = int16(ByteOrder::swapIfBigEndian(s));
+		}
+		return true;
+	}
+	if (k > 16 || size < 3)
+		return false;
+
+	uint16 first;
+	memcpy(&first, data + 1, sizeof(int16));
+	int32 previous = int16(ByteOrder::swapIfBigEndian(first));
+	dst[0] = int16(previous);
+
+	//the stream restarts on a byte boundary every 64 samples, see compressChannel
+	const uint8* payload = data + 3;
+	const uint8* end = data + size;
+	int i = 1;
+	while (i < nFrames)
+	{
+		BitReader reader(payload, size_t(end - payload));
+		size_t consumedBits = 0;
+		int runEnd = jmin(nFrames, ((i + 63) / 64) * 64 + 1);
+		for (; i < runEnd; i++)
+		{
+			int q;
+			uint32 v;
+			if (!reader.getUnary(COMPRESSED_ESCAPE_BITS, q))
+				return false;
+			if (q == COMPRESSED_ESCAPE_BITS)
+			{
+				if (!reader.get(17, v))
+					return false;
+				consumedBits += COMPRESSED_ESCAPE_BITS + 17;
+			}
+			else
+			{
+				uint32 low = 0;
+				if (k > 0 && !reader.get(k, low))
+					return false;
+				v = (uint32(q) << k) | low;
+				consumedBits += q + 1 + k;
+			}
+			previous += unzigzag(v);
+			dst[i*stride] = int16(previous);
+		}
+		payload += (consumedBits + 7) / 8;
+	}
+	return true;
+}
+
+size_t BlockCompressor::compressBlock(const int16* data, int nChannels, int nFrames, MemoryBlock& out)
+{
+	const size_t channelStride = getMaxChannelBytes(nFrames);
+	const size_t scratchNeeded = channelStride * nChannels;
+	if (scratchNeeded > m_scratchSize)
+	{
+		m_scratch.malloc(scratchNeeded);
+		m_scratchSize = scratchNeeded;
+	}
+	if (nChannels > m_channelBytesSize)
+	{
+		m_channelBytes.malloc(nChannels);
+		m_channelBytesSize = nChannels;
+	}
+
+	int nJobs = jlimit(1, m_jobs.size(), nChannels / minChannelsPerJob);
+	for (int j = 0; j < nJobs; j++)
+	{
+		CompressJob* job = m_jobs[j];
+		job->data = data;
+		job->nChannels = nChannels;
+		job->nFrames = nFrames;
+		job->firstChannel = int(int64(nChannels) * j / nJobs);
+		job->lastChannel = int(int64(nChannels) * (j + 1) / nJobs);
+		job->out = m_scratch;
+		job->channelStride = channelStride;
+		job->channelBytes = m_channelBytes;
+		if (j > 0)
+			m_pool.addJob(job, false);
+	}
+	m_jobs[0]->runJob();
+	for (int j = 1; j < nJobs; j++)
+		m_pool.waitForJobToFinish(m_jobs[j], -1);
+
+	size_t total = sizeof(uint32) * (2 + nChannels);
+	for (int c = 0; c < nChannels; c++)
+		total += m_channelBytes[c];
+	out.ensureSize(total);
+
+	uint8* dst = static_cast<uint8*>(out.getData());
+	uint32 header[2] = { ByteOrder::swapIfBigEndian(uint32(COMPRESSED_BLOCK_MAGIC)), ByteOrder::swapIfBigEndian(uint32(nFrames)) };
+	memcpy(dst, header, sizeof(header));
+	dst += sizeof(header);
+	for (int c = 0; c < nChannels; c++)
+	{
+		uint32 bytes = ByteOrder::swapIfBigEndian(m_channelBytes[c]);
+		memcpy(dst, &bytes, sizeof(uint32));
+		dst += sizeof(uint32);
+	}
+	for (int c = 0; c < nChannels; c++)
+	{
+		memcpy(dst, m_scratch + c*channelStride, m_channelBytes[c]);
+		dst += m_channelBytes[c];
+	}
+	return total;
+}
@@ -0,0 +1,106 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2017 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef BLOCKCOMPRESSOR_H
+#define BLOCKCOMPRESSOR_H
+
+#include <BasicJuceHeader.h>
+
+/*
+Layout of a compressed continuous file (all values little endian):
+
+	header:  char[8] COMPRESSED_FILE_MAGIC, uint32 version, uint32 numChannels, uint32 framesPerBlock, float sampleRate
+	blocks:  uint32 COMPRESSED_BLOCK_MAGIC, uint32 numFrames, uint32 channelBytes[numChannels], then the channels one after another
+	index:   uint64 blockOffset[numBlocks], uint64 numBlocks, uint64 numFrames, char[8] COMPRESSED_INDEX_MAGIC
+
+Every block but the last holds framesPerBlock frames. The index is written when the file is closed; if it is missing,
+the blocks can still be found by walking their headers.
+
+A channel starts with its Rice parameter k and its first sample as int16. Each following sample is stored as the
+zigzag-mapped difference to the previous one, Rice coded: (value >> k) one bits, a zero bit, then the k low bits of
+the value, least significant bit first. Quotients of COMPRESSED_ESCAPE_BITS or more are written as that many one bits
+followed by the 17-bit value. A k of COMPRESSED_RAW_CHANNEL means the samples are stored as plain int16.
+*/
+#define COMPRESSED_FILE_MAGIC "OEBCDAT1"
+#define COMPRESSED_INDEX_MAGIC "OEBCIDX1"
+#define COMPRESSED_FILE_VERSION 1
+#define COMPRESSED_BLOCK_MAGIC 0x4b4c4243
+#define COMPRESSED_HEADER_SIZE 24
+#define COMPRESSED_TRAILER_SIZE 24
+#define COMPRESSED_ESCAPE_BITS 24
+#define COMPRESSED_RAW_CHANNEL 0xff
+
+namespace BinaryRecordingEngine
+{
+	/** Lossless compression of interleaved int16 blocks: per-channel delta coding followed by Rice coding.
+	The channels of a block are compressed in parallel on a pool of worker threads.*/
+	class BlockCompressor
+	{
+	public:
+		/** With numThreads 0, one thread fewer than the number of cores, the calling thread doing its share too */
+		BlockCompressor(int numThreads = 0);
+		~BlockCompressor();
+
+		/** Compresses nFrames frames of nChannels interleaved samples into a block record, as laid out above.
+		Returns its size in bytes. out is grown as needed. Only one thread may call this at a time. */
+		size_t compressBlock(const int16* data, int nChannels, int nFrames, MemoryBlock& out);
+
+		/** Returns the largest size compressChannel() can produce */
+		static size_t getMaxChannelBytes(int nFrames);
+
+		/** Compresses one channel, whose samples are stride items apart, into out. Returns the bytes written */
+		static size_t compressChannel(const int16* data, int stride, int nFrames, uint8* out);
+
+		/** Decodes a channel into dst, with stride items between samples. Returns false if the data is corrupt */
+		static bool decompressChannel(const uint8* data, size_t size, int nFrames, int16* dst, int stride);
+
+	private:
+		class CompressJob : public ThreadPoolJob
+		{
+		public:
+			CompressJob();
+			JobStatus runJob() override;
+
+			const int16* data;
+			int nChannels;
+			int nFrames;
+			int firstChannel;
+			int lastChannel;
+			uint8* out;
+			size_t channelStride;
+			uint32* channelBytes;
+		};
+
+		ThreadPool m_pool;
+		OwnedArray<CompressJob> m_jobs;
+		HeapBlock<uint8> m_scratch;
+		size_t m_scratchSize;
+		HeapBlock<uint32> m_channelBytes;
+		int m_channelBytesSize;
+
+		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BlockCompressor);
+	};
+}
+
+#endif
@@ -0,0 +1,79 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2017 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "BlockFlushThread.h"
+#include "SequentialBlockFile.h"
+
+using namespace BinaryRecordingEngine;
+
+BlockFlushThread::BlockFlushThread() : Thread("Binary block writer")
+{
+	m_queue.ensureStorageAllocated(128);
+	m_writing.ensureStorageAllocated(128);
+}
+
+BlockFlushThread::~BlockFlushThread()
+{
+	signalThreadShouldExit();
+	notify();
+	waitForThreadToExit(-1);
+	writePendingBlocks();
+}
+
+void BlockFlushThread::queueBlock(SequentialBlockFile* file, FileMemoryBlock<int16>* block, size_t numItems, bool lastBlock)
+{
+	PendingBlock pending;
+	pending.file = file;
+	pending.block = block;
+	pending.numItems = numItems;
+	pending.lastBlock = lastBlock;
+	{
+		const ScopedLock sl(m_queueLock);
+		m_queue.add(pending);
+	}
+	notify();
+}
+
+void BlockFlushThread::writePendingBlocks()
+{
+	{
+		const ScopedLock sl(m_queueLock);
+		m_writing.swapWith(m_queue);
+	}
+	for (int i = 0; i < m_writing.size(); i++)
+	{
+		const PendingBlock& pending = m_writing.getReference(i);
+		pending.file->writeBlock(pending.block, pending.numItems, pending.lastBlock);
+	}
+	m_writing.clearQuick();
+}
+
+void BlockFlushThread::run()
+{
+	while (!threadShouldExit())
+	{
+		writePendingBlocks();
+		wait(100);
+	}
+	writePendingBlocks();
+}
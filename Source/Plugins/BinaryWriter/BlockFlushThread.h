@@ -0,0 +1,67 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2017 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef BLOCKFLUSHTHREAD_H
+#define BLOCKFLUSHTHREAD_H
+
+#include "FileMemoryBlock.h"
+
+namespace BinaryRecordingEngine
+{
+	class SequentialBlockFile;
+
+	/** Writes the memory blocks completed by SequentialBlockFiles to disk, so the record thread filling
+	them never waits for the disk. Blocks are written in the order they are queued, and handed back to
+	their file once written.*/
+	class BlockFlushThread : public Thread
+	{
+	public:
+		BlockFlushThread();
+		/** Writes any pending block before returning */
+		~BlockFlushThread();
+
+		/** Queues the first numItems items of a block of a file */
+		void queueBlock(SequentialBlockFile* file, FileMemoryBlock<int16>* block, size_t numItems, bool lastBlock);
+
+		void run() override;
+
+	private:
+		struct PendingBlock
+		{
+			SequentialBlockFile* file;
+			FileMemoryBlock<int16>* block;
+			size_t numItems;
+			bool lastBlock;
+		};
+
+		void writePendingBlocks();
+
+		CriticalSection m_queueLock;
+		Array<PendingBlock> m_queue;
+		Array<PendingBlock> m_writing;
+
+		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BlockFlushThread);
+	};
+}
+
+#endif
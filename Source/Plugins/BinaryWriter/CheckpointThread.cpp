@@ -0,0 +1,190 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2017 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "CheckpointThread.h"
+#include "SequentialBlockFile.h"
+#include "NpyFile.h"
+
+using namespace BinaryRecordingEngine;
+
+CheckpointThread::CheckpointThread() : Thread("Binary checkpoints"),
+	m_busy(false),
+	m_idle(true),
+	m_numCheckpoints(0),
+	m_numSkipped(0),
+	m_numFailed(0),
+	m_syncSeconds(0),
+	m_maxSyncSeconds(0),
+	m_recordThreadTicks(0)
+{
+	m_idle.signal();
+}
+
+CheckpointThread::~CheckpointThread()
+{
+	signalThreadShouldExit();
+	notify();
+	waitForThreadToExit(-1);
+}
+
+void CheckpointThread::startRecording(const File& journalFile)
+{
+	m_idle.wait(-1);
+	m_entries.clearQuick();
+	m_journalFile = journalFile;
+	m_numCheckpoints = 0;
+	m_numSkipped = 0;
+	m_numFailed = 0;
+	m_syncSeconds = 0;
+	m_maxSyncSeconds = 0;
+	m_recordThreadTicks = 0;
+}
+
+void CheckpointThread::addDataFile(const File& path, SequentialBlockFile* file)
+{
+	Entry entry = { path, file, nullptr, 0, 0 };
+	m_entries.add(entry);
+}
+
+void CheckpointThread::addNpyFile(NpyFile* file)
+{
+	if (file == nullptr || file->getFile() == nullptr)
+		return;
+	Entry entry = { file->getFile()->getFile(), nullptr, file, 0, 0 };
+	m_entries.add(entry);
+}
+
+bool CheckpointThread::checkpoint()
+{
+	if (m_busy)
+	{
+		m_numSkipped++;
+		return false;
+	}
+	const int64 startTicks = Time::getHighResolutionTicks();
+	for (int i = 0; i < m_entries.size(); i++)
+	{
+		Entry& entry = m_entries.getReference(i);
+		if (entry.npyFile == nullptr)
+			continue;
+		//the header then holds the count, and every record counted is queued
+		entry.npyFile->flush();
+		entry.records = entry.npyFile->getRecordCount();
+		entry.queuedBytes = entry.npyFile->getFile()->getPosition();
+	}
+	m_busy = true;
+	m_idle.reset();
+	m_recordThreadTicks += Time::getHighResolutionTicks() - startTicks;
+	notify();
+	return true;
+}
+
+void CheckpointThread::stopRecording()
+{
+	m_idle.wait(-1);
+	if (m_numCheckpoints + m_numSkipped == 0)
+		return;
+	std::cout << "Binary checkpoints: " << m_numCheckpoints << " written, " << m_numSkipped << " skipped while the previous one was syncing, "
+		<< m_numFailed << " failed. Sync time mean " << (m_numCheckpoints > 0 ? 1000.0 * m_syncSeconds / m_numCheckpoints : 0.0)
+		<< " ms, max " << 1000.0 * m_maxSyncSeconds << " ms. Record thread time "
+		<< 1000.0 * Time::highResolutionTicksToSeconds(m_recordThreadTicks) << " ms" << std::endl;
+}
+
+String CheckpointThread::getPathName(const File& file) const
+{
+	const File folder = m_journalFile.getParentDirectory();
+	if (file.isAChildOf(folder))
+		return file.getRelativePathFrom(folder).replaceCharacter('\\', '/');
+	return file.getFullPathName();
+}
+
+bool CheckpointThread::writeCheckpoint()
+{
+	bool synced = true;
+	Array<var> files;
+	for (int i = 0; i < m_entries.size(); i++)
+	{
+		const Entry& entry = m_entries.getReference(i);
+		DynamicObject::Ptr jsonFile = new DynamicObject();
+		jsonFile->setProperty("path", getPathName(entry.path));
+		int64 validBytes = entry.dataFile ? entry.dataFile->sync() : entry.npyFile->getFile()->sync();
+		if (validBytes < 0)
+		{
+			synced = false;
+			continue;
+		}
+		jsonFile->setProperty("valid_bytes", validBytes);
+		if (entry.npyFile)
+		{
+			const int64 headerBytes = entry.npyFile->getHeaderBytes();
+			const int64 recordBytes = entry.npyFile->getRecordBytes();
+			int64 records = entry.records;
+			//records queued at the checkpoint but not written yet don't count
+			if (validBytes < entry.queuedBytes && recordBytes > 0)
+				records = jmin(records, jmax(int64(0), (validBytes - headerBytes) / recordBytes));
+			jsonFile->setProperty("header_bytes", headerBytes);
+			jsonFile->setProperty("record_bytes", recordBytes);
+			jsonFile->setProperty("records", records);
+		}
+		files.add(var(jsonFile));
+	}
+
+	DynamicObject::Ptr journal = new DynamicObject();
+	journal->setProperty("checkpoint", m_numCheckpoints + 1);
+	journal->setProperty("time", Time::getCurrentTime().toISO8601(true));
+	journal->setProperty("files", files);
+
+	//written aside and synced, so that the journal is either the previous one or the new one in full
+	File tempFile = m_journalFile.getSiblingFile(m_journalFile.getFileName() + ".tmp");
+	{
+		FileOutputStream out(tempFile);
+		if (out.failedToOpen())
+			return false;
+		out.setPosition(0);
+		out.truncate();
+		JSON::writeToStream(out, var(journal));
+		out.flush();
+		if (out.getStatus().failed())
+			return false;
+	}
+	return tempFile.moveFileTo(m_journalFile) && synced;
+}
+
+void CheckpointThread::run()
+{
+	while (!threadShouldExit())
+	{
+		wait(-1);
+		if (!m_busy)
+			continue;
+		const int64 startTicks = Time::getHighResolutionTicks();
+		if (!writeCheckpoint())
+			m_numFailed++;
+		const double seconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks);
+		m_numCheckpoints++;
+		m_syncSeconds += seconds;
+		m_maxSyncSeconds = jmax(m_maxSyncSeconds, seconds);
+		m_busy = false;
+		m_idle.signal();
+	}
+}
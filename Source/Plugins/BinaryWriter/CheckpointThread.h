@@ -0,0 +1,97 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2017 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef CHECKPOINTTHREAD_H
+#define CHECKPOINTTHREAD_H
+
+#include <RecordingLib.h>
+#include <atomic>
+
+namespace BinaryRecordingEngine
+{
+	class SequentialBlockFile;
+	class NpyFile;
+
+	/** Makes the files of a recording durable at regular intervals without stalling the record thread.
+
+	At each checkpoint the record thread hands the buffered npy data to the write service and notes the
+	record counts, and this thread then syncs every file to disk and rewrites checkpoint.json in the
+	recording folder. The journal gives, for each file, how much of it was on disk at the checkpoint and,
+	for npy files, how many records are complete, so that the files of a recording cut short by a crash
+	can be truncated and their headers repaired. It is removed once the recording has been closed normally.
+
+	A checkpoint is skipped if the previous one is still syncing, so a slow disk delays checkpoints instead
+	of queuing them.*/
+	class CheckpointThread : public Thread
+	{
+	public:
+		CheckpointThread();
+		~CheckpointThread();
+
+		/** Forgets the files of the previous recording and clears the statistics */
+		void startRecording(const File& journalFile);
+		/** Adds a file to the checkpoints. path is how the journal names it */
+		void addDataFile(const File& path, SequentialBlockFile* file);
+		void addNpyFile(NpyFile* file);
+
+		/** Called from the record thread. Flushes the npy files, notes their record counts and wakes the
+		thread to sync them. Returns false, doing nothing, if the previous checkpoint is still running */
+		bool checkpoint();
+
+		/** Waits for a running checkpoint to complete, and logs how much the checkpoints cost. Must be called
+		before the files are closed */
+		void stopRecording();
+
+		void run() override;
+
+	private:
+		struct Entry
+		{
+			File path;
+			SequentialBlockFile* dataFile;
+			NpyFile* npyFile;
+			/** Records and bytes handed to the write service at the last checkpoint */
+			int64 records;
+			int64 queuedBytes;
+		};
+
+		/** Syncs the files and writes the journal. Returns false if any of them couldn't be synced */
+		bool writeCheckpoint();
+		String getPathName(const File& file) const;
+
+		Array<Entry> m_entries;
+		File m_journalFile;
+		std::atomic<bool> m_busy;
+		WaitableEvent m_idle;
+		int m_numCheckpoints;
+		int m_numSkipped;
+		int m_numFailed;
+		double m_syncSeconds;
+		double m_maxSyncSeconds;
+		std::atomic<int64> m_recordThreadTicks;
+
+		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CheckpointThread);
+	};
+}
+
+#endif
@@ -0,0 +1,295 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2017 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "CompressedFileSource.h"
+#include "BlockCompressor.h"
+
+using namespace BinaryRecordingEngine;
+
+namespace
+{
+	inline uint32 readUint32(const void* data)
+	{
+		uint32 v;
+		memcpy(&v, data, sizeof(uint32));
+		return ByteOrder::swapIfBigEndian(v);
+	}
+
+	inline uint64 readUint64(const void* data)
+	{
+		uint64 v;
+		memcpy(&v, data, sizeof(uint64));
+		return ByteOrder::swapIfBigEndian(v);
+	}
+}
+
+CompressedFileSource::CompressedFileSource() :
+	m_numChannels(0),
+	m_framesPerBlock(0),
+	m_sampleRate(0),
+	m_numFrames(0),
+	m_decodedBlock(-1),
+	m_decodedFrames(0),
+	m_samplePos(0)
+{
+}
+
+CompressedFileSource::~CompressedFileSource()
+{
+}
+
+bool CompressedFileSource::Open(File file)
+{
+	ScopedPointer<FileInputStream> stream = file.createInputStream();
+	if (!stream || stream->failedToOpen())
+		return false;
+
+	uint8 header[COMPRESSED_HEADER_SIZE];
+	if (stream->read(header, COMPRESSED_HEADER_SIZE) != COMPRESSED_HEADER_SIZE || memcmp(header, COMPRESSED_FILE_MAGIC, 8) != 0)
+		return false;
+	if (readUint32(header + 8) != COMPRESSED_FILE_VERSION)
+	{
+		std::cerr << "Unsupported compressed file version " << readUint32(header + 8) << std::endl;
+		return false;
+	}
+	m_numChannels = int(readUint32(header + 12));
+	m_framesPerBlock = int(readUint32(header + 16));
+	memcpy(&m_sampleRate, header + 20, sizeof(float));
+	if (m_numChannels <= 0 || m_framesPerBlock <= 0)
+		return false;
+
+	m_file = file;
+	m_stream = stream.release();
+	m_blockOffsets.clear();
+	if (!readIndex() && !scanBlocks())
+		return false;
+
+	m_decoded.malloc(size_t(m_numChannels) * m_framesPerBlock);
+	m_decodedBlock = -1;
+	return true;
+}
+
+bool CompressedFileSource::readIndex()
+{
+	int64 fileSize = m_stream->getTotalLength();
+	if (fileSize < COMPRESSED_HEADER_SIZE + COMPRESSED_TRAILER_SIZE)
+		return false;
+
+	uint8 trailer[COMPRESSED_TRAILER_SIZE];
+	if (!m_stream->setPosition(fileSize - COMPRESSED_TRAILER_SIZE) || m_stream->read(trailer, COMPRESSED_TRAILER_SIZE) != COMPRESSED_TRAILER_SIZE)
+		return false;
+	if (memcmp(trailer + 16, COMPRESSED_INDEX_MAGIC, 8) != 0)
+		return false;
+
+	int64 nBlocks = int64(readUint64(trailer));
+	int64 indexStart = fileSize - COMPRESSED_TRAILER_SIZE - nBlocks * int64(sizeof(uint64));
+	if (nBlocks < 0 || indexStart < COMPRESSED_HEADER_SIZE)
+		return false;
+
+	HeapBlock<uint64> index(nBlocks + 1);
+	if (!m_stream->setPosition(indexStart) || m_stream->read(index, int(nBlocks * sizeof(uint64))) != int(nBlocks * sizeof(uint64)))
+		return false;
+	for (int64 i = 0; i < nBlocks; i++)
+		m_blockOffsets.add(int64(ByteOrder::swapIfBigEndian(index[i])));
+	m_numFrames = int64(readUint64(trailer + 8));
+	return true;
+}
+
+bool CompressedFileSource::scanBlocks()
+{
+	std::cerr << "No index in " << m_file.getFullPathName() << ", scanning its blocks" << std::endl;
+	m_blockOffsets.clear();
+	m_numFrames = 0;
+
+	const int64 fileSize = m_stream->getTotalLength();
+	const int headerSize = int(sizeof(uint32)) * (2 + m_numChannels);
+	HeapBlock<uint8> blockHeader(headerSize);
+	int64 pos = COMPRESSED_HEADER_SIZE;
+	while (pos + headerSize <= fileSize)
+	{
+		if (!m_stream->setPosition(pos) || m_stream->read(blockHeader, headerSize) != headerSize)
+			break;
+		if (readUint32(blockHeader) != COMPRESSED_BLOCK_MAGIC)
+			break;
+		int64 size = headerSize;
+		for (int c = 0; c < m_numChannels; c++)
+			size += readUint32(blockHeader + sizeof(uint32) * (2 + c));
+		//a block cut short by a crash is dropped
+		if (pos + size > fileSize)
+			break;
+		m_blockOffsets.add(pos);
+		m_numFrames += readUint32(blockHeader + sizeof(uint32));
+		pos += size;
+	}
+	//with no complete block, the recording is empty rather than unreadable
+	return true;
+}
+
+void CompressedFileSource::fillRecordInfo()
+{
+	RecordInfo info;
+	info.name = m_file.getParentDirectory().getFileName();
+	info.numSamples = m_numFrames;
+	info.sampleRate = m_sampleRate;
+	for (int c = 0; c < m_numChannels; c++)
+	{
+		RecordedChannelInfo chan;
+		chan.name = "CH" + String(c + 1);
+		chan.bitVolts = 1.0f;
+		info.channels.add(chan);
+	}
+	readChannelInfo(info);
+	infoArray.add(info);
+	numRecords = 1;
+}
+
+void CompressedFileSource::readChannelInfo(RecordInfo& info) const
+{
+	//<recording>/continuous/<processor folder>/continuous.cdat
+	File processorFolder = m_file.getParentDirectory();
+	File structureFile = processorFolder.getParentDirectory().getParentDirectory().getChildFile("structure.oebin");
+	if (!structureFile.existsAsFile())
+		return;
+
+	var structure = JSON::parse(structureFile);
+	const Array<var>* continuous = structure["continuous"].getArray();
+	if (continuous == nullptr)
+		return;
+
+	for (int i = 0; i < continuous->size(); i++)
+	{
+		const var& entry = continuous->getReference(i);
+		String folder = entry["folder_name"].toString().trimCharactersAtEnd("/");
+		if (folder.fromLastOccurrenceOf("/", false, false) != processorFolder.getFileName())
+			continue;
+
+		info.sampleRate = float(entry["sample_rate"]);
+		info.name = entry["source_processor_name"].toString() + " " + folder;
+		const Array<var>* channels = entry["channels"].getArray();
+		if (channels == nullptr)
+			return;
+		for (int c = 0; c < jmin(channels->size(), info.channels.size()); c++)
+		{
+			info.channels.getReference(c).name = channels->getReference(c)["channel_name"].toString();
+			info.channels.getReference(c).bitVolts = float(channels->getReference(c)["bit_volts"]);
+		}
+		return;
+	}
+}
+
+void CompressedFileSource::updateActiveRecord()
+{
+	m_samplePos = 0;
+}
+
+void CompressedFileSource::seekTo(int64 sample)
+{
+	//an empty recording has no position to wrap around
+	const int64 numSamples = getActiveNumSamples();
+	m_samplePos = (numSamples > 0) ? sample % numSamples : 0;
+}
+
+bool CompressedFileSource::loadBlock(int block)
+{
+	if (block == m_decodedBlock)
+		return true;
+	m_decodedBlock = -1;
+	if (block < 0 || block >= m_blockOffsets.size())
+		return false;
+
+	int64 start = m_blockOffsets[block];
+	int64 end = block + 1 < m_blockOffsets.size() ? m_blockOffsets[block + 1] : m_stream->getTotalLength();
+	const int headerSize = int(sizeof(uint32)) * (2 + m_numChannels);
+	int64 size = headerSize;
+
+	m_compressed.ensureSize(headerSize);
+	if (!m_stream->setPosition(start) || m_stream->read(m_compressed.getData(), headerSize) != headerSize)
+		return false;
+	const uint8* header = static_cast<const uint8*>(m_compressed.getData());
+	if (readUint32(header) != COMPRESSED_BLOCK_MAGIC)
+		return false;
+	int nFrames = int(readUint32(header + sizeof(uint32)));
+	if (nFrames > m_framesPerBlock)
+		return false;
+	for (int c = 0; c < m_numChannels; c++)
+		size += readUint32(header + sizeof(uint32) * (2 + c));
+	if (start + size > end)
+		return false;
+
+	m_compressed.ensureSize(size_t(size));
+	uint8* data = static_cast<uint8*>(m_compressed.getData());
+	if (m_stream->read(data + headerSize, int(size - headerSize)) != int(size - headerSize))
+		return false;
+
+	const uint8* channelData = data + headerSize;
+	for (int c = 0; c < m_numChannels; c++)
+	{
+		size_t channelSize = readUint32(data + sizeof(uint32) * (2 + c));
+		if (!BlockCompressor::decompressChannel(channelData, channelSize, nFrames, m_decoded + c, m_numChannels))
+		{
+			std::cerr << "Corrupt block " << block << " in " << m_file.getFullPathName() << std::endl;
+			return false;
+		}
+		channelData += channelSize;
+	}
+	m_decodedBlock = block;
+	m_decodedFrames = nFrames;
+	return true;
+}
+
+int CompressedFileSource::readData(int16* buffer, int nSamples)
+{
+	int samplesRead = 0;
+	int64 numFrames = getActiveNumSamples();
+	while (samplesRead < nSamples && m_samplePos < numFrames)
+	{
+		int block = int(m_samplePos / m_framesPerBlock);
+		if (!loadBlock(block))
+			break;
+		int offset = int(m_samplePos - int64(block) * m_framesPerBlock);
+		int count = jmin(nSamples - samplesRead, m_decodedFrames - offset);
+		if (count <= 0)
+			break;
+		memcpy(buffer + size_t(samplesRead) * m_numChannels, m_decoded + size_t(offset) * m_numChannels, size_t(count) * m_numChannels * sizeof(int16));
+		samplesRead += count;
+		m_samplePos += count;
+	}
+	return samplesRead;
+}
+
+void CompressedFileSource::processChannelData(int16* inBuffer, float* outBuffer, int channel, int64 numSamples)
+{
+	int n = getActiveNumChannels();
+	float bitVolts = getChannelInfo(channel).bitVolts;
+
+	for (int i = 0; i < numSamples; i++)
+	{
+		*(outBuffer + i) = *(inBuffer + (n*i) + channel) * bitVolts;
+	}
+}
+
+void CompressedFileSource::processAllChannelsData(int16* inBuffer, float* const* outBuffers, int64 numSamples)
+{
+	deinterleaveChannels(inBuffer, outBuffers, activeBitVolts.getRawDataPointer(), getActiveNumChannels(), numSamples);
+}
@@ -0,0 +1,77 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2017 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef COMPRESSEDFILESOURCE_H
+#define COMPRESSEDFILESOURCE_H
+
+#include <FileSourceHeaders.h>
+
+namespace BinaryRecordingEngine
+{
+	/** Reads the compressed continuous.cdat files of the Binary engine in the File Reader.
+
+	Blocks are located through the index at the end of the file, or by walking the block headers if the
+	recording wasn't closed properly. Only the block holding the read position is decoded. Channel names
+	and bit volts come from the structure.oebin file of the recording, when found next to the data.*/
+	class CompressedFileSource : public FileSource
+	{
+	public:
+		CompressedFileSource();
+		~CompressedFileSource();
+
+		int readData(int16* buffer, int nSamples) override;
+		void seekTo(int64 sample) override;
+		void processChannelData(int16* inBuffer, float* outBuffer, int channel, int64 numSamples) override;
+		void processAllChannelsData(int16* inBuffer, float* const* outBuffers, int64 numSamples) override;
+
+	private:
+		bool Open(File file) override;
+		void fillRecordInfo() override;
+		void updateActiveRecord() override;
+
+		bool readIndex();
+		bool scanBlocks();
+		/** Decodes the block into m_decoded, if not already there */
+		bool loadBlock(int block);
+		void readChannelInfo(RecordInfo& info) const;
+
+		File m_file;
+		ScopedPointer<FileInputStream> m_stream;
+		int m_numChannels;
+		int m_framesPerBlock;
+		float m_sampleRate;
+		int64 m_numFrames;
+		Array<int64> m_blockOffsets;
+
+		int m_decodedBlock;
+		int m_decodedFrames;
+		HeapBlock<int16> m_decoded;
+		MemoryBlock m_compressed;
+		int64 m_samplePos;
+
+		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CompressedFileSource);
+	};
+}
+
+#endif
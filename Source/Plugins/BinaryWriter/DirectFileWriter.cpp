@@ -0,0 +1,256 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2017 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "DirectFileWriter.h"
+
+#if JUCE_WINDOWS
+ #include <windows.h>
+#else
+ #include <fcntl.h>
+ #include <unistd.h>
+ #include <sys/stat.h>
+#endif
+
+using namespace BinaryRecordingEngine;
+
+DirectFileWriter::DirectFileWriter() :
+#if JUCE_WINDOWS
+	m_handle(INVALID_HANDLE_VALUE),
+#else
+	m_fd(-1),
+#endif
+	m_unbuffered(false),
+	m_position(0),
+	m_fileSize(0)
+{
+}
+
+DirectFileWriter::~DirectFileWriter()
+{
+	close();
+}
+
+#if JUCE_WINDOWS
+
+bool DirectFileWriter::open(const File& file, bool unbuffered, int64 preallocateBytes)
+{
+	close();
+	const DWORD flags = FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN;
+	if (unbuffered)
+		m_handle = CreateFileW(file.getFullPathName().toWideCharPointer(), GENERIC_WRITE, FILE_SHARE_READ, 0,
+			CREATE_ALWAYS, flags | FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH, 0);
+	m_unbuffered = unbuffered && m_handle != INVALID_HANDLE_VALUE;
+	if (!m_unbuffered)
+	{
+		if (unbuffered)
+			std::cerr << "BINARY WRITER: unbuffered writes not supported for " << file.getFullPathName() << ", using buffered writes" << std::endl;
+		m_handle = CreateFileW(file.getFullPathName().toWideCharPointer(), GENERIC_WRITE, FILE_SHARE_READ, 0,
+			CREATE_ALWAYS, flags, 0);
+	}
+	if (m_handle == INVALID_HANDLE_VALUE)
+		return false;
+
+	m_position = 0;
+	m_fileSize = 0;
+	preallocate(preallocateBytes);
+	return true;
+}
+
+void DirectFileWriter::preallocate(int64 bytes)
+{
+	if (bytes <= 0)
+		return;
+
+	LARGE_INTEGER size;
+	size.QuadPart = bytes;
+	if (SetFilePointerEx(m_handle, size, 0, FILE_BEGIN) && SetEndOfFile(m_handle))
+	{
+		//Only allowed with the volume maintenance privilege. Without it, the OS zero-fills the space as it is written
+		SetFileValidData(m_handle, bytes);
+		m_fileSize = bytes;
+	}
+	size.QuadPart = 0;
+	SetFilePointerEx(m_handle, size, 0, FILE_BEGIN);
+}
+
+bool DirectFileWriter::writeBytes(const void* data, size_t size)
+{
+	const char* ptr = static_cast<const char*>(data);
+	while (size > 0)
+	{
+		DWORD chunk = DWORD(jmin(size, size_t(1) << 30));
+		DWORD written = 0;
+		if (!WriteFile(m_handle, ptr, chunk, &written, 0) || written == 0)
+			return false;
+		ptr += written;
+		size -= written;
+	}
+	return true;
+}
+
+void DirectFileWriter::close()
+{
+	if (m_handle == INVALID_HANDLE_VALUE)
+		return;
+
+	if (m_fileSize > m_position)
+	{
+		LARGE_INTEGER size;
+		size.QuadPart = m_position;
+		SetFilePointerEx(m_handle, size, 0, FILE_BEGIN);
+		SetEndOfFile(m_handle);
+	}
+	CloseHandle(m_handle);
+	m_handle = INVALID_HANDLE_VALUE;
+}
+
+bool DirectFileWriter::isOpen() const
+{
+	return m_handle != INVALID_HANDLE_VALUE;
+}
+
+bool DirectFileWriter::sync()
+{
+	return m_handle != INVALID_HANDLE_VALUE && FlushFileBuffers(m_handle) != 0;
+}
+
+#else
+
+bool DirectFileWriter::open(const File& file, bool unbuffered, int64 preallocateBytes)
+{
+	close();
+	const char* path = file.getFullPathName().toRawUTF8();
+	int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#if defined (O_DIRECT)
+	if (unbuffered)
+		m_fd = ::open(path, flags | O_DIRECT, 0644);
+#endif
+	m_unbuffered = unbuffered && m_fd >= 0;
+	if (m_fd < 0)
+		m_fd = ::open(path, flags, 0644);
+	if (m_fd < 0)
+		return false;
+#if JUCE_MAC
+	if (unbuffered)
+		m_unbuffered = fcntl(m_fd, F_NOCACHE, 1) != -1;
+#endif
+	if (unbuffered && !m_unbuffered)
+		std::cerr << "BINARY WRITER: unbuffered writes not supported for " << file.getFullPathName() << ", using buffered writes" << std::endl;
+
+	m_position = 0;
+	m_fileSize = 0;
+	preallocate(preallocateBytes);
+	return true;
+}
+
+void DirectFileWriter::preallocate(int64 bytes)
+{
+	if (bytes <= 0)
+		return;
+#if JUCE_MAC
+	fstore_t store = { F_ALLOCATECONTIG, F_PEOFPOSMODE, 0, bytes, 0 };
+	if (fcntl(m_fd, F_PREALLOCATE, &store) == -1)
+	{
+		store.fst_flags = F_ALLOCATEALL;
+		fcntl(m_fd, F_PREALLOCATE, &store);
+	}
+	//F_PREALLOCATE reserves blocks without changing the file length, so there's nothing to cut back
+#else
+	if (posix_fallocate(m_fd, 0, bytes) == 0)
+		m_fileSize = bytes;
+#endif
+}
+
+bool DirectFileWriter::writeBytes(const void* data, size_t size)
+{
+	const char* ptr = static_cast<const char*>(data);
+	while (size > 0)
+	{
+		ssize_t written = ::write(m_fd, ptr, size);
+		if (written <= 0)
+			return false;
+		ptr += written;
+		size -= size_t(written);
+	}
+	return true;
+}
+
+void DirectFileWriter::close()
+{
+	if (m_fd < 0)
+		return;
+
+	if (m_fileSize > m_position)
+		ftruncate(m_fd, m_position);
+	::close(m_fd);
+	m_fd = -1;
+}
+
+bool DirectFileWriter::isOpen() const
+{
+	return m_fd >= 0;
+}
+
+bool DirectFileWriter::sync()
+{
+	if (m_fd < 0)
+		return false;
+#if JUCE_MAC
+	//fsync only reaches the drive's cache on OS X
+	if (fcntl(m_fd, F_FULLFSYNC) == 0)
+		return true;
+	return fsync(m_fd) == 0;
+#else
+	return fdatasync(m_fd) == 0;
+#endif
+}
+
+#endif
+
+bool DirectFileWriter::isUnbuffered() const
+{
+	return m_unbuffered;
+}
+
+bool DirectFileWriter::write(const void* data, size_t size)
+{
+	jassert(!m_unbuffered || ((size % getAlignment()) == 0 && (pointer_sized_int(data) % getAlignment()) == 0));
+	if (!writeBytes(data, size))
+		return false;
+	m_position += size;
+	return true;
+}
+
+bool DirectFileWriter::writeFinal(const void* data, size_t size)
+{
+	if (!m_unbuffered)
+		return write(data, size);
+
+	//the padding goes to disk and is cut off on close
+	size_t padded = alignSize(size);
+	if (!writeBytes(data, padded))
+		return false;
+	m_position += size;
+	m_fileSize = jmax(m_fileSize, m_position + int64(padded - size));
+	return true;
+}
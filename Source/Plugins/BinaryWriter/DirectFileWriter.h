@@ -0,0 +1,80 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2017 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DIRECTFILEWRITER_H
+#define DIRECTFILEWRITER_H
+
+#include <BasicJuceHeader.h>
+
+namespace BinaryRecordingEngine
+{
+	/** Sequential file writer that can bypass the operating system's page cache.
+
+	In unbuffered mode (O_DIRECT on Linux, F_NOCACHE on OS X, FILE_FLAG_NO_BUFFERING on Windows)
+	every write must start from memory aligned to getAlignment() and have a size multiple of it;
+	the last, partial chunk is padded with writeFinal() and the file cut back to its real length
+	on close. If the file system doesn't support unbuffered writes, the file is opened buffered.
+
+	Space can be preallocated to avoid fragmentation and allocation stalls during the recording.
+	Any preallocated space not written is released on close.*/
+	class DirectFileWriter
+	{
+	public:
+		DirectFileWriter();
+		~DirectFileWriter();
+
+		bool open(const File& file, bool unbuffered, int64 preallocateBytes);
+		void close();
+		bool isOpen() const;
+		bool isUnbuffered() const;
+
+		bool write(const void* data, size_t size);
+		/** Writes the last size bytes of the file. In unbuffered mode data must have room for size
+		rounded up to the alignment, the padding being written and then cut off */
+		bool writeFinal(const void* data, size_t size);
+
+		/** Waits until the data written so far is on disk. Can be called from another thread than the one writing */
+		bool sync();
+
+		/** The alignment unbuffered writes need, in both memory and size */
+		static size_t getAlignment() { return 4096; }
+		static size_t alignSize(size_t size) { return (size + getAlignment() - 1) & ~(getAlignment() - 1); }
+
+	private:
+		bool writeBytes(const void* data, size_t size);
+		void preallocate(int64 bytes);
+
+#if JUCE_WINDOWS
+		void* m_handle;
+#else
+		int m_fd;
+#endif
+		bool m_unbuffered;
+		int64 m_position;
+		int64 m_fileSize;
+
+		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DirectFileWriter);
+	};
+}
+
+#endif
@@ -29,39 +29,33 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 namespace BinaryRecordingEngine
 {
 
+	/** A zeroed chunk of a file being filled in memory. Blocks are recycled once written:
+	the writer clears them and they are given another offset.
+	The data is aligned to 4096 bytes, as unbuffered file writes need */
 	template <class StorageType = int16>
 	class FileMemoryBlock
 	{
 	public:
-		FileMemoryBlock(FileOutputStream* file, int blockSize, uint64 offset) :
-			m_data(blockSize, true),
-			m_file(file),
+		FileMemoryBlock(int blockSize, uint64 offset) :
+			m_storage(blockSize*sizeof(StorageType) + dataAlignment, true),
 			m_blockSize(blockSize),
 			m_offset(offset)
-		{};
-		~FileMemoryBlock() {
-			if (!m_flushed)
-			{
-				m_file->write(m_data, m_blockSize*sizeof(StorageType));
-			}
+		{
+			m_data = reinterpret_cast<StorageType*>((pointer_sized_int(m_storage.getData()) + dataAlignment - 1) & ~pointer_sized_int(dataAlignment - 1));
 		};
 
-		inline uint64 getOffset() { return m_offset; }
-		inline StorageType* getData() { return m_data.getData(); }
-		void partialFlush(size_t size, bool markFlushed = true)
-		{
-			std::cout << "flushing last block " << size << std::endl;
-			m_file->write(m_data, size*sizeof(StorageType));
-			if (markFlushed)
-				m_flushed = true;
-		}
+		inline uint64 getOffset() const { return m_offset; }
+		inline void setOffset(uint64 offset) { m_offset = offset; }
+		inline StorageType* getData() { return m_data; }
+		inline int getBlockSize() const { return m_blockSize; }
+		void clear(size_t size) { zeromem(m_data, size*sizeof(StorageType)); }
 
 	private:
-		HeapBlock<StorageType> m_data;
-		FileOutputStream* const m_file;
+		static const int dataAlignment = 4096;
+		HeapBlock<char> m_storage;
+		StorageType* m_data;
 		const int m_blockSize;
-		const uint64 m_offset;
-		bool m_flushed{ false };
+		uint64 m_offset;
 		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FileMemoryBlock);
 	};
 }
@@ -25,7 +25,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 using namespace BinaryRecordingEngine;
 
-NpyFile::NpyFile(String path, const Array<NpyType>& typeList)
+NpyFile::NpyFile(AsyncWriteFile* file, const Array<NpyType>& typeList)
+	: m_file(file)
 {
 		
 	m_dim1 = 1;
@@ -40,44 +41,35 @@ NpyFile::NpyFile(String path, const Array<NpyType>& typeList)
 		if (type.getType() != BaseType::CHAR) //strings work different
 			m_dim1 = type.getTypeLength();
 	}
+	for (int i = 0; i < typeList.size(); i++)
+		m_recordBytes += typeList[i].getTypeBytes();
 	
-	if (!openFile(path))
+	if (!m_file)
 		return;
+	m_okOpen = true;
+	m_buffer.malloc(NPY_BUFFER_BYTES);
 	writeHeader(typeList);
 		
 }
 
-NpyFile::NpyFile(String path, NpyType type, unsigned int dim)
+NpyFile::NpyFile(AsyncWriteFile* file, NpyType type, unsigned int dim)
+	: m_file(file)
 {
 	
-	if (!openFile(path))
+	if (!m_file)
 		return;
+	m_okOpen = true;
+	m_buffer.malloc(NPY_BUFFER_BYTES);
 
 	Array<NpyType> typeList;
 	typeList.add(type);
 	m_dim1 = dim;
 	m_dim2 = type.getTypeLength();
+	m_recordBytes = dim * type.getTypeBytes();
 	writeHeader(typeList);
 
 }
 
-bool NpyFile::openFile(String path)
-{
-	File file(path);
-	Result res = file.create();
-	if (res.failed())
-	{
-		std::cerr << "Error creating file " << path << ":" << res.getErrorMessage() << std::endl;
-		return false;
-	}
-	m_file = file.createOutputStream();
-	if (!m_file)
-		return false;
-
-	m_okOpen = true;
-	return true;
-}
-
 void NpyFile::writeHeader(const Array<NpyType>& typeList)
 {
 	bool multiValue = typeList.size() > 1;
@@ -104,7 +96,9 @@ void NpyFile::writeHeader(const Array<NpyType>& typeList)
 
 	m_countPos = header.length() + 10;
 	header += "(1,), }";
-	int padding = (int((header.length() + 30) / 16) + 1) * 16;
+	//room for the final shape, with the data starting on a 64 byte boundary as numpy itself does,
+	//counting the 10 bytes before the header and the closing newline
+	int padding = (int((header.length() + 30 + 11) / 64) + 1) * 64 - 11;
 	header = header.paddedRight(' ', padding);
 	header += '\n';
 
@@ -117,33 +111,73 @@ void NpyFile::writeHeader(const Array<NpyType>& typeList)
 	m_file->write(&ver, sizeof(uint16));
 	m_file->write(&len, sizeof(uint16));
 	m_file->write(header.toUTF8(), len);
+	m_headerBytes = 10 + len;
 }
 
 NpyFile::~NpyFile()
 {
-	if (m_file->setPosition(m_countPos))
+	if (!m_okOpen)
+		return;
+
+	flush();
+}
+
+void NpyFile::updateHeader()
+{
+	//the count only grows, so the new shape always covers the previous one
+	if (m_recordCount == m_headerCount)
+		return;
+	m_headerCount = m_recordCount;
+
+	String newShape = "(";
+	newShape.preallocateBytes(20);
+	newShape += String(m_recordCount) + ",";
+	if (m_dim1 > 1)
 	{
-		String newShape = "(";
-		newShape.preallocateBytes(20);
-		newShape += String(m_recordCount) + ",";
-		if (m_dim1 > 1)
-		{
-			newShape += String(m_dim1) + ",";
-		}
-		if (m_dim2 > 1)
-			newShape += String(m_dim2);
-		newShape += "), }";
-		m_file->write(newShape.toUTF8(), newShape.getNumBytesAsUTF8());
+		newShape += String(m_dim1) + ",";
 	}
-	else
+	if (m_dim2 > 1)
+		newShape += String(m_dim2);
+	newShape += "), }";
+	m_file->writeAt(m_countPos, newShape.toUTF8(), newShape.getNumBytesAsUTF8());
+}
+
+void NpyFile::writeData(const void* data, size_t size)
+{
+	if (!m_okOpen)
+		return;
+
+	if (m_bufferedBytes + size > NPY_BUFFER_BYTES)
+		flush();
+	if (size > NPY_BUFFER_BYTES)
 	{
-		std::cerr << "Error. Unable to seek to update header on file " << m_file->getFile().getFullPathName() << std::endl;
+		m_file->write(data, size);
+		return;
 	}
+	if (m_bufferedBytes == 0)
+		m_bufferStartTime = Time::getMillisecondCounter();
+	memcpy(m_buffer.getData() + m_bufferedBytes, data, size);
+	m_bufferedBytes += size;
 }
 
-void NpyFile::writeData(const void* data, size_t size)
+void NpyFile::flush()
 {
-	m_file->write(data, size);
+	if (!m_okOpen)
+		return;
+
+	if (m_bufferedBytes > 0)
+	{
+		m_file->write(m_buffer.getData(), m_bufferedBytes);
+		m_bufferedBytes = 0;
+	}
+	//the data written may end partway through a record, but readers only go as far as the count says
+	updateHeader();
+}
+
+void NpyFile::flushIfStale()
+{
+	if (m_bufferedBytes > 0 && Time::getMillisecondCounter() - m_bufferStartTime > NPY_FLUSH_INTERVAL_MS)
+		flush();
 }
 
 void NpyFile::increaseRecordCount(int count)
@@ -151,6 +185,26 @@ void NpyFile::increaseRecordCount(int count)
 	m_recordCount += count;
 }
 
+AsyncWriteFile* NpyFile::getFile() const
+{
+	return m_file;
+}
+
+int64 NpyFile::getRecordCount() const
+{
+	return m_recordCount;
+}
+
+size_t NpyFile::getHeaderBytes() const
+{
+	return m_headerBytes;
+}
+
+size_t NpyFile::getRecordBytes() const
+{
+	return m_recordBytes;
+}
+
 
 NpyType::NpyType(String n, BaseType t, size_t l)
 	: name(n), type(t), length(l)
@@ -199,6 +253,14 @@ String NpyType::getTypeString() const
 	}
 }
 
+size_t NpyType::getTypeBytes() const
+{
+	if (type == BaseType::CHAR)
+		return length + 1;
+	else
+		return MetaDataDescriptor::getTypeSize(type) * length;
+}
+
 int NpyType::getTypeLength() const
 {
 	if (type == BaseType::CHAR)
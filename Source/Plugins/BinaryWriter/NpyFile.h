@@ -26,6 +26,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <RecordingLib.h>
 
+//Appends are gathered in memory up to this size before being handed to the write service
+#define NPY_BUFFER_BYTES 16384
+//and are not held back for longer than this
+#define NPY_FLUSH_INTERVAL_MS 1000
+
 namespace BinaryRecordingEngine
 {
 
@@ -38,6 +43,8 @@ namespace BinaryRecordingEngine
 		String getName() const;
 		String getTypeString() const;
 		int getTypeLength() const;
+		/** Bytes the type takes in each record */
+		size_t getTypeBytes() const;
 		BaseType getType() const;
 	private:
 		String name;
@@ -48,18 +55,38 @@ namespace BinaryRecordingEngine
 	class NpyFile
 	{
 	public:
-		NpyFile(String path, const Array<NpyType>& typeList);
-		NpyFile(String path, NpyType type, unsigned int dim = 1);
+		/** The file is written through the given AsyncWriteFile, which must outlive this object.
+		Appended data is buffered, and the record count in the header is updated whenever the buffer
+		is flushed and when the object is destroyed. A null file is ignored. */
+		NpyFile(AsyncWriteFile* file, const Array<NpyType>& typeList);
+		NpyFile(AsyncWriteFile* file, NpyType type, unsigned int dim = 1);
 		~NpyFile();
 		void writeData(const void* data, size_t size);
 		void increaseRecordCount(int count = 1);
+		/** Hands the buffered data to the write service */
+		void flush();
+		/** Flushes if the oldest buffered data has waited longer than NPY_FLUSH_INTERVAL_MS */
+		void flushIfStale();
+
+		/** The file written, nullptr if none */
+		AsyncWriteFile* getFile() const;
+		int64 getRecordCount() const;
+		/** Where the records start in the file, and the size of each */
+		size_t getHeaderBytes() const;
+		size_t getRecordBytes() const;
 	private:
-		bool openFile(String path);
 		void writeHeader(const Array<NpyType>& typeList);
-		ScopedPointer<FileOutputStream> m_file;
+		void updateHeader();
+		AsyncWriteFile* m_file;
 		bool m_okOpen{ false };
 		int64 m_recordCount{ 0 };
+		int64 m_headerCount{ -1 };
+		HeapBlock<char> m_buffer;
+		size_t m_bufferedBytes{ 0 };
+		uint32 m_bufferStartTime{ 0 };
 		size_t m_countPos;
+		size_t m_headerBytes{ 0 };
+		size_t m_recordBytes{ 0 };
 		unsigned int m_dim1;
 		unsigned int m_dim2;
 	};
@@ -22,14 +22,22 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "SequentialBlockFile.h"
+#include <VectorLib.h>
 
 using namespace BinaryRecordingEngine;
 
-SequentialBlockFile::SequentialBlockFile(int nChannels, int samplesPerBlock) :
+void SequentialBlockFile::interleaveChannels(int16* dst, const int16* const* data, int dataOffset, int nChannels, int nSamples)
+{
+	VectorOps::interleave(dst, data, dataOffset, nChannels, nSamples);
+}
+
+SequentialBlockFile::SequentialBlockFile(int nChannels, int samplesPerBlock, BlockFlushThread* flushThread) :
 m_file(nullptr),
 m_nChannels(nChannels),
 m_samplesPerBlock(samplesPerBlock),
 m_blockSize(nChannels*samplesPerBlock),
+m_flushThread(flushThread),
+m_pendingBlocks(0),
 m_lastBlockFill(0)
 {
 	m_memBlocks.ensureStorageAllocated(blockArrayInitSize);
@@ -39,18 +47,152 @@ m_lastBlockFill(0)
 
 SequentialBlockFile::~SequentialBlockFile()
 {
-	//Ensure that all remaining blocks are flushed in order. Keep the last one
+	//Ensure that all remaining blocks are flushed in order, the last one only up to its last sample to avoid trailing zeroes
 	int n = m_memBlocks.size();
-	for (int i = 0; i < n - 1; i++)
+	for (int i = 0; i < n; i++)
+	{
+		if (i < n - 1)
+			retireBlock(m_memBlocks[i], m_blockSize);
+		else
+		{
+			std::cout << "flushing last block " << m_lastBlockFill * m_nChannels << std::endl;
+			retireBlock(m_memBlocks[i], m_lastBlockFill * m_nChannels, true);
+		}
+	}
+	m_memBlocks.clear();
+
+	//the file and the blocks must outlive the writes. The flush thread leaves the lock as its last use of this file
+	for (;;)
+	{
+		{
+			const ScopedLock sl(m_freeBlocksLock);
+			if (m_pendingBlocks == 0)
+				break;
+		}
+		m_blockWritten.wait(100);
+	}
+
+	//a compressed file whose blocks were never allocated still gets its empty index, for readers to open it
+	if (n == 0 && m_file && m_compressor)
+		writeCompressedBlock(nullptr, 0, true);
+}
+
+FileBlock* SequentialBlockFile::getFreeBlock(uint64 offset)
+{
+	FileBlock* block = nullptr;
+	{
+		const ScopedLock sl(m_freeBlocksLock);
+		if (m_freeBlocks.size() > 0)
+			block = m_freeBlocks.remove(m_freeBlocks.size() - 1);
+	}
+	if (block == nullptr)
+	{
+		//the disk is falling behind, grow the pool
+		block = m_allBlocks.add(new FileBlock(m_blockSize, offset));
+	}
+	block->setOffset(offset);
+	return block;
+}
+
+void SequentialBlockFile::retireBlock(FileBlock* block, size_t numItems, bool lastBlock)
+{
+	m_pendingBlocks++;
+	if (m_flushThread)
+		m_flushThread->queueBlock(this, block, numItems, lastBlock);
+	else
+		writeBlock(block, numItems, lastBlock);
+}
+
+void SequentialBlockFile::writeBlock(FileBlock* block, size_t numItems, bool lastBlock)
+{
+	const int64 startTicks = Time::getHighResolutionTicks();
+	//the last block is padded to the sector size for unbuffered writes; the rest of the block is zeroes
+	if (m_compressor)
+		writeCompressedBlock(block, numItems, lastBlock);
+	else
+	{
+		if (lastBlock)
+			m_file->writeFinal(block->getData(), numItems*sizeof(int16));
+		else if (numItems > 0)
+			m_file->write(block->getData(), numItems*sizeof(int16));
+		m_bytesWritten += numItems*sizeof(int16);
+	}
+	m_writeTicks += Time::getHighResolutionTicks() - startTicks;
+	block->clear(numItems);
+	{
+		const ScopedLock sl(m_freeBlocksLock);
+		m_freeBlocks.add(block);
+		m_blockWritten.signal();
+		m_pendingBlocks--;
+	}
+}
+
+int64 SequentialBlockFile::sync()
+{
+	//blocks are written in order, so whatever had been written before the sync starts is contiguous
+	int64 validBytes = m_bytesWritten + (m_compressor ? COMPRESSED_HEADER_SIZE : 0);
+	if (m_file == nullptr || !m_file->sync())
+		return -1;
+	return validBytes;
+}
+
+int64 SequentialBlockFile::getBytesWritten() const
+{
+	return m_bytesWritten;
+}
+
+double SequentialBlockFile::getWriteSeconds() const
+{
+	return Time::highResolutionTicksToSeconds(m_writeTicks);
+}
+
+void SequentialBlockFile::setCompression(BlockCompressor* compressor, float sampleRate)
+{
+	m_compressor = compressor;
+	m_sampleRate = sampleRate;
+}
+
+void SequentialBlockFile::writeCompressedHeader()
+{
+	uint32 values[3] = { ByteOrder::swapIfBigEndian(uint32(COMPRESSED_FILE_VERSION)),
+		ByteOrder::swapIfBigEndian(uint32(m_nChannels)),
+		ByteOrder::swapIfBigEndian(uint32(m_samplesPerBlock)) };
+	float sampleRate = m_sampleRate;
+	uint8 header[COMPRESSED_HEADER_SIZE];
+	memcpy(header, COMPRESSED_FILE_MAGIC, 8);
+	memcpy(header + 8, values, sizeof(values));
+	memcpy(header + 20, &sampleRate, sizeof(float));
+	m_file->write(header, COMPRESSED_HEADER_SIZE);
+	m_compressedPosition = COMPRESSED_HEADER_SIZE;
+}
+
+void SequentialBlockFile::writeCompressedBlock(FileBlock* block, size_t numItems, bool lastBlock)
+{
+	int nFrames = int((numItems + m_nChannels - 1) / m_nChannels);
+	if (nFrames > 0)
 	{
-		m_memBlocks.remove(0);
+		size_t size = m_compressor->compressBlock(block->getData(), m_nChannels, nFrames, m_compressedBlock);
+		m_file->write(m_compressedBlock.getData(), size);
+		m_bytesWritten += size;
+		m_blockOffsets.add(m_compressedPosition);
+		m_compressedPosition += size;
+		m_compressedFrames += nFrames;
 	}
+	if (!lastBlock)
+		return;
 
-	//manually flush the last one to avoid trailing zeroes
-	m_memBlocks[0]->partialFlush(m_lastBlockFill * m_nChannels);
+	//the index, so readers can seek without walking the blocks
+	int nBlocks = m_blockOffsets.size();
+	HeapBlock<uint64> index(nBlocks + 2);
+	for (int i = 0; i < nBlocks; i++)
+		index[i] = ByteOrder::swapIfBigEndian(m_blockOffsets[i]);
+	index[nBlocks] = ByteOrder::swapIfBigEndian(uint64(nBlocks));
+	index[nBlocks + 1] = ByteOrder::swapIfBigEndian(m_compressedFrames);
+	m_file->write(index, (nBlocks + 2) * sizeof(uint64));
+	m_file->write(COMPRESSED_INDEX_MAGIC, 8);
 }
 
-bool SequentialBlockFile::openFile(String filename)
+bool SequentialBlockFile::openFile(String filename, bool unbuffered, int64 preallocateBytes)
 {
 	File file(filename);
 	Result res = file.create();
@@ -59,19 +201,30 @@ bool SequentialBlockFile::openFile(String filename)
 		std::cerr << "Error creating file " << filename << ":" << res.getErrorMessage() << std::endl;
 		return false;
 	}
-	m_file = file.createOutputStream(streamBufferSize);
-	if (!m_file)
+	m_file = new DirectFileWriter();
+	//compressed blocks have arbitrary sizes, and the final size isn't known
+	if (m_compressor)
+	{
+		unbuffered = false;
+		preallocateBytes = 0;
+	}
+	if (!m_file->open(file, unbuffered, preallocateBytes))
+	{
+		m_file = nullptr;
 		return false;
+	}
+	if (m_compressor)
+		writeCompressedHeader();
+
+	for (int i = 0; i < blockPoolSize; i++)
+		m_freeBlocks.add(m_allBlocks.add(new FileBlock(m_blockSize, 0)));
 
-	m_memBlocks.add(new FileBlock(m_file, m_blockSize, 0));
+	m_memBlocks.add(getFreeBlock(0));
 	return true;
 }
 
-bool SequentialBlockFile::writeChannel(uint64 startPos, int channel, int16* data, int nSamples)
+int SequentialBlockFile::prepareBlocks(uint64 startPos, int nSamples)
 {
-	if (!m_file)
-		return false;
-	
 	int bIndex = m_memBlocks.size() - 1;
 	if ((bIndex < 0) || (m_memBlocks[bIndex]->getOffset() + m_samplesPerBlock) < (startPos + nSamples))
 		allocateBlocks(startPos, nSamples);
@@ -81,6 +234,23 @@ bool SequentialBlockFile::writeChannel(uint64 startPos, int channel, int16* data
 		if (m_memBlocks[bIndex]->getOffset() <= startPos)
 			break;
 	}
+	return bIndex;
+}
+
+void SequentialBlockFile::updateLastBlockFill(int bIndex, size_t samplePos)
+{
+	if (bIndex == m_memBlocks.size() - 1 && samplePos > m_lastBlockFill)
+	{
+		m_lastBlockFill = samplePos;
+	}
+}
+
+bool SequentialBlockFile::writeChannel(uint64 startPos, int channel, const int16* data, int nSamples)
+{
+	if (!m_file)
+		return false;
+	
+	int bIndex = prepareBlocks(startPos, nSamples);
 	if (bIndex < 0)
 	{
 		std::cerr << "BINARY WRITER: Memory block unloaded ahead of time for chan " << channel << " start " << startPos << " ns " << nSamples << " first " << m_memBlocks[0]->getOffset() <<std::endl;
@@ -92,7 +262,6 @@ bool SequentialBlockFile::writeChannel(uint64 startPos, int channel, int16* data
 	int startIdx = startPos - m_memBlocks[bIndex]->getOffset();
 	int startMemPos = startIdx*m_nChannels;
 	int dataIdx = 0;
-	int lastBlockIdx = m_memBlocks.size() - 1;
 	while (writtenSamples < nSamples)
 	{
 		int16* blockPtr = m_memBlocks[bIndex]->getData();
@@ -105,11 +274,7 @@ bool SequentialBlockFile::writeChannel(uint64 startPos, int channel, int16* data
 		writtenSamples += samplesToWrite;
 
 		//Update the last block fill index
-		size_t samplePos = startIdx + samplesToWrite;
-		if (bIndex == lastBlockIdx && samplePos > m_lastBlockFill)
-		{
-			m_lastBlockFill = samplePos;
-		}
+		updateLastBlockFill(bIndex, startIdx + samplesToWrite);
 
 		startIdx = 0;
 		startMemPos = 0;
@@ -119,6 +284,36 @@ bool SequentialBlockFile::writeChannel(uint64 startPos, int channel, int16* data
 	return true;
 }
 
+bool SequentialBlockFile::writeChannels(uint64 startPos, const int16* const* data, int nChannels, int nSamples)
+{
+	if (!m_file || nChannels != m_nChannels)
+		return false;
+
+	int bIndex = prepareBlocks(startPos, nSamples);
+	if (bIndex < 0)
+	{
+		std::cerr << "BINARY WRITER: Memory block unloaded ahead of time for all channels start " << startPos << " ns " << nSamples << " first " << m_memBlocks[0]->getOffset() << std::endl;
+		return false;
+	}
+	int writtenSamples = 0;
+	int startIdx = startPos - m_memBlocks[bIndex]->getOffset();
+	while (writtenSamples < nSamples)
+	{
+		int16* blockPtr = m_memBlocks[bIndex]->getData() + startIdx*m_nChannels;
+		int samplesToWrite = jmin((nSamples - writtenSamples), (m_samplesPerBlock - startIdx));
+		interleaveChannels(blockPtr, data, writtenSamples, m_nChannels, samplesToWrite);
+		writtenSamples += samplesToWrite;
+
+		updateLastBlockFill(bIndex, startIdx + samplesToWrite);
+
+		startIdx = 0;
+		bIndex++;
+	}
+	for (int i = 0; i < m_nChannels; i++)
+		m_currentBlock.set(i, bIndex - 1);
+	return true;
+}
+
 void SequentialBlockFile::allocateBlocks(uint64 startIndex, int numSamples)
 {
 	//First deallocate full blocks
@@ -136,7 +331,10 @@ void SequentialBlockFile::allocateBlocks(uint64 startIndex, int numSamples)
 		m_currentBlock.set(i, m_currentBlock[i] - minBlock);
 	}
 
-	m_memBlocks.removeRange(0, minBlock);
+	int numCompleted = jlimit(0, m_memBlocks.size(), int(minBlock));
+	for (int i = 0; i < numCompleted; i++)
+		retireBlock(m_memBlocks[i], m_blockSize);
+	m_memBlocks.removeRange(0, numCompleted);
 
 	//for (int i = 0; i < minBlock; i++)
 	//{
@@ -153,7 +351,7 @@ void SequentialBlockFile::allocateBlocks(uint64 startIndex, int numSamples)
 	for (int i = 0; i < newBlocks; i++)
 	{
 		lastOffset += m_samplesPerBlock;
-		m_memBlocks.add(new FileBlock(m_file, m_blockSize, lastOffset));
+		m_memBlocks.add(getFreeBlock(lastOffset));
 	}
 	if (newBlocks > 0)
 		m_lastBlockFill = 0; //we've added some new blocks, so the last one will be empty
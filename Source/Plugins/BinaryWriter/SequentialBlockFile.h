@@ -25,6 +25,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define SEQUENTIALBLOCKFILE_H
 
 #include "FileMemoryBlock.h"
+#include "BlockFlushThread.h"
+#include "DirectFileWriter.h"
+#include "BlockCompressor.h"
+#include <atomic>
 
 namespace BinaryRecordingEngine
 {
@@ -34,27 +38,77 @@ namespace BinaryRecordingEngine
 	class SequentialBlockFile
 	{
 	public:
-		SequentialBlockFile(int nChannels, int samplesPerBlock);
+		/** If a flush thread is given, completed blocks are written by it instead of the calling thread */
+		SequentialBlockFile(int nChannels, int samplesPerBlock, BlockFlushThread* flushThread = nullptr);
 		~SequentialBlockFile();
 
-		bool openFile(String filename);
-		bool writeChannel(uint64 startPos, int channel, int16* data, int nSamples);
+		/** Opens the file. If unbuffered, writes bypass the OS cache. preallocateBytes of disk space are
+		reserved at once, if possible */
+		bool openFile(String filename, bool unbuffered = false, int64 preallocateBytes = 0);
+		/** Makes the file a compressed container of the blocks, each block compressed by compressor as it is
+		written. Must be called before openFile(), and rules out unbuffered writes and preallocation */
+		void setCompression(BlockCompressor* compressor, float sampleRate);
+		bool writeChannel(uint64 startPos, int channel, const int16* data, int nSamples);
+		/** Writes the same samples of all the channels of the file at once, interleaving them tile by tile.
+		data holds one pointer per channel, nChannels must match the file's */
+		bool writeChannels(uint64 startPos, const int16* const* data, int nChannels, int nSamples);
+
+		/** Writes the first numItems items of a completed block to the file, clears the block and returns it
+		to the pool. Called by the flush thread */
+		void writeBlock(FileBlock* block, size_t numItems, bool lastBlock);
+
+		/** Makes the data of the blocks written so far durable, and returns the length of the file that is valid
+		after a crash, from its start. Can be called from another thread than the writing ones, or -1 on error */
+		int64 sync();
+
+		/** Bytes written to disk so far, and the time spent writing them, to measure the volume's throughput */
+		int64 getBytesWritten() const;
+		double getWriteSeconds() const;
 
 	private:
-		ScopedPointer<FileOutputStream> m_file;
+		ScopedPointer<DirectFileWriter> m_file;
 		const int m_nChannels;
 		const int m_samplesPerBlock;
 		const int m_blockSize;
-		OwnedArray<FileBlock> m_memBlocks;
+		/** The blocks being filled, in file order */
+		Array<FileBlock*> m_memBlocks;
+		/** Every block of the file, either being filled, waiting to be written or free */
+		OwnedArray<FileBlock> m_allBlocks;
+		Array<FileBlock*> m_freeBlocks;
+		CriticalSection m_freeBlocksLock;
+		BlockFlushThread* const m_flushThread;
+		std::atomic<int> m_pendingBlocks;
+		WaitableEvent m_blockWritten;
 		Array<int> m_currentBlock;
 		size_t m_lastBlockFill;
 
+		BlockCompressor* m_compressor{ nullptr };
+		float m_sampleRate{ 0 };
+		/** The compressed record of the block being written, and where each block starts in the file */
+		MemoryBlock m_compressedBlock;
+		Array<uint64> m_blockOffsets;
+		uint64 m_compressedPosition{ 0 };
+		uint64 m_compressedFrames{ 0 };
+
+		std::atomic<int64> m_bytesWritten{ 0 };
+		std::atomic<int64> m_writeTicks{ 0 };
+
 		void allocateBlocks(uint64 startIndex, int numSamples);
+		/** Returns the index of the memory block holding startPos, allocating new ones if needed, or -1 */
+		int prepareBlocks(uint64 startPos, int nSamples);
+		void updateLastBlockFill(int bIndex, size_t samplePos);
+		/** Gets a free block from the pool, or a new one if all of them are in use */
+		FileBlock* getFreeBlock(uint64 offset);
+		/** Hands a completed block over to be written */
+		void retireBlock(FileBlock* block, size_t numItems, bool lastBlock = false);
+		void writeCompressedHeader();
+		void writeCompressedBlock(FileBlock* block, size_t numItems, bool lastBlock);
+		static void interleaveChannels(int16* dst, const int16* const* data, int dataOffset, int nChannels, int nSamples);
 
 
 		//Compile-time parameters
-		const int streamBufferSize{ 0 };
 		const int blockArrayInitSize{ 128 };
+		const int blockPoolSize{ 4 };
 
 	};
 
@@ -22,6 +22,7 @@
 */
 
 #include <stdio.h>
+#include <algorithm>
 
 #include "CAR.h"
 #include "CAREditor.h"
@@ -29,10 +30,15 @@
 
 CAR::CAR()
     : GenericProcessor ("Common Avg Ref") //, threshold(200.0), state(true)
+    , m_referenceMode   (MEAN_REFERENCE)
+    , m_groupSize       (0)
+    , m_groupsChanged   (1)
+    , m_processedMode   (MEAN_REFERENCE)
+    , m_numSamples      (0)
+    , m_gain            (0.0f)
 {
     setProcessorType (PROCESSOR_TYPE_FILTER);
 
-    m_avgBuffer = AudioSampleBuffer (1, 10000); // 1-dimensional buffer to hold the avg
 }
 
 
@@ -63,53 +69,194 @@ void CAR::setGainLevel (float newGain)
 
 void CAR::process (AudioSampleBuffer& buffer)
 {
-    const int numSamples            = buffer.getNumSamples();
-    const int numReferenceChannels  = m_referenceChannels.size();
-    const int numAffectedChannels   = m_affectedChannels.size();
+    if (m_groupsChanged.get() != 0)
+    {
+        const ScopedTryLock myScopedTryLock (objectLock);
+
+        // otherwise the previous groups are kept for this block
+        if (myScopedTryLock.isLocked())
+            updateGroups();
+    }
+
+    // There are no sense to do any processing if no group has both reference and affected channels.
+    if (m_groups.size() == 0)
+        return;
+
+    m_gainLevel.updateTarget();
+    m_gain          = -1.0f * m_gainLevel.getNextValue() / 100.f;
+    m_numSamples    = buffer.getNumSamples();
+
+    processChannelsInParallel (buffer, (m_numSamples + CAR_TILE_SAMPLES - 1) / CAR_TILE_SAMPLES);
+}
+
+
+void CAR::processChannels (AudioSampleBuffer& buffer, int firstTile, int lastTile)
+{
+    float* const* data = buffer.getArrayOfWritePointers();
+    float reference[CAR_TILE_SAMPLES];
 
-    // There are no sense to do any processing if either number of reference or affected channels is zero.
-    if (! numReferenceChannels
-        || ! numAffectedChannels)
+    for (int tile = firstTile; tile < lastTile; ++tile)
     {
+        const int startSample = tile * CAR_TILE_SAMPLES;
+        const int numSamples  = jmin (CAR_TILE_SAMPLES, m_numSamples - startSample);
+
+        for (int g = 0; g < m_groups.size(); ++g)
+        {
+            computeReference (data, g, startSample, numSamples, reference);
+
+            const Array<int>& affectedChannels = m_groups.getUnchecked (g)->affectedChannels;
+
+            for (int i = 0; i < affectedChannels.size(); ++i)
+                FloatVectorOperations::addWithMultiply (data[affectedChannels.getUnchecked (i)] + startSample,
+                                                        reference, m_gain, numSamples);
+        }
+    }
+}
+
+
+void CAR::computeReference (const float* const* data, int group, int startSample, int numSamples, float* reference)
+{
+    const Array<int>& referenceChannels = m_groups.getUnchecked (group)->referenceChannels;
+    const int numReferenceChannels = referenceChannels.size();
+
+    if (m_processedMode == MEAN_REFERENCE)
+    {
+        FloatVectorOperations::copy (reference, data[referenceChannels.getUnchecked (0)] + startSample, numSamples);
+
+        for (int i = 1; i < numReferenceChannels; ++i)
+            FloatVectorOperations::add (reference, data[referenceChannels.getUnchecked (i)] + startSample, numSamples);
+
+        FloatVectorOperations::multiply (reference, 1.0f / float (numReferenceChannels), numSamples);
         return;
     }
 
-    m_avgBuffer.clear();
+    // one scratch buffer is enough for each thread that can be referencing tiles
+    MedianScratch* scratch = nullptr;
 
-    for (int i = 0; i < numReferenceChannels; ++i)
+    for (int i = 0; scratch == nullptr; i = (i + 1) % m_medianScratch.size())
     {
-        m_avgBuffer.addFrom (0,                         // destChannel
-                             0,                         // destStartSample
-                             buffer,                    // source
-                             m_referenceChannels[i],    // sourceChannel
-                             0,                         // sourceStartSample
-                             numSamples,                // numSamples
-                             1.0f);                     // gain to apply
+        if (m_medianScratch.getUnchecked (i)->inUse.compareAndSetBool (1, 0))
+            scratch = m_medianScratch.getUnchecked (i);
     }
 
-    m_avgBuffer.applyGain (1.0f / float (numReferenceChannels));
+    float* values = scratch->values;
+    const int middle = numReferenceChannels / 2;
 
-    m_gainLevel.updateTarget();
-    const float gain = -1.0f * m_gainLevel.getNextValue() / 100.f;
+    for (int n = 0; n < numSamples; ++n)
+    {
+        // the channels' lines of the tile stay in cache from one sample to the next
+        for (int i = 0; i < numReferenceChannels; ++i)
+            values[i] = data[referenceChannels.getUnchecked (i)][startSample + n];
+
+        std::nth_element (values, values + middle, values + numReferenceChannels);
+        reference[n] = values[middle];
+
+        // the lower half holds the other middle value of an even number of channels
+        if (numReferenceChannels % 2 == 0)
+            reference[n] = 0.5f * (reference[n] + *std::max_element (values, values + middle));
+    }
+
+    scratch->inUse = 0;
+}
+
+
+void CAR::updateGroups()
+{
+    m_groupsChanged = 0;
+    m_processedMode = m_referenceMode.get();
+
+    const int groupSize = m_groupSize.get();
+    const int numChannels = getNumInputs();
+    HashMap<int, ReferenceGroup*> groupsByIndex;
+    OwnedArray<ReferenceGroup> groups;
+
+    // only the selected channels are visited, in increasing order
+    m_referenceChannels.forEachSet ([&] (int channel)
+    {
+        const int index = (groupSize > 0) ? channel / groupSize : 0;
+
+        if (channel >= numChannels)
+            return;
+
+        if (! groupsByIndex.contains (index))
+            groupsByIndex.set (index, groups.add (new ReferenceGroup()));
+
+        groupsByIndex[index]->referenceChannels.add (channel);
+    });
+
+    m_affectedChannels.forEachSet ([&] (int channel)
+    {
+        const int index = (groupSize > 0) ? channel / groupSize : 0;
 
-    for (int i = 0; i < numAffectedChannels; ++i)
+        if (channel < numChannels && groupsByIndex.contains (index))
+            groupsByIndex[index]->affectedChannels.add (channel);
+    });
+
+    m_groups.clear();
+    int maxReferenceChannels = 0;
+
+    for (int g = groups.size(); --g >= 0;)
+    {
+        if (groups[g]->affectedChannels.size() > 0)
+        {
+            maxReferenceChannels = jmax (maxReferenceChannels, groups[g]->referenceChannels.size());
+            m_groups.insert (0, groups.removeAndReturn (g));
+        }
+    }
+
+    if (m_processedMode == MEDIAN_REFERENCE)
     {
-        buffer.addFrom (m_affectedChannels[i],  // destChannel
-                        0,                      // destStartSample
-                        m_avgBuffer,            // source
-                        0,                      // sourceChannel
-                        0,                      // sourceStartSample
-                        numSamples,             // numSamples
-                        gain);                  // gain to apply
+        m_medianScratch.clear();
+
+        for (int i = 0; i <= getNumChannelPoolThreads(); ++i)
+        {
+            MedianScratch* scratch = m_medianScratch.add (new MedianScratch());
+            scratch->values.malloc (jmax (1, maxReferenceChannels));
+        }
     }
 }
 
 
+Array<int> CAR::getReferenceChannels() const
+{
+    Array<int> channels;
+    m_referenceChannels.getSetChannels (channels);
+
+    return channels;
+}
+
+
+Array<int> CAR::getAffectedChannels() const
+{
+    Array<int> channels;
+    m_affectedChannels.getSetChannels (channels);
+
+    return channels;
+}
+
+
+void CAR::setChannelState (ChannelMask& channels, int channel, bool newState)
+{
+    if (channel < 0)
+        return;
+
+    if (newState && channel >= channels.getNumChannels())
+        channels.setNumChannels (channel + 1);
+
+    channels.set (channel, newState);
+}
+
+
 void CAR::setReferenceChannels (const Array<int>& newReferenceChannels)
 {
     const ScopedLock myScopedLock (objectLock);
 
-    m_referenceChannels = Array<int> (newReferenceChannels);
+    m_referenceChannels.setAll (false);
+
+    for (int i = 0; i < newReferenceChannels.size(); ++i)
+        setChannelState (m_referenceChannels, newReferenceChannels[i], true);
+
+    m_groupsChanged = 1;
 }
 
 
@@ -117,24 +264,64 @@ void CAR::setAffectedChannels (const Array<int>& newAffectedChannels)
 {
     const ScopedLock myScopedLock (objectLock);
 
-    m_affectedChannels = Array<int> (newAffectedChannels);
+    m_affectedChannels.setAll (false);
+
+    for (int i = 0; i < newAffectedChannels.size(); ++i)
+        setChannelState (m_affectedChannels, newAffectedChannels[i], true);
+
+    m_groupsChanged = 1;
 }
 
 
 void CAR::setReferenceChannelState (int channel, bool newState)
 {
-    if (! newState)
-        m_referenceChannels.removeFirstMatchingValue (channel);
-    else
-        m_referenceChannels.addIfNotAlreadyThere (channel);
+    const ScopedLock myScopedLock (objectLock);
+
+    setChannelState (m_referenceChannels, channel, newState);
+
+    m_groupsChanged = 1;
 }
 
 
 void CAR::setAffectedChannelState (int channel, bool newState)
 {
-    if (! newState)
-        m_affectedChannels.removeFirstMatchingValue (channel);
-    else
-        m_affectedChannels.add (channel);
+    const ScopedLock myScopedLock (objectLock);
+
+    setChannelState (m_affectedChannels, channel, newState);
+
+    m_groupsChanged = 1;
+}
+
+
+void CAR::updateSettings()
+{
+    // the channels may have changed in number
+    m_groupsChanged = 1;
+}
+
+
+CAR::ReferenceMode CAR::getReferenceMode() const
+{
+    return ReferenceMode (m_referenceMode.get());
+}
+
+
+void CAR::setReferenceMode (ReferenceMode newMode)
+{
+    m_referenceMode = newMode;
+    m_groupsChanged = 1;
+}
+
+
+int CAR::getGroupSize() const
+{
+    return m_groupSize.get();
+}
+
+
+void CAR::setGroupSize (int newGroupSize)
+{
+    m_groupSize = jmax (0, newGroupSize);
+    m_groupsChanged = 1;
 }
 
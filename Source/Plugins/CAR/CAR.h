@@ -31,10 +31,21 @@
 
 #include <ProcessorHeaders.h>
 
+/** Samples of every channel referenced together, a cache line of floats */
+#define CAR_TILE_SAMPLES 16
+
 /**
     This is a simple filter that subtracts the average of all other channels from 
     each channel. The gain parameter allows you to subtract a percentage of the total avg.
 
+    The channels can be split into consecutive groups, for instance the channels of each shank
+    of a probe, every group being referenced to its own reference channels. The reference is
+    either their mean or, to be robust to artifacts on a few of them, their median.
+
+    The buffer is swept through tiles of CAR_TILE_SAMPLES samples of every channel, the
+    references of a tile being subtracted while it is still in cache, and the tiles are
+    spread over the channel thread pool.
+
     See Ludwig et al. 2009 Using a common average reference to improve cortical
     neuron recordings from microelectrode arrays. J. Neurophys, 2009 for a detailed
     discussion
@@ -62,6 +73,13 @@ public:
     */
     void process (AudioSampleBuffer& buffer) override;
 
+    bool isChannelParallelSafe() const override { return true; }
+
+    void updateSettings() override;
+
+    /** References the tiles from firstTile to lastTile - 1 */
+    void processChannels (AudioSampleBuffer& buffer, int firstTile, int lastTile) override;
+
     /** Returns the current gain level that is set in the processor */
     float getGainLevel();
 
@@ -71,8 +89,8 @@ public:
     /** Creates the CAREditor. */
     AudioProcessorEditor* createEditor() override;
 
-    Array<int> getReferenceChannels() const     { return m_referenceChannels; }
-    Array<int> getAffectedChannels()  const     { return m_affectedChannels; }
+    Array<int> getReferenceChannels() const;
+    Array<int> getAffectedChannels()  const;
 
     void setReferenceChannels (const Array<int>& newReferenceChannels);
     void setAffectedChannels  (const Array<int>& newAffectedChannels);
@@ -80,11 +98,55 @@ public:
     void setReferenceChannelState (int channel, bool newState);
     void setAffectedChannelState  (int channel, bool newState);
 
+    enum ReferenceMode
+    {
+        MEAN_REFERENCE = 0,
+        MEDIAN_REFERENCE
+    };
+
+    ReferenceMode getReferenceMode() const;
+    void setReferenceMode (ReferenceMode newMode);
+
+    /** Returns the number of consecutive channels in each group, 0 for a single group of all channels */
+    int getGroupSize() const;
+    void setGroupSize (int newGroupSize);
+
 
 private:
+    /** Splits the reference and affected channels into their groups */
+    void updateGroups();
+
+    /** Sets the state of a channel of one of the selections, adding room for it if needed */
+    static void setChannelState (ChannelMask& channels, int channel, bool newState);
+
+    /** Writes the reference of the group for the numSamples samples from startSample */
+    void computeReference (const float* const* data, int group, int startSample, int numSamples, float* reference);
+
+    struct ReferenceGroup
+    {
+        Array<int> referenceChannels;
+        Array<int> affectedChannels;
+    };
+
+    /** Values of one sample being sorted for the median, one per thread referencing tiles at once */
+    struct MedianScratch
+    {
+        Atomic<int> inUse;
+        HeapBlock<float> values;
+    };
+
     LinearSmoothedValueAtomic<float> m_gainLevel;
 
-    AudioSampleBuffer m_avgBuffer;
+    Atomic<int> m_referenceMode;
+    Atomic<int> m_groupSize;
+    Atomic<int> m_groupsChanged;
+
+    /** Groups with both reference and affected channels, only touched by the processing threads */
+    OwnedArray<ReferenceGroup> m_groups;
+    OwnedArray<MedianScratch> m_medianScratch;
+    int m_processedMode;
+    int m_numSamples;
+    float m_gain;
 
     /** We should add this for safety to prevent any app crashes or invalid data processing.
         Since we use m_referenceChannels and m_affectedChannels arrays in the process() function,
@@ -95,11 +157,11 @@ private:
     */
     CriticalSection objectLock;
 
-    /** Array of channels which will be used to calculate mean signal. */
-    Array<int> m_referenceChannels;
+    /** Channels which will be used to calculate mean signal. */
+    ChannelMask m_referenceChannels;
 
-    /** Array of channels that will be affected by adding/substracting of mean signal of reference channels */
-    Array<int> m_affectedChannels;
+    /** Channels that will be affected by adding/substracting of mean signal of reference channels */
+    ChannelMask m_affectedChannels;
 
     // ==================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CAR);
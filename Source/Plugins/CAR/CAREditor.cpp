@@ -25,6 +25,7 @@
 #include "CAR.h"
 #include "../../UI/LookAndFeel/MaterialButtonLookAndFeel.h"
 #include "../../Processors/Parameter/ParameterEditor.h"
+#include "../../Utils/ListSliceParser.h"
 
 
 static const Colour COLOUR_PRIMARY (Colours::black.withAlpha (0.87f));
@@ -66,6 +67,25 @@ CAREditor::CAREditor (GenericProcessor* parentProcessor, bool useDefaultParamete
     m_gainSlider->addListener (this);
     addAndMakeVisible (m_gainSlider);
 
+    // item ids are the reference mode plus one
+    m_referenceModeSelector = new ComboBox ("Reference mode");
+    m_referenceModeSelector->addItem ("Mean",   1);
+    m_referenceModeSelector->addItem ("Median", 2);
+    m_referenceModeSelector->setSelectedId (1, dontSendNotification);
+    m_referenceModeSelector->setTooltip ("Subtract the mean of the reference channels, or their median to be robust to artifacts");
+    m_referenceModeSelector->addListener (this);
+    addAndMakeVisible (m_referenceModeSelector);
+
+    // item ids are the number of channels in each group, plus one for a single group
+    m_groupSizeSelector = new ComboBox ("Group size");
+    m_groupSizeSelector->addItem ("All channels", 1);
+    for (int groupSize = 8; groupSize <= 128; groupSize *= 2)
+        m_groupSizeSelector->addItem ("Groups of " + String (groupSize), groupSize + 1);
+    m_groupSizeSelector->setSelectedId (1, dontSendNotification);
+    m_groupSizeSelector->setTooltip ("Consecutive channels referenced to the reference channels among them, such as those of a shank");
+    m_groupSizeSelector->addListener (this);
+    addAndMakeVisible (m_groupSizeSelector);
+
     channelSelector->paramButtonsToggledByDefault (false);
 
     setDesiredWidth (280);
@@ -97,6 +117,9 @@ void CAREditor::resized()
 
     m_gainSlider->setBounds (15, 30, 80, 80);
 
+    m_referenceModeSelector->setBounds (110, 94, 60, 18);
+    m_groupSizeSelector->setBounds     (175, 94, 85, 18);
+
     GenericEditor::resized();
 }
 
@@ -144,3 +167,91 @@ void CAREditor::sliderEvent (Slider* sliderWhichValueHasChanged)
 
     processor->setGainLevel ( (float)sliderWhichValueHasChanged->getValue());
 }
+
+
+void CAREditor::comboBoxChanged (ComboBox* comboBoxThatHasChanged)
+{
+    auto processor = static_cast<CAR*> (getProcessor());
+
+    if (comboBoxThatHasChanged == m_referenceModeSelector)
+        processor->setReferenceMode (CAR::ReferenceMode (m_referenceModeSelector->getSelectedId() - 1));
+    else if (comboBoxThatHasChanged == m_groupSizeSelector)
+        processor->setGroupSize (m_groupSizeSelector->getSelectedId() - 1);
+}
+
+
+void CAREditor::saveCustomParameters (XmlElement* xml)
+{
+    xml->setAttribute ("Type", "CAREditor");
+
+    XmlElement* values = xml->createNewChildElement ("VALUES");
+    values->setAttribute ("ReferenceMode", m_referenceModeSelector->getSelectedId() - 1);
+    values->setAttribute ("GroupSize",     m_groupSizeSelector->getSelectedId() - 1);
+
+    auto processor = static_cast<CAR*> (getProcessor());
+    values->setAttribute ("ReferenceChannels", channelsToString (processor->getReferenceChannels()));
+    values->setAttribute ("AffectedChannels",  channelsToString (processor->getAffectedChannels()));
+}
+
+
+void CAREditor::loadCustomParameters (XmlElement* xml)
+{
+    forEachXmlChildElement (*xml, xmlNode)
+    {
+        if (xmlNode->hasTagName ("VALUES"))
+        {
+            m_referenceModeSelector->setSelectedId (xmlNode->getIntAttribute ("ReferenceMode", 0) + 1, sendNotification);
+
+            const int groupSize = xmlNode->getIntAttribute ("GroupSize", 0);
+            m_groupSizeSelector->setSelectedId (m_groupSizeSelector->indexOfItemId (groupSize + 1) >= 0 ? groupSize + 1 : 1,
+                                                sendNotification);
+
+            auto processor = static_cast<CAR*> (getProcessor());
+            if (xmlNode->hasAttribute ("ReferenceChannels"))
+                processor->setReferenceChannels (stringToChannels (xmlNode->getStringAttribute ("ReferenceChannels")));
+            if (xmlNode->hasAttribute ("AffectedChannels"))
+                processor->setAffectedChannels (stringToChannels (xmlNode->getStringAttribute ("AffectedChannels")));
+
+            channelSelector->setActiveChannels (m_currentChannelsView == REFERENCE_CHANNELS
+                                                ? processor->getReferenceChannels()
+                                                : processor->getAffectedChannels());
+        }
+    }
+}
+
+
+String CAREditor::channelsToString (const Array<int>& channels)
+{
+    // Runs of consecutive channels as 1-based ranges, in the syntax of the channel selector
+    StringArray ranges;
+
+    for (int i = 0; i < channels.size();)
+    {
+        int last = i;
+        while (last + 1 < channels.size() && channels[last + 1] == channels[last] + 1)
+            ++last;
+
+        ranges.add (last == i ? String (channels[i] + 1)
+                              : String (channels[i] + 1) + "-" + String (channels[last] + 1));
+        i = last + 1;
+    }
+
+    return ranges.joinIntoString (",");
+}
+
+
+Array<int> CAREditor::stringToChannels (const String& text) const
+{
+    const Array<int> ranges = ListSliceParser::parseStringIntoRange (text, getProcessor()->getNumInputs());
+
+    Array<int> channels;
+    for (int i = 0; i + 2 < ranges.size(); i += 3)
+    {
+        for (int channel = ranges[i]; channel <= ranges[i + 1]; channel += jmax (1, ranges[i + 2]))
+            channels.addIfNotAlreadyThere (channel);
+    }
+
+    channels.sort();
+
+    return channels;
+}
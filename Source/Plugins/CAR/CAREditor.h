@@ -39,6 +39,7 @@ class ParameterSlider;
    @see CAR
 */
 class CAREditor : public GenericEditor
+                , public ComboBox::Listener
 {
 public:
     CAREditor (GenericProcessor* parentProcessor, bool useDefaultParameterEditors);
@@ -58,6 +59,13 @@ public:
     void sliderEvent (Slider* sliderWhichValueHasChanged) override;
     void channelChanged (int channel, bool newState) override;
 
+    void saveCustomParameters (XmlElement* xml) override;
+    void loadCustomParameters (XmlElement* xml) override;
+
+    // ComboBox::Listener methods
+    // ==========================================================
+    void comboBoxChanged (ComboBox* comboBoxThatHasChanged) override;
+
 
 private:
     enum ChannelsType
@@ -66,10 +74,17 @@ private:
         AFFECTED_CHANNELS
     };
 
+    /** The channels as 1-based ranges, e.g. "1-64,70", and back, the ranges being in any syntax
+        of the channel selector, such as "[:]" for every input channel */
+    static String channelsToString (const Array<int>& channels);
+    Array<int> stringToChannels (const String& text) const;
+
     ChannelsType m_currentChannelsView;
 
     ScopedPointer<LinearButtonGroupManager> m_channelSelectorButtonManager;
     ScopedPointer<ParameterSlider>          m_gainSlider;
+    ScopedPointer<ComboBox>                 m_referenceModeSelector;
+    ScopedPointer<ComboBox>                 m_groupSizeSelector;
 
     // LookAndFeel
     SharedResourcePointer<MaterialButtonLookAndFeel> m_materialButtonLookAndFeel;
@@ -590,6 +590,9 @@ void ChannelMappingEditor::channelChanged (int channel, bool /*newState*/)
     }
 }
 
+/** Layout of the MAPPING_DATA blob, raised whenever it changes */
+#define MAPPING_DATA_VERSION 1
+
 void ChannelMappingEditor::saveCustomParameters(XmlElement* xml)
 {
     xml->setAttribute("Type", "ChannelMappingEditor");
@@ -598,21 +601,26 @@ void ChannelMappingEditor::saveCustomParameters(XmlElement* xml)
     XmlElement* settingsXml = xml->createNewChildElement("SETTING");
     settingsXml->setAttribute("Type","visibleChannels");
     settingsXml->setAttribute("Value",previousChannelCount);
+
+    // the mapping of every channel, which was once a CHANNEL and a REFERENCE element each
+    SettingsBlobWriter blob(MAPPING_DATA_VERSION);
+    MemoryOutputStream& out = blob.getStream();
+
+    out.writeInt(channelArray.size());
     for (int i = 0; i < channelArray.size(); i++)
     {
-        XmlElement* channelXml = xml->createNewChildElement("CHANNEL");
-        channelXml->setAttribute("Number", i);
-        channelXml->setAttribute("Mapping", channelArray[i]);
-        channelXml->setAttribute("Reference", referenceArray[channelArray[i]-1]);
-        channelXml->setAttribute("Enabled",enabledChannelArray[channelArray[i]-1]);
+        out.writeInt(channelArray[i]);
+        out.writeInt(referenceArray[channelArray[i]-1]);
+        out.writeBool(enabledChannelArray[channelArray[i]-1]);
     }
+
+    out.writeInt(referenceChannels.size());
     for (int i = 0; i< referenceChannels.size(); i++)
     {
-        XmlElement* referenceXml = xml->createNewChildElement("REFERENCE");
-        referenceXml->setAttribute("Number", i);
-        referenceXml->setAttribute("Channel",referenceChannels[i]);
+        out.writeInt(referenceChannels[i]);
     }
 
+    blob.addTo(xml, "MAPPING_DATA");
 }
 
 void ChannelMappingEditor::loadCustomParameters(XmlElement* xml)
@@ -629,53 +637,113 @@ void ChannelMappingEditor::loadCustomParameters(XmlElement* xml)
             }
         }
     }
-    forEachXmlChildElementWithTagName(*xml, channelXml, "CHANNEL")
+
+    Array<int> mappings, references, referenceSettings;
+    Array<bool> enabled;
+
+    SettingsBlobReader blob(xml, "MAPPING_DATA", MAPPING_DATA_VERSION);
+
+    if (blob.isValid())
     {
-        int i = channelXml->getIntAttribute("Number");
+        MemoryInputStream& in = blob.getStream();
 
-        if (i < channelArray.size())
+        const int numChannels = blob.readCount(2 * sizeof(int) + 1);
+        for (int i = 0; i < numChannels; i++)
         {
+            mappings.add(in.readInt());
+            references.add(in.readInt());
+            enabled.add(in.readBool());
+        }
 
-            int mapping = channelXml->getIntAttribute("Mapping");
-            int reference = channelXml->getIntAttribute("Reference");
-            bool enabled = channelXml->getBoolAttribute("Enabled");
-
-            channelArray.set(i, mapping);
-            referenceArray.set(mapping-1, reference);
-            enabledChannelArray.set(mapping-1,enabled);
+        const int numReferences = blob.readCount(sizeof(int));
+        for (int i = 0; i < numReferences; i++)
+        {
+            referenceSettings.add(in.readInt());
+        }
+    }
 
-            electrodeButtons[i]->setChannelNum(mapping);
-            electrodeButtons[i]->setEnabled(enabled);
-            electrodeButtons[i]->repaint();
+    if (! blob.isValid())
+    {
+        mappings.clearQuick();
+        references.clearQuick();
+        enabled.clearQuick();
+        referenceSettings.clearQuick();
 
+        forEachXmlChildElementWithTagName(*xml, channelXml, "CHANNEL")
+        {
+            int i = channelXml->getIntAttribute("Number");
 
-            getProcessor()->setCurrentChannel(i);
+            if (i >= 0 && i < channelArray.size())
+            {
+                if (i >= mappings.size())
+                {
+                    mappings.insertMultiple(-1, 0, i + 1 - mappings.size());
+                    references.insertMultiple(-1, 0, i + 1 - references.size());
+                    enabled.insertMultiple(-1, false, i + 1 - enabled.size());
+                }
 
-            getProcessor()->setParameter(0, mapping-1); // set mapping
+                mappings.set(i, channelXml->getIntAttribute("Mapping"));
+                references.set(i, channelXml->getIntAttribute("Reference"));
+                enabled.set(i, channelXml->getBoolAttribute("Enabled"));
+            }
+        }
 
-            getProcessor()->setCurrentChannel(mapping-1);
+        forEachXmlChildElementWithTagName(*xml, referenceXml, "REFERENCE")
+        {
+            int i = referenceXml->getIntAttribute("Number");
 
-            getProcessor()->setParameter(1, reference); // set reference
+            if (i >= 0 && i < referenceChannels.size())
+            {
+                if (i >= referenceSettings.size())
+                    referenceSettings.insertMultiple(-1, -1, i + 1 - referenceSettings.size());
 
-            getProcessor()->setParameter(3,enabled ? 1 : 0); //set enabled
+                referenceSettings.set(i, referenceXml->getIntAttribute("Channel"));
+            }
         }
+    }
+
+    for (int i = 0; i < jmin(mappings.size(), channelArray.size()); i++)
+    {
+        int mapping = mappings[i];
+
+        // a channel missing from older settings, or one out of range
+        if (mapping < 1 || mapping > referenceArray.size())
+            continue;
+
+        int reference = references[i];
+
+        channelArray.set(i, mapping);
+        referenceArray.set(mapping-1, reference);
+        enabledChannelArray.set(mapping-1,enabled[i]);
+
+        electrodeButtons[i]->setChannelNum(mapping);
+        electrodeButtons[i]->setEnabled(enabled[i]);
+        electrodeButtons[i]->repaint();
 
+
+        getProcessor()->setCurrentChannel(i);
+
+        getProcessor()->setParameter(0, mapping-1); // set mapping
+
+        getProcessor()->setCurrentChannel(mapping-1);
+
+        getProcessor()->setParameter(1, reference); // set reference
+
+        getProcessor()->setParameter(3,enabled[i] ? 1 : 0); //set enabled
     }
 
-    forEachXmlChildElementWithTagName(*xml, referenceXml, "REFERENCE")
+    for (int i = 0; i < jmin(referenceSettings.size(), referenceChannels.size()); i++)
     {
-        int i = referenceXml->getIntAttribute("Number");
+        int channel = referenceSettings[i];
 
-        if (i < referenceChannels.size())
-        {
-            int channel = referenceXml->getIntAttribute("Channel");
+        if (channel < 0)
+            continue;
 
-            referenceChannels.set(i,channel);
+        referenceChannels.set(i,channel);
 
-            getProcessor()->setCurrentChannel(channel);
+        getProcessor()->setCurrentChannel(channel);
 
-            getProcessor()->setParameter(2,i);
-        }
+        getProcessor()->setParameter(2,i);
     }
 
     for (int i = 0; i < electrodeButtons.size(); i++)
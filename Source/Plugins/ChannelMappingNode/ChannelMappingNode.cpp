@@ -28,17 +28,18 @@
 ChannelMappingNode::ChannelMappingNode()
     : GenericProcessor  ("Channel Map")
     , channelBuffer     (1, 10000)
+    , isCopyingInputs   (false)
 {
     setProcessorType (PROCESSOR_TYPE_FILTER);
 
     referenceArray.resize (1024); // make room for 1024 channels
     channelArray.resize   (1024);
+    enabledChannelArray.setNumChannels (1024, true);
 
     for (int i = 0; i < referenceArray.size(); ++i)
     {
         channelArray.set        (i, i);
         referenceArray.set      (i, -1);
-        enabledChannelArray.set (i, true);
     }
 
     for (int i = 0; i < NUM_REFERENCES; ++i)
@@ -111,6 +112,9 @@ void ChannelMappingNode::setParameter (int parameterIndex, float newValue)
     }
     else if (parameterIndex == 3)
     {
+        if (currentChannel >= enabledChannelArray.getNumChannels())
+            enabledChannelArray.setNumChannels (currentChannel + 1, true);
+
         enabledChannelArray.set (currentChannel, (newValue != 0) ? true : false);
     }
     else if (parameterIndex == 4)
@@ -130,42 +134,147 @@ void ChannelMappingNode::process (AudioSampleBuffer& buffer)
     int i = 0;
     int realChan;
 
-    // use copy constructor to set the data to refer to
-    channelBuffer = buffer;
+    // find the source of each output first, so that the outputs can be filled in parallel
+    outputSourceChannels.clearQuick();
+    inputDestChannels.clearQuick();
+    inputDestChannels.insertMultiple (0, -1, buffer.getNumChannels());
 
-   // buffer.clear();
+    bool isPermutation = true;
 
-    while (j < settings.numOutputs)
+    while (j < settings.numOutputs && i < channelArray.size())
     {
         realChan = channelArray[i];
-        if ((realChan < channelBuffer.getNumChannels())
+        if ((realChan < buffer.getNumChannels())
             && (enabledChannelArray[realChan]))
         {
-            // copy it back into the buffer according to the channel mapping
-            buffer.copyFrom (j,                                       // destChannel
-                             0,                                       // destStartSample
-                             channelBuffer.getReadPointer (realChan), // source
-                             getNumSamples (j),                       // numSamples
-                             1.0f); // gain to apply to source (positive for original signal)
-
-            // now do the referencing
-            if ((referenceArray[realChan] > -1)
-                && (referenceChannels[referenceArray[realChan]] > -1)
-                && (referenceChannels[referenceArray[realChan]] < channelBuffer.getNumChannels()))
-            {
-                buffer.addFrom (j,                                                                // destChannel
-                                0,                                                                // destStartSample
-                                channelBuffer,                                                    // source
-                                channelArray[referenceChannels[referenceArray[realChan]]], // sourceChannel
-                                0,                                                                // sourceStartSample
-                                getNumSamples (j),                                                // numSamples
-                                -1.0f); // gain to apply to source (negative for reference)
-            }
-
+            // a referenced output or a source taken twice needs the original inputs
+            if (inputDestChannels[realChan] >= 0
+                || ((referenceArray[realChan] > -1) && (referenceChannels[referenceArray[realChan]] > -1)))
+                isPermutation = false;
+            else
+                inputDestChannels.set (realChan, j);
+
+            outputSourceChannels.add (realChan);
             ++j;
         }
 
         ++i;
     }
+
+    // only grows, so that the copy of the inputs doesn't allocate from one block to the next
+    if (channelBuffer.getNumChannels() < buffer.getNumChannels()
+        || channelBuffer.getNumSamples() < buffer.getNumSamples())
+    {
+        channelBuffer.setSize (jmax (channelBuffer.getNumChannels(), buffer.getNumChannels()),
+                               jmax (channelBuffer.getNumSamples(), buffer.getNumSamples()));
+    }
+
+    if (isPermutation)
+    {
+        permuteChannels (buffer);
+        return;
+    }
+
+    isCopyingInputs = true;
+    processChannelsInParallel (buffer, buffer.getNumChannels());
+
+    isCopyingInputs = false;
+    processChannelsInParallel (buffer, outputSourceChannels.size());
+}
+
+
+void ChannelMappingNode::permuteChannels (AudioSampleBuffer& buffer)
+{
+    const int numSamples = buffer.getNumSamples();
+    const int numOutputs = outputSourceChannels.size();
+
+    // outputs whose input is still to be moved to them
+    for (int j = 0; j < numOutputs; ++j)
+    {
+        if (outputSourceChannels.getUnchecked (j) == j)
+            inputDestChannels.set (j, -1);
+    }
+
+    // an output can be written once its own input has gone to its destination, so the
+    // moves are done from the end of each chain of outputs towards its start
+    for (int j = 0; j < numOutputs; ++j)
+    {
+        int dest = j;
+
+        while (dest >= 0
+               && outputSourceChannels.getUnchecked (dest) != dest
+               && inputDestChannels[dest] < 0)
+        {
+            const int source = outputSourceChannels.getUnchecked (dest);
+
+            buffer.copyFrom (dest, 0, buffer, source, 0, numSamples);
+            outputSourceChannels.set (dest, dest);
+
+            // the source has been given away, so whichever output it is can now be written
+            inputDestChannels.set (source, -1);
+            dest = (source < numOutputs) ? source : -1;
+        }
+    }
+
+    // what is left are cycles, each broken by setting aside the input of one of its outputs
+    for (int j = 0; j < numOutputs; ++j)
+    {
+        if (outputSourceChannels.getUnchecked (j) == j)
+            continue;
+
+        channelBuffer.copyFrom (0, 0, buffer, j, 0, numSamples);
+
+        int dest = j;
+
+        while (outputSourceChannels.getUnchecked (dest) != j)
+        {
+            const int source = outputSourceChannels.getUnchecked (dest);
+
+            buffer.copyFrom (dest, 0, buffer, source, 0, numSamples);
+            outputSourceChannels.set (dest, dest);
+            dest = source;
+        }
+
+        buffer.copyFrom (dest, 0, channelBuffer, 0, 0, numSamples);
+        outputSourceChannels.set (dest, dest);
+    }
+}
+
+
+void ChannelMappingNode::processChannels (AudioSampleBuffer& buffer, int firstChannel, int lastChannel)
+{
+    if (isCopyingInputs)
+    {
+        for (int i = firstChannel; i < lastChannel; ++i)
+            channelBuffer.copyFrom (i, 0, buffer, i, 0, buffer.getNumSamples());
+
+        return;
+    }
+
+    for (int j = firstChannel; j < lastChannel; ++j)
+    {
+        const int realChan = outputSourceChannels.getUnchecked (j);
+
+        // copy it back into the buffer according to the channel mapping
+        buffer.copyFrom (j,                                       // destChannel
+                         0,                                       // destStartSample
+                         channelBuffer.getReadPointer (realChan), // source
+                         getNumSamples (j),                       // numSamples
+                         1.0f); // gain to apply to source (positive for original signal)
+
+        // now do the referencing
+        if ((referenceArray[realChan] > -1)
+            && (referenceChannels[referenceArray[realChan]] > -1)
+            && (referenceChannels[referenceArray[realChan]] < channelBuffer.getNumChannels()))
+        {
+            buffer.addFrom (j,                                                                // destChannel
+                            0,                                                                // destStartSample
+                            channelBuffer,                                                    // source
+                            channelArray[referenceChannels[referenceArray[realChan]]], // sourceChannel
+                            0,                                                                // sourceStartSample
+                            getNumSamples (j),                                                // numSamples
+                            -1.0f); // gain to apply to source (negative for reference)
+        }
+    }
 }
 
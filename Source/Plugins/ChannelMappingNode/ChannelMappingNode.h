@@ -33,6 +33,11 @@
     Allows the user to select a subset of channels, remap their order, and reference them against
     any other channel.
 
+    A mapping that only reorders or drops channels, without referencing, is done in place by
+    moving each channel once, one channel being set aside to break each cycle of the permutation.
+    Referencing needs the original inputs, which are first copied to a scratch buffer kept from
+    one block to the next.
+
     @see GenericProcessor
 */
 class ChannelMappingNode : public GenericProcessor
@@ -45,6 +50,10 @@ public:
 
     void process (AudioSampleBuffer& buffer) override;
 
+    bool isChannelParallelSafe() const override { return true; }
+
+    void processChannels (AudioSampleBuffer& buffer, int firstChannel, int lastChannel) override;
+
     void setParameter (int parameterIndex, float newValue) override;
 
     bool hasEditor() const override { return true; }
@@ -53,15 +62,28 @@ public:
 
 
 private:
+    /** Moves every input to its output in the buffer, given that no two outputs have the same source */
+    void permuteChannels (AudioSampleBuffer& buffer);
+
     Array<int> referenceArray;
     Array<int> referenceChannels;
     Array<int> channelArray;
-    Array<bool> enabledChannelArray;
+    ChannelMask enabledChannelArray;
 
     bool editorIsConfigured;
 
+    /** Copy of the inputs when referencing, and the channel set aside when permuting */
     AudioSampleBuffer channelBuffer;
 
+    /** The input channel copied to each output in the current block */
+    Array<int> outputSourceChannels;
+
+    /** The output taking each input channel, or -1 */
+    Array<int> inputDestChannels;
+
+    /** Whether processChannels() copies inputs to channelBuffer rather than filling outputs */
+    bool isCopyingInputs;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ChannelMappingNode);
 };
 
@@ -28,9 +28,13 @@
 using namespace H5;
 using namespace OpenEphysHDF5;
 
+//ids registered with the HDF Group for the LZ4 and Zstandard filter plugins
+#define LZ4_FILTER_ID 32004
+#define ZSTD_FILTER_ID 32015
+
 //HDF5FileBase
 
-HDF5FileBase::HDF5FileBase() : readyToOpen(false), opened(false)
+HDF5FileBase::HDF5FileBase() : readyToOpen(false), opened(false), swmrActive(false)
 {
     Exception::dontPrint();
 };
@@ -50,6 +54,71 @@ bool HDF5FileBase::isReadyToOpen() const
 	return readyToOpen;
 }
 
+void HDF5FileBase::setStorageSettings(const HDF5StorageSettings& settings)
+{
+	storageSettings = settings;
+}
+
+const HDF5StorageSettings& HDF5FileBase::getStorageSettings() const
+{
+	return storageSettings;
+}
+
+int HDF5FileBase::getContinuousChunkSize() const
+{
+	return (storageSettings.chunkSamples > 0) ? storageSettings.chunkSamples : CHUNK_XSIZE;
+}
+
+int HDF5FileBase::startSWMRWrite()
+{
+	if (!opened || !storageSettings.swmr) return -1;
+	if (swmrActive) return 0;
+#if H5_VERSION_GE(1,10,0)
+	if (H5Fstart_swmr_write(file->getId()) < 0)
+	{
+		std::cerr << "Error starting SWMR write of " << getFileName() << std::endl;
+		return -1;
+	}
+	swmrActive = true;
+	return 0;
+#else
+	std::cerr << "SWMR needs HDF5 1.10 or newer, " << getFileName() << " can't be read while recording" << std::endl;
+	return -1;
+#endif
+}
+
+bool HDF5FileBase::isSWMRActive() const
+{
+	return swmrActive;
+}
+
+int HDF5FileBase::flush()
+{
+	if (!opened) return -1;
+	try
+	{
+		file->flush(H5F_SCOPE_LOCAL);
+	}
+	catch (FileIException error)
+	{
+		PROCESS_ERROR;
+	}
+	return 0;
+}
+
+/** Smallest prime not lower than n, as the chunk cache hash table works best with a prime number of slots */
+static size_t nextPrime(size_t n)
+{
+	for (;; n++)
+	{
+		bool prime = n > 1;
+		for (size_t d = 2; d * d <= n && prime; d++)
+			prime = (n % d) != 0;
+		if (prime)
+			return n;
+	}
+}
+
 int HDF5FileBase::open()
 {
 	return open(-1);
@@ -73,12 +142,25 @@ int HDF5FileBase::open(bool newfile, int nChans)
 
     try
     {
-		FileAccPropList props = FileAccPropList::DEFAULT;
-		if (nChans > 0)
+		FileAccPropList props;
+		const HDF5StorageSettings& s = storageSettings;
+		if (nChans > 0 || s.cacheMB > 0)
 		{
-			props.setCache(0, 1667, 2 * 8 * 2 * CHUNK_XSIZE * nChans, 1);
+			//by default, room for 16 int16 chunks of every channel
+			size_t chunkBytes = size_t(getContinuousChunkSize()) * 2 * jmax(nChans, 1);
+			size_t cacheBytes = (s.cacheMB > 0) ? size_t(s.cacheMB) << 20 : 16 * chunkBytes;
+			//the library suggests about a hundred slots per chunk that fits in the cache
+			size_t slots = nextPrime(jmax(size_t(1667), 100 * (cacheBytes / chunkBytes)));
+			//w0 = 1 evicts fully written chunks first, so they are never read back to be completed
+			props.setCache(0, slots, cacheBytes, 1);
 			//std::cout << "opening HDF5 " << getFileName() << " with nchans: " << nChans << std::endl;
 		}
+		if (s.alignmentKB > 0)
+			props.setAlignment(hsize_t(s.alignmentKB) << 10, hsize_t(s.alignmentKB) << 10);
+		if (s.metaBlockKB > 0)
+			H5Pset_meta_block_size(props.getId(), hsize_t(s.metaBlockKB) << 10);
+		if (s.latestFormat || s.swmr)
+			H5Pset_libver_bounds(props.getId(), H5F_LIBVER_LATEST, H5F_LIBVER_LATEST);
 
         if (newfile) accFlags = H5F_ACC_TRUNC;
         else accFlags = H5F_ACC_RDWR;
@@ -109,6 +191,7 @@ void HDF5FileBase::close()
 {
     file = nullptr;
     opened = false;
+    swmrActive = false;
 }
 
 int HDF5FileBase::setAttribute(BaseDataType type, const void* data, String path, String name)
@@ -316,7 +399,7 @@ HDF5RecordingData* HDF5FileBase::getDataSet(String path)
     try
     {
         data = new DataSet(file->openDataSet(path.toUTF8()));
-        return new HDF5RecordingData(data.release());
+        return new HDF5RecordingData(data.release(), storageSettings.swmr);
     }
     catch (DataSetIException error)
     {
@@ -350,6 +433,15 @@ HDF5RecordingData* HDF5FileBase::createDataSet(BaseDataType type, int sizeX, int
     return createDataSet(type,2,size,chunks,path);
 }
 
+HDF5RecordingData* HDF5FileBase::createContinuousDataSet(BaseDataType type, int sizeX, int sizeY, int chunkX, String path)
+{
+    int size[2];
+    int chunks[3] = {chunkX, 0, 0};
+    size[0] = sizeX;
+    size[1] = sizeY;
+    return createDataSet(type,2,size,chunks,path,true);
+}
+
 HDF5RecordingData* HDF5FileBase::createDataSet(BaseDataType type, int sizeX, int sizeY, int sizeZ, int chunkX, String path)
 {
     int size[3];
@@ -370,7 +462,45 @@ HDF5RecordingData* HDF5FileBase::createDataSet(BaseDataType type, int sizeX, int
     return createDataSet(type,3,size,chunks,path);
 }
 
-HDF5RecordingData* HDF5FileBase::createDataSet(BaseDataType type, int dimension, int* size, int* chunking, String path)
+static void setCompression(DSetCreatPropList& prop, const HDF5StorageSettings& settings)
+{
+    int compression = settings.compression;
+    int level = settings.compressionLevel;
+    if ((compression == HDF5StorageSettings::LZ4) || (compression == HDF5StorageSettings::ZSTD))
+    {
+        H5Z_filter_t filter = (compression == HDF5StorageSettings::LZ4) ? LZ4_FILTER_ID : ZSTD_FILTER_ID;
+        if (H5Zfilter_avail(filter) <= 0)
+        {
+            std::cerr << "HDF5 filter plugin " << filter << " not available, compressing with gzip" << std::endl;
+            compression = HDF5StorageSettings::GZIP;
+            level = 0;
+        }
+    }
+    if (compression == HDF5StorageSettings::NO_COMPRESSION)
+        return;
+
+    if (settings.shuffle)
+        prop.setShuffle();
+
+    unsigned int cdValue;
+    switch (compression)
+    {
+    case HDF5StorageSettings::GZIP:
+        prop.setDeflate((level > 0) ? jmin(level, 9) : 1);
+        break;
+    case HDF5StorageSettings::LZ4:
+        //the only parameter is the block size, 0 for the whole chunk
+        cdValue = 0;
+        H5Pset_filter(prop.getId(), LZ4_FILTER_ID, H5Z_FLAG_OPTIONAL, 1, &cdValue);
+        break;
+    case HDF5StorageSettings::ZSTD:
+        cdValue = jlimit(0, 22, level);
+        H5Pset_filter(prop.getId(), ZSTD_FILTER_ID, H5Z_FLAG_OPTIONAL, 1, &cdValue);
+        break;
+    }
+}
+
+HDF5RecordingData* HDF5FileBase::createDataSet(BaseDataType type, int dimension, int* size, int* chunking, String path, bool compressed)
 {
     ScopedPointer<DataSet> data;
     DSetCreatPropList prop;
@@ -403,9 +533,11 @@ HDF5RecordingData* HDF5FileBase::createDataSet(BaseDataType type, int dimension,
     {
         DataSpace dSpace(dimension,dims,max_dims);
         prop.setChunk(dimension,chunk_dims);
+        if (compressed)
+            setCompression(prop, storageSettings);
 
         data = new DataSet(file->createDataSet(path.toUTF8(),H5type,dSpace,prop));
-        return new HDF5RecordingData(data.release());
+        return new HDF5RecordingData(data.release(), storageSettings.swmr);
     }
     catch (DataSetIException error)
     {
@@ -555,7 +687,7 @@ const HDF5FileBase::BaseDataType HDF5FileBase::BaseDataType::DSTR = HDF5FileBase
 
 //H5RecordingData
 
-HDF5RecordingData::HDF5RecordingData(DataSet* data)
+HDF5RecordingData::HDF5RecordingData(DataSet* data, bool exact) : exactExtents(exact)
 {
     DataSpace dSpace;
     DSetCreatPropList prop;
@@ -587,9 +719,52 @@ HDF5RecordingData::HDF5RecordingData(DataSet* data)
 
 HDF5RecordingData::~HDF5RecordingData()
 {
+    //Trim the room left by the last extension
+    if (xPos < size[0])
+    {
+        hsize_t dim[3];
+        dim[0] = xPos;
+        dim[1] = size[1];
+        dim[2] = size[2];
+        try
+        {
+            dSet->extend(dim);
+        }
+        catch (DataSetIException error)
+        {
+            std::cerr << error.getCDetailMsg() << std::endl;
+        }
+    }
 	//Safety
 	dSet->flush(H5F_SCOPE_GLOBAL);
 }
+
+void HDF5RecordingData::reserveSpace(int xSize, int ySize)
+{
+    if (xSize <= size[0] && ySize <= size[1])
+        return;
+
+    hsize_t dim[3];
+    DataSpace fSpace;
+    //Grow in large steps, as every extension has a cost. The dataset is trimmed to the written size when closed
+    int64 target = xSize;
+    if (!exactExtents)
+    {
+        target = jmax(target, int64(size[0]) + jmax(int64(size[0]), int64(xChunkSize)));
+        if (xChunkSize > 0)
+            target = ((target + xChunkSize - 1) / xChunkSize) * xChunkSize;
+    }
+    dim[0] = (hsize_t) jmin(target, int64(std::numeric_limits<int>::max()));
+    dim[1] = jmax(ySize, size[1]);
+    dim[2] = size[2];
+    dSet->extend(dim);
+
+    fSpace = dSet->getSpace();
+    fSpace.getSimpleExtentDims(dim);
+    size[0] = (int) dim[0];
+    if (dimension > 1)
+        size[1] = (int) dim[1];
+}
 int HDF5RecordingData::writeDataBlock(int xDataSize, HDF5FileBase::BaseDataType type, const void* data)
 {
     return writeDataBlock(xDataSize,size[1],type,data);
@@ -611,13 +786,8 @@ int HDF5RecordingData::writeDataBlock(int xDataSize, int yDataSize, HDF5FileBase
     try
     {
         //First be sure that we have enough space
-        dSet->extend(dim);
-
+        reserveSpace((int) dim[0], (int) dim[1]);
         fSpace = dSet->getSpace();
-        fSpace.getSimpleExtentDims(dim);
-        size[0] = (int) dim[0];
-        if (dimension > 1)
-            size[1] = (int) dim[1];
 
         //Create memory space
         dim[0]=xDataSize;
@@ -636,6 +806,9 @@ int HDF5RecordingData::writeDataBlock(int xDataSize, int yDataSize, HDF5FileBase
 
         dSet->write(data,nativeType,mSpace,fSpace);
         xPos += xDataSize;
+        //the rows written are now all at the same position
+        for (int i = 0; i < yDataSize && i < rowXPos.size(); i++)
+            rowXPos.set(i, xPos);
     }
     catch (DataSetIException error)
     {
@@ -660,16 +833,7 @@ int HDF5RecordingData::writeDataRow(int yPos, int xDataSize, HDF5FileBase::BaseD
 
     try
     {
-        if (rowXPos[yPos]+xDataSize > size[0])
-        {
-            dim[1] = size[1];
-            dim[0] = rowXPos[yPos] + xDataSize;
-            dSet->extend(dim);
-
-            fSpace = dSet->getSpace();
-            fSpace.getSimpleExtentDims(dim);
-            size[0] = (int) dim[0];
-        }
+        reserveSpace(rowXPos[yPos] + xDataSize, size[1]);
         if (rowXPos[yPos]+xDataSize > xPos)
         {
             xPos = rowXPos[yPos]+xDataSize;
@@ -712,3 +876,114 @@ void HDF5RecordingData::getRowXPositions(Array<uint32>& rows)
     rows.addArray(rowXPos);
 }
 
+
+//HDF5BlockBuffer
+
+HDF5BlockBuffer::HDF5BlockBuffer() : numChannels(0), capacity(0)
+{
+}
+
+void HDF5BlockBuffer::setNumChannels(int nChannels)
+{
+    numChannels = nChannels;
+    channelSamples.clearQuick();
+    channelSamples.insertMultiple(0, 0, nChannels);
+    capacity = 0;
+    samples.free();
+}
+
+void HDF5BlockBuffer::addSamples(int channel, const int16* data, int nSamples)
+{
+    if (channel < 0 || channel >= numChannels || nSamples <= 0)
+        return;
+
+    int start = channelSamples[channel];
+    if (start + nSamples > capacity)
+    {
+        //the interleaved layout doesn't depend on the capacity, so the samples stay in place
+        capacity = jmax(start + nSamples, 2 * capacity);
+        samples.realloc(size_t(capacity) * numChannels);
+    }
+    int16* dest = samples + size_t(start) * numChannels + channel;
+    for (int i = 0; i < nSamples; i++)
+        dest[size_t(i) * numChannels] = data[i];
+    channelSamples.set(channel, start + nSamples);
+}
+
+int HDF5BlockBuffer::write(HDF5RecordingData* dataSet)
+{
+    if (numChannels == 0)
+        return 0;
+
+    int nSamples = channelSamples[0];
+    bool aligned = true;
+    for (int c = 1; c < numChannels; c++)
+    {
+        if (channelSamples[c] != nSamples)
+            aligned = false;
+    }
+
+    int res = 0;
+    if (aligned)
+    {
+        if (nSamples > 0)
+            res = dataSet->writeDataBlock(nSamples, numChannels, HDF5FileBase::BaseDataType::I16, samples);
+    }
+    else
+    {
+        //channels out of step with each other, as with different sample rates in the same dataset
+        rowBuffer.malloc(jmax(capacity, 1));
+        for (int c = 0; c < numChannels && res == 0; c++)
+        {
+            int n = channelSamples[c];
+            if (n == 0)
+                continue;
+            for (int i = 0; i < n; i++)
+                rowBuffer[i] = samples[size_t(i) * numChannels + c];
+            res = dataSet->writeDataRow(c, n, HDF5FileBase::BaseDataType::I16, rowBuffer);
+        }
+    }
+    for (int c = 0; c < numChannels; c++)
+        channelSamples.set(c, 0);
+    return res;
+}
+
+//HDF5RecordBuffer
+
+HDF5RecordBuffer::HDF5RecordBuffer() : dataSet(nullptr), recordBytes(0), capacity(0), numRecords(0)
+{
+}
+
+void HDF5RecordBuffer::setDataSet(HDF5RecordingData* set, HDF5FileBase::BaseDataType recordType, size_t bytes)
+{
+    dataSet = set;
+    type = recordType;
+    recordBytes = jmax(bytes, size_t(1));
+    capacity = jlimit(1, RECORD_BUFFER_RECORDS, int(RECORD_BUFFER_MAX_BYTES / recordBytes));
+    numRecords = 0;
+    records.malloc(size_t(capacity) * recordBytes);
+}
+
+int HDF5RecordBuffer::add(const void* record)
+{
+    int res = 0;
+    if (numRecords >= capacity)
+        res = flush();
+    memcpy(records + size_t(numRecords) * recordBytes, record, recordBytes);
+    numRecords++;
+    return res;
+}
+
+int HDF5RecordBuffer::flush()
+{
+    if (numRecords == 0 || dataSet == nullptr)
+        return 0;
+    int res = dataSet->writeDataBlock(numRecords, type, records);
+    numRecords = 0;
+    return res;
+}
+
+int HDF5RecordBuffer::getNumRecords() const
+{
+    return numRecords;
+}
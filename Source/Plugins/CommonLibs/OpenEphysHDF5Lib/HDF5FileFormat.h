@@ -35,6 +35,10 @@
 
 #define DEFAULT_STR_SIZE 256
 
+//records gathered by an HDF5RecordBuffer before they're written, up to a megabyte
+#define RECORD_BUFFER_RECORDS 4096
+#define RECORD_BUFFER_MAX_BYTES (1 << 20)
+
 namespace H5
 {
 class DataSet;
@@ -47,6 +51,32 @@ namespace OpenEphysHDF5
 
 class HDF5RecordingData;
 
+/** File access and layout options of an HDF5FileBase. 0 leaves a setting to its default */
+struct HDF5StorageSettings
+{
+    enum Compression { NO_COMPRESSION = 0, GZIP, LZ4, ZSTD };
+
+    /** Length of the chunks of the continuous datasets, in samples. 0 for CHUNK_XSIZE */
+    int chunkSamples{ 0 };
+    /** Size of the raw data chunk cache, in MB. 0 makes room for 16 chunks of every channel */
+    int cacheMB{ 0 };
+    /** Objects of this size or larger are placed at multiples of it within the file, in KB */
+    int alignmentKB{ 0 };
+    /** Minimum size of the blocks file metadata is allocated in, in KB */
+    int metaBlockKB{ 0 };
+    /** Use the latest file format the library supports, faster for large extendable datasets but unreadable by HDF5 1.8 and older */
+    bool latestFormat{ false };
+    /** Compressor of the continuous datasets. LZ4 and zstd need the HDF5 filter plugins installed, and fall back to gzip otherwise */
+    int compression{ NO_COMPRESSION };
+    /** Compression level. 0 for the fastest level of gzip and the default of the others */
+    int compressionLevel{ 0 };
+    /** Shuffle the bytes of each chunk before compressing, so the high bytes of the samples compress together */
+    bool shuffle{ true };
+    /** Single writer, multiple readers: lets other processes read the file while it's written, once startSWMRWrite()
+    has been called. Implies the latest file format, and datasets grow to exactly their written size */
+    bool swmr{ false };
+};
+
 class COMMON_LIB HDF5FileBase
 {
 public:
@@ -59,6 +89,17 @@ public:
     virtual String getFileName() = 0;
     bool isOpen() const;
 	bool isReadyToOpen() const;
+	/** Sets the options used the next time the file is opened */
+	void setStorageSettings(const HDF5StorageSettings& settings);
+	const HDF5StorageSettings& getStorageSettings() const;
+	/** Chunk length to use for the continuous datasets */
+	int getContinuousChunkSize() const;
+	/** Lets other processes read the file from now on, if the storage settings allow it. Until the file is closed,
+	data can only be written to the existing datasets: no object or attribute can be created. */
+	int startSWMRWrite();
+	bool isSWMRActive() const;
+	/** Writes everything buffered by the library to the file, where SWMR readers can see it */
+	int flush();
 	class COMMON_LIB BaseDataType {
 	public:
 		enum Type { T_U8, T_U16, T_U32, T_U64, T_I8, T_I16, T_I32, T_I64, T_F32, T_F64, T_STR };
@@ -103,6 +144,8 @@ protected:
 	HDF5RecordingData* createDataSet(BaseDataType type, int sizeX, int sizeY, int chunkX, String path);
 	HDF5RecordingData* createDataSet(BaseDataType type, int sizeX, int sizeY, int sizeZ, int chunkX, String path);
 	HDF5RecordingData* createDataSet(BaseDataType type, int sizeX, int sizeY, int sizeZ, int chunkX, int chunkY, String path);
+	/** Creates a 2D dataset of continuous data, passed through the compression filters of the storage settings */
+	HDF5RecordingData* createContinuousDataSet(BaseDataType type, int sizeX, int sizeY, int chunkX, String path);
 
     bool readyToOpen;
 
@@ -110,10 +153,12 @@ private:
 	int setAttributeStrArray(Array<const char*>& data, int maxSize, String path, String name);
 
     //create an extendable dataset
-	HDF5RecordingData* createDataSet(BaseDataType type, int dimension, int* size, int* chunking, String path);
+	HDF5RecordingData* createDataSet(BaseDataType type, int dimension, int* size, int* chunking, String path, bool compressed = false);
     int open(bool newfile, int nChans);
     ScopedPointer<H5::H5File> file;
     bool opened;
+    bool swmrActive;
+    HDF5StorageSettings storageSettings;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(HDF5FileBase);
 };
@@ -121,7 +166,8 @@ private:
 class COMMON_LIB HDF5RecordingData
 {
 public:
-    HDF5RecordingData(H5::DataSet* data);
+    /** @param exactExtents grow the dataset to exactly the written size, as SWMR readers would see any room left for later */
+    HDF5RecordingData(H5::DataSet* data, bool exactExtents = false);
     ~HDF5RecordingData();
 
 	int writeDataBlock(int xDataSize, HDF5FileBase::BaseDataType type, const void* data);
@@ -132,8 +178,12 @@ public:
     void getRowXPositions(Array<uint32>& rows);
 
 private:
+    /** Makes the dataset at least xSize long and ySize wide. Throws the HDF5 exceptions */
+    void reserveSpace(int xSize, int ySize);
+
     int xPos;
     int xChunkSize;
+    bool exactExtents;
     int size[3];
     int dimension;
     Array<uint32> rowXPos;
@@ -142,6 +192,65 @@ private:
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(HDF5RecordingData);
 };
 
+/**
+Gathers the int16 samples of every channel of a 2D dataset, interleaved as in the file, so that a whole
+record block can be written with a single HDF5RecordingData::writeDataBlock call instead of a call per channel.
+*/
+class COMMON_LIB HDF5BlockBuffer
+{
+public:
+    HDF5BlockBuffer();
+
+    /** Empties the buffer, setting the number of channels of the dataset */
+    void setNumChannels(int nChannels);
+
+    void addSamples(int channel, const int16* data, int nSamples);
+
+    /** Writes the gathered samples and empties the buffer. Channels with differing sample counts are written row by row */
+    int write(HDF5RecordingData* dataSet);
+
+private:
+    int numChannels;
+    int capacity;
+    Array<int> channelSamples;
+    HeapBlock<int16> samples;
+    HeapBlock<int16> rowBuffer;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(HDF5BlockBuffer);
+};
+
+/**
+Gathers the fixed-size records appended one at a time to an extendable dataset, such as those of events
+or spikes, so that thousands of them are written with a single HDF5RecordingData::writeDataBlock call.
+*/
+class COMMON_LIB HDF5RecordBuffer
+{
+public:
+    HDF5RecordBuffer();
+
+    /** Sets the dataset the records go to, and empties the buffer without writing it.
+    @param recordBytes size in memory of one record, as laid out for the given type */
+    void setDataSet(HDF5RecordingData* dataSet, HDF5FileBase::BaseDataType type, size_t recordBytes);
+
+    /** Appends a record, writing the buffer first if it's full */
+    int add(const void* record);
+
+    /** Writes the buffered records */
+    int flush();
+
+    int getNumRecords() const;
+
+private:
+    HDF5RecordingData* dataSet;
+    HDF5FileBase::BaseDataType type;
+    size_t recordBytes;
+    int capacity;
+    int numRecords;
+    HeapBlock<char> records;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(HDF5RecordBuffer);
+};
+
 }
 
 
@@ -0,0 +1,180 @@
+/*
+ ------------------------------------------------------------------
+
+ This file is part of the Open Ephys GUI
+ Copyright (C) 2014 Open Ephys
+
+ ------------------------------------------------------------------
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include "HDF5WriteThread.h"
+
+//a waiter missing a signal sees the task done at most this late
+#define TASK_DONE_POLL_MS 10
+
+using namespace OpenEphysHDF5;
+
+//HDF5WriteThread
+
+HDF5WriteThread::HDF5WriteThread() : Thread("HDF5 writer"), lastTicket(0), doneTicket(0), taskDone(true)
+{
+    queued.reserve(256);
+    running.reserve(256);
+    startThread();
+}
+
+HDF5WriteThread::~HDF5WriteThread()
+{
+    signalThreadShouldExit();
+    workAvailable.signal();
+    waitForThreadToExit(-1);
+    while (runQueuedTasks());
+}
+
+int64 HDF5WriteThread::post(const Task& task)
+{
+    int64 ticket;
+    {
+        const ScopedLock sl(queueLock);
+        queued.push_back(task);
+        ticket = ++lastTicket;
+    }
+    workAvailable.signal();
+    return ticket;
+}
+
+void HDF5WriteThread::waitFor(int64 ticket)
+{
+    //tasks posted from the write thread itself can't be waited for, but the ones before have already run
+    if (Thread::getCurrentThreadId() == getThreadId())
+        return;
+    while (doneTicket.load() < ticket)
+        taskDone.wait(TASK_DONE_POLL_MS);
+}
+
+void HDF5WriteThread::call(const Task& task)
+{
+    if (Thread::getCurrentThreadId() == getThreadId())
+        task();
+    else
+        waitFor(post(task));
+}
+
+int HDF5WriteThread::getNumPendingTasks() const
+{
+    const ScopedLock sl(queueLock);
+    return int(lastTicket - doneTicket.load());
+}
+
+void HDF5WriteThread::run()
+{
+    while (!threadShouldExit())
+    {
+        if (!runQueuedTasks())
+            workAvailable.wait(100);
+    }
+}
+
+bool HDF5WriteThread::runQueuedTasks()
+{
+    {
+        const ScopedLock sl(queueLock);
+        if (queued.empty())
+            return false;
+        running.swap(queued);
+    }
+    taskDone.reset();
+    for (size_t i = 0; i < running.size(); i++)
+    {
+        running[i]();
+        doneTicket++;
+        taskDone.signal();
+    }
+    running.clear();
+    return true;
+}
+
+//SharedHDF5WriteThread
+
+static CriticalSection sharedThreadLock;
+static HDF5WriteThread* sharedThread = nullptr;
+static int sharedThreadUsers = 0;
+
+SharedHDF5WriteThread::SharedHDF5WriteThread()
+{
+    const ScopedLock sl(sharedThreadLock);
+    if (sharedThreadUsers++ == 0)
+        sharedThread = new HDF5WriteThread();
+    thread = sharedThread;
+}
+
+SharedHDF5WriteThread::~SharedHDF5WriteThread()
+{
+    const ScopedLock sl(sharedThreadLock);
+    if (--sharedThreadUsers == 0)
+    {
+        delete sharedThread;
+        sharedThread = nullptr;
+    }
+}
+
+HDF5WriteThread* SharedHDF5WriteThread::operator->() const
+{
+    return thread;
+}
+
+HDF5WriteThread& SharedHDF5WriteThread::get() const
+{
+    return *thread;
+}
+
+//HDF5DoubleBlockBuffer
+
+HDF5DoubleBlockBuffer::HDF5DoubleBlockBuffer() : fillIndex(0)
+{
+    tickets[0] = tickets[1] = 0;
+}
+
+void HDF5DoubleBlockBuffer::setNumChannels(int nChannels)
+{
+    buffers[0].setNumChannels(nChannels);
+    buffers[1].setNumChannels(nChannels);
+    tickets[0] = tickets[1] = 0;
+    fillIndex = 0;
+}
+
+void HDF5DoubleBlockBuffer::addSamples(int channel, const int16* data, int nSamples)
+{
+    buffers[fillIndex].addSamples(channel, data, nSamples);
+}
+
+void HDF5DoubleBlockBuffer::write(HDF5WriteThread& writer, HDF5RecordingData* dataSet)
+{
+    HDF5BlockBuffer* filled = buffers + fillIndex;
+    tickets[fillIndex] = writer.post([filled, dataSet]
+    {
+        CHECK_ERROR(filled->write(dataSet));
+    });
+    fillIndex = 1 - fillIndex;
+    //the other buffer is only filled again once the write thread is done with it
+    writer.waitFor(tickets[fillIndex]);
+}
+
+int HDF5DoubleBlockBuffer::writeNow(HDF5RecordingData* dataSet)
+{
+    return buffers[fillIndex].write(dataSet);
+}
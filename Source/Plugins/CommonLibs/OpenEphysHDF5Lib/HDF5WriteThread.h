@@ -0,0 +1,136 @@
+/*
+ ------------------------------------------------------------------
+
+ This file is part of the Open Ephys GUI
+ Copyright (C) 2014 Open Ephys
+
+ ------------------------------------------------------------------
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#ifndef HDF5WRITETHREAD_H_INCLUDED
+#define HDF5WRITETHREAD_H_INCLUDED
+
+#include "HDF5FileFormat.h"
+#include <functional>
+#include <atomic>
+#include <vector>
+
+namespace OpenEphysHDF5
+{
+
+/**
+Runs the HDF5 calls of the record engines on a thread of its own.
+
+The HDF5 library is not thread-safe, so instead of calling it from their record threads, where a
+slow write or metadata flush would hold up the data queue, engines post tasks to this thread with
+copies of the data to write, and go on at once. Tasks run one at a time in the order they were posted.
+
+A single instance is shared by every engine writing HDF5 files, through SharedHDF5WriteThread, so
+no two threads ever call the library at the same time.
+*/
+class COMMON_LIB HDF5WriteThread : public Thread
+{
+public:
+    typedef std::function<void()> Task;
+
+    HDF5WriteThread();
+    /** Runs the tasks still queued before returning */
+    ~HDF5WriteThread();
+
+    /** Queues a task and returns at once.
+    @return a ticket to wait for the task with waitFor() */
+    int64 post(const Task& task);
+
+    /** Blocks until the task with the given ticket, and every task posted before it, has run */
+    void waitFor(int64 ticket);
+
+    /** Runs a task on the write thread after the ones already queued, and waits for it to complete.
+    Used for opening and closing files and anything else the caller can't go on without. */
+    void call(const Task& task);
+
+    /** Returns the number of posted tasks that haven't run yet */
+    int getNumPendingTasks() const;
+
+private:
+    void run() override;
+    /** Runs the tasks queued so far. Returns false if there were none */
+    bool runQueuedTasks();
+
+    CriticalSection queueLock;
+    //std::function isn't trivially relocatable, which Array assumes when it grows
+    std::vector<Task> queued;
+    std::vector<Task> running;
+    int64 lastTicket;
+    std::atomic<int64> doneTicket;
+    WaitableEvent workAvailable;
+    WaitableEvent taskDone;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(HDF5WriteThread);
+};
+
+/**
+Gives access to the HDF5WriteThread shared by every engine, creating it along with the first
+instance of this class and destroying it with the last one.
+*/
+class COMMON_LIB SharedHDF5WriteThread
+{
+public:
+    SharedHDF5WriteThread();
+    ~SharedHDF5WriteThread();
+
+    HDF5WriteThread* operator->() const;
+    HDF5WriteThread& get() const;
+
+private:
+    HDF5WriteThread* thread;
+
+    JUCE_DECLARE_NON_COPYABLE(SharedHDF5WriteThread);
+};
+
+/**
+Continuous samples of a dataset gathered in one buffer while the previous buffer is being written.
+
+The record thread fills a buffer and hands it over to the write thread, then goes on with the other
+one, only waiting if its last write hasn't completed yet.
+*/
+class COMMON_LIB HDF5DoubleBlockBuffer
+{
+public:
+    HDF5DoubleBlockBuffer();
+
+    /** Empties both buffers. There must be no write of them pending */
+    void setNumChannels(int nChannels);
+
+    void addSamples(int channel, const int16* data, int nSamples);
+
+    /** Posts the write of the gathered samples to the dataset, and switches to the other buffer */
+    void write(HDF5WriteThread& writer, HDF5RecordingData* dataSet);
+
+    /** Writes the gathered samples at once. Must be called from the write thread */
+    int writeNow(HDF5RecordingData* dataSet);
+
+private:
+    HDF5BlockBuffer buffers[2];
+    int64 tickets[2];
+    int fillIndex;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(HDF5DoubleBlockBuffer);
+};
+
+}
+
+#endif  // HDF5WRITETHREAD_H_INCLUDED
@@ -0,0 +1,408 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <stdio.h>
+#include <cmath>
+#include "Decimator.h"
+#include "DecimatorEditor.h"
+
+#if JUCE_INTEL && (defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2))
+ #define DECIMATOR_SSE2 1
+ #include <emmintrin.h>
+#endif
+
+#if JUCE_ARM && defined (__aarch64__)
+ #define DECIMATOR_NEON 1
+ #include <arm_neon.h>
+#endif
+
+// input samples of a channel run through the stages at once, bounding the size of their buffers
+#define DECIMATOR_CHUNK_SAMPLES 1024
+
+namespace
+{
+    float innerProduct (const float* taps, const float* input, int numTaps)
+    {
+        int n = 0;
+        float sum = 0;
+
+       #if DECIMATOR_SSE2
+        __m128 acc = _mm_setzero_ps();
+
+        for (; n + 4 <= numTaps; n += 4)
+            acc = _mm_add_ps (acc, _mm_mul_ps (_mm_loadu_ps (taps + n), _mm_loadu_ps (input + n)));
+
+        acc = _mm_add_ps (acc, _mm_movehl_ps (acc, acc));
+        acc = _mm_add_ss (acc, _mm_shuffle_ps (acc, acc, 1));
+        sum = _mm_cvtss_f32 (acc);
+       #elif DECIMATOR_NEON
+        float32x4_t acc = vdupq_n_f32 (0);
+
+        for (; n + 4 <= numTaps; n += 4)
+            acc = vmlaq_f32 (acc, vld1q_f32 (taps + n), vld1q_f32 (input + n));
+
+        sum = vaddvq_f32 (acc);
+       #endif
+
+        for (; n < numTaps; ++n)
+            sum += taps[n] * input[n];
+
+        return sum;
+    }
+}
+
+
+Decimator::Decimator()
+    : GenericProcessor ("Decimator")
+    , factor            (DECIMATOR_DEFAULT_FACTOR)
+{
+    setProcessorType (PROCESSOR_TYPE_FILTER);
+}
+
+
+Decimator::~Decimator()
+{
+}
+
+
+AudioProcessorEditor* Decimator::createEditor()
+{
+    editor = new DecimatorEditor (this, true);
+    return editor;
+}
+
+
+int Decimator::getFactor() const
+{
+    return factor;
+}
+
+
+void Decimator::setParameter (int parameterIndex, float newValue)
+{
+    // decimation factor
+    if (parameterIndex == 0)
+        factor = jlimit (2, 64, roundFloatToInt (newValue));
+}
+
+
+int Decimator::getNumSubProcessors() const
+{
+    return jmax (1, decimations.size());
+}
+
+
+float Decimator::getSampleRate (int subProcessorIdx) const
+{
+    if (subProcessorIdx < decimations.size())
+        return decimations[subProcessorIdx]->outputSampleRate;
+
+    return getDefaultSampleRate();
+}
+
+
+int Decimator::getStageFactors (int factorToSplit, int* stageFactors)
+{
+    int primes[32];
+    int numPrimes = 0;
+    int remaining = jmax (1, factorToSplit);
+
+    for (int p = 2; p * p <= remaining; ++p)
+    {
+        while (remaining % p == 0)
+        {
+            primes[numPrimes++] = p;
+            remaining /= p;
+        }
+    }
+
+    if (remaining > 1)
+        primes[numPrimes++] = remaining;
+
+    std::sort (primes, primes + numPrimes);
+    std::reverse (primes, primes + numPrimes);
+
+    // too many stages: the first ones are merged, their transition bands being the widest
+    while (numPrimes > DECIMATOR_MAX_STAGES)
+    {
+        primes[1] *= primes[0];
+
+        for (int i = 0; i < numPrimes - 1; ++i)
+            primes[i] = primes[i + 1];
+
+        --numPrimes;
+        std::sort (primes, primes + numPrimes);
+        std::reverse (primes, primes + numPrimes);
+    }
+
+    for (int i = 0; i < numPrimes; ++i)
+        stageFactors[i] = primes[i];
+
+    return numPrimes;
+}
+
+
+void Decimator::designStages (Decimation& decimation, float inputSampleRate)
+{
+    int factors[DECIMATOR_MAX_STAGES];
+    decimation.numStages = getStageFactors (factor, factors);
+
+    const double finalRate = inputSampleRate / double (factor);
+    const double passEdge = 0.4 * finalRate;
+
+    double stageRate = inputSampleRate;
+    int inputSamplesPerStageSample = 1;
+    decimation.delaySamples = 0;
+
+    for (int k = 0; k < decimation.numStages; ++k)
+    {
+        Stage& stage = decimation.stages[k];
+        stage.factor = factors[k];
+
+        // what the stages after it would let alias into the passband, or the final Nyquist frequency
+        const double outputRate = stageRate / stage.factor;
+        const double stopEdge = (k == decimation.numStages - 1) ? 0.5 * finalRate : outputRate - passEdge;
+
+        // the transition band of a Blackman window is about 5.5 / numTaps of the rate
+        stage.numTaps = jmax (stage.factor + 1, (int) std::ceil (5.5 * stageRate / (stopEdge - passEdge))) | 1;
+        stage.taps.malloc (stage.numTaps);
+
+        const double cutoff = 0.5 * (passEdge + stopEdge) / stageRate;
+        const double centre = (stage.numTaps - 1) / 2.0;
+        double sum = 0;
+
+        for (int n = 0; n < stage.numTaps; ++n)
+        {
+            const double t = n - centre;
+            const double ideal = (t == 0) ? 2 * cutoff : std::sin (2 * double_Pi * cutoff * t) / (double_Pi * t);
+            const double w = 2 * double_Pi * n / (stage.numTaps - 1);
+            const double window = 0.42 - 0.5 * std::cos (w) + 0.08 * std::cos (2 * w);
+
+            stage.taps[n] = float (ideal * window);
+            sum += ideal * window;
+        }
+
+        // unit gain at DC; the kernel is symmetric, so it needs no reversing for the inner product
+        for (int n = 0; n < stage.numTaps; ++n)
+            stage.taps[n] = float (stage.taps[n] / sum);
+
+        decimation.delaySamples += (stage.numTaps - 1) / 2 * inputSamplesPerStageSample;
+        inputSamplesPerStageSample *= stage.factor;
+        stageRate = outputRate;
+    }
+}
+
+
+void Decimator::updateSettings()
+{
+    decimations.clear();
+    channelStates.clear();
+
+    for (int i = 0; i < dataChannelArray.size(); ++i)
+    {
+        const DataChannel* input = dataChannelArray[i];
+        const uint32 sourceId = getProcessorFullId (input->getSourceNodeID(), input->getSubProcessorIdx());
+
+        int sub = 0;
+        while (sub < decimations.size() && decimations[sub]->inputSourceId != sourceId)
+            ++sub;
+
+        if (sub == decimations.size())
+        {
+            Decimation* decimation = decimations.add (new Decimation());
+            decimation->inputSourceId = sourceId;
+            decimation->outputSampleRate = input->getSampleRate() / float (factor);
+            designStages (*decimation, input->getSampleRate());
+        }
+
+        const Decimation& decimation = *decimations[sub];
+
+        DataChannel* output = new DataChannel (input->getChannelType(), decimation.outputSampleRate, this, uint16 (sub));
+        output->setName (input->getName());
+        output->setBitVolts (input->getBitVolts());
+        output->setDataUnits (input->getDataUnits());
+        output->setRecordState (input->getRecordState());
+        output->setMonitored (input->isMonitored());
+        output->addToHistoricString (input->getHistoricString());
+
+        // each stage holds its history and at most what the one before gives for a chunk
+        ChannelState* state = channelStates.add (new ChannelState());
+        state->decimation = sub;
+
+        int maxInputs = DECIMATOR_CHUNK_SAMPLES;
+
+        for (int k = 0; k < decimation.numStages; ++k)
+        {
+            state->samples[k].malloc (decimation.stages[k].numTaps - 1 + maxInputs);
+            maxInputs = maxInputs / decimation.stages[k].factor + 1;
+        }
+
+        dataChannelArray.set (i, output);
+    }
+
+    resetStates();
+}
+
+
+bool Decimator::enable()
+{
+    resetStates();
+    return true;
+}
+
+
+void Decimator::resetStates()
+{
+    for (int s = 0; s < decimations.size(); ++s)
+    {
+        Decimation& decimation = *decimations[s];
+
+        for (int k = 0; k < decimation.numStages; ++k)
+            decimation.pending[k] = 0;
+
+        decimation.numInputs = 0;
+        decimation.numOutputs = 0;
+        decimation.hasTimestamp = false;
+        decimation.nextTimestamp = 0;
+    }
+
+    for (int ch = 0; ch < channelStates.size(); ++ch)
+    {
+        ChannelState& state = *channelStates[ch];
+        const Decimation& decimation = *decimations[state.decimation];
+
+        for (int k = 0; k < decimation.numStages; ++k)
+        {
+            const int history = decimation.stages[k].numTaps - 1;
+
+            FloatVectorOperations::clear (state.samples[k], history);
+            state.numSamples[k] = history;
+            state.position[k] = history;
+        }
+    }
+}
+
+
+int Decimator::countOutputs (Decimation& decimation, int numInputs)
+{
+    int n = numInputs;
+
+    for (int k = 0; k < decimation.numStages; ++k)
+    {
+        const int stageFactor = decimation.stages[k].factor;
+
+        decimation.pending[k] += n;
+        n = (decimation.pending[k] > 0) ? (decimation.pending[k] + stageFactor - 1) / stageFactor : 0;
+        decimation.pending[k] -= n * stageFactor;
+    }
+
+    return n;
+}
+
+
+void Decimator::process (AudioSampleBuffer& buffer)
+{
+    if (decimations.size() == 0)
+        return;
+
+    // the number of outputs only depends on how many inputs came before, so it is known before the channels are run
+    for (int s = 0; s < decimations.size(); ++s)
+    {
+        Decimation& decimation = *decimations[s];
+
+        decimation.numInputs = getNumSourceSamples (decimation.inputSourceId);
+        decimation.numOutputs = countOutputs (decimation, decimation.numInputs);
+
+        if (! decimation.hasTimestamp)
+        {
+            const uint64 timestamp = getSourceTimestamp (decimation.inputSourceId);
+
+            decimation.nextTimestamp = (timestamp > uint64 (decimation.delaySamples))
+                                     ? (timestamp - decimation.delaySamples) / factor : 0;
+            decimation.hasTimestamp = true;
+        }
+    }
+
+    processChannelsInParallel (buffer, jmin (buffer.getNumChannels(), channelStates.size()));
+
+    for (int s = 0; s < decimations.size(); ++s)
+    {
+        Decimation& decimation = *decimations[s];
+
+        setTimestampAndSamples (decimation.nextTimestamp, decimation.numOutputs, s);
+        decimation.nextTimestamp += decimation.numOutputs;
+    }
+}
+
+
+void Decimator::processChannels (AudioSampleBuffer& buffer, int firstChannel, int lastChannel)
+{
+    for (int ch = firstChannel; ch < lastChannel; ++ch)
+    {
+        ChannelState& state = *channelStates.getUnchecked (ch);
+        decimateChannel (state, buffer.getWritePointer (ch), decimations[state.decimation]->numInputs);
+    }
+}
+
+
+void Decimator::decimateChannel (ChannelState& state, float* data, int numInputs)
+{
+    const Decimation& decimation = *decimations[state.decimation];
+    int numOutputs = 0;
+
+    for (int offset = 0; offset < numInputs; offset += DECIMATOR_CHUNK_SAMPLES)
+    {
+        int count = jmin (DECIMATOR_CHUNK_SAMPLES, numInputs - offset);
+
+        FloatVectorOperations::copy (state.samples[0] + state.numSamples[0], data + offset, count);
+
+        for (int k = 0; k < decimation.numStages; ++k)
+        {
+            const Stage& stage = decimation.stages[k];
+            float* samples = state.samples[k];
+            int& position = state.position[k];
+
+            state.numSamples[k] += count;
+
+            // a stage writes straight into the buffer of the next one, and the last one into the channel,
+            // behind the inputs still to be read
+            const bool isLast = (k == decimation.numStages - 1);
+            float* out = isLast ? data + numOutputs : state.samples[k + 1] + state.numSamples[k + 1];
+
+            count = 0;
+
+            for (; position < state.numSamples[k]; position += stage.factor)
+                out[count++] = innerProduct (stage.taps, samples + position - (stage.numTaps - 1), stage.numTaps);
+
+            const int first = position - (stage.numTaps - 1);
+
+            memmove (samples, samples + first, sizeof (float) * (state.numSamples[k] - first));
+            state.numSamples[k] -= first;
+            position -= first;
+
+            if (isLast)
+                numOutputs += count;
+        }
+    }
+}
@@ -0,0 +1,145 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DECIMATOR_H_INCLUDED
+#define DECIMATOR_H_INCLUDED
+
+
+#ifdef _WIN32
+    #include <Windows.h>
+#endif
+
+#include <ProcessorHeaders.h>
+
+
+#define DECIMATOR_MAX_STAGES 4
+#define DECIMATOR_DEFAULT_FACTOR 12
+
+
+/**
+    Lowers the sample rate of every channel by an integer factor, so that the processors and
+    record engines after it, typically on an LFP branch, handle 10 to 30 times fewer samples.
+
+    The factor is split into stages of decreasing factors, each a linear-phase low-pass FIR
+    of which only the outputs that are kept are computed. The passband is 40% of the final
+    rate; every stage but the last only has to reject what would alias into it, so its
+    transition band is wide and its kernel short, and the last stage, at the lowest rate,
+    makes the sharp cut below the final Nyquist frequency.
+
+    Each source of the input channels becomes a subprocessor of the Decimator, its channels
+    coming out with the lower sample rate and timestamps counted at that rate, shifted back
+    by the delay of the filters.
+*/
+class Decimator : public GenericProcessor
+{
+public:
+    /** The class constructor, used to initialize any members. */
+    Decimator();
+
+    /** The class destructor, used to deallocate memory */
+    ~Decimator();
+
+    /** Decimates the samples of each source and sets the timestamp and number of samples
+        of the matching subprocessor. */
+    void process (AudioSampleBuffer& buffer) override;
+
+    /** Channels are decimated independently, so they can be split across threads.*/
+    bool isChannelParallelSafe() const override { return true; }
+
+    void processChannels (AudioSampleBuffer& buffer, int firstChannel, int lastChannel) override;
+
+    AudioProcessorEditor* createEditor() override;
+
+    bool hasEditor() const override { return true; }
+
+    /** Replaces the input channels with channels of the Decimator's subprocessors */
+    void updateSettings() override;
+
+    int getNumSubProcessors() const override;
+
+    float getSampleRate (int subProcessorIdx = 0) const override;
+
+    bool enable() override;
+
+    int getFactor() const;
+
+    /** Splits a factor into at most DECIMATOR_MAX_STAGES factors in decreasing order, and returns their number */
+    static int getStageFactors (int factor, int* stageFactors);
+
+    /** Sets the decimation factor, which takes effect at the next update of the signal chain */
+    void setParameter (int parameterIndex, float newValue) override;
+
+
+private:
+    struct Stage
+    {
+        int factor;
+        int numTaps;
+        HeapBlock<float> taps;
+    };
+
+    /** The stages of one source, and how many samples each of them is waiting for */
+    struct Decimation
+    {
+        uint32 inputSourceId;
+        float outputSampleRate;
+        int numStages;
+        Stage stages[DECIMATOR_MAX_STAGES];
+        int pending[DECIMATOR_MAX_STAGES];  // inputs beyond the last output, or minus those still needed for the next
+        int delaySamples;                   // delay of the filters, in input samples
+        int numInputs;
+        int numOutputs;
+        bool hasTimestamp;
+        uint64 nextTimestamp;
+    };
+
+    struct ChannelState
+    {
+        int decimation;
+        HeapBlock<float> samples[DECIMATOR_MAX_STAGES];   // numTaps - 1 inputs of history, then the pending ones
+        int numSamples[DECIMATOR_MAX_STAGES];
+        int position[DECIMATOR_MAX_STAGES];               // input aligned with the last tap of the next output
+    };
+
+    /** Designs the stages of a source of the given rate */
+    void designStages (Decimation& decimation, float inputSampleRate);
+
+    /** Clears the history of every stage */
+    void resetStates();
+
+    /** Returns the outputs the given number of inputs will give, updating the pending counts */
+    static int countOutputs (Decimation& decimation, int numInputs);
+
+    void decimateChannel (ChannelState& state, float* data, int numInputs);
+
+    int factor;
+
+    OwnedArray<Decimation> decimations;
+    OwnedArray<ChannelState> channelStates;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Decimator);
+};
+
+
+
+#endif  // DECIMATOR_H_INCLUDED
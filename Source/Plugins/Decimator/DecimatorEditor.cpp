@@ -0,0 +1,122 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "DecimatorEditor.h"
+#include "Decimator.h"
+
+
+DecimatorEditor::DecimatorEditor (GenericProcessor* parentNode, bool useDefaultParameterEditors)
+    : GenericEditor (parentNode, useDefaultParameterEditors)
+{
+    desiredWidth = 130;
+
+    factorLabel = new Label ("factor label", "Factor:");
+    factorLabel->setBounds (10, 25, 80, 20);
+    factorLabel->setFont (Font ("Small Text", 12, Font::plain));
+    factorLabel->setColour (Label::textColourId, Colours::darkgrey);
+    addAndMakeVisible (factorLabel);
+
+    // item ids are the factors, all products of few primes so that they split into short stages
+    factorSelector = new ComboBox ("factor selector");
+    factorSelector->setBounds (15, 42, 100, 20);
+    const int factors[] = { 2, 3, 4, 5, 6, 8, 10, 12, 15, 16, 20, 24, 25, 30, 32, 40, 50, 60 };
+    for (int i = 0; i < numElementsInArray (factors); ++i)
+        factorSelector->addItem (String (factors[i]), factors[i]);
+    factorSelector->setSelectedId (DECIMATOR_DEFAULT_FACTOR, dontSendNotification);
+    factorSelector->setTooltip ("Number of input samples per output sample");
+    factorSelector->addListener (this);
+    addAndMakeVisible (factorSelector);
+
+    rateLabel = new Label ("rate label", "");
+    rateLabel->setBounds (10, 67, 110, 20);
+    rateLabel->setFont (Font ("Small Text", 12, Font::plain));
+    rateLabel->setColour (Label::textColourId, Colours::darkgrey);
+    addAndMakeVisible (rateLabel);
+}
+
+
+DecimatorEditor::~DecimatorEditor()
+{
+}
+
+
+void DecimatorEditor::comboBoxChanged (ComboBox* comboBox)
+{
+    if (comboBox == factorSelector)
+    {
+        getProcessor()->setParameter (0, float (factorSelector->getSelectedId()));
+
+        // the channels downstream change rate
+        CoreServices::updateSignalChain (this);
+    }
+}
+
+
+void DecimatorEditor::updateSettings()
+{
+    GenericProcessor* processor = getProcessor();
+
+    if (processor->getNumOutputs() > 0 && processor->getDataChannel (0) != nullptr)
+        rateLabel->setText ("Output: " + String (processor->getDataChannel (0)->getSampleRate(), 1) + " Hz",
+                            dontSendNotification);
+    else
+        rateLabel->setText ("", dontSendNotification);
+}
+
+
+void DecimatorEditor::startAcquisition()
+{
+    factorSelector->setEnabled (false);
+}
+
+
+void DecimatorEditor::stopAcquisition()
+{
+    factorSelector->setEnabled (true);
+}
+
+
+void DecimatorEditor::saveCustomParameters (XmlElement* xml)
+{
+    xml->setAttribute ("Type", "DecimatorEditor");
+
+    XmlElement* values = xml->createNewChildElement ("VALUES");
+    values->setAttribute ("Factor", factorSelector->getSelectedId());
+}
+
+
+void DecimatorEditor::loadCustomParameters (XmlElement* xml)
+{
+    forEachXmlChildElement (*xml, xmlNode)
+    {
+        if (xmlNode->hasTagName ("VALUES"))
+        {
+            const int factor = xmlNode->getIntAttribute ("Factor", DECIMATOR_DEFAULT_FACTOR);
+            // the signal chain is updated once the whole configuration is loaded
+            factorSelector->setSelectedId (factorSelector->indexOfItemId (factor) >= 0 ? factor : DECIMATOR_DEFAULT_FACTOR,
+                                           dontSendNotification);
+            getProcessor()->setParameter (0, float (factorSelector->getSelectedId()));
+        }
+    }
+}
@@ -0,0 +1,64 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DECIMATOREDITOR_H_INCLUDED
+#define DECIMATOREDITOR_H_INCLUDED
+
+
+#include <EditorHeaders.h>
+
+
+/**
+    User interface for the Decimator, choosing the decimation factor and showing the resulting rate.
+
+    @see Decimator
+*/
+class DecimatorEditor : public GenericEditor
+                      , public ComboBox::Listener
+{
+public:
+    DecimatorEditor (GenericProcessor* parentNode, bool useDefaultParameterEditors);
+    ~DecimatorEditor();
+
+    void comboBoxChanged (ComboBox* comboBox) override;
+
+    /** Shows the output rate of the first channel */
+    void updateSettings() override;
+
+    void startAcquisition() override;
+    void stopAcquisition() override;
+
+    void saveCustomParameters (XmlElement* xml) override;
+    void loadCustomParameters (XmlElement* xml) override;
+
+
+private:
+    ScopedPointer<Label>    factorLabel;
+    ScopedPointer<ComboBox> factorSelector;
+    ScopedPointer<Label>    rateLabel;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DecimatorEditor);
+};
+
+
+#endif  // DECIMATOREDITOR_H_INCLUDED
@@ -49,8 +49,10 @@ public:
     std::map<int, int> chid_map;
     IEcubeAnalogAcquisitionPtr pStrmA;
     IEcubeDigitalInputStreamingPtr pStrmD;
-    HeapBlock<float, true> interleaving_buffer;
+    HeapBlock<float, true> interleaving_buffer; // channel-major, int_buf_size samples per channel
     HeapBlock<uint64_t, true> event_buffer;
+    HeapBlock<int64, true> block_timestamps;
+    HeapBlock<uint64_t, true> block_event_codes; // stays zero, for the analog modes
     HeapBlock<uint32_t, true> bit_conversion_tables;
     bool buf_timestamp_locked;
     unsigned long buf_timestamp;
@@ -83,6 +85,33 @@ void build_bit_conversion_table(uint32_t* table, const char* bits)
     }
 }
 
+// Converts eCube's signed 16-bit samples into floats. Contiguous runs are a plain loop
+// that the compiler vectorizes
+static void convert_samples(const short* source, unsigned long sourceStride, float* dest, unsigned long n, float scale)
+{
+    if (sourceStride == 1)
+    {
+        for (unsigned long i = 0; i < n; i++)
+            dest[i] = source[i] * scale;
+    }
+    else
+    {
+        for (unsigned long i = 0; i < n; i++)
+            dest[i] = source[i * sourceStride] * scale;
+    }
+}
+
+// Sends numSamples samples of every channel of the interleaving buffer out at once, with
+// consecutive timestamps starting from the current buffer timestamp
+static void add_block(DataBuffer* buffer, EcubeDevInt* dev, unsigned long numSamples, uint64_t* eventCodes)
+{
+    int64 cts = dev->buf_timestamp64 / dev->sampletime_80mhz; // Convert eCube 80MHz timestamp into a sample count
+    for (unsigned long j = 0; j < numSamples; j++)
+        dev->block_timestamps[j] = cts + j;
+
+    buffer->addToBuffer(dev->interleaving_buffer, dev->block_timestamps, eventCodes, numSamples, numSamples);
+}
+
 void build_bit_conversion_tables(uint32_t* tables)
 {
     // Bit conversion tables have 256 uint64s for each 8 bits of ecube ports
@@ -230,6 +259,8 @@ EcubeThread::EcubeThread(SourceNode* sn) : DataThread(sn), numberingScheme(1), a
                 sourceBuffers.set(0,new DataBuffer(pDevInt->n_channel_objects, 10000));
                 // Create the interleaving buffer based on the number of channels
                 pDevInt->interleaving_buffer.malloc(sizeof(float)* 1500 * pDevInt->n_channel_objects);
+                pDevInt->block_timestamps.malloc(1500);
+                pDevInt->block_event_codes.calloc(1500);
             }
             else if (selmod == "Panel Analog Input")
             {
@@ -259,6 +290,8 @@ EcubeThread::EcubeThread(SourceNode* sn) : DataThread(sn), numberingScheme(1), a
                 sourceBuffers.set(0,new DataBuffer(32, 10000));
                 // The interleaving buffer is there just for short->float conversion
                 pDevInt->interleaving_buffer.malloc(sizeof(float)* 1500);
+                pDevInt->block_timestamps.malloc(1500);
+                pDevInt->block_event_codes.calloc(1500);
             }
             else if (selmod == "Panel Digital Input")
             {
@@ -288,6 +321,7 @@ EcubeThread::EcubeThread(SourceNode* sn) : DataThread(sn), numberingScheme(1), a
                 pDevInt->interleaving_buffer.malloc(sizeof(float)* 1500 * 64);
                 // Create the analog of interleaving buffer in packed format (int64)
                 pDevInt->event_buffer.malloc(sizeof(uint64_t)* 1500);
+                pDevInt->block_timestamps.malloc(1500);
                 pDevInt->bit_conversion_tables.malloc(sizeof(uint32_t)* 0x600);
                 build_bit_conversion_tables(pDevInt->bit_conversion_tables);
             }
@@ -474,12 +508,7 @@ bool EcubeThread::updateBuffer()
                         {
                             // Interleaving buffer is not empty.
                             // Send its contents out to the application
-                            int64 cts = pDevInt->buf_timestamp64 / pDevInt->sampletime_80mhz; // Convert eCube 80MHz timestamp into a 25kHz timestamp
-                            for (unsigned long j = 0; j < pDevInt->int_buf_size; j++)
-                            {
-								sourceBuffers[0]->addToBuffer(pDevInt->interleaving_buffer + j*nchan, &cts, &ttlEventWords.getReference(0), 1);
-                                cts++;
-                            }
+                            add_block(sourceBuffers[0], pDevInt, pDevInt->int_buf_size, pDevInt->block_event_codes);
                             // Update the 64-bit timestamp, take account of its wrap-around
                             unsigned tsdif = bts - pDevInt->buf_timestamp;
                             pDevInt->buf_timestamp64 += tsdif;
@@ -498,10 +527,8 @@ bool EcubeThread::updateBuffer()
                     chid = chit->second; // Adjust the channel id to become the channel index
                     unsigned char* dp = ab->GetDataPointer();
                     const short* pData = (const short*)dp;
-                    for (unsigned long j = 0; j < datasize; j++)
-                    {
-                        pDevInt->interleaving_buffer[chid + nchan*j] = pData[j] * 6.25e3 / 32768; // Convert into microvolts
-                    }
+                    // Each channel fills its own row of the buffer, converted into microvolts
+                    convert_samples(pData, 1, pDevInt->interleaving_buffer + chid*datasize, datasize, 6.25e3f / 32768);
                 }
                 else if (pDevInt->data_format == EcubeDevInt::dfInterleavedChannelsAnalog)
                 {
@@ -519,17 +546,11 @@ bool EcubeThread::updateBuffer()
                     pDevInt->buf_timestamp_locked = true;
                     unsigned char* dp = ab->GetDataPointer();
                     const short* pData = (const short*)dp;
-                    for (unsigned j = 0; j < datasize; j++)
-                    {
-                        pDevInt->interleaving_buffer[j] = pData[j] * 10.0/32768; // Convert into volts
-                    }
                     unsigned long datasam = datasize / 32;
-                    int64 cts = pDevInt->buf_timestamp64 / pDevInt->sampletime_80mhz; // Convert eCube's 80MHz timestamps into number of samples on the Panel Analog input (orig sample rate 1144)
-                    for (unsigned long j = 0; j < datasam; j++)
-                    {
-						sourceBuffers[0]->addToBuffer(pDevInt->interleaving_buffer + j * 32, &cts, &ttlEventWords.getReference(0), 1);
-                        cts++;
-                    }
+                    // Transpose the 32 interleaved channels into rows, converted into volts
+                    for (unsigned long c = 0; c < 32; c++)
+                        convert_samples(pData + c, 32, pDevInt->interleaving_buffer + c*datasam, datasam, 10.0f / 32768);
+                    add_block(sourceBuffers[0], pDevInt, datasam, pDevInt->block_event_codes);
                 }
                 else // Digital data
                 {
@@ -542,12 +563,7 @@ bool EcubeThread::updateBuffer()
                         {
                             // Interleaving buffer is not empty.
                             // Send its contents out to the application
-                            int64 cts = pDevInt->buf_timestamp64 / pDevInt->sampletime_80mhz; // Convert eCube 80MHz timestamp into a 25kHz timestamp
-                            for (unsigned long j = 0; j < pDevInt->int_buf_size; j++)
-                            {
-                                sourceBuffers[0]->addToBuffer(pDevInt->interleaving_buffer + j*64, &cts, pDevInt->event_buffer+j, 1);
-                                cts++;
-                            }
+                            add_block(sourceBuffers[0], pDevInt, pDevInt->int_buf_size, pDevInt->event_buffer);
                             // Update the 64-bit timestamp, take account of its wrap-around
                             pDevInt->buf_timestamp64 += tsdif;
                         }
@@ -606,7 +622,7 @@ bool EcubeThread::updateBuffer()
                             if (bitchn>=0)
                             {
                                 float val = wrd&msk ? 5.0f : 0.0f; // Convert to 5V/0V values
-                                pDevInt->interleaving_buffer[bitchn + bitchn_offset + 64*j] = val;
+                                pDevInt->interleaving_buffer[(bitchn + bitchn_offset)*datasize + j] = val;
                             }
                             msk <<= 1;
                         }
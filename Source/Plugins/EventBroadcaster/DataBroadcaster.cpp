@@ -0,0 +1,408 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "DataBroadcaster.h"
+#include "DataBroadcasterEditor.h"
+
+
+std::shared_ptr<void> DataBroadcaster::getZMQContext()
+{
+#ifdef ZEROMQ
+    static const std::shared_ptr<void> ctx (zmq_ctx_new(), zmq_ctx_destroy);
+#else
+    static const std::shared_ptr<void> ctx;
+#endif
+    return ctx;
+}
+
+
+void DataBroadcaster::closeZMQSocket (void* socket)
+{
+#ifdef ZEROMQ
+    zmq_close (socket);
+#endif
+}
+
+
+DataBroadcaster::DataBroadcaster()
+    : GenericProcessor  ("Data Broadcaster")
+    , zmqContext        (getZMQContext())
+    , listeningPort     (5558)
+    , dataType          (FLOAT32)
+    , decimation        (1)
+    , ringFifo          (1)
+    , frameScratchSize  (0)
+{
+    setProcessorType (PROCESSOR_TYPE_SINK);
+
+    senderThread = new SenderThread (*this);
+}
+
+
+DataBroadcaster::~DataBroadcaster()
+{
+    senderThread->stopThread (1000);
+}
+
+
+AudioProcessorEditor* DataBroadcaster::createEditor()
+{
+    editor = new DataBroadcasterEditor (this, true);
+    return editor;
+}
+
+
+int DataBroadcaster::getListeningPort() const
+{
+    return listeningPort.get();
+}
+
+
+void DataBroadcaster::setListeningPort (int port)
+{
+    listeningPort = port;
+}
+
+
+DataBroadcaster::DataType DataBroadcaster::getDataType() const
+{
+    return dataType;
+}
+
+
+void DataBroadcaster::setDataType (DataType type)
+{
+    // the editor only offers it while not acquiring
+    dataType = type;
+}
+
+
+int DataBroadcaster::getDecimation() const
+{
+    return decimation;
+}
+
+
+void DataBroadcaster::setDecimation (int factor)
+{
+    decimation = jlimit (1, DATA_BROADCASTER_MAX_DECIMATION, factor);
+}
+
+
+void DataBroadcaster::buildSourceGroups()
+{
+    sourceGroups.clear();
+
+    Array<int> channels = getEditor()->getActiveChannels();
+
+    for (int i = 0; i < channels.size(); ++i)
+    {
+        const DataChannel* channel = getDataChannel (channels[i]);
+
+        if (channel == nullptr)
+            continue;
+
+        const uint32 sourceID = getProcessorFullId (channel->getSourceNodeID(), channel->getSubProcessorIdx());
+        SourceGroup* group = nullptr;
+
+        for (int g = 0; g < sourceGroups.size() && group == nullptr; ++g)
+        {
+            if (sourceGroups[g]->sourceID == sourceID)
+                group = sourceGroups[g];
+        }
+
+        if (group == nullptr)
+        {
+            group = sourceGroups.add (new SourceGroup());
+            group->sourceID = sourceID;
+            group->sampleRate = channel->getSampleRate();
+            group->decimationPhase = 0;
+        }
+
+        const float bitVolts = channel->getBitVolts();
+
+        group->channels.add (channels[i]);
+        group->countsPerMicrovolt.add (bitVolts > 0 ? 1.0f / bitVolts : 1.0f);
+    }
+}
+
+
+bool DataBroadcaster::enable()
+{
+    buildSourceGroups();
+
+    ringData.malloc (DATA_BROADCASTER_RING_BYTES);
+    ringFifo.setTotalSize (DATA_BROADCASTER_RING_BYTES);
+    ringFifo.reset();
+    droppedFrames = 0;
+
+    senderThread->startThread();
+
+    return true;
+}
+
+
+bool DataBroadcaster::disable()
+{
+    // the frames still in the ring are sent before the thread exits
+    senderThread->stopThread (1000);
+
+    if (droppedFrames.get() > 0)
+        std::cout << "Data Broadcaster dropped " << droppedFrames.get() << " frames that the network could not keep up with." << std::endl;
+
+    return true;
+}
+
+
+void DataBroadcaster::process (AudioSampleBuffer& continuousBuffer)
+{
+    const int valueSize = (dataType == INT16) ? sizeof (int16) : sizeof (float);
+
+    for (int g = 0; g < sourceGroups.size(); ++g)
+    {
+        SourceGroup* group = sourceGroups[g];
+        const int nChannels = group->channels.size();
+        const int nSamples = getNumSamples (group->channels[0]);
+
+        // one sample out of every decimation, carrying on from the previous block
+        const int first = group->decimationPhase;
+
+        if (first >= nSamples)
+        {
+            group->decimationPhase -= nSamples;
+            continue;
+        }
+
+        const int nKept = (nSamples - first + decimation - 1) / decimation;
+        group->decimationPhase = first + nKept * decimation - nSamples;
+
+        const int frameBytes = sizeof (DataFrameHeader) + nKept * nChannels * valueSize;
+
+        if (frameBytes > ringFifo.getFreeSpace())
+        {
+            ++droppedFrames;
+            continue;
+        }
+
+        if (frameBytes > frameScratchSize)
+        {
+            frameScratchSize = frameBytes * 2;
+            frameScratch.realloc (frameScratchSize);
+        }
+
+        DataFrameHeader* header = reinterpret_cast<DataFrameHeader*> (frameScratch.getData());
+        header->sourceID = group->sourceID;
+        header->nChannels = (uint16) nChannels;
+        header->dataType = (uint8) dataType;
+        header->decimation = (uint8) decimation;
+        header->timestamp = (int64) getTimestamp (group->channels[0]) + first;
+        header->nSamples = (uint32) nKept;
+        header->sampleRate = group->sampleRate / decimation;
+
+        char* payload = frameScratch + sizeof (DataFrameHeader);
+
+        for (int c = 0; c < nChannels; ++c)
+        {
+            const float* source = continuousBuffer.getReadPointer (group->channels[c], first);
+
+            if (dataType == INT16)
+            {
+                int16* dest = reinterpret_cast<int16*> (payload) + c * nKept;
+                const float scale = group->countsPerMicrovolt[c];
+
+                for (int i = 0; i < nKept; ++i)
+                    dest[i] = (int16) jlimit (-32768, 32767, roundToInt (source[i * decimation] * scale));
+            }
+            else
+            {
+                float* dest = reinterpret_cast<float*> (payload) + c * nKept;
+
+                if (decimation == 1)
+                {
+                    FloatVectorOperations::copy (dest, source, nKept);
+                }
+                else
+                {
+                    for (int i = 0; i < nKept; ++i)
+                        dest[i] = source[i * decimation];
+                }
+            }
+        }
+
+        pushFrame (frameScratch, frameBytes);
+    }
+
+    senderThread->notify();
+}
+
+
+void DataBroadcaster::pushFrame (const char* frame, int numBytes)
+{
+    int start1, size1, start2, size2;
+    ringFifo.prepareToWrite (numBytes, start1, size1, start2, size2);
+
+    memcpy (ringData + start1, frame, size1);
+
+    if (size2 > 0)
+        memcpy (ringData + start2, frame + size1, size2);
+
+    // the whole frame, so that the sender never sees a header without its samples
+    ringFifo.finishedWrite (size1 + size2);
+}
+
+
+void DataBroadcaster::readFromRing (void* dest, int numBytes)
+{
+    int start1, size1, start2, size2;
+    ringFifo.prepareToRead (numBytes, start1, size1, start2, size2);
+
+    memcpy (dest, ringData + start1, size1);
+
+    if (size2 > 0)
+        memcpy (static_cast<char*> (dest) + size1, ringData + start2, size2);
+
+    ringFifo.finishedRead (size1 + size2);
+}
+
+
+void DataBroadcaster::saveCustomParametersToXml (XmlElement* parentElement)
+{
+    XmlElement* mainNode = parentElement->createNewChildElement ("DATABROADCASTER");
+    mainNode->setAttribute ("port", getListeningPort());
+    mainNode->setAttribute ("dataType", (int) dataType);
+    mainNode->setAttribute ("decimation", decimation);
+}
+
+
+void DataBroadcaster::loadCustomParametersFromXml()
+{
+    if (parametersAsXml)
+    {
+        forEachXmlChildElement (*parametersAsXml, mainNode)
+        {
+            if (mainNode->hasTagName ("DATABROADCASTER"))
+            {
+                setListeningPort (mainNode->getIntAttribute ("port", 5558));
+                setDataType (mainNode->getIntAttribute ("dataType", FLOAT32) == INT16 ? INT16 : FLOAT32);
+                setDecimation (mainNode->getIntAttribute ("decimation", 1));
+
+                static_cast<DataBroadcasterEditor*> (getEditor())->updateSettingsFromProcessor();
+            }
+        }
+    }
+}
+
+
+// ----------------------------------------------------------------
+
+DataBroadcaster::SenderThread::SenderThread (DataBroadcaster& owner_)
+    : Thread            ("Data Broadcaster")
+    , owner             (owner_)
+    , socket            (nullptr, &DataBroadcaster::closeZMQSocket)
+    , boundPort         (0)
+    , samplesSize       (0)
+{
+}
+
+
+void DataBroadcaster::SenderThread::bindSocket (int port)
+{
+    // tried once per port, not to flood the console if it is taken
+    boundPort = port;
+
+#ifdef ZEROMQ
+    socket.reset (zmq_socket (owner.zmqContext.get(), ZMQ_PUB));
+
+    if (! socket)
+    {
+        std::cout << "Failed to create socket: " << zmq_strerror (zmq_errno()) << std::endl;
+        return;
+    }
+
+    String url = String ("tcp://*:") + String (port);
+
+    if (0 != zmq_bind (socket.get(), url.toRawUTF8()))
+    {
+        std::cout << "Failed to open socket: " << zmq_strerror (zmq_errno()) << std::endl;
+        socket.reset();
+    }
+#endif
+}
+
+
+bool DataBroadcaster::SenderThread::sendNextFrame()
+{
+    if (owner.ringFifo.getNumReady() < (int) sizeof (DataFrameHeader))
+        return false;
+
+    DataFrameHeader header;
+    owner.readFromRing (&header, sizeof (header));
+
+    const size_t valueSize = (header.dataType == INT16) ? sizeof (int16) : sizeof (float);
+    const size_t numBytes = (size_t) header.nChannels * header.nSamples * valueSize;
+
+    if (numBytes > samplesSize)
+    {
+        samplesSize = numBytes;
+        samples.realloc (samplesSize);
+    }
+
+    owner.readFromRing (samples, (int) numBytes);
+
+#ifdef ZEROMQ
+    // a PUB socket drops messages rather than blocking when a subscriber is slow
+    if (socket != nullptr
+        && (-1 == zmq_send (socket.get(), &header, sizeof (header), ZMQ_SNDMORE)
+            || -1 == zmq_send (socket.get(), samples, numBytes, 0)))
+    {
+        std::cout << "Failed to send message: " << zmq_strerror (zmq_errno()) << std::endl;
+    }
+#endif
+
+    return true;
+}
+
+
+void DataBroadcaster::SenderThread::run()
+{
+    while (! threadShouldExit())
+    {
+        const int port = owner.getListeningPort();
+
+        if (port != boundPort)
+            bindSocket (port);
+
+        while (sendNextFrame())
+        {
+        }
+
+        wait (20);
+    }
+
+    while (sendNextFrame())
+    {
+    }
+
+    socket.reset();
+    boundPort = 0;
+}
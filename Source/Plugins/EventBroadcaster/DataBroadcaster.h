@@ -0,0 +1,179 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef DATABROADCASTER_H_INCLUDED
+#define DATABROADCASTER_H_INCLUDED
+
+#include <ProcessorHeaders.h>
+
+#ifdef ZEROMQ
+    #ifdef WIN32
+        #include <zmq.h>
+        #include <zmq_utils.h>
+    #else
+        #include <zmq.h>
+    #endif
+#endif
+
+#include <memory>
+
+#define DATA_BROADCASTER_RING_BYTES (1 << 24)   // about 2 s of 128 float channels at 30 kHz
+#define DATA_BROADCASTER_MAX_DECIMATION 64
+
+
+/**
+
+ Header of each frame published by the DataBroadcaster. It is the first part of a two-part
+ ZeroMQ message, the second part holding the samples of the frame: nChannels rows of
+ nSamples values each, in the order the channels were selected. Everything is sent in the
+ byte order of the machine, which is little-endian on every supported platform.
+
+ */
+
+struct DataFrameHeader
+{
+    uint32 sourceID;        // full id of the processor and subprocessor the channels come from
+    uint16 nChannels;
+    uint8 dataType;         // a DataBroadcaster::DataType
+    uint8 decimation;
+    int64 timestamp;        // of the first sample, in samples of the source
+    uint32 nSamples;
+    float sampleRate;       // of the samples of the frame, after decimation
+};
+
+
+/**
+
+ Publishes the selected continuous channels on a ZeroMQ PUB socket, one frame per block
+ and per source of the channels.
+
+ process() only copies the frames to a lock-free ring; a sender thread owns the socket and
+ publishes them, so that a slow network never holds up the processing thread. Frames that
+ do not fit in the ring are dropped. Channels are sent either as int16 ADC counts, using
+ their bitVolts, or as float microvolts, keeping one sample out of every "decimation".
+
+ @see EventBroadcaster
+
+ */
+
+class DataBroadcaster : public GenericProcessor
+{
+public:
+    enum DataType
+    {
+        INT16 = 0,
+        FLOAT32 = 1
+    };
+
+    DataBroadcaster();
+    ~DataBroadcaster();
+
+    AudioProcessorEditor* createEditor() override;
+
+    int getListeningPort() const;
+
+    /** Takes effect immediately if acquiring, the socket being bound when acquisition starts otherwise */
+    void setListeningPort (int port);
+
+    DataType getDataType() const;
+    void setDataType (DataType type);
+
+    int getDecimation() const;
+    void setDecimation (int factor);
+
+    bool enable() override;
+    bool disable() override;
+
+    void process (AudioSampleBuffer& continuousBuffer) override;
+
+    bool isPassThroughChannel (int) const override { return true; }
+
+    void saveCustomParametersToXml (XmlElement* parentElement) override;
+    void loadCustomParametersFromXml() override;
+
+private:
+    /** Owns the socket, and publishes the frames queued by process() */
+    class SenderThread : public Thread
+    {
+    public:
+        SenderThread (DataBroadcaster& owner);
+
+        void run() override;
+
+    private:
+        void bindSocket (int port);
+
+        /** Publishes the next frame of the ring, returning false if there is none */
+        bool sendNextFrame();
+
+        DataBroadcaster& owner;
+        std::unique_ptr<void, void (*)(void*)> socket;
+        int boundPort;
+
+        HeapBlock<char> samples;
+        size_t samplesSize;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SenderThread);
+    };
+
+    /** The selected channels of one source, published as one frame per block */
+    struct SourceGroup
+    {
+        uint32 sourceID;
+        float sampleRate;
+        Array<int> channels;
+        Array<float> countsPerMicrovolt;
+        int decimationPhase;        // of the first sample of the next block to keep
+    };
+
+    void buildSourceGroups();
+
+    /** Copies a frame to the ring, which must have room for it */
+    void pushFrame (const char* frame, int numBytes);
+
+    /** Copies and consumes the next numBytes of the ring */
+    void readFromRing (void* dest, int numBytes);
+
+    static std::shared_ptr<void> getZMQContext();
+    static void closeZMQSocket (void* socket);
+
+    const std::shared_ptr<void> zmqContext;
+    Atomic<int> listeningPort;
+    DataType dataType;
+    int decimation;
+
+    OwnedArray<SourceGroup> sourceGroups;
+
+    AbstractFifo ringFifo;                  // of bytes, written by process(), read by the sender thread
+    HeapBlock<char> ringData;
+    HeapBlock<char> frameScratch;           // the frame being built by process()
+    int frameScratchSize;
+    Atomic<int> droppedFrames;
+
+    ScopedPointer<SenderThread> senderThread;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DataBroadcaster);
+};
+
+
+#endif  // DATABROADCASTER_H_INCLUDED
@@ -0,0 +1,127 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "DataBroadcasterEditor.h"
+#include "DataBroadcaster.h"
+
+
+DataBroadcasterEditor::DataBroadcasterEditor (GenericProcessor* parentNode, bool useDefaultParameterEditors)
+    : GenericEditor (parentNode, useDefaultParameterEditors)
+
+{
+    desiredWidth = 180;
+
+    DataBroadcaster* p = (DataBroadcaster*) getProcessor();
+
+    urlLabel = new Label ("Port", "Port:");
+    urlLabel->setBounds (20, 30, 140, 25);
+    addAndMakeVisible (urlLabel);
+
+    portLabel = new Label ("Port", String (p->getListeningPort()));
+    portLabel->setBounds (70, 35, 80, 18);
+    portLabel->setFont (Font ("Default", 15, Font::plain));
+    portLabel->setColour (Label::textColourId, Colours::white);
+    portLabel->setColour (Label::backgroundColourId, Colours::grey);
+    portLabel->setEditable (true);
+    portLabel->addListener (this);
+    addAndMakeVisible (portLabel);
+
+    formatLabel = new Label ("Format", "Format:");
+    formatLabel->setBounds (20, 65, 140, 25);
+    addAndMakeVisible (formatLabel);
+
+    formatSelector = new ComboBox ("Format");
+    formatSelector->addItem ("int16", DataBroadcaster::INT16 + 1);
+    formatSelector->addItem ("float32", DataBroadcaster::FLOAT32 + 1);
+    formatSelector->setBounds (80, 68, 80, 20);
+    formatSelector->addListener (this);
+    addAndMakeVisible (formatSelector);
+
+    decimationLabel = new Label ("Decimation", "Decimate:");
+    decimationLabel->setBounds (20, 95, 140, 25);
+    addAndMakeVisible (decimationLabel);
+
+    decimationSelector = new ComboBox ("Decimation");
+
+    for (int factor = 1; factor <= DATA_BROADCASTER_MAX_DECIMATION; factor *= 2)
+        decimationSelector->addItem (String (factor), factor);
+
+    decimationSelector->setBounds (80, 98, 80, 20);
+    decimationSelector->addListener (this);
+    addAndMakeVisible (decimationSelector);
+
+    updateSettingsFromProcessor();
+}
+
+
+void DataBroadcasterEditor::updateSettingsFromProcessor()
+{
+    DataBroadcaster* p = (DataBroadcaster*) getProcessor();
+
+    portLabel->setText (String (p->getListeningPort()), dontSendNotification);
+    formatSelector->setSelectedId (p->getDataType() + 1, dontSendNotification);
+    decimationSelector->setSelectedId (p->getDecimation(), dontSendNotification);
+}
+
+
+void DataBroadcasterEditor::labelTextChanged (juce::Label* label)
+{
+    if (label == portLabel)
+    {
+        Value val = label->getTextValue();
+
+        DataBroadcaster* p = (DataBroadcaster*) getProcessor();
+        p->setListeningPort (val.getValue());
+    }
+}
+
+
+void DataBroadcasterEditor::comboBoxChanged (ComboBox* comboBox)
+{
+    DataBroadcaster* p = (DataBroadcaster*) getProcessor();
+
+    if (comboBox == formatSelector)
+    {
+        p->setDataType (formatSelector->getSelectedId() == DataBroadcaster::INT16 + 1 ? DataBroadcaster::INT16
+                                                                                       : DataBroadcaster::FLOAT32);
+    }
+    else if (comboBox == decimationSelector)
+    {
+        p->setDecimation (decimationSelector->getSelectedId());
+    }
+}
+
+
+void DataBroadcasterEditor::startAcquisition()
+{
+    // the processor reads these from the processing thread
+    formatSelector->setEnabled (false);
+    decimationSelector->setEnabled (false);
+}
+
+
+void DataBroadcasterEditor::stopAcquisition()
+{
+    formatSelector->setEnabled (true);
+    decimationSelector->setEnabled (true);
+}
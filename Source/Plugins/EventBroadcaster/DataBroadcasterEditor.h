@@ -0,0 +1,66 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef DATABROADCASTEREDITOR_H_INCLUDED
+#define DATABROADCASTEREDITOR_H_INCLUDED
+
+#include <EditorHeaders.h>
+
+
+/**
+
+ User interface for the "DataBroadcaster" sink. The channels to publish are those
+ selected in the channel selector when acquisition starts.
+
+ @see DataBroadcaster
+
+ */
+
+class DataBroadcasterEditor : public GenericEditor, public Label::Listener, public ComboBox::Listener
+{
+public:
+    DataBroadcasterEditor (GenericProcessor* parentNode, bool useDefaultParameterEditors);
+
+    void labelTextChanged (juce::Label* label) override;
+    void comboBoxChanged (ComboBox* comboBox) override;
+
+    void startAcquisition() override;
+    void stopAcquisition() override;
+
+    /** Shows the settings of the processor, after they were loaded */
+    void updateSettingsFromProcessor();
+
+private:
+    ScopedPointer<Label> urlLabel;
+    ScopedPointer<Label> portLabel;
+    ScopedPointer<Label> formatLabel;
+    ScopedPointer<ComboBox> formatSelector;
+    ScopedPointer<Label> decimationLabel;
+    ScopedPointer<ComboBox> decimationSelector;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DataBroadcasterEditor);
+
+};
+
+
+#endif  // DATABROADCASTEREDITOR_H_INCLUDED
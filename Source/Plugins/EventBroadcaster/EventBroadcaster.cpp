@@ -34,12 +34,22 @@ void EventBroadcaster::closeZMQSocket(void* socket)
 EventBroadcaster::EventBroadcaster()
     : GenericProcessor  ("Event Broadcaster")
     , zmqContext        (getZMQContext())
-    , zmqSocket         (nullptr, &closeZMQSocket)
-    , listeningPort     (0)
+    , listeningPort     (5557)
+    , queueFifo         (EVENT_BROADCASTER_QUEUE_BYTES)
 {
     setProcessorType (PROCESSOR_TYPE_SINK);
 
-    setListeningPort(5557);
+    queueData.malloc (EVENT_BROADCASTER_QUEUE_BYTES);
+
+    // the socket stays bound while the processor exists, so clients can connect before acquisition
+    senderThread = new SenderThread (*this);
+    senderThread->startThread();
+}
+
+
+EventBroadcaster::~EventBroadcaster()
+{
+    senderThread->stopThread (1000);
 }
 
 
@@ -52,55 +62,97 @@ AudioProcessorEditor* EventBroadcaster::createEditor()
 
 int EventBroadcaster::getListeningPort() const
 {
-    return listeningPort;
+    return listeningPort.get();
 }
 
 
 void EventBroadcaster::setListeningPort(int port, bool forceRestart)
 {
-    if ((listeningPort != port) || forceRestart)
+    if ((listeningPort.get() != port) || forceRestart)
     {
-#ifdef ZEROMQ
-        zmqSocket.reset(zmq_socket(zmqContext.get(), ZMQ_PUB));
-        if (!zmqSocket)
-        {
-            std::cout << "Failed to create socket: " << zmq_strerror(zmq_errno()) << std::endl;
-            return;
-        }
-
-        String url = String("tcp://*:") + String(port);
-        if (0 != zmq_bind(zmqSocket.get(), url.toRawUTF8()))
-        {
-            std::cout << "Failed to open socket: " << zmq_strerror(zmq_errno()) << std::endl;
-            return;
-        }
-#endif
-
         listeningPort = port;
+        restartRequested = 1;
+        senderThread->notify();
     }
 }
 
 
+bool EventBroadcaster::disable()
+{
+    const int dropped = droppedEvents.exchange (0);
+
+    if (dropped > 0)
+        std::cout << "Event Broadcaster dropped " << dropped << " events that could not be sent in time." << std::endl;
+
+    return true;
+}
+
+
 void EventBroadcaster::process(AudioSampleBuffer& continuousBuffer)
 {
     checkForEvents(true);
+
+    // once per block, so that the events of a block are sent together
+    senderThread->notify();
 }
 
 
-//IMPORTANT: The structure of the event buffers has changed drastically, so we need to find a better way of doing this
-void EventBroadcaster::sendEvent(const MidiMessage& event, float eventSampleRate) const
+// copies n bytes at offset pos of a region of the queue, which ends at start1 + size1 and
+// continues at start2
+static void copyToRegion (char* data, int start1, int size1, int start2, int pos, const void* source, int n)
 {
-	double timestampSeconds = double(Event::getTimestamp(event)) / eventSampleRate;
-	uint16 type = Event::getBaseType(event);
+    const int n1 = jlimit (0, n, size1 - pos);
 
-#ifdef ZEROMQ
-	if (-1 == zmq_send(zmqSocket.get(), &type, sizeof(type), ZMQ_SNDMORE) ||
-		-1 == zmq_send(zmqSocket.get(), &timestampSeconds, sizeof(timestampSeconds), ZMQ_SNDMORE) ||
-		-1 == zmq_send(zmqSocket.get(), event.getRawData(), event.getRawDataSize(), 0))
-	{
-		std::cout << "Failed to send message: " << zmq_strerror(zmq_errno()) << std::endl;
-	}
-#endif
+    if (n1 > 0)
+        memcpy (data + start1 + pos, source, n1);
+
+    if (n > n1)
+        memcpy (data + start2 + (pos + n1 - size1), static_cast<const char*> (source) + n1, n - n1);
+}
+
+
+void EventBroadcaster::sendEvent(const MidiMessage& event, float eventSampleRate)
+{
+    QueuedEvent queued;
+    queued.timestampSeconds = double(Event::getTimestamp(event)) / eventSampleRate;
+    queued.type = Event::getBaseType(event);
+    queued.size = (uint32) event.getRawDataSize();
+
+    const int numBytes = sizeof (queued) + (int) queued.size;
+
+    if (numBytes > queueFifo.getFreeSpace())
+    {
+        ++droppedEvents;
+        return;
+    }
+
+    int start1, size1, start2, size2;
+    queueFifo.prepareToWrite (numBytes, start1, size1, start2, size2);
+
+    copyToRegion (queueData, start1, size1, start2, 0, &queued, sizeof (queued));
+    copyToRegion (queueData, start1, size1, start2, sizeof (queued), event.getRawData(), queued.size);
+
+    queueFifo.finishedWrite (size1 + size2);
+}
+
+
+void EventBroadcaster::readFromQueue (void* dest, int numBytes)
+{
+    int start1, size1, start2, size2;
+    queueFifo.prepareToRead (numBytes, start1, size1, start2, size2);
+
+    memcpy (dest, queueData + start1, size1);
+
+    if (size2 > 0)
+        memcpy (static_cast<char*> (dest) + size1, queueData + start2, size2);
+
+    queueFifo.finishedRead (size1 + size2);
+}
+
+void EventBroadcaster::getEventSubscription (EventSubscription& subscription) const
+{
+    // every event and spike, but not the timestamp texts of the sources
+    subscription.setTimestampSyncTexts (false);
 }
 
 void EventBroadcaster::handleEvent(const EventChannel* channelInfo, const MidiMessage& event, int samplePosition)
@@ -116,7 +168,7 @@ void EventBroadcaster::handleSpike(const SpikeChannel* channelInfo, const MidiMe
 void EventBroadcaster::saveCustomParametersToXml(XmlElement* parentElement)
 {
     XmlElement* mainNode = parentElement->createNewChildElement("EVENTBROADCASTER");
-    mainNode->setAttribute("port", listeningPort);
+    mainNode->setAttribute("port", getListeningPort());
 }
 
 
@@ -133,3 +185,94 @@ void EventBroadcaster::loadCustomParametersFromXml()
         }
     }
 }
+
+
+// ----------------------------------------------------------------
+
+EventBroadcaster::SenderThread::SenderThread (EventBroadcaster& owner_)
+    : Thread            ("Event Broadcaster")
+    , owner             (owner_)
+    , zmqSocket         (nullptr, &EventBroadcaster::closeZMQSocket)
+    , boundPort         (0)
+    , eventDataSize     (0)
+{
+}
+
+
+void EventBroadcaster::SenderThread::bindSocket (int port)
+{
+    boundPort = port;
+
+#ifdef ZEROMQ
+    zmqSocket.reset (zmq_socket (owner.zmqContext.get(), ZMQ_PUB));
+    if (!zmqSocket)
+    {
+        std::cout << "Failed to create socket: " << zmq_strerror (zmq_errno()) << std::endl;
+        return;
+    }
+
+    int highWaterMark = EVENT_BROADCASTER_SEND_HWM;
+    zmq_setsockopt (zmqSocket.get(), ZMQ_SNDHWM, &highWaterMark, sizeof (highWaterMark));
+
+    String url = String ("tcp://*:") + String (port);
+    if (0 != zmq_bind (zmqSocket.get(), url.toRawUTF8()))
+    {
+        std::cout << "Failed to open socket: " << zmq_strerror (zmq_errno()) << std::endl;
+        zmqSocket.reset();
+    }
+#endif
+}
+
+
+bool EventBroadcaster::SenderThread::sendNextEvent()
+{
+    if (owner.queueFifo.getNumReady() < (int) sizeof (QueuedEvent))
+        return false;
+
+    // written at once with its raw data, which is therefore in the queue too
+    QueuedEvent queued;
+    owner.readFromQueue (&queued, sizeof (queued));
+
+    if (queued.size > eventDataSize)
+    {
+        eventDataSize = queued.size;
+        eventData.realloc (eventDataSize);
+    }
+
+    owner.readFromQueue (eventData, (int) queued.size);
+
+#ifdef ZEROMQ
+    // a PUB socket drops the messages of a subscriber past the high-water mark rather than blocking
+    if (zmqSocket
+        && (-1 == zmq_send (zmqSocket.get(), &queued.type, sizeof (queued.type), ZMQ_SNDMORE | ZMQ_DONTWAIT) ||
+            -1 == zmq_send (zmqSocket.get(), &queued.timestampSeconds, sizeof (queued.timestampSeconds), ZMQ_SNDMORE | ZMQ_DONTWAIT) ||
+            -1 == zmq_send (zmqSocket.get(), eventData, queued.size, ZMQ_DONTWAIT)))
+    {
+        std::cout << "Failed to send message: " << zmq_strerror (zmq_errno()) << std::endl;
+    }
+#endif
+
+    return true;
+}
+
+
+void EventBroadcaster::SenderThread::run()
+{
+    while (!threadShouldExit())
+    {
+        if (owner.restartRequested.exchange (0) != 0 || boundPort == 0)
+            bindSocket (owner.getListeningPort());
+
+        while (sendNextEvent())
+        {
+        }
+
+        wait (20);
+    }
+
+    while (sendNextEvent())
+    {
+    }
+
+    zmqSocket.reset();
+}
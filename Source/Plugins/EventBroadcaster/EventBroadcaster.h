@@ -24,33 +24,98 @@
 
 #include <memory>
 
+#define EVENT_BROADCASTER_QUEUE_BYTES (1 << 20)
+#define EVENT_BROADCASTER_SEND_HWM 10000        // messages queued by ZeroMQ per subscriber
+
+
+/**
+
+ Publishes every event and spike received on a ZeroMQ PUB socket, as a three-part message:
+ the event type, its timestamp in seconds, and the raw event.
+
+ handleEvent() and handleSpike() only copy the events to a lock-free queue, which a sender
+ thread owning the socket drains, so that neither the socket nor a slow subscriber can hold
+ up the processing thread. Events that do not fit in the queue are dropped and counted.
+
+ */
 
 class EventBroadcaster : public GenericProcessor
 {
 public:
     EventBroadcaster();
+    ~EventBroadcaster();
 
     AudioProcessorEditor* createEditor() override;
 
     int getListeningPort() const;
+
+    /** Asks the sender thread to bind the socket to a new port, which it does shortly after */
     void setListeningPort (int port, bool forceRestart = false);
 
+    bool disable() override;
+
     void process (AudioSampleBuffer& continuousBuffer) override;
+
+    bool isPassThroughChannel (int) const override { return true; }
     void handleEvent (const EventChannel* channelInfo, const MidiMessage& event, int samplePosition = 0) override;
 	void handleSpike(const SpikeChannel* channelInfo, const MidiMessage& event, int samplePosition = 0) override;
+    void getEventSubscription (EventSubscription& subscription) const override;
 
     void saveCustomParametersToXml (XmlElement* parentElement) override;
     void loadCustomParametersFromXml() override;
 
 
 private:
-	void sendEvent(const MidiMessage& event, float eventSampleRate) const;
+    /** Owns the socket, and publishes the events queued by sendEvent() */
+    class SenderThread : public Thread
+    {
+    public:
+        SenderThread (EventBroadcaster& owner);
+
+        void run() override;
+
+    private:
+        void bindSocket (int port);
+
+        /** Publishes the next queued event, returning false if there is none */
+        bool sendNextEvent();
+
+        EventBroadcaster& owner;
+        std::unique_ptr<void, void (*)(void*)> zmqSocket;
+        int boundPort;
+
+        HeapBlock<char> eventData;
+        size_t eventDataSize;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SenderThread);
+    };
+
+    /** Precedes the raw data of each event in the queue */
+    struct QueuedEvent
+    {
+        double timestampSeconds;
+        uint32 size;
+        uint16 type;
+    };
+
+    /** Queues an event for the sender thread */
+	void sendEvent(const MidiMessage& event, float eventSampleRate);
+
+    /** Copies and consumes the next numBytes of the queue */
+    void readFromQueue (void* dest, int numBytes);
+
     static std::shared_ptr<void> getZMQContext();
     static void closeZMQSocket (void* socket);
 
     const std::shared_ptr<void> zmqContext;
-    std::unique_ptr<void, decltype (&closeZMQSocket)> zmqSocket;
-    int listeningPort;
+    Atomic<int> listeningPort;
+    Atomic<int> restartRequested;
+
+    AbstractFifo queueFifo;         // of bytes, written by the processing thread, read by the sender thread
+    HeapBlock<char> queueData;
+    Atomic<int> droppedEvents;
+
+    ScopedPointer<SenderThread> senderThread;
 
 };
 
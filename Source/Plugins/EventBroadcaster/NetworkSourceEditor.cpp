@@ -0,0 +1,200 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "NetworkSourceEditor.h"
+#include "NetworkSourceThread.h"
+
+#define DISCOVERY_TIMEOUT_MS 1000
+
+
+NetworkSourceEditor::NetworkSourceEditor (GenericProcessor* parentNode,
+                                          NetworkSourceThread* thread_,
+                                          bool useDefaultParameterEditors)
+    : GenericEditor (parentNode, useDefaultParameterEditors)
+    , thread        (thread_)
+{
+    desiredWidth = 200;
+
+    endpointsLabel = new Label ("Remotes", "Remotes:");
+    endpointsLabel->setBounds (10, 25, 180, 20);
+    addAndMakeVisible (endpointsLabel);
+
+    endpointsEditor = new Label ("Endpoints", thread->getEndpoints().joinIntoString (", "));
+    endpointsEditor->setBounds (15, 45, 170, 18);
+    endpointsEditor->setFont (Font ("Default", 13, Font::plain));
+    endpointsEditor->setColour (Label::textColourId, Colours::white);
+    endpointsEditor->setColour (Label::backgroundColourId, Colours::grey);
+    endpointsEditor->setEditable (true);
+    endpointsEditor->addListener (this);
+    addAndMakeVisible (endpointsEditor);
+
+    jitterLabel = new Label ("Jitter", "Jitter (ms):");
+    jitterLabel->setBounds (10, 70, 90, 20);
+    addAndMakeVisible (jitterLabel);
+
+    jitterSelector = new ComboBox ("Jitter");
+    const int delays[] = { 0, 5, 10, 20, 50, 100, 200 };
+
+    for (int i = 0; i < numElementsInArray (delays); ++i)
+        jitterSelector->addItem (String (delays[i]), delays[i] + 1);
+
+    jitterSelector->setSelectedId (thread->getJitterDelay() + 1, dontSendNotification);
+    jitterSelector->setBounds (105, 71, 80, 18);
+    jitterSelector->addListener (this);
+    addAndMakeVisible (jitterSelector);
+
+    connectButton = new UtilityButton ("CONNECT", Font ("Small Text", 13, Font::plain));
+    connectButton->setBounds (15, 98, 80, 20);
+    connectButton->addListener (this);
+    addAndMakeVisible (connectButton);
+
+    streamCountLabel = new Label ("Streams", "");
+    streamCountLabel->setBounds (100, 98, 95, 20);
+    streamCountLabel->setFont (Font ("Small Text", 11, Font::plain));
+    addAndMakeVisible (streamCountLabel);
+
+    updateStreamCount();
+}
+
+
+void NetworkSourceEditor::updateStreamCount()
+{
+    const Array<NetworkSourceThread::StreamInfo>& streams = thread->getStreams();
+
+    int numChannels = 0;
+    for (int i = 0; i < streams.size(); ++i)
+        numChannels += streams.getReference (i).numChannels;
+
+    streamCountLabel->setText (String (streams.size()) + " streams, " + String (numChannels) + " ch",
+                               dontSendNotification);
+}
+
+
+void NetworkSourceEditor::labelTextChanged (juce::Label* label)
+{
+    if (label == endpointsEditor)
+    {
+        // the streams found before belong to the previous endpoints
+        thread->setEndpoints (StringArray::fromTokens (label->getText(), ",", ""));
+        thread->setStreams (Array<NetworkSourceThread::StreamInfo>());
+
+        endpointsEditor->setText (thread->getEndpoints().joinIntoString (", "), dontSendNotification);
+        updateStreamCount();
+
+        CoreServices::updateSignalChain (this);
+    }
+}
+
+
+void NetworkSourceEditor::comboBoxChanged (ComboBox* comboBox)
+{
+    if (comboBox == jitterSelector)
+        thread->setJitterDelay (jitterSelector->getSelectedId() - 1);
+}
+
+
+void NetworkSourceEditor::buttonEvent (Button* button)
+{
+    if (button == connectButton && ! acquisitionIsActive)
+    {
+        const int numStreams = thread->discoverStreams (DISCOVERY_TIMEOUT_MS);
+
+        CoreServices::sendStatusMessage ("Network Source found " + String (numStreams) + " streams");
+        updateStreamCount();
+
+        CoreServices::updateSignalChain (this);
+    }
+}
+
+
+void NetworkSourceEditor::startAcquisition()
+{
+    endpointsEditor->setEnabled (false);
+    jitterSelector->setEnabled (false);
+    connectButton->setEnabled (false);
+
+    acquisitionIsActive = true;
+}
+
+
+void NetworkSourceEditor::stopAcquisition()
+{
+    endpointsEditor->setEnabled (true);
+    jitterSelector->setEnabled (true);
+    connectButton->setEnabled (true);
+
+    acquisitionIsActive = false;
+}
+
+
+void NetworkSourceEditor::saveCustomParameters (XmlElement* xml)
+{
+    xml->setAttribute ("Endpoints", thread->getEndpoints().joinIntoString (","));
+    xml->setAttribute ("JitterMs", thread->getJitterDelay());
+    xml->setAttribute ("BitVolts", thread->getBitVolts());
+
+    const Array<NetworkSourceThread::StreamInfo>& streams = thread->getStreams();
+
+    for (int i = 0; i < streams.size(); ++i)
+    {
+        const NetworkSourceThread::StreamInfo& info = streams.getReference (i);
+
+        XmlElement* streamXml = xml->createNewChildElement ("STREAM");
+        streamXml->setAttribute ("endpoint", info.endpoint);
+        streamXml->setAttribute ("sourceID", String (info.sourceID));
+        streamXml->setAttribute ("channels", info.numChannels);
+        streamXml->setAttribute ("sampleRate", info.sampleRate);
+        streamXml->setAttribute ("dataType", info.dataType);
+    }
+}
+
+
+void NetworkSourceEditor::loadCustomParameters (XmlElement* xml)
+{
+    thread->setEndpoints (StringArray::fromTokens (xml->getStringAttribute ("Endpoints"), ",", ""));
+    thread->setJitterDelay (xml->getIntAttribute ("JitterMs", thread->getJitterDelay()));
+    thread->setBitVolts ((float) xml->getDoubleAttribute ("BitVolts", thread->getBitVolts()));
+
+    // the remotes may not be publishing yet, so the streams are not discovered again
+    Array<NetworkSourceThread::StreamInfo> streams;
+
+    forEachXmlChildElementWithTagName (*xml, streamXml, "STREAM")
+    {
+        NetworkSourceThread::StreamInfo info;
+        info.endpoint = streamXml->getIntAttribute ("endpoint");
+        info.sourceID = (uint32) streamXml->getStringAttribute ("sourceID").getLargeIntValue();
+        info.numChannels = streamXml->getIntAttribute ("channels");
+        info.sampleRate = (float) streamXml->getDoubleAttribute ("sampleRate");
+        info.dataType = streamXml->getIntAttribute ("dataType");
+        streams.add (info);
+    }
+
+    thread->setStreams (streams);
+
+    endpointsEditor->setText (thread->getEndpoints().joinIntoString (", "), dontSendNotification);
+    jitterSelector->setSelectedId (thread->getJitterDelay() + 1, dontSendNotification);
+    updateStreamCount();
+
+    CoreServices::updateSignalChain (this);
+}
@@ -0,0 +1,75 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef NETWORKSOURCEEDITOR_H_INCLUDED
+#define NETWORKSOURCEEDITOR_H_INCLUDED
+
+#include <EditorHeaders.h>
+
+class NetworkSourceThread;
+
+
+/**
+
+ User interface for the "Network Source": the Data Broadcasters to receive from, as a comma
+ separated list of "host:port", and the jitter delay. Connect listens to them to find the
+ streams they publish, which become the subprocessors of the source.
+
+ @see NetworkSourceThread
+
+ */
+
+class NetworkSourceEditor : public GenericEditor, public Label::Listener, public ComboBox::Listener
+{
+public:
+    NetworkSourceEditor (GenericProcessor* parentNode, NetworkSourceThread* thread, bool useDefaultParameterEditors);
+
+    void labelTextChanged (juce::Label* label) override;
+    void comboBoxChanged (ComboBox* comboBox) override;
+    void buttonEvent (Button* button) override;
+
+    void startAcquisition() override;
+    void stopAcquisition() override;
+
+    void saveCustomParameters (XmlElement* xml) override;
+    void loadCustomParameters (XmlElement* xml) override;
+
+private:
+    void updateStreamCount();
+
+    NetworkSourceThread* thread;
+
+    ScopedPointer<Label> endpointsLabel;
+    ScopedPointer<Label> endpointsEditor;
+    ScopedPointer<Label> jitterLabel;
+    ScopedPointer<ComboBox> jitterSelector;
+    ScopedPointer<UtilityButton> connectButton;
+    ScopedPointer<Label> streamCountLabel;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (NetworkSourceEditor);
+
+};
+
+
+#endif  // NETWORKSOURCEEDITOR_H_INCLUDED
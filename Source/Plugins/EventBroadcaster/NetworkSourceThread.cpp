@@ -0,0 +1,726 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "NetworkSourceThread.h"
+#include "NetworkSourceEditor.h"
+
+#include <float.h>
+
+#define NETWORK_SOURCE_BLOCK_SIZE 1024         // samples per channel written at once when filling a gap
+#define NETWORK_SOURCE_POLL_MS 1
+#define CLOCK_WINDOW_SECONDS 0.25               // of remote time, over which the smallest delay is kept
+
+
+std::shared_ptr<void> NetworkSourceThread::getZMQContext()
+{
+#ifdef ZEROMQ
+    static const std::shared_ptr<void> ctx (zmq_ctx_new(), zmq_ctx_destroy);
+#else
+    static const std::shared_ptr<void> ctx;
+#endif
+    return ctx;
+}
+
+
+NetworkSourceThread::ClockMapper::ClockMapper()
+{
+    reset();
+}
+
+
+void NetworkSourceThread::ClockMapper::reset()
+{
+    windowStart = -1;
+    windowRemote = 0;
+    windowDelay = 0;
+    numPoints = 0;
+    nextPoint = 0;
+    offset = 0;
+    drift = 0;
+}
+
+
+void NetworkSourceThread::ClockMapper::addObservation (double remoteSeconds, double localSeconds)
+{
+    const double delay = localSeconds - remoteSeconds;
+
+    if (windowStart < 0)
+    {
+        windowStart = remoteSeconds;
+        windowRemote = remoteSeconds;
+        windowDelay = delay;
+    }
+    else if (delay < windowDelay)
+    {
+        windowRemote = remoteSeconds;
+        windowDelay = delay;
+    }
+
+    // until the first window closes, the smallest delay so far is the best estimate
+    if (numPoints == 0)
+        offset = windowDelay;
+
+    if (remoteSeconds - windowStart >= CLOCK_WINDOW_SECONDS)
+    {
+        pointRemote[nextPoint] = windowRemote;
+        pointDelay[nextPoint] = windowDelay;
+        nextPoint = (nextPoint + 1) % NETWORK_SOURCE_CLOCK_POINTS;
+        numPoints = jmin (numPoints + 1, NETWORK_SOURCE_CLOCK_POINTS);
+
+        fit();
+
+        windowStart = remoteSeconds;
+        windowRemote = remoteSeconds;
+        windowDelay = delay;
+    }
+}
+
+
+void NetworkSourceThread::ClockMapper::fit()
+{
+    // delay = offset + drift * remote, computed around the means for a well-conditioned fit
+    double meanRemote = 0, meanDelay = 0;
+
+    for (int i = 0; i < numPoints; ++i)
+    {
+        meanRemote += pointRemote[i];
+        meanDelay += pointDelay[i];
+    }
+
+    meanRemote /= numPoints;
+    meanDelay /= numPoints;
+
+    double covariance = 0, variance = 0;
+
+    for (int i = 0; i < numPoints; ++i)
+    {
+        covariance += (pointRemote[i] - meanRemote) * (pointDelay[i] - meanDelay);
+        variance += (pointRemote[i] - meanRemote) * (pointRemote[i] - meanRemote);
+    }
+
+    drift = variance > 0 ? covariance / variance : 0;
+    offset = meanDelay - drift * meanRemote;
+}
+
+
+double NetworkSourceThread::ClockMapper::getLocalSeconds (double remoteSeconds) const
+{
+    return remoteSeconds + offset + drift * remoteSeconds;
+}
+
+
+NetworkSourceThread::NetworkSourceThread (SourceNode* sn)
+    : DataThread        (sn)
+    , zmqContext        (getZMQContext())
+    , jitterDelayMs     (20)
+    , bitVolts          (0.195f)
+    , payloadSize       (0)
+    , blockSize         (0)
+{
+    resizeBuffers();
+}
+
+
+NetworkSourceThread::~NetworkSourceThread()
+{
+    closeSockets (sockets);
+}
+
+
+GenericEditor* NetworkSourceThread::createEditor (SourceNode* sn)
+{
+    return new NetworkSourceEditor (sn, this, true);
+}
+
+
+bool NetworkSourceThread::foundInputSource() { return true; }
+
+
+bool NetworkSourceThread::isReady()
+{
+    if (streams.isEmpty())
+    {
+        CoreServices::sendStatusMessage ("Network Source: no remote stream, press Connect first");
+        return false;
+    }
+
+    return true;
+}
+
+
+int NetworkSourceThread::getNumDataOutputs (DataChannel::DataChannelTypes type, int sub) const
+{
+    if (type == DataChannel::HEADSTAGE_CHANNEL && isPositiveAndBelow (sub, streams.size()))
+        return streams.getReference (sub).numChannels;
+
+    return 0;
+}
+
+
+int NetworkSourceThread::getNumTTLOutputs (int) const { return 0; }
+
+
+unsigned int NetworkSourceThread::getNumSubProcessors() const
+{
+    return jmax (1, streams.size());
+}
+
+
+float NetworkSourceThread::getSampleRate (int sub) const
+{
+    if (isPositiveAndBelow (sub, streams.size()))
+        return streams.getReference (sub).sampleRate;
+
+    return 30000.0f;
+}
+
+
+float NetworkSourceThread::getBitVolts (const DataChannel*) const { return bitVolts; }
+
+
+bool NetworkSourceThread::hasRawSamples (const DataChannel* chan) const
+{
+    const int sub = chan->getSubProcessorIdx();
+
+    return isPositiveAndBelow (sub, streams.size())
+        && streams.getReference (sub).dataType == DataBroadcaster::INT16;
+}
+
+
+void NetworkSourceThread::resizeBuffers()
+{
+    const int numBuffers = (int) getNumSubProcessors();
+
+    while (sourceBuffers.size() > numBuffers)
+        sourceBuffers.removeLast();
+
+    while (sourceBuffers.size() < numBuffers)
+        sourceBuffers.add (new DataBuffer (1, 10000));
+
+    for (int i = 0; i < sourceBuffers.size(); ++i)
+    {
+        // a second of samples, as frames come in bursts of up to the jitter delay
+        const int numChannels = jmax (1, getNumDataOutputs (DataChannel::HEADSTAGE_CHANNEL, i));
+        sourceBuffers[i]->resize (numChannels, jmax (10000, (int) getSampleRate (i)));
+        sourceBuffers[i]->enableRawSamples (isPositiveAndBelow (i, streams.size())
+                                            && streams.getReference (i).dataType == DataBroadcaster::INT16);
+    }
+}
+
+
+void NetworkSourceThread::setEndpoints (const StringArray& newEndpoints)
+{
+    endpoints = newEndpoints;
+    endpoints.trim();
+    endpoints.removeEmptyStrings();
+
+    while (endpoints.size() > NETWORK_SOURCE_MAX_ENDPOINTS)
+        endpoints.remove (endpoints.size() - 1);
+}
+
+
+const StringArray& NetworkSourceThread::getEndpoints() const { return endpoints; }
+
+
+void NetworkSourceThread::setStreams (const Array<StreamInfo>& newStreams)
+{
+    streams.clearQuick();
+
+    for (int i = 0; i < newStreams.size(); ++i)
+    {
+        const StreamInfo& info = newStreams.getReference (i);
+
+        if (isPositiveAndBelow (info.endpoint, endpoints.size()) && info.numChannels > 0 && info.sampleRate > 0)
+            streams.add (info);
+    }
+}
+
+
+const Array<NetworkSourceThread::StreamInfo>& NetworkSourceThread::getStreams() const { return streams; }
+
+
+void NetworkSourceThread::setJitterDelay (int milliseconds) { jitterDelayMs = jlimit (0, 1000, milliseconds); }
+
+int NetworkSourceThread::getJitterDelay() const { return jitterDelayMs; }
+
+
+void NetworkSourceThread::setBitVolts (float newBitVolts)
+{
+    if (newBitVolts > 0)
+        bitVolts = newBitVolts;
+}
+
+
+float NetworkSourceThread::getBitVolts() const { return bitVolts; }
+
+int64 NetworkSourceThread::getNumLostSamples() const { return lostSamples.get(); }
+
+int NetworkSourceThread::getNumLateFrames() const { return lateFrames.get(); }
+
+
+String NetworkSourceThread::getEndpointUrl (const String& endpoint)
+{
+    return endpoint.contains ("://") ? endpoint : "tcp://" + endpoint;
+}
+
+
+double NetworkSourceThread::getLocalSeconds()
+{
+    return double (CoreServices::getGlobalTimestamp()) / CoreServices::getGlobalSampleRate();
+}
+
+
+bool NetworkSourceThread::openSockets (Array<void*>& newSockets) const
+{
+#ifdef ZEROMQ
+    for (int i = 0; i < endpoints.size(); ++i)
+    {
+        void* socket = zmq_socket (zmqContext.get(), ZMQ_SUB);
+
+        if (socket == nullptr)
+        {
+            std::cout << "Failed to create socket: " << zmq_strerror (zmq_errno()) << std::endl;
+            closeSockets (newSockets);
+            return false;
+        }
+
+        zmq_setsockopt (socket, ZMQ_SUBSCRIBE, "", 0);
+
+        const String url = getEndpointUrl (endpoints[i]);
+
+        if (0 != zmq_connect (socket, url.toRawUTF8()))
+        {
+            std::cout << "Failed to connect to " << url << ": " << zmq_strerror (zmq_errno()) << std::endl;
+            zmq_close (socket);
+            closeSockets (newSockets);
+            return false;
+        }
+
+        newSockets.add (socket);
+    }
+
+    return newSockets.size() > 0;
+#else
+    return false;
+#endif
+}
+
+
+void NetworkSourceThread::closeSockets (Array<void*>& socketsToClose)
+{
+#ifdef ZEROMQ
+    for (int i = 0; i < socketsToClose.size(); ++i)
+        zmq_close (socketsToClose[i]);
+#endif
+
+    socketsToClose.clearQuick();
+}
+
+
+bool NetworkSourceThread::receiveFrame (void* socket, DataFrameHeader& header, bool& isValid)
+{
+    isValid = false;
+
+#ifdef ZEROMQ
+    const int headerSize = zmq_recv (socket, &header, sizeof (header), ZMQ_DONTWAIT);
+
+    if (headerSize < 0)
+        return false;
+
+    int more = 0;
+    size_t moreSize = sizeof (more);
+    zmq_getsockopt (socket, ZMQ_RCVMORE, &more, &moreSize);
+
+    if (headerSize == (int) sizeof (header) && more)
+    {
+        const size_t valueSize = header.dataType == DataBroadcaster::INT16 ? sizeof (int16) : sizeof (float);
+        const size_t numBytes = size_t (header.nChannels) * header.nSamples * valueSize;
+
+        if (numBytes > payloadSize)
+        {
+            payloadSize = numBytes * 2;
+            payload.realloc (payloadSize);
+        }
+
+        // the parts of a message arrive together, so the samples are already there
+        const int received = zmq_recv (socket, payload, numBytes, ZMQ_DONTWAIT);
+
+        zmq_getsockopt (socket, ZMQ_RCVMORE, &more, &moreSize);
+        isValid = received == (int) numBytes && ! more && header.nSamples > 0;
+    }
+
+    // anything else is not a frame of a Data Broadcaster
+    char discard;
+    while (more)
+    {
+        zmq_recv (socket, &discard, 1, ZMQ_DONTWAIT);
+        zmq_getsockopt (socket, ZMQ_RCVMORE, &more, &moreSize);
+    }
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+int NetworkSourceThread::discoverStreams (int timeoutMs)
+{
+    Array<void*> discoverySockets;
+    Array<StreamInfo> found;
+
+    if (! openSockets (discoverySockets))
+    {
+        setStreams (found);
+        return 0;
+    }
+
+#ifdef ZEROMQ
+    zmq_pollitem_t items[NETWORK_SOURCE_MAX_ENDPOINTS];
+
+    for (int i = 0; i < discoverySockets.size(); ++i)
+    {
+        items[i].socket = discoverySockets[i];
+        items[i].fd = 0;
+        items[i].events = ZMQ_POLLIN;
+        items[i].revents = 0;
+    }
+
+    const uint32 end = Time::getMillisecondCounter() + (uint32) timeoutMs;
+
+    while (Time::getMillisecondCounter() < end)
+    {
+        if (zmq_poll (items, discoverySockets.size(), 10) <= 0)
+            continue;
+
+        for (int e = 0; e < discoverySockets.size(); ++e)
+        {
+            DataFrameHeader header;
+            bool isValid;
+
+            while ((items[e].revents & ZMQ_POLLIN) && receiveFrame (discoverySockets[e], header, isValid))
+            {
+                if (! isValid)
+                    continue;
+
+                bool known = false;
+                for (int s = 0; s < found.size() && ! known; ++s)
+                    known = found.getReference (s).endpoint == e && found.getReference (s).sourceID == header.sourceID;
+
+                if (known)
+                    continue;
+
+                StreamInfo info;
+                info.endpoint = e;
+                info.sourceID = header.sourceID;
+                info.numChannels = header.nChannels;
+                info.sampleRate = header.sampleRate;
+                info.dataType = header.dataType;
+                found.add (info);
+            }
+        }
+    }
+#endif
+
+    closeSockets (discoverySockets);
+
+    // the same order whatever order the frames arrived in
+    struct Sorter
+    {
+        static int compareElements (const StreamInfo& a, const StreamInfo& b)
+        {
+            if (a.endpoint != b.endpoint)
+                return a.endpoint - b.endpoint;
+
+            return a.sourceID < b.sourceID ? -1 : (a.sourceID > b.sourceID ? 1 : 0);
+        }
+    } sorter;
+
+    found.sort (sorter);
+    setStreams (found);
+
+    return streams.size();
+}
+
+
+bool NetworkSourceThread::startAcquisition()
+{
+    if (streams.isEmpty() || ! openSockets (sockets))
+        return false;
+
+    states.clear();
+
+    int maxChannels = 1;
+
+    for (int i = 0; i < streams.size(); ++i)
+    {
+        StreamState* state = new StreamState();
+        state->nextTimestamp = -1;
+        state->lastTimestamp = -1;
+        states.add (state);
+
+        maxChannels = jmax (maxChannels, streams.getReference (i).numChannels);
+        sourceBuffers[i]->clear();
+    }
+
+    blockSize = NETWORK_SOURCE_BLOCK_SIZE;
+    gapSamples.calloc (maxChannels * NETWORK_SOURCE_BLOCK_SIZE);
+    gapRawSamples.calloc (maxChannels * NETWORK_SOURCE_BLOCK_SIZE);
+    blockTimestamps.malloc (blockSize);
+    blockEventCodes.calloc (blockSize);
+
+    lostSamples = 0;
+    lateFrames = 0;
+
+    std::cout << "Network Source receiving " << streams.size() << " stream(s) from "
+              << endpoints.size() << " endpoint(s)" << std::endl;
+
+    startThread();
+
+    return true;
+}
+
+
+bool NetworkSourceThread::stopAcquisition()
+{
+    if (isThreadRunning())
+        signalThreadShouldExit();
+
+    if (! waitForThreadToExit (500))
+        std::cout << "Network source thread failed to exit, continuing anyway..." << std::endl;
+
+    closeSockets (sockets);
+    states.clear();
+
+    for (int i = 0; i < sourceBuffers.size(); ++i)
+        sourceBuffers[i]->clear();
+
+    if (lostSamples.get() > 0 || lateFrames.get() > 0)
+        std::cout << "Network Source replaced " << lostSamples.get() << " missing samples by zeros and dropped "
+                  << lateFrames.get() << " late frames." << std::endl;
+
+    return true;
+}
+
+
+int NetworkSourceThread::findStream (int endpoint, uint32 sourceID) const
+{
+    for (int i = 0; i < streams.size(); ++i)
+    {
+        if (streams.getReference (i).endpoint == endpoint && streams.getReference (i).sourceID == sourceID)
+            return i;
+    }
+
+    return -1;
+}
+
+
+bool NetworkSourceThread::updateBuffer()
+{
+#ifdef ZEROMQ
+    zmq_pollitem_t items[NETWORK_SOURCE_MAX_ENDPOINTS];
+
+    for (int i = 0; i < sockets.size(); ++i)
+    {
+        items[i].socket = sockets[i];
+        items[i].fd = 0;
+        items[i].events = ZMQ_POLLIN;
+        items[i].revents = 0;
+    }
+
+    // also a timeout for the deadlines of the frames held back
+    if (zmq_poll (items, sockets.size(), NETWORK_SOURCE_POLL_MS) < 0)
+        return true;
+
+    const double now = getLocalSeconds();
+
+    for (int e = 0; e < sockets.size(); ++e)
+    {
+        DataFrameHeader header;
+        bool isValid;
+
+        while ((items[e].revents & ZMQ_POLLIN) && receiveFrame (sockets[e], header, isValid))
+        {
+            const int stream = isValid ? findStream (e, header.sourceID) : -1;
+
+            if (stream >= 0)
+                queueFrame (stream, header, now);
+        }
+    }
+
+    for (int s = 0; s < states.size(); ++s)
+        releaseFrames (s, now);
+#else
+    sleep (NETWORK_SOURCE_POLL_MS);
+#endif
+
+    return true;
+}
+
+
+void NetworkSourceThread::queueFrame (int stream, const DataFrameHeader& header, double now)
+{
+    const StreamInfo& info = streams.getReference (stream);
+    StreamState* state = states[stream];
+
+    // the remote settings changed since the streams were discovered
+    if (header.nChannels != info.numChannels || header.dataType != info.dataType)
+        return;
+
+    // in samples of the frame, decimated samples being decimation source samples apart
+    const int64 timestamp = header.timestamp / jmax (1, (int) header.decimation);
+    const int numSamples = (int) header.nSamples;
+
+    state->clock.addObservation (double (timestamp + numSamples) / info.sampleRate, now);
+
+    if (state->nextTimestamp >= 0 && timestamp < state->nextTimestamp)
+    {
+        ++lateFrames;
+        return;
+    }
+
+    if (state->pending.size() >= NETWORK_SOURCE_MAX_PENDING_FRAMES)
+        releaseFrames (stream, DBL_MAX);
+
+    PendingFrame* frame = state->freeFrames.size() > 0 ? state->freeFrames.removeAndReturn (state->freeFrames.size() - 1)
+                                                       : new PendingFrame();
+
+    const int numValues = info.numChannels * numSamples;
+
+    if (frame->samples == nullptr || frame->capacity < numValues)
+    {
+        frame->capacity = numValues;
+        frame->samples.malloc (numValues);
+        frame->rawSamples.malloc (numValues);
+    }
+
+    frame->timestamp = timestamp;
+    frame->numSamples = numSamples;
+    frame->deadline = now + jitterDelayMs / 1000.0;
+
+    if (info.dataType == DataBroadcaster::INT16)
+    {
+        const int16* codes = reinterpret_cast<const int16*> (payload.getData());
+        memcpy (frame->rawSamples, codes, numValues * sizeof (int16));
+
+        for (int i = 0; i < numValues; ++i)
+            frame->samples[i] = codes[i] * bitVolts;
+    }
+    else
+    {
+        FloatVectorOperations::copy (frame->samples, reinterpret_cast<const float*> (payload.getData()), numValues);
+    }
+
+    // frames mostly arrive in order, so the search starts from the end
+    int position = state->pending.size();
+    while (position > 0 && state->pending[position - 1]->timestamp > timestamp)
+        --position;
+
+    state->pending.insert (position, frame);
+}
+
+
+void NetworkSourceThread::releaseFrames (int stream, double now)
+{
+    const StreamInfo& info = streams.getReference (stream);
+    StreamState* state = states[stream];
+
+    while (state->pending.size() > 0)
+    {
+        PendingFrame* frame = state->pending[0];
+
+        if (state->nextTimestamp < 0)
+        {
+            // the first frame is also held back, in case the one before it is still on its way
+            if (now < frame->deadline)
+                break;
+
+            state->nextTimestamp = frame->timestamp;
+        }
+
+        if (frame->timestamp > state->nextTimestamp)
+        {
+            if (now < frame->deadline)
+                break;
+
+            const int64 gap = frame->timestamp - state->nextTimestamp;
+
+            if (gap <= NETWORK_SOURCE_MAX_GAP_SECONDS * info.sampleRate)
+            {
+                for (int64 written = 0; written < gap; written += NETWORK_SOURCE_BLOCK_SIZE)
+                {
+                    const int n = (int) jmin ((int64) NETWORK_SOURCE_BLOCK_SIZE, gap - written);
+                    writeSamples (stream, gapSamples, gapRawSamples, state->nextTimestamp + written, n);
+                }
+            }
+
+            // longer gaps, such as a remote restarting its acquisition, are not filled
+            lostSamples += gap;
+            state->nextTimestamp = frame->timestamp;
+        }
+
+        state->pending.removeObject (frame, false);
+
+        // a copy of a frame already written
+        if (frame->timestamp < state->nextTimestamp)
+        {
+            ++lateFrames;
+        }
+        else
+        {
+            writeSamples (stream, frame->samples, frame->rawSamples, frame->timestamp, frame->numSamples);
+            state->nextTimestamp = frame->timestamp + frame->numSamples;
+        }
+
+        state->freeFrames.add (frame);
+    }
+}
+
+
+void NetworkSourceThread::writeSamples (int stream, const float* samples, const int16* rawSamples,
+                                        int64 remoteTimestamp, int numSamples)
+{
+    const float sampleRate = streams.getReference (stream).sampleRate;
+    StreamState* state = states[stream];
+
+    if (numSamples > blockSize)
+    {
+        blockSize = numSamples;
+        blockTimestamps.realloc (blockSize);
+        blockEventCodes.calloc (blockSize);
+    }
+
+    // slewed by at most a sample at frame boundaries as the mapping follows the drift, but never backwards
+    const double localSeconds = state->clock.getLocalSeconds (double (remoteTimestamp) / sampleRate);
+    const int64 first = jmax ((int64) std::floor (localSeconds * sampleRate + 0.5), state->lastTimestamp + 1);
+
+    for (int i = 0; i < numSamples; ++i)
+        blockTimestamps[i] = first + i;
+
+    state->lastTimestamp = first + numSamples - 1;
+
+    // channel-major, as sent by the Data Broadcaster
+    sourceBuffers[stream]->addToBuffer (const_cast<float*> (samples), blockTimestamps, blockEventCodes,
+                                        numSamples, numSamples, rawSamples);
+}
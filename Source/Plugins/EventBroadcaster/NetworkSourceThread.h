@@ -0,0 +1,224 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef NETWORKSOURCETHREAD_H_INCLUDED
+#define NETWORKSOURCETHREAD_H_INCLUDED
+
+#include <DataThreadHeaders.h>
+
+#include "DataBroadcaster.h"
+
+#define NETWORK_SOURCE_MAX_ENDPOINTS 16
+#define NETWORK_SOURCE_MAX_PENDING_FRAMES 64    // per stream, waiting to be put back in order
+#define NETWORK_SOURCE_MAX_GAP_SECONDS 1.0      // longer gaps restart the stream instead of being filled
+#define NETWORK_SOURCE_CLOCK_POINTS 32
+
+
+/**
+
+ Receives the frames published by the Data Broadcasters of other instances of the GUI, so that
+ headstages attached to several machines can feed one signal chain.
+
+ Every source published by a remote Data Broadcaster becomes a subprocessor. The streams are
+ found by listening to the remote endpoints for a moment (discoverStreams()), as their channel
+ counts and sample rates must be known before acquisition starts, and are saved with the
+ rest of the settings.
+
+ Frames are held for the jitter delay before they are written to the DataBuffer, so that frames
+ arriving out of order are put back in order. Frames still missing once the delay has passed
+ are replaced by zeros, and frames arriving after that are dropped.
+
+ Remote timestamps are mapped onto the global timestamp source chosen in the ProcessorGraph,
+ from the time the frames arrive: the lower envelope of (arrival - remote time) is tracked, so
+ the network delay only adds its smallest value, and a line is fitted through it to follow the
+ drift between the clocks. The timestamps of a subprocessor thus count its own samples
+ from the start of the global timestamp source. A Network Source should not be chosen as the
+ global timestamp source itself.
+
+ @see DataBroadcaster, DataThread
+
+ */
+
+class NetworkSourceThread : public DataThread
+{
+public:
+    /** One source of a remote Data Broadcaster, read as one subprocessor */
+    struct StreamInfo
+    {
+        int endpoint;       // index in getEndpoints()
+        uint32 sourceID;    // on the remote machine
+        int numChannels;
+        float sampleRate;
+        int dataType;       // a DataBroadcaster::DataType
+    };
+
+    NetworkSourceThread (SourceNode* sn);
+    ~NetworkSourceThread();
+
+    bool foundInputSource() override;
+    bool isReady() override;
+
+    int getNumDataOutputs (DataChannel::DataChannelTypes type, int subProcessor) const override;
+    int getNumTTLOutputs (int subProcessor) const override;
+    unsigned int getNumSubProcessors() const override;
+
+    float getSampleRate (int subProcessor) const override;
+    float getBitVolts (const DataChannel* chan) const override;
+    bool hasRawSamples (const DataChannel* chan) const override;
+
+    void resizeBuffers() override;
+
+    GenericEditor* createEditor (SourceNode* sn) override;
+
+    /** Sets the Data Broadcasters to receive from, as "host:port" or ZeroMQ urls */
+    void setEndpoints (const StringArray& endpoints);
+    const StringArray& getEndpoints() const;
+
+    /** Listens to every endpoint for up to timeoutMs and replaces the streams with the sources
+        heard from. Returns the number of streams found. Only while acquisition is stopped. */
+    int discoverStreams (int timeoutMs);
+
+    void setStreams (const Array<StreamInfo>& streams);
+    const Array<StreamInfo>& getStreams() const;
+
+    void setJitterDelay (int milliseconds);
+    int getJitterDelay() const;
+
+    /** Sets the microvolts per ADC count the remote Data Broadcasters use for int16 frames */
+    void setBitVolts (float bitVolts);
+    float getBitVolts() const;
+
+    /** Samples replaced by zeros since acquisition started, over all streams */
+    int64 getNumLostSamples() const;
+
+    /** Frames dropped since acquisition started, for arriving after their samples were replaced */
+    int getNumLateFrames() const;
+
+
+private:
+    /** Maps the clock of a remote source onto the global timestamp source */
+    class ClockMapper
+    {
+    public:
+        ClockMapper();
+
+        void reset();
+
+        /** Adds the remote time of the last sample of a frame and the local time it arrived, in seconds */
+        void addObservation (double remoteSeconds, double localSeconds);
+
+        double getLocalSeconds (double remoteSeconds) const;
+
+    private:
+        void fit();
+
+        double windowStart;
+        double windowRemote;
+        double windowDelay;     // the smallest delay seen in the current window
+
+        double pointRemote[NETWORK_SOURCE_CLOCK_POINTS];
+        double pointDelay[NETWORK_SOURCE_CLOCK_POINTS];
+        int numPoints;
+        int nextPoint;
+
+        double offset;
+        double drift;
+    };
+
+    /** A frame waiting in the jitter buffer, converted to float microvolts */
+    struct PendingFrame
+    {
+        int64 timestamp;        // remote, in samples of the frame's sample rate
+        int numSamples;
+        double deadline;        // local seconds after which the frame is written even if frames before it are missing
+        HeapBlock<float> samples;
+        HeapBlock<int16> rawSamples;
+        int capacity;
+    };
+
+    /** What the network thread keeps about each stream during acquisition */
+    struct StreamState
+    {
+        int64 nextTimestamp;    // remote, of the next sample to write, or -1 before the first frame
+        int64 lastTimestamp;    // local, of the last sample written
+        OwnedArray<PendingFrame> pending;       // ordered by timestamp
+        OwnedArray<PendingFrame> freeFrames;
+        ClockMapper clock;
+    };
+
+    bool updateBuffer() override;
+
+    bool startAcquisition() override;
+    bool stopAcquisition()  override;
+
+    bool openSockets (Array<void*>& sockets) const;
+    static void closeSockets (Array<void*>& sockets);
+
+    /** Reads the next message of a socket, returning false if there is none. isValid is
+        set if it was a frame, whose samples are then in payload. */
+    bool receiveFrame (void* socket, DataFrameHeader& header, bool& isValid);
+
+    int findStream (int endpoint, uint32 sourceID) const;
+
+    void queueFrame (int stream, const DataFrameHeader& header, double now);
+
+    /** Writes the frames of a stream that are next in order, or whose deadline has passed */
+    void releaseFrames (int stream, double now);
+
+    void writeSamples (int stream, const float* samples, const int16* rawSamples, int64 remoteTimestamp, int numSamples);
+
+    /** Local time, in seconds of the global timestamp source */
+    static double getLocalSeconds();
+
+    static String getEndpointUrl (const String& endpoint);
+
+    static std::shared_ptr<void> getZMQContext();
+
+    const std::shared_ptr<void> zmqContext;
+
+    StringArray endpoints;
+    Array<StreamInfo> streams;
+    int jitterDelayMs;
+    float bitVolts;
+
+    Array<void*> sockets;
+    OwnedArray<StreamState> states;
+
+    HeapBlock<char> payload;
+    size_t payloadSize;
+
+    HeapBlock<float> gapSamples;
+    HeapBlock<int16> gapRawSamples;
+    HeapBlock<int64> blockTimestamps;
+    HeapBlock<uint64> blockEventCodes;
+    int blockSize;
+
+    Atomic<int64> lostSamples;
+    Atomic<int> lateFrames;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (NetworkSourceThread);
+};
+
+
+#endif  // NETWORKSOURCETHREAD_H_INCLUDED
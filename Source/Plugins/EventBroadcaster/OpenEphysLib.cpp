@@ -23,6 +23,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <PluginInfo.h>
 #include "EventBroadcaster.h"
+#include "DataBroadcaster.h"
+#include "SharedMemoryOutput.h"
+#include "UdpEventOutput.h"
+#include "NetworkSourceThread.h"
 #include <string>
 #ifdef WIN32
 #include <Windows.h>
@@ -32,7 +36,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #endif
 
 using namespace Plugin;
-#define NUM_PLUGINS 1
+#define NUM_PLUGINS 5
 
 extern "C" EXPORT void getLibInfo(Plugin::LibraryInfo* info)
 {
@@ -52,6 +56,29 @@ extern "C" EXPORT int getPluginInfo(int index, Plugin::PluginInfo* info)
 		info->processor.type = Plugin::SinkProcessor;
 		info->processor.creator = &(Plugin::createProcessor<EventBroadcaster>);
 		break;
+	case 1:
+		info->type = Plugin::PLUGIN_TYPE_PROCESSOR;
+		info->processor.name = "Data Broadcaster";
+		info->processor.type = Plugin::SinkProcessor;
+		info->processor.creator = &(Plugin::createProcessor<DataBroadcaster>);
+		break;
+	case 2:
+		info->type = Plugin::PLUGIN_TYPE_PROCESSOR;
+		info->processor.name = "Shared Memory";
+		info->processor.type = Plugin::SinkProcessor;
+		info->processor.creator = &(Plugin::createProcessor<SharedMemoryOutput>);
+		break;
+	case 3:
+		info->type = Plugin::PLUGIN_TYPE_DATA_THREAD;
+		info->dataThread.name = "Network Source";
+		info->dataThread.creator = &createDataThread<NetworkSourceThread>;
+		break;
+	case 4:
+		info->type = Plugin::PLUGIN_TYPE_PROCESSOR;
+		info->processor.name = "UDP Events";
+		info->processor.type = Plugin::SinkProcessor;
+		info->processor.creator = &(Plugin::createProcessor<UdpEventOutput>);
+		break;
 	default:
 		return -1;
 		break;
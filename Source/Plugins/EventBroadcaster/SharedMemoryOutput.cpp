@@ -0,0 +1,338 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "SharedMemoryOutput.h"
+#include "SharedMemoryOutputEditor.h"
+
+#define SHARED_MEMORY_HEADER_BYTES 4096
+
+
+SharedMemoryOutput::SharedMemoryOutput()
+    : GenericProcessor  ("Shared Memory")
+    , ringSeconds       (SHARED_MEMORY_DEFAULT_SECONDS)
+    , header            (nullptr)
+    , timestamps        (nullptr)
+    , samples           (nullptr)
+    , events            (nullptr)
+    , ringSamples       (0)
+    , samplesWritten    (0)
+    , eventsWritten     (0)
+{
+    setProcessorType (PROCESSOR_TYPE_SINK);
+}
+
+
+SharedMemoryOutput::~SharedMemoryOutput()
+{
+    // the file can take as much memory as the samples it holds, in /dev/shm
+    if (map != nullptr)
+    {
+        closeSharedFile();
+        file.deleteFile();
+    }
+}
+
+
+AudioProcessorEditor* SharedMemoryOutput::createEditor()
+{
+    editor = new SharedMemoryOutputEditor (this, true);
+    return editor;
+}
+
+
+String SharedMemoryOutput::getFilePath() const
+{
+    return filePath;
+}
+
+
+void SharedMemoryOutput::setFilePath (const String& path)
+{
+    // the editor only offers it while not acquiring
+    filePath = path.trim();
+}
+
+
+File SharedMemoryOutput::getFile() const
+{
+    if (filePath.isNotEmpty())
+        return File (filePath);
+
+    File directory = File::getSpecialLocation (File::tempDirectory);
+
+#if JUCE_LINUX
+    if (File ("/dev/shm").isDirectory())
+        directory = File ("/dev/shm");
+#endif
+
+    return directory.getChildFile ("open-ephys-" + String (getNodeId()) + ".shm");
+}
+
+
+int SharedMemoryOutput::getRingSeconds() const
+{
+    return ringSeconds;
+}
+
+
+void SharedMemoryOutput::setRingSeconds (int seconds)
+{
+    ringSeconds = jlimit (1, SHARED_MEMORY_MAX_SECONDS, seconds);
+}
+
+
+void SharedMemoryOutput::publish (int64& field, int64 value)
+{
+    reinterpret_cast<Atomic<int64>&> (field).set (value);
+}
+
+
+void SharedMemoryOutput::publish (int32& field, int32 value)
+{
+    reinterpret_cast<Atomic<int32>&> (field).set (value);
+}
+
+
+bool SharedMemoryOutput::createSharedFile()
+{
+    channels.clear();
+
+    Array<int> activeChannels = getEditor()->getActiveChannels();
+    const DataChannel* first = nullptr;
+
+    for (int i = 0; i < activeChannels.size(); ++i)
+    {
+        const DataChannel* channel = getDataChannel (activeChannels[i]);
+
+        if (channel == nullptr)
+            continue;
+
+        if (first == nullptr)
+            first = channel;
+        else if (channel->getSourceNodeID() != first->getSourceNodeID()
+                 || channel->getSubProcessorIdx() != first->getSubProcessorIdx())
+            continue;
+
+        channels.add (activeChannels[i]);
+    }
+
+    if (activeChannels.size() > channels.size())
+        std::cout << "Shared Memory: only the channels of the first selected source are written." << std::endl;
+
+    if (first == nullptr)
+    {
+        std::cout << "Shared Memory: no channel selected." << std::endl;
+        return false;
+    }
+
+    ringSamples = jmax (1, roundToInt (first->getSampleRate() * ringSeconds));
+
+    const uint64 timestampsOffset = SHARED_MEMORY_HEADER_BYTES;
+    const uint64 samplesOffset = timestampsOffset + (uint64) ringSamples * sizeof (int64);
+    const uint64 samplesBytes = (uint64) channels.size() * ringSamples * sizeof (float);
+    const uint64 eventsOffset = samplesOffset + ((samplesBytes + 7) & ~(uint64) 7);
+    const uint64 totalBytes = eventsOffset + SHARED_MEMORY_RING_EVENTS * sizeof (SharedMemoryEvent);
+
+    // readers still mapping the previous file see it closed, the new one being another file
+    file = getFile();
+    file.deleteFile();
+
+    {
+        FileOutputStream stream (file);
+
+        if (stream.failedToOpen()
+            || ! stream.setPosition ((int64) totalBytes - 1)
+            || ! stream.writeByte (0))
+        {
+            std::cout << "Shared Memory: failed to create " << file.getFullPathName() << std::endl;
+            return false;
+        }
+    }
+
+    map = new MemoryMappedFile (file, MemoryMappedFile::readWrite);
+
+    if (map->getData() == nullptr || map->getSize() < (size_t) totalBytes)
+    {
+        std::cout << "Shared Memory: failed to map " << file.getFullPathName() << std::endl;
+        map = nullptr;
+        return false;
+    }
+
+    char* data = static_cast<char*> (map->getData());
+
+    header = reinterpret_cast<SharedMemoryHeader*> (data);
+    timestamps = reinterpret_cast<int64*> (data + timestampsOffset);
+    samples = reinterpret_cast<float*> (data + samplesOffset);
+    events = reinterpret_cast<SharedMemoryEvent*> (data + eventsOffset);
+
+    zerostruct (*header);
+    strcpy (header->magic, "OESHMEM");
+    header->version = SHARED_MEMORY_VERSION;
+    header->headerBytes = SHARED_MEMORY_HEADER_BYTES;
+    header->numChannels = (uint32) channels.size();
+    header->ringSamples = (uint32) ringSamples;
+    header->sampleRate = first->getSampleRate();
+    header->sourceID = getProcessorFullId (first->getSourceNodeID(), first->getSubProcessorIdx());
+    header->eventBytes = sizeof (SharedMemoryEvent);
+    header->ringEvents = SHARED_MEMORY_RING_EVENTS;
+    header->timestampsOffset = timestampsOffset;
+    header->samplesOffset = samplesOffset;
+    header->eventsOffset = eventsOffset;
+    header->totalBytes = totalBytes;
+
+    std::cout << "Shared Memory: writing " << channels.size() << " channels to " << file.getFullPathName() << std::endl;
+
+    return true;
+}
+
+
+void SharedMemoryOutput::closeSharedFile()
+{
+    if (header != nullptr)
+        publish (header->status, SharedMemoryHeader::CLOSED);
+
+    header = nullptr;
+    timestamps = nullptr;
+    samples = nullptr;
+    events = nullptr;
+    map = nullptr;
+}
+
+
+bool SharedMemoryOutput::enable()
+{
+    closeSharedFile();
+
+    samplesWritten = 0;
+    eventsWritten = 0;
+
+    // acquisition goes on without it, as for the other outputs of this library
+    if (createSharedFile())
+        publish (header->status, SharedMemoryHeader::ACQUIRING);
+
+    return true;
+}
+
+
+bool SharedMemoryOutput::disable()
+{
+    // the file stays mapped, for the readers to get the end of the acquisition
+    if (header != nullptr)
+        publish (header->status, SharedMemoryHeader::STOPPED);
+
+    return true;
+}
+
+
+void SharedMemoryOutput::writeSamples (int row, int64 position, const float* source, int nSamples)
+{
+    float* dest = samples + (size_t) row * ringSamples;
+    const int start = (int) (position % ringSamples);
+    const int size1 = jmin (nSamples, ringSamples - start);
+
+    FloatVectorOperations::copy (dest + start, source, size1);
+
+    if (nSamples > size1)
+        FloatVectorOperations::copy (dest, source + size1, nSamples - size1);
+}
+
+
+void SharedMemoryOutput::process (AudioSampleBuffer& continuousBuffer)
+{
+    if (header == nullptr)
+        return;
+
+    const int nSamples = getNumSamples (channels[0]);
+    const int64 timestamp = (int64) getTimestamp (channels[0]);
+
+    // a block longer than the ring only leaves its end in it
+    const int first = jmax (0, nSamples - ringSamples);
+    const int64 position = samplesWritten + first;
+
+    for (int c = 0; c < channels.size(); ++c)
+        writeSamples (c, position, continuousBuffer.getReadPointer (channels[c], first), nSamples - first);
+
+    for (int i = first; i < nSamples; ++i)
+        timestamps[(samplesWritten + i) % ringSamples] = timestamp + i;
+
+    checkForEvents();
+
+    samplesWritten += nSamples;
+
+    publish (header->eventsWritten, eventsWritten);
+    publish (header->samplesWritten, samplesWritten);
+}
+
+
+void SharedMemoryOutput::getEventSubscription (EventSubscription& subscription) const
+{
+    subscription.setEventTypes (EventSubscription::TTL_EVENTS);
+    subscription.setSpikes (false);
+    subscription.setTimestampSyncTexts (false);
+}
+
+
+void SharedMemoryOutput::handleEvent (const EventChannel* eventInfo, const MidiMessage& event, int samplePosition)
+{
+    if (Event::getEventType (event) != EventChannel::TTL)
+        return;
+
+    TTLEventPtr ttl = TTLEvent::deserializeFromMessage (event, eventInfo);
+
+    SharedMemoryEvent& record = events[eventsWritten % SHARED_MEMORY_RING_EVENTS];
+    record.timestamp = Event::getTimestamp (event);
+    record.sourceID = getProcessorFullId (eventInfo->getSourceNodeID(), eventInfo->getSubProcessorIdx());
+    record.line = (uint16) ttl->getChannel();
+    record.state = ttl->getState() ? 1 : 0;
+    record.reserved = 0;
+
+    // published with the samples, at the end of the block
+    ++eventsWritten;
+}
+
+
+void SharedMemoryOutput::saveCustomParametersToXml (XmlElement* parentElement)
+{
+    XmlElement* mainNode = parentElement->createNewChildElement ("SHAREDMEMORY");
+    mainNode->setAttribute ("path", filePath);
+    mainNode->setAttribute ("seconds", ringSeconds);
+}
+
+
+void SharedMemoryOutput::loadCustomParametersFromXml()
+{
+    if (parametersAsXml)
+    {
+        forEachXmlChildElement (*parametersAsXml, mainNode)
+        {
+            if (mainNode->hasTagName ("SHAREDMEMORY"))
+            {
+                setFilePath (mainNode->getStringAttribute ("path", String()));
+                setRingSeconds (mainNode->getIntAttribute ("seconds", SHARED_MEMORY_DEFAULT_SECONDS));
+
+                static_cast<SharedMemoryOutputEditor*> (getEditor())->updateSettingsFromProcessor();
+            }
+        }
+    }
+}
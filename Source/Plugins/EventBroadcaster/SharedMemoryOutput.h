@@ -0,0 +1,176 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef SHAREDMEMORYOUTPUT_H_INCLUDED
+#define SHAREDMEMORYOUTPUT_H_INCLUDED
+
+#include <ProcessorHeaders.h>
+
+#define SHARED_MEMORY_VERSION 1
+#define SHARED_MEMORY_DEFAULT_SECONDS 10
+#define SHARED_MEMORY_MAX_SECONDS 600
+#define SHARED_MEMORY_RING_EVENTS 4096
+
+
+/**
+
+ Header at the start of the file shared by the SharedMemoryOutput. The file holds, after it:
+
+   at timestampsOffset  int64 timestamps[ringSamples], of each sample, in samples of the source
+   at samplesOffset     float32 samples[numChannels][ringSamples], in microvolts, one row per channel
+   at eventsOffset      SharedMemoryEvent events[ringEvents]
+
+ Sample number n, counted from the start of acquisition, is at index n % ringSamples of
+ the timestamps and of each row, and event number n at index n % ringEvents. samplesWritten
+ and eventsWritten only ever grow, and are only updated once what they count is in place,
+ so that a reader can use samples samplesWritten - ringSamples to samplesWritten - 1 directly
+ in the file. As the oldest of these may be overwritten while they are read, a reader checks
+ samplesWritten again afterwards and discards those older than its new value - ringSamples.
+ Everything is in the byte order of the machine, which is little-endian on every supported
+ platform. Resources/Python/shared_memory_reader.py and Resources/Matlab/SharedMemoryReader.m
+ read this layout.
+
+ */
+
+struct SharedMemoryHeader
+{
+    enum Status
+    {
+        STARTING = 0,           // the file is being laid out
+        ACQUIRING = 1,
+        STOPPED = 2,            // what the file holds stays readable
+        CLOSED = 3              // the file was replaced or deleted, and should be opened again
+    };
+
+    char magic[8];              // "OESHMEM", with its terminating zero
+    uint32 version;             // SHARED_MEMORY_VERSION
+    uint32 headerBytes;
+    uint32 numChannels;
+    uint32 ringSamples;
+    float sampleRate;
+    uint32 sourceID;            // full id of the processor and subprocessor the channels come from
+    uint32 eventBytes;          // sizeof (SharedMemoryEvent)
+    uint32 ringEvents;
+    uint64 timestampsOffset;
+    uint64 samplesOffset;
+    uint64 eventsOffset;
+    uint64 totalBytes;
+    int64 samplesWritten;
+    int64 eventsWritten;
+    int32 status;               // a Status
+    int32 reserved;
+};
+
+
+/** A TTL event of the shared memory, at the layout described with SharedMemoryHeader */
+struct SharedMemoryEvent
+{
+    int64 timestamp;            // in samples of the event's source
+    uint32 sourceID;
+    uint16 line;
+    uint8 state;
+    uint8 reserved;
+};
+
+
+/**
+
+ Exposes the selected continuous channels and the TTL events in a memory-mapped file, for
+ analysis programs on the same machine to read without any copy or system call.
+
+ The channels must come from a single source: the one of the first selected channel is used,
+ and the others are left out. The file is laid out when acquisition starts, in /dev/shm on
+ Linux so that it never goes to disk, and in the temporary directory elsewhere, unless another
+ path is set. It stays mapped, and readable, until acquisition starts again.
+
+ @see SharedMemoryHeader, DataBroadcaster
+
+ */
+
+class SharedMemoryOutput : public GenericProcessor
+{
+public:
+    SharedMemoryOutput();
+    ~SharedMemoryOutput();
+
+    AudioProcessorEditor* createEditor() override;
+
+    /** The path set by the user, empty for the default one */
+    String getFilePath() const;
+    void setFilePath (const String& path);
+
+    /** The file the processor writes, or would write if it started acquiring now */
+    File getFile() const;
+
+    int getRingSeconds() const;
+    void setRingSeconds (int seconds);
+
+    bool enable() override;
+    bool disable() override;
+
+    void process (AudioSampleBuffer& continuousBuffer) override;
+
+    bool isPassThroughChannel (int) const override { return true; }
+
+    void getEventSubscription (EventSubscription& subscription) const override;
+    void handleEvent (const EventChannel* eventInfo, const MidiMessage& event, int samplePosition) override;
+
+    void saveCustomParametersToXml (XmlElement* parentElement) override;
+    void loadCustomParametersFromXml() override;
+
+private:
+    /** Creates and maps the file for the selected channels, returning false if it could not */
+    bool createSharedFile();
+
+    /** Marks the mapped file as closed, for the readers to let it go, and unmaps it */
+    void closeSharedFile();
+
+    /** Copies nSamples to a row of the ring, from sample number position on */
+    void writeSamples (int row, int64 position, const float* source, int nSamples);
+
+    /** Writes a counter or the status of the header, after everything written before it */
+    static void publish (int64& field, int64 value);
+    static void publish (int32& field, int32 value);
+
+    String filePath;
+    int ringSeconds;
+
+    Array<int> channels;
+    File file;
+    ScopedPointer<MemoryMappedFile> map;
+
+    SharedMemoryHeader* header;
+    int64* timestamps;
+    float* samples;
+    SharedMemoryEvent* events;
+    int ringSamples;
+
+    int64 samplesWritten;       // only read and written by the processing thread, which
+    int64 eventsWritten;        // publishes them in the header at the end of each block
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SharedMemoryOutput);
+};
+
+
+#endif  // SHAREDMEMORYOUTPUT_H_INCLUDED
@@ -0,0 +1,105 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "SharedMemoryOutputEditor.h"
+#include "SharedMemoryOutput.h"
+
+
+SharedMemoryOutputEditor::SharedMemoryOutputEditor (GenericProcessor* parentNode, bool useDefaultParameterEditors)
+    : GenericEditor (parentNode, useDefaultParameterEditors)
+
+{
+    desiredWidth = 220;
+
+    pathTitle = new Label ("File", "File:");
+    pathTitle->setBounds (10, 30, 60, 25);
+    addAndMakeVisible (pathTitle);
+
+    pathLabel = new Label ("File", String());
+    pathLabel->setBounds (15, 55, 190, 18);
+    pathLabel->setFont (Font ("Default", 13, Font::plain));
+    pathLabel->setColour (Label::textColourId, Colours::white);
+    pathLabel->setColour (Label::backgroundColourId, Colours::grey);
+    pathLabel->setEditable (true);
+    pathLabel->addListener (this);
+    addAndMakeVisible (pathLabel);
+
+    secondsTitle = new Label ("Seconds", "Seconds:");
+    secondsTitle->setBounds (10, 85, 80, 25);
+    addAndMakeVisible (secondsTitle);
+
+    secondsLabel = new Label ("Seconds", String());
+    secondsLabel->setBounds (90, 90, 60, 18);
+    secondsLabel->setFont (Font ("Default", 15, Font::plain));
+    secondsLabel->setColour (Label::textColourId, Colours::white);
+    secondsLabel->setColour (Label::backgroundColourId, Colours::grey);
+    secondsLabel->setEditable (true);
+    secondsLabel->addListener (this);
+    addAndMakeVisible (secondsLabel);
+
+    updateSettingsFromProcessor();
+}
+
+
+void SharedMemoryOutputEditor::updateSettingsFromProcessor()
+{
+    SharedMemoryOutput* p = (SharedMemoryOutput*) getProcessor();
+
+    // the default path is shown, and kept as the default unless it is edited
+    pathLabel->setText (p->getFile().getFullPathName(), dontSendNotification);
+    pathLabel->setTooltip (p->getFile().getFullPathName());
+    secondsLabel->setText (String (p->getRingSeconds()), dontSendNotification);
+}
+
+
+void SharedMemoryOutputEditor::labelTextChanged (juce::Label* label)
+{
+    SharedMemoryOutput* p = (SharedMemoryOutput*) getProcessor();
+
+    if (label == pathLabel)
+    {
+        p->setFilePath (label->getText());
+    }
+    else if (label == secondsLabel)
+    {
+        p->setRingSeconds (label->getText().getIntValue());
+    }
+
+    updateSettingsFromProcessor();
+}
+
+
+void SharedMemoryOutputEditor::startAcquisition()
+{
+    // the processor lays out its file when acquisition starts
+    pathLabel->setEditable (false);
+    secondsLabel->setEditable (false);
+}
+
+
+void SharedMemoryOutputEditor::stopAcquisition()
+{
+    pathLabel->setEditable (true);
+    secondsLabel->setEditable (true);
+}
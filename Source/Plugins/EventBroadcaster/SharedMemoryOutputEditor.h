@@ -0,0 +1,64 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef SHAREDMEMORYOUTPUTEDITOR_H_INCLUDED
+#define SHAREDMEMORYOUTPUTEDITOR_H_INCLUDED
+
+#include <EditorHeaders.h>
+
+
+/**
+
+ User interface for the "SharedMemoryOutput" sink. The channels to write are those
+ selected in the channel selector when acquisition starts.
+
+ @see SharedMemoryOutput
+
+ */
+
+class SharedMemoryOutputEditor : public GenericEditor, public Label::Listener
+{
+public:
+    SharedMemoryOutputEditor (GenericProcessor* parentNode, bool useDefaultParameterEditors);
+
+    void labelTextChanged (juce::Label* label) override;
+
+    void startAcquisition() override;
+    void stopAcquisition() override;
+
+    /** Shows the settings of the processor, after they were loaded */
+    void updateSettingsFromProcessor();
+
+private:
+    ScopedPointer<Label> pathTitle;
+    ScopedPointer<Label> pathLabel;
+    ScopedPointer<Label> secondsTitle;
+    ScopedPointer<Label> secondsLabel;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SharedMemoryOutputEditor);
+
+};
+
+
+#endif  // SHAREDMEMORYOUTPUTEDITOR_H_INCLUDED
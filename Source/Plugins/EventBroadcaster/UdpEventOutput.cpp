@@ -0,0 +1,418 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "UdpEventOutput.h"
+#include "UdpEventOutputEditor.h"
+
+static_assert (sizeof (UdpEventHeader) == 16 && sizeof (UdpEventRecord) == 32,
+               "the datagrams are sent as laid out in memory");
+
+
+UdpEventOutput::UdpEventOutput()
+    : GenericProcessor  ("UDP Events")
+    , host              ("127.0.0.1")
+    , port              (UDP_EVENT_OUTPUT_DEFAULT_PORT)
+    , coalescing        (false)
+    , sendingFeatures   (true)
+    , queueFifo         (UDP_EVENT_OUTPUT_QUEUE_DATAGRAMS)
+    , sequence          (0)
+{
+    setProcessorType (PROCESSOR_TYPE_SINK);
+
+    queue.malloc (UDP_EVENT_OUTPUT_QUEUE_DATAGRAMS);
+    pending.header.numRecords = 0;
+}
+
+
+UdpEventOutput::~UdpEventOutput()
+{
+    disable();
+}
+
+
+AudioProcessorEditor* UdpEventOutput::createEditor()
+{
+    editor = new UdpEventOutputEditor (this, true);
+    return editor;
+}
+
+
+String UdpEventOutput::getHost() const
+{
+    return host;
+}
+
+
+int UdpEventOutput::getPort() const
+{
+    return port;
+}
+
+
+void UdpEventOutput::setHost (const String& newHost)
+{
+    if (newHost.trim().isNotEmpty())
+        host = newHost.trim();
+}
+
+
+void UdpEventOutput::setPort (int newPort)
+{
+    if (newPort > 0 && newPort < 65536)
+        port = newPort;
+}
+
+
+void UdpEventOutput::setParameter (int parameterIndex, float newValue)
+{
+    if (parameterIndex == 0)
+        coalescing = newValue != 0;
+    else if (parameterIndex == 1)
+        sendingFeatures = newValue != 0;
+}
+
+
+bool UdpEventOutput::isCoalescing() const
+{
+    return coalescing;
+}
+
+
+bool UdpEventOutput::isSendingFeatures() const
+{
+    return sendingFeatures;
+}
+
+
+bool UdpEventOutput::enable()
+{
+    queueFifo.reset();
+    pending.header.numRecords = 0;
+    sequence = 0;
+
+    sentDatagrams = 0;
+    droppedDatagrams = 0;
+    failedDatagrams = 0;
+    sendLatency.reset();
+
+    // a connected socket resolves the host once, rather than on every datagram
+    try
+    {
+        socket = new UDPSocket();
+        socket->connect (host.toStdString(), (unsigned short) port);
+    }
+    catch (SocketException& e)
+    {
+        // acquisition goes on without it, as for the other outputs of this library
+        std::cout << "UDP Events: failed to open a socket to " << host << ":" << port
+                  << ": " << e.what() << std::endl;
+        socket = nullptr;
+        return true;
+    }
+
+    senderThread = new SenderThread (*this);
+    senderThread->startThread (9);
+
+    return true;
+}
+
+
+bool UdpEventOutput::disable()
+{
+    // the sender thread sends what is left in the queue before returning
+    if (senderThread != nullptr)
+    {
+        senderThread->signalThreadShouldExit();
+        senderThread->notify();
+        senderThread->stopThread (1000);
+        senderThread = nullptr;
+    }
+
+    if (socket != nullptr)
+    {
+        socket = nullptr;
+
+        const ProcessorTimingStats::Snapshot latency = sendLatency.getSnapshot();
+
+        std::cout << "UDP Events: sent " << sentDatagrams.get() << " datagrams to " << host << ":" << port
+                  << ", " << droppedDatagrams.get() << " dropped, " << failedDatagrams.get() << " failed"
+                  << (latency.numBlocks > 0 ? ", waited " + latency.getSummary() : String()) << std::endl;
+    }
+
+    return true;
+}
+
+
+UdpEventRecord& UdpEventOutput::addRecord (const EventChannel* eventInfo, int64 sourceTicks)
+{
+    if (pending.header.numRecords == UDP_EVENT_OUTPUT_MAX_RECORDS)
+        flush();
+
+    const int index = pending.header.numRecords++;
+    pending.eventInfo[index] = eventInfo;
+    pending.sourceTicks[index] = sourceTicks;
+
+    UdpEventRecord& record = pending.records[index];
+    zerostruct (record);
+
+    return record;
+}
+
+
+void UdpEventOutput::flush()
+{
+    if (pending.header.numRecords == 0)
+        return;
+
+    memcpy (pending.header.magic, "OEUE", 4);
+    pending.header.version = UDP_EVENT_OUTPUT_VERSION;
+    pending.header.sequence = sequence++;
+    pending.header.reserved = 0;
+
+    int start1, size1, start2, size2;
+    queueFifo.prepareToWrite (1, start1, size1, start2, size2);
+
+    if (size1 == 0)
+    {
+        // its sequence number is skipped, for the receiver to see it missing
+        ++droppedDatagrams;
+    }
+    else
+    {
+        // only the records in use are copied
+        QueuedDatagram& queued = queue[start1];
+        const int numRecords = pending.header.numRecords;
+
+        queued.queuedTicks = Time::getHighResolutionTicks();
+        queued.header = pending.header;
+        memcpy (queued.records, pending.records, numRecords * sizeof (UdpEventRecord));
+        memcpy (queued.eventInfo, pending.eventInfo, numRecords * sizeof (const EventChannel*));
+        memcpy (queued.sourceTicks, pending.sourceTicks, numRecords * sizeof (int64));
+
+        queueFifo.finishedWrite (1);
+    }
+
+    pending.header.numRecords = 0;
+}
+
+
+void UdpEventOutput::process (AudioSampleBuffer& continuousBuffer)
+{
+    if (senderThread == nullptr)
+        return;
+
+    checkForEvents (true);
+    flush();
+
+    // once per block, the events of a block being added together
+    senderThread->notify();
+}
+
+
+void UdpEventOutput::getEventSubscription (EventSubscription& subscription) const
+{
+    subscription.setEventTypes (EventSubscription::TTL_EVENTS);
+    subscription.setSpikes (true);
+    subscription.setTimestampSyncTexts (false);
+}
+
+
+void UdpEventOutput::handleEvent (const EventChannel* eventInfo, const MidiMessage& event, int samplePosition)
+{
+    if (senderThread == nullptr || Event::getEventType (event) != EventChannel::TTL)
+        return;
+
+    if (event.getRawDataSize() < EVENT_BASE_SIZE + (int) eventInfo->getDataSize())
+        return;
+
+    // read in place, without allocating: the line follows the timestamp, the TTL word the header
+    const uint16 line = *reinterpret_cast<const uint16*> (event.getRawData() + 16);
+    const uint8* word = event.getRawData() + EVENT_BASE_SIZE;
+
+    if (size_t (line / 8) >= eventInfo->getDataSize())
+        return;
+
+    const int64 sourceTicks = isEventLatencyMeasurementEnabled()
+                                ? getSourceHostTicks (eventInfo->getSourceNodeID(), eventInfo->getSubProcessorIdx())
+                                : 0;
+
+    UdpEventRecord& record = addRecord (eventInfo, sourceTicks);
+    record.timestamp = Event::getTimestamp (event);
+    record.sourceID = eventInfo->getSourceNodeID();
+    record.type = UdpEventRecord::TTL;
+    record.electrode = line;
+    record.sortedID = (word[line / 8] >> (line % 8)) & 1;
+
+    if (! coalescing)
+        flush();
+}
+
+
+void UdpEventOutput::handleSpike (const SpikeChannel* spikeInfo, const MidiMessage& event, int samplePosition)
+{
+    if (senderThread == nullptr)
+        return;
+
+    // read in place, without allocating
+    SpikeEventView spike (event, spikeInfo);
+
+    if (! spike.isValid())
+        return;
+
+    UdpEventRecord& record = addRecord (nullptr, 0);
+    record.timestamp = spike.getTimestamp();
+    record.sourceID = spike.getSourceID();
+    record.type = UdpEventRecord::SPIKE;
+    record.electrode = (uint16) jmax (0, getSpikeChannelIndex (spike));
+    record.sortedID = spike.getSortedID();
+
+    if (sendingFeatures)
+    {
+        const int peak = (int) spikeInfo->getPrePeakSamples();
+        const int numFeatures = jmin ((int) spikeInfo->getNumChannels(), UDP_EVENT_OUTPUT_MAX_FEATURES);
+
+        // the samples are not necessarily aligned
+        for (int c = 0; c < numFeatures; ++c)
+            memcpy (&record.features[c], spike.getDataPointer (c) + peak, sizeof (float));
+
+        record.numFeatures = (uint8) numFeatures;
+    }
+
+    if (! coalescing)
+        flush();
+}
+
+
+var UdpEventOutput::getStatusInfo() const
+{
+    const ProcessorTimingStats::Snapshot latency = sendLatency.getSnapshot();
+
+    DynamicObject::Ptr info = new DynamicObject();
+    info->setProperty ("destination", host + ":" + String (port));
+    info->setProperty ("sent", sentDatagrams.get());
+    info->setProperty ("dropped", droppedDatagrams.get());
+    info->setProperty ("failed", failedDatagrams.get());
+    info->setProperty ("mean_wait_ms", latency.meanMs);
+    info->setProperty ("p99_wait_ms", latency.p99Ms);
+    return var (info.get());
+}
+
+
+const ProcessorTimingStats& UdpEventOutput::getSendLatencyStats() const
+{
+    return sendLatency;
+}
+
+
+void UdpEventOutput::saveCustomParametersToXml (XmlElement* parentElement)
+{
+    XmlElement* mainNode = parentElement->createNewChildElement ("UDPEVENTS");
+    mainNode->setAttribute ("host", host);
+    mainNode->setAttribute ("port", port);
+    mainNode->setAttribute ("coalesce", coalescing);
+    mainNode->setAttribute ("features", sendingFeatures);
+}
+
+
+void UdpEventOutput::loadCustomParametersFromXml()
+{
+    if (parametersAsXml)
+    {
+        forEachXmlChildElement (*parametersAsXml, mainNode)
+        {
+            if (mainNode->hasTagName ("UDPEVENTS"))
+            {
+                setHost (mainNode->getStringAttribute ("host", host));
+                setPort (mainNode->getIntAttribute ("port", UDP_EVENT_OUTPUT_DEFAULT_PORT));
+                setParameter (0, mainNode->getBoolAttribute ("coalesce", false) ? 1.0f : 0.0f);
+                setParameter (1, mainNode->getBoolAttribute ("features", true) ? 1.0f : 0.0f);
+
+                static_cast<UdpEventOutputEditor*> (getEditor())->updateSettingsFromProcessor();
+            }
+        }
+    }
+}
+
+
+// ----------------------------------------------------------------
+
+UdpEventOutput::SenderThread::SenderThread (UdpEventOutput& owner_)
+    : Thread    ("UDP Events")
+    , owner     (owner_)
+{
+}
+
+
+bool UdpEventOutput::SenderThread::sendNextDatagram()
+{
+    int start1, size1, start2, size2;
+    owner.queueFifo.prepareToRead (1, start1, size1, start2, size2);
+
+    if (size1 == 0)
+        return false;
+
+    const QueuedDatagram& queued = owner.queue[start1];
+    const int numRecords = queued.header.numRecords;
+
+    // the header and the records are contiguous
+    const int numBytes = (int) (sizeof (UdpEventHeader) + numRecords * sizeof (UdpEventRecord));
+
+    try
+    {
+        owner.socket->send (&queued.header, numBytes);
+
+        owner.sendLatency.addBlock (Time::getHighResolutionTicks() - queued.queuedTicks, 0);
+        ++owner.sentDatagrams;
+
+        for (int i = 0; i < numRecords; ++i)
+            if (queued.eventInfo[i] != nullptr)
+                owner.measureEventLatency (queued.eventInfo[i], queued.sourceTicks[i]);
+    }
+    catch (SocketException&)
+    {
+        // such as a refused port of the receiver, reported by a later send
+        ++owner.failedDatagrams;
+    }
+
+    owner.queueFifo.finishedRead (1);
+
+    return true;
+}
+
+
+void UdpEventOutput::SenderThread::run()
+{
+    while (! threadShouldExit())
+    {
+        while (sendNextDatagram())
+        {
+        }
+
+        wait (20);
+    }
+
+    while (sendNextDatagram())
+    {
+    }
+}
@@ -0,0 +1,192 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef UDPEVENTOUTPUT_H_INCLUDED
+#define UDPEVENTOUTPUT_H_INCLUDED
+
+#include <ProcessorHeaders.h>
+#include <NetworkLib.h>
+
+#define UDP_EVENT_OUTPUT_VERSION 1
+#define UDP_EVENT_OUTPUT_DEFAULT_PORT 5560
+#define UDP_EVENT_OUTPUT_MAX_RECORDS 40         // per datagram, which then fits in an Ethernet frame
+#define UDP_EVENT_OUTPUT_MAX_FEATURES 4
+#define UDP_EVENT_OUTPUT_QUEUE_DATAGRAMS 1024
+
+
+/**
+
+ Header of each datagram sent by the UdpEventOutput, followed by numRecords UdpEventRecord.
+
+ sequence counts the datagrams from the start of acquisition, including those dropped before
+ being sent, so that a receiver can tell how many it missed from the gaps. Everything is in the
+ byte order of the machine, which is little-endian on every supported platform.
+
+ */
+
+struct UdpEventHeader
+{
+    char magic[4];              // "OEUE"
+    uint16 version;             // UDP_EVENT_OUTPUT_VERSION
+    uint16 numRecords;
+    uint32 sequence;
+    uint32 reserved;
+};
+
+
+/** A spike or a TTL event, as sent by the UdpEventOutput */
+struct UdpEventRecord
+{
+    enum Type
+    {
+        SPIKE = 1,
+        TTL = 2
+    };
+
+    int64 timestamp;            // in samples of the event's source
+    uint16 sourceID;            // node id of the event's source
+    uint8 type;                 // a Type
+    uint8 numFeatures;          // the features that are set
+    uint16 electrode;           // index of the spike channel in the processor, or TTL line
+    uint16 sortedID;            // of a spike, 0 if unsorted, or state of a TTL line
+    float features[UDP_EVENT_OUTPUT_MAX_FEATURES];  // of a spike, its amplitude on each channel at the peak
+};
+
+
+/**
+
+ Sends spikes and TTL events to another machine as UDP datagrams of fixed-size records, for
+ closed-loop programs for which a TCP stream such as the EventBroadcaster's adds too much latency.
+
+ handleEvent() and handleSpike() only write records to datagrams in a lock-free queue, which
+ a sender thread owning the socket drains, so that the network never holds up the processing
+ thread. By default each event is sent on its own, as soon as the block is processed; the
+ events of a block can instead be coalesced into as few datagrams as they fit in. Datagrams that
+ do not fit in the queue are dropped and counted.
+
+ When event latency measurement is enabled, the time from the source block to the sending of
+ each TTL event is recorded as for the other outputs.
+
+ @see UdpEventHeader, EventBroadcaster
+
+ */
+
+class UdpEventOutput : public GenericProcessor
+{
+public:
+    UdpEventOutput();
+    ~UdpEventOutput();
+
+    AudioProcessorEditor* createEditor() override;
+
+    String getHost() const;
+    int getPort() const;
+
+    /** The editor only offers these while not acquiring, as the socket is connected when it starts */
+    void setHost (const String& host);
+    void setPort (int port);
+
+    /** Parameter 0 coalesces the events of a block if not 0, and parameter 1 adds spike features */
+    void setParameter (int parameterIndex, float newValue) override;
+
+    bool isCoalescing() const;
+    bool isSendingFeatures() const;
+
+    bool enable() override;
+    bool disable() override;
+
+    void process (AudioSampleBuffer& continuousBuffer) override;
+
+    bool isPassThroughChannel (int) const override { return true; }
+
+    void getEventSubscription (EventSubscription& subscription) const override;
+    void handleEvent (const EventChannel* eventInfo, const MidiMessage& event, int samplePosition) override;
+    void handleSpike (const SpikeChannel* spikeInfo, const MidiMessage& event, int samplePosition) override;
+
+    /** The datagrams sent, dropped and failed since acquisition started, and the time they waited */
+    var getStatusInfo() const override;
+
+    /** The time from queuing each datagram until the socket took it, since acquisition started */
+    const ProcessorTimingStats& getSendLatencyStats() const;
+
+    void saveCustomParametersToXml (XmlElement* parentElement) override;
+    void loadCustomParametersFromXml() override;
+
+private:
+    /** A datagram, with what the sender thread needs to know about its records */
+    struct QueuedDatagram
+    {
+        int64 queuedTicks;
+        UdpEventHeader header;
+        UdpEventRecord records[UDP_EVENT_OUTPUT_MAX_RECORDS];
+        const EventChannel* eventInfo[UDP_EVENT_OUTPUT_MAX_RECORDS];   // of TTL events, for their latency
+        int64 sourceTicks[UDP_EVENT_OUTPUT_MAX_RECORDS];
+    };
+
+    /** Owns the socket, and sends the datagrams queued by flush() */
+    class SenderThread : public Thread
+    {
+    public:
+        SenderThread (UdpEventOutput& owner);
+
+        void run() override;
+
+    private:
+        /** Sends the next queued datagram, returning false if there is none */
+        bool sendNextDatagram();
+
+        UdpEventOutput& owner;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SenderThread);
+    };
+
+    /** Returns the record to fill next, flushing the pending datagram first if it is full */
+    UdpEventRecord& addRecord (const EventChannel* eventInfo, int64 sourceTicks);
+
+    /** Queues the pending datagram, if it holds any record */
+    void flush();
+
+    String host;
+    int port;
+    bool coalescing;
+    bool sendingFeatures;
+
+    ScopedPointer<UDPSocket> socket;
+    ScopedPointer<SenderThread> senderThread;
+
+    AbstractFifo queueFifo;         // written by the processing thread, read by the sender thread
+    HeapBlock<QueuedDatagram> queue;
+    QueuedDatagram pending;         // only used by the processing thread
+    uint32 sequence;
+
+    Atomic<int> sentDatagrams;
+    Atomic<int> droppedDatagrams;
+    Atomic<int> failedDatagrams;
+    ProcessorTimingStats sendLatency;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (UdpEventOutput);
+};
+
+
+#endif  // UDPEVENTOUTPUT_H_INCLUDED
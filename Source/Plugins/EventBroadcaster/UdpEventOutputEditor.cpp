@@ -0,0 +1,136 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "UdpEventOutputEditor.h"
+#include "UdpEventOutput.h"
+
+
+UdpEventOutputEditor::UdpEventOutputEditor (GenericProcessor* parentNode, bool useDefaultParameterEditors)
+    : GenericEditor (parentNode, useDefaultParameterEditors)
+
+{
+    desiredWidth = 220;
+
+    hostTitle = new Label ("Host", "Host:");
+    hostTitle->setBounds (10, 30, 60, 25);
+    addAndMakeVisible (hostTitle);
+
+    hostLabel = new Label ("Host", String());
+    hostLabel->setBounds (70, 33, 135, 18);
+    hostLabel->setFont (Font ("Default", 13, Font::plain));
+    hostLabel->setColour (Label::textColourId, Colours::white);
+    hostLabel->setColour (Label::backgroundColourId, Colours::grey);
+    hostLabel->setEditable (true);
+    hostLabel->addListener (this);
+    addAndMakeVisible (hostLabel);
+
+    portTitle = new Label ("Port", "Port:");
+    portTitle->setBounds (10, 60, 60, 25);
+    addAndMakeVisible (portTitle);
+
+    portLabel = new Label ("Port", String());
+    portLabel->setBounds (70, 63, 60, 18);
+    portLabel->setFont (Font ("Default", 15, Font::plain));
+    portLabel->setColour (Label::textColourId, Colours::white);
+    portLabel->setColour (Label::backgroundColourId, Colours::grey);
+    portLabel->setEditable (true);
+    portLabel->addListener (this);
+    addAndMakeVisible (portLabel);
+
+    coalesceButton = new UtilityButton ("Coalesce", Font ("Small Text", 13, Font::plain));
+    coalesceButton->setBounds (15, 95, 90, 20);
+    coalesceButton->setClickingTogglesState (true);
+    coalesceButton->setTooltip ("Send the events of a block in as few datagrams as they fit in, rather than one each");
+    coalesceButton->addListener (this);
+    addAndMakeVisible (coalesceButton);
+
+    featuresButton = new UtilityButton ("Features", Font ("Small Text", 13, Font::plain));
+    featuresButton->setBounds (115, 95, 90, 20);
+    featuresButton->setClickingTogglesState (true);
+    featuresButton->setTooltip ("Send the amplitude of spikes at their peak on each channel");
+    featuresButton->addListener (this);
+    addAndMakeVisible (featuresButton);
+
+    updateSettingsFromProcessor();
+}
+
+
+void UdpEventOutputEditor::updateSettingsFromProcessor()
+{
+    UdpEventOutput* p = (UdpEventOutput*) getProcessor();
+
+    hostLabel->setText (p->getHost(), dontSendNotification);
+    portLabel->setText (String (p->getPort()), dontSendNotification);
+    coalesceButton->setToggleState (p->isCoalescing(), dontSendNotification);
+    featuresButton->setToggleState (p->isSendingFeatures(), dontSendNotification);
+}
+
+
+void UdpEventOutputEditor::labelTextChanged (juce::Label* label)
+{
+    UdpEventOutput* p = (UdpEventOutput*) getProcessor();
+
+    if (label == hostLabel)
+    {
+        p->setHost (label->getText());
+    }
+    else if (label == portLabel)
+    {
+        p->setPort (label->getText().getIntValue());
+    }
+
+    updateSettingsFromProcessor();
+}
+
+
+void UdpEventOutputEditor::buttonEvent (Button* button)
+{
+    if (button == coalesceButton)
+    {
+        getProcessor()->setParameter (0, coalesceButton->getToggleState() ? 1.0f : 0.0f);
+    }
+    else if (button == featuresButton)
+    {
+        getProcessor()->setParameter (1, featuresButton->getToggleState() ? 1.0f : 0.0f);
+    }
+}
+
+
+void UdpEventOutputEditor::startAcquisition()
+{
+    // the socket is connected when acquisition starts
+    hostLabel->setEditable (false);
+    portLabel->setEditable (false);
+    coalesceButton->setEnabled (false);
+    featuresButton->setEnabled (false);
+}
+
+
+void UdpEventOutputEditor::stopAcquisition()
+{
+    hostLabel->setEditable (true);
+    portLabel->setEditable (true);
+    coalesceButton->setEnabled (true);
+    featuresButton->setEnabled (true);
+}
@@ -0,0 +1,67 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef UDPEVENTOUTPUTEDITOR_H_INCLUDED
+#define UDPEVENTOUTPUTEDITOR_H_INCLUDED
+
+#include <EditorHeaders.h>
+
+
+/**
+
+ User interface for the "UdpEventOutput" sink: the address the datagrams are sent to, and
+ whether the events of a block are coalesced and spikes carry their features.
+
+ @see UdpEventOutput
+
+ */
+
+class UdpEventOutputEditor : public GenericEditor, public Label::Listener
+{
+public:
+    UdpEventOutputEditor (GenericProcessor* parentNode, bool useDefaultParameterEditors);
+
+    void labelTextChanged (juce::Label* label) override;
+    void buttonEvent (Button* button) override;
+
+    void startAcquisition() override;
+    void stopAcquisition() override;
+
+    /** Shows the settings of the processor, after they were loaded */
+    void updateSettingsFromProcessor();
+
+private:
+    ScopedPointer<Label> hostTitle;
+    ScopedPointer<Label> hostLabel;
+    ScopedPointer<Label> portTitle;
+    ScopedPointer<Label> portLabel;
+    ScopedPointer<UtilityButton> coalesceButton;
+    ScopedPointer<UtilityButton> featuresButton;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (UdpEventOutputEditor);
+
+};
+
+
+#endif  // UDPEVENTOUTPUTEDITOR_H_INCLUDED
@@ -68,8 +68,8 @@ void EvntTrigAvg::setParameter(int parameterIndex, float newValue)
     
     // If anything was changed, delete all data and start over
     if (changed){
-        spikeData.clear();
-        ttlTimestampBuffer.clear();
+        const ScopedLock lock(mut);
+        recentTTLs.clear();
         lastTTLCalculated=0;
         updateSettings();
     }
@@ -85,15 +85,16 @@ void EvntTrigAvg::updateSettings()
  //   electrodeMap = createElectrodeMap();
     electrodeLabels.clear();
     electrodeLabels = createElectrodeLabels();
-    if(spikeData.size()!=getTotalSpikeChannels())
-        spikeData.resize(getTotalSpikeChannels());
+    const ScopedLock lock(mut);
+    recentSpikes.clear();
+    recentSpikes.resize(getTotalSpikeChannels());
     electrodeSortedId.clear();
-    if(electrodeSortedId.size()!=getTotalSpikeChannels())
-        electrodeSortedId.resize(getTotalSpikeChannels());
-    for(int electrodeIt = 0 ; electrodeIt < spikeData.size() ; electrodeIt++){
+    electrodeSortedId.resize(getTotalSpikeChannels());
+    electrodeFirstRow.resize(getTotalSpikeChannels());
+    for(size_t electrodeIt = 0 ; electrodeIt < recentSpikes.size() ; electrodeIt++){
         electrodeSortedId[electrodeIt].push_back(0);
-        if(spikeData[electrodeIt].size()<1)
-            spikeData[electrodeIt].resize(1);
+        recentSpikes[electrodeIt].resize(1);
+        electrodeFirstRow[electrodeIt] = (int) electrodeIt;
     }
 }
 void EvntTrigAvg::initializeHistogramArray()
@@ -103,10 +104,11 @@ void EvntTrigAvg::initializeHistogramArray()
         histogramData.add(new uint64[1003]{0});
         histogramData[i][0]=i;//electrode
         histogramData[i][1]=0;//sortedID
-        histogramData[i][2]=0;//num bins used
+        histogramData[i][2]=getNumBins();//num bins used
         for (int data = 3 ; data < 1003 ; data++){
             histogramData[i][data] = 0;
         }
+        histogramStats.push_back({ 0, 0, getNumBins() });
     }
 }
 
@@ -129,6 +131,7 @@ void EvntTrigAvg::clearHistogramArray()
     for (int i = 0 ; i < histogramData.size() ; i++)
         delete[] histogramData[i];
     histogramData.clear();
+    histogramStats.clear();
 }
 void EvntTrigAvg::clearMinMaxMean()
 {
@@ -151,29 +154,15 @@ bool EvntTrigAvg::disable()
 
 void EvntTrigAvg::process(AudioSampleBuffer& buffer)
 {
-    
+    // the histograms are updated as the spikes and TTLs come in
+    const ScopedLock lock(mut);
+
     checkForEvents(true);// see if got any spikes
     
     if(buffer.getNumChannels() != numChannels)
         numChannels = buffer.getNumChannels();
-    if(ttlTimestampBuffer.size() > lastTTLCalculated && buffer.getNumSamples() + getTimestamp(0) >= ttlTimestampBuffer[lastTTLCalculated+1] + windowSize/2){ // if need to recalc
-        recalc = true;
-    }
-    if(recalc){ // triggered after window time has expirered
-        //process the data
-        processSpikeData(spikeData, ttlTimestampBuffer);
-        
-        //clear the data
-        for(int channelIterator = 0 ; channelIterator < spikeData.size() ; channelIterator++){
-            for(int sortedIdIterator = 0 ; sortedIdIterator < spikeData[channelIterator].size() ; sortedIdIterator++){
-                spikeData[channelIterator][sortedIdIterator].clear();
-            }
-        }
-        //advance the TTL that needs to be calculated
-        lastTTLCalculated+=1;
-        //just recalculated, don't need to again until next ttl window has expired
-        recalc=false;
-    }
+
+    discardExpired(getTimestamp(0) + buffer.getNumSamples());
 }
 
 void EvntTrigAvg::handleEvent(const EventChannel* eventInfo, const MidiMessage& event, int sampleNum)
@@ -183,100 +172,145 @@ void EvntTrigAvg::handleEvent(const EventChannel* eventInfo, const MidiMessage&
     {// if TTL from right channel
         TTLEventPtr ttl = TTLEvent::deserializeFromMessage(event, eventInfo);
         if (ttl->getChannel() == triggerChannel)
-            ttlTimestampBuffer.push_back(Event::getTimestamp(event)); // add timestamp of TTL to buffer
+            addTTL(Event::getTimestamp(event));
     }
 }
 
 void EvntTrigAvg::handleSpike(const SpikeChannel* spikeInfo, const MidiMessage& event, int samplePosition)
 {
-    SpikeEventPtr newSpike = SpikeEvent::deserializeFromMessage(event, spikeInfo);
-    if (!newSpike)
+    // only the timestamp and sorted ID are needed, read in place
+    SpikeEventView newSpike(event, spikeInfo);
+    if (!newSpike.isValid())
         return;
     else {
         // extract information from spike
         
-        const SpikeChannel* chan = newSpike->getChannelInfo();
-        Array<SourceChannelInfo> chanInfo = chan->getSourceChannelInfo();
-        //int chanIDX = chanInfo[0].channelIDX;
+        //int chanIDX = newSpike.getChannelInfo()->getSourceChannelInfo()[0].channelIDX;
         int electrode = getSpikeChannelIndex(newSpike);
         //std::cout<<"chanIDX: " << chanIDX << "\n";
-        int sortedID = newSpike->getSortedID();
+        int sortedID = newSpike.getSortedID();
         //int electrode = electrodeMap[chanInfo];
-        if(sortedID!=0 && sortedID>idIndex.size()){ // respond to new sortedID
-            idIndex.push_back(spikeData[electrode].size());// update map of what sorted ID is on what electrode
-        }
-            
-        bool newID = true;
-        //for(int i = 0 ; i < electrodeSortedId[chanIDX].size() ; i++){
+        
+        // position of the sorted ID among those of the electrode, 0 being every spike
+        int unit = 0;
         for(int i = 0 ; i < electrodeSortedId[electrode].size() ; i++){
-            //if(sortedID == electrodeSortedId[chanIDX][i])
            if(sortedID == electrodeSortedId[electrode][i])
-               newID=false;
+               unit = i;
         }
-        if(newID){
-            //electrodeSortedId[chanIDX].push_back(sortedID);
+        if(sortedID != 0 && unit == 0){ // respond to new sortedID
+            unit = int(electrodeSortedId[electrode].size());
             electrodeSortedId[electrode].push_back(sortedID);
-            addNewSortedIdMinMaxMean(electrode,sortedID);
-            addNewSortedIdHistoData(electrode,sortedID); //insert new sortedId into histogramArray
-            spikeData[electrode].resize(spikeData[electrode].size()+1);
-            }
+            addNewSortedId(electrode,sortedID); //insert new sortedId into histogramArray
+            recentSpikes[electrode].resize(recentSpikes[electrode].size()+1);
+        }
         
-        int relativeSortedID = 0;
-        if (sortedID>0)
-            relativeSortedID = idIndex[sortedID-1];
-        spikeData[electrode][0].push_back(newSpike->getTimestamp());
-        if (sortedID>0)
-            spikeData[electrode][relativeSortedID].push_back(newSpike->getTimestamp());
+        addSpike(electrode, 0, newSpike.getTimestamp());
+        if (unit > 0)
+            addSpike(electrode, unit, newSpike.getTimestamp());
     }
 }
 
-void EvntTrigAvg::addNewSortedIdHistoData(int electrode,int sortedId)
+void EvntTrigAvg::addNewSortedId(int electrode,int sortedId)
 {
     const ScopedLock myScopedLock(mut);
-    if(electrode == getTotalSpikeChannels()-1){
-        histogramData.add(new uint64[1003]{0});
-        histogramData.getLast()[0]=electrode;//electrode
-        histogramData.getLast()[1]=sortedId;//sortedID
-        histogramData.getLast()[2]=windowSize/binSize;//num bins used
+    // the units of an electrode follow its row of every spike, in the order they appeared
+    const int row = electrodeFirstRow[electrode] + int(electrodeSortedId[electrode].size()) - 1;
+
+    histogramData.insert(row,new uint64[1003]{0});
+    histogramData[row][0]=electrode;//electrode
+    histogramData[row][1]=sortedId;//sortedID
+    histogramData[row][2]=getNumBins();//num bins used
+
+    minMaxMean.insert(row,new float[5]);
+    minMaxMean[row][0]=electrode;//electrode
+    minMaxMean[row][1]=sortedId;//sortedID
+    minMaxMean[row][2]=0;//minimum
+    minMaxMean[row][3]=0;//maximum
+    minMaxMean[row][4]=0;//mean
+
+    histogramStats.insert(histogramStats.begin() + row, { 0, 0, getNumBins() });
+
+    for (size_t i = electrode + 1 ; i < electrodeFirstRow.size() ; i++)
+        electrodeFirstRow[i] += 1;
+}
+
+int EvntTrigAvg::getNumBins() const
+{
+    // the rows have room for 1000 bins
+    return binSize > 0 ? int(jmin(uint64(1000), windowSize/binSize)) : 0;
+}
+
+void EvntTrigAvg::addToHistogram(int row, int64 relativeTime)
+{
+    const int64 halfWindow = int64(windowSize)/2;
+    const int numBins = getNumBins();
 
+    if (numBins == 0 || relativeTime < -halfWindow || relativeTime > halfWindow)
         return;
+
+    // the end of the window falls in the last bin
+    const int bin = int(jmin(int64(numBins - 1), (relativeTime + halfWindow)/int64(binSize)));
+
+    uint64* counts = &histogramData[row][3];
+    float* stats = minMaxMean[row];
+    HistogramStats& hs = histogramStats[row];
+
+    const uint64 previous = counts[bin]++;
+    hs.total += 1;
+
+    if (counts[bin] > stats[3])
+        stats[3] = float(counts[bin]);//maximum
+
+    // counts only grow, so the minimum rises once no bin holds it any more, at most once every numBins spikes
+    if (previous == hs.minimum && --hs.numAtMinimum == 0){
+        hs.minimum += 1;
+        for (int i = 0 ; i < numBins ; i++)
+            if (counts[i] == hs.minimum)
+                hs.numAtMinimum += 1;
     }
-    else{
-        for(int i = 1 ; i < histogramData.size() ; i++){
-            if(histogramData[i][0]>electrode){
-                histogramData.insert(i,new uint64[1003]{0});
-                histogramData[i][0]=electrode;//electrode
-                histogramData[i][1]=sortedId;//sortedID
-                histogramData[i][2]=windowSize/binSize;//num bins used
-                return;
-            }
+
+    stats[2] = float(hs.minimum);//minimum
+    stats[4] = float(hs.total)/(float(windowSize)/float(binSize));//mean
+}
+
+void EvntTrigAvg::addSpike(int electrode, int unit, uint64 timestamp)
+{
+    const int row = electrodeFirstRow[electrode] + unit;
+
+    for (size_t i = 0 ; i < recentTTLs.size() ; i++)
+        addToHistogram(row, int64(timestamp) - int64(recentTTLs[i]));
+
+    recentSpikes[electrode][unit].push_back(timestamp);
+}
+
+void EvntTrigAvg::addTTL(uint64 timestamp)
+{
+    for (size_t electrode = 0 ; electrode < recentSpikes.size() ; electrode++){
+        for (size_t unit = 0 ; unit < recentSpikes[electrode].size() ; unit++){
+            const std::deque<uint64>& spikes = recentSpikes[electrode][unit];
+            for (size_t i = 0 ; i < spikes.size() ; i++)
+                addToHistogram(electrodeFirstRow[electrode] + (int) unit, int64(spikes[i]) - int64(timestamp));
         }
     }
+
+    recentTTLs.push_back(timestamp);
 }
 
-void EvntTrigAvg::addNewSortedIdMinMaxMean(int electrode,int sortedId)
+void EvntTrigAvg::discardExpired(uint64 timestamp)
 {
-    const ScopedLock myScopedLock(mut);
-    if(electrode == getTotalSpikeChannels()-1){
-        minMaxMean.add(new float[5]);
-        minMaxMean.getLast()[0]=electrode;//electrode
-        minMaxMean.getLast()[1]=sortedId;//sortedID
-        minMaxMean.getLast()[2]=0;//minimum
-        minMaxMean.getLast()[3]=0;//maximum
-        minMaxMean.getLast()[4]=0;//mean
-        return;
+    const uint64 halfWindow = windowSize/2;
+
+    // a TTL whose window has passed is a completed trial
+    while (!recentTTLs.empty() && recentTTLs.front() + halfWindow < timestamp){
+        recentTTLs.pop_front();
+        lastTTLCalculated += 1;
     }
-    else{
-        for(int i = 1 ; i < histogramData.size() ; i++){
-            if(minMaxMean[i][0]>electrode){
-                minMaxMean.insert(i,new float[5]);
-                minMaxMean[i][0]=electrode;//electrode
-                minMaxMean[i][1]=sortedId;//sortedID
-                minMaxMean[i][2]=0;//minimum
-                minMaxMean[i][3]=0;//maximum
-                minMaxMean[i][4]=0;//mean
-                return;
-            }
+
+    for (size_t electrode = 0 ; electrode < recentSpikes.size() ; electrode++){
+        for (size_t unit = 0 ; unit < recentSpikes[electrode].size() ; unit++){
+            std::deque<uint64>& spikes = recentSpikes[electrode][unit];
+            while (!spikes.empty() && spikes.front() + halfWindow < timestamp)
+                spikes.pop_front();
         }
     }
 }
@@ -336,86 +370,6 @@ std::vector<String> EvntTrigAvg::createElectrodeLabels()
     return map;
 }
 
-/** passes data into createHistogramData() by electrode and sorted ID */
-void EvntTrigAvg::processSpikeData(std::vector<std::vector<std::vector<uint64>>> spikeData,std::vector<uint64> ttlData)
-{
-    
-    for (int channelIterator = 0 ; channelIterator < getTotalSpikeChannels() ; channelIterator++){
-        const ScopedLock myScopedLock(mut);
-        for (int sortedIdIterator = 0 ; sortedIdIterator < spikeData[channelIterator].size() ; sortedIdIterator++){
-            uint64* data = createHistogramData(spikeData[channelIterator][sortedIdIterator],ttlData);
-            histogramData[channelIterator+sortedIdIterator][2]=windowSize/binSize;
-            for(int dataIterator = 3 ; dataIterator<windowSize/binSize+3 ; dataIterator++){
-                histogramData[channelIterator+sortedIdIterator][dataIterator] += (data[dataIterator-3]);
-            }
-        minMaxMean[channelIterator+sortedIdIterator][2]= findMin(&histogramData[channelIterator+sortedIdIterator][3]);
-            
-        minMaxMean[channelIterator+sortedIdIterator][3]= findMax(&histogramData[channelIterator+sortedIdIterator][3]);
-            
-        minMaxMean[channelIterator+sortedIdIterator][4] = findMean(&histogramData[channelIterator+sortedIdIterator][3]);
-        }
-    }
-}
-
-/** returns bin counts */
-uint64* EvntTrigAvg::createHistogramData(std::vector<uint64> spikeData, std::vector<uint64> ttlData)
-{
-    uint64 numberOfBins = windowSize/binSize;
-    std::vector<uint64> histoData;
-    for(int ttlIterator = 0 ; ttlIterator < ttlData.size() ; ttlIterator++){
-        for(int spikeIterator = 0 ; spikeIterator < spikeData.size() ; spikeIterator++){
-            int relativeSpikeValue = int(spikeData[spikeIterator])-int(ttlData[ttlIterator]);
-            if (relativeSpikeValue >= -int(windowSize)/2 && relativeSpikeValue <= int(windowSize)/2){
-                uint64 bin = binDataPoint(0, numberOfBins, binSize, relativeSpikeValue+windowSize/2);
-                histoData.push_back(bin);
-            }
-        }
-    }
-    return binCount(histoData,numberOfBins);
-}
-
-
-/** Returns the bin a data point belongs to given the very first bin, the very last bin, bin size and the data point to bin, currently only works for positive numbers (can get around by adding minimum value to all values*/
-uint64 EvntTrigAvg::binDataPoint(uint64 startBin, uint64 endBin, uint64 binSize, uint64 dataPoint)
-{
-    uint64 binsInRange = (endBin-startBin);
-    uint64 binsToSearch = binsInRange/2;
-    if (binsToSearch <= 1){
-        
-        if (dataPoint < (startBin+binsToSearch)*binSize){
-            return startBin;
-        }
-        else if (dataPoint < (startBin+1+binsToSearch) * binSize){
-            return startBin+1;
-        }
-        else{
-            return startBin+2;
-        }
-    }
-
-    else if (dataPoint < (startBin+binsToSearch)*binSize){ // if in first half of search range
-        return binDataPoint(startBin,startBin+(binsToSearch),binSize,dataPoint);
-    }
-    else if (dataPoint >= (startBin+binsToSearch) * binSize){ // if in second half of search range
-        return binDataPoint(startBin+(binsToSearch),endBin,binSize,dataPoint);
-    }
-    else{
-        return NULL;
-    }
-}
-
-/** count the number of bin instances */
-uint64* EvntTrigAvg::binCount(std::vector<uint64> binData,uint64 numberOfBins)
-{
-    for (int i = 0 ; i < 1000 ; i++){
-        bins[i]=0;
-    }
-    for (int dataIterator = 0 ; dataIterator < binData.size() ; dataIterator++){
-        bins[binData[dataIterator]] = bins[binData[dataIterator]]+1;
-    }
-    return bins;
-}
-
 uint64 EvntTrigAvg::getBinSize()
 {
     return binSize;
@@ -438,57 +392,11 @@ Array<float *> EvntTrigAvg::getMinMaxMean()
     return minMaxMean;
 }
 
-float EvntTrigAvg::findMin(uint64* data_)
-{
-    const ScopedLock myScopedLock(mut);
-    //uint64 min = UINT64_MAX;
-    uint64 min = 18446744073709551614;
-    for (int i = 0 ; i < windowSize/binSize ; i++){
-        if(data_[i]<min){
-            min=data_[i];
-        }
-    }
-    return float(min);
-}
-
-float EvntTrigAvg::findMax(uint64* data_)
-{
-    const ScopedLock myScopedLock(mut);
-    uint64 max = 0;
-    for (int i = 0 ; i < windowSize/binSize ; i++){
-        if(data_[i]>max){
-            max=data_[i];
-        }
-    }
-    return float(max);
-}
-
-float EvntTrigAvg::findMean(uint64* data_)
-{
-    const ScopedLock myScopedLock(mut);
-    uint64 runningSum=0;
-    for(int i=0 ; i < windowSize/binSize ; i++){
-        runningSum += data_[i];
-    }
-    float mean = float(runningSum)/(float(windowSize)/float(binSize));
-    return mean;
-}
-
-
-
 std::vector<String> EvntTrigAvg::getElectrodeLabels()
 {
     return electrodeLabels;
 }
 
-void EvntTrigAvg::clearHistogramData(uint64 * dataptr)
-{
-    const ScopedLock myScopedLock(mut);
-    for(int i = 0 ; i < 1000 ; i++)
-        dataptr[i] = 0;
-}
-
-
 void EvntTrigAvg::saveCustomParametersToXml (XmlElement* parentElement)
 {
     XmlElement* mainNode = parentElement->createNewChildElement ("EVNTTRIGAVG");
@@ -27,12 +27,19 @@
 #include <ProcessorHeaders.h>
 #include "EvntTrigAvgEditor.h"
 #include <vector>
+#include <deque>
 #include <map>
 
 class EvntTrigAvgEditor;
 
 /**
 Aligns spike times with TTL input.
+
+The histograms are accumulated as spikes and TTLs arrive: a spike is binned against the TTLs
+received less than half a window before it, and a TTL against the spikes received less than
+half a window before it, so each pair is counted once and only the last half window of each
+is kept. The bins and their minimum, maximum and mean are updated in place, under the mutex
+the canvas reads them with.
  
 @see EvntTrigAvgCanvas, EvntTrigAvgEditor
 
@@ -81,16 +88,6 @@ public:
     Array<uint64 *> getHistoData();
     Array<float *> getMinMaxMean();
 
-    //create histogram data
-    uint64* createHistogramData(std::vector<uint64> spikeData, std::vector<uint64> ttlData); // shared data
-    uint64 binDataPoint(uint64 startBin, uint64 endBin, uint64 binSize, uint64 dataPoint); // shared data
-    void processSpikeData(std::vector<std::vector<std::vector<uint64>>> spikeData,std::vector<uint64> ttlData);
-    uint64* binCount(std::vector<uint64> binData, uint64 numberOfBins); // shared data
-    bool shouldReadHistoData();
-    float findMin(uint64* data_);
-    float findMax(uint64* data_);
-    float findMean(uint64* data_); // TODO make running
-    
     //TODO electrodeMap is not being used right now, fix it to actually work with SourceInfo instead of just indexes
     //std::map<SourceChannelInfo,int> createElectrodeMap();
     std::vector<String> createElectrodeLabels();
@@ -103,27 +100,37 @@ private:
     void initializeMinMaxMean();
     void clearHistogramArray();
     void clearMinMaxMean();
-    void addNewSortedIdHistoData(int electrode, int sortedId);
-    void addNewSortedIdMinMaxMean(int electrode,int sortedID);
+    void addNewSortedId(int electrode, int sortedId);
+    int getNumBins() const;
+    /** Counts a spike at relativeTime samples from a TTL in a row of the histograms, if in the window */
+    void addToHistogram(int row, int64 relativeTime);
+    void addSpike(int electrode, int unit, uint64 timestamp);
+    void addTTL(uint64 timestamp);
+    /** Forgets the TTLs and spikes no longer within half a window of the block's end */
+    void discardExpired(uint64 timestamp);
     std::atomic<int> triggerEvent;
     std::atomic<int> triggerChannel;
 
-    uint64 bins[1000]; // workspace for bin counting
-
     int numChannels = 0;
-    bool recalc = false;
     int lastTTLCalculated = 0;
     uint64 windowSize;
     uint64 binSize;
     
-    std::vector<uint64> ttlTimestampBuffer;
-    std::vector<std::vector<std::vector<uint64>>> spikeData;// channel.sortedID.spikeInstance.timestamp
-    void clearHistogramData(uint64 * const);
+    struct HistogramStats
+    {
+        uint64 total;        // spikes counted in all the bins
+        uint64 minimum;
+        int numAtMinimum;    // bins holding the minimum
+    };
+
+    std::deque<uint64> recentTTLs;
+    std::vector<std::vector<std::deque<uint64>>> recentSpikes;// channel.sortedID.spikeInstance.timestamp
     Array<uint64*> histogramData; // shared data
     Array<float*> minMaxMean; // shared data
+    std::vector<HistogramStats> histogramStats; // alongside histogramData
+    std::vector<int> electrodeFirstRow; // row of each electrode's sortedID 0, its units following
     //std::map<SourceChannelInfo,int> electrodeMap; // Used to identify what electrode a spike came from
     std::vector<String> electrodeLabels;
-    std::vector<int> idIndex; //sorted ID, electrode. used to match a sortedID with its electrode
     std::vector<std::vector<int>> electrodeSortedId; 
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EvntTrigAvg);
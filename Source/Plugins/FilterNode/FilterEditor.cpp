@@ -30,7 +30,7 @@ FilterEditor::FilterEditor(GenericProcessor* parentNode, bool useDefaultParamete
     : GenericEditor(parentNode, useDefaultParameterEditors)
 
 {
-    desiredWidth = 150;
+    desiredWidth = 215;
 
     lastLowCutString = " ";
     lastHighCutString = " ";
@@ -82,6 +82,55 @@ FilterEditor::FilterEditor(GenericProcessor* parentNode, bool useDefaultParamete
     applyFilterOnChan->setTooltip("When this button is off, selected channels will not be filtered");
     addAndMakeVisible(applyFilterOnChan);
 
+    threadsLabel = new Label("threads label", "Threads:");
+    threadsLabel->setBounds(85,25,60,20);
+    threadsLabel->setFont(Font("Small Text", 12, Font::plain));
+    threadsLabel->setColour(Label::textColourId, Colours::darkgrey);
+    addAndMakeVisible(threadsLabel);
+
+    // item ids are the number of threads filtering plus one, "Auto" using every pool thread
+    threadsSelector = new ComboBox("threads selector");
+    threadsSelector->setBounds(90,42,50,18);
+    threadsSelector->addItem("Auto", 1);
+    for (int n = 1; n <= getProcessor()->getNumChannelPoolThreads() + 1; n++)
+        threadsSelector->addItem(String(n), n + 1);
+    threadsSelector->setSelectedId(1, dontSendNotification);
+    threadsSelector->setTooltip("Number of threads the channels are filtered on");
+    threadsSelector->addListener(this);
+    addAndMakeVisible(threadsSelector);
+
+    typeLabel = new Label("type label", "Type:");
+    typeLabel->setBounds(148,25,60,20);
+    typeLabel->setFont(Font("Small Text", 12, Font::plain));
+    typeLabel->setColour(Label::textColourId, Colours::darkgrey);
+    addAndMakeVisible(typeLabel);
+
+    typeSelector = new ComboBox("type selector");
+    typeSelector->setBounds(152,42,55,18);
+    typeSelector->addItem("IIR", 1);
+    typeSelector->addItem("FIR", 2);
+    typeSelector->setSelectedId(1, dontSendNotification);
+    typeSelector->setTooltip("Butterworth IIR filters, or linear-phase FIR filters delaying the signal");
+    typeSelector->addListener(this);
+    addAndMakeVisible(typeSelector);
+
+    tapsLabel = new Label("taps label", "Taps:");
+    tapsLabel->setBounds(148,65,60,20);
+    tapsLabel->setFont(Font("Small Text", 12, Font::plain));
+    tapsLabel->setColour(Label::textColourId, Colours::darkgrey);
+    addAndMakeVisible(tapsLabel);
+
+    // item ids are the number of taps
+    tapsSelector = new ComboBox("taps selector");
+    tapsSelector->setBounds(152,82,55,18);
+    for (int taps = 127; taps <= FIR_MAX_TAPS; taps = taps * 2 + 1)
+        tapsSelector->addItem(String(taps), taps);
+    tapsSelector->setSelectedId(FIR_DEFAULT_TAPS, dontSendNotification);
+    tapsSelector->addListener(this);
+    addAndMakeVisible(tapsSelector);
+
+    updateTapsSelector();
+
 }
 
 FilterEditor::~FilterEditor()
@@ -138,8 +187,7 @@ void FilterEditor::labelTextChanged(Label* label)
 
             if (requestedValue > minVal)
             {
-                fn->setCurrentChannel(chans[n]);
-                fn->setParameter(1, requestedValue);
+                fn->queueParameterChange(1, requestedValue, chans[n]);
             }
 
             lastHighCutString = label->getText();
@@ -151,8 +199,7 @@ void FilterEditor::labelTextChanged(Label* label)
 
             if (requestedValue < maxVal)
             {
-                fn->setCurrentChannel(chans[n]);
-                fn->setParameter(0, requestedValue);
+                fn->queueParameterChange(0, requestedValue, chans[n]);
             }
 
             lastLowCutString = label->getText();
@@ -172,6 +219,40 @@ void FilterEditor::channelChanged (int channel, bool /*newState*/)
 
 }
 
+void FilterEditor::comboBoxChanged(ComboBox* comboBox)
+{
+    if (comboBox == threadsSelector)
+    {
+        // the thread processing the chain is one of them
+        const int id = threadsSelector->getSelectedId();
+        getProcessor()->setParameter(3, (id > 1) ? float(id - 2) : -1.0f);
+    }
+    else if (comboBox == typeSelector)
+    {
+        getProcessor()->setParameter(4, float(typeSelector->getSelectedId() - 1));
+        updateTapsSelector();
+    }
+    else if (comboBox == tapsSelector)
+    {
+        getProcessor()->setParameter(5, float(tapsSelector->getSelectedId()));
+        updateTapsSelector();
+    }
+}
+
+void FilterEditor::updateTapsSelector()
+{
+    FilterNode* fn = (FilterNode*) getProcessor();
+
+    tapsSelector->setEnabled(typeSelector->getSelectedId() == 2);
+
+    // the delay in time depends on the sample rate of each channel, so show the one of the first
+    const int latency = FirFilterBank::getLatencySamplesForTaps(tapsSelector->getSelectedId());
+    String tooltip = "Length of the FIR filters. They delay the signal by " + String(latency) + " samples";
+    if (fn->getNumInputs() > 0 && fn->getDataChannel(0) != nullptr)
+        tooltip << " (" << String(1000.0 * latency / fn->getDataChannel(0)->getSampleRate(), 1) << " ms)";
+    tapsSelector->setTooltip(tooltip);
+}
+
 void FilterEditor::buttonEvent(Button* button)
 {
 
@@ -191,8 +272,7 @@ void FilterEditor::buttonEvent(Button* button)
         {
             float newValue = button->getToggleState() ? 1.0 : 0.0;
 
-            fn->setCurrentChannel(chans[n]);
-            fn->setParameter(2, newValue);
+            fn->queueParameterChange(2, newValue, chans[n]);
         }
     }
 }
@@ -210,6 +290,9 @@ void FilterEditor::saveCustomParameters(XmlElement* xml)
     textLabelValues->setAttribute("HighCut",lastHighCutString);
     textLabelValues->setAttribute("LowCut",lastLowCutString);
     textLabelValues->setAttribute("ApplyToADC",	applyFilterOnADC->getToggleState());
+    textLabelValues->setAttribute("Threads", threadsSelector->getSelectedId() - 1);
+    textLabelValues->setAttribute("FilterType", typeSelector->getSelectedId() - 1);
+    textLabelValues->setAttribute("Taps", tapsSelector->getSelectedId());
 }
 
 void FilterEditor::loadCustomParameters(XmlElement* xml)
@@ -222,6 +305,13 @@ void FilterEditor::loadCustomParameters(XmlElement* xml)
             highCutValue->setText(xmlNode->getStringAttribute("HighCut"),dontSendNotification);
             lowCutValue->setText(xmlNode->getStringAttribute("LowCut"),dontSendNotification);
             applyFilterOnADC->setToggleState(xmlNode->getBoolAttribute("ApplyToADC",false), sendNotification);
+            const int threads = xmlNode->getIntAttribute("Threads", 0);
+            threadsSelector->setSelectedId((threads > 0 && threads < threadsSelector->getNumItems()) ? threads + 1 : 1,
+                                           sendNotification);
+            typeSelector->setSelectedId(xmlNode->getIntAttribute("FilterType", 0) == 1 ? 2 : 1, sendNotification);
+            const int taps = xmlNode->getIntAttribute("Taps", FIR_DEFAULT_TAPS);
+            tapsSelector->setSelectedId(tapsSelector->indexOfItemId(taps) >= 0 ? taps : FIR_DEFAULT_TAPS,
+                                        sendNotification);
         }
     }
 
@@ -38,7 +38,8 @@ class FilterViewport;
 */
 
 class FilterEditor : public GenericEditor,
-    public Label::Listener
+    public Label::Listener,
+    public ComboBox::Listener
 {
 public:
     FilterEditor(GenericProcessor* parentNode, bool useDefaultParameterEditors);
@@ -46,6 +47,7 @@ public:
 
     void buttonEvent(Button* button);
     void labelTextChanged(Label* label);
+    void comboBoxChanged(ComboBox* comboBox);
 
     void saveCustomParameters(XmlElement* xml);
     void loadCustomParameters(XmlElement* xml);
@@ -55,6 +57,8 @@ public:
     void channelChanged (int chan, bool newState);
 
 private:
+    /** Enables the taps selector in FIR mode and shows the delay of the chosen length */
+    void updateTapsSelector();
 
     String lastHighCutString;
     String lastLowCutString;
@@ -67,6 +71,14 @@ private:
     ScopedPointer<UtilityButton> applyFilterOnADC;
     ScopedPointer<UtilityButton> applyFilterOnChan;
 
+    ScopedPointer<Label> threadsLabel;
+    ScopedPointer<ComboBox> threadsSelector;
+
+    ScopedPointer<Label> typeLabel;
+    ScopedPointer<ComboBox> typeSelector;
+    ScopedPointer<Label> tapsLabel;
+    ScopedPointer<ComboBox> tapsSelector;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FilterEditor);
 
 };
@@ -27,6 +27,8 @@
 
 FilterNode::FilterNode()
     : GenericProcessor  ("Bandpass Filter")
+    , filterType        (IIR_FILTER)
+    , processedType     (IIR_FILTER)
     , defaultLowCut     (300.0f)
     , defaultHighCut    (6000.0f)
 {
@@ -129,8 +131,8 @@ void FilterNode::updateSettings()
 {
     //int id = nodeId;
     int numInputs = getNumInputs();
-    int numfilt = filters.size();
-    if (numInputs < 1024 && numInputs != numfilt)
+    int numfilt = filterBank.getNumChannels();
+    if (numInputs != numfilt)
     {
         // SO fixed this. I think values were never restored correctly because you cleared lowCuts.
         Array<double> oldlowCuts;
@@ -138,20 +140,15 @@ void FilterNode::updateSettings()
         oldlowCuts = lowCuts;
         oldhighCuts = highCuts;
 
-        filters.clear();
+        filterBank.setNumChannels (numInputs);
+        firBank.setNumChannels (numInputs);
         lowCuts.clear();
         highCuts.clear();
-        shouldFilterChannel.clear();
+        shouldFilterChannel.setNumChannels (numInputs);
+        shouldFilterChannel.setAll (true);
 
         for (int n = 0; n < getNumInputs(); ++n)
         {
-            filters.add (new Dsp::SmoothedFilterDesign
-                         <Dsp::Butterworth::Design::BandPass    // design type
-                         <2>,                                   // order
-                         1,                                     // number of channels (must be const)
-                         Dsp::DirectFormII> (1));               // realization
-
-
             //Parameter& p1 =  parameters.getReference(0);
             //p1.setValue(600.0f, n);
             //Parameter& p2 =  parameters.getReference(1);
@@ -159,7 +156,8 @@ void FilterNode::updateSettings()
 
             // restore defaults
 
-            shouldFilterChannel.add (true);
+            filterBank.setChannelEnabled (n, true);
+            firBank.setChannelEnabled (n, true);
 
             float newLowCut  = 0.f;
             float newHighCut = 0.f;
@@ -182,6 +180,14 @@ void FilterNode::updateSettings()
         }
     }
 
+    for (int n = 0; n < dataChannelArray.size() && n < numInputs; ++n)
+    {
+        const uint32 sourceId = getProcessorFullId (dataChannelArray[n]->getSourceNodeID(),
+                                                    dataChannelArray[n]->getSubProcessorIdx());
+        filterBank.setChannelSource (n, sourceId);
+        firBank.setChannelSource (n, sourceId);
+    }
+
     setApplyOnADC (applyOnADC);
 }
 
@@ -204,19 +210,37 @@ bool FilterNode::getBypassStatusForChannel (int chan) const
 }
 
 
+FilterNode::FilterType FilterNode::getFilterType() const
+{
+    return FilterType (filterType.get());
+}
+
+
+int FilterNode::getFirNumTaps() const
+{
+    return firBank.getNumTaps();
+}
+
+
+int FilterNode::getLatencySamples() const
+{
+    return (getFilterType() == FIR_FILTER) ? firBank.getLatencySamples() : 0;
+}
+
+
 void FilterNode::setFilterParameters (double lowCut, double highCut, int chan)
 {
     if (dataChannelArray.size() - 1 < chan)
         return;
 
-    Dsp::Params params;
-    params[0] = dataChannelArray[chan]->getSampleRate(); // sample rate
-    params[1] = 2;                          // order
-    params[2] = (highCut + lowCut) / 2;     // center frequency
-    params[3] = highCut - lowCut;           // bandwidth
+    Dsp::Butterworth::BandPass<2> design;
+    design.setup (2,                                        // order
+                  dataChannelArray[chan]->getSampleRate(),  // sample rate
+                  (highCut + lowCut) / 2,                   // center frequency
+                  highCut - lowCut);                        // bandwidth
 
-    if (filters.size() > chan)
-        filters[chan]->setParams (params);
+    filterBank.setChannelCascade (chan, design);
+    firBank.setChannelBandPass (chan, dataChannelArray[chan]->getSampleRate(), lowCut, highCut);
 }
 
 
@@ -240,32 +264,81 @@ void FilterNode::setParameter (int parameterIndex, float newValue)
                              highCuts[currentChannel],
                              currentChannel);
 
-        editor->updateParameterButtons (parameterIndex);
+        // changes queued during acquisition are applied by the processing thread
+        if (MessageManager::getInstance()->isThisTheMessageThread())
+            editor->updateParameterButtons (parameterIndex);
+    }
+    // change the number of threads helping to filter, all of them if negative
+    else if (parameterIndex == 3)
+    {
+        setMaxChannelThreads (roundFloatToInt (newValue));
+    }
+    // change between the IIR and FIR filters
+    else if (parameterIndex == 4)
+    {
+        filterType = (newValue > 0) ? FIR_FILTER : IIR_FILTER;
+    }
+    // change the length of the FIR filters
+    else if (parameterIndex == 5)
+    {
+        firBank.setNumTaps (roundFloatToInt (newValue));
     }
     // change channel bypass state
     else
     {
-        if (newValue == 0)
-        {
-            shouldFilterChannel.set (currentChannel, false);
-        }
-        else
-        {
-            shouldFilterChannel.set (currentChannel, true);
-        }
+        shouldFilterChannel.set (currentChannel, newValue != 0);
+
+        filterBank.setChannelEnabled (currentChannel, shouldFilterChannel[currentChannel]);
+        firBank.setChannelEnabled (currentChannel, shouldFilterChannel[currentChannel]);
+
+        updateIdleState();
     }
 }
 
 
+bool FilterNode::isIdle() const
+{
+    return shouldFilterChannel.isEmpty();
+}
+
+
+bool FilterNode::enable()
+{
+    firBank.prepareGroups();
+
+    return GenericProcessor::enable();
+}
+
+
 void FilterNode::process (AudioSampleBuffer& buffer)
 {
-    for (int n = 0; n < getNumOutputs(); ++n)
+    processedType = filterType.get();
+
+    // the ranges handed to processChannels() are ranges of filter bank groups
+    if (processedType == FIR_FILTER)
     {
-        if (shouldFilterChannel[n])
-        {
-            float* ptr = buffer.getWritePointer (n);
-            filters[n]->process (getNumSamples (n), &ptr);
-        }
+        firBank.updateGroups();
+        processChannelsInParallel (buffer, firBank.getNumGroups());
+    }
+    else
+    {
+        filterBank.updateGroups();
+        processChannelsInParallel (buffer, filterBank.getNumGroups());
+    }
+}
+
+
+void FilterNode::processChannels (AudioSampleBuffer& buffer, int firstGroup, int lastGroup)
+{
+    if (processedType == FIR_FILTER)
+    {
+        for (int g = firstGroup; g < lastGroup; ++g)
+            firBank.processGroup (g, buffer, getNumSamples (firBank.getGroupFirstChannel (g)));
+    }
+    else
+    {
+        for (int g = firstGroup; g < lastGroup; ++g)
+            filterBank.processGroup (g, buffer, getNumSamples (filterBank.getGroupFirstChannel (g)));
     }
 }
 
@@ -317,9 +390,13 @@ void FilterNode::loadCustomChannelParametersFromXml(XmlElement* channelInfo, Inf
                 highCuts.set (channelNum, subNode->getDoubleAttribute ("highcut", defaultHighCut));
                 lowCuts.set  (channelNum, subNode->getDoubleAttribute ("lowcut",  defaultLowCut));
                 shouldFilterChannel.set (channelNum, subNode->getBoolAttribute ("shouldFilter", true));
+                filterBank.setChannelEnabled (channelNum, shouldFilterChannel[channelNum]);
+                firBank.setChannelEnabled (channelNum, shouldFilterChannel[channelNum]);
 
                 setFilterParameters (lowCuts[channelNum], highCuts[channelNum], channelNum);
             }
         }
+
+        updateIdleState();
     }
 }
@@ -25,12 +25,16 @@
 
 #include <ProcessorHeaders.h>
 #include "Dsp/Dsp.h"
+#include <VectorLib.h>
+#include "FirFilterBank.h"
 
 
 /**
     Filters data using a filter from the DSP library.
 
-    The user can select the low- and high-frequency cutoffs.
+    The user can select the low- and high-frequency cutoffs, and whether the channels are
+    filtered by Butterworth IIR filters, a few of them per SIMD instruction in a BiquadBank, or by
+    linear-phase FIR filters in a FirFilterBank.
 
     @see GenericProcessor, FilterEditor
 */
@@ -44,8 +48,20 @@ public:
 
     bool hasEditor() const override { return true; }
 
+    /** Prepares the FIR filters, for the first block to have them */
+    bool enable() override;
+
     void process (AudioSampleBuffer& buffer) override;
 
+    bool isChannelParallelSafe() const override { return true; }
+
+    /** Filters the channels of filter bank groups firstGroup to lastGroup - 1, which is what the
+        ranges of process() are made of */
+    void processChannels (AudioSampleBuffer& buffer, int firstGroup, int lastGroup) override;
+
+    /** Idle when every channel is bypassed */
+    bool isIdle() const override;
+
     void setParameter (int parameterIndex, float newValue) override;
 
     void updateSettings() override;
@@ -60,6 +76,14 @@ public:
 
     void setApplyOnADC (bool state);
 
+    enum FilterType { IIR_FILTER = 0, FIR_FILTER = 1 };
+
+    FilterType getFilterType() const;
+    int getFirNumTaps() const;
+
+    /** Returns how many samples the output lags behind the input */
+    int getLatencySamples() const;
+
 
 private:
     void setFilterParameters (double, double, int);
@@ -67,8 +91,13 @@ private:
     Array<double> lowCuts;
     Array<double> highCuts;
 
-    OwnedArray<Dsp::Filter> filters;
-    Array<bool> shouldFilterChannel;
+    BiquadBank filterBank;
+    FirFilterBank firBank;
+
+    Atomic<int> filterType;
+    /** The type of the block being processed, read once per block */
+    int processedType;
+    ChannelMask shouldFilterChannel;
 
     bool applyOnADC;
 
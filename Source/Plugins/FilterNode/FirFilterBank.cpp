@@ -0,0 +1,456 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "FirFilterBank.h"
+
+// transforms cover two partitions, the previous one giving the current one its history
+#define FIR_FFT_ORDER 9
+#define FIR_FFT_SIZE (2 * FIR_PARTITION_SAMPLES)
+
+
+bool FirFilterBank::Design::operator== (const Design& other) const
+{
+    return sampleRate == other.sampleRate && lowCut == other.lowCut && highCut == other.highCut;
+}
+
+
+FirFilterBank::FirFilterBank()
+    : numChannels   (0)
+    , numTaps       (FIR_DEFAULT_TAPS)
+    , forwardFFT    (FIR_FFT_ORDER, false)
+    , inverseFFT    (FIR_FFT_ORDER, true)
+{
+    static_assert ((1 << FIR_FFT_ORDER) == FIR_FFT_SIZE, "FIR_FFT_ORDER must match FIR_PARTITION_SAMPLES");
+}
+
+
+FirFilterBank::~FirFilterBank()
+{
+    cancelPendingUpdate();
+}
+
+
+void FirFilterBank::settingsChanged()
+{
+    groupsChanged = 1;
+    triggerAsyncUpdate();
+}
+
+
+void FirFilterBank::handleAsyncUpdate()
+{
+    prepareGroups();
+}
+
+
+void FirFilterBank::setNumChannels (int newNumChannels)
+{
+    {
+        const ScopedLock sl (settingsLock);
+        numChannels = newNumChannels;
+        channels.calloc (jmax (1, numChannels));
+    }
+
+    settingsChanged();
+}
+
+
+int FirFilterBank::getNumChannels() const
+{
+    return numChannels;
+}
+
+
+void FirFilterBank::setNumTaps (int newNumTaps)
+{
+    // odd lengths put the centre of the kernel on a sample, for a delay of a whole number of samples
+    newNumTaps = jlimit (3, FIR_MAX_TAPS, newNumTaps) | 1;
+
+    if (numTaps.exchange (newNumTaps) != newNumTaps)
+        settingsChanged();
+}
+
+
+int FirFilterBank::getNumTaps() const
+{
+    return numTaps.get();
+}
+
+
+void FirFilterBank::setChannelBandPass (int channel, double sampleRate, double lowCut, double highCut)
+{
+    const Design design = { sampleRate, lowCut, highCut };
+
+    {
+        const ScopedLock sl (settingsLock);
+
+        if (channel < 0 || channel >= numChannels)
+            return;
+
+        Channel& c = channels[channel];
+
+        if (c.hasDesign && c.design == design)
+            return;
+
+        c.design = design;
+        c.hasDesign = true;
+    }
+
+    settingsChanged();
+}
+
+
+void FirFilterBank::setChannelSource (int channel, uint32 sourceId)
+{
+    {
+        const ScopedLock sl (settingsLock);
+
+        if (channel < 0 || channel >= numChannels || channels[channel].sourceId == sourceId)
+            return;
+
+        channels[channel].sourceId = sourceId;
+    }
+
+    settingsChanged();
+}
+
+
+void FirFilterBank::setChannelEnabled (int channel, bool enabled)
+{
+    {
+        const ScopedLock sl (settingsLock);
+
+        if (channel < 0 || channel >= numChannels || channels[channel].enabled == enabled)
+            return;
+
+        channels[channel].enabled = enabled;
+    }
+
+    settingsChanged();
+}
+
+
+void FirFilterBank::designBandPass (double* taps, int numTaps, double sampleRate, double lowCut, double highCut)
+{
+    const double centre = (numTaps - 1) / 2.0;
+    const double low = lowCut / sampleRate;
+    const double high = highCut / sampleRate;
+    double gainRe = 0;
+    double gainIm = 0;
+
+    for (int n = 0; n < numTaps; ++n)
+    {
+        const double t = n - centre;
+        const double ideal = (t == 0) ? 2 * (high - low)
+                                      : (std::sin (2 * double_Pi * high * t) - std::sin (2 * double_Pi * low * t)) / (double_Pi * t);
+        const double phase = 2 * double_Pi * n / (numTaps - 1);
+        const double window = 0.42 - 0.5 * std::cos (phase) + 0.08 * std::cos (2 * phase);
+
+        taps[n] = ideal * window;
+
+        const double w = double_Pi * (low + high) * t;
+        gainRe += taps[n] * std::cos (w);
+        gainIm += taps[n] * std::sin (w);
+    }
+
+    const double gain = std::sqrt (gainRe * gainRe + gainIm * gainIm);
+
+    if (gain > 0)
+    {
+        for (int n = 0; n < numTaps; ++n)
+            taps[n] /= gain;
+    }
+}
+
+
+void FirFilterBank::prepareGroups()
+{
+    ScopedPointer<Layout> unused;
+    {
+        const ScopedLock sl (layoutLock);
+        unused = retiredLayout.release();
+    }
+
+    if (! groupsChanged.compareAndSetBool (0, 1))
+        return;
+
+    // a copy of the settings, so that the setters are held up for no longer than it takes
+    ScopedPointer<Layout> next = new Layout();
+    HeapBlock<Channel> settings;
+    {
+        const ScopedLock sl (settingsLock);
+        next->numChannels = numChannels;
+        settings.malloc (jmax (1, numChannels));
+        memcpy (settings.getData(), channels.getData(), sizeof (Channel) * size_t (numChannels));
+    }
+
+    const int taps = numTaps.get();
+    const int numPartitions = (taps + FIR_PARTITION_SAMPLES - 1) / FIR_PARTITION_SAMPLES;
+
+    HeapBlock<double> coefficients (numPartitions * FIR_PARTITION_SAMPLES, true);
+    HeapBlock<FFT::Complex> padded (FIR_FFT_SIZE);
+
+    next->channelGroups.malloc (jmax (1, next->numChannels));
+
+    // each group waits for a second channel of its source and design
+    HashMap<int, int> openGroups;
+    OwnedArray<Group>& groups = next->groups;
+
+    for (int i = 0; i < next->numChannels; ++i)
+    {
+        const Channel& c = settings[i];
+        next->channelGroups[i] = -1;
+
+        if (! c.enabled || ! c.hasDesign)
+            continue;
+
+        int k = 0;
+        while (k < next->kernels.size() && ! (next->kernels[k]->design == c.design))
+            ++k;
+
+        if (k == next->kernels.size())
+        {
+            // only the kernels of new designs are transformed
+            Kernel* kernel = nullptr;
+
+            for (int p = 0; p < preparedKernels.size() && kernel == nullptr; ++p)
+                if (preparedKernels[p]->design == c.design && preparedKernels[p]->numTaps == taps)
+                    kernel = preparedKernels[p];
+
+            if (kernel == nullptr)
+            {
+                kernel = new Kernel();
+                kernel->design = c.design;
+                kernel->numTaps = taps;
+                kernel->numPartitions = numPartitions;
+                kernel->partitions.malloc (size_t (numPartitions) * FIR_FFT_SIZE);
+
+                designBandPass (coefficients, taps, c.design.sampleRate, c.design.lowCut, c.design.highCut);
+
+                // the inverse transform isn't scaled, so the kernel is
+                const float scale = 1.0f / FIR_FFT_SIZE;
+
+                for (int p = 0; p < numPartitions; ++p)
+                {
+                    zeromem (padded, sizeof (FFT::Complex) * FIR_FFT_SIZE);
+
+                    for (int n = 0; n < FIR_PARTITION_SAMPLES; ++n)
+                        padded[n].r = float (coefficients[p * FIR_PARTITION_SAMPLES + n]) * scale;
+
+                    forwardFFT.perform (padded, kernel->partitions + p * FIR_FFT_SIZE);
+                }
+            }
+
+            next->kernels.add (kernel);
+        }
+
+        const Kernel* kernel = next->kernels[k];
+        const int key = int (c.sourceId) * 31 + k;
+        int g = openGroups.contains (key) ? openGroups[key] : -1;
+
+        if (g >= 0 && groups[g]->kernel == kernel && settings[groups[g]->channels[0]].sourceId == c.sourceId)
+        {
+            groups[g]->channels[groups[g]->numChannels++] = i;
+            next->channelGroups[i] = g;
+            openGroups.remove (key);
+            continue;
+        }
+
+        Group* group = new Group();
+        group->channels[0] = i;
+        group->channels[1] = -1;
+        group->numChannels = 1;
+        group->kernel = kernel;
+        group->position = 0;
+        group->head = 0;
+        group->input.calloc (FIR_FFT_SIZE);
+        group->spectra.calloc (size_t (numPartitions) * FIR_FFT_SIZE);
+        group->accumulator.calloc (FIR_FFT_SIZE);
+        group->result.calloc (FIR_FFT_SIZE);
+
+        next->channelGroups[i] = groups.size();
+        openGroups.set (key, groups.size());
+        groups.add (group);
+    }
+
+    preparedKernels = next->kernels;
+
+    // a layout prepared before and not switched to yet is replaced
+    {
+        const ScopedLock sl (layoutLock);
+        pendingLayout.swapWith (next);
+        layoutPending = 1;
+    }
+}
+
+
+void FirFilterBank::updateGroups()
+{
+    if (layoutPending.get() == 0)
+        return;
+
+    const ScopedLock sl (layoutLock);
+
+    // the layout before the last one hasn't been deleted yet, which the next prepareGroups() does
+    if (retiredLayout != nullptr)
+        return;
+
+    layoutPending = 0;
+
+    ScopedPointer<Layout> next (pendingLayout.release());
+
+    // the groups of the same channels and kernel go on from where they were
+    if (layout != nullptr)
+    {
+        for (int g = 0; g < next->groups.size(); ++g)
+        {
+            Group& group = *next->groups[g];
+
+            if (group.channels[0] >= layout->numChannels || layout->channelGroups[group.channels[0]] < 0)
+                continue;
+
+            Group& previous = *layout->groups[layout->channelGroups[group.channels[0]]];
+
+            if (previous.kernel == group.kernel && previous.channels[0] == group.channels[0]
+                && previous.channels[1] == group.channels[1])
+                group.swapStateWith (previous);
+        }
+    }
+
+    retiredLayout = layout.release();
+    layout = next.release();
+
+    triggerAsyncUpdate();
+}
+
+
+void FirFilterBank::Group::swapStateWith (Group& other)
+{
+    std::swap (position, other.position);
+    std::swap (head, other.head);
+    input.swapWith (other.input);
+    spectra.swapWith (other.spectra);
+    accumulator.swapWith (other.accumulator);
+    result.swapWith (other.result);
+}
+
+
+int FirFilterBank::getNumGroups() const
+{
+    return (layout != nullptr) ? layout->groups.size() : 0;
+}
+
+
+int FirFilterBank::getGroupFirstChannel (int group) const
+{
+    return layout->groups[group]->channels[0];
+}
+
+
+int FirFilterBank::getLatencySamples() const
+{
+    return getLatencySamplesForTaps (numTaps.get());
+}
+
+
+int FirFilterBank::getLatencySamplesForTaps (int taps)
+{
+    return FIR_PARTITION_SAMPLES + (taps - 1) / 2;
+}
+
+
+void FirFilterBank::processGroup (int groupIndex, AudioSampleBuffer& buffer, int numSamples)
+{
+    Group& group = *layout->groups[groupIndex];
+
+    float* first = buffer.getWritePointer (group.channels[0]);
+    float* second = (group.numChannels > 1) ? buffer.getWritePointer (group.channels[1]) : nullptr;
+
+    // samples go into the upper half of the input, and come out from the result of the previous partition
+    FFT::Complex* input = group.input + FIR_PARTITION_SAMPLES;
+    const FFT::Complex* output = group.result + FIR_PARTITION_SAMPLES;
+
+    int i = 0;
+    while (i < numSamples)
+    {
+        const int count = jmin (numSamples - i, FIR_PARTITION_SAMPLES - group.position);
+
+        for (int n = 0; n < count; ++n)
+        {
+            const int p = group.position + n;
+            input[p].r = first[i + n];
+            first[i + n] = output[p].r;
+        }
+
+        if (second != nullptr)
+        {
+            for (int n = 0; n < count; ++n)
+            {
+                const int p = group.position + n;
+                input[p].i = second[i + n];
+                second[i + n] = output[p].i;
+            }
+        }
+
+        group.position += count;
+        i += count;
+
+        if (group.position == FIR_PARTITION_SAMPLES)
+        {
+            convolvePartition (group);
+            group.position = 0;
+        }
+    }
+}
+
+
+void FirFilterBank::convolvePartition (Group& group) const
+{
+    FFT::Complex* latest = group.spectra + group.head * FIR_FFT_SIZE;
+    forwardFFT.perform (group.input, latest);
+
+    // the spectrum of partition p ago meets the p-th partition of the kernel
+    FFT::Complex* acc = group.accumulator;
+    zeromem (acc, sizeof (FFT::Complex) * FIR_FFT_SIZE);
+
+    const int numPartitions = group.kernel->numPartitions;
+
+    for (int p = 0; p < numPartitions; ++p)
+    {
+        const int slot = (group.head - p + numPartitions) % numPartitions;
+        const FFT::Complex* x = group.spectra + slot * FIR_FFT_SIZE;
+        const FFT::Complex* h = group.kernel->partitions + p * FIR_FFT_SIZE;
+
+        for (int k = 0; k < FIR_FFT_SIZE; ++k)
+        {
+            acc[k].r += x[k].r * h[k].r - x[k].i * h[k].i;
+            acc[k].i += x[k].r * h[k].i + x[k].i * h[k].r;
+        }
+    }
+
+    // only the upper half of the circular convolution is free of wrap-around
+    inverseFFT.perform (acc, group.result);
+
+    memcpy (group.input.getData(), group.input + FIR_PARTITION_SAMPLES, sizeof (FFT::Complex) * FIR_PARTITION_SAMPLES);
+    group.head = (group.head + 1) % numPartitions;
+}
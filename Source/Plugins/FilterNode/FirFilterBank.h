@@ -0,0 +1,189 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __FIRFILTERBANK_H_8D3E51B7__
+#define __FIRFILTERBANK_H_8D3E51B7__
+
+#include <ProcessorHeaders.h>
+
+/** Samples of each partition of the kernels, and of the latency of the convolution */
+#define FIR_PARTITION_SAMPLES 256
+#define FIR_DEFAULT_TAPS 255
+#define FIR_MAX_TAPS 8191
+
+
+/**
+    Filters many channels with linear-phase FIR band-pass filters, by uniformly partitioned
+    overlap-save convolution.
+
+    Kernels are windowed sincs of an odd number of taps, split in partitions of FIR_PARTITION_SAMPLES
+    taps whose spectra are computed once. Each new partition of input is transformed once and kept in
+    a delay line of spectra, and its output is the sum of the products of the last spectra with the
+    kernel partitions, so the cost per sample grows with the number of taps only through these
+    products, however long the kernel.
+
+    The output lags the input by getLatencySamples(): the partition being gathered, plus the half-length
+    delay inherent to any linear-phase kernel.
+
+    Two channels of the same source and design share a group, one being the real part and the other the
+    imaginary part of the same complex transforms, which halves the number of FFTs. All groups use the same
+    two FFT plans, and can be processed concurrently.
+
+    The setters can be called from any thread. The kernels and groups of the new settings are built by
+    prepareGroups() on the message thread, which only transforms the kernels of new designs, and the
+    processing thread switches to them in updateGroups(), where the groups that didn't change keep their
+    delay lines.
+
+    @see BiquadBank, FilterNode
+*/
+class FirFilterBank : private AsyncUpdater
+{
+public:
+    FirFilterBank();
+    ~FirFilterBank();
+
+    /** Sets the number of channels, all bypassed */
+    void setNumChannels (int numChannels);
+    int getNumChannels() const;
+
+    /** Sets the length of every kernel, rounded to an odd number of taps */
+    void setNumTaps (int numTaps);
+    int getNumTaps() const;
+
+    /** Makes a channel use a band-pass kernel between the given frequencies */
+    void setChannelBandPass (int channel, double sampleRate, double lowCut, double highCut);
+
+    /** Only channels of the same source are grouped together */
+    void setChannelSource (int channel, uint32 sourceId);
+
+    /** Bypassed channels are left untouched */
+    void setChannelEnabled (int channel, bool enabled);
+
+    /** Builds the kernels and groups of the settings if they changed since the last call, for the next
+        updateGroups() to switch to. Called on the message thread after each change, and must be called
+        before acquisition starts, so that the first block has them. */
+    void prepareGroups();
+
+    /** Switches to the groups last prepared, if any. Called by the processing thread, and must not be
+        called while groups are being processed. */
+    void updateGroups();
+
+    int getNumGroups() const;
+
+    /** Returns the first channel of a group, whose number of samples the group has */
+    int getGroupFirstChannel (int group) const;
+
+    /** Filters the first numSamples samples of the group's channels in place */
+    void processGroup (int group, AudioSampleBuffer& buffer, int numSamples);
+
+    int getLatencySamples() const;
+
+    /** Returns the latency of filters of the given length */
+    static int getLatencySamplesForTaps (int numTaps);
+
+    /** Fills taps with a Blackman-windowed sinc band-pass kernel, of unit gain at the centre of the band */
+    static void designBandPass (double* taps, int numTaps, double sampleRate, double lowCut, double highCut);
+
+
+private:
+    struct Design
+    {
+        double sampleRate;
+        double lowCut;
+        double highCut;
+
+        bool operator== (const Design& other) const;
+    };
+
+    struct Channel
+    {
+        uint32 sourceId;
+        bool enabled;
+        bool hasDesign;
+        Design design;
+    };
+
+    /** Spectra of the partitions of a kernel, scaled for the inverse transform */
+    struct Kernel : public ReferenceCountedObject
+    {
+        Design design;
+        int numTaps;
+        int numPartitions;
+        HeapBlock<FFT::Complex> partitions;
+    };
+
+    struct Group
+    {
+        int channels[2];
+        int numChannels;
+        const Kernel* kernel;
+        int position;                           // samples gathered of the current partition
+        int head;                               // delay line slot of the latest spectrum
+        HeapBlock<FFT::Complex> input;          // the last two partitions of input
+        HeapBlock<FFT::Complex> spectra;        // delay line of the spectra of the last partitions
+        HeapBlock<FFT::Complex> accumulator;
+        HeapBlock<FFT::Complex> result;
+
+        /** Takes over the delay lines of a group of the same channels and kernel */
+        void swapStateWith (Group& other);
+    };
+
+    /** The kernels and groups of a set of settings */
+    struct Layout
+    {
+        ReferenceCountedArray<Kernel> kernels;
+        OwnedArray<Group> groups;
+        HeapBlock<int> channelGroups;           // the group of each channel, or -1
+        int numChannels;
+    };
+
+    void handleAsyncUpdate() override;
+
+    /** Marks the settings as changed, for prepareGroups() to be called */
+    void settingsChanged();
+
+    /** Transforms the partition just gathered and computes the output of the next one */
+    void convolvePartition (Group& group) const;
+
+    CriticalSection settingsLock;               // held by the setters, and by prepareGroups() to copy them
+    HeapBlock<Channel> channels;
+    int numChannels;
+    Atomic<int> numTaps;
+    Atomic<int> groupsChanged;
+
+    /** The kernels of the last prepared groups, for the next ones to reuse. Only used by prepareGroups() */
+    ReferenceCountedArray<Kernel> preparedKernels;
+
+    CriticalSection layoutLock;                 // only held to hand layouts over
+    ScopedPointer<Layout> pendingLayout;        // prepared, not yet switched to
+    ScopedPointer<Layout> retiredLayout;        // switched from, for prepareGroups() to delete
+    Atomic<int> layoutPending;
+    ScopedPointer<Layout> layout;               // only used by the processing thread
+
+    FFT forwardFFT;
+    FFT inverseFFT;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FirFilterBank);
+};
+
+#endif  // __FIRFILTERBANK_H_8D3E51B7__
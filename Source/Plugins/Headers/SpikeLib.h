@@ -23,7 +23,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 /*
 This header provides access to the methods and structures for 
-representing, packing, unpacking and processing spike objects.
+detecting and processing spikes.
 */
 
-#include "../../Processors/Visualization/SpikeObject.h"
+#include "../../Processors/Dsp/NoiseEstimator.h"
+#include "../../Processors/Dsp/ThresholdDetector.h"
+#include "../../Processors/Dsp/SpikeFeatures.h"
+#include "../../Processors/Dsp/SpikeWaveform.h"
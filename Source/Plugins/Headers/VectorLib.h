@@ -0,0 +1,32 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2016 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+This header provides access to the vectorized sample loops the core
+uses: multi-channel threshold scans, int16/float conversion, min/max/mean
+decimation, interleaving and banks of biquads across channels.
+*/
+
+#include "../../Processors/Dsp/VectorOps.h"
+#include "../../Processors/Dsp/ThresholdDetector.h"
+#include "../../Processors/Dsp/BiquadBank.h"
@@ -27,6 +27,13 @@
 
 JuliaProcessor::JuliaProcessor()
     : GenericProcessor("Julia Processor")
+    , processFunction(nullptr)
+    , processBlockFunction(nullptr)
+    , vectorType(nullptr)
+    , matrixType(nullptr)
+    , blockArray(nullptr)
+    , blockSamples(0)
+    , blockChannels(0)
 {
 	hasJuliaInstance = false;
     dataHistoryBufferNumChannels = 256;
@@ -70,6 +77,7 @@ void JuliaProcessor::setFile(String fullpath)
 
 	String juliaString = "include(\"" + filePath + "\")";
 	run_julia_string(juliaString);
+	cacheJuliaFunctions();
 }
 
 void JuliaProcessor::reloadFile()
@@ -78,6 +86,7 @@ void JuliaProcessor::reloadFile()
     {
         String juliaString = "reload(\"" + filePath + "\")";
         run_julia_string(juliaString);
+        cacheJuliaFunctions();
     }
     else
     {
@@ -119,6 +128,41 @@ void JuliaProcessor::run_julia_string(String juliaString)
 }
 
 
+void JuliaProcessor::cacheJuliaFunctions()
+{
+    // both are bound in Main, so that the garbage collector keeps them
+    processFunction = jl_get_function(jl_main_module, "oe_process!");
+    processBlockFunction = jl_get_function(jl_main_module, "oe_process_block!");
+
+    // the array types are kept in Julia's type cache
+    vectorType = jl_apply_array_type(jl_float32_type, 1); // last arg is nDims
+    matrixType = jl_apply_array_type(jl_float32_type, 2);
+
+    // the file may have replaced oe_block, so a new one is allocated
+    blockArray = nullptr;
+    blockSamples = 0;
+    blockChannels = 0;
+
+    if (processBlockFunction == nullptr && processFunction == nullptr)
+        std::cout << "Julia file defines neither oe_process_block! nor oe_process!" << std::endl;
+}
+
+float* JuliaProcessor::getBlockData(int numSamples, int numChannels)
+{
+    if (blockArray == nullptr || numSamples != blockSamples || numChannels != blockChannels)
+    {
+        // column-major, so that each channel is contiguous, as in the buffer
+        jl_array_t* block = jl_alloc_array_2d(matrixType, numSamples, numChannels);
+        jl_set_global(jl_main_module, jl_symbol("oe_block"), (jl_value_t*) block);
+
+        blockArray = (jl_value_t*) block;
+        blockSamples = numSamples;
+        blockChannels = numChannels;
+    }
+
+    return (float*) jl_array_data((jl_array_t*) blockArray);
+}
+
 
 String JuliaProcessor::getFile()
 {
@@ -127,19 +171,42 @@ String JuliaProcessor::getFile()
 
 void JuliaProcessor::process(AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
 {
-	if (hasJuliaInstance)
+	if (! hasJuliaInstance)
+		return;
+
+	const int numSamples = buffer.getNumSamples();
+	const int numChannels = getNumOutputs();
+
+	if (processBlockFunction != nullptr)
 	{
-		jl_function_t *func = jl_get_function(jl_main_module, "oe_process!");    
-	
-		// create 2D array of float64 type
-		jl_value_t *array_type = jl_apply_array_type(jl_float32_type, 1); // last arg is nDims
+		if (numSamples == 0 || numChannels == 0)
+			return;
+
+		// one call for the whole block, so that its cost does not grow with the channels
+		float* data = getBlockData(numSamples, numChannels);
+
+		for (int n = 0; n < numChannels; n++)
+			FloatVectorOperations::copy(data + n * numSamples, buffer.getReadPointer(n), numSamples);
 
-		for (int n = 0; n < getNumOutputs(); n++)
+		jl_call1(processBlockFunction, blockArray);
+
+		if (jl_exception_occurred())
+		{
+			printf("%s \n", jl_typeof_str(jl_exception_occurred()));
+			return;
+		}
+
+		for (int n = 0; n < numChannels; n++)
+			FloatVectorOperations::copy(buffer.getWritePointer(n), data + n * numSamples, numSamples);
+	}
+	else if (processFunction != nullptr)
+	{
+		for (int n = 0; n < numChannels; n++)
 		{
 			float* ptr = buffer.getWritePointer(n); // to perform in-place edits to the buffer
-			jl_array_t *x = jl_ptr_to_array_1d(array_type, ptr , buffer.getNumSamples(), 0);
+			jl_array_t *x = jl_ptr_to_array_1d(vectorType, ptr, numSamples, 0);
 			JL_GC_PUSH1(&x);
-			jl_call1(func, (jl_value_t*)x);
+			jl_call1(processFunction, (jl_value_t*)x);
 			JL_GC_POP();
 		}
 	}
@@ -25,11 +25,17 @@
 
 #include <ProcessorHeaders.h>
 
+struct _jl_value_t;
+
 /**
   Julia Processor.
 
   Allows the user to select a Julia Programming Language file to use as filter
 
+  If the file defines oe_process_block!(data), it is called once per block with a
+  Float32 matrix holding one column of samples per channel, which it edits in place.
+  Otherwise oe_process!(data) is called once per channel.
+
   @see GenericProcessor, JuliaEditor
 */
 
@@ -61,6 +67,20 @@ private:
     AudioSampleBuffer* dataHistoryBuffer;
     void run_julia_string(String juliaString);
 
+    /** Looks up the functions of the file, after it was included or reloaded */
+    void cacheJuliaFunctions();
+
+    /** The matrix handed to oe_process_block!, allocated again only when the block size changes */
+    float* getBlockData(int numSamples, int numChannels);
+
+    _jl_value_t* processFunction;
+    _jl_value_t* processBlockFunction;
+    _jl_value_t* vectorType;
+    _jl_value_t* matrixType;
+    _jl_value_t* blockArray;        // kept alive by the oe_block global of Main
+    int blockSamples;
+    int blockChannels;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(JuliaProcessor);
 };
 
@@ -18,4 +18,10 @@ function oe_process!(data)
 		last = data[i];
 	end
 
-end
\ No newline at end of file
+end
+# if defined, this function is called instead, once per buffer update,
+# with a matrix holding one column of samples per channel, e.g.
+#
+# function oe_process_block!(data)
+# 	data .*= 0.5
+# end
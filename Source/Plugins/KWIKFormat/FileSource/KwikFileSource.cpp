@@ -29,7 +29,8 @@ using namespace H5;
 
 #define PROCESS_ERROR std::cerr << "KwikFilesource exception: " << error.getCDetailMsg() << std::endl
 
-KWIKFileSource::KWIKFileSource() : samplePos(0), skipRecordEngineCheck(false)
+KWIKFileSource::KWIKFileSource() : samplePos(0), chunkSamples(1), readBufferSize(0), bufferStart(0), bufferSamples(0),
+    skipRecordEngineCheck(false)
 {
 }
 
@@ -180,13 +181,158 @@ void KWIKFileSource::fillRecordInfo()
     }
 }
 
+/** Reads a one-dimensional dataset whole, returning its length */
+template <typename T>
+static hsize_t readEventColumn(H5File& file, const String& path, const DataType& type, HeapBlock<T>& data, size_t itemSize = 1)
+{
+    DataSet dataSet = file.openDataSet(path.toUTF8());
+    hsize_t dims[2] = { 0, 0 };
+    dataSet.getSpace().getSimpleExtentDims(dims);
+
+    data.malloc(jmax(hsize_t(1), dims[0]) * itemSize);
+    if (dims[0] > 0)
+        dataSet.read(data.getData(), type);
+    return dims[0];
+}
+
+void KWIKFileSource::fillEventInfo()
+{
+    //<basename>_<processor>.raw.kwd, the events of every processor being in <basename>.kwe
+    const File kwdFile(String(sourceFile->getFileName().c_str()));
+    const String basename = kwdFile.getFileName().upToLastOccurrenceOf("_", false, false);
+    const File kweFile = kwdFile.getSiblingFile(basename + ".kwe");
+    if (basename.isEmpty() || !kweFile.existsAsFile())
+        return;
+
+    //event timestamps are made samples of a record through the timestamp it started at
+    Array<int64> startTimes;
+    try
+    {
+        for (int i = 0; i < availableDataSets.size(); i++)
+        {
+            uint64 startTime = 0;
+            Group recordN = sourceFile->openGroup(("/recordings/" + String(availableDataSets[i])).toUTF8());
+            if (recordN.attrExists("start_time"))
+                recordN.openAttribute("start_time").read(PredType::NATIVE_UINT64, &startTime);
+            startTimes.add(int64(startTime));
+        }
+    }
+    catch (Exception error)
+    {
+        PROCESS_ERROR;
+        return;
+    }
+
+    try
+    {
+        H5File kwe(kweFile.getFullPathName().toUTF8(), H5F_ACC_RDONLY);
+
+        for (int type = 0; type < 2; type++)
+        {
+            const bool isTTL = type == 0;
+            const String path = isTTL ? "/event_types/TTL/events" : "/event_types/Messages/events";
+            if (!H5Lexists(kwe.getId(), "/event_types", H5P_DEFAULT) || !H5Lexists(kwe.getId(), path.toUTF8(), H5P_DEFAULT))
+                continue;
+
+            HeapBlock<uint64> timestamps;
+            HeapBlock<uint16> recordings;
+            HeapBlock<uint8> states;
+            HeapBlock<uint8> lines;
+            HeapBlock<char> texts;
+
+            hsize_t numEvents = readEventColumn(kwe, path + "/time_samples", PredType::NATIVE_UINT64, timestamps);
+            numEvents = jmin(numEvents, readEventColumn(kwe, path + "/recording", PredType::NATIVE_UINT16, recordings));
+            if (isTTL)
+            {
+                numEvents = jmin(numEvents, readEventColumn(kwe, path + "/user_data/eventID", PredType::NATIVE_UINT8, states));
+                numEvents = jmin(numEvents, readEventColumn(kwe, path + "/user_data/event_channels", PredType::NATIVE_UINT8, lines));
+            }
+            else
+            {
+                numEvents = jmin(numEvents, readEventColumn(kwe, path + "/user_data/Text", StrType(PredType::C_S1, KWE_TEXT_SIZE), texts, KWE_TEXT_SIZE));
+            }
+
+            int track = isTTL
+                ? addEventTrack(RecordedEventTrack::TTL, "TTL", 1)
+                : addEventTrack(RecordedEventTrack::TEXT, "Messages", 1);
+
+            for (hsize_t i = 0; i < numEvents; i++)
+            {
+                const int record = availableDataSets.indexOf(recordings[i]);
+                if (record < 0)
+                    continue;
+
+                const int64 sample = int64(timestamps[i]) - startTimes[record];
+                if (isTTL)
+                {
+                    if (lines[i] >= 64)
+                        continue;
+                    eventTracks.getReference(track).size = jmax(eventTracks[track].size, lines[i] + 1);
+                    addTTLEvent(record, track, sample, lines[i], states[i] != 0);
+                }
+                else
+                {
+                    const char* text = texts + i * KWE_TEXT_SIZE;
+                    addTextEvent(record, track, sample, String::fromUTF8(text, int(strnlen(text, KWE_TEXT_SIZE))));
+                }
+            }
+        }
+    }
+    catch (Exception error)
+    {
+        PROCESS_ERROR;
+    }
+}
+
+/** Smallest prime not lower than n, as the chunk cache hash table works best with a prime number of slots */
+static size_t nextPrime(size_t n)
+{
+    for (;; n++)
+    {
+        bool prime = n > 1;
+        for (size_t d = 2; d * d <= n && prime; d++)
+            prime = (n % d) != 0;
+        if (prime)
+            return n;
+    }
+}
+
 void KWIKFileSource::updateActiveRecord()
 {
     samplePos=0;
+    bufferSamples = 0;
     try
     {
         String path = "/recordings/" + String(availableDataSets[activeRecord.get()]) + "/data";
         dataSet = new DataSet(sourceFile->openDataSet(path.toUTF8()));
+
+        chunkSamples = 1;
+        DSetCreatPropList createProps = dataSet->getCreatePlist();
+        if (createProps.getLayout() == H5D_CHUNKED)
+        {
+            hsize_t chunkDims[3];
+            createProps.getChunk(3, chunkDims);
+            chunkSamples = jmax(hsize_t(1), chunkDims[0]);
+        }
+
+        const int nChannels = jmax(getActiveNumChannels(), 1);
+        const int64 readChunks = (KWIK_MIN_READ_SAMPLES + chunkSamples - 1) / chunkSamples;
+        readBufferSize = readChunks * chunkSamples;
+        readBuffer.malloc(size_t(readBufferSize) * nChannels);
+
+        if (chunkSamples > 1)
+        {
+            //reopen the file with room in the chunk cache for a whole read, so no chunk is decoded twice
+            //while it is being copied out. Chunks are only read once anyway, so they are evicted first
+            const size_t chunkBytes = size_t(chunkSamples) * nChannels * sizeof(int16);
+            const size_t cacheBytes = size_t(readChunks) * chunkBytes;
+            FileAccPropList props;
+            props.setCache(0, nextPrime(jmax(size_t(521), 100 * size_t(readChunks))), cacheBytes, 1);
+            ScopedPointer<H5File> tmpFile = new H5File(getFileName().toUTF8(), H5F_ACC_RDONLY, FileCreatPropList::DEFAULT, props);
+            dataSet = nullptr;
+            sourceFile = tmpFile;
+            dataSet = new DataSet(sourceFile->openDataSet(path.toUTF8()));
+        }
     }
     catch (FileIException error)
     {
@@ -205,10 +351,8 @@ void KWIKFileSource::seekTo(int64 sample)
 
 int KWIKFileSource::readData(int16* buffer, int nSamples)
 {
-    DataSpace fSpace,mSpace;
     int samplesToRead;
     int nChannels = getActiveNumChannels();
-    hsize_t dim[3],offset[3];
 
     if (samplePos + nSamples > getActiveNumSamples())
     {
@@ -219,35 +363,59 @@ int KWIKFileSource::readData(int16* buffer, int nSamples)
         samplesToRead = nSamples;
     }
 
+    //reads go through whole chunks, so chunks straddling two refills aren't decoded twice
+    int samplesRead = 0;
+    while (samplesRead < samplesToRead)
+    {
+        if (samplePos < bufferStart || samplePos >= bufferStart + bufferSamples)
+        {
+            if (!fillReadBuffer(samplePos))
+                break;
+        }
+
+        const int n = (int) jmin(int64(samplesToRead - samplesRead), bufferStart + bufferSamples - samplePos);
+        memcpy(buffer + size_t(samplesRead) * nChannels, readBuffer + size_t(samplePos - bufferStart) * nChannels,
+               size_t(n) * nChannels * sizeof(int16));
+        samplesRead += n;
+        samplePos += n;
+    }
+    return samplesRead;
+}
+
+bool KWIKFileSource::fillReadBuffer(int64 sample)
+{
+    DataSpace fSpace,mSpace;
+    hsize_t dim[3],offset[3];
+
+    bufferStart = sample - (sample % chunkSamples);
+    bufferSamples = jmin(readBufferSize, getActiveNumSamples() - bufferStart);
+
     try
     {
         fSpace = dataSet->getSpace();
-        dim[0] = samplesToRead;
-        dim[1] = nChannels;
+        dim[0] = bufferSamples;
+        dim[1] = getActiveNumChannels();
         dim[2] = 1;
-        offset[0] = samplePos;
+        offset[0] = bufferStart;
         offset[1] = 0;
         offset[2] = 0;
 
         fSpace.selectHyperslab(H5S_SELECT_SET,dim,offset);
         mSpace = DataSpace(2,dim);
 
-        dataSet->read(buffer,PredType::NATIVE_INT16,mSpace,fSpace);
-        samplePos += samplesToRead;
-        return samplesToRead;
-
+        dataSet->read(readBuffer.getData(),PredType::NATIVE_INT16,mSpace,fSpace);
+        return true;
     }
     catch (DataSetIException error)
     {
         PROCESS_ERROR;
-        return 0;
     }
     catch (DataSpaceIException error)
     {
         PROCESS_ERROR;
-        return 0;
     }
-    return 0;
+    bufferSamples = 0;
+    return false;
 }
 
 void KWIKFileSource::processChannelData(int16* inBuffer, float* outBuffer, int channel, int64 numSamples)
@@ -262,6 +430,17 @@ void KWIKFileSource::processChannelData(int16* inBuffer, float* outBuffer, int c
 
 }
 
+void KWIKFileSource::processAllChannelsData(int16* inBuffer, float* const* outBuffers, int64 numSamples)
+{
+    deinterleaveChannels(inBuffer, outBuffers, activeBitVolts.getRawDataPointer(), getActiveNumChannels(), numSamples);
+}
+
+bool KWIKFileSource::canBeReadConcurrently() const
+{
+    //the HDF5 library isn't built thread-safe
+    return false;
+}
+
 bool KWIKFileSource::isReady()
 {
 	//HDF5 is by default not thread-safe, so we must warn the user.
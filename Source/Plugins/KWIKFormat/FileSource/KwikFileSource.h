@@ -29,6 +29,12 @@
 #define MIN_KWIK_VERSION 2
 #define MAX_KWIK_VERSION 2
 
+//least number of samples read from the file at once, rounded up to whole chunks
+#define KWIK_MIN_READ_SAMPLES 16384
+
+//size of the fixed length texts of the Messages events in .kwe files
+#define KWE_TEXT_SIZE 256
+
 class HDF5RecordingData;
 namespace H5
 {
@@ -49,18 +55,37 @@ public:
 
     void processChannelData (int16* inBuffer, float* outBuffer, int channel, int64 numSamples) override;
 
+    void processAllChannelsData (int16* inBuffer, float* const* outBuffers, int64 numSamples) override;
+
     bool isReady() override;
 
+    bool canBeReadConcurrently() const override;
+
 
 private:
     bool Open (File file) override;
     void fillRecordInfo() override;
     void updateActiveRecord() override;
 
+    /** Indexes the TTL and Messages events of the .kwe file written along with the .kwd file */
+    void fillEventInfo() override;
+
+    /** Reads the whole chunks holding sample into readBuffer. Returns false on error */
+    bool fillReadBuffer(int64 sample);
+
     ScopedPointer<H5::H5File> sourceFile;
     ScopedPointer<H5::DataSet> dataSet;
 
     int64 samplePos;
+
+    /** Samples per chunk of the active dataset, 1 if it isn't chunked */
+    int64 chunkSamples;
+    /** Chunk-aligned samples [bufferStart, bufferStart + bufferSamples) of the active dataset */
+    HeapBlock<int16> readBuffer;
+    int64 readBufferSize;
+    int64 bufferStart;
+    int64 bufferSamples;
+
     Array<int> availableDataSets;
     bool skipRecordEngineCheck;
 };
@@ -22,6 +22,7 @@
  */
 
 #include "HDF5Recording.h"
+#include <memory>
 #define MAX_BUFFER_SIZE 40960
 #define CHANNEL_TIMESTAMP_PREALLOC_SIZE 128
 #define CHANNEL_TIMESTAMP_MIN_WRITE	32
@@ -36,6 +37,13 @@ HDF5Recording::HDF5Recording() : processorIndex(-1), bufferSize(MAX_BUFFER_SIZE)
 
 HDF5Recording::~HDF5Recording()
 {	
+	//the files close their datasets on destruction
+	writer->call([this]
+	{
+		fileArray.clear();
+		eventFile = nullptr;
+		spikesFile = nullptr;
+	});
 }
 
 String HDF5Recording::getEngineID() const
@@ -69,7 +77,7 @@ void HDF5Recording::resetChannels()
 	intBuffer.malloc(MAX_BUFFER_SIZE);
 	bufferSize = MAX_BUFFER_SIZE;
     processorIndex = -1;
-    fileArray.clear();
+    writer->call([this] { fileArray.clear(); });
 	channelsPerProcessor.clear();
     bitVoltsArray.clear();
     sampleRatesArray.clear();
@@ -92,12 +100,11 @@ void HDF5Recording::openFiles(File rootFolder, int experimentNumber, int recordi
     String basepath = rootFolder.getFullPathName() + rootFolder.separatorString + "experiment" + String(experimentNumber);
     //KWE file
     eventFile->initFile(basepath);
-    eventFile->open();
+    eventFile->setStorageSettings(storageSettings);
 
     //KWX file
     spikesFile->initFile(basepath);
-    spikesFile->open();
-    spikesFile->startNewRecording(recordingNumber);
+    spikesFile->setStorageSettings(storageSettings);
 
     //Let's just put the first processor (usually the source node) on the KWIK for now
     infoArray[0]->name = String("Open Ephys Recording #") + String(recordingNumber);
@@ -109,7 +116,6 @@ void HDF5Recording::openFiles(File rootFolder, int experimentNumber, int recordi
 	infoArray[0]->start_time = getTimestamp(0);
 
     infoArray[0]->start_sample = 0;
-    eventFile->startNewRecording(recordingNumber,infoArray[0]);
 
     //KWD files
 	recordedChanToKWDChan.clear();
@@ -139,49 +145,63 @@ void HDF5Recording::openFiles(File rootFolder, int experimentNumber, int recordi
 		channelLeftOverSamples.add(0);
 	} 
 
-    for (int i = 0; i < fileArray.size(); i++)
+    //every HDF5 call is made on the write thread
+    writer->call([&]
     {
-		if ((!fileArray[i]->isOpen()) && (fileArray[i]->isReadyToOpen()))
-		{
-			fileArray[i]->open(channelsPerProcessor[i]);
-		}
-        if (fileArray[i]->isOpen())
+        eventFile->open();
+        spikesFile->open();
+        spikesFile->startNewRecording(recordingNumber);
+        eventFile->startNewRecording(recordingNumber, infoArray[0]);
+
+        for (int i = 0; i < fileArray.size(); i++)
         {
-           // File f(fileArray[i]->getFileName());
-           // eventFile->addKwdFile(f.getFileName());
-
-            infoArray[i]->name = String("Open Ephys Recording #") + String(recordingNumber);
-            //           infoArray[i]->start_time = timestamp;
-            infoArray[i]->start_sample = 0;
-            infoArray[i]->bitVolts.clear();
-            infoArray[i]->bitVolts.addArray(*bitVoltsArray[i]);
-            infoArray[i]->channelSampleRates.clear();
-            infoArray[i]->channelSampleRates.addArray(*sampleRatesArray[i]);
-            fileArray[i]->startNewRecording(recordingNumber,bitVoltsArray[i]->size(),infoArray[i]);
+			if ((!fileArray[i]->isOpen()) && (fileArray[i]->isReadyToOpen()))
+			{
+				fileArray[i]->setStorageSettings(storageSettings);
+				fileArray[i]->open(channelsPerProcessor[i]);
+			}
+            if (fileArray[i]->isOpen())
+            {
+               // File f(fileArray[i]->getFileName());
+               // eventFile->addKwdFile(f.getFileName());
+
+                infoArray[i]->name = String("Open Ephys Recording #") + String(recordingNumber);
+                //           infoArray[i]->start_time = timestamp;
+                infoArray[i]->start_sample = 0;
+                infoArray[i]->bitVolts.clear();
+                infoArray[i]->bitVolts.addArray(*bitVoltsArray[i]);
+                infoArray[i]->channelSampleRates.clear();
+                infoArray[i]->channelSampleRates.addArray(*sampleRatesArray[i]);
+                fileArray[i]->startNewRecording(recordingNumber,bitVoltsArray[i]->size(),infoArray[i]);
+            }
         }
-    }
+    });
 
     hasAcquired = true;
 }
 
 void HDF5Recording::closeFiles()
 {
-    eventFile->stopRecording();
-    eventFile->close();
-    spikesFile->stopRecording();
-    spikesFile->close();
-    for (int i = 0; i < fileArray.size(); i++)
+    //runs after every write still queued
+    writer->call([this]
     {
-        if (fileArray[i]->isOpen())
+        eventFile->stopRecording();
+        eventFile->close();
+        spikesFile->stopRecording();
+        spikesFile->close();
+        for (int i = 0; i < fileArray.size(); i++)
         {
-			std::cout << "Closed file " << i << std::endl;
-            fileArray[i]->stopRecording();
-            fileArray[i]->close();
-            bitVoltsArray[i]->clear();
-			sampleRatesArray[i]->clear();
+            if (fileArray[i]->isOpen())
+            {
+				std::cout << "Closed file " << i << std::endl;
+                fileArray[i]->stopRecording();
+                fileArray[i]->close();
+                bitVoltsArray[i]->clear();
+				sampleRatesArray[i]->clear();
+            }
+			channelsPerProcessor.set(i, 0);
         }
-		channelsPerProcessor.set(i, 0);
-    }
+    });
 	recordedChanToKWDChan.clear();
 	channelTimestampArray.clear();
 	channelLeftOverSamples.clear();
@@ -199,11 +219,16 @@ void HDF5Recording::writeData(int writeChannel, int realChannel, const float* bu
 		scaledBuffer.malloc(size);
 		intBuffer.malloc(size);
 	}
-	double multFactor = 1 / (float(0x7fff) * getDataChannel(realChannel)->getBitVolts());
-	int index = processorMap[realChannel]; //CHECK
+	double multFactor = 1 / (float(0x7fff) * getDataChannelTable().bitVolts[realChannel]);
 	FloatVectorOperations::copyWithMultiply(scaledBuffer.getData(), buffer, multFactor, size);
 	AudioDataConverters::convertFloatToInt16LE(scaledBuffer.getData(), intBuffer.getData(), size);
-	fileArray[index]->writeRowData(intBuffer.getData(), size, recordedChanToKWDChan[writeChannel]);
+	writeDataInt16(writeChannel, realChannel, buffer, intBuffer.getData(), size);
+}
+
+void HDF5Recording::writeDataInt16(int writeChannel, int realChannel, const float* buffer, const int16* samples, int size)
+{
+	int index = processorMap[realChannel]; //CHECK
+	fileArray[index]->bufferRowData(samples, size, recordedChanToKWDChan[writeChannel]);
 
 	int sampleOffset = channelLeftOverSamples[writeChannel];
 	int blockStart = sampleOffset;
@@ -226,8 +251,20 @@ void HDF5Recording::writeData(int writeChannel, int realChannel, const float* bu
 	channelLeftOverSamples.set(writeChannel, (size + sampleOffset) % TIMESTAMP_EACH_NSAMPLES);
 }
 
+bool HDF5Recording::storesInt16Samples() const
+{
+	return true;
+}
+
 void HDF5Recording::endChannelBlock(bool lastBlock)
 {
+	//the samples of every channel of a file go in a single write
+	for (int i = 0; i < fileArray.size(); i++)
+	{
+		if (fileArray[i]->isOpen())
+			fileArray[i]->writeBufferedData(&writer.get());
+	}
+
 	int nCh = channelTimestampArray.size();
 	for (int ch = 0; ch < nCh; ++ch)
 	{
@@ -236,7 +273,13 @@ void HDF5Recording::endChannelBlock(bool lastBlock)
 		{
 			int realChan = getRealChannel(ch);
 			int index = processorMap[realChan]; //CHECK
-			fileArray[index]->writeTimestamps(channelTimestampArray[ch]->getRawDataPointer(), tsSize, recordedChanToKWDChan[ch]);
+			KWDFile* file = fileArray[index];
+			Array<int64> timestamps(*channelTimestampArray[ch]);
+			int channel = recordedChanToKWDChan[ch];
+			writer->post([file, timestamps, channel]
+			{
+				file->writeTimestamps(timestamps.begin(), timestamps.size(), channel);
+			});
 			channelTimestampArray[ch]->clearQuick();
 		}
 	}
@@ -249,20 +292,35 @@ void HDF5Recording::writeEvent(int eventChannel, const MidiMessage& event)
 		TTLEventPtr ttl = TTLEvent::deserializeFromMessage(event, getEventChannel(eventChannel));
 		if (ttl == nullptr) return;
 		uint8 channel = ttl->getChannel();
-		eventFile->writeEvent(0, (ttl->getState() ? 1 : 0), ttl->getSourceID(), &channel, ttl->getTimestamp());
+		uint8 state = ttl->getState() ? 1 : 0;
+		uint8 sourceID = ttl->getSourceID();
+		int64 timestamp = ttl->getTimestamp();
+		writer->post([this, channel, state, sourceID, timestamp]
+		{
+			uint8 data = channel;
+			eventFile->writeEvent(0, state, sourceID, &data, timestamp);
+		});
 	}
 	else if (Event::getEventType(event) == EventChannel::TEXT)
 	{
 		TextEventPtr text = TextEvent::deserializeFromMessage(event, getEventChannel(eventChannel));
 		if (text == nullptr) return;
 		String textMsg = text->getText();
-		eventFile->writeEvent(1, 0, text->getSourceID(), textMsg.toUTF8().getAddress(), text->getTimestamp());
+		uint8 sourceID = text->getSourceID();
+		int64 timestamp = text->getTimestamp();
+		writer->post([this, textMsg, sourceID, timestamp]
+		{
+			eventFile->writeEvent(1, 0, sourceID, textMsg.toUTF8().getAddress(), timestamp);
+		});
 	}
 }
 
 void HDF5Recording::writeTimestampSyncText(uint16 sourceID, uint16 sourceIdx, int64 timestamp, float, String text)
 {
-	eventFile->writeEvent(1, 0xFF, sourceID, text.toUTF8().getAddress(), timestamp);
+	writer->post([this, sourceID, timestamp, text]
+	{
+		eventFile->writeEvent(1, 0xFF, sourceID, text.toUTF8().getAddress(), timestamp);
+	});
 }
 
 void HDF5Recording::addSpikeElectrode(int index, const SpikeChannel* elec)
@@ -275,19 +333,58 @@ void HDF5Recording::writeSpike(int electrodeIndex, const SpikeEvent* spike)
 	Array<float> bitVolts;
 	for (int i = 0; i < spikeInfo->getNumChannels(); i++)
 		bitVolts.add(spikeInfo->getChannelBitVolts(i));
-    spikesFile->writeSpike(electrodeIndex,spikeInfo->getTotalSamples(),spike->getDataPointer(), bitVolts, spike->getTimestamp());
+	//the spike is only valid during this call
+	std::shared_ptr<SpikeEvent> copy(new SpikeEvent(*spike));
+	int nSamples = spikeInfo->getTotalSamples();
+	writer->post([this, electrodeIndex, nSamples, copy, bitVolts]
+	{
+		Array<float> volts(bitVolts);
+		spikesFile->writeSpike(electrodeIndex, nSamples, copy->getDataPointer(), volts, copy->getTimestamp());
+	});
 }
 
 void HDF5Recording::startAcquisition()
 {
-    eventFile = new KWEFile();
-    eventFile->addEventType("TTL",HDF5FileBase::BaseDataType::U8,"event_channels");
-	eventFile->addEventType("Messages", HDF5FileBase::BaseDataType::DSTR, "Text");
-    spikesFile = new KWXFile();
+    writer->call([this]
+    {
+        eventFile = new KWEFile();
+        eventFile->addEventType("TTL",HDF5FileBase::BaseDataType::U8,"event_channels");
+		eventFile->addEventType("Messages", HDF5FileBase::BaseDataType::DSTR, "Text");
+        spikesFile = new KWXFile();
+    });
 }
 
 RecordEngineManager* HDF5Recording::getEngineManager()
 {
     RecordEngineManager* man = new RecordEngineManager("KWIK","Kwik",&(engineFactory<HDF5Recording>));
+    EngineParameter* param;
+    param = new EngineParameter(EngineParameter::INT, 0, "Chunk length (samples)", CHUNK_XSIZE, 64, 65536);
+    man->addParameter(param);
+    param = new EngineParameter(EngineParameter::INT, 1, "Chunk cache (MB, 0 for automatic)", 0, 0, 4096);
+    man->addParameter(param);
+    param = new EngineParameter(EngineParameter::INT, 2, "Alignment (KB, 0 for none)", 0, 0, 65536);
+    man->addParameter(param);
+    param = new EngineParameter(EngineParameter::INT, 3, "Metadata block size (KB, 0 for default)", 0, 0, 65536);
+    man->addParameter(param);
+    param = new EngineParameter(EngineParameter::BOOL, 4, "Latest HDF5 file format", false);
+    man->addParameter(param);
+    param = new EngineParameter(EngineParameter::MULTI, 5, "Compression|None|gzip|LZ4|zstd", HDF5StorageSettings::NO_COMPRESSION);
+    man->addParameter(param);
+    param = new EngineParameter(EngineParameter::BOOL, 6, "Shuffle bytes before compressing", true);
+    man->addParameter(param);
+    param = new EngineParameter(EngineParameter::INT, 7, "Compression level (0 for default)", 0, 0, 22);
+    man->addParameter(param);
     return man;
 }
+
+void HDF5Recording::setParameter(EngineParameter& parameter)
+{
+    intParameter(0, storageSettings.chunkSamples);
+    else intParameter(1, storageSettings.cacheMB);
+    else intParameter(2, storageSettings.alignmentKB);
+    else intParameter(3, storageSettings.metaBlockKB);
+    else boolParameter(4, storageSettings.latestFormat);
+    else multiParameter(5, storageSettings.compression);
+    else boolParameter(6, storageSettings.shuffle);
+    else intParameter(7, storageSettings.compressionLevel);
+}
@@ -36,6 +36,8 @@ public:
     void openFiles(File rootFolder, int experimentNumber, int recordingNumber) override;
 	void closeFiles() override;
 	void writeData(int writeChannel, int realChannel, const float* buffer, int size) override;
+	void writeDataInt16(int writeChannel, int realChannel, const float* buffer, const int16* samples, int size) override;
+	bool storesInt16Samples() const override;
 	void writeEvent(int eventType, const MidiMessage& event) override;
 	void writeTimestampSyncText(uint16 sourceID, uint16 sourceIdx, int64 timestamp, float, String text) override;
 	void addDataChannel(int index, const DataChannel* chan) override;
@@ -45,9 +47,12 @@ public:
 	void resetChannels() override;
 	void startAcquisition() override;
 	void endChannelBlock(bool lastBlock) override;
+	void setParameter(EngineParameter& parameter) override;
 
     static RecordEngineManager* getEngineManager();
 private:
+    /** Declared first, so that it outlives the files */
+    SharedHDF5WriteThread writer;
 
     int processorIndex;
 
@@ -70,6 +75,8 @@ private:
 
     bool hasAcquired;
 
+	HDF5StorageSettings storageSettings;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(HDF5Recording);
 };
 
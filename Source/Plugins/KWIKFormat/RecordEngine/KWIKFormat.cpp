@@ -60,6 +60,7 @@ void KWDFile::startNewRecording(int recordingNumber, int nChannels, KWIKRecordin
 {
     this->recordingNumber = recordingNumber;
     this->nChannels = nChannels;
+    blockBuffer.setNumChannels(nChannels);
     this->multiSample = info->multiSample;
     uint8 mSample = info->multiSample ? 1 : 0;
 
@@ -89,7 +90,7 @@ void KWDFile::startNewRecording(int recordingNumber, int nChannels, KWIKRecordin
 	else
 		std::cerr << "Error creating sample rates data set" << std::endl;
 
-	recdata = createDataSet(BaseDataType::I16, 0, nChannels, CHUNK_XSIZE, recordPath + "/data");
+	recdata = createContinuousDataSet(BaseDataType::I16, 0, nChannels, getContinuousChunkSize(), recordPath + "/data");
     if (!recdata.get())
         std::cerr << "Error creating data set" << std::endl;
 
@@ -104,6 +105,7 @@ void KWDFile::stopRecording()
 {
     Array<uint32> samples;
     String path = String("/recordings/")+String(recordingNumber)+String("/data");
+    writeBufferedData();
     recdata->getRowXPositions(samples);
 
 	CHECK_ERROR(setAttributeArray(BaseDataType::U32, samples.getRawDataPointer(), samples.size(), path, "valid_samples"));
@@ -144,6 +146,21 @@ void KWDFile::writeRowData(int16* data, int nSamples, int channel)
 	}
 }
 
+void KWDFile::bufferRowData(const int16* data, int nSamples, int channel)
+{
+	blockBuffer.addSamples(channel, data, nSamples);
+}
+
+void KWDFile::writeBufferedData(HDF5WriteThread* writer)
+{
+	if (!recdata)
+		return;
+	if (writer)
+		blockBuffer.write(*writer, recdata);
+	else
+		CHECK_ERROR(blockBuffer.writeNow(recdata));
+}
+
 void KWDFile::writeTimestamps(int64* ts, int nTs, int channel)
 {
 	if (channel >= 0 && channel < nChannels)
@@ -25,6 +25,7 @@
 #define KWIKFORMAT_H_INCLUDED
  
 #include <OpenEphysHDF5Lib/HDF5FileFormat.h>
+#include <OpenEphysHDF5Lib/HDF5WriteThread.h>
 using namespace OpenEphysHDF5;
 
 struct KWIKRecordingInfo
@@ -52,6 +53,11 @@ public:
     void writeRowData(int16* data, int nSamples);
 	void writeRowData(int16* data, int nSamples, int channel);
 	void writeTimestamps(int64* ts, int nTs, int channel);
+	/** Adds samples of a channel to the block written by writeBufferedData() */
+	void bufferRowData(const int16* data, int nSamples, int channel);
+	/** Writes the samples gathered for every channel since the last call, all at once when they line up.
+	With a writer, the write is handed over to it and the file goes on gathering samples in a second buffer */
+	void writeBufferedData(HDF5WriteThread* writer = nullptr);
     String getFileName();
 
 protected:
@@ -65,6 +71,7 @@ private:
     bool multiSample;
     ScopedPointer<HDF5RecordingData> recdata;
 	ScopedPointer<HDF5RecordingData> tsData;
+	HDF5DoubleBlockBuffer blockBuffer;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(KWDFile);
 };
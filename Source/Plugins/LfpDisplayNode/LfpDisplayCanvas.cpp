@@ -27,20 +27,106 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 using namespace LfpViewer;
 
+#if JUCE_INTEL && (defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2))
+ #define LFP_DISPLAY_SSE 1
+ #include <emmintrin.h>
+#endif
+
+#if JUCE_ARM && defined (__aarch64__)
+ #define LFP_DISPLAY_NEON 1
+ #include <arm_neon.h>
+#endif
+
+namespace
+{
+    // columns per tile below which splitting a refresh further isn't worth the scheduling
+    const int minColumnsPerPaintJob = 8;
+
+    int getNumPaintThreads()
+    {
+        return jmax(1, SystemStats::getNumCpus() - 1);
+    }
+
+    // the min, max and sum of the samples of one pixel column, four at a time; the min and max
+    // start from +/-10000000 as the per-sample loop did, so an empty pixel keeps those
+    void scanPixelSamples (const float* samples, int numSamples, float& min, float& max, float& sum)
+    {
+        int j = 0;
+        min = 10000000;
+        max = -10000000;
+        sum = 0;
+
+       #if LFP_DISPLAY_SSE
+        if (numSamples >= 4)
+        {
+            __m128 vmin = _mm_set1_ps (min);
+            __m128 vmax = _mm_set1_ps (max);
+            __m128 vsum = _mm_setzero_ps();
+
+            for (; j + 4 <= numSamples; j += 4)
+            {
+                const __m128 x = _mm_loadu_ps (samples + j);
+                vmin = _mm_min_ps (vmin, x);
+                vmax = _mm_max_ps (vmax, x);
+                vsum = _mm_add_ps (vsum, x);
+            }
+
+            vmin = _mm_min_ps (vmin, _mm_movehl_ps (vmin, vmin));
+            vmin = _mm_min_ss (vmin, _mm_shuffle_ps (vmin, vmin, 1));
+            vmax = _mm_max_ps (vmax, _mm_movehl_ps (vmax, vmax));
+            vmax = _mm_max_ss (vmax, _mm_shuffle_ps (vmax, vmax, 1));
+            vsum = _mm_add_ps (vsum, _mm_movehl_ps (vsum, vsum));
+            vsum = _mm_add_ss (vsum, _mm_shuffle_ps (vsum, vsum, 1));
+
+            min = _mm_cvtss_f32 (vmin);
+            max = _mm_cvtss_f32 (vmax);
+            sum = _mm_cvtss_f32 (vsum);
+        }
+       #elif LFP_DISPLAY_NEON
+        if (numSamples >= 4)
+        {
+            float32x4_t vmin = vdupq_n_f32 (min);
+            float32x4_t vmax = vdupq_n_f32 (max);
+            float32x4_t vsum = vdupq_n_f32 (0);
+
+            for (; j + 4 <= numSamples; j += 4)
+            {
+                const float32x4_t x = vld1q_f32 (samples + j);
+                vmin = vminq_f32 (vmin, x);
+                vmax = vmaxq_f32 (vmax, x);
+                vsum = vaddq_f32 (vsum, x);
+            }
+
+            min = vminvq_f32 (vmin);
+            max = vmaxvq_f32 (vmax);
+            sum = vaddvq_f32 (vsum);
+        }
+       #endif
+
+        for (; j < numSamples; ++j)
+        {
+            const float x = samples[j];
+            min = jmin (min, x);
+            max = jmax (max, x);
+            sum += x;
+        }
+    }
+}
+
 
 
 #pragma mark - LfpDisplayCanvas -
 
 LfpDisplayCanvas::LfpDisplayCanvas(LfpDisplayNode* processor_) :
      timebase(1.0f), displayGain(1.0f),   timeOffset(0.0f),
-    processor(processor_)
+    processor(processor_), spectrogramMode(false), animating(false), displayLevel(0),
+    numPixelChannels(0), numPixelColumns(0), detailReduced(false)
 {
 
     nChans = processor->getNumInputs();
     std::cout << "Setting num inputs on LfpDisplayCanvas to " << nChans << std::endl;
 
-    displayBuffer = processor->getDisplayBufferAddress();
-    displayBufferSize = displayBuffer->getNumSamples();
+    displayBufferSize = processor->getDisplayBufferSize(displayLevel);
     std::cout << "Setting displayBufferSize on LfpDisplayCanvas to " << displayBufferSize << std::endl;
 
     screenBuffer = new AudioSampleBuffer(MAX_N_CHAN, MAX_N_SAMP);
@@ -57,6 +143,7 @@ LfpDisplayCanvas::LfpDisplayCanvas(LfpDisplayNode* processor_) :
     lfpDisplay = new LfpDisplay(this, viewport);
     timescale = new LfpTimescale(this, lfpDisplay);
     options = new LfpDisplayOptions(this, timescale, lfpDisplay, processor);
+    spectrogram = new LfpSpectrogram(processor);
 
     lfpDisplay->options = options;
 
@@ -88,47 +175,24 @@ LfpDisplayCanvas::LfpDisplayCanvas(LfpDisplayNode* processor_) :
 LfpDisplayCanvas::~LfpDisplayCanvas()
 {
 
-    // de-allocate 3d-array samplesPerPixel [nChans][MAX_N_SAMP][MAX_N_SAMP_PER_PIXEL];
-
-    //for(int i=0;i<nChans;i++)
-    //{
-    //    for(int j=0;j<MAX_N_SAMP;j++)
-    //    {
-    //        free(samplesPerPixel[i][j]);
-    //    }
-    //    free(samplesPerPixel[i]);
-    // }
-    // free(samplesPerPixel);
-
-    samplesPerPixel.clear();
-    
     TopLevelWindow::getTopLevelWindow(0)->removeKeyListener(this);
 }
 
 void LfpDisplayCanvas::resizeSamplesPerPixelBuffer(int numCh)
 {
-    // allocate samplesPerPixel, behaves like float samplesPerPixel[nChans][MAX_N_SAMP][MAX_N_SAMP_PER_PIXEL]
-    //samplesPerPixel = (float***)malloc(nChans * sizeof(float **));
+    // the columns of the screen buffer, as in updateScreenBuffer
+    int numColumns = jlimit(0, MAX_N_SAMP, lfpDisplay->getWidth() - leftmargin);
+
+    if (numCh == numPixelChannels && numColumns == numPixelColumns)
+        return;
 
-    // 3D array: dimensions channels x samples x samples per pixel
-    samplesPerPixel.clear();
-    samplesPerPixel.resize(numCh);
+    numPixelChannels = numCh;
+    numPixelColumns = numColumns;
 
-    //for(int i = 0; i < numCh; i++)
-    //{
-        //std::vector< std::vector<float>> v1;
-    //    samplesPerPixel[i].resize(MAX_N_SAMP);
-        //samplesPerPixel.push_back(v1);
-        //samplesPerPixel[i] = (float**)malloc(MAX_N_SAMP * sizeof(float*));
+    const size_t numPixels = (size_t) jmax(1, numPixelChannels * numPixelColumns);
 
-    //    for(int j = 0; j < MAX_N_SAMP; j++)
-    //    {
-            //std::vector<float> v2;
-            //v2.resize(MAX_N_SAMP_PER_PIXEL);
-    //        samplesPerPixel[i][j].resize(MAX_N_SAMP_PER_PIXEL);
-    //        //samplesPerPixel[i][j] = (float*)malloc(MAX_N_SAMP_PER_PIXEL*sizeof(float));
-    //    }
-   //}
+    samplesPerPixel.malloc(numPixels * MAX_N_SAMP_PER_PIXEL);
+    sampleCountPerPixel.calloc(numPixels);
 }
 
 void LfpDisplayCanvas::toggleOptionsDrawer(bool isOpen)
@@ -157,6 +221,8 @@ void LfpDisplayCanvas::resized()
         lfpDisplay->setBounds(0, 0, getWidth(), getHeight());
     }
 
+    resizeSamplesPerPixelBuffer(nChans);
+
     if (optionsDrawerIsOpen)
         options->setBounds(0, getHeight()-200, getWidth(), 200);
     else
@@ -186,13 +252,16 @@ void LfpDisplayCanvas::beginAnimation()
 {
     std::cout << "Beginning animation." << std::endl;
 
-    displayBufferSize = displayBuffer->getNumSamples();
+    displayBufferSize = processor->getDisplayBufferSize(displayLevel);
 
     for (int i = 0; i < screenBufferIndex.size(); i++)
     {
         screenBufferIndex.set(i,0);
     }
 
+    animating = true;
+    updateSpectrogram();
+
     startCallbacks();
 }
 
@@ -201,6 +270,43 @@ void LfpDisplayCanvas::endAnimation()
     std::cout << "Ending animation." << std::endl;
 
     stopCallbacks();
+
+    // the taps are only resized outside of acquisition, so the spectrogram stops reading them first
+    animating = false;
+    updateSpectrogram();
+}
+
+void LfpDisplayCanvas::setSpectrogramMode(bool isEnabled)
+{
+    spectrogramMode = isEnabled;
+    updateSpectrogram();
+    redraw();
+}
+
+bool LfpDisplayCanvas::getSpectrogramMode()
+{
+    return spectrogramMode;
+}
+
+LfpSpectrogram* LfpDisplayCanvas::getSpectrogram()
+{
+    return spectrogram;
+}
+
+void LfpDisplayCanvas::updateSpectrogram()
+{
+    spectrogram->stopThread(1000);
+
+    if (spectrogramMode && animating)
+    {
+        Array<float> channelSampleRates;
+
+        for (int i = 0; i < nChans; i++)
+            channelSampleRates.add(sampleRate[i]);
+
+        spectrogram->prepare(channelSampleRates, lfpDisplay->getDisplayedSampleRate());
+        spectrogram->startThread();
+    }
 }
 
 void LfpDisplayCanvas::update()
@@ -212,6 +318,7 @@ void LfpDisplayCanvas::update()
     sampleRate.clear();
     screenBufferIndex.clear();
     lastScreenBufferIndex.clear();
+    screenBufferStale.clear();
     displayBufferIndex.clear();
     
     options->setEnabled(nChans != 0);
@@ -246,6 +353,7 @@ void LfpDisplayCanvas::update()
         displayBufferIndex.add(0);
         screenBufferIndex.add(0);
         lastScreenBufferIndex.add(0);
+        screenBufferStale.add(false);
     }
 
     if (nChans != lfpDisplay->getNumChannels())
@@ -312,7 +420,7 @@ void LfpDisplayCanvas::refreshState()
     for (int i = 0; i <= displayBufferIndex.size(); i++) // include event channel
     {
 
-        displayBufferIndex.set(i, processor->getDisplayBufferIndex(i));
+        displayBufferIndex.set(i, processor->getDisplayBufferIndex(i, displayLevel));
         screenBufferIndex.set(i,0);
     }
 
@@ -324,6 +432,10 @@ void LfpDisplayCanvas::refreshScreenBuffer()
     for (int i = 0; i < screenBufferIndex.size(); i++)
         screenBufferIndex.set(i,0);
 
+    // the cleared columns are as up to date as any
+    for (int i = 0; i < screenBufferStale.size(); i++)
+        screenBufferStale.set(i, false);
+
     screenBuffer->clear();
     screenBufferMin->clear();
     screenBufferMean->clear();
@@ -331,13 +443,49 @@ void LfpDisplayCanvas::refreshScreenBuffer()
 
 }
 
+int LfpDisplayCanvas::chooseDisplayLevel() const
+{
+    int level = 0;
+
+    while (level < DISPLAY_TAP_NUM_LEVELS - 1 && DisplayTap::getLevelSeconds(level) <= timebase)
+        level++;
+
+    return level;
+}
+
 void LfpDisplayCanvas::updateScreenBuffer()
 {
+    // long timebases are drawn from the minima and maxima of the coarser levels of the taps
+    const int level = chooseDisplayLevel();
+
+    if (level != displayLevel)
+    {
+        // the indices are in entries of the level, so every channel is drawn again from the new one's history
+        displayLevel = level;
+        displayBufferSize = processor->getDisplayBufferSize(displayLevel);
+
+        for (int i = 0; i < displayBufferIndex.size(); i++)
+        {
+            displayBufferIndex.set(i, processor->getDisplayBufferIndex(i, displayLevel));
+
+            if (i < screenBufferStale.size())
+                screenBufferStale.set(i, true);
+        }
+    }
+
+    // nothing was displayed yet
+    if (displayBufferSize <= 0)
+        return;
 
     // copy new samples from the displayBuffer into the screenBuffer
     int maxSamples = lfpDisplay->getWidth() - leftmargin;
 
-	ScopedLock displayLock(*processor->getMutex());
+    // channels this close to the viewport are kept up to date, so that scrolling a little
+    // never shows a channel before it caught up
+    const int margin = 2 * lfpDisplay->getChannelHeight();
+
+    // no lock is taken: the processor publishes each channel's index after copying its samples,
+    // and the count of samples written tells afterwards if it came back around over what was read
 
     for (int channel = 0; channel <= nChans; channel++) // pull one extra channel for event display
     {
@@ -351,7 +499,9 @@ void LfpDisplayCanvas::updateScreenBuffer()
         
         lastScreenBufferIndex.set(channel,sbi);
 
-        int index = processor->getDisplayBufferIndex(channel);
+        // the count before the index, so that the index is at least as recent
+        const int64 samplesWrittenBefore = processor->getDisplayBufferSamplesWritten(channel, displayLevel);
+        int index = processor->getDisplayBufferIndex(channel, displayLevel);
 
         int nSamples =  index - dbi; // N new samples (not pixels) to be added to displayBufferIndex
 
@@ -365,7 +515,8 @@ void LfpDisplayCanvas::updateScreenBuffer()
         //     std::cout << channel << " " << sbi << " " << dbi << " " << nSamples << std::endl;
 
 
-        float ratio = sampleRate[channel] * timebase / float(getWidth() - leftmargin - scrollBarThickness); // samples / pixel
+        float ratio = sampleRate[channel] * timebase / float(getWidth() - leftmargin - scrollBarThickness)
+                      / DisplayTap::getLevelFactor(displayLevel); // entries of the level / pixel
         // this number is crucial: converting from samples to values (in px) for the screen buffer
         int valuesNeeded = (int) float(nSamples) / ratio; // N pixels needed for this update
 
@@ -376,7 +527,6 @@ void LfpDisplayCanvas::updateScreenBuffer()
         float subSampleOffset = 0.0;
 
         dbi %= displayBufferSize; // make sure we're not overshooting
-        int nextPos = (dbi + 1) % displayBufferSize; //  position next to displayBufferIndex in display buffer to copy from
 
 //         if (channel == 0)
 //             std::cout << "Channel " 
@@ -390,122 +540,189 @@ void LfpDisplayCanvas::updateScreenBuffer()
         
         if (valuesNeeded > 0 && valuesNeeded < 1000000)
         {
-            for (int i = 0; i < valuesNeeded; i++) // also fill one extra sample for line drawing interpolation to match across draws
+            // channels out of view only have their indices advanced, and catch up once back in view
+            const bool inView = lfpDisplay->isChannelInView(channel, margin);
+
+            //If paused don't update screen buffers, but update all indexes as needed
+            const bool write = inView && !lfpDisplay->isPaused;
+
+            decimateScreenColumns(channel, sbi, valuesNeeded, dbi, subSampleOffset, ratio, write);
+
+            if (!lfpDisplay->isPaused)
             {
-                //If paused don't update screen buffers, but update all indexes as needed
-                if (!lfpDisplay->isPaused)
-                {
-                    float gain = 1.0;
-                    float alpha = (float) subSampleOffset;
-                    float invAlpha = 1.0f - alpha;
+                sbi += valuesNeeded;
 
-                    screenBuffer->clear(channel, sbi, 1);
-                    screenBufferMean->clear(channel, sbi, 1);
-                    screenBufferMin->clear(channel, sbi, 1);
-                    screenBufferMax->clear(channel, sbi, 1);
+                if (!inView)
+                    screenBufferStale.set(channel, true);
+            }
 
-                    dbi %= displayBufferSize; // just to be sure
-                    
-                    // update continuous data channels
-                    if (channel != nChans)
-                    {
-                        // interpolate between two samples with invAlpha and alpha
-                        screenBuffer->addFrom(channel, // destChannel
-                                              sbi, // destStartSample
-                                              displayBuffer->getReadPointer(channel, dbi), // source
-                                              1, // numSamples
-                                              invAlpha*gain); // gain
-
-
-                        screenBuffer->addFrom(channel, // destChannel
-                                              sbi, // destStartSample
-                                              displayBuffer->getReadPointer(channel, nextPos), // source
-                                              1, // numSamples
-                                              alpha*gain); // gain
-                    }
+            if (write && screenBufferStale[channel])
+            {
+                catchUpScreenColumns(channel, sbi, dbi, nSamples, ratio);
+                screenBufferStale.set(channel, false);
+                fullredraw = true;
+            }
 
-                    // same thing again, but this time add the min,mean, and max of all samples in current pixel
-                    float sample_min   =  10000000;
-                    float sample_max   = -10000000;
-                    float sample_mean  =  0;
-                    
-                    int nextpix = (dbi +(int)ratio +1) % (displayBufferSize+1); //  position to next pixels index
-                    
-                    if (nextpix <= dbi) { // at the end of the displaybuffer, this can occur and it causes the display to miss one pixel woth of sample - this circumvents that
-                    //    std::cout << "np " ;
-                        nextpix=dbi;
-                    }
-                   
-                    for (int j = dbi; j < nextpix; j++)
-                    {
-                        
-                        float sample_current = displayBuffer->getSample(channel, j);
-                        sample_mean = sample_mean + sample_current;
+            // if the processor wrote over the samples read meanwhile, the same columns are drawn
+            // again on the next refresh, from samples it has not reached yet
+            const int64 samplesWrittenSince = processor->getDisplayBufferSamplesWritten(channel, displayLevel) - samplesWrittenBefore;
 
-                        if (sample_min>sample_current)
-                        {
-                            sample_min=sample_current;
-                        }
+            if (samplesWrittenSince > displayBufferSize - nSamples - (int) ratio - 2)
+            {
+                sbi = lastScreenBufferIndex[channel];
+                dbi = processor->getDisplayBufferIndex(channel, displayLevel);
+            }
 
-                        if (sample_max<sample_current)
-                        {
-                            sample_max=sample_current;
-                        }
-                       
+            // update values after we're done
+            screenBufferIndex.set(channel, sbi);
+            displayBufferIndex.set(channel, dbi);
+        }
+
+    }
+
+}
+
+void LfpDisplayCanvas::decimateScreenColumns(int channel, int sbi, int numColumns, int& dbi, float& subSampleOffset,
+                                             float ratio, bool write)
+{
+    const int maxSamples = lfpDisplay->getWidth() - leftmargin;
+
+    // the samples of each pixel are only needed by the supersampled plotter
+    const bool keepSamplesPerPixel = getDrawMethodState();
+
+    // at level 0 both are the samples themselves
+    const float* minima = processor->getDisplayBufferMinima(channel, displayLevel);
+    const float* maxima = processor->getDisplayBufferMaxima(channel, displayLevel);
+    float* values = screenBuffer->getWritePointer(channel);
+    float* means = screenBufferMean->getWritePointer(channel);
+    float* mins = screenBufferMin->getWritePointer(channel);
+    float* maxs = screenBufferMax->getWritePointer(channel);
+
+    for (int i = 0; i < numColumns; i++)
+    {
+        if (write)
+        {
+            if (sbi >= maxSamples)
+                sbi = 0;
+
+            float alpha = (float) subSampleOffset;
+            float invAlpha = 1.0f - alpha;
+
+            dbi %= displayBufferSize; // just to be sure
+            const int nextPos = (dbi + 1) % displayBufferSize; //  position next to displayBufferIndex in display buffer to copy from
+
+            int nextpix = (dbi +(int)ratio +1) % (displayBufferSize+1); //  position to next pixels index
+            
+            if (nextpix <= dbi) { // at the end of the displaybuffer, this can occur and it causes the display to miss one pixel woth of sample - this circumvents that
+            //    std::cout << "np " ;
+                nextpix=dbi;
+            }
+
+            // the min, max and sum of all samples in current pixel, in one pass
+            const int c = nextpix - dbi;
+            float sample_min, sample_max, sample_sum;
+            scanPixelSamples(minima + dbi, c, sample_min, sample_max, sample_sum);
+
+            if (maxima != minima)
+            {
+                // the coarser levels keep the extremes of each run, the mean being taken halfway
+                float unusedMin, maxSum;
+                scanPixelSamples(maxima + dbi, c, unusedMin, sample_max, maxSum);
+                sample_sum = 0.5f * (sample_sum + maxSum);
+            }
+
+            if (channel == nChans) // update event channel
+            {
+                values[sbi] = sample_max;
+                means[sbi] = 0;
+                mins[sbi] = 0;
+                maxs[sbi] = 0;
+            }
+            else // update continuous data channels
+            {
+                // interpolate between two samples with invAlpha and alpha
+                values[sbi] = 0.5f * (minima[dbi] + maxima[dbi]) * invAlpha
+                              + 0.5f * (minima[nextPos] + maxima[nextPos]) * alpha;
+                means[sbi] = (c > 0) ? sample_sum / c : 0;
+                mins[sbi] = sample_min;
+                maxs[sbi] = sample_max;
+
+                // similarly, for each pixel on the screen, the supersampled plotter wants the values so it can draw a histogram later
+                // only up to MAX_N_SAMP_PER_PIXEL of them are kept, evenly spread over the pixel and including the first and last
+                if (keepSamplesPerPixel && channel < numPixelChannels && sbi < numPixelColumns)
+                {
+                    const int pixel = channel * numPixelColumns + sbi;
+                    float* kept = samplesPerPixel + pixel * MAX_N_SAMP_PER_PIXEL;
+
+                    if (c <= MAX_N_SAMP_PER_PIXEL)
+                    {
+                        // alternately the minimum and the maximum of the entries of a coarser level
+                        for (int k = 0; k < c; k++)
+                            kept[k] = ((k & 1) ? maxima : minima)[dbi + k];
+
+                        sampleCountPerPixel[pixel] = (uint8) jmax(0, c);
                     }
-                    
-                    // update event channel
-                    if (channel == nChans)
+                    else
                     {
-                        screenBuffer->setSample(channel, sbi, sample_max);
+                        for (int k = 0; k < MAX_N_SAMP_PER_PIXEL; k++)
+                            kept[k] = ((k & 1) ? maxima : minima)[dbi + k * (c - 1) / (MAX_N_SAMP_PER_PIXEL - 1)];
+
+                        sampleCountPerPixel[pixel] = MAX_N_SAMP_PER_PIXEL;
                     }
-                    
-                    // similarly, for each pixel on the screen, we want a list of all values so we can draw a histogram later
-                    // for simplicity, we'll just do this as 2d array, samplesPerPixel[px][samples]
-                    // with an additional array sampleCountPerPixel[px] that holds the N samples per pixel
-                    if (channel < nChans) // we're looping over one 'extra' channel for events above, so make sure not to loop over that one here
-                        {
-                            int c = 0;
-                            for (int j = dbi; j < nextpix && c < MAX_N_SAMP_PER_PIXEL; j++)
-                            {
-                                float sample_current = displayBuffer->getSample(channel, j);
-                                samplesPerPixel[channel][sbi][c]=sample_current;
-                                c++;
-                            }
-                            if (c>0){
-                                sampleCountPerPixel[sbi]=c-1; // save count of samples for this pixel
-                            }else{
-                                sampleCountPerPixel[sbi]=0;
-                            }
-                            sample_mean = sample_mean/c;
-                            screenBufferMean->addSample(channel, sbi, sample_mean*gain);
-                            
-                            screenBufferMin->addSample(channel, sbi, sample_min*gain);
-                            screenBufferMax->addSample(channel, sbi, sample_max*gain);
-                        }
-                    sbi++;
-                }
-            
-                subSampleOffset += ratio;
-                
-                while (subSampleOffset >= 1.0)
-                {
-                    if (++dbi > displayBufferSize)
-                        dbi = 0;
-                    
-                    nextPos = (dbi + 1) % displayBufferSize;
-                    subSampleOffset -= 1.0;
                 }
-                
             }
+            sbi++;
+        }
+
+        subSampleOffset += ratio;
+        
+        while (subSampleOffset >= 1.0)
+        {
+            if (++dbi > displayBufferSize)
+                dbi = 0;
             
-            // update values after we're done
-            screenBufferIndex.set(channel, sbi);
-            displayBufferIndex.set(channel, dbi);
+            subSampleOffset -= 1.0;
         }
+    }
+}
+
+void LfpDisplayCanvas::catchUpScreenColumns(int channel, int sbi, int dbi, int nSamples, float ratio)
+{
+    const int maxSamples = lfpDisplay->getWidth() - leftmargin;
+
+    if (maxSamples <= 0 || ratio <= 0)
+        return;
+
+    // the oldest samples are left alone, as the processor may be writing over them
+    const int available = displayBufferSize - nSamples - (int) ratio - 2;
+    const int numColumns = jlimit(0, maxSamples, (int) (available / ratio));
+
+    // columns left of the sweep are from this pass, the others from the previous one
+    int firstColumn = sbi - numColumns;
+
+    if (firstColumn < 0)
+        firstColumn += maxSamples;
 
+    for (int i = 0; i < maxSamples - numColumns; i++)
+    {
+        const int column = (sbi + i) % maxSamples;
+
+        screenBuffer->setSample(channel, column, 0);
+        screenBufferMean->setSample(channel, column, 0);
+        screenBufferMin->setSample(channel, column, 0);
+        screenBufferMax->setSample(channel, column, 0);
+
+        if (channel < numPixelChannels && column < numPixelColumns)
+            sampleCountPerPixel[channel * numPixelColumns + column] = 0;
     }
 
+    int from = (dbi - (int) (numColumns * ratio)) % displayBufferSize;
+
+    if (from < 0)
+        from += displayBufferSize;
+
+    float subSampleOffset = 0.0;
+    decimateScreenColumns(channel, firstColumn, numColumns, from, subSampleOffset, ratio, true);
 }
 
 const float LfpDisplayCanvas::getXCoord(int chan, int samp)
@@ -546,13 +763,19 @@ const float LfpDisplayCanvas::getYCoordMax(int chan, int samp)
     return *screenBufferMax->getReadPointer(chan, samp);
 }
 
-std::array<float, MAX_N_SAMP_PER_PIXEL> LfpDisplayCanvas::getSamplesPerPixel(int chan, int px)
+const float* LfpDisplayCanvas::getSamplesPerPixel(int chan, int px)
 {
-    return samplesPerPixel[chan][px];
+    if (chan >= numPixelChannels || px >= numPixelColumns)
+        return samplesPerPixel;
+
+    return samplesPerPixel + (chan * numPixelColumns + px) * MAX_N_SAMP_PER_PIXEL;
 }
-const int LfpDisplayCanvas::getSampleCountPerPixel(int px)
+const int LfpDisplayCanvas::getSampleCountPerPixel(int chan, int px)
 {
-    return sampleCountPerPixel[px];
+    if (chan >= numPixelChannels || px >= numPixelColumns)
+        return 0;
+
+    return sampleCountPerPixel[chan * numPixelColumns + px];
 }
 
 float LfpDisplayCanvas::getMean(int chan)
@@ -603,7 +826,28 @@ bool LfpDisplayCanvas::getDisplaySpikeRasterizerState()
 bool LfpDisplayCanvas::getDrawMethodState()
 {
     
-    return options->getDrawMethodState(); //drawMethodButton->getToggleState();
+    return options->getDrawMethodState() && !detailReduced; //drawMethodButton->getToggleState();
+}
+
+void LfpDisplayCanvas::setDetailReduced(bool isReduced)
+{
+    detailReduced = isReduced;
+
+    lfpDisplay->setDrawMethod(getDrawMethodState());
+    fullredraw = true;
+}
+
+int64 LfpDisplayCanvas::getMemoryFootprint() const
+{
+    const int64 numPixels = jmax(1, numPixelChannels * numPixelColumns);
+
+    return MemoryFootprint::ofBuffer(screenBuffer.get())
+        + MemoryFootprint::ofBuffer(screenBufferMin.get())
+        + MemoryFootprint::ofBuffer(screenBufferMean.get())
+        + MemoryFootprint::ofBuffer(screenBufferMax.get())
+        + MemoryFootprint::ofBlock(samplesPerPixel, numPixels * MAX_N_SAMP_PER_PIXEL)
+        + MemoryFootprint::ofBlock(sampleCountPerPixel, numPixels)
+        + spectrogram->getMemoryFootprint();
 }
 
 int LfpDisplayCanvas::getChannelSampleRate(int channel)
@@ -615,6 +859,9 @@ void LfpDisplayCanvas::setDrawableSampleRate(float samplerate)
 {
 //    std::cout << "setting the drawable sample rate in the canvas" << std::endl;
     lfpDisplay->setDisplayedSampleRate(samplerate);
+
+    if (spectrogramMode && animating)
+        updateSpectrogram();
 }
 
 void LfpDisplayCanvas::setDrawableSubprocessor(int idx)
@@ -1071,6 +1318,26 @@ LfpDisplayOptions::LfpDisplayOptions(LfpDisplayCanvas* canvas_, LfpTimescale* ti
     drawMethodButton->setToggleState(false, sendNotification);
     addAndMakeVisible(drawMethodButton);
     
+    //button for drawing the traces with OpenGL rather than into the software bitmap
+    openGLButton = new UtilityButton("OpenGL", Font("Small Text", 13, Font::plain));
+    openGLButton->setRadius(5.0f);
+    openGLButton->setEnabledState(true);
+    openGLButton->setCorners(true, true, true, true);
+    openGLButton->addListener(this);
+    openGLButton->setClickingTogglesState(true);
+    openGLButton->setToggleState(false, dontSendNotification);
+    addAndMakeVisible(openGLButton);
+    
+    //button for showing the spectrograms of the channels instead of their traces
+    spectrogramButton = new UtilityButton("Spectrogram", Font("Small Text", 13, Font::plain));
+    spectrogramButton->setRadius(5.0f);
+    spectrogramButton->setEnabledState(true);
+    spectrogramButton->setCorners(true, true, true, true);
+    spectrogramButton->addListener(this);
+    spectrogramButton->setClickingTogglesState(true);
+    spectrogramButton->setToggleState(false, dontSendNotification);
+    addAndMakeVisible(spectrogramButton);
+    
     // two sliders for the two histogram components of the supersampled plotting mode
     // todo: rename these
     brightnessSliderA = new Slider();
@@ -1171,6 +1438,8 @@ void LfpDisplayOptions::resized()
 
     invertInputButton->setBounds(35,getHeight()-190,100,22);
     drawMethodButton->setBounds(35,getHeight()-160,100,22);
+    openGLButton->setBounds(35,getHeight()-132,100,22);
+    spectrogramButton->setBounds(170,getHeight()-132,100,22);
 
     pauseButton->setBounds(450,getHeight()-50,50,44);
     
@@ -1400,10 +1669,20 @@ void LfpDisplayOptions::buttonClicked(Button* b)
     }
     if (b == drawMethodButton)
     {
-        lfpDisplay->setDrawMethod(b->getToggleState()); // this should be done the same way as drawClipWarning - or the other way around.
+        lfpDisplay->setDrawMethod(canvas->getDrawMethodState()); // this should be done the same way as drawClipWarning - or the other way around.
         
         return;
     }
+    if (b == openGLButton)
+    {
+        lfpDisplay->setOpenGLRendering(b->getToggleState());
+        return;
+    }
+    if (b == spectrogramButton)
+    {
+        canvas->setSpectrogramMode(b->getToggleState());
+        return;
+    }
     if (b == drawClipWarningButton)
     {
         canvas->drawClipWarning = b->getToggleState();
@@ -1842,6 +2121,8 @@ void LfpDisplayOptions::saveParameters(XmlElement* xml)
     xmlNode->setAttribute("colorGrouping",colorGroupingSelection->getSelectedId());
     xmlNode->setAttribute("isInverted",invertInputButton->getToggleState());
     xmlNode->setAttribute("drawMethod",drawMethodButton->getToggleState());
+    xmlNode->setAttribute("openGL",openGLButton->getToggleState());
+    xmlNode->setAttribute("spectrogram",spectrogramButton->getToggleState());
 
     int eventButtonState = 0;
 
@@ -1917,6 +2198,10 @@ void LfpDisplayOptions::loadParameters(XmlElement* xml)
 
             drawMethodButton->setToggleState(xmlNode->getBoolAttribute("drawMethod", true), sendNotification);
 
+            openGLButton->setToggleState(xmlNode->getBoolAttribute("openGL", false), sendNotification);
+
+            spectrogramButton->setToggleState(xmlNode->getBoolAttribute("spectrogram", false), sendNotification);
+
             canvas->viewport->setViewPosition(xmlNode->getIntAttribute("ScrollX"),
                                       xmlNode->getIntAttribute("ScrollY"));
 
@@ -2136,10 +2421,20 @@ LfpDisplay::LfpDisplay(LfpDisplayCanvas* c, Viewport* v)
     , channelsReversed(false)
     , displaySkipAmt(0)
     , m_SpikeRasterPlottingFlag(false)
+    , drewWithOpenGL(false)
+    , spectrogramColumnsPainted(0)
+    , paintPool(jmax(1, getNumPaintThreads() - 1))
 {
+    // one job is drawn by the message thread itself
+    for (int i = 0; i < getNumPaintThreads(); i++)
+        paintJobs.add(new PaintJob(this));
+
     perPixelPlotter = new PerPixelBitmapPlotter(this);
     supersampledPlotter = new SupersampledBitmapPlotter(this);
     
+    glRenderer = new LfpOpenGLRenderer(this, canvas, viewport, openGLContext);
+    openGLContext.setRenderer(glRenderer);
+    
 //    colorScheme = new LfpDefaultColourScheme();
     colourSchemeList.add(new LfpDefaultColourScheme(this, canvas));
     colourSchemeList.add(new LfpMonochromaticColourScheme(this, canvas));
@@ -2195,6 +2490,8 @@ LfpDisplay::LfpDisplay(LfpDisplayCanvas* c, Viewport* v)
 LfpDisplay::~LfpDisplay()
 {
 //    deleteAllChildren();
+    paintPool.removeAllJobs(true, -1);
+    openGLContext.detach();
 }
 
 
@@ -2377,10 +2674,37 @@ void LfpDisplay::resized()
 void LfpDisplay::paint(Graphics& g)
 {
 
-    g.drawImageAt(lfpChannelBitmap, canvas->leftmargin,0);
+    if (canvas->getSpectrogramMode())
+    {
+        paintSpectrograms(g);
+        return;
+    }
+
+    if (!drewWithOpenGL) // otherwise the traces are already drawn below this component
+        g.drawImageAt(lfpChannelBitmap, canvas->leftmargin,0);
     
 }
 
+void LfpDisplay::paintSpectrograms(Graphics& g)
+{
+    g.fillAll(backgroundColour);
+
+    const Rectangle<int> clip = g.getClipBounds();
+
+    for (int i = 0; i < drawableChannels.size(); i++)
+    {
+        LfpChannelDisplay* disp = drawableChannels[i].channel;
+
+        if (disp->getHidden())
+            continue;
+
+        const Rectangle<int> area(canvas->leftmargin, disp->getY(), getWidth() - canvas->leftmargin, disp->getHeight());
+
+        if (area.intersects(clip))
+            canvas->getSpectrogram()->drawChannel(g, disp->getChannelNumber(), area, canvas->timebase);
+    }
+}
+
 
 void LfpDisplay::refresh()
 {
@@ -2394,22 +2718,72 @@ void LfpDisplay::refresh()
     
     int topBorder = viewport->getViewPositionY();
     int bottomBorder = viewport->getViewHeight() + topBorder;
+    
+    // switching between the OpenGL and software paths leaves the other one's drawing out of date
+    const bool drawWithOpenGL = isDrawingWithOpenGL();
+    
+    if (drawWithOpenGL != drewWithOpenGL)
+    {
+        drewWithOpenGL = drawWithOpenGL;
+        canvas->fullredraw = true;
+    }
+    
+    if (canvas->getSpectrogramMode())
+    {
+        // only the channels in view are computed, and the display repainted once new columns are in
+        LfpSpectrogram* spectrogram = canvas->getSpectrogram();
+
+        for (int i = 0; i < numChans; i++)
+            spectrogram->setChannelInView(i, isChannelInView(i, 0));
+
+        const int columnsComputed = spectrogram->getColumnsComputed();
+
+        if (canvas->fullredraw || columnsComputed != spectrogramColumnsPainted)
+        {
+            spectrogramColumnsPainted = columnsComputed;
+            repaint(0, topBorder, getWidth(), bottomBorder - topBorder);
+        }
+
+        canvas->fullredraw = false;
+        return;
+    }
+    
+    if (drawWithOpenGL)
+    {
+        glRenderer->update(canvas->fullredraw);
+        
+        if (canvas->fullredraw)
+            repaint(0,topBorder,getWidth(),bottomBorder-topBorder); // the channel infos
+        else if (fillfrom == 0 && singleChan != -1)
+            channelInfo[singleChan]->repaint();
+        
+        canvas->fullredraw = false;
+        return;
+    }
 
     // clear appropriate section of the bitmap --
     // we need to do this before each channel draws its new section of data into lfpChannelBitmap
-    Graphics gLfpChannelBitmap(lfpChannelBitmap);
-    gLfpChannelBitmap.setColour(backgroundColour); //background color
-
-    if (canvas->fullredraw)
     {
-        gLfpChannelBitmap.fillRect(0,0, getWidth(), getHeight());
-    } else {
+        Graphics gLfpChannelBitmap(lfpChannelBitmap);
         gLfpChannelBitmap.setColour(backgroundColour); //background color
 
-        gLfpChannelBitmap.fillRect(fillfrom,0, (fillto-fillfrom)+1, getHeight());
-    };
+        if (canvas->fullredraw)
+        {
+            gLfpChannelBitmap.fillRect(0,0, getWidth(), getHeight());
+        } else {
+            gLfpChannelBitmap.setColour(backgroundColour); //background color
+
+            gLfpChannelBitmap.fillRect(fillfrom,0, (fillto-fillfrom)+1, getHeight());
+        };
+    }
     
     
+    // the visible channels are drawn column tile by column tile, on the paint pool
+    channelsToPaint.clearQuick();
+    
+    int paintFrom = lfpChannelBitmap.getWidth();
+    int paintTo = 0;
+    
     for (int i = 0; i < numChans; i++)
 //    for (int i = 0; i < drawableChannels.size(); ++i)
     {
@@ -2420,28 +2794,37 @@ void LfpDisplay::refresh()
         if ((topBorder <= componentBottom && bottomBorder >= componentTop)) // only draw things that are visible
         {
             if (canvas->fullredraw)
-            {
                 channels[i]->fullredraw = true;
-                
-                channels[i]->pxPaint();
-                channelInfo[i]->repaint();
-                
-            }
-            else
-            {
-                 channels[i]->pxPaint(); // draws to lfpChannelBitmap
-                
-                 // it's not clear why, but apparently because the pxPaint() in a child component of LfpDisplay, we also need to issue repaint() calls for each channel, even though there's nothin to repaint there. Otherwise, the repaint call in LfpDisplay::refresh(), a few lines down, lags behind the update line by ~60 px. This could ahev something to do with teh reopaint message passing in juce. In any case, this seemingly redundant repaint here seems to fix the issue.
-                
-                 // we redraw from 0 to +2 (px) relative to the real redraw window, the +1 draws the vertical update line
-                 channels[i]->repaint(fillfrom, 0, (fillto-fillfrom)+2, channels[i]->getHeight());
-                
-                
-            }
-            //std::cout << i << std::endl;
+            
+            int columnFrom, columnTo;
+            channels[i]->preparePxPaint(columnFrom, columnTo);
+            
+            paintFrom = jmin(paintFrom, columnFrom);
+            paintTo = jmax(paintTo, columnTo);
+            
+            channelsToPaint.add(i);
         }
 
     }
+    
+    paintChannelColumns(paintFrom, paintTo); // draws to lfpChannelBitmap
+    
+    for (int n = 0; n < channelsToPaint.size(); n++)
+    {
+        const int i = channelsToPaint[n];
+        
+        if (canvas->fullredraw)
+        {
+            channelInfo[i]->repaint();
+        }
+        else
+        {
+             // it's not clear why, but apparently because the pxPaint() in a child component of LfpDisplay, we also need to issue repaint() calls for each channel, even though there's nothin to repaint there. Otherwise, the repaint call in LfpDisplay::refresh(), a few lines down, lags behind the update line by ~60 px. This could ahev something to do with teh reopaint message passing in juce. In any case, this seemingly redundant repaint here seems to fix the issue.
+            
+             // we redraw from 0 to +2 (px) relative to the real redraw window, the +1 draws the vertical update line
+             channels[i]->repaint(fillfrom, 0, (fillto-fillfrom)+2, channels[i]->getHeight());
+        }
+    }
 
     if (fillfrom == 0 && singleChan != -1)
     {
@@ -2460,11 +2843,50 @@ void LfpDisplay::refresh()
     
 }
 
-
-
-void LfpDisplay::setRange(float r, DataChannel::DataChannelTypes type)
+void LfpDisplay::paintChannelColumns(int from, int to)
 {
-    range[type] = r;
+    if (from >= to || channelsToPaint.size() == 0)
+        return;
+    
+    const int nJobs = jlimit(1, paintJobs.size(), (to - from) / minColumnsPerPaintJob);
+    
+    for (int j = 0; j < nJobs; j++)
+    {
+        PaintJob* job = paintJobs[j];
+        job->xFrom = from + int(int64(to - from) * j / nJobs);
+        job->xTo = from + int(int64(to - from) * (j + 1) / nJobs);
+        
+        if (j > 0)
+            paintPool.addJob(job, false);
+    }
+    
+    paintJobs[0]->runJob();
+    
+    for (int j = 1; j < nJobs; j++)
+        paintPool.waitForJobToFinish(paintJobs[j], -1);
+}
+
+LfpDisplay::PaintJob::PaintJob(LfpDisplay* display_)
+    : ThreadPoolJob("LFP display paint")
+    , display(display_)
+    , xFrom(0)
+    , xTo(0)
+{
+}
+
+ThreadPoolJob::JobStatus LfpDisplay::PaintJob::runJob()
+{
+    for (int n = 0; n < display->channelsToPaint.size(); n++)
+        display->channels[display->channelsToPaint[n]]->pxPaint(xFrom, xTo);
+    
+    return jobHasFinished;
+}
+
+
+
+void LfpDisplay::setRange(float r, DataChannel::DataChannelTypes type)
+{
+    range[type] = r;
     
     if (channels.size() > 0)
     {
@@ -2953,6 +3375,54 @@ LfpBitmapPlotter * const LfpDisplay::getPlotterPtr() const
     return plotter;
 }
 
+void LfpDisplay::setOpenGLRendering(bool isEnabled)
+{
+    if (isEnabled == openGLContext.isAttached())
+        return;
+    
+    if (isEnabled)
+        openGLContext.attachTo(*viewport);
+    else
+        openGLContext.detach();
+    
+    canvas->redraw();
+}
+
+bool LfpDisplay::getOpenGLRendering()
+{
+    return openGLContext.isAttached();
+}
+
+bool LfpDisplay::isDrawingWithOpenGL()
+{
+    return openGLContext.isAttached()
+        && !glRenderer->hasFailed()
+        && !canvas->getDrawMethodState()
+        && !getSpikeRasterPlotting()
+        && !canvas->drawClipWarning
+        && !canvas->drawSaturationWarning
+        && !canvas->getSpectrogramMode();
+}
+
+bool LfpDisplay::isChannelInView(int chan, int margin)
+{
+    if (chan < 0 || chan >= channels.size()) // the event channel is drawn over every channel
+        return true;
+
+    LfpChannelDisplay* channel = channels[chan];
+
+    if (channel->getParentComponent() != this) // not in drawableChannels
+        return false;
+
+    int topBorder = viewport->getViewPositionY() - margin;
+    int bottomBorder = viewport->getViewHeight() + viewport->getViewPositionY() + margin;
+
+    int componentTop = channel->getY();
+    int componentBottom = channel->getHeight() + componentTop;
+
+    return topBorder <= componentBottom && bottomBorder >= componentTop;
+}
+
 bool LfpDisplay::getSingleChannelState()
 {
     //if (singleChan < 0) return false;
@@ -3078,6 +3548,8 @@ LfpChannelDisplay::LfpChannelDisplay(LfpDisplayCanvas* c, LfpDisplay* d, LfpDisp
     , canBeInverted(true)
     , drawMethod(false)
     , isHidden(false)
+    , paintFrom(0)
+    , paintTo(0)
 {
 
 
@@ -3133,6 +3605,39 @@ void LfpChannelDisplay::setHidden(bool isHidden_)
 }
 
 void LfpChannelDisplay::pxPaint()
+{
+    int columnFrom, columnTo;
+    preparePxPaint(columnFrom, columnTo);
+    pxPaint(columnFrom, columnTo);
+}
+
+void LfpChannelDisplay::preparePxPaint(int& columnFrom, int& columnTo)
+{
+    int stepSize = 1;
+    
+    int ifrom = canvas->lastScreenBufferIndex[chan] - 1; // need to start drawing a bit before the actual redraw window for the interpolated line to join correctly
+    
+    if (ifrom < 0)
+        ifrom = 0;
+    
+    int ito = canvas->screenBufferIndex[chan] +0;
+    
+    if (fullredraw)
+    {
+        ifrom = 0; //canvas->leftmargin;
+        ito = getWidth()-stepSize;
+        fullredraw = false;
+    }
+    
+    paintFrom = ifrom;
+    paintTo = ito;
+    
+    // including the most recent drawn sample position
+    columnFrom = jmin(ifrom, canvas->screenBufferIndex[chan]+1);
+    columnTo = jmax(ito, canvas->screenBufferIndex[chan]+2);
+}
+
+void LfpChannelDisplay::pxPaint(int xFrom, int xTo)
 {
     if (!isEnabled) return; // return early if THIS display is not enabled
     
@@ -3155,9 +3660,11 @@ void LfpChannelDisplay::pxPaint()
     if (jto_wholechannel >= display->lfpChannelBitmap.getHeight()) {jto_wholechannel=display->lfpChannelBitmap.getHeight()-1;};
     
     // draw most recent drawn sample position
-    if (canvas->screenBufferIndex[chan]+1 <= display->lfpChannelBitmap.getWidth())
+    const int markerColumn = canvas->screenBufferIndex[chan]+1;
+    
+    if (markerColumn >= xFrom && markerColumn < xTo && markerColumn < display->lfpChannelBitmap.getWidth())
         for (int k=jfrom_wholechannel; k<=jto_wholechannel; k+=2) // draw line
-            bdLfpChannelBitmap.setPixelColour(canvas->screenBufferIndex[chan]+1,k, Colours::yellow);
+            bdLfpChannelBitmap.setPixelColour(markerColumn,k, Colours::yellow);
     
     
     bool clipWarningHi =false; // keep track if something clipped in the display, so we can draw warnings after the data pixels are done
@@ -3176,19 +3683,8 @@ void LfpChannelDisplay::pxPaint()
     int from = 0; // for vertical line drawing in the LFP data
     int to = 0;
     
-    int ifrom = canvas->lastScreenBufferIndex[chan] - 1; // need to start drawing a bit before the actual redraw window for the interpolated line to join correctly
-    
-    if (ifrom < 0)
-        ifrom = 0;
-    
-    int ito = canvas->screenBufferIndex[chan] +0;
-    
-    if (fullredraw)
-    {
-        ifrom = 0; //canvas->leftmargin;
-        ito = getWidth()-stepSize;
-        fullredraw = false;
-    }
+    const int ifrom = jmax(paintFrom, xFrom);
+    const int ito = jmin(paintTo, xTo);
     
     bool drawWithOffsetCorrection = display->getMedianOffsetPlotting();
     
@@ -3314,7 +3810,7 @@ void LfpChannelDisplay::pxPaint()
                 plotterInfo.lineColourDark = lineColourDark;
                 plotterInfo.range = range;
                 plotterInfo.channelHeightFloat = channelHeightFloat;
-                plotterInfo.sampleCountPerPixel = canvas->getSampleCountPerPixel(i);
+                plotterInfo.sampleCountPerPixel = canvas->getSampleCountPerPixel(chan, i);
                 plotterInfo.samplesPerPixel = canvas->getSamplesPerPixel(chan, i);
                 plotterInfo.histogramParameterA = canvas->histogramParameterA;
                 plotterInfo.samplerange = samplerange;
@@ -3411,6 +3907,50 @@ void LfpChannelDisplay::pxPaint()
 
 }
 
+void LfpChannelDisplay::glPaint(LfpGLVertex* columns, int stride, int from, int to)
+{
+    const float x = canvas->leftmargin + 0.5f; // through the middle of the pixels
+    
+    if (!isEnabled)
+    {
+        for (int i = from; i < to; i++)
+        {
+            columns[i*stride].set(x + i, 0, Colours::transparentBlack);
+            columns[i*stride + 1] = columns[i*stride];
+        }
+        
+        return;
+    }
+    
+    // the same range as pxPaint and PerPixelBitmapPlotter, the second vertex just below the last pixel
+    int lm = channelHeightFloat*canvas->channelOverlapFactor;
+    if (lm>0)
+        lm=-lm;
+    
+    double mean = 0;
+    
+    if (display->getMedianOffsetPlotting())
+        mean = canvas->getMean(chan)/range*channelHeightFloat;
+    
+    const int top = getY() + getHeight()/2;
+    const int maxY = display->getHeight() - 1;
+    
+    for (int i = from; i < to; i++)
+    {
+        double a = canvas->getYCoordMax(chan, i)/range*channelHeightFloat - mean;
+        double b = canvas->getYCoordMin(chan, i)/range*channelHeightFloat - mean;
+        
+        int jfrom = jlimit(lm, -lm, (int) jmin(a, b)) + top;
+        int jto = jlimit(lm, -lm, (int) jmax(a, b)) + top;
+        
+        if (jfrom<0) {jfrom=0;};
+        if (jto>maxY) {jto=maxY;};
+        
+        columns[i*stride].set(x + i, jfrom, lineColour);
+        columns[i*stride + 1].set(x + i, jto + 1, lineColour);
+    }
+}
+
 void LfpChannelDisplay::paint(Graphics& g) {}
 
 
@@ -3935,6 +4475,633 @@ void LfpViewport::visibleAreaChanged(const Rectangle<int>& newVisibleArea)
 
 
 
+#pragma mark - LfpOpenGLRenderer -
+
+void LfpGLVertex::set(float x_, float y_, Colour c)
+{
+    x = x_;
+    y = y_;
+    colour[0] = c.getRed();
+    colour[1] = c.getGreen();
+    colour[2] = c.getBlue();
+    colour[3] = c.getAlpha();
+}
+
+LfpOpenGLRenderer::LfpOpenGLRenderer(LfpDisplay* display_, LfpDisplayCanvas* canvas_, Viewport* viewport_, OpenGLContext& context_)
+    : display(display_)
+    , canvas(canvas_)
+    , viewport(viewport_)
+    , context(context_)
+    , vertexBuffer(0)
+    , numBufferVertices(0)
+    , numVertices(0)
+    , numAllocatedVertices(0)
+    , numColumns(0)
+    , eventsStart(0)
+    , overlayStart(0)
+    , cursorsStart(0)
+    , numUnderlayVertices(0)
+    , numCursorVertices(0)
+    , uploadAll(true)
+    , dirtyFrom(0)
+    , dirtyTo(0)
+{
+}
+
+LfpOpenGLRenderer::~LfpOpenGLRenderer()
+{
+}
+
+bool LfpOpenGLRenderer::hasFailed() const
+{
+    return failed.get() != 0;
+}
+
+void LfpOpenGLRenderer::layoutSlots()
+{
+    int top = viewport->getViewPositionY();
+    int bottom = viewport->getViewHeight() + top;
+    
+    // the channels pxPaint would draw
+    slots.clearQuick();
+    
+    for (int i = 0; i < display->channels.size(); i++)
+    {
+        LfpChannelDisplay* channel = display->channels[i];
+        
+        if (channel->getEnabledState() && top <= channel->getBottom() && bottom >= channel->getY())
+            slots.add(channel);
+    }
+    
+    numColumns = jlimit(0, MAX_N_SAMP, display->getWidth());
+    
+    eventsStart = numColumns * slots.size() * 2;
+    overlayStart = eventsStart + numColumns * 16;
+    cursorsStart = overlayStart + slots.size() * 12;
+    numUnderlayVertices = slots.size() * 12;
+    numCursorVertices = slots.size() * 2;
+    numVertices = cursorsStart + numCursorVertices;
+    
+    if (numVertices > numAllocatedVertices)
+    {
+        vertices.malloc(numVertices);
+        numAllocatedVertices = numVertices;
+    }
+    
+    viewArea = Rectangle<int>(viewport->getViewPositionX(), top, viewport->getWidth(), viewport->getHeight());
+    backgroundColour = display->backgroundColour;
+    uploadAll = true;
+}
+
+void LfpOpenGLRenderer::writeEventColumns(int from, int to)
+{
+    const int eventChannel = canvas->getNumChannels(); // the last channel of the screen buffer
+    const float top = viewArea.getY();
+    const float bottom = viewArea.getBottom();
+    
+    for (int i = from; i < to; i++)
+    {
+        LfpGLVertex* v = vertices + eventsStart + i*16;
+        const float x = canvas->leftmargin + i + 0.5f;
+        const int rawEventState = canvas->getYCoord(eventChannel, i);
+        
+        for (int ev_ch = 0; ev_ch < 8; ev_ch++)
+        {
+            if (slots.size() > 0 && display->getEventDisplayState(ev_ch) && (rawEventState & (1 << ev_ch)))
+            {
+                // blending at 0.3 like the interpolated colour of pxPaint
+                Colour c = display->channelColours[ev_ch*2].withAlpha(0.3f);
+                
+                v[ev_ch*2].set(x, top, c);
+                v[ev_ch*2 + 1].set(x, bottom, c);
+            }
+            else
+            {
+                v[ev_ch*2].set(x, 0, Colours::transparentBlack);
+                v[ev_ch*2 + 1] = v[ev_ch*2];
+            }
+        }
+    }
+}
+
+void LfpOpenGLRenderer::writeOverlay()
+{
+    const float left = canvas->leftmargin;
+    const float right = left + numColumns;
+    
+    for (int s = 0; s < slots.size(); s++)
+    {
+        LfpChannelDisplay* channel = slots[s];
+        LfpGLVertex* v = vertices + overlayStart + s*12;
+        
+        const int center = channel->getY() + channel->getHeight()/2;
+        const int channelHeight = channel->getChannelHeight();
+        
+        // zero line, then the range markers of a selected channel
+        v[0].set(left, center + 0.5f, Colour(50,50,50));
+        v[1].set(right, center + 0.5f, Colour(50,50,50));
+        
+        int start = center - channelHeight/2;
+        int jump = channelHeight/4;
+        
+        for (int k = 0; k <= 4; k++)
+        {
+            if (channel->getSelected())
+            {
+                v[2 + k*2].set(left, start + k*jump + 0.5f, Colour(80,80,80));
+                v[3 + k*2].set(right, start + k*jump + 0.5f, Colour(80,80,80));
+            }
+            else
+            {
+                v[2 + k*2].set(left, 0, Colours::transparentBlack);
+                v[3 + k*2] = v[2 + k*2];
+            }
+        }
+        
+        // most recent drawn sample position
+        LfpGLVertex* cursor = vertices + cursorsStart + s*2;
+        const int column = canvas->screenBufferIndex[channel->getChannelNumber()] + 1;
+        
+        if (column < numColumns)
+        {
+            cursor[0].set(left + column + 0.5f, center - channelHeight/2 + 1, Colours::yellow);
+            cursor[1].set(left + column + 0.5f, center + channelHeight/2 + 1, Colours::yellow);
+        }
+        else
+        {
+            cursor[0].set(left, 0, Colours::transparentBlack);
+            cursor[1] = cursor[0];
+        }
+    }
+}
+
+void LfpOpenGLRenderer::update(bool fullRedraw)
+{
+    {
+        const TraceRecorder::ScopedTracedLock<CriticalSection> sl(lock, "Wait for LFP renderer");
+        
+        if (fullRedraw || numVertices == 0)
+        {
+            layoutSlots();
+            fullRedraw = true;
+        }
+        
+        int from = numColumns;
+        int to = 0;
+        
+        for (int s = 0; s < slots.size(); s++)
+        {
+            const int chan = slots[s]->getChannelNumber();
+            
+            // like pxPaint, starting a column early for the segments to join
+            int ifrom = fullRedraw ? 0 : jmax(0, canvas->lastScreenBufferIndex[chan] - 1);
+            int ito = fullRedraw ? numColumns : jmin(numColumns, canvas->screenBufferIndex[chan]);
+            
+            if (ifrom < ito)
+            {
+                slots[s]->glPaint(vertices + s*2, slots.size()*2, ifrom, ito);
+                
+                from = jmin(from, ifrom);
+                to = jmax(to, ito);
+            }
+        }
+        
+        if (fullRedraw)
+        {
+            from = 0;
+            to = numColumns;
+        }
+        
+        if (from < to)
+        {
+            writeEventColumns(from, to);
+            
+            dirtyFrom = (dirtyFrom < dirtyTo) ? jmin(dirtyFrom, from) : from;
+            dirtyTo = jmax(dirtyTo, to);
+        }
+        
+        writeOverlay();
+    }
+    
+    context.triggerRepaint();
+}
+
+void LfpOpenGLRenderer::newOpenGLContextCreated()
+{
+    const char* vertexShader =
+        "attribute vec2 position;\n"
+        "attribute vec4 colour;\n"
+        "uniform vec4 transform;\n"
+        "varying vec4 lineColour;\n"
+        "\n"
+        "void main()\n"
+        "{\n"
+        "    lineColour = colour;\n"
+        "    gl_Position = vec4 ((position - transform.xy) * transform.zw + vec2 (-1.0, 1.0), 0.0, 1.0);\n"
+        "}\n";
+    
+    const char* fragmentShader =
+        "varying " JUCE_LOWP " vec4 lineColour;\n"
+        "\n"
+        "void main()\n"
+        "{\n"
+        "    gl_FragColor = lineColour;\n"
+        "}\n";
+    
+    shader = new OpenGLShaderProgram(context);
+    
+    if (shader->addVertexShader(OpenGLHelpers::translateVertexShaderToV3(vertexShader))
+        && shader->addFragmentShader(OpenGLHelpers::translateFragmentShaderToV3(fragmentShader))
+        && shader->link())
+    {
+        positionAttribute = new OpenGLShaderProgram::Attribute(*shader, "position");
+        colourAttribute = new OpenGLShaderProgram::Attribute(*shader, "colour");
+        transformUniform = new OpenGLShaderProgram::Uniform(*shader, "transform");
+        
+        context.extensions.glGenBuffers(1, &vertexBuffer);
+        numBufferVertices = 0;
+        failed = 0;
+    }
+    else
+    {
+        std::cout << "LFP Viewer could not build its OpenGL shaders, drawing in software instead: "
+                  << shader->getLastError() << std::endl;
+        
+        shader = nullptr;
+        failed = 1;
+    }
+}
+
+void LfpOpenGLRenderer::renderOpenGL()
+{
+    int numTraceVertices, numEventVertices;
+    int firstEvent, firstOverlay, firstCursor, numUnderlay, numCursors;
+    Rectangle<int> area;
+    
+    {
+        const TraceRecorder::ScopedTracedLock<CriticalSection> sl(lock, "Wait for LFP renderer");
+        
+        OpenGLHelpers::clear(backgroundColour);
+        
+        if (shader == nullptr || numVertices == 0)
+            return;
+        
+        context.extensions.glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        
+        const int numSlots = slots.size();
+        
+        if (numVertices > numBufferVertices)
+        {
+            context.extensions.glBufferData(GL_ARRAY_BUFFER, numVertices * sizeof(LfpGLVertex), vertices, GL_DYNAMIC_DRAW);
+            numBufferVertices = numVertices;
+        }
+        else if (uploadAll)
+        {
+            context.extensions.glBufferSubData(GL_ARRAY_BUFFER, 0, numVertices * sizeof(LfpGLVertex), vertices);
+        }
+        else
+        {
+            // the new columns of every trace and of the events are two ranges
+            if (dirtyFrom < dirtyTo)
+            {
+                const int first = dirtyFrom * numSlots * 2;
+                const int count = (dirtyTo - dirtyFrom) * numSlots * 2;
+                
+                context.extensions.glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(LfpGLVertex),
+                                                   count * sizeof(LfpGLVertex), vertices + first);
+                
+                const int firstEventVertex = eventsStart + dirtyFrom * 16;
+                const int numEventColumnVertices = (dirtyTo - dirtyFrom) * 16;
+                
+                context.extensions.glBufferSubData(GL_ARRAY_BUFFER, firstEventVertex * sizeof(LfpGLVertex),
+                                                   numEventColumnVertices * sizeof(LfpGLVertex), vertices + firstEventVertex);
+            }
+            
+            context.extensions.glBufferSubData(GL_ARRAY_BUFFER, overlayStart * sizeof(LfpGLVertex),
+                                               (numVertices - overlayStart) * sizeof(LfpGLVertex), vertices + overlayStart);
+        }
+        
+        uploadAll = false;
+        dirtyFrom = dirtyTo = 0;
+        
+        numTraceVertices = numColumns * numSlots * 2;
+        numEventVertices = numColumns * 16;
+        firstEvent = eventsStart;
+        firstOverlay = overlayStart;
+        firstCursor = cursorsStart;
+        numUnderlay = numUnderlayVertices;
+        numCursors = numCursorVertices;
+        area = viewArea;
+    }
+    
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    
+    shader->use();
+    
+    // LfpDisplay pixels to clip coordinates, y pointing down
+    transformUniform->set((GLfloat) area.getX(), (GLfloat) area.getY(),
+                          2.0f / jmax(1, area.getWidth()), -2.0f / jmax(1, area.getHeight()));
+    
+    context.extensions.glVertexAttribPointer(positionAttribute->attributeID, 2, GL_FLOAT, GL_FALSE,
+                                             sizeof(LfpGLVertex), 0);
+    context.extensions.glEnableVertexAttribArray(positionAttribute->attributeID);
+    
+    context.extensions.glVertexAttribPointer(colourAttribute->attributeID, 4, GL_UNSIGNED_BYTE, GL_TRUE,
+                                             sizeof(LfpGLVertex), (GLvoid*) offsetof(LfpGLVertex, colour));
+    context.extensions.glEnableVertexAttribArray(colourAttribute->attributeID);
+    
+    glDrawArrays(GL_LINES, firstOverlay, numUnderlay);
+    glDrawArrays(GL_LINES, firstEvent, numEventVertices);
+    glDrawArrays(GL_LINES, 0, numTraceVertices);
+    glDrawArrays(GL_LINES, firstCursor, numCursors);
+    
+    context.extensions.glDisableVertexAttribArray(positionAttribute->attributeID);
+    context.extensions.glDisableVertexAttribArray(colourAttribute->attributeID);
+    context.extensions.glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void LfpOpenGLRenderer::openGLContextClosing()
+{
+    positionAttribute = nullptr;
+    colourAttribute = nullptr;
+    transformUniform = nullptr;
+    shader = nullptr;
+    
+    if (vertexBuffer != 0)
+        context.extensions.glDeleteBuffers(1, &vertexBuffer);
+    
+    vertexBuffer = 0;
+    numBufferVertices = 0;
+}
+
+
+#pragma mark - LfpSpectrogram -
+
+LfpSpectrogram::LfpSpectrogram(LfpDisplayNode* processor_)
+    : Thread("LFP spectrogram")
+    , processor(processor_)
+    , windowSize(0)
+    , hopSize(1)
+    , numBins(0)
+    , numColumns(0)
+    , sampleRate(0)
+{
+    // from black through blue and green to red, brightening over the first quarter
+    for (int i = 0; i < 256; i++)
+    {
+        const float level = i / 255.0f;
+        colourMap[i] = Colour::fromHSV(0.7f * (1.0f - level), 1.0f, jmin(1.0f, 4.0f * level), 1.0f);
+    }
+}
+
+LfpSpectrogram::~LfpSpectrogram()
+{
+    stopThread(1000);
+}
+
+void LfpSpectrogram::prepare(const Array<float>& channelSampleRates, float displayedSampleRate)
+{
+    jassert(!isThreadRunning());
+    
+    channels.clear();
+    sampleRate = displayedSampleRate;
+    
+    if (sampleRate <= 0)
+        return;
+    
+    // the window must stay well within the full rate ring of the tap
+    const int ringSize = processor->getDisplayBufferSize();
+    int order = 6;
+    
+    while ((1 << (order + 1)) <= sampleRate * LFP_SPECTROGRAM_WINDOW_SECONDS
+           && (1 << (order + 1)) <= ringSize / 2)
+        order++;
+    
+    if (fft == nullptr || fft->getSize() != (1 << order))
+        fft = new FFT(order, false);
+    
+    windowSize = 1 << order;
+    hopSize = windowSize / LFP_SPECTROGRAM_OVERLAP;
+    numBins = jlimit(1, windowSize / 2, int(LFP_SPECTROGRAM_MAX_HZ * windowSize / sampleRate) + 1);
+    numColumns = jmax(1, (int) std::ceil(DISPLAY_TAP_SECONDS * sampleRate / hopSize));
+    
+    window.malloc(windowSize);
+    realPart.malloc(windowSize);
+    imagPart.malloc(windowSize);
+    input.malloc(windowSize);
+    output.malloc(windowSize);
+    powerA.malloc(numBins);
+    powerB.malloc(numBins);
+    
+    for (int i = 0; i < windowSize; i++)
+        window[i] = 0.5f - 0.5f * std::cos(2.0f * float_Pi * i / windowSize);
+    
+    for (int chan = 0; chan < channelSampleRates.size(); chan++)
+    {
+        Channel* channel = channels.add(new Channel());
+        channel->computed = channelSampleRates[chan] == sampleRate;
+        channel->inView = 1;
+        channel->nextWindowEnd = jmax((int64) windowSize, processor->getDisplayBufferSamplesWritten(chan));
+        channel->columnsWritten = 0;
+        channel->peakDb = -1000.0f;
+        
+        if (channel->computed)
+            channel->image = Image(Image::RGB, numColumns, numBins, true);
+    }
+    
+    jobs.clearQuick();
+    jobs.ensureStorageAllocated(2 * channels.size());
+}
+
+void LfpSpectrogram::setChannelInView(int chan, bool isInView)
+{
+    if (isPositiveAndBelow(chan, channels.size()))
+        channels.getUnchecked(chan)->inView = isInView ? 1 : 0;
+}
+
+int LfpSpectrogram::getColumnsComputed() const
+{
+    return columnsComputed.get();
+}
+
+void LfpSpectrogram::drawChannel(Graphics& g, int chan, const Rectangle<int>& area, float seconds)
+{
+    if (!isPositiveAndBelow(chan, channels.size()))
+        return;
+    
+    Channel& channel = *channels.getUnchecked(chan);
+    
+    if (!channel.computed || channel.image.isNull())
+        return;
+    
+    // the latest column at the right edge, the columns not written yet being blank
+    const int shown = jlimit(1, numColumns, roundToInt(seconds * sampleRate / hopSize));
+    const int first = ((channel.columnsWritten.get() - shown) % numColumns + numColumns) % numColumns;
+    const int firstPart = jmin(shown, numColumns - first);
+    const int firstWidth = roundToInt(area.getWidth() * firstPart / float(shown));
+    
+    g.setImageResamplingQuality(Graphics::lowResamplingQuality);
+    g.drawImage(channel.image, area.getX(), area.getY(), firstWidth, area.getHeight(),
+                first, 0, firstPart, numBins);
+    
+    if (firstPart < shown)
+        g.drawImage(channel.image, area.getX() + firstWidth, area.getY(), area.getWidth() - firstWidth, area.getHeight(),
+                    0, 0, shown - firstPart, numBins);
+}
+
+int64 LfpSpectrogram::getMemoryFootprint() const
+{
+    int64 imageBytes = 0;
+    
+    for (int chan = 0; chan < channels.size(); chan++)
+        if (channels[chan]->computed)
+            imageBytes += (int64) numColumns * numBins * 3;
+    
+    return imageBytes
+        + MemoryFootprint::ofBlock(window, windowSize)
+        + MemoryFootprint::ofBlock(realPart, windowSize)
+        + MemoryFootprint::ofBlock(imagPart, windowSize)
+        + MemoryFootprint::ofBlock(input, windowSize)
+        + MemoryFootprint::ofBlock(output, windowSize)
+        + MemoryFootprint::ofBlock(powerA, numBins)
+        + MemoryFootprint::ofBlock(powerB, numBins)
+        + MemoryFootprint::ofArray(jobs);
+}
+
+void LfpSpectrogram::run()
+{
+    const int ringSize = processor->getDisplayBufferSize();
+    const int waitMs = jlimit(1, 50, roundToInt(250.0f * hopSize / sampleRate)); // a quarter of a column
+    
+    while (!threadShouldExit())
+    {
+        jobs.clearQuick();
+        
+        for (int chan = 0; chan < channels.size(); chan++)
+        {
+            Channel& channel = *channels.getUnchecked(chan);
+            
+            if (!channel.computed)
+                continue;
+            
+            const int64 written = processor->getDisplayBufferSamplesWritten(chan);
+            
+            // past a whole image of columns behind, only the last image's worth is worth writing
+            if (written - channel.nextWindowEnd > (int64) numColumns * hopSize)
+                channel.nextWindowEnd += ((written - channel.nextWindowEnd) / hopSize - numColumns) * hopSize;
+            
+            for (; channel.nextWindowEnd <= written; channel.nextWindowEnd += hopSize)
+            {
+                // windows the writer went over already are left blank, as are channels out of view
+                if (channel.inView.get() == 0 || written - (channel.nextWindowEnd - windowSize) > ringSize)
+                {
+                    writeColumn(chan, nullptr);
+                }
+                else
+                {
+                    Job job = { chan, channel.nextWindowEnd };
+                    jobs.add(job);
+                }
+            }
+        }
+        
+        for (int j = 0; j < jobs.size() && !threadShouldExit(); j += 2)
+            transformJobs(jobs.getReference(j), j + 1 < jobs.size() ? &jobs.getReference(j + 1) : nullptr);
+        
+        wait(waitMs);
+    }
+}
+
+bool LfpSpectrogram::readWindow(const Job& job, float* dest)
+{
+    const float* ring = processor->getDisplayBufferChannel(job.channel);
+    const int ringSize = processor->getDisplayBufferSize();
+    const int64 windowStart = job.windowEnd - windowSize;
+    
+    if (ring == nullptr || ringSize < windowSize)
+        return false;
+    
+    // the window is applied while reading the ring, in at most two runs
+    const int start = int(windowStart % ringSize);
+    const int firstRun = jmin(windowSize, ringSize - start);
+    
+    FloatVectorOperations::multiply(dest, ring + start, window, firstRun);
+    
+    if (firstRun < windowSize)
+        FloatVectorOperations::multiply(dest + firstRun, ring, window + firstRun, windowSize - firstRun);
+    
+    // the writer may have gone around the ring over the window meanwhile
+    return processor->getDisplayBufferSamplesWritten(job.channel) - windowStart <= ringSize;
+}
+
+void LfpSpectrogram::transformJobs(const Job& first, const Job* second)
+{
+    const bool firstRead = readWindow(first, realPart);
+    const bool secondRead = second != nullptr && readWindow(*second, imagPart);
+    
+    if (!secondRead)
+        FloatVectorOperations::clear(imagPart, windowSize);
+    
+    for (int i = 0; i < windowSize; i++)
+    {
+        input[i].r = realPart[i];
+        input[i].i = imagPart[i];
+    }
+    
+    fft->perform(input, output);
+    
+    // the spectra of the real and imaginary parts are the even and odd parts of the transform
+    for (int k = 0; k < numBins; k++)
+    {
+        const FFT::Complex& z = output[k];
+        const FFT::Complex& mirror = output[k == 0 ? 0 : windowSize - k];
+        
+        const float ar = z.r + mirror.r;
+        const float ai = z.i - mirror.i;
+        const float br = z.i + mirror.i;
+        const float bi = z.r - mirror.r;
+        
+        powerA[k] = 10.0f * std::log10(0.25f * (ar * ar + ai * ai) + 1.0e-20f);
+        powerB[k] = 10.0f * std::log10(0.25f * (br * br + bi * bi) + 1.0e-20f);
+    }
+    
+    writeColumn(first.channel, firstRead ? powerA.getData() : nullptr);
+    
+    if (second != nullptr)
+        writeColumn(second->channel, secondRead ? powerB.getData() : nullptr);
+}
+
+void LfpSpectrogram::writeColumn(int chan, const float* power)
+{
+    Channel& channel = *channels.getUnchecked(chan);
+    Image::BitmapData pixels(channel.image, channel.columnsWritten.get() % numColumns, 0, 1, numBins,
+                             Image::BitmapData::writeOnly);
+    
+    if (power == nullptr)
+    {
+        for (int bin = 0; bin < numBins; bin++)
+            pixels.setPixelColour(0, bin, colourMap[0]);
+    }
+    else
+    {
+        // the peak leaves the range over the length of the image, the DC bin being left out of it
+        const float columnPeak = numBins > 1 ? FloatVectorOperations::findMaximum(power + 1, numBins - 1) : power[0];
+        channel.peakDb = jmax(columnPeak, channel.peakDb - LFP_SPECTROGRAM_RANGE_DB / numColumns);
+        
+        const float floorDb = channel.peakDb - LFP_SPECTROGRAM_RANGE_DB;
+        const float scale = 255.0f / LFP_SPECTROGRAM_RANGE_DB;
+        
+        for (int bin = 0; bin < numBins; bin++)
+            pixels.setPixelColour(0, numBins - 1 - bin, colourMap[jlimit(0, 255, int((power[bin] - floorDb) * scale))]);
+    }
+    
+    ++channel.columnsWritten;
+    ++columnsComputed;
+}
+
+
+
 #pragma mark - PerPixelBitmapPlotter -
 
 PerPixelBitmapPlotter::PerPixelBitmapPlotter(LfpDisplay * lfpDisplay)
@@ -3978,9 +5145,8 @@ SupersampledBitmapPlotter::SupersampledBitmapPlotter(LfpDisplay * lfpDisplay)
 
 void SupersampledBitmapPlotter::plot(Image::BitmapData &bdLfpChannelBitmap, LfpBitmapPlotterInfo &pInfo)
 {
-    std::array<float, MAX_N_SAMP_PER_PIXEL> samplesThisPixel = pInfo.samplesPerPixel;
-//    int sampleCountThisPixel = lfpDisplay->canvas->getSampleCountPerPixel(pInfo.samp);
-    int sampleCountThisPixel = pInfo.sampleCountPerPixel;
+    const float* samplesThisPixel = pInfo.samplesPerPixel;
+    int sampleCountThisPixel = pInfo.sampleCountPerPixel - 1; // pairs of consecutive samples
     
     if (pInfo.samplerange>0 & sampleCountThisPixel>0)
     {
@@ -3991,7 +5157,7 @@ void SupersampledBitmapPlotter::plot(Image::BitmapData &bdLfpChannelBitmap, LfpB
         for (int k = 0; k <= pInfo.samplerange; k++)
             rangeHist.add(0);
         
-        for (int k = 0; k <= sampleCountThisPixel; k++) // add up paired-range histogram per pixel - for each pair fill intermediate with uniform distr.
+        for (int k = 0; k < sampleCountThisPixel; k++) // add up paired-range histogram per pixel - for each pair fill intermediate with uniform distr.
         {
             int cs_this = (((samplesThisPixel[k]/pInfo.range*pInfo.channelHeightFloat)+pInfo.height/2)-pInfo.from); // sample values -> pixel coordinates relative to from
             int cs_next = (((samplesThisPixel[k+1]/pInfo.range*pInfo.channelHeightFloat)+pInfo.height/2)-pInfo.from);
@@ -26,13 +26,14 @@
 #include <VisualizerWindowHeaders.h>
 #include "LfpDisplayNode.h"
 
-#include <vector>
-#include <array>
-
 #define CHANNEL_TYPES 3
 #define MAX_N_CHAN 2048
 #define MAX_N_SAMP 5000
-#define MAX_N_SAMP_PER_PIXEL 100
+#define MAX_N_SAMP_PER_PIXEL 16 // samples kept per pixel column for the supersampled plotter, evenly spread over it
+#define LFP_SPECTROGRAM_MAX_HZ 300.0f
+#define LFP_SPECTROGRAM_WINDOW_SECONDS 0.5f // longest window of the spectrogram, rounded down to a power of two
+#define LFP_SPECTROGRAM_OVERLAP 4 // columns per window length
+#define LFP_SPECTROGRAM_RANGE_DB 60.0f // colours span this far below a channel's recent peak
 
 namespace LfpViewer {
 
@@ -49,6 +50,9 @@ class LfpBitmapPlotter;
 class PerPixelBitmapPlotter;
 class SupersampledBitmapPlotter;
 class LfpChannelColourScheme;
+class LfpOpenGLRenderer;
+class LfpSpectrogram;
+struct LfpGLVertex;
 
     
     
@@ -83,6 +87,12 @@ public:
     void refresh();
     void resized();
     
+    /** Falls back to per-pixel drawing while the display scheduler asks for less detail */
+    void setDetailReduced(bool isReduced) override;
+
+    /** The screen buffers, and the samples of each pixel column */
+    int64 getMemoryFootprint() const override;
+    
     /** Resizes the LfpDisplay to the size required to fit all channels that are being
         drawn to the screen.
         
@@ -109,8 +119,16 @@ public:
     /** Returns a bool describing whether the spike raster functionality is enabled */
     bool getDisplaySpikeRasterizerState();
     
+    /** Returns true if the supersampled drawing is selected and the detail is not reduced */
     bool getDrawMethodState();
     
+    /** Shows the spectrograms of the channels instead of their traces */
+    void setSpectrogramMode(bool isEnabled);
+    bool getSpectrogramMode();
+    
+    /** Returns the spectrograms, computed while acquiring in spectrogram mode */
+    LfpSpectrogram* getSpectrogram();
+    
     int getChannelSampleRate(int channel);
     
     /** Delegates a samplerate for drawing to the LfpDisplay referenced by this canvas */
@@ -126,8 +144,11 @@ public:
     const float getXCoord(int chan, int samp);
     const float getYCoord(int chan, int samp);
     
-    std::array<float, MAX_N_SAMP_PER_PIXEL> getSamplesPerPixel(int chan, int px);
-    const int getSampleCountPerPixel(int px);
+    /** Returns the samples kept for a pixel column, in order, while the supersampled
+        draw method is on */
+    const float* getSamplesPerPixel(int chan, int px);
+    /** Returns the number of samples kept for a pixel column, 0 past the screen buffer */
+    const int getSampleCountPerPixel(int chan, int px);
     
     const float getYCoordMin(int chan, int samp);
     const float getYCoordMean(int chan, int samp);
@@ -180,7 +201,6 @@ private:
     //float waves[MAX_N_CHAN][MAX_N_SAMP*2]; // we need an x and y point for each sample
 
     LfpDisplayNode* processor;
-    AudioSampleBuffer* displayBuffer; // sample wise data buffer for display
     ScopedPointer<AudioSampleBuffer> screenBuffer; // subsampled buffer- one int per pixel
 
     //'define 3 buffers for min mean and max for better plotting of spikes
@@ -195,22 +215,49 @@ private:
     ScopedPointer<LfpDisplay> lfpDisplay;
     
     ScopedPointer<LfpDisplayOptions> options;
+    
+    ScopedPointer<LfpSpectrogram> spectrogram;
+    bool spectrogramMode;
+    bool animating;
+
+    /** Restarts the spectrogram thread for the displayed channels, if it is to run */
+    void updateSpectrogram();
 
     void refreshScreenBuffer();
     void updateScreenBuffer();
 
+    /** Computes numColumns screen columns of a channel from column sbi on, wrapping at the
+        right edge, reading the display buffer level from dbi. dbi and subSampleOffset are advanced
+        past the samples of these columns; if write is false, only they are. */
+    void decimateScreenColumns(int channel, int sbi, int numColumns, int& dbi, float& subSampleOffset,
+                               float ratio, bool write);
+
+    /** Recomputes every screen column of a channel that was out of view from the display
+        buffer history ending at dbi, clearing the columns older than the history */
+    void catchUpScreenColumns(int channel, int sbi, int dbi, int nSamples, float ratio);
+
+    /** Returns the finest level of the display taps holding more than the timebase */
+    int chooseDisplayLevel() const;
+
     Array<int> displayBufferIndex;
+    Array<bool> screenBufferStale; // the columns of channels out of view are not kept up to date
     int displayBufferSize;
+    int displayLevel; // of the display taps, the indices and sizes being in its entries
 
     int scrollBarThickness;
     
-    //float samplesPerPixel[MAX_N_SAMP][MAX_N_SAMP_PER_PIXEL];
-    //float*** samplesPerPixel;
-
+    /** Sizes the per-column samples to the channels and the width of the display,
+        only reallocating if either changed */
 	void resizeSamplesPerPixelBuffer(int numChannels);
-    std::vector<std::array<std::array<float, MAX_N_SAMP_PER_PIXEL>, MAX_N_SAMP>> samplesPerPixel;
+    
+    // up to MAX_N_SAMP_PER_PIXEL samples of each pixel column, behaves like
+    // float samplesPerPixel[numPixelChannels][numPixelColumns][MAX_N_SAMP_PER_PIXEL]
+    HeapBlock<float> samplesPerPixel;
+    HeapBlock<uint8> sampleCountPerPixel;   // [numPixelChannels][numPixelColumns]
+    int numPixelChannels;
+    int numPixelColumns;
 
-    int sampleCountPerPixel[MAX_N_SAMP];
+    bool detailReduced; // set by the display scheduler
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LfpDisplayCanvas);
 
@@ -349,6 +396,8 @@ private:
     ScopedPointer<ComboBox> colorGroupingSelection;
     ScopedPointer<UtilityButton> invertInputButton;
     ScopedPointer<UtilityButton> drawMethodButton;
+    ScopedPointer<UtilityButton> openGLButton;
+    ScopedPointer<UtilityButton> spectrogramButton;
     ScopedPointer<UtilityButton> pauseButton;
     OwnedArray<UtilityButton> typeButtons;
     
@@ -571,6 +620,10 @@ public:
     /** Set the threshold value for the spike raster plotting function */
     void setSpikeRasterThreshold(float thresh);
 
+    /** Returns true if the channel is drawable and within margin pixels of the viewport's
+        visible area, the event channel always being in view */
+    bool isChannelInView(int chan, int margin);
+
     /** Returns true if a single channel is focused in viewport */
     bool getSingleChannelState();
     
@@ -593,6 +646,18 @@ public:
     
     /** Returns a const pointer to the internally managed plotter method class */
     LfpBitmapPlotter * const getPlotterPtr() const;
+    
+    /** Attaches an OpenGL context to the viewport, through which the traces are drawn
+        instead of into lfpChannelBitmap, or detaches it if isEnabled is false */
+    void setOpenGLRendering(bool isEnabled);
+    
+    /** Returns true if an OpenGL context is attached to the viewport */
+    bool getOpenGLRendering();
+    
+    /** Returns true if the traces are currently drawn by the OpenGL renderer. It only
+        draws the per-pixel method without warnings nor spike raster, any of these
+        falling back to the software path, as does a failure of the renderer. */
+    bool isDrawingWithOpenGL();
 
     Colour backgroundColour;
     
@@ -665,6 +730,34 @@ private:
     
     ScopedPointer<PerPixelBitmapPlotter> perPixelPlotter;
     ScopedPointer<SupersampledBitmapPlotter> supersampledPlotter;
+    
+    OpenGLContext openGLContext;
+    ScopedPointer<LfpOpenGLRenderer> glRenderer;
+    bool drewWithOpenGL;                // the path taken by the last refresh
+    int spectrogramColumnsPainted;
+
+    /** Draws the spectrogram of each drawable channel instead of its traces */
+    void paintSpectrograms(Graphics& g);
+
+    /** Draws columns xFrom..xTo of the channels to paint into lfpChannelBitmap */
+    class PaintJob : public ThreadPoolJob
+    {
+    public:
+        PaintJob(LfpDisplay* display);
+        JobStatus runJob() override;
+
+        LfpDisplay* display;
+        int xFrom;
+        int xTo;
+    };
+
+    /** Splits columns from..to of the channels to paint into tiles, drawn at once by the
+        paint pool and this thread, and returns once all of them are drawn */
+    void paintChannelColumns(int from, int to);
+
+    ThreadPool paintPool;
+    OwnedArray<PaintJob> paintJobs;
+    Array<int> channelsToPaint;         // in channels[] order, so that overlapping channels draw over each other as before
 
     // TODO: (kelly) add reference to a color scheme
 //    LfpChannelColourScheme * colourScheme;
@@ -692,6 +785,20 @@ public:
     void pxPaint(); // like paint, but just populate lfpChannelBitmap
                     // needs to avoid a paint(Graphics& g) mechanism here becauswe we need to clear the screen in the lfpDisplay repaint(),
                     // because otherwise we cant deal with the channel overlap (need to clear a vertical section first, _then_ all channels are dawn, so cant do it per channel)
+    
+    /** Works out the columns the next pxPaint(xFrom, xTo) calls redraw, all of them if
+        fullredraw was set, and resets fullredraw. Returns the columns written, which include
+        the one of the most recent sample marker. */
+    void preparePxPaint(int& columnFrom, int& columnTo);
+    
+    /** Like pxPaint, but only writes the columns xFrom to xTo (excluded) of the range set by
+        preparePxPaint. Each column is drawn on its own, so separate threads may draw separate
+        columns of lfpChannelBitmap at once. */
+    void pxPaint(int xFrom, int xTo);
+    
+    /** Like pxPaint, but writes the min-max segment of each column from..to as a pair of
+        vertices for the LfpOpenGLRenderer, the pair of column i starting at columns[i * stride] */
+    void glPaint(LfpGLVertex* columns, int stride, int from, int to);
                 
 
     void select();
@@ -777,6 +884,9 @@ protected:
 
     float range;
 
+    int paintFrom;      // the columns set by preparePxPaint
+    int paintTo;
+
     bool isEnabled;
     bool inputInverted;
     bool canBeInverted;
@@ -917,6 +1027,205 @@ private:
 
     
     
+#pragma mark - LfpGLVertex -
+//==============================================================================
+/**
+    One end of a line drawn by the LfpOpenGLRenderer, in LfpDisplay pixels.
+ */
+struct LfpGLVertex
+{
+    GLfloat x;
+    GLfloat y;
+    uint8 colour[4];    // r, g, b, a
+    
+    void set(float x_, float y_, Colour c);
+};
+
+    
+    
+#pragma mark - LfpOpenGLRenderer -
+//==============================================================================
+/**
+    Draws the traces of the LfpDisplay through an OpenGL context attached to the
+    viewport, rather than setting the pixels of lfpChannelBitmap one at a time.
+ 
+    Each channel visible in the viewport gets a slot, and each pixel column of a
+    slot the two vertices of the line from its min to its max. The columns are
+    stored one after the other, every slot within a column, so that the columns
+    drawn since the last refresh, which are the same for all the channels, are a
+    single range of the vertex buffer: only those are uploaded, and all the traces
+    are then drawn in one call. The event markers are stored the same way, followed
+    by the zero lines, range markers and cursors, the whole display taking four
+    draw calls. Scrolling or any change of the layout rebuilds every column, as a
+    full redraw of the bitmap does.
+ 
+    The vertices are written on the message thread by LfpDisplay::refresh and read
+    on the OpenGL thread, under a lock. The channel numbers, labels and other child
+    components are still painted by JUCE over the traces.
+ 
+    @see LfpDisplay, LfpChannelDisplay::glPaint
+ */
+class LfpOpenGLRenderer : public OpenGLRenderer
+{
+public:
+    LfpOpenGLRenderer(LfpDisplay* display, LfpDisplayCanvas* canvas, Viewport* viewport, OpenGLContext& context);
+    ~LfpOpenGLRenderer();
+    
+    /** Writes the columns drawn since the last update, or every column and slot if
+        fullRedraw is true, and triggers a new frame */
+    void update(bool fullRedraw);
+    
+    /** Returns true if the shaders could not be built, nothing being drawn then */
+    bool hasFailed() const;
+    
+    void newOpenGLContextCreated() override;
+    void renderOpenGL() override;
+    void openGLContextClosing() override;
+    
+private:
+    /** Reassigns the slots to the visible channels and reallocates the vertices if needed */
+    void layoutSlots();
+    
+    void writeEventColumns(int from, int to);
+    void writeOverlay();
+    
+    LfpDisplay* display;
+    LfpDisplayCanvas* canvas;
+    Viewport* viewport;
+    OpenGLContext& context;
+    
+    ScopedPointer<OpenGLShaderProgram> shader;
+    ScopedPointer<OpenGLShaderProgram::Attribute> positionAttribute;
+    ScopedPointer<OpenGLShaderProgram::Attribute> colourAttribute;
+    ScopedPointer<OpenGLShaderProgram::Uniform> transformUniform;
+    GLuint vertexBuffer;
+    int numBufferVertices;              // allocated in the vertex buffer
+    Atomic<int> failed;
+    
+    CriticalSection lock;               // guards everything below
+    
+    HeapBlock<LfpGLVertex> vertices;
+    int numVertices;
+    int numAllocatedVertices;
+    int numColumns;
+    Array<LfpChannelDisplay*> slots;
+    
+    int eventsStart;                    // first vertex of each region
+    int overlayStart;
+    int cursorsStart;
+    int numUnderlayVertices;            // zero lines and range markers, drawn below the traces
+    int numCursorVertices;
+    
+    bool uploadAll;
+    int dirtyFrom;                      // columns written since the last upload
+    int dirtyTo;
+    
+    Rectangle<int> viewArea;            // of the viewport, in LfpDisplay pixels
+    Colour backgroundColour;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LfpOpenGLRenderer);
+};
+
+    
+    
+#pragma mark - LfpSpectrogram -
+//==============================================================================
+/**
+    Computes the spectrograms of the channels in view, up to LFP_SPECTROGRAM_MAX_HZ, on a
+    thread of its own while the LfpDisplay is in spectrogram mode.
+ 
+    Each time LFP_SPECTROGRAM_OVERLAP-th of a window was written to a channel, the window
+    ending there is read straight out of the display tap of the LfpDisplayNode, being
+    multiplied by a Hann window on the way, and the power of its bins becomes a new column
+    of the channel's image. The images are rings of columns, drawn with the latest column
+    on the right. As in FirFilterBank, the windows of two channels go through one complex
+    transform as its real and imaginary parts, all the transforms sharing a single plan.
+ 
+    Only the channels of the displayed sample rate are computed, the columns of those out of
+    view being left blank.
+ 
+    @see LfpDisplay, DisplayTap
+ */
+class LfpSpectrogram : public Thread
+{
+public:
+    LfpSpectrogram(LfpDisplayNode* processor);
+    ~LfpSpectrogram();
+    
+    /** Sizes the transform and the images for the channels of the given sample rate, and
+        clears the images. Only called while the thread is stopped. */
+    void prepare(const Array<float>& channelSampleRates, float displayedSampleRate);
+    
+    /** Sets whether the columns of a channel are to be computed. Safe to call from any thread. */
+    void setChannelInView(int chan, bool isInView);
+    
+    /** Returns the number of columns computed for all channels so far. Safe to call from any thread. */
+    int getColumnsComputed() const;
+    
+    /** Draws the last seconds of a channel's spectrogram into area, lowest frequencies at the bottom */
+    void drawChannel(Graphics& g, int chan, const Rectangle<int>& area, float seconds);
+    
+    /** The images and the buffers of the transform */
+    int64 getMemoryFootprint() const;
+    
+    void run() override;
+    
+private:
+    /** A window of a channel to be transformed */
+    struct Job
+    {
+        int channel;
+        int64 windowEnd;
+    };
+    
+    /** Transforms the windows of two jobs, or of one if second is null, and writes their columns */
+    void transformJobs(const Job& first, const Job* second);
+    
+    /** Multiplies a channel's window by the Hann window into dest, returning false if the
+        writer went over it meanwhile */
+    bool readWindow(const Job& job, float* dest);
+    
+    /** Appends a column to a channel's image, blank if power is null */
+    void writeColumn(int chan, const float* power);
+    
+    LfpDisplayNode* processor;
+    
+    ScopedPointer<FFT> fft;
+    int windowSize;
+    int hopSize;
+    int numBins;
+    int numColumns;
+    float sampleRate;
+    
+    HeapBlock<float> window;
+    HeapBlock<float> realPart;
+    HeapBlock<float> imagPart;
+    HeapBlock<FFT::Complex> input;
+    HeapBlock<FFT::Complex> output;
+    HeapBlock<float> powerA;
+    HeapBlock<float> powerB;
+    
+    /** The state of one channel, its image being written by the thread while it is drawn */
+    struct Channel
+    {
+        bool computed;                  // of the displayed sample rate
+        Atomic<int> inView;
+        int64 nextWindowEnd;
+        Atomic<int> columnsWritten;
+        float peakDb;
+        Image image;
+    };
+    
+    OwnedArray<Channel> channels;
+    Array<Job> jobs;
+    Atomic<int> columnsComputed;
+    Colour colourMap[256];              // from the floor of the range to the peak
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LfpSpectrogram);
+};
+
+    
+    
 #pragma mark - LfpBitmapPlotterInfo -
 //==============================================================================
 /**
@@ -933,7 +1242,7 @@ struct LfpBitmapPlotterInfo
     int height;
     int width;
     float channelHeightFloat;
-    std::array<float, MAX_N_SAMP_PER_PIXEL> samplesPerPixel;
+    const float* samplesPerPixel;
     int sampleCountPerPixel;
     float range;
     int samplerange;
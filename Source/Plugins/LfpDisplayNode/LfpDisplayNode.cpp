@@ -25,31 +25,29 @@
 #include "LfpDisplayCanvas.h"
 #include <stdio.h>
 
+#define LFP_OFFLINE_UPDATE_MS 50
+
 using namespace LfpViewer;
 
 
 LfpDisplayNode::LfpDisplayNode()
     : GenericProcessor  ("LFP Viewer")
+    , localTap          (new DisplayTap())
+    , firstLocalChannel (0)
+    , numDisplayChannels (0)
     , displayGain       (1)
-    , bufferLength      (20.0f)
     , abstractFifo      (100)
+    , lastOfflineUpdate (0)
 {
     setProcessorType (PROCESSOR_TYPE_SINK);
 
-    displayBuffer = new AudioSampleBuffer (8, 100);
-
-    const int heapSize = 5000;
-    arrayOfOnes = new float[heapSize];
-    for (int n = 0; n < heapSize; ++n)
-    {
-        arrayOfOnes[n] = 1;
-    }
+    // so that blocks of TTL pulses do not allocate on the processing thread
+    pendingTTLChanges.ensureStorageAllocated (1024);
 }
 
 
 LfpDisplayNode::~LfpDisplayNode()
 {
-    delete[] arrayOfOnes;
 }
 
 
@@ -67,6 +65,7 @@ void LfpDisplayNode::updateSettings()
     channelForEventSource.clear();
     eventSourceNodes.clear();
     ttlState.clear();
+    pendingTTLChanges.clearQuick();
 
 	for (int i = 0; i < eventChannelArray.size(); ++i)
 	{
@@ -90,8 +89,8 @@ void LfpDisplayNode::updateSettings()
         ttlState[eventSourceNodes[i]] = 0;
     }
 
-    displayBufferIndex.clear();
-    displayBufferIndex.insertMultiple (0, 0, getNumInputs() + numEventChannels);
+    // the taps are sized by enable(), once the sources are ready
+    numDisplayChannels = getNumInputs() + numEventChannels;
     
     // update the editor's subprocessor selection display
     LfpDisplayEditor * ed = (LfpDisplayEditor*)getEditor();
@@ -110,9 +109,109 @@ uint32 LfpDisplayNode::getChannelSourceID(const EventChannel* event) const
 	return getProcessorFullId(values[1], values[2]);
 }
 
+DisplayTap* LfpDisplayNode::getTapForChannel (int chan, int& tapChannel) const
+{
+    if (chan < firstLocalChannel)
+    {
+        tapChannel = chan;
+        return sharedReader->getTap();
+    }
+
+    tapChannel = chan - firstLocalChannel;
+    return localTap;
+}
+
+const float* LfpDisplayNode::getDisplayBufferChannel (int chan) const
+{
+    int tapChannel;
+    return getTapForChannel (chan, tapChannel)->getReadPointer (tapChannel);
+}
+
+const float* LfpDisplayNode::getDisplayBufferMinima (int chan, int level) const
+{
+    int tapChannel;
+    return getTapForChannel (chan, tapChannel)->getLevelMinima (level, tapChannel);
+}
+
+const float* LfpDisplayNode::getDisplayBufferMaxima (int chan, int level) const
+{
+    int tapChannel;
+    return getTapForChannel (chan, tapChannel)->getLevelMaxima (level, tapChannel);
+}
+
+int LfpDisplayNode::getDisplayBufferSize (int level) const
+{
+    return localTap->getLevelLength (level);
+}
+
+int LfpDisplayNode::getDisplayBufferIndex (int chan, int level) const
+{
+    if (! isPositiveAndBelow (chan, numDisplayChannels))
+        return 0;
+
+    int tapChannel;
+    return getTapForChannel (chan, tapChannel)->getLevelWriteIndex (level, tapChannel);
+}
+
+int64 LfpDisplayNode::getDisplayBufferSamplesWritten (int chan, int level) const
+{
+    if (! isPositiveAndBelow (chan, numDisplayChannels))
+        return 0;
+
+    int tapChannel;
+    return getTapForChannel (chan, tapChannel)->getLevelEntriesWritten (level, tapChannel);
+}
+
+void LfpDisplayNode::idleStateChanged (bool isIdle)
+{
+    if (localReader != nullptr)
+        localReader->setActive (! isIdle);
+
+    if (sharedReader != nullptr)
+        sharedReader->setActive (! isIdle);
+}
+
+int64 LfpDisplayNode::getMemoryFootprint() const
+{
+    // a shared tap is counted by the processor it belongs to
+    return GenericProcessor::getMemoryFootprint()
+        + localTap->getMemoryFootprint()
+        + MemoryFootprint::ofArray (pendingTTLChanges);
+}
+
+
+bool LfpDisplayNode::isIdle() const
+{
+    const LfpDisplayEditor* ed = (const LfpDisplayEditor*) getEditor();
+
+    return ed != nullptr && ! ed->isCanvasOpen();
+}
+
+
+GenericProcessor* LfpDisplayNode::findSharedTapSource() const
+{
+    GenericProcessor* source = getSourceNode();
+
+    // splitters hand the same buffer to all their outputs
+    while (source != nullptr && source->isSplitter())
+        source = source->getSourceNode();
+
+    if (source == nullptr || source->isMerger())
+        return nullptr;
+
+    const DisplayTap* tap = source->getDisplayTap();
+
+    if (tap->getNumChannels() != getNumInputs()
+        || tap->getNumSamples() != DisplayTap::getLengthForSampleRate (getSampleRate()))
+        return nullptr;
+
+    return source;
+}
+
+
 bool LfpDisplayNode::resizeBuffer()
 {
-    int nSamples = (int) getSampleRate() * bufferLength;
+    int nSamples = DisplayTap::getLengthForSampleRate (getSampleRate());
     int nInputs = getNumInputs();
 
     std::cout << "Resizing buffer. Samples: " << nSamples << ", Inputs: " << nInputs << std::endl;
@@ -120,7 +219,21 @@ bool LfpDisplayNode::resizeBuffer()
     if (nSamples > 0 && nInputs > 0)
     {
         abstractFifo.setTotalSize (nSamples);
-        displayBuffer->setSize (nInputs + numEventChannels, nSamples); // add extra channels for TTLs
+
+        GenericProcessor* source = findSharedTapSource();
+
+        if (source == nullptr)
+            sharedReader = nullptr;
+        else if (sharedReader == nullptr || sharedReader->getTap() != source->getDisplayTap())
+            sharedReader = new DisplayTap::Reader (source->getDisplayTap(), ! isIdleState());
+
+        firstLocalChannel = (sharedReader != nullptr) ? nInputs : 0;
+
+        // extra channels for TTLs, and the inputs unless they are shared
+        localTap->setSize (numDisplayChannels - firstLocalChannel, nSamples);
+
+        if (localReader == nullptr)
+            localReader = new DisplayTap::Reader (localTap, ! isIdleState());
 
         return true;
     }
@@ -169,57 +282,35 @@ void LfpDisplayNode::setParameter (int parameterIndex, float newValue)
 }
 
 
+void LfpDisplayNode::getEventSubscription (EventSubscription& subscription) const
+{
+    // only TTLs are drawn
+    subscription.setEventTypes (EventSubscription::TTL_EVENTS);
+    subscription.setSpikes (false);
+    subscription.setTimestampSyncTexts (false);
+}
+
+
 void LfpDisplayNode::handleEvent(const EventChannel* eventInfo, const MidiMessage& event, int samplePosition)
 {
     if (Event::getEventType(event) == EventChannel::TTL)
     {
         TTLEventPtr ttl = TTLEvent::deserializeFromMessage(event, eventInfo);
         
-        //int eventNodeId = *(dataptr+1);
-        const int eventId = ttl->getState() ? 1 : 0;
-        const int eventChannel = ttl->getChannel();
-        const int eventTime = samplePosition;
         const uint32 eventSourceNodeId = getChannelSourceID(eventInfo);
-        
-        
-        const int chan          = channelForEventSource[eventSourceNodeId];
-        const int index         = (displayBufferIndex[chan] + eventTime) % displayBuffer->getNumSamples();
-        const int samplesLeft   = displayBuffer->getNumSamples() - index;
-        const int nSamples = getNumSourceSamples(eventSourceNodeId) - eventTime;
-        
-        if (eventId == 1)
-        {
-            ttlState[eventSourceNodeId] |= (1L << eventChannel);
-        }
-        else
-        {
-            ttlState[eventSourceNodeId] &= ~(1L << eventChannel);
-        }
-        
-        if (nSamples < samplesLeft)
-        {
-            displayBuffer->copyFrom (channelForEventSource[eventSourceNodeId],  // destChannel
-                                     index,                               // destStartSample
-                                     arrayOfOnes,                               // source
-                                     nSamples,                             // numSamples
-                                     float (ttlState[eventSourceNodeId]));      // gain
-        }
-        else
-        {
-            int extraSamples = nSamples - samplesLeft;
-            
-            displayBuffer->copyFrom (channelForEventSource[eventSourceNodeId],  // destChannel
-                                     index,                               // destStartSample
-                                     arrayOfOnes,                               // source
-                                     samplesLeft,                                // numSamples
-                                     float (ttlState[eventSourceNodeId]));      // gain
-            
-            displayBuffer->copyFrom (channelForEventSource[eventSourceNodeId],  // destChannel
-                                     0,                                         // destStartSample
-                                     arrayOfOnes,                               // source
-                                     extraSamples,                                // numSamples
-                                     float (ttlState[eventSourceNodeId]));      // gain
-        }
+        std::map<uint32, int>::const_iterator source = channelForEventSource.find (eventSourceNodeId);
+
+        if (source == channelForEventSource.end())
+            return;
+
+        // written out with the rest of the block by writeEventChannels()
+        TTLChange change;
+        change.chan     = source->second;
+        change.position = samplePosition;
+        change.line     = ttl->getChannel();
+        change.state    = ttl->getState();
+
+        pendingTTLChanges.add (change);
         
         //         std::cout << "Received event from " << eventSourceNodeId
         //                   << " on channel " << eventChannel
@@ -229,65 +320,69 @@ void LfpDisplayNode::handleEvent(const EventChannel* eventInfo, const MidiMessag
 }
 
 
-void LfpDisplayNode::initializeEventChannels()
+int LfpDisplayNode::TTLChangeSorter::compareElements (const TTLChange& first, const TTLChange& second)
 {
-    for (int i = 0; i < eventSourceNodes.size(); ++i)
+    if (first.chan != second.chan)
+        return first.chan - second.chan;
+
+    return first.position - second.position;
+}
+
+void LfpDisplayNode::fillEventChannel (int chan, int index, int from, int to, uint64 state)
+{
+    const int bufferSize = localTap->getNumSamples();
+    const float value = float (state);
+
+    while (from < to)
     {
-        const int chan          = channelForEventSource[eventSourceNodes[i]];
-        const int index         = displayBufferIndex[chan];
-        const int samplesLeft   = displayBuffer->getNumSamples() - index;
-		const int nSamples = getNumSourceSamples(eventSourceNodes[i]);
-        
-        if (nSamples < samplesLeft)
-        {
+        const int start = (index + from) % bufferSize;
+        const int n = jmin (to - from, bufferSize - start);
 
-            displayBuffer->copyFrom (chan,                                      // destChannel
-                                     index,                                     // destStartSample
-                                     arrayOfOnes,                               // source
-                                     nSamples,                                  // numSamples
-                                     float (ttlState[eventSourceNodes[i]]));    // gain
-        }
-        else
-        {
-            int extraSamples = nSamples - samplesLeft;
-
-            displayBuffer->copyFrom (chan,                                      // destChannel
-                                     index,                                     // destStartSample
-                                     arrayOfOnes,                               // source
-                                     samplesLeft,                               // numSamples
-                                     float (ttlState[eventSourceNodes[i]]));    // gain
-
-            displayBuffer->copyFrom (chan,                                      // destChannel
-                                     0,                                         // destStartSample
-                                     arrayOfOnes,                               // source
-                                     extraSamples,                              // numSamples
-                                     float (ttlState[eventSourceNodes[i]]));    // gain
-        }
+        FloatVectorOperations::fill (localTap->getWritePointer (chan) + start, value, n);
+        from += n;
     }
 }
 
-void LfpDisplayNode::finalizeEventChannels()
+void LfpDisplayNode::writeEventChannels()
 {
+    // events normally arrive in order already, in which case this does not move anything
+    TTLChangeSorter sorter;
+    pendingTTLChanges.sort (sorter, true);
+
+    int change = 0;
+
     for (int i = 0; i < eventSourceNodes.size(); ++i)
     {
-        const int chan          = channelForEventSource[eventSourceNodes[i]];
-        const int index         = displayBufferIndex[chan];
-        const int samplesLeft   = displayBuffer->getNumSamples() - index;
-        const int nSamples = getNumSourceSamples(eventSourceNodes[i]);
-        
-        int newIdx = 0;
-        
-        if (nSamples < samplesLeft)
-        {
-            newIdx = index + nSamples;
-        }
-        else
+        const uint32 sourceID   = eventSourceNodes[i];
+        const int chan          = channelForEventSource[sourceID];
+        const int tapChannel    = chan - firstLocalChannel;
+        const int index         = localTap->getWriteIndex (tapChannel);
+        const int nSamples      = getNumSourceSamples (sourceID);
+
+        uint64& state = ttlState[sourceID];
+        int runStart = 0;
+
+        // the channels are in the order of eventSourceNodes, as the changes now are
+        for (; change < pendingTTLChanges.size() && pendingTTLChanges.getReference (change).chan == chan; ++change)
         {
-            newIdx = nSamples - samplesLeft;
+            const TTLChange& c = pendingTTLChanges.getReference (change);
+            const int position = jlimit (runStart, nSamples, c.position);
+
+            fillEventChannel (tapChannel, index, runStart, position, state);
+            runStart = position;
+
+            if (c.state)
+                state |= (uint64 (1) << c.line);
+            else
+                state &= ~(uint64 (1) << c.line);
         }
-        
-        displayBufferIndex.set(chan, newIdx);
+
+        fillEventChannel (tapChannel, index, runStart, nSamples, state);
+
+        localTap->advance (tapChannel, nSamples);
     }
+
+    pendingTTLChanges.clearQuick();
 }
 
 
@@ -296,49 +391,24 @@ void LfpDisplayNode::process (AudioSampleBuffer& buffer)
     // 1. place any new samples into the displayBuffer
     //std::cout << "Display node sample count: " << nSamples << std::endl; ///buffer.getNumSamples() << std::endl;
 
-    ScopedLock displayLock (displayMutex);
-    
-    initializeEventChannels();
+    // offline, blocks come much faster than the display can show them, so only one in a while is kept
+    if (CoreServices::isOfflineProcessing())
+    {
+        const uint32 now = Time::getMillisecondCounter();
+        if (now - lastOfflineUpdate < LFP_OFFLINE_UPDATE_MS)
+            return;
+        lastOfflineUpdate = now;
+    }
+
     checkForEvents (); // see if we got any TTL events
-    finalizeEventChannels();
+    writeEventChannels();
 
+    // shared inputs are written by the processor feeding them
+    if (sharedReader != nullptr)
+        return;
 
-    for (int chan = 0; chan < buffer.getNumChannels(); ++chan)
-    {
-        const int samplesLeft  = displayBuffer->getNumSamples() - displayBufferIndex[chan];
-        const int nSamples     = getNumSamples (chan);
+    const int numChannels = jmin (getNumInputs(), buffer.getNumChannels());
 
-        if (nSamples < samplesLeft)
-        {
-            displayBuffer->copyFrom (chan,                      // destChannel
-                                     displayBufferIndex[chan],  // destStartSample
-                                     buffer,                    // source
-                                     chan,                      // source channel
-                                     0,                         // source start sample
-                                     nSamples);                 // numSamples
-
-            displayBufferIndex.set (chan, displayBufferIndex[chan] + nSamples);
-        }
-        else
-        {
-            const int extraSamples = nSamples - samplesLeft;
-
-            displayBuffer->copyFrom (chan,                      // destChannel
-                                     displayBufferIndex[chan],  // destStartSample
-                                     buffer,                    // source
-                                     chan,                      // source channel
-                                     0,                         // source start sample
-                                     samplesLeft);              // numSamples
-
-            displayBuffer->copyFrom (chan,                      // destChannel
-                                     0,                         // destStartSample
-                                     buffer,                    // source
-                                     chan,                      // source channel
-                                     samplesLeft,               // source start sample
-                                     extraSamples);             // numSamples
-
-            displayBufferIndex.set (chan, extraSamples);
-        }
-    }
+    for (int chan = 0; chan < numChannels; ++chan)
+        localTap->write (chan, buffer.getReadPointer (chan), getNumSamples (chan));
 }
-
@@ -35,8 +35,14 @@ namespace LfpViewer
 
 /**
 
-  Holds data in a displayBuffer to be used by the LfpDisplayCanvas
-  for rendering continuous data streams.
+  Holds the recent samples of its channels, and the states of their TTL lines,
+  to be used by the LfpDisplayCanvas for rendering continuous data streams.
+
+  The samples are kept in display taps, rings written by the processing thread
+  without any lock (see DisplayTap). When only splitters separate it from the
+  processor feeding it, the node reads that processor's own tap, which every
+  other viewer of the same channels shares, and only writes the TTL states to
+  a tap of its own. Otherwise its tap also gets a copy of its inputs.
 
   @see GenericProcessor, LfpDisplayEditor, LfpDisplayCanvas
 
@@ -52,6 +58,15 @@ public:
 
     void process (AudioSampleBuffer& buffer) override;
 
+    /** Only draws its inputs, so it can be skipped when processing can't keep up */
+    bool isDisplayOnly() const override { return true; }
+
+    /** Idle while the canvas is in neither a tab nor a window */
+    bool isIdle() const override;
+
+    /** Adds the display buffer the canvas reads from */
+    int64 getMemoryFootprint() const override;
+
     void setParameter (int parameterIndex, float newValue) override;
 
     void updateSettings() override;
@@ -60,40 +75,85 @@ public:
     bool disable()  override;
 
 	void handleEvent (const EventChannel* eventInfo, const MidiMessage& event, int samplePosition = 0) override;
+    void getEventSubscription (EventSubscription& subscription) const override;
 
-    AudioSampleBuffer* getDisplayBufferAddress() const { return displayBuffer; }
+    /** Stops filling the taps while the canvas is closed */
+    void idleStateChanged (bool isIdle) override;
 
-    int getDisplayBufferIndex (int chan) const { return displayBufferIndex[chan]; }
+    /** Returns the ring holding the recent samples of a display channel, the data
+        channels being followed by one channel per event source */
+    const float* getDisplayBufferChannel (int chan) const;
 
-    CriticalSection* getMutex() { return &displayMutex; }
+    /** Returns the rings of minima and maxima of a display channel at a level of its tap,
+        level 0 being the samples themselves (see DisplayTap) */
+    const float* getDisplayBufferMinima (int chan, int level) const;
+    const float* getDisplayBufferMaxima (int chan, int level) const;
 
+    /** Returns the length of the rings of all the display channels at a level */
+    int getDisplayBufferSize (int level = 0) const;
 
-private:
-    void initializeEventChannels();
-    void finalizeEventChannels();
+    /** Returns the index the next entry of a channel will be written at in a level, the
+        entries before it being complete. Safe to call from any thread. */
+    int getDisplayBufferIndex (int chan, int level = 0) const;
+
+    /** Returns the number of entries written to a channel at a level since its tap was
+        last sized. Reading it before and after reading a range of its ring tells by how
+        much the writer moved meanwhile. Safe to call from any thread. */
+    int64 getDisplayBufferSamplesWritten (int chan, int level = 0) const;
 
-    ScopedPointer<AudioSampleBuffer> displayBuffer;
 
-    Array<int> displayBufferIndex;
+private:
+    /** A TTL line changing state within the current block */
+    struct TTLChange
+    {
+        int chan;           // of the displayBuffer
+        int position;       // in the block
+        int line;
+        bool state;
+    };
+
+    /** Orders the changes by event channel, then by position in the block */
+    struct TTLChangeSorter
+    {
+        static int compareElements (const TTLChange& first, const TTLChange& second);
+    };
+
+    /** Writes the TTL states of the current block to the event channels, filling each run
+        between two changes once, then publishes their write indices */
+    void writeEventChannels();
+
+    /** Fills samples [from, to) of the block starting at index of an event channel */
+    void fillEventChannel (int chan, int index, int from, int to, uint64 state);
+
+    /** Returns the tap holding a display channel, and the channel's index in it */
+    DisplayTap* getTapForChannel (int chan, int& tapChannel) const;
+
+    /** Returns the processor whose tap holds the samples of the inputs, if only splitters
+        lie between them, or nullptr */
+    GenericProcessor* findSharedTapSource() const;
+
+    DisplayTap::Ptr localTap;
+    ScopedPointer<DisplayTap::Reader> localReader;
+    ScopedPointer<DisplayTap::Reader> sharedReader;     // of the source's tap, if shared
+    int firstLocalChannel;                              // the first display channel of localTap
+    int numDisplayChannels;
     Array<uint32> eventSourceNodes;
     std::map<uint32, int> channelForEventSource;
 
     int numEventChannels;
 
     float displayGain; //
-    float bufferLength; // s
 
     AbstractFifo abstractFifo;
 
     int64 bufferTimestamp;
     std::map<uint32, uint64> ttlState;
-    float* arrayOfOnes;
+    Array<TTLChange> pendingTTLChanges;     // received by handleEvent() during the current block
     int totalSamples;
+    uint32 lastOfflineUpdate; // ms counter of the last block displayed while processing offline
 
     bool resizeBuffer();
 
-    CriticalSection displayMutex;
-
 	uint32 getChannelSourceID(const EventChannel* event) const;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LfpDisplayNode);
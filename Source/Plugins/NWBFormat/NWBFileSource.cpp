@@ -0,0 +1,493 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2017 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <H5Cpp.h>
+#include "NWBFileSource.h"
+#include <CoreServicesHeader.h>
+
+using namespace H5;
+using namespace NWBRecording;
+
+#define PROCESS_ERROR std::cerr << "NWBFileSource exception: " << error.getCDetailMsg() << std::endl
+
+//raw chunk reads came with HDF5 1.10.3
+#if H5_VERSION_GE(1, 10, 3)
+ #define NWB_RAW_CHUNKS 1
+#else
+ #define NWB_RAW_CHUNKS 0
+#endif
+
+static int getNumDecodeThreads()
+{
+	return jlimit(1, NWB_MAX_DECODE_THREADS, SystemStats::getNumCpus() - 1);
+}
+
+NWBFileSource::DecodeJob::DecodeJob() : ThreadPoolJob("NWB chunk decoding"), source(nullptr), firstChunk(0), lastChunk(0), failed(false)
+{
+}
+
+ThreadPoolJob::JobStatus NWBFileSource::DecodeJob::runJob()
+{
+	for (int i = firstChunk; i < lastChunk; i++)
+	{
+		if (!source->decodeChunk(i, scratch))
+			failed = true;
+	}
+	return jobHasFinished;
+}
+
+NWBFileSource::NWBFileSource() : samplePos(0), numChannels(0), chunkSamples(1), readBufferSize(0), bufferStart(0), bufferSamples(0),
+	decodeRawChunks(false), shuffled(false), deflated(false), pool(getNumDecodeThreads()), skipRecordEngineCheck(false)
+{
+	//the calling thread decodes its share too
+	for (int i = 0; i <= getNumDecodeThreads(); i++)
+		jobs.add(new DecodeJob());
+}
+
+NWBFileSource::~NWBFileSource()
+{
+	pool.removeAllJobs(true, -1);
+}
+
+bool NWBFileSource::Open(File file)
+{
+	try
+	{
+		ScopedPointer<H5File> tmpFile = new H5File(file.getFullPathName().toUTF8(), H5F_ACC_RDONLY);
+		if (H5Lexists(tmpFile->getId(), "/acquisition", H5P_DEFAULT) <= 0
+			|| H5Lexists(tmpFile->getId(), "/acquisition/timeseries", H5P_DEFAULT) <= 0)
+			return false;
+
+		sourceFile = tmpFile;
+		return true;
+	}
+	catch (Exception error)
+	{
+		PROCESS_ERROR;
+		return false;
+	}
+}
+
+/** Reads a string attribute of an object, or returns an empty string */
+static String readStringAttribute(H5Object& object, const char* name)
+{
+	if (!object.attrExists(name))
+		return String::empty;
+
+	Attribute attr = object.openAttribute(name);
+	H5std_string value;
+	attr.read(attr.getStrType(), value);
+	return String(value.c_str()).trimEnd();
+}
+
+/** The sample rate the timestamps, in seconds, were written at, measured over as many of them as there are up to a limit */
+static float readSampleRate(H5File& file, const String& path)
+{
+	DataSet timestamps = file.openDataSet(path.toUTF8());
+	DataSpace fSpace = timestamps.getSpace();
+	hsize_t dims[1] = { 0 };
+	fSpace.getSimpleExtentDims(dims);
+	if (dims[0] < 2)
+		return 0;
+
+	const hsize_t last = jmin(dims[0] - 1, hsize_t(1 << 20));
+	double values[2];
+	hsize_t count[1] = { 1 };
+	DataSpace mSpace(1, count);
+	hsize_t offset[1] = { 0 };
+
+	fSpace.selectHyperslab(H5S_SELECT_SET, count, offset);
+	timestamps.read(&values[0], PredType::NATIVE_DOUBLE, mSpace, fSpace);
+	offset[0] = last;
+	fSpace.selectHyperslab(H5S_SELECT_SET, count, offset);
+	timestamps.read(&values[1], PredType::NATIVE_DOUBLE, mSpace, fSpace);
+
+	if (values[1] <= values[0])
+		return 0;
+
+	//the timestamps are counts divided by the rate, so whole rates come back out slightly off
+	double rate = double(last) / (values[1] - values[0]);
+	if (std::abs(rate - std::round(rate)) < rate * 1e-6)
+		rate = std::round(rate);
+	return float(rate);
+}
+
+void NWBFileSource::fillRecordInfo()
+{
+	try
+	{
+		Group timeseries = sourceFile->openGroup("/acquisition/timeseries");
+
+		for (int r = 1; ; r++)
+		{
+			const String recordingPath = "/acquisition/timeseries/recording" + String(r);
+			if (H5Lexists(sourceFile->getId(), recordingPath.toUTF8(), H5P_DEFAULT) <= 0)
+				break;
+			if (H5Lexists(sourceFile->getId(), (recordingPath + "/continuous").toUTF8(), H5P_DEFAULT) <= 0)
+				continue;
+
+			Group continuous = sourceFile->openGroup((recordingPath + "/continuous").toUTF8());
+			const int numObjs = int(continuous.getNumObjs());
+
+			for (int i = 0; i < numObjs; i++)
+			{
+				const String name(continuous.getObjnameByIdx(i).c_str());
+				const String path = recordingPath + "/continuous/" + name;
+
+				try
+				{
+					Group series = sourceFile->openGroup(path.toUTF8());
+					DataSet data = sourceFile->openDataSet((path + "/data").toUTF8());
+					hsize_t dims[2] = { 0, 0 };
+					if (data.getSpace().getSimpleExtentNdims() != 2)
+						continue;
+					data.getSpace().getSimpleExtentDims(dims);
+
+					RecordInfo info;
+					info.name = "Recording " + String(r) + " " + name;
+					info.numSamples = int64(dims[0]);
+					info.sampleRate = readSampleRate(*sourceFile, path + "/timestamps");
+
+					//only set once the recording was closed, the dataset being larger while it's written
+					if (series.attrExists("num_samples"))
+					{
+						uint64 numSamples = 0;
+						series.openAttribute("num_samples").read(PredType::NATIVE_UINT64, &numSamples);
+						info.numSamples = jmin(info.numSamples, int64(numSamples));
+					}
+
+					float bitVolts = 1.0f;
+					if (data.attrExists("conversion"))
+						data.openAttribute("conversion").read(PredType::NATIVE_FLOAT, &bitVolts);
+
+					for (hsize_t c = 0; c < dims[1]; c++)
+					{
+						RecordedChannelInfo chan;
+						chan.name = "CH" + String(c + 1);
+						chan.bitVolts = bitVolts;
+
+						const String channelPath = path + "/oe_extra_info/channel" + String(c + 1);
+						if (H5Lexists(sourceFile->getId(), (path + "/oe_extra_info").toUTF8(), H5P_DEFAULT) > 0
+							&& H5Lexists(sourceFile->getId(), channelPath.toUTF8(), H5P_DEFAULT) > 0)
+						{
+							Group channel = sourceFile->openGroup(channelPath.toUTF8());
+							String channelName = readStringAttribute(channel, "name");
+							if (channelName.isNotEmpty())
+								chan.name = channelName;
+						}
+						info.channels.add(chan);
+					}
+
+					if (info.sampleRate <= 0 || info.channels.size() == 0)
+						continue;
+
+					infoArray.add(info);
+					recordPaths.add(path + "/data");
+					numRecords++;
+				}
+				catch (Exception error)
+				{
+					PROCESS_ERROR;
+				}
+			}
+		}
+	}
+	catch (Exception error)
+	{
+		PROCESS_ERROR;
+	}
+}
+
+void NWBFileSource::updateActiveRecord()
+{
+	samplePos = 0;
+	bufferSamples = 0;
+	numChannels = getActiveNumChannels();
+	decodeRawChunks = false;
+
+	try
+	{
+		dataSet = new DataSet(sourceFile->openDataSet(recordPaths[activeRecord.get()].toUTF8()));
+
+		chunkSamples = 1;
+		int chunkChannels = numChannels;
+		DSetCreatPropList createProps = dataSet->getCreatePlist();
+		if (createProps.getLayout() == H5D_CHUNKED)
+		{
+			hsize_t chunkDims[2];
+			createProps.getChunk(2, chunkDims);
+			chunkSamples = jmax(hsize_t(1), chunkDims[0]);
+			chunkChannels = int(chunkDims[1]);
+		}
+
+		//chunks of every channel, stored as int16, through no filter but gzip and shuffle, can be decoded here
+		shuffled = false;
+		deflated = false;
+		bool knownFilters = true;
+		for (int f = 0; f < createProps.getNfilters(); f++)
+		{
+			unsigned int flags;
+			size_t numValues = 0;
+			unsigned int filterConfig;
+			char name[64];
+			H5Z_filter_t filter = createProps.getFilter(f, flags, numValues, nullptr, sizeof(name), name, filterConfig);
+			if (filter == H5Z_FILTER_SHUFFLE)
+				shuffled = true;
+			else if (filter == H5Z_FILTER_DEFLATE)
+				deflated = true;
+			else
+				knownFilters = false;
+		}
+
+		decodeRawChunks = NWB_RAW_CHUNKS && createProps.getLayout() == H5D_CHUNKED && knownFilters
+			&& chunkChannels == numChannels && dataSet->getDataType().getSize() == sizeof(int16);
+
+		const int64 readChunks = (NWB_MIN_READ_SAMPLES + chunkSamples - 1) / chunkSamples;
+		readBufferSize = readChunks * chunkSamples;
+		readBuffer.malloc(size_t(readBufferSize) * jmax(1, numChannels));
+
+		rawChunks.clear();
+		rawFilterMasks.clearQuick();
+		if (decodeRawChunks)
+		{
+			for (int i = 0; i < readChunks; i++)
+			{
+				rawChunks.add(new MemoryBlock());
+				rawFilterMasks.add(0);
+			}
+		}
+	}
+	catch (Exception error)
+	{
+		PROCESS_ERROR;
+	}
+}
+
+void NWBFileSource::seekTo(int64 sample)
+{
+	//an empty recording has no position to wrap around
+	const int64 numSamples = getActiveNumSamples();
+	samplePos = (numSamples > 0) ? sample % numSamples : 0;
+}
+
+int NWBFileSource::readData(int16* buffer, int nSamples)
+{
+	int samplesToRead = int(jmin(int64(nSamples), getActiveNumSamples() - samplePos));
+
+	//reads go through whole chunks, so chunks straddling two refills aren't decoded twice
+	int samplesRead = 0;
+	while (samplesRead < samplesToRead)
+	{
+		if (samplePos < bufferStart || samplePos >= bufferStart + bufferSamples)
+		{
+			if (!fillReadBuffer(samplePos))
+				break;
+		}
+
+		const int n = int(jmin(int64(samplesToRead - samplesRead), bufferStart + bufferSamples - samplePos));
+		memcpy(buffer + size_t(samplesRead) * numChannels, readBuffer + size_t(samplePos - bufferStart) * numChannels,
+			size_t(n) * numChannels * sizeof(int16));
+		samplesRead += n;
+		samplePos += n;
+	}
+	return samplesRead;
+}
+
+bool NWBFileSource::fillReadBuffer(int64 sample)
+{
+	if (dataSet == nullptr)
+		return false;
+
+	bufferStart = sample - (sample % chunkSamples);
+	bufferSamples = jmin(readBufferSize, getActiveNumSamples() - bufferStart);
+
+	if (decodeRawChunks)
+	{
+		if (readRawChunks(int((bufferSamples + chunkSamples - 1) / chunkSamples)))
+			return true;
+
+		//anything unexpected in the raw chunks is left to the library from then on
+		std::cerr << "NWBFileSource: could not decode the chunks of " << recordPaths[activeRecord.get()] << " raw" << std::endl;
+		decodeRawChunks = false;
+	}
+
+	try
+	{
+		DataSpace fSpace = dataSet->getSpace();
+		hsize_t dim[2] = { hsize_t(bufferSamples), hsize_t(numChannels) };
+		hsize_t offset[2] = { hsize_t(bufferStart), 0 };
+
+		fSpace.selectHyperslab(H5S_SELECT_SET, dim, offset);
+		DataSpace mSpace(2, dim);
+
+		dataSet->read(readBuffer.getData(), PredType::NATIVE_INT16, mSpace, fSpace);
+		return true;
+	}
+	catch (Exception error)
+	{
+		PROCESS_ERROR;
+	}
+	bufferSamples = 0;
+	return false;
+}
+
+bool NWBFileSource::readRawChunks(int numChunks)
+{
+#if NWB_RAW_CHUNKS
+	//the library only does the reads, which it can't do from several threads anyway
+	for (int i = 0; i < numChunks; i++)
+	{
+		hsize_t offset[2] = { hsize_t(bufferStart + i * chunkSamples), 0 };
+		hsize_t chunkBytes = 0;
+		if (H5Dget_chunk_storage_size(dataSet->getId(), offset, &chunkBytes) < 0)
+			return false;
+
+		MemoryBlock& raw = *rawChunks[i];
+		raw.ensureSize(size_t(chunkBytes));
+		//a chunk never written reads as its fill value, zeros, which a full mask stands for
+		uint32_t filterMask = 0xFFFFFFFF;
+		if (chunkBytes > 0 && H5Dread_chunk(dataSet->getId(), H5P_DEFAULT, offset, &filterMask, raw.getData()) < 0)
+			return false;
+		rawFilterMasks.set(i, uint32(filterMask));
+	}
+
+	const int numJobs = jlimit(1, jobs.size(), numChunks);
+	for (int j = 0; j < numJobs; j++)
+	{
+		DecodeJob* job = jobs[j];
+		job->source = this;
+		job->firstChunk = numChunks * j / numJobs;
+		job->lastChunk = numChunks * (j + 1) / numJobs;
+		job->failed = false;
+
+		if (j > 0)
+			pool.addJob(job, false);
+	}
+
+	jobs[0]->runJob();
+
+	bool failed = jobs[0]->failed;
+	for (int j = 1; j < numJobs; j++)
+	{
+		pool.waitForJobToFinish(jobs[j], -1);
+		failed = failed || jobs[j]->failed;
+	}
+	return !failed;
+#else
+	ignoreUnused(numChunks);
+	return false;
+#endif
+}
+
+bool NWBFileSource::decodeChunk(int i, MemoryBlock& scratch)
+{
+	const size_t chunkBytes = size_t(chunkSamples) * numChannels * sizeof(int16);
+	int16* dest = readBuffer + size_t(i) * chunkSamples * numChannels;
+	const uint32 filterMask = rawFilterMasks[i];
+
+	if (filterMask == 0xFFFFFFFF)
+	{
+		zeromem(dest, chunkBytes);
+		return true;
+	}
+
+	//bit n of the mask is set when filter n of the pipeline, shuffle coming before gzip, was skipped for this chunk
+	const bool chunkShuffled = shuffled && (filterMask & 1) == 0;
+	const bool chunkDeflated = deflated && (filterMask & (shuffled ? 2 : 1)) == 0;
+
+	const MemoryBlock& raw = *rawChunks[i];
+	if (chunkShuffled)
+		scratch.ensureSize(chunkBytes);
+	void* unpacked = chunkShuffled ? scratch.getData() : static_cast<void*>(dest);
+
+	if (chunkDeflated)
+	{
+		MemoryInputStream compressed(raw, false);
+		GZIPDecompressorInputStream inflater(compressed);
+		if (inflater.read(unpacked, int(chunkBytes)) != int(chunkBytes))
+			return false;
+	}
+	else
+	{
+		if (raw.getSize() < chunkBytes)
+			return false;
+		memcpy(unpacked, raw.getData(), chunkBytes);
+	}
+
+	if (chunkShuffled)
+	{
+		//the low bytes of every sample come first, then the high bytes
+		const uint8* bytes = static_cast<const uint8*>(unpacked);
+		const size_t count = chunkBytes / sizeof(int16);
+		uint8* out = reinterpret_cast<uint8*>(dest);
+		for (size_t s = 0; s < count; s++)
+		{
+			out[2 * s] = bytes[s];
+			out[2 * s + 1] = bytes[count + s];
+		}
+	}
+
+	return true;
+}
+
+void NWBFileSource::processChannelData(int16* inBuffer, float* outBuffer, int channel, int64 numSamples)
+{
+	float bitVolts = getChannelInfo(channel).bitVolts;
+
+	for (int i = 0; i < numSamples; i++)
+	{
+		*(outBuffer + i) = *(inBuffer + (numChannels * i) + channel) * bitVolts;
+	}
+}
+
+void NWBFileSource::processAllChannelsData(int16* inBuffer, float* const* outBuffers, int64 numSamples)
+{
+	deinterleaveChannels(inBuffer, outBuffers, activeBitVolts.getRawDataPointer(), numChannels, numSamples);
+}
+
+bool NWBFileSource::canBeReadConcurrently() const
+{
+	//the HDF5 library isn't built thread-safe
+	return false;
+}
+
+bool NWBFileSource::isReady()
+{
+	//the NWB engine writes through the same, not thread-safe, HDF5 library
+	if (skipRecordEngineCheck || CoreServices::getSelectedRecordEngineId() != "NWB")
+		return true;
+
+	int res = AlertWindow::showYesNoCancelBox(AlertWindow::WarningIcon, "Record format conflict",
+		"Both the selected input file for the File Reader and the output file format for recording use the HDF5 library, "
+		"which is not thread safe unless built to be. Running both at the same time might crash.\n\n"
+		"Do you want to continue acquisition?", "Yes", "Yes and don't ask again", "No");
+	switch (res)
+	{
+	case 2:
+		skipRecordEngineCheck = true;
+	case 1:
+		return true;
+	default:
+		return false;
+	}
+}
@@ -0,0 +1,122 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2017 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef NWBFILESOURCE_H
+#define NWBFILESOURCE_H
+
+#include <FileSourceHeaders.h>
+
+//least number of samples read from the file at once, rounded up to whole chunks
+#define NWB_MIN_READ_SAMPLES 16384
+#define NWB_MAX_DECODE_THREADS 4
+
+namespace H5
+{
+	class DataSet;
+	class H5File;
+}
+
+namespace NWBRecording
+{
+	/** Reads the continuous data of the NWB files written by NWBFile in the File Reader.
+
+	Every processor group under /acquisition/timeseries/recording<N>/continuous is a record: its int16
+	data scaled by the conversion attribute, the channel names kept in oe_extra_info, and the sample rate
+	worked out from the timestamps.
+
+	The data is read in spans of whole chunks, which each hold every channel of a run of samples in the
+	interleaved layout the File Reader expects. Chunks stored plain or through the gzip and shuffle filters
+	are read raw, the I/O being all the HDF5 library is asked for, and decoded on a few threads at once.
+	Any other filter, such as LZ4 or zstd through the HDF5 filter plugins, is left to the library.*/
+	class NWBFileSource : public FileSource
+	{
+	public:
+		NWBFileSource();
+		~NWBFileSource();
+
+		int readData(int16* buffer, int nSamples) override;
+		void seekTo(int64 sample) override;
+		void processChannelData(int16* inBuffer, float* outBuffer, int channel, int64 numSamples) override;
+		void processAllChannelsData(int16* inBuffer, float* const* outBuffers, int64 numSamples) override;
+		bool isReady() override;
+		bool canBeReadConcurrently() const override;
+
+	private:
+		bool Open(File file) override;
+		void fillRecordInfo() override;
+		void updateActiveRecord() override;
+
+		class DecodeJob : public ThreadPoolJob
+		{
+		public:
+			DecodeJob();
+			JobStatus runJob() override;
+
+			NWBFileSource* source;
+			int firstChunk;
+			int lastChunk;
+			bool failed;
+			MemoryBlock scratch;
+		};
+
+		/** Reads the whole chunks holding sample into readBuffer. Returns false on error */
+		bool fillReadBuffer(int64 sample);
+
+		/** Reads the raw chunks of the span, then decodes them on the pool */
+		bool readRawChunks(int numChunks);
+
+		/** Decodes raw chunk i into its place in readBuffer */
+		bool decodeChunk(int i, MemoryBlock& scratch);
+
+		ScopedPointer<H5::H5File> sourceFile;
+		ScopedPointer<H5::DataSet> dataSet;
+		StringArray recordPaths;
+
+		int64 samplePos;
+		int numChannels;
+
+		/** Samples per chunk of the active dataset */
+		int64 chunkSamples;
+		/** Chunk-aligned samples [bufferStart, bufferStart + bufferSamples) of the active dataset */
+		HeapBlock<int16> readBuffer;
+		int64 readBufferSize;
+		int64 bufferStart;
+		int64 bufferSamples;
+
+		/** Set when the chunks of the active dataset can be read raw and decoded here */
+		bool decodeRawChunks;
+		bool shuffled;
+		bool deflated;
+		OwnedArray<MemoryBlock> rawChunks;
+		Array<uint32> rawFilterMasks;
+
+		ThreadPool pool;
+		OwnedArray<DecodeJob> jobs;
+
+		bool skipRecordEngineCheck;
+
+		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(NWBFileSource);
+	};
+}
+
+#endif
@@ -24,12 +24,13 @@
  #include "NWBFormat.h"
  using namespace NWBRecording;
 
+//events and spikes are written in bulk, so their datasets take a good number of records per chunk
 #ifndef EVENT_CHUNK_SIZE
-#define EVENT_CHUNK_SIZE 8
+#define EVENT_CHUNK_SIZE 256
 #endif
 
 #ifndef SPIKE_CHUNK_XSIZE
-#define SPIKE_CHUNK_XSIZE 8
+#define SPIKE_CHUNK_XSIZE 64
 #endif
 
 #ifndef SPIKE_CHUNK_YSIZE
@@ -46,6 +47,9 @@
 	 scaledBuffer.malloc(MAX_BUFFER_SIZE);
 	 intBuffer.malloc(MAX_BUFFER_SIZE);
 	 bufferSize = MAX_BUFFER_SIZE;
+	 spikeScaledBuffer.malloc(MAX_BUFFER_SIZE);
+	 spikeIntBuffer.malloc(MAX_BUFFER_SIZE);
+	 spikeBufferSize = MAX_BUFFER_SIZE;
  }
  
  NWBFile::~NWBFile()
@@ -129,7 +133,7 @@ bool NWBFile::startNewRecording(int recordingNumber, const Array<ContinuousGroup
 		 if (!createTimeSeriesBase(basePath, name, "Stores acquired voltage data from extracellular recordings", "", ancestry)) return false;
 		 tsStruct = new TimeSeries();
 		 tsStruct->basePath = basePath;
-		 dSet = createDataSet(BaseDataType::I16, 0, continuousArray.getReference(i).size(), CHUNK_XSIZE, basePath + "/data");
+		 dSet = createContinuousDataSet(BaseDataType::I16, 0, continuousArray.getReference(i).size(), getContinuousChunkSize(), basePath + "/data");
 		 if (dSet == nullptr)
 		 {
 			 std::cerr << "Error creating dataset for " << name << std::endl;
@@ -140,8 +144,9 @@ bool NWBFile::startNewRecording(int recordingNumber, const Array<ContinuousGroup
 			 createDataAttributes(basePath, info->getBitVolts(), info->getBitVolts() / 65536, info->getDataUnits());
 		 }
 		 tsStruct->baseDataSet = dSet;
+		 tsStruct->pendingData.setNumChannels(continuousArray.getReference(i).size());
 
-		 dSet = createTimestampDataSet(basePath, CHUNK_XSIZE);
+		 dSet = createTimestampDataSet(basePath, getContinuousChunkSize());
 		 if (dSet == nullptr) return false;
 		 tsStruct->timestampDataSet = dSet;
 
@@ -187,6 +192,8 @@ bool NWBFile::startNewRecording(int recordingNumber, const Array<ContinuousGroup
 		 dSet = createTimestampDataSet(basePath, SPIKE_CHUNK_XSIZE);
 		 if (dSet == nullptr) return false;
 		 tsStruct->timestampDataSet = dSet;
+		 tsStruct->baseBuffer.setDataSet(tsStruct->baseDataSet, BaseDataType::I16, info->getNumChannels() * info->getTotalSamples() * sizeof(int16));
+		 tsStruct->timestampBuffer.setDataSet(tsStruct->timestampDataSet, BaseDataType::F64, sizeof(double));
 
 		 basePath = basePath + "/oe_extra_info";
 		 createExtraInfo(basePath, info->getName(), info->getDescription(), info->getIdentifier(), info->getSourceIndex(), info->getSourceTypeIndex());
@@ -275,8 +282,25 @@ bool NWBFile::startNewRecording(int recordingNumber, const Array<ContinuousGroup
 			 dSet = createDataSet(BaseDataType::U8, 0, info->getDataSize(), EVENT_CHUNK_SIZE, basePath + "/full_word");
 			 if (dSet == nullptr) return false;
 			 tsStruct->ttlWordDataSet = dSet;
+			 tsStruct->ttlWordBuffer.setDataSet(tsStruct->ttlWordDataSet, BaseDataType::U8, info->getDataSize());
 		 }
 
+		 //the records as writeEvent lays them out
+		 switch (info->getChannelType())
+		 {
+		 case EventChannel::TTL:
+			 tsStruct->baseBuffer.setDataSet(tsStruct->baseDataSet, BaseDataType::I8, sizeof(int8));
+			 break;
+		 case EventChannel::TEXT:
+			 tsStruct->baseBuffer.setDataSet(tsStruct->baseDataSet, BaseDataType::STR(info->getLength()), info->getLength());
+			 break;
+		 default:
+			 tsStruct->baseBuffer.setDataSet(tsStruct->baseDataSet, getEventH5Type(info->getChannelType()), info->getDataSize());
+			 break;
+		 }
+		 tsStruct->timestampBuffer.setDataSet(tsStruct->timestampDataSet, BaseDataType::F64, sizeof(double));
+		 tsStruct->controlBuffer.setDataSet(tsStruct->controlDataSet, BaseDataType::U8, sizeof(uint8));
+
 		 basePath = basePath + "/oe_extra_info";
 		 createExtraInfo(basePath, info->getName(), info->getDescription(), info->getIdentifier(), info->getSourceIndex(), info->getSourceTypeIndex());
 		 createChannelMetaDataSets(basePath + "/channel_metadata", info);
@@ -312,37 +336,54 @@ bool NWBFile::startNewRecording(int recordingNumber, const Array<ContinuousGroup
 	 tsStruct->controlDataSet = dSet;
 	 syncMsgDataSet = tsStruct;
 
+	 //every object of the recording exists by now, so readers can be let in
+	 if (getStorageSettings().swmr)
+		 CHECK_ERROR(startSWMRWrite());
+
 	 return true;
  }
  
  void NWBFile::stopRecording()
  {
-	 int nObjs = continuousDataSets.size();
-	 const TimeSeries* tsStruct;
-	 for (int i = 0; i < nObjs; i++)
-	 {
-		 tsStruct = continuousDataSets[i];
-		 CHECK_ERROR(setAttribute(BaseDataType::U64, &(tsStruct->numSamples), tsStruct->basePath, "num_samples"));
-	 }
-	 nObjs = spikeDataSets.size();
-	 for (int i = 0; i < nObjs; i++)
-	 {
-		 tsStruct = spikeDataSets[i];
-		 CHECK_ERROR(setAttribute(BaseDataType::U64, &(tsStruct->numSamples), tsStruct->basePath, "num_samples"));
-	 }
-	 nObjs = eventDataSets.size();
-	 for (int i = 0; i < nObjs; i++)
+	 writeBufferedData();
+	 flushRecords();
+
+	 StringArray paths;
+	 Array<uint64> numSamples;
+	 const OwnedArray<TimeSeries>* seriesArrays[] = { &continuousDataSets, &spikeDataSets, &eventDataSets };
+	 for (int a = 0; a < 3; a++)
 	 {
-		 tsStruct = eventDataSets[i];
-		 CHECK_ERROR(setAttribute(BaseDataType::U64, &(tsStruct->numSamples), tsStruct->basePath, "num_samples"));
+		 for (int i = 0; i < seriesArrays[a]->size(); i++)
+		 {
+			 const TimeSeries* tsStruct = seriesArrays[a]->getUnchecked(i);
+			 paths.add(tsStruct->basePath);
+			 numSamples.add(tsStruct->numSamples);
+		 }
 	 }
-	 
-	 CHECK_ERROR(setAttribute(BaseDataType::U64, &(syncMsgDataSet->numSamples), syncMsgDataSet->basePath, "num_samples"));
+	 paths.add(syncMsgDataSet->basePath);
+	 numSamples.add(syncMsgDataSet->numSamples);
 
 	 continuousDataSets.clear();
 	 spikeDataSets.clear();
 	 eventDataSets.clear();
 	 syncMsgDataSet = nullptr;
+
+	 //no attribute can be created in SWMR mode, so the file is reopened normally to add them
+	 if (isSWMRActive())
+	 {
+		 close();
+		 if (open())
+		 {
+			 std::cerr << "Error reopening " << filename << ", the num_samples attributes are missing" << std::endl;
+			 return;
+		 }
+	 }
+
+	 for (int i = 0; i < paths.size(); i++)
+	 {
+		 uint64 n = numSamples[i];
+		 CHECK_ERROR(setAttribute(BaseDataType::U64, &n, paths[i], "num_samples"));
+	 }
  }
  
  void NWBFile::writeData(int datasetID, int channel, int nSamples, const float* data, float bitVolts)
@@ -362,7 +403,7 @@ bool NWBFile::startNewRecording(int recordingNumber, const Array<ContinuousGroup
 	 FloatVectorOperations::copyWithMultiply(scaledBuffer.getData(), data, multFactor, nSamples);
 	 AudioDataConverters::convertFloatToInt16LE(scaledBuffer.getData(), intBuffer.getData(), nSamples);
 
-	 CHECK_ERROR(continuousDataSets[datasetID]->baseDataSet->writeDataRow(channel, nSamples, BaseDataType::I16, intBuffer));
+	 continuousDataSets[datasetID]->pendingData.addSamples(channel, intBuffer, nSamples);
 	 
 	 /* Since channels are filled asynchronouysly by the Record Thread, there is no guarantee
 		that at a any point in time all channels in a dataset have the same number of filled samples.
@@ -374,6 +415,21 @@ bool NWBFile::startNewRecording(int recordingNumber, const Array<ContinuousGroup
 		 continuousDataSets[datasetID]->numSamples += nSamples;
  }
 
+ void NWBFile::writeBufferedData(HDF5WriteThread* writer)
+ {
+	 int nObjs = continuousDataSets.size();
+	 for (int i = 0; i < nObjs; i++)
+	 {
+		 TimeSeries* tsStruct = continuousDataSets[i];
+		 if (!tsStruct)
+			 continue;
+		 if (writer)
+			 tsStruct->pendingData.write(*writer, tsStruct->baseDataSet);
+		 else
+			 CHECK_ERROR(tsStruct->pendingData.writeNow(tsStruct->baseDataSet));
+	 }
+ }
+
  void NWBFile::writeTimestamps(int datasetID, int nSamples, const double* data)
  {
 	 if (!continuousDataSets[datasetID])
@@ -388,22 +444,22 @@ bool NWBFile::startNewRecording(int recordingNumber, const Array<ContinuousGroup
 		 return;
 	 int nSamples = channel->getTotalSamples() * channel->getNumChannels();
 
-	 if (nSamples > bufferSize) //Shouldn't happen, and if it happens it'll be slow, but better this than crashing. Will be reset on file close and reset.
+	 if (size_t(nSamples) > spikeBufferSize) //Shouldn't happen, and if it happens it'll be slow, but better this than crashing. Will be reset on file close and reset.
 	 {
 		 std::cerr << "Write buffer overrun, resizing to" << nSamples << std::endl;
-		 bufferSize = nSamples;
-		 scaledBuffer.malloc(nSamples);
-		 intBuffer.malloc(nSamples);
+		 spikeBufferSize = nSamples;
+		 spikeScaledBuffer.malloc(nSamples);
+		 spikeIntBuffer.malloc(nSamples);
 	 }
 
 	 double multFactor = 1 / (float(0x7fff) * channel->getChannelBitVolts(0));
-	 FloatVectorOperations::copyWithMultiply(scaledBuffer.getData(), event->getDataPointer(), multFactor, nSamples);
-	 AudioDataConverters::convertFloatToInt16LE(scaledBuffer.getData(), intBuffer.getData(), nSamples);
+	 FloatVectorOperations::copyWithMultiply(spikeScaledBuffer.getData(), event->getDataPointer(), multFactor, nSamples);
+	 AudioDataConverters::convertFloatToInt16LE(spikeScaledBuffer.getData(), spikeIntBuffer.getData(), nSamples);
 
 	 double timestampSec = event->getTimestamp() / channel->getSampleRate();
 
-	 CHECK_ERROR(spikeDataSets[electrodeId]->baseDataSet->writeDataBlock(1, BaseDataType::I16, intBuffer));
-	 CHECK_ERROR(spikeDataSets[electrodeId]->timestampDataSet->writeDataBlock(1, BaseDataType::F64, &timestampSec));
+	 CHECK_ERROR(spikeDataSets[electrodeId]->baseBuffer.add(spikeIntBuffer));
+	 CHECK_ERROR(spikeDataSets[electrodeId]->timestampBuffer.add(&timestampSec));
 	 writeEventMetaData(spikeDataSets[electrodeId], channel, event);
 
 	 spikeDataSets[electrodeId]->numSamples += 1;
@@ -416,45 +472,70 @@ bool NWBFile::startNewRecording(int recordingNumber, const Array<ContinuousGroup
 		 return;
 	 
 	 const void* dataSrc;
-	 BaseDataType type;
 	 int8 ttlVal;
-	 String text;
+	 MemoryBlock text;
 
 	 switch (event->getEventType())
 	 {
 	 case EventChannel::TTL:
 		 ttlVal = (static_cast<const TTLEvent*>(event)->getState() ? 1 : -1) * (event->getChannel() + 1);
 		 dataSrc = &ttlVal;
-		 type = BaseDataType::I8;
 		 break;
 	 case EventChannel::TEXT:
-		 text = static_cast<const TextEvent*>(event)->getText();
-		 dataSrc = text.toUTF8().getAddress();
-		 type = BaseDataType::STR(text.length());
+	 {
+		 //buffered records are all as long as the dataset's strings
+		 String eventText = static_cast<const TextEvent*>(event)->getText();
+		 text.setSize(channel->getLength(), true);
+		 text.copyFrom(eventText.toUTF8().getAddress(), 0, jmin(size_t(channel->getLength()), eventText.getNumBytesAsUTF8()));
+		 dataSrc = text.getData();
 		 break;
+	 }
 	 default:
 		 dataSrc = static_cast<const BinaryEvent*>(event)->getBinaryDataPointer();
-		 type = getEventH5Type(event->getEventType());
 		 break;
 	 }
-	 CHECK_ERROR(eventDataSets[eventID]->baseDataSet->writeDataBlock(1, type, dataSrc));
+	 CHECK_ERROR(eventDataSets[eventID]->baseBuffer.add(dataSrc));
 
 	 double timeSec = event->getTimestamp() / channel->getSampleRate();
 
-	 CHECK_ERROR(eventDataSets[eventID]->timestampDataSet->writeDataBlock(1, BaseDataType::F64, &timeSec));
+	 CHECK_ERROR(eventDataSets[eventID]->timestampBuffer.add(&timeSec));
 
 	 uint8 controlValue = event->getChannel() + 1;
 
-	 CHECK_ERROR(eventDataSets[eventID]->controlDataSet->writeDataBlock(1, BaseDataType::U8, &controlValue));
+	 CHECK_ERROR(eventDataSets[eventID]->controlBuffer.add(&controlValue));
 
 	 if (event->getEventType() == EventChannel::TTL)
 	 {
-		 CHECK_ERROR(eventDataSets[eventID]->ttlWordDataSet->writeDataBlock(1, BaseDataType::U8, static_cast<const TTLEvent*>(event)->getTTLWordPointer()));
+		 CHECK_ERROR(eventDataSets[eventID]->ttlWordBuffer.add(static_cast<const TTLEvent*>(event)->getTTLWordPointer()));
 	 }
 	 
 	 eventDataSets[eventID]->numSamples += 1;
  }
 
+ void NWBFile::flushRecords()
+ {
+	 for (int i = 0; i < spikeDataSets.size(); i++)
+	 {
+		 if (spikeDataSets[i])
+			 spikeDataSets[i]->flushRecords();
+	 }
+	 for (int i = 0; i < eventDataSets.size(); i++)
+	 {
+		 if (eventDataSets[i])
+			 eventDataSets[i]->flushRecords();
+	 }
+ }
+
+ void TimeSeries::flushRecords()
+ {
+	 CHECK_ERROR(baseBuffer.flush());
+	 CHECK_ERROR(timestampBuffer.flush());
+	 CHECK_ERROR(controlBuffer.flush());
+	 CHECK_ERROR(ttlWordBuffer.flush());
+	 for (int i = 0; i < metaDataBuffers.size(); i++)
+		 CHECK_ERROR(metaDataBuffers[i]->flush());
+ }
+
  void NWBFile::writeTimestampSyncText(uint16 sourceID, int64 timestamp, float sourceSampleRate, String text)
  {
 	 CHECK_ERROR(syncMsgDataSet->baseDataSet->writeDataBlock(1, BaseDataType::STR(text.length()), text.toUTF8()));
@@ -551,6 +632,7 @@ bool NWBFile::startNewRecording(int recordingNumber, const Array<ContinuousGroup
 	  CHECK_ERROR(setAttributeStr("openephys:<metadata>/", basePath, "schema_id"));
 	  int nMetaData = info->getEventMetaDataCount();
 
+	  timeSeries->metaDataBuffers.clear();
 	  timeSeries->metaDataSet.clear(); //just in case
 	  for (int i = 0; i < nMetaData; i++)
 	  {
@@ -565,6 +647,9 @@ bool NWBFile::startNewRecording(int recordingNumber, const Array<ContinuousGroup
 		  HDF5RecordingData* dSet = createDataSet(type, 0, length, EVENT_CHUNK_SIZE, fullPath);
 		  if (!dSet) return false;
 		  timeSeries->metaDataSet.add(dSet);
+		  HDF5RecordBuffer* buffer = new HDF5RecordBuffer();
+		  buffer->setDataSet(dSet, type, desc->getDataSize());
+		  timeSeries->metaDataBuffers.add(buffer);
 
 		  CHECK_ERROR(setAttributeStr("openephys:<metadata>/", fullPath, "schema_id"));
 		  CHECK_ERROR(setAttributeStr(name, fullPath, "name"));
@@ -576,13 +661,12 @@ bool NWBFile::startNewRecording(int recordingNumber, const Array<ContinuousGroup
 
   void NWBFile::writeEventMetaData(TimeSeries* timeSeries, const MetaDataEventObject* info, const MetaDataEvent* event)
   {
-	  jassert(timeSeries->metaDataSet.size() == event->getMetadataValueCount());
+	  jassert(timeSeries->metaDataBuffers.size() == event->getMetadataValueCount());
 	  jassert(info->getEventMetaDataCount() == event->getMetadataValueCount());
 	  int nMetaData = event->getMetadataValueCount();
 	  for (int i = 0; i < nMetaData; i++)
 	  {
-		  BaseDataType type = getMetaDataH5Type(info->getEventMetaDataDescriptor(i)->getType(), info->getEventMetaDataDescriptor(i)->getLength());
-		  timeSeries->metaDataSet[i]->writeDataBlock(1, type, event->getMetaDataValue(i)->getRawValuePointer());
+		  timeSeries->metaDataBuffers[i]->add(event->getMetaDataValuePointer(i));
 	  }
 
   }
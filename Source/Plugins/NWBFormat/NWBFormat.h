@@ -25,6 +25,7 @@
 #define NWBFORMAT_H
 
 #include <OpenEphysHDF5Lib/HDF5FileFormat.h>
+#include <OpenEphysHDF5Lib/HDF5WriteThread.h>
 #include <RecordingLib.h>
 using namespace OpenEphysHDF5;
 
@@ -41,6 +42,17 @@ namespace NWBRecording
 		OwnedArray<HDF5RecordingData> metaDataSet;
 		String basePath;
 		uint64 numSamples{ 0 };
+		/** Continuous samples waiting to be written to baseDataSet in a single block */
+		HDF5DoubleBlockBuffer pendingData;
+		/** Event and spike records waiting to be written, many at a time, to each of the datasets */
+		HDF5RecordBuffer baseBuffer;
+		HDF5RecordBuffer timestampBuffer;
+		HDF5RecordBuffer controlBuffer;
+		HDF5RecordBuffer ttlWordBuffer;
+		OwnedArray<HDF5RecordBuffer> metaDataBuffers;
+
+		/** Writes the buffered event and spike records */
+		void flushRecords();
 	};
 
 	class NWBFile : public HDF5FileBase
@@ -52,10 +64,15 @@ namespace NWBRecording
 			const Array<const EventChannel*>& eventArray, const Array<const SpikeChannel*>& electrodeArray);
 		void stopRecording();
 		void writeData(int datasetID, int channel, int nSamples, const float* data, float bitVolts);
+		/** Writes the continuous samples gathered by writeData since the last call, a single block per dataset.
+		With a writer, the writes are handed over to it and writeData goes on filling a second buffer */
+		void writeBufferedData(HDF5WriteThread* writer = nullptr);
 		void writeTimestamps(int datasetID, int nSamples, const double* data);
 		void writeSpike(int electrodeId, const SpikeChannel* channel, const SpikeEvent* event);
 		void writeEvent(int eventID, const EventChannel* channel, const Event* event);
 		void writeTimestampSyncText(uint16 sourceID, int64 timestamp, float sourceSampleRate, String text);
+		/** Writes the event and spike records buffered so far. They're otherwise written once thousands have gathered, or on stopRecording() */
+		void flushRecords();
 		String getFileName() override;
 		void setXmlText(const String& xmlText);
 
@@ -93,6 +110,10 @@ namespace NWBRecording
 		HeapBlock<float> scaledBuffer;
 		HeapBlock<int16> intBuffer;
 		size_t bufferSize;
+		//writeSpike may run on another thread than writeData, so it has buffers of its own
+		HeapBlock<float> spikeScaledBuffer;
+		HeapBlock<int16> spikeIntBuffer;
+		size_t spikeBufferSize;
 
 		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(NWBFile);
 
@@ -22,11 +22,14 @@
  */
  
  #include "NWBRecording.h"
+ #include <memory>
 #define MAX_BUFFER_SIZE 40960
+//buffered events and spikes are written at least this often
+#define RECORD_FLUSH_INTERVAL_MS 1000
  
  using namespace NWBRecording;
  
- NWBRecordEngine::NWBRecordEngine() 
+ NWBRecordEngine::NWBRecordEngine() : lastRecordFlush(0)
  {
 	 
 	 tsBuffer.malloc(MAX_BUFFER_SIZE);
@@ -34,6 +37,7 @@
  
  NWBRecordEngine::~NWBRecordEngine()
  {
+	 writer->call([this] { recordFile = nullptr; });
  }
  
  String NWBRecordEngine::getEngineID() const
@@ -102,11 +106,13 @@
 	 for (int i = 0; i < nSpikes; i++)
 		 spikeChannels.add(getSpikeChannel(i));
 
-	 //open the file
-	 recordFile->open(getNumRecordedChannels() + continuousChannels.size() + eventChannels.size() + spikeChannels.size()); //total channels + timestamp arrays, to create a big enough buffer
-
-	 //create the recording
-	 recordFile->startNewRecording(recordingNumber, continuousChannels, eventChannels, spikeChannels);
+	 //open the file and create the recording on the write thread, which makes every HDF5 call
+	 recordFile->setStorageSettings(storageSettings);
+	 writer->call([&]
+	 {
+		 recordFile->open(getNumRecordedChannels() + continuousChannels.size() + eventChannels.size() + spikeChannels.size()); //total channels + timestamp arrays, to create a big enough buffer
+		 recordFile->startNewRecording(recordingNumber, continuousChannels, eventChannels, spikeChannels);
+	 });
 	
  }
 
@@ -114,9 +120,13 @@
  void NWBRecordEngine::closeFiles()
  {
 	 //Called when acquisition stops. Should close the files and leave the processor in a reset status
-	 recordFile->stopRecording();
-	 recordFile->close();
-	 recordFile = nullptr;
+	 //runs after every write still queued
+	 writer->call([this]
+	 {
+		 recordFile->stopRecording();
+		 recordFile->close();
+		 recordFile = nullptr;
+	 });
 	 resetChannels();
  }
 
@@ -136,7 +146,7 @@
  void NWBRecordEngine::writeData(int writeChannel, int realChannel, const float* buffer, int size)
  {
 
-	 recordFile->writeData(datasetIndexes[writeChannel], writeChannelIndexes[writeChannel], size, buffer, getDataChannel(realChannel)->getBitVolts());
+	 recordFile->writeData(datasetIndexes[writeChannel], writeChannelIndexes[writeChannel], size, buffer, getDataChannelTable().bitVolts[realChannel]);
 
 	 /* All channels in a dataset have the same number of samples and share timestamps. But since this method is called 
 		asynchronously, the timestamps might not be in sync during acquisition, so we chose a channel and write the
@@ -150,22 +160,53 @@
 		 {
 			 tsBuffer[i] = (baseTS + i) / fs;
 		 }
-		 recordFile->writeTimestamps(datasetIndexes[writeChannel], size, tsBuffer);
+		 Array<double> timestamps(tsBuffer.getData(), size);
+		 int datasetID = datasetIndexes[writeChannel];
+		 writer->post([this, datasetID, timestamps]
+		 {
+			 recordFile->writeTimestamps(datasetID, timestamps.size(), timestamps.begin());
+		 });
 	 }
 		 
  }
  
+void NWBRecordEngine::endChannelBlock(bool lastBlock)
+{
+	//all the channels of a dataset are written at once
+	recordFile->writeBufferedData(&writer.get());
+
+	uint32 now = Time::getMillisecondCounter();
+	if (now - lastRecordFlush >= RECORD_FLUSH_INTERVAL_MS)
+	{
+		writer->post([this]
+		{
+			recordFile->flushRecords();
+			//lets SWMR readers see everything written so far
+			if (recordFile->isSWMRActive())
+				CHECK_ERROR(recordFile->flush());
+		});
+		lastRecordFlush = now;
+	}
+}
+
 void NWBRecordEngine::writeEvent(int eventIndex, const MidiMessage& event) 
 {
 	const EventChannel* channel = getEventChannel(eventIndex);
-	EventPtr eventStruct = Event::deserializeFromMessage(event, channel);
-
-	recordFile->writeEvent(eventIndex, channel, eventStruct);
+	//the message is copied along, and only deserialized when written
+	writer->post([this, eventIndex, channel, event]
+	{
+		EventPtr eventStruct = Event::deserializeFromMessage(event, channel);
+		if (eventStruct)
+			recordFile->writeEvent(eventIndex, channel, eventStruct);
+	});
 }
 
 void NWBRecordEngine::writeTimestampSyncText(uint16 sourceID, uint16 sourceIdx, int64 timestamp, float sourceSampleRate, String text)
 {
-	recordFile->writeTimestampSyncText(sourceID, timestamp, sourceSampleRate, text);
+	writer->post([this, sourceID, timestamp, sourceSampleRate, text]
+	{
+		recordFile->writeTimestampSyncText(sourceID, timestamp, sourceSampleRate, text);
+	});
 }
 
 void NWBRecordEngine::addSpikeElectrode(int index,const  SpikeChannel* elec) 
@@ -175,8 +216,12 @@ void NWBRecordEngine::addSpikeElectrode(int index,const  SpikeChannel* elec)
 void NWBRecordEngine::writeSpike(int electrodeIndex, const SpikeEvent* spike) 
 {
 	const SpikeChannel* channel = getSpikeChannel(electrodeIndex);
-
-	recordFile->writeSpike(electrodeIndex, channel, spike);
+	//the spike is only valid during this call
+	std::shared_ptr<SpikeEvent> copy(new SpikeEvent(*spike));
+	writer->post([this, electrodeIndex, channel, copy]
+	{
+		recordFile->writeSpike(electrodeIndex, channel, copy.get());
+	});
 }
 
 RecordEngineManager* NWBRecordEngine::getEngineManager()
@@ -186,6 +231,24 @@ RecordEngineManager* NWBRecordEngine::getEngineManager()
 	EngineParameter* param;
 	param = new EngineParameter(EngineParameter::STR, 0, "Identifier Text", String::empty);
 	man->addParameter(param);
+	param = new EngineParameter(EngineParameter::INT, 1, "Chunk length (samples)", CHUNK_XSIZE, 64, 65536);
+	man->addParameter(param);
+	param = new EngineParameter(EngineParameter::INT, 2, "Chunk cache (MB, 0 for automatic)", 0, 0, 4096);
+	man->addParameter(param);
+	param = new EngineParameter(EngineParameter::INT, 3, "Alignment (KB, 0 for none)", 0, 0, 65536);
+	man->addParameter(param);
+	param = new EngineParameter(EngineParameter::INT, 4, "Metadata block size (KB, 0 for default)", 0, 0, 65536);
+	man->addParameter(param);
+	param = new EngineParameter(EngineParameter::BOOL, 5, "Latest HDF5 file format", false);
+	man->addParameter(param);
+	param = new EngineParameter(EngineParameter::MULTI, 6, "Compression|None|gzip|LZ4|zstd", HDF5StorageSettings::NO_COMPRESSION);
+	man->addParameter(param);
+	param = new EngineParameter(EngineParameter::BOOL, 7, "Shuffle bytes before compressing", true);
+	man->addParameter(param);
+	param = new EngineParameter(EngineParameter::INT, 8, "Compression level (0 for default)", 0, 0, 22);
+	man->addParameter(param);
+	param = new EngineParameter(EngineParameter::BOOL, 9, "Readable while recording (SWMR)", false);
+	man->addParameter(param);
 	return man;
 	
 }
@@ -193,4 +256,13 @@ RecordEngineManager* NWBRecordEngine::getEngineManager()
 void NWBRecordEngine::setParameter(EngineParameter& parameter)
 {
 	strParameter(0, identifierText);
+	else intParameter(1, storageSettings.chunkSamples);
+	else intParameter(2, storageSettings.cacheMB);
+	else intParameter(3, storageSettings.alignmentKB);
+	else intParameter(4, storageSettings.metaBlockKB);
+	else boolParameter(5, storageSettings.latestFormat);
+	else multiParameter(6, storageSettings.compression);
+	else boolParameter(7, storageSettings.shuffle);
+	else intParameter(8, storageSettings.compressionLevel);
+	else boolParameter(9, storageSettings.swmr);
 }
\ No newline at end of file
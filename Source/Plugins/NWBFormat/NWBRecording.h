@@ -38,6 +38,7 @@
 			void openFiles(File rootFolder, int experimentNumber, int recordingNumber) override;
 			void closeFiles() override;
 			void writeData(int writeChannel, int realChannel, const float* buffer, int size) override;
+			void endChannelBlock(bool lastBlock) override;
 			void writeEvent(int eventIndex, const MidiMessage& event) override;
 			void addSpikeElectrode(int index,const  SpikeChannel* elec) override;
 			void writeSpike(int electrodeIndex, const SpikeEvent* spike) override;
@@ -48,6 +49,8 @@
 			static RecordEngineManager* getEngineManager();
 			
 		private:
+			/** Declared first, so that it outlives the file */
+			SharedHDF5WriteThread writer;
 			ScopedPointer<NWBFile> recordFile;
 			Array<int> datasetIndexes;
 			Array<int> writeChannelIndexes;
@@ -60,6 +63,8 @@
 			size_t bufferSize;
 
 			String identifierText;
+			HDF5StorageSettings storageSettings;
+			uint32 lastRecordFlush;
 			
 			JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(NWBRecordEngine);
 
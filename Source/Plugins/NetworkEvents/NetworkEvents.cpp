@@ -27,6 +27,11 @@
 
 
 const int MAX_MESSAGE_LENGTH = 64000;
+const int MESSAGE_RING_BYTES = 1 << 20;
+const int MAX_IDENTITY_LENGTH = 256;
+const int POLL_INTERVAL_MS = 5;         // longest wait for a reply to be sent, or for the thread to exit
+const int STATUS_INTERVAL_MS = 100;
+const int DEFAULT_STATUS_PORT = 5560;
 
 
 #ifdef WIN32
@@ -154,6 +159,86 @@ StringTS::~StringTS()
 }
 
 
+TickToSampleMapper::TickToSampleMapper()
+{
+    reset();
+}
+
+
+void TickToSampleMapper::reset()
+{
+    numPairs = 0;
+    nextPair = 0;
+    lastTicks = 0;
+    lastTimestamp = 0;
+    samplesPerTick = 0;
+    slope = 0;
+    offset = 0;
+}
+
+
+void TickToSampleMapper::addPair (int64 ticks, int64 timestamp)
+{
+    // acquisition restarted, or the global timestamp source changed
+    if (numPairs > 0 && (timestamp < lastTimestamp || ticks <= lastTicks))
+        reset();
+
+    pairTicks[nextPair] = double (ticks);
+    pairTimestamps[nextPair] = double (timestamp);
+    nextPair = (nextPair + 1) % MAX_PAIRS;
+    numPairs = jmin (numPairs + 1, (int) MAX_PAIRS);
+
+    lastTicks = ticks;
+    lastTimestamp = timestamp;
+    samplesPerTick = CoreServices::getGlobalSampleRate() / double (Time::getHighResolutionTicksPerSecond());
+
+    fit();
+}
+
+
+void TickToSampleMapper::fit()
+{
+    if (numPairs < 2)
+        return;
+
+    // relative to the last pair, to keep the precision of the large tick counts
+    double meanX = 0, meanY = 0;
+    for (int i = 0; i < numPairs; ++i)
+    {
+        meanX += pairTicks[i] - double (lastTicks);
+        meanY += pairTimestamps[i] - double (lastTimestamp);
+    }
+    meanX /= numPairs;
+    meanY /= numPairs;
+
+    double sxx = 0, sxy = 0;
+    for (int i = 0; i < numPairs; ++i)
+    {
+        const double dx = pairTicks[i] - double (lastTicks) - meanX;
+        sxx += dx * dx;
+        sxy += dx * (pairTimestamps[i] - double (lastTimestamp) - meanY);
+    }
+
+    // pairs all taken at the same tick, or a clock going backwards, leave the nominal rate
+    slope = (sxx > 0 && sxy > 0) ? sxy / sxx : samplesPerTick;
+    offset = meanY - slope * meanX;
+}
+
+
+int64 TickToSampleMapper::getTimestamp (int64 ticks) const
+{
+    if (numPairs == 0)
+        return CoreServices::getGlobalTimestamp();
+
+    const double dx = double (ticks - lastTicks);
+
+    if (numPairs < 2)
+        return lastTimestamp + int64 (dx * samplesPerTick);
+
+    return lastTimestamp + int64 (std::floor (offset + slope * dx + 0.5));
+}
+
+
 /*********************************************/
 void* NetworkEvents::zmqcontext = nullptr;
 
@@ -163,17 +248,24 @@ NetworkEvents::NetworkEvents()
     , threshold         (200.0)
     , bufferZone        (5.0f)
     , state             (false)
+    , messageFifo       (MESSAGE_RING_BYTES)
 {
     setProcessorType (PROCESSOR_TYPE_SOURCE);
 
+    messageRing.malloc (MESSAGE_RING_BYTES);
+    messageScratch.malloc (MAX_MESSAGE_LENGTH);
+
     createZmqContext();
 
     firstTime = true;
     responder = nullptr;
+    statusPublisher = nullptr;
     urlport = 5556;
+    statusPort = DEFAULT_STATUS_PORT;
     threadRunning = false;
 
     opensocket();
+    startTimer (STATUS_INTERVAL_MS);
 
     sendSampleCount = false; // disable updating the continuous buffer sample counts,
     // since this processor only sends events
@@ -186,22 +278,32 @@ void NetworkEvents::setNewListeningPort (int port)
     // first, close existing thread.
     closesocket();
 
-    // allow some time for thread to quit
-#ifdef WIN32
-    Sleep (300);
-#else
-    usleep (300 * 1000);
-#endif
-
     urlport = port;
     opensocket();
 }
 
 
+void NetworkEvents::setStatusPort (int port)
+{
+    closesocket();
+
+    statusPort = port;
+    opensocket();
+}
+
+
+int NetworkEvents::getStatusPort() const
+{
+    return statusPort;
+}
+
+
 NetworkEvents::~NetworkEvents()
 {
+    stopTimer();
     shutdown = true;
     closesocket();
+    cancelPendingUpdate();
 }
 
 
@@ -209,25 +311,12 @@ bool NetworkEvents::closesocket()
 {
     std::cout << "Disabling network node" << std::endl;
 
-#ifdef ZEROMQ
-    if (threadRunning)
+    // the thread polls its socket, so it sees the request to exit and closes it
+    if (!stopThread(500))
     {
-		lock.enter();
-        zmq_close (responder);
-        zmq_ctx_destroy (zmqcontext); // this will cause the thread to exit
-        zmqcontext = nullptr;
-		lock.exit();
-
-		if (!stopThread(500))
-		{
-			std::cerr << "Network thread timeout. Forcing thread termination, system could be lefr in an unstable state" << std::endl;
-		}
-
-        if (! shutdown)
-            createZmqContext();// and this will take care that processor graph doesn't attempt to delete the context again
-	
+        std::cerr << "Network thread timeout. Forcing thread termination, system could be lefr in an unstable state" << std::endl;
     }
-#endif
+
     return true;
 }
 
@@ -307,10 +396,14 @@ void NetworkEvents::simulateDesignAndTrials ()
 
 void NetworkEvents::postTimestamppedStringToMidiBuffer (StringTS s)
 {
-	MetaDataValueArray md;
-	md.add(new MetaDataValue(MetaDataDescriptor::INT64, 1, &s.timestamp));
-	TextEventPtr event = TextEvent::createTextEvent(messageChannel, CoreServices::getGlobalTimestamp(), String::fromUTF8(reinterpret_cast<const char*>(s.str), s.len), md);
-	addEvent(messageChannel, event, 0);
+	postNetworkMessage(reinterpret_cast<const char*>(s.str), s.len, s.timestamp);
+}
+
+void NetworkEvents::postNetworkMessage (const char* data, int len, int64 timestamp)
+{
+	// at the sample it was received, rather than at the start of the block, with the software
+	// timestamp as the channel's only metadata value, serialized without building a String
+	addTextEvent(messageChannel, tickMapper.getTimestamp(timestamp), data, 0, len, &timestamp);
 }
 
 
@@ -498,6 +591,10 @@ String NetworkEvents::handleSpecialMessages (StringTS msg)
             return String ("StoppedRecording");
         }
     }
+    else if (cmd.compareIgnoreCase ("GetStatus") == 0)
+    {
+        return JSON::toString (CoreServices::getStatusSnapshot(), true);
+    }
     else if (cmd.compareIgnoreCase ("IsAcquiring") == 0)
     {
         String status = CoreServices::getAcquisitionStatus() ? String ("1") : String ("0");
@@ -541,6 +638,25 @@ String NetworkEvents::handleSpecialMessages (StringTS msg)
 		}
 			
 	}
+    else if (cmd.compareIgnoreCase ("StartTrace") == 0)
+    {
+        TraceRecorder::setEnabled (true);
+        return String ("TraceStarted");
+    }
+    else if (cmd.compareIgnoreCase ("StopTrace") == 0)
+    {
+        TraceRecorder::setEnabled (false);
+        return String ("TraceStopped");
+    }
+    else if (cmd.compareIgnoreCase ("SaveTrace") == 0)
+    {
+        const String filePath = s.substring (cmd.length() + 1).trim();
+
+        if (! File::isAbsolutePath (filePath))
+            return String ("InvalidFile");
+
+        return TraceRecorder::exportChromeTrace (File (filePath));
+    }
 
     return String ("NotHandled");
 }
@@ -548,18 +664,73 @@ String NetworkEvents::handleSpecialMessages (StringTS msg)
 
 void NetworkEvents::process (AudioSampleBuffer& buffer)
 {
-    setTimestampAndSamples(CoreServices::getGlobalTimestamp(),0);
+    const int64 blockTicks = Time::getHighResolutionTicks();
+    const int64 blockTimestamp = CoreServices::getGlobalTimestamp();
+
+    setTimestampAndSamples(blockTimestamp,0);
+    tickMapper.addPair (blockTicks, blockTimestamp);
 
-    lock.enter();
-    while (! networkMessagesQueue.empty())
+    // each message is its software timestamp, its length, then its bytes, all written at once
+    const int headerSize = sizeof (int64) + sizeof (int);
+
+    while (messageFifo.getNumReady() >= headerSize)
     {
-        StringTS msg = networkMessagesQueue.front();
-        postTimestamppedStringToMidiBuffer (msg);
-        CoreServices::sendStatusMessage ( ("Network event received: " + msg.getString()).toRawUTF8());
-        networkMessagesQueue.pop();
+        int64 timestamp;
+        int len;
+        readFromRing (&timestamp, sizeof (timestamp));
+        readFromRing (&len, sizeof (len));
+        readFromRing (messageScratch, len);
+
+        postNetworkMessage (messageScratch, len, timestamp);
     }
+}
+
+
+void NetworkEvents::readFromRing (void* dest, int numBytes)
+{
+    int start1, size1, start2, size2;
+    messageFifo.prepareToRead (numBytes, start1, size1, start2, size2);
 
-    lock.exit();
+    memcpy (dest, messageRing + start1, size1);
+
+    if (size2 > 0)
+        memcpy (static_cast<char*> (dest) + size1, messageRing + start2, size2);
+
+    messageFifo.finishedRead (size1 + size2);
+}
+
+
+void NetworkEvents::writeToRing (const void* source, int numBytes)
+{
+    int start1, size1, start2, size2;
+    messageFifo.prepareToWrite (numBytes, start1, size1, start2, size2);
+
+    memcpy (messageRing + start1, source, size1);
+
+    if (size2 > 0)
+        memcpy (messageRing + start2, static_cast<const char*> (source) + size1, size2);
+
+    messageFifo.finishedWrite (size1 + size2);
+}
+
+
+void NetworkEvents::queueNetworkMessage (const unsigned char* data, int len, int64 timestamp)
+{
+    const int numBytes = sizeof (timestamp) + sizeof (len) + len;
+
+    if (numBytes > messageFifo.getFreeSpace())
+    {
+        std::cout << "Network Events dropped a message, " << ++droppedMessages << " so far" << std::endl;
+        return;
+    }
+
+    // written at once, so that process() never sees a message without its bytes
+    HeapBlock<char> record (numBytes);
+    memcpy (record, &timestamp, sizeof (timestamp));
+    memcpy (record + sizeof (timestamp), &len, sizeof (len));
+    memcpy (record + sizeof (timestamp) + sizeof (len), data, len);
+
+    writeToRing (record, numBytes);
 }
 
 
@@ -569,10 +740,178 @@ void NetworkEvents::opensocket()
 }
 
 
+void NetworkEvents::handleAsyncUpdate()
+{
+    Array<PendingRequest> received;
+    {
+        const ScopedLock sl (requestLock);
+        received.swapWith (requests);
+    }
+
+    for (int i = 0; i < received.size(); ++i)
+    {
+        PendingRequest& request = received.getReference (i);
+
+        if (request.isBatch)
+        {
+            Array<var> results;
+
+            for (int c = 0; c < request.commands.size(); ++c)
+            {
+                CoreServices::sendStatusMessage ("Network event received: " + request.commands[c]);
+                results.add (handleSpecialMessages (StringTS (request.commands[c], request.timestamp)));
+            }
+
+            request.message = JSON::toString (results, true);
+            continue;
+        }
+
+        CoreServices::sendStatusMessage ("Network event received: " + request.message);
+
+        // handle special messages
+        StringTS msg (request.message, request.timestamp);
+        request.message = handleSpecialMessages (msg);
+    }
+
+    const ScopedLock sl (requestLock);
+    replies.addArray (received);
+}
+
+
+bool NetworkEvents::receiveRequest (unsigned char* buffer)
+{
+#ifdef ZEROMQ
+    PendingRequest request;
+
+    char identity[MAX_IDENTITY_LENGTH];
+    const int identityLength = zmq_recv (responder, identity, MAX_IDENTITY_LENGTH, 0);
+
+    if (identityLength < 0) // will only happen when responder dies.
+        return false;
+
+    request.identity.append (identity, jmin (identityLength, MAX_IDENTITY_LENGTH));
+    request.hasDelimiter = false;
+    request.isBatch = false;
+    request.timestamp = 0;
+
+    // the body is the last part, after the empty delimiter of a REQ client
+    int result = 0;
+    int numParts = 0;
+    int more = 1;
+    size_t moreSize = sizeof (more);
+
+    while (zmq_getsockopt (responder, ZMQ_RCVMORE, &more, &moreSize) == 0 && more)
+    {
+        result = zmq_recv (responder, buffer, MAX_MESSAGE_LENGTH - 1, 0);
+
+        if (result < 0)
+            return false;
+
+        if (numParts++ == 0 && result == 0)
+            request.hasDelimiter = true;
+
+        result = jmin (result, MAX_MESSAGE_LENGTH - 1);
+    }
+
+    request.timestamp = timer.getHighResolutionTicks();
+
+    if (result > 0)
+    {
+        request.message = String::fromUTF8 ((const char*) buffer, result);
+
+        const var batch = request.message.startsWithChar ('[') ? JSON::parse (request.message) : var();
+
+        if (batch.isArray())
+        {
+            request.isBatch = true;
+
+            for (int i = 0; i < batch.size(); ++i)
+            {
+                const String command = batch[i].toString();
+                request.commands.add (command);
+                queueNetworkMessage ((const unsigned char*) command.toRawUTF8(), (int) command.getNumBytesAsUTF8(), request.timestamp);
+            }
+        }
+        else
+        {
+            queueNetworkMessage (buffer, result, request.timestamp);
+        }
+
+        {
+            const ScopedLock sl (requestLock);
+            requests.add (request);
+        }
+
+        triggerAsyncUpdate();
+    }
+    else
+    {
+        request.message = "Recieved Zero Message?!?!?";
+
+        const ScopedLock sl (requestLock);
+        replies.add (request);
+    }
+#endif
+    return true;
+}
+
+
+void NetworkEvents::sendPendingReplies()
+{
+#ifdef ZEROMQ
+    Array<PendingRequest> toSend;
+    {
+        const ScopedLock sl (requestLock);
+        toSend.swapWith (replies);
+    }
+
+    for (int i = 0; i < toSend.size(); ++i)
+    {
+        const PendingRequest& reply = toSend.getReference (i);
+
+        zmq_send (responder, reply.identity.getData(), reply.identity.getSize(), ZMQ_SNDMORE);
+
+        if (reply.hasDelimiter)
+            zmq_send (responder, "", 0, ZMQ_SNDMORE);
+
+        zmq_send (responder, reply.message.toRawUTF8(), reply.message.getNumBytesAsUTF8(), 0);
+    }
+#endif
+}
+
+
+void NetworkEvents::timerCallback()
+{
+    if (statusPort <= 0 || ! threadRunning)
+        return;
+
+    const String status = JSON::toString (CoreServices::getStatusSnapshot(), true);
+
+    const ScopedLock sl (requestLock);
+    pendingStatus = status;
+}
+
+
+void NetworkEvents::publishPendingStatus()
+{
+#ifdef ZEROMQ
+    String status;
+    {
+        const ScopedLock sl (requestLock);
+        status.swapWith (pendingStatus);
+    }
+
+    // a PUB socket drops the snapshots no subscriber is ready for
+    if (status.isNotEmpty() && statusPublisher != nullptr)
+        zmq_send (statusPublisher, status.toRawUTF8(), status.getNumBytesAsUTF8(), ZMQ_DONTWAIT);
+#endif
+}
+
+
 void NetworkEvents::run()
 {
 #ifdef ZEROMQ
-    responder = zmq_socket (zmqcontext, ZMQ_REP);
+    responder = zmq_socket (zmqcontext, ZMQ_ROUTER);
     String url= String ("tcp://*:") + String (urlport);
     int rc = zmq_bind (responder, url.toRawUTF8());
 
@@ -580,45 +919,57 @@ void NetworkEvents::run()
     {
         // failed to open socket?
         std::cout << "Failed to open socket: " << zmq_strerror (zmq_errno()) << std::endl;
+        zmq_close (responder);
+        responder = nullptr;
         return;
     }
 
+    if (statusPort > 0)
+    {
+        statusPublisher = zmq_socket (zmqcontext, ZMQ_PUB);
+        String statusUrl = String ("tcp://*:") + String (statusPort);
+
+        if (zmq_bind (statusPublisher, statusUrl.toRawUTF8()) != 0)
+        {
+            // the commands are still served
+            std::cout << "Failed to open status socket: " << zmq_strerror (zmq_errno()) << std::endl;
+            zmq_close (statusPublisher);
+            statusPublisher = nullptr;
+        }
+    }
+
     threadRunning = true;
     unsigned char* buffer = new unsigned char[MAX_MESSAGE_LENGTH];
-    int result = -1;
 
-    while (threadRunning)
+    zmq_pollitem_t item;
+    item.socket = responder;
+    item.fd = 0;
+    item.events = ZMQ_POLLIN;
+    item.revents = 0;
+
+    while (! threadShouldExit())
     {
-        result = zmq_recv (responder, buffer, MAX_MESSAGE_LENGTH - 1, 0);  // blocking
+        sendPendingReplies();
+        publishPendingStatus();
 
-        juce::int64 timestamp_software = timer.getHighResolutionTicks();
+        const int result = zmq_poll (&item, 1, POLL_INTERVAL_MS);
 
-        if (result < 0) // will only happen when responder dies.
+        if (result < 0)
             break;
 
-        StringTS Msg (buffer, result, timestamp_software);
-        if (result > 0)
-        {
-            lock.enter();
-            networkMessagesQueue.push (Msg);
-            lock.exit();
-
-            //std::cout << "Received message!" << std::endl;
-            // handle special messages
-            String response = handleSpecialMessages (Msg);
-
-            zmq_send (responder, response.getCharPointer(), response.length(), 0);
-        }
-        else
-        {
-            String zeroMessageError = "Recieved Zero Message?!?!?";
-            //std::cout << "Received Zero Message!" << std::endl;
-
-            zmq_send (responder, zeroMessageError.getCharPointer(), zeroMessageError.length(), 0);
-        }
+        if (result > 0 && ! receiveRequest (buffer))
+            break;
     }
 
+    sendPendingReplies();
     zmq_close (responder);
+    responder = nullptr;
+
+    if (statusPublisher != nullptr)
+    {
+        zmq_close (statusPublisher);
+        statusPublisher = nullptr;
+    }
 
     delete[] buffer;
     threadRunning = false;
@@ -660,6 +1011,7 @@ void NetworkEvents::saveCustomParametersToXml (XmlElement* parentElement)
 {
     XmlElement* mainNode = parentElement->createNewChildElement ("NETWORKEVENTS");
     mainNode->setAttribute ("port", urlport);
+    mainNode->setAttribute ("statusPort", statusPort);
 }
 
 
@@ -671,6 +1023,7 @@ void NetworkEvents::loadCustomParametersFromXml()
         {
             if (mainNode->hasTagName ("NETWORKEVENTS"))
             {
+                statusPort = mainNode->getIntAttribute ("statusPort", DEFAULT_STATUS_PORT);
                 setNewListeningPort (mainNode->getIntAttribute("port"));
             }
         }
@@ -40,6 +40,46 @@
 #include <list>
 #include <queue>
 
+/**
+ Maps the high resolution ticks at which messages are received onto the global timestamp,
+ through a least-squares line fitted to the (ticks, global timestamp) pairs taken at the
+ last blocks, so that the jitter of block times is averaged out and drift followed.
+
+ Used by the processing thread only.
+*/
+class TickToSampleMapper
+{
+public:
+    TickToSampleMapper();
+
+    /** Forgets every pair */
+    void reset();
+
+    /** Adds the pair of one block, forgetting the oldest one once MAX_PAIRS are held */
+    void addPair (int64 ticks, int64 timestamp);
+
+    /** Returns the global timestamp at which ticks occurred, extrapolated from the last
+        pair at the nominal rate until two pairs are known */
+    int64 getTimestamp (int64 ticks) const;
+
+private:
+    enum { MAX_PAIRS = 256 };
+
+    void fit();
+
+    double pairTicks[MAX_PAIRS];
+    double pairTimestamps[MAX_PAIRS];
+    int numPairs;
+    int nextPair;
+
+    int64 lastTicks;
+    int64 lastTimestamp;
+    double samplesPerTick;      // nominal
+    double slope;               // fitted, in samples per tick, relative to the last pair
+    double offset;
+};
+
+
 class StringTS
 {
 public:
@@ -65,10 +105,24 @@ public:
 /**
  Sends incoming TCP/IP messages from 0MQ to the events buffer
 
+ The network thread serves a ROUTER socket, to which REQ clients connect as before. Each
+ request is copied to a lock-free ring read by process(), which turns it into a text event,
+ and handed to the message thread, which runs the commands it may hold, posts the status
+ message and queues the reply that the network thread then sends. Neither the processing
+ thread nor the network thread ever waits for a command to be carried out.
+
+ A request can also be a JSON array of commands, run in order and answered with the JSON
+ array of their replies, each command being a separate event. Clients that monitor the GUI
+ can subscribe to the PUB socket of the status port instead of polling: the JSON object of
+ CoreServices::getStatusSnapshot() is published on it every STATUS_INTERVAL_MS, and is also
+ the reply to the GetStatus command.
+
   @see GenericProcessor
 */
 class NetworkEvents : public GenericProcessor
                     , public Thread
+                    , public AsyncUpdater
+                    , private Timer
 {
 public:
     NetworkEvents();
@@ -115,14 +169,52 @@ public:
     void postTimestamppedStringToMidiBuffer (StringTS s);
     void setNewListeningPort (int port);
 
+    /** Sets the port status snapshots are published on, 0 not to publish them */
+    void setStatusPort (int port);
+    int getStatusPort() const;
+
+    /** Runs the commands of the requests received, and queues their replies */
+    void handleAsyncUpdate() override;
+
     int urlport;
     String socketStatus;
     std::atomic<bool> threadRunning;
 
 
 private:
+    /** A request waiting for the message thread, or the reply to it */
+    struct PendingRequest
+    {
+        MemoryBlock identity;       // of the client, routing the reply back to it
+        bool hasDelimiter;          // the empty part a REQ client puts before the body
+        String message;
+        StringArray commands;       // of a batch, whose reply is a JSON array
+        bool isBatch;
+        int64 timestamp;
+    };
+
+    /** Takes a status snapshot for the network thread to publish */
+    void timerCallback() override;
+
+    void publishPendingStatus();
+
     void createZmqContext();
 
+    /** Receives all parts of a request, returning false if the socket was closed */
+    bool receiveRequest (unsigned char* buffer);
+
+    void sendPendingReplies();
+
+    /** Copies a message to the ring read by process(), dropping it if there is no room */
+    void queueNetworkMessage (const unsigned char* data, int len, int64 timestamp);
+
+    void writeToRing (const void* source, int numBytes);
+
+    /** Copies and consumes the next numBytes of the ring */
+    void readFromRing (void* dest, int numBytes);
+
+    void postNetworkMessage (const char* data, int len, int64 timestamp);
+
     //* Split network message into name/value pairs (name1=val1 name2=val2 etc) */
     StringPairArray parseNetworkMessage (String msg);
 
@@ -130,6 +222,8 @@ private:
 
     static void* zmqcontext;
     void* responder;
+    void* statusPublisher;
+    int statusPort;
 
     float threshold;
     float bufferZone;
@@ -140,9 +234,20 @@ private:
 
     Time timer;
 
-    std::queue<StringTS> networkMessagesQueue;
     std::queue<StringTS> simulation;
 
+    TickToSampleMapper tickMapper;
+
+    AbstractFifo messageFifo;       // of bytes, written by the network thread, read by process()
+    HeapBlock<char> messageRing;
+    HeapBlock<char> messageScratch; // the message process() is posting
+    Atomic<int> droppedMessages;
+
+    CriticalSection requestLock;    // guards the two arrays below
+    Array<PendingRequest> requests;
+    Array<PendingRequest> replies;
+    String pendingStatus;           // taken by the network thread once published
+
     CriticalSection lock;
     int64 simulationStartTime;
 
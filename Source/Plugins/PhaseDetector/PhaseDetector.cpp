@@ -21,6 +21,7 @@
 */
 
 #include <stdio.h>
+#include <limits>
 #include "PhaseDetector.h"
 #include "PhaseDetectorEditor.h"
 
@@ -64,8 +65,60 @@ void PhaseDetector::addModule()
     m.samplesSinceTrigger = 5000;
     m.wasTriggered = false;
     m.phase = NO_PHASE;
+    m.band = 0;
+    m.numPredictedTriggers = 0;
+    m.samplesSinceLastTrigger = std::numeric_limits<int>::max();
 
     modules.add (m);
+    estimators.add (new PhaseEstimator());
+}
+
+
+namespace
+{
+    struct Band
+    {
+        const char* name;
+        double lowCut;
+        double highCut;
+    };
+
+    const Band bands[] =
+    {
+        { "Raw",   0.0,  0.0  },
+        { "Delta", 1.0,  4.0  },
+        { "Theta", 4.0,  8.0  },
+        { "Alpha", 8.0,  12.0 },
+        { "Beta",  13.0, 30.0 },
+        { "Gamma", 30.0, 80.0 }
+    };
+}
+
+
+StringArray PhaseDetector::getBandNames()
+{
+    StringArray names;
+
+    for (int i = 0; i < numElementsInArray (bands); ++i)
+        names.add (bands[i].name);
+
+    return names;
+}
+
+
+void PhaseDetector::prepareEstimators()
+{
+    for (int m = 0; m < modules.size(); ++m)
+    {
+        DetectorModule& module = modules.getReference (m);
+        const DataChannel* in = getDataChannel (module.inputChan);
+
+        module.numPredictedTriggers = 0;
+        module.pendingEvents.ensureStorageAllocated (MAX_PENDING_EVENTS);
+
+        if (module.band > 0 && in != nullptr)
+            estimators[m]->prepare (in->getSampleRate(), bands[module.band].lowCut, bands[module.band].highCut);
+    }
 }
 
 
@@ -112,6 +165,7 @@ void PhaseDetector::setParameter (int parameterIndex, float newValue)
     else if (parameterIndex == 2)   // inputChan
     {
         module.inputChan = (int) newValue;
+        prepareEstimators();
     }
     else if (parameterIndex == 3)   // outputChan
     {
@@ -129,6 +183,11 @@ void PhaseDetector::setParameter (int parameterIndex, float newValue)
             module.isActive = false;
         }
     }
+    else if (parameterIndex == 5)   // band
+    {
+        module.band = jlimit (0, numElementsInArray (bands) - 1, (int) newValue);
+        prepareEstimators();
+    }
 }
 
 //Usually, to be more ordered, we'd create the event channels overriding the createEventChannels() method.
@@ -177,11 +236,17 @@ void PhaseDetector::updateSettings()
 		moduleEventChannels.add(ev);
 	}
 	lastNumInputs = getNumInputs();
+	prepareEstimators();
 }
 
 
 bool PhaseDetector::enable()
 {
+    // every acquisition starts with clear filters and windows
+    for (int m = 0; m < estimators.size(); ++m)
+        estimators[m]->reset();
+
+    prepareEstimators();
     return true;
 }
 
@@ -221,16 +286,45 @@ void PhaseDetector::process (AudioSampleBuffer& buffer)
 {
     checkForEvents ();
 
+    // the modules of each input channel are run in parallel, then their events are
+    // added here in module order, as they would be from a single thread
+    processChannelsInParallel (buffer, buffer.getNumChannels());
+
+    for (int m = 0; m < modules.size(); ++m)
+    {
+        DetectorModule& module = modules.getReference (m);
+
+        for (int n = 0; n < module.pendingEvents.size(); ++n)
+        {
+            const PendingEvent& pending = module.pendingEvents.getReference (n);
+            addTTLEvent (moduleEventChannels[m], getTimestamp (module.inputChan) + pending.sampleNum,
+                         &pending.ttlData, module.outputChan, pending.sampleNum);
+        }
+
+        module.pendingEvents.clearQuick();
+    }
+}
+
+
+void PhaseDetector::processChannels (AudioSampleBuffer& buffer, int firstChannel, int lastChannel)
+{
     // loop through the modules
     for (int m = 0; m < modules.size(); ++m)
     {
         DetectorModule& module = modules.getReference (m);
 
-        // check to see if it's active and has a channel
+        // check to see if it's active and has a channel in this range
         if (module.isActive && module.outputChan >= 0
-            && module.inputChan >= 0
-            && module.inputChan < buffer.getNumChannels())
+            && module.inputChan >= firstChannel
+            && module.inputChan < lastChannel)
         {
+            if (module.band > 0 && estimators[m]->isPrepared())
+            {
+                processPredictedPhase (module, *estimators[m], buffer.getReadPointer (module.inputChan),
+                                       getNumSamples (module.inputChan));
+                continue;
+            }
+
             for (int i = 0; i < getNumSamples (module.inputChan); ++i)
             {
                 const float sample = *buffer.getReadPointer (module.inputChan, i);
@@ -241,11 +335,7 @@ void PhaseDetector::process (AudioSampleBuffer& buffer)
                 {
                     if (module.type == PEAK)
                     {
-						uint8 ttlData = 1 << module.outputChan;
-						TTLEventPtr event = TTLEvent::createTTLEvent(moduleEventChannels[m], getTimestamp(module.inputChan) + i, &ttlData, sizeof(uint8), module.outputChan);
-						addEvent(moduleEventChannels[m], event, i);
-                        module.samplesSinceTrigger = 0;
-                        module.wasTriggered = true;
+                        triggerModule (module, i);
                     }
 
                     module.phase = FALLING_POS;
@@ -256,11 +346,7 @@ void PhaseDetector::process (AudioSampleBuffer& buffer)
                 {
                     if (module.type == FALLING_ZERO)
                     {
-						uint8 ttlData = 1 << module.outputChan;
-						TTLEventPtr event = TTLEvent::createTTLEvent(moduleEventChannels[m], getTimestamp(module.inputChan) + i, &ttlData, sizeof(uint8), module.outputChan);
-						addEvent(moduleEventChannels[m], event, i);
-                        module.samplesSinceTrigger = 0;
-                        module.wasTriggered = true;
+                        triggerModule (module, i);
                     }
 
                     module.phase = FALLING_NEG;
@@ -269,11 +355,7 @@ void PhaseDetector::process (AudioSampleBuffer& buffer)
                 {
                     if (module.type == TROUGH)
                     {
-						uint8 ttlData = 1 << module.outputChan;
-						TTLEventPtr event = TTLEvent::createTTLEvent(moduleEventChannels[m], getTimestamp(module.inputChan) + i, &ttlData, sizeof(uint8), module.outputChan);
-						addEvent(moduleEventChannels[m], event, i);
-                        module.samplesSinceTrigger = 0;
-                        module.wasTriggered = true;
+                        triggerModule (module, i);
                     }
 
                     module.phase = RISING_NEG;
@@ -284,11 +366,7 @@ void PhaseDetector::process (AudioSampleBuffer& buffer)
                 {
                     if (module.type == RISING_ZERO)
                     {
-						uint8 ttlData = 1 << module.outputChan;
-						TTLEventPtr event = TTLEvent::createTTLEvent(moduleEventChannels[m], getTimestamp(module.inputChan) + i, &ttlData, sizeof(uint8), module.outputChan);
-						addEvent(moduleEventChannels[m], event, i);
-                        module.samplesSinceTrigger = 0;
-                        module.wasTriggered = true;
+                        triggerModule (module, i);
                     }
 
                     module.phase = RISING_POS;
@@ -296,27 +374,82 @@ void PhaseDetector::process (AudioSampleBuffer& buffer)
 
                 module.lastSample = sample;
 
-                if (module.wasTriggered)
-                {
-                    if (module.samplesSinceTrigger > 1000)
-                    {
-						uint8 ttlData = 0;
-						TTLEventPtr event = TTLEvent::createTTLEvent(moduleEventChannels[m], getTimestamp(module.inputChan) + i, &ttlData, sizeof(uint8), module.outputChan);
-						addEvent(moduleEventChannels[m], event, i);
-                        module.wasTriggered = false;
-                    }
-                    else
-                    {
-                        module.samplesSinceTrigger++;
-                    }
-                }
+                updateTrigger (module, i);
             }
         }
     }
 }
 
 
-void PhaseDetector::estimateFrequency()
+void PhaseDetector::triggerModule (DetectorModule& module, int sampleNum)
+{
+    // past the preallocated events, the later triggers of the block are dropped
+    if (module.pendingEvents.size() >= MAX_PENDING_EVENTS)
+        return;
+
+    module.pendingEvents.add (PendingEvent (sampleNum, (uint8) (1 << module.outputChan)));
+    module.samplesSinceTrigger = 0;
+    module.samplesSinceLastTrigger = 0;
+    module.wasTriggered = true;
+}
+
+
+void PhaseDetector::updateTrigger (DetectorModule& module, int sampleNum)
+{
+    if (module.wasTriggered)
+    {
+        // a full block turns the line off on the next one
+        if (module.samplesSinceTrigger > 1000 && module.pendingEvents.size() < MAX_PENDING_EVENTS)
+        {
+            module.pendingEvents.add (PendingEvent (sampleNum, 0));
+            module.wasTriggered = false;
+        }
+        else
+        {
+            module.samplesSinceTrigger++;
+        }
+    }
+
+    if (module.samplesSinceLastTrigger < std::numeric_limits<int>::max())
+        module.samplesSinceLastTrigger++;
+}
+
+
+void PhaseDetector::processPredictedPhase (DetectorModule& module, PhaseEstimator& estimator,
+                                           const float* samples, int numSamples)
 {
+    // successive predictions of the same cycle fall close together, so a trigger holds
+    // off the next ones for half a period
+    const int holdOff = int (0.5 * getDataChannel (module.inputChan)->getSampleRate() / estimator.getFrequency());
+    int next = 0;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        if (next < module.numPredictedTriggers && module.predictedTriggers[next] == i)
+        {
+            ++next;
+
+            if (module.type != NONE && module.samplesSinceLastTrigger >= holdOff)
+                triggerModule (module, i);
+        }
+
+        updateTrigger (module, i);
+    }
+
+    estimator.processSamples (samples, numSamples);
+
+    PhaseEstimator::TargetPhase target = PhaseEstimator::PEAK_PHASE;
+
+    switch (module.type)
+    {
+        case FALLING_ZERO:  target = PhaseEstimator::FALLING_ZERO_PHASE;  break;
+        case TROUGH:        target = PhaseEstimator::TROUGH_PHASE;        break;
+        case RISING_ZERO:   target = PhaseEstimator::RISING_ZERO_PHASE;   break;
+        default:            break;
+    }
+
+    // blocks keep their length, so the next one is covered with room to spare
+    module.numPredictedTriggers = estimator.predictPhase (target, 2 * numSamples, module.predictedTriggers,
+                                                          MAX_PREDICTED_TRIGGERS);
 }
 
@@ -26,14 +26,25 @@
 
 
 #include <ProcessorHeaders.h>
+#include "PhaseEstimator.h"
 
 #define NUM_INTERVALS 5
 
+/** Predicted triggers a module keeps for the next block */
+#define MAX_PREDICTED_TRIGGERS 8
+
+/** TTLs a module can add in a block, preallocated so that processing never allocates */
+#define MAX_PENDING_EVENTS 256
+
 
 /**
 
     Uses peaks to estimate the phase of a continuous signal.
 
+    A module either triggers on the zero crossings and extrema of its raw input, or on those
+    of a band of it, predicted by a PhaseEstimator at the end of each block and triggered at
+    their sample in the next one.
+
     @see GenericProcessor, PhaseDetectorEditor
 */
 class PhaseDetector : public GenericProcessor
@@ -47,6 +58,14 @@ public:
 
     void process (AudioSampleBuffer& buffer) override;
 
+    bool isDataPassThrough() const override { return true; }
+    bool isPassThroughChannel (int) const override { return true; }
+
+    /** Modules only read their own input channel, and their events are added once all are done.*/
+    bool isChannelParallelSafe() const override { return true; }
+
+    void processChannels (AudioSampleBuffer& buffer, int firstChannel, int lastChannel) override;
+
     void setParameter (int parameterIndex, float newValue) override;
 
     bool enable() override;
@@ -56,11 +75,15 @@ public:
     void addModule();
     void setActiveModule (int);
 
+    /** Names of the bands the modules can predict the phase of, from index 1 on; 0 is the raw input */
+    static StringArray getBandNames();
+
 
 private:
     void handleEvent (const EventChannel* channelInfo, const MidiMessage& event, int sampleNum) override;
 
-    void estimateFrequency();
+    /** Prepares the estimators of the modules predicting a band, for the sample rate of their input */
+    void prepareEstimators();
 
     enum ModuleType
     {
@@ -72,6 +95,16 @@ private:
         NO_PHASE, RISING_POS, FALLING_POS, FALLING_NEG, RISING_NEG
     };
 
+    /** A TTL found by processChannels(), added by process() once all channels are done */
+    struct PendingEvent
+    {
+        PendingEvent() : sampleNum (0), ttlData (0) {}
+        PendingEvent (int sample, uint8 data) : sampleNum (sample), ttlData (data) {}
+
+        int sampleNum;
+        uint8 ttlData;
+    };
+
     struct DetectorModule
     {
         int inputChan;
@@ -84,12 +117,30 @@ private:
         bool isActive;
         bool wasTriggered;
 
+        /** 0 to trigger on the raw input, else the band of getBandNames() whose phase is predicted */
+        int band;
+        int predictedTriggers[MAX_PREDICTED_TRIGGERS];
+        int numPredictedTriggers;
+        int samplesSinceLastTrigger;
+
         ModuleType type;
         PhaseType phase;
+
+        Array<PendingEvent> pendingEvents;
     };
 
+    /** Adds a TTL for the module at the sample and starts counting towards turning it off */
+    void triggerModule (DetectorModule& module, int sampleNum);
+    /** Turns the module's TTL off once it has lasted long enough */
+    void updateTrigger (DetectorModule& module, int sampleNum);
+
+    void processPredictedPhase (DetectorModule& module, PhaseEstimator& estimator, const float* samples, int numSamples);
+
     Array<DetectorModule> modules;
 
+    /** The estimator of each module, used by those predicting a band */
+    OwnedArray<PhaseEstimator> estimators;
+
     int activeModule;
 
     bool risingPos;
@@ -56,11 +56,22 @@ PhaseDetectorEditor::PhaseDetectorEditor(GenericProcessor* parentNode, bool useD
     // addAndMakeVisible(inputChannelSelectionBox);
 
     detectorSelector = new ComboBox();
-    detectorSelector->setBounds(35,30,150,20);
+    detectorSelector->setBounds(35,30,95,20);
     detectorSelector->addListener(this);
 
     addAndMakeVisible(detectorSelector);
 
+    subBlockSelector = new ComboBox();
+    subBlockSelector->setBounds(135,30,65,20);
+    subBlockSelector->setTooltip("Process the input in sub-blocks of this many samples");
+    subBlockSelector->addItem("Block", 1);
+    for (int size = 16; size <= 128; size *= 2)
+        subBlockSelector->addItem(String(size), size);
+    subBlockSelector->setSelectedId(1, dontSendNotification);
+    subBlockSelector->addListener(this);
+
+    addAndMakeVisible(subBlockSelector);
+
     plusButton = new UtilityButton("+", titleFont);
     plusButton->addListener(this);
     plusButton->setRadius(3.0f);
@@ -89,6 +100,7 @@ PhaseDetectorEditor::~PhaseDetectorEditor()
 void PhaseDetectorEditor::startAcquisition()
 {
 	plusButton->setEnabled(false);
+	subBlockSelector->setEnabled(false);
 	for (int i = 0; i < interfaces.size(); i++)
 		interfaces[i]->setEnableStatus(false);
 }
@@ -96,6 +108,7 @@ void PhaseDetectorEditor::startAcquisition()
 void PhaseDetectorEditor::stopAcquisition()
 {
 	plusButton->setEnabled(true);
+	subBlockSelector->setEnabled(true);
 	for (int i = 0; i < interfaces.size(); i++)
 		interfaces[i]->setEnableStatus(true);
 }
@@ -117,6 +130,12 @@ void PhaseDetectorEditor::updateSettings()
 
 void PhaseDetectorEditor::comboBoxChanged(ComboBox* c)
 {
+    if (c == subBlockSelector)
+    {
+        const int id = c->getSelectedId();
+        getProcessor()->setSubBlockSize(id > 1 ? id : 0);
+        return;
+    }
 
     for (int i = 0; i < interfaces.size(); i++)
     {
@@ -181,6 +200,7 @@ void PhaseDetectorEditor::saveCustomParameters(XmlElement* xml)
 {
 
     xml->setAttribute("Type", "PhaseDetectorEditor");
+    xml->setAttribute("SUB_BLOCK", getProcessor()->getSubBlockSize());
 
     for (int i = 0; i < interfaces.size(); i++)
     {
@@ -189,6 +209,7 @@ void PhaseDetectorEditor::saveCustomParameters(XmlElement* xml)
         d->setAttribute("INPUT",interfaces[i]->getInputChan());
         d->setAttribute("GATE",interfaces[i]->getGateChan());
         d->setAttribute("OUTPUT",interfaces[i]->getOutputChan());
+        d->setAttribute("BAND",interfaces[i]->getBand());
     }
 }
 
@@ -197,6 +218,9 @@ void PhaseDetectorEditor::loadCustomParameters(XmlElement* xml)
 
     int i = 0;
 
+    const int subBlockSize = xml->getIntAttribute("SUB_BLOCK", 0);
+    subBlockSelector->setSelectedId(subBlockSize > 0 ? subBlockSize : 1, sendNotificationSync);
+
     forEachXmlChildElement(*xml, xmlNode)
     {
         if (xmlNode->hasTagName("DETECTOR"))
@@ -211,6 +235,7 @@ void PhaseDetectorEditor::loadCustomParameters(XmlElement* xml)
             interfaces[i]->setInputChan(xmlNode->getIntAttribute("INPUT"));
             interfaces[i]->setGateChan(xmlNode->getIntAttribute("GATE"));
             interfaces[i]->setOutputChan(xmlNode->getIntAttribute("OUTPUT"));
+            interfaces[i]->setBand(xmlNode->getIntAttribute("BAND", 0));
 
             i++;
         }
@@ -293,6 +318,14 @@ DetectorInterface::DetectorInterface(PhaseDetector* pd, Colour c, int id) :
     outputSelector->setSelectedId(1);
     addAndMakeVisible(outputSelector);
 
+    bandSelector = new ComboBox();
+    bandSelector->setBounds(5,60,75,18);
+    bandSelector->addItemList(PhaseDetector::getBandNames(), 1);
+    bandSelector->setSelectedId(1, dontSendNotification);
+    bandSelector->setTooltip("Trigger on the raw input, or at the predicted phase of a band of it");
+    bandSelector->addListener(this);
+    addAndMakeVisible(bandSelector);
+
 
     std::cout << "Updating channels" << std::endl;
 
@@ -328,8 +361,11 @@ void DetectorInterface::comboBoxChanged(ComboBox* c)
     else if (c == gateSelector)
     {
         parameterIndex = 4;
-    } else {
-        
+    }
+    else if (c == bandSelector)
+    {
+        processor->setParameter(5, (float) c->getSelectedId() - 1);
+        return;
     }
 
     processor->setParameter(parameterIndex, (float) c->getSelectedId() - 2);
@@ -448,9 +484,24 @@ int DetectorInterface::getGateChan()
 {
     return gateSelector->getSelectedId()-2;
 }
+
+void DetectorInterface::setBand(int band)
+{
+    bandSelector->setSelectedId(band+1, dontSendNotification);
+
+    processor->setActiveModule(idNum);
+
+    processor->setParameter(5, (float) band);
+}
+
+int DetectorInterface::getBand()
+{
+    return bandSelector->getSelectedId()-1;
+}
 void DetectorInterface::setEnableStatus(bool status)
 {
 	inputSelector->setEnabled(status);
+	bandSelector->setEnabled(status);
 	for (int i = 0; i < phaseButtons.size(); i++)
 		phaseButtons[i]->setEnabled(status);
 }
\ No newline at end of file
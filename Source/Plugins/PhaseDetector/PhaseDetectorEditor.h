@@ -63,6 +63,9 @@ private:
 
     ScopedPointer<ComboBox> detectorSelector;
 
+    /** Size of the sub-blocks the detector processes, for lower latency. 0 for the whole block. */
+    ScopedPointer<ComboBox> subBlockSelector;
+
     ScopedPointer<UtilityButton> plusButton;
 
     void addDetector();
@@ -102,11 +105,13 @@ public:
     void setInputChan(int);
     void setOutputChan(int);
     void setGateChan(int);
+    void setBand(int);
 
     int getPhase();
     int getInputChan();
     int getOutputChan();
     int getGateChan();
+    int getBand();
 
 	void setEnableStatus(bool status);
 
@@ -127,6 +132,9 @@ private:
     ScopedPointer<ComboBox> gateSelector;
     ScopedPointer<ComboBox> outputSelector;
 
+    /** The raw input, or the band whose phase is predicted; item ids are the band plus one */
+    ScopedPointer<ComboBox> bandSelector;
+
 };
 
 #endif  // __PHASEDETECTOREDITOR_H_136829C6__
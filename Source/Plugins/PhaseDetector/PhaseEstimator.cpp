@@ -0,0 +1,261 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "PhaseEstimator.h"
+#include <complex>
+
+
+PhaseEstimator::PhaseEstimator()
+    : sampleRate                (0.0)
+    , centreFrequency           (0.0)
+    , b0 (0.0), b2 (0.0), a1 (0.0), a2 (0.0)
+    , decimation                (1)
+    , samplesSinceDecimated     (0)
+    , historyPosition           (0)
+    , historySize               (0)
+{
+    zerostruct (state);
+    zerostruct (coefficients);
+}
+
+
+PhaseEstimator::~PhaseEstimator()
+{
+}
+
+
+void PhaseEstimator::prepare (double newSampleRate, double lowCut, double highCut)
+{
+    sampleRate = newSampleRate;
+    centreFrequency = std::sqrt (lowCut * highCut);
+
+    // constant peak gain band-pass of the Audio EQ Cookbook, with no phase shift at its centre
+    const double w0 = 2.0 * double_Pi * centreFrequency / sampleRate;
+    const double alpha = std::sin (w0) * (highCut - lowCut) / (2.0 * centreFrequency);
+    const double a0 = 1.0 + alpha;
+
+    b0 = alpha / a0;
+    b2 = -alpha / a0;
+    a1 = -2.0 * std::cos (w0) / a0;
+    a2 = (1.0 - alpha) / a0;
+
+    decimation = jmax (1, int (sampleRate / (20.0 * highCut)));
+
+    history.calloc (PHASE_ESTIMATOR_WINDOW);
+    window.calloc (PHASE_ESTIMATOR_WINDOW + PHASE_ESTIMATOR_MAX_HORIZON);
+    forward.calloc (PHASE_ESTIMATOR_WINDOW);
+    backward.calloc (PHASE_ESTIMATOR_WINDOW);
+
+    reset();
+}
+
+
+bool PhaseEstimator::isPrepared() const
+{
+    return history != nullptr;
+}
+
+
+void PhaseEstimator::reset()
+{
+    zerostruct (state);
+    samplesSinceDecimated = 0;
+    historyPosition = 0;
+    historySize = 0;
+}
+
+
+void PhaseEstimator::processSamples (const float* samples, int numSamples)
+{
+    if (! isPrepared())
+        return;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        double y = samples[i];
+
+        for (int s = 0; s < 2; ++s)
+        {
+            const double w = y - a1 * state[s][0] - a2 * state[s][1];
+            y = b0 * w + b2 * state[s][1];
+            state[s][1] = state[s][0];
+            state[s][0] = w;
+        }
+
+        if (++samplesSinceDecimated >= decimation)
+        {
+            samplesSinceDecimated = 0;
+            history[historyPosition] = y;
+            historyPosition = (historyPosition + 1) % PHASE_ESTIMATOR_WINDOW;
+            historySize = jmin (historySize + 1, PHASE_ESTIMATOR_WINDOW);
+        }
+    }
+}
+
+
+void PhaseEstimator::fitModel (const double* x)
+{
+    const int n = PHASE_ESTIMATOR_WINDOW;
+
+    for (int i = 0; i < n; ++i)
+        forward[i] = backward[i] = x[i];
+
+    zerostruct (coefficients);
+    coefficients[0] = 1.0;
+
+    for (int k = 0; k < PHASE_ESTIMATOR_ORDER; ++k)
+    {
+        double numerator = 0.0;
+        double denominator = 0.0;
+
+        for (int i = 0; i < n - k - 1; ++i)
+        {
+            numerator   += forward[i + k + 1] * backward[i];
+            denominator += forward[i + k + 1] * forward[i + k + 1] + backward[i] * backward[i];
+        }
+
+        // a silent window leaves the lower orders
+        if (denominator <= 0.0)
+            break;
+
+        const double mu = -2.0 * numerator / denominator;
+
+        for (int i = 0; i <= (k + 1) / 2; ++i)
+        {
+            const double low  = coefficients[i] + mu * coefficients[k + 1 - i];
+            const double high = coefficients[k + 1 - i] + mu * coefficients[i];
+            coefficients[i] = low;
+            coefficients[k + 1 - i] = high;
+        }
+
+        for (int i = 0; i < n - k - 1; ++i)
+        {
+            const double f = forward[i + k + 1] + mu * backward[i];
+            const double b = backward[i] + mu * forward[i + k + 1];
+            forward[i + k + 1] = f;
+            backward[i] = b;
+        }
+    }
+}
+
+
+int PhaseEstimator::predictPhase (TargetPhase target, int horizon, int* offsets, int maxOffsets)
+{
+    if (! isPrepared() || historySize < PHASE_ESTIMATOR_WINDOW)
+        return 0;
+
+    double* x = window;
+    for (int i = 0; i < PHASE_ESTIMATOR_WINDOW; ++i)
+        x[i] = history[(historyPosition + i) % PHASE_ESTIMATOR_WINDOW];
+
+    fitModel (x);
+
+    // away from the centre of the band the filters shift the phase, which is undone at the frequency
+    // of the window, delaying the predicted times by the phase the filters lag by
+    const double w = 2.0 * double_Pi * getFrequency() / sampleRate;
+    const std::complex<double> z1 = std::polar (1.0, -w);
+    const std::complex<double> z2 = z1 * z1;
+    const double stagePhase = std::arg ((b0 + b2 * z2) / (1.0 + a1 * z1 + a2 * z2));
+    const int phaseShift = roundDoubleToInt (2.0 * stagePhase / w);
+
+    // the last decimated sample lies this many samples before the next one to come
+    const int lastOffset = -1 - samplesSinceDecimated + phaseShift;
+    const int numPredicted = jmin (PHASE_ESTIMATOR_MAX_HORIZON, (horizon - lastOffset) / decimation + 2);
+
+    for (int j = PHASE_ESTIMATOR_WINDOW; j < PHASE_ESTIMATOR_WINDOW + numPredicted; ++j)
+    {
+        double y = 0.0;
+        for (int k = 1; k <= PHASE_ESTIMATOR_ORDER; ++k)
+            y -= coefficients[k] * x[j - k];
+        x[j] = y;
+    }
+
+    int numOffsets = 0;
+
+    // a band leading the signal reaches the phase before the signal does, possibly already in the
+    // last observed samples; otherwise the search starts from the last one, so that a crossing right
+    // at the end of the block is found
+    const int firstSample = jmax (1, PHASE_ESTIMATOR_WINDOW - jmax (0, phaseShift) / decimation - 2);
+
+    for (int j = firstSample; j < PHASE_ESTIMATOR_WINDOW + numPredicted - 1 && numOffsets < maxOffsets; ++j)
+    {
+        const double previous = x[j - 1];
+        const double current  = x[j];
+        const double next     = x[j + 1];
+        double position = -1.0;   // in decimated samples after x[j - 1]
+
+        if (target == RISING_ZERO_PHASE && previous <= 0.0 && current > 0.0)
+            position = previous / (previous - current);
+        else if (target == FALLING_ZERO_PHASE && previous >= 0.0 && current < 0.0)
+            position = previous / (previous - current);
+        else if ((target == PEAK_PHASE && current > 0.0 && current >= previous && current > next)
+                 || (target == TROUGH_PHASE && current < 0.0 && current <= previous && current < next))
+        {
+            const double curvature = previous - 2.0 * current + next;
+            position = 1.0 + ((curvature != 0.0) ? 0.5 * (previous - next) / curvature : 0.0);
+        }
+
+        if (position < 0.0)
+            continue;
+
+        const int offset = lastOffset + roundDoubleToInt ((j - PHASE_ESTIMATOR_WINDOW + position) * decimation);
+
+        if (offset >= horizon)
+            break;
+
+        if (offset >= 0)
+            offsets[numOffsets++] = offset;
+    }
+
+    return numOffsets;
+}
+
+
+double PhaseEstimator::getFrequency() const
+{
+    if (! isPrepared())
+        return centreFrequency;
+
+    int numCrossings = 0;
+    int firstCrossing = 0;
+    int lastCrossing = 0;
+
+    for (int i = 1; i < historySize; ++i)
+    {
+        const int start = historyPosition - historySize + PHASE_ESTIMATOR_WINDOW;
+        const double previous = history[(start + i - 1) % PHASE_ESTIMATOR_WINDOW];
+        const double current  = history[(start + i) % PHASE_ESTIMATOR_WINDOW];
+
+        if (previous <= 0.0 && current > 0.0)
+        {
+            if (numCrossings++ == 0)
+                firstCrossing = i;
+            lastCrossing = i;
+        }
+    }
+
+    if (numCrossings < 2)
+        return centreFrequency;
+
+    return (numCrossings - 1) * sampleRate / (double (lastCrossing - firstCrossing) * decimation);
+}
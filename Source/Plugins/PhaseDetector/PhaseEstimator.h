@@ -0,0 +1,109 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __PHASEESTIMATOR_H_7C2E9B14__
+#define __PHASEESTIMATOR_H_7C2E9B14__
+
+#include <ProcessorHeaders.h>
+
+/** Decimated samples of the band the AR model is fitted on */
+#define PHASE_ESTIMATOR_WINDOW 256
+#define PHASE_ESTIMATOR_ORDER 16
+/** Decimated samples predicted at most */
+#define PHASE_ESTIMATOR_MAX_HORIZON 256
+
+
+/**
+    Predicts when a band of a signal will reach a given phase.
+
+    The signal goes through a causal band-pass, two biquads which have no phase shift at the
+    centre of the band, and is decimated to about twenty samples per period of the band's
+    upper edge. An AR model is fitted with Burg's method to the last PHASE_ESTIMATOR_WINDOW
+    decimated samples and runs the band forward, and the peaks, troughs and zero crossings of
+    that prediction are interpolated back to the full sample rate. Predicting from the end of
+    each block makes up for the delay of filtering, so triggers come at the phase of the
+    oscillation rather than after it, with no more than a sub-block of latency.
+
+    All buffers are allocated by prepare(), so that nothing is allocated while processing.
+
+    @see PhaseDetector
+*/
+class PhaseEstimator
+{
+public:
+    PhaseEstimator();
+    ~PhaseEstimator();
+
+    enum TargetPhase
+    {
+        PEAK_PHASE, FALLING_ZERO_PHASE, TROUGH_PHASE, RISING_ZERO_PHASE
+    };
+
+    /** Sets the band the phase is estimated in, clearing the history */
+    void prepare (double sampleRate, double lowCut, double highCut);
+    bool isPrepared() const;
+
+    /** Clears the filters and the history */
+    void reset();
+
+    /** Band-passes the samples and adds them to the history */
+    void processSamples (const float* samples, int numSamples);
+
+    /** Writes the offsets, counted from the sample after the last one processed and in increasing
+        order, at which the band is predicted to reach the target phase within horizon samples.
+        Returns how many were written, at most maxOffsets, and none until the window is full. */
+    int predictPhase (TargetPhase target, int horizon, int* offsets, int maxOffsets);
+
+    /** Returns the frequency of the band in the window, from the intervals between its rising
+        zero crossings, or the centre of the band until there are two of them */
+    double getFrequency() const;
+
+
+private:
+    /** Fits the AR coefficients to the window with Burg's method */
+    void fitModel (const double* x);
+
+    double sampleRate;
+    double centreFrequency;
+
+    // the two stages of the band-pass share their coefficients
+    double b0, b2, a1, a2;
+    double state[2][2];
+
+    int decimation;
+    int samplesSinceDecimated;
+
+    HeapBlock<double> history;      // ring of decimated samples
+    int historyPosition;
+    int historySize;
+
+    HeapBlock<double> window;       // the history in order, then the prediction
+    HeapBlock<double> forward;
+    HeapBlock<double> backward;
+    double coefficients[PHASE_ESTIMATOR_ORDER + 1];
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PhaseEstimator);
+};
+
+
+#endif  // __PHASEESTIMATOR_H_7C2E9B14__
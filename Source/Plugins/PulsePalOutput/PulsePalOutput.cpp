@@ -29,6 +29,7 @@
 PulsePalOutput::PulsePalOutput()
     : GenericProcessor  ("Pulse Pal")
     , channelToChange   (0)
+    , serialWorker      ("Pulse Pal")
 {
     setProcessorType (PROCESSOR_TYPE_SINK);
 
@@ -47,6 +48,7 @@ PulsePalOutput::PulsePalOutput()
 
 PulsePalOutput::~PulsePalOutput()
 {
+    pulsePal.stopSerialWorker();
     pulsePal.updateDisplay ("PULSE PAL v1.0","Click for menu");
 }
 
@@ -76,7 +78,8 @@ void PulsePalOutput::handleEvent (const EventChannel* eventInfo, const MidiMessa
                 && eventChannel == channelTtlTrigger[i]
                 && channelState[i])
             {
-                pulsePal.triggerChannel (i + 1);
+                serialWorker.trigger (i); // pulsePal.triggerChannel (i + 1), pre-armed
+                measureEventLatency (eventInfo);
             }
 
             if (eventChannel == channelTtlGate[i])
@@ -91,6 +94,43 @@ void PulsePalOutput::handleEvent (const EventChannel* eventInfo, const MidiMessa
 }
 
 
+bool PulsePalOutput::enable()
+{
+    serialWorker.disarmAll();
+    pulsePal.armTriggers (&serialWorker);
+    pulsePal.startSerialWorker (&serialWorker);
+    return true;
+}
+
+
+bool PulsePalOutput::disable()
+{
+    // after the last triggers are written
+    pulsePal.stopSerialWorker();
+
+    if (serialWorker.hasFailed() || serialWorker.getNumDroppedBytes() > 0)
+        CoreServices::sendStatusMessage ("Pulse Pal: some triggers could not be sent.");
+
+    const ProcessorTimingStats::Snapshot latency = serialWorker.getTriggerLatencyStats().getSnapshot();
+
+    if (latency.numBlocks > 0)
+    {
+        const String summary = "Pulse Pal trigger latency over " + String (latency.numBlocks) + " triggers: "
+                               + latency.getSummary() + "  max " + String (latency.maxMs, 2) + " ms";
+        std::cout << summary << std::endl;
+        CoreServices::sendStatusMessage (summary);
+    }
+
+    return true;
+}
+
+
+const ProcessorTimingStats& PulsePalOutput::getTriggerLatencyStats() const
+{
+    return serialWorker.getTriggerLatencyStats();
+}
+
+
 void PulsePalOutput::setParameter (int parameterIndex, float newValue)
 {
     editor->updateParameterButtons (parameterIndex);
@@ -44,10 +44,18 @@ public:
 
     void process (AudioSampleBuffer& buffer) override;
 
+    bool isPassThroughChannel (int) const override { return true; }
+
     void setParameter (int parameterIndex, float newValue) override;
 
     void handleEvent (const EventChannel* eventInfo, const MidiMessage& event, int sampleNum) override;
 
+    bool enable() override;
+    bool disable() override;
+
+    /** The time from each trigger until it was sent to the Pulse Pal, during the last acquisition. */
+    const ProcessorTimingStats& getTriggerLatencyStats() const;
+
 
 private:
     Array<int> channelTtlTrigger;
@@ -58,6 +66,10 @@ private:
 
     PulsePal pulsePal;
 
+    /** Writes to the Pulse Pal during acquisition, so that handleEvent() never waits for the port,
+        the triggers being pre-armed commands. */
+    SerialWorker serialWorker;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PulsePalOutput);
 };
 
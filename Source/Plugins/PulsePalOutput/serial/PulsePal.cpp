@@ -41,6 +41,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define makeLong(msb, byte2, byte3, lsb) ((msb << 24) | (byte2 << 16) | (byte3 << 8) | (lsb)) //JS  2/1/2014
 
 PulsePal::PulsePal()
+    : worker(nullptr)
 {
     setDefaultParameters();
         
@@ -48,10 +49,46 @@ PulsePal::PulsePal()
 
 PulsePal::~PulsePal()
 {
+    stopSerialWorker();
     disconnectClient();
     serial.close();
 }
 
+void PulsePal::startSerialWorker(SerialWorker* w)
+{
+    stopSerialWorker();
+    worker = w;
+    worker->start(&serial, false, 10); // the highest priority, for the triggers
+}
+
+void PulsePal::armTriggers(SerialWorker* w)
+{
+    // the parameters of the pulse trains are on the Pulse Pal already, triggering
+    // a channel only takes the 3 bytes of triggerChannel()
+    for (uint8_t chan = 1; chan < 5; chan++)
+    {
+        uint8_t bytesToWrite[3] = {213, 77, (uint8_t) (1 << (chan - 1))};
+        w->arm(chan - 1, bytesToWrite, 3);
+    }
+}
+
+void PulsePal::stopSerialWorker()
+{
+    if (worker != nullptr)
+    {
+        worker->stop();
+        worker = nullptr;
+    }
+}
+
+void PulsePal::writeBytes(unsigned char* buffer, int length)
+{
+    if (worker != nullptr)
+        worker->write(buffer, length);
+    else
+        serial.writeBytes(buffer, length);
+}
+
 void PulsePal::setDefaultParameters()
 {
 
@@ -109,7 +146,7 @@ uint32_t PulsePal::getFirmwareVersion() // JS 1/30/2014
     uint32_t firmwareVersion = 0;
     uint8_t responseBytes[5] = { 0 };
     uint8_t handshakeMessage[2] = {213, 72};
-    serial.writeBytes(handshakeMessage, 2);
+    writeBytes(handshakeMessage, 2);
         Sleep(100);
     serial.readBytes(responseBytes,5);
     firmwareVersion = makeLong(responseBytes[4], responseBytes[3], responseBytes[2], responseBytes[1]);
@@ -258,8 +295,8 @@ void PulsePal::program(uint8_t channel, uint8_t paramCode, uint32_t paramValue)
     message2[2] = (paramValue & 0xff0000) >> 16;
     message2[3] = (paramValue & 0xff00000) >> 24;
 
-    serial.writeBytes(message1, 4);
-    serial.writeBytes(message2, 4);
+    writeBytes(message1, 4);
+    writeBytes(message2, 4);
 
     //std::cout << "Message 1: " << (int) message1[0] << " " << (int) message1[1] << " " << (int) message1[2] << std::endl;
     //std::cout << "Message 2: " << (int) message2[0] << " " << (int) message2[1] << " " << (int) message2[2] <<  " " << (int) message2[3] << std::endl;
@@ -273,8 +310,8 @@ void PulsePal::program(uint8_t channel, uint8_t paramCode, uint8_t paramValue)
 
     uint8_t message1[4] = {213, 74, paramCode, channel};
 
-    serial.writeBytes(message1, 4);
-    serial.writeBytes(&paramValue, 1);
+    writeBytes(message1, 4);
+    writeBytes(&paramValue, 1);
 
     //std::cout << "Message 1: " << (int) message1[0] << " " << (int) message1[1] << " " << (int) message1[2] << std::endl;
     //std::cout << "Message 2: " << paramValue << std::endl;
@@ -288,7 +325,7 @@ void PulsePal::triggerChannel(uint8_t chan)
 
     uint8_t bytesToWrite[3] = {213, 77, code};
 
-    serial.writeBytes(bytesToWrite, 3);
+    writeBytes(bytesToWrite, 3);
 }
 
 void PulsePal::triggerChannels(uint8_t channel1, uint8_t channel2, uint8_t channel3, uint8_t channel4) // JS 1/30/2014
@@ -301,7 +338,7 @@ void PulsePal::triggerChannels(uint8_t channel1, uint8_t channel2, uint8_t chann
 
     uint8_t bytesToWrite[3] = {213, 77, code };
 
-    serial.writeBytes(bytesToWrite, 3);
+    writeBytes(bytesToWrite, 3);
 }
 
 void PulsePal::updateDisplay(string line1, string line2)
@@ -315,7 +352,7 @@ void PulsePal::updateDisplay(string line1, string line2)
     Prefix += 78;
     Prefix += Message.size();
     Prefix.append(Message);
-    serial.writeBytes((unsigned char*) Prefix.data(), (int) Prefix.size());
+    writeBytes((unsigned char*) Prefix.data(), (int) Prefix.size());
 }
 
 void PulsePal::setClientIDString(string idString)
@@ -326,7 +363,7 @@ void PulsePal::setClientIDString(string idString)
     int mSize = (int) idString.size();
     if (mSize == 6) {
         Prefix.append(idString);
-        serial.writeBytes((unsigned char*) Prefix.data(), (int) Prefix.size());
+        writeBytes((unsigned char*) Prefix.data(), (int) Prefix.size());
     }
     else {
         std::cout << "ClientID must be 6 characters. ClientID NOT set." << std::endl;
@@ -338,25 +375,25 @@ void PulsePal::setFixedVoltage(uint8_t channel, float voltage) // JS 1/30/2014
     uint8_t voltageByte = 0;
     voltageByte = voltageToByte(voltage);
     uint8_t message1[4] = { 213, 79, channel, voltageByte };
-    serial.writeBytes(message1, 4);
+    writeBytes(message1, 4);
 }
 
 void PulsePal::abortPulseTrains() // JS 1/30/2014
 {
     uint8_t message1[2] = { 213, 80 };
-    serial.writeBytes(message1,2);
+    writeBytes(message1,2);
 }
 
 void PulsePal::disconnectClient() // JS 1/30/2014
 {
     uint8_t message1[2] = { 213, 81 };
-    serial.writeBytes(message1,2);
+    writeBytes(message1,2);
 }
 
 void PulsePal::setContinuousLoop(uint8_t channel, uint8_t state) // JS 1/30/2014
 {
     uint8_t message1[4] = {213, 82, channel, state};
-    serial.writeBytes(message1, 4);
+    writeBytes(message1, 4);
 }
 
 
@@ -432,7 +469,7 @@ void PulsePal::sendCustomPulseTrain(uint8_t ID, uint8_t nPulses, float customPul
     for (int i = timeDataEnd; i < nMessageBytes; i++){
         messageBytes[i] = voltageBytes[i - timeDataEnd];
     }
-    serial.writeBytes(messageBytes, nMessageBytes);
+    writeBytes(messageBytes, nMessageBytes);
 }
 
 void PulsePal::syncAllParams() {
@@ -518,5 +555,5 @@ void PulsePal::syncAllParams() {
         messageBytes[pos] = (uint8_t)currentInputParams[1].triggerMode; pos++;
         messageBytes[pos] = (uint8_t)currentInputParams[2].triggerMode; pos++;
 
-    serial.writeBytes(messageBytes, 168);
+    writeBytes(messageBytes, 168);
 }
@@ -81,6 +81,13 @@ public:
     void setContinuousLoop(uint8_t channel, uint8_t state);
     void setTriggerMode(uint8_t channel, uint8_t mode);
     void setClientIDString(string idString);
+
+    // Hands the serial port over to worker, through which everything is then sent, until stopSerialWorker()
+    void startSerialWorker(SerialWorker* worker);
+    void stopSerialWorker();
+
+    // Arms the trigger of output channel n (1-4) as command n - 1 of worker, before it is started
+    void armTriggers(SerialWorker* worker);
     
     // Fields
     struct OutputParams {
@@ -111,7 +118,9 @@ private:
     void program(uint8_t channel, uint8_t paramCode, uint32_t paramValue);
     void program(uint8_t channel, uint8_t paramCode, uint8_t paramValue);
     uint8_t voltageToByte(float voltage);
+    void writeBytes(unsigned char* buffer, int length);
     ofSerial serial;
+    SerialWorker* worker;
 
 };
 
@@ -0,0 +1,644 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "PythonProcessor.h"
+#include "PythonProcessorEditor.h"
+
+#if JUCE_LINUX
+ #include <climits>
+ #include <linux/futex.h>
+ #include <sys/syscall.h>
+ #include <unistd.h>
+#endif
+
+#define PYTHON_PROCESSOR_HEADER_BYTES 4096
+#define PYTHON_PROCESSOR_SLOT_HEADER_BYTES 64
+
+
+/** Prints what the script writes, line by line, until it exits */
+class PythonProcessor::OutputThread : public Thread
+{
+public:
+    OutputThread (ChildProcess& p)
+        : Thread ("Python Processor output")
+        , process (p)
+    {
+    }
+
+    void run() override
+    {
+        String line;
+        char c;
+
+        // the pipe is read a byte at a time, as a longer read only returns once it is full
+        while (! threadShouldExit() && process.readProcessOutput (&c, 1) == 1)
+        {
+            if (c == '\n')
+            {
+                std::cout << "Python Processor: " << line << std::endl;
+                line = String();
+            }
+            else if (c != '\r')
+            {
+                line += c;
+            }
+        }
+
+        if (line.isNotEmpty())
+            std::cout << "Python Processor: " << line << std::endl;
+    }
+
+private:
+    ChildProcess& process;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OutputThread);
+};
+
+
+PythonProcessor::PythonProcessor()
+    : GenericProcessor      ("Python Processor")
+#if JUCE_WINDOWS
+    , interpreter           ("python")
+#else
+    , interpreter           ("python3")
+#endif
+    , latePolicy            (PASS_THROUGH)
+    , header                (nullptr)
+    , maxSamples            (0)
+    , blockNumber           (0)
+    , previousHandedOver    (false)
+    , previousSamples       (0)
+    , delayWritten          (0)
+    , delayRead             (0)
+{
+    setProcessorType (PROCESSOR_TYPE_FILTER);
+}
+
+
+PythonProcessor::~PythonProcessor()
+{
+    stopScript();
+
+    if (map != nullptr)
+    {
+        closeSharedFile();
+        file.deleteFile();
+    }
+}
+
+
+AudioProcessorEditor* PythonProcessor::createEditor()
+{
+    editor = new PythonProcessorEditor (this, true);
+    return editor;
+}
+
+
+File PythonProcessor::getScript() const
+{
+    return script;
+}
+
+
+void PythonProcessor::setScript (const File& newScript)
+{
+    // the editor only offers it while not acquiring
+    script = newScript;
+}
+
+
+String PythonProcessor::getInterpreter() const
+{
+    return interpreter;
+}
+
+
+void PythonProcessor::setInterpreter (const String& newInterpreter)
+{
+    if (newInterpreter.trim().isNotEmpty())
+        interpreter = newInterpreter.trim();
+}
+
+
+void PythonProcessor::setParameter (int parameterIndex, float newValue)
+{
+    if (parameterIndex == 0)
+        latePolicy = (roundFloatToInt (newValue) == SILENCE) ? SILENCE : PASS_THROUGH;
+}
+
+
+int PythonProcessor::getLatePolicy() const
+{
+    return latePolicy;
+}
+
+
+void PythonProcessor::publish (int32& field, int32 value)
+{
+    reinterpret_cast<Atomic<int32>&> (field).set (value);
+}
+
+
+int32 PythonProcessor::readShared (const int32& field)
+{
+    return reinterpret_cast<const Atomic<int32>&> (field).get();
+}
+
+
+void PythonProcessor::wakeScript()
+{
+    reinterpret_cast<Atomic<int32>&> (header->sequence) += 1;
+
+#if JUCE_LINUX
+    // not a private futex, as the script waits on its own mapping of the file
+    syscall (SYS_futex, &header->sequence, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#endif
+}
+
+
+File PythonProcessor::findRunner()
+{
+    // the executable is a few levels below the root of the repository, depending on the platform
+    File directory = File::getSpecialLocation (File::currentExecutableFile).getParentDirectory();
+
+    for (int i = 0; i < 8; ++i)
+    {
+        const File runner = directory.getChildFile ("Resources/Python/python_processor.py");
+
+        if (runner.existsAsFile())
+            return runner;
+
+        const File parent = directory.getParentDirectory();
+
+        if (parent == directory)
+            break;
+
+        directory = parent;
+    }
+
+    return File();
+}
+
+
+PythonBlockSlot* PythonProcessor::getSlot (int64 block) const
+{
+    char* slots = reinterpret_cast<char*> (header) + header->slotsOffset;
+    return reinterpret_cast<PythonBlockSlot*> (slots + (block % PYTHON_PROCESSOR_SLOTS) * header->slotBytes);
+}
+
+
+float* PythonProcessor::getSlotSamples (PythonBlockSlot* slot, int channel) const
+{
+    float* samples = reinterpret_cast<float*> (reinterpret_cast<char*> (slot) + PYTHON_PROCESSOR_SLOT_HEADER_BYTES);
+    return samples + (size_t) channel * maxSamples;
+}
+
+
+PythonBlockEvent* PythonProcessor::getSlotEvents (PythonBlockSlot* slot) const
+{
+    const uint64 samplesBytes = (uint64) channels.size() * maxSamples * sizeof (float);
+    const uint64 eventsOffset = PYTHON_PROCESSOR_SLOT_HEADER_BYTES + ((samplesBytes + 7) & ~(uint64) 7);
+
+    return reinterpret_cast<PythonBlockEvent*> (reinterpret_cast<char*> (slot) + eventsOffset);
+}
+
+
+bool PythonProcessor::createSharedFile()
+{
+    channels.clear();
+
+    Array<int> activeChannels = getEditor()->getActiveChannels();
+    const DataChannel* first = nullptr;
+
+    for (int i = 0; i < activeChannels.size(); ++i)
+    {
+        const DataChannel* channel = getDataChannel (activeChannels[i]);
+
+        if (channel == nullptr)
+            continue;
+
+        if (first == nullptr)
+            first = channel;
+        else if (channel->getSourceNodeID() != first->getSourceNodeID()
+                 || channel->getSubProcessorIdx() != first->getSubProcessorIdx())
+            continue;
+
+        channels.add (activeChannels[i]);
+    }
+
+    if (activeChannels.size() > channels.size())
+        std::cout << "Python Processor: only the channels of the first selected source are processed." << std::endl;
+
+    if (first == nullptr)
+    {
+        std::cout << "Python Processor: no channel selected." << std::endl;
+        return false;
+    }
+
+    // longer blocks are skipped, but the sources of this GUI send much shorter ones
+    maxSamples = jmax (1, (int) std::ceil (first->getSampleRate() * PYTHON_PROCESSOR_MAX_BLOCK_SECONDS));
+
+    const uint64 samplesBytes = (uint64) channels.size() * maxSamples * sizeof (float);
+    const uint64 eventsBytes = PYTHON_PROCESSOR_MAX_EVENTS * sizeof (PythonBlockEvent);
+    const uint64 slotBytes = (PYTHON_PROCESSOR_SLOT_HEADER_BYTES + ((samplesBytes + 7) & ~(uint64) 7) + eventsBytes + 63) & ~(uint64) 63;
+    const uint64 totalBytes = PYTHON_PROCESSOR_HEADER_BYTES + PYTHON_PROCESSOR_SLOTS * slotBytes;
+
+    File directory = File::getSpecialLocation (File::tempDirectory);
+
+#if JUCE_LINUX
+    if (File ("/dev/shm").isDirectory())
+        directory = File ("/dev/shm");
+#endif
+
+    // a script still mapping the previous file sees it closed, the new one being another file
+    file = directory.getChildFile ("open-ephys-python-" + String (getNodeId()) + ".shm");
+    file.deleteFile();
+
+    {
+        FileOutputStream stream (file);
+
+        if (stream.failedToOpen()
+            || ! stream.setPosition ((int64) totalBytes - 1)
+            || ! stream.writeByte (0))
+        {
+            std::cout << "Python Processor: failed to create " << file.getFullPathName() << std::endl;
+            return false;
+        }
+    }
+
+    map = new MemoryMappedFile (file, MemoryMappedFile::readWrite);
+
+    if (map->getData() == nullptr || map->getSize() < (size_t) totalBytes)
+    {
+        std::cout << "Python Processor: failed to map " << file.getFullPathName() << std::endl;
+        map = nullptr;
+        return false;
+    }
+
+    header = static_cast<PythonBlockHeader*> (map->getData());
+
+    zerostruct (*header);
+    strcpy (header->magic, "OEPYBLK");
+    header->version = PYTHON_PROCESSOR_VERSION;
+    header->headerBytes = PYTHON_PROCESSOR_HEADER_BYTES;
+    header->numChannels = (uint32) channels.size();
+    header->maxSamples = (uint32) maxSamples;
+    header->maxEvents = PYTHON_PROCESSOR_MAX_EVENTS;
+    header->eventBytes = sizeof (PythonBlockEvent);
+    header->sampleRate = first->getSampleRate();
+    header->numSlots = PYTHON_PROCESSOR_SLOTS;
+    header->slotBytes = slotBytes;
+    header->slotsOffset = PYTHON_PROCESSOR_HEADER_BYTES;
+
+    // the slots are all FREE, the file being created full of zeros
+
+    return true;
+}
+
+
+void PythonProcessor::closeSharedFile()
+{
+    if (header != nullptr)
+        publish (header->status, PythonBlockHeader::CLOSED);
+
+    header = nullptr;
+    map = nullptr;
+}
+
+
+bool PythonProcessor::startScript()
+{
+    const File runner = findRunner();
+
+    if (! runner.existsAsFile())
+    {
+        std::cout << "Python Processor: Resources/Python/python_processor.py not found." << std::endl;
+        return false;
+    }
+
+    StringArray arguments;
+    arguments.add (interpreter);
+    arguments.add ("-u");           // for its output to come as it is printed
+    arguments.add (runner.getFullPathName());
+    arguments.add (file.getFullPathName());
+    arguments.add (script.getFullPathName());
+
+    scriptProcess = new ChildProcess();
+
+    if (! scriptProcess->start (arguments, ChildProcess::wantStdOut | ChildProcess::wantStdErr))
+    {
+        std::cout << "Python Processor: failed to start " << interpreter << std::endl;
+        scriptProcess = nullptr;
+        return false;
+    }
+
+    outputThread = new OutputThread (*scriptProcess);
+    outputThread->startThread();
+
+    std::cout << "Python Processor: running " << script.getFullPathName()
+              << " on " << channels.size() << " channels" << std::endl;
+
+    return true;
+}
+
+
+void PythonProcessor::stopScript()
+{
+    if (header != nullptr)
+    {
+        publish (header->status, PythonBlockHeader::STOPPED);
+        wakeScript();
+    }
+
+    if (scriptProcess != nullptr && ! scriptProcess->waitForProcessToFinish (1000))
+    {
+        std::cout << "Python Processor: the script didn't return, killing it." << std::endl;
+        scriptProcess->kill();
+    }
+
+    // the thread returns once the pipe is closed, with the process gone
+    if (outputThread != nullptr)
+        outputThread->stopThread (2000);
+
+    outputThread = nullptr;
+    scriptProcess = nullptr;
+}
+
+
+bool PythonProcessor::enable()
+{
+    stopScript();
+    closeSharedFile();
+
+    blockNumber = 0;
+    previousHandedOver = false;
+    previousSamples = 0;
+    delayWritten = 0;
+    delayRead = 0;
+
+    blocksProcessed = 0;
+    blocksLate = 0;
+    blocksSkipped = 0;
+
+    // acquisition goes on without the script, the channels passing through
+    if (! script.existsAsFile())
+    {
+        std::cout << "Python Processor: no script selected." << std::endl;
+        return true;
+    }
+
+    if (! createSharedFile())
+        return true;
+
+    previousInput.setSize (channels.size(), maxSamples);
+    delayLine.setSize (channels.size(), 4 * maxSamples);
+    delayLine.clear();
+    blockEvents.clearQuick();
+    blockEvents.ensureStorageAllocated (PYTHON_PROCESSOR_MAX_EVENTS);
+
+    publish (header->status, PythonBlockHeader::ACQUIRING);
+
+    if (! startScript())
+    {
+        closeSharedFile();
+        file.deleteFile();
+    }
+
+    return true;
+}
+
+
+bool PythonProcessor::disable()
+{
+    stopScript();
+
+    if (map != nullptr)
+    {
+        closeSharedFile();
+        file.deleteFile();
+    }
+
+    return true;
+}
+
+
+void PythonProcessor::writeDelayLine (int channel, const float* source, int nSamples)
+{
+    const int capacity = delayLine.getNumSamples();
+
+    // of a block longer than the line, only its end is kept
+    const int skipped = jmax (0, nSamples - capacity);
+    const int start = (int) ((delayWritten + skipped) % capacity);
+    const int size1 = jmin (nSamples - skipped, capacity - start);
+    const int size2 = nSamples - skipped - size1;
+    float* dest = delayLine.getWritePointer (channel);
+
+    if (source != nullptr)
+    {
+        FloatVectorOperations::copy (dest + start, source + skipped, size1);
+        FloatVectorOperations::copy (dest, source + skipped + size1, size2);
+    }
+    else
+    {
+        FloatVectorOperations::clear (dest + start, size1);
+        FloatVectorOperations::clear (dest, size2);
+    }
+}
+
+
+void PythonProcessor::collectPreviousBlock()
+{
+    if (blockNumber == 0)
+        return;
+
+    const int nSamples = previousSamples;
+    PythonBlockSlot* slot = getSlot (blockNumber - 1);
+
+    if (previousHandedOver && readShared (slot->state) == PythonBlockSlot::DONE)
+    {
+        for (int c = 0; c < channels.size(); ++c)
+            writeDelayLine (c, getSlotSamples (slot, c), nSamples);
+
+        publish (slot->state, PythonBlockSlot::FREE);
+        ++blocksProcessed;
+    }
+    else
+    {
+        // the script finishes the block anyway, and the slot is filled again once it is done
+        if (previousHandedOver)
+            ++blocksLate;
+
+        for (int c = 0; c < channels.size(); ++c)
+            writeDelayLine (c, latePolicy == SILENCE ? nullptr : previousInput.getReadPointer (c), nSamples);
+    }
+
+    delayWritten += nSamples;
+    delayRead = jmax (delayRead, delayWritten - delayLine.getNumSamples());
+}
+
+
+void PythonProcessor::handOverBlock (const AudioSampleBuffer& buffer, int nSamples, int64 timestamp)
+{
+    // only reallocated for a block longer than any before
+    previousInput.setSize (channels.size(), jmax (nSamples, previousInput.getNumSamples()), true, false, true);
+
+    for (int c = 0; c < channels.size(); ++c)
+        previousInput.copyFrom (c, 0, buffer, channels[c], 0, nSamples);
+
+    previousSamples = nSamples;
+    previousHandedOver = false;
+
+    PythonBlockSlot* slot = getSlot (blockNumber);
+
+    // the script is still on the block before the previous one
+    if (readShared (slot->state) == PythonBlockSlot::READY || nSamples > maxSamples)
+    {
+        ++blocksSkipped;
+        return;
+    }
+
+    slot->blockNumber = blockNumber;
+    slot->timestamp = timestamp;
+    slot->numSamples = nSamples;
+    slot->numEvents = blockEvents.size();
+
+    for (int c = 0; c < channels.size(); ++c)
+        FloatVectorOperations::copy (getSlotSamples (slot, c), buffer.getReadPointer (channels[c]), nSamples);
+
+    if (blockEvents.size() > 0)
+        memcpy (getSlotEvents (slot), blockEvents.getRawDataPointer(), blockEvents.size() * sizeof (PythonBlockEvent));
+
+    publish (slot->state, PythonBlockSlot::READY);
+    wakeScript();
+
+    previousHandedOver = true;
+}
+
+
+void PythonProcessor::readDelayLine (AudioSampleBuffer& buffer, int nSamples)
+{
+    const int capacity = delayLine.getNumSamples();
+    const int available = (int) jmin<int64> (nSamples, delayWritten - delayRead);
+    const int padding = nSamples - available;
+    const int start = (int) (delayRead % capacity);
+    const int size1 = jmin (available, capacity - start);
+
+    for (int c = 0; c < channels.size(); ++c)
+    {
+        float* dest = buffer.getWritePointer (channels[c]);
+        const float* source = delayLine.getReadPointer (c);
+
+        FloatVectorOperations::clear (dest, padding);
+        FloatVectorOperations::copy (dest + padding, source + start, size1);
+        FloatVectorOperations::copy (dest + padding + size1, source, available - size1);
+    }
+
+    delayRead += available;
+}
+
+
+void PythonProcessor::process (AudioSampleBuffer& continuousBuffer)
+{
+    if (header == nullptr)
+        return;
+
+    const int nSamples = jmin ((int) getNumSamples (channels[0]), continuousBuffer.getNumSamples());
+    const int64 timestamp = (int64) getTimestamp (channels[0]);
+
+    blockEvents.clearQuick();
+    checkForEvents();
+
+    collectPreviousBlock();
+    handOverBlock (continuousBuffer, nSamples, timestamp);
+    readDelayLine (continuousBuffer, nSamples);
+
+    ++blockNumber;
+}
+
+
+void PythonProcessor::getEventSubscription (EventSubscription& subscription) const
+{
+    subscription.setEventTypes (EventSubscription::TTL_EVENTS);
+    subscription.setSpikes (false);
+    subscription.setTimestampSyncTexts (false);
+}
+
+
+void PythonProcessor::handleEvent (const EventChannel* eventInfo, const MidiMessage& event, int samplePosition)
+{
+    if (Event::getEventType (event) != EventChannel::TTL || blockEvents.size() >= PYTHON_PROCESSOR_MAX_EVENTS)
+        return;
+
+    TTLEventPtr ttl = TTLEvent::deserializeFromMessage (event, eventInfo);
+
+    PythonBlockEvent record;
+    record.timestamp = Event::getTimestamp (event);
+    record.sampleNumber = samplePosition;
+    record.line = (uint16) ttl->getChannel();
+    record.state = ttl->getState() ? 1 : 0;
+    record.reserved = 0;
+
+    blockEvents.add (record);
+}
+
+
+var PythonProcessor::getStatusInfo() const
+{
+    DynamicObject::Ptr info = new DynamicObject();
+    info->setProperty ("script", script.getFullPathName());
+    info->setProperty ("processed", blocksProcessed.get());
+    info->setProperty ("late", blocksLate.get());
+    info->setProperty ("skipped", blocksSkipped.get());
+    return var (info.get());
+}
+
+
+void PythonProcessor::saveCustomParametersToXml (XmlElement* parentElement)
+{
+    XmlElement* mainNode = parentElement->createNewChildElement ("PYTHON");
+    mainNode->setAttribute ("script", script.getFullPathName());
+    mainNode->setAttribute ("interpreter", interpreter);
+    mainNode->setAttribute ("latePolicy", latePolicy);
+}
+
+
+void PythonProcessor::loadCustomParametersFromXml()
+{
+    if (parametersAsXml)
+    {
+        forEachXmlChildElement (*parametersAsXml, mainNode)
+        {
+            if (mainNode->hasTagName ("PYTHON"))
+            {
+                const String path = mainNode->getStringAttribute ("script", String());
+
+                setScript (path.isNotEmpty() ? File (path) : File());
+                setInterpreter (mainNode->getStringAttribute ("interpreter", interpreter));
+                setParameter (0, (float) mainNode->getIntAttribute ("latePolicy", PASS_THROUGH));
+
+                static_cast<PythonProcessorEditor*> (getEditor())->updateSettingsFromProcessor();
+            }
+        }
+    }
+}
@@ -0,0 +1,242 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef PYTHONPROCESSOR_H_INCLUDED
+#define PYTHONPROCESSOR_H_INCLUDED
+
+#include <ProcessorHeaders.h>
+
+#define PYTHON_PROCESSOR_VERSION 1
+#define PYTHON_PROCESSOR_SLOTS 2
+#define PYTHON_PROCESSOR_MAX_BLOCK_SECONDS 0.1
+#define PYTHON_PROCESSOR_MAX_EVENTS 1024
+
+
+/**
+
+ Header at the start of the file the PythonProcessor shares with its script. The file holds,
+ after it, numSlots slots of slotBytes each, from slotsOffset on. Each slot is:
+
+   PythonBlockSlot                              its header
+   float32 samples[numChannels][maxSamples]     one row per channel, of which the first
+                                                numSamples samples are the block's
+   PythonBlockEvent events[maxEvents]           at the next multiple of 8 bytes
+
+ Block number n goes to slot n % numSlots. The processor only fills a FREE or DONE slot, and
+ marks it READY once everything is in place, then increments sequence, which the script
+ can wait on with a futex on Linux. The script marks the slot DONE once it has overwritten the
+ samples with its output, and the processor reads them back when the next block comes in,
+ which leaves the script one block of time. Everything is in the byte order of the machine.
+ Resources/Python/python_processor.py runs the user's script on this layout.
+
+ */
+
+struct PythonBlockHeader
+{
+    enum Status
+    {
+        STARTING = 0,           // the file is being laid out
+        ACQUIRING = 1,
+        STOPPED = 2,            // the script should return
+        CLOSED = 3              // the file was replaced or deleted
+    };
+
+    char magic[8];              // "OEPYBLK", with its terminating zero
+    uint32 version;             // PYTHON_PROCESSOR_VERSION
+    uint32 headerBytes;
+    uint32 numChannels;
+    uint32 maxSamples;
+    uint32 maxEvents;
+    uint32 eventBytes;          // sizeof (PythonBlockEvent)
+    float sampleRate;
+    uint32 numSlots;
+    uint64 slotBytes;
+    uint64 slotsOffset;
+    int32 status;               // a Status
+    int32 sequence;             // incremented each time a slot becomes READY
+};
+
+
+/** Header of a slot of the file shared with the script, as described with PythonBlockHeader */
+struct PythonBlockSlot
+{
+    enum State
+    {
+        FREE = 0,
+        READY = 1,              // holds a block for the script
+        DONE = 2                // holds the script's output
+    };
+
+    int64 blockNumber;          // counted from the start of acquisition
+    int64 timestamp;            // of the first sample, in samples of the source
+    int32 state;                // a State
+    int32 numSamples;
+    int32 numEvents;
+    int32 reserved;
+};
+
+
+/** A TTL event of a block, as described with PythonBlockHeader */
+struct PythonBlockEvent
+{
+    int64 timestamp;            // in samples of the event's source
+    int32 sampleNumber;         // in the block
+    uint16 line;
+    uint8 state;
+    uint8 reserved;
+};
+
+
+/**
+
+ Runs a Python script in a process of its own, and replaces the selected channels with what
+ it makes of them, so that a slow script or the interpreter's lock never holds up the chain.
+
+ When acquisition starts, the processor lays out a file shared with the script, in /dev/shm
+ on Linux and in the temporary directory elsewhere, and starts the interpreter on
+ Resources/Python/python_processor.py, which imports the script and calls its process() on each
+ block, with a numpy view of the samples in the file. The output of a block replaces the
+ next one, so the selected channels come one block late. A block the script isn't done with
+ by then is passed through unchanged, or silenced, as chosen, and blocks are skipped while it
+ is behind. The channels must come from a single source, as for the SharedMemoryOutput: the
+ one of the first selected channel is used, and the others are left unchanged.
+
+ @see PythonBlockHeader, PythonProcessorEditor
+
+ */
+
+class PythonProcessor : public GenericProcessor
+{
+public:
+    /** What replaces a block the script was late with */
+    enum LatePolicy
+    {
+        PASS_THROUGH = 0,
+        SILENCE = 1
+    };
+
+    PythonProcessor();
+    ~PythonProcessor();
+
+    AudioProcessorEditor* createEditor() override;
+
+    File getScript() const;
+    void setScript (const File& script);
+
+    /** The interpreter the script is run with, looked up in the path if not a full path */
+    String getInterpreter() const;
+    void setInterpreter (const String& interpreter);
+
+    /** Parameter 0 is the LatePolicy */
+    void setParameter (int parameterIndex, float newValue) override;
+
+    int getLatePolicy() const;
+
+    bool enable() override;
+    bool disable() override;
+
+    void process (AudioSampleBuffer& continuousBuffer) override;
+
+    void getEventSubscription (EventSubscription& subscription) const override;
+    void handleEvent (const EventChannel* eventInfo, const MidiMessage& event, int samplePosition) override;
+
+    /** The blocks processed by the script, late and skipped since acquisition started */
+    var getStatusInfo() const override;
+
+    void saveCustomParametersToXml (XmlElement* parentElement) override;
+    void loadCustomParametersFromXml() override;
+
+private:
+    /** Creates and maps the file for the selected channels, returning false if it could not */
+    bool createSharedFile();
+
+    /** Marks the mapped file as closed, for the script to let it go, and unmaps it */
+    void closeSharedFile();
+
+    /** Starts the interpreter on the runner and the script, returning false if it could not */
+    bool startScript();
+
+    /** Stops the script, killing it if it doesn't return by itself */
+    void stopScript();
+
+    PythonBlockSlot* getSlot (int64 block) const;
+    float* getSlotSamples (PythonBlockSlot* slot, int channel) const;
+    PythonBlockEvent* getSlotEvents (PythonBlockSlot* slot) const;
+
+    /** Moves the output of the previous block, or what replaces it, to the delay line */
+    void collectPreviousBlock();
+
+    /** Copies the current block to its slot, and wakes the script up */
+    void handOverBlock (const AudioSampleBuffer& buffer, int nSamples, int64 timestamp);
+
+    /** Appends nSamples of a channel to the delay line, or zeros if source is null */
+    void writeDelayLine (int channel, const float* source, int nSamples);
+
+    /** Moves nSamples from the delay line to the channels, after zeros if it holds fewer */
+    void readDelayLine (AudioSampleBuffer& buffer, int nSamples);
+
+    /** Writes a field of the shared file, after everything written before it */
+    static void publish (int32& field, int32 value);
+    static int32 readShared (const int32& field);
+
+    /** Wakes the script up if it waits on the sequence of the header */
+    void wakeScript();
+
+    /** Locates Resources/Python/python_processor.py from the executable */
+    static File findRunner();
+
+    class OutputThread;
+
+    File script;
+    String interpreter;
+    int latePolicy;
+
+    Array<int> channels;
+    File file;
+    ScopedPointer<MemoryMappedFile> map;
+    ScopedPointer<ChildProcess> scriptProcess;
+    ScopedPointer<OutputThread> outputThread;
+
+    PythonBlockHeader* header;
+    int maxSamples;
+
+    int64 blockNumber;
+    bool previousHandedOver;
+    int previousSamples;
+    AudioSampleBuffer previousInput;
+    Array<PythonBlockEvent> blockEvents;
+
+    AudioSampleBuffer delayLine;
+    int64 delayWritten;
+    int64 delayRead;
+
+    Atomic<int> blocksProcessed;
+    Atomic<int> blocksLate;
+    Atomic<int> blocksSkipped;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PythonProcessor);
+};
+
+
+#endif  // PYTHONPROCESSOR_H_INCLUDED
@@ -0,0 +1,146 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "PythonProcessorEditor.h"
+#include "PythonProcessor.h"
+
+
+PythonProcessorEditor::PythonProcessorEditor (GenericProcessor* parentNode, bool useDefaultParameterEditors)
+    : GenericEditor (parentNode, useDefaultParameterEditors)
+    , lastDirectory (CoreServices::getDefaultUserSaveDirectory())
+{
+    desiredWidth = 220;
+
+    scriptButton = new UtilityButton ("Script", Font ("Small Text", 13, Font::plain));
+    scriptButton->setBounds (10, 30, 55, 20);
+    scriptButton->setTooltip ("Choose the Python script, which defines process(data, events)");
+    scriptButton->addListener (this);
+    addAndMakeVisible (scriptButton);
+
+    scriptLabel = new Label ("Script", "No script");
+    scriptLabel->setBounds (70, 30, 140, 20);
+    scriptLabel->setFont (Font ("Small Text", 12, Font::plain));
+    scriptLabel->setColour (Label::textColourId, Colours::darkgrey);
+    addAndMakeVisible (scriptLabel);
+
+    interpreterTitle = new Label ("Interpreter", "Interpreter:");
+    interpreterTitle->setBounds (10, 58, 80, 20);
+    interpreterTitle->setFont (Font ("Small Text", 12, Font::plain));
+    interpreterTitle->setColour (Label::textColourId, Colours::darkgrey);
+    addAndMakeVisible (interpreterTitle);
+
+    interpreterLabel = new Label ("Interpreter", String());
+    interpreterLabel->setBounds (90, 59, 120, 18);
+    interpreterLabel->setFont (Font ("Default", 13, Font::plain));
+    interpreterLabel->setColour (Label::textColourId, Colours::white);
+    interpreterLabel->setColour (Label::backgroundColourId, Colours::grey);
+    interpreterLabel->setEditable (true);
+    interpreterLabel->setTooltip ("Python interpreter with numpy, looked up in the path if not a full path");
+    interpreterLabel->addListener (this);
+    addAndMakeVisible (interpreterLabel);
+
+    lateTitle = new Label ("Late", "When late:");
+    lateTitle->setBounds (10, 86, 80, 20);
+    lateTitle->setFont (Font ("Small Text", 12, Font::plain));
+    lateTitle->setColour (Label::textColourId, Colours::darkgrey);
+    addAndMakeVisible (lateTitle);
+
+    // item ids are the LatePolicy values plus one
+    lateSelector = new ComboBox ("Late");
+    lateSelector->setBounds (90, 87, 120, 18);
+    lateSelector->addItem ("Pass through", PythonProcessor::PASS_THROUGH + 1);
+    lateSelector->addItem ("Silence", PythonProcessor::SILENCE + 1);
+    lateSelector->setTooltip ("What replaces a block the script isn't done with in time");
+    lateSelector->addListener (this);
+    addAndMakeVisible (lateSelector);
+
+    updateSettingsFromProcessor();
+}
+
+
+PythonProcessorEditor::~PythonProcessorEditor()
+{
+}
+
+
+void PythonProcessorEditor::updateSettingsFromProcessor()
+{
+    PythonProcessor* processor = static_cast<PythonProcessor*> (getProcessor());
+    const File script = processor->getScript();
+
+    scriptLabel->setText (script != File() ? script.getFileName() : String ("No script"), dontSendNotification);
+    scriptLabel->setTooltip (script.getFullPathName());
+    interpreterLabel->setText (processor->getInterpreter(), dontSendNotification);
+    lateSelector->setSelectedId (processor->getLatePolicy() + 1, dontSendNotification);
+}
+
+
+void PythonProcessorEditor::buttonEvent (Button* button)
+{
+    if (button == scriptButton && ! acquisitionIsActive)
+    {
+        FileChooser fc ("Choose a Python script...", lastDirectory, "*.py", true);
+
+        if (fc.browseForFileToOpen())
+        {
+            lastDirectory = fc.getResult().getParentDirectory();
+            static_cast<PythonProcessor*> (getProcessor())->setScript (fc.getResult());
+        }
+
+        updateSettingsFromProcessor();
+    }
+}
+
+
+void PythonProcessorEditor::labelTextChanged (Label* label)
+{
+    if (label == interpreterLabel)
+        static_cast<PythonProcessor*> (getProcessor())->setInterpreter (label->getText());
+
+    updateSettingsFromProcessor();
+}
+
+
+void PythonProcessorEditor::comboBoxChanged (ComboBox* comboBox)
+{
+    if (comboBox == lateSelector)
+        getProcessor()->setParameter (0, float (lateSelector->getSelectedId() - 1));
+}
+
+
+void PythonProcessorEditor::startAcquisition()
+{
+    // the script is started with acquisition
+    scriptButton->setEnabled (false);
+    interpreterLabel->setEditable (false);
+    lateSelector->setEnabled (false);
+}
+
+
+void PythonProcessorEditor::stopAcquisition()
+{
+    scriptButton->setEnabled (true);
+    interpreterLabel->setEditable (true);
+    lateSelector->setEnabled (true);
+}
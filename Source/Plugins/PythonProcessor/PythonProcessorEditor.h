@@ -0,0 +1,73 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef PYTHONPROCESSOREDITOR_H_INCLUDED
+#define PYTHONPROCESSOREDITOR_H_INCLUDED
+
+#include <EditorHeaders.h>
+
+
+/**
+
+ User interface for the Python Processor: chooses the script, the interpreter it is run
+ with and what replaces a block it is late with. The channels to process are those selected
+ in the channel selector when acquisition starts.
+
+ @see PythonProcessor
+
+ */
+
+class PythonProcessorEditor : public GenericEditor
+                            , public Label::Listener
+                            , public ComboBox::Listener
+{
+public:
+    PythonProcessorEditor (GenericProcessor* parentNode, bool useDefaultParameterEditors);
+    ~PythonProcessorEditor();
+
+    void buttonEvent (Button* button) override;
+    void labelTextChanged (Label* label) override;
+    void comboBoxChanged (ComboBox* comboBox) override;
+
+    void startAcquisition() override;
+    void stopAcquisition() override;
+
+    /** Shows the settings of the processor, after they were loaded */
+    void updateSettingsFromProcessor();
+
+private:
+    ScopedPointer<UtilityButton> scriptButton;
+    ScopedPointer<Label>         scriptLabel;
+    ScopedPointer<Label>         interpreterTitle;
+    ScopedPointer<Label>         interpreterLabel;
+    ScopedPointer<Label>         lateTitle;
+    ScopedPointer<ComboBox>      lateSelector;
+
+    File lastDirectory;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PythonProcessorEditor);
+};
+
+
+#endif  // PYTHONPROCESSOREDITOR_H_INCLUDED
@@ -0,0 +1,25 @@
+# An example script for the Python Processor, smoothing each channel.
+#
+# process() is called once per block, with the samples of the block in data,
+# one row per channel, which it overwrites with its output.
+
+import numpy as np
+
+f = 0.05
+last = None
+
+
+def start(sample_rate, num_channels):
+    global last
+    last = np.zeros(num_channels, np.float32)
+
+
+def process(data, events):
+    for i in range(data.shape[1]):
+        data[:, i] = f * data[:, i] + (1 - f) * last
+        last[:] = data[:, i]
+
+    # events holds the TTL events of the block, e.g.
+    #
+    # for event in events:
+    #     print(event['line'], event['state'], event['sample_number'])
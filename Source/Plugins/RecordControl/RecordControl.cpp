@@ -27,6 +27,7 @@
 
 RecordControl::RecordControl()
     : GenericProcessor  ("Record Control")
+    , triggerEvent      (-1)
     , triggerChannel    (0)
 {
     setProcessorType (PROCESSOR_TYPE_UTILITY);
@@ -50,6 +51,7 @@ void RecordControl::setParameter (int parameterIndex, float newValue)
     if (parameterIndex == 0)
     {
 		triggerEvent = static_cast<int>(newValue);
+        updateEventSubscription();
     }
 	else if (parameterIndex == 1)
 	{
@@ -78,6 +80,18 @@ void RecordControl::process (AudioSampleBuffer& buffer)
 }
 
 
+void RecordControl::getEventSubscription (EventSubscription& subscription) const
+{
+    // only the TTLs of the trigger channel
+    subscription.clear();
+    subscription.setEventTypes (EventSubscription::TTL_EVENTS);
+
+    const int trigger = triggerEvent;
+    if (trigger >= 0 && trigger < eventChannelArray.size())
+        subscription.addEventChannel (trigger);
+}
+
+
 void RecordControl::handleEvent (const EventChannel* eventInfo, const MidiMessage& event, int)
 {
 	if (triggerEvent < 0) return;
@@ -42,8 +42,12 @@ public:
 
     void process (AudioSampleBuffer& buffer) override;
 
+    bool isDataPassThrough() const override { return true; }
+    bool isPassThroughChannel (int) const override { return true; }
+
     void setParameter (int parameterIndex, float newValue) override;
     void handleEvent (const EventChannel* eventInfo, const MidiMessage& event, int) override;
+    void getEventSubscription (EventSubscription& subscription) const override;
 
     bool enable() override;
 
@@ -24,15 +24,110 @@
 
 #include <stdio.h>
 #include "Rectifier.h"
+#include "RectifierEditor.h"
+
+#if JUCE_INTEL && (defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2))
+ #define RECTIFIER_SSE2 1
+ #include <emmintrin.h>
+#endif
+
+// samples of a group interleaved at once, small enough to stay in the stack and in cache
+#define RECTIFIER_BLOCK_SAMPLES 256
+
+namespace
+{
+    /** Runs numSamples interleaved samples of RECTIFIER_LANES lanes through their windows in place,
+        writing the RMS if isRms, the mean of abs times scale otherwise. */
+    template <bool isRms>
+    void processWindowScalar (float* x, int numSamples, float* history, int windowSamples, int& position,
+                              double* sums, double scale)
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            float* in   = x + i * RECTIFIER_LANES;
+            float* past = history + position * RECTIFIER_LANES;
+
+            for (int lane = 0; lane < RECTIFIER_LANES; ++lane)
+            {
+                const float e = isRms ? in[lane] * in[lane] : fabsf (in[lane]);
+                sums[lane] += double (e) - double (past[lane]);
+                past[lane] = e;
+
+                in[lane] = isRms ? float (std::sqrt (jmax (0.0, sums[lane] * scale)))
+                                 : float (sums[lane] * scale);
+            }
+
+            if (++position == windowSamples)
+                position = 0;
+        }
+    }
+
+   #if RECTIFIER_SSE2
+    template <bool isRms>
+    void processWindowSSE2 (float* x, int numSamples, float* history, int windowSamples, int& position,
+                            double* sums, double scale)
+    {
+        __m128d sumLow  = _mm_loadu_pd (sums);
+        __m128d sumHigh = _mm_loadu_pd (sums + 2);
+        const __m128d scales = _mm_set1_pd (scale);
+        const __m128d zero   = _mm_setzero_pd();
+        const __m128 absMask = _mm_castsi128_ps (_mm_set1_epi32 (0x7fffffff));
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            float* in   = x + i * RECTIFIER_LANES;
+            float* past = history + position * RECTIFIER_LANES;
+
+            const __m128 value = _mm_loadu_ps (in);
+            const __m128 e     = isRms ? _mm_mul_ps (value, value) : _mm_and_ps (value, absMask);
+            const __m128 old   = _mm_loadu_ps (past);
+            _mm_storeu_ps (past, e);
+
+            sumLow  = _mm_add_pd (sumLow,  _mm_sub_pd (_mm_cvtps_pd (e), _mm_cvtps_pd (old)));
+            sumHigh = _mm_add_pd (sumHigh, _mm_sub_pd (_mm_cvtps_pd (_mm_movehl_ps (e, e)),
+                                                       _mm_cvtps_pd (_mm_movehl_ps (old, old))));
+
+            __m128d outLow  = _mm_mul_pd (sumLow,  scales);
+            __m128d outHigh = _mm_mul_pd (sumHigh, scales);
+
+            if (isRms)
+            {
+                outLow  = _mm_sqrt_pd (_mm_max_pd (outLow,  zero));
+                outHigh = _mm_sqrt_pd (_mm_max_pd (outHigh, zero));
+            }
+
+            _mm_storeu_ps (in, _mm_movelh_ps (_mm_cvtpd_ps (outLow), _mm_cvtpd_ps (outHigh)));
+
+            if (++position == windowSamples)
+                position = 0;
+        }
+
+        _mm_storeu_pd (sums,     sumLow);
+        _mm_storeu_pd (sums + 2, sumHigh);
+    }
+   #endif
+
+    template <bool isRms>
+    void processWindow (float* x, int numSamples, float* history, int windowSamples, int& position,
+                        double* sums, double scale)
+    {
+       #if RECTIFIER_SSE2
+        processWindowSSE2<isRms> (x, numSamples, history, windowSamples, position, sums, scale);
+       #else
+        processWindowScalar<isRms> (x, numSamples, history, windowSamples, position, sums, scale);
+       #endif
+    }
+}
 
 
 Rectifier::Rectifier()
     : GenericProcessor ("Rectifier")
+    , mode              (ABS_MODE)
+    , windowMs          (10)
+    , groupsChanged     (1)
+    , processedMode     (ABS_MODE)
 {
     setProcessorType (PROCESSOR_TYPE_FILTER);
-
-    // It would be nice to have the option to do -abs for negative events (e.g. sharp waves)
-    //parameters.add(Parameter("Sign", -1.0, 1.0, 1.0, -1.0));
 }
 
 
@@ -41,29 +136,166 @@ Rectifier::~Rectifier()
 }
 
 
+AudioProcessorEditor* Rectifier::createEditor()
+{
+    editor = new RectifierEditor (this, true);
+    return editor;
+}
+
+
+void Rectifier::updateSettings()
+{
+    groupsChanged = 1;
+}
+
+
+Rectifier::RectifierMode Rectifier::getMode() const
+{
+    return RectifierMode (mode.get());
+}
+
+
+float Rectifier::getWindowMs() const
+{
+    return float (windowMs.get());
+}
+
+
 void Rectifier::setParameter (int parameterIndex, float newValue)
 {
-    editor->updateParameterButtons (parameterIndex);
+    // mode
+    if (parameterIndex == 0)
+    {
+        mode = jlimit (int (ABS_MODE), int (ENVELOPE_MODE), roundFloatToInt (newValue));
+        groupsChanged = 1;
+    }
+    // envelope window, in ms
+    else if (parameterIndex == 1)
+    {
+        windowMs = jlimit (1, RECTIFIER_MAX_WINDOW_MS, roundFloatToInt (newValue));
+        groupsChanged = 1;
+    }
+}
+
 
-    if (currentChannel >= 0)
+void Rectifier::updateGroups()
+{
+    groupsChanged = 0;
+    processedMode = mode.get();
+    groups.clear();
+
+    if (processedMode != RMS_MODE && processedMode != ENVELOPE_MODE)
+        return;
+
+    const int numChannels = jmin (getNumInputs(), dataChannelArray.size());
+    WindowGroup* group = nullptr;
+
+    // a group's channels share a source, so that they have as many samples, and a window length
+    for (int ch = 0; ch < numChannels; ++ch)
     {
-        Parameter* p =  parameters[parameterIndex];
-        p->setValue (newValue, currentChannel);
+        const DataChannel* channel = dataChannelArray[ch];
+        const int windowSamples = jmax (1, roundDoubleToInt (windowMs.get() * channel->getSampleRate() / 1000.0));
+
+        if (group == nullptr
+            || group->numLanes == RECTIFIER_LANES
+            || group->windowSamples != windowSamples
+            || getProcessorFullId (dataChannelArray[group->channels[0]]->getSourceNodeID(),
+                                   dataChannelArray[group->channels[0]]->getSubProcessorIdx())
+               != getProcessorFullId (channel->getSourceNodeID(), channel->getSubProcessorIdx()))
+        {
+            group = groups.add (new WindowGroup());
+            group->numLanes = 0;
+            group->windowSamples = windowSamples;
+            group->position = 0;
+            group->history.calloc (size_t (windowSamples) * RECTIFIER_LANES);
+
+            for (int lane = 0; lane < RECTIFIER_LANES; ++lane)
+                group->sums[lane] = 0.0;
+        }
+
+        group->channels[group->numLanes++] = ch;
     }
 }
 
 
 void Rectifier::process (AudioSampleBuffer& buffer)
 {
-    const int nChannels = buffer.getNumChannels();
+    if (groupsChanged.get() != 0)
+        updateGroups();
+
+    if (processedMode == RMS_MODE || processedMode == ENVELOPE_MODE)
+        processChannelsInParallel (buffer, groups.size());
+    else
+        processChannelsInParallel (buffer, buffer.getNumChannels());
+}
+
 
-    for (int ch = 0; ch < nChannels ; ++ch)
+void Rectifier::processChannels (AudioSampleBuffer& buffer, int firstChannel, int lastChannel)
+{
+    if (processedMode == RMS_MODE || processedMode == ENVELOPE_MODE)
+    {
+        for (int g = firstChannel; g < lastChannel; ++g)
+        {
+            WindowGroup& group = *groups.getUnchecked (g);
+            processWindowGroup (group, buffer, getNumSamples (group.channels[0]));
+        }
+
+        return;
+    }
+
+    for (int ch = firstChannel; ch < lastChannel; ++ch)
     {
         const int nSamples = buffer.getNumSamples();
         float* bufPtr = buffer.getWritePointer (ch);
-        for (int n = 0; n < nSamples; ++n)
+
+        if (processedMode == SQUARE_MODE)
+        {
+            FloatVectorOperations::multiply (bufPtr, bufPtr, nSamples);
+        }
+        else
+        {
+            FloatVectorOperations::abs (bufPtr, bufPtr, nSamples);
+
+            if (processedMode == NEGATIVE_ABS_MODE)
+                FloatVectorOperations::negate (bufPtr, bufPtr, nSamples);
+        }
+    }
+}
+
+
+void Rectifier::processWindowGroup (WindowGroup& group, AudioSampleBuffer& buffer, int numSamples)
+{
+    float* data[RECTIFIER_LANES];
+    for (int lane = 0; lane < group.numLanes; ++lane)
+        data[lane] = buffer.getWritePointer (group.channels[lane]);
+
+    const bool isRms = (processedMode == RMS_MODE);
+    const double scale = isRms ? 1.0 / group.windowSamples : double_Pi / 2.0 / group.windowSamples;
+
+    float x[RECTIFIER_BLOCK_SAMPLES * RECTIFIER_LANES];
+
+    for (int start = 0; start < numSamples; start += RECTIFIER_BLOCK_SAMPLES)
+    {
+        const int n = jmin (RECTIFIER_BLOCK_SAMPLES, numSamples - start);
+
+        // lanes left over run on silence
+        for (int lane = 0; lane < RECTIFIER_LANES; ++lane)
+        {
+            const float* in = (lane < group.numLanes) ? data[lane] + start : nullptr;
+            for (int i = 0; i < n; ++i)
+                x[i * RECTIFIER_LANES + lane] = (in != nullptr) ? in[i] : 0.0f;
+        }
+
+        if (isRms)
+            processWindow<true>  (x, n, group.history, group.windowSamples, group.position, group.sums, scale);
+        else
+            processWindow<false> (x, n, group.history, group.windowSamples, group.position, group.sums, scale);
+
+        for (int lane = 0; lane < group.numLanes; ++lane)
         {
-            *(bufPtr + n) = fabsf (*(bufPtr + n));
+            float* out = data[lane] + start;
+            for (int i = 0; i < n; ++i)
+                out[i] = x[i * RECTIFIER_LANES + lane];
         }
     }
 }
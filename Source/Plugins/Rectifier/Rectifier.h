@@ -32,7 +32,21 @@
 #include <ProcessorHeaders.h>
 
 
-/** A simple rectifier */
+/** Channels whose windowed envelopes are computed together, one per SIMD lane */
+#define RECTIFIER_LANES 4
+#define RECTIFIER_MAX_WINDOW_MS 100
+
+
+/**
+    A simple rectifier, which can also output the envelope of each channel.
+
+    The abs, -abs (for negative events, e.g. sharp waves) and squared outputs are computed
+    channel by channel with the SIMD FloatVectorOperations. The RMS and the smoothed envelope
+    (the mean of abs over the window, scaled by pi/2 so that it follows the amplitude of a
+    sinusoid) keep a running sum over a window of past samples. That recursion is serial
+    along a channel, so RECTIFIER_LANES channels are interleaved and run in the lanes of
+    SSE2 registers.
+*/
 class Rectifier : public GenericProcessor
 {
 public:
@@ -56,6 +70,30 @@ public:
      */
     void process (AudioSampleBuffer& buffer) override;
 
+    /** Channels are rectified independently, so they can be split across threads.*/
+    bool isChannelParallelSafe() const override { return true; }
+
+    /** In the windowed modes, the range is one of groups of RECTIFIER_LANES channels */
+    void processChannels (AudioSampleBuffer& buffer, int firstChannel, int lastChannel) override;
+
+    AudioProcessorEditor* createEditor() override;
+
+    bool hasEditor() const override { return true; }
+
+    void updateSettings() override;
+
+    enum RectifierMode
+    {
+        ABS_MODE = 0,
+        NEGATIVE_ABS_MODE,
+        SQUARE_MODE,
+        RMS_MODE,
+        ENVELOPE_MODE
+    };
+
+    RectifierMode getMode() const;
+    float getWindowMs() const;
+
     /** Any variables used by the "process" function _must_ be modified only through
      this method while data acquisition is active. If they are modified in any
      other way, the application will crash.  */
@@ -63,6 +101,28 @@ public:
 
 
 private:
+    /** Lays out the windows of the channels again, cleared */
+    void updateGroups();
+
+    struct WindowGroup
+    {
+        int channels[RECTIFIER_LANES];
+        int numLanes;
+        int windowSamples;
+        int position;
+        HeapBlock<float> history;       // interleaved window of past squares or abs
+        double sums[RECTIFIER_LANES];
+    };
+
+    void processWindowGroup (WindowGroup& group, AudioSampleBuffer& buffer, int numSamples);
+
+    Atomic<int> mode;
+    Atomic<int> windowMs;
+    Atomic<int> groupsChanged;
+
+    int processedMode;
+    OwnedArray<WindowGroup> groups;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Rectifier);
 };
 
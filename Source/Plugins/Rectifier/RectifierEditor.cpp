@@ -0,0 +1,118 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "RectifierEditor.h"
+#include "Rectifier.h"
+
+
+RectifierEditor::RectifierEditor (GenericProcessor* parentNode, bool useDefaultParameterEditors)
+    : GenericEditor (parentNode, useDefaultParameterEditors)
+{
+    desiredWidth = 130;
+
+    modeLabel = new Label ("mode label", "Output:");
+    modeLabel->setBounds (10, 25, 80, 20);
+    modeLabel->setFont (Font ("Small Text", 12, Font::plain));
+    modeLabel->setColour (Label::textColourId, Colours::darkgrey);
+    addAndMakeVisible (modeLabel);
+
+    // item ids are the Rectifier modes plus one
+    modeSelector = new ComboBox ("mode selector");
+    modeSelector->setBounds (15, 42, 100, 20);
+    modeSelector->addItem ("abs",       Rectifier::ABS_MODE + 1);
+    modeSelector->addItem ("-abs",      Rectifier::NEGATIVE_ABS_MODE + 1);
+    modeSelector->addItem ("Squared",   Rectifier::SQUARE_MODE + 1);
+    modeSelector->addItem ("RMS",       Rectifier::RMS_MODE + 1);
+    modeSelector->addItem ("Envelope",  Rectifier::ENVELOPE_MODE + 1);
+    modeSelector->setSelectedId (Rectifier::ABS_MODE + 1, dontSendNotification);
+    modeSelector->addListener (this);
+    addAndMakeVisible (modeSelector);
+
+    windowLabel = new Label ("window label", "Window (ms):");
+    windowLabel->setBounds (10, 67, 100, 20);
+    windowLabel->setFont (Font ("Small Text", 12, Font::plain));
+    windowLabel->setColour (Label::textColourId, Colours::darkgrey);
+    addAndMakeVisible (windowLabel);
+
+    // item ids are the window lengths in ms
+    windowSelector = new ComboBox ("window selector");
+    windowSelector->setBounds (15, 84, 100, 20);
+    const int windows[] = { 1, 2, 5, 10, 20, 50, 100 };
+    for (int i = 0; i < numElementsInArray (windows); ++i)
+        windowSelector->addItem (String (windows[i]), windows[i]);
+    windowSelector->setSelectedId (10, dontSendNotification);
+    windowSelector->setTooltip ("Window the RMS and the envelope are computed over");
+    windowSelector->setEnabled (false);
+    windowSelector->addListener (this);
+    addAndMakeVisible (windowSelector);
+}
+
+
+RectifierEditor::~RectifierEditor()
+{
+}
+
+
+void RectifierEditor::comboBoxChanged (ComboBox* comboBox)
+{
+    if (comboBox == modeSelector)
+    {
+        const int mode = modeSelector->getSelectedId() - 1;
+
+        getProcessor()->setParameter (0, float (mode));
+        windowSelector->setEnabled (mode == Rectifier::RMS_MODE || mode == Rectifier::ENVELOPE_MODE);
+    }
+    else if (comboBox == windowSelector)
+    {
+        getProcessor()->setParameter (1, float (windowSelector->getSelectedId()));
+    }
+}
+
+
+void RectifierEditor::saveCustomParameters (XmlElement* xml)
+{
+    xml->setAttribute ("Type", "RectifierEditor");
+
+    XmlElement* values = xml->createNewChildElement ("VALUES");
+    values->setAttribute ("Mode",     modeSelector->getSelectedId() - 1);
+    values->setAttribute ("WindowMs", windowSelector->getSelectedId());
+}
+
+
+void RectifierEditor::loadCustomParameters (XmlElement* xml)
+{
+    forEachXmlChildElement (*xml, xmlNode)
+    {
+        if (xmlNode->hasTagName ("VALUES"))
+        {
+            const int mode = xmlNode->getIntAttribute ("Mode", Rectifier::ABS_MODE);
+            modeSelector->setSelectedId (jlimit (int (Rectifier::ABS_MODE), int (Rectifier::ENVELOPE_MODE), mode) + 1,
+                                         sendNotification);
+
+            const int windowMs = xmlNode->getIntAttribute ("WindowMs", 10);
+            windowSelector->setSelectedId (windowSelector->indexOfItemId (windowMs) >= 0 ? windowMs : 10,
+                                           sendNotification);
+        }
+    }
+}
@@ -0,0 +1,59 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef RECTIFIEREDITOR_H_INCLUDED
+#define RECTIFIEREDITOR_H_INCLUDED
+
+
+#include <EditorHeaders.h>
+
+
+/**
+    User interface for the Rectifier, choosing its output and the window of the envelopes.
+
+    @see Rectifier
+*/
+class RectifierEditor : public GenericEditor
+                      , public ComboBox::Listener
+{
+public:
+    RectifierEditor (GenericProcessor* parentNode, bool useDefaultParameterEditors);
+    ~RectifierEditor();
+
+    void comboBoxChanged (ComboBox* comboBox) override;
+
+    void saveCustomParameters (XmlElement* xml) override;
+    void loadCustomParameters (XmlElement* xml) override;
+
+
+private:
+    ScopedPointer<Label>    modeLabel;
+    ScopedPointer<ComboBox> modeSelector;
+    ScopedPointer<Label>    windowLabel;
+    ScopedPointer<ComboBox> windowSelector;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RectifierEditor);
+};
+
+
+#endif  // RECTIFIEREDITOR_H_INCLUDED
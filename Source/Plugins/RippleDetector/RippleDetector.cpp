@@ -0,0 +1,585 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <stdio.h>
+#include <cmath>
+#include "RippleDetector.h"
+#include "RippleDetectorEditor.h"
+
+#if JUCE_INTEL && (defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2))
+ #define RIPPLE_SSE2 1
+ #include <emmintrin.h>
+#endif
+
+// samples of a group interleaved at once, small enough to stay in the stack and in cache
+#define RIPPLE_BLOCK_SAMPLES 256
+
+namespace
+{
+    /** Runs numSamples interleaved samples of RIPPLE_LANES lanes through a resonator in place,
+        in transposed direct form II, state holding z1 then z2 of each lane. */
+    void processStageScalar (double* x, int numSamples, double b0, double a1, double a2, double (*state)[RIPPLE_LANES])
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            double* in = x + i * RIPPLE_LANES;
+
+            for (int lane = 0; lane < RIPPLE_LANES; ++lane)
+            {
+                const double y = b0 * in[lane] + state[0][lane];
+                state[0][lane] = state[1][lane] - a1 * y;
+                state[1][lane] = -b0 * in[lane] - a2 * y;
+                in[lane] = y;
+            }
+        }
+    }
+
+    /** Replaces band-passed samples by the z-score of their envelope, updating the baselines of the lanes with their rate */
+    void processEnvelopeScalar (double* x, int numSamples, double* envelope, double* mean, double* variance,
+                                double alpha, const double* beta)
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            double* in = x + i * RIPPLE_LANES;
+
+            for (int lane = 0; lane < RIPPLE_LANES; ++lane)
+            {
+                envelope[lane] += alpha * (std::abs (in[lane]) - envelope[lane]);
+
+                const double d = envelope[lane] - mean[lane];
+                in[lane] = d / std::sqrt (variance[lane] + 1e-12);
+
+                mean[lane] += beta[lane] * d;
+                variance[lane] = (1.0 - beta[lane]) * (variance[lane] + beta[lane] * d * d);
+            }
+        }
+    }
+
+   #if RIPPLE_SSE2
+    void processStageSSE2 (double* x, int numSamples, double b0, double a1, double a2, double (*state)[RIPPLE_LANES])
+    {
+        const __m128d vb0 = _mm_set1_pd (b0);
+        const __m128d va1 = _mm_set1_pd (a1);
+        const __m128d va2 = _mm_set1_pd (a2);
+        __m128d z1[2] = { _mm_loadu_pd (state[0]), _mm_loadu_pd (state[0] + 2) };
+        __m128d z2[2] = { _mm_loadu_pd (state[1]), _mm_loadu_pd (state[1] + 2) };
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            double* in = x + i * RIPPLE_LANES;
+
+            for (int h = 0; h < 2; ++h)
+            {
+                const __m128d bx = _mm_mul_pd (vb0, _mm_loadu_pd (in + 2 * h));
+                const __m128d y  = _mm_add_pd (bx, z1[h]);
+
+                z1[h] = _mm_sub_pd (z2[h], _mm_mul_pd (va1, y));
+                z2[h] = _mm_sub_pd (_mm_setzero_pd(), _mm_add_pd (bx, _mm_mul_pd (va2, y)));
+                _mm_storeu_pd (in + 2 * h, y);
+            }
+        }
+
+        _mm_storeu_pd (state[0],     z1[0]);
+        _mm_storeu_pd (state[0] + 2, z1[1]);
+        _mm_storeu_pd (state[1],     z2[0]);
+        _mm_storeu_pd (state[1] + 2, z2[1]);
+    }
+
+    void processEnvelopeSSE2 (double* x, int numSamples, double* envelope, double* mean, double* variance,
+                              double alpha, const double* beta)
+    {
+        const __m128d absMask = _mm_castsi128_pd (_mm_set_epi32 (0x7fffffff, -1, 0x7fffffff, -1));
+        const __m128d valpha  = _mm_set1_pd (alpha);
+        const __m128d one     = _mm_set1_pd (1.0);
+        const __m128d tiny    = _mm_set1_pd (1e-12);
+
+        for (int h = 0; h < 2; ++h)
+        {
+            __m128d e = _mm_loadu_pd (envelope + 2 * h);
+            __m128d m = _mm_loadu_pd (mean + 2 * h);
+            __m128d v = _mm_loadu_pd (variance + 2 * h);
+            const __m128d b = _mm_loadu_pd (beta + 2 * h);
+            const __m128d keep = _mm_sub_pd (one, b);
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                double* in = x + i * RIPPLE_LANES + 2 * h;
+
+                e = _mm_add_pd (e, _mm_mul_pd (valpha, _mm_sub_pd (_mm_and_pd (_mm_loadu_pd (in), absMask), e)));
+
+                const __m128d d = _mm_sub_pd (e, m);
+                _mm_storeu_pd (in, _mm_div_pd (d, _mm_sqrt_pd (_mm_add_pd (v, tiny))));
+
+                m = _mm_add_pd (m, _mm_mul_pd (b, d));
+                v = _mm_mul_pd (keep, _mm_add_pd (v, _mm_mul_pd (b, _mm_mul_pd (d, d))));
+            }
+
+            _mm_storeu_pd (envelope + 2 * h, e);
+            _mm_storeu_pd (mean + 2 * h, m);
+            _mm_storeu_pd (variance + 2 * h, v);
+        }
+    }
+   #endif
+
+    void processStage (double* x, int numSamples, double b0, double a1, double a2, double (*state)[RIPPLE_LANES])
+    {
+       #if RIPPLE_SSE2
+        processStageSSE2 (x, numSamples, b0, a1, a2, state);
+       #else
+        processStageScalar (x, numSamples, b0, a1, a2, state);
+       #endif
+    }
+
+    void processEnvelope (double* x, int numSamples, double* envelope, double* mean, double* variance,
+                          double alpha, const double* beta)
+    {
+       #if RIPPLE_SSE2
+        processEnvelopeSSE2 (x, numSamples, envelope, mean, variance, alpha, beta);
+       #else
+        processEnvelopeScalar (x, numSamples, envelope, mean, variance, alpha, beta);
+       #endif
+    }
+}
+
+
+RippleDetector::RippleDetector()
+    : GenericProcessor  ("Ripple Detector")
+    , lowCut            (RIPPLE_DEFAULT_LOW_HZ)
+    , highCut           (RIPPLE_DEFAULT_HIGH_HZ)
+    , threshold         (RIPPLE_DEFAULT_THRESHOLD)
+    , minDurationMs     (RIPPLE_DEFAULT_MIN_MS)
+    , baselineSeconds   (RIPPLE_DEFAULT_BASELINE_S)
+{
+    setProcessorType (PROCESSOR_TYPE_FILTER);
+}
+
+
+RippleDetector::~RippleDetector()
+{
+}
+
+
+AudioProcessorEditor* RippleDetector::createEditor()
+{
+    editor = new RippleDetectorEditor (this, true);
+    return editor;
+}
+
+
+float RippleDetector::getLowCut() const
+{
+    return lowCut;
+}
+
+
+float RippleDetector::getHighCut() const
+{
+    return highCut;
+}
+
+
+float RippleDetector::getThreshold() const
+{
+    return threshold;
+}
+
+
+float RippleDetector::getMinDurationMs() const
+{
+    return minDurationMs;
+}
+
+
+float RippleDetector::getBaselineSeconds() const
+{
+    return baselineSeconds;
+}
+
+
+const ProcessorTimingStats& RippleDetector::getDetectionLatencyStats() const
+{
+    return detectionLatency;
+}
+
+
+void RippleDetector::setParameter (int parameterIndex, float newValue)
+{
+    if (parameterIndex == 0)
+        lowCut = jlimit (1.0f, 10000.0f, newValue);
+    else if (parameterIndex == 1)
+        highCut = jlimit (1.0f, 10000.0f, newValue);
+    else if (parameterIndex == 2)
+        threshold = jlimit (0.5f, 50.0f, newValue);
+    else if (parameterIndex == 3)
+        minDurationMs = jlimit (0.0f, 1000.0f, newValue);
+    else if (parameterIndex == 4)
+        baselineSeconds = jlimit (0.1f, 600.0f, newValue);
+    else
+        return;
+
+    // only the coefficients change, so this is safe on the processing thread
+    updateDesign();
+}
+
+
+void RippleDetector::updateDesign()
+{
+    for (int s = 0; s < sources.size(); ++s)
+    {
+        DetectorSource& source = *sources[s];
+        const double fs = source.sampleRate;
+
+        // a resonator at the geometric centre of the band, kept below Nyquist
+        const double low  = jmin (double (lowCut), double (highCut));
+        const double high = jmax (double (lowCut), double (highCut), low + 1.0);
+        const double centre = jmin (std::sqrt (low * high), 0.45 * fs);
+        const double w0 = 2.0 * double_Pi * centre / fs;
+        const double alpha = std::sin (w0) * (high - low) / (2.0 * centre);
+
+        source.b0 = alpha / (1.0 + alpha);
+        source.a1 = -2.0 * std::cos (w0) / (1.0 + alpha);
+        source.a2 = (1.0 - alpha) / (1.0 + alpha);
+
+        // the envelope follows within a period of the lowest frequency
+        source.envelopeAlpha = 1.0 - std::exp (-low / fs);
+        source.baselineBeta = 1.0 - std::exp (-1.0 / (baselineSeconds * fs));
+        source.minSamples = jmax (1, roundDoubleToInt (minDurationMs * fs / 1000.0));
+        source.warmupSamples = int64 (2.0 * baselineSeconds * fs);
+    }
+}
+
+
+void RippleDetector::updateSettings()
+{
+    sources.clear();
+    groups.clear();
+
+    Array<int> numLines;
+
+    for (int i = 0; i < dataChannelArray.size(); ++i)
+    {
+        const DataChannel* input = dataChannelArray[i];
+        const uint32 sourceId = getProcessorFullId (input->getSourceNodeID(), input->getSubProcessorIdx());
+
+        int s = 0;
+        while (s < sources.size() && sources[s]->sourceId != sourceId)
+            ++s;
+
+        if (s == sources.size())
+        {
+            DetectorSource* source = sources.add (new DetectorSource());
+            source->sourceId = sourceId;
+            source->sampleRate = input->getSampleRate();
+            source->eventChannel = nullptr;
+            source->numActive = 0;
+            numLines.add (1);
+        }
+
+        numLines.set (s, numLines[s] + 1);
+    }
+
+    for (int s = 0; s < sources.size(); ++s)
+    {
+        DetectorSource& source = *sources[s];
+
+        EventChannel* ev = new EventChannel (EventChannel::TTL, numLines[s], 1, source.sampleRate, this);
+        ev->setName ("Ripple detector output " + String (s + 1));
+        ev->setDescription ("Line 0 is on during an event on any channel, the others during those of each input channel");
+        ev->setIdentifier ("dataderived.oscillation.ripple");
+        eventChannelArray.add (ev);
+
+        source.eventChannel = ev;
+        source.ttlWord.calloc (ev->getDataSize());
+        source.pendingEvents.ensureStorageAllocated (64);
+    }
+
+    updateDesign();
+}
+
+
+bool RippleDetector::enable()
+{
+    groups.clear();
+    detectionLatency.reset();
+
+    Array<int> lineCounts;
+    lineCounts.insertMultiple (0, 1, sources.size());
+
+    Array<int> lines;
+
+    // the line of every input channel, in the order of the event channel
+    for (int i = 0; i < dataChannelArray.size(); ++i)
+    {
+        const DataChannel* input = dataChannelArray[i];
+        const uint32 sourceId = getProcessorFullId (input->getSourceNodeID(), input->getSubProcessorIdx());
+
+        for (int s = 0; s < sources.size(); ++s)
+        {
+            if (sources[s]->sourceId == sourceId)
+            {
+                lines.add (lineCounts[s]);
+                lineCounts.set (s, lineCounts[s] + 1);
+                break;
+            }
+        }
+    }
+
+    const Array<int> selected = getEditor()->getActiveChannels();
+
+    for (int n = 0; n < selected.size(); ++n)
+    {
+        const int ch = selected[n];
+        const DataChannel* input = getDataChannel (ch);
+
+        if (input == nullptr || ! isPositiveAndBelow (ch, lines.size()))
+            continue;
+
+        const uint32 sourceId = getProcessorFullId (input->getSourceNodeID(), input->getSubProcessorIdx());
+
+        int s = 0;
+        while (s < sources.size() && sources[s]->sourceId != sourceId)
+            ++s;
+
+        // a group's channels share a source, so that they have as many samples, and a filter
+        Group* group = groups.size() > 0 ? groups.getLast() : nullptr;
+
+        if (group == nullptr || group->numLanes == RIPPLE_LANES || group->source != s)
+        {
+            group = groups.add (new Group());
+            zerostruct (group->state);
+            group->source = s;
+            group->numLanes = 0;
+            group->samplesSeen = 0;
+            group->pendingEvents.ensureStorageAllocated (16);
+
+            for (int lane = 0; lane < RIPPLE_LANES; ++lane)
+            {
+                group->envelope[lane] = 0;
+                group->mean[lane] = 0;
+                group->variance[lane] = 0;
+                group->samplesAbove[lane] = 0;
+                group->inEvent[lane] = false;
+            }
+        }
+
+        group->channels[group->numLanes] = ch;
+        group->lines[group->numLanes] = lines[ch];
+        ++group->numLanes;
+    }
+
+    for (int s = 0; s < sources.size(); ++s)
+    {
+        DetectorSource& source = *sources[s];
+
+        zeromem (source.ttlWord, source.eventChannel->getDataSize());
+        source.numActive = 0;
+        source.pendingEvents.clearQuick();
+    }
+
+    return true;
+}
+
+
+bool RippleDetector::disable()
+{
+    const ProcessorTimingStats::Snapshot latency = detectionLatency.getSnapshot();
+
+    if (latency.numBlocks > 0)
+    {
+        const String summary = "Ripple Detector latency over " + String (latency.numBlocks) + " events: "
+                               + latency.getSummary() + "  max " + String (latency.maxMs, 2) + " ms";
+        std::cout << summary << std::endl;
+        CoreServices::sendStatusMessage (summary);
+    }
+
+    return true;
+}
+
+
+int RippleDetector::PendingEventSorter::compareElements (const PendingEvent& first, const PendingEvent& second)
+{
+    if (first.sampleNum != second.sampleNum)
+        return first.sampleNum - second.sampleNum;
+
+    return first.line - second.line;
+}
+
+
+void RippleDetector::process (AudioSampleBuffer& buffer)
+{
+    if (groups.size() == 0)
+        return;
+
+    const int64 startTicks = Time::getHighResolutionTicks();
+
+    // the groups are run in parallel, then their events are added here in sample order,
+    // as they would be from a single thread
+    processChannelsInParallel (buffer, groups.size());
+
+    for (int g = 0; g < groups.size(); ++g)
+    {
+        Group& group = *groups.getUnchecked (g);
+
+        sources.getUnchecked (group.source)->pendingEvents.addArray (group.pendingEvents);
+        group.pendingEvents.clearQuick();
+    }
+
+    const double ticksPerSecond = double (Time::getHighResolutionTicksPerSecond());
+    PendingEventSorter sorter;
+
+    for (int s = 0; s < sources.size(); ++s)
+    {
+        DetectorSource& source = *sources.getUnchecked (s);
+
+        if (source.pendingEvents.size() == 0)
+            continue;
+
+        source.pendingEvents.sort (sorter, true);
+
+        const int64 timestamp = int64 (getSourceTimestamp (source.sourceId));
+        const int numSamples = getNumSourceSamples (source.sourceId);
+
+        for (int n = 0; n < source.pendingEvents.size(); ++n)
+        {
+            const PendingEvent& pending = source.pendingEvents.getReference (n);
+            const uint8 bit = uint8 (1 << (pending.line & 7));
+
+            if (pending.state)
+                source.ttlWord[pending.line >> 3] |= bit;
+            else
+                source.ttlWord[pending.line >> 3] &= ~bit;
+
+            addTTLEvent (source.eventChannel, timestamp + pending.sampleNum, source.ttlWord, uint16 (pending.line), pending.sampleNum);
+
+            // line 0 follows the first channel in an event and the last one out of it
+            const bool anyWasActive = source.numActive > 0;
+            source.numActive += pending.state ? 1 : -1;
+
+            if ((source.numActive > 0) == anyWasActive)
+                continue;
+
+            if (source.numActive > 0)
+                source.ttlWord[0] |= 1;
+            else
+                source.ttlWord[0] &= ~1;
+
+            addTTLEvent (source.eventChannel, timestamp + pending.sampleNum, source.ttlWord, 0, pending.sampleNum);
+
+            // the samples after the detection had to arrive before the event could be added
+            if (source.numActive > 0)
+            {
+                const double waitedSeconds = double (numSamples - 1 - pending.sampleNum) / source.sampleRate;
+                detectionLatency.addBlock (Time::getHighResolutionTicks() - startTicks
+                                           + int64 (waitedSeconds * ticksPerSecond), 0);
+            }
+        }
+
+        source.pendingEvents.clearQuick();
+    }
+}
+
+
+void RippleDetector::processChannels (AudioSampleBuffer& buffer, int firstChannel, int lastChannel)
+{
+    for (int g = firstChannel; g < lastChannel; ++g)
+    {
+        Group& group = *groups.getUnchecked (g);
+        processGroup (group, buffer, getNumSamples (group.channels[0]));
+    }
+}
+
+
+void RippleDetector::processGroup (Group& group, AudioSampleBuffer& buffer, int numSamples)
+{
+    const DetectorSource& source = *sources.getUnchecked (group.source);
+
+    const float* data[RIPPLE_LANES];
+    for (int lane = 0; lane < group.numLanes; ++lane)
+        data[lane] = buffer.getReadPointer (group.channels[lane]);
+
+    const double exitThreshold = 0.5 * threshold;
+    double x[RIPPLE_BLOCK_SAMPLES * RIPPLE_LANES];
+    double beta[RIPPLE_LANES];
+
+    for (int start = 0; start < numSamples; start += RIPPLE_BLOCK_SAMPLES)
+    {
+        const int n = jmin (RIPPLE_BLOCK_SAMPLES, numSamples - start);
+
+        // lanes left over run on silence
+        for (int lane = 0; lane < RIPPLE_LANES; ++lane)
+        {
+            const float* in = (lane < group.numLanes) ? data[lane] + start : nullptr;
+            for (int i = 0; i < n; ++i)
+                x[i * RIPPLE_LANES + lane] = (in != nullptr) ? in[i] : 0.0;
+
+            // the baseline of a channel in an event stays as it was before it
+            beta[lane] = group.inEvent[lane] ? 0.0 : source.baselineBeta;
+        }
+
+        for (int k = 0; k < RIPPLE_STAGES; ++k)
+            processStage (x, n, source.b0, source.a1, source.a2, group.state[k]);
+
+        processEnvelope (x, n, group.envelope, group.mean, group.variance, source.envelopeAlpha, beta);
+
+        const bool isSettled = group.samplesSeen >= source.warmupSamples;
+        group.samplesSeen += n;
+
+        if (! isSettled)
+            continue;
+
+        for (int lane = 0; lane < group.numLanes; ++lane)
+        {
+            int& samplesAbove = group.samplesAbove[lane];
+            bool& inEvent = group.inEvent[lane];
+
+            for (int i = 0; i < n; ++i)
+            {
+                const double z = x[i * RIPPLE_LANES + lane];
+
+                if (z > threshold)
+                {
+                    if (samplesAbove < source.minSamples && ++samplesAbove == source.minSamples && ! inEvent)
+                    {
+                        inEvent = true;
+
+                        PendingEvent event = { start + i, group.lines[lane], true };
+                        group.pendingEvents.add (event);
+                    }
+                }
+                else
+                {
+                    samplesAbove = 0;
+
+                    if (inEvent && z < exitThreshold)
+                    {
+                        inEvent = false;
+
+                        PendingEvent event = { start + i, group.lines[lane], false };
+                        group.pendingEvents.add (event);
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,189 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef RIPPLEDETECTOR_H_INCLUDED
+#define RIPPLEDETECTOR_H_INCLUDED
+
+
+#ifdef _WIN32
+    #include <Windows.h>
+#endif
+
+#include <ProcessorHeaders.h>
+
+
+/** Channels detected together, one per SIMD lane */
+#define RIPPLE_LANES 4
+#define RIPPLE_STAGES 2
+
+#define RIPPLE_DEFAULT_LOW_HZ 150
+#define RIPPLE_DEFAULT_HIGH_HZ 250
+#define RIPPLE_DEFAULT_THRESHOLD 3
+#define RIPPLE_DEFAULT_MIN_MS 10
+#define RIPPLE_DEFAULT_BASELINE_S 5
+
+
+/**
+    Detects oscillatory events, such as sharp-wave ripples, on the selected channels, and
+    sends out TTL events as soon as they are found, for closed-loop experiments.
+
+    Every stage is causal. Each channel is band-passed by two resonators (biquads of unit gain
+    at the centre of the band), then its envelope is the absolute value smoothed by a one-pole
+    low-pass. The envelope is z-scored against an exponential moving mean and variance of
+    itself, frozen while the channel is in an event, over a baseline of a few seconds. An event
+    starts once the z-score has stayed above the threshold for the minimum duration, and ends
+    once it falls below half the threshold. No event is detected while the baseline settles,
+    for the first two baseline time constants.
+
+    The state of the channels is laid out lane by lane, RIPPLE_LANES channels of a source per
+    group, so that the filters and the envelope run over a block of interleaved samples with
+    SSE2, while the groups are spread over the channel thread pool. Only the thresholding is
+    done by lane.
+
+    Each source gets a TTL event channel: line 0 is on while any of its channels is in an
+    event, and line 1 + i follows its i-th input channel. The events are added at the sample
+    they are detected at, so that with sub-blocks, the delay until they leave the processor
+    is at most a sub-block. That delay, from the sample detected at to the events being added,
+    is measured and reported when acquisition stops.
+*/
+class RippleDetector : public GenericProcessor
+{
+public:
+    /** The class constructor, used to initialize any members. */
+    RippleDetector();
+
+    /** The class destructor, used to deallocate memory */
+    ~RippleDetector();
+
+    /** Runs the groups of channels, then adds the events they found in sample order */
+    void process (AudioSampleBuffer& buffer) override;
+
+    bool isDataPassThrough() const override { return true; }
+    bool isPassThroughChannel (int) const override { return true; }
+
+    /** Groups only touch their own state, and their events are added once all are done.*/
+    bool isChannelParallelSafe() const override { return true; }
+
+    /** The range is one of groups of RIPPLE_LANES channels */
+    void processChannels (AudioSampleBuffer& buffer, int firstChannel, int lastChannel) override;
+
+    AudioProcessorEditor* createEditor() override;
+
+    bool hasEditor() const override { return true; }
+
+    /** Adds a TTL event channel per source */
+    void updateSettings() override;
+
+    /** Groups the channels selected in the editor, with a cleared state */
+    bool enable() override;
+
+    /** Reports the measured latency */
+    bool disable() override;
+
+    /** Sets the low (0) and high (1) edges of the band in Hz, the threshold in standard
+        deviations (2), the minimum duration in ms (3) and the baseline time constant in
+        seconds (4). Can be changed during acquisition through queueParameterChange(). */
+    void setParameter (int parameterIndex, float newValue) override;
+
+    float getLowCut() const;
+    float getHighCut() const;
+    float getThreshold() const;
+    float getMinDurationMs() const;
+    float getBaselineSeconds() const;
+
+    /** How long after the sample they were detected at the events were added, since
+        acquisition last started */
+    const ProcessorTimingStats& getDetectionLatencyStats() const;
+
+
+private:
+    /** A change of line found by processChannels(), added by process() once all groups are done */
+    struct PendingEvent
+    {
+        int sampleNum;
+        int line;
+        bool state;
+    };
+
+    struct PendingEventSorter
+    {
+        static int compareElements (const PendingEvent& first, const PendingEvent& second);
+    };
+
+    /** The event channel of the channels sharing a source, and their filters */
+    struct DetectorSource
+    {
+        uint32 sourceId;
+        float sampleRate;
+        const EventChannel* eventChannel;
+        HeapBlock<uint8> ttlWord;
+        int numActive;              // channels in an event
+        Array<PendingEvent> pendingEvents;
+
+        double b0;                  // resonator, b1 being 0 and b2 -b0
+        double a1;
+        double a2;
+        double envelopeAlpha;
+        double baselineBeta;
+        int minSamples;
+        int64 warmupSamples;
+    };
+
+    struct Group
+    {
+        int source;
+        int numLanes;
+        int channels[RIPPLE_LANES];
+        int lines[RIPPLE_LANES];
+        double state[RIPPLE_STAGES][2][RIPPLE_LANES];
+        double envelope[RIPPLE_LANES];
+        double mean[RIPPLE_LANES];
+        double variance[RIPPLE_LANES];
+        int samplesAbove[RIPPLE_LANES];
+        bool inEvent[RIPPLE_LANES];
+        int64 samplesSeen;
+        Array<PendingEvent> pendingEvents;
+    };
+
+    /** Computes the filters of every source from the current parameters */
+    void updateDesign();
+
+    void processGroup (Group& group, AudioSampleBuffer& buffer, int numSamples);
+
+    float lowCut;
+    float highCut;
+    float threshold;
+    float minDurationMs;
+    float baselineSeconds;
+
+    OwnedArray<DetectorSource> sources;
+    OwnedArray<Group> groups;
+
+    ProcessorTimingStats detectionLatency;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RippleDetector);
+};
+
+
+
+#endif  // RIPPLEDETECTOR_H_INCLUDED
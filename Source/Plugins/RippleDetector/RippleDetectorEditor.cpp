@@ -0,0 +1,211 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "RippleDetectorEditor.h"
+#include "RippleDetector.h"
+
+
+RippleDetectorEditor::RippleDetectorEditor (GenericProcessor* parentNode, bool useDefaultParameterEditors)
+    : GenericEditor (parentNode, useDefaultParameterEditors)
+{
+    desiredWidth = 230;
+
+    lowCutValue      = addValue ("Low (Hz):", 10, 25, RIPPLE_DEFAULT_LOW_HZ, "Low edge of the band the events are detected in");
+    highCutValue     = addValue ("High (Hz):", 10, 65, RIPPLE_DEFAULT_HIGH_HZ, "High edge of the band the events are detected in");
+    thresholdValue   = addValue ("Threshold (SD):", 80, 25, RIPPLE_DEFAULT_THRESHOLD, "Standard deviations of the envelope above its mean an event starts at");
+    minDurationValue = addValue ("Min (ms):", 80, 65, RIPPLE_DEFAULT_MIN_MS, "How long the envelope must stay above the threshold before the event is sent out");
+
+    // item ids are the baselines plus one, and the sub-block sizes, 1 being whole blocks
+    baselineSelector = addSelector ("Baseline (s):", 155, 25, "Time constant of the mean and standard deviation of the envelope");
+    const int baselines[] = { 1, 2, 5, 10, 30, 60 };
+    for (int i = 0; i < numElementsInArray (baselines); ++i)
+        baselineSelector->addItem (String (baselines[i]), baselines[i] + 1);
+    baselineSelector->setSelectedId (RIPPLE_DEFAULT_BASELINE_S + 1, dontSendNotification);
+
+    subBlockSelector = addSelector ("Sub-block:", 155, 65, "Process the input in sub-blocks of this many samples, bounding the latency of the events");
+    subBlockSelector->addItem ("Block", 1);
+    for (int size = 16; size <= 128; size *= 2)
+        subBlockSelector->addItem (String (size), size);
+    subBlockSelector->setSelectedId (1, dontSendNotification);
+}
+
+
+RippleDetectorEditor::~RippleDetectorEditor()
+{
+}
+
+
+Label* RippleDetectorEditor::addValue (const String& name, int x, int y, float value, const String& tooltip)
+{
+    Label* caption = captions.add (new Label (name, name));
+    caption->setBounds (x, y, 80, 15);
+    caption->setFont (Font ("Small Text", 12, Font::plain));
+    caption->setColour (Label::textColourId, Colours::darkgrey);
+    addAndMakeVisible (caption);
+
+    Label* label = new Label (name, String (value));
+    label->setBounds (x + 5, y + 17, 55, 18);
+    label->setFont (Font ("Default", 15, Font::plain));
+    label->setColour (Label::textColourId, Colours::white);
+    label->setColour (Label::backgroundColourId, Colours::grey);
+    label->setEditable (true);
+    label->setTooltip (tooltip);
+    label->addListener (this);
+    addAndMakeVisible (label);
+
+    return label;
+}
+
+
+ComboBox* RippleDetectorEditor::addSelector (const String& name, int x, int y, const String& tooltip)
+{
+    Label* caption = captions.add (new Label (name, name));
+    caption->setBounds (x, y, 70, 15);
+    caption->setFont (Font ("Small Text", 12, Font::plain));
+    caption->setColour (Label::textColourId, Colours::darkgrey);
+    addAndMakeVisible (caption);
+
+    ComboBox* selector = new ComboBox (name);
+    selector->setBounds (x + 5, y + 17, 65, 18);
+    selector->setTooltip (tooltip);
+    selector->addListener (this);
+    addAndMakeVisible (selector);
+
+    return selector;
+}
+
+
+int RippleDetectorEditor::getParameterIndex (Label* label) const
+{
+    if (label == lowCutValue)       return 0;
+    if (label == highCutValue)      return 1;
+    if (label == thresholdValue)    return 2;
+    if (label == minDurationValue)  return 3;
+
+    return -1;
+}
+
+
+void RippleDetectorEditor::updateValues()
+{
+    RippleDetector* processor = static_cast<RippleDetector*> (getProcessor());
+
+    lowCutValue->setText (String (processor->getLowCut()), dontSendNotification);
+    highCutValue->setText (String (processor->getHighCut()), dontSendNotification);
+    thresholdValue->setText (String (processor->getThreshold()), dontSendNotification);
+    minDurationValue->setText (String (processor->getMinDurationMs()), dontSendNotification);
+}
+
+
+void RippleDetectorEditor::labelTextChanged (Label* label)
+{
+    const int index = getParameterIndex (label);
+
+    if (index < 0)
+        return;
+
+    const float value = label->getText().getFloatValue();
+
+    // values are only checked here; during acquisition they are applied at the next block
+    if (value < 0 || (value == 0 && index != 3))
+        CoreServices::sendStatusMessage ("Value out of range.");
+    else
+        getProcessor()->queueParameterChange (index, value);
+
+    // a change queued during acquisition isn't applied yet, so the label keeps what was typed
+    if (! CoreServices::getAcquisitionStatus())
+        updateValues();
+}
+
+
+void RippleDetectorEditor::comboBoxChanged (ComboBox* comboBox)
+{
+    if (comboBox == baselineSelector)
+    {
+        getProcessor()->queueParameterChange (4, float (baselineSelector->getSelectedId() - 1));
+    }
+    else if (comboBox == subBlockSelector)
+    {
+        const int id = subBlockSelector->getSelectedId();
+        getProcessor()->setSubBlockSize (id > 1 ? id : 0);
+    }
+}
+
+
+void RippleDetectorEditor::startAcquisition()
+{
+    subBlockSelector->setEnabled (false);
+}
+
+
+void RippleDetectorEditor::stopAcquisition()
+{
+    subBlockSelector->setEnabled (true);
+    updateValues();
+}
+
+
+void RippleDetectorEditor::saveCustomParameters (XmlElement* xml)
+{
+    xml->setAttribute ("Type", "RippleDetectorEditor");
+
+    RippleDetector* processor = static_cast<RippleDetector*> (getProcessor());
+
+    XmlElement* values = xml->createNewChildElement ("VALUES");
+    values->setAttribute ("LowCut", processor->getLowCut());
+    values->setAttribute ("HighCut", processor->getHighCut());
+    values->setAttribute ("Threshold", processor->getThreshold());
+    values->setAttribute ("MinDuration", processor->getMinDurationMs());
+    values->setAttribute ("Baseline", baselineSelector->getSelectedId() - 1);
+    values->setAttribute ("SubBlock", processor->getSubBlockSize());
+}
+
+
+void RippleDetectorEditor::loadCustomParameters (XmlElement* xml)
+{
+    GenericProcessor* processor = getProcessor();
+
+    forEachXmlChildElement (*xml, xmlNode)
+    {
+        if (xmlNode->hasTagName ("VALUES"))
+        {
+            processor->setParameter (0, float (xmlNode->getDoubleAttribute ("LowCut", RIPPLE_DEFAULT_LOW_HZ)));
+            processor->setParameter (1, float (xmlNode->getDoubleAttribute ("HighCut", RIPPLE_DEFAULT_HIGH_HZ)));
+            processor->setParameter (2, float (xmlNode->getDoubleAttribute ("Threshold", RIPPLE_DEFAULT_THRESHOLD)));
+            processor->setParameter (3, float (xmlNode->getDoubleAttribute ("MinDuration", RIPPLE_DEFAULT_MIN_MS)));
+
+            const int baseline = xmlNode->getIntAttribute ("Baseline", RIPPLE_DEFAULT_BASELINE_S) + 1;
+            baselineSelector->setSelectedId (baselineSelector->indexOfItemId (baseline) >= 0 ? baseline : RIPPLE_DEFAULT_BASELINE_S + 1,
+                                             dontSendNotification);
+            processor->setParameter (4, float (baselineSelector->getSelectedId() - 1));
+
+            const int subBlock = xmlNode->getIntAttribute ("SubBlock", 0);
+            subBlockSelector->setSelectedId (subBlockSelector->indexOfItemId (subBlock) >= 0 ? subBlock : 1,
+                                             dontSendNotification);
+            processor->setSubBlockSize (subBlock > 1 ? subBlockSelector->getSelectedId() : 0);
+
+            updateValues();
+        }
+    }
+}
@@ -0,0 +1,79 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef RIPPLEDETECTOREDITOR_H_INCLUDED
+#define RIPPLEDETECTOREDITOR_H_INCLUDED
+
+
+#include <EditorHeaders.h>
+
+
+/**
+    User interface for the Ripple Detector, setting the band, the threshold, the minimum
+    duration, the baseline and the sub-block size. The channels it detects on are those
+    selected in the channel selector when acquisition starts.
+
+    @see RippleDetector
+*/
+class RippleDetectorEditor : public GenericEditor
+                           , public ComboBox::Listener
+                           , public Label::Listener
+{
+public:
+    RippleDetectorEditor (GenericProcessor* parentNode, bool useDefaultParameterEditors);
+    ~RippleDetectorEditor();
+
+    void comboBoxChanged (ComboBox* comboBox) override;
+    void labelTextChanged (Label* label) override;
+
+    void startAcquisition() override;
+    void stopAcquisition() override;
+
+    void saveCustomParameters (XmlElement* xml) override;
+    void loadCustomParameters (XmlElement* xml) override;
+
+
+private:
+    /** Adds a caption at the given position, the editable value being added below it */
+    Label* addValue (const String& name, int x, int y, float value, const String& tooltip);
+    ComboBox* addSelector (const String& name, int x, int y, const String& tooltip);
+
+    /** The parameter index of an editable value, or -1 */
+    int getParameterIndex (Label* label) const;
+
+    /** Shows the parameters of the processor */
+    void updateValues();
+
+    OwnedArray<Label>       captions;
+    ScopedPointer<Label>    lowCutValue;
+    ScopedPointer<Label>    highCutValue;
+    ScopedPointer<Label>    thresholdValue;
+    ScopedPointer<Label>    minDurationValue;
+    ScopedPointer<ComboBox> baselineSelector;
+    ScopedPointer<ComboBox> subBlockSelector;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RippleDetectorEditor);
+};
+
+
+#endif  // RIPPLEDETECTOREDITOR_H_INCLUDED
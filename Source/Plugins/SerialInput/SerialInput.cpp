@@ -45,6 +45,8 @@ const int SerialInput::BAUDRATES[12] =
 
 SerialInput::SerialInput()
     : GenericProcessor  ("Serial Port")
+    , serialWorker      ("Serial Port")
+    , failureReported   (false)
     , baudrate          (0)
 	, lastRecv			(0)
 {
@@ -55,6 +57,7 @@ SerialInput::SerialInput()
 
 SerialInput::~SerialInput()
 {
+    serialWorker.stop();
     serial.close();
 }
 
@@ -116,56 +119,84 @@ bool SerialInput::isReady()
         AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, "SerialInput connection error!", "Could not connect to specified serial device. Check log files for details.");
         return false;
     }
+
+    failureReported = false;
+    serialWorker.start (&serial, true);
+
     return true;
 }
 
 
 bool SerialInput::disable()
 {
+    serialWorker.stop();
     serial.close();
+
+    if (serialWorker.getNumDroppedBytes() > 0)
+        std::cout << "SerialInput dropped " << serialWorker.getNumDroppedBytes() << " bytes." << std::endl;
+
     return true;
 }
 
 
+void SerialInput::handleAsyncUpdate()
+{
+    AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, "SerialInput device access error!", "Could not access serial device.");
+}
+
+
+int64 SerialInput::getTimestampForTicks (int64 ticks, int64 blockTimestamp, int64 blockTicks) const
+{
+    const double secondsAgo = Time::highResolutionTicksToSeconds (blockTicks - ticks);
+    return blockTimestamp - (int64) (secondsAgo * CoreServices::getGlobalSampleRate());
+}
+
+
 void SerialInput::process (AudioSampleBuffer&)
 {
 	int64 timestamp = CoreServices::getGlobalTimestamp();
+	const int64 blockTicks = Time::getHighResolutionTicks();
 	setTimestampAndSamples(timestamp, 0);
 
-    int bytesAvailable = serial.available();
-
-    if (bytesAvailable == OF_SERIAL_ERROR)
+    if (serialWorker.hasFailed() && ! failureReported)
     {
-        // ToDo: Properly warn about problem here!
-        AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, "SerialInput device access error!", "Could not access serial device.");
-        return;
+        failureReported = true;
+        triggerAsyncUpdate();
     }
 
-    if (bytesAvailable > 0)
+    // the chunks received since the last block, up to what one event can hold
+    int bytesRead = 0;
+    int64 firstTicks = 0;
+
+    while (bytesRead <= MAX_MSG_SIZE - SERIAL_WORKER_MAX_CHUNK)
     {
+        int64 ticks;
+        const int n = serialWorker.read (dataBuffer + bytesRead, SERIAL_WORKER_MAX_CHUNK, ticks);
+
+        if (n == 0)
+            break;
 
-        int bytesRead = serial.readBytes (dataBuffer, bytesAvailable);
-
-        if (bytesRead > 0)
-        {
-			//Clear the rest of the buffer so we don't send garbage.
-			if (bytesRead < lastRecv)
-				zeromem(dataBuffer.getData() + bytesRead, lastRecv - bytesRead);
-			lastRecv = bytesRead;
-			MetaDataValueArray metadata;
-			MetaDataValuePtr bufferRead = new MetaDataValue(MetaDataDescriptor::UINT64, 1);
-			bufferRead->setValue(static_cast<uint64>(bytesRead));
-			metadata.add(bufferRead);
-			const EventChannel* chan = getEventChannel(getEventChannelIndex(0, getNodeId()));
-			BinaryEventPtr event = BinaryEvent::createBinaryEvent(chan, timestamp, static_cast<uint8*>(dataBuffer.getData()), MAX_MSG_SIZE, metadata);
-			addEvent(chan, event, 0);
-        }
-        else if (bytesRead < 0)
-        {
-            // ToDo: Properly warn about problem here!
-            AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, "SerialInput device read error!", "Could not read serial input, even though data should be available.");
-            return;
-        }
+        if (bytesRead == 0)
+            firstTicks = ticks;
+
+        bytesRead += n;
+    }
+
+    if (bytesRead > 0)
+    {
+        timestamp = getTimestampForTicks (firstTicks, timestamp, blockTicks);
+
+        //Clear the rest of the buffer so we don't send garbage.
+        if (bytesRead < lastRecv)
+            zeromem(dataBuffer.getData() + bytesRead, lastRecv - bytesRead);
+        lastRecv = bytesRead;
+        MetaDataValueArray metadata;
+        MetaDataValuePtr bufferRead = new MetaDataValue(MetaDataDescriptor::UINT64, 1);
+        bufferRead->setValue(static_cast<uint64>(bytesRead));
+        metadata.add(bufferRead);
+        const EventChannel* chan = getEventChannel(getEventChannelIndex(0, getNodeId()));
+        BinaryEventPtr event = BinaryEvent::createBinaryEvent(chan, timestamp, static_cast<uint8*>(dataBuffer.getData()), MAX_MSG_SIZE, metadata);
+        addEvent(chan, event, 0);
     }
 }
 
@@ -37,9 +37,12 @@
 /**
     This source processor allows you to pipe binary serial data input straight to the event cue/buffer.
 
-    @see SerialInputEditor
+    The port is read by a SerialWorker during acquisition, and each block gets one event with
+    the bytes received since the previous one, timestamped when the first of them was read.
+
+    @see SerialInputEditor, SerialWorker
 */
-class SerialInput : public GenericProcessor
+class SerialInput : public GenericProcessor, private AsyncUpdater
 {
 public:
     /** The class constructor, used to initialize any members. */
@@ -94,9 +97,19 @@ protected:
 
 
 private:
+    /** Warns about a failure of the port, from the message thread */
+    void handleAsyncUpdate() override;
+
+    /** The timestamp of bytes read at the given high resolution ticks */
+    int64 getTimestampForTicks (int64 ticks, int64 blockTimestamp, int64 blockTicks) const;
+
     // The current serial connection
     ofSerial serial;
 
+    // Does the reads of the port during acquisition
+    SerialWorker serialWorker;
+    bool failureReported;
+
     // The serial device to be used
     string device;
 
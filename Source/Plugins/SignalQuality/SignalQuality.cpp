@@ -0,0 +1,363 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <cmath>
+#include <algorithm>
+#include <vector>
+#include "SignalQuality.h"
+#include "SignalQualityEditor.h"
+
+#if JUCE_INTEL && (defined (__SSE__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 1))
+ #define SIGNALQUALITY_SSE 1
+ #include <xmmintrin.h>
+#endif
+
+
+SignalQuality::SignalQuality()
+    : GenericProcessor  ("Signal Quality")
+    , stride            (SIGNALQUALITY_DEFAULT_STRIDE)
+    , lineFrequency     (SIGNALQUALITY_DEFAULT_LINE_HZ)
+{
+    setProcessorType (PROCESSOR_TYPE_FILTER);
+}
+
+
+SignalQuality::~SignalQuality()
+{
+}
+
+
+AudioProcessorEditor* SignalQuality::createEditor()
+{
+    editor = new SignalQualityEditor (this, true);
+    return editor;
+}
+
+
+int SignalQuality::getStride() const
+{
+    return stride;
+}
+
+
+float SignalQuality::getLineFrequency() const
+{
+    return lineFrequency;
+}
+
+
+void SignalQuality::setParameter (int parameterIndex, float newValue)
+{
+    if (parameterIndex == 0)
+        lineFrequency = jlimit (1.0f, 1000.0f, newValue);
+    else if (parameterIndex == 1)
+        stride = jlimit (1, 64, roundFloatToInt (newValue));
+}
+
+
+void SignalQuality::updateSettings()
+{
+    groups.clear();
+    noiseEstimators.clear();
+
+    // consecutive channels of one source share a group, so that they have the same samples per block
+    for (int ch = 0; ch < dataChannelArray.size(); ++ch)
+    {
+        const DataChannel* channel = dataChannelArray[ch];
+        const uint32 sourceId = getProcessorFullId (channel->getSourceNodeID(), channel->getSubProcessorIdx());
+
+        Group* group = groups.getLast();
+
+        if (group == nullptr || group->numLanes == SIGNALQUALITY_LANES
+            || getProcessorFullId (dataChannelArray[group->channels[0]]->getSourceNodeID(),
+                                   dataChannelArray[group->channels[0]]->getSubProcessorIdx()) != sourceId)
+        {
+            group = groups.add (new Group());
+            zerostruct (*group);
+        }
+
+        group->channels[group->numLanes++] = ch;
+        noiseEstimators.add (new NoiseEstimator());
+    }
+
+    qualities.resize (dataChannelArray.size());
+
+    resetStates();
+}
+
+
+bool SignalQuality::enable()
+{
+    resetStates();
+    return true;
+}
+
+
+void SignalQuality::resetStates()
+{
+    for (int g = 0; g < groups.size(); ++g)
+    {
+        Group& group = *groups[g];
+        const float sampleRate = dataChannelArray[group.channels[0]]->getSampleRate();
+
+        // at least four samples taken per period of the line
+        group.stride = jlimit (1, stride, int (sampleRate / (4.0f * lineFrequency)));
+        group.windowSamples = jmax (1, roundToInt (SIGNALQUALITY_WINDOW_SECONDS * sampleRate / group.stride));
+        group.phase = 0;
+        group.taken = 0;
+
+        const float coefficient = 2.0f * std::cos (2.0f * float_Pi * lineFrequency * group.stride / sampleRate);
+
+        for (int lane = 0; lane < SIGNALQUALITY_LANES; ++lane)
+        {
+            // missing lanes repeat the first channel, and are never published
+            const int ch = group.channels[lane < group.numLanes ? lane : 0];
+            const float bitVolts = dataChannelArray[ch]->getBitVolts();
+
+            group.goertzelCoefficient[lane] = coefficient;
+            group.saturationLevel[lane] = (bitVolts > 0) ? 0.99f * 32767.0f * bitVolts : std::numeric_limits<float>::max();
+            group.sumSquares[lane] = 0;
+            group.s1[lane] = 0;
+            group.s2[lane] = 0;
+            group.saturated[lane] = 0;
+        }
+
+        for (int lane = 0; lane < group.numLanes; ++lane)
+            noiseEstimators[group.channels[lane]]->setSampleRate (sampleRate, group.stride);
+    }
+
+    for (int ch = 0; ch < qualities.size(); ++ch)
+        zerostruct (qualities.getReference (ch));
+}
+
+
+void SignalQuality::process (AudioSampleBuffer& buffer)
+{
+    for (int g = 0; g < groups.size(); ++g)
+    {
+        Group& group = *groups.getUnchecked (g);
+        const int numSamples = jmin ((int) getNumSamples (group.channels[0]), buffer.getNumSamples());
+
+        if (numSamples > 0)
+            processGroup (group, buffer, numSamples);
+    }
+}
+
+
+void SignalQuality::processGroup (Group& group, const AudioSampleBuffer& buffer, int numSamples)
+{
+    const float* data[SIGNALQUALITY_LANES];
+
+    for (int lane = 0; lane < SIGNALQUALITY_LANES; ++lane)
+        data[lane] = buffer.getReadPointer (group.channels[lane < group.numLanes ? lane : 0]);
+
+    for (int lane = 0; lane < group.numLanes; ++lane)
+        noiseEstimators.getUnchecked (group.channels[lane])->pushSamples (data[lane], numSamples);
+
+    int i = group.phase;
+
+    while (i < numSamples)
+    {
+        // the samples taken until the end of the block or of the window
+        const int n = jmin ((numSamples - 1 - i) / group.stride + 1, group.windowSamples - group.taken);
+
+       #if SIGNALQUALITY_SSE
+        const __m128 coefficient = _mm_loadu_ps (group.goertzelCoefficient);
+        const __m128 level = _mm_loadu_ps (group.saturationLevel);
+        const __m128 signMask = _mm_set1_ps (-0.0f);
+        const __m128 one = _mm_set1_ps (1.0f);
+        __m128 sumSquares = _mm_loadu_ps (group.sumSquares);
+        __m128 s1 = _mm_loadu_ps (group.s1);
+        __m128 s2 = _mm_loadu_ps (group.s2);
+        __m128 saturated = _mm_loadu_ps (group.saturated);
+
+        for (int k = 0; k < n; ++k, i += group.stride)
+        {
+            const __m128 x = _mm_setr_ps (data[0][i], data[1][i], data[2][i], data[3][i]);
+            const __m128 s0 = _mm_sub_ps (_mm_add_ps (x, _mm_mul_ps (coefficient, s1)), s2);
+
+            sumSquares = _mm_add_ps (sumSquares, _mm_mul_ps (x, x));
+            s2 = s1;
+            s1 = s0;
+            saturated = _mm_add_ps (saturated, _mm_and_ps (_mm_cmpge_ps (_mm_andnot_ps (signMask, x), level), one));
+        }
+
+        _mm_storeu_ps (group.sumSquares, sumSquares);
+        _mm_storeu_ps (group.s1, s1);
+        _mm_storeu_ps (group.s2, s2);
+        _mm_storeu_ps (group.saturated, saturated);
+       #else
+        for (int lane = 0; lane < group.numLanes; ++lane)
+        {
+            const float* samples = data[lane];
+            const float coefficient = group.goertzelCoefficient[lane];
+            const float level = group.saturationLevel[lane];
+            float sumSquares = group.sumSquares[lane];
+            float s1 = group.s1[lane];
+            float s2 = group.s2[lane];
+            float saturated = group.saturated[lane];
+
+            for (int k = 0, j = i; k < n; ++k, j += group.stride)
+            {
+                const float x = samples[j];
+                const float s0 = x + coefficient * s1 - s2;
+
+                sumSquares += x * x;
+                s2 = s1;
+                s1 = s0;
+                saturated += (std::abs (x) >= level) ? 1.0f : 0.0f;
+            }
+
+            group.sumSquares[lane] = sumSquares;
+            group.s1[lane] = s1;
+            group.s2[lane] = s2;
+            group.saturated[lane] = saturated;
+        }
+
+        i += n * group.stride;
+       #endif
+
+        group.taken += n;
+
+        if (group.taken >= group.windowSamples)
+            finishWindow (group);
+    }
+
+    group.phase = i - numSamples;
+}
+
+
+void SignalQuality::finishWindow (Group& group)
+{
+    const float n = float (group.taken);
+
+    for (int lane = 0; lane < group.numLanes; ++lane)
+    {
+        const int ch = group.channels[lane];
+        const float s1 = group.s1[lane];
+        const float s2 = group.s2[lane];
+
+        // a sine of amplitude A leaves a squared magnitude of (A n / 2)^2 in the Goertzel bin
+        const float power = jmax (0.0f, s1 * s1 + s2 * s2 - group.goertzelCoefficient[lane] * s1 * s2);
+
+        ChannelQuality& quality = qualities.getReference (ch);
+        quality.rms = std::sqrt (group.sumSquares[lane] / n);
+        quality.noise = noiseEstimators.getUnchecked (ch)->getNoiseLevel();
+        quality.lineNoise = std::sqrt (2.0f * power) / n;
+        quality.saturated = int (group.saturated[lane]);
+        quality.valid = true;
+    }
+
+    for (int lane = 0; lane < SIGNALQUALITY_LANES; ++lane)
+    {
+        group.sumSquares[lane] = 0;
+        group.s1[lane] = 0;
+        group.s2[lane] = 0;
+        group.saturated[lane] = 0;
+    }
+
+    group.taken = 0;
+}
+
+
+void SignalQuality::getChannelQualities (Array<ChannelQuality>& result) const
+{
+    result.clearQuick();
+    result.addArray (qualities);
+}
+
+
+void SignalQuality::getChannelStatus (const Array<ChannelQuality>& qualities, Array<int>& status)
+{
+    std::vector<float> rms, noise;
+
+    for (int ch = 0; ch < qualities.size(); ++ch)
+    {
+        if (qualities[ch].valid)
+        {
+            rms.push_back (qualities[ch].rms);
+            noise.push_back (qualities[ch].noise);
+        }
+    }
+
+    float medianRms = 0;
+    float medianNoise = 0;
+
+    if (rms.size() > 0)
+    {
+        std::nth_element (rms.begin(), rms.begin() + rms.size() / 2, rms.end());
+        std::nth_element (noise.begin(), noise.begin() + noise.size() / 2, noise.end());
+        medianRms = rms[rms.size() / 2];
+        medianNoise = noise[noise.size() / 2];
+    }
+
+    status.clearQuick();
+
+    for (int ch = 0; ch < qualities.size(); ++ch)
+    {
+        const ChannelQuality& quality = qualities.getReference (ch);
+
+        if (! quality.valid)
+            status.add (STATUS_UNKNOWN);
+        else if (quality.saturated > 0)
+            status.add (STATUS_SATURATED);
+        else if (quality.rms <= 0.2f * medianRms || quality.rms == 0)
+            status.add (STATUS_DEAD);
+        else if (medianNoise > 0 && quality.noise > 3.0f * medianNoise)
+            status.add (STATUS_NOISY);
+        else if (quality.lineNoise * quality.lineNoise > 0.5f * quality.rms * quality.rms)
+            status.add (STATUS_LINE_NOISE);
+        else
+            status.add (STATUS_GOOD);
+    }
+}
+
+
+var SignalQuality::getStatusInfo() const
+{
+    Array<ChannelQuality> current;
+    Array<int> status;
+    getChannelQualities (current);
+    getChannelStatus (current, status);
+
+    // one letter per channel, in the order of the ChannelStatus values
+    const char letters[] = ".GDNLS";
+    int counts[numElementsInArray (letters)] = { 0 };
+    String codes;
+    codes.preallocateBytes (size_t (status.size()) + 1);
+
+    for (int ch = 0; ch < status.size(); ++ch)
+    {
+        codes += letters[status[ch]];
+        ++counts[status[ch]];
+    }
+
+    DynamicObject::Ptr info = new DynamicObject();
+    info->setProperty ("channels", codes);
+    info->setProperty ("dead", counts[STATUS_DEAD]);
+    info->setProperty ("noisy", counts[STATUS_NOISY]);
+    info->setProperty ("line_noise", counts[STATUS_LINE_NOISE]);
+    info->setProperty ("saturated", counts[STATUS_SATURATED]);
+    return var (info.get());
+}
@@ -0,0 +1,163 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SIGNALQUALITY_H_INCLUDED
+#define SIGNALQUALITY_H_INCLUDED
+
+
+#ifdef _WIN32
+    #include <Windows.h>
+#endif
+
+#include <ProcessorHeaders.h>
+#include <SpikeLib.h>
+
+
+/** Channels measured together, one per SIMD lane */
+#define SIGNALQUALITY_LANES 4
+#define SIGNALQUALITY_DEFAULT_STRIDE 8
+#define SIGNALQUALITY_DEFAULT_LINE_HZ 50
+/** Length of the windows each measurement is made over */
+#define SIGNALQUALITY_WINDOW_SECONDS 1.0
+
+
+/**
+    Watches every input channel for the usual faults of long sessions, so that they needn't be
+    spotted on the LFP display: dead channels, noisy ones, line noise pickup and saturation.
+
+    Over windows of about a second, it measures the RMS of each channel, its power at the line
+    frequency with a Goertzel filter, and the number of samples within a percent of the full
+    scale of its 16-bit samples, while a NoiseEstimator follows its noise as median(|x|) / 0.6745.
+    Only one sample in every few is taken, which leaves the line frequency well below the
+    Nyquist frequency of what is taken. The accumulators of the channels of one source are laid
+    out lane by lane, SIGNALQUALITY_LANES channels at a time, and updated with SSE where there is
+    SSE. The input channels are passed through unchanged.
+
+    Each finished window is published for the editor's heat map and for remote monitoring, which
+    classify the channels against the median of all of them: a channel well below it is dead,
+    one well above it noisy.
+
+    @see NoiseEstimator
+*/
+class SignalQuality : public GenericProcessor
+{
+public:
+    /** The class constructor, used to initialize any members. */
+    SignalQuality();
+
+    /** The class destructor, used to deallocate memory */
+    ~SignalQuality();
+
+    /** Takes the block's samples into the measurements of every channel */
+    void process (AudioSampleBuffer& buffer) override;
+
+    AudioProcessorEditor* createEditor() override;
+
+    bool hasEditor() const override { return true; }
+
+    /** Groups the channels by source */
+    void updateSettings() override;
+
+    bool enable() override;
+
+    /** Returns the status of every channel, as a string with one letter per channel */
+    var getStatusInfo() const override;
+
+    enum ChannelStatus
+    {
+        STATUS_UNKNOWN = 0,     // no window finished yet
+        STATUS_GOOD,
+        STATUS_DEAD,            // RMS under a fifth of the median
+        STATUS_NOISY,           // noise over three times the median
+        STATUS_LINE_NOISE,      // over half of the power at the line frequency
+        STATUS_SATURATED        // samples at full scale in the last window
+    };
+
+    /** The measurements of a channel over its last finished window */
+    struct ChannelQuality
+    {
+        float rms;
+        float noise;            // median(|x|) / 0.6745
+        float lineNoise;        // RMS amplitude at the line frequency
+        int saturated;          // samples at full scale
+        bool valid;
+    };
+
+    /** Copies the last finished measurements of every channel. Can be called from any thread. */
+    void getChannelQualities (Array<ChannelQuality>& qualities) const;
+
+    /** Classifies the channels, as measured, against the median of all of them */
+    static void getChannelStatus (const Array<ChannelQuality>& qualities, Array<int>& status);
+
+    int getStride() const;
+    float getLineFrequency() const;
+
+    /** Sets the line frequency in Hz (0) and the samples between two taken (1), which take effect
+        the next time acquisition starts. */
+    void setParameter (int parameterIndex, float newValue) override;
+
+
+private:
+    /** Accumulators of up to SIGNALQUALITY_LANES channels of one source */
+    struct Group
+    {
+        int channels[SIGNALQUALITY_LANES];
+        int numLanes;
+        int stride;             // samples between two taken, fewer at low sample rates
+        int phase;              // samples to skip at the start of the next block
+        int taken;              // samples taken in the window
+        int windowSamples;      // samples taken per window
+
+        float goertzelCoefficient[SIGNALQUALITY_LANES];
+        float saturationLevel[SIGNALQUALITY_LANES];
+        float sumSquares[SIGNALQUALITY_LANES];
+        float s1[SIGNALQUALITY_LANES];
+        float s2[SIGNALQUALITY_LANES];
+        float saturated[SIGNALQUALITY_LANES];
+    };
+
+    /** Clears the accumulators and measurements, and sets the coefficients for the sample rates */
+    void resetStates();
+
+    /** Takes every stride-th sample of the group's channels from the block */
+    void processGroup (Group& group, const AudioSampleBuffer& buffer, int numSamples);
+
+    /** Publishes the group's window and clears its accumulators */
+    void finishWindow (Group& group);
+
+    int stride;
+    float lineFrequency;
+
+    OwnedArray<Group> groups;
+    OwnedArray<NoiseEstimator> noiseEstimators;
+
+    /** Written by the processing thread at the end of each window, one channel at a time; a reader
+        may see a channel's fields from two windows, which is fine for a status display */
+    Array<ChannelQuality> qualities;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SignalQuality);
+};
+
+
+
+#endif  // SIGNALQUALITY_H_INCLUDED
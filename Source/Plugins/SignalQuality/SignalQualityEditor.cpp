@@ -0,0 +1,217 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "SignalQualityEditor.h"
+
+
+SignalQualityMap::SignalQualityMap (SignalQuality* p)
+    : processor (p)
+{
+    startTimerHz (4);
+}
+
+
+SignalQualityMap::~SignalQualityMap()
+{
+}
+
+
+void SignalQualityMap::timerCallback()
+{
+    processor->getChannelQualities (qualities);
+    SignalQuality::getChannelStatus (qualities, status);
+    repaint();
+}
+
+
+void SignalQualityMap::getCellLayout (int& cellSize, int& columns) const
+{
+    const int numChannels = jmax (1, status.size());
+
+    // the largest cells for which the rows fit
+    cellSize = jmax (getWidth(), getHeight());
+    columns = 1;
+
+    while (cellSize > 1)
+    {
+        columns = jmax (1, getWidth() / cellSize);
+
+        if (((numChannels + columns - 1) / columns) * cellSize <= getHeight())
+            break;
+
+        --cellSize;
+    }
+}
+
+
+int SignalQualityMap::getChannelAt (Point<int> position) const
+{
+    int cellSize, columns;
+    getCellLayout (cellSize, columns);
+
+    const int column = position.x / cellSize;
+    const int channel = (position.y / cellSize) * columns + column;
+
+    return (column < columns && isPositiveAndBelow (channel, status.size())) ? channel : -1;
+}
+
+
+void SignalQualityMap::paint (Graphics& g)
+{
+    g.fillAll (Colours::darkgrey);
+
+    int cellSize, columns;
+    getCellLayout (cellSize, columns);
+
+    const Colour colours[] = { Colours::grey, Colours::green, Colours::black,
+                               Colours::orange, Colours::yellow, Colours::red };
+    const int gap = (cellSize > 3) ? 1 : 0;
+
+    for (int ch = 0; ch < status.size(); ++ch)
+    {
+        g.setColour (colours[status[ch]]);
+        g.fillRect ((ch % columns) * cellSize, (ch / columns) * cellSize, cellSize - gap, cellSize - gap);
+    }
+}
+
+
+void SignalQualityMap::mouseMove (const MouseEvent& event)
+{
+    const int channel = getChannelAt (event.getPosition());
+
+    if (channel < 0 || ! qualities[channel].valid)
+    {
+        setTooltip (String::empty);
+        return;
+    }
+
+    const SignalQuality::ChannelQuality& quality = qualities.getReference (channel);
+
+    setTooltip ("CH" + String (channel + 1)
+                + ": RMS " + String (quality.rms, 1)
+                + ", noise " + String (quality.noise, 1)
+                + ", line " + String (quality.lineNoise, 1)
+                + ", saturated " + String (quality.saturated));
+}
+
+
+// =====================================================================
+
+SignalQualityEditor::SignalQualityEditor (GenericProcessor* parentNode, bool useDefaultParameterEditors)
+    : GenericEditor (parentNode, useDefaultParameterEditors)
+{
+    desiredWidth = 290;
+
+    // item ids are the values themselves
+    lineSelector = addSelector ("Line (Hz):", 25, "Frequency of the line noise to measure");
+    lineSelector->addItem ("50", 50);
+    lineSelector->addItem ("60", 60);
+    lineSelector->setSelectedId (SIGNALQUALITY_DEFAULT_LINE_HZ, dontSendNotification);
+
+    strideSelector = addSelector ("Stride:", 55, "One sample in this many is measured");
+    const int strides[] = { 1, 2, 4, 8, 16, 32 };
+    for (int i = 0; i < numElementsInArray (strides); ++i)
+        strideSelector->addItem (String (strides[i]), strides[i]);
+    strideSelector->setSelectedId (SIGNALQUALITY_DEFAULT_STRIDE, dontSendNotification);
+
+    map = new SignalQualityMap (static_cast<SignalQuality*> (parentNode));
+    map->setBounds (140, 30, 140, 90);
+    addAndMakeVisible (map);
+}
+
+
+SignalQualityEditor::~SignalQualityEditor()
+{
+}
+
+
+ComboBox* SignalQualityEditor::addSelector (const String& name, int y, const String& tooltip)
+{
+    Label* label = labels.add (new Label (name, name));
+    label->setBounds (10, y, 100, 15);
+    label->setFont (Font ("Small Text", 12, Font::plain));
+    label->setColour (Label::textColourId, Colours::darkgrey);
+    addAndMakeVisible (label);
+
+    ComboBox* selector = new ComboBox (name);
+    selector->setBounds (15, y + 15, 110, 18);
+    selector->setTooltip (tooltip);
+    selector->addListener (this);
+    addAndMakeVisible (selector);
+
+    return selector;
+}
+
+
+void SignalQualityEditor::comboBoxChanged (ComboBox* comboBox)
+{
+    if (comboBox == lineSelector)
+        getProcessor()->setParameter (0, float (lineSelector->getSelectedId()));
+    else if (comboBox == strideSelector)
+        getProcessor()->setParameter (1, float (strideSelector->getSelectedId()));
+}
+
+
+void SignalQualityEditor::startAcquisition()
+{
+    lineSelector->setEnabled (false);
+    strideSelector->setEnabled (false);
+}
+
+
+void SignalQualityEditor::stopAcquisition()
+{
+    lineSelector->setEnabled (true);
+    strideSelector->setEnabled (true);
+}
+
+
+void SignalQualityEditor::saveCustomParameters (XmlElement* xml)
+{
+    xml->setAttribute ("Type", "SignalQualityEditor");
+
+    XmlElement* values = xml->createNewChildElement ("VALUES");
+    values->setAttribute ("LineFrequency", lineSelector->getSelectedId());
+    values->setAttribute ("Stride", strideSelector->getSelectedId());
+}
+
+
+void SignalQualityEditor::loadCustomParameters (XmlElement* xml)
+{
+    forEachXmlChildElement (*xml, xmlNode)
+    {
+        if (xmlNode->hasTagName ("VALUES"))
+        {
+            const int line = xmlNode->getIntAttribute ("LineFrequency", SIGNALQUALITY_DEFAULT_LINE_HZ);
+            lineSelector->setSelectedId (lineSelector->indexOfItemId (line) >= 0 ? line : SIGNALQUALITY_DEFAULT_LINE_HZ,
+                                         dontSendNotification);
+            getProcessor()->setParameter (0, float (lineSelector->getSelectedId()));
+
+            const int stride = xmlNode->getIntAttribute ("Stride", SIGNALQUALITY_DEFAULT_STRIDE);
+            strideSelector->setSelectedId (strideSelector->indexOfItemId (stride) >= 0 ? stride : SIGNALQUALITY_DEFAULT_STRIDE,
+                                           dontSendNotification);
+            getProcessor()->setParameter (1, float (strideSelector->getSelectedId()));
+        }
+    }
+}
@@ -0,0 +1,102 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SIGNALQUALITYEDITOR_H_INCLUDED
+#define SIGNALQUALITYEDITOR_H_INCLUDED
+
+
+#include <EditorHeaders.h>
+#include "SignalQuality.h"
+
+
+/**
+    A grid with a cell per channel, coloured by its status, refreshed a few times per second.
+    Hovering over a cell shows the channel's measurements.
+
+    @see SignalQuality
+*/
+class SignalQualityMap : public Component
+                       , public SettableTooltipClient
+                       , private Timer
+{
+public:
+    SignalQualityMap (SignalQuality* processor);
+    ~SignalQualityMap();
+
+    void paint (Graphics& g) override;
+    void mouseMove (const MouseEvent& event) override;
+
+
+private:
+    void timerCallback() override;
+
+    /** Returns the channel of the cell at a point, or -1 */
+    int getChannelAt (Point<int> position) const;
+
+    /** Side of the square cells fitting every channel in the component, and cells per row */
+    void getCellLayout (int& cellSize, int& columns) const;
+
+    SignalQuality* processor;
+    Array<SignalQuality::ChannelQuality> qualities;
+    Array<int> status;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SignalQualityMap);
+};
+
+
+/**
+    User interface for the Signal Quality, choosing the line frequency and the samples between
+    two taken, and showing the status of the channels.
+
+    @see SignalQuality
+*/
+class SignalQualityEditor : public GenericEditor
+                          , public ComboBox::Listener
+{
+public:
+    SignalQualityEditor (GenericProcessor* parentNode, bool useDefaultParameterEditors);
+    ~SignalQualityEditor();
+
+    void comboBoxChanged (ComboBox* comboBox) override;
+
+    void startAcquisition() override;
+    void stopAcquisition() override;
+
+    void saveCustomParameters (XmlElement* xml) override;
+    void loadCustomParameters (XmlElement* xml) override;
+
+
+private:
+    /** Adds a label and a combo box below the previous ones */
+    ComboBox* addSelector (const String& name, int y, const String& tooltip);
+
+    OwnedArray<Label>       labels;
+    ScopedPointer<ComboBox> lineSelector;
+    ScopedPointer<ComboBox> strideSelector;
+    ScopedPointer<SignalQualityMap> map;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SignalQualityEditor);
+};
+
+
+#endif  // SIGNALQUALITYEDITOR_H_INCLUDED
@@ -0,0 +1,566 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include <stdio.h>
+#include <cmath>
+#include "SpatialFilter.h"
+#include "SpatialFilterEditor.h"
+
+#if JUCE_INTEL && (defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2))
+ #define SPATIAL_FILTER_SSE2 1
+ #include <emmintrin.h>
+#endif
+
+namespace
+{
+    double dotProduct (const float* a, const float* b, int numSamples)
+    {
+        int i = 0;
+        float sum = 0;
+
+       #if SPATIAL_FILTER_SSE2
+        __m128 sum0 = _mm_setzero_ps();
+        __m128 sum1 = _mm_setzero_ps();
+
+        for (; i + 8 <= numSamples; i += 8)
+        {
+            sum0 = _mm_add_ps (sum0, _mm_mul_ps (_mm_loadu_ps (a + i), _mm_loadu_ps (b + i)));
+            sum1 = _mm_add_ps (sum1, _mm_mul_ps (_mm_loadu_ps (a + i + 4), _mm_loadu_ps (b + i + 4)));
+        }
+
+        float lanes[4];
+        _mm_storeu_ps (lanes, _mm_add_ps (sum0, sum1));
+        sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+       #endif
+
+        for (; i < numSamples; ++i)
+            sum += a[i] * b[i];
+
+        return sum;
+    }
+}
+
+
+SpatialFilter::SpatialFilter()
+    : GenericProcessor      ("Spatial Filter")
+    , calibrationSeconds    (SPATIAL_FILTER_DEFAULT_CALIBRATION_S)
+    , matrixSize            (0)
+    , transformChanged      (0)
+    , numChannels           (0)
+    , singleSource          (true)
+    , sourceId              (0)
+    , sampleRate            (0)
+    , pass                  (TRANSFORM_PASS)
+    , numSamples            (0)
+    , calibrationRequested  (0)
+    , calibrating           (0)
+    , calibrationSamples    (0)
+    , calibrationTarget     (0)
+    , whiteningThread       (*this)
+{
+    setProcessorType (PROCESSOR_TYPE_FILTER);
+
+    whiteningThread.startThread();
+}
+
+
+SpatialFilter::~SpatialFilter()
+{
+    whiteningThread.stopThread (5000);
+}
+
+
+AudioProcessorEditor* SpatialFilter::createEditor()
+{
+    editor = new SpatialFilterEditor (this, true);
+    return editor;
+}
+
+
+void SpatialFilter::setParameter (int parameterIndex, float newValue)
+{
+    if (parameterIndex == 0)
+        calibrationSeconds = jlimit (1.0f, float (SPATIAL_FILTER_MAX_CALIBRATION_S), newValue);
+}
+
+
+float SpatialFilter::getCalibrationSeconds() const
+{
+    return calibrationSeconds;
+}
+
+
+String SpatialFilter::loadMatrix (const File& file)
+{
+    if (! file.existsAsFile())
+        return "Spatial Filter: " + file.getFullPathName() + " does not exist.";
+
+    StringArray lines;
+    file.readLines (lines);
+
+    Array<float> values;
+    int numColumns = 0;
+    int numRows = 0;
+
+    for (int l = 0; l < lines.size(); ++l)
+    {
+        const String line = lines[l].trim();
+
+        if (line.isEmpty() || line.startsWithChar ('#'))
+            continue;
+
+        StringArray tokens;
+        tokens.addTokens (line, ",; \t", "");
+        tokens.removeEmptyStrings();
+
+        if (numRows == 0)
+            numColumns = tokens.size();
+        else if (tokens.size() != numColumns)
+            return "Spatial Filter: row " + String (numRows + 1) + " of " + file.getFileName() + " has "
+                   + String (tokens.size()) + " coefficients instead of " + String (numColumns) + ".";
+
+        for (int t = 0; t < tokens.size(); ++t)
+            values.add (tokens[t].getFloatValue());
+
+        ++numRows;
+    }
+
+    if (numRows == 0 || numRows != numColumns)
+        return "Spatial Filter: " + file.getFileName() + " is not a square matrix.";
+
+    setMatrix (values, numRows, file.getFileName());
+    matrixFile = file;
+
+    return "Spatial Filter: loaded a " + String (numRows) + " x " + String (numRows) + " matrix from "
+           + file.getFileName() + ".";
+}
+
+
+String SpatialFilter::saveMatrix (const File& file) const
+{
+    if (matrixSize == 0)
+        return "Spatial Filter: there is no matrix to save.";
+
+    String text;
+    text << "# Spatial Filter: " << matrixDescription << newLine;
+
+    for (int i = 0; i < matrixSize; ++i)
+    {
+        StringArray row;
+
+        for (int j = 0; j < matrixSize; ++j)
+            row.add (String (coefficients[i * matrixSize + j], 7));
+
+        text << row.joinIntoString (" ") << newLine;
+    }
+
+    if (! file.replaceWithText (text))
+        return "Spatial Filter: could not write " + file.getFullPathName() + ".";
+
+    return "Spatial Filter: saved the matrix to " + file.getFileName() + ".";
+}
+
+
+void SpatialFilter::setMatrix (const Array<float>& newCoefficients, int size, const String& description)
+{
+    ScopedPointer<Transform> newTransform;
+
+    if (size <= 0 || newCoefficients.size() != size * size)
+        size = 0;
+
+    if (size > 0)
+    {
+        int numNonzero = 0;
+
+        for (int i = 0; i < newCoefficients.size(); ++i)
+            if (newCoefficients.getUnchecked (i) != 0)
+                ++numNonzero;
+
+        newTransform = new Transform();
+        newTransform->size = size;
+        newTransform->sparse = numNonzero < SPATIAL_FILTER_SPARSE_DENSITY * float (size) * float (size);
+
+        if (newTransform->sparse)
+        {
+            newTransform->rowStart.add (0);
+
+            for (int i = 0; i < size; ++i)
+            {
+                for (int j = 0; j < size; ++j)
+                {
+                    const float c = newCoefficients.getUnchecked (i * size + j);
+
+                    if (c != 0)
+                    {
+                        newTransform->columns.add (j);
+                        newTransform->values.add (c);
+                    }
+                }
+
+                newTransform->rowStart.add (newTransform->columns.size());
+            }
+        }
+        else
+        {
+            // the coefficients of the rows of a block for each input are next to each other
+            const int numBlocks = (size + SPATIAL_FILTER_ROW_BLOCK - 1) / SPATIAL_FILTER_ROW_BLOCK;
+            newTransform->packed.calloc (size_t (numBlocks) * size * SPATIAL_FILTER_ROW_BLOCK);
+
+            for (int i = 0; i < size; ++i)
+                for (int j = 0; j < size; ++j)
+                    newTransform->packed[((i / SPATIAL_FILTER_ROW_BLOCK) * size + j) * SPATIAL_FILTER_ROW_BLOCK
+                                         + i % SPATIAL_FILTER_ROW_BLOCK] = newCoefficients.getUnchecked (i * size + j);
+        }
+    }
+
+    const ScopedLock myScopedLock (objectLock);
+
+    coefficients = newCoefficients;
+    matrixSize = size;
+    matrixDescription = (size > 0) ? description : String();
+    matrixFile = File();
+
+    pendingTransform = newTransform;
+    transformChanged = 1;
+}
+
+
+void SpatialFilter::clearMatrix()
+{
+    setMatrix (Array<float>(), 0, String());
+}
+
+
+String SpatialFilter::getMatrixDescription() const
+{
+    if (matrixSize == 0)
+        return "No matrix";
+
+    String description = matrixDescription + " (" + String (matrixSize) + " x " + String (matrixSize) + ")";
+
+    if (matrixSize != numChannels)
+        description += ", " + String (numChannels) + " channels";
+
+    return description;
+}
+
+
+File SpatialFilter::getMatrixFile() const
+{
+    return matrixFile;
+}
+
+
+bool SpatialFilter::startCalibration()
+{
+    if (whiteningThread.isComputing() || calibrating.get() != 0)
+        return false;
+
+    calibrationRequested = 1;
+    return true;
+}
+
+
+bool SpatialFilter::isCalibrating() const
+{
+    return calibrationRequested.get() != 0 || calibrating.get() != 0 || whiteningThread.isComputing();
+}
+
+
+void SpatialFilter::whiteningComputed()
+{
+    const int size = whiteningThread.getMatrixSize();
+
+    if (size == 0)
+    {
+        CoreServices::sendStatusMessage ("Spatial Filter: the channels were flat, no whitening matrix was computed.");
+    }
+    else
+    {
+        setMatrix (whiteningThread.getMatrix(), size, "Whitening over " + String (calibrationSeconds) + " s");
+        CoreServices::sendStatusMessage ("Spatial Filter: computed a " + String (size) + " x " + String (size)
+                                         + " whitening matrix.");
+    }
+
+    if (SpatialFilterEditor* spatialFilterEditor = dynamic_cast<SpatialFilterEditor*> (getEditor()))
+        spatialFilterEditor->updateMatrixInfo();
+}
+
+
+void SpatialFilter::updateSettings()
+{
+    // the sums are reallocated, so a whitening matrix still being computed from them is dropped
+    if (whiteningThread.isComputing())
+    {
+        whiteningThread.stopThread (5000);
+        whiteningThread.startThread();
+    }
+
+    numChannels = dataChannelArray.size();
+    singleSource = true;
+    calibrating = 0;
+
+    if (numChannels > 0)
+    {
+        const DataChannel* first = dataChannelArray[0];
+        sourceId = getProcessorFullId (first->getSourceNodeID(), first->getSubProcessorIdx());
+        sampleRate = first->getSampleRate();
+
+        for (int i = 1; i < numChannels; ++i)
+        {
+            const DataChannel* channel = dataChannelArray[i];
+
+            if (getProcessorFullId (channel->getSourceNodeID(), channel->getSubProcessorIdx()) != sourceId)
+                singleSource = false;
+        }
+
+        sums.calloc (numChannels);
+        crossSums.calloc (size_t (numChannels) * numChannels);
+    }
+
+    if (! singleSource)
+        CoreServices::sendStatusMessage ("Spatial Filter: the channels come from several sources, they are not transformed.");
+    else if (matrixSize > 0 && matrixSize != numChannels)
+        CoreServices::sendStatusMessage ("Spatial Filter: the matrix is " + String (matrixSize) + " x " + String (matrixSize)
+                                         + " but there are " + String (numChannels) + " channels, they are not transformed.");
+}
+
+
+bool SpatialFilter::enable()
+{
+    calibrating = 0;
+    return true;
+}
+
+
+bool SpatialFilter::disable()
+{
+    if (calibrating.get() != 0)
+    {
+        calibrating = 0;
+        CoreServices::sendStatusMessage ("Spatial Filter: acquisition stopped before the end of the calibration.");
+    }
+
+    return true;
+}
+
+
+void SpatialFilter::process (AudioSampleBuffer& buffer)
+{
+    if (transformChanged.get() != 0)
+    {
+        const ScopedTryLock myScopedTryLock (objectLock);
+
+        // otherwise the previous transform is kept for this block
+        if (myScopedTryLock.isLocked())
+        {
+            transformChanged = 0;
+            transform = pendingTransform.release();
+        }
+    }
+
+    if (numChannels == 0 || ! singleSource)
+        return;
+
+    numSamples = int (getNumSourceSamples (sourceId));
+
+    if (calibrationRequested.get() != 0 && calibrating.get() == 0 && ! whiteningThread.isComputing())
+    {
+        calibrationRequested = 0;
+        calibrating = 1;
+        calibrationSamples = 0;
+        calibrationTarget = jmax (int64 (2), int64 (calibrationSeconds * sampleRate));
+
+        FloatVectorOperations::clear (sums.getData(), numChannels);
+        memset (crossSums.getData(), 0, sizeof (double) * size_t (numChannels) * numChannels);
+    }
+
+    // the covariance is of the input, whatever the current matrix
+    if (calibrating.get() != 0)
+    {
+        pass = COVARIANCE_PASS;
+        processChannelsInParallel (buffer, numChannels);
+
+        calibrationSamples += numSamples;
+
+        if (calibrationSamples >= calibrationTarget)
+        {
+            calibrating = 0;
+            whiteningThread.startComputing (sums, crossSums, calibrationSamples, numChannels);
+        }
+    }
+
+    if (transform == nullptr || transform->size != numChannels || numSamples == 0)
+        return;
+
+    input.setSize (numChannels, numSamples, false, false, true);
+
+    pass = TRANSFORM_PASS;
+    processChannelsInParallel (buffer, (numSamples + SPATIAL_FILTER_TILE_SAMPLES - 1) / SPATIAL_FILTER_TILE_SAMPLES);
+}
+
+
+void SpatialFilter::processChannels (AudioSampleBuffer& buffer, int first, int last)
+{
+    float* const* data = buffer.getArrayOfWritePointers();
+
+    if (pass == COVARIANCE_PASS)
+    {
+        accumulateCovariance (data, first, last);
+        return;
+    }
+
+    for (int tile = first; tile < last; ++tile)
+    {
+        const int startSample = tile * SPATIAL_FILTER_TILE_SAMPLES;
+        transformTile (data, startSample, jmin (SPATIAL_FILTER_TILE_SAMPLES, numSamples - startSample));
+    }
+}
+
+
+void SpatialFilter::accumulateCovariance (const float* const* data, int firstRow, int lastRow)
+{
+    for (int i = firstRow; i < lastRow; ++i)
+    {
+        double sum = 0;
+
+        for (int n = 0; n < numSamples; ++n)
+            sum += data[i][n];
+
+        sums[i] += sum;
+
+        // the upper triangle is the same
+        double* row = crossSums + size_t (i) * numChannels;
+
+        for (int j = 0; j <= i; ++j)
+            row[j] += dotProduct (data[i], data[j], numSamples);
+    }
+}
+
+
+void SpatialFilter::transformTile (float* const* data, int startSample, int tileSamples)
+{
+    float* const* inputData = input.getArrayOfWritePointers();
+
+    // the tile's input is copied aside, its outputs then overwriting it
+    for (int j = 0; j < numChannels; ++j)
+        FloatVectorOperations::copy (inputData[j] + startSample, data[j] + startSample, tileSamples);
+
+    if (transform->sparse)
+        transformSparse (data, inputData, startSample, tileSamples);
+    else
+        transformDense (data, inputData, startSample, tileSamples);
+}
+
+
+void SpatialFilter::transformDense (float* const* data, const float* const* inputData, int startSample, int tileSamples)
+{
+    const int size = transform->size;
+
+    for (int firstRow = 0; firstRow < size; firstRow += SPATIAL_FILTER_ROW_BLOCK)
+    {
+        const float* packed = transform->packed + size_t (firstRow) * size;
+        const int numRows = jmin (SPATIAL_FILTER_ROW_BLOCK, size - firstRow);
+        int n = 0;
+
+       #if SPATIAL_FILTER_SSE2
+        // eight samples of the block's four rows are kept in registers over all the inputs
+        for (; n + 8 <= tileSamples; n += 8)
+        {
+            __m128 acc[SPATIAL_FILTER_ROW_BLOCK][2];
+
+            for (int r = 0; r < SPATIAL_FILTER_ROW_BLOCK; ++r)
+                acc[r][0] = acc[r][1] = _mm_setzero_ps();
+
+            for (int j = 0; j < size; ++j)
+            {
+                const float* x = inputData[j] + startSample + n;
+                const __m128 x0 = _mm_loadu_ps (x);
+                const __m128 x1 = _mm_loadu_ps (x + 4);
+                const __m128 c = _mm_loadu_ps (packed + j * SPATIAL_FILTER_ROW_BLOCK);
+
+                const __m128 c0 = _mm_shuffle_ps (c, c, _MM_SHUFFLE (0, 0, 0, 0));
+                const __m128 c1 = _mm_shuffle_ps (c, c, _MM_SHUFFLE (1, 1, 1, 1));
+                const __m128 c2 = _mm_shuffle_ps (c, c, _MM_SHUFFLE (2, 2, 2, 2));
+                const __m128 c3 = _mm_shuffle_ps (c, c, _MM_SHUFFLE (3, 3, 3, 3));
+
+                acc[0][0] = _mm_add_ps (acc[0][0], _mm_mul_ps (c0, x0));
+                acc[0][1] = _mm_add_ps (acc[0][1], _mm_mul_ps (c0, x1));
+                acc[1][0] = _mm_add_ps (acc[1][0], _mm_mul_ps (c1, x0));
+                acc[1][1] = _mm_add_ps (acc[1][1], _mm_mul_ps (c1, x1));
+                acc[2][0] = _mm_add_ps (acc[2][0], _mm_mul_ps (c2, x0));
+                acc[2][1] = _mm_add_ps (acc[2][1], _mm_mul_ps (c2, x1));
+                acc[3][0] = _mm_add_ps (acc[3][0], _mm_mul_ps (c3, x0));
+                acc[3][1] = _mm_add_ps (acc[3][1], _mm_mul_ps (c3, x1));
+            }
+
+            for (int r = 0; r < numRows; ++r)
+            {
+                float* out = data[firstRow + r] + startSample + n;
+                _mm_storeu_ps (out, acc[r][0]);
+                _mm_storeu_ps (out + 4, acc[r][1]);
+            }
+        }
+       #endif
+
+        if (n == tileSamples)
+            continue;
+
+        for (int r = 0; r < numRows; ++r)
+        {
+            float* out = data[firstRow + r] + startSample + n;
+            FloatVectorOperations::clear (out, tileSamples - n);
+
+            for (int j = 0; j < size; ++j)
+                FloatVectorOperations::addWithMultiply (out, inputData[j] + startSample + n,
+                                                        packed[j * SPATIAL_FILTER_ROW_BLOCK + r], tileSamples - n);
+        }
+    }
+}
+
+
+void SpatialFilter::transformSparse (float* const* data, const float* const* inputData, int startSample, int tileSamples)
+{
+    const int* rowStart = transform->rowStart.begin();
+    const int* columns = transform->columns.begin();
+    const float* values = transform->values.begin();
+
+    for (int i = 0; i < transform->size; ++i)
+    {
+        float* out = data[i] + startSample;
+
+        if (rowStart[i] == rowStart[i + 1])
+        {
+            FloatVectorOperations::clear (out, tileSamples);
+            continue;
+        }
+
+        FloatVectorOperations::copyWithMultiply (out, inputData[columns[rowStart[i]]] + startSample,
+                                                 values[rowStart[i]], tileSamples);
+
+        for (int k = rowStart[i] + 1; k < rowStart[i + 1]; ++k)
+            FloatVectorOperations::addWithMultiply (out, inputData[columns[k]] + startSample, values[k], tileSamples);
+    }
+}
@@ -0,0 +1,194 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SPATIALFILTER_H_INCLUDED
+#define SPATIALFILTER_H_INCLUDED
+
+
+#ifdef _WIN32
+    #include <Windows.h>
+#endif
+
+#include <ProcessorHeaders.h>
+
+#include "WhiteningThread.h"
+
+
+/** Samples of every channel transformed together, their input staying in cache */
+#define SPATIAL_FILTER_TILE_SAMPLES 64
+
+/** Output channels computed together from each input sample, one per SIMD lane */
+#define SPATIAL_FILTER_ROW_BLOCK 4
+
+/** Fraction of nonzero coefficients under which a matrix is applied as a sparse one */
+#define SPATIAL_FILTER_SPARSE_DENSITY 0.25f
+
+#define SPATIAL_FILTER_DEFAULT_CALIBRATION_S 10
+#define SPATIAL_FILTER_MAX_CALIBRATION_S 600
+
+
+/**
+    Replaces the channels by a linear combination of them, out = M * in, M being a square
+    matrix over all the input channels: a whitening matrix, local references, or any
+    re-referencing that a channel map with one reference per channel cannot express.
+
+    The matrix is either loaded from a text file, one row per output channel, or computed
+    from the data: over a calibration window, the covariance of the channels is estimated
+    online, and the ZCA whitening matrix is then computed from it on a background thread
+    and replaces the current one. The whitening matrix is scaled so that the channels keep
+    their mean variance, and so their units.
+
+    The buffer is swept through tiles of SPATIAL_FILTER_TILE_SAMPLES samples of every
+    channel, which are spread over the channel thread pool. Each tile copies its input aside
+    and computes its outputs while that input is still in cache, SPATIAL_FILTER_ROW_BLOCK
+    outputs at a time with SSE2 for a dense matrix, or row by row from the nonzero
+    coefficients for a sparse one. The covariance is accumulated by rows of channels.
+
+    All the channels must come from a single source, whose blocks they share.
+*/
+class SpatialFilter : public GenericProcessor
+{
+public:
+    /** The class constructor, used to initialize any members. */
+    SpatialFilter();
+
+    /** The class destructor, used to deallocate memory */
+    ~SpatialFilter();
+
+    /** Accumulates the covariance while calibrating, then transforms the tiles */
+    void process (AudioSampleBuffer& buffer) override;
+
+    /** Tiles and rows of the covariance are independent of each other.*/
+    bool isChannelParallelSafe() const override { return true; }
+
+    /** The range is one of tiles, or of rows of the covariance while it is accumulated */
+    void processChannels (AudioSampleBuffer& buffer, int first, int last) override;
+
+    AudioProcessorEditor* createEditor() override;
+
+    bool hasEditor() const override { return true; }
+
+    /** Checks that the channels can be transformed, and sizes the covariance */
+    void updateSettings() override;
+
+    bool enable() override;
+
+    /** Abandons a calibration */
+    bool disable() override;
+
+    /** Sets the length of the calibration window in seconds (0) */
+    void setParameter (int parameterIndex, float newValue) override;
+
+    float getCalibrationSeconds() const;
+
+    /** Reads a matrix from a text file, each line being a row of coefficients separated by
+        commas or spaces, and lines starting with # being comments. Returns a status message. */
+    String loadMatrix (const File& file);
+
+    /** Writes the current matrix in the format loadMatrix() reads. Returns a status message. */
+    String saveMatrix (const File& file) const;
+
+    /** Replaces the matrix, of size x size coefficients row by row, which the audio thread
+        picks up at its next block. Can be called during acquisition. */
+    void setMatrix (const Array<float>& coefficients, int size, const String& description);
+    void clearMatrix();
+
+    /** Describes the current matrix, and whether it fits the channels */
+    String getMatrixDescription() const;
+
+    /** The file the matrix was loaded from, if it was */
+    File getMatrixFile() const;
+
+    /** Starts estimating the covariance over the calibration window, at the next block or once
+        acquisition starts, the whitening matrix computed from it then replacing the matrix.
+        Returns false if a whitening matrix is still being computed. */
+    bool startCalibration();
+
+    bool isCalibrating() const;
+
+    /** Called on the message thread by the whitening thread once it is done */
+    void whiteningComputed();
+
+
+private:
+    /** The matrix laid out for the kernels */
+    struct Transform
+    {
+        int size;
+        bool sparse;
+        HeapBlock<float> packed;    // dense, by blocks of rows, the rows of a block interleaved
+        Array<int> rowStart;        // sparse, CSR
+        Array<int> columns;
+        Array<float> values;
+    };
+
+    enum Pass
+    {
+        COVARIANCE_PASS = 0,
+        TRANSFORM_PASS
+    };
+
+    void accumulateCovariance (const float* const* data, int firstRow, int lastRow);
+    void transformTile (float* const* data, int startSample, int numSamples);
+    void transformDense (float* const* data, const float* const* input, int startSample, int numSamples);
+    void transformSparse (float* const* data, const float* const* input, int startSample, int numSamples);
+
+    float calibrationSeconds;
+
+    /** The matrix as set, on the message thread */
+    Array<float> coefficients;
+    int matrixSize;
+    String matrixDescription;
+    File matrixFile;
+
+    /** The transform for the audio thread, replaced by the pending one when it changes */
+    CriticalSection objectLock;
+    ScopedPointer<Transform> pendingTransform;
+    Atomic<int> transformChanged;
+    ScopedPointer<Transform> transform;
+
+    int numChannels;
+    bool singleSource;
+    uint32 sourceId;
+    float sampleRate;
+
+    Pass pass;
+    int numSamples;
+    AudioSampleBuffer input;
+
+    /** Sums of the samples and, below the diagonal, of their products */
+    Atomic<int> calibrationRequested;
+    Atomic<int> calibrating;
+    int64 calibrationSamples;
+    int64 calibrationTarget;
+    HeapBlock<double> sums;
+    HeapBlock<double> crossSums;
+
+    WhiteningThread whiteningThread;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpatialFilter);
+};
+
+
+
+#endif  // SPATIALFILTER_H_INCLUDED
@@ -0,0 +1,197 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "SpatialFilterEditor.h"
+#include "SpatialFilter.h"
+
+
+SpatialFilterEditor::SpatialFilterEditor (GenericProcessor* parentNode, bool useDefaultParameterEditors)
+    : GenericEditor (parentNode, useDefaultParameterEditors)
+    , lastDirectory (CoreServices::getDefaultUserSaveDirectory())
+{
+    desiredWidth = 200;
+
+    matrixLabel = new Label ("Matrix", "No matrix");
+    matrixLabel->setBounds (10, 25, 180, 30);
+    matrixLabel->setFont (Font ("Small Text", 12, Font::plain));
+    matrixLabel->setColour (Label::textColourId, Colours::darkgrey);
+    matrixLabel->setJustificationType (Justification::topLeft);
+    addAndMakeVisible (matrixLabel);
+
+    loadButton  = addButton ("Load", 10, 60, "Load a square matrix, one row of coefficients per line");
+    saveButton  = addButton ("Save", 70, 60, "Save the current matrix");
+    clearButton = addButton ("Clear", 130, 60, "Remove the matrix, leaving the channels unchanged");
+
+    calibrateButton = addButton ("Whiten", 10, 95, "Estimate the covariance of the channels, then whiten them");
+    calibrateButton->setBounds (10, 95, 70, 20);
+
+    calibrationCaption = new Label ("Calibration", "over (s):");
+    calibrationCaption->setBounds (85, 97, 55, 15);
+    calibrationCaption->setFont (Font ("Small Text", 12, Font::plain));
+    calibrationCaption->setColour (Label::textColourId, Colours::darkgrey);
+    addAndMakeVisible (calibrationCaption);
+
+    calibrationValue = new Label ("Calibration seconds", String (SPATIAL_FILTER_DEFAULT_CALIBRATION_S));
+    calibrationValue->setBounds (140, 96, 45, 18);
+    calibrationValue->setFont (Font ("Default", 15, Font::plain));
+    calibrationValue->setColour (Label::textColourId, Colours::white);
+    calibrationValue->setColour (Label::backgroundColourId, Colours::grey);
+    calibrationValue->setEditable (true);
+    calibrationValue->setTooltip ("Length of the calibration window");
+    calibrationValue->addListener (this);
+    addAndMakeVisible (calibrationValue);
+}
+
+
+SpatialFilterEditor::~SpatialFilterEditor()
+{
+}
+
+
+UtilityButton* SpatialFilterEditor::addButton (const String& name, int x, int y, const String& tooltip)
+{
+    UtilityButton* button = new UtilityButton (name, Font ("Small Text", 13, Font::plain));
+    button->setBounds (x, y, 55, 20);
+    button->setTooltip (tooltip);
+    button->addListener (this);
+    addAndMakeVisible (button);
+
+    return button;
+}
+
+
+void SpatialFilterEditor::updateMatrixInfo()
+{
+    SpatialFilter* processor = static_cast<SpatialFilter*> (getProcessor());
+
+    String info = processor->getMatrixDescription();
+
+    if (processor->isCalibrating())
+        info += "\nCalibrating...";
+
+    matrixLabel->setText (info, dontSendNotification);
+}
+
+
+void SpatialFilterEditor::updateSettings()
+{
+    updateMatrixInfo();
+}
+
+
+void SpatialFilterEditor::buttonEvent (Button* button)
+{
+    SpatialFilter* processor = static_cast<SpatialFilter*> (getProcessor());
+
+    // the matrix can be replaced during acquisition
+    if (button == loadButton)
+    {
+        FileChooser fc ("Choose a matrix to load...", lastDirectory, "*.txt;*.csv;*", true);
+
+        if (fc.browseForFileToOpen())
+        {
+            lastDirectory = fc.getResult().getParentDirectory();
+            CoreServices::sendStatusMessage (processor->loadMatrix (fc.getResult()));
+        }
+    }
+    else if (button == saveButton)
+    {
+        FileChooser fc ("Choose the file name...", lastDirectory, "*.txt", true);
+
+        if (fc.browseForFileToSave (true))
+        {
+            lastDirectory = fc.getResult().getParentDirectory();
+            CoreServices::sendStatusMessage (processor->saveMatrix (fc.getResult()));
+        }
+    }
+    else if (button == clearButton)
+    {
+        processor->clearMatrix();
+    }
+    else if (button == calibrateButton)
+    {
+        if (! processor->startCalibration())
+            CoreServices::sendStatusMessage ("Spatial Filter: a calibration is already running.");
+        else if (! CoreServices::getAcquisitionStatus())
+            CoreServices::sendStatusMessage ("Spatial Filter: the calibration will start with acquisition.");
+    }
+
+    updateMatrixInfo();
+}
+
+
+void SpatialFilterEditor::labelTextChanged (Label* label)
+{
+    SpatialFilter* processor = static_cast<SpatialFilter*> (getProcessor());
+
+    if (label == calibrationValue)
+    {
+        const float value = label->getText().getFloatValue();
+
+        if (value < 1 || value > SPATIAL_FILTER_MAX_CALIBRATION_S)
+            CoreServices::sendStatusMessage ("Value out of range.");
+        else
+            processor->setParameter (0, value);
+
+        calibrationValue->setText (String (processor->getCalibrationSeconds()), dontSendNotification);
+    }
+}
+
+
+void SpatialFilterEditor::saveCustomParameters (XmlElement* xml)
+{
+    xml->setAttribute ("Type", "SpatialFilterEditor");
+
+    SpatialFilter* processor = static_cast<SpatialFilter*> (getProcessor());
+
+    XmlElement* values = xml->createNewChildElement ("VALUES");
+    values->setAttribute ("CalibrationSeconds", processor->getCalibrationSeconds());
+
+    // a computed whitening matrix is only kept if saved to a file
+    if (processor->getMatrixFile() != File())
+        values->setAttribute ("MatrixFile", processor->getMatrixFile().getFullPathName());
+}
+
+
+void SpatialFilterEditor::loadCustomParameters (XmlElement* xml)
+{
+    SpatialFilter* processor = static_cast<SpatialFilter*> (getProcessor());
+
+    forEachXmlChildElement (*xml, xmlNode)
+    {
+        if (xmlNode->hasTagName ("VALUES"))
+        {
+            processor->setParameter (0, float (xmlNode->getDoubleAttribute ("CalibrationSeconds",
+                                                                             SPATIAL_FILTER_DEFAULT_CALIBRATION_S)));
+            calibrationValue->setText (String (processor->getCalibrationSeconds()), dontSendNotification);
+
+            const String path = xmlNode->getStringAttribute ("MatrixFile");
+
+            if (path.isNotEmpty())
+                CoreServices::sendStatusMessage (processor->loadMatrix (File (path)));
+        }
+    }
+
+    updateMatrixInfo();
+}
@@ -0,0 +1,73 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SPATIALFILTEREDITOR_H_INCLUDED
+#define SPATIALFILTEREDITOR_H_INCLUDED
+
+
+#include <EditorHeaders.h>
+
+
+/**
+    User interface for the Spatial Filter: loads, saves and clears its matrix, and starts
+    the calibration of a whitening matrix.
+
+    @see SpatialFilter
+*/
+class SpatialFilterEditor : public GenericEditor
+                          , public Label::Listener
+{
+public:
+    SpatialFilterEditor (GenericProcessor* parentNode, bool useDefaultParameterEditors);
+    ~SpatialFilterEditor();
+
+    void buttonEvent (Button* button) override;
+    void labelTextChanged (Label* label) override;
+
+    /** Shows the processor's current matrix */
+    void updateMatrixInfo();
+
+    void updateSettings() override;
+
+    void saveCustomParameters (XmlElement* xml) override;
+    void loadCustomParameters (XmlElement* xml) override;
+
+
+private:
+    UtilityButton* addButton (const String& name, int x, int y, const String& tooltip);
+
+    ScopedPointer<Label>         matrixLabel;
+    ScopedPointer<UtilityButton> loadButton;
+    ScopedPointer<UtilityButton> saveButton;
+    ScopedPointer<UtilityButton> clearButton;
+    ScopedPointer<UtilityButton> calibrateButton;
+    ScopedPointer<Label>         calibrationCaption;
+    ScopedPointer<Label>         calibrationValue;
+
+    File lastDirectory;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpatialFilterEditor);
+};
+
+
+#endif  // SPATIALFILTEREDITOR_H_INCLUDED
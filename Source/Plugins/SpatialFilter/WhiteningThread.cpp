@@ -0,0 +1,233 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "WhiteningThread.h"
+#include "SpatialFilter.h"
+
+
+WhiteningThread::WhiteningThread (SpatialFilter& owner_)
+    : Thread        ("Whitening")
+    , owner         (owner_)
+    , computing     (0)
+    , sums          (nullptr)
+    , crossSums     (nullptr)
+    , numSamples    (0)
+    , size          (0)
+    , resultSize    (0)
+{
+}
+
+
+WhiteningThread::~WhiteningThread()
+{
+    cancelPendingUpdate();
+    stopThread (5000);
+}
+
+
+void WhiteningThread::startComputing (const double* sums_, const double* crossSums_, int64 numSamples_, int size_)
+{
+    sums = sums_;
+    crossSums = crossSums_;
+    numSamples = numSamples_;
+    size = size_;
+
+    computing = 1;
+    notify();
+}
+
+
+bool WhiteningThread::isComputing() const
+{
+    return computing.get() != 0;
+}
+
+
+Array<float> WhiteningThread::getMatrix() const
+{
+    const ScopedLock resultScopedLock (resultLock);
+    return result;
+}
+
+
+int WhiteningThread::getMatrixSize() const
+{
+    const ScopedLock resultScopedLock (resultLock);
+    return resultSize;
+}
+
+
+void WhiteningThread::run()
+{
+    while (! threadShouldExit())
+    {
+        wait (-1);
+
+        if (computing.get() == 0)
+            continue;
+
+        const bool done = computeWhitening();
+        computing = 0;
+
+        if (done)
+            triggerAsyncUpdate();
+    }
+}
+
+
+void WhiteningThread::handleAsyncUpdate()
+{
+    owner.whiteningComputed();
+}
+
+
+bool WhiteningThread::computeWhitening()
+{
+    const int n = size;
+
+    if (n <= 0 || numSamples < 2)
+    {
+        const ScopedLock resultScopedLock (resultLock);
+        result.clear();
+        resultSize = 0;
+        return true;
+    }
+
+    // the covariance, from the lower triangle of the sums
+    HeapBlock<double> a (size_t (n) * n);
+    HeapBlock<double> v (size_t (n) * n, true);
+
+    for (int i = 0; i < n; ++i)
+    {
+        for (int j = 0; j <= i; ++j)
+        {
+            const double c = (crossSums[i * n + j] - sums[i] * sums[j] / double (numSamples)) / double (numSamples - 1);
+            a[i * n + j] = c;
+            a[j * n + i] = c;
+        }
+
+        v[i * n + i] = 1.0;
+    }
+
+    double trace = 0;
+
+    for (int i = 0; i < n; ++i)
+        trace += a[i * n + i];
+
+    // each rotation zeroes a[p][q], a = J' a J and v = v J, until the off-diagonal part vanishes
+    for (int sweep = 0; sweep < WHITENING_MAX_SWEEPS; ++sweep)
+    {
+        if (threadShouldExit())
+            return false;
+
+        double offDiagonal = 0;
+
+        for (int p = 0; p < n; ++p)
+            for (int q = p + 1; q < n; ++q)
+                offDiagonal += a[p * n + q] * a[p * n + q];
+
+        if (offDiagonal <= 1e-24 * trace * trace)
+            break;
+
+        for (int p = 0; p < n - 1; ++p)
+        {
+            if (threadShouldExit())
+                return false;
+
+            for (int q = p + 1; q < n; ++q)
+            {
+                const double apq = a[p * n + q];
+
+                if (std::abs (apq) <= 1e-300)
+                    continue;
+
+                const double theta = (a[q * n + q] - a[p * n + p]) / (2.0 * apq);
+                const double t = ((theta >= 0) ? 1.0 : -1.0) / (std::abs (theta) + std::sqrt (theta * theta + 1.0));
+                const double c = 1.0 / std::sqrt (t * t + 1.0);
+                const double s = t * c;
+
+                for (int k = 0; k < n; ++k)
+                {
+                    const double akp = a[k * n + p];
+                    const double akq = a[k * n + q];
+                    a[k * n + p] = c * akp - s * akq;
+                    a[k * n + q] = s * akp + c * akq;
+                }
+
+                for (int k = 0; k < n; ++k)
+                {
+                    const double apk = a[p * n + k];
+                    const double aqk = a[q * n + k];
+                    a[p * n + k] = c * apk - s * aqk;
+                    a[q * n + k] = s * apk + c * aqk;
+                }
+
+                for (int k = 0; k < n; ++k)
+                {
+                    const double vkp = v[k * n + p];
+                    const double vkq = v[k * n + q];
+                    v[k * n + p] = c * vkp - s * vkq;
+                    v[k * n + q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+
+    const double meanEigenvalue = trace / double (n);
+
+    Array<float> matrix;
+
+    if (meanEigenvalue > 0)
+    {
+        const double epsilon = WHITENING_EPSILON * meanEigenvalue;
+        const double scale = std::sqrt (meanEigenvalue);
+
+        HeapBlock<double> factors (n);
+
+        for (int k = 0; k < n; ++k)
+            factors[k] = scale / std::sqrt (jmax (0.0, a[k * n + k]) + epsilon);
+
+        matrix.resize (n * n);
+
+        for (int i = 0; i < n; ++i)
+        {
+            for (int j = 0; j <= i; ++j)
+            {
+                double w = 0;
+
+                for (int k = 0; k < n; ++k)
+                    w += v[i * n + k] * factors[k] * v[j * n + k];
+
+                matrix.set (i * n + j, float (w));
+                matrix.set (j * n + i, float (w));
+            }
+        }
+    }
+
+    const ScopedLock resultScopedLock (resultLock);
+    result.swapWith (matrix);
+    resultSize = (result.size() > 0) ? n : 0;
+
+    return true;
+}
@@ -0,0 +1,93 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef WHITENINGTHREAD_H_INCLUDED
+#define WHITENINGTHREAD_H_INCLUDED
+
+
+#include <ProcessorHeaders.h>
+
+
+class SpatialFilter;
+
+/** Regularization of the eigenvalues, as a fraction of their mean */
+#define WHITENING_EPSILON 1e-3
+
+#define WHITENING_MAX_SWEEPS 50
+
+
+/**
+    Computes the ZCA whitening matrix of a covariance off the audio thread, and hands it back
+    to the Spatial Filter on the message thread.
+
+    The covariance is diagonalized with the cyclic Jacobi eigenvalue method, C = V L V', and
+    the whitening matrix is W = s V (L + e)^-1/2 V', e regularizing the smallest eigenvalues
+    and s being the square root of their mean, so that the whitened channels keep the mean
+    variance of the input ones.
+
+    @see SpatialFilter
+*/
+class WhiteningThread : public Thread
+                      , private AsyncUpdater
+{
+public:
+    WhiteningThread (SpatialFilter& owner);
+    ~WhiteningThread();
+
+    /** Wakes the thread to compute the whitening matrix of size channels, from the sums of their
+        samples and the lower triangle of the sums of their products over numSamples samples.
+        Called from the audio thread; the sums must not change until isComputing() is false. */
+    void startComputing (const double* sums, const double* crossSums, int64 numSamples, int size);
+
+    bool isComputing() const;
+
+    /** The last whitening matrix, row by row, empty if it could not be computed */
+    Array<float> getMatrix() const;
+    int getMatrixSize() const;
+
+    void run() override;
+
+
+private:
+    /** Computes the matrix into result. Returns false if the thread is stopped first. */
+    bool computeWhitening();
+
+    void handleAsyncUpdate() override;
+
+    SpatialFilter& owner;
+
+    Atomic<int> computing;
+    const double* sums;
+    const double* crossSums;
+    int64 numSamples;
+    int size;
+
+    CriticalSection resultLock;
+    Array<float> result;
+    int resultSize;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WhiteningThread);
+};
+
+
+#endif  // WHITENINGTHREAD_H_INCLUDED
@@ -0,0 +1,299 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <stdio.h>
+#include <cmath>
+#include "SpikeRate.h"
+#include "SpikeRateEditor.h"
+
+
+SpikeRate::SpikeRate()
+    : GenericProcessor  ("Spike Rate")
+    , binWidth          (SPIKERATE_DEFAULT_BIN_MS)
+    , timeConstant      (0)
+    , unitsPerElectrode (SPIKERATE_DEFAULT_UNITS)
+    , firstRateChannel  (0)
+    , currentBuffer     (nullptr)
+{
+    setProcessorType (PROCESSOR_TYPE_FILTER);
+}
+
+
+SpikeRate::~SpikeRate()
+{
+}
+
+
+AudioProcessorEditor* SpikeRate::createEditor()
+{
+    editor = new SpikeRateEditor (this, true);
+    return editor;
+}
+
+
+float SpikeRate::getBinWidth() const
+{
+    return binWidth;
+}
+
+
+float SpikeRate::getTimeConstant() const
+{
+    return timeConstant;
+}
+
+
+int SpikeRate::getUnitsPerElectrode() const
+{
+    return unitsPerElectrode;
+}
+
+
+void SpikeRate::setParameter (int parameterIndex, float newValue)
+{
+    if (parameterIndex == 0)
+        binWidth = jlimit (1.0f, 1000.0f, newValue);
+    else if (parameterIndex == 1)
+        timeConstant = jmax (0.0f, newValue);
+    else if (parameterIndex == 2)
+        unitsPerElectrode = jlimit (0, SPIKERATE_MAX_UNITS, roundFloatToInt (newValue));
+}
+
+
+int SpikeRate::getNumSubProcessors() const
+{
+    return jmax (1, sources.size());
+}
+
+
+float SpikeRate::getSampleRate (int subProcessorIdx) const
+{
+    if (subProcessorIdx < sources.size())
+        return 1000.0f / binWidth;
+
+    return getDefaultSampleRate();
+}
+
+
+void SpikeRate::updateSettings()
+{
+    sources.clear();
+    electrodes.clear();
+    rateChannels.clear();
+
+    firstRateChannel = dataChannelArray.size();
+
+    for (int i = 0; i < spikeChannelArray.size(); ++i)
+    {
+        const SpikeChannel* spikeChannel = spikeChannelArray[i];
+
+        // spikes are timestamped with the samples of the channels they were detected on
+        const Array<SourceChannelInfo> sourceInfo = spikeChannel->getSourceChannelInfo();
+        const uint32 sourceId = (sourceInfo.size() > 0)
+                              ? getProcessorFullId (sourceInfo[0].processorID, sourceInfo[0].subProcessorID)
+                              : getProcessorFullId (spikeChannel->getSourceNodeID(), spikeChannel->getSubProcessorIdx());
+
+        int sub = 0;
+        while (sub < sources.size() && sources[sub]->sourceId != sourceId)
+            ++sub;
+
+        if (sub == sources.size())
+        {
+            RateSource* source = sources.add (new RateSource());
+            source->sourceId = sourceId;
+            source->binSamples = spikeChannel->getSampleRate() * binWidth / 1000.0;
+            source->hasTimestamp = false;
+            source->nextBin = 0;
+            source->numBins = 0;
+        }
+
+        Electrode* electrode = electrodes.add (new Electrode());
+        electrode->source = sub;
+        electrode->firstChannel = rateChannels.size();
+        electrode->unitIds.ensureStorageAllocated (unitsPerElectrode);
+
+        for (int unit = 0; unit <= unitsPerElectrode; ++unit)
+        {
+            DataChannel* output = new DataChannel (DataChannel::AUX_CHANNEL, 1000.0f / binWidth, this, uint16 (sub));
+            output->setName (spikeChannel->getName() + ((unit == 0) ? String (" rate") : " unit " + String (unit)));
+            output->setBitVolts (1.0f);
+            output->setDataUnits ("Hz");
+            output->addToHistoricString (getName());
+            dataChannelArray.add (output);
+
+            RateChannel rateChannel;
+            rateChannel.source = sub;
+            rateChannels.add (rateChannel);
+        }
+    }
+
+    settings.numOutputs = dataChannelArray.size();
+
+    resetStates();
+}
+
+
+bool SpikeRate::enable()
+{
+    resetStates();
+    return true;
+}
+
+
+void SpikeRate::resetStates()
+{
+    for (int s = 0; s < sources.size(); ++s)
+    {
+        sources[s]->hasTimestamp = false;
+        sources[s]->nextBin = 0;
+        sources[s]->numBins = 0;
+    }
+
+    for (int e = 0; e < electrodes.size(); ++e)
+        electrodes[e]->unitIds.clearQuick();
+
+    for (int ch = 0; ch < rateChannels.size(); ++ch)
+    {
+        RateChannel& rateChannel = rateChannels.getReference (ch);
+        rateChannel.carry = 0;
+        rateChannel.rate = 0;
+    }
+}
+
+
+void SpikeRate::process (AudioSampleBuffer& buffer)
+{
+    const int numSamples = buffer.getNumSamples();
+
+    if (rateChannels.size() == 0 || numSamples == 0 || buffer.getNumChannels() < firstRateChannel + rateChannels.size())
+        return;
+
+    // the bins completed by the end of the block, at most one per sample of the buffer,
+    // the one after them holding the spikes of the bin still filling up
+    for (int s = 0; s < sources.size(); ++s)
+    {
+        RateSource& source = *sources[s];
+        const uint64 timestamp = getSourceTimestamp (source.sourceId);
+        const uint64 end = timestamp + getNumSourceSamples (source.sourceId);
+
+        if (! source.hasTimestamp)
+        {
+            source.nextBin = int64 (std::floor (timestamp / source.binSamples));
+            source.hasTimestamp = true;
+        }
+
+        const int64 completed = int64 (std::floor (end / source.binSamples)) - source.nextBin;
+        source.numBins = int (jlimit (int64 (0), int64 (numSamples - 1), completed));
+    }
+
+    for (int ch = 0; ch < rateChannels.size(); ++ch)
+    {
+        float* data = buffer.getWritePointer (firstRateChannel + ch);
+        const int numBins = sources[rateChannels.getReference (ch).source]->numBins;
+
+        FloatVectorOperations::clear (data, numBins + 1);
+        data[0] = rateChannels.getReference (ch).carry;
+    }
+
+    currentBuffer = &buffer;
+    checkForEvents (true);
+    currentBuffer = nullptr;
+
+    for (int ch = 0; ch < rateChannels.size(); ++ch)
+    {
+        RateChannel& rateChannel = rateChannels.getReference (ch);
+        float* data = buffer.getWritePointer (firstRateChannel + ch);
+        const int numBins = sources[rateChannel.source]->numBins;
+
+        // an exponential moving average with the given time constant, or the counts themselves
+        const float spikesToHz = 1000.0f / binWidth;
+        const float alpha = (timeConstant > 0) ? 1.0f - std::exp (-binWidth / timeConstant) : 1.0f;
+        float rate = rateChannel.rate;
+
+        for (int i = 0; i < numBins; ++i)
+        {
+            rate += alpha * (data[i] * spikesToHz - rate);
+            data[i] = rate;
+        }
+
+        rateChannel.rate = rate;
+        rateChannel.carry = data[numBins];
+
+        FloatVectorOperations::clear (data + numBins, numSamples - numBins);
+    }
+
+    for (int s = 0; s < sources.size(); ++s)
+    {
+        RateSource& source = *sources[s];
+
+        setTimestampAndSamples (uint64 (source.nextBin), source.numBins, s);
+        source.nextBin += source.numBins;
+    }
+}
+
+
+void SpikeRate::handleSpike (const SpikeChannel* spikeInfo, const MidiMessage& event, int samplePosition)
+{
+    // only the timestamp and sorted ID are needed, read in place
+    SpikeEventView spike (event, spikeInfo);
+
+    if (! spike.isValid() || currentBuffer == nullptr)
+        return;
+
+    const int electrodeIndex = getSpikeChannelIndex (spike);
+
+    if (! isPositiveAndBelow (electrodeIndex, electrodes.size()))
+        return;
+
+    Electrode& electrode = *electrodes.getUnchecked (electrodeIndex);
+    const RateSource& source = *sources.getUnchecked (electrode.source);
+
+    // spikes from before the block, if any, are counted in its first bin
+    const int64 bin = int64 (std::floor (spike.getTimestamp() / source.binSamples)) - source.nextBin;
+    const int binInBlock = int (jlimit (int64 (0), int64 (source.numBins), bin));
+
+    countSpike (electrode.firstChannel, binInBlock);
+
+    const uint16 sortedId = spike.getSortedID();
+
+    if (sortedId == 0)
+        return;
+
+    int unit = electrode.unitIds.indexOf (sortedId);
+
+    if (unit < 0 && electrode.unitIds.size() < unitsPerElectrode)
+    {
+        unit = electrode.unitIds.size();
+        electrode.unitIds.add (sortedId);
+    }
+
+    if (unit >= 0)
+        countSpike (electrode.firstChannel + 1 + unit, binInBlock);
+}
+
+
+void SpikeRate::countSpike (int rateChannel, int bin)
+{
+    currentBuffer->getWritePointer (firstRateChannel + rateChannel)[bin] += 1.0f;
+}
@@ -0,0 +1,141 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SPIKERATE_H_INCLUDED
+#define SPIKERATE_H_INCLUDED
+
+
+#ifdef _WIN32
+    #include <Windows.h>
+#endif
+
+#include <ProcessorHeaders.h>
+
+
+#define SPIKERATE_DEFAULT_BIN_MS 10
+#define SPIKERATE_DEFAULT_UNITS 4
+#define SPIKERATE_MAX_UNITS 16
+
+
+/**
+    Turns the incoming spikes into continuous firing rates, one sample per bin, for decoders
+    and exporters that want per-unit counts every few milliseconds rather than waveforms.
+
+    Each electrode gives a channel counting all of its spikes, followed by channels for the
+    first sorted units to appear on it, up to a set number per electrode. The rate channels of
+    the electrodes recording from one source make up a subprocessor of the Spike Rate, whose
+    sample rate is one over the bin width and whose timestamps count the bins since the
+    source's first sample. The input channels are passed through unchanged.
+
+    A spike only adds one to the bin it falls in, written straight into the block's output
+    channel, so the work per spike does not depend on the bin width nor on the number of
+    channels. At the end of the block, the completed bins are turned into spikes per second,
+    optionally smoothed by an exponential moving average, and the bin still filling up is
+    carried over to the next block.
+*/
+class SpikeRate : public GenericProcessor
+{
+public:
+    /** The class constructor, used to initialize any members. */
+    SpikeRate();
+
+    /** The class destructor, used to deallocate memory */
+    ~SpikeRate();
+
+    /** Counts the block's spikes into the rate channels and sets the timestamp and number of
+        samples of each subprocessor. */
+    void process (AudioSampleBuffer& buffer) override;
+
+    void handleSpike (const SpikeChannel* spikeInfo, const MidiMessage& event, int samplePosition) override;
+
+    AudioProcessorEditor* createEditor() override;
+
+    bool hasEditor() const override { return true; }
+
+    /** Adds the rate channels after the input channels */
+    void updateSettings() override;
+
+    int getNumSubProcessors() const override;
+
+    float getSampleRate (int subProcessorIdx = 0) const override;
+
+    bool enable() override;
+
+    float getBinWidth() const;
+    float getTimeConstant() const;
+    int getUnitsPerElectrode() const;
+
+    /** Sets the bin width in ms (0) and the number of units per electrode (2), which take
+        effect at the next update of the signal chain, or the time constant of the smoothing
+        in ms (1), 0 turning it off, which can be changed during acquisition. */
+    void setParameter (int parameterIndex, float newValue) override;
+
+
+private:
+    /** The rate channels of the electrodes sharing a source */
+    struct RateSource
+    {
+        uint32 sourceId;
+        double binSamples;          // source samples per bin
+        bool hasTimestamp;
+        int64 nextBin;              // bin of the first sample of the block
+        int numBins;                // bins completed in the block
+    };
+
+    struct Electrode
+    {
+        int source;
+        int firstChannel;           // channel of all the spikes, the units following it
+        Array<uint16> unitIds;      // sorted IDs of the units, in the order they appeared
+    };
+
+    struct RateChannel
+    {
+        int source;
+        float carry;                // spikes in the bin still filling up at the end of the last block
+        float rate;                 // smoothed rate of the last bin
+    };
+
+    /** Forgets the spikes counted so far */
+    void resetStates();
+
+    /** Adds a spike to a bin of the block, counted from the first sample of the block */
+    void countSpike (int rateChannel, int bin);
+
+    float binWidth;
+    float timeConstant;
+    int unitsPerElectrode;
+
+    int firstRateChannel;           // buffer index of the first rate channel
+    AudioSampleBuffer* currentBuffer; // the buffer being processed, for handleSpike()
+
+    OwnedArray<RateSource> sources;
+    OwnedArray<Electrode> electrodes;
+    Array<RateChannel> rateChannels;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpikeRate);
+};
+
+
+
+#endif  // SPIKERATE_H_INCLUDED
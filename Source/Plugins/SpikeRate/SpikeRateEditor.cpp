@@ -0,0 +1,151 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "SpikeRateEditor.h"
+#include "SpikeRate.h"
+
+
+SpikeRateEditor::SpikeRateEditor (GenericProcessor* parentNode, bool useDefaultParameterEditors)
+    : GenericEditor (parentNode, useDefaultParameterEditors)
+{
+    desiredWidth = 150;
+
+    // item ids are the values in ms, or the number of units plus one
+    binSelector = addSelector ("Bin (ms):", 25, "Width of the bins, one sample of the rate channels per bin");
+    const int bins[] = { 1, 2, 5, 10, 20, 50, 100 };
+    for (int i = 0; i < numElementsInArray (bins); ++i)
+        binSelector->addItem (String (bins[i]), bins[i]);
+    binSelector->setSelectedId (SPIKERATE_DEFAULT_BIN_MS, dontSendNotification);
+
+    smoothingSelector = addSelector ("Smoothing (ms):", 55, "Time constant of the exponential moving average of the rates");
+    smoothingSelector->addItem ("Off", 1);
+    const int timeConstants[] = { 10, 20, 50, 100, 200, 500, 1000 };
+    for (int i = 0; i < numElementsInArray (timeConstants); ++i)
+        smoothingSelector->addItem (String (timeConstants[i]), timeConstants[i]);
+    smoothingSelector->setSelectedId (1, dontSendNotification);
+
+    unitsSelector = addSelector ("Units:", 85, "Sorted units given a channel on each electrode, besides all its spikes");
+    const int units[] = { 0, 1, 2, 4, 8, 16 };
+    for (int i = 0; i < numElementsInArray (units); ++i)
+        unitsSelector->addItem (String (units[i]), units[i] + 1);
+    unitsSelector->setSelectedId (SPIKERATE_DEFAULT_UNITS + 1, dontSendNotification);
+}
+
+
+SpikeRateEditor::~SpikeRateEditor()
+{
+}
+
+
+ComboBox* SpikeRateEditor::addSelector (const String& name, int y, const String& tooltip)
+{
+    Label* label = labels.add (new Label (name, name));
+    label->setBounds (10, y, 100, 15);
+    label->setFont (Font ("Small Text", 12, Font::plain));
+    label->setColour (Label::textColourId, Colours::darkgrey);
+    addAndMakeVisible (label);
+
+    ComboBox* selector = new ComboBox (name);
+    selector->setBounds (15, y + 15, 120, 18);
+    selector->setTooltip (tooltip);
+    selector->addListener (this);
+    addAndMakeVisible (selector);
+
+    return selector;
+}
+
+
+void SpikeRateEditor::comboBoxChanged (ComboBox* comboBox)
+{
+    if (comboBox == binSelector)
+    {
+        getProcessor()->setParameter (0, float (binSelector->getSelectedId()));
+
+        // the rate channels downstream change rate
+        CoreServices::updateSignalChain (this);
+    }
+    else if (comboBox == smoothingSelector)
+    {
+        const int id = smoothingSelector->getSelectedId();
+        getProcessor()->setParameter (1, id > 1 ? float (id) : 0.0f);
+    }
+    else if (comboBox == unitsSelector)
+    {
+        getProcessor()->setParameter (2, float (unitsSelector->getSelectedId() - 1));
+
+        // the number of rate channels changes
+        CoreServices::updateSignalChain (this);
+    }
+}
+
+
+void SpikeRateEditor::startAcquisition()
+{
+    binSelector->setEnabled (false);
+    unitsSelector->setEnabled (false);
+}
+
+
+void SpikeRateEditor::stopAcquisition()
+{
+    binSelector->setEnabled (true);
+    unitsSelector->setEnabled (true);
+}
+
+
+void SpikeRateEditor::saveCustomParameters (XmlElement* xml)
+{
+    xml->setAttribute ("Type", "SpikeRateEditor");
+
+    XmlElement* values = xml->createNewChildElement ("VALUES");
+    values->setAttribute ("Bin", binSelector->getSelectedId());
+    values->setAttribute ("Smoothing", smoothingSelector->getSelectedId());
+    values->setAttribute ("Units", unitsSelector->getSelectedId() - 1);
+}
+
+
+void SpikeRateEditor::loadCustomParameters (XmlElement* xml)
+{
+    forEachXmlChildElement (*xml, xmlNode)
+    {
+        if (xmlNode->hasTagName ("VALUES"))
+        {
+            // the signal chain is updated once the whole configuration is loaded
+            const int bin = xmlNode->getIntAttribute ("Bin", SPIKERATE_DEFAULT_BIN_MS);
+            binSelector->setSelectedId (binSelector->indexOfItemId (bin) >= 0 ? bin : SPIKERATE_DEFAULT_BIN_MS,
+                                        dontSendNotification);
+            getProcessor()->setParameter (0, float (binSelector->getSelectedId()));
+
+            const int smoothing = xmlNode->getIntAttribute ("Smoothing", 1);
+            smoothingSelector->setSelectedId (smoothingSelector->indexOfItemId (smoothing) >= 0 ? smoothing : 1,
+                                              dontSendNotification);
+            getProcessor()->setParameter (1, smoothingSelector->getSelectedId() > 1 ? float (smoothingSelector->getSelectedId()) : 0.0f);
+
+            const int units = xmlNode->getIntAttribute ("Units", SPIKERATE_DEFAULT_UNITS) + 1;
+            unitsSelector->setSelectedId (unitsSelector->indexOfItemId (units) >= 0 ? units : SPIKERATE_DEFAULT_UNITS + 1,
+                                          dontSendNotification);
+            getProcessor()->setParameter (2, float (unitsSelector->getSelectedId() - 1));
+        }
+    }
+}
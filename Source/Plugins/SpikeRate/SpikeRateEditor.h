@@ -0,0 +1,66 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SPIKERATEEDITOR_H_INCLUDED
+#define SPIKERATEEDITOR_H_INCLUDED
+
+
+#include <EditorHeaders.h>
+
+
+/**
+    User interface for the Spike Rate, choosing the bin width, the smoothing and the number of
+    units per electrode.
+
+    @see SpikeRate
+*/
+class SpikeRateEditor : public GenericEditor
+                      , public ComboBox::Listener
+{
+public:
+    SpikeRateEditor (GenericProcessor* parentNode, bool useDefaultParameterEditors);
+    ~SpikeRateEditor();
+
+    void comboBoxChanged (ComboBox* comboBox) override;
+
+    void startAcquisition() override;
+    void stopAcquisition() override;
+
+    void saveCustomParameters (XmlElement* xml) override;
+    void loadCustomParameters (XmlElement* xml) override;
+
+
+private:
+    /** Adds a label and a combo box below the previous ones */
+    ComboBox* addSelector (const String& name, int y, const String& tooltip);
+
+    OwnedArray<Label>       labels;
+    ScopedPointer<ComboBox> binSelector;
+    ScopedPointer<ComboBox> smoothingSelector;
+    ScopedPointer<ComboBox> unitsSelector;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpikeRateEditor);
+};
+
+
+#endif  // SPIKERATEEDITOR_H_INCLUDED
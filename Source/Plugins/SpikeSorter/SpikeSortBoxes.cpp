@@ -26,6 +26,53 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "SpikeSortBoxes.h"
 #include "SpikeSorter.h"
 
+#if JUCE_INTEL && (defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2))
+ #define SPIKESORTBOXES_SSE 1
+ #include <emmintrin.h>
+#endif
+
+#if JUCE_ARM && defined (__aarch64__)
+ #define SPIKESORTBOXES_NEON 1
+ #include <arm_neon.h>
+#endif
+
+namespace
+{
+    /** Tells whether a channel of a spike stays above or below a box, over the bins it spans */
+    struct BoxRangeTest
+    {
+        const float* data;
+        int channel;
+        int from;
+        int to;
+        float low;
+        float high;
+        bool outside;
+
+        template <int NumChannels, int NumSamples>
+        void visit()
+        {
+            outside = SpikeWaveform<NumChannels, NumSamples>::isOutsideRange(data, channel, from, to, low, high);
+        }
+    };
+
+    /** Projects a spike on the first two principal components */
+    struct PrincipalProjection
+    {
+        const float* data;
+        const float* pc1;
+        const float* pc2;
+        float p1;
+        float p2;
+
+        template <int NumChannels, int NumSamples>
+        void visit()
+        {
+            SpikeWaveform<NumChannels, NumSamples>::project(data, pc1, pc2, p1, p2);
+        }
+    };
+}
+
 PointD::PointD()
 {
     X = Y = 0;
@@ -157,6 +204,13 @@ bool Box::isWaveFormInside(SorterSpikePtr so)
     int BinLeft = microSecondsToSpikeTimeBin(so,x);
     int BinRight = microSecondsToSpikeTimeBin(so,x+w);
 
+    // for the common shapes, a waveform staying above or below the box over these bins can't cross it
+    BoxRangeTest rangeTest = { so->getData(), channel, BinLeft, BinRight, float(y - h), float(y), false };
+
+    if (visitCommonSpikeShape(so->getChannel()->getNumChannels(), so->getChannel()->getTotalSamples(), rangeTest)
+        && rangeTest.outside)
+        return false;
+
     /*
     float minValue=1e10, maxValue=1e-10;
     for (int pt = 0; pt < so->nSamples; pt++)
@@ -446,6 +500,22 @@ void RunningStats::reset()
     hist.reset();
 }
 
+void RunningStats::swap(RunningStats& other)
+{
+    std::swap(LastSpikeTime, other.LastSpikeTime);
+    std::swap(newData, other.newData);
+    std::swap(hist.Max, other.hist.Max);
+    std::swap(hist.t0, other.hist.t0);
+    std::swap(hist.t1, other.hist.t1);
+    hist.Time.swap(other.hist.Time);
+    std::swap(hist.numBins, other.hist.numBins);
+    hist.Counter.swap(other.hist.Counter);
+    WaveFormMean.swap(other.WaveFormMean);
+    WaveFormSk.swap(other.WaveFormSk);
+    WaveFormMk.swap(other.WaveFormMk);
+    std::swap(numSamples, other.numSamples);
+}
+
 Histogram RunningStats::getHistogram()
 {
     return hist;
@@ -612,30 +682,119 @@ SpikeSortBoxes::SpikeSortBoxes(UniqueIDgenerator* uniqueIDgenerator_,PCAcomputin
     numChannels = numch;
     waveformLength = WaveFormLength;
 
+    bHasComponents = false;
+
     pc1 = new float[numChannels * waveformLength];
     pc2 = new float[numChannels * waveformLength];
-    for (int n = 0; n < bufferSize; n++)
+    resetSpikeSums();
+
+    rules = new SortingRules();
+}
+
+void SpikeSortBoxes::publishSortingRules()
+{
+    SortingRules* next = new SortingRules();
+    next->boxUnits = boxUnits;
+    next->pcaUnits = pcaUnits;
+    next->templates = templates;
+    next->templateEnergies = templateEnergies;
+    next->templateUnitIDs = templateUnitIDs;
+
+    // rules published before and not taken yet are never seen
+    delete pendingRules.exchange(next);
+    delete retiredRules.exchange(nullptr);
+}
+
+void SpikeSortBoxes::updateSortingRules()
+{
+    // the rules replaced last time must have been deleted first
+    if (retiredRules.get() != nullptr)
+        return;
+
+    SortingRules* next = pendingRules.exchange(nullptr);
+
+    if (next == nullptr)
+        return;
+
+    SortingRules* previous;
+
     {
+        const SpinLock::ScopedLockType statsScopedLock(statsLock);
+
+        // units keep their mean waveforms across edits
+        for (size_t k = 0; k < next->boxUnits.size(); k++)
+            for (size_t j = 0; j < rules->boxUnits.size(); j++)
+                if (rules->boxUnits[j].getUnitID() == next->boxUnits[k].getUnitID())
+                    next->boxUnits[k].WaveformStat.swap(rules->boxUnits[j].WaveformStat);
+
+        for (size_t k = 0; k < next->pcaUnits.size(); k++)
+            for (size_t j = 0; j < rules->pcaUnits.size(); j++)
+                if (rules->pcaUnits[j].getUnitID() == next->pcaUnits[k].getUnitID())
+                    next->pcaUnits[k].WaveformStat.swap(rules->pcaUnits[j].WaveformStat);
 
+        previous = rules.release();
+        rules = next;
+    }
+
+    retiredRules = previous;
+}
+
+void SpikeSortBoxes::resetSpikeSums()
+{
+    const int dim = numChannels * waveformLength;
+
+    spikeBuffer.clear();
+    for (int n = 0; n < bufferSize; n++)
+    {
         spikeBuffer.add(nullptr);
     }
+
+    spikeSums.calloc(dim);
+    spikeProducts.calloc(dim * dim);
+    numSummedSpikes = 0;
+}
+
+void SpikeSortBoxes::addToSpikeSums(SorterSpikePtr so, double weight)
+{
+    const int dim = numChannels * waveformLength;
+
+    if (so == nullptr || (int) (so->getChannel()->getNumChannels()*so->getChannel()->getTotalSamples()) != dim)
+        return;
+
+    const float* x = so->getData();
+
+    // row by row, so that the inner loop runs over contiguous memory
+    for (int i = 0; i < dim; i++)
+    {
+        const double wx = weight * x[i];
+        double* row = spikeProducts + i * dim;
+
+        spikeSums[i] += wx;
+
+        for (int j = i; j < dim; j++)
+            row[j] += wx * x[j];
+    }
+
+    numSummedSpikes += (weight > 0) ? 1 : -1;
 }
 
 void SpikeSortBoxes::resizeWaveform(int numSamples)
 {
     const ScopedLock myScopedLock(mut);
+    const ScopedRulesUpdate rulesUpdate(*this);
     //StartCriticalSection();
     waveformLength = numSamples;
+    if (currentJob != nullptr)
+        currentJob->cancel();
+    currentJob = nullptr;
     delete[] pc1;
     delete[] pc2;
     pc1 = new float[numChannels * waveformLength];
     pc2 = new float[numChannels * waveformLength];
-    spikeBuffer.clear();
-    for (int n = 0; n < bufferSize; n++)
-    {
-        spikeBuffer.add(nullptr);
-    }
+    resetSpikeSums();
+    clearTemplates();
     bPCAcomputed = false;
+    bHasComponents = false;
     spikeBufferIndex = 0;
     for (int k=0; k<pcaUnits.size(); k++)
     {
@@ -650,108 +809,233 @@ void SpikeSortBoxes::resizeWaveform(int numSamples)
 
 
 
+/** Layout of the SORTING_DATA blob, raised whenever it changes */
+#define SORTING_DATA_VERSION 1
+
 void SpikeSortBoxes::loadCustomParametersFromXml(XmlElement* electrodeNode)
 {
+    const ScopedLock myScopedLock(mut);
+    const ScopedRulesUpdate rulesUpdate(*this);
+
+    XmlElement* spikesortNode = electrodeNode->getChildByName("SPIKESORTING");
+
+    if (spikesortNode == nullptr)
+        return;
+
+    //int numBoxUnit  = spikesortNode->getIntAttribute("numBoxUnits");
+    //int numPCAUnit  = spikesortNode->getIntAttribute("numPCAUnits");
+    selectedUnit  = spikesortNode->getIntAttribute("selectedUnit");
+    selectedBox =  spikesortNode->getIntAttribute("selectedBox");
+
+    pcaUnits.clear();
+    boxUnits.clear();
+    clearTemplates();
+
+    // the PCA is saved next to SPIKESORTING, though it was once looked for within it
+    XmlElement* pcaNode = electrodeNode->getChildByName("PCA");
+
+    if (pcaNode == nullptr)
+        pcaNode = spikesortNode->getChildByName("PCA");
+
+    if (pcaNode != nullptr)
+    {
+        numChannels = pcaNode->getIntAttribute("numChannels");
+        waveformLength = pcaNode->getIntAttribute("waveformLength");
+
+        pc1min = pcaNode->getDoubleAttribute("pc1min");
+        pc2min = pcaNode->getDoubleAttribute("pc2min");
+        pc1max = pcaNode->getDoubleAttribute("pc1max");
+        pc2max = pcaNode->getDoubleAttribute("pc2max");
+
+        bPCAjobFinished = pcaNode->getBoolAttribute("PCAjobFinished");
+        bPCAcomputed = pcaNode->getBoolAttribute("PCAcomputed");
+        bHasComponents = bPCAcomputed;
+
+        if (currentJob != nullptr)
+            currentJob->cancel();
+        currentJob = nullptr;
+        resetSpikeSums();
+
+        delete[] pc1;
+        delete[] pc2;
+
+        pc1 = new float[waveformLength*numChannels]();
+        pc2 = new float[waveformLength*numChannels]();
+    }
+
+    if (! loadSortingData(spikesortNode))
+        loadSortingXml(spikesortNode, pcaNode);
+}
+
+bool SpikeSortBoxes::loadSortingData(const XmlElement* spikesortNode)
+{
+    SettingsBlobReader blob(spikesortNode, "SORTING_DATA", SORTING_DATA_VERSION);
+
+    if (! blob.isValid())
+        return false;
+
+    MemoryInputStream& in = blob.getStream();
+    const int dim = numChannels * waveformLength;
+
+    // everything is read before anything is replaced, in case the blob turns out damaged
+    const int numComponents = blob.readCount(2 * sizeof(float));
+    std::vector<float> components(2 * numComponents);
+    blob.readFloats(components.data(), 2 * numComponents);
 
-    forEachXmlChildElement(*electrodeNode, spikesortNode)
+    std::vector<BoxUnit> loadedBoxUnits(blob.readCount(2 * sizeof(int) + 3));
+
+    for (size_t k = 0; k < loadedBoxUnits.size(); k++)
     {
-        if (spikesortNode->hasTagName("SPIKESORTING"))
+        BoxUnit& boxUnit = loadedBoxUnits[k];
+        boxUnit.UnitID = in.readInt();
+
+        for (int c = 0; c < 3; c++)
+            boxUnit.ColorRGB[c] = (uint8_t) in.readByte();
+
+        boxUnit.lstBoxes.resize(blob.readCount(sizeof(int) + 4 * sizeof(double)));
+
+        for (size_t b = 0; b < boxUnit.lstBoxes.size(); b++)
         {
-            //int numBoxUnit  = spikesortNode->getIntAttribute("numBoxUnits");
-            //int numPCAUnit  = spikesortNode->getIntAttribute("numPCAUnits");
-            selectedUnit  = spikesortNode->getIntAttribute("selectedUnit");
-            selectedBox =  spikesortNode->getIntAttribute("selectedBox");
+            Box& box = boxUnit.lstBoxes[b];
+            box.channel = in.readInt();
+            box.x = in.readDouble();
+            box.y = in.readDouble();
+            box.w = in.readDouble();
+            box.h = in.readDouble();
+        }
+    }
 
+    std::vector<PCAUnit> loadedPCAUnits(blob.readCount(2 * sizeof(int) + 3 + 2 * sizeof(float)));
 
-            pcaUnits.clear();
-            boxUnits.clear();
+    for (size_t k = 0; k < loadedPCAUnits.size(); k++)
+    {
+        PCAUnit& pcaUnit = loadedPCAUnits[k];
+        pcaUnit.UnitID = in.readInt();
 
-            forEachXmlChildElement(*spikesortNode, UnitNode)
-            {
-                if (UnitNode->hasTagName("PCA"))
-                {
-                    numChannels = UnitNode->getIntAttribute("numChannels");
-                    waveformLength = UnitNode->getIntAttribute("waveformLength");
+        for (int c = 0; c < 3; c++)
+            pcaUnit.ColorRGB[c] = (uint8_t) in.readByte();
 
-                    pc1min = UnitNode->getDoubleAttribute("pc1min");
-                    pc2min = UnitNode->getDoubleAttribute("pc2min");
-                    pc1max = UnitNode->getDoubleAttribute("pc1max");
-                    pc2max = UnitNode->getDoubleAttribute("pc2max");
+        pcaUnit.poly.offset.X = in.readFloat();
+        pcaUnit.poly.offset.Y = in.readFloat();
+        pcaUnit.poly.pts.resize(blob.readCount(2 * sizeof(float)));
 
-                    bPCAjobFinished = UnitNode->getBoolAttribute("PCAjobFinished");
-                    bPCAcomputed = UnitNode->getBoolAttribute("PCAcomputed");
+        for (size_t p = 0; p < pcaUnit.poly.pts.size(); p++)
+        {
+            pcaUnit.poly.pts[p].X = in.readFloat();
+            pcaUnit.poly.pts[p].Y = in.readFloat();
+        }
+    }
 
-                    delete[] pc1;
-                    delete[] pc2;
+    const int numTemplates = blob.readCount(sizeof(int) + dim * sizeof(float));
+    std::vector<int> loadedTemplateIDs(numTemplates);
+    std::vector<float> loadedTemplates((size_t) numTemplates * dim);
 
-                    pc1 = new float[waveformLength*numChannels];
-                    pc2 = new float[waveformLength*numChannels];
-                    int dimcounter = 0;
-                    forEachXmlChildElement(*UnitNode, dimNode)
-                    {
-                        if (dimNode->hasTagName("PCA_DIM"))
-                        {
-                            pc1[dimcounter]=dimNode->getDoubleAttribute("pc1");
-                            pc2[dimcounter]=dimNode->getDoubleAttribute("pc2");
-                            dimcounter++;
-                        }
-                    }
-                }
+    for (int k = 0; k < numTemplates; k++)
+    {
+        loadedTemplateIDs[k] = in.readInt();
+        blob.readFloats(loadedTemplates.data() + (size_t) k * dim, dim);
+    }
+
+    if (! blob.isValid() || numComponents != dim)
+        return false;
+
+    std::copy(components.begin(), components.begin() + dim, pc1);
+    std::copy(components.begin() + dim, components.end(), pc2);
+
+    boxUnits = loadedBoxUnits;
+    pcaUnits = loadedPCAUnits;
+
+    for (int k = 0; k < numTemplates; k++)
+        addTemplate(loadedTemplateIDs[k], loadedTemplates.data() + (size_t) k * dim);
+
+    return true;
+}
+
+void SpikeSortBoxes::loadSortingXml(const XmlElement* spikesortNode, const XmlElement* pcaNode)
+{
+    if (pcaNode != nullptr)
+    {
+        int dimcounter = 0;
+        forEachXmlChildElementWithTagName(*pcaNode, dimNode, "PCA_DIM")
+        {
+            if (dimcounter == waveformLength*numChannels)
+                break;
+
+            pc1[dimcounter]=dimNode->getDoubleAttribute("pc1");
+            pc2[dimcounter]=dimNode->getDoubleAttribute("pc2");
+            dimcounter++;
+        }
+    }
 
-                if (UnitNode->hasTagName("BOXUNIT"))
+    forEachXmlChildElement(*spikesortNode, UnitNode)
+    {
+        if (UnitNode->hasTagName("BOXUNIT"))
+        {
+            BoxUnit boxUnit;
+            boxUnit.UnitID = UnitNode->getIntAttribute("UnitID");
+            boxUnit.ColorRGB[0] = UnitNode->getIntAttribute("ColorR");
+            boxUnit.ColorRGB[1] = UnitNode->getIntAttribute("ColorG");
+            boxUnit.ColorRGB[2] = UnitNode->getIntAttribute("ColorB");
+            int numBoxes = UnitNode->getIntAttribute("NumBoxes");
+            boxUnit.lstBoxes.resize(numBoxes);
+            int boxCounter = 0;
+            forEachXmlChildElement(*UnitNode, boxNode)
+            {
+                if (boxNode->hasTagName("BOX") && boxCounter < numBoxes)
                 {
-                    BoxUnit boxUnit;
-                    boxUnit.UnitID = UnitNode->getIntAttribute("UnitID");
-                    boxUnit.ColorRGB[0] = UnitNode->getIntAttribute("ColorR");
-                    boxUnit.ColorRGB[1] = UnitNode->getIntAttribute("ColorG");
-                    boxUnit.ColorRGB[2] = UnitNode->getIntAttribute("ColorB");
-                    int numBoxes = UnitNode->getIntAttribute("NumBoxes");
-                    boxUnit.lstBoxes.resize(numBoxes);
-                    int boxCounter = 0;
-                    forEachXmlChildElement(*UnitNode, boxNode)
-                    {
-                        if (boxNode->hasTagName("BOX"))
-                        {
-                            Box box;
-                            box.channel = boxNode->getIntAttribute("ch");
-                            box.x = boxNode->getDoubleAttribute("x");
-                            box.y = boxNode->getDoubleAttribute("y");
-                            box.w = boxNode->getDoubleAttribute("w");
-                            box.h = boxNode->getDoubleAttribute("h");
-                            boxUnit.lstBoxes[boxCounter++] = box;
-                        }
-                    }
-                    // add box unit
-                    boxUnits.push_back(boxUnit);
+                    Box box;
+                    box.channel = boxNode->getIntAttribute("ch");
+                    box.x = boxNode->getDoubleAttribute("x");
+                    box.y = boxNode->getDoubleAttribute("y");
+                    box.w = boxNode->getDoubleAttribute("w");
+                    box.h = boxNode->getDoubleAttribute("h");
+                    boxUnit.lstBoxes[boxCounter++] = box;
                 }
-                if (UnitNode->hasTagName("PCAUNIT"))
+            }
+            // add box unit
+            boxUnits.push_back(boxUnit);
+        }
+        if (UnitNode->hasTagName("PCAUNIT"))
+        {
+            PCAUnit pcaUnit;
+
+            pcaUnit.UnitID = UnitNode->getIntAttribute("UnitID");
+            pcaUnit.ColorRGB[0] = UnitNode->getIntAttribute("ColorR");
+            pcaUnit.ColorRGB[1] = UnitNode->getIntAttribute("ColorG");
+            pcaUnit.ColorRGB[2] = UnitNode->getIntAttribute("ColorB");
+
+            int numPolygonPoints = UnitNode->getIntAttribute("PolygonNumPoints");
+            pcaUnit.poly.pts.resize(numPolygonPoints);
+            pcaUnit.poly.offset.X = UnitNode->getDoubleAttribute("PolygonOffsetX");
+            pcaUnit.poly.offset.Y = UnitNode->getDoubleAttribute("PolygonOffsetY");
+            // read polygon
+            int pointCounter = 0;
+            forEachXmlChildElement(*UnitNode, polygonPoint)
+            {
+                if (polygonPoint->hasTagName("POLYGON_POINT") && pointCounter < numPolygonPoints)
                 {
-                    PCAUnit pcaUnit;
-
-                    pcaUnit.UnitID = UnitNode->getIntAttribute("UnitID");
-                    pcaUnit.ColorRGB[0] = UnitNode->getIntAttribute("ColorR");
-                    pcaUnit.ColorRGB[1] = UnitNode->getIntAttribute("ColorG");
-                    pcaUnit.ColorRGB[2] = UnitNode->getIntAttribute("ColorB");
-
-                    int numPolygonPoints = UnitNode->getIntAttribute("PolygonNumPoints");
-                    pcaUnit.poly.pts.resize(numPolygonPoints);
-                    pcaUnit.poly.offset.X = UnitNode->getDoubleAttribute("PolygonOffsetX");
-                    pcaUnit.poly.offset.Y = UnitNode->getDoubleAttribute("PolygonOffsetY");
-                    // read polygon
-                    int pointCounter = 0;
-                    forEachXmlChildElement(*UnitNode, polygonPoint)
-                    {
-                        if (polygonPoint->hasTagName("POLYGON_POINT"))
-                        {
-                            pcaUnit.poly.pts[pointCounter].X =  polygonPoint->getDoubleAttribute("pointX");
-                            pcaUnit.poly.pts[pointCounter].Y =  polygonPoint->getDoubleAttribute("pointY");
-                            pointCounter++;
-                        }
-                    }
-                    // add polygon unit
-                    pcaUnits.push_back(pcaUnit);
+                    pcaUnit.poly.pts[pointCounter].X =  polygonPoint->getDoubleAttribute("pointX");
+                    pcaUnit.poly.pts[pointCounter].Y =  polygonPoint->getDoubleAttribute("pointY");
+                    pointCounter++;
                 }
             }
+            // add polygon unit
+            pcaUnits.push_back(pcaUnit);
+        }
+        if (UnitNode->hasTagName("TEMPLATE"))
+        {
+            StringArray values;
+            values.addTokens(UnitNode->getStringAttribute("values"), " ", String());
+            values.removeEmptyStrings();
+
+            if (values.size() == numChannels * waveformLength)
+            {
+                std::vector<float> waveform(values.size());
+                for (int k = 0; k < values.size(); k++)
+                    waveform[k] = values[k].getFloatValue();
+
+                addTemplate(UnitNode->getIntAttribute("UnitID"), &waveform[0]);
+            }
         }
     }
 }
@@ -762,6 +1046,7 @@ void SpikeSortBoxes::saveCustomParametersToXml(XmlElement* electrodeNode)
     XmlElement* spikesortNode = electrodeNode->createNewChildElement("SPIKESORTING");
     spikesortNode->setAttribute("numBoxUnits", (int)boxUnits.size());
     spikesortNode->setAttribute("numPCAUnits", (int)pcaUnits.size());
+    spikesortNode->setAttribute("numTemplates", (int)templateUnitIDs.size());
     spikesortNode->setAttribute("selectedUnit",selectedUnit);
     spikesortNode->setAttribute("selectedBox",selectedBox);
 
@@ -777,62 +1062,78 @@ void SpikeSortBoxes::saveCustomParametersToXml(XmlElement* electrodeNode)
     pcaNode->setAttribute("PCAjobFinished", bPCAjobFinished);
     pcaNode->setAttribute("PCAcomputed", bPCAcomputed);
 
-    for (int k=0; k<numChannels*waveformLength; k++)
-    {
-        XmlElement* dimNode = pcaNode->createNewChildElement("PCA_DIM");
-        dimNode->setAttribute("pc1",pc1[k]);
-        dimNode->setAttribute("pc2",pc2[k]);
-    }
+    // the components, boxes, polygons and templates, which were once an element each
+    SettingsBlobWriter blob(SORTING_DATA_VERSION);
+    MemoryOutputStream& out = blob.getStream();
+    const int dim = numChannels * waveformLength;
+
+    out.writeInt(dim);
+    blob.writeFloats(pc1, dim);
+    blob.writeFloats(pc2, dim);
+
+    out.writeInt((int)boxUnits.size());
 
     for (int boxUnitIter=0; boxUnitIter<boxUnits.size(); boxUnitIter++)
     {
-        XmlElement* BoxUnitNode = spikesortNode->createNewChildElement("BOXUNIT");
+        const BoxUnit& boxUnit = boxUnits[boxUnitIter];
+
+        out.writeInt(boxUnit.UnitID);
+        for (int c = 0; c < 3; c++)
+            out.writeByte((char) boxUnit.ColorRGB[c]);
 
-        BoxUnitNode->setAttribute("UnitID",boxUnits[boxUnitIter].UnitID);
-        BoxUnitNode->setAttribute("ColorR",boxUnits[boxUnitIter].ColorRGB[0]);
-        BoxUnitNode->setAttribute("ColorG",boxUnits[boxUnitIter].ColorRGB[1]);
-        BoxUnitNode->setAttribute("ColorB",boxUnits[boxUnitIter].ColorRGB[2]);
-        BoxUnitNode->setAttribute("NumBoxes", (int)boxUnits[boxUnitIter].lstBoxes.size());
-        for (int boxIter=0; boxIter<boxUnits[boxUnitIter].lstBoxes.size(); boxIter++)
+        out.writeInt((int)boxUnit.lstBoxes.size());
+        for (size_t boxIter=0; boxIter<boxUnit.lstBoxes.size(); boxIter++)
         {
-            XmlElement* BoxNode = BoxUnitNode->createNewChildElement("BOX");
-            BoxNode->setAttribute("ch", (int)boxUnits[boxUnitIter].lstBoxes[boxIter].channel);
-            BoxNode->setAttribute("x", (int)boxUnits[boxUnitIter].lstBoxes[boxIter].x);
-            BoxNode->setAttribute("y", (int)boxUnits[boxUnitIter].lstBoxes[boxIter].y);
-            BoxNode->setAttribute("w", (int)boxUnits[boxUnitIter].lstBoxes[boxIter].w);
-            BoxNode->setAttribute("h", (int)boxUnits[boxUnitIter].lstBoxes[boxIter].h);
+            const Box& box = boxUnit.lstBoxes[boxIter];
+            out.writeInt(box.channel);
+            out.writeDouble(box.x);
+            out.writeDouble(box.y);
+            out.writeDouble(box.w);
+            out.writeDouble(box.h);
         }
     }
 
+    out.writeInt((int)pcaUnits.size());
+
     for (int pcaUnitIter=0; pcaUnitIter<pcaUnits.size(); pcaUnitIter++)
     {
-        XmlElement* PcaUnitNode = spikesortNode->createNewChildElement("PCAUNIT");
+        const PCAUnit& pcaUnit = pcaUnits[pcaUnitIter];
+
+        out.writeInt(pcaUnit.UnitID);
+        for (int c = 0; c < 3; c++)
+            out.writeByte((char) pcaUnit.ColorRGB[c]);
 
-        PcaUnitNode->setAttribute("UnitID",pcaUnits[pcaUnitIter].UnitID);
-        PcaUnitNode->setAttribute("ColorR",pcaUnits[pcaUnitIter].ColorRGB[0]);
-        PcaUnitNode->setAttribute("ColorG",pcaUnits[pcaUnitIter].ColorRGB[1]);
-        PcaUnitNode->setAttribute("ColorB",pcaUnits[pcaUnitIter].ColorRGB[2]);
-        PcaUnitNode->setAttribute("PolygonNumPoints",(int)pcaUnits[pcaUnitIter].poly.pts.size());
-        PcaUnitNode->setAttribute("PolygonOffsetX",(int)pcaUnits[pcaUnitIter].poly.offset.X);
-        PcaUnitNode->setAttribute("PolygonOffsetY",(int)pcaUnits[pcaUnitIter].poly.offset.Y);
+        out.writeFloat(pcaUnit.poly.offset.X);
+        out.writeFloat(pcaUnit.poly.offset.Y);
 
-        for (int p=0; p<pcaUnits[pcaUnitIter].poly.pts.size(); p++)
+        out.writeInt((int)pcaUnit.poly.pts.size());
+        for (size_t p=0; p<pcaUnit.poly.pts.size(); p++)
         {
-            XmlElement* PolygonNode = PcaUnitNode->createNewChildElement("POLYGON_POINT");
-            PolygonNode->setAttribute("pointX", pcaUnits[pcaUnitIter].poly.pts[p].X);
-            PolygonNode->setAttribute("pointY", pcaUnits[pcaUnitIter].poly.pts[p].Y);
+            out.writeFloat(pcaUnit.poly.pts[p].X);
+            out.writeFloat(pcaUnit.poly.pts[p].Y);
         }
     }
 
+    out.writeInt((int)templateUnitIDs.size());
 
-    //float *pc1, *pc2;
-
+    for (size_t templateIter=0; templateIter<templateUnitIDs.size(); templateIter++)
+    {
+        out.writeInt(templateUnitIDs[templateIter]);
+        blob.writeFloats(&templates[templateIter * dim], dim);
+    }
 
+    blob.addTo(spikesortNode, "SORTING_DATA");
 }
 
 SpikeSortBoxes::~SpikeSortBoxes()
 {
-    // wait until PCA job is done (if one was submitted).
+    // keep a PCA job still running from writing into the components
+    if (currentJob != nullptr)
+        currentJob->cancel();
+
+    delete pendingRules.get();
+    delete retiredRules.get();
+
     delete[] pc1;
     delete[] pc2;
     pc1 = nullptr;
@@ -855,20 +1156,36 @@ void SpikeSortBoxes::projectOnPrincipalComponents(SorterSpikePtr so)
 {
     spikeBufferIndex++;
     spikeBufferIndex %= bufferSize;
+
+    // the sums follow the spikes in the buffer
+    addToSpikeSums(spikeBuffer[spikeBufferIndex], -1.0);
+    addToSpikeSums(so, 1.0);
+
     spikeBuffer.set(spikeBufferIndex, so);
     if (bPCAjobFinished)
     {
         bPCAcomputed = true;
+        bHasComponents = true;
     }
 
     if (bPCAcomputed)
     {
-        so->pcProj[0] = so->pcProj[1] = 0;
-        for (int k=0; k<so->getChannel()->getNumChannels()*so->getChannel()->getTotalSamples(); k++)
+        PrincipalProjection projection = { so->getData(), pc1, pc2, 0, 0 };
+
+        if (visitCommonSpikeShape(so->getChannel()->getNumChannels(), so->getChannel()->getTotalSamples(), projection))
+        {
+            so->pcProj[0] = projection.p1;
+            so->pcProj[1] = projection.p2;
+        }
+        else
         {
-            float v = spikeDataIndexToMicrovolts(so, k);
-            so->pcProj[0] += pc1[k]* v;
-            so->pcProj[1] += pc2[k]* v;
+            so->pcProj[0] = so->pcProj[1] = 0;
+            for (int k=0; k<(int) (so->getChannel()->getNumChannels()*so->getChannel()->getTotalSamples()); k++)
+            {
+                float v = spikeDataIndexToMicrovolts(so, k);
+                so->pcProj[0] += pc1[k]* v;
+                so->pcProj[1] += pc2[k]* v;
+            }
         }
         if (so->pcProj[0] > 1e5 || so->pcProj[0] < -1e5 || so->pcProj[1] > 1e5 || so->pcProj[1] < -1e5)
         {
@@ -885,8 +1202,9 @@ void SpikeSortBoxes::projectOnPrincipalComponents(SorterSpikePtr so)
 	    bPCAcomputed = false;
             bRePCA = false;
             // submit a new job to compute the spike buffer.
-            PCAJobPtr job = new PCAjob(spikeBuffer,pc1,pc2, pc1min, pc2min, pc1max, pc2max, bPCAjobFinished);
-            computingThread->addPCAjob(job);
+            currentJob = new PCAjob(spikeBuffer, spikeSums, spikeProducts, numSummedSpikes, numChannels * waveformLength,
+                                    pc1, pc2, bHasComponents, pc1min, pc2min, pc1max, pc2max, bPCAjobFinished);
+            computingThread->addPCAjob(currentJob);
         }
     }
 }
@@ -927,6 +1245,7 @@ void SpikeSortBoxes::RePCA()
 void SpikeSortBoxes::addPCAunit(PCAUnit unit)
 {
     const ScopedLock myScopedLock(mut);
+    const ScopedRulesUpdate rulesUpdate(*this);
     //StartCriticalSection();
     pcaUnits.push_back(unit);
     //EndCriticalSection();
@@ -937,6 +1256,7 @@ void SpikeSortBoxes::addPCAunit(PCAUnit unit)
 int SpikeSortBoxes::addBoxUnit(int channel)
 {
     const ScopedLock myScopedLock(mut);
+    const ScopedRulesUpdate rulesUpdate(*this);
     //StartCriticalSection();
     int unusedID = uniqueIDgenerator->generateUniqueID(); //generateUnitID();
     BoxUnit unit(unusedID, generateLocalID());
@@ -959,6 +1279,7 @@ void  SpikeSortBoxes::EndCriticalSection()
 int SpikeSortBoxes::addBoxUnit(int channel, Box B)
 {
     const ScopedLock myScopedLock(mut);
+    const ScopedRulesUpdate rulesUpdate(*this);
     //StartCriticalSection();
     int unusedID = uniqueIDgenerator->generateUniqueID(); //generateUnitID();
     BoxUnit unit(B, unusedID,generateLocalID());
@@ -1037,6 +1358,7 @@ int SpikeSortBoxes::generateUnitID()
 void SpikeSortBoxes::generateNewIDs()
 {
     const ScopedLock myScopedLock(mut);
+    const ScopedRulesUpdate rulesUpdate(*this);
     for (int k=0; k<boxUnits.size(); k++)
     {
         boxUnits[k].UnitID = generateUnitID();
@@ -1050,19 +1372,23 @@ void SpikeSortBoxes::generateNewIDs()
 void SpikeSortBoxes::removeAllUnits()
 {
     const ScopedLock myScopedLock(mut);
+    const ScopedRulesUpdate rulesUpdate(*this);
     boxUnits.clear();
     pcaUnits.clear();
+    clearTemplates();
 }
 
 bool SpikeSortBoxes::removeUnit(int unitID)
 {
     const ScopedLock myScopedLock(mut);
+    const ScopedRulesUpdate rulesUpdate(*this);
     //StartCriticalSection();
     for (int k=0; k<boxUnits.size(); k++)
     {
         if (boxUnits[k].getUnitID() == unitID)
         {
             boxUnits.erase(boxUnits.begin()+k);
+            pruneTemplates();
             //EndCriticalSection();
             return true;
         }
@@ -1073,6 +1399,7 @@ bool SpikeSortBoxes::removeUnit(int unitID)
         if (pcaUnits[k].getUnitID() == unitID)
         {
             pcaUnits.erase(pcaUnits.begin()+k);
+            pruneTemplates();
             //EndCriticalSection();
             return true;
         }
@@ -1086,6 +1413,7 @@ bool SpikeSortBoxes::removeUnit(int unitID)
 bool SpikeSortBoxes::addBoxToUnit(int channel, int unitID)
 {
     const ScopedLock myScopedLock(mut);
+    const ScopedRulesUpdate rulesUpdate(*this);
 
     //StartCriticalSection();
 
@@ -1111,6 +1439,7 @@ bool SpikeSortBoxes::addBoxToUnit(int channel, int unitID)
 bool SpikeSortBoxes::addBoxToUnit(int channel, int unitID, Box B)
 {
     const ScopedLock myScopedLock(mut);
+    const ScopedRulesUpdate rulesUpdate(*this);
     //StartCriticalSection();
     for (int k=0; k<boxUnits.size(); k++)
     {
@@ -1148,15 +1477,19 @@ void SpikeSortBoxes::updatePCAUnits(std::vector<PCAUnit> _units)
 {
     //StartCriticalSection();
     const ScopedLock myScopedLock(mut);
+    const ScopedRulesUpdate rulesUpdate(*this);
     pcaUnits = _units;
+    pruneTemplates();
     //EndCriticalSection();
 }
 
 void SpikeSortBoxes::updateBoxUnits(std::vector<BoxUnit> _units)
 {
     const ScopedLock myScopedLock(mut);
+    const ScopedRulesUpdate rulesUpdate(*this);
     //StartCriticalSection();
     boxUnits = _units;
+    pruneTemplates();
     //EndCriticalSection();
 }
 
@@ -1166,7 +1499,10 @@ void SpikeSortBoxes::updateBoxUnits(std::vector<BoxUnit> _units)
 // tests whether a candidate spike belongs to one of the defined units
 bool SpikeSortBoxes::sortSpike(SorterSpikePtr so, bool PCAfirst)
 {
-    const ScopedLock myScopedLock(mut);
+    // sorted with the units as last published, without waiting for an edit to finish
+    std::vector<BoxUnit>& boxUnits = rules->boxUnits;
+    std::vector<PCAUnit>& pcaUnits = rules->pcaUnits;
+
     if (PCAfirst)
     {
 
@@ -1190,6 +1526,7 @@ bool SpikeSortBoxes::sortSpike(SorterSpikePtr so, bool PCAfirst)
                 so->color[0] = boxUnits[k].ColorRGB[0];
                 so->color[1] = boxUnits[k].ColorRGB[1];
                 so->color[2] = boxUnits[k].ColorRGB[2];
+                const SpinLock::ScopedLockType statsScopedLock(statsLock);
                 boxUnits[k].updateWaveform(so);
                 return true;
             }
@@ -1206,6 +1543,7 @@ bool SpikeSortBoxes::sortSpike(SorterSpikePtr so, bool PCAfirst)
                 so->color[0] = boxUnits[k].ColorRGB[0];
                 so->color[1] = boxUnits[k].ColorRGB[1];
                 so->color[2] = boxUnits[k].ColorRGB[2];
+                const SpinLock::ScopedLockType statsScopedLock(statsLock);
                 boxUnits[k].updateWaveform(so);
                 return true;
             }
@@ -1218,6 +1556,7 @@ bool SpikeSortBoxes::sortSpike(SorterSpikePtr so, bool PCAfirst)
                 so->color[0] = pcaUnits[k].ColorRGB[0];
                 so->color[1] = pcaUnits[k].ColorRGB[1];
                 so->color[2] = pcaUnits[k].ColorRGB[2];
+                const SpinLock::ScopedLockType statsScopedLock(statsLock);
                 pcaUnits[k].updateWaveform(so);
                 return true;
             }
@@ -1229,9 +1568,306 @@ bool SpikeSortBoxes::sortSpike(SorterSpikePtr so, bool PCAfirst)
 }
 
 
+namespace
+{
+    /** Dot product of two waveforms, four products at a time where possible */
+    float waveformDotProduct(const float* a, const float* b, int n)
+    {
+        int k = 0;
+        float sum = 0;
+
+       #if SPIKESORTBOXES_SSE
+        __m128 acc = _mm_setzero_ps();
+
+        for (; k + 4 <= n; k += 4)
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + k), _mm_loadu_ps(b + k)));
+
+        acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+        acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+        sum = _mm_cvtss_f32(acc);
+       #elif SPIKESORTBOXES_NEON
+        float32x4_t acc = vdupq_n_f32(0);
+
+        for (; k + 4 <= n; k += 4)
+            acc = vmlaq_f32(acc, vld1q_f32(a + k), vld1q_f32(b + k));
+
+        sum = vaddvq_f32(acc);
+       #endif
+
+        for (; k < n; k++)
+            sum += a[k] * b[k];
+
+        return sum;
+    }
+
+    /** The runtime-sized dot product, for the shapes without a SpikeWaveform */
+    struct WaveformDotProduct
+    {
+        int n;
+
+        float operator()(const float* a, const float* b) const
+        {
+            return waveformDotProduct(a, b, n);
+        }
+    };
+
+    /** Finds the template closest to a spike, |x - t|^2 being |x|^2 - 2 x.t + |t|^2, the
+        templates being read one after the other */
+    struct TemplateMatch
+    {
+        const float* x;
+        const float* templates;
+        const float* energies;
+        int numTemplates;
+        int dim;
+        float bestDistance;
+        int best;
+
+        template <typename DotProduct>
+        void match(DotProduct dot)
+        {
+            const float energy = dot(x, x);
+
+            for (int k = 0; k < numTemplates; k++)
+            {
+                const float distance = energy - 2 * dot(x, templates + k * dim) + energies[k];
+
+                if (distance <= bestDistance)
+                {
+                    bestDistance = distance;
+                    best = k;
+                }
+            }
+        }
+
+        template <int NumChannels, int NumSamples>
+        void visit()
+        {
+            match(&SpikeWaveform<NumChannels, NumSamples>::dot);
+        }
+    };
+}
+
+// matches a spike against the templates of all the units of the electrode
+bool SpikeSortBoxes::sortSpikeByTemplates(SorterSpikePtr so, float rejectionRMS)
+{
+    // matched with the templates as last published, without waiting for an edit to finish
+    const std::vector<float>& templates = rules->templates;
+    const std::vector<float>& templateEnergies = rules->templateEnergies;
+    const std::vector<int>& templateUnitIDs = rules->templateUnitIDs;
+    std::vector<BoxUnit>& boxUnits = rules->boxUnits;
+    std::vector<PCAUnit>& pcaUnits = rules->pcaUnits;
+
+    const int dim = numChannels * waveformLength;
+    const int numTemplates = (int) templateUnitIDs.size();
+
+    if (numTemplates == 0 || (int) (so->getChannel()->getNumChannels()*so->getChannel()->getTotalSamples()) != dim)
+        return false;
+
+    TemplateMatch templateMatch = { so->getData(), &templates[0], &templateEnergies[0], numTemplates, dim,
+                                    rejectionRMS * rejectionRMS * dim, -1 };
+
+    if (!visitCommonSpikeShape(numChannels, waveformLength, templateMatch))
+    {
+        WaveformDotProduct dot = { dim };
+        templateMatch.match(dot);
+    }
+
+    const int best = templateMatch.best;
+
+    if (best < 0)
+        return false;
+
+    const int unitID = templateUnitIDs[best];
+
+    for (size_t k=0; k<boxUnits.size(); k++)
+    {
+        if (boxUnits[k].getUnitID() == unitID)
+        {
+            so->sortedId = unitID;
+            so->color[0] = boxUnits[k].ColorRGB[0];
+            so->color[1] = boxUnits[k].ColorRGB[1];
+            so->color[2] = boxUnits[k].ColorRGB[2];
+            const SpinLock::ScopedLockType statsScopedLock(statsLock);
+            boxUnits[k].updateWaveform(so);
+            return true;
+        }
+    }
+
+    for (size_t k=0; k<pcaUnits.size(); k++)
+    {
+        if (pcaUnits[k].getUnitID() == unitID)
+        {
+            so->sortedId = unitID;
+            so->color[0] = pcaUnits[k].ColorRGB[0];
+            so->color[1] = pcaUnits[k].ColorRGB[1];
+            so->color[2] = pcaUnits[k].ColorRGB[2];
+            const SpinLock::ScopedLockType statsScopedLock(statsLock);
+            pcaUnits[k].updateWaveform(so);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int SpikeSortBoxes::learnTemplates(int minSpikes)
+{
+    const ScopedLock myScopedLock(mut);
+    const ScopedRulesUpdate rulesUpdate(*this);
+
+    clearTemplates();
+
+    // the mean waveforms are those of the units the spikes are sorted with
+    const SpinLock::ScopedLockType statsScopedLock(statsLock);
+
+    std::vector<RunningStats*> stats;
+    std::vector<int> unitIDs;
+
+    for (size_t k=0; k<rules->boxUnits.size(); k++)
+    {
+        stats.push_back(&rules->boxUnits[k].WaveformStat);
+        unitIDs.push_back(rules->boxUnits[k].getUnitID());
+    }
+
+    for (size_t k=0; k<rules->pcaUnits.size(); k++)
+    {
+        stats.push_back(&rules->pcaUnits[k].WaveformStat);
+        unitIDs.push_back(rules->pcaUnits[k].getUnitID());
+    }
+
+    std::vector<float> waveform(numChannels * waveformLength);
+
+    for (size_t u = 0; u < stats.size(); u++)
+    {
+        const RunningStats& stat = *stats[u];
+
+        if (stat.numSamples < minSpikes || stat.WaveFormMean.size() != (size_t) numChannels
+            || stat.WaveFormMean[0].size() != (size_t) waveformLength)
+            continue;
+
+        for (int ch = 0; ch < numChannels; ch++)
+            for (int j = 0; j < waveformLength; j++)
+                waveform[j + ch*waveformLength] = (float) stat.WaveFormMean[ch][j];
+
+        addTemplate(unitIDs[u], &waveform[0]);
+    }
+
+    // units removed since the last edit was taken have none
+    pruneTemplates();
+
+    return (int) templateUnitIDs.size();
+}
+
+bool SpikeSortBoxes::setUnitTemplate(int unitID, const std::vector<float>& waveform)
+{
+    const ScopedLock myScopedLock(mut);
+    const ScopedRulesUpdate rulesUpdate(*this);
+
+    if (waveform.size() != (size_t) (numChannels * waveformLength))
+        return false;
+
+    bool found = false;
+
+    for (size_t k=0; k<boxUnits.size(); k++)
+        found = found || boxUnits[k].getUnitID() == unitID;
+
+    for (size_t k=0; k<pcaUnits.size(); k++)
+        found = found || pcaUnits[k].getUnitID() == unitID;
+
+    if (! found)
+        return false;
+
+    addTemplate(unitID, &waveform[0]);
+    return true;
+}
+
+void SpikeSortBoxes::addTemplate(int unitID, const float* waveform)
+{
+    const int dim = numChannels * waveformLength;
+
+    // a unit has a single template
+    for (size_t k = 0; k < templateUnitIDs.size(); k++)
+    {
+        if (templateUnitIDs[k] == unitID)
+        {
+            std::copy(waveform, waveform + dim, templates.begin() + k * dim);
+            templateEnergies[k] = waveformDotProduct(waveform, waveform, dim);
+            return;
+        }
+    }
+
+    templates.insert(templates.end(), waveform, waveform + dim);
+    templateEnergies.push_back(waveformDotProduct(waveform, waveform, dim));
+    templateUnitIDs.push_back(unitID);
+}
+
+void SpikeSortBoxes::pruneTemplates()
+{
+    const int dim = numChannels * waveformLength;
+
+    for (int k = (int) templateUnitIDs.size() - 1; k >= 0; k--)
+    {
+        bool found = false;
+
+        for (size_t u=0; u<boxUnits.size(); u++)
+            found = found || boxUnits[u].getUnitID() == templateUnitIDs[k];
+
+        for (size_t u=0; u<pcaUnits.size(); u++)
+            found = found || pcaUnits[u].getUnitID() == templateUnitIDs[k];
+
+        if (! found)
+        {
+            templates.erase(templates.begin() + k * dim, templates.begin() + (k + 1) * dim);
+            templateEnergies.erase(templateEnergies.begin() + k);
+            templateUnitIDs.erase(templateUnitIDs.begin() + k);
+        }
+    }
+}
+
+void SpikeSortBoxes::clearTemplates()
+{
+    const ScopedLock myScopedLock(mut);
+    const ScopedRulesUpdate rulesUpdate(*this);
+    templates.clear();
+    templateEnergies.clear();
+    templateUnitIDs.clear();
+}
+
+int SpikeSortBoxes::getNumTemplates()
+{
+    const ScopedLock myScopedLock(mut);
+    return (int) templateUnitIDs.size();
+}
+
+
+int64 SpikeSortBoxes::getMemoryFootprint()
+{
+    const ScopedLock myScopedLock(mut);
+    const int64 dim = int64(numChannels) * waveformLength;
+
+    int64 bytes = MemoryFootprint::ofBlock(spikeSums, dim)
+        + MemoryFootprint::ofBlock(spikeProducts, dim * dim)
+        + (pc1 != nullptr ? dim * sizeof(float) : 0)
+        + (pc2 != nullptr ? dim * sizeof(float) : 0)
+        + MemoryFootprint::ofArray(templates)
+        + MemoryFootprint::ofArray(templateEnergies);
+
+    const SorterSpikeArray::ScopedLockType spikesScopedLock(spikeBuffer.getLock());
+    for (int n = 0; n < spikeBuffer.size(); n++)
+    {
+        if (SorterSpikeContainer* spike = spikeBuffer.getObjectPointerUnchecked(n))
+            bytes += spike->getMemoryFootprint();
+    }
+
+    return bytes;
+}
+
+
 bool  SpikeSortBoxes::removeBoxFromUnit(int unitID, int boxIndex)
 {
     const ScopedLock myScopedLock(mut);
+    const ScopedRulesUpdate rulesUpdate(*this);
     //StartCriticalSection();
     for (int k=0; k<boxUnits.size(); k++)
     {
@@ -1691,416 +2327,316 @@ void PCAUnit::updateWaveform(SorterSpikePtr so)
 
 
 /*
-  An implementation of SVD from Numerical Recipes in C and Mike Erhdmann's lectures
+  The principal components are the leading eigenvectors of the covariance of the spike
+  waveforms, found by subspace iteration with a Rayleigh-Ritz step on a few more vectors
+  than needed, so that only products of the covariance with a thin block are computed.
 */
 
-
-#define SIGN(a,b) ((b) > 0.0 ? fabs(a) : - fabs(a))
-
-static double maxarg1,maxarg2;
-#define FMAX(a,b) (maxarg1 = (a),maxarg2 = (b),(maxarg1) > (maxarg2) ? (maxarg1) : (maxarg2))
-
-static int iminarg1,iminarg2;
-#define IMIN(a,b) (iminarg1 = (a),iminarg2 = (b),(iminarg1 < (iminarg2) ? (iminarg1) : iminarg2))
-
-static double sqrarg;
-#define SQR(a) ((sqrarg = (a)) == 0.0 ? 0.0 : sqrarg * sqrarg)
-
-PCAjob::PCAjob(SorterSpikeArray& _spikes, float* _pc1, float* _pc2,
-                std::atomic<float>& pc1Min,  std::atomic<float>& pc2Min,  std::atomic<float>&pc1Max,  std::atomic<float>& pc2Max, std::atomic<bool>& _reportDone) : spikes(_spikes),
-pc1min(pc1Min), pc2min(pc2Min), pc1max(pc1Max), pc2max(pc2Max), reportDone(_reportDone)
+namespace
 {
-    cov = nullptr;
-    pc1 = _pc1;
-    pc2 = _pc2;
-
-    dim = spikes[0]->getChannel()->getNumChannels()*spikes[0]->getChannel()->getTotalSamples();
-
-};
+    const int numPCAvectors = 4;        // vectors iterated on, the first two being kept
+    const int maxPCAiterations = 500;
+    const double PCAtolerance = 1e-7;   // residual relative to the largest eigenvalue
 
-PCAjob::~PCAjob()
-{
-
-}
+    /** Eigen-decomposes the small symmetric matrix a[n][n] by cyclic Jacobi rotations. On
+        return its diagonal holds the eigenvalues and the columns of v the eigenvectors. */
+    void jacobiEigen(double a[numPCAvectors][numPCAvectors], double v[numPCAvectors][numPCAvectors], int n)
+    {
+        for (int i = 0; i < n; i++)
+            for (int j = 0; j < n; j++)
+                v[i][j] = (i == j) ? 1.0 : 0.0;
 
+        for (int sweep = 0; sweep < 50; sweep++)
+        {
+            double offDiagonal = 0;
 
+            for (int p = 0; p < n; p++)
+                for (int q = p + 1; q < n; q++)
+                    offDiagonal += a[p][q] * a[p][q];
 
-// calculates sqrt( a^2 + b^2 ) with decent precision
-float PCAjob::pythag(float a, float b)
-{
-    float absa,absb;
+            if (offDiagonal < 1e-30)
+                return;
 
-    absa = fabs(a);
-    absb = fabs(b);
+            for (int p = 0; p < n; p++)
+            {
+                for (int q = p + 1; q < n; q++)
+                {
+                    if (a[p][q] == 0)
+                        continue;
 
-    if (absa > absb)
-        return (absa * sqrt(1.0 + SQR(absb/absa)));
-    else
-        return (absb == 0.0 ? 0.0 : absb * sqrt(1.0 + SQR(absa / absb)));
-}
+                    const double theta = (a[q][q] - a[p][p]) / (2 * a[p][q]);
+                    const double t = (theta >= 0 ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta * theta + 1));
+                    const double c = 1 / sqrt(t * t + 1);
+                    const double s = t * c;
 
-/*
-  Modified from Numerical Recipes in C
-  Given a matrix a[nRows][nCols], svdcmp() computes its singular value
-  decomposition, A = U * W * Vt.  A is replaced by U when svdcmp
-  returns.  The diagonal matrix W is output as a vector w[nCols].
-  V (not V transpose) is output as the matrix V[nCols][nCols].
-*/
-int PCAjob::svdcmp(float** a, int nRows, int nCols, float* w, float** v)
-{
+                    for (int k = 0; k < n; k++)
+                    {
+                        const double akp = a[k][p], akq = a[k][q];
+                        a[k][p] = c * akp - s * akq;
+                        a[k][q] = s * akp + c * akq;
+                    }
 
-    int flag, i, its, j, jj, k, l = 0, nm = 0;
-    float anorm, c, f, g, h, s, scale, x, y, z, *rv1;
+                    for (int k = 0; k < n; k++)
+                    {
+                        const double apk = a[p][k], aqk = a[q][k];
+                        a[p][k] = c * apk - s * aqk;
+                        a[q][k] = s * apk + c * aqk;
+                    }
 
-    rv1 = new float[nCols];
-    if (rv1 == NULL)
-    {
-        printf("svdcmp(): Unable to allocate vector\n");
-        return (-1);
+                    for (int k = 0; k < n; k++)
+                    {
+                        const double vkp = v[k][p], vkq = v[k][q];
+                        v[k][p] = c * vkp - s * vkq;
+                        v[k][q] = s * vkp + c * vkq;
+                    }
+                }
+            }
+        }
     }
 
-    g = scale = anorm = 0.0;
-    for (i = 0; i < nCols; i++)
+    /** Orthonormalizes the columns of v[dim][numPCAvectors] by modified Gram-Schmidt, replacing
+        any that vanishes by a unit vector */
+    void orthonormalize(double* v, int dim, int numVectors)
     {
-        l = i+1;
-        rv1[i] = scale*g;
-        g = s = scale = 0.0;
-        if (i < nRows)
+        for (int c = 0; c < numVectors; c++)
         {
-            for (k = i; k < nRows; k++)
-            {
-                //std::cout << k << " " << i << std::endl;
-                scale += fabs(a[k][i]);
-            }
-
-            if (scale)
+            for (int attempt = 0; attempt <= dim; attempt++)
             {
-                for (k = i; k < nRows; k++)
+                for (int b = 0; b < c; b++)
                 {
-                    a[k][i] /= scale;
-                    s += a[k][i] * a[k][i];
+                    double dot = 0;
+                    for (int i = 0; i < dim; i++)
+                        dot += v[i * numPCAvectors + b] * v[i * numPCAvectors + c];
+                    for (int i = 0; i < dim; i++)
+                        v[i * numPCAvectors + c] -= dot * v[i * numPCAvectors + b];
                 }
-                f = a[i][i];
-                g = -SIGN(sqrt(s),f);
-                h = f * g - s;
-                a[i][i] = f - g;
 
-                for (j = l; j < nCols; j++)
-                {
-                    for (s = 0.0, k = i; k < nRows; k++) s += a[k][i] * a[k][j];
-                    f = s / h;
-                    for (k = i; k < nRows; k++) a[k][j] += f * a[k][i];
-                }
+                double norm = 0;
+                for (int i = 0; i < dim; i++)
+                    norm += v[i * numPCAvectors + c] * v[i * numPCAvectors + c];
 
-                for (k = i; k < nRows; k++)
-                    a[k][i] *= scale;
-            } // end if (scale)
-        } // end if (i < nRows)
-        w[i] = scale * g;
-        g = s = scale = 0.0;
-        if (i < nRows && i != nCols-1)
-        {
-            for (k = l; k < nCols; k++) scale += fabs(a[i][k]);
-            if (scale)
-            {
-                for (k = l; k < nCols; k++)
-                {
-                    a[i][k] /= scale;
-                    s += a[i][k] * a[i][k];
-                }
-                f = a[i][l];
-                g = - SIGN(sqrt(s),f);
-                h = f * g - s;
-                a[i][l] = f - g;
-                for (k=l; k<nCols; k++) rv1[k] = a[i][k] / h;
-                for (j=l; j<nRows; j++)
+                if (norm > 1e-24)
                 {
-                    for (s=0.0,k=l; k<nCols; k++) s += a[j][k] * a[i][k];
-                    for (k=l; k<nCols; k++) a[j][k] += s * rv1[k];
+                    norm = 1 / sqrt(norm);
+                    for (int i = 0; i < dim; i++)
+                        v[i * numPCAvectors + c] *= norm;
+                    break;
                 }
-                for (k=l; k<nCols; k++) a[i][k] *= scale;
+
+                for (int i = 0; i < dim; i++)
+                    v[i * numPCAvectors + c] = (i == (c + attempt) % dim) ? 1.0 : 0.0;
             }
         }
-        anorm = FMAX(anorm, (fabs(w[i]) + fabs(rv1[i])));
+    }
+}
 
 
-    }
+PCAjob::PCAjob(SorterSpikeArray& _spikes, const double* sums, const double* products, int _numSpikes, int _dim,
+               float* _pc1, float* _pc2, bool usePreviousComponents,
+               std::atomic<float>& pc1Min,  std::atomic<float>& pc2Min,  std::atomic<float>&pc1Max,  std::atomic<float>& pc2Max, std::atomic<bool>& _reportDone) : spikes(_spikes),
+pc1min(pc1Min), pc2min(pc2Min), pc1max(pc1Max), pc2max(pc2Max), reportDone(_reportDone)
+{
+    pc1 = _pc1;
+    pc2 = _pc2;
+    dim = _dim;
+    numSpikes = _numSpikes;
+    cancelled = false;
 
-    for (i=nCols-1; i>=0; i--)
-    {
-        if (i < nCols-1)
-        {
-            if (g)
-            {
-                for (j=l; j<nCols; j++)
-                    v[j][i] = (a[i][j] / a[i][l]) / g;
-                for (j=l; j<nCols; j++)
-                {
-                    for (s=0.0,k=l; k<nCols; k++) s += a[i][k] * v[k][j];
-                    for (k=l; k<nCols; k++) v[k][j] += s * v[k][i];
-                }
-            }
-            for (j=l; j<nCols; j++) v[i][j] = v[j][i] = 0.0;
-        }
-        v[i][i] = 1.0;
-        g = rv1[i];
-        l = i;
-    }
+    mean.malloc(dim);
+    cov.malloc(dim * dim);
 
-    for (i=IMIN(nRows,nCols) - 1; i >= 0; i--)
-    {
-        l = i + 1;
-        g = w[i];
-        for (j=l; j<nCols; j++) a[i][j] = 0.0;
-        if (g)
-        {
-            g = 1.0 / g;
-            for (j=l; j<nCols; j++)
-            {
-                for (s=0.0,k=l; k<nRows; k++) s += a[k][i] * a[k][j];
-                f = (s / a[i][i]) * g;
-                for (k=i; k<nRows; k++) a[k][j] += f * a[k][i];
-            }
-            for (j=i; j<nRows; j++) a[j][i] *= g;
-        }
-        else
-            for (j=i; j<nRows; j++) a[j][i] = 0.0;
-        ++a[i][i];
-    }
+    // the sums are copied now, as they keep changing with the spikes coming in
+    for (int i = 0; i < dim; i++)
+        mean[i] = (numSpikes > 0) ? sums[i] / numSpikes : 0.0;
+
+    memcpy(cov, products, sizeof(double) * dim * dim);
 
-    for (k=nCols-1; k>=0; k--)
+    // a new analysis starts from the previous components, which also sets their signs
+    hasPrevious = usePreviousComponents;
+
+    if (hasPrevious)
     {
-        for (its=0; its<30; its++)
+        previous.malloc(2 * dim);
+        for (int i = 0; i < dim; i++)
         {
-            flag = 1;
-            for (l=k; l>=0; l--)
-            {
-                nm = l-1;
-                if ((fabs(rv1[l]) + anorm) == anorm)
-                {
-                    flag =  0;
-                    break;
-                }
-                if ((fabs(w[nm]) + anorm) == anorm) break;
-            }
-            if (flag)
-            {
-                c = 0.0;
-                s = 1.0;
-                for (i=l; i<=k; i++)
-                {
-                    f = s * rv1[i];
-                    rv1[i] = c * rv1[i];
-                    if ((fabs(f) + anorm) == anorm) break;
-                    g = w[i];
-                    h = pythag(f,g);
-                    w[i] = h;
-                    h = 1.0 / h;
-                    c = g * h;
-                    s = -f * h;
-                    for (j=0; j<nRows; j++)
-                    {
-                        y = a[j][nm];
-                        z = a[j][i];
-                        a[j][nm] = y * c + z * s;
-                        a[j][i] = z * c - y * s;
-                    }
-                }
-            }
-            z = w[k];
-            if (l == k)
-            {
-                if (z < 0.0)
-                {
-                    w[k] = -z;
-                    for (j=0; j<nCols; j++) v[j][k] = -v[j][k];
-                }
-                break;
-            }
-            //if(its == 29) printf("no convergence in 30 svdcmp iterations\n");
-            x = w[l];
-            nm = k-1;
-            y = w[nm];
-            g = rv1[nm];
-            h = rv1[k];
-            f = ((y - z) * (y + z) + (g - h) * (g + h)) / (2.0 * h * y);
-            g = pythag(f,1.0);
-            f = ((x - z) * (x + z) + h * ((y / (f + SIGN(g,f))) - h)) / x;
-            c = s = 1.0;
-            for (j=l; j<=nm; j++)
-            {
-                i = j+1;
-                g = rv1[i];
-                y = w[i];
-                h = s * g;
-                g = c * g;
-                z = pythag(f,h);
-                rv1[j] = z;
-                c = f/z;
-                s = h/z;
-                f = x * c + g * s;
-                g = g * c - x * s;
-                h = y * s;
-                y *= c;
-                for (jj=0; jj<nCols; jj++)
-                {
-                    x = v[jj][j];
-                    z = v[jj][i];
-                    v[jj][j] = x * c + z * s;
-                    v[jj][i] = z * c - x * s;
-                }
-                z = pythag(f,h);
-                w[j] = z;
-                if (z)
-                {
-                    z = 1.0 / z;
-                    c = f * z;
-                    s = h * z;
-                }
-                f = c * g + s * y;
-                x = c * y - s * g;
-                for (jj=0; jj < nRows; jj++)
-                {
-                    y = a[jj][j];
-                    z = a[jj][i];
-                    a[jj][j] = y * c + z * s;
-                    a[jj][i] = z * c - y * s;
-                }
-            }
-            rv1[l] = 0.0;
-            rv1[k] = f;
-            w[k] = x;
+            previous[i] = pc1[i];
+            previous[dim + i] = pc2[i];
         }
     }
+}
 
-    delete[] rv1;
+PCAjob::~PCAjob()
+{
 
-    return (0);
 }
 
+void PCAjob::cancel()
+{
+    const ScopedLock resultScopedLock(resultLock);
+    cancelled = true;
+}
 
 void PCAjob::computeCov()
 {
-    // allocate and zero
-    cov = new float*[dim];
-    float* mean  = new float[dim];
-    for (int k = 0; k < dim; k++)
+    // cov[i][j] = (sum_k x_k[i] x_k[j] - N mean[i] mean[j]) / (N - 1), only the upper half being accumulated
+    const double scale = 1.0 / jmax(1, numSpikes - 1);
+
+    for (int i = 0; i < dim; i++)
     {
-        cov[k] = new float[dim];
-        for (int j=0; j<dim; j++)
+        for (int j = i; j < dim; j++)
         {
-            cov[k][j] = 0;
+            const double c = (cov[i * dim + j] - numSpikes * mean[i] * mean[j]) * scale;
+            cov[i * dim + j] = c;
+            cov[j * dim + i] = c;
         }
     }
-    // compute mean
+}
+
+void PCAjob::computeSVD()
+{
+    // the covariance is symmetric, so its singular vectors are its eigenvectors
+    const int numVectors = jmin(numPCAvectors, dim);
 
-    for (int j=0; j<dim; j++)
+    HeapBlock<double> v(dim * numPCAvectors, true);
+    HeapBlock<double> w(dim * numPCAvectors, true);
+
+    for (int i = 0; i < dim; i++)
     {
-        mean[j] = 0;
-        for (int i=0; i<spikes.size(); i++)
+        for (int c = 0; c < numVectors; c++)
         {
-            SorterSpikePtr spike = spikes[i];
-            float v = spikeDataIndexToMicrovolts(spike, j) ;
-            mean[j] += v / dim;
+            if (hasPrevious && c < 2)
+                v[i * numPCAvectors + c] = previous[c * dim + i];
+            else
+                v[i * numPCAvectors + c] = sin(0.7 * (i + 1) * (c + 1) + c);
         }
     }
-    // aggregate
 
+    orthonormalize(v, dim, numVectors);
 
-    for (int i=0; i<dim; i++)
+    double h[numPCAvectors][numPCAvectors];
+    double y[numPCAvectors][numPCAvectors];
+    int order[numPCAvectors];
+
+    for (int iteration = 0; iteration < maxPCAiterations; iteration++)
     {
-        for (int j=i; j<dim; j++)
+        // w = cov * v, the rows of cov being read once for all the vectors
+        for (int i = 0; i < dim; i++)
         {
-            // cov[i][j] = sum_k[ (X(i,:)) * (Xj-mue(j) ]
-            float sum = 0 ;
-            for (int k=0; k<spikes.size(); k++)
-            {
+            const double* row = cov + i * dim;
+            double acc[numPCAvectors] = { 0 };
+
+            for (int j = 0; j < dim; j++)
+                for (int c = 0; c < numPCAvectors; c++)
+                    acc[c] += row[j] * v[j * numPCAvectors + c];
+
+            for (int c = 0; c < numPCAvectors; c++)
+                w[i * numPCAvectors + c] = acc[c];
+        }
 
-                SorterSpikePtr spike = spikes[k];
-                float vi = spikeDataIndexToMicrovolts(spike, i);
-                float vj = spikeDataIndexToMicrovolts(spike, j);
-                sum += (vi-mean[i]) * (vj-mean[j]);
+        // Rayleigh-Ritz: the best approximations of the eigenvectors within the span of v
+        for (int a = 0; a < numVectors; a++)
+        {
+            for (int b = 0; b < numVectors; b++)
+            {
+                double dot = 0;
+                for (int i = 0; i < dim; i++)
+                    dot += v[i * numPCAvectors + a] * w[i * numPCAvectors + b];
+                h[a][b] = dot;
             }
-            cov[i][j] = sum / (dim-1);
-            cov[j][i] = sum / (dim-1);
         }
-    }
-    delete[] mean;
 
-    // delete covariances
-    //for (int k = 0; k < dim; k++)
-    //delete cov[k];
+        for (int a = 0; a < numVectors; a++)
+            for (int b = a + 1; b < numVectors; b++)
+                h[a][b] = h[b][a] = 0.5 * (h[a][b] + h[b][a]);
 
-    //delete(cov);
-    //cov = nullptr;
+        jacobiEigen(h, y, numVectors);
 
-}
+        for (int c = 0; c < numVectors; c++)
+            order[c] = c;
 
-std::vector<int> sort_indexes(std::vector<float> v)
-{
-    // initialize original index locations
-    std::vector<int> idx(v.size());
+        std::sort(order, order + numVectors, [&h](int a, int b) { return h[a][a] > h[b][b]; });
 
-    for (int i = 0; i != idx.size(); ++i)
-    {
-        idx[i] = i;
-    }
+        // rotate both blocks onto the Ritz vectors, largest eigenvalue first
+        double residual = 0;
+        const double largest = jmax(fabs(h[order[0]][order[0]]), 1e-30);
 
-    //sort indexes based on comparing values in v
-    sort(
-        idx.begin(),
-        idx.end()//,
-        //[&v](size_t i1, size_t i2)
-        //{
-        //	return v[i1] > v[i2];
-        //}
-    );
+        for (int i = 0; i < dim; i++)
+        {
+            double vi[numPCAvectors], wi[numPCAvectors];
 
-    return idx;
-}
+            for (int c = 0; c < numVectors; c++)
+            {
+                vi[c] = wi[c] = 0;
+                for (int b = 0; b < numVectors; b++)
+                {
+                    vi[c] += v[i * numPCAvectors + b] * y[b][order[c]];
+                    wi[c] += w[i * numPCAvectors + b] * y[b][order[c]];
+                }
+            }
 
-void PCAjob::computeSVD()
-{
+            for (int c = 0; c < numVectors; c++)
+            {
+                if (c < 2)
+                {
+                    const double r = wi[c] - h[order[c]][order[c]] * vi[c];
+                    residual = jmax(residual, fabs(r));
+                }
 
+                v[i * numPCAvectors + c] = vi[c];
+                w[i * numPCAvectors + c] = wi[c];
+            }
+        }
 
-    float** eigvec, *sigvalues;
-    sigvalues = new float[dim];
+        if (residual <= PCAtolerance * largest)
+            break;
 
-    eigvec = new float*[dim];
-    for (int k = 0; k < dim; k++)
-    {
-        eigvec[k] = new float[dim];
-        for (int j=0; j<dim; j++)
-        {
-            eigvec[k][j] = 0;
-        }
+        // next block: cov times the current Ritz vectors
+        for (int i = 0; i < dim * numPCAvectors; i++)
+            v[i] = w[i];
+
+        orthonormalize(v, dim, numVectors);
     }
 
-    svdcmp(cov, dim, dim, sigvalues, eigvec);
+    HeapBlock<float> newPc1(dim), newPc2(dim);
+    double dot1 = 0, dot2 = 0;
 
-    std::vector<float> sig;
-    sig.resize(dim);
     for (int k = 0; k < dim; k++)
-        sig[k] = sigvalues[k];
+    {
+        newPc1[k] = (float) v[k * numPCAvectors];
+        newPc2[k] = (float) v[k * numPCAvectors + (numVectors > 1 ? 1 : 0)];
 
-    std::vector<int> sortind = sort_indexes(sig);
+        if (hasPrevious)
+        {
+            dot1 += newPc1[k] * previous[k];
+            dot2 += newPc2[k] * previous[dim + k];
+        }
+    }
 
+    // keep the orientation of the previous components, so that units drawn stay in place
     for (int k = 0; k < dim; k++)
     {
-        pc1[k] = eigvec[k][sortind[0]];
-        pc2[k] = eigvec[k][sortind[1]];
+        if (dot1 < 0)
+            newPc1[k] = -newPc1[k];
+        if (dot2 < 0)
+            newPc2[k] = -newPc2[k];
     }
+
     // project samples to find the display range
     float min1 = 1e10, min2 = 1e10, max1 = -1e10, max2 = -1e10;
 
     for (int j = 0; j < spikes.size(); j++)
     {
+        SorterSpikePtr spike = spikes[j];
+
+        if (spike == nullptr || (int) (spike->getChannel()->getNumChannels()*spike->getChannel()->getTotalSamples()) != dim)
+            continue;
+
+        const float* data = spike->getData();
         float sum1 = 0, sum2=0;
         for (int k = 0; k < dim; k++)
         {
-            SorterSpikePtr spike = spikes[j];
-            sum1 += spikeDataIndexToMicrovolts(spike,k) * pc1[k];
-            sum2 += spikeDataIndexToMicrovolts(spike,k) * pc2[k];
+            sum1 += data[k] * newPc1[k];
+            sum2 += data[k] * newPc2[k];
         }
         if (sum1 < min1)
             min1 = sum1;
@@ -2112,73 +2648,79 @@ void PCAjob::computeSVD()
             max2 = sum2;
     }
 
+    const ScopedLock resultScopedLock(resultLock);
 
-    pc1min = min1 - 1.5 * (max1-min1);
-    pc2min = min2 - 1.5 * (max2-min2);
-    pc1max = max1 + 1.5 * (max1-min1);
-    pc2max = max2 + 1.5 * (max2-min2);
+    // the electrode may have gone or changed its waveforms meanwhile
+    if (cancelled)
+        return;
 
-    // clear memory
     for (int k = 0; k < dim; k++)
     {
-        delete[] eigvec[k];
+        pc1[k] = newPc1[k];
+        pc2[k] = newPc2[k];
     }
-    delete[] eigvec;
-    delete[] sigvalues;
 
-    // delete covariances
-    for (int k = 0; k < dim; k++)
-        delete[] cov[k];
-
-    delete[] cov;
-    cov = nullptr;
+    pc1min = min1 - 1.5 * (max1-min1);
+    pc2min = min2 - 1.5 * (max2-min2);
+    pc1max = max1 + 1.5 * (max1-min1);
+    pc2max = max2 + 1.5 * (max2-min2);
 
+    // Report to the spike sorting electrode that PCA is finished
+    reportDone = true;
 }
 
 
 /**********************/
 
 
-void PCAcomputingThread::addPCAjob(PCAJobPtr job)
+class PCAcomputingThread::PCAPoolJob : public ThreadPoolJob
 {
-	{
-		ScopedLock critical(lock);
-		jobs.add(job);
-	}
-	
-    if (!isThreadRunning())
+public:
+    PCAPoolJob(PCAJobPtr j) : ThreadPoolJob("PCA"), job(j) {}
+
+    JobStatus runJob() override
     {
-        startThread();
+        // 1. Compute the covariance matrix from the accumulated sums
+        // 2. Extract the two eigenvectors with the largest eigenvalues
+        if (waitWhileOverrunning())
+            job->computeCov();
+
+        if (waitWhileOverrunning())
+            job->computeSVD();
+
+        return jobHasFinished;
     }
-}
 
-void PCAcomputingThread::run()
-{
-    while (jobs.size() > 0)
+private:
+    /** Holds the job back while the processing thread can't keep up, the components of the
+        previous job staying in use. Returns false if the pool is being shut down. */
+    bool waitWhileOverrunning()
     {
-		lock.enter();
-        PCAJobPtr J = jobs.removeAndReturn(0);
-	if (J == nullptr) continue;
-		lock.exit();
-        // compute PCA
-        // 1. Compute Covariance matrix
-        // 2. Apply SVD on covariance matrix
-        // 3. Extract the two principal components corresponding to the largest singular values
-
-        J->computeCov();
-        J->computeSVD();
+        while (OverrunWatchdog::getLevel() >= OverrunWatchdog::PAUSE_BACKGROUND_WORK && ! shouldExit())
+            Thread::sleep(50);
 
-        // 4. Report to the spike sorting electrode that PCA is finished
-        J->reportDone = true;
+        return ! shouldExit();
     }
+
+    PCAJobPtr job;
+};
+
+void PCAcomputingThread::addPCAjob(PCAJobPtr job)
+{
+    pool.addJob(new PCAPoolJob(job), true);
 }
 
 
-PCAcomputingThread::PCAcomputingThread() : Thread("PCA")
+PCAcomputingThread::PCAcomputingThread() : pool(jlimit(1, 8, SystemStats::getNumCpus() / 2))
 {
 
 }
 
+PCAcomputingThread::~PCAcomputingThread()
+{
+    pool.removeAllJobs(true, 10000);
+}
+
 
 /**************************/
 
@@ -2214,6 +2756,12 @@ int microSecondsToSpikeTimeBin(SorterSpikePtr s, float t, int ch)
 
 
 SorterSpikeContainer::SorterSpikeContainer(const SpikeChannel* channel, SpikeEvent::SpikeBuffer& spikedata, int64 timestamp)
+	: dataSize(0)
+{
+	set(channel, spikedata, timestamp);
+}
+
+void SorterSpikeContainer::set(const SpikeChannel* channel, SpikeEvent::SpikeBuffer& spikedata, int64 timestamp)
 {
 	color[0] = color[1] = color[2] = 127;
 	pcProj[0] = pcProj[1] = 0;
@@ -2221,7 +2769,11 @@ SorterSpikeContainer::SorterSpikeContainer(const SpikeChannel* channel, SpikeEve
 	this->timestamp = timestamp;
 	chan = channel;
 	int nSamples = chan->getNumChannels() * chan->getTotalSamples();
-	data.malloc(nSamples);
+	if (nSamples > dataSize)
+	{
+		data.malloc(nSamples);
+		dataSize = nSamples;
+	}
 	memcpy(data.getData(), spikedata.getRawPointer(), nSamples*sizeof(float));
 }
 
@@ -2230,6 +2782,11 @@ const float* SorterSpikeContainer::getData() const
 	return data.getData();
 }
 
+int64 SorterSpikeContainer::getMemoryFootprint() const
+{
+	return sizeof(SorterSpikeContainer) + MemoryFootprint::ofBlock(data, dataSize);
+}
+
 const SpikeChannel* SorterSpikeContainer::getChannel() const
 {
 	return chan;
@@ -2239,3 +2796,35 @@ int64 SorterSpikeContainer::getTimestamp() const
 {
 	return timestamp;
 }
+/***************************/
+
+SorterSpikePool::SorterSpikePool() : nextSpike(0)
+{
+}
+
+SorterSpikePtr SorterSpikePool::getSpike(const SpikeChannel* channel, SpikeEvent::SpikeBuffer& data, int64 timestamp)
+{
+	// a few spikes are tried in turn before adding one
+	for (int tries = jmin(4, spikes.size()); --tries >= 0;)
+	{
+		SorterSpikeContainer* spike = spikes.getUnchecked(nextSpike);
+
+		if (++nextSpike >= spikes.size())
+			nextSpike = 0;
+
+		if (spike->getReferenceCount() == 1)
+		{
+			spike->set(channel, data, timestamp);
+			return spike;
+		}
+	}
+
+	SorterSpikeContainer* spike = new SorterSpikeContainer(channel, data, timestamp);
+	spikes.insert(nextSpike, spike);
+
+	if (++nextSpike >= spikes.size())
+		nextSpike = 0;
+
+	return spike;
+}
+
@@ -37,8 +37,13 @@ public:
 	SorterSpikeContainer(const SpikeChannel* channel, SpikeEvent::SpikeBuffer& data, int64 timestamp);
 	SorterSpikeContainer() = delete;
 
+	/** Makes this a new spike, keeping the memory of the previous one if it is large enough */
+	void set(const SpikeChannel* channel, SpikeEvent::SpikeBuffer& data, int64 timestamp);
+
 	const float* getData() const;
 	const SpikeChannel* getChannel() const;
+	/** Returns the bytes of the spike, including those kept from larger previous ones */
+	int64 getMemoryFootprint() const;
 	int64 getTimestamp() const;
 	uint8 color[3];
 	float pcProj[2];
@@ -46,11 +51,33 @@ public:
 private:
 	int64 timestamp;
 	HeapBlock<float> data;
+	int dataSize;
 	const SpikeChannel* chan;
 };
 typedef ReferenceCountedObjectPtr<SorterSpikeContainer> SorterSpikePtr;
 typedef ReferenceCountedArray<SorterSpikeContainer, CriticalSection> SorterSpikeArray;
 
+/**
+    The spikes of an electrode, kept to be used again so that detecting a spike does not
+    allocate. A spike is handed out again once the pool holds the only reference to it; the
+    buffers holding on to spikes let go of the oldest first, so the next spike in turn is
+    nearly always free, and the pool only grows while more spikes are in use than it has.
+
+    Only the processing thread takes spikes, while they can be let go of on any thread.
+*/
+class SorterSpikePool
+{
+public:
+    SorterSpikePool();
+
+    /** Returns a spike holding a copy of the data */
+    SorterSpikePtr getSpike(const SpikeChannel* channel, SpikeEvent::SpikeBuffer& data, int64 timestamp);
+
+private:
+    ReferenceCountedArray<SorterSpikeContainer, DummyCriticalSection> spikes;
+    int nextSpike;
+};
+
 class PCAcomputingThread;
 class UniqueIDgenerator;
 class PointD
@@ -119,6 +146,8 @@ public:
     std::vector<double> getStandardDeviation(int index);
     void update(SorterSpikePtr so);
     bool queryNewData();
+    /** Exchanges the statistics of two units without allocating */
+    void swap(RunningStats& other);
 
     double LastSpikeTime;
     bool newData;
@@ -177,24 +206,41 @@ class PCAjob
 public:
 PCAjob();
 };*/
+/**
+    Finds the first two principal components of an electrode's spikes.
+
+    The job is given the sums of the spikes and of their outer products, which the electrode
+    keeps up to date as spikes arrive, so that the covariance comes without another pass over
+    the spikes; these are only projected at the end to find the display range. The components
+    are the leading eigenvectors of the covariance, found by subspace iteration from the
+    previous components if there are any.
+*/
 class PCAjob : public ReferenceCountedObject
 {
 public:
-    PCAjob(SorterSpikeArray& _spikes, float* _pc1, float* _pc2,
+    PCAjob(SorterSpikeArray& _spikes, const double* sums, const double* products, int numSpikes, int dim,
+           float* _pc1, float* _pc2, bool usePreviousComponents,
            std::atomic<float>&,  std::atomic<float>&,  std::atomic<float>&,  std::atomic<float>&, std::atomic<bool>& _reportDone);
     ~PCAjob();
     void computeCov();
     void computeSVD();
 
-    float** cov;
+    /** Keeps the job from writing its results, waiting for it if it is writing them */
+    void cancel();
+
     SorterSpikeArray spikes;
     float* pc1, *pc2;
     std::atomic<float>& pc1min, &pc2min, &pc1max, &pc2max;
     std::atomic<bool>& reportDone;
 private:
-    int svdcmp(float** a, int nRows, int nCols, float* w, float** v);
-    float pythag(float a, float b);
-    int dim;
+    HeapBlock<double> mean;
+    HeapBlock<double> cov;          // dim x dim, the sums of the outer products until computeCov()
+    HeapBlock<double> previous;     // the previous pc1 and pc2
+    bool hasPrevious;
+    int dim, numSpikes;
+
+    CriticalSection resultLock;
+    bool cancelled;
 };
 
 typedef ReferenceCountedObjectPtr<PCAjob> PCAJobPtr;
@@ -211,16 +257,18 @@ public:
 
 
 
-class PCAcomputingThread : juce::Thread
+/** Computes the PCA jobs of all the electrodes on a pool of threads, several at a time */
+class PCAcomputingThread
 {
 public:
     PCAcomputingThread();
-    void run(); // computes PCA on waveforms
+    ~PCAcomputingThread();
     void addPCAjob(PCAJobPtr job);
 
 private:
-    PCAJobArray jobs;
-	CriticalSection lock;
+    class PCAPoolJob;
+
+    ThreadPool pool;
 };
 
 class PCAUnit
@@ -247,6 +295,24 @@ public:
     Time timer;
 };
 
+/**
+    The units of an electrode as spikes are sorted with them, a copy made on each change.
+
+    The editing threads change the units of a SpikeSortBoxes under its lock and then publish
+    a new copy, which the processing thread takes in place of its own at the start of a block.
+    The processing thread thus never waits for an edit, nor an edit for a block. The mean
+    waveforms of the units are only updated in the processing thread's copy, and carried over
+    to the next one.
+*/
+struct SortingRules
+{
+    std::vector<BoxUnit> boxUnits;
+    std::vector<PCAUnit> pcaUnits;
+    std::vector<float> templates;           // one row of numChannels * waveformLength per template
+    std::vector<float> templateEnergies;    // the sum of squares of each row
+    std::vector<int> templateUnitIDs;
+};
+
 // Sort spikes from a single electrode (which could have any number of channels)
 // using the box method. Any electrode could have an arbitrary number of units specified.
 // Each unit is defined by a set of boxes, which can be placed on any of the given channels.
@@ -261,6 +327,21 @@ public:
 
 	void projectOnPrincipalComponents(SorterSpikePtr so);
 	bool sortSpike(SorterSpikePtr so, bool PCAfirst);
+
+    /** Gives the spike the unit with the nearest template, if their RMS difference is at most
+        rejectionRMS microvolts, instead of testing boxes and polygons. Returns false, leaving the
+        spike unsorted, if no template is near enough. */
+    bool sortSpikeByTemplates(SorterSpikePtr so, float rejectionRMS);
+    /** Takes the template of each unit from the mean of the spikes it has sorted, for units with
+        at least minSpikes of them. Returns the number of templates. */
+    int learnTemplates(int minSpikes = 20);
+    /** Sets the template of a unit, for one imported from an offline sorter. The waveform holds
+        the samples of each channel in turn, as spikes do. Returns false if there is no such
+        unit or the waveform has the wrong length. */
+    bool setUnitTemplate(int unitID, const std::vector<float>& waveform);
+    void clearTemplates();
+    int getNumTemplates();
+
     void RePCA();
     void addPCAunit(PCAUnit unit);
     int addBoxUnit(int channel);
@@ -292,7 +373,30 @@ public:
     void getSelectedUnitAndBox(int& unitID, int& boxid);
     void saveCustomParametersToXml(XmlElement* electrodeNode);
     void loadCustomParametersFromXml(XmlElement* electrodeNode);
+
+    /** Takes the units as last published, if they changed. Called by the processing thread
+        before sorting the spikes of a block. */
+    void updateSortingRules();
+
+    /** Returns the bytes held by the spikes buffered for PCA, their sums and the templates */
+    int64 getMemoryFootprint();
 private:
+    /** Publishes the units for the processing thread when it goes out of scope, which the
+        methods changing units declare after taking the lock */
+    struct ScopedRulesUpdate
+    {
+        ScopedRulesUpdate(SpikeSortBoxes& o) : owner(o) {}
+        ~ScopedRulesUpdate() { owner.publishSortingRules(); }
+        SpikeSortBoxes& owner;
+    };
+
+    void publishSortingRules();
+
+    ScopedPointer<SortingRules> rules;      // sorted with, only changed by the processing thread
+    Atomic<SortingRules*> pendingRules;     // published by the editing threads, not yet taken
+    Atomic<SortingRules*> retiredRules;     // replaced by the processing thread, to be deleted
+    SpinLock statsLock;                     // guards the mean waveforms of the units sorted with
+
     //void  StartCriticalSection();
     //void  EndCriticalSection();
     UniqueIDgenerator* uniqueIDgenerator;
@@ -306,9 +410,34 @@ private:
     SorterSpikeArray spikeBuffer;
     int bufferSize,spikeBufferIndex;
     PCAcomputingThread* computingThread;
+    PCAJobPtr currentJob;
     bool bPCAJobSubmitted,bPCAcomputed,bRePCA;
+    bool bHasComponents;
     std::atomic<bool> bPCAjobFinished ;
 
+    /** Adds weight times a spike to the sums over the spike buffer */
+    void addToSpikeSums(SorterSpikePtr so, double weight);
+    /** Empties the spike buffer and sizes its sums for the waveforms */
+    void resetSpikeSums();
+
+    HeapBlock<double> spikeSums;        // sum of the spikes in the buffer
+    HeapBlock<double> spikeProducts;    // sum of their outer products, upper half only
+    int numSummedSpikes;
+
+    /** Drops the templates of units that no longer exist */
+    void pruneTemplates();
+    void addTemplate(int unitID, const float* waveform);
+
+    /** Loads the units and templates from the SORTING_DATA blob, returning false without
+        changing anything if there is none that can be read */
+    bool loadSortingData(const XmlElement* spikesortNode);
+    /** Loads them from the elements settings had before the blob */
+    void loadSortingXml(const XmlElement* spikesortNode, const XmlElement* pcaNode);
+
+    std::vector<float> templates;           // one row of numChannels * waveformLength per template
+    std::vector<float> templateEnergies;    // the sum of squares of each row
+    std::vector<int> templateUnitIDs;
+
 
 };
 
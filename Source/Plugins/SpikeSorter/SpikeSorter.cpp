@@ -47,6 +47,9 @@ SpikeSorter::SpikeSorter()
     autoDACassignment = false;
     syncThresholds = false;
     flipSignal = false;
+    thresholdMultiplier = 0.0f;
+    templateMatching = false;
+    templateRejection = 30.0f;
 }
 
 bool SpikeSorter::getFlipSignalState()
@@ -95,6 +98,61 @@ void SpikeSorter::setThresholdSyncStatus(bool status)
     syncThresholds= status;
 }
 
+float SpikeSorter::getThresholdMultiplier()
+{
+    return thresholdMultiplier;
+}
+
+void SpikeSorter::setThresholdMultiplier(float multiplier)
+{
+    thresholdMultiplier = jmax(0.0f, multiplier);
+}
+
+bool SpikeSorter::getTemplateMatching()
+{
+    return templateMatching;
+}
+
+void SpikeSorter::setTemplateMatching(bool state)
+{
+    templateMatching = state;
+}
+
+float SpikeSorter::getTemplateRejection()
+{
+    return templateRejection;
+}
+
+void SpikeSorter::setTemplateRejection(float rejectionRMS)
+{
+    templateRejection = jmax(0.0f, rejectionRMS);
+}
+
+int SpikeSorter::learnTemplates()
+{
+    int numTemplates = 0;
+
+    mut.enter();
+    for (int i = 0; i < electrodes.size(); i++)
+        numTemplates += electrodes[i]->spikeSort->learnTemplates();
+    mut.exit();
+
+    return numTemplates;
+}
+
+
+int64 SpikeSorter::getMemoryFootprint() const
+{
+    int64 bytes = GenericProcessor::getMemoryFootprint();
+
+    // electrodes are only added and removed from the message thread, as this is called, so
+    // there is no need to hold up the processing thread by taking mut
+    for (int i = 0; i < electrodes.size(); i++)
+        bytes += electrodes[i]->spikeSort->getMemoryFootprint();
+
+    return bytes;
+}
+
 
 void SpikeSorter::seteAutoDacAssignment(bool status)
 {
@@ -207,6 +265,8 @@ void SpikeSorter::updateSettings()
 		SpikeChannel* spk = new SpikeChannel(SpikeChannel::typeFromNumChannels(nChans), this, chans);
 		spk->setNumSamples(elec->prePeakSamples, elec->postPeakSamples);
 		spk->addEventMetaData(new MetaDataDescriptor(MetaDataDescriptor::UINT8, 3, "Color", "Color of the spike", "graphics.color"));
+		spk->addEventMetaData(SpikeFeatures::createDescriptor(nChans));
+		spk->addEventMetaData(SpikeFeatures::createProjectionDescriptor());
 
         spikeChannelArray.add(spk);
     }
@@ -221,10 +281,11 @@ Electrode::~Electrode()
     delete[] isActive;
     delete[] voltageScale;
     delete[] channels;
-    delete[] runningStats;
+    delete[] noiseEstimators;
 }
 
 Electrode::Electrode(int ID, UniqueIDgenerator* uniqueIDgenerator_, PCAcomputingThread* pth, String _name, int _numChannels, int* _channels, float default_threshold, int pre, int post, float samplingRate , int sourceId, int subIdx)
+    : plotFifo(numElementsInArray(plotSpikes))
 {
     electrodeID = ID;
     computingThread = pth;
@@ -237,11 +298,14 @@ Electrode::Electrode(int ID, UniqueIDgenerator* uniqueIDgenerator_, PCAcomputing
     prePeakSamples = pre;
     postPeakSamples = post;
 
-    thresholds = new double[numChannels];
-    isActive = new bool[numChannels];
+    thresholds = new std::atomic<double>[numChannels];
+    spikeThresholds.ensureStorageAllocated(numChannels);
+    spikeFeatures.malloc(numChannels * SPIKE_FEATURES_PER_CHANNEL);
+    sampleIndex = 0;
+    isActive = new std::atomic<bool>[numChannels];
     channels = new int[numChannels];
     voltageScale = new double[numChannels];
-    runningStats = new RunningStat[numChannels];
+    noiseEstimators = new NoiseEstimator[numChannels];
     depthOffsetMM = 0.0;
 
     advancerID = -1;
@@ -252,6 +316,7 @@ Electrode::Electrode(int ID, UniqueIDgenerator* uniqueIDgenerator_, PCAcomputing
         thresholds[i] = default_threshold;
         isActive[i] = true;
         voltageScale[i] = 500;
+        noiseEstimators[i].setSampleRate(samplingRate);
     }
     spikePlot = nullptr;
 
@@ -275,6 +340,45 @@ void Electrode::resizeWaveform(int numPre, int numPost)
 
 }
 
+void Electrode::pushSpikeToPlot(SorterSpikePtr spike)
+{
+    int start1, size1, start2, size2;
+    plotFifo.prepareToWrite(1, start1, size1, start2, size2);
+
+    if (size1 > 0)
+    {
+        plotSpikes[start1] = spike;
+        plotFifo.finishedWrite(1);
+    }
+}
+
+void Electrode::updateSpikePlot()
+{
+    int start1, size1, start2, size2;
+    plotFifo.prepareToRead(plotFifo.getNumReady(), start1, size1, start2, size2);
+
+    for (int k = 0; k < size1 + size2; k++)
+    {
+        SorterSpikePtr& spike = plotSpikes[k < size1 ? start1 + k : start2 + k - size1];
+
+        if (spikePlot != nullptr)
+            spikePlot->processSpikeObject(spike);
+
+        // the pool can only use it again once let go of here
+        spike = nullptr;
+    }
+
+    plotFifo.finishedRead(size1 + size2);
+
+    if (spikePlot != nullptr && spikeSort->isPCAfinished())
+    {
+        spikeSort->resetJobStatus();
+        float p1min,p2min, p1max,  p2max;
+        spikeSort->getPCArange(p1min,p2min, p1max,  p2max);
+        spikePlot->setPCARange(p1min,p2min, p1max,  p2max);
+    }
+}
+
 void SpikeSorter::setElectrodeVoltageScale(int electrodeID, int index, float newvalue)
 {
     std::vector<float> values;
@@ -593,16 +697,13 @@ void SpikeSorter::setChannelActive(int electrodeIndex, int subChannel, bool acti
 
 bool SpikeSorter::isChannelActive(int electrodeIndex, int i)
 {
-    mut.enter();
-    bool b= *(electrodes[electrodeIndex]->isActive+i);
-    mut.exit();
-    return b;
+    return *(electrodes[electrodeIndex]->isActive+i);
 }
 
 
+// thresholds are atomics, so that dragging them never waits for a block to be processed
 void SpikeSorter::setChannelThreshold(int electrodeNum, int channelNum, float thresh)
 {
-    mut.enter();
     currentElectrode = electrodeNum;
     currentChannelIndex = channelNum;
     electrodes[electrodeNum]->thresholds[channelNum] = thresh;
@@ -620,22 +721,18 @@ void SpikeSorter::setChannelThreshold(int electrodeNum, int channelNum, float th
         }
     }
 
-    mut.exit();
     setParameter(99, thresh);
 }
 
 double SpikeSorter::getChannelThreshold(int electrodeNum, int channelNum)
 {
-    mut.enter();
     double f= *(electrodes[electrodeNum]->thresholds+channelNum);
-    mut.exit();
     return f;
 }
 
 void SpikeSorter::setParameter(int parameterIndex, float newValue)
 {
     //editor->updateParameterButtons(parameterIndex);
-    mut.enter();
     if (parameterIndex == 99 && currentElectrode > -1)
     {
         *(electrodes[currentElectrode]->thresholds+currentChannelIndex) = newValue;
@@ -647,7 +744,6 @@ void SpikeSorter::setParameter(int parameterIndex, float newValue)
         else
             *(electrodes[currentElectrode]->isActive+currentChannelIndex) = true;
     }
-    mut.exit();
 }
 
 
@@ -663,8 +759,18 @@ bool SpikeSorter::enable()
 	}
 
     for (int i = 0; i < electrodes.size(); i++)
+    {
         useOverflowBuffer.add(false);
 
+        for (int j = 0; j < electrodes[i]->numChannels; j++)
+        {
+            const DataChannel* channel = getDataChannel(electrodes[i]->channels[j]);
+
+            if (channel != nullptr)
+                electrodes[i]->noiseEstimators[j].setSampleRate(channel->getSampleRate());
+        }
+    }
+
 
     SpikeSorterEditor* editor = (SpikeSorterEditor*) getEditor();
     editor->enable();
@@ -701,24 +807,20 @@ Electrode* SpikeSorter::getActiveElectrode()
 
 
 void SpikeSorter::addWaveformToSpikeObject(SpikeEvent::SpikeBuffer& s,
-                                           int& peakIndex,
-                                           int& electrodeNumber,
-                                           int& currentChannel)
+                                           Electrode* electrode,
+                                           int currentChannel)
 {
-    mut.enter();
-	int spikeLength = electrodes[electrodeNumber]->prePeakSamples
-		+ electrodes[electrodeNumber]->postPeakSamples;
-
+	int spikeLength = electrode->prePeakSamples
+		+ electrode->postPeakSamples;
 
-	const int chan = *(electrodes[electrodeNumber]->channels + currentChannel);
 
-	if (isChannelActive(electrodeNumber, currentChannel))
+	if (*(electrode->isActive + currentChannel))
 	{
 
 		for (int sample = 0; sample < spikeLength; ++sample)
 		{
-			s.set(currentChannel, sample, getNextSample(*(electrodes[electrodeNumber]->channels + currentChannel)));
-			++sampleIndex;
+			s.set(currentChannel, sample, getNextSample(electrode, *(electrode->channels + currentChannel)));
+			++electrode->sampleIndex;
 
 			//std::cout << currentIndex << std::endl;
 		}
@@ -729,13 +831,12 @@ void SpikeSorter::addWaveformToSpikeObject(SpikeEvent::SpikeBuffer& s,
 		{
 			// insert a blank spike if the
 			s.set(currentChannel, sample, 0);
-			++sampleIndex;
+			++electrode->sampleIndex;
 			//std::cout << currentIndex << std::endl;
 		}
 	}
 
-	sampleIndex -= spikeLength; // reset sample index
-    mut.exit();
+	electrode->sampleIndex -= spikeLength; // reset sample index
 
 }
 
@@ -829,7 +930,7 @@ float SpikeSorter::getSelectedElectrodeNoise()
         return 0.0;
 
     // TODO, change "0" to active channel to support tetrodes.
-    return electrodes[currentElectrode]->runningStats[0].StandardDeviation();
+    return electrodes[currentElectrode]->noiseEstimators[0].getNoiseLevel();
 }
 
 
@@ -838,7 +939,7 @@ void SpikeSorter::clearRunningStatForSelectedElectrode()
     if (electrodes.size() == 0)
         return;
     // TODO, change "0" to active channel to support tetrodes.
-    electrodes[currentElectrode]->runningStats[0].Clear();
+    electrodes[currentElectrode]->noiseEstimators[0].reset();
 }
 
 void SpikeSorter::process(AudioSampleBuffer& buffer)
@@ -846,198 +947,241 @@ void SpikeSorter::process(AudioSampleBuffer& buffer)
 
     //printf("Entering Spike Detector::process\n");
     mut.enter();
-    uint16_t samplingFrequencyHz = getSampleRate();//buffer.getSamplingFrequency();
-    // cycle through electrodes
-    Electrode* electrode;
     dataBuffer = &buffer;
-	const SpikeChannel* spikeChan;
 
     //channelBuffers->update(buffer, hardware_timestamp,software_timestamp, nSamples);
 
+    // the electrodes are independent, so they are spread over the channel thread pool as channels would be
+    processChannelsInParallel(buffer, electrodes.size());
+
+    // the spikes are then sent in order of time, and of electrode for the same sample
+    pendingSpikes.clearQuick();
+
     for (int i = 0; i < electrodes.size(); i++)
     {
+        for (int k = 0; k < electrodes[i]->spikeEvents.size(); k++)
+        {
+            PendingSpike spike = { electrodes[i]->spikeSampleNumbers.getUnchecked(k), i, k };
+            pendingSpikes.add(spike);
+        }
+    }
 
-        //  std::cout << "ELECTRODE " << i << std::endl;
+    std::sort(pendingSpikes.begin(), pendingSpikes.end());
 
-        electrode = electrodes[i];
-		spikeChan = spikeChannelArray[i];
+    for (int n = 0; n < pendingSpikes.size(); n++)
+    {
+        const PendingSpike& spike = pendingSpikes.getReference(n);
+        addSpike(spikeChannelArray[spike.electrode], electrodes[spike.electrode]->spikeEvents[spike.index], spike.sampleNumber);
+    }
 
-        // refresh buffer index for this electrode
-        sampleIndex = electrode->lastBufferIndex - 1; // subtract 1 to account for
-        // increment at start of getNextSample()
+    // the ends of the buffers are only kept for the next one once no electrode reads the previous ones
+    for (int i = 0; i < electrodes.size(); i++)
+    {
+        Electrode* electrode = electrodes[i];
+        const int nSamples = getNumSamples(*electrode->channels);
 
-        int nSamples = getNumSamples(*electrode->channels); // get the number of samples for this buffer
+        electrode->spikeEvents.clear();
+        electrode->spikeSampleNumbers.clearQuick();
 
-        // cycle through samples
-        while (samplesAvailable(nSamples))
+        if (nSamples > overflowBufferSize)
         {
 
-            sampleIndex++;
-
-            // cycle through channels
-            for (int chan = 0; chan < electrode->numChannels; chan++)
+            for (int j = 0; j < electrode->numChannels; j++)
             {
+                //std::cout << "Processing " << *electrode->channels+i << std::endl;
 
-                // std::cout << "  channel " << chan << std::endl;
+                overflowBuffer.copyFrom(*(electrode->channels+j), 0,
+                                        buffer, *(electrode->channels+j),
+                                        nSamples-overflowBufferSize,
+                                        overflowBufferSize);
 
-                if (*(electrode->isActive+chan))
-                {
-                    //float v = getNextSample(currentChannel);
+            }
 
-                    int currentChannel = electrode->channels[chan];
-                    float currentValue = getNextSample(currentChannel);
-                    electrode->runningStats[chan].Push(currentValue);
+            useOverflowBuffer.set(i, true);
 
-                    bool bSpikeDetectedPositive  = electrode->thresholds[chan] > 0 &&
-                                                   (currentValue > electrode->thresholds[chan]); // rising edge
-                    bool bSpikeDetectedNegative = electrode->thresholds[chan] < 0 &&
-                                                  (currentValue < electrode->thresholds[chan]); // falling edge
+        }
+        else
+        {
+            useOverflowBuffer.set(i, false);
+        }
+    } // end cycle through electrodes
 
-                    if (bSpikeDetectedPositive || bSpikeDetectedNegative)
-                    {
 
-                        //std::cout << "Spike detected on electrode " << i << std::endl;
-                        // find the peak
-                        int peakIndex = sampleIndex;
+    mut.exit();
+    //printf("Exitting Spike Detector::process\n");
+}
 
-                        //if (sampleIndex == 0 && i == 0)
-                        //    std::cout << getCurrentSample(currentChannel) << std::endl;
+bool SpikeSorter::isChannelParallelSafe() const
+{
+    return true;
+}
 
-                        if (bSpikeDetectedPositive)
-                        {
-                            // find localmaxima
-                            while (getCurrentSample(currentChannel) < getNextSample(currentChannel) &&
-                                   sampleIndex < peakIndex + electrode->postPeakSamples)
-                            {
-                                sampleIndex++;
-                            }
-                        }
-                        else
-                        {
-                            // find local minimum
+void SpikeSorter::processChannels(AudioSampleBuffer& buffer, int firstElectrode, int lastElectrode)
+{
+    for (int i = firstElectrode; i < lastElectrode; i++)
+        processElectrode(i, buffer);
+}
 
-                            while (getCurrentSample(currentChannel) > getNextSample(currentChannel) &&
-                                   sampleIndex < peakIndex + electrode->postPeakSamples)
-                            {
-                                sampleIndex++;
-                            }
-                        }
+void SpikeSorter::processElectrode(int i, AudioSampleBuffer& buffer)
+{
+    Electrode* electrode = electrodes[i];
 
-                        peakIndex = sampleIndex;
-                        sampleIndex -= (electrode->prePeakSamples+1);
-
-						const SpikeChannel* spikeChan = getSpikeChannel(i);
-						SpikeEvent::SpikeBuffer spikeData(spikeChan);
-						Array<float> thresholds;
-						for (int channel = 0; channel < electrode->numChannels; ++channel)
-						{
-							addWaveformToSpikeObject(spikeData,
-								peakIndex,
-								i,
-								channel);
-							thresholds.add((int)*(electrode->thresholds + channel));
-						}
-						int64 timestamp = getTimestamp(electrode->channels[0]) + peakIndex;
-
-						SorterSpikePtr sorterSpike = new SorterSpikeContainer(spikeChan, spikeData, timestamp);
-
-                        /*
-                        bool perfectMatch = true;
-                        for (int k=0;k<40;k++) {
-                        	perfectMatch = perfectMatch & (prevSpike.data[k] == newSpike.data[k]);
-                        }
-                        if (perfectMatch)
-                        {
-                        	int x;
-                        	x++;
-                        }
-                        */
+    // units edited since the last block are sorted with from this one
+    electrode->spikeSort->updateSortingRules();
 
-                        //for (int xxx = 0; xxx < 1000; xxx++) // overload with spikes for testing purposes
-						electrode->spikeSort->projectOnPrincipalComponents(sorterSpike);
+    int nSamples = getNumSamples(*electrode->channels); // get the number of samples for this buffer
 
-                        // Add spike to drawing buffer....
-						electrode->spikeSort->sortSpike(sorterSpike, PCAbeforeBoxes);
+    // samples are searched from the electrode's buffer index up to this one
+    const int lastIndex = nSamples - overflowBufferSize / 2 + 1;
 
+    electrode->thresholdDetector.setNumChannels(electrode->numChannels);
 
-                        // transfer buffered spikes to spike plot
-                        if (electrode->spikePlot != nullptr)
-                        {
-                            if (electrode->spikeSort->isPCAfinished())
-                            {
-                                electrode->spikeSort->resetJobStatus();
-                                float p1min,p2min, p1max,  p2max;
-                                electrode->spikeSort->getPCArange(p1min,p2min, p1max,  p2max);
-                                electrode->spikePlot->setPCARange(p1min,p2min, p1max,  p2max);
-                            }
+    for (int chan = 0; chan < electrode->numChannels; chan++)
+    {
+        if (! *(electrode->isActive+chan))
+            continue;
 
+        const int currentChannel = electrode->channels[chan];
+        NoiseEstimator& noiseEstimator = electrode->noiseEstimators[chan];
 
-							electrode->spikePlot->processSpikeObject(sorterSpike);
-                        }
+        noiseEstimator.pushSamples(buffer.getReadPointer(currentChannel), getNumSamples(currentChannel));
 
-						MetaDataValueArray md;
-						md.add(new MetaDataValue(MetaDataDescriptor::UINT8, 3, sorterSpike->color));
-						SpikeEventPtr newSpike = SpikeEvent::createSpikeEvent(spikeChan, timestamp, thresholds, spikeData, sorterSpike->sortedId, md);
+        // adaptive thresholds keep their sign, going negative from 0
+        if (thresholdMultiplier > 0 && noiseEstimator.isReady())
+            electrode->thresholds[chan] = (electrode->thresholds[chan] > 0 ? 1 : -1)
+                                          * thresholdMultiplier * noiseEstimator.getNoiseLevel();
 
-                        addSpike(spikeChan, newSpike, peakIndex);
-                        //prevSpike = newSpike;
-                        // advance the sample index
-                        sampleIndex = peakIndex + electrode->postPeakSamples;
+        const double threshold = electrode->thresholds[chan];
 
-                        break; // quit spike "for" loop
-                    } // end spike trigger
+        // positive thresholds are crossed on a rising edge, negative ones on a falling edge
+        if (threshold != 0)
+            electrode->thresholdDetector.setChannel(chan,
+                                                    overflowBuffer.getReadPointer(currentChannel), overflowBufferSize,
+                                                    buffer.getReadPointer(currentChannel), getNumSamples(currentChannel),
+                                                    threshold,
+                                                    threshold > 0 ? ThresholdDetector::ABOVE : ThresholdDetector::BELOW);
+    }
 
-                } // end if channel is active
-            } // end cycle through channels on electrode
+    int nextIndex = electrode->lastBufferIndex;
+    int crossingIndex, crossingChannel;
 
+    // jump from one threshold crossing to the next
+    while (nextIndex <= lastIndex
+           && electrode->thresholdDetector.findNextCrossing(nextIndex, lastIndex, crossingIndex, crossingChannel))
+    {
+        electrode->sampleIndex = crossingIndex;
 
-        } // end cycle through samples
+        int currentChannel = electrode->channels[crossingChannel];
+        bool bSpikeDetectedPositive = electrode->thresholds[crossingChannel] > 0;
 
-        //float vv = getNextSample(currentChannel);
-        electrode->lastBufferIndex = sampleIndex - nSamples; // should be negative
+        //std::cout << "Spike detected on electrode " << i << std::endl;
+        // find the peak
+        int peakIndex = electrode->sampleIndex;
 
-        //jassert(electrode->lastBufferIndex < 0);
+        //if (sampleIndex == 0 && i == 0)
+        //    std::cout << getCurrentSample(electrode, currentChannel) << std::endl;
 
-        if (nSamples > overflowBufferSize)
+        if (bSpikeDetectedPositive)
+        {
+            // find localmaxima
+            while (getCurrentSample(electrode, currentChannel) < getNextSample(electrode, currentChannel) &&
+                   electrode->sampleIndex < peakIndex + electrode->postPeakSamples)
+            {
+                electrode->sampleIndex++;
+            }
+        }
+        else
         {
+            // find local minimum
 
-            for (int j = 0; j < electrode->numChannels; j++)
+            while (getCurrentSample(electrode, currentChannel) > getNextSample(electrode, currentChannel) &&
+                   electrode->sampleIndex < peakIndex + electrode->postPeakSamples)
             {
-                //std::cout << "Processing " << *electrode->channels+i << std::endl;
+                electrode->sampleIndex++;
+            }
+        }
 
-                overflowBuffer.copyFrom(*(electrode->channels+j), 0,
-                                        buffer, *(electrode->channels+j),
-                                        nSamples-overflowBufferSize,
-                                        overflowBufferSize);
+        peakIndex = electrode->sampleIndex;
+        electrode->sampleIndex -= (electrode->prePeakSamples+1);
 
-            }
+		const SpikeChannel* spikeChan = getSpikeChannel(i);
+		SpikeEvent::SpikeBuffer spikeData(spikeChan);
+		Array<float>& thresholds = electrode->spikeThresholds;
+		thresholds.clearQuick();
+		for (int channel = 0; channel < electrode->numChannels; ++channel)
+		{
+			addWaveformToSpikeObject(spikeData, electrode, channel);
+			thresholds.add((int)*(electrode->thresholds + channel));
+		}
+		int64 timestamp = getTimestamp(electrode->channels[0]) + peakIndex;
 
-            useOverflowBuffer.set(i, true);
+		SorterSpikePtr sorterSpike = electrode->spikePool.getSpike(spikeChan, spikeData, timestamp);
 
+        /*
+        bool perfectMatch = true;
+        for (int k=0;k<40;k++) {
+        	perfectMatch = perfectMatch & (prevSpike.data[k] == newSpike.data[k]);
         }
-        else
+        if (perfectMatch)
         {
-            useOverflowBuffer.set(i, false);
+        	int x;
+        	x++;
         }
+        */
 
-    } // end cycle through electrodes
+        //for (int xxx = 0; xxx < 1000; xxx++) // overload with spikes for testing purposes
+		electrode->spikeSort->projectOnPrincipalComponents(sorterSpike);
+
+        // Add spike to drawing buffer....
+        if (templateMatching)
+            electrode->spikeSort->sortSpikeByTemplates(sorterSpike, templateRejection);
+        else
+            electrode->spikeSort->sortSpike(sorterSpike, PCAbeforeBoxes);
 
 
-    mut.exit();
-    //printf("Exitting Spike Detector::process\n");
+        // the canvas takes the spike on its next refresh, so that drawing never holds up processing
+        if (electrode->spikePlot != nullptr)
+            electrode->pushSpikeToPlot(sorterSpike);
+
+		// computed once here for every consumer downstream, with the projections the sorting used
+		SpikeFeatures::compute(sorterSpike->getData(), electrode->numChannels, spikeChan->getTotalSamples(), electrode->spikeFeatures);
+
+		MetaDataValueArray md;
+		md.add(new MetaDataValue(MetaDataDescriptor::UINT8, 3, sorterSpike->color));
+		md.add(new MetaDataValue(MetaDataDescriptor::FLOAT, electrode->numChannels * SPIKE_FEATURES_PER_CHANNEL, electrode->spikeFeatures.getData()));
+		md.add(new MetaDataValue(MetaDataDescriptor::FLOAT, 2, sorterSpike->pcProj));
+		SpikeEventPtr newSpike = SpikeEvent::createSpikeEvent(spikeChan, timestamp, thresholds, spikeData, sorterSpike->sortedId, md);
+
+        // sent once all the electrodes are done
+        electrode->spikeEvents.add(newSpike.release());
+        electrode->spikeSampleNumbers.add(peakIndex);
+        //prevSpike = newSpike;
+        // advance the sample index
+        electrode->sampleIndex = peakIndex + electrode->postPeakSamples;
+
+        nextIndex = electrode->sampleIndex + 1;
+    }
+
+    // the last sample searched, searched again with the next buffer
+    electrode->sampleIndex = jmax(nextIndex, lastIndex + 1) - 1;
+
+    //float vv = getNextSample(electrode, currentChannel);
+    electrode->lastBufferIndex = electrode->sampleIndex - nSamples; // should be negative
+
+    //jassert(electrode->lastBufferIndex < 0);
 }
 
-float SpikeSorter::getNextSample(int& chan)
+float SpikeSorter::getNextSample(const Electrode* electrode, int chan)
 {
 
 
 
     //if (useOverflowBuffer)
     //{
-    if (sampleIndex < 0)
+    if (electrode->sampleIndex < 0)
     {
         // std::cout << "  sample index " << sampleIndex << "from overflowBuffer" << std::endl;
-        int ind = overflowBufferSize + sampleIndex;
+        int ind = overflowBufferSize + electrode->sampleIndex;
 
         if (ind < overflowBuffer.getNumSamples())
             return (*overflowBuffer.getReadPointer(chan, ind));
@@ -1050,8 +1194,8 @@ float SpikeSorter::getNextSample(int& chan)
         //  useOverflowBuffer = false;
         // std::cout << "  sample index " << sampleIndex << "from regular buffer" << std::endl;
 
-        if (sampleIndex < getNumSamples(chan))
-            return (*dataBuffer->getReadPointer(chan, sampleIndex));
+        if (electrode->sampleIndex < (int) getNumSamples(chan))
+            return (*dataBuffer->getReadPointer(chan, electrode->sampleIndex));
         else
             return 0;
     }
@@ -1062,7 +1206,7 @@ float SpikeSorter::getNextSample(int& chan)
 
 }
 
-float SpikeSorter::getCurrentSample(int& chan)
+float SpikeSorter::getCurrentSample(const Electrode* electrode, int chan)
 {
 
     // if (useOverflowBuffer)
@@ -1072,35 +1216,22 @@ float SpikeSorter::getCurrentSample(int& chan)
     //     return *dataBuffer.getSampleData(chan, sampleIndex - 1);
     // }
 
-    if (sampleIndex < 1)
+    if (electrode->sampleIndex < 1)
     {
         //std::cout << "  sample index " << sampleIndex << "from overflowBuffer" << std::endl;
-        return (*overflowBuffer.getReadPointer(chan, overflowBufferSize + sampleIndex - 1)) ;
+        return (*overflowBuffer.getReadPointer(chan, overflowBufferSize + electrode->sampleIndex - 1)) ;
     }
     else
     {
         //  useOverflowBuffer = false;
         // std::cout << "  sample index " << sampleIndex << "from regular buffer" << std::endl;
-        return (*dataBuffer->getReadPointer(chan, sampleIndex - 1));
+        return (*dataBuffer->getReadPointer(chan, electrode->sampleIndex - 1));
     }
     //} else {
 
 }
 
 
-bool SpikeSorter::samplesAvailable(int nSamples)
-{
-
-    if (sampleIndex > nSamples - overflowBufferSize/2)
-    {
-        return false;
-    }
-    else
-    {
-        return true;
-    }
-
-}
 
 void SpikeSorter::addProbes(String probeType,int numProbes, int nElectrodesPerProbe, int nChansPerElectrode,  double firstContactOffset, double interelectrodeDistance)
 {
@@ -1185,6 +1316,9 @@ void SpikeSorter::saveCustomParametersToXml(XmlElement* parentElement)
     mainNode->setAttribute("syncThresholds",syncThresholds);
     mainNode->setAttribute("uniqueID",uniqueID);
     mainNode->setAttribute("flipSignal",flipSignal);
+    mainNode->setAttribute("thresholdMultiplier",thresholdMultiplier);
+    mainNode->setAttribute("templateMatching",templateMatching);
+    mainNode->setAttribute("templateRejection",templateRejection);
 
     XmlElement* countNode = mainNode->createNewChildElement("ELECTRODE_COUNTER");
 
@@ -1247,6 +1381,9 @@ void SpikeSorter::loadCustomParametersFromXml()
                 syncThresholds = mainNode->getBoolAttribute("syncThresholds");
                 uniqueID = mainNode->getIntAttribute("uniqueID");
                 flipSignal = mainNode->getBoolAttribute("flipSignal");
+                thresholdMultiplier = (float) mainNode->getDoubleAttribute("thresholdMultiplier", 0.0);
+                templateMatching = mainNode->getBoolAttribute("templateMatching", false);
+                templateRejection = (float) mainNode->getDoubleAttribute("templateRejection", 30.0);
 
                 forEachXmlChildElement(*mainNode, xmlNode)
                 {
@@ -25,6 +25,7 @@
 #define __SPIKESORTER_H_3F920F95__
 
 #include <ProcessorHeaders.h>
+#include <SpikeLib.h>
 #include "SpikeSorterEditor.h"
 #include "SpikeSortBoxes.h"
 #include <algorithm>    // std::sort
@@ -88,63 +89,6 @@ private:
     int globalUniqueID;
 };
 
-/* snatched from http://www.johndcook.com/blog/standard_deviation/ */
-class RunningStat
-{
-public:
-    RunningStat() : m_n(0) {}
-
-    void Clear()
-    {
-        m_n = 0;
-    }
-
-    void Push(double x)
-    {
-        m_n++;
-
-        // See Knuth TAOCP vol 2, 3rd edition, page 232
-        if (m_n == 1)
-        {
-            m_oldM = m_newM = x;
-            m_oldS = 0.0;
-        }
-        else
-        {
-            m_newM = m_oldM + (x - m_oldM) / m_n;
-            m_newS = m_oldS + (x - m_oldM)*(x - m_newM);
-
-            // set up for next iteration
-            m_oldM = m_newM;
-            m_oldS = m_newS;
-        }
-    }
-
-    int NumDataValues() const
-    {
-        return m_n;
-    }
-
-    double Mean() const
-    {
-        return (m_n > 0) ? m_newM : 0.0;
-    }
-
-    double Variance() const
-    {
-        return ((m_n > 1) ? m_newS / (m_n - 1) : 0.0);
-    }
-
-    double StandardDeviation() const
-    {
-        return sqrt(Variance());
-    }
-
-private:
-    int m_n;
-    double m_oldM, m_newM, m_oldS, m_newS;
-};
-
 class Electrode
 {
 public:
@@ -153,6 +97,12 @@ public:
 
     void resizeWaveform(int numPre, int numPost);
 
+    /** Queues a sorted spike for the spike plot, from the processing thread. The spike
+        is dropped if the plot has fallen too far behind. */
+    void pushSpikeToPlot(SorterSpikePtr spike);
+    /** Hands the queued spikes and any new PCA range to the spike plot, from the message thread */
+    void updateSpikePlot();
+
     String name;
 
     int numChannels;
@@ -166,12 +116,13 @@ public:
     int sourceNodeId_;
 	int sourceSubIdx;
     int* channels;
-    double* thresholds;
-    bool* isActive;
+    /** Set by the editor and read by the processing threads once per block, without locking */
+    std::atomic<double>* thresholds;
+    std::atomic<bool>* isActive;
     double* voltageScale;
     //float PCArange[4];
 
-    RunningStat* runningStats;
+    NoiseEstimator* noiseEstimators;
     SpikeHistogramPlot* spikePlot;
     
     PCAcomputingThread* computingThread;
@@ -179,6 +130,23 @@ public:
 
 	ScopedPointer<SpikeSortBoxes> spikeSort;
     bool isMonitored;
+
+    SorterSpikePool spikePool;
+    Array<float> spikeThresholds;
+    HeapBlock<float> spikeFeatures;
+
+    /** Finds the threshold crossings of the electrode */
+    ThresholdDetector thresholdDetector;
+    /** The sample being read, from the start of the buffer being processed */
+    int sampleIndex;
+
+    /** The spikes found in the buffer being processed, and their sample numbers */
+    OwnedArray<SpikeEvent> spikeEvents;
+    Array<int> spikeSampleNumbers;
+
+private:
+    AbstractFifo plotFifo;
+    SorterSpikePtr plotSpikes[256];
 };
 
 class ContinuousCircularBuffer
@@ -231,6 +199,11 @@ public:
         spikes into the event buffer. */
     void process(AudioSampleBuffer& buffer) override;
 
+    /** Each electrode only touches its own state, so several can be processed at once */
+    bool isChannelParallelSafe() const override;
+    /** Detects and sorts the spikes of the electrodes from firstElectrode to lastElectrode - 1 */
+    void processChannels(AudioSampleBuffer& buffer, int firstElectrode, int lastElectrode) override;
+
     /** Used to alter parameters of data acquisition. */
     void setParameter(int parameterIndex, float newValue) override;
 
@@ -245,6 +218,10 @@ public:
 
 
     bool isReady() override;
+
+    /** Adds the spikes each electrode keeps for PCA and the sums they are sorted with */
+    int64 getMemoryFootprint() const override;
+
     /** Creates the SpikeSorterEditor. */
     AudioProcessorEditor* createEditor() override;
 
@@ -351,6 +328,19 @@ public:
     void updateDACthreshold(int dacChannel, float threshold);
     bool getThresholdSyncStatus();
     void setThresholdSyncStatus(bool status);
+    /** Makes every active channel's threshold follow this multiple of its noise level,
+        median(|x|) / 0.6745, or keeps the thresholds set by hand if 0. */
+    float getThresholdMultiplier();
+    void setThresholdMultiplier(float multiplier);
+    /** Sorts spikes by the nearest unit template rather than by boxes and polygons, leaving
+        those further than the rejection RMS difference, in microvolts, from every template unsorted */
+    bool getTemplateMatching();
+    void setTemplateMatching(bool state);
+    float getTemplateRejection();
+    void setTemplateRejection(float rejectionRMS);
+    /** Takes the templates of the units of every electrode from their mean waveforms, and
+        returns the number of templates */
+    int learnTemplates();
     bool getFlipSignalState();
     void setFlipSignalState(bool state);
     void startRecording();
@@ -402,12 +392,30 @@ private:
 
     int overflowBufferSize;
 
-    int sampleIndex;
-
     std::vector<int> electrodeCounter;
-    float getNextSample(int& chan);
-    float getCurrentSample(int& chan);
-    bool samplesAvailable(int nSamples);
+    float getNextSample(const Electrode* electrode, int chan);
+    float getCurrentSample(const Electrode* electrode, int chan);
+
+    /** Detects and sorts the spikes of one electrode, keeping the events found for process() to send */
+    void processElectrode(int electrodeIndex, AudioSampleBuffer& buffer);
+
+    /** A spike found by an electrode, waiting for the others to be done */
+    struct PendingSpike
+    {
+        int sampleNumber;
+        int electrode;
+        int index;
+
+        bool operator< (const PendingSpike& other) const
+        {
+            if (sampleNumber != other.sampleNumber)
+                return sampleNumber < other.sampleNumber;
+
+            return electrode != other.electrode ? electrode < other.electrode : index < other.index;
+        }
+    };
+
+    Array<PendingSpike> pendingSpikes;
 
     Array<bool> useOverflowBuffer;
 
@@ -426,6 +434,9 @@ private:
     CriticalSection mut;
     bool autoDACassignment;
     bool syncThresholds;
+    float thresholdMultiplier;
+    bool templateMatching;
+    float templateRejection;
  //   RHD2000Thread* getRhythmAccess();
     bool flipSignal;
 
@@ -434,9 +445,8 @@ private:
     Time timer;
 
     void addWaveformToSpikeObject(SpikeEvent::SpikeBuffer& s,
-                                  int& peakIndex,
-                                  int& electrodeNumber,
-                                  int& currentChannel);
+                                  Electrode* electrode,
+                                  int currentChannel);
 
 
     OwnedArray<Electrode> electrodes;
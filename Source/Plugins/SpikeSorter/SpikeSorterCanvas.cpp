@@ -72,6 +72,12 @@ SpikeSorterCanvas::SpikeSorterCanvas(SpikeSorter* n) :
     deleteAllUnits->addListener(this);
     addAndMakeVisible(deleteAllUnits);
 
+    openGLButton = new UtilityButton("OpenGL", Font("Small Text", 13, Font::plain));
+    openGLButton->setRadius(3.0f);
+    openGLButton->setClickingTogglesState(true);
+    openGLButton->addListener(this);
+    addAndMakeVisible(openGLButton);
+
     nextElectrode = new UtilityButton("Next Electrode", Font("Small Text", 13, Font::plain));
     nextElectrode->setRadius(3.0f);
     nextElectrode->addListener(this);
@@ -128,6 +134,7 @@ void SpikeSorterCanvas::update()
         processor->addSpikePlotForElectrode(sp, currentElectrode);
         electrode->spikePlot->setFlipSignal(processor->getFlipSignalState());
         electrode->spikePlot->updateUnitsFromProcessor();
+        electrode->spikePlot->setOpenGLRendering(openGLButton->getToggleState());
 
     }
     spikeDisplay->resized();
@@ -159,6 +166,7 @@ void SpikeSorterCanvas::resized()
 
     newIDbuttons->setBounds(0, 270, 120,20);
     deleteAllUnits->setBounds(0, 300, 120,20);
+    openGLButton->setBounds(0, 330, 120,20);
 
 }
 
@@ -180,13 +188,11 @@ void SpikeSorterCanvas::refresh()
 
 void SpikeSorterCanvas::processSpikeEvents()
 {
+    // only the active electrode has a spike plot
+    Electrode* e = processor->getActiveElectrode();
 
-
-    //Electrode* e = ((SpikeSorter*) processor)->getActiveElectrode();
-
-    //	e->spikeSort->lstLastSpikes
-    //    processor->setParameter(2, 0.0f); // request redraw
-
+    if (e != nullptr)
+        e->updateSpikePlot();
 }
 
 
@@ -402,6 +408,11 @@ void SpikeSorterCanvas::buttonClicked(Button* button)
         electrode->spikePlot->updateUnitsFromProcessor();
         processor->removeAllUnits(electrode->electrodeID);
     }
+    else if (button == openGLButton)
+    {
+        if (electrode != nullptr && electrode->spikePlot != nullptr)
+            electrode->spikePlot->setOpenGLRendering(openGLButton->getToggleState());
+    }
 
     repaint();
 }
@@ -643,6 +654,12 @@ void SpikeHistogramPlot::setPCARange(float p1min, float p2min, float p1max, floa
     pAxes[0]->setPCARange(p1min, p2min, p1max, p2max);
 }
 
+void SpikeHistogramPlot::setOpenGLRendering(bool isEnabled)
+{
+    const ScopedLock myScopedLock(mut);
+    pAxes[0]->setOpenGLRendering(isEnabled);
+}
+
 void SpikeHistogramPlot::processSpikeObject(SorterSpikePtr s)
 {
     const ScopedLock myScopedLock(mut);
@@ -1707,6 +1724,9 @@ PCAProjectionAxes::PCAProjectionAxes(SpikeSorter* p) : GenericDrawAxes(0), proce
 {
     projectionImage = Image(Image::RGB, imageDim, imageDim, true);
     bufferSize = 600;
+
+    glRenderer = new PCAPointCloudRenderer(openGLContext, bufferSize);
+    openGLContext.setRenderer(glRenderer);
     pcaMin[0] = pcaMin[1] = 0;
     pcaMax[0] = pcaMax[1] = 0;
 
@@ -1730,6 +1750,30 @@ PCAProjectionAxes::PCAProjectionAxes(SpikeSorter* p) : GenericDrawAxes(0), proce
 
 }
 
+PCAProjectionAxes::~PCAProjectionAxes()
+{
+    openGLContext.detach();
+}
+
+void PCAProjectionAxes::setOpenGLRendering(bool isEnabled)
+{
+    if (isEnabled == openGLContext.isAttached())
+        return;
+
+    if (isEnabled)
+        openGLContext.attachTo(*this);
+    else
+        openGLContext.detach();
+
+    redrawSpikes = true;
+    repaint();
+}
+
+bool PCAProjectionAxes::isDrawingWithOpenGL()
+{
+    return openGLContext.isAttached() && !glRenderer->hasFailed();
+}
+
 void PCAProjectionAxes::resized()
 {
 
@@ -1805,9 +1849,15 @@ void PCAProjectionAxes::paint(Graphics& g)
 
     spikesReceivedSinceLastRedraw = 0;
 
-    g.drawImage(projectionImage,
-                0, 0, getWidth(), getHeight(),
-                0, 0, rangeX, rangeY);
+    // the OpenGL renderer has drawn the spikes below this component already
+    const bool drawingWithOpenGL = isDrawingWithOpenGL();
+
+    if (!drawingWithOpenGL)
+    {
+        g.drawImage(projectionImage,
+                    0, 0, getWidth(), getHeight(),
+                    0, 0, rangeX, rangeY);
+    }
 
 
     // draw pca units polygons
@@ -1847,7 +1897,7 @@ void PCAProjectionAxes::paint(Graphics& g)
 
     //Graphics im(projectionImage);
 
-    if (redrawSpikes)
+    if (redrawSpikes && !drawingWithOpenGL)
     {
         // recompute image
         //int w = getWidth();
@@ -1911,6 +1961,7 @@ void PCAProjectionAxes::setPCARange(float p1min, float p2min, float p1max, float
     pcaMax[1] = p2max;
     rangeSet = true;
     redrawSpikes = true;
+    glRenderer->setRange(p1min, p2min, p1max, p2max);
     processor->getActiveElectrode()->spikeSort->setPCArange(p1min,p2min, p1max,  p2max);
 
 }
@@ -1925,6 +1976,7 @@ bool PCAProjectionAxes::updateSpikeData(SorterSpikePtr s)
         spikeIndex %= bufferSize;
 
         spikeBuffer.set(spikeIndex, s);
+        glRenderer->setPoint(spikeIndex, s);
 
         spikesReceivedSinceLastRedraw++;
         //drawProjectedSpike(newSpike);
@@ -1943,6 +1995,7 @@ void PCAProjectionAxes::clear()
 
     spikeBuffer.clear();
     spikeIndex = 0;
+    glRenderer->clearPoints();
 
     redrawSpikes = true;
     //repaint();
@@ -2188,3 +2241,220 @@ void PCAProjectionAxes::mouseWheelMove(const MouseEvent& event, const MouseWheel
     else
         rangeUp();
 }
+
+
+// ----------------------------------------------------------------
+
+PCAPointCloudRenderer::PCAPointCloudRenderer(OpenGLContext& context_, int numPoints)
+    : context(context_)
+    , vertexBuffer(0)
+    , numBufferVertices(0)
+    , numVertices(numPoints)
+    , uploadAll(true)
+    , dirtyFrom(0)
+    , dirtyTo(0)
+{
+    vertices.calloc(numVertices);
+
+    rangeMin[0] = rangeMin[1] = 0;
+    rangeMax[0] = rangeMax[1] = 0;
+}
+
+PCAPointCloudRenderer::~PCAPointCloudRenderer()
+{
+}
+
+bool PCAPointCloudRenderer::hasFailed() const
+{
+    return failed.get() != 0;
+}
+
+void PCAPointCloudRenderer::setPoint(int index, SorterSpikePtr s)
+{
+    if (index < 0 || index >= numVertices)
+        return;
+
+    const ScopedLock sl(lock);
+
+    PCAPointVertex& v = vertices[index];
+
+    if (s != nullptr)
+    {
+        v.x = s->pcProj[0];
+        v.y = s->pcProj[1];
+        v.colour[0] = s->color[0];
+        v.colour[1] = s->color[1];
+        v.colour[2] = s->color[2];
+        v.colour[3] = 255;
+    }
+    else
+    {
+        zerostruct(v);
+    }
+
+    if (dirtyFrom < dirtyTo)
+    {
+        dirtyFrom = jmin(dirtyFrom, index);
+        dirtyTo = jmax(dirtyTo, index + 1);
+    }
+    else
+    {
+        dirtyFrom = index;
+        dirtyTo = index + 1;
+    }
+}
+
+void PCAPointCloudRenderer::clearPoints()
+{
+    const ScopedLock sl(lock);
+
+    vertices.clear(numVertices);
+    uploadAll = true;
+}
+
+void PCAPointCloudRenderer::setRange(float xMin, float yMin, float xMax, float yMax)
+{
+    {
+        const ScopedLock sl(lock);
+
+        rangeMin[0] = xMin;
+        rangeMin[1] = yMin;
+        rangeMax[0] = xMax;
+        rangeMax[1] = yMax;
+    }
+
+    context.triggerRepaint();
+}
+
+void PCAPointCloudRenderer::newOpenGLContextCreated()
+{
+    const char* vertexShader =
+        "attribute vec2 position;\n"
+        "attribute vec4 colour;\n"
+        "uniform vec4 transform;\n"
+        "varying vec4 pointColour;\n"
+        "\n"
+        "void main()\n"
+        "{\n"
+        "    pointColour = colour;\n"
+        "    gl_Position = vec4 ((position - transform.xy) * transform.zw + vec2 (-1.0, 1.0), 0.0, 1.0);\n"
+        "}\n";
+
+    const char* fragmentShader =
+        "varying " JUCE_LOWP " vec4 pointColour;\n"
+        "\n"
+        "void main()\n"
+        "{\n"
+        "    gl_FragColor = pointColour;\n"
+        "}\n";
+
+    shader = new OpenGLShaderProgram(context);
+
+    if (shader->addVertexShader(OpenGLHelpers::translateVertexShaderToV3(vertexShader))
+        && shader->addFragmentShader(OpenGLHelpers::translateFragmentShaderToV3(fragmentShader))
+        && shader->link())
+    {
+        positionAttribute = new OpenGLShaderProgram::Attribute(*shader, "position");
+        colourAttribute = new OpenGLShaderProgram::Attribute(*shader, "colour");
+        transformUniform = new OpenGLShaderProgram::Uniform(*shader, "transform");
+
+        context.extensions.glGenBuffers(1, &vertexBuffer);
+        numBufferVertices = 0;
+        failed = 0;
+    }
+    else
+    {
+        std::cout << "Spike Sorter could not build its OpenGL shaders, drawing in software instead: "
+                  << shader->getLastError() << std::endl;
+
+        shader = nullptr;
+        failed = 1;
+    }
+}
+
+void PCAPointCloudRenderer::renderOpenGL()
+{
+    float xMin, yMin, xRange, yRange;
+
+    {
+        const ScopedLock sl(lock);
+
+        OpenGLHelpers::clear(Colours::black);
+
+        if (shader == nullptr)
+            return;
+
+        context.extensions.glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+
+        if (numVertices > numBufferVertices)
+        {
+            context.extensions.glBufferData(GL_ARRAY_BUFFER, numVertices * sizeof(PCAPointVertex), vertices, GL_DYNAMIC_DRAW);
+            numBufferVertices = numVertices;
+        }
+        else if (uploadAll)
+        {
+            context.extensions.glBufferSubData(GL_ARRAY_BUFFER, 0, numVertices * sizeof(PCAPointVertex), vertices);
+        }
+        else if (dirtyFrom < dirtyTo)
+        {
+            context.extensions.glBufferSubData(GL_ARRAY_BUFFER, dirtyFrom * sizeof(PCAPointVertex),
+                                               (dirtyTo - dirtyFrom) * sizeof(PCAPointVertex), vertices + dirtyFrom);
+        }
+
+        uploadAll = false;
+        dirtyFrom = dirtyTo = 0;
+
+        xMin = rangeMin[0];
+        yMin = rangeMin[1];
+        xRange = rangeMax[0] - rangeMin[0];
+        yRange = rangeMax[1] - rangeMin[1];
+    }
+
+    if (xRange <= 0 || yRange <= 0) // no range set yet
+    {
+        context.extensions.glBindBuffer(GL_ARRAY_BUFFER, 0);
+        return;
+    }
+
+    shader->use();
+
+    // PCA coordinates to clip coordinates, the first component growing to the right and
+    // the second one downwards, as in projectionImage
+    transformUniform->set((GLfloat) xMin, (GLfloat) yMin, 2.0f / xRange, -2.0f / yRange);
+
+    context.extensions.glVertexAttribPointer(positionAttribute->attributeID, 2, GL_FLOAT, GL_FALSE,
+                                             sizeof(PCAPointVertex), 0);
+    context.extensions.glEnableVertexAttribArray(positionAttribute->attributeID);
+
+    context.extensions.glVertexAttribPointer(colourAttribute->attributeID, 4, GL_UNSIGNED_BYTE, GL_TRUE,
+                                             sizeof(PCAPointVertex), (GLvoid*) offsetof(PCAPointVertex, colour));
+    context.extensions.glEnableVertexAttribArray(colourAttribute->attributeID);
+
+   #if ! JUCE_OPENGL_ES
+    glPointSize(2.0f);
+   #endif
+
+    // the empty slots are transparent
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    glDrawArrays(GL_POINTS, 0, numBufferVertices);
+
+    context.extensions.glDisableVertexAttribArray(positionAttribute->attributeID);
+    context.extensions.glDisableVertexAttribArray(colourAttribute->attributeID);
+    context.extensions.glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void PCAPointCloudRenderer::openGLContextClosing()
+{
+    positionAttribute = nullptr;
+    colourAttribute = nullptr;
+    transformUniform = nullptr;
+    shader = nullptr;
+
+    if (vertexBuffer != 0)
+        context.extensions.glDeleteBuffers(1, &vertexBuffer);
+
+    vertexBuffer = 0;
+    numBufferVertices = 0;
+}
@@ -101,7 +101,7 @@ public:
     SpikeSorter* processor;
 
     ScopedPointer<UtilityButton> addPolygonUnitButton,
-                  addUnitButton, delUnitButton, addBoxButton, delBoxButton, rePCAButton,nextElectrode,prevElectrode,newIDbuttons,deleteAllUnits;
+                  addUnitButton, delUnitButton, addBoxButton, delBoxButton, rePCAButton,nextElectrode,prevElectrode,newIDbuttons,deleteAllUnits,openGLButton;
 
 private:
     void removeUnitOrBox();
@@ -287,11 +287,85 @@ private:
 
 
 
+/**
+
+  One point of the PCAPointCloudRenderer, in PCA coordinates.
+
+*/
+
+struct PCAPointVertex
+{
+    GLfloat x;
+    GLfloat y;
+    uint8 colour[4];    // r, g, b, a
+};
+
+/**
+
+  Draws the PCA projections of the buffered spikes as a point cloud, through an
+  OpenGL context attached to the PCAProjectionAxes.
+
+  Each slot of the spike buffer owns one vertex holding its raw projection and unit
+  colour; only the slots written since the last frame are uploaded, and the PCA range
+  is applied by the shader, so that zooming does not touch the vertices. The unit
+  polygons are still painted by the axes on top of the points.
+
+*/
+
+class PCAPointCloudRenderer : public OpenGLRenderer
+{
+public:
+    PCAPointCloudRenderer(OpenGLContext& context, int numPoints);
+    ~PCAPointCloudRenderer();
+
+    /** Writes the projection and colour of the spike held by a buffer slot, or hides
+        that slot if the spike is null */
+    void setPoint(int index, SorterSpikePtr s);
+
+    /** Hides every point */
+    void clearPoints();
+
+    void setRange(float xMin, float yMin, float xMax, float yMax);
+
+    /** Returns true if the shaders could not be built, nothing being drawn then */
+    bool hasFailed() const;
+
+    void newOpenGLContextCreated() override;
+    void renderOpenGL() override;
+    void openGLContextClosing() override;
+
+private:
+    OpenGLContext& context;
+
+    ScopedPointer<OpenGLShaderProgram> shader;
+    ScopedPointer<OpenGLShaderProgram::Attribute> positionAttribute;
+    ScopedPointer<OpenGLShaderProgram::Attribute> colourAttribute;
+    ScopedPointer<OpenGLShaderProgram::Uniform> transformUniform;
+    GLuint vertexBuffer;
+    int numBufferVertices;              // allocated in the vertex buffer
+    Atomic<int> failed;
+
+    CriticalSection lock;               // guards everything below
+
+    HeapBlock<PCAPointVertex> vertices;
+    int numVertices;
+
+    bool uploadAll;
+    int dirtyFrom;                      // slots written since the last upload
+    int dirtyTo;
+
+    float rangeMin[2];
+    float rangeMax[2];
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PCAPointCloudRenderer);
+};
+
+
 class PCAProjectionAxes : public GenericDrawAxes,  Button::Listener
 {
 public:
     PCAProjectionAxes(SpikeSorter* p);
-    ~PCAProjectionAxes() {}
+    ~PCAProjectionAxes();
 
     void setPCARange(float p1min, float p2min, float p1max, float p2max);
 	bool updateSpikeData(SorterSpikePtr s);
@@ -315,6 +389,13 @@ public:
     void rangeDown();
     void rangeUp();
 
+    /** Attaches an OpenGL context to the axes, through which the spikes are drawn */
+    void setOpenGLRendering(bool isEnabled);
+
+    /** Returns true if the spikes are currently drawn by the OpenGL renderer, rather
+        than through projectionImage */
+    bool isDrawingWithOpenGL();
+
 private:
     float prevx,prevy;
     bool inPolygonDrawingMode;
@@ -352,6 +433,9 @@ private:
     PCAUnit drawnUnit;
 
     bool redrawSpikes;
+
+    OpenGLContext openGLContext;
+    ScopedPointer<PCAPointCloudRenderer> glRenderer;
 };
 
 
@@ -370,6 +454,7 @@ public:
 
     void setPolygonDrawingMode(bool on);
     void setPCARange(float p1min, float p2min, float p1max, float p2max);
+    void setOpenGLRendering(bool isEnabled);
     void modifyRange(int index,bool up);
     void updateUnitsFromProcessor();
 	void processSpikeObject(SorterSpikePtr s);
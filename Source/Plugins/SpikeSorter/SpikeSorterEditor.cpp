@@ -317,6 +317,22 @@ void SpikeSorterEditor::buttonEvent(Button* button)
         configMenu.addItem(5,"Current Channel => Audio",true,processor->getAutoDacAssignmentStatus());
         configMenu.addItem(6,"Threshold => All channels",true,processor->getThresholdSyncStatus());
 
+        PopupMenu adaptiveThresholdMenu;
+        const float multiplier = processor->getThresholdMultiplier();
+        adaptiveThresholdMenu.addItem(8,"Set by hand",true,multiplier == 0);
+        for (int k = 3; k <= 6; k++)
+            adaptiveThresholdMenu.addItem(8+k,String(k) + " x noise level",true,multiplier == k);
+        configMenu.addSubMenu("Threshold",adaptiveThresholdMenu,true);
+
+        PopupMenu templateMenu;
+        const float rejection = processor->getTemplateRejection();
+        templateMenu.addItem(15,"Sort by templates",true,processor->getTemplateMatching());
+        templateMenu.addItem(16,"Learn templates from units");
+        templateMenu.addSeparator();
+        for (int k = 1; k <= 4; k++)
+            templateMenu.addItem(16+k,"Reject beyond " + String(k*15) + " uV RMS",true,rejection == k*15);
+        configMenu.addSubMenu("Templates",templateMenu,true);
+
         const int result = configMenu.show();
         switch (result)
         {
@@ -342,6 +358,27 @@ void SpikeSorterEditor::buttonEvent(Button* button)
             case 7:
                 processor->setFlipSignalState(!processor->getFlipSignalState());
                 break;
+            case 8:
+                processor->setThresholdMultiplier(0.0f);
+                break;
+            case 11:
+            case 12:
+            case 13:
+            case 14:
+                processor->setThresholdMultiplier((float) (result - 8));
+                break;
+            case 15:
+                processor->setTemplateMatching(!processor->getTemplateMatching());
+                break;
+            case 16:
+                CoreServices::sendStatusMessage("Learned " + String(processor->learnTemplates()) + " unit templates");
+                break;
+            case 17:
+            case 18:
+            case 19:
+            case 20:
+                processor->setTemplateRejection((float) ((result - 16) * 15));
+                break;
         }
 
     }
@@ -26,7 +26,8 @@
 #include "AudioNode.h"
 
 AudioNode::AudioNode()
-    : GenericProcessor("Audio Node"), audioEditor(0), volume(0.00001f), noiseGateLevel(0.0f)
+    : GenericProcessor("Audio Node"), audioEditor(0), volume(0.00001f), noiseGateLevel(0.0f),
+      destBufferSampleRate(44100.0), estimatedSamples(1024)
 {
 
     settings.numInputs = 4096;
@@ -37,7 +38,7 @@ AudioNode::AudioNode()
 
     nextAvailableChannel = 2; // keep first two channels empty
 
-    tempBuffer = new AudioSampleBuffer(16, 1024);
+    tempBuffer = new AudioSampleBuffer(1, 4096);
 
 }
 
@@ -141,12 +142,14 @@ void AudioNode::setParameter(int parameterIndex, float newValue)
     {
 
 		dataChannelArray[currentChannel]->setMonitored(true);
+        updateMonitoredSources(true);
 
     }
     else if (parameterIndex == -100)
     {
 
 		dataChannelArray[currentChannel]->setMonitored(false);
+        updateMonitoredSources(true);
     }
 
 }
@@ -169,308 +172,180 @@ void AudioNode::prepareToPlay(double sampleRate_, int estimatedSamplesPerBlock)
 
 void AudioNode::recreateBuffers()
 {
-	numSamplesExpected.clear();
-    samplesInBackupBuffer.clear();
-    samplesInOverflowBuffer.clear();
-    ratio.clear();
-    filters.clear();
-    bufferA.clear();
-    bufferB.clear();
-    bufferSwap.clear();
+    updateMonitoredSources(false);
+}
+
+void AudioNode::updateMonitoredSources(bool keepStates)
+{
+    OwnedArray<MonitoredSource> newSources;
 
     for (int i = 0; i < dataChannelArray.size(); i++)
     {
-        // processor sample rate divided by sound card sample rate
-        numSamplesExpected.add((int)(dataChannelArray[i]->getSampleRate()/destBufferSampleRate*float(estimatedSamples)) + 1);
-        samplesInBackupBuffer.add(0);
-        samplesInOverflowBuffer.add(0);
-        sourceBufferSampleRate.add(dataChannelArray[i]->getSampleRate());
-
-        filters.add(new Dsp::SmoothedFilterDesign<Dsp::RBJ::Design::LowPass, 1> (1024));
-
-        ratio.add(float(numSamplesExpected[i])/float(estimatedSamples));
-        updateFilter(i);
-
-        bufferA.add(new AudioSampleBuffer(1,10000));
-        bufferB.add(new AudioSampleBuffer(1,10000));
-        bufferSwap.add(false);
+        const DataChannel* chan = dataChannelArray[i];
 
-    }
-
-//    tempBuffer->setSize(getNumInputs(), 4096);
-    tempBuffer->setSize(1, 4096);
-}
-
-bool AudioNode::enable()
-{
-	recreateBuffers();
-	return true;
-}
+        if (! chan->isMonitored())
+            continue;
 
-void AudioNode::updateFilter(int i)
-{
+        const uint32 sourceId = getProcessorFullId(chan->getSourceNodeID(), chan->getSubProcessorIdx());
 
-    double cutoffFreq = (ratio[i] > 1.0) ? 2 * destBufferSampleRate  // downsample
-                        : destBufferSampleRate / 2; // upsample
+        MonitoredSource* source = nullptr;
 
-    double sampleFreq = (ratio[i] > 1.0) ? sourceBufferSampleRate[i] // downsample
-                        : destBufferSampleRate;  // upsample
+        for (int s = 0; s < newSources.size() && source == nullptr; s++)
+        {
+            if (newSources[s]->sourceId == sourceId)
+                source = newSources[s];
+        }
 
-    Dsp::Params params;
-    params[0] = sampleFreq; // sample rate
-    params[1] = cutoffFreq; // cutoff frequency
-    params[2] = 1.25; //Q //
+        if (source == nullptr)
+        {
+            source = newSources.add(new MonitoredSource());
+            source->sourceId = sourceId;
+            source->isPrimed = false;
 
-    filters[i]->setParams(params);
+            // only this thread changes the list, so it can be searched without the lock
+            bool isKept = false;
 
-}
+            for (int s = 0; s < sources.size() && keepStates && ! isKept; s++)
+                isKept = sources[s]->sourceId == sourceId;
 
-void AudioNode::process(AudioSampleBuffer& buffer)
-{
-    float gain;
-    int valuesNeeded = buffer.getNumSamples(); // samples needed to fill out the buffer
+            if (! isKept)
+            {
+                // processor samples per sound card block, with room for sources delivering in bursts
+                const int samplesPerBlock = (int) std::ceil(chan->getSampleRate() / destBufferSampleRate * estimatedSamples);
 
-    //std::cout << "Buffer size: " << buffer.getNumChannels() << std::endl;
+                source->resampler = new PolyphaseResampler();
+                source->resampler->setRates(chan->getSampleRate(), destBufferSampleRate);
+                source->resampler->setMaxPendingSamples(jmax(8 * samplesPerBlock, 4096));
+            }
+        }
 
-    // clear the left and right channels
-    buffer.clear(0,0,buffer.getNumSamples());
-    buffer.clear(1,0,buffer.getNumSamples());
+        source->channels.add(i);
+    }
 
-    if (1)
     {
+        const ScopedLock sl(sourceLock);
 
-        AudioSampleBuffer* overflowBuffer;
-        AudioSampleBuffer* backupBuffer;
-
-        if (dataChannelArray.size() > 0) // we have some channels
+        for (int s = 0; s < newSources.size(); s++)
         {
+            MonitoredSource* source = newSources[s];
 
-//            tempBuffer->clear();
-
-            for (int i = 0; i < buffer.getNumChannels()-2; i++) // cycle through them all
+            for (int old = 0; old < sources.size() && source->resampler == nullptr; old++)
             {
-                
-                if (dataChannelArray[i]->isMonitored())
+                if (sources[old]->sourceId == source->sourceId)
                 {
-                    tempBuffer->clear();
-                    //std::cout << "Processing channel " << i << std::endl;
-
-                    if (!bufferSwap[i])
-                    {
-                        overflowBuffer = bufferA[i];
-                        backupBuffer = bufferB[i];
-
-                        bufferSwap.set(i,true);
-                    }
-                    else
-                    {
-                        overflowBuffer = bufferB[i];
-                        backupBuffer = bufferA[i];
-
-                        bufferSwap.set(i,false);
-                    }
-
-                    backupBuffer->clear();
-
-                    samplesInOverflowBuffer.set(i,samplesInBackupBuffer[i]); // size of buffer after last round
-                    samplesInBackupBuffer.set(i,0);
-
-                    int orphanedSamples = 0;
-
-                    // 1. copy overflow buffer
-
-                    int samplesToCopyFromOverflowBuffer =
-                        ((samplesInOverflowBuffer[i] <= numSamplesExpected[i]) ?
-                         samplesInOverflowBuffer[i] :
-                         numSamplesExpected[i]);
-
-                    //std::cout << "Copying " << samplesToCopyFromOverflowBuffer << " samples from overflow buffer of " << samplesInOverflowBuffer[i] << " samples." << std::endl;
-
-                    if (samplesToCopyFromOverflowBuffer > 0) // need to re-add samples from backup buffer
-                    {
+                    source->resampler = sources[old]->resampler;
+                    source->isPrimed = sources[old]->isPrimed;
+                }
+            }
+        }
 
-                        tempBuffer->addFrom(0,    // destination channel
-                                            0,                // destination start sample
-                                            *overflowBuffer,  // source
-                                            0,                // source channel
-                                            0,                // source start sample
-                                            samplesToCopyFromOverflowBuffer,    // number of samples
-                                            1.0f              // gain to apply
-                                           );
-
-                        int leftoverSamples = samplesInOverflowBuffer[i] - samplesToCopyFromOverflowBuffer;
-
-                        // std::cout << "Samples remaining in overflow buffer: " << leftoverSamples << std::endl;
-
-                        if (leftoverSamples > 0) // move remaining samples to the backup buffer
-                        {
-
-                            backupBuffer->addFrom(0, // destination channel
-                                                  0,                     // destination start sample
-                                                  *overflowBuffer,       // source
-                                                  0,                     // source channel
-                                                  samplesToCopyFromOverflowBuffer,         // source start sample
-                                                  leftoverSamples,       // number of samples
-                                                  1.0f                   // gain to apply
-                                                 );
-                        }
-
-                        samplesInBackupBuffer.set(i,leftoverSamples);
-                    }
+        sources.swapWith(newSources);
+    }
 
-                    gain = volume/(float(0x7fff) * dataChannelArray[i]->getBitVolts());
-                    // Data are floats in units of microvolts, so dividing by bitVolts and 0x7fff (max value for 16b signed)
-                    // rescales to between -1 and +1. Audio output starts So, maximum gain applied to maximum data would be 10.
+    // the sources no longer monitored are deleted here, outside the lock
+}
 
-                    int remainingSamples = numSamplesExpected[i] - samplesToCopyFromOverflowBuffer;
+bool AudioNode::enable()
+{
+	recreateBuffers();
+	return true;
+}
 
-                    int samplesAvailable = getNumSourceSamples(dataChannelArray[i]->getSourceNodeID(), dataChannelArray[i]->getSubProcessorIdx());
+void AudioNode::process(AudioSampleBuffer& buffer)
+{
+    int valuesNeeded = buffer.getNumSamples(); // samples needed to fill out the buffer
 
-                    int samplesToCopyFromIncomingBuffer = ((remainingSamples <= samplesAvailable) ?
-                                                           remainingSamples :
-                                                           samplesAvailable);
+    // clear the left and right channels
+    buffer.clear(0,0,buffer.getNumSamples());
+    buffer.clear(1,0,buffer.getNumSamples());
 
-                    //std::cout << "Copying " << samplesToCopyFromIncomingBuffer << " samples from incoming buffer of " << samplesAvailable << " samples." << std::endl;
+    const ScopedTryLock sl(sourceLock);
 
+    // silent for a block while the list of monitored channels is replaced
+    if (! sl.isLocked())
+        return;
 
-                    if (samplesToCopyFromIncomingBuffer > 0)
-                    {
+    if (sources.size() > 0) // we have some channels
+    {
+        const DataChannelTable& channels = getDataChannelTable();
+        const int numDataChannels = jmin(channels.size(), buffer.getNumChannels() - 2);
 
-                        //tempBuffer->addFrom(i,       // destination channel
-                        tempBuffer->addFrom(0,       // destination channel
-                                            samplesToCopyFromOverflowBuffer,           // destination start sample
-                                            buffer,      // source
-                                            i+2,           // source channel (add 2 to account for output channels)
-                                            0,           // source start sample
-                                            samplesToCopyFromIncomingBuffer, //  number of samples
-                                            gain       // gain to apply
-                                           );
+        for (int s = 0; s < sources.size(); s++)
+        {
+            MonitoredSource* source = sources[s];
 
-                        //if (destBufferPos == 0)
-                        //  std::cout << "Temp buffer 0 value: " << *tempBuffer->getReadPointer(i,0) << std::endl;
+            // the monitored channels are mixed at the source rate, so the source is resampled once
+            // however many of its channels are heard
+            const int samplesAvailable = getNumSourceSamples(source->sourceId);
 
-                    }
+            for (int offset = 0; offset < samplesAvailable; offset += tempBuffer->getNumSamples())
+            {
+                const int numSamples = jmin(tempBuffer->getNumSamples(), samplesAvailable - offset);
 
-                    orphanedSamples = samplesAvailable - samplesToCopyFromIncomingBuffer;
+                tempBuffer->clear(0, 0, numSamples);
 
-                    // std::cout << "Samples remaining in incoming buffer: " << orphanedSamples << std::endl;
+                for (int c = 0; c < source->channels.size(); c++)
+                {
+                    const int chan = source->channels.getUnchecked(c);
 
-                    if (orphanedSamples > 0 && (samplesInBackupBuffer[i] + orphanedSamples < backupBuffer->getNumSamples()))
+                    if (chan < numDataChannels)
                     {
-
-                        backupBuffer->addFrom(0,                            // destination channel
-                                              samplesInBackupBuffer[i],     // destination start sample
-                                              buffer,                       // source
-                                              i+2,                          // source channel (add 2 to account for output channels)
-                                              remainingSamples,             // source start sample
-                                              orphanedSamples,              //  number of samples
-                                              gain                          // gain to apply
-                                             );
-
-                        samplesInBackupBuffer.set(i, samplesInBackupBuffer[i] + orphanedSamples);
-
+                        // Data are floats in units of microvolts, so dividing by bitVolts and 0x7fff (max value for 16b signed)
+                        // rescales to between -1 and +1. Audio output starts So, maximum gain applied to maximum data would be 10.
+                        const float gain = volume/(float(0x7fff) * channels.bitVolts[chan]);
+
+                        tempBuffer->addFrom(0,         // destination channel
+                                            0,         // destination start sample
+                                            buffer,    // source
+                                            chan+2,    // source channel (add 2 to account for output channels)
+                                            offset,    // source start sample
+                                            numSamples, // number of samples
+                                            gain);     // gain to apply
                     }
+                }
 
-                    // now that our tempBuffer is ready, we can filter it and copy it into the
-                    // original buffer
+                source->resampler->pushSamples(tempBuffer->getReadPointer(0), numSamples);
+            }
 
-                    //std::cout << "Ratio = " << ratio[i] << ", gain = " << gain << std::endl;
-                    //std::cout << "Values needed = " << valuesNeeded << ", channel = " << i << std::endl;
+            // a block is kept in hand to absorb the jitter in the number of samples per block,
+            // and gathered again after running dry
+            if (! source->isPrimed)
+                source->isPrimed = source->resampler->getNumSamplesAvailable() >= 2 * valuesNeeded;
 
-                    if (ratio[i] > 1.00001)
-                    {
-                        // pre-apply filter before downsampling
-                        float* ptr = tempBuffer->getWritePointer(i);
-                        filters[i]->process(numSamplesExpected[i], &ptr);
-                    }
-
-                    // initialize variables
-                    int sourceBufferPos = 0;
-                    int sourceBufferSize = numSamplesExpected[i];
-                    float subSampleOffset = 0.0;
-                    int nextPos = (sourceBufferPos + 1) % sourceBufferSize;
+            if (source->isPrimed && source->resampler->addSamples(buffer.getWritePointer(0), valuesNeeded) < valuesNeeded)
+                source->isPrimed = false;
+        }
 
-                    int destBufferPos;
+        // Simple implementation of a "noise gate" on audio output
+        expander.process(buffer.getWritePointer(0), // expand the left channel
+                         buffer.getNumSamples());
+
+        // copy the signal into the right channel (no stereo audio yet!)
+        buffer.addFrom(1,    // destChannel
+                       0,  // destSampleOffset
+                       buffer,     // source
+                       0,    // sourceChannel
+                       0,// sourceSampleOffset
+                       valuesNeeded,        // number of samples
+                       1.0);      // gain to apply to source
+    }
+}
 
-                    // code modified from "juce_ResamplingAudioSource.cpp":
 
-                    for (destBufferPos = 0; destBufferPos < valuesNeeded; destBufferPos++)
-                    {
-                        float gain = 1.0;
-                        float alpha = (float) subSampleOffset;
-                        float invAlpha = 1.0f - alpha;
-
-                        // std::cout << "Copying sample " << sourceBufferPos << std::endl;
-
-                        buffer.addFrom(0,    // destChannel
-                                       destBufferPos,  // destSampleOffset
-                                       *tempBuffer,     // source
-                                       //i,    // sourceChannel
-                                       0,       // sourceChannel
-                                       sourceBufferPos,// sourceSampleOffset
-                                       1,        // number of samples
-                                       invAlpha*gain);      // gain to apply to source
-
-                        buffer.addFrom(0,    // destChannel
-                                       destBufferPos,   // destSampleOffset
-                                       *tempBuffer,     // source
-                                       //i,      // sourceChannel
-                                       0,      // sourceChannel
-                                       nextPos,      // sourceSampleOffset
-                                       1,        // number of samples
-                                       alpha*gain);       // gain to apply to source
-
-                        // if (destBufferPos == 0)
-                        //std::cout << "Output buffer 0 value: " << *buffer.getReadPointer(i+2,destBufferPos) << std::endl;
-
-                        subSampleOffset += ratio[i];
-
-                        while (subSampleOffset >= 1.0)
-                        {
-                            if (++sourceBufferPos >= sourceBufferSize)
-                                sourceBufferPos = 0;
-
-                            nextPos = (sourceBufferPos + 1) % sourceBufferSize;
-                            subSampleOffset -= 1.0;
-                        }
-                    }
+int64 AudioNode::getMemoryFootprint() const
+{
+    int64 bytes = GenericProcessor::getMemoryFootprint() + MemoryFootprint::ofBuffer(tempBuffer.get());
 
-                    if (ratio[i] < 0.99999)
-                    {
-                        // apply the filter after upsampling
-                        float* ptr = buffer.getWritePointer(0);
-                        filters[i]->process(destBufferPos, &ptr);
-                    }
+    const ScopedLock sl(sourceLock);
 
-                    // now copy the channel into the output zone
-
-                    // buffer.addFrom(0,    // destChannel
-                    //                0,  // destSampleOffset
-                    //                buffer,     // source
-                    //                 i+2,    // sourceChannel
-                    //                 0,// sourceSampleOffset
-                    //                 valuesNeeded,        // number of samples
-                    //                 1.0);      // gain to apply to source
-
-                } // if channelPointers[i]->isMonitored
-            } // end cycling through channels
-
-            // Simple implementation of a "noise gate" on audio output
-            expander.process(buffer.getWritePointer(0), // expand the left channel
-                             buffer.getNumSamples());
-
-            // copy the signal into the right channel (no stereo audio yet!)
-            buffer.addFrom(1,    // destChannel
-                           0,  // destSampleOffset
-                           buffer,     // source
-                           0,    // sourceChannel
-                           0,// sourceSampleOffset
-                           valuesNeeded,        // number of samples
-                           1.0);      // gain to apply to source
-        }
+    for (int i = 0; i < sources.size(); i++)
+    {
+        if (sources[i]->resampler != nullptr)
+            bytes += sources[i]->resampler->getMemoryFootprint();
     }
-}
 
+    return bytes;
+}
 
 void AudioNode::updateRecordChannelIndexes()
 {
@@ -30,7 +30,7 @@
 
 #include "../GenericProcessor/GenericProcessor.h"
 #include "AudioEditor.h"
-#include "../Dsp/Dsp.h"
+#include "PolyphaseResampler.h"
 
 
 class AudioEditor;
@@ -119,43 +119,44 @@ public:
 
     void prepareToPlay(double sampleRate_, int estimatedSamplesPerBlock) override;
 
-    void updateFilter(int i);
-
 	bool enable() override;
 
 	//Called by ProcessorGraph
 	void updateRecordChannelIndexes();
 
+	/** Adds the mixing buffer and the resamplers of the monitored sources */
+	int64 getMemoryFootprint() const override;
+
 private:
+    /** The monitored channels of one source, mixed at their own rate and resampled together. */
+    struct MonitoredSource
+    {
+        uint32 sourceId;
+        Array<int> channels;
+        ScopedPointer<PolyphaseResampler> resampler;
+        bool isPrimed;              // a block of output is ready ahead of the one being played
+    };
+
 	void recreateBuffers();
 
+    /** Rebuilds the list of sources with monitored channels, only those having resampling state.
+        Sources still monitored keep theirs unless keepStates is false. */
+    void updateMonitoredSources(bool keepStates);
+
     Array<int> leftChan;
     Array<int> rightChan;
     float volume;
     float noiseGateLevel; // in microvolts
 
-    OwnedArray<AudioSampleBuffer> bufferA;
-    OwnedArray<AudioSampleBuffer> bufferB;
+    OwnedArray<MonitoredSource> sources;
+    mutable CriticalSection sourceLock;
 
-    Array<int> numSamplesExpected;
-
-    Array<int> samplesInBackupBuffer;
-    Array<int> samplesInOverflowBuffer;
-    Array<double> sourceBufferSampleRate;
     double destBufferSampleRate;
 	int estimatedSamples;
 
-    Array<bool> bufferSwap;
-
     Expander expander;
 
-    // sample rate, timebase, and ratio info:
-    Array<double> ratio;
-
-    // major objects:
-    OwnedArray<Dsp::Filter> filters;
-
-    // Temporary buffer for data
+    // Temporary buffer for the mix of a source
     ScopedPointer<AudioSampleBuffer> tempBuffer;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioNode);
@@ -0,0 +1,281 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "PolyphaseResampler.h"
+#include "../GenericProcessor/MemoryFootprint.h"
+
+#include <cmath>
+
+#if JUCE_INTEL && (defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2))
+ #define POLYPHASE_SSE 1
+ #include <emmintrin.h>
+#endif
+
+#if JUCE_ARM && defined (__aarch64__)
+ #define POLYPHASE_NEON 1
+ #include <arm_neon.h>
+#endif
+
+namespace
+{
+    float innerProduct (const float* taps, const float* input, int numTaps)
+    {
+        int n = 0;
+        float sum = 0;
+
+       #if POLYPHASE_SSE
+        __m128 acc = _mm_setzero_ps();
+
+        for (; n + 4 <= numTaps; n += 4)
+            acc = _mm_add_ps (acc, _mm_mul_ps (_mm_loadu_ps (taps + n), _mm_loadu_ps (input + n)));
+
+        acc = _mm_add_ps (acc, _mm_movehl_ps (acc, acc));
+        acc = _mm_add_ss (acc, _mm_shuffle_ps (acc, acc, 1));
+        sum = _mm_cvtss_f32 (acc);
+       #elif POLYPHASE_NEON
+        float32x4_t acc = vdupq_n_f32 (0);
+
+        for (; n + 4 <= numTaps; n += 4)
+            acc = vmlaq_f32 (acc, vld1q_f32 (taps + n), vld1q_f32 (input + n));
+
+        sum = vaddvq_f32 (acc);
+       #endif
+
+        for (; n < numTaps; ++n)
+            sum += taps[n] * input[n];
+
+        return sum;
+    }
+}
+
+
+PolyphaseResampler::PolyphaseResampler()
+    : up (1), down (1), numTaps (0), capacity (0), maxPendingSamples (4096),
+      numSamples (0), position (0), phase (0)
+{
+    setRates (44100.0, 44100.0);
+}
+
+
+PolyphaseResampler::~PolyphaseResampler()
+{
+}
+
+
+void PolyphaseResampler::getRationalRatio (double sourceSampleRate, double destSampleRate, int maxFactor,
+                                           int& upFactor, int& downFactor)
+{
+    const double ratio = destSampleRate / sourceSampleRate;
+
+    // convergents h / k of the continued fraction, starting from h(-2) / k(-2) = 0 / 1 and h(-1) / k(-1) = 1 / 0
+    int64 h0 = 0, h1 = 1;
+    int64 k0 = 1, k1 = 0;
+    double remainder = ratio;
+
+    upFactor = 0;
+    downFactor = 1;
+
+    for (int i = 0; i < 64; ++i)
+    {
+        const double a = std::floor (remainder);
+        const int64 h = (int64) a * h1 + h0;
+        const int64 k = (int64) a * k1 + k0;
+
+        if (h > maxFactor || k > maxFactor)
+            break;
+
+        upFactor = (int) h;
+        downFactor = (int) k;
+
+        if (remainder - a < 1.0e-9 || std::abs (ratio - double (h) / double (k)) < 1.0e-12 * ratio)
+            break;
+
+        h0 = h1;
+        h1 = h;
+        k0 = k1;
+        k1 = k;
+        remainder = 1.0 / (remainder - a);
+    }
+
+    if (upFactor < 1)
+    {
+        upFactor = (ratio < 1.0) ? 1 : maxFactor;
+        downFactor = (ratio < 1.0) ? maxFactor : 1;
+    }
+}
+
+
+void PolyphaseResampler::setRates (double sourceSampleRate, double destSampleRate)
+{
+    getRationalRatio (sourceSampleRate, destSampleRate, POLYPHASE_MAX_FACTOR, up, down);
+
+    if (up == down)
+    {
+        up = down = 1;
+        numTaps = 1;
+        phases.malloc (1);
+        phases[0] = 1.0f;
+    }
+    else
+    {
+        // going down, the kernel must span as many inputs as it does outputs going up
+        numTaps = POLYPHASE_TAPS_PER_PHASE * jlimit (1, 8, (down + up - 1) / up);
+
+        const int length = up * numTaps;
+        const double centre = (length - 1) / 2.0;
+        const double cutoff = 0.45 / jmax (up, down);   // cycles per interpolated sample, a tenth below Nyquist
+
+        HeapBlock<double> kernel (length);
+        double sum = 0;
+
+        for (int n = 0; n < length; ++n)
+        {
+            const double t = n - centre;
+            const double ideal = (t == 0) ? 2 * cutoff : std::sin (2 * double_Pi * cutoff * t) / (double_Pi * t);
+            const double w = 2 * double_Pi * n / (length - 1);
+            const double window = 0.42 - 0.5 * std::cos (w) + 0.08 * std::cos (2 * w);
+
+            kernel[n] = ideal * window;
+            sum += kernel[n];
+        }
+
+        // each phase then has a gain close to one, the interpolation having spread the input over up samples
+        phases.malloc (length);
+
+        for (int p = 0; p < up; ++p)
+            for (int j = 0; j < numTaps; ++j)
+                phases[p * numTaps + j] = float (kernel[p + (numTaps - 1 - j) * up] * up / sum);
+    }
+
+    setMaxPendingSamples (maxPendingSamples);
+}
+
+
+void PolyphaseResampler::setMaxPendingSamples (int numPendingSamples)
+{
+    maxPendingSamples = jmax (1, numPendingSamples);
+    capacity = maxPendingSamples + numTaps - 1;
+    samples.malloc (capacity);
+
+    reset();
+}
+
+
+void PolyphaseResampler::reset()
+{
+    FloatVectorOperations::clear (samples, numTaps - 1);
+
+    numSamples = numTaps - 1;
+    position = numTaps - 1;
+    phase = 0;
+}
+
+
+int PolyphaseResampler::getUpFactor() const
+{
+    return up;
+}
+
+
+int PolyphaseResampler::getDownFactor() const
+{
+    return down;
+}
+
+
+int64 PolyphaseResampler::getMemoryFootprint() const
+{
+    return MemoryFootprint::ofBlock (phases, (int64) up * numTaps) + MemoryFootprint::ofBlock (samples, capacity);
+}
+
+
+double PolyphaseResampler::getLatencySamples() const
+{
+    return (up * numTaps - 1) / (2.0 * down);
+}
+
+
+void PolyphaseResampler::discardUsedSamples()
+{
+    const int first = position - (numTaps - 1);
+
+    if (first > 0)
+    {
+        memmove (samples, samples + first, sizeof (float) * (numSamples - first));
+        numSamples -= first;
+        position -= first;
+    }
+}
+
+
+void PolyphaseResampler::pushSamples (const float* source, int numNewSamples)
+{
+    discardUsedSamples();
+
+    int excess = numSamples + numNewSamples - capacity;
+
+    if (excess > 0)
+    {
+        // the output fell behind, so the oldest inputs are skipped rather than the latency growing
+        const int skipped = jmin (excess, numSamples - position);
+
+        position += skipped;
+        excess -= skipped;
+        discardUsedSamples();
+
+        source += excess;
+        numNewSamples -= excess;
+    }
+
+    FloatVectorOperations::copy (samples + numSamples, source, numNewSamples);
+    numSamples += numNewSamples;
+}
+
+
+int PolyphaseResampler::getNumSamplesAvailable() const
+{
+    if (position >= numSamples)
+        return 0;
+
+    // the m-th next output needs the input position + (phase + m * down) / up
+    const int64 span = int64 (numSamples - position) * up - phase;
+
+    return (int) ((span + down - 1) / down);
+}
+
+
+int PolyphaseResampler::addSamples (float* dest, int numOutputs)
+{
+    int n = 0;
+
+    for (; n < numOutputs && position < numSamples; ++n)
+    {
+        dest[n] += innerProduct (phases + phase * numTaps, samples + position - (numTaps - 1), numTaps);
+
+        phase += down;
+        position += phase / up;
+        phase %= up;
+    }
+
+    return n;
+}
@@ -0,0 +1,111 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __POLYPHASERESAMPLER_H_5E8A2C91__
+#define __POLYPHASERESAMPLER_H_5E8A2C91__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+/** Taps of each phase of the kernel when the rate goes up, more being used to go down */
+#define POLYPHASE_TAPS_PER_PHASE 32
+/** Largest interpolation or decimation factor of the rational ratio */
+#define POLYPHASE_MAX_FACTOR 1024
+
+
+/**
+    Converts a stream of samples from one sample rate to another by a rational ratio
+    up / down, for instance 147 / 100 from 30 kHz to 44.1 kHz.
+
+    Conceptually the input is interpolated by up, low-pass filtered below the lower of the
+    two Nyquist frequencies and decimated by down; only the outputs that are kept are
+    computed, each as the inner product of the last input samples with one of the up phases
+    of a Blackman-windowed sinc, stored reversed so that both run forward in memory and the
+    product runs with SSE or NEON.
+
+    Samples are pushed and pulled separately, and the inputs not used yet as well as the
+    phase are kept from one call to the next, so blocks of any length give the same output
+    as a single long one: there is no pitch shift nor any discontinuity at block boundaries.
+    If more samples are pushed than the consumer pulls, the oldest pending inputs are
+    dropped so that the latency stays below setMaxPendingSamples().
+
+    @see AudioNode, AudioResamplingNode
+*/
+class PolyphaseResampler
+{
+public:
+    PolyphaseResampler();
+    ~PolyphaseResampler();
+
+    /** Designs the kernel for the closest ratio of factors up to POLYPHASE_MAX_FACTOR, and resets the state */
+    void setRates (double sourceSampleRate, double destSampleRate);
+
+    /** Sets how many pushed inputs can wait to be used, and resets the state */
+    void setMaxPendingSamples (int numSamples);
+
+    /** Forgets the inputs, as if a stream of zeros had been pushed */
+    void reset();
+
+    int getUpFactor() const;
+    int getDownFactor() const;
+
+    /** Returns the bytes of the kernel and of the input buffer */
+    int64 getMemoryFootprint() const;
+
+    /** Returns the delay of the kernel, in output samples */
+    double getLatencySamples() const;
+
+    /** Appends samples to the inputs */
+    void pushSamples (const float* source, int numSamples);
+
+    /** Returns the number of outputs the pending inputs are enough for */
+    int getNumSamplesAvailable() const;
+
+    /** Adds up to numSamples outputs to dest, and returns how many were available */
+    int addSamples (float* dest, int numSamples);
+
+    /** Returns the closest ratio up / down to destSampleRate / sourceSampleRate with both factors
+        at most maxFactor, from the convergents of its continued fraction */
+    static void getRationalRatio (double sourceSampleRate, double destSampleRate, int maxFactor, int& up, int& down);
+
+
+private:
+    /** Moves the inputs still needed back to the start of the buffer */
+    void discardUsedSamples();
+
+    int up;
+    int down;
+    int numTaps;                    // taps of each phase, a multiple of 4 except when the rates match
+
+    HeapBlock<float> phases;        // up phases of numTaps taps, each reversed
+    HeapBlock<float> samples;       // numTaps - 1 inputs of history, then the pending ones
+    int capacity;
+    int maxPendingSamples;
+
+    int numSamples;                 // inputs in the buffer
+    int position;                   // input aligned with the last tap of the next output
+    int phase;                      // phase of the next output
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PolyphaseResampler);
+};
+
+#endif  // __POLYPHASERESAMPLER_H_5E8A2C91__
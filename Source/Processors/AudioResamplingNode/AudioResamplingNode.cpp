@@ -23,11 +23,12 @@
 
 #include "AudioResamplingNode.h"
 #include <stdio.h>
+#include <cmath>
 
 AudioResamplingNode::AudioResamplingNode()
     : GenericProcessor("Resampling Node"),
       sourceBufferSampleRate(40000.0), destBufferSampleRate(44100.0),
-      ratio(1.0), lastRatio(1.0), destBuffer(0), tempBuffer(0),
+      destBuffer(0), tempBuffer(0),
       destBufferIsTempBuffer(true), isTransmitting(false), destBufferPos(0)
 {
 
@@ -39,9 +40,6 @@ AudioResamplingNode::AudioResamplingNode()
                          44100.0, // sampleRate
                          128);    // blockSize
 
-    filter = new Dsp::SmoothedFilterDesign
-    <Dsp::RBJ::Design::LowPass, 1> (1024);
-
     if (destBufferIsTempBuffer)
         destBufferWidth = 1024;
     else
@@ -61,7 +59,6 @@ AudioResamplingNode::~AudioResamplingNode()
     delete[] continuousDataBuffer;
     deleteAndZero(tempBuffer);
     deleteAndZero(destBuffer);
-    delete filter;
 }
 
 
@@ -109,28 +106,20 @@ void AudioResamplingNode::prepareToPlay(double sampleRate_, int estimatedSamples
 
     destBufferPos = 0;
 
-    // std::cout << "Temp buffer size: " << tempBuffer->getNumChannels() << " x "
-    //           << tempBuffer->getNumSamples() << std::endl;
-
-    updateFilter();
-
-}
-
-void AudioResamplingNode::updateFilter()
-{
-
-    double cutoffFreq = (ratio > 1.0) ? 2 * destBufferSampleRate  // downsample
-                        : destBufferSampleRate / 2; // upsample
+    if (getNumInputs() > 0 && getDataChannel(0) != nullptr)
+        sourceBufferSampleRate = getDataChannel(0)->getSampleRate();
 
-    double sampleFreq = (ratio > 1.0) ? sourceBufferSampleRate // downsample
-                        : destBufferSampleRate;  // upsample
+    // inputs pending beyond what fills the temp buffer are dropped
+    const int maxPendingSamples = (int) std::ceil(tempBuffer->getNumSamples() * sourceBufferSampleRate / destBufferSampleRate);
 
-    Dsp::Params params;
-    params[0] = sampleFreq; // sample rate
-    params[1] = cutoffFreq; // cutoff frequency
-    params[2] = 1.25; //Q //
+    resamplers.clear();
 
-    filter->setParams(params);
+    for (int channel = 0; channel < getNumInputs(); channel++)
+    {
+        PolyphaseResampler* resampler = resamplers.add(new PolyphaseResampler());
+        resampler->setRates(sourceBufferSampleRate, destBufferSampleRate);
+        resampler->setMaxPendingSamples(maxPendingSamples);
+    }
 
 }
 
@@ -139,119 +128,35 @@ void AudioResamplingNode::releaseResources()
 
 }
 
-void AudioResamplingNode::process(AudioSampleBuffer& buffer,
-                                  MidiBuffer& midiMessages)
+void AudioResamplingNode::process(AudioSampleBuffer& buffer)
 {
 
-    int nSamps = buffer.getNumSamples(); // WRONG!!!!
-    int valuesNeeded;
-
-    if (destBufferIsTempBuffer)
-    {
-        ratio = float(nSamps) / float(buffer.getNumSamples());
-        valuesNeeded = buffer.getNumSamples();
-    }
-    else
-    {
-        ratio = sourceBufferSampleRate / destBufferSampleRate;
-        valuesNeeded = (int) buffer.getNumSamples() / ratio;
-        //std::cout << std::endl;
-        //std::cout << "Ratio: " << ratio << std::endl;
-        //std::cout << "Values needed: " << valuesNeeded << std::endl;
-    }
-
-
-
-    if (lastRatio != ratio)
-    {
-        updateFilter();
-        lastRatio = ratio;
-    }
+    const int numChannels = jmin(buffer.getNumChannels(), resamplers.size(), tempBuffer->getNumChannels());
 
+    // every channel has the same rate, so the same outputs are ready once its samples are pushed
+    int numOutputs = tempBuffer->getNumSamples();
 
-    if (ratio > 1.0001)
+    for (int channel = 0; channel < numChannels; ++channel)
     {
-        // pre-apply filter before downsampling
-        filter->process(nSamps, buffer.getArrayOfWritePointers());
+        resamplers[channel]->pushSamples(buffer.getReadPointer(channel), getNumSamples(channel));
+        numOutputs = jmin(numOutputs, resamplers[channel]->getNumSamplesAvailable());
     }
 
-
-    // initialize variables
     tempBuffer->clear();
-    int sourceBufferPos = 0;
-    int sourceBufferSize = buffer.getNumSamples();
-    float subSampleOffset = 0.0;
-    int nextPos = (sourceBufferPos + 1) % sourceBufferSize;
-
-    int tempBufferPos;
-    //int totalSamples = 0;
-
-    // code modified from "juce_ResamplingAudioSource.cpp":
 
-    for (tempBufferPos = 0; tempBufferPos < valuesNeeded; tempBufferPos++)
-    {
-        float gain = 1.0;
-        float alpha = (float) subSampleOffset;
-        float invAlpha = 1.0f - alpha;
-
-        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
-        {
-
-            tempBuffer->addFrom(channel, 		// destChannel
-                                tempBufferPos,  // destSampleOffset
-                                buffer,			// source
-                                channel,		// sourceChannel
-                                sourceBufferPos,// sourceSampleOffset
-                                1,				// number of samples
-                                invAlpha*gain);      // gain to apply to source
-
-            tempBuffer->addFrom(channel, 		// destChannel
-                                tempBufferPos,   // destSampleOffset
-                                buffer,			// source
-                                channel,			// sourceChannel
-                                nextPos,		 	// sourceSampleOffset
-                                1,				// number of samples
-                                alpha*gain);     	 // gain to apply to source
-
-        }
-
-        subSampleOffset += ratio;
-
-
-
-        while (subSampleOffset >= 1.0)
-        {
-            if (++sourceBufferPos >= sourceBufferSize)
-                sourceBufferPos = 0;
-
-            nextPos = (sourceBufferPos + 1) % sourceBufferSize;
-            subSampleOffset -= 1.0;
-        }
-    }
-
-    // std::cout << sourceBufferPos << " " << tempBufferPos << std::endl;
-
-
-    if (ratio < 0.9999)
-    {
-
-        filter->process(tempBufferPos, tempBuffer->getArrayOfWritePointers());
-        // apply the filter after upsampling
-        ///////filter->process (totalSamples, buffer.getArrayOfChannels());
-    }
-    else if (ratio <= 1.0001)
-    {
-
-        // no resampling is being applied, no need to filter, BUT...
-        // keep the filter stoked with samples to avoid discontinuities
-
-    }
+    for (int channel = 0; channel < numChannels; ++channel)
+        resamplers[channel]->addSamples(tempBuffer->getWritePointer(channel), numOutputs);
 
     if (destBufferIsTempBuffer)
     {
 
         // copy the temp buffer into the original buffer
-        buffer = AudioSampleBuffer(tempBuffer->getArrayOfWritePointers(), 2, tempBufferPos);//buffer.getNumSamples());
+        const int numSamples = jmin(numOutputs, buffer.getNumSamples());
+
+        buffer.clear();
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            buffer.copyFrom(channel, 0, *tempBuffer, channel, 0, numSamples);
 
     }
     else
@@ -261,16 +166,13 @@ void AudioResamplingNode::process(AudioSampleBuffer& buffer,
 
         // copy the temp buffer into the destination buffer
 
-        int pos = 0;
-
-        while (*tempBuffer->getWritePointer(0,pos) != 0)
-            pos++;
+        int pos = jmin(numOutputs, destBufferWidth);
 
         int spaceAvailable = destBufferWidth - destBufferPos;
         int blockSize1 = (spaceAvailable > pos) ? pos : spaceAvailable;
         int blockSize2 = (spaceAvailable > pos) ? 0 : (pos - spaceAvailable);
 
-        for (int channel = 0; channel < destBuffer->getNumChannels(); channel++)
+        for (int channel = 0; channel < jmin(numChannels, destBuffer->getNumChannels()); channel++)
         {
 
             // copy first block
@@ -293,14 +195,9 @@ void AudioResamplingNode::process(AudioSampleBuffer& buffer,
 
         }
 
-        //destBufferPos = (spaceAvailable > tempBufferPos) ? destBufferPos
-
         destBufferPos += pos;
         destBufferPos %= destBufferWidth;
 
-        //std::cout << "Temp buffer position: " << tempBufferPos << std::endl;
-        //std::cout << "Resampling node value:" << *destBuffer->getReadPointer(0,0) << std::endl;
-
     }
 
 }
@@ -25,7 +25,7 @@
 #define __AUDIORESAMPLINGNODE_H_CFAB182E__
 
 #include "../../../JuceLibraryCode/JuceHeader.h"
-#include "../Dsp/Dsp.h"
+#include "../AudioNode/PolyphaseResampler.h"
 #include "../GenericProcessor/GenericProcessor.h"
 
 /**
@@ -33,11 +33,9 @@
   Changes the sample rate of continuous data, specialized for increasing
   the sample rate to 44.1 kHz for audio output.
 
-  Code is based on Juce's ResamplingAudioSource class.
-
-  This processor could be vastly improved by implementing a scheme to handle
-  inputs that do not provide the same amount of samples in each buffer. At the
-  moment, the resampling process shifts the pitch of the incoming signal.
+  Each channel goes through a PolyphaseResampler, which keeps its state from one
+  block to the next, so blocks of varying length neither shift the pitch nor
+  leave discontinuities.
 
   @see GenericProcessor
 
@@ -55,11 +53,10 @@ public:
     {
         return destBuffer;
     }
-    void updateFilter();
 
     void prepareToPlay(double sampleRate, int estimatedSamplesPerBlock);
     void releaseResources();
-    void process(AudioSampleBuffer& buffer, MidiBuffer& midiMessages);
+    void process(AudioSampleBuffer& buffer);
     void setParameter(int parameterIndex, float newValue);
 
     AudioSampleBuffer* getContinuousBuffer()
@@ -72,12 +69,11 @@ private:
 
     // sample rate, timebase, and ratio info:
     double sourceBufferSampleRate, destBufferSampleRate;
-    double ratio, lastRatio;
     double destBufferTimebaseSecs;
     int destBufferWidth;
 
     // major objects:
-    Dsp::Filter* filter;
+    OwnedArray<PolyphaseResampler> resamplers;
     AudioSampleBuffer* destBuffer;
     AudioSampleBuffer* tempBuffer;
 
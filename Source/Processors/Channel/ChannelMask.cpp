@@ -0,0 +1,168 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "ChannelMask.h"
+
+ChannelMask::ChannelMask()
+	: m_numChannels(0)
+{
+}
+
+ChannelMask::ChannelMask(int numChannels, bool initialState)
+	: m_numChannels(0)
+{
+	setNumChannels(numChannels, initialState);
+}
+
+void ChannelMask::setNumChannels(int numChannels, bool newChannelsState)
+{
+	numChannels = jmax(0, numChannels);
+
+	if (numChannels == m_numChannels)
+		return;
+
+	const int oldNumChannels = m_numChannels;
+	m_numChannels = numChannels;
+	m_words.resize((numChannels + 63) >> 6);
+
+	if (newChannelsState)
+	{
+		for (int i = oldNumChannels; i < numChannels; ++i)
+			set(i, true);
+	}
+
+	clearUnusedBits();
+}
+
+int ChannelMask::getNumChannels() const
+{
+	return m_numChannels;
+}
+
+void ChannelMask::set(int channel, bool state)
+{
+	if (!isPositiveAndBelow(channel, m_numChannels))
+		return;
+
+	uint64& word = m_words.getReference(channel >> 6);
+	const uint64 bit = uint64(1) << (channel & 63);
+
+	if (state)
+		word |= bit;
+	else
+		word &= ~bit;
+}
+
+void ChannelMask::setAll(bool state)
+{
+	const uint64 word = state ? ~uint64(0) : uint64(0);
+
+	for (int w = 0; w < m_words.size(); ++w)
+		m_words.setUnchecked(w, word);
+
+	clearUnusedBits();
+}
+
+bool ChannelMask::isSet(int channel) const
+{
+	if (!isPositiveAndBelow(channel, m_numChannels))
+		return false;
+
+	return (m_words.getUnchecked(channel >> 6) >> (channel & 63)) & 1;
+}
+
+bool ChannelMask::operator[](int channel) const
+{
+	return isSet(channel);
+}
+
+int ChannelMask::countSet() const
+{
+	int total = 0;
+
+	for (int w = 0; w < m_words.size(); ++w)
+		total += countNumberOfBits(m_words.getUnchecked(w));
+
+	return total;
+}
+
+bool ChannelMask::isEmpty() const
+{
+	for (int w = 0; w < m_words.size(); ++w)
+		if (m_words.getUnchecked(w) != 0)
+			return false;
+
+	return true;
+}
+
+int ChannelMask::findNextSet(int fromChannel) const
+{
+	fromChannel = jmax(0, fromChannel);
+
+	if (fromChannel >= m_numChannels)
+		return -1;
+
+	int w = fromChannel >> 6;
+	uint64 bits = m_words.getUnchecked(w) & (~uint64(0) << (fromChannel & 63));
+
+	while (bits == 0)
+	{
+		if (++w >= m_words.size())
+			return -1;
+
+		bits = m_words.getUnchecked(w);
+	}
+
+	return (w << 6) + getLowestSetBit(bits);
+}
+
+void ChannelMask::getSetChannels(Array<int>& channels) const
+{
+	channels.clearQuick();
+	channels.ensureStorageAllocated(countSet());
+	forEachSet([&channels](int chan) { channels.add(chan); });
+}
+
+bool ChannelMask::operator==(const ChannelMask& other) const
+{
+	return m_numChannels == other.m_numChannels && m_words == other.m_words;
+}
+
+bool ChannelMask::operator!=(const ChannelMask& other) const
+{
+	return !operator==(other);
+}
+
+int ChannelMask::getLowestSetBit(uint64 bits)
+{
+	// the bits below the lowest set one, counted
+	return countNumberOfBits((bits & (~bits + 1)) - 1);
+}
+
+void ChannelMask::clearUnusedBits()
+{
+	const int usedBits = m_numChannels & 63;
+
+	if (usedBits != 0)
+		m_words.getReference(m_words.size() - 1) &= (uint64(1) << usedBits) - 1;
+}
@@ -0,0 +1,98 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef CHANNELMASK_H_INCLUDED
+#define CHANNELMASK_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "../PluginManager/OpenEphysPlugin.h"
+
+/**
+Set of selected channels, such as the ones being recorded, monitored or filtered, packed
+one bit per channel into 64-bit words.
+
+Counting and walking the selected channels looks at a whole word at a time, so a processing
+loop over a mostly empty selection does not visit every channel:
+
+mask.forEachSet([&](int chan) { ... });
+
+Channels beyond getNumChannels() read as not selected.
+*/
+class PLUGIN_API ChannelMask
+{
+public:
+	ChannelMask();
+	explicit ChannelMask(int numChannels, bool initialState = false);
+
+	/** Changes the number of channels, keeping the state of the ones already there.
+	Added channels are set to newChannelsState */
+	void setNumChannels(int numChannels, bool newChannelsState = false);
+	int getNumChannels() const;
+
+	/** Channels outside the mask are ignored */
+	void set(int channel, bool state);
+	void setAll(bool state);
+
+	bool isSet(int channel) const;
+	bool operator[](int channel) const;
+
+	/** Number of selected channels */
+	int countSet() const;
+	bool isEmpty() const;
+
+	/** The first selected channel from the given one on, or -1 if there is none */
+	int findNextSet(int fromChannel) const;
+
+	/** Replaces the contents of the array with the selected channels, in increasing order */
+	void getSetChannels(Array<int>& channels) const;
+
+	/** Calls function(channel) for every selected channel, in increasing order */
+	template <typename FunctionType>
+	void forEachSet(FunctionType function) const
+	{
+		const int numWords = m_words.size();
+
+		for (int w = 0; w < numWords; ++w)
+		{
+			for (uint64 bits = m_words.getUnchecked(w); bits != 0; bits &= bits - 1)
+				function((w << 6) + getLowestSetBit(bits));
+		}
+	}
+
+	bool operator==(const ChannelMask& other) const;
+	bool operator!=(const ChannelMask& other) const;
+
+private:
+	/** Index of the lowest set bit of a non-zero word */
+	static int getLowestSetBit(uint64 bits);
+
+	/** Keeps the bits past the last channel cleared, so that whole words can be counted and compared */
+	void clearUnusedBits();
+
+	Array<uint64> m_words;
+	int m_numChannels;
+
+	JUCE_LEAK_DETECTOR(ChannelMask);
+};
+
+#endif
@@ -199,6 +199,8 @@ bool InfoObjectCommon::isEqual(const InfoObjectCommon& other, bool similar) cons
 }
 
 //DataChannel
+Atomic<uint32> DataChannel::m_stateGeneration(0);
+
 
 DataChannel::DataChannel(DataChannelTypes type, float sampleRate, GenericProcessor* source, uint16 subproc) :
 	InfoObjectCommon(source->dataChannelCount++, source->dataChannelTypeCount[type]++, sampleRate, source, subproc),
@@ -215,7 +217,9 @@ DataChannel::DataChannel(const DataChannel& ch)
 		m_bitVolts(ch.m_bitVolts),
 		m_isEnabled(true),
 		m_isMonitored(false),
-		m_isRecording(false)
+		m_isRecording(false),
+		m_recordDecimation(1),
+		m_hasRawSamples(ch.m_hasRawSamples)
 {
 }
 
@@ -270,25 +274,58 @@ bool DataChannel::isMonitored() const
 
 void DataChannel::setMonitored(bool e)
 {
+	if (m_isMonitored != e)
+		++m_stateGeneration;
 	m_isMonitored = e;
 }
 
 void DataChannel::setRecordState(bool t)
 {
+	if (m_isRecording != t)
+		++m_stateGeneration;
 	m_isRecording = t;
 }
 
+uint32 DataChannel::getStateGeneration()
+{
+	return m_stateGeneration.get();
+}
+
 bool DataChannel::getRecordState() const
 {
 	return m_isRecording;
 }
 
+void DataChannel::setRecordDecimation(int factor)
+{
+	m_recordDecimation = jmax(1, factor);
+}
+
+int DataChannel::getRecordDecimation() const
+{
+	return m_recordDecimation;
+}
+
+void DataChannel::setRawSamplesAvailable(bool available)
+{
+	m_hasRawSamples = available;
+}
+
+bool DataChannel::hasRawSamples() const
+{
+	return m_hasRawSamples;
+}
+
 void DataChannel::reset()
 {
 	m_bitVolts = 1.0f;
 	m_isEnabled = true;
+	if (m_isMonitored || m_isRecording)
+		++m_stateGeneration;
 	m_isMonitored = false;
 	m_isRecording = false;
+	m_recordDecimation = 1;
+	m_hasRawSamples = false;
 }
 
 void DataChannel::setDefaultNameAndDescription() 
@@ -335,6 +372,64 @@ bool DataChannel::checkEqual(const InfoObjectCommon& other, bool similar) const
 	else return hasSameMetadata(o);
 }
 
+//DataChannelTable
+DataChannelTable::DataChannelTable()
+	: m_stateGeneration(0)
+{
+}
+
+void DataChannelTable::build(const OwnedArray<DataChannel>& channels)
+{
+	const int n = channels.size();
+
+	bitVolts.clearQuick();
+	sampleRate.clearQuick();
+	sourceId.clearQuick();
+	bitVolts.ensureStorageAllocated(n);
+	sampleRate.ensureStorageAllocated(n);
+	sourceId.ensureStorageAllocated(n);
+
+	for (int i = 0; i < n; i++)
+	{
+		const DataChannel* chan = channels.getUnchecked(i);
+		bitVolts.add(chan->getBitVolts());
+		sampleRate.add(chan->getSampleRate());
+		sourceId.add(GenericProcessor::getProcessorFullId(chan->getSourceNodeID(), chan->getSubProcessorIdx()));
+	}
+
+	recordEnabled.clearQuick();
+	monitored.clearQuick();
+	recordEnabled.insertMultiple(0, false, n);
+	monitored.insertMultiple(0, false, n);
+
+	m_stateGeneration = DataChannel::getStateGeneration() - 1;
+	refreshStates(channels);
+}
+
+void DataChannelTable::refreshStates(const OwnedArray<DataChannel>& channels)
+{
+	const uint32 generation = DataChannel::getStateGeneration();
+
+	if (generation == m_stateGeneration)
+		return;
+
+	m_stateGeneration = generation;
+
+	// channels can't be added without a build(), so the sizes match
+	const int n = jmin(channels.size(), monitored.size());
+	for (int i = 0; i < n; i++)
+	{
+		const DataChannel* chan = channels.getUnchecked(i);
+		recordEnabled.setUnchecked(i, chan->getRecordState());
+		monitored.setUnchecked(i, chan->isMonitored());
+	}
+}
+
+int DataChannelTable::size() const
+{
+	return bitVolts.size();
+}
+
 //EventChannel
 EventChannel::EventChannel(EventChannelTypes type, unsigned int nChannels, unsigned int dataLength, float sampleRate, GenericProcessor* source, uint16 subproc)
 	: InfoObjectCommon(source->eventChannelCount++, source->eventChannelTypeCount[type]++, sampleRate, source, subproc),
@@ -254,6 +254,25 @@ public:
 	/** Informs whether or not the channel will record. */
 	bool getRecordState() const;
 
+	/** Sets by how much the record engines that support it lower the rate of this channel when
+	recording it, 1 to record it at its own rate. */
+	void setRecordDecimation(int factor);
+
+	/** Returns the factor the channel is decimated by when it is recorded, 1 if it is recorded at its own rate. */
+	int getRecordDecimation() const;
+
+	/** Sets whether the original integer codes of this channel's samples can be retrieved from its source
+	processor (see GenericProcessor::getRawSampleData). Cleared by any processor in the chain that modifies the data. */
+	void setRawSamplesAvailable(bool available);
+
+	/** Returns true if the samples reaching this point are unmodified and their original integer codes
+	are available from the source processor. */
+	bool hasRawSamples() const;
+
+	/** Returns a counter that changes whenever the record or monitor state of any data channel does,
+	so that copies of these flags can tell when they need refreshing. */
+	static uint32 getStateGeneration();
+
 	//---------- OTHER METHODS ------------//
 	/** Restores the default settings for a given channel. */
 	void reset();
@@ -267,11 +286,44 @@ private:
 	bool m_isEnabled{ true };
 	bool m_isMonitored{ false };
 	bool m_isRecording{ false };
+	int m_recordDecimation{ 1 };
+	bool m_hasRawSamples{ false };
 	String m_unitName{ "uV" };
 
+	static Atomic<uint32> m_stateGeneration;
+
 	JUCE_LEAK_DETECTOR(DataChannel);
 };
 
+/** The values of a set of data channels most often needed by per-block code, kept in contiguous
+arrays indexed like the channels so that loops over many channels don't follow a pointer per channel.
+
+@see GenericProcessor::getDataChannelTable */
+class PLUGIN_API DataChannelTable
+{
+public:
+	DataChannelTable();
+
+	/** Rebuilds all arrays from the channels. */
+	void build(const OwnedArray<DataChannel>& channels);
+
+	/** Copies the record and monitor flags of the channels again, if any data channel's have changed
+	since the last build() or refreshStates(). Cheap enough to be called at the start of every block. */
+	void refreshStates(const OwnedArray<DataChannel>& channels);
+
+	int size() const;
+
+	Array<float> bitVolts;
+	Array<float> sampleRate;
+	/** Full source IDs, as returned by GenericProcessor::getProcessorFullId() */
+	Array<uint32> sourceId;
+	Array<bool> recordEnabled;
+	Array<bool> monitored;
+
+private:
+	uint32 m_stateGeneration;
+};
+
 class PLUGIN_API EventChannel :
 	public InfoObjectCommon, public MetaDataInfoObject, public MetaDataEventObject
 {
@@ -297,12 +297,33 @@ void MetaDataValue::setValue(const void* data)
 
 //Actual template instantiations at the end of the file
 
+//MetaDataSet
+
+MetaDataSet::MetaDataSet() {}
+
+MetaDataSet::MetaDataSet(const MetaDataSet& other)
+	: ReferenceCountedObject(),
+	descriptors(other.descriptors),
+	values(other.values),
+	offsets(other.offsets)
+{}
+
 //MetaDataInfoObject
 
 MetaDataInfoObject::MetaDataInfoObject() {}
 
 MetaDataInfoObject::~MetaDataInfoObject() {}
 
+MetaDataSet& MetaDataInfoObject::getWritableMetaData()
+{
+	if (m_metaData == nullptr)
+		m_metaData = new MetaDataSet();
+	else if (m_metaData->getReferenceCount() > 1)
+		m_metaData = new MetaDataSet(*m_metaData);
+
+	return *m_metaData;
+}
+
 void MetaDataInfoObject::addMetaData(MetaDataDescriptor* desc, MetaDataValue* val)
 {
 	if (desc->getType() != val->getDataType() || desc->getLength() != val->getDataLength())
@@ -315,8 +336,9 @@ void MetaDataInfoObject::addMetaData(MetaDataDescriptor* desc, MetaDataValue* va
 		delete val;
 		return;
 	}
-	m_metaDataDescriptorArray.add(desc);
-	m_metaDataValueArray.add(val);
+	MetaDataSet& metaData = getWritableMetaData();
+	metaData.descriptors.add(desc);
+	metaData.values.add(val);
 }
 
 void MetaDataInfoObject::addMetaData(const MetaDataDescriptor& desc, const MetaDataValue& val)
@@ -326,31 +348,32 @@ void MetaDataInfoObject::addMetaData(const MetaDataDescriptor& desc, const MetaD
 		jassertfalse;
 		return;
 	}
-	m_metaDataDescriptorArray.add(new MetaDataDescriptor(desc));
-	m_metaDataValueArray.add(new MetaDataValue(val));
+	MetaDataSet& metaData = getWritableMetaData();
+	metaData.descriptors.add(new MetaDataDescriptor(desc));
+	metaData.values.add(new MetaDataValue(val));
 }
 
 const MetaDataDescriptor* MetaDataInfoObject::getMetaDataDescriptor(int index) const
 {
-	return m_metaDataDescriptorArray[index];
+	return m_metaData != nullptr ? m_metaData->descriptors[index].get() : nullptr;
 }
 
 const MetaDataValue* MetaDataInfoObject::getMetaDataValue(int index) const
 {
-	return m_metaDataValueArray[index];
+	return m_metaData != nullptr ? m_metaData->values[index].get() : nullptr;
 }
 
 const int MetaDataInfoObject::getMetaDataCount() const
 {
-	return m_metaDataDescriptorArray.size();
+	return m_metaData != nullptr ? m_metaData->descriptors.size() : 0;
 }
 
 int MetaDataInfoObject::findMetaData(MetaDataDescriptor::MetaDataTypes type, unsigned int length, String identifier) const
 {
-	int nMetaData = m_metaDataDescriptorArray.size();
+	int nMetaData = getMetaDataCount();
 	for (int i = 0; i < nMetaData; i++)
 	{
-		MetaDataDescriptorPtr md = m_metaDataDescriptorArray[i];
+		MetaDataDescriptorPtr md = m_metaData->descriptors[i];
 		if (md->getType() == type && md->getLength() == length && compareIdentifierStrings(identifier,md->getIdentifier()))
 			return i;
 	}
@@ -369,12 +392,14 @@ bool MetaDataInfoObject::hasSimilarMetadata(const MetaDataInfoObject& other) con
 
 bool MetaDataInfoObject::checkMetaDataCoincidence(const MetaDataInfoObject& other, bool similar) const
 {
-	int nMetaData = m_metaDataDescriptorArray.size();
-	if (nMetaData != other.m_metaDataDescriptorArray.size()) return false;
+	//copies that haven't added anything since share the whole set
+	if (m_metaData == other.m_metaData) return true;
+	int nMetaData = getMetaDataCount();
+	if (nMetaData != other.getMetaDataCount()) return false;
 	for (int i = 0; i < nMetaData; i++)
 	{
-		MetaDataDescriptorPtr md = m_metaDataDescriptorArray[i];
-		MetaDataDescriptorPtr mdo = other.m_metaDataDescriptorArray[i];
+		MetaDataDescriptorPtr md = m_metaData->descriptors[i];
+		MetaDataDescriptorPtr mdo = other.m_metaData->descriptors[i];
 		if (similar)
 		{
 			if (!md->isSimilar(*mdo)) return false;
@@ -393,6 +418,16 @@ MetaDataEventObject::MetaDataEventObject() {}
 
 MetaDataEventObject::~MetaDataEventObject() {}
 
+MetaDataSet& MetaDataEventObject::getWritableEventMetaData()
+{
+	if (m_eventMetaData == nullptr)
+		m_eventMetaData = new MetaDataSet();
+	else if (m_eventMetaData->getReferenceCount() > 1)
+		m_eventMetaData = new MetaDataSet(*m_eventMetaData);
+
+	return *m_eventMetaData;
+}
+
 void MetaDataEventObject::addEventMetaData(MetaDataDescriptor* desc)
 {
 	if (eventMetaDataLock)
@@ -401,7 +436,9 @@ void MetaDataEventObject::addEventMetaData(MetaDataDescriptor* desc)
 		jassertfalse;
 		return;
 	}
-	m_eventMetaDataDescriptorArray.add(desc);
+	MetaDataSet& metaData = getWritableEventMetaData();
+	metaData.descriptors.add(desc);
+	metaData.offsets.add(m_totalSize);
 	size_t size = desc->getDataSize();
 	m_totalSize += size;
 	if (m_maxSize < size)
@@ -416,7 +453,9 @@ void MetaDataEventObject::addEventMetaData(const MetaDataDescriptor& desc)
 		jassertfalse;
 		return;
 	}
-	m_eventMetaDataDescriptorArray.add(new MetaDataDescriptor(desc));
+	MetaDataSet& metaData = getWritableEventMetaData();
+	metaData.descriptors.add(new MetaDataDescriptor(desc));
+	metaData.offsets.add(m_totalSize);
 	size_t size = desc.getDataSize();
 	m_totalSize += size;
 	if (m_maxSize < size)
@@ -430,20 +469,25 @@ size_t MetaDataEventObject::getTotalEventMetaDataSize() const
 
 const MetaDataDescriptor* MetaDataEventObject::getEventMetaDataDescriptor(int index) const
 {
-	return m_eventMetaDataDescriptorArray[index];
+	return m_eventMetaData != nullptr ? m_eventMetaData->descriptors[index].get() : nullptr;
 }
 
 int MetaDataEventObject::getEventMetaDataCount() const
 {
-	return m_eventMetaDataDescriptorArray.size();
+	return m_eventMetaData != nullptr ? m_eventMetaData->descriptors.size() : 0;
+}
+
+size_t MetaDataEventObject::getEventMetaDataOffset(int index) const
+{
+	return m_eventMetaData != nullptr ? m_eventMetaData->offsets[index] : 0;
 }
 
 int MetaDataEventObject::findEventMetaData(MetaDataDescriptor::MetaDataTypes type, unsigned int length, String descriptor) const
 {
-	int nMetaData = m_eventMetaDataDescriptorArray.size();
+	int nMetaData = getEventMetaDataCount();
 	for (int i = 0; i < nMetaData; i++)
 	{
-		MetaDataDescriptorPtr md = m_eventMetaDataDescriptorArray[i];
+		MetaDataDescriptorPtr md = m_eventMetaData->descriptors[i];
 		if (md->getType() == type && md->getLength() == length && compareIdentifierStrings(descriptor,md->getIdentifier()))
 			return i;
 	}
@@ -462,12 +506,14 @@ bool MetaDataEventObject::hasSimilarEventMetadata(const MetaDataEventObject& oth
 
 bool MetaDataEventObject::checkMetaDataCoincidence(const MetaDataEventObject& other, bool similar) const
 {
-	int nMetaData = m_eventMetaDataDescriptorArray.size();
-	if (nMetaData != other.m_eventMetaDataDescriptorArray.size()) return false;
+	//copies down the chain can't add event metadata, so they normally share the whole set
+	if (m_eventMetaData == other.m_eventMetaData) return true;
+	int nMetaData = getEventMetaDataCount();
+	if (nMetaData != other.getEventMetaDataCount()) return false;
 	for (int i = 0; i < nMetaData; i++)
 	{
-		MetaDataDescriptorPtr md = m_eventMetaDataDescriptorArray[i];
-		MetaDataDescriptorPtr mdo = other.m_eventMetaDataDescriptorArray[i];
+		MetaDataDescriptorPtr md = m_eventMetaData->descriptors[i];
+		MetaDataDescriptorPtr mdo = other.m_eventMetaData->descriptors[i];
 		if (similar)
 		{
 			if (!md->isSimilar(*mdo)) return false;
@@ -488,50 +534,85 @@ size_t MetaDataEventObject::getMaxEventMetaDataSize() const
 //MetaDataEvent
 MetaDataEvent::MetaDataEvent() {}
 
+MetaDataEvent::MetaDataEvent(const MetaDataEvent& other)
+	: m_metaDataInfo(other.m_metaDataInfo),
+	m_numMetaDataValues(other.m_numMetaDataValues)
+{
+	if (m_numMetaDataValues > 0)
+	{
+		size_t size = m_metaDataInfo->getTotalEventMetaDataSize();
+		m_metaDataBlock.malloc(size);
+		memcpy(m_metaDataBlock.getData(), other.m_metaDataBlock.getData(), size);
+	}
+}
+
 MetaDataEvent::~MetaDataEvent() {}
 
 int MetaDataEvent::getMetadataValueCount() const
 {
-	return m_metaDataValues.size();
+	return m_numMetaDataValues;
 }
 
 const MetaDataValue* MetaDataEvent::getMetaDataValue(int index) const
 {
+	if (!isPositiveAndBelow(index, m_numMetaDataValues))
+		return nullptr;
+
+	if (m_metaDataValues.size() == 0)
+	{
+		MetaDataValueArray values;
+		values.ensureStorageAllocated(m_numMetaDataValues);
+		for (int i = 0; i < m_numMetaDataValues; i++)
+			values.add(new MetaDataValue(*m_metaDataInfo->getEventMetaDataDescriptor(i), getMetaDataValuePointer(i)));
+		m_metaDataValues.swapWith(values);
+	}
 	return m_metaDataValues[index];
 }
 
-void MetaDataEvent::serializeMetaData(void* dstBuffer) const
+const void* MetaDataEvent::getMetaDataValuePointer(int index) const
 {
-	int metaDataSize = m_metaDataValues.size();
-	char* buffer = static_cast<char*>(dstBuffer);
-	size_t ptrIndex = 0;
+	if (!isPositiveAndBelow(index, m_numMetaDataValues))
+		return nullptr;
 
-	for (int i = 0; i < metaDataSize; i++)
-	{
-		MetaDataValuePtr val = m_metaDataValues[i];
-		memcpy(buffer + ptrIndex, val->m_data.getData(), val->m_size);
-		ptrIndex += val->m_size;
-	}
+	return m_metaDataBlock.getData() + m_metaDataInfo->getEventMetaDataOffset(index);
+}
+
+void MetaDataEvent::serializeMetaData(void* dstBuffer) const
+{
+	if (m_numMetaDataValues > 0)
+		memcpy(dstBuffer, m_metaDataBlock.getData(), m_metaDataInfo->getTotalEventMetaDataSize());
 }
 
 bool MetaDataEvent::deserializeMetaData(const MetaDataEventObject* info, const void* srcBuffer, int size)
 {
-	MetaDataValueArray metaData;
-	int nMetaData = info->getEventMetaDataCount();
-	size_t memIndex = 0;
-	for (int i = 0; i < nMetaData; i++)
-	{
-		const MetaDataDescriptor* desc = info->getEventMetaDataDescriptor(i);
-		size_t dataSize = desc->getDataSize();
-		if ((memIndex + dataSize) > size) return false; //check for buffer boundaries
-		
-		metaData.add(new MetaDataValue(*desc, (static_cast<const char*>(srcBuffer) + memIndex)));
-		memIndex += dataSize;
-	}
-	m_metaDataValues.swapWith(metaData);
+	size_t dataSize = info->getTotalEventMetaDataSize();
+	if (size < 0 || dataSize > (size_t) size) return false; //check for buffer boundaries
+
+	m_metaDataInfo = info;
+	m_numMetaDataValues = info->getEventMetaDataCount();
+	m_metaDataValues.clear();
+	m_metaDataBlock.malloc(jmax(dataSize, size_t(1)));
+	memcpy(m_metaDataBlock.getData(), srcBuffer, dataSize);
 	return true;
 }
 
+void MetaDataEvent::setMetaData(const MetaDataEventObject* info, const MetaDataValueArray& metaData)
+{
+	m_metaDataInfo = info;
+	m_numMetaDataValues = metaData.size();
+	m_metaDataValues.clear();
+
+	if (m_numMetaDataValues == 0)
+		return;
+
+	m_metaDataBlock.malloc(jmax(info->getTotalEventMetaDataSize(), size_t(1)));
+
+	//the values have been checked against the descriptors, so they have the same sizes
+	MetaDataValue* const* values = metaData.getRawDataPointer();
+	for (int i = 0; i < m_numMetaDataValues; i++)
+		memcpy(m_metaDataBlock.getData() + info->getEventMetaDataOffset(i), values[i]->m_data.getData(), values[i]->m_size);
+}
+
 MetaDataEventLock::MetaDataEventLock() {}
 
 //Specific instantiations for templated metadata members.
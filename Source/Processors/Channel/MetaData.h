@@ -176,6 +176,26 @@ typedef ReferenceCountedArray<MetaDataValue,CriticalSection> MetaDataValueArray;
 typedef ReferenceCountedObjectPtr<MetaDataDescriptor> MetaDataDescriptorPtr;
 typedef ReferenceCountedObjectPtr<MetaDataValue> MetaDataValuePtr;
 
+/** The metadata of an info object. Copies of the object, such as the ones made by every processor
+down the chain, share the same set until one of them adds metadata, at which point it gets its own (copy on write).
+Since descriptors and values can't be modified once added, the set copy still shares them. */
+class PLUGIN_API MetaDataSet
+	: public ReferenceCountedObject
+{
+public:
+	MetaDataSet();
+	MetaDataSet(const MetaDataSet& other);
+
+	MetaDataDescriptorArray descriptors;
+	/** Not used by the event metadata of event and spike channels, which only has descriptors */
+	MetaDataValueArray values;
+	/** For event metadata, the offset of each value in the metadata block of the events */
+	Array<size_t> offsets;
+
+	JUCE_LEAK_DETECTOR(MetaDataSet);
+};
+typedef ReferenceCountedObjectPtr<MetaDataSet> MetaDataSetPtr;
+
 //Inherited for all info objects that have metadata
 class PLUGIN_API MetaDataInfoObject
 {
@@ -191,11 +211,11 @@ public:
 	const int getMetaDataCount() const;
 	bool hasSameMetadata(const MetaDataInfoObject& other) const;
 	bool hasSimilarMetadata(const MetaDataInfoObject& other) const;
-protected:
-	MetaDataDescriptorArray m_metaDataDescriptorArray;
-	MetaDataValueArray m_metaDataValueArray;
 private:
+	/** The set this object can add to, copying the shared one first if needed */
+	MetaDataSet& getWritableMetaData();
 	bool checkMetaDataCoincidence(const MetaDataInfoObject& other, bool similar) const;
+	MetaDataSetPtr m_metaData;
 };
 
 class PLUGIN_API MetaDataEventLock
@@ -222,31 +242,50 @@ public:
 	int findEventMetaData(MetaDataDescriptor::MetaDataTypes type, unsigned int length, String identifier = String::empty) const;
 	size_t getTotalEventMetaDataSize() const;
 	int getEventMetaDataCount() const;
+	/** Position of the value of a metadata field in the metadata block of the events, where the
+	values follow each other in the order of the descriptors */
+	size_t getEventMetaDataOffset(int index) const;
 	//gets the largest metadata size, which can be useful to reserve buffers in advance
 	size_t getMaxEventMetaDataSize() const;
 	bool hasSameEventMetadata(const MetaDataEventObject& other) const;
 	bool hasSimilarEventMetadata(const MetaDataEventObject& other) const;
 protected:
-	MetaDataDescriptorArray m_eventMetaDataDescriptorArray;
 	MetaDataEventObject();
 	size_t m_totalSize{ 0 };
 	size_t m_maxSize{ 0 };
 private:
+	/** The set this object can add to, copying the shared one first if needed */
+	MetaDataSet& getWritableEventMetaData();
 	bool checkMetaDataCoincidence(const MetaDataEventObject& other, bool similar) const;
+	MetaDataSetPtr m_eventMetaData;
 };
 
 //And the base from which event objects can hold their metadata before serializing
+//The values are held in a single block laid out as the channel's descriptors say, the same way they are serialized,
+//so that creating, serializing and deserializing events only copies that block, without locks or an allocation per value.
 class PLUGIN_API MetaDataEvent
 {
 public:
     virtual ~MetaDataEvent();
 	int getMetadataValueCount() const;
+	/** Wraps the value in a MetaDataValue, created the first time it is asked for */
 	const MetaDataValue* getMetaDataValue(int index) const;
+	/** The value straight from the event's metadata block, without creating any object,
+	or nullptr if there is no such value. Valid for as long as the event is */
+	const void* getMetaDataValuePointer(int index) const;
 protected:
 	void serializeMetaData(void* dstBuffer) const;
 	bool deserializeMetaData(const MetaDataEventObject* info, const void* srcBuffer, int size);
+	/** Copies the values, which must match the descriptors of the channel, into the metadata block */
+	void setMetaData(const MetaDataEventObject* info, const MetaDataValueArray& metaData);
 	MetaDataEvent();
-	MetaDataValueArray m_metaDataValues;
+	MetaDataEvent(const MetaDataEvent& other);
+private:
+	MetaDataEvent& operator= (const MetaDataEvent&) = delete;
+	const MetaDataEventObject* m_metaDataInfo{ nullptr };
+	HeapBlock<char> m_metaDataBlock;
+	int m_numMetaDataValues{ 0 };
+	mutable MetaDataValueArray m_metaDataValues;
 };
 
 //Helper function to compare identifier strings
@@ -21,15 +21,80 @@
 */
 
 #include "DataBuffer.h"
+#include "../GenericProcessor/MemoryFootprint.h"
+
+// Timestamp discontinuities are rare (dropped or resynchronized frames), so their ring gets a
+// fraction of the sample ring. A fast digital input can change the event code on every sample,
+// so that ring holds a run per sample, plus the runs still in effect, and never fills first.
+static int getTimestampRunCapacity (int size) { return size / 16 + 16; }
+static int getEventCodeRunCapacity (int size) { return size + 16; }
+
+
+template <typename Run>
+static const Run& getRun (const HeapBlock<Run>& runs, int n, int index1, int size1, int index2)
+{
+    return runs[n < size1 ? index1 + n : index2 + n - size1];
+}
+
+
+template <typename Run>
+static bool appendRun (AbstractFifo& fifo, HeapBlock<Run>& runs, const Run& run)
+{
+    int index1, size1, index2, size2;
+    fifo.prepareToWrite (1, index1, size1, index2, size2);
+
+    if (size1 + size2 == 0)
+        return false;
+
+    runs[size1 > 0 ? index1 : index2] = run;
+    fifo.finishedWrite (1);
+
+    return true;
+}
+
+
+/** Discards the runs that were superseded before upToSample, keeping the one still in effect.*/
+template <typename Run>
+static void releaseRunsBefore (AbstractFifo& fifo, const HeapBlock<Run>& runs, int64 upToSample)
+{
+    const int numRuns = fifo.getNumReady();
+
+    int index1, size1, index2, size2;
+    fifo.prepareToRead (numRuns, index1, size1, index2, size2);
+
+    int numReleased = 0;
+    while (numReleased + 1 < numRuns
+           && getRun (runs, numReleased + 1, index1, size1, index2).startSample <= upToSample)
+        ++numReleased;
+
+    fifo.finishedRead (numReleased);
+}
 
 
 DataBuffer::DataBuffer (int chans, int size)
     : abstractFifo  (size)
-    , buffer        (chans, size)
+    , placement     (LargeSampleBlock::NORMAL_PAGES)
+    , timestampRunFifo (getTimestampRunCapacity (size))
+    , eventCodeRunFifo (getEventCodeRunCapacity (size))
+    , samplesWritten (0)
+    , nextTimestamp (0)
+    , lastEventCode (0)
+    , writeCapacity (0)
+    , writeSamples  (0)
+    , writeInProgress (false)
+    , samplesRead   (0)
     , numChans      (chans)
+    , bufferSize    (size)
+    , minimumSize   (0)
+    , rawEnabled    (false)
+    , highWaterMark (0)
+    , droppedSamples (0)
+    , readLatency   (0)
+    , readSamples   (0)
+    , readInProgress (false)
 {
-    timestampBuffer.malloc (size);
-    eventCodeBuffer.malloc (size);
+    samples.allocate (buffer, chans, size, placement);
+    allocateRuns (size);
 }
 
 
@@ -40,59 +105,315 @@ void DataBuffer::clear()
 {
     buffer.clear();
     abstractFifo.reset();
+    timestampRunFifo.reset();
+    eventCodeRunFifo.reset();
+
+    samplesWritten = 0;
+    samplesRead = 0;
+    readSamples = 0;
+    readInProgress = false;
+    writeSamples = 0;
+    writeInProgress = false;
 }
 
 
 void DataBuffer::resize (int chans, int size)
 {
-    buffer.setSize (chans, size);
+    size = jmax (size, minimumSize);
 
-    timestampBuffer.malloc (size);
-    eventCodeBuffer.malloc (size);
+    if (size != bufferSize)
+    {
+        abstractFifo.setTotalSize (size);
+        allocateRuns (size);
+
+        samplesWritten = 0;
+        samplesRead = 0;
+        readSamples = 0;
+        readInProgress = false;
+        writeSamples = 0;
+        writeInProgress = false;
+    }
+
+    if (chans != buffer.getNumChannels() || size != buffer.getNumSamples())
+        samples.allocate (buffer, chans, size, placement);
 
     numChans = chans;
+    bufferSize = size;
+
+    if (rawEnabled)
+        rawBuffer.calloc (chans * size);
 }
 
-int DataBuffer::addToBuffer (float* data, int64* timestamps, uint64* eventCodes, int numItems, int chunkSize)
+
+void DataBuffer::setPlacement (const LargeSampleBlock::Placement& newPlacement)
+{
+    if (newPlacement == placement)
+        return;
+
+    placement = newPlacement;
+    samples.allocate (buffer, numChans, bufferSize, placement);
+    clear();
+}
+
+
+LargeSampleBlock::PageSize DataBuffer::getPageSize() const { return samples.getPageSize(); }
+
+
+void DataBuffer::allocateRuns (int size)
+{
+    timestampRunFifo.setTotalSize (getTimestampRunCapacity (size));
+    timestampRuns.malloc (getTimestampRunCapacity (size));
+
+    eventCodeRunFifo.setTotalSize (getEventCodeRunCapacity (size));
+    eventCodeRuns.malloc (getEventCodeRunCapacity (size));
+}
+
+
+void DataBuffer::releaseRuns (int64 upToSample)
+{
+    releaseRunsBefore (timestampRunFifo, timestampRuns, upToSample);
+    releaseRunsBefore (eventCodeRunFifo, eventCodeRuns, upToSample);
+}
+
+
+int DataBuffer::getBufferSize() const { return bufferSize; }
+
+int DataBuffer::getHighWaterMark() const { return highWaterMark; }
+
+int64 DataBuffer::getNumDroppedSamples() const { return droppedSamples; }
+
+int DataBuffer::getReadLatency() const { return readLatency; }
+
+
+void DataBuffer::resetStatistics()
+{
+    highWaterMark = 0;
+    droppedSamples = 0;
+    readLatency = 0;
+}
+
+
+bool DataBuffer::autoResize (int maxSize)
+{
+    if ((highWaterMark * 4 < bufferSize * 3 && droppedSamples == 0) || bufferSize >= maxSize)
+        return false;
+
+    minimumSize = jmin (bufferSize * 2, maxSize);
+
+    resize (numChans, minimumSize);
+    clear();
+    resetStatistics();
+
+    return true;
+}
+
+
+void DataBuffer::enableRawSamples (bool enable)
+{
+    rawEnabled = enable;
+
+    if (enable)
+        rawBuffer.calloc (numChans * bufferSize);
+    else
+        rawBuffer.free();
+}
+
+
+bool DataBuffer::hasRawSamples() const { return rawEnabled; }
+
+
+int64 DataBuffer::getMemoryFootprint() const
+{
+    return MemoryFootprint::ofBuffer (buffer)
+        + MemoryFootprint::ofBlock (timestampRuns, timestampRunFifo.getTotalSize())
+        + MemoryFootprint::ofBlock (eventCodeRuns, eventCodeRunFifo.getTotalSize())
+        + MemoryFootprint::ofBlock (rawBuffer, (int64) numChans * bufferSize)
+        + MemoryFootprint::ofBlock (writeTimestamps, writeCapacity)
+        + MemoryFootprint::ofBlock (writeEventCodes, writeCapacity);
+}
+
+
+const int16* DataBuffer::getRawBufferReference (int channel) const
+{
+    if (! rawEnabled)
+        return nullptr;
+
+    return rawBuffer + (channel * bufferSize);
+}
+
+int DataBuffer::appendRuns (const int64* timestamps, const uint64* eventCodes, int numItems)
+{
+    // record where the timestamps jump and the event codes change; if either ring of runs
+    // fills up, the samples from that point on are dropped like those not fitting in the buffer
+    int numWritten = 0;
+
+    for (; numWritten < numItems; ++numWritten)
+    {
+        const int64 sampleNumber = samplesWritten + numWritten;
+
+        if (sampleNumber == 0 || timestamps[numWritten] != nextTimestamp)
+        {
+            const TimestampRun run = { sampleNumber, timestamps[numWritten] };
+
+            if (! appendRun (timestampRunFifo, timestampRuns, run))
+                break;
+        }
+
+        if (sampleNumber == 0 || eventCodes[numWritten] != lastEventCode)
+        {
+            const EventCodeRun run = { sampleNumber, eventCodes[numWritten] };
+
+            if (! appendRun (eventCodeRunFifo, eventCodeRuns, run))
+                break;
+        }
+
+        nextTimestamp = timestamps[numWritten] + 1;
+        lastEventCode = eventCodes[numWritten];
+    }
+
+    return numWritten;
+}
+
+
+void DataBuffer::finishWrite (int numWritten)
+{
+    abstractFifo.finishedWrite (numWritten);
+    samplesWritten += numWritten;
+
+    const int numReady = abstractFifo.getNumReady();
+    if (numReady > highWaterMark)
+        highWaterMark = numReady;
+}
+
+
+int DataBuffer::addToBuffer (float* data, int64* timestamps, uint64* eventCodes, int numItems, int chunkSize, const int16* rawData)
 {
     int startIndex1, blockSize1, startIndex2, blockSize2;
 
     abstractFifo.prepareToWrite (numItems, startIndex1, blockSize1, startIndex2, blockSize2);
 
-    int bs[3] = { blockSize1, blockSize2, 0 };
-    int si[2] = { startIndex1, startIndex2 };
-    int cSize = 0;
-    int idx = 0;
-    int blkIdx;
-
-    for (int i = 0; bs[i] != 0; ++i)
-    {                                // for each of the dest blocks we can write to...
-        blkIdx = 0;
-        for (int j = 0; j < bs[i]; j+= chunkSize) 
-        {                     // for each chunk...
-            cSize = chunkSize <= bs[i] - j ? chunkSize : bs[i] - j;     // figure our how much you can write
-            for (int chan = 0; chan < numChans; ++chan)         // write that much, per channel
-            {
-                buffer.copyFrom (chan,                           // (int destChannel)
-                                 si[i] + j,                      // (int destStartSample)
-                                 data + (idx * numChans) + chan, // (const float* source)
-                                 cSize);                         // (int num samples)
-            }
+    const int numWritten = appendRuns (timestamps, eventCodes, blockSize1 + blockSize2);
+
+    blockSize1 = jmin (blockSize1, numWritten);
+    blockSize2 = numWritten - blockSize1;
+
+    if (numWritten < numItems)
+        droppedSamples += numItems - numWritten;
+
+    if (numWritten <= 0)
+        return 0;
+
+    if (chunkSize < 1)
+        chunkSize = 1;
+
+    const bool storeRaw = rawEnabled && rawData != nullptr;
 
-            for (int k = 0; k < cSize; ++k)
+    for (int chunkStart = 0; chunkStart < numWritten; chunkStart += chunkSize)
+    {                                // for each chunk of the source data...
+        // samples per channel stored in this chunk, and how many of them actually fit
+        const int srcChunkSize = jmin (chunkSize, numItems - chunkStart);
+        const int cSize = jmin (srcChunkSize, numWritten - chunkStart);
+
+        const float* chunkData = data + (chunkStart * numChans);
+
+        // the chunk can straddle the end of the circular buffer
+        const int size1 = jlimit (0, cSize, blockSize1 - chunkStart);
+        const int size2 = cSize - size1;
+        const int dest2 = startIndex2 + jmax (0, chunkStart - blockSize1);
+
+        for (int chan = 0; chan < numChans; ++chan)         // write that much, per channel
+        {
+            const float* src = chunkData + (chan * srcChunkSize);
+
+            if (size1 > 0)
+                buffer.copyFrom (chan, startIndex1 + chunkStart, src, size1);
+
+            if (size2 > 0)
+                buffer.copyFrom (chan, dest2, src + size1, size2);
+
+            if (storeRaw)
             {
-                timestampBuffer[si[i] + blkIdx + k] = timestamps[idx + k];
-                eventCodeBuffer[si[i] + blkIdx + k] = eventCodes[idx + k];
+                const int16* rawSrc = rawData + (chunkStart * numChans) + (chan * srcChunkSize);
+                int16* rawDest = rawBuffer + (chan * bufferSize);
+
+                if (size1 > 0)
+                    memcpy (rawDest + startIndex1 + chunkStart, rawSrc, size1 * sizeof (int16));
+
+                if (size2 > 0)
+                    memcpy (rawDest + dest2, rawSrc + size1, size2 * sizeof (int16));
             }
-            idx     += cSize;
-            blkIdx  += cSize;
         }
     }
 
-    // finish write
-    abstractFifo.finishedWrite (idx);
+    finishWrite (numWritten);
+
+    return numWritten;
+}
+
+
+int DataBuffer::beginWrite (WriteSpan& span, int maxSize)
+{
+    span.timestamps = nullptr;
+    span.eventCodes = nullptr;
+    span.numSamples = 0;
+
+    // only one write can be in progress at any time
+    if (writeInProgress || maxSize <= 0)
+    {
+        span.indexes.index1 = span.indexes.size1 = span.indexes.index2 = span.indexes.size2 = 0;
+        return 0;
+    }
+
+    abstractFifo.prepareToWrite (maxSize, span.indexes.index1, span.indexes.size1,
+                                 span.indexes.index2, span.indexes.size2);
+
+    writeSamples = span.indexes.size1 + span.indexes.size2;
 
-    return idx;
+    // allocated on the first write rather than with the buffer, as most threads never write in place
+    if (writeSamples > writeCapacity)
+    {
+        writeCapacity = bufferSize;
+        writeTimestamps.malloc (writeCapacity);
+        writeEventCodes.malloc (writeCapacity);
+    }
+
+    span.timestamps = writeTimestamps;
+    span.eventCodes = writeEventCodes;
+    span.numSamples = writeSamples;
+    writeInProgress = true;
+
+    return writeSamples;
+}
+
+
+int DataBuffer::commitWrite (int numItems)
+{
+    if (! writeInProgress)
+        return 0;
+
+    const int numWritten = appendRuns (writeTimestamps, writeEventCodes, jlimit (0, writeSamples, numItems));
+
+    if (numWritten < numItems)
+        droppedSamples += numItems - numWritten;
+
+    finishWrite (numWritten);
+
+    writeSamples = 0;
+    writeInProgress = false;
+
+    return numWritten;
+}
+
+
+float* DataBuffer::getWritePointer (int channel) { return buffer.getWritePointer (channel); }
+
+
+int16* DataBuffer::getRawWritePointer (int channel)
+{
+    if (! rawEnabled)
+        return nullptr;
+
+    return rawBuffer + (channel * bufferSize);
 }
 
 
@@ -106,6 +427,7 @@ int DataBuffer::readAllFromBuffer (AudioSampleBuffer& data, uint64* timestamp, u
     // Better version (1/27/14)?
     int numReady = abstractFifo.getNumReady();
     int numItems = (maxSize < numReady) ? maxSize : numReady;
+    readLatency = numReady;
 
     // Original version:
     //int numItems = (maxSize < abstractFifo.getNumReady()) ?
@@ -127,13 +449,6 @@ int DataBuffer::readAllFromBuffer (AudioSampleBuffer& data, uint64* timestamp, u
                            startIndex1,     // sourceStartSample
                            blockSize1);     // numSamples
         }
-
-        memcpy (timestamp, timestampBuffer + startIndex1, 8);
-        memcpy (eventCodes, eventCodeBuffer + startIndex1, blockSize1 * 8);
-    }
-    else
-    {
-        memcpy (timestamp, timestampBuffer + startIndex2, 8);
     }
 
     if (blockSize2 > 0)
@@ -147,10 +462,134 @@ int DataBuffer::readAllFromBuffer (AudioSampleBuffer& data, uint64* timestamp, u
                            startIndex2,     // sourceStartSample
                            blockSize2);     // numSamples
         }
-        memcpy (eventCodes + blockSize1, eventCodeBuffer + startIndex2, blockSize2 * 8);
     }
 
+    *timestamp = (uint64) getReadTimestamp();
+    fillEventCodes (eventCodes, numItems);
+
     abstractFifo.finishedRead (numItems);
+    samplesRead += numItems;
+    releaseRuns (samplesRead);
 
     return numItems;
 }
+
+
+int DataBuffer::startRead (CircularBufferIndexes& indexes, int maxSize)
+{
+    // only one read can be in progress at any time
+    if (readInProgress)
+    {
+        indexes.index1 = indexes.size1 = indexes.index2 = indexes.size2 = 0;
+        return 0;
+    }
+
+    int numReady = abstractFifo.getNumReady();
+    int numItems = (maxSize < numReady) ? maxSize : numReady;
+    readLatency = numReady;
+
+    abstractFifo.prepareToRead (numItems, indexes.index1, indexes.size1, indexes.index2, indexes.size2);
+
+    readSamples = indexes.size1 + indexes.size2;
+    readInProgress = true;
+
+    return readSamples;
+}
+
+
+void DataBuffer::stopRead()
+{
+    if (! readInProgress)
+        return;
+
+    abstractFifo.finishedRead (readSamples);
+    samplesRead += readSamples;
+    releaseRuns (samplesRead);
+
+    readSamples = 0;
+    readInProgress = false;
+}
+
+
+const AudioSampleBuffer& DataBuffer::getAudioBufferReference() const { return buffer; }
+
+
+int64 DataBuffer::getReadTimestamp() const
+{
+    const int numRuns = timestampRunFifo.getNumReady();
+
+    int index1, size1, index2, size2;
+    timestampRunFifo.prepareToRead (numRuns, index1, size1, index2, size2);
+
+    if (numRuns == 0)
+        return 0;
+
+    // the runs before the last read have been released, but a run starting exactly at the
+    // first unread sample may have been written since
+    int n = 0;
+    while (n + 1 < numRuns && getRun (timestampRuns, n + 1, index1, size1, index2).startSample <= samplesRead)
+        ++n;
+
+    const TimestampRun& run = getRun (timestampRuns, n, index1, size1, index2);
+
+    return run.timestamp + (samplesRead - run.startSample);
+}
+
+
+int DataBuffer::getEventCodeChanges (EventCodeChange* changes, int maxChanges) const
+{
+    const int numRuns = eventCodeRunFifo.getNumReady();
+    const int64 readEnd = samplesRead + readSamples;
+
+    int index1, size1, index2, size2;
+    eventCodeRunFifo.prepareToRead (numRuns, index1, size1, index2, size2);
+
+    int numChanges = 0;
+
+    for (int n = 0; n < numRuns && numChanges < maxChanges; ++n)
+    {
+        const EventCodeRun& run = getRun (eventCodeRuns, n, index1, size1, index2);
+
+        if (run.startSample >= readEnd)
+            break;
+
+        if (run.startSample >= samplesRead)
+        {
+            changes[numChanges].sampleOffset = (int) (run.startSample - samplesRead);
+            changes[numChanges].eventCode = run.eventCode;
+            ++numChanges;
+        }
+    }
+
+    return numChanges;
+}
+
+
+void DataBuffer::fillEventCodes (uint64* eventCodes, int numItems) const
+{
+    const int numRuns = eventCodeRunFifo.getNumReady();
+
+    int index1, size1, index2, size2;
+    eventCodeRunFifo.prepareToRead (numRuns, index1, size1, index2, size2);
+
+    uint64 eventCode = 0;
+    int filled = 0;
+
+    for (int n = 0; n < numRuns; ++n)
+    {
+        const EventCodeRun& run = getRun (eventCodeRuns, n, index1, size1, index2);
+
+        if (run.startSample >= samplesRead + numItems)
+            break;
+
+        const int runStart = (int) jmax ((int64) 0, run.startSample - samplesRead);
+
+        for (; filled < runStart; ++filled)
+            eventCodes[filled] = eventCode;
+
+        eventCode = run.eventCode;
+    }
+
+    for (; filled < numItems; ++filled)
+        eventCodes[filled] = eventCode;
+}
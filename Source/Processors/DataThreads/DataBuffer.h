@@ -25,16 +25,53 @@
 
 #include "../../../JuceLibraryCode/JuceHeader.h"
 #include "../PluginManager/OpenEphysPlugin.h"
+#include "LargeSampleBlock.h"
+#include <atomic>
+
+
+/** The one or two segments of a circular buffer covered by a read or a write.*/
+struct CircularBufferIndexes
+{
+    int index1;
+    int size1;
+    int index2;
+    int size2;
+};
 
 
 /**
     Manages reading and writing data to a circular buffer.
 
+    Timestamps and event codes are not stored per sample. Consecutive timestamps are kept as
+    runs (first sample and its timestamp) and event codes as the samples where the word changes,
+    each in a small circular buffer of its own, so that a read only touches the changes it covers.
+
     See @DataThread
 */
 class PLUGIN_API DataBuffer
 {
 public:
+    /** A new value of the event code word, taking effect at a sample of a read.*/
+    struct EventCodeChange
+    {
+        int sampleOffset;
+        uint64 eventCode;
+    };
+
+    /** Space reserved by beginWrite(), for a producer to decode its samples straight into.
+
+        The samples of a channel go to the one or two segments in indexes, through
+        getWritePointer() and getRawWritePointer(). The timestamp and event code of the n-th
+        sample go to timestamps[n] and eventCodes[n].
+    */
+    struct WriteSpan
+    {
+        CircularBufferIndexes indexes;
+        int64* timestamps;
+        uint64* eventCodes;
+        int numSamples;
+    };
+
     DataBuffer (int chans, int size);
     ~DataBuffer();
 
@@ -43,17 +80,50 @@ public:
 
     /** Add an array of floats to the buffer.
 
-        @param data The data.
+        @param data The data. Samples are grouped in chunks of chunkSize samples per
+        channel; inside each chunk the samples of channel 0 come first, followed by those
+        of channel 1 and so on. With a chunkSize of 1 this is plain sample-interleaved data,
+        with a chunkSize of numItems it is a channel-major block. A trailing chunk shorter
+        than chunkSize is packed with its own length.
         @param timestamps Array of timestamps. Same length as numItems.
         @param eventCodes Array of event codes. Same length as numItems.
         @param numItems Total number of samples per channel.
         @param chunkSize Number of consecutive samples per channel per chunk.
         1 by default. Typically 1 or numItems.
+        @param rawData Optional. The original integer codes of the samples, with the same
+        layout as data. Only stored if raw samples have been enabled with enableRawSamples().
 
         @return The number of items actually written. May be less than numItems if
-        the buffer doesn't have space.
+        the buffer doesn't have space, either for the samples or for their timestamp
+        discontinuities and event code changes.
+    */
+    int addToBuffer (float* data, int64* timestamps, uint64* eventCodes, int numItems, int chunkSize=1, const int16* rawData = nullptr);
+
+    /** Reserves space for up to maxSize samples, to be written in place instead of being copied
+        by addToBuffer(). Nothing becomes visible to the reader until commitWrite() is called,
+        and only one write can be in progress at any time.
+
+        @return The number of samples that fit, which may be less than maxSize if the buffer
+        is nearly full.
+    */
+    int beginWrite (WriteSpan& span, int maxSize);
+
+    /** Hands the first samples of the write in progress to the reader.
+
+        @param numItems The number of samples the producer had. Those beyond the span are
+        counted as dropped, as addToBuffer() does with samples that don't fit.
+
+        @return The number of samples actually written. May be less than the span if there is
+        no room left for their timestamp discontinuities and event code changes.
     */
-    int addToBuffer (float* data, int64* timestamps, uint64* eventCodes, int numItems, int chunkSize=1);
+    int commitWrite (int numItems);
+
+    /** Returns the start of a channel's samples, to be indexed with the segments of a WriteSpan.*/
+    float* getWritePointer (int channel);
+
+    /** Returns the start of a channel's raw codes, to be indexed with the segments of a
+        WriteSpan. Null if raw samples are not enabled.*/
+    int16* getRawWritePointer (int channel);
 
     /** Returns the number of samples currently available in the buffer.*/
     int getNumSamples() const;
@@ -61,18 +131,150 @@ public:
     /** Copies as many samples as possible from the DataBuffer to an AudioSampleBuffer.*/
     int readAllFromBuffer (AudioSampleBuffer& data, uint64* ts, uint64* eventCodes, int maxSize, int dstStartChannel = 0, int numChannels = -1);
 
-    /** Resizes the data buffer */
+    /** Resizes the data buffer. The size will never go below the one set by autoResize().*/
     void resize (int chans, int size);
 
+    /** Sets the pages and NUMA node of the samples, reallocating and clearing them if the
+        placement changed. Only to be called while no thread is reading or writing.*/
+    void setPlacement (const LargeSampleBlock::Placement& placement);
+
+    /** Returns the pages the samples actually got, see LargeSampleBlock::getPageSize().*/
+    LargeSampleBlock::PageSize getPageSize() const;
+
+    /** Returns the number of samples per channel the buffer can hold.*/
+    int getBufferSize() const;
+
+    /** Returns the highest number of samples waiting in the buffer since the last resetStatistics().*/
+    int getHighWaterMark() const;
+
+    /** Returns the number of samples per channel discarded because the buffer was full,
+        since the last resetStatistics().*/
+    int64 getNumDroppedSamples() const;
+
+    /** Returns the number of samples that were waiting in the buffer at the start of the last read,
+        that is, how far the reader lags behind the writer.*/
+    int getReadLatency() const;
+
+    void resetStatistics();
+
+    /** Doubles the size of the buffer if the observed peak occupancy went over three quarters of
+        it or samples were dropped, up to maxSize. Only to be called while no thread is reading
+        or writing, typically between acquisitions.
+
+        @return true if the buffer was resized.
+    */
+    bool autoResize (int maxSize);
+
+    /** Starts reading up to maxSize samples directly from the internal buffers, without copying them.
+
+        The segments of the circular buffer holding the samples are returned in indexes, and
+        are meant to be used with getAudioBufferReference() and getRawBufferReference(), while
+        getReadTimestamp() and getEventCodeChanges() describe the same samples. The space is
+        not released to the writer until stopRead() is called.
+
+        @return The number of samples available through the indexes.
+    */
+    int startRead (CircularBufferIndexes& indexes, int maxSize);
+
+    /** Releases the samples obtained by the last startRead() call.*/
+    void stopRead();
+
+    const AudioSampleBuffer& getAudioBufferReference() const;
+
+    /** Returns the timestamp of the first sample of the read in progress.*/
+    int64 getReadTimestamp() const;
+
+    /** Fills changes with the event code changes falling inside the read in progress, with
+        their offsets relative to its first sample. A word that is already in effect before
+        the read starts is not reported.
+
+        @return The number of changes written, at most maxChanges.
+    */
+    int getEventCodeChanges (EventCodeChange* changes, int maxChanges) const;
+
+    /** Allocates (or frees) a side buffer holding the original int16 codes of the samples.
+
+        Threads whose hardware delivers integer ADC codes can pass them to addToBuffer()
+        alongside the scaled floats, so that record engines can store them untouched when
+        the signal chain doesn't modify the data. A raw code times the channel bitVolts
+        must equal the float sample.
+    */
+    void enableRawSamples (bool enable);
+
+    /** Returns true if the buffer keeps the original int16 codes of the samples.*/
+    bool hasRawSamples() const;
+
+    /** Returns the raw codes of a channel, to be indexed with the segments returned by
+        startRead(). Null if raw samples are not enabled.*/
+    const int16* getRawBufferReference (int channel) const;
+
+    /** Returns the bytes allocated for the samples, their timestamps, event codes and raw codes.*/
+    int64 getMemoryFootprint() const;
+
 
 private:
+    /** The first sample, counted since the last clear(), of a timestamp run or event code.*/
+    struct TimestampRun
+    {
+        int64 startSample;
+        int64 timestamp;
+    };
+
+    struct EventCodeRun
+    {
+        int64 startSample;
+        uint64 eventCode;
+    };
+
+    void allocateRuns (int size);
+    void releaseRuns (int64 upToSample);
+
+    /** Records the timestamp discontinuities and event code changes of the next samples.
+        @return The number of samples whose changes fitted in the rings of runs.*/
+    int appendRuns (const int64* timestamps, const uint64* eventCodes, int numItems);
+
+    /** Makes the next samples visible to the reader.*/
+    void finishWrite (int numWritten);
+
+    void fillEventCodes (uint64* eventCodes, int numItems) const;
+
     AbstractFifo abstractFifo;
+    LargeSampleBlock::Placement placement;
+    LargeSampleBlock samples;               // outlives the buffer referring to it
     AudioSampleBuffer buffer;
 
-    HeapBlock<int64> timestampBuffer;
-    HeapBlock<uint64> eventCodeBuffer;
+    AbstractFifo timestampRunFifo;
+    HeapBlock<TimestampRun> timestampRuns;
+    AbstractFifo eventCodeRunFifo;
+    HeapBlock<EventCodeRun> eventCodeRuns;
+    HeapBlock<int16> rawBuffer;
+
+    // writer side
+    int64 samplesWritten;
+    int64 nextTimestamp;
+    uint64 lastEventCode;
+
+    // write in place
+    HeapBlock<int64> writeTimestamps;
+    HeapBlock<uint64> writeEventCodes;
+    int writeCapacity;
+    int writeSamples;
+    bool writeInProgress;
+
+    // reader side
+    int64 samplesRead;
 
     int numChans;
+    int bufferSize;
+    int minimumSize;
+    bool rawEnabled;
+
+    std::atomic<int> highWaterMark;
+    std::atomic<int64> droppedSamples;
+    std::atomic<int> readLatency;
+
+    int readSamples;
+    bool readInProgress;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DataBuffer);
 };
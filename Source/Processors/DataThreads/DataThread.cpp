@@ -22,10 +22,24 @@
 
 #include "DataThread.h"
 #include "../SourceNode/SourceNode.h"
+#include "../GenericProcessor/TraceRecorder.h"
+#include "../GenericProcessor/AllocationAudit.h"
+
+#if JUCE_WINDOWS
+ #include <windows.h>
+#else
+ #include <pthread.h>
+ #include <sched.h>
+#endif
 
 
 DataThread::DataThread (SourceNode* s)
-    : Thread     ("Data Thread")
+    : Thread            ("Data Thread")
+    , schedulingPolicy  (HIGH_PRIORITY)
+    , cpuCore           (-1)
+    , schedulingHandle  (nullptr)
+    , bufferPages       (LargeSampleBlock::TRANSPARENT_HUGE_PAGES)
+    , updateDelay       (0)
 {
     sn = s;
     setPriority (10);
@@ -47,9 +61,20 @@ DataThread::~DataThread()
 
 void DataThread::run()
 {
+    applyScheduling();
+
     while (! threadShouldExit())
     {
-        if (! updateBuffer())
+        const int64 startTicks = TraceRecorder::isEnabled() ? Time::getHighResolutionTicks() : 0;
+        const bool updated = updateBuffer();
+
+        // a span that includes any wait for the hardware
+        if (startTicks != 0 && TraceRecorder::isEnabled())
+            TraceRecorder::addSpan ("Update buffer", startTicks, Time::getHighResolutionTicks());
+
+        AllocationAudit::endBlock ("Acquisition");
+
+        if (! updated)
         {
             const MessageManagerLock mmLock (Thread::getCurrentThread());
 
@@ -58,10 +83,147 @@ void DataThread::run()
             std::cout << "Notifying source node to stop acqusition." << std::endl;
             sn->acquisitionStopped();
         }
+        else if (updateDelay > 0)
+        {
+            sleepUntilNextUpdate();
+        }
+    }
+
+    revertScheduling();
+}
+
+
+void DataThread::waitBeforeNextUpdate (double seconds)
+{
+    updateDelay = jmax (updateDelay, seconds);
+}
+
+
+double DataThread::getTimeForSamples (int numSamples, float sampleRate)
+{
+    return sampleRate > 0 ? numSamples / (double) sampleRate : 0.0;
+}
+
+
+void DataThread::sleepUntilNextUpdate()
+{
+    const int64 endTicks = Time::getHighResolutionTicks() + Time::secondsToHighResolutionTicks (updateDelay);
+    updateDelay = 0;
+
+    // the OS may oversleep by up to a timer tick, so the last millisecond is spent yielding,
+    // and the wait returns as soon as stopThread() notifies the thread
+    const int waitMs = (int) (Time::highResolutionTicksToSeconds (endTicks - Time::getHighResolutionTicks()) * 1000.0) - 1;
+
+    if (waitMs > 0)
+        wait (waitMs);
+
+    while (Time::getHighResolutionTicks() < endTicks && ! threadShouldExit())
+        Thread::yield();
+}
+
+
+void DataThread::setScheduling (SchedulingPolicy policy, int core)
+{
+    schedulingPolicy = policy;
+    cpuCore = (core >= 0 && core < jmin (32, SystemStats::getNumCpus())) ? core : -1;
+}
+
+
+DataThread::SchedulingPolicy DataThread::getSchedulingPolicy() const { return schedulingPolicy; }
+
+int DataThread::getCpuCore() const { return cpuCore; }
+
+
+void DataThread::setBufferPages (LargeSampleBlock::PageSize pageSize) { bufferPages = pageSize; }
+
+LargeSampleBlock::PageSize DataThread::getBufferPages() const { return bufferPages; }
+
+
+LargeSampleBlock::Placement DataThread::getBufferPlacement() const
+{
+    return LargeSampleBlock::Placement (bufferPages, LargeSampleBlock::getNumaNodeOfCpu (cpuCore));
+}
+
+
+String DataThread::getSchedulingPolicyName (SchedulingPolicy policy)
+{
+    switch (policy)
+    {
+        case NORMAL_PRIORITY:   return "Normal";
+        case HIGH_PRIORITY:     return "High";
+        case REALTIME_PRIORITY: return "Real-time";
+        default:                return String::empty;
     }
 }
 
 
+void DataThread::applyScheduling()
+{
+    if (cpuCore >= 0)
+        Thread::setCurrentThreadAffinityMask (1u << cpuCore);
+
+    if (schedulingPolicy == NORMAL_PRIORITY)
+    {
+        Thread::setCurrentThreadPriority (5);
+        return;
+    }
+
+    Thread::setCurrentThreadPriority (10);
+
+    if (schedulingPolicy != REALTIME_PRIORITY)
+        return;
+
+#if JUCE_WINDOWS
+    // avrt.dll is loaded on demand, so the GUI doesn't need to link against it
+    typedef HANDLE (WINAPI *AvSetMmThreadCharacteristicsFunc) (LPCWSTR, LPDWORD);
+    typedef BOOL (WINAPI *AvSetMmThreadPriorityFunc) (HANDLE, int);
+
+    if (HMODULE avrt = LoadLibraryA ("avrt.dll"))
+    {
+        AvSetMmThreadCharacteristicsFunc setCharacteristics = (AvSetMmThreadCharacteristicsFunc) GetProcAddress (avrt, "AvSetMmThreadCharacteristicsW");
+        AvSetMmThreadPriorityFunc setPriority = (AvSetMmThreadPriorityFunc) GetProcAddress (avrt, "AvSetMmThreadPriority");
+        DWORD taskIndex = 0;
+
+        if (setCharacteristics != nullptr)
+            schedulingHandle = setCharacteristics (L"Pro Audio", &taskIndex);
+
+        if (schedulingHandle != nullptr && setPriority != nullptr)
+            setPriority (schedulingHandle, 2); // AVRT_PRIORITY_CRITICAL
+    }
+
+    if (schedulingHandle == nullptr)
+        std::cout << "Could not register the data thread with MMCSS, using high priority." << std::endl;
+#else
+    struct sched_param param;
+    param.sched_priority = sched_get_priority_max (SCHED_FIFO) - 1;
+
+    if (pthread_setschedparam (pthread_self(), SCHED_FIFO, &param) != 0)
+        std::cout << "Could not set SCHED_FIFO on the data thread (missing rtprio permissions?), using high priority." << std::endl;
+#endif
+}
+
+
+void DataThread::revertScheduling()
+{
+#if JUCE_WINDOWS
+    typedef BOOL (WINAPI *AvRevertMmThreadCharacteristicsFunc) (HANDLE);
+
+    if (schedulingHandle != nullptr)
+    {
+        if (HMODULE avrt = GetModuleHandleA ("avrt.dll"))
+        {
+            AvRevertMmThreadCharacteristicsFunc revert = (AvRevertMmThreadCharacteristicsFunc) GetProcAddress (avrt, "AvRevertMmThreadCharacteristics");
+
+            if (revert != nullptr)
+                revert (schedulingHandle);
+        }
+    }
+#endif
+
+    schedulingHandle = nullptr;
+}
+
+
 DataBuffer* DataThread::getBufferAddress(int subProcessor) const
 {
 
@@ -69,6 +231,29 @@ DataBuffer* DataThread::getBufferAddress(int subProcessor) const
 }
 
 
+MultiStreamDataBuffer* DataThread::getMultiStreamBufferAddress(int subProcessor) const
+{
+	return multiStreamBuffers[subProcessor];
+}
+
+
+int64 DataThread::getMemoryFootprint() const
+{
+	int64 bytes = 0;
+
+	for (int i = 0; i < sourceBuffers.size(); i++)
+		bytes += sourceBuffers[i]->getMemoryFootprint();
+
+	for (int i = 0; i < multiStreamBuffers.size(); i++)
+	{
+		if (multiStreamBuffers[i] != nullptr)
+			bytes += multiStreamBuffers[i]->getMemoryFootprint();
+	}
+
+	return bytes;
+}
+
+
 void DataThread::getChannelInfo (Array<ChannelCustomInfo>& infoArray) const
 {
     infoArray.clear();
@@ -141,6 +326,11 @@ void DataThread::createExtraEvents(Array<EventChannel*>&)
 void DataThread::resizeBuffers()
 {}
 
+bool DataThread::hasRawSamples(const DataChannel*) const
+{
+	return false;
+}
+
 String DataThread::getChannelUnits(int chanIndex) const
 {
 	return String::empty;
@@ -26,6 +26,7 @@
 #include "../../../JuceLibraryCode/JuceHeader.h"
 #include <stdio.h>
 #include "DataBuffer.h"
+#include "MultiStreamDataBuffer.h"
 #include "../GenericProcessor/GenericProcessor.h"
 
 class SourceNode;
@@ -53,26 +54,71 @@ struct PLUGIN_API ChannelCustomInfo
     The DataThread class makes it easy to create threads that interact with
     new data sources, such as an FPGA, an Arduino, or a network stream.
 
+    The thread calls updateBuffer() over and over. When there is no data yet, updateBuffer()
+    should either block in the device's own wait call, or return after calling
+    waitBeforeNextUpdate() with the time until there should be, rather than return at once and
+    have the thread spin. Sources whose SDK delivers data through callbacks of its own can
+    instead write to the DataBuffers from those callbacks, and never start the thread.
+
     @see SourceNode
 */
 
 class PLUGIN_API DataThread : public Thread
 {
 public:
+    /** How the acquisition thread is scheduled by the OS. */
+    enum SchedulingPolicy
+    {
+        NORMAL_PRIORITY = 0,
+        HIGH_PRIORITY = 1,   //!< Highest priority JUCE can set. The default.
+        REALTIME_PRIORITY = 2 //!< SCHED_FIFO on Linux and OS X, MMCSS "Pro Audio" on Windows.
+    };
+
     DataThread (SourceNode* sn);
     ~DataThread();
 
     /** Calls 'updateBuffer()' continuously while the thread is being run.*/
     void run() override;
 
+    /** Sets the scheduling policy and the CPU core the thread is pinned to (-1 lets the OS choose).
+        Takes effect the next time acquisition starts.*/
+    void setScheduling (SchedulingPolicy policy, int cpuCore = -1);
+
+    SchedulingPolicy getSchedulingPolicy() const;
+
+    /** Returns the core the thread is pinned to, or -1 if it isn't.*/
+    int getCpuCore() const;
+
+    static String getSchedulingPolicyName (SchedulingPolicy policy);
+
+    /** Sets the pages backing the thread's large buffers, which are placed on the NUMA node
+        of the core the thread is pinned to. Takes effect the next time acquisition starts.*/
+    void setBufferPages (LargeSampleBlock::PageSize pageSize);
+
+    LargeSampleBlock::PageSize getBufferPages() const;
+
+    /** Returns where the buffers the thread writes are to be allocated, see setBufferPages().*/
+    LargeSampleBlock::Placement getBufferPlacement() const;
+
     /** Returns the address of the DataBuffer that the input source will fill.*/
     DataBuffer* getBufferAddress(int subProcessor) const;
 
+    /** Returns the MultiStreamDataBuffer of a subprocessor, or nullptr if that subprocessor
+    uses a single DataBuffer.*/
+    MultiStreamDataBuffer* getMultiStreamBufferAddress(int subProcessor) const;
+
 	/** Called when the chain updates, to add, remove or resize the sourceBuffers' DataBuffers as needed*/
 	virtual void resizeBuffers();
 
+	/** Returns the bytes allocated by the buffers the thread fills. Threads holding large buffers
+	of their own, such as USB transfer buffers, add them to this.*/
+	virtual int64 getMemoryFootprint() const;
+
     /** Fills the DataBuffer with incoming data. This is the most important
-    method for each DataThread.*/
+    method for each DataThread.
+
+    @return false on an error that stops acquisition. Having no data yet is not an error,
+    see waitBeforeNextUpdate().*/
     virtual bool updateBuffer() = 0;
 
     /** Experimental method used for testing data sources that can deliver outputs.*/
@@ -108,6 +154,10 @@ public:
     /** Returns the volts per bit of the data source.*/
     virtual float getBitVolts (const DataChannel* chan) const = 0;
 
+    /** Returns true if the original integer codes of a channel are stored in its DataBuffer
+        (see DataBuffer::enableRawSamples). Each code times getBitVolts() must equal the float sample.*/
+    virtual bool hasRawSamples (const DataChannel* chan) const;
+
     /** Notifies if the device is ready for acquisition */
     virtual bool isReady();
 
@@ -142,6 +192,14 @@ public:
 protected:
     virtual void setDefaultChannelNames();
 
+    /** Called by updateBuffer() when the device has no data yet, with the estimated time until
+        it has. The thread sleeps that long before calling updateBuffer() again, waking up early
+        if it is stopped.*/
+    void waitBeforeNextUpdate (double seconds);
+
+    /** Returns the time it takes the device to deliver a number of samples.*/
+    static double getTimeForSamples (int numSamples, float sampleRate);
+
     SourceNode* sn;
 
     Array<uint64> ttlEventWords;
@@ -149,10 +207,29 @@ protected:
 
     Array<ChannelCustomInfo> channelInfo;
 	OwnedArray<DataBuffer> sourceBuffers;
+	/** Subprocessors whose channels come from independent hardware streams can use one of these
+	instead of an entry in sourceBuffers, indexed by subprocessor (nullptr entries are allowed).*/
+	OwnedArray<MultiStreamDataBuffer> multiStreamBuffers;
 
 private:
+    /** Applies the scheduling settings to the calling thread. Called at the start of run().*/
+    void applyScheduling();
+
+    /** Reverts whatever applyScheduling() registered with the OS. Called at the end of run().*/
+    void revertScheduling();
+
+    /** Sleeps for the time set by waitBeforeNextUpdate(), precisely enough for blocks of a
+        millisecond or two.*/
+    void sleepUntilNextUpdate();
+
     Time timer;
 
+    SchedulingPolicy schedulingPolicy;
+    int cpuCore;
+    void* schedulingHandle;
+    LargeSampleBlock::PageSize bufferPages;
+    double updateDelay;
+
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DataThread);
 };
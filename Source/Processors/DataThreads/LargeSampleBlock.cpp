@@ -0,0 +1,278 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "LargeSampleBlock.h"
+
+#if JUCE_WINDOWS
+ #include <windows.h>
+#elif JUCE_LINUX
+ #include <sys/mman.h>
+ #include <sys/syscall.h>
+ #include <unistd.h>
+#endif
+
+
+namespace
+{
+    const size_t hugePageBytes = 2 * 1024 * 1024;
+
+    size_t roundUp (size_t bytes, size_t granularity)
+    {
+        return (bytes + granularity - 1) / granularity * granularity;
+    }
+
+#if JUCE_LINUX
+    void* mapPages (size_t numBytes, bool hugePages)
+    {
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+        if (hugePages)
+        {
+           #ifdef MAP_HUGETLB
+            flags |= MAP_HUGETLB;
+           #else
+            return nullptr;
+           #endif
+        }
+
+        void* data = mmap (nullptr, numBytes, PROT_READ | PROT_WRITE, flags, -1, 0);
+        return data != MAP_FAILED ? data : nullptr;
+    }
+
+    bool preferNode (void* data, size_t numBytes, int node)
+    {
+       #ifdef SYS_mbind
+        const int mpolPreferred = 1;    // MPOL_PREFERRED, numaif.h coming with libnuma
+        const int bitsPerWord = 8 * sizeof (unsigned long);
+        unsigned long mask[16] = { 0 };
+
+        if (node >= 16 * bitsPerWord)
+            return false;
+
+        mask[node / bitsPerWord] |= 1ul << (node % bitsPerWord);
+
+        // the kernel reads one bit less than maxnode
+        return syscall (SYS_mbind, data, numBytes, mpolPreferred, mask, (unsigned long) (16 * bitsPerWord + 1), 0) == 0;
+       #else
+        ignoreUnused (data, numBytes, node);
+        return false;
+       #endif
+    }
+#elif JUCE_WINDOWS
+    /** Large pages need the privilege to be granted to the user, and enabled in the process */
+    bool enableLockMemoryPrivilege()
+    {
+        HANDLE token;
+        if (! OpenProcessToken (GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+            return false;
+
+        TOKEN_PRIVILEGES privileges;
+        privileges.PrivilegeCount = 1;
+        privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+
+        const bool enabled = LookupPrivilegeValue (nullptr, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid)
+                             && AdjustTokenPrivileges (token, FALSE, &privileges, 0, nullptr, nullptr)
+                             && GetLastError() == ERROR_SUCCESS;
+
+        CloseHandle (token);
+        return enabled;
+    }
+#endif
+}
+
+
+LargeSampleBlock::LargeSampleBlock()
+    : data      (nullptr)
+    , numBytes  (0)
+    , pageSize  (NORMAL_PAGES)
+    , numaNode  (-1)
+{
+}
+
+
+LargeSampleBlock::~LargeSampleBlock()
+{
+    free();
+}
+
+
+void LargeSampleBlock::allocate (AudioSampleBuffer& buffer, int numChannels, int numSamples, const Placement& placement)
+{
+    // the buffer stops referring to the previous block before it is freed
+    buffer.setSize (0, 0);
+    free();
+
+    const size_t bytes = (size_t) numChannels * (size_t) numSamples * sizeof (float);
+
+    const bool wanted = bytes > 0
+                        && (placement.numaNode >= 0 || (placement.pageSize != NORMAL_PAGES && bytes >= hugePageBytes));
+
+#if JUCE_LINUX
+    if (wanted)
+    {
+        if (placement.pageSize == EXPLICIT_HUGE_PAGES)
+        {
+            numBytes = roundUp (bytes, hugePageBytes);
+            data = mapPages (numBytes, true);
+            pageSize = EXPLICIT_HUGE_PAGES;
+
+            if (data == nullptr)
+                std::cout << "Not enough huge pages reserved for a buffer of " << File::descriptionOfSizeInBytes ((int64) numBytes)
+                          << ", using transparent huge pages." << std::endl;
+        }
+
+        if (data == nullptr)
+        {
+            pageSize = placement.pageSize == NORMAL_PAGES ? NORMAL_PAGES : TRANSPARENT_HUGE_PAGES;
+            numBytes = pageSize != NORMAL_PAGES ? roundUp (bytes, hugePageBytes) : bytes;
+            data = mapPages (numBytes, false);
+
+           #ifdef MADV_HUGEPAGE
+            if (data != nullptr && pageSize == TRANSPARENT_HUGE_PAGES)
+                madvise (data, numBytes, MADV_HUGEPAGE);
+           #endif
+        }
+
+        // before anything is written, for the pages to be placed as they are first touched
+        if (data != nullptr && placement.numaNode >= 0 && preferNode (data, numBytes, placement.numaNode))
+            numaNode = placement.numaNode;
+    }
+#elif JUCE_WINDOWS
+    if (wanted)
+    {
+        const DWORD node = placement.numaNode >= 0 ? (DWORD) placement.numaNode : NUMA_NO_PREFERRED_NODE;
+        const SIZE_T largePageBytes = GetLargePageMinimum();
+
+        if (placement.pageSize == EXPLICIT_HUGE_PAGES && largePageBytes > 0)
+        {
+            static const bool canLockMemory = enableLockMemoryPrivilege();
+
+            if (canLockMemory)
+            {
+                numBytes = roundUp (bytes, largePageBytes);
+                data = VirtualAllocExNuma (GetCurrentProcess(), nullptr, numBytes,
+                                           MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE, node);
+                pageSize = EXPLICIT_HUGE_PAGES;
+            }
+
+            if (data == nullptr)
+                std::cout << "Could not allocate large pages (is the Lock pages in memory privilege granted?), using normal pages." << std::endl;
+        }
+
+        // Windows has no transparent huge pages
+        if (data == nullptr)
+        {
+            numBytes = bytes;
+            data = VirtualAllocExNuma (GetCurrentProcess(), nullptr, numBytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE, node);
+            pageSize = NORMAL_PAGES;
+        }
+
+        if (data != nullptr)
+            numaNode = placement.numaNode;
+    }
+#else
+    ignoreUnused (wanted, placement);
+#endif
+
+    if (data == nullptr)
+    {
+        numBytes = 0;
+        pageSize = NORMAL_PAGES;
+
+        buffer.setSize (numChannels, numSamples);
+        buffer.clear();
+        return;
+    }
+
+    // the pages come cleared, and stay untouched until the buffer is written
+    channels.malloc ((size_t) numChannels);
+
+    for (int ch = 0; ch < numChannels; ++ch)
+        channels[ch] = static_cast<float*> (data) + (size_t) ch * (size_t) numSamples;
+
+    buffer.setDataToReferTo (channels, numChannels, numSamples);
+}
+
+
+void LargeSampleBlock::free()
+{
+    if (data != nullptr)
+    {
+       #if JUCE_LINUX
+        munmap (data, numBytes);
+       #elif JUCE_WINDOWS
+        VirtualFree (data, 0, MEM_RELEASE);
+       #endif
+    }
+
+    data = nullptr;
+    numBytes = 0;
+    pageSize = NORMAL_PAGES;
+    numaNode = -1;
+    channels.free();
+}
+
+
+LargeSampleBlock::PageSize LargeSampleBlock::getPageSize() const { return pageSize; }
+
+int LargeSampleBlock::getNumaNode() const { return numaNode; }
+
+
+String LargeSampleBlock::getPageSizeName (PageSize size)
+{
+    switch (size)
+    {
+        case NORMAL_PAGES:              return "Normal";
+        case TRANSPARENT_HUGE_PAGES:    return "Transparent huge pages";
+        case EXPLICIT_HUGE_PAGES:       return "Reserved huge pages";
+        default:                        return String::empty;
+    }
+}
+
+
+int LargeSampleBlock::getNumaNodeOfCpu (int cpu)
+{
+    if (cpu < 0)
+        return -1;
+
+#if JUCE_LINUX
+    if (File ("/sys/devices/system/node").getNumberOfChildFiles (File::findDirectories, "node*") < 2)
+        return -1;
+
+    // each core's directory links to that of its node
+    Array<File> nodes;
+    File ("/sys/devices/system/cpu/cpu" + String (cpu)).findChildFiles (nodes, File::findDirectories, false, "node*");
+
+    return nodes.size() == 1 ? nodes[0].getFileName().substring (4).getIntValue() : -1;
+#elif JUCE_WINDOWS
+    ULONG highestNode = 0;
+    UCHAR node = 0;
+
+    if (cpu > 255 || ! GetNumaHighestNodeNumber (&highestNode) || highestNode == 0
+        || ! GetNumaProcessorNode ((UCHAR) cpu, &node) || node == 0xff)
+        return -1;
+
+    return (int) node;
+#else
+    return -1;
+#endif
+}
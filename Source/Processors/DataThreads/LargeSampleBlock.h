@@ -0,0 +1,103 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __LARGESAMPLEBLOCK_H_4E9A1C27__
+#define __LARGESAMPLEBLOCK_H_4E9A1C27__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "../PluginManager/OpenEphysPlugin.h"
+
+
+/**
+    The memory of a large AudioSampleBuffer, allocated straight from the system so that it
+    can be backed by huge pages and placed on a NUMA node.
+
+    The buffer is pointed at the block with setDataToReferTo(), so its readers and writers
+    see an ordinary AudioSampleBuffer. Buffers smaller than a huge page, asking for neither
+    huge pages nor a node, keep using the AudioSampleBuffer's own memory.
+
+    Transparent huge pages are only a hint to the kernel (Linux). Explicit ones come from the
+    pool reserved in /proc/sys/vm/nr_hugepages on Linux, or need the "Lock pages in memory"
+    privilege on Windows, and fall back to transparent ones when there are not enough. The
+    pages are placed on the preferred node as they are first written.
+
+    See @DataBuffer, @DataQueue
+*/
+class PLUGIN_API LargeSampleBlock
+{
+public:
+    enum PageSize
+    {
+        NORMAL_PAGES = 0,
+        TRANSPARENT_HUGE_PAGES,
+        EXPLICIT_HUGE_PAGES,
+        NUM_PAGE_SIZES
+    };
+
+    /** Where a block is to be allocated.*/
+    struct Placement
+    {
+        Placement (PageSize pages = TRANSPARENT_HUGE_PAGES, int node = -1)
+            : pageSize (pages), numaNode (node) {}
+
+        bool operator== (const Placement& other) const noexcept { return pageSize == other.pageSize && numaNode == other.numaNode; }
+        bool operator!= (const Placement& other) const noexcept { return ! operator== (other); }
+
+        PageSize pageSize;
+        int numaNode;       // -1 for the node of the thread first writing the samples
+    };
+
+    LargeSampleBlock();
+    ~LargeSampleBlock();
+
+    /** Frees the previous block, and points the buffer at numChannels channels of numSamples
+        cleared samples.*/
+    void allocate (AudioSampleBuffer& buffer, int numChannels, int numSamples, const Placement& placement);
+
+    /** Frees the block. The buffer referring to it must be resized or deleted first.*/
+    void free();
+
+    /** Returns the pages the block actually got, NORMAL_PAGES when it uses the buffer's memory.*/
+    PageSize getPageSize() const;
+
+    /** Returns the node the block is placed on, -1 if left to the system.*/
+    int getNumaNode() const;
+
+    static String getPageSizeName (PageSize pageSize);
+
+    /** Returns the NUMA node of a CPU core, or -1 if it can't be told or the machine has a single node.*/
+    static int getNumaNodeOfCpu (int cpu);
+
+
+private:
+    void* data;
+    size_t numBytes;
+    PageSize pageSize;
+    int numaNode;
+
+    HeapBlock<float*> channels;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LargeSampleBlock);
+};
+
+
+#endif  // __LARGESAMPLEBLOCK_H_4E9A1C27__
@@ -0,0 +1,139 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "MultiStreamDataBuffer.h"
+
+
+MultiStreamDataBuffer::MultiStreamDataBuffer()
+    : eventCodeSize (0)
+{
+}
+
+
+MultiStreamDataBuffer::~MultiStreamDataBuffer() {}
+
+
+int MultiStreamDataBuffer::addStream (int numChannels, int size)
+{
+    streams.add (new DataBuffer (numChannels, size));
+    streamChannels.add (numChannels);
+
+    if (size > eventCodeSize)
+    {
+        streamEventCodes.malloc (size);
+        eventCodeSize = size;
+    }
+
+    return streams.size() - 1;
+}
+
+
+void MultiStreamDataBuffer::removeAllStreams()
+{
+    streams.clear();
+    streamChannels.clear();
+}
+
+
+int MultiStreamDataBuffer::getNumStreams() const { return streams.size(); }
+
+
+DataBuffer* MultiStreamDataBuffer::getStreamBuffer (int stream) const { return streams[stream]; }
+
+
+int64 MultiStreamDataBuffer::getMemoryFootprint() const
+{
+    int64 bytes = eventCodeSize * (int64) sizeof (uint64);
+
+    for (int i = 0; i < streams.size(); ++i)
+        bytes += streams[i]->getMemoryFootprint();
+
+    return bytes;
+}
+
+
+int MultiStreamDataBuffer::getNumChannels() const
+{
+    int total = 0;
+
+    for (int i = 0; i < streamChannels.size(); ++i)
+        total += streamChannels[i];
+
+    return total;
+}
+
+
+void MultiStreamDataBuffer::clear()
+{
+    for (int i = 0; i < streams.size(); ++i)
+        streams[i]->clear();
+}
+
+
+int MultiStreamDataBuffer::getNumSamples() const
+{
+    if (streams.size() == 0)
+        return 0;
+
+    int numReady = streams[0]->getNumSamples();
+
+    for (int i = 1; i < streams.size(); ++i)
+        numReady = jmin (numReady, streams[i]->getNumSamples());
+
+    return numReady;
+}
+
+
+int MultiStreamDataBuffer::readAllFromBuffer (AudioSampleBuffer& data, uint64* timestamp, uint64* eventCodes, int maxSize, int dstStartChannel, int numChannels)
+{
+    // only read what every stream has, so the merged block stays aligned in time
+    const int numItems = jmin (maxSize, getNumSamples(), eventCodeSize);
+
+    if (numItems <= 0)
+        return 0;
+
+    int channelsLeft = numChannels < 0 ? data.getNumChannels() - dstStartChannel : numChannels;
+    int dstChannel = dstStartChannel;
+
+    for (int i = 0; i < streams.size(); ++i)
+    {
+        const int channelsToCopy = jmin (streamChannels[i], channelsLeft);
+
+        if (i == 0)
+        {
+            streams[i]->readAllFromBuffer (data, timestamp, eventCodes, numItems, dstChannel, channelsToCopy);
+        }
+        else
+        {
+            uint64 streamTimestamp;
+            streams[i]->readAllFromBuffer (data, &streamTimestamp, streamEventCodes, numItems, dstChannel, channelsToCopy);
+
+            for (int n = 0; n < numItems; ++n)
+                eventCodes[n] |= streamEventCodes[n];
+        }
+
+        dstChannel   += channelsToCopy;
+        channelsLeft -= channelsToCopy;
+    }
+
+    return numItems;
+}
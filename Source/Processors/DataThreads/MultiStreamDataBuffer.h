@@ -0,0 +1,97 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __MULTISTREAMDATABUFFER_H_5B0E2D74__
+#define __MULTISTREAMDATABUFFER_H_5B0E2D74__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "../PluginManager/OpenEphysPlugin.h"
+#include "DataBuffer.h"
+
+
+/**
+    A set of independent circular buffers that together hold the channels of one subprocessor.
+
+    Each stream owns a contiguous range of the subprocessor's channels and has its own
+    single-producer/single-consumer DataBuffer, so separate hardware ports can be filled
+    from separate threads without sharing a FIFO or serializing through a common sample
+    array. The streams are merged on the consumer side: reading returns only the samples
+    that every stream has already delivered.
+
+    Timestamps are taken from the first stream. The TTL words of all streams are OR-ed
+    together, so each stream should only set its own event bits.
+
+    See @DataThread, @DataBuffer
+*/
+class PLUGIN_API MultiStreamDataBuffer
+{
+public:
+    MultiStreamDataBuffer();
+    ~MultiStreamDataBuffer();
+
+    /** Adds a stream holding the next numChannels channels of the subprocessor.
+
+        @return The index of the new stream.
+    */
+    int addStream (int numChannels, int size);
+
+    /** Removes all streams.*/
+    void removeAllStreams();
+
+    /** Returns the number of streams.*/
+    int getNumStreams() const;
+
+    /** Returns the buffer a given stream's producer writes to.*/
+    DataBuffer* getStreamBuffer (int stream) const;
+
+    /** Returns the total number of channels across all streams.*/
+    int getNumChannels() const;
+
+    /** Returns the bytes allocated by every stream, see DataBuffer::getMemoryFootprint().*/
+    int64 getMemoryFootprint() const;
+
+    /** Clears every stream.*/
+    void clear();
+
+    /** Returns the number of samples that all streams have available.*/
+    int getNumSamples() const;
+
+    /** Copies as many samples as every stream can provide to an AudioSampleBuffer.
+
+        Works like DataBuffer::readAllFromBuffer, with the channels of each stream placed
+        one after the other starting at dstStartChannel.
+    */
+    int readAllFromBuffer (AudioSampleBuffer& data, uint64* ts, uint64* eventCodes, int maxSize, int dstStartChannel = 0, int numChannels = -1);
+
+
+private:
+    OwnedArray<DataBuffer> streams;
+    Array<int> streamChannels;
+
+    HeapBlock<uint64> streamEventCodes;
+    int eventCodeSize;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MultiStreamDataBuffer);
+};
+
+
+#endif  // __MULTISTREAMDATABUFFER_H_5B0E2D74__
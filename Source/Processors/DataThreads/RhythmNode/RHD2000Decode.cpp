@@ -0,0 +1,166 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "RHD2000Decode.h"
+
+#if JUCE_INTEL && (defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2))
+ #define RHD_DECODE_SSE2 1
+ #include <emmintrin.h>
+#endif
+
+#if JUCE_INTEL && (JUCE_MSVC || defined (__GNUC__))
+ #define RHD_DECODE_AVX2 1
+ #include <immintrin.h>
+ #if defined (__GNUC__)
+  #define RHD_DECODE_AVX2_TARGET __attribute__ ((target ("avx2")))
+ #else
+  #define RHD_DECODE_AVX2_TARGET
+ #endif
+#endif
+
+#if JUCE_ARM && (defined (__ARM_NEON__) || defined (__ARM_NEON))
+ #define RHD_DECODE_NEON 1
+ #include <arm_neon.h>
+#endif
+
+namespace RHD2000Decode
+{
+    typedef void (*ConvertFunction) (const uint16*, float*, int, int, float, float);
+
+    void convertWordsScalar (const uint16* source, float* dest, int numWords, int offset, float scale, float bias)
+    {
+        for (int i = 0; i < numWords; ++i)
+            dest[i] = float (int (source[i]) - offset) * scale + bias;
+    }
+
+   #if RHD_DECODE_SSE2
+    static void convertWordsSSE2 (const uint16* source, float* dest, int numWords, int offset, float scale, float bias)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i off = _mm_set1_epi32 (offset);
+        const __m128 mul = _mm_set1_ps (scale);
+        const __m128 add = _mm_set1_ps (bias);
+
+        int i = 0;
+        for (; i + 8 <= numWords; i += 8)
+        {
+            const __m128i words = _mm_loadu_si128 ((const __m128i*) (source + i));
+            const __m128i lo = _mm_sub_epi32 (_mm_unpacklo_epi16 (words, zero), off);
+            const __m128i hi = _mm_sub_epi32 (_mm_unpackhi_epi16 (words, zero), off);
+
+            _mm_storeu_ps (dest + i,     _mm_add_ps (_mm_mul_ps (_mm_cvtepi32_ps (lo), mul), add));
+            _mm_storeu_ps (dest + i + 4, _mm_add_ps (_mm_mul_ps (_mm_cvtepi32_ps (hi), mul), add));
+        }
+
+        convertWordsScalar (source + i, dest + i, numWords - i, offset, scale, bias);
+    }
+   #endif
+
+   #if RHD_DECODE_AVX2
+    RHD_DECODE_AVX2_TARGET
+    static void convertWordsAVX2 (const uint16* source, float* dest, int numWords, int offset, float scale, float bias)
+    {
+        const __m256i off = _mm256_set1_epi32 (offset);
+        const __m256 mul = _mm256_set1_ps (scale);
+        const __m256 add = _mm256_set1_ps (bias);
+
+        int i = 0;
+        for (; i + 8 <= numWords; i += 8)
+        {
+            const __m256i words = _mm256_cvtepu16_epi32 (_mm_loadu_si128 ((const __m128i*) (source + i)));
+            const __m256 values = _mm256_cvtepi32_ps (_mm256_sub_epi32 (words, off));
+
+            _mm256_storeu_ps (dest + i, _mm256_add_ps (_mm256_mul_ps (values, mul), add));
+        }
+
+        convertWordsScalar (source + i, dest + i, numWords - i, offset, scale, bias);
+    }
+   #endif
+
+   #if RHD_DECODE_NEON
+    static void convertWordsNEON (const uint16* source, float* dest, int numWords, int offset, float scale, float bias)
+    {
+        const int32x4_t off = vdupq_n_s32 (offset);
+        const float32x4_t mul = vdupq_n_f32 (scale);
+        const float32x4_t add = vdupq_n_f32 (bias);
+
+        int i = 0;
+        for (; i + 8 <= numWords; i += 8)
+        {
+            const uint16x8_t words = vld1q_u16 (source + i);
+            const int32x4_t lo = vsubq_s32 (vreinterpretq_s32_u32 (vmovl_u16 (vget_low_u16 (words))), off);
+            const int32x4_t hi = vsubq_s32 (vreinterpretq_s32_u32 (vmovl_u16 (vget_high_u16 (words))), off);
+
+            vst1q_f32 (dest + i,     vaddq_f32 (vmulq_f32 (vcvtq_f32_s32 (lo), mul), add));
+            vst1q_f32 (dest + i + 4, vaddq_f32 (vmulq_f32 (vcvtq_f32_s32 (hi), mul), add));
+        }
+
+        convertWordsScalar (source + i, dest + i, numWords - i, offset, scale, bias);
+    }
+   #endif
+
+    struct Kernel
+    {
+        Kernel()
+            : function  (convertWordsScalar)
+            , name      ("scalar")
+        {
+           #if RHD_DECODE_NEON
+            function = convertWordsNEON;
+            name = "NEON";
+           #endif
+
+           #if RHD_DECODE_SSE2
+            function = convertWordsSSE2;
+            name = "SSE2";
+           #endif
+
+           #if RHD_DECODE_AVX2
+            if (SystemStats::hasAVX2())
+            {
+                function = convertWordsAVX2;
+                name = "AVX2";
+            }
+           #endif
+        }
+
+        ConvertFunction function;
+        String name;
+    };
+
+    static const Kernel& getKernel()
+    {
+        static const Kernel kernel;
+        return kernel;
+    }
+
+    void convertWords (const uint16* source, float* dest, int numWords, int offset, float scale, float bias)
+    {
+        getKernel().function (source, dest, numWords, offset, scale, bias);
+    }
+
+    String getKernelName()
+    {
+        return getKernel().name;
+    }
+}
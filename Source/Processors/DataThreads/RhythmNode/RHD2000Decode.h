@@ -0,0 +1,57 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __RHD2000DECODE_H_7E3A91C2__
+#define __RHD2000DECODE_H_7E3A91C2__
+
+#include "../../../../JuceLibraryCode/JuceHeader.h"
+
+/**
+    Conversion kernels used to decode raw Rhythm USB frames.
+
+    Every section of a frame (amplifier, aux and ADC) is a run of unsigned 16-bit
+    words that is turned into floats with the same affine transform, so a single
+    vectorized routine serves all of them. The fastest implementation available on
+    the running CPU (AVX2, SSE2 or NEON) is picked the first time it is needed,
+    falling back to a plain scalar loop.
+
+    @see RHD2000Thread
+*/
+namespace RHD2000Decode
+{
+    /** Converts raw words to floats as dest[i] = float (source[i] - offset) * scale + bias.
+
+        The subtraction is done on integers, so the results match the scalar
+        conversion that was used before the kernels were added.
+    */
+    void convertWords (const uint16* source, float* dest, int numWords, int offset, float scale, float bias = 0.0f);
+
+    /** The plain scalar version of convertWords(), which all other kernels must match. */
+    void convertWordsScalar (const uint16* source, float* dest, int numWords, int offset, float scale, float bias = 0.0f);
+
+    /** Returns the name of the kernel used by convertWords() on this machine. */
+    String getKernelName();
+}
+
+
+#endif  // __RHD2000DECODE_H_7E3A91C2__
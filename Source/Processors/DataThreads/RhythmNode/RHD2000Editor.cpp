@@ -936,6 +936,7 @@ void RHD2000Editor::saveCustomParameters(XmlElement* xml)
     xml->setAttribute("auto_measure_impedances",measureWhenRecording);
 	xml->setAttribute("LEDs", ledButton->getToggleState());
 	xml->setAttribute("ClockDivideRatio", clockInterface->getClockDivideRatio());
+	xml->setAttribute("USBBlocksPerTransfer", board->getBlocksPerTransfer());
 }
 
 void RHD2000Editor::loadCustomParameters(XmlElement* xml)
@@ -959,6 +960,7 @@ void RHD2000Editor::loadCustomParameters(XmlElement* xml)
     measureWhenRecording = xml->getBoolAttribute("auto_measure_impedances");
 	ledButton->setToggleState(xml->getBoolAttribute("LEDs", true),sendNotification);
     clockInterface->setClockDivideRatio(xml->getIntAttribute("ClockDivideRatio")); 
+	board->setBlocksPerTransfer(xml->getIntAttribute("USBBlocksPerTransfer", 1));
 }
 
 
@@ -23,6 +23,7 @@
 
 #include "RHD2000Thread.h"
 #include "RHD2000Editor.h"
+#include "RHD2000Decode.h"
 #include "../../SourceNode/SourceNode.h"
 
 #if defined(_WIN32)
@@ -49,24 +50,6 @@
 
 #define INIT_STEP ( evalBoard->isUSB3() ? 256 : 60)
 
-// Allocates memory for a 3-D array of doubles.
-void allocateDoubleArray3D(std::vector<std::vector<std::vector<double> > >& array3D,
-                           int xSize, int ySize, int zSize)
-{
-    int i, j;
-
-    if (xSize == 0) return;
-    array3D.resize(xSize);
-    for (i = 0; i < xSize; ++i)
-    {
-        array3D[i].resize(ySize);
-        for (j = 0; j < ySize; ++j)
-        {
-            array3D[i][j].resize(zSize);
-        }
-    }
-}
-
 DataThread* RHD2000Thread::createDataThread(SourceNode *sn)
 {
 	return new RHD2000Thread(sn);
@@ -76,6 +59,7 @@ RHD2000Thread::RHD2000Thread(SourceNode* sn) : DataThread(sn),
     chipRegisters(30000.0f),
     numChannels(0),
     deviceFound(false),
+    blocksPerTransfer(1),
     isTransmitting(false),
     dacOutputShouldChange(false),
     acquireAdcChannels(false),
@@ -97,12 +81,15 @@ RHD2000Thread::RHD2000Thread(SourceNode* sn) : DataThread(sn),
 	impedanceThread = new RHDImpedanceMeasure(this);
 	memset(auxBuffer, 0, sizeof(auxBuffer));
 	memset(auxSamples, 0, sizeof(auxSamples));
+	blockSamples.calloc(MAX_NUM_CHANNELS * MAX_SAMPLES_PER_DATA_BLOCK);
+	blockRawSamples.calloc(MAX_NUM_CHANNELS * MAX_SAMPLES_PER_DATA_BLOCK);
 
     for (int i=0; i < MAX_NUM_HEADSTAGES; i++)
         headstagesArray.add(new RHDHeadstage(static_cast<Rhd2000EvalBoard::BoardDataSource>(i)));
 
     evalBoard = new Rhd2000EvalBoard;
     sourceBuffers.add(new DataBuffer(2, 10000)); // start with 2 channels and automatically resize
+    sourceBuffers[0]->enableRawSamples(true);
 
     // Open Opal Kelly XEM6010 board.
     // Returns 1 if successful, -1 if FrontPanel cannot be loaded, and -2 if XEM6010 can't be found.
@@ -965,6 +952,12 @@ float RHD2000Thread::getBitVolts (const DataChannel* ch) const
         return 0.195f;
 }
 
+bool RHD2000Thread::hasRawSamples (const DataChannel* ch) const
+{
+    // aux and ADC samples are rescaled or offset, so only the amplifier codes map directly to bitVolts
+    return ch->getChannelType() == DataChannel::HEADSTAGE_CHANNEL;
+}
+
 float RHD2000Thread::getAdcBitVolts (int chan) const
 {
     if (chan < adcBitVolts.size())
@@ -1435,6 +1428,14 @@ bool RHD2000Thread::startAcquisition()
     blockSize = dataBlock->calculateDataBlockSizeInWords(evalBoard->getNumEnabledDataStreams(), evalBoard->isUSB3());
 	std::cout << "Expecting blocksize of " << blockSize << " for " << evalBoard->getNumEnabledDataStreams() << " streams" << std::endl;
 	//evalBoard->printFIFOmetrics();
+
+	if (blocksPerTransfer > 1)
+	{
+		std::cout << "Reading " << blocksPerTransfer << " blocks per USB transfer." << std::endl;
+		blockReader = new RHDBlockReader(this, blocksPerTransfer, 2 * blockSize);
+		blockReader->startThread();
+	}
+
     startThread();
 
 
@@ -1464,6 +1465,13 @@ bool RHD2000Thread::stopAcquisition()
         std::cout << "Thread failed to exit, continuing anyway..." << std::endl;
     }
 
+    if (blockReader != nullptr)
+    {
+        // the decoder is gone, so the reader stops as soon as its current transfer is done
+        blockReader->stopThread(1000);
+        blockReader = nullptr;
+    }
+
     if (deviceFound)
     {
         evalBoard->setContinuousRunMode(false);
@@ -1494,111 +1502,206 @@ bool RHD2000Thread::stopAcquisition()
     return true;
 }
 
-bool RHD2000Thread::updateBuffer()
+void RHD2000Thread::setBlocksPerTransfer(int numBlocks)
 {
-	//int chOffset;
-	unsigned char* bufferPtr;
-    //cout << "Number of 16-bit words in FIFO: " << evalBoard->numWordsInFifo() << endl;
-    //cout << "Block size: " << blockSize << endl;
-   
-	//std::cout << "Current number of words: " <<  evalBoard->numWordsInFifo() << " for " << blockSize << std::endl;
-    if (evalBoard->isUSB3() || evalBoard->numWordsInFifo() >= blockSize)
-    {
-		bool return_code;
+	if (isTransmitting)
+		return;
 
-		return_code = evalBoard->readRawDataBlock(&bufferPtr);
+	blocksPerTransfer = jlimit(1, 32, numBlocks);
+}
 
-		int index = 0;
-		int auxIndex, chanIndex;
-		int numStreams = enabledStreams.size();
-		int nSamps = Rhd2000DataBlock::getSamplesPerDataBlock(evalBoard->isUSB3());
-		
-		//evalBoard->printFIFOmetrics();
-        for (int samp = 0; samp < nSamps; samp++)
-        {
-            int channel = -1;
+int RHD2000Thread::getBlocksPerTransfer() const
+{
+	return blocksPerTransfer;
+}
 
-			if (!Rhd2000DataBlock::checkUsbHeader(bufferPtr, index))
-			{
-				cerr << "Error in Rhd2000EvalBoard::readDataBlock: Incorrect header." << endl;
-				break;
-			}
+bool RHD2000Thread::readDataBlocks(int numBlocks, unsigned char* buffer)
+{
+	const ScopedLock boardLock(boardAccessLock);
+
+	// USB2 reads don't wait for the data, so only read once the whole batch is in the FIFO
+	if (!evalBoard->isUSB3() && evalBoard->numWordsInFifo() < numBlocks * blockSize)
+		return false;
+
+	return evalBoard->readRawDataBlocks(numBlocks, buffer);
+}
+
+void RHD2000Thread::decodeDataBlock(unsigned char* bufferPtr)
+{
+	int index = 0;
+	int auxIndex;
+	int numStreams = enabledStreams.size();
+	int nSamps = Rhd2000DataBlock::getSamplesPerDataBlock(evalBoard->isUSB3());
+	int samp;
+
+	// map each amplifier channel to its word inside the [channel][stream] amplifier section of a frame
+	int numAmpChannels = 0;
+	for (int dataStream = 0; dataStream < numStreams; dataStream++)
+	{
+		int nChans = numChannelsPerDataStream[dataStream];
+		int firstChan = 0;
+		if ((chipId[dataStream] == CHIP_ID_RHD2132) && (nChans == 16)) //RHD2132 16ch. headstage
+		{
+			firstChan = RHD2132_16CH_OFFSET;
+		}
+		for (int chan = 0; chan < nChans; chan++)
+		{
+			ampWordIndex[numAmpChannels++] = (firstChan + chan)*numStreams + dataStream;
+		}
+	}
+
+	// decode straight into the DataBuffer when the whole block fits, or else into the block
+	// buffers, for addToBuffer() to store what fits and count the rest as dropped
+	int numBlockChannels = getNumChannels();
+	DataBuffer::WriteSpan span;
+	const bool inPlace = sourceBuffers[0]->beginWrite(span, nSamps) == nSamps;
+	if (!inPlace)
+		sourceBuffers[0]->commitWrite(0);
+
+	for (int chan = 0; chan < numBlockChannels; chan++)
+	{
+		sampleDest[chan] = inPlace ? sourceBuffers[0]->getWritePointer(chan) : blockSamples + chan*nSamps;
+		rawDest[chan] = inPlace ? sourceBuffers[0]->getRawWritePointer(chan) : blockRawSamples + chan*nSamps;
+	}
+	const bool storeRaw = numBlockChannels > 0 && rawDest[0] != nullptr;
+	int64* timestamps = inPlace ? span.timestamps : blockTimestamps;
+	uint64* eventCodes = inPlace ? span.eventCodes : blockEventCodes;
+
+	//evalBoard->printFIFOmetrics();
+    for (samp = 0; samp < nSamps; samp++)
+    {
+        int channel = -1;
+		// where the sample goes in each channel, which wraps around the end of the circular buffer
+		const int pos = !inPlace ? samp
+			: (samp < span.indexes.size1 ? span.indexes.index1 + samp : span.indexes.index2 + samp - span.indexes.size1);
+
+		if (!Rhd2000DataBlock::checkUsbHeader(bufferPtr, index))
+		{
+			cerr << "Error in Rhd2000EvalBoard::readDataBlock: Incorrect header." << endl;
+			break;
+		}
 
-			index += 8;
-			timestamps.set(0,Rhd2000DataBlock::convertUsbTimeStamp(bufferPtr,index));
-			index += 4;
-			auxIndex = index;
-			//skip the aux channels
-			index += numStreams * 6;
-			// do the neural data channels first
-			for (int dataStream = 0; dataStream < numStreams; dataStream++)
+		index += 8;
+		timestamps[samp] = Rhd2000DataBlock::convertUsbTimeStamp(bufferPtr,index);
+		index += 4;
+		auxIndex = index;
+		//skip the aux channels
+		index += numStreams * 6;
+		// do the neural data channels first
+		RHD2000Decode::convertWords((uint16*)(bufferPtr + index), frameSamples, 32 * numStreams, 32768, 0.195f);
+		const uint16* ampWords = (uint16*)(bufferPtr + index);
+		for (int chan = 0; chan < numAmpChannels; chan++)
+		{
+			channel++;
+			sampleDest[channel][pos] = frameSamples[ampWordIndex[chan]];
+			if (storeRaw)
+				rawDest[channel][pos] = (int16)(ampWords[ampWordIndex[chan]] - 32768);
+		}
+		index += 64 * numStreams;
+		//now we can do the aux channels
+		auxIndex += 2*numStreams;
+		int auxNum = (samp+3) % 4;
+		if (auxNum < 3)
+		{
+			RHD2000Decode::convertWords((uint16*)(bufferPtr + auxIndex), frameSamples, numStreams, 32768, 0.0000374f);
+		}
+		for (int dataStream = 0; dataStream < numStreams; dataStream++)
+		{
+			if (chipId[dataStream] != CHIP_ID_RHD2164_B)
 			{
-				int nChans = numChannelsPerDataStream[dataStream];
-				chanIndex = index + 2*dataStream;
-				if ((chipId[dataStream] == CHIP_ID_RHD2132) && (nChans == 16)) //RHD2132 16ch. headstage
+				if (auxNum < 3)
 				{
-					chanIndex += 2 * RHD2132_16CH_OFFSET*numStreams;
+					auxSamples[dataStream][auxNum] = frameSamples[dataStream];
 				}
-				for (int chan = 0; chan < nChans; chan++)
+				for (int chan = 0; chan < 3; chan++)
 				{
 					channel++;
-					thisSample[channel] = float(*(uint16*)(bufferPtr + chanIndex) - 32768)*0.195f;
-					chanIndex += 2*numStreams;
-				}
-			}
-			index += 64 * numStreams;
-			//now we can do the aux channels
-			auxIndex += 2*numStreams;
-			for (int dataStream = 0; dataStream < numStreams; dataStream++)
-			{
-				if (chipId[dataStream] != CHIP_ID_RHD2164_B)
-				{
-					int auxNum = (samp+3) % 4;
-					if (auxNum < 3)
-					{
-						auxSamples[dataStream][auxNum] = float(*(uint16*)(bufferPtr + auxIndex) - 32768)*0.0000374;
-					}
-					for (int chan = 0; chan < 3; chan++)
+					if (auxNum == 3)
 					{
-						channel++;
-						if (auxNum == 3)
-						{
-							auxBuffer[channel] = auxSamples[dataStream][chan];
-						}
-						thisSample[channel] = auxBuffer[channel];
+						auxBuffer[channel] = auxSamples[dataStream][chan];
 					}
+					sampleDest[channel][pos] = auxBuffer[channel];
 				}
-				auxIndex += 2;
-
 			}
-			index += 2 * numStreams;
-			if (acquireAdcChannels)
+		}
+		index += 2 * numStreams;
+		if (acquireAdcChannels)
+		{
+			// ADC waveform units = volts, accounting for +/-5V input range and DC offset
+			RHD2000Decode::convertWords((uint16*)(bufferPtr + index), frameSamples, 8, 0, 0.00015258789f, -5.4096f);
+			for (int adcChan = 0; adcChan < 8; ++adcChan)
 			{
-				for (int adcChan = 0; adcChan < 8; ++adcChan)
-				{
-
-					channel++;
-					// ADC waveform units = volts
-					thisSample[channel] =
-						//0.000050354 * float(dataBlock->boardAdcData[adcChan][samp]);
-						0.00015258789 * float(*(uint16*)(bufferPtr + index)) - 5 - 0.4096; // account for +/-5V input range and DC offset
-					index += 2;
-				}
+				channel++;
+				sampleDest[channel][pos] = frameSamples[adcChan];
 			}
-			else
+		}
+		index += 16;
+		eventCodes[samp] = *(uint16*)(bufferPtr + index);
+		index += 4;
+    }
+
+	if (inPlace)
+	{
+		// a bad header cuts the block short, leaving the rest of the span unused
+		sourceBuffers[0]->commitWrite(samp);
+	}
+	else if (samp > 0)
+	{
+		// a bad header cuts the block short, so pack the channels to the actual length
+		if (samp < nSamps)
+		{
+			for (int chan = 1; chan < numBlockChannels; chan++)
 			{
-				index += 16;
+				memmove(blockSamples + chan*samp, blockSamples + chan*nSamps, samp * sizeof(float));
+				memmove(blockRawSamples + chan*samp, blockRawSamples + chan*nSamps, samp * sizeof(int16));
 			}
-			ttlEventWords.set(0, *(uint16*)(bufferPtr + index));
-			index += 4;
-			sourceBuffers[0]->addToBuffer(thisSample, &timestamps.getReference(0), &ttlEventWords.getReference(0), 1);
-        }
+		}
+
+		// push the whole block, channel-major, in a single write
+		sourceBuffers[0]->addToBuffer(blockSamples, blockTimestamps, blockEventCodes, samp, samp, blockRawSamples);
+	}
+}
+
+bool RHD2000Thread::updateBuffer()
+{
+	//int chOffset;
+	unsigned char* bufferPtr;
+    //cout << "Number of 16-bit words in FIFO: " << evalBoard->numWordsInFifo() << endl;
+    //cout << "Block size: " << blockSize << endl;
+   
+	if (blockReader != nullptr)
+	{
+		// batched mode: decode the blocks of one transfer while the reader fills the other buffer
+		bufferPtr = blockReader->waitForFilledBuffer(100);
+		if (bufferPtr != nullptr)
+		{
+			for (int block = 0; block < blockReader->getNumBlocks(); block++)
+				decodeDataBlock(bufferPtr + block * 2 * blockSize);
+
+			blockReader->releaseBuffer();
+		}
+	}
+	//std::cout << "Current number of words: " <<  evalBoard->numWordsInFifo() << " for " << blockSize << std::endl;
+    else if (evalBoard->isUSB3() || evalBoard->numWordsInFifo() >= blockSize)
+    {
+		bool return_code;
+
+		return_code = evalBoard->readRawDataBlock(&bufferPtr);
 
+		decodeDataBlock(bufferPtr);
     }
+	else
+	{
+		// USB2 reads don't block, so sleep until the rest of the block should be in the FIFO
+		int wordsPerSample = blockSize / Rhd2000DataBlock::getSamplesPerDataBlock(false);
+		int missingWords = blockSize - evalBoard->numWordsInFifo();
+		waitBeforeNextUpdate(getTimeForSamples(missingWords / wordsPerSample + 1, boardSampleRate));
+	}
 
 
     if (dacOutputShouldChange)
     {
+		const ScopedLock boardLock(boardAccessLock);
 		std::cout << "DAC" << std::endl;
         for (int k=0; k<8; k++)
         {
@@ -1833,17 +1936,19 @@ bool RHDHeadstage::isPlugged() const
 /***********************************/
 /* Below is code for impedance measurements */
 
-RHDImpedanceMeasure::RHDImpedanceMeasure(RHD2000Thread* b) : Thread(""), data(nullptr), board(b)
+RHDImpedanceMeasure::RHDImpedanceMeasure(RHD2000Thread* b) : Thread(""),
+	usbBufferSize(0), amplifierDataSize(0), samplesPerChannel(0),
+	windowStart(0), windowLength(0),
+	measurePool(jlimit(1, 8, SystemStats::getNumCpus() - 1)),
+	data(nullptr), board(b)
 {
-	// to perform electrode impedance measurements at very low frequencies.
-	const int maxNumBlocks = 120;
-	int numStreams = 8;
-	allocateDoubleArray3D(amplifierPreFilter, numStreams, 32, MAX_SAMPLES_PER_DATA_BLOCK * maxNumBlocks);
+	frameAmplifierWords.malloc(32 * MAX_NUM_DATA_STREAMS_USB3);
 }
 
 RHDImpedanceMeasure::~RHDImpedanceMeasure()
 {
 	stopThreadSafely();
+	measurePool.removeAllJobs(true, -1);
 }
 
 void RHDImpedanceMeasure::stopThreadSafely()
@@ -1922,55 +2027,69 @@ float RHDImpedanceMeasure::updateImpedanceFrequency(float desiredImpedanceFreq,
 }
 
 
-// Reads numBlocks blocks of raw USB data stored in a queue of Rhd2000DataBlock
-// objects, loads this data into this SignalProcessor object, scaling the raw
-// data to generate waveforms with units of volts or microvolts.
-int RHDImpedanceMeasure::loadAmplifierData(queue<Rhd2000DataBlock>& dataQueue,
-	int numBlocks, int numDataStreams)
+void RHDImpedanceMeasure::allocateAmplifierData(int numBlocks, int numDataStreams)
 {
+	const bool usb3 = board->evalBoard->isUSB3();
+	const size_t usbBytes = 2 * size_t(numBlocks) * Rhd2000DataBlock::calculateDataBlockSizeInWords(numDataStreams, usb3);
 
-	int block, t, channel, stream;
-	int indexAmp = 0;
-    /*
-	int indexAux = 0;
-	int indexSupply = 0;
-	int indexAdc = 0;
-	int indexDig = 0;
-	int numWordsWritten = 0;
+	if (usbBytes > usbBufferSize)
+	{
+		usbBufferSize = usbBytes;
+		usbBuffer.malloc(usbBufferSize);
+	}
 
-	int bufferIndex;
-	int16 tempQint16;
-	uint16 tempQuint16;
-	int32 tempQint32;
+	samplesPerChannel = numBlocks * SAMPLES_PER_DATA_BLOCK(usb3);
+	const size_t numSamples = size_t(numDataStreams) * 32 * samplesPerChannel;
 
-	bool triggerFound = false;
-	const double AnalogTriggerThreshold = 1.65;
-     */
+	if (numSamples > amplifierDataSize)
+	{
+		amplifierDataSize = numSamples;
+		amplifierData.malloc(amplifierDataSize);
+	}
+}
 
+// Reads numBlocks blocks of raw USB data and decodes their amplifier words, scaling the raw
+// data to generate waveforms with units of microvolts. Other words are skipped.
+bool RHDImpedanceMeasure::loadAmplifierData(int numBlocks, int numDataStreams)
+{
+	if (!board->evalBoard->readRawDataBlocks(numBlocks, usbBuffer))
+		return false;
+
+	// 4 header words, 2 timestamp words, then 3 aux words per stream before the amplifier words
+	const int frameBytes = 2 * (4 + 2 + numDataStreams * 36 + 8 + 2);
+	const int amplifierOffset = 2 * (4 + 2 + 3 * numDataStreams);
+	const int numWords = 32 * numDataStreams;
 
-	for (block = 0; block < numBlocks; ++block)
+	for (int t = 0; t < samplesPerChannel; ++t)
 	{
+		unsigned char* frame = usbBuffer + size_t(t) * frameBytes;
+
+		if (!Rhd2000DataBlock::checkUsbHeader(frame, 0))
+		{
+			cerr << "Error in RHDImpedanceMeasure::loadAmplifierData: Incorrect header." << endl;
+			return false;
+		}
+
+		// Amplifier waveform units = microvolts
+		RHD2000Decode::convertWords((const uint16*)(frame + amplifierOffset), frameAmplifierWords, numWords, 32768, 0.195f);
 
-		// Load and scale RHD2000 amplifier waveforms
-		// (sampled at amplifier sampling rate)
-		for (t = 0; t < SAMPLES_PER_DATA_BLOCK(board->evalBoard->isUSB3()); ++t)
+		// words are ordered [channel][stream] within a frame
+		for (int channel = 0; channel < 32; ++channel)
 		{
-			for (channel = 0; channel < 32; ++channel)
+			for (int stream = 0; stream < numDataStreams; ++stream)
 			{
-				for (stream = 0; stream < numDataStreams; ++stream)
-				{
-					// Amplifier waveform units = microvolts
-					amplifierPreFilter[stream][channel][indexAmp] = 0.195 *
-						(dataQueue.front().amplifierData[stream][channel][t] - 32768);
-				}
+				amplifierData[(size_t(stream) * 32 + channel) * samplesPerChannel + t] =
+					frameAmplifierWords[channel * numDataStreams + stream];
 			}
-			++indexAmp;
 		}
-		// We are done with this Rhd2000DataBlock object; remove it from dataQueue
-		dataQueue.pop();
 	}
 
-	return 0;
+	return true;
+}
+
+const float* RHDImpedanceMeasure::getAmplifierSamples(int stream, int channel) const
+{
+	return amplifierData + (size_t(stream) * 32 + channel) * samplesPerChannel;
 }
 
 #define PI  3.14159265359
@@ -1978,12 +2097,9 @@ int RHDImpedanceMeasure::loadAmplifierData(queue<Rhd2000DataBlock>& dataQueue,
 #define DEGREES_TO_RADIANS  0.0174532925199
 #define RADIANS_TO_DEGREES  57.2957795132
 
-// Return the magnitude and phase (in degrees) of a selected frequency component (in Hz)
-// for a selected amplifier channel on the selected USB data stream.
-void RHDImpedanceMeasure::measureComplexAmplitude(std::vector<std::vector<std::vector<double>>>& measuredMagnitude,
-	std::vector<std::vector<std::vector<double>>>& measuredPhase,
-	int capIndex, int stream, int chipChannel, int numBlocks,
-	double sampleRate, double frequency, int numPeriods)
+// Choose the samples measured on every channel, and tabulate the sine and cosine waveforms
+// of the selected frequency (in Hz) over them.
+void RHDImpedanceMeasure::prepareQuadrature(int numBlocks, double sampleRate, double frequency, int numPeriods)
 {
 	int period = (sampleRate / frequency);
 	int startIndex = 0;
@@ -1996,37 +2112,91 @@ void RHDImpedanceMeasure::measureComplexAmplitude(std::vector<std::vector<std::v
 		endIndex += period;
 	}
 
+	windowStart = startIndex;
+	windowLength = endIndex - startIndex + 1;
+
+	const double k = TWO_PI * frequency / sampleRate;
+
+	quadratureCos.resize(windowLength);
+	quadratureSin.resize(windowLength);
+	for (int i = 0; i < windowLength; ++i)
+	{
+		quadratureCos[i] = cos(k * (startIndex + i));
+		quadratureSin[i] = -1.0 * sin(k * (startIndex + i));
+	}
+}
+
+// Queue the measurement of the magnitude and phase (in degrees) of the selected frequency
+// component for a selected amplifier channel on the selected USB data stream. The samples
+// are copied, as the next channel is loaded into amplifierData while this one is measured.
+void RHDImpedanceMeasure::measureComplexAmplitude(std::vector<std::vector<std::vector<double>>>& measuredMagnitude,
+	std::vector<std::vector<std::vector<double>>>& measuredPhase,
+	int capIndex, int stream, int chipChannel)
+{
+	++pendingMeasurements;
+	measurePool.addJob(new MeasureJob(this, getAmplifierSamples(stream, chipChannel) + windowStart,
+		measuredMagnitude[stream][chipChannel][capIndex], measuredPhase[stream][chipChannel][capIndex]), true);
+}
+
+void RHDImpedanceMeasure::waitForMeasurements()
+{
+	while (pendingMeasurements.get() > 0)
+		measurementsDone.wait(100);
+}
+
+RHDImpedanceMeasure::MeasureJob::MeasureJob(RHDImpedanceMeasure* owner_, const float* samples_, double& magnitude_, double& phase_)
+	: ThreadPoolJob("Impedance measurement"),
+	owner(owner_),
+	samples(samples_, samples_ + owner_->windowLength),
+	magnitude(magnitude_),
+	phase(phase_)
+{
+}
+
+ThreadPoolJob::JobStatus RHDImpedanceMeasure::MeasureJob::runJob()
+{
 	double iComponent, qComponent;
 
 	// Measure real (iComponent) and imaginary (qComponent) amplitude of frequency component.
-	amplitudeOfFreqComponent(iComponent, qComponent, amplifierPreFilter[stream][chipChannel],
-		startIndex, endIndex, sampleRate, frequency);
+	owner->amplitudeOfFreqComponent(iComponent, qComponent, samples.data());
 	// Calculate magnitude and phase from real (I) and imaginary (Q) components.
-	measuredMagnitude[stream][chipChannel][capIndex] =
-		sqrt(iComponent * iComponent + qComponent * qComponent);
-	measuredPhase[stream][chipChannel][capIndex] =
-		RADIANS_TO_DEGREES *atan2(qComponent, iComponent);
+	magnitude = sqrt(iComponent * iComponent + qComponent * qComponent);
+	phase = RADIANS_TO_DEGREES *atan2(qComponent, iComponent);
+
+	if (--owner->pendingMeasurements == 0)
+		owner->measurementsDone.signal();
+
+	return jobHasFinished;
 }
 
-// Returns the real and imaginary amplitudes of a selected frequency component in the vector
-// data, between a start index and end index.
+// Returns the real and imaginary amplitudes of the selected frequency component in the
+// samples of the measurement window.
 void RHDImpedanceMeasure::amplitudeOfFreqComponent(double& realComponent, double& imagComponent,
-	const std::vector<double>& data, int startIndex,
-	int endIndex, double sampleRate, double frequency)
+	const float* window) const
 {
-	int length = endIndex - startIndex + 1;
-	const double k = TWO_PI * frequency / sampleRate;  // precalculate for speed
+	const double* c = quadratureCos.data();
+	const double* s = quadratureSin.data();
 
-	// Perform correlation with sine and cosine waveforms.
-	double meanI = 0.0;
-	double meanQ = 0.0;
-	for (int t = startIndex; t <= endIndex; ++t)
+	// Perform correlation with sine and cosine waveforms, over two independent sums each,
+	// which the compiler can keep in the two lanes of a vector register.
+	double sumI0 = 0.0, sumI1 = 0.0;
+	double sumQ0 = 0.0, sumQ1 = 0.0;
+	int t = 0;
+	for (; t + 1 < windowLength; t += 2)
+	{
+		sumI0 += window[t] * c[t];
+		sumI1 += window[t + 1] * c[t + 1];
+		sumQ0 += window[t] * s[t];
+		sumQ1 += window[t + 1] * s[t + 1];
+	}
+	for (; t < windowLength; ++t)
 	{
-		meanI += data.at(t) * cos(k * t);
-		meanQ += data.at(t) * -1.0 * sin(k * t);
+		sumI0 += window[t] * c[t];
+		sumQ0 += window[t] * s[t];
 	}
-	meanI /= (double)length;
-	meanQ /= (double)length;
+
+	double meanI = (sumI0 + sumI1) / (double)windowLength;
+	double meanQ = (sumQ0 + sumQ1) / (double)windowLength;
 
 	realComponent = 2.0 * meanI;
 	imagComponent = 2.0 * meanQ;
@@ -2097,7 +2267,6 @@ void RHDImpedanceMeasure::runImpedanceMeasurement()
 	double cSeries;
 	vector<int> commandList;
 	//int triggerIndex;                       // dummy reference variable; not used
-	queue<Rhd2000DataBlock> bufferQueue;    // dummy reference variable; not used
 	int numdataStreams = board->evalBoard->getNumEnabledDataStreams();
 
 	bool rhd2164ChipPresent = false;
@@ -2203,6 +2372,16 @@ void RHDImpedanceMeasure::runImpedanceMeasurement()
 
 	int bestAmplitudeIndex;
 
+	prepareQuadrature(numBlocks, board->boardSampleRate, actualImpedanceFreq, numPeriods);
+	allocateAmplifierData(numBlocks, numdataStreams);
+
+	// the queued measurements write to measuredMagnitude and measuredPhase, including on the way out of CHECK_EXIT
+	struct MeasurementWaiter
+	{
+		RHDImpedanceMeasure& owner;
+		~MeasurementWaiter() { owner.waitForMeasurements(); }
+	} waiter = { *this };
+
 	// We execute three complete electrode impedance measurements: one each with
 	// Cseries set to 0.1 pF, 1 pF, and 10 pF.  Then we select the best measurement
 	// for each channel so that we achieve a wide impedance measurement range.
@@ -2245,16 +2424,13 @@ void RHDImpedanceMeasure::runImpedanceMeasurement()
 			{
 
 			}
-			queue<Rhd2000DataBlock> dataQueue;
-			board->evalBoard->readDataBlocks(numBlocks, dataQueue);
-			loadAmplifierData(dataQueue, numBlocks, numdataStreams);
+			loadAmplifierData(numBlocks, numdataStreams);
 			for (stream = 0; stream < numdataStreams; ++stream)
 			{
 				if (board->chipId[stream] != CHIP_ID_RHD2164_B)
 				{
 					measureComplexAmplitude(measuredMagnitude, measuredPhase,
-						capRange, stream, channel, numBlocks, board->boardSampleRate,
-						actualImpedanceFreq, numPeriods);
+						capRange, stream, channel);
 				}
 			}
 
@@ -2274,22 +2450,22 @@ void RHDImpedanceMeasure::runImpedanceMeasurement()
 				{
 
 				}
-				board->evalBoard->readDataBlocks(numBlocks, dataQueue);
-				loadAmplifierData(dataQueue, numBlocks, numdataStreams);
+				loadAmplifierData(numBlocks, numdataStreams);
 
 				for (stream = 0; stream < board->evalBoard->getNumEnabledDataStreams(); ++stream)
 				{
 					if (board->chipId[stream] == CHIP_ID_RHD2164_B)
 					{
 						measureComplexAmplitude(measuredMagnitude, measuredPhase,
-							capRange, stream, channel, numBlocks, board->boardSampleRate,
-							actualImpedanceFreq, numPeriods);
+							capRange, stream, channel);
 					}
 				}
 			}
 		}
 	}
 
+	waitForMeasurements();
+
 	data->streams.clear();
 	data->channels.clear();
 	data->magnitudes.clear();
@@ -2394,3 +2570,65 @@ void RHDImpedanceMeasure::restoreFPGA()
 		board->evalBoard->enableExternalFastSettle(true);
 	}
 }
+
+
+RHDBlockReader::RHDBlockReader(RHD2000Thread* b, int nBlocks, int blockSizeInBytes)
+    : Thread("RHD2000 Block Reader"),
+      board(b),
+      numBlocks(nBlocks),
+      blockBytes(blockSizeInBytes),
+      readIndex(0)
+{
+    setPriority(10);
+
+    for (int i = 0; i < 2; i++)
+    {
+        buffers[i].malloc(numBlocks * blockBytes);
+        bufferFree[i].signal();
+    }
+}
+
+RHDBlockReader::~RHDBlockReader()
+{
+    stopThread(1000);
+}
+
+void RHDBlockReader::run()
+{
+    int writeIndex = 0;
+
+    while (!threadShouldExit())
+    {
+        if (!bufferFree[writeIndex].wait(100))
+            continue;
+
+        while (!board->readDataBlocks(numBlocks, buffers[writeIndex]))
+        {
+            if (threadShouldExit())
+                return;
+            wait(1);
+        }
+
+        bufferFilled[writeIndex].signal();
+        writeIndex = 1 - writeIndex;
+    }
+}
+
+unsigned char* RHDBlockReader::waitForFilledBuffer(int timeoutMs)
+{
+    if (!bufferFilled[readIndex].wait(timeoutMs))
+        return nullptr;
+
+    return buffers[readIndex];
+}
+
+void RHDBlockReader::releaseBuffer()
+{
+    bufferFree[readIndex].signal();
+    readIndex = 1 - readIndex;
+}
+
+int RHDBlockReader::getNumBlocks() const
+{
+    return numBlocks;
+}
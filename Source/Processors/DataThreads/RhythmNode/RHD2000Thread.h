@@ -46,6 +46,7 @@
 class SourceNode;
 class RHDHeadstage;
 class RHDImpedanceMeasure;
+class RHDBlockReader;
 
 struct ImpedanceData
 {
@@ -65,6 +66,7 @@ class RHD2000Thread : public DataThread
                     , public Timer
 {
     friend class RHDImpedanceMeasure;
+    friend class RHDBlockReader;
 
 public:
     RHD2000Thread (SourceNode* sn);
@@ -85,6 +87,7 @@ public:
 
     float getSampleRate(int subprocessor) const override;
     float getBitVolts (const DataChannel* chan) const override;
+    bool hasRawSamples (const DataChannel* chan) const override;
 
     float getAdcBitVolts (int channelNum) const;
 
@@ -137,6 +140,14 @@ public:
     int getHeadstageChannel (int& hs, int ch) const;
 
     void runImpedanceTest (ImpedanceData* data);
+
+    /** Sets how many USB data blocks are read per transfer. With more than one, the transfers
+        run on a separate thread into two alternating buffers, so block k is decoded while
+        block k+1 is read. 1 (the default) reads a single block per updateBuffer() call.
+        Takes effect the next time acquisition starts.*/
+    void setBlocksPerTransfer (int numBlocks);
+    int getBlocksPerTransfer() const;
+
     void enableBoardLeds( bool enable);
     int setClockDivider (int divide_ratio);
     GenericEditor* createEditor (SourceNode* sn);
@@ -153,6 +164,12 @@ private:
 
     bool updateBuffer() override;
 
+    /** Decodes one USB data block into the DataBuffer */
+    void decodeDataBlock (unsigned char* bufferPtr);
+
+    /** Reads numBlocks data blocks into buffer, if they are available. Used by the RHDBlockReader. */
+    bool readDataBlocks (int numBlocks, unsigned char* buffer);
+
     void timerCallback() override;
 
     bool startAcquisition() override;
@@ -165,13 +182,30 @@ private:
     int numChannels;
     bool deviceFound;
 
-    float thisSample[MAX_NUM_CHANNELS];
+    // where each channel of a block is decoded to: the DataBuffer itself, or the block buffers below
+    float* sampleDest[MAX_NUM_CHANNELS + 8];
+    int16* rawDest[MAX_NUM_CHANNELS + 8];
+    // a whole USB block, stored channel-major, for when it doesn't fit in the DataBuffer
+    HeapBlock<float> blockSamples;
+    // the amplifier codes of the same block, relative to mid-scale
+    HeapBlock<int16> blockRawSamples;
+    int64 blockTimestamps[MAX_SAMPLES_PER_DATA_BLOCK];
+    uint64 blockEventCodes[MAX_SAMPLES_PER_DATA_BLOCK];
+    // decoded words of the current frame, and where each amplifier channel sits among them
+    float frameSamples[32 * MAX_NUM_DATA_STREAMS_USB3];
+    int ampWordIndex[MAX_NUM_CHANNELS];
+
     // aux inputs are only sampled every 4th sample, so use this to buffer the samples so they can be handles just like the regular neural channels later
     float auxBuffer[MAX_NUM_CHANNELS];
     float auxSamples[MAX_NUM_DATA_STREAMS_USB3][3];
 
     unsigned int blockSize;
 
+    int blocksPerTransfer;
+    ScopedPointer<RHDBlockReader> blockReader;
+    // serializes the board accesses of the reader thread and the data thread
+    CriticalSection boardAccessLock;
+
     bool isTransmitting;
 
     bool dacOutputShouldChange;
@@ -277,14 +311,35 @@ private:
     void runImpedanceMeasurement();
     void restoreFPGA();
 
+    /** Measures the magnitude and phase of one channel on a copy of its samples, on the
+        measurement pool, so that the board can acquire the next channel meanwhile */
+    class MeasureJob : public ThreadPoolJob
+    {
+    public:
+        MeasureJob (RHDImpedanceMeasure* owner, const float* samples, double& magnitude, double& phase);
+
+        JobStatus runJob() override;
+
+    private:
+        RHDImpedanceMeasure* owner;
+        std::vector<float> samples;
+        double& magnitude;
+        double& phase;
+    };
+
+    /** Picks the window measured on every channel and tabulates the cosine and sine of the
+        measured frequency over it, once per measurement */
+    void prepareQuadrature (int numBlocks, double sampleRate, double frequency, int numPeriods);
+
     void measureComplexAmplitude (std::vector<std::vector<std::vector<double>>>& measuredMagnitude,
                                   std::vector<std::vector<std::vector<double>>>& measuredPhase,
-                                  int capIndex, int stream, int chipChannel, int numBlocks,
-                                  double sampleRate, double frequency, int numPeriods);
+                                  int capIndex, int stream, int chipChannel);
 
-    void amplitudeOfFreqComponent (double& realComponent, double& imagComponent,
-                                   const std::vector<double>& data, int startIndex,
-                                   int endIndex, double sampleRate, double frequency);
+    /** Correlates the samples of the measurement window with the quadrature tables */
+    void amplitudeOfFreqComponent (double& realComponent, double& imagComponent, const float* window) const;
+
+    /** Returns once every queued measurement has been written */
+    void waitForMeasurements();
 
     void factorOutParallelCapacitance(double& impedanceMagnitude, double& impedancePhase,
                                       double frequency, double parasiticCapacitance);
@@ -293,10 +348,32 @@ private:
                                        double boardSampleRate);
 
     float updateImpedanceFrequency (float desiredImpedanceFreq, bool& impedanceFreqValid);
-    int loadAmplifierData (queue<Rhd2000DataBlock>& dataQueue,
-                           int numBlocks, int numDataStreams);
+    /** Sizes the raw USB buffer and the amplifier samples for numBlocks blocks, reusing them if large enough */
+    void allocateAmplifierData (int numBlocks, int numDataStreams);
+
+    /** Reads numBlocks blocks from the board and decodes their amplifier words straight from the raw USB buffer */
+    bool loadAmplifierData (int numBlocks, int numDataStreams);
+
+    /** The samples of one amplifier channel, in microvolts */
+    const float* getAmplifierSamples (int stream, int channel) const;
+
+    HeapBlock<unsigned char> usbBuffer;
+    size_t usbBufferSize;
+
+    // flat, as stream x channel x sample, with samplesPerChannel samples per channel
+    HeapBlock<float> amplifierData;
+    size_t amplifierDataSize;
+    int samplesPerChannel;
+    HeapBlock<float> frameAmplifierWords;
 
-    std::vector<std::vector<std::vector<double>>> amplifierPreFilter;
+    int windowStart;
+    int windowLength;
+    std::vector<double> quadratureCos;
+    std::vector<double> quadratureSin;  // negated, as the imaginary part is correlated with -sin
+
+    ThreadPool measurePool;
+    Atomic<int> pendingMeasurements;
+    WaitableEvent measurementsDone;
 
     ImpedanceData* data;
     RHD2000Thread* board;
@@ -304,4 +381,44 @@ private:
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RHDImpedanceMeasure);
 };
 
+
+/**
+    Reads batches of USB data blocks from the board on its own thread.
+
+    Transfers go to two buffers used in turn, so that the board keeps being drained
+    while the RHD2000Thread decodes the previous batch.
+
+    @see RHD2000Thread::setBlocksPerTransfer
+*/
+class RHDBlockReader : public Thread
+{
+public:
+    RHDBlockReader (RHD2000Thread* b, int numBlocks, int blockSizeInBytes);
+    ~RHDBlockReader();
+
+    void run() override;
+
+    /** Waits up to timeoutMs for the next filled buffer. Returns nullptr if none is ready. */
+    unsigned char* waitForFilledBuffer (int timeoutMs);
+
+    /** Hands the buffer returned by waitForFilledBuffer() back to the reader. */
+    void releaseBuffer();
+
+    int getNumBlocks() const;
+
+private:
+    RHD2000Thread* board;
+
+    const int numBlocks;
+    const int blockBytes;
+
+    HeapBlock<unsigned char> buffers[2];
+    WaitableEvent bufferFilled[2];
+    WaitableEvent bufferFree[2];
+
+    int readIndex;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RHDBlockReader);
+};
+
 #endif  // __RHD2000THREAD_H_2C4CBD67__
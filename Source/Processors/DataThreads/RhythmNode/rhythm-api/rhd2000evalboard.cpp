@@ -1481,6 +1481,31 @@ bool Rhd2000EvalBoard::readRawDataBlock(unsigned char** bufferPtr, int nSamples)
 	return true;
 }
 
+// Reads numBlocks USB data blocks in a single transfer into a caller-supplied buffer, which must
+// hold numBlocks full data blocks. Unlike readDataBlocks, it doesn't check the FIFO level first.
+bool Rhd2000EvalBoard::readRawDataBlocks(int numBlocks, unsigned char* buffer)
+{
+	unsigned int numBytesToRead;
+	long res;
+
+	numBytesToRead = 2 * numBlocks * Rhd2000DataBlock::calculateDataBlockSizeInWords(numDataStreams, usb3);
+
+	if (usb3)
+	{
+		res = dev->ReadFromBlockPipeOut(PipeOutData, USB3_BLOCK_SIZE, numBytesToRead, buffer);
+	}
+	else
+	{
+		res = dev->ReadFromPipeOut(PipeOutData, numBytesToRead, buffer);
+	}
+	if (res == ok_Timeout)
+	{
+		cerr << "CRITICAL: Timeout on pipe read. Check block and buffer sizes." << endl;
+		return false;
+	}
+	return res >= 0;
+}
+
 // Reads a certain number of USB data blocks, if the specified number is available, and appends them
 // to queue.  Returns true if data blocks were available.
 bool Rhd2000EvalBoard::readDataBlocks(int numBlocks, queue<Rhd2000DataBlock> &dataQueue)
@@ -0,0 +1,177 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "SyntheticDataEditor.h"
+#include "SyntheticDataThread.h"
+
+
+SyntheticDataEditor::SyntheticDataEditor (GenericProcessor* parentNode,
+                                          SyntheticDataThread* thread_,
+                                          bool useDefaultParameterEditors)
+    : GenericEditor (parentNode, useDefaultParameterEditors)
+    , thread        (thread_)
+{
+    desiredWidth = 190;
+
+    for (int n = 16; n <= MAX_SYNTHETIC_CHANNELS; n *= 2)
+        channelValues.add (n);
+
+    for (int n = 1; n <= MAX_SYNTHETIC_SUBPROCESSORS; n *= 2)
+        subProcessorValues.add (n);
+
+    sampleRateValues.add (1000.0f);
+    sampleRateValues.add (2000.0f);
+    sampleRateValues.add (5000.0f);
+    sampleRateValues.add (10000.0f);
+    sampleRateValues.add (20000.0f);
+    sampleRateValues.add (25000.0f);
+    sampleRateValues.add (30000.0f);
+    sampleRateValues.add (40000.0f);
+
+    spikeRateValues.add (0.0f);
+    spikeRateValues.add (1.0f);
+    spikeRateValues.add (10.0f);
+    spikeRateValues.add (50.0f);
+    spikeRateValues.add (100.0f);
+
+    ttlValues.add (0.0f);
+    ttlValues.add (0.5f);
+    ttlValues.add (1.0f);
+    ttlValues.add (10.0f);
+    ttlValues.add (100.0f);
+
+    channelSelection      = addOption ("Channels",  channelValues,      thread->getNumChannels(),                 27);
+    subProcessorSelection = addOption ("Streams",   subProcessorValues, (float) thread->getNumSubProcessors(),    47);
+    sampleRateSelection   = addOption ("Rate (Hz)", sampleRateValues,   thread->getSampleRate (0),                67);
+    spikeRateSelection    = addOption ("Spikes/s",  spikeRateValues,    thread->getSpikeRate(),                   87);
+    ttlSelection          = addOption ("TTL (Hz)",  ttlValues,          thread->getTTLFrequency(),                107);
+}
+
+
+SyntheticDataEditor::~SyntheticDataEditor()
+{
+}
+
+
+ComboBox* SyntheticDataEditor::addOption (const String& name, const Array<float>& values, float current, int y)
+{
+    Label* label = new Label (name, name);
+    label->setFont (Font ("Small Text", 10, Font::plain));
+    label->setColour (Label::textColourId, Colours::darkgrey);
+    label->setBounds (8, y, 70, 18);
+    addAndMakeVisible (label);
+    labels.add (label);
+
+    ComboBox* comboBox = new ComboBox (name);
+    for (int i = 0; i < values.size(); ++i)
+        comboBox->addItem (String (values[i]), i + 1);
+
+    selectValue (comboBox, values, current);
+    comboBox->addListener (this);
+    comboBox->setBounds (80, y, 100, 18);
+    addAndMakeVisible (comboBox);
+
+    return comboBox;
+}
+
+
+void SyntheticDataEditor::selectValue (ComboBox* comboBox, const Array<float>& values, float value)
+{
+    int closest = 0;
+    for (int i = 1; i < values.size(); ++i)
+    {
+        if (std::abs (values[i] - value) < std::abs (values[closest] - value))
+            closest = i;
+    }
+
+    comboBox->setSelectedId (closest + 1, dontSendNotification);
+}
+
+
+void SyntheticDataEditor::applySettings()
+{
+    thread->setNumChannels ((int) channelValues[channelSelection->getSelectedId() - 1]);
+    thread->setNumSubProcessors ((int) subProcessorValues[subProcessorSelection->getSelectedId() - 1]);
+    thread->setSampleRate (sampleRateValues[sampleRateSelection->getSelectedId() - 1]);
+    thread->setSpikeRate (spikeRateValues[spikeRateSelection->getSelectedId() - 1]);
+    thread->setTTLFrequency (ttlValues[ttlSelection->getSelectedId() - 1]);
+}
+
+
+void SyntheticDataEditor::comboBoxChanged (ComboBox*)
+{
+    if (acquisitionIsActive)
+        return;
+
+    applySettings();
+
+    CoreServices::updateSignalChain (this);
+}
+
+
+void SyntheticDataEditor::startAcquisition()
+{
+    channelSelection->setEnabled (false);
+    subProcessorSelection->setEnabled (false);
+    sampleRateSelection->setEnabled (false);
+    spikeRateSelection->setEnabled (false);
+    ttlSelection->setEnabled (false);
+
+    acquisitionIsActive = true;
+}
+
+
+void SyntheticDataEditor::stopAcquisition()
+{
+    channelSelection->setEnabled (true);
+    subProcessorSelection->setEnabled (true);
+    sampleRateSelection->setEnabled (true);
+    spikeRateSelection->setEnabled (true);
+    ttlSelection->setEnabled (true);
+
+    acquisitionIsActive = false;
+}
+
+
+void SyntheticDataEditor::saveCustomParameters (XmlElement* xml)
+{
+    xml->setAttribute ("Channels",      thread->getNumChannels());
+    xml->setAttribute ("SubProcessors", (int) thread->getNumSubProcessors());
+    xml->setAttribute ("SampleRate",    thread->getSampleRate (0));
+    xml->setAttribute ("SpikeRate",     thread->getSpikeRate());
+    xml->setAttribute ("TTLFrequency",  thread->getTTLFrequency());
+}
+
+
+void SyntheticDataEditor::loadCustomParameters (XmlElement* xml)
+{
+    selectValue (channelSelection,      channelValues,      (float) xml->getIntAttribute ("Channels", thread->getNumChannels()));
+    selectValue (subProcessorSelection, subProcessorValues, (float) xml->getIntAttribute ("SubProcessors", 1));
+    selectValue (sampleRateSelection,   sampleRateValues,   (float) xml->getDoubleAttribute ("SampleRate", thread->getSampleRate (0)));
+    selectValue (spikeRateSelection,    spikeRateValues,    (float) xml->getDoubleAttribute ("SpikeRate", thread->getSpikeRate()));
+    selectValue (ttlSelection,          ttlValues,          (float) xml->getDoubleAttribute ("TTLFrequency", thread->getTTLFrequency()));
+
+    applySettings();
+
+    CoreServices::updateSignalChain (this);
+}
@@ -0,0 +1,79 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __SYNTHETICDATAEDITOR_H_5E7A61C3__
+#define __SYNTHETICDATAEDITOR_H_5E7A61C3__
+
+#include "../../../../JuceLibraryCode/JuceHeader.h"
+#include "../../Editors/GenericEditor.h"
+
+class SyntheticDataThread;
+
+
+/**
+    User interface for the synthetic data source: channel count, subprocessors,
+    sample rate, spike rate and TTL frequency. Settings can only be changed
+    while acquisition is stopped.
+
+    @see SyntheticDataThread
+*/
+class SyntheticDataEditor : public GenericEditor,
+    public ComboBox::Listener
+{
+public:
+    SyntheticDataEditor (GenericProcessor* parentNode, SyntheticDataThread* thread, bool useDefaultParameterEditors);
+    ~SyntheticDataEditor();
+
+    void comboBoxChanged (ComboBox* comboBox) override;
+
+    void startAcquisition() override;
+    void stopAcquisition() override;
+
+    void saveCustomParameters (XmlElement* xml) override;
+    void loadCustomParameters (XmlElement* xml) override;
+
+
+private:
+    /** Adds a labelled combo box listing values, selecting the one closest to current. */
+    ComboBox* addOption (const String& name, const Array<float>& values, float current, int y);
+
+    /** Selects the item of a combo box closest to value, without notifying. */
+    static void selectValue (ComboBox* comboBox, const Array<float>& values, float value);
+
+    /** Pushes every combo box selection to the thread. */
+    void applySettings();
+
+    SyntheticDataThread* thread;
+
+    Array<float> channelValues, subProcessorValues, sampleRateValues, spikeRateValues, ttlValues;
+
+    OwnedArray<Label> labels;
+    ScopedPointer<ComboBox> channelSelection, subProcessorSelection, sampleRateSelection,
+                            spikeRateSelection, ttlSelection;
+
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SyntheticDataEditor);
+};
+
+
+#endif  // __SYNTHETICDATAEDITOR_H_5E7A61C3__
@@ -0,0 +1,324 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "SyntheticDataThread.h"
+#include "SyntheticDataEditor.h"
+#include "../../SourceNode/SourceNode.h"
+
+// samples per channel written to the DataBuffer at once, when catching up after a stall
+#define SYNTHETIC_BLOCK_SIZE 256
+
+// must be a power of two
+#define NOISE_TABLE_SIZE 65536
+
+#define SYNTHETIC_BITVOLTS 0.195f
+#define NOISE_RMS_UV 8.0f
+#define SPIKE_AMPLITUDE_UV 120.0f
+#define SPIKE_DURATION_S 0.0015f
+
+
+DataThread* SyntheticDataThread::createDataThread (SourceNode* sn)
+{
+    return new SyntheticDataThread (sn);
+}
+
+
+SyntheticDataThread::SyntheticDataThread (SourceNode* sn)
+    : DataThread        (sn)
+    , numChannels       (64)
+    , numSubProcessors  (1)
+    , sampleRate        (30000.0f)
+    , spikeRate         (10.0f)
+    , ttlFrequency      (1.0f)
+    , startTicks        (0)
+    , samplesGenerated  (0)
+    , spikeLength       (0)
+{
+    resizeBuffers();
+}
+
+
+SyntheticDataThread::~SyntheticDataThread()
+{
+}
+
+
+GenericEditor* SyntheticDataThread::createEditor (SourceNode* sn)
+{
+    return new SyntheticDataEditor (sn, this, true);
+}
+
+
+bool SyntheticDataThread::foundInputSource() { return true; }
+
+bool SyntheticDataThread::isReady() { return true; }
+
+
+int SyntheticDataThread::getChannelsPerSubProcessor() const
+{
+    return jmax (1, numChannels / numSubProcessors);
+}
+
+
+int SyntheticDataThread::getNumDataOutputs (DataChannel::DataChannelTypes type, int) const
+{
+    if (type == DataChannel::HEADSTAGE_CHANNEL)
+        return getChannelsPerSubProcessor();
+
+    return 0;
+}
+
+
+int SyntheticDataThread::getNumTTLOutputs (int) const { return SYNTHETIC_TTL_LINES; }
+
+unsigned int SyntheticDataThread::getNumSubProcessors() const { return numSubProcessors; }
+
+float SyntheticDataThread::getSampleRate (int) const { return sampleRate; }
+
+float SyntheticDataThread::getBitVolts (const DataChannel*) const { return SYNTHETIC_BITVOLTS; }
+
+
+bool SyntheticDataThread::hasRawSamples (const DataChannel* chan) const
+{
+    return chan->getChannelType() == DataChannel::HEADSTAGE_CHANNEL;
+}
+
+
+void SyntheticDataThread::setNumChannels (int n)
+{
+    numChannels = jlimit (1, MAX_SYNTHETIC_CHANNELS, n);
+}
+
+int SyntheticDataThread::getNumChannels() const { return numChannels; }
+
+
+void SyntheticDataThread::setNumSubProcessors (int n)
+{
+    numSubProcessors = jlimit (1, MAX_SYNTHETIC_SUBPROCESSORS, n);
+}
+
+
+void SyntheticDataThread::setSampleRate (float rate)
+{
+    if (rate > 0)
+        sampleRate = rate;
+}
+
+
+void SyntheticDataThread::setSpikeRate (float rate) { spikeRate = jmax (0.0f, rate); }
+
+float SyntheticDataThread::getSpikeRate() const { return spikeRate; }
+
+void SyntheticDataThread::setTTLFrequency (float frequency) { ttlFrequency = jmax (0.0f, frequency); }
+
+float SyntheticDataThread::getTTLFrequency() const { return ttlFrequency; }
+
+
+void SyntheticDataThread::resizeBuffers()
+{
+    const int channelsPerSub = getChannelsPerSubProcessor();
+
+    while (sourceBuffers.size() > numSubProcessors)
+        sourceBuffers.removeLast();
+
+    while (sourceBuffers.size() < numSubProcessors)
+    {
+        DataBuffer* buffer = new DataBuffer (channelsPerSub, 10000);
+        buffer->enableRawSamples (true);
+        sourceBuffers.add (buffer);
+    }
+
+    for (int i = 0; i < sourceBuffers.size(); ++i)
+        sourceBuffers[i]->resize (channelsPerSub, 10000);
+}
+
+
+void SyntheticDataThread::resetGenerator()
+{
+    // a fixed seed makes every acquisition with the same settings reproducible
+    random.setSeed (0x0E0E0E0E);
+
+    const float noiseCodes = NOISE_RMS_UV / SYNTHETIC_BITVOLTS;
+
+    noiseTable.malloc (NOISE_TABLE_SIZE);
+    for (int i = 0; i < NOISE_TABLE_SIZE; ++i)
+    {
+        // the sum of four uniform values is close enough to a normal distribution
+        float sum = 0;
+        for (int k = 0; k < 4; ++k)
+            sum += random.nextFloat() - 0.5f;
+
+        noiseTable[i] = (int16) roundToInt (sum * noiseCodes * 1.732f);
+    }
+
+    // biphasic extracellular spike: sharp trough followed by a slower, smaller peak
+    spikeLength = jmax (3, roundToInt (SPIKE_DURATION_S * sampleRate));
+    spikeWaveform.malloc (spikeLength);
+
+    const float spikeCodes = SPIKE_AMPLITUDE_UV / SYNTHETIC_BITVOLTS;
+    for (int i = 0; i < spikeLength; ++i)
+    {
+        const float x = float (i) / float (spikeLength);
+        const float trough = std::exp (-std::pow ((x - 0.3f) / 0.08f, 2.0f));
+        const float peak = std::exp (-std::pow ((x - 0.55f) / 0.15f, 2.0f));
+
+        spikeWaveform[i] = (int16) roundToInt (spikeCodes * (0.4f * peak - trough));
+    }
+
+    const int totalChannels = getChannelsPerSubProcessor() * numSubProcessors;
+
+    noisePosition.malloc (totalChannels);
+    nextSpike.malloc (totalChannels);
+    spikeScale.malloc (totalChannels);
+
+    for (int i = 0; i < totalChannels; ++i)
+    {
+        noisePosition[i] = random.nextInt (NOISE_TABLE_SIZE);
+        spikeScale[i] = 0.5f + random.nextFloat();
+        nextSpike[i] = spikeRate > 0 ? random.nextInt (jmax (1, roundToInt (sampleRate / spikeRate))) : -1;
+    }
+
+    const int channelsPerSub = getChannelsPerSubProcessor();
+
+    blockSamples.malloc (channelsPerSub * SYNTHETIC_BLOCK_SIZE);
+    blockRawSamples.malloc (channelsPerSub * SYNTHETIC_BLOCK_SIZE);
+    blockTimestamps.malloc (SYNTHETIC_BLOCK_SIZE);
+    blockEventCodes.malloc (SYNTHETIC_BLOCK_SIZE);
+
+    samplesGenerated = 0;
+}
+
+
+bool SyntheticDataThread::startAcquisition()
+{
+    resetGenerator();
+
+    for (int i = 0; i < sourceBuffers.size(); ++i)
+        sourceBuffers[i]->clear();
+
+    std::cout << "Synthetic source generating " << numChannels << " channels in " << numSubProcessors
+              << " subprocessor(s) at " << sampleRate << " Hz" << std::endl;
+
+    startTicks = Time::getHighResolutionTicks();
+    startThread();
+
+    return true;
+}
+
+
+bool SyntheticDataThread::stopAcquisition()
+{
+    if (isThreadRunning())
+        signalThreadShouldExit();
+
+    if (! waitForThreadToExit (500))
+        std::cout << "Synthetic data thread failed to exit, continuing anyway..." << std::endl;
+
+    for (int i = 0; i < sourceBuffers.size(); ++i)
+        sourceBuffers[i]->clear();
+
+    return true;
+}
+
+
+bool SyntheticDataThread::updateBuffer()
+{
+    // the number of samples due is derived from the elapsed time rather than accumulated per
+    // call, so the average rate stays exact however irregularly the thread is woken up
+    const double elapsed = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - startTicks);
+    const int64 samplesDue = (int64) (elapsed * sampleRate);
+
+    if (samplesDue <= samplesGenerated)
+    {
+        // until a block is due, but no longer than a millisecond
+        waitBeforeNextUpdate (jmin (0.001, getTimeForSamples (int (samplesGenerated - samplesDue) + SYNTHETIC_BLOCK_SIZE, sampleRate)));
+        return true;
+    }
+
+    const int numSamples = (int) jmin ((int64) SYNTHETIC_BLOCK_SIZE, samplesDue - samplesGenerated);
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const int64 sampleNumber = samplesGenerated + i;
+        blockTimestamps[i] = sampleNumber;
+
+        // binary counter: line k toggles at ttlFrequency / 2^k
+        const int64 halfPeriods = ttlFrequency > 0 ? (int64) (sampleNumber * 2.0 * ttlFrequency / sampleRate) : 0;
+        blockEventCodes[i] = uint64 (halfPeriods) & ((1 << SYNTHETIC_TTL_LINES) - 1);
+    }
+
+    for (int sub = 0; sub < numSubProcessors; ++sub)
+    {
+        generateBlock (sub, numSamples);
+
+        sourceBuffers[sub]->addToBuffer (blockSamples, blockTimestamps, blockEventCodes,
+                                         numSamples, numSamples, blockRawSamples);
+    }
+
+    samplesGenerated += numSamples;
+
+    return true;
+}
+
+
+void SyntheticDataThread::generateBlock (int sub, int numSamples)
+{
+    const int channelsPerSub = getChannelsPerSubProcessor();
+    const int64 blockStart = samplesGenerated;
+    const int64 blockEnd = samplesGenerated + numSamples;
+
+    for (int chan = 0; chan < channelsPerSub; ++chan)
+    {
+        const int index = sub * channelsPerSub + chan;
+
+        int16* raw = blockRawSamples + (chan * numSamples);
+        float* samples = blockSamples + (chan * numSamples);
+
+        const int position = noisePosition[index];
+        for (int i = 0; i < numSamples; ++i)
+            raw[i] = noiseTable[(position + i) & (NOISE_TABLE_SIZE - 1)];
+
+        noisePosition[index] = (position + numSamples) & (NOISE_TABLE_SIZE - 1);
+
+        // a spike can start in a previous block and end in this one
+        while (nextSpike[index] >= 0 && nextSpike[index] < blockEnd)
+        {
+            const int64 spikeStart = nextSpike[index];
+            const int64 from = jmax (spikeStart, blockStart);
+            const int64 to = jmin (spikeStart + spikeLength, blockEnd);
+
+            for (int64 s = from; s < to; ++s)
+                raw[s - blockStart] += (int16) roundToInt (spikeScale[index] * spikeWaveform[s - spikeStart]);
+
+            if (spikeStart + spikeLength > blockEnd)
+                break;
+
+            // exponential inter-spike intervals, with the spike itself as refractory period
+            const double interval = -std::log (1.0 - random.nextDouble()) * sampleRate / spikeRate;
+            nextSpike[index] = spikeStart + spikeLength + (int64) interval;
+        }
+
+        for (int i = 0; i < numSamples; ++i)
+            samples[i] = raw[i] * SYNTHETIC_BITVOLTS;
+    }
+}
@@ -0,0 +1,132 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __SYNTHETICDATATHREAD_H_5E7A61C3__
+#define __SYNTHETICDATATHREAD_H_5E7A61C3__
+
+#include "../../../../JuceLibraryCode/JuceHeader.h"
+#include "../DataThread.h"
+
+#define MAX_SYNTHETIC_CHANNELS 4096
+#define MAX_SYNTHETIC_SUBPROCESSORS 8
+#define SYNTHETIC_TTL_LINES 8
+
+class SourceNode;
+
+
+/**
+    Generates synthetic neural data at wall-clock pace, to exercise the signal chain without hardware.
+
+    Each channel carries Gaussian-like noise with spike-shaped transients at Poisson intervals,
+    and every subprocessor drives SYNTHETIC_TTL_LINES TTL lines counting in binary. The data is
+    produced as int16 codes and written through the same DataBuffer path (raw codes included)
+    as a hardware source. With a fixed seed, two acquisitions with the same settings produce
+    the same samples.
+
+    @see DataThread, SourceNode
+*/
+class SyntheticDataThread : public DataThread
+{
+public:
+    SyntheticDataThread (SourceNode* sn);
+    ~SyntheticDataThread();
+
+    bool foundInputSource() override;
+    bool isReady() override;
+
+    int getNumDataOutputs (DataChannel::DataChannelTypes type, int subProcessor) const override;
+    int getNumTTLOutputs (int subProcessor) const override;
+    unsigned int getNumSubProcessors() const override;
+
+    float getSampleRate (int subProcessor) const override;
+    float getBitVolts (const DataChannel* chan) const override;
+    bool hasRawSamples (const DataChannel* chan) const override;
+
+    void resizeBuffers() override;
+
+    GenericEditor* createEditor (SourceNode* sn) override;
+
+    static DataThread* createDataThread (SourceNode* sn);
+
+    /** Sets the total number of channels, split evenly across the subprocessors. */
+    void setNumChannels (int numChannels);
+    int getNumChannels() const;
+
+    void setNumSubProcessors (int numSubProcessors);
+
+    void setSampleRate (float sampleRate);
+
+    /** Sets the mean firing rate of every channel, in spikes per second. 0 disables spikes. */
+    void setSpikeRate (float spikesPerSecond);
+    float getSpikeRate() const;
+
+    /** Sets the frequency of the first TTL line. Each following line runs at half the
+        frequency of the previous one. 0 keeps all lines low. */
+    void setTTLFrequency (float frequency);
+    float getTTLFrequency() const;
+
+
+private:
+    bool updateBuffer() override;
+
+    bool startAcquisition() override;
+    bool stopAcquisition()  override;
+
+    int getChannelsPerSubProcessor() const;
+
+    /** Builds the noise table, spike waveform and per-channel state for a new acquisition. */
+    void resetGenerator();
+
+    /** Writes numSamples samples of a subprocessor's channels, channel-major, to the scratch blocks. */
+    void generateBlock (int subProcessor, int numSamples);
+
+    int numChannels;
+    int numSubProcessors;
+    float sampleRate;
+    float spikeRate;
+    float ttlFrequency;
+
+    Random random;
+    int64 startTicks;
+    int64 samplesGenerated;
+
+    HeapBlock<int16> noiseTable;
+    HeapBlock<int16> spikeWaveform;
+    int spikeLength;
+
+    /** Per channel, over all subprocessors */
+    HeapBlock<int> noisePosition;
+    HeapBlock<int64> nextSpike;
+    HeapBlock<float> spikeScale;
+
+    HeapBlock<float> blockSamples;
+    HeapBlock<int16> blockRawSamples;
+    HeapBlock<int64> blockTimestamps;
+    HeapBlock<uint64> blockEventCodes;
+
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SyntheticDataThread);
+};
+
+
+#endif  // __SYNTHETICDATATHREAD_H_5E7A61C3__
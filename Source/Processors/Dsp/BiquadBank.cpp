@@ -0,0 +1,533 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "BiquadBank.h"
+
+#if JUCE_INTEL && (defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2))
+ #define BIQUAD_BANK_SSE2 1
+ #include <emmintrin.h>
+#endif
+
+#if JUCE_INTEL && (JUCE_MSVC || defined (__GNUC__))
+ #define BIQUAD_BANK_AVX 1
+ #include <immintrin.h>
+ #if defined (__GNUC__)
+  #define BIQUAD_BANK_AVX_TARGET __attribute__ ((target ("avx")))
+ #else
+  #define BIQUAD_BANK_AVX_TARGET
+ #endif
+#endif
+
+#if JUCE_ARM && defined (__aarch64__)
+ #define BIQUAD_BANK_NEON 1
+ #include <arm_neon.h>
+#endif
+
+// samples of a group interleaved at once, small enough to stay in the stack and in cache
+#define BIQUAD_BANK_BLOCK_SAMPLES 256
+
+namespace
+{
+    /** Each kernel runs NumStages stages over numSamples interleaved samples of BIQUAD_BANK_LANES lanes,
+        taking every sample through all of them in turn, so that the recursions of the stages overlap
+        instead of each waiting on its own. Denormals are left to the flush-to-zero mode of the
+        processing threads, see ChannelThreadPool::disableDenormals(). */
+    typedef const double (*Coefficients)[5][BIQUAD_BANK_LANES];
+    typedef double (*States)[2][BIQUAD_BANK_LANES];
+
+    struct ScalarStages
+    {
+        template <int NumStages>
+        static void run (double* x, int numSamples, Coefficients c, States v)
+        {
+            for (int lane = 0; lane < BIQUAD_BANK_LANES; ++lane)
+            {
+                double b0[NumStages], b1[NumStages], b2[NumStages], a1[NumStages], a2[NumStages];
+                double v1[NumStages], v2[NumStages];
+
+                for (int s = 0; s < NumStages; ++s)
+                {
+                    b0[s] = c[s][0][lane]; b1[s] = c[s][1][lane]; b2[s] = c[s][2][lane];
+                    a1[s] = c[s][3][lane]; a2[s] = c[s][4][lane];
+                    v1[s] = v[s][0][lane];
+                    v2[s] = v[s][1][lane];
+                }
+
+                for (int i = 0; i < numSamples; ++i)
+                {
+                    double* sample = x + i * BIQUAD_BANK_LANES + lane;
+                    double y = *sample;
+
+                    for (int s = 0; s < NumStages; ++s)
+                    {
+                        const double w = y - a1[s] * v1[s] - a2[s] * v2[s];
+                        y = b0[s] * w + b1[s] * v1[s] + b2[s] * v2[s];
+                        v2[s] = v1[s];
+                        v1[s] = w;
+                    }
+
+                    *sample = y;
+                }
+
+                for (int s = 0; s < NumStages; ++s)
+                {
+                    v[s][0][lane] = v1[s];
+                    v[s][1][lane] = v2[s];
+                }
+            }
+        }
+    };
+
+   #if BIQUAD_BANK_SSE2
+    struct SSE2Stages
+    {
+        template <int NumStages>
+        static void run (double* x, int numSamples, Coefficients c, States v)
+        {
+            // the four lanes as two halves of two doubles
+            for (int half = 0; half < BIQUAD_BANK_LANES; half += 2)
+            {
+                __m128d b0[NumStages], b1[NumStages], b2[NumStages], a1[NumStages], a2[NumStages];
+                __m128d v1[NumStages], v2[NumStages];
+
+                for (int s = 0; s < NumStages; ++s)
+                {
+                    b0[s] = _mm_loadu_pd (c[s][0] + half);
+                    b1[s] = _mm_loadu_pd (c[s][1] + half);
+                    b2[s] = _mm_loadu_pd (c[s][2] + half);
+                    a1[s] = _mm_loadu_pd (c[s][3] + half);
+                    a2[s] = _mm_loadu_pd (c[s][4] + half);
+                    v1[s] = _mm_loadu_pd (v[s][0] + half);
+                    v2[s] = _mm_loadu_pd (v[s][1] + half);
+                }
+
+                for (int i = 0; i < numSamples; ++i)
+                {
+                    double* sample = x + i * BIQUAD_BANK_LANES + half;
+                    __m128d y = _mm_loadu_pd (sample);
+
+                    for (int s = 0; s < NumStages; ++s)
+                    {
+                        const __m128d w = _mm_sub_pd (_mm_sub_pd (y, _mm_mul_pd (a1[s], v1[s])), _mm_mul_pd (a2[s], v2[s]));
+                        y = _mm_add_pd (_mm_add_pd (_mm_mul_pd (b0[s], w), _mm_mul_pd (b1[s], v1[s])),
+                                        _mm_mul_pd (b2[s], v2[s]));
+                        v2[s] = v1[s];
+                        v1[s] = w;
+                    }
+
+                    _mm_storeu_pd (sample, y);
+                }
+
+                for (int s = 0; s < NumStages; ++s)
+                {
+                    _mm_storeu_pd (v[s][0] + half, v1[s]);
+                    _mm_storeu_pd (v[s][1] + half, v2[s]);
+                }
+            }
+        }
+    };
+   #endif
+
+   #if BIQUAD_BANK_AVX
+    struct AVXStages
+    {
+        template <int NumStages>
+        BIQUAD_BANK_AVX_TARGET
+        static void run (double* x, int numSamples, Coefficients c, States v)
+        {
+            __m256d b0[NumStages], b1[NumStages], b2[NumStages], a1[NumStages], a2[NumStages];
+            __m256d v1[NumStages], v2[NumStages];
+
+            for (int s = 0; s < NumStages; ++s)
+            {
+                b0[s] = _mm256_loadu_pd (c[s][0]);
+                b1[s] = _mm256_loadu_pd (c[s][1]);
+                b2[s] = _mm256_loadu_pd (c[s][2]);
+                a1[s] = _mm256_loadu_pd (c[s][3]);
+                a2[s] = _mm256_loadu_pd (c[s][4]);
+                v1[s] = _mm256_loadu_pd (v[s][0]);
+                v2[s] = _mm256_loadu_pd (v[s][1]);
+            }
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                double* sample = x + i * BIQUAD_BANK_LANES;
+                __m256d y = _mm256_loadu_pd (sample);
+
+                for (int s = 0; s < NumStages; ++s)
+                {
+                    const __m256d w = _mm256_sub_pd (_mm256_sub_pd (y, _mm256_mul_pd (a1[s], v1[s])),
+                                                     _mm256_mul_pd (a2[s], v2[s]));
+                    y = _mm256_add_pd (_mm256_add_pd (_mm256_mul_pd (b0[s], w), _mm256_mul_pd (b1[s], v1[s])),
+                                       _mm256_mul_pd (b2[s], v2[s]));
+                    v2[s] = v1[s];
+                    v1[s] = w;
+                }
+
+                _mm256_storeu_pd (sample, y);
+            }
+
+            for (int s = 0; s < NumStages; ++s)
+            {
+                _mm256_storeu_pd (v[s][0], v1[s]);
+                _mm256_storeu_pd (v[s][1], v2[s]);
+            }
+        }
+    };
+   #endif
+
+   #if BIQUAD_BANK_NEON
+    struct NEONStages
+    {
+        template <int NumStages>
+        static void run (double* x, int numSamples, Coefficients c, States v)
+        {
+            for (int half = 0; half < BIQUAD_BANK_LANES; half += 2)
+            {
+                float64x2_t b0[NumStages], b1[NumStages], b2[NumStages], a1[NumStages], a2[NumStages];
+                float64x2_t v1[NumStages], v2[NumStages];
+
+                for (int s = 0; s < NumStages; ++s)
+                {
+                    b0[s] = vld1q_f64 (c[s][0] + half);
+                    b1[s] = vld1q_f64 (c[s][1] + half);
+                    b2[s] = vld1q_f64 (c[s][2] + half);
+                    a1[s] = vld1q_f64 (c[s][3] + half);
+                    a2[s] = vld1q_f64 (c[s][4] + half);
+                    v1[s] = vld1q_f64 (v[s][0] + half);
+                    v2[s] = vld1q_f64 (v[s][1] + half);
+                }
+
+                for (int i = 0; i < numSamples; ++i)
+                {
+                    double* sample = x + i * BIQUAD_BANK_LANES + half;
+                    float64x2_t y = vld1q_f64 (sample);
+
+                    for (int s = 0; s < NumStages; ++s)
+                    {
+                        const float64x2_t w = vsubq_f64 (vsubq_f64 (y, vmulq_f64 (a1[s], v1[s])), vmulq_f64 (a2[s], v2[s]));
+                        y = vaddq_f64 (vaddq_f64 (vmulq_f64 (b0[s], w), vmulq_f64 (b1[s], v1[s])), vmulq_f64 (b2[s], v2[s]));
+                        v2[s] = v1[s];
+                        v1[s] = w;
+                    }
+
+                    vst1q_f64 (sample, y);
+                }
+
+                for (int s = 0; s < NumStages; ++s)
+                {
+                    vst1q_f64 (v[s][0] + half, v1[s]);
+                    vst1q_f64 (v[s][1] + half, v2[s]);
+                }
+            }
+        }
+    };
+   #endif
+
+    /** Runs the stages of a group four, then two, then one at a time, which covers the second
+        and fourth order band-passes of the Filter Node in a single pass over the block */
+    typedef void (*CascadeFunction) (double*, int, Coefficients, States, int);
+
+    template <class Stages>
+    void processCascade (double* x, int numSamples, Coefficients c, States v, int numStages)
+    {
+        int s = 0;
+
+        for (; s + 4 <= numStages; s += 4)
+            Stages::template run<4> (x, numSamples, c + s, v + s);
+
+        if (s + 2 <= numStages)
+        {
+            Stages::template run<2> (x, numSamples, c + s, v + s);
+            s += 2;
+        }
+
+        if (s < numStages)
+            Stages::template run<1> (x, numSamples, c + s, v + s);
+    }
+
+    struct Kernel
+    {
+        Kernel()
+            : function  (processCascade<ScalarStages>)
+            , name      ("scalar")
+        {
+           #if BIQUAD_BANK_NEON
+            function = processCascade<NEONStages>;
+            name = "NEON";
+           #endif
+
+           #if BIQUAD_BANK_SSE2
+            function = processCascade<SSE2Stages>;
+            name = "SSE2";
+           #endif
+
+           #if BIQUAD_BANK_AVX
+            if (SystemStats::hasAVX())
+            {
+                function = processCascade<AVXStages>;
+                name = "AVX";
+            }
+           #endif
+        }
+
+        CascadeFunction function;
+        String name;
+    };
+
+    const Kernel& getKernel()
+    {
+        static const Kernel kernel;
+        return kernel;
+    }
+}
+
+
+BiquadBank::BiquadBank()
+    : numChannels (0)
+{
+}
+
+
+BiquadBank::~BiquadBank()
+{
+}
+
+
+void BiquadBank::setNumChannels (int newNumChannels)
+{
+    numChannels = newNumChannels;
+    channels.calloc (jmax (1, numChannels));
+
+    for (int i = 0; i < numChannels; ++i)
+    {
+        channels[i].group = -1;
+        channels[i].lane = 0;
+    }
+
+    groups.clear();
+    groupsChanged = 1;
+}
+
+
+int BiquadBank::getNumChannels() const
+{
+    return numChannels;
+}
+
+
+void BiquadBank::setChannelStages (int channel, int numStages, const double (*coefficients)[5])
+{
+    if (channel < 0 || channel >= numChannels)
+        return;
+
+    Channel& c = channels[channel];
+    numStages = jlimit (0, BIQUAD_BANK_MAX_STAGES, numStages);
+
+    for (int s = 0; s < numStages; ++s)
+        for (int k = 0; k < 5; ++k)
+            c.coefficients[s][k] = coefficients[s][k];
+
+    if (numStages != c.numStages)
+    {
+        c.numStages = numStages;
+        groupsChanged = 1;
+    }
+    else if (c.group >= 0 && c.group < groups.size())
+    {
+        setLaneCoefficients (*groups[c.group], c.lane, c);
+    }
+}
+
+
+void BiquadBank::setChannelSource (int channel, uint32 sourceId)
+{
+    if (channel < 0 || channel >= numChannels || channels[channel].sourceId == sourceId)
+        return;
+
+    channels[channel].sourceId = sourceId;
+    groupsChanged = 1;
+}
+
+
+void BiquadBank::setChannelEnabled (int channel, bool enabled)
+{
+    if (channel < 0 || channel >= numChannels || channels[channel].enabled == enabled)
+        return;
+
+    channels[channel].enabled = enabled;
+    groupsChanged = 1;
+}
+
+
+void BiquadBank::setLaneCoefficients (Group& group, int lane, const Channel& channel)
+{
+    for (int s = 0; s < group.numStages; ++s)
+    {
+        for (int k = 0; k < 5; ++k)
+            group.coefficients[s][k][lane] = (s < channel.numStages) ? channel.coefficients[s][k] : 0.0;
+
+        if (s >= channel.numStages)
+            group.coefficients[s][0][lane] = 1.0;
+    }
+}
+
+
+void BiquadBank::updateGroups()
+{
+    if (! groupsChanged.compareAndSetBool (0, 1))
+        return;
+
+    // the groups hold the states while filtering
+    for (int g = 0; g < groups.size(); ++g)
+    {
+        const Group& group = *groups[g];
+
+        for (int lane = 0; lane < group.numLanes; ++lane)
+        {
+            Channel& c = channels[group.channels[lane]];
+
+            for (int s = 0; s < c.numStages; ++s)
+            {
+                c.state[s][0] = group.state[s][0][lane];
+                c.state[s][1] = group.state[s][1][lane];
+            }
+        }
+    }
+
+    groups.clear();
+
+    // each source has a group open until its lanes are all taken
+    HashMap<int, int> openGroups;
+
+    for (int i = 0; i < numChannels; ++i)
+    {
+        Channel& c = channels[i];
+        c.group = -1;
+
+        if (! c.enabled || c.numStages == 0)
+            continue;
+
+        const int key = int (c.sourceId);
+        int g = openGroups.contains (key) ? openGroups[key] : -1;
+
+        if (g < 0 || groups[g]->numLanes == BIQUAD_BANK_LANES)
+        {
+            Group* group = new Group();
+            zerostruct (*group);
+            g = groups.size();
+            groups.add (group);
+            openGroups.set (key, g);
+        }
+
+        Group& group = *groups[g];
+        c.group = g;
+        c.lane = group.numLanes;
+        group.channels[group.numLanes++] = i;
+        group.numStages = jmax (group.numStages, c.numStages);
+    }
+
+    for (int g = 0; g < groups.size(); ++g)
+    {
+        Group& group = *groups[g];
+
+        for (int lane = 0; lane < group.numLanes; ++lane)
+        {
+            const Channel& c = channels[group.channels[lane]];
+            setLaneCoefficients (group, lane, c);
+
+            for (int s = 0; s < c.numStages; ++s)
+            {
+                group.state[s][0][lane] = c.state[s][0];
+                group.state[s][1][lane] = c.state[s][1];
+            }
+        }
+
+        // lanes left over filter silence, so that they cost nothing to keep in
+        for (int lane = group.numLanes; lane < BIQUAD_BANK_LANES; ++lane)
+        {
+            for (int s = 0; s < group.numStages; ++s)
+                group.coefficients[s][0][lane] = 1.0;
+        }
+    }
+}
+
+
+int BiquadBank::getNumGroups() const
+{
+    return groups.size();
+}
+
+
+int BiquadBank::getGroupFirstChannel (int group) const
+{
+    return groups[group]->channels[0];
+}
+
+
+void BiquadBank::processGroup (int groupIndex, AudioSampleBuffer& buffer, int numSamples)
+{
+    Group& group = *groups[groupIndex];
+    const CascadeFunction processCascade = getKernel().function;
+
+    float* data[BIQUAD_BANK_LANES];
+    for (int lane = 0; lane < group.numLanes; ++lane)
+        data[lane] = buffer.getWritePointer (group.channels[lane]);
+
+    double x[BIQUAD_BANK_BLOCK_SAMPLES * BIQUAD_BANK_LANES];
+
+    for (int start = 0; start < numSamples; start += BIQUAD_BANK_BLOCK_SAMPLES)
+    {
+        const int n = jmin (BIQUAD_BANK_BLOCK_SAMPLES, numSamples - start);
+
+        for (int lane = 0; lane < BIQUAD_BANK_LANES; ++lane)
+        {
+            if (lane < group.numLanes)
+            {
+                const float* in = data[lane] + start;
+                for (int i = 0; i < n; ++i)
+                    x[i * BIQUAD_BANK_LANES + lane] = in[i];
+            }
+            else
+            {
+                for (int i = 0; i < n; ++i)
+                    x[i * BIQUAD_BANK_LANES + lane] = 0.0;
+            }
+        }
+
+        processCascade (x, n, group.coefficients, group.state, group.numStages);
+
+        for (int lane = 0; lane < group.numLanes; ++lane)
+        {
+            float* out = data[lane] + start;
+            for (int i = 0; i < n; ++i)
+                out[i] = float (x[i * BIQUAD_BANK_LANES + lane]);
+        }
+    }
+}
+
+
+String BiquadBank::getKernelName()
+{
+    return getKernel().name;
+}
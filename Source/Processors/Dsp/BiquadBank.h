@@ -0,0 +1,140 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __BIQUADBANK_H_4F1C9A28__
+#define __BIQUADBANK_H_4F1C9A28__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "../PluginManager/OpenEphysPlugin.h"
+
+/** Channels filtered together, one per SIMD lane */
+#define BIQUAD_BANK_LANES 4
+#define BIQUAD_BANK_MAX_STAGES 8
+
+
+/**
+    Filters many channels with cascades of biquads, BIQUAD_BANK_LANES channels at a time.
+
+    The recursion of a biquad is serial along a channel, but independent across channels, so
+    the channels are gathered in groups whose coefficients and states are laid out lane by lane,
+    and the stages run over a whole block of the group's interleaved samples with SSE2, AVX or
+    NEON, in double precision with the same direct form II as Dsp::DirectFormII, the common
+    cascades of two and four stages being fused into one pass. Channels in a
+    group need not share a design, only a source, so that their blocks have the same length.
+
+    Groups are formed in channel order by updateGroups(), which keeps every channel's state, so
+    only changes of source, of bypass or of the number of stages need it; new coefficients are
+    used from the next block on. Groups can be processed concurrently, each being only
+    touched by processGroup().
+
+    @see FilterNode, VectorOps
+*/
+class PLUGIN_API BiquadBank
+{
+public:
+    BiquadBank();
+    ~BiquadBank();
+
+    /** Sets the number of channels, all bypassed and with a cleared state */
+    void setNumChannels (int numChannels);
+    int getNumChannels() const;
+
+    /** Makes a channel use the given stages, each of b0, b1, b2, a1 and a2 normalized by a0 */
+    void setChannelStages (int channel, int numStages, const double (*coefficients)[5]);
+
+    /** Makes a channel use the stages of a cascade of the Dsp library, such as Dsp::Cascade */
+    template <class CascadeType>
+    void setChannelCascade (int channel, CascadeType& cascade)
+    {
+        double coefficients[BIQUAD_BANK_MAX_STAGES][5];
+        const int numStages = jmin (cascade.getNumStages(), BIQUAD_BANK_MAX_STAGES);
+
+        for (int s = 0; s < numStages; ++s)
+        {
+            const double a0 = cascade[s].getA0();
+
+            coefficients[s][0] = cascade[s].getB0() / a0;
+            coefficients[s][1] = cascade[s].getB1() / a0;
+            coefficients[s][2] = cascade[s].getB2() / a0;
+            coefficients[s][3] = cascade[s].getA1() / a0;
+            coefficients[s][4] = cascade[s].getA2() / a0;
+        }
+
+        setChannelStages (channel, numStages, coefficients);
+    }
+
+    /** Only channels of the same source are grouped together */
+    void setChannelSource (int channel, uint32 sourceId);
+
+    /** Bypassed channels are left untouched */
+    void setChannelEnabled (int channel, bool enabled);
+
+    /** Regroups the channels if their sources, bypass or stages have changed since the last call.
+        Must not be called while groups are being processed. */
+    void updateGroups();
+
+    int getNumGroups() const;
+
+    /** Returns the first channel of a group, whose number of samples the group has */
+    int getGroupFirstChannel (int group) const;
+
+    /** Filters the first numSamples samples of the group's channels in place */
+    void processGroup (int group, AudioSampleBuffer& buffer, int numSamples);
+
+    /** Returns the name of the instruction set the stages run with */
+    static String getKernelName();
+
+
+private:
+    struct Channel
+    {
+        uint32 sourceId;
+        bool enabled;
+        int numStages;
+        int group;
+        int lane;
+        double coefficients[BIQUAD_BANK_MAX_STAGES][5];   // b0, b1, b2, a1, a2, normalized by a0
+        double state[BIQUAD_BANK_MAX_STAGES][2];          // v[-1], v[-2]
+    };
+
+    struct Group
+    {
+        int channels[BIQUAD_BANK_LANES];
+        int numLanes;
+        int numStages;
+        double coefficients[BIQUAD_BANK_MAX_STAGES][5][BIQUAD_BANK_LANES];
+        double state[BIQUAD_BANK_MAX_STAGES][2][BIQUAD_BANK_LANES];
+    };
+
+    /** Copies a channel's coefficients into its lane, a missing stage letting samples through */
+    void setLaneCoefficients (Group& group, int lane, const Channel& channel);
+
+    HeapBlock<Channel> channels;
+    int numChannels;
+    OwnedArray<Group> groups;
+    Atomic<int> groupsChanged;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BiquadBank);
+};
+
+#endif  // __BIQUADBANK_H_4F1C9A28__
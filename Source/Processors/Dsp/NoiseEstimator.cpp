@@ -0,0 +1,156 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "NoiseEstimator.h"
+
+#include <cmath>
+
+namespace
+{
+    const int mantissaShift = 23 - 4;   // leaves the exponent and log2 (NOISE_ESTIMATOR_BINS_PER_OCTAVE) bits of mantissa
+    const int firstKey = (127 - 12) * NOISE_ESTIMATOR_BINS_PER_OCTAVE;
+
+    inline int getBin (float sample)
+    {
+        union { float f; uint32 i; } u;
+        u.f = sample;
+
+        const int key = (int) ((u.i & 0x7fffffff) >> mantissaShift);
+
+        return jlimit (0, NOISE_ESTIMATOR_NUM_BINS - 1, key - firstKey);
+    }
+
+    /** Returns the lowest absolute value falling into a bin */
+    inline float getBinStart (int bin)
+    {
+        if (bin <= 0)
+            return 0;
+
+        union { float f; uint32 i; } u;
+        u.i = uint32 (bin + firstKey) << mantissaShift;
+
+        return u.f;
+    }
+}
+
+static_assert ((1 << (23 - mantissaShift)) == NOISE_ESTIMATOR_BINS_PER_OCTAVE, "the bins must match the mantissa bits kept");
+
+
+NoiseEstimator::NoiseEstimator()
+{
+    setSampleRate (30000.0);
+}
+
+
+NoiseEstimator::~NoiseEstimator()
+{
+}
+
+
+void NoiseEstimator::setSampleRate (double sampleRate, int newDecimation, double timeConstant)
+{
+    decimation = jmax (1, newDecimation);
+    decay = (float) std::exp (-double (NOISE_ESTIMATOR_UPDATE_SAMPLES) * decimation / (timeConstant * sampleRate));
+
+    reset();
+}
+
+
+void NoiseEstimator::reset()
+{
+    FloatVectorOperations::clear (counts, NOISE_ESTIMATOR_NUM_BINS);
+
+    phase = 0;
+    samplesUntilUpdate = NOISE_ESTIMATOR_UPDATE_SAMPLES;
+    medianAbsoluteValue = 0;
+    ready = false;
+}
+
+
+void NoiseEstimator::pushSamples (const float* samples, int numSamples)
+{
+    int i = phase;
+
+    while (i < numSamples)
+    {
+        // the samples taken before the next update
+        const int end = jmin (numSamples, i + samplesUntilUpdate * decimation);
+
+        for (; i < end; i += decimation)
+        {
+            counts[getBin (samples[i])] += 1.0f;
+            --samplesUntilUpdate;
+        }
+
+        if (samplesUntilUpdate == 0)
+        {
+            update();
+            samplesUntilUpdate = NOISE_ESTIMATOR_UPDATE_SAMPLES;
+        }
+    }
+
+    phase = i - numSamples;
+}
+
+
+void NoiseEstimator::update()
+{
+    float total = 0;
+
+    for (int b = 0; b < NOISE_ESTIMATOR_NUM_BINS; ++b)
+        total += counts[b];
+
+    const float half = total * 0.5f;
+    float below = 0;
+    int b = 0;
+
+    while (b < NOISE_ESTIMATOR_NUM_BINS - 1 && below + counts[b] < half)
+        below += counts[b++];
+
+    // the samples of a bin are taken as spread evenly over it
+    const float fraction = (counts[b] > 0) ? (half - below) / counts[b] : 0.0f;
+    const float start = getBinStart (b);
+
+    medianAbsoluteValue = start + fraction * (getBinStart (b + 1) - start);
+    ready = true;
+
+    FloatVectorOperations::multiply (counts, decay, NOISE_ESTIMATOR_NUM_BINS);
+}
+
+
+bool NoiseEstimator::isReady() const
+{
+    return ready;
+}
+
+
+float NoiseEstimator::getMedianAbsoluteValue() const
+{
+    return medianAbsoluteValue;
+}
+
+
+float NoiseEstimator::getNoiseLevel() const
+{
+    return medianAbsoluteValue / 0.6745f;
+}
@@ -0,0 +1,95 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __NOISEESTIMATOR_H_2C6D84A1__
+#define __NOISEESTIMATOR_H_2C6D84A1__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "../PluginManager/OpenEphysPlugin.h"
+
+/** Bins of the histogram of absolute values per doubling of the value */
+#define NOISE_ESTIMATOR_BINS_PER_OCTAVE 16
+/** The histogram covers absolute values from 2^-12 to 2^17 */
+#define NOISE_ESTIMATOR_NUM_BINS (29 * NOISE_ESTIMATOR_BINS_PER_OCTAVE)
+/** Samples taken in between two updates of the estimate */
+#define NOISE_ESTIMATOR_UPDATE_SAMPLES 1024
+
+
+/**
+    Follows the noise level of a channel as median(|x|) / 0.6745, which unlike the standard
+    deviation is hardly raised by the spikes themselves.
+
+    Only one sample every few is taken, into a histogram of absolute values whose bins are
+    an equal fraction of their value apart, the bin of a sample being read from the exponent
+    and the first bits of the mantissa of its float. Every NOISE_ESTIMATOR_UPDATE_SAMPLES
+    samples taken, the counts are decayed so that older samples fade with the time constant,
+    and the median is interpolated within its bin, to about a percent. Nothing is allocated,
+    and each sample taken costs a few integer operations.
+
+    Samples are pushed by the processing thread, while the estimate can be read from any.
+
+    @see SpikeDetector, SpikeSorter
+*/
+class PLUGIN_API NoiseEstimator
+{
+public:
+    NoiseEstimator();
+    ~NoiseEstimator();
+
+    /** Takes one sample every decimation, forgets samples over timeConstant seconds and resets the estimate */
+    void setSampleRate (double sampleRate, int decimation = 4, double timeConstant = 10.0);
+
+    /** Forgets every sample */
+    void reset();
+
+    /** Takes every decimation-th sample, counting on from the previous call */
+    void pushSamples (const float* samples, int numSamples);
+
+    /** Returns true once enough samples have been taken for a first estimate */
+    bool isReady() const;
+
+    /** Returns the median of the absolute values, or 0 until ready */
+    float getMedianAbsoluteValue() const;
+
+    /** Returns median(|x|) / 0.6745, the standard deviation of gaussian noise, or 0 until ready */
+    float getNoiseLevel() const;
+
+
+private:
+    /** Decays the counts and recomputes the median */
+    void update();
+
+    float counts[NOISE_ESTIMATOR_NUM_BINS];
+    float decay;
+
+    int decimation;
+    int phase;                  // samples to skip at the start of the next block
+    int samplesUntilUpdate;
+
+    float medianAbsoluteValue;
+    bool ready;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (NoiseEstimator);
+};
+
+#endif  // __NOISEESTIMATOR_H_2C6D84A1__
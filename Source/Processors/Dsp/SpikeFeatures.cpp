@@ -0,0 +1,174 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "SpikeFeatures.h"
+#include "../Channel/InfoObjects.h"
+#include "../Events/Events.h"
+
+#if JUCE_INTEL && (defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2))
+ #define SPIKE_FEATURES_SSE 1
+ #include <emmintrin.h>
+#endif
+
+#if JUCE_ARM && defined (__aarch64__)
+ #define SPIKE_FEATURES_NEON 1
+ #include <arm_neon.h>
+#endif
+
+namespace
+{
+    /** Largest and smallest sample and sum of squares, numSamples being at least one */
+    void scanWaveform (const float* samples, int numSamples, float& peak, float& trough, float& energy)
+    {
+        int i = 0;
+        float hi = samples[0], lo = samples[0], sum = 0;
+
+       #if SPIKE_FEATURES_SSE
+        if (numSamples >= 4)
+        {
+            __m128 vhi = _mm_loadu_ps (samples);
+            __m128 vlo = vhi;
+            __m128 vsum = _mm_setzero_ps();
+
+            for (; i + 4 <= numSamples; i += 4)
+            {
+                const __m128 x = _mm_loadu_ps (samples + i);
+                vhi = _mm_max_ps (vhi, x);
+                vlo = _mm_min_ps (vlo, x);
+                vsum = _mm_add_ps (vsum, _mm_mul_ps (x, x));
+            }
+
+            vhi = _mm_max_ps (vhi, _mm_movehl_ps (vhi, vhi));
+            vhi = _mm_max_ss (vhi, _mm_shuffle_ps (vhi, vhi, 1));
+            vlo = _mm_min_ps (vlo, _mm_movehl_ps (vlo, vlo));
+            vlo = _mm_min_ss (vlo, _mm_shuffle_ps (vlo, vlo, 1));
+            vsum = _mm_add_ps (vsum, _mm_movehl_ps (vsum, vsum));
+            vsum = _mm_add_ss (vsum, _mm_shuffle_ps (vsum, vsum, 1));
+
+            hi = _mm_cvtss_f32 (vhi);
+            lo = _mm_cvtss_f32 (vlo);
+            sum = _mm_cvtss_f32 (vsum);
+        }
+       #elif SPIKE_FEATURES_NEON
+        if (numSamples >= 4)
+        {
+            float32x4_t vhi = vld1q_f32 (samples);
+            float32x4_t vlo = vhi;
+            float32x4_t vsum = vdupq_n_f32 (0);
+
+            for (; i + 4 <= numSamples; i += 4)
+            {
+                const float32x4_t x = vld1q_f32 (samples + i);
+                vhi = vmaxq_f32 (vhi, x);
+                vlo = vminq_f32 (vlo, x);
+                vsum = vmlaq_f32 (vsum, x, x);
+            }
+
+            hi = vmaxvq_f32 (vhi);
+            lo = vminvq_f32 (vlo);
+            sum = vaddvq_f32 (vsum);
+        }
+       #endif
+
+        for (; i < numSamples; ++i)
+        {
+            hi = jmax (hi, samples[i]);
+            lo = jmin (lo, samples[i]);
+            sum += samples[i] * samples[i];
+        }
+
+        peak = hi;
+        trough = lo;
+        energy = sum;
+    }
+}
+
+
+void SpikeFeatures::compute (const float* waveforms, int numChannels, int numSamples, float* features)
+{
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        const float* samples = waveforms + ch * numSamples;
+        float* f = features + ch * SPIKE_FEATURES_PER_CHANNEL;
+
+        if (numSamples <= 0)
+        {
+            f[PEAK] = f[TROUGH] = f[WIDTH] = f[ENERGY] = 0;
+            continue;
+        }
+
+        scanWaveform (samples, numSamples, f[PEAK], f[TROUGH], f[ENERGY]);
+
+        // the trough is nearly always in the first half, and what follows it is short
+        int troughIndex = 0;
+        while (samples[troughIndex] != f[TROUGH] && troughIndex < numSamples - 1)
+            ++troughIndex;
+
+        int peakAfterTrough = troughIndex;
+        for (int i = troughIndex + 1; i < numSamples; ++i)
+            if (samples[i] > samples[peakAfterTrough])
+                peakAfterTrough = i;
+
+        f[WIDTH] = float (peakAfterTrough - troughIndex);
+    }
+}
+
+
+MetaDataDescriptor* SpikeFeatures::createDescriptor (int numChannels)
+{
+    return new MetaDataDescriptor (MetaDataDescriptor::FLOAT, numChannels * SPIKE_FEATURES_PER_CHANNEL, "Features",
+                                   "Peak, trough, trough to peak width in samples and energy of each channel",
+                                   "spike.features");
+}
+
+
+MetaDataDescriptor* SpikeFeatures::createProjectionDescriptor()
+{
+    return new MetaDataDescriptor (MetaDataDescriptor::FLOAT, 2, "PC projection",
+                                   "Projections on the first two principal components", "spike.pcprojection");
+}
+
+
+int SpikeFeatures::findFeatures (const SpikeChannel* channel)
+{
+    return channel->findEventMetaData (MetaDataDescriptor::FLOAT, channel->getNumChannels() * SPIKE_FEATURES_PER_CHANNEL,
+                                       "spike.features");
+}
+
+
+int SpikeFeatures::findProjections (const SpikeChannel* channel)
+{
+    return channel->findEventMetaData (MetaDataDescriptor::FLOAT, 2, "spike.pcprojection");
+}
+
+
+const float* SpikeFeatures::getFeatures (const SpikeEvent* spike, int metaDataIndex, float* workspace)
+{
+    if (metaDataIndex >= 0 && metaDataIndex < spike->getMetadataValueCount())
+        return static_cast<const float*> (spike->getMetaDataValuePointer (metaDataIndex));
+
+    const SpikeChannel* channel = spike->getChannelInfo();
+    compute (spike->getDataPointer(), channel->getNumChannels(), channel->getTotalSamples(), workspace);
+    return workspace;
+}
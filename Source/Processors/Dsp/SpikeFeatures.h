@@ -0,0 +1,88 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef __SPIKEFEATURES_H_5A1E7C30__
+#define __SPIKEFEATURES_H_5A1E7C30__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "../PluginManager/OpenEphysPlugin.h"
+#include "../Channel/MetaData.h"
+
+class SpikeChannel;
+class SpikeEvent;
+
+/** Floats of features per channel of a spike */
+#define SPIKE_FEATURES_PER_CHANNEL 4
+
+
+/**
+    The features of a spike's waveforms most consumers look at, computed once by the processor
+    creating the spike and carried along as event metadata, so that displays, sorters and
+    record engines downstream can read them rather than scanning the waveforms again.
+
+    For each channel, in that order: the peak (largest sample), the trough (smallest sample),
+    the width in samples from the trough to the largest sample after it, and the energy, the
+    sum of the squared samples. Peak, trough and energy are found in a single pass with SSE2
+    or NEON, four samples at a time.
+
+    Spike channels carrying the features have a FLOAT metadata descriptor of identifier
+    "spike.features" and length numChannels * SPIKE_FEATURES_PER_CHANNEL. Sorters can add the
+    projections on the first two principal components under "spike.pcprojection".
+
+    @see SpikeDetector, SpikeSorter
+*/
+class PLUGIN_API SpikeFeatures
+{
+public:
+    enum Feature
+    {
+        PEAK = 0,
+        TROUGH,
+        WIDTH,
+        ENERGY
+    };
+
+    /** Computes the features of waveforms laid out one channel after the other, into
+        numChannels * SPIKE_FEATURES_PER_CHANNEL floats */
+    static void compute (const float* waveforms, int numChannels, int numSamples, float* features);
+
+    /** The descriptor to add with addEventMetaData() to a spike channel of numChannels channels */
+    static MetaDataDescriptor* createDescriptor (int numChannels);
+
+    /** The descriptor of the projections on the first two principal components */
+    static MetaDataDescriptor* createProjectionDescriptor();
+
+    /** Returns the index of the features among the event metadata of a spike channel, or -1 */
+    static int findFeatures (const SpikeChannel* channel);
+
+    /** Returns the index of the projections among the event metadata of a spike channel, or -1 */
+    static int findProjections (const SpikeChannel* channel);
+
+    /** Returns the features of a spike, read from its metadata at an index given by findFeatures(),
+        or, if the index is -1, computed again from its waveforms into workspace, which must hold
+        numChannels * SPIKE_FEATURES_PER_CHANNEL floats. Valid as long as the spike and the workspace. */
+    static const float* getFeatures (const SpikeEvent* spike, int metaDataIndex, float* workspace);
+};
+
+#endif  // __SPIKEFEATURES_H_5A1E7C30__
@@ -0,0 +1,172 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef __SPIKEWAVEFORM_H_3C8F1D52__
+#define __SPIKEWAVEFORM_H_3C8F1D52__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+/** Samples per channel of the common spike shapes: 8 before the peak and 32 after it */
+#define SPIKE_WAVEFORM_COMMON_SAMPLES 40
+
+
+/**
+    The waveforms of a spike of a shape known at compile time, laid out one channel after the
+    other as in SpikeEvent, and the loops spike processors run over them.
+
+    With every size a constant, the loops below have fixed trip counts the compiler unrolls,
+    and their sums are kept in four independent lanes, which it can vectorize without having
+    to reorder additions. Processors reach them through visitCommonSpikeShape(), for the
+    single electrodes, stereotrodes and tetrodes of SPIKE_WAVEFORM_COMMON_SAMPLES samples, and
+    keep their runtime-sized code for any other shape.
+
+    @see visitCommonSpikeShape, SpikeFeatures
+*/
+template <int NumChannels, int NumSamples>
+class SpikeWaveform
+{
+public:
+    static const int numChannels = NumChannels;
+    static const int numSamples = NumSamples;
+    static const int numValues = NumChannels * NumSamples;
+
+    float* getData() noexcept                               { return data; }
+    const float* getData() const noexcept                   { return data; }
+
+    float* getChannel (int channel) noexcept                { return data + channel * NumSamples; }
+    const float* getChannel (int channel) const noexcept    { return data + channel * NumSamples; }
+
+    /** Copies NumSamples samples of each channel from sources[channel] + start, a null
+        source leaving its channel flat */
+    void extract (const float* const* sources, int start) noexcept
+    {
+        for (int channel = 0; channel < NumChannels; ++channel)
+        {
+            float* const dest = data + channel * NumSamples;
+
+            if (sources[channel] != nullptr)
+            {
+                const float* const source = sources[channel] + start;
+
+                for (int i = 0; i < NumSamples; ++i)
+                    dest[i] = source[i];
+            }
+            else
+            {
+                for (int i = 0; i < NumSamples; ++i)
+                    dest[i] = 0;
+            }
+        }
+    }
+
+    /** Dot product of two waveforms of this shape */
+    static float dot (const float* a, const float* b) noexcept
+    {
+        float sum[4] = { 0, 0, 0, 0 };
+        int k = 0;
+
+        for (; k + 4 <= numValues; k += 4)
+            for (int lane = 0; lane < 4; ++lane)
+                sum[lane] += a[k + lane] * b[k + lane];
+
+        for (; k < numValues; ++k)
+            sum[0] += a[k] * b[k];
+
+        return (sum[0] + sum[2]) + (sum[1] + sum[3]);
+    }
+
+    /** Projections of a waveform on two others, as on the first two principal components */
+    static void project (const float* x, const float* pc1, const float* pc2, float& p1, float& p2) noexcept
+    {
+        float sum1[4] = { 0, 0, 0, 0 };
+        float sum2[4] = { 0, 0, 0, 0 };
+        int k = 0;
+
+        for (; k + 4 <= numValues; k += 4)
+        {
+            for (int lane = 0; lane < 4; ++lane)
+            {
+                sum1[lane] += pc1[k + lane] * x[k + lane];
+                sum2[lane] += pc2[k + lane] * x[k + lane];
+            }
+        }
+
+        for (; k < numValues; ++k)
+        {
+            sum1[0] += pc1[k] * x[k];
+            sum2[0] += pc2[k] * x[k];
+        }
+
+        p1 = (sum1[0] + sum1[2]) + (sum1[1] + sum1[3]);
+        p2 = (sum2[0] + sum2[2]) + (sum2[1] + sum2[3]);
+    }
+
+    /** Returns true if the samples from..to of a channel, both included, all lie above high or
+        all lie below low, in which case no line through them meets a box spanning low..high */
+    static bool isOutsideRange (const float* x, int channel, int from, int to, float low, float high) noexcept
+    {
+        const float* const samples = x + channel * NumSamples;
+        from = jlimit (0, NumSamples - 1, from);
+        to = jlimit (0, NumSamples - 1, to);
+
+        float min = samples[from];
+        float max = samples[from];
+
+        for (int i = from + 1; i <= to; ++i)
+        {
+            min = jmin (min, samples[i]);
+            max = jmax (max, samples[i]);
+        }
+
+        return min > high || max < low;
+    }
+
+private:
+    float data[numValues];
+};
+
+
+/**
+    Calls visitor.template visit<NumChannels, NumSamples>() and returns true if the shape is
+    one of the common ones SpikeWaveform is compiled for, or returns false for the caller to
+    fall back to its runtime-sized code.
+
+    @see SpikeWaveform
+*/
+template <typename Visitor>
+inline bool visitCommonSpikeShape (int numChannels, int numSamples, Visitor& visitor)
+{
+    if (numSamples != SPIKE_WAVEFORM_COMMON_SAMPLES)
+        return false;
+
+    switch (numChannels)
+    {
+        case 1: visitor.template visit<1, SPIKE_WAVEFORM_COMMON_SAMPLES>(); return true;
+        case 2: visitor.template visit<2, SPIKE_WAVEFORM_COMMON_SAMPLES>(); return true;
+        case 4: visitor.template visit<4, SPIKE_WAVEFORM_COMMON_SAMPLES>(); return true;
+        default: return false;
+    }
+}
+
+#endif  // __SPIKEWAVEFORM_H_3C8F1D52__
@@ -0,0 +1,270 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "ThresholdDetector.h"
+
+#include <cmath>
+#include <limits>
+
+#if JUCE_INTEL && (defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2))
+ #define THRESHOLD_DETECTOR_SSE 1
+ #include <emmintrin.h>
+#endif
+
+#if JUCE_ARM && defined (__aarch64__)
+ #define THRESHOLD_DETECTOR_NEON 1
+ #include <arm_neon.h>
+#endif
+
+namespace
+{
+    template <bool above>
+    inline bool crosses (float sample, float threshold)
+    {
+        return above ? (sample > threshold) : (sample < threshold);
+    }
+
+    template <bool above>
+    int findFirst (const float* samples, int start, int end, float threshold)
+    {
+        int i = start;
+
+       #if THRESHOLD_DETECTOR_SSE
+        const __m128 t = _mm_set1_ps (threshold);
+
+        // sixteen samples are tested per branch, the lanes of a hit being searched afterwards
+        for (; i + 16 <= end; i += 16)
+        {
+            const float* s = samples + i;
+            __m128 m0, m1, m2, m3;
+
+            if (above)
+            {
+                m0 = _mm_cmpgt_ps (_mm_loadu_ps (s), t);
+                m1 = _mm_cmpgt_ps (_mm_loadu_ps (s + 4), t);
+                m2 = _mm_cmpgt_ps (_mm_loadu_ps (s + 8), t);
+                m3 = _mm_cmpgt_ps (_mm_loadu_ps (s + 12), t);
+            }
+            else
+            {
+                m0 = _mm_cmplt_ps (_mm_loadu_ps (s), t);
+                m1 = _mm_cmplt_ps (_mm_loadu_ps (s + 4), t);
+                m2 = _mm_cmplt_ps (_mm_loadu_ps (s + 8), t);
+                m3 = _mm_cmplt_ps (_mm_loadu_ps (s + 12), t);
+            }
+
+            if (_mm_movemask_ps (_mm_or_ps (_mm_or_ps (m0, m1), _mm_or_ps (m2, m3))) != 0)
+                break;
+        }
+       #elif THRESHOLD_DETECTOR_NEON
+        const float32x4_t t = vdupq_n_f32 (threshold);
+
+        for (; i + 16 <= end; i += 16)
+        {
+            const float* s = samples + i;
+            uint32x4_t m0, m1, m2, m3;
+
+            if (above)
+            {
+                m0 = vcgtq_f32 (vld1q_f32 (s), t);
+                m1 = vcgtq_f32 (vld1q_f32 (s + 4), t);
+                m2 = vcgtq_f32 (vld1q_f32 (s + 8), t);
+                m3 = vcgtq_f32 (vld1q_f32 (s + 12), t);
+            }
+            else
+            {
+                m0 = vcltq_f32 (vld1q_f32 (s), t);
+                m1 = vcltq_f32 (vld1q_f32 (s + 4), t);
+                m2 = vcltq_f32 (vld1q_f32 (s + 8), t);
+                m3 = vcltq_f32 (vld1q_f32 (s + 12), t);
+            }
+
+            if (vmaxvq_u32 (vorrq_u32 (vorrq_u32 (m0, m1), vorrq_u32 (m2, m3))) != 0)
+                break;
+        }
+       #endif
+
+        for (; i < end; ++i)
+            if (crosses<above> (samples[i], threshold))
+                return i;
+
+        return end;
+    }
+}
+
+
+ThresholdDetector::ThresholdDetector()
+    : numChannels (0)
+{
+}
+
+
+ThresholdDetector::~ThresholdDetector()
+{
+}
+
+
+void ThresholdDetector::setNumChannels (int newNumChannels)
+{
+    if (newNumChannels != numChannels)
+    {
+        numChannels = newNumChannels;
+        channels.malloc (jmax (1, numChannels));
+    }
+
+    for (int i = 0; i < numChannels; ++i)
+        channels[i].enabled = false;
+}
+
+
+int ThresholdDetector::getNumChannels() const
+{
+    return numChannels;
+}
+
+
+void ThresholdDetector::setChannel (int channel, const float* previous, int numPrevious, const float* samples, int numSamples,
+                                    double threshold, Direction direction)
+{
+    jassert (isPositiveAndBelow (channel, numChannels));
+
+    Channel& c = channels[channel];
+
+    // the float whose comparisons to floats match those to the double threshold
+    float t = (float) threshold;
+
+    if (direction == ABOVE && (double) t > threshold)
+        t = std::nextafter (t, -std::numeric_limits<float>::infinity());
+    else if (direction == BELOW && (double) t < threshold)
+        t = std::nextafter (t, std::numeric_limits<float>::infinity());
+
+    c.previous = previous + numPrevious;
+    c.numPrevious = numPrevious;
+    c.samples = samples;
+    c.numSamples = numSamples;
+    c.threshold = t;
+    c.direction = direction;
+    c.zeroCrosses = (direction == ABOVE) ? (0 > threshold) : (0 < threshold);
+    c.enabled = true;
+
+    c.searchedFrom = std::numeric_limits<int>::max();
+    c.searchedTo = 0;
+    c.nextCrossing = 0;
+}
+
+
+void ThresholdDetector::disableChannel (int channel)
+{
+    jassert (isPositiveAndBelow (channel, numChannels));
+
+    channels[channel].enabled = false;
+}
+
+
+int ThresholdDetector::findFirstCrossing (const float* samples, int start, int end, float threshold, Direction direction)
+{
+    if (direction == ABOVE)
+        return findFirst<true> (samples, start, end, threshold);
+    else
+        return findFirst<false> (samples, start, end, threshold);
+}
+
+
+int ThresholdDetector::searchChannel (const Channel& c, int start, int last)
+{
+    const int end = last + 1;
+    int i = start;
+
+    if (i >= end)
+        return end;
+
+    // before the previous samples
+    if (i < -c.numPrevious)
+    {
+        if (c.zeroCrosses)
+            return i;
+
+        i = jmin (-c.numPrevious, end);
+    }
+
+    // the end of the previous block
+    if (i < 0)
+    {
+        const int segmentEnd = jmin (0, end);
+        const int found = findFirstCrossing (c.previous, i, segmentEnd, c.threshold, c.direction);
+
+        if (found < segmentEnd)
+            return found;
+
+        i = segmentEnd;
+    }
+
+    // this block
+    if (i < c.numSamples)
+    {
+        const int segmentEnd = jmin (c.numSamples, end);
+        const int found = findFirstCrossing (c.samples, i, segmentEnd, c.threshold, c.direction);
+
+        if (found < segmentEnd)
+            return found;
+
+        i = segmentEnd;
+    }
+
+    // past the end of the block
+    if (i < end && c.zeroCrosses)
+        return i;
+
+    return end;
+}
+
+
+bool ThresholdDetector::findNextCrossing (int start, int last, int& index, int& channel)
+{
+    index = last + 1;
+    channel = -1;
+
+    for (int i = 0; i < numChannels; ++i)
+    {
+        Channel& c = channels[i];
+
+        if (! c.enabled)
+            continue;
+
+        if (c.searchedTo != last || start < c.searchedFrom || start > c.nextCrossing)
+        {
+            c.nextCrossing = searchChannel (c, start, last);
+            c.searchedFrom = start;
+            c.searchedTo = last;
+        }
+
+        // a later channel only wins with a strictly earlier crossing
+        if (c.nextCrossing < index)
+        {
+            index = c.nextCrossing;
+            channel = i;
+        }
+    }
+
+    return channel >= 0;
+}
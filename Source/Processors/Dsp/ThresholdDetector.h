@@ -0,0 +1,106 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __THRESHOLDDETECTOR_H_7B3E19D4__
+#define __THRESHOLDDETECTOR_H_7B3E19D4__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "../PluginManager/OpenEphysPlugin.h"
+
+
+/**
+    Finds where the channels of an electrode first cross their thresholds, for spike detectors.
+
+    Crossings are rare, so rather than testing one sample of one channel at a time, each channel
+    is searched on its own through whole runs of samples, four thresholds comparisons at a time
+    with SSE2 or NEON, and the detector only stops at the candidates. The earliest crossing over
+    all the channels is returned, ties going to the lowest channel as when the channels of each
+    sample are tested in turn; the peak and the waveform are then read around it as before.
+
+    Sample indices are those of the current block, negative ones reading the end of the
+    previous block and samples past either end reading as zero. Each channel's next crossing
+    is kept until the search moves past it, so a channel is only scanned once per block
+    however many spikes are found on the others.
+
+    @see SpikeDetector, SpikeSorter
+*/
+class PLUGIN_API ThresholdDetector
+{
+public:
+    ThresholdDetector();
+    ~ThresholdDetector();
+
+    enum Direction
+    {
+        ABOVE = 0,      // samples greater than the threshold cross it
+        BELOW           // samples less than the threshold cross it
+    };
+
+    /** Sets the number of channels, none of them searched until setChannel() is called */
+    void setNumChannels (int numChannels);
+    int getNumChannels() const;
+
+    /** Gives a channel its samples for the block: numPrevious samples ending with the one before
+        index 0, then numSamples from index 0 on. The threshold is compared to samples exactly as
+        a double would be. */
+    void setChannel (int channel, const float* previous, int numPrevious, const float* samples, int numSamples,
+                     double threshold, Direction direction);
+
+    /** Leaves a channel out of the search until setChannel() is called again */
+    void disableChannel (int channel);
+
+    /** Looks for the earliest crossing at an index from start to last included. Returns false if
+        there is none, and otherwise its index and channel. */
+    bool findNextCrossing (int start, int last, int& index, int& channel);
+
+    /** Returns the index of the first sample of samples[start..end) crossing the threshold, or end */
+    static int findFirstCrossing (const float* samples, int start, int end, float threshold, Direction direction);
+
+
+private:
+    struct Channel
+    {
+        const float* previous;      // points to index 0, so that previous[-1] precedes the block
+        int numPrevious;
+        const float* samples;
+        int numSamples;
+        float threshold;
+        Direction direction;
+        bool zeroCrosses;           // whether the zeros past the ends of the samples cross
+        bool enabled;
+
+        int searchedFrom;           // the next crossing is known for starts from here...
+        int searchedTo;             // ...to here, included
+        int nextCrossing;           // searchedTo + 1 if none
+    };
+
+    /** Returns the first crossing of a channel at an index from start to last, or last + 1 */
+    static int searchChannel (const Channel& channel, int start, int last);
+
+    HeapBlock<Channel> channels;
+    int numChannels;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ThresholdDetector);
+};
+
+#endif  // __THRESHOLDDETECTOR_H_7B3E19D4__
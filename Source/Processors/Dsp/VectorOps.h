@@ -0,0 +1,578 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef __VECTOROPS_H_6D2B7E91__
+#define __VECTOROPS_H_6D2B7E91__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+#if JUCE_INTEL && (defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2))
+ #define VECTOR_OPS_SSE2 1
+ #include <emmintrin.h>
+#endif
+
+#if JUCE_INTEL && (JUCE_MSVC || defined (__GNUC__))
+ #define VECTOR_OPS_AVX 1
+ #include <immintrin.h>
+ #if defined (__GNUC__)
+  #define VECTOR_OPS_AVX_TARGET __attribute__ ((target ("avx")))
+ #else
+  #define VECTOR_OPS_AVX_TARGET
+ #endif
+#endif
+
+#if JUCE_ARM && defined (__aarch64__)
+ #define VECTOR_OPS_NEON 1
+ #include <arm_neon.h>
+#endif
+
+// samples de-interleaved for every channel before moving on, so that their input stays in cache
+#define VECTOR_OPS_DEINTERLEAVE_BLOCK_SAMPLES 256
+
+
+/**
+    The sample loops the core runs over whole blocks, shared with plugins through VectorLib.h.
+
+    Everything is in this header, so that a plugin gets the same code as the core without
+    linking to it. Each kernel is written with SSE2 or NEON, whichever the build targets, and
+    those which gain from wider registers also with AVX, which is chosen once at run time if the
+    CPU has it, see getKernelName(). Results are the same whichever kernel runs, the sums of
+    means aside, which may be added up in a different order.
+
+    @see BiquadBank, ThresholdDetector
+*/
+namespace VectorOps
+{
+    //==============================================================================
+    namespace Kernels
+    {
+        typedef void (*ToInt16Function) (const float*, int16*, float, int);
+        typedef void (*ToFloatFunction) (const int16*, float*, float, int);
+        typedef void (*MinMaxMeanFunction) (const float*, int, int, float*, float*, float*);
+
+        inline void convertFloatToInt16Scalar (const float* src, int16* dest, float scale, int numSamples)
+        {
+            for (int i = 0; i < numSamples; ++i)
+                dest[i] = (int16) roundToInt (jlimit (-32767.0f, 32767.0f, src[i] * scale));
+        }
+
+        inline void convertInt16ToFloatScalar (const int16* src, float* dest, float scale, int numSamples)
+        {
+            for (int i = 0; i < numSamples; ++i)
+                dest[i] = src[i] * scale;
+        }
+
+        /** Takes samples from..to of x, to excluded, into a bucket's extremes and sum */
+        inline void accumulateMinMaxSum (const float* x, int from, int to, float& min, float& max, float& sum)
+        {
+            for (int i = from; i < to; ++i)
+            {
+                min = jmin (min, x[i]);
+                max = jmax (max, x[i]);
+                sum += x[i];
+            }
+        }
+
+        inline void storeBucket (int bucket, int factor, float min, float max, float sum,
+                                 float* mins, float* maxs, float* means)
+        {
+            mins[bucket] = min;
+            maxs[bucket] = max;
+
+            if (means != nullptr)
+                means[bucket] = sum / factor;
+        }
+
+        inline void decimateMinMaxMeanScalar (const float* src, int numBuckets, int factor,
+                                              float* mins, float* maxs, float* means)
+        {
+            for (int b = 0; b < numBuckets; ++b)
+            {
+                const float* x = src + b * factor;
+                float min = x[0], max = x[0], sum = 0;
+                accumulateMinMaxSum (x, 0, factor, min, max, sum);
+                storeBucket (b, factor, min, max, sum, mins, maxs, means);
+            }
+        }
+
+       #if VECTOR_OPS_SSE2
+        inline void convertFloatToInt16SSE2 (const float* src, int16* dest, float scale, int numSamples)
+        {
+            const __m128 scaleVec = _mm_set1_ps (scale);
+            const __m128 maxVec = _mm_set1_ps (32767.0f);
+            const __m128 minVec = _mm_set1_ps (-32767.0f);
+            int i = 0;
+
+            for (; i + 8 <= numSamples; i += 8)
+            {
+                const __m128 a = _mm_min_ps (maxVec, _mm_max_ps (minVec, _mm_mul_ps (_mm_loadu_ps (src + i), scaleVec)));
+                const __m128 b = _mm_min_ps (maxVec, _mm_max_ps (minVec, _mm_mul_ps (_mm_loadu_ps (src + i + 4), scaleVec)));
+                // rounds to nearest, like roundToInt
+                _mm_storeu_si128 ((__m128i*) (dest + i), _mm_packs_epi32 (_mm_cvtps_epi32 (a), _mm_cvtps_epi32 (b)));
+            }
+
+            convertFloatToInt16Scalar (src + i, dest + i, scale, numSamples - i);
+        }
+
+        /** Scales the 8 int16 of a register into dest */
+        inline void convertInt16x8 (__m128i x, float* dest, __m128 scale)
+        {
+            // sign-extends the int16 by shifting them down from the top of each 32-bit lane
+            const __m128i lo = _mm_srai_epi32 (_mm_unpacklo_epi16 (x, x), 16);
+            const __m128i hi = _mm_srai_epi32 (_mm_unpackhi_epi16 (x, x), 16);
+            _mm_storeu_ps (dest,     _mm_mul_ps (_mm_cvtepi32_ps (lo), scale));
+            _mm_storeu_ps (dest + 4, _mm_mul_ps (_mm_cvtepi32_ps (hi), scale));
+        }
+
+        inline void convertInt16ToFloatSSE2 (const int16* src, float* dest, float scale, int numSamples)
+        {
+            const __m128 scaleVec = _mm_set1_ps (scale);
+            int i = 0;
+
+            for (; i + 8 <= numSamples; i += 8)
+                convertInt16x8 (_mm_loadu_si128 ((const __m128i*) (src + i)), dest + i, scaleVec);
+
+            convertInt16ToFloatScalar (src + i, dest + i, scale, numSamples - i);
+        }
+
+        inline void decimateMinMaxMeanSSE2 (const float* src, int numBuckets, int factor,
+                                            float* mins, float* maxs, float* means)
+        {
+            for (int b = 0; b < numBuckets; ++b)
+            {
+                const float* x = src + b * factor;
+                float min = x[0], max = x[0], sum = 0;
+                int i = 0;
+
+                if (factor >= 8)
+                {
+                    __m128 vmin = _mm_loadu_ps (x);
+                    __m128 vmax = vmin;
+                    __m128 vsum = vmin;
+
+                    for (i = 4; i + 4 <= factor; i += 4)
+                    {
+                        const __m128 v = _mm_loadu_ps (x + i);
+                        vmin = _mm_min_ps (vmin, v);
+                        vmax = _mm_max_ps (vmax, v);
+                        vsum = _mm_add_ps (vsum, v);
+                    }
+
+                    float lanes[3][4];
+                    _mm_storeu_ps (lanes[0], vmin);
+                    _mm_storeu_ps (lanes[1], vmax);
+                    _mm_storeu_ps (lanes[2], vsum);
+
+                    min = jmin (jmin (lanes[0][0], lanes[0][1]), jmin (lanes[0][2], lanes[0][3]));
+                    max = jmax (jmax (lanes[1][0], lanes[1][1]), jmax (lanes[1][2], lanes[1][3]));
+                    sum = (lanes[2][0] + lanes[2][2]) + (lanes[2][1] + lanes[2][3]);
+                }
+
+                accumulateMinMaxSum (x, i, factor, min, max, sum);
+                storeBucket (b, factor, min, max, sum, mins, maxs, means);
+            }
+        }
+
+        /** Copies an 8x8 tile of samples, one row per channel, into the interleaved destination */
+        inline void interleaveTile (int16* dst, const int16* const* src, int srcOffset, int numChannels)
+        {
+            __m128i r[8];
+            for (int c = 0; c < 8; ++c)
+                r[c] = _mm_loadu_si128 ((const __m128i*) (src[c] + srcOffset));
+
+            // pairs of channels, sample by sample
+            const __m128i a0 = _mm_unpacklo_epi16 (r[0], r[1]);
+            const __m128i a1 = _mm_unpackhi_epi16 (r[0], r[1]);
+            const __m128i a2 = _mm_unpacklo_epi16 (r[2], r[3]);
+            const __m128i a3 = _mm_unpackhi_epi16 (r[2], r[3]);
+            const __m128i a4 = _mm_unpacklo_epi16 (r[4], r[5]);
+            const __m128i a5 = _mm_unpackhi_epi16 (r[4], r[5]);
+            const __m128i a6 = _mm_unpacklo_epi16 (r[6], r[7]);
+            const __m128i a7 = _mm_unpackhi_epi16 (r[6], r[7]);
+
+            // groups of four channels, two samples each
+            const __m128i b0 = _mm_unpacklo_epi32 (a0, a2);
+            const __m128i b1 = _mm_unpackhi_epi32 (a0, a2);
+            const __m128i b2 = _mm_unpacklo_epi32 (a1, a3);
+            const __m128i b3 = _mm_unpackhi_epi32 (a1, a3);
+            const __m128i b4 = _mm_unpacklo_epi32 (a4, a6);
+            const __m128i b5 = _mm_unpackhi_epi32 (a4, a6);
+            const __m128i b6 = _mm_unpacklo_epi32 (a5, a7);
+            const __m128i b7 = _mm_unpackhi_epi32 (a5, a7);
+
+            _mm_storeu_si128 ((__m128i*) (dst),                   _mm_unpacklo_epi64 (b0, b4));
+            _mm_storeu_si128 ((__m128i*) (dst + numChannels),     _mm_unpackhi_epi64 (b0, b4));
+            _mm_storeu_si128 ((__m128i*) (dst + 2 * numChannels), _mm_unpacklo_epi64 (b1, b5));
+            _mm_storeu_si128 ((__m128i*) (dst + 3 * numChannels), _mm_unpackhi_epi64 (b1, b5));
+            _mm_storeu_si128 ((__m128i*) (dst + 4 * numChannels), _mm_unpacklo_epi64 (b2, b6));
+            _mm_storeu_si128 ((__m128i*) (dst + 5 * numChannels), _mm_unpackhi_epi64 (b2, b6));
+            _mm_storeu_si128 ((__m128i*) (dst + 6 * numChannels), _mm_unpacklo_epi64 (b3, b7));
+            _mm_storeu_si128 ((__m128i*) (dst + 7 * numChannels), _mm_unpackhi_epi64 (b3, b7));
+        }
+
+        /** Transposes the 8 channels by 8 samples starting at source, rows being stride samples apart,
+            scaling channel c by scales[c] into dest[c] + offset */
+        inline void deinterleaveTile (const int16* source, int stride, float* const* dest, const float* scales, int64 offset)
+        {
+            __m128i r[8];
+            for (int i = 0; i < 8; ++i)
+                r[i] = _mm_loadu_si128 ((const __m128i*) (source + i * stride));
+
+            const __m128i t0 = _mm_unpacklo_epi16 (r[0], r[1]);
+            const __m128i t1 = _mm_unpackhi_epi16 (r[0], r[1]);
+            const __m128i t2 = _mm_unpacklo_epi16 (r[2], r[3]);
+            const __m128i t3 = _mm_unpackhi_epi16 (r[2], r[3]);
+            const __m128i t4 = _mm_unpacklo_epi16 (r[4], r[5]);
+            const __m128i t5 = _mm_unpackhi_epi16 (r[4], r[5]);
+            const __m128i t6 = _mm_unpacklo_epi16 (r[6], r[7]);
+            const __m128i t7 = _mm_unpackhi_epi16 (r[6], r[7]);
+
+            const __m128i u0 = _mm_unpacklo_epi32 (t0, t2);
+            const __m128i u1 = _mm_unpackhi_epi32 (t0, t2);
+            const __m128i u2 = _mm_unpacklo_epi32 (t1, t3);
+            const __m128i u3 = _mm_unpackhi_epi32 (t1, t3);
+            const __m128i u4 = _mm_unpacklo_epi32 (t4, t6);
+            const __m128i u5 = _mm_unpackhi_epi32 (t4, t6);
+            const __m128i u6 = _mm_unpacklo_epi32 (t5, t7);
+            const __m128i u7 = _mm_unpackhi_epi32 (t5, t7);
+
+            convertInt16x8 (_mm_unpacklo_epi64 (u0, u4), dest[0] + offset, _mm_set1_ps (scales[0]));
+            convertInt16x8 (_mm_unpackhi_epi64 (u0, u4), dest[1] + offset, _mm_set1_ps (scales[1]));
+            convertInt16x8 (_mm_unpacklo_epi64 (u1, u5), dest[2] + offset, _mm_set1_ps (scales[2]));
+            convertInt16x8 (_mm_unpackhi_epi64 (u1, u5), dest[3] + offset, _mm_set1_ps (scales[3]));
+            convertInt16x8 (_mm_unpacklo_epi64 (u2, u6), dest[4] + offset, _mm_set1_ps (scales[4]));
+            convertInt16x8 (_mm_unpackhi_epi64 (u2, u6), dest[5] + offset, _mm_set1_ps (scales[5]));
+            convertInt16x8 (_mm_unpacklo_epi64 (u3, u7), dest[6] + offset, _mm_set1_ps (scales[6]));
+            convertInt16x8 (_mm_unpackhi_epi64 (u3, u7), dest[7] + offset, _mm_set1_ps (scales[7]));
+        }
+       #endif
+
+       #if VECTOR_OPS_AVX
+        VECTOR_OPS_AVX_TARGET inline void convertFloatToInt16AVX (const float* src, int16* dest, float scale, int numSamples)
+        {
+            const __m256 scaleVec = _mm256_set1_ps (scale);
+            const __m256 maxVec = _mm256_set1_ps (32767.0f);
+            const __m256 minVec = _mm256_set1_ps (-32767.0f);
+            int i = 0;
+
+            for (; i + 8 <= numSamples; i += 8)
+            {
+                const __m256 x = _mm256_min_ps (maxVec, _mm256_max_ps (minVec, _mm256_mul_ps (_mm256_loadu_ps (src + i), scaleVec)));
+                const __m256i rounded = _mm256_cvtps_epi32 (x);
+                _mm_storeu_si128 ((__m128i*) (dest + i), _mm_packs_epi32 (_mm256_castsi256_si128 (rounded),
+                                                                          _mm256_extractf128_si256 (rounded, 1)));
+            }
+
+            for (; i < numSamples; ++i)
+                dest[i] = (int16) roundToInt (jlimit (-32767.0f, 32767.0f, src[i] * scale));
+        }
+
+        VECTOR_OPS_AVX_TARGET inline void convertInt16ToFloatAVX (const int16* src, float* dest, float scale, int numSamples)
+        {
+            const __m256 scaleVec = _mm256_set1_ps (scale);
+            int i = 0;
+
+            for (; i + 8 <= numSamples; i += 8)
+            {
+                const __m128i x = _mm_loadu_si128 ((const __m128i*) (src + i));
+                const __m256i wide = _mm256_insertf128_si256 (_mm256_castsi128_si256 (_mm_cvtepi16_epi32 (x)),
+                                                              _mm_cvtepi16_epi32 (_mm_srli_si128 (x, 8)), 1);
+                _mm256_storeu_ps (dest + i, _mm256_mul_ps (_mm256_cvtepi32_ps (wide), scaleVec));
+            }
+
+            for (; i < numSamples; ++i)
+                dest[i] = src[i] * scale;
+        }
+
+        VECTOR_OPS_AVX_TARGET inline void decimateMinMaxMeanAVX (const float* src, int numBuckets, int factor,
+                                                                 float* mins, float* maxs, float* means)
+        {
+            for (int b = 0; b < numBuckets; ++b)
+            {
+                const float* x = src + b * factor;
+                float min = x[0], max = x[0], sum = 0;
+                int i = 0;
+
+                if (factor >= 16)
+                {
+                    __m256 vmin = _mm256_loadu_ps (x);
+                    __m256 vmax = vmin;
+                    __m256 vsum = vmin;
+
+                    for (i = 8; i + 8 <= factor; i += 8)
+                    {
+                        const __m256 v = _mm256_loadu_ps (x + i);
+                        vmin = _mm256_min_ps (vmin, v);
+                        vmax = _mm256_max_ps (vmax, v);
+                        vsum = _mm256_add_ps (vsum, v);
+                    }
+
+                    float lanes[3][8];
+                    _mm256_storeu_ps (lanes[0], vmin);
+                    _mm256_storeu_ps (lanes[1], vmax);
+                    _mm256_storeu_ps (lanes[2], vsum);
+
+                    min = lanes[0][0];
+                    max = lanes[1][0];
+                    sum = 0;
+
+                    for (int lane = 0; lane < 8; ++lane)
+                    {
+                        min = jmin (min, lanes[0][lane]);
+                        max = jmax (max, lanes[1][lane]);
+                        sum += lanes[2][lane];
+                    }
+                }
+
+                for (; i < factor; ++i)
+                {
+                    min = jmin (min, x[i]);
+                    max = jmax (max, x[i]);
+                    sum += x[i];
+                }
+
+                mins[b] = min;
+                maxs[b] = max;
+
+                if (means != nullptr)
+                    means[b] = sum / factor;
+            }
+        }
+       #endif
+
+       #if VECTOR_OPS_NEON
+        inline void convertFloatToInt16NEON (const float* src, int16* dest, float scale, int numSamples)
+        {
+            const float32x4_t maxVec = vdupq_n_f32 (32767.0f);
+            const float32x4_t minVec = vdupq_n_f32 (-32767.0f);
+            int i = 0;
+
+            for (; i + 8 <= numSamples; i += 8)
+            {
+                const float32x4_t a = vminq_f32 (maxVec, vmaxq_f32 (minVec, vmulq_n_f32 (vld1q_f32 (src + i), scale)));
+                const float32x4_t b = vminq_f32 (maxVec, vmaxq_f32 (minVec, vmulq_n_f32 (vld1q_f32 (src + i + 4), scale)));
+                // rounds to nearest, like roundToInt
+                vst1q_s16 (dest + i, vcombine_s16 (vqmovn_s32 (vcvtnq_s32_f32 (a)), vqmovn_s32 (vcvtnq_s32_f32 (b))));
+            }
+
+            convertFloatToInt16Scalar (src + i, dest + i, scale, numSamples - i);
+        }
+
+        inline void convertInt16ToFloatNEON (const int16* src, float* dest, float scale, int numSamples)
+        {
+            int i = 0;
+
+            for (; i + 8 <= numSamples; i += 8)
+            {
+                const int16x8_t x = vld1q_s16 (src + i);
+                vst1q_f32 (dest + i,     vmulq_n_f32 (vcvtq_f32_s32 (vmovl_s16 (vget_low_s16 (x))), scale));
+                vst1q_f32 (dest + i + 4, vmulq_n_f32 (vcvtq_f32_s32 (vmovl_s16 (vget_high_s16 (x))), scale));
+            }
+
+            convertInt16ToFloatScalar (src + i, dest + i, scale, numSamples - i);
+        }
+
+        inline void decimateMinMaxMeanNEON (const float* src, int numBuckets, int factor,
+                                            float* mins, float* maxs, float* means)
+        {
+            for (int b = 0; b < numBuckets; ++b)
+            {
+                const float* x = src + b * factor;
+                float min = x[0], max = x[0], sum = 0;
+                int i = 0;
+
+                if (factor >= 8)
+                {
+                    float32x4_t vmin = vld1q_f32 (x);
+                    float32x4_t vmax = vmin;
+                    float32x4_t vsum = vmin;
+
+                    for (i = 4; i + 4 <= factor; i += 4)
+                    {
+                        const float32x4_t v = vld1q_f32 (x + i);
+                        vmin = vminq_f32 (vmin, v);
+                        vmax = vmaxq_f32 (vmax, v);
+                        vsum = vaddq_f32 (vsum, v);
+                    }
+
+                    min = vminvq_f32 (vmin);
+                    max = vmaxvq_f32 (vmax);
+                    sum = vaddvq_f32 (vsum);
+                }
+
+                accumulateMinMaxSum (x, i, factor, min, max, sum);
+                storeBucket (b, factor, min, max, sum, mins, maxs, means);
+            }
+        }
+       #endif
+
+        /** The kernels used, the widest the CPU runs */
+        struct Dispatch
+        {
+            Dispatch()
+                : toInt16       (convertFloatToInt16Scalar)
+                , toFloat       (convertInt16ToFloatScalar)
+                , minMaxMean    (decimateMinMaxMeanScalar)
+                , name          ("scalar")
+            {
+               #if VECTOR_OPS_NEON
+                toInt16 = convertFloatToInt16NEON;
+                toFloat = convertInt16ToFloatNEON;
+                minMaxMean = decimateMinMaxMeanNEON;
+                name = "NEON";
+               #endif
+
+               #if VECTOR_OPS_SSE2
+                toInt16 = convertFloatToInt16SSE2;
+                toFloat = convertInt16ToFloatSSE2;
+                minMaxMean = decimateMinMaxMeanSSE2;
+                name = "SSE2";
+               #endif
+
+               #if VECTOR_OPS_AVX
+                if (SystemStats::hasAVX())
+                {
+                    toInt16 = convertFloatToInt16AVX;
+                    toFloat = convertInt16ToFloatAVX;
+                    minMaxMean = decimateMinMaxMeanAVX;
+                    name = "AVX";
+                }
+               #endif
+            }
+
+            ToInt16Function toInt16;
+            ToFloatFunction toFloat;
+            MinMaxMeanFunction minMaxMean;
+            String name;
+        };
+
+        inline const Dispatch& getDispatch()
+        {
+            static const Dispatch dispatch;
+            return dispatch;
+        }
+    }
+
+    //==============================================================================
+    /** Scales samples and rounds them to the nearest int16, saturating at +/-32767. With a scale
+        of 1/bitVolts, gives what the record engines store for a channel. */
+    inline void convertFloatToInt16 (const float* src, int16* dest, float scale, int numSamples)
+    {
+        Kernels::getDispatch().toInt16 (src, dest, scale, numSamples);
+    }
+
+    /** Converts int16 samples to floats, scaled, as by bitVolts when reading back a recording */
+    inline void convertInt16ToFloat (const int16* src, float* dest, float scale, int numSamples)
+    {
+        Kernels::getDispatch().toFloat (src, dest, scale, numSamples);
+    }
+
+    /** Reduces each run of factor samples of src to its minimum, maximum and, unless means is
+        null, its mean, for numBuckets runs. The minima and maxima are exact, unlike the means
+        of samples added up in a different order by each kernel. */
+    inline void decimateMinMaxMean (const float* src, int numBuckets, int factor,
+                                    float* mins, float* maxs, float* means)
+    {
+        if (factor > 0)
+            Kernels::getDispatch().minMaxMean (src, numBuckets, factor, mins, maxs, means);
+    }
+
+    /** Writes samples dataOffset..dataOffset + numSamples of each channel to dst, frame by frame.
+        Works through tiles of 8 samples by 8 channels, transposed with SSE2 where available, so
+        that the destination rows stay in cache while each channel is read sequentially. */
+    inline void interleave (int16* dst, const int16* const* data, int dataOffset, int numChannels, int numSamples)
+    {
+        const int fullChannels = numChannels & ~7;
+        const int fullSamples = numSamples & ~7;
+
+        for (int s = 0; s < fullSamples; s += 8)
+        {
+            int16* row = dst + s * numChannels;
+
+           #if VECTOR_OPS_SSE2
+            for (int c = 0; c < fullChannels; c += 8)
+                Kernels::interleaveTile (row + c, data + c, dataOffset + s, numChannels);
+
+            const int firstRemaining = fullChannels;
+           #else
+            const int firstRemaining = 0;
+           #endif
+
+            for (int c = firstRemaining; c < numChannels; ++c)
+            {
+                const int16* src = data[c] + dataOffset + s;
+                for (int i = 0; i < 8; ++i)
+                    row[i * numChannels + c] = src[i];
+            }
+        }
+
+        for (int s = fullSamples; s < numSamples; ++s)
+        {
+            int16* row = dst + s * numChannels;
+            for (int c = 0; c < numChannels; ++c)
+                row[c] = data[c][dataOffset + s];
+        }
+    }
+
+    /** Writes channel c of the interleaved src, scaled by scales[c], to dest[c]. Works through
+        tiles of 8 samples by 8 channels, transposed with SSE2 where available, over blocks of
+        samples small enough for their input to stay in cache while every channel is read. */
+    inline void deinterleave (const int16* src, float* const* dest, const float* scales, int numChannels, int64 numSamples)
+    {
+        for (int64 blockStart = 0; blockStart < numSamples; blockStart += VECTOR_OPS_DEINTERLEAVE_BLOCK_SAMPLES)
+        {
+            const int64 blockEnd = jmin (numSamples, blockStart + VECTOR_OPS_DEINTERLEAVE_BLOCK_SAMPLES);
+            int channel = 0;
+
+            for (; channel + 8 <= numChannels; channel += 8)
+            {
+                int64 i = blockStart;
+               #if VECTOR_OPS_SSE2
+                for (; i + 8 <= blockEnd; i += 8)
+                    Kernels::deinterleaveTile (src + i * numChannels + channel, numChannels, dest + channel, scales + channel, i);
+               #endif
+                for (; i < blockEnd; ++i)
+                {
+                    const int16* frame = src + i * numChannels + channel;
+                    for (int c = 0; c < 8; ++c)
+                        dest[channel + c][i] = frame[c] * scales[channel + c];
+                }
+            }
+
+            for (; channel < numChannels; ++channel)
+            {
+                for (int64 i = blockStart; i < blockEnd; ++i)
+                    dest[channel][i] = src[i * numChannels + channel] * scales[channel];
+            }
+        }
+    }
+
+    /** Returns the name of the instruction set the dispatched kernels run with */
+    inline String getKernelName()
+    {
+        return Kernels::getDispatch().name;
+    }
+}
+
+#endif  // __VECTOROPS_H_6D2B7E91__
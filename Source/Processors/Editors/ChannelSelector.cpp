@@ -42,8 +42,11 @@ static const int DURATION_ANIMATION_COLLAPSE_MS = 200;
 
 ChannelSelector::ChannelSelector(bool createButtons, Font& titleFont_) :
     eventsOnly(false)
+    , parameterChannelsGrid          (PARAMETER, titleFont_)
     , parameterSlicerChannelSelector (Channels::PARAM_CHANNELS,  "Parameter slicer channel selector component")
+    , audioChannelsGrid              (AUDIO, titleFont_)
     , audioSlicerChannelSelector     (Channels::AUDIO_CHANNELS,  "Audio slicer channel selector component")
+    , recordChannelsGrid             (RECORD, titleFont_)
     , recordSlicerChannelSelector    (Channels::RECORD_CHANNELS, "Record slicer channel selector component")
     , paramsToggled(true), paramsActive(true), recActive(true), radioStatus(false), isNotSink(createButtons)
     , moveRight(false), moveLeft(false), offsetLR(0), offsetUD(0), desiredOffset(0), titleFont(titleFont_), acquisitionIsActive(false)
@@ -80,29 +83,15 @@ ChannelSelector::ChannelSelector(bool createButtons, Font& titleFont_) :
     noneButton->addListener(this);
     addAndMakeVisible(noneButton);
 
-    // Buttons managers
+    // Channel grids
     // ====================================================================
-    addAndMakeVisible (audioButtonsManager);
-    addAndMakeVisible (recordButtonsManager);
-    addAndMakeVisible (parameterButtonsManager);
-
-    // Enable fast mode selection for buttons
-    audioButtonsManager.setFastSelectionModeEnabled     (true);
-    recordButtonsManager.setFastSelectionModeEnabled    (true);
-    parameterButtonsManager.setFastSelectionModeEnabled (true);
-
-    audioButtonsManager.setMinPaddingBetweenButtons     (0);
-    recordButtonsManager.setMinPaddingBetweenButtons    (0);
-    parameterButtonsManager.setMinPaddingBetweenButtons (0);
-
-    audioButtonsManager.setColour       (ButtonGroupManager::outlineColourId, Colour (0x0));
-    recordButtonsManager.setColour      (ButtonGroupManager::outlineColourId, Colour (0x0));
-    parameterButtonsManager.setColour   (ButtonGroupManager::outlineColourId, Colour (0x0));
-
-    // Register listeners for buttons
-    audioButtonsManager.setButtonListener      (this);
-    recordButtonsManager.setButtonListener     (this);
-    parameterButtonsManager.setButtonListener  (this);
+    addAndMakeVisible (audioChannelsGrid);
+    addAndMakeVisible (recordChannelsGrid);
+    addAndMakeVisible (parameterChannelsGrid);
+
+    audioChannelsGrid.setListener       (this);
+    recordChannelsGrid.setListener      (this);
+    parameterChannelsGrid.setListener   (this);
     // ====================================================================
 
     // Slicer channels selectors
@@ -137,9 +126,9 @@ ChannelSelector::~ChannelSelector()
     // We will remove it after getting rid of the ugly calling of deleteAllChildren() method.
     // We should really use some RAII technuiqes to avoid calling this method.
     // TODO: refactor the code to follow RAII best principles and to avoid using raw pointers after merge with priyanjitdey94
-    removeChildComponent (&audioButtonsManager);
-    removeChildComponent (&recordButtonsManager);
-    removeChildComponent (&parameterButtonsManager);
+    removeChildComponent (&audioChannelsGrid);
+    removeChildComponent (&recordChannelsGrid);
+    removeChildComponent (&parameterChannelsGrid);
 
     removeChildComponent (&audioSlicerChannelSelector);
     removeChildComponent (&recordSlicerChannelSelector);
@@ -172,36 +161,25 @@ void ChannelSelector::paint(Graphics& g)
 
 void ChannelSelector::setNumChannels(int numChans)
 {
-    int difference = numChans - parameterButtonsManager.getNumButtons();
-
-    // std::cout << difference << " buttons needed." << std::endl;
+    parameterChannelsGrid.setNumChannels (numChans, paramsToggled);
 
-    if (difference > 0)
-    {
-        for (int n = 0; n < difference; n++)
-        {
-            addButton();
-        }
-    }
-    else if (difference < 0)
+    if (isNotSink)
     {
-        for (int n = 0; n < -difference; n++)
-        {
-            removeButton();
-        }
+        recordChannelsGrid.setNumChannels (numChans, false);
+        audioChannelsGrid.setNumChannels  (numChans, false);
     }
 
-    const int numButtons = parameterButtonsManager.getNumButtons();
     //Reassign numbers according to the actual channels (useful for channel mapper)
-    for (int n = 0; n < numButtons; ++n)
+    GenericEditor* editor = (GenericEditor*) getParentComponent();
+    for (int n = 0; n < numChans; ++n)
     {
-        int num = ( (GenericEditor*)getParentComponent())->getChannelDisplayNumber (n);
-        static_cast<ChannelSelectorButton*> (parameterButtonsManager.getButtonAt  (n))->setChannel (n + 1, num + 1);
+        const int num = editor->getChannelDisplayNumber (n) + 1;
+        parameterChannelsGrid.setDisplayNumber (n, num);
 
         if (isNotSink)
         {
-            static_cast<ChannelSelectorButton*> (recordButtonsManager.getButtonAt (n))->setChannel (n + 1, num + 1);
-            static_cast<ChannelSelectorButton*> (audioButtonsManager.getButtonAt  (n))->setChannel (n + 1, num + 1);
+            recordChannelsGrid.setDisplayNumber (n, num);
+            audioChannelsGrid.setDisplayNumber  (n, num);
         }
     }
 
@@ -210,12 +188,12 @@ void ChannelSelector::setNumChannels(int numChans)
 
 int ChannelSelector::getNumChannels()
 {
-    return parameterButtonsManager.getNumButtons();
+    return parameterChannelsGrid.getNumChannels();
 }
 
 void ChannelSelector::shiftChannelsVertical(float amount)
 {
-    if (parameterButtonsManager.getNumButtons() > 16)
+    if (parameterChannelsGrid.getNumChannels() > 16)
     {
         offsetUD -= amount * 10;
         offsetUD = jmin(offsetUD, 0.0f);
@@ -232,9 +210,9 @@ void ChannelSelector::refreshButtonBoundaries()
     const int columnWidth   = getDesiredWidth() / (numColumnsGreaterThan100 + 1) + 1;
     const int rowHeight     = 14;
 
-    audioButtonsManager.setButtonSize      (columnWidth, rowHeight);
-    recordButtonsManager.setButtonSize     (columnWidth, rowHeight);
-    parameterButtonsManager.setButtonSize  (columnWidth, rowHeight);
+    audioChannelsGrid.setCellSize      (columnWidth, rowHeight);
+    recordChannelsGrid.setCellSize     (columnWidth, rowHeight);
+    parameterChannelsGrid.setCellSize  (columnWidth, rowHeight);
 
     const int xLoc = offsetLR + 3;
 
@@ -261,20 +239,20 @@ void ChannelSelector::refreshButtonBoundaries()
     // We will use just some hacks to set initial y and height if height is zero,
     // otherwise we will use the same bounds for buttons maangers
     int buttonsManagerX = xLoc;
-    parameterButtonsManager.setBounds   (buttonsManagerX,
-                                         parameterButtonsManager.getHeight() == 0 ? defaultButtonsManagerY : parameterButtonsManager.getY(),
+    parameterChannelsGrid.setBounds     (buttonsManagerX,
+                                         parameterChannelsGrid.getHeight() == 0 ? defaultButtonsManagerY : parameterChannelsGrid.getY(),
                                          buttonsManagerWidth,
-                                         getHeight() - parameterButtonsManager.getY() - tabButtonHeight);
+                                         getHeight() - parameterChannelsGrid.getY() - tabButtonHeight);
     buttonsManagerX -= getDesiredWidth();
-    recordButtonsManager.setBounds      (buttonsManagerX,
-                                         recordButtonsManager.getHeight() == 0 ? defaultButtonsManagerY : recordButtonsManager.getY(),
+    recordChannelsGrid.setBounds        (buttonsManagerX,
+                                         recordChannelsGrid.getHeight() == 0 ? defaultButtonsManagerY : recordChannelsGrid.getY(),
                                          buttonsManagerWidth,
-                                         getHeight() - recordButtonsManager.getY() - tabButtonHeight);
+                                         getHeight() - recordChannelsGrid.getY() - tabButtonHeight);
     buttonsManagerX -= getDesiredWidth();
-    audioButtonsManager.setBounds       (buttonsManagerX,
-                                         audioButtonsManager.getHeight() == 0 ? defaultButtonsManagerY : audioButtonsManager.getY(),
+    audioChannelsGrid.setBounds         (buttonsManagerX,
+                                         audioChannelsGrid.getHeight() == 0 ? defaultButtonsManagerY : audioChannelsGrid.getY(),
                                          buttonsManagerWidth,
-                                         getHeight() - audioButtonsManager.getY() - tabButtonHeight);
+                                         getHeight() - audioChannelsGrid.getY() - tabButtonHeight);
     // ===================================================================================================
 
     /*
@@ -322,54 +300,16 @@ void ChannelSelector::timerCallback()
     refreshButtonBoundaries();
 }
 
-void ChannelSelector::addButton()
-{
-    const int size = parameterButtonsManager.getNumButtons();
-
-    ChannelSelectorButton* b = new ChannelSelectorButton (size + 1, PARAMETER, titleFont);
-    parameterButtonsManager.addButton (b);
-
-    if (paramsToggled)
-        b->setToggleState(true, dontSendNotification);
-    else
-        b->setToggleState(false, dontSendNotification);
-
-    if (!paramsActive)
-        b->setActive(false);
-
-    if (isNotSink)
-    {
-        ChannelSelectorButton* br = new ChannelSelectorButton(size + 1, RECORD, titleFont);
-        recordButtonsManager.addButton (br);
-
-        ChannelSelectorButton* ba = new ChannelSelectorButton(size + 1, AUDIO, titleFont);
-        audioButtonsManager.addButton (ba);
-    }
-}
-
-void ChannelSelector::removeButton()
-{
-    int size = parameterButtonsManager.getNumButtons();
-
-    parameterButtonsManager.removeButton (size - 1);
-
-    if (isNotSink)
-    {
-        recordButtonsManager.removeButton (size - 1);
-        audioButtonsManager.removeButton  (size - 1);
-    }
-}
-
 Array<int> ChannelSelector::getActiveChannels()
 {
     Array<int> a;
 
     if (! eventsOnly)
     {
-        const int numButtons = parameterButtonsManager.getNumButtons();
-        for (int i = 0; i < numButtons; ++i)
+        const int numChannels = parameterChannelsGrid.getNumChannels();
+        for (int i = 0; i < numChannels; ++i)
         {
-            if (parameterButtonsManager.getButtonAt (i)->getToggleState())
+            if (parameterChannelsGrid.getChannelState (i))
                 a.add (i);
         }
     }
@@ -385,71 +325,36 @@ void ChannelSelector::setActiveChannels(Array<int> a)
 {
     //std::cout << "Setting active channels!" << std::endl;
 
-    const int numButtons = parameterButtonsManager.getNumButtons();
-    for (int i = 0; i < numButtons; ++i)
-    {
-        parameterButtonsManager.getButtonAt (i)->setToggleState (false, dontSendNotification);
-    }
+    parameterChannelsGrid.setAllChannels (false, false);
 
     for (int i = 0; i < a.size(); i++)
     {
-        if (a[i] < numButtons)
-        {
-            parameterButtonsManager.getButtonAt (a[i])->setToggleState (true, dontSendNotification);
-        }
+        parameterChannelsGrid.setChannelState (a[i], true, false);
     }
 }
 
 void ChannelSelector::inactivateButtons()
 {
     paramsActive = false;
-
-    const int numButtons = parameterButtonsManager.getNumButtons();
-    for (int i = 0; i < numButtons; ++i)
-    {
-        const auto& button = static_cast<ChannelSelectorButton*> (parameterButtonsManager.getButtonAt (i));
-        button->setActive (false);
-        button->repaint();
-    }
+    parameterChannelsGrid.setActive (false);
 }
 
 void ChannelSelector::activateButtons()
 {
     paramsActive = true;
-
-    const int numButtons = parameterButtonsManager.getNumButtons();
-    for (int i = 0; i < numButtons; ++i)
-    {
-        const auto& button = static_cast<ChannelSelectorButton*> (parameterButtonsManager.getButtonAt (i));
-        button->setActive (true);
-        button->repaint();
-    }
+    parameterChannelsGrid.setActive (true);
 }
 
 void ChannelSelector::inactivateRecButtons()
 {
     recActive = false;
-
-    const int numButtons = recordButtonsManager.getNumButtons();
-    for (int i = 0; i < numButtons; ++i)
-    {
-        const auto& button = static_cast<ChannelSelectorButton*> (recordButtonsManager.getButtonAt (i));
-        button->setActive (false);
-        button->repaint();
-    }
+    recordChannelsGrid.setActive (false);
 }
 
 void ChannelSelector::activateRecButtons()
 {
     recActive = true;
-
-    const int numButtons = recordButtonsManager.getNumButtons();
-    for (int i = 0; i < numButtons; ++i)
-    {
-        const auto& button = static_cast<ChannelSelectorButton*> (recordButtonsManager.getButtonAt (i));
-        button->setActive (true);
-        button->repaint();
-    }
+    recordChannelsGrid.setActive (true);
 }
 
 void ChannelSelector::refreshParameterColors()
@@ -479,63 +384,44 @@ void ChannelSelector::setRadioStatus(bool radioOn)
     {
         radioStatus = radioOn;
 
-        const int numButtons = parameterButtonsManager.getNumButtons();
-        for (int i = 0; i < numButtons; ++i)
-        {
-            parameterButtonsManager.getButtonAt (i)->setToggleState (false, dontSendNotification);
-        }
-
-        parameterButtonsManager.setRadioButtonMode (radioStatus);
+        parameterChannelsGrid.setAllChannels (false, false);
+        parameterChannelsGrid.setRadioMode (radioStatus);
     }
 }
 
 bool ChannelSelector::getParamStatus(int chan)
 {
-    if (chan >= 0 && chan < parameterButtonsManager.getNumButtons())
-        return parameterButtonsManager.getButtonAt (chan)->getToggleState();
-    else
-        return false;
+    return parameterChannelsGrid.getChannelState (chan);
 }
 
 bool ChannelSelector::getRecordStatus(int chan)
 {
-    if (chan >= 0 && chan < recordButtonsManager.getNumButtons())
-        return recordButtonsManager.getButtonAt (chan)->getToggleState();
-    else
-        return false;
+    return recordChannelsGrid.getChannelState (chan);
 }
 
 bool ChannelSelector::getAudioStatus(int chan)
 {
-    if (chan >= 0 && chan < audioButtonsManager.getNumButtons())
-        return audioButtonsManager.getButtonAt (chan)->getToggleState();
-    else
-        return false;
+    return audioChannelsGrid.getChannelState (chan);
 }
 
 void ChannelSelector::setParamStatus(int chan, bool b)
 {
-    if (chan >= 0 && chan < parameterButtonsManager.getNumButtons())
-        parameterButtonsManager.getButtonAt (chan)->setToggleState(b, sendNotification);
+    parameterChannelsGrid.setChannelState (chan, b, true);
 }
 
 void ChannelSelector::setRecordStatus(int chan, bool b)
 {
-    if (chan >= 0 && chan < recordButtonsManager.getNumButtons())
-        recordButtonsManager.getButtonAt (chan)->setToggleState(b, sendNotification);
+    recordChannelsGrid.setChannelState (chan, b, true);
 }
 
 void ChannelSelector::setAudioStatus(int chan, bool b)
 {
-    if (chan >= 0 && chan < audioButtonsManager.getNumButtons())
-        audioButtonsManager.getButtonAt (chan)->setToggleState (b, sendNotification);
+    audioChannelsGrid.setChannelState (chan, b, true);
 }
 
 void ChannelSelector::clearAudio()
 {
-    const int numButtons = audioButtonsManager.getNumButtons();
-    for (int chan = 0; chan < numButtons; ++chan)
-        audioButtonsManager.getButtonAt (chan)->setToggleState (false, sendNotification);
+    audioChannelsGrid.setAllChannels (false, true);
 }
 
 int ChannelSelector::getDesiredWidth()
@@ -591,18 +477,11 @@ void ChannelSelector::buttonClicked(Button* button)
         // select all active buttons
         if (offsetLR == recordOffset)
         {
-            for (int i = 0; i < recordButtonsManager.getNumButtons(); ++i)
-            {
-                recordButtonsManager.getButtonAt (i)->setToggleState (true, sendNotification);
-            }
-
+            recordChannelsGrid.setAllChannels (true, true);
         }
         else if (offsetLR == parameterOffset)
         {
-            for (int i = 0; i < parameterButtonsManager.getNumButtons(); ++i)
-            {
-                parameterButtonsManager.getButtonAt (i)->setToggleState (true, sendNotification);
-            }
+            parameterChannelsGrid.setAllChannels (true, true);
         }
         else if (offsetLR == audioOffset)
         {
@@ -614,24 +493,15 @@ void ChannelSelector::buttonClicked(Button* button)
         // deselect all active buttons
         if (offsetLR == recordOffset)
         {
-            for (int i = 0; i < recordButtonsManager.getNumButtons(); ++i)
-            {
-                recordButtonsManager.getButtonAt (i)->setToggleState (false, sendNotification);
-            }
+            recordChannelsGrid.setAllChannels (false, true);
         }
         else if (offsetLR == parameterOffset)
         {
-            for (int i = 0; i < parameterButtonsManager.getNumButtons(); ++i)
-            {
-                parameterButtonsManager.getButtonAt (i)->setToggleState (false, sendNotification);
-            }
+            parameterChannelsGrid.setAllChannels (false, true);
         }
         else if (offsetLR == audioOffset)
         {
-            for (int i = 0; i < audioButtonsManager.getNumButtons(); ++i)
-            {
-                audioButtonsManager.getButtonAt (i)->setToggleState (false, sendNotification);
-            }
+            audioChannelsGrid.setAllChannels (false, true);
         }
 
         if (radioStatus) // if radio buttons are active
@@ -639,119 +509,175 @@ void ChannelSelector::buttonClicked(Button* button)
             // send a message to parent
             GenericEditor* editor = (GenericEditor*) getParentComponent();
             editor->channelChanged (-1, false);
+            refreshParameterColors();
         }
     }
-    else
-    {
-        ChannelSelectorButton* b = (ChannelSelectorButton*)button;
+}
 
-        if (b->getType() == AUDIO)
-        {
-            // get audio node, and inform it of the change
-            GenericEditor* editor = (GenericEditor*)getParentComponent();
 
-            const DataChannel* ch = editor->getChannel(b->getChannel() - 1);
-            //int channelNum = editor->getStartChannel() + b->getChannel() - 1;
-            bool status = b->getToggleState();
+void ChannelSelector::channelStateChanged (ChannelSelectorGrid* grid, int channel, bool status)
+{
+    if (grid->getType() == AUDIO)
+    {
+        // get audio node, and inform it of the change
+        GenericEditor* editor = (GenericEditor*)getParentComponent();
+
+        const DataChannel* ch = editor->getChannel(channel);
 
-         //   std::cout << "Requesting audio monitor for channel " << ch->nodeIndex + 1 << std::endl;
-            
-            // change parameter directly on editor
-            //     This is another of those ugly things that will go away once the
-            //     probe audio system is implemented, but is needed to maintain compatibility
-            //     between the older recording system and the newer channel objects.
-            const_cast<DataChannel*>(ch)->setMonitored(status);
+     //   std::cout << "Requesting audio monitor for channel " << ch->nodeIndex + 1 << std::endl;
+        
+        // change parameter directly on editor
+        //     This is another of those ugly things that will go away once the
+        //     probe audio system is implemented, but is needed to maintain compatibility
+        //     between the older recording system and the newer channel objects.
+        const_cast<DataChannel*>(ch)->setMonitored(status);
 
-            
-            if (acquisitionIsActive) // use setParameter to change audio node's copy of parameter safely, if running
-            {
-                AccessClass::getProcessorGraph()->
-                getAudioNode()->setChannelStatus(ch, status);
-            }
-        }
-        else if (b->getType() == RECORD)
+        
+        if (acquisitionIsActive) // use setParameter to change audio node's copy of parameter safely, if running
         {
-            // get record node, and inform it of the change
-            GenericEditor* editor = (GenericEditor*)getParentComponent();
+            AccessClass::getProcessorGraph()->
+            getAudioNode()->setChannelStatus(ch, status);
+        }
+    }
+    else if (grid->getType() == RECORD)
+    {
+        // get record node, and inform it of the change
+        GenericEditor* editor = (GenericEditor*)getParentComponent();
 
-            const DataChannel* ch = editor->getChannel(b->getChannel() - 1);
-            //int channelNum = editor->getStartChannel() + b->getChannel() - 1;
-            bool status = b->getToggleState();
+        const DataChannel* ch = editor->getChannel(channel);
 
-            if (acquisitionIsActive) // use setParameter to change parameter safely
-            {
-                if ( AccessClass::getProcessorGraph()->
-                getRecordNode()->
-                setChannelStatus(ch, status) )
-                {
-                    const_cast<DataChannel*>(ch)->setRecordState(status);
-                }
-                
-                // make sure that the button matches the system's actual state, in case
-                // user's interaction was disallowed
-                b->setToggleState(const_cast<DataChannel*>(ch)->getRecordState(), dontSendNotification);
-            }
-            else     // change parameter directly
+        if (acquisitionIsActive) // use setParameter to change parameter safely
+        {
+            if ( AccessClass::getProcessorGraph()->
+            getRecordNode()->
+            setChannelStatus(ch, status) )
             {
-                //std::cout << "Setting record status for channel " << b->getChannel() << std::endl;
-
-				//This is another of those ugly things that will go away once the
-				//probe recording system is implemented, but is needed to maintain compatibility
-				//between the older recording system and the newer channel objects.
                 const_cast<DataChannel*>(ch)->setRecordState(status);
             }
-
-            AccessClass::getGraphViewer()->repaint();
-
+            
+            // make sure that the button matches the system's actual state, in case
+            // user's interaction was disallowed
+            grid->setChannelState(channel, const_cast<DataChannel*>(ch)->getRecordState(), false);
         }
-        else // parameter type
+        else     // change parameter directly
         {
-            GenericEditor* editor = (GenericEditor*) getParentComponent();
-            editor->channelChanged (b->getChannel() - 1, b->getToggleState());
+            //std::cout << "Setting record status for channel " << channel + 1 << std::endl;
 
-            // do nothing
-            if (radioStatus) // if radio buttons are active
-            {
-                // send a message to parent
-                GenericEditor* editor = (GenericEditor*) getParentComponent();
-                editor->channelChanged (b->getChannel(), b->getToggleState());
-            }
+			//This is another of those ugly things that will go away once the
+			//probe recording system is implemented, but is needed to maintain compatibility
+			//between the older recording system and the newer channel objects.
+            const_cast<DataChannel*>(ch)->setRecordState(status);
         }
+    }
+    else // parameter type
+    {
+        GenericEditor* editor = (GenericEditor*) getParentComponent();
+        editor->channelChanged (channel, status);
 
+        // do nothing
+        if (radioStatus) // if radio buttons are active
+        {
+            // send a message to parent
+            editor->channelChanged (channel + 1, status);
+        }
     }
+}
+
+
+void ChannelSelector::channelSelectionChanged (ChannelSelectorGrid* grid)
+{
+    if (grid->getType() == RECORD)
+        AccessClass::getGraphViewer()->repaint();
+
     refreshParameterColors();
 }
 
 
-void ChannelSelector::changeChannelsSelectionButtonClicked (SlicerChannelSelectorComponent* sender,
-                                                            Button* buttonThatWasClicked,
-                                                            bool isSelect)
+void ChannelSelector::channelMenuRequested (ChannelSelectorGrid* grid, int channel)
 {
-    const Channels::ChannelsType channelsType = sender->getChannelsType();
+    if (grid->getType() != RECORD)
+        return;
+
+    GenericEditor* editor = (GenericEditor*) getParentComponent();
+    const DataChannel* clicked = editor->getChannel (channel);
+
+    if (clicked == nullptr)
+        return;
+
+    // the record engines configure their files when acquisition starts
+    const int factors[] = { 1, 2, 4, 5, 10, 20, 30 };
+    const int current = clicked->getRecordDecimation();
+
+    PopupMenu menu;
+    menu.addSectionHeader ("Record rate");
+
+    for (int i = 0; i < numElementsInArray (factors); ++i)
+    {
+        const String rate = String (clicked->getSampleRate() / factors[i] / 1000.0f, 2) + " kHz";
+        menu.addItem (i + 1,
+                      (factors[i] == 1) ? "Full rate (" + rate + ")" : "1/" + String (factors[i]) + " (" + rate + ")",
+                      ! acquisitionIsActive,
+                      factors[i] == current);
+    }
+
+    const int result = menu.show();
+
+    if (result <= 0)
+        return;
+
+    // a recorded channel takes the other recorded ones with it
+    Array<int> channels;
+
+    if (grid->getChannelState (channel))
+    {
+        for (int i = 0; i < grid->getNumChannels(); ++i)
+        {
+            if (grid->getChannelState (i))
+                channels.add (i);
+        }
+    }
+    else
+    {
+        channels.add (channel);
+    }
+
+    for (int i = 0; i < channels.size(); ++i)
+    {
+        if (const DataChannel* ch = editor->getChannel (channels[i]))
+            const_cast<DataChannel*> (ch)->setRecordDecimation (factors[result - 1]);
+    }
+}
 
-    TiledButtonGroupManager* buttonsManager = nullptr;
+
+ChannelSelectorGrid* ChannelSelector::getGridForChannelsType (Channels::ChannelsType channelsType)
+{
     if (channelsType == Channels::AUDIO_CHANNELS)
-        buttonsManager = &audioButtonsManager;
+        return &audioChannelsGrid;
     else if (channelsType == Channels::RECORD_CHANNELS)
-        buttonsManager = &recordButtonsManager;
+        return &recordChannelsGrid;
     else if (channelsType == Channels::PARAM_CHANNELS)
-        buttonsManager = &parameterButtonsManager;
+        return &parameterChannelsGrid;
 
-    jassert (buttonsManager != nullptr);
+    return nullptr;
+}
+
+
+void ChannelSelector::changeChannelsSelectionButtonClicked (SlicerChannelSelectorComponent* sender,
+                                                            Button* buttonThatWasClicked,
+                                                            bool isSelect)
+{
+    ChannelSelectorGrid* grid = getGridForChannelsType (sender->getChannelsType());
 
-    Array<int> getBoxList = ListSliceParser::parseStringIntoRange (sender->getText(), audioButtonsManager.getNumButtons());
+    jassert (grid != nullptr);
+
+    Array<int> getBoxList = ListSliceParser::parseStringIntoRange (sender->getText(), grid->getNumChannels());
     if (getBoxList.size() < 3)
         return;
 
     int i = 0;
     while (i <= getBoxList.size() - 3)
     {
-        const int lim = getBoxList[i + 1];
-        const int comd = getBoxList[i + 2];
-        for (int fa = getBoxList[i]; fa <= lim; fa += comd)
-        {
-            buttonsManager->getButtonAt (fa)->setToggleState (isSelect, sendNotification);
-        }
+        grid->setChannelRange (getBoxList[i], getBoxList[i + 1], getBoxList[i + 2], isSelect, true);
         i += 3;
     }
 }
@@ -760,15 +686,7 @@ void ChannelSelector::changeChannelsSelectionButtonClicked (SlicerChannelSelecto
 void ChannelSelector::channelSelectorCollapsedStateChanged (SlicerChannelSelectorComponent* sender,
                                                             bool isCollapsed)
 {
-    const Channels::ChannelsType channelsType = sender->getChannelsType();
-
-    TiledButtonGroupManager* buttonsManager = nullptr;
-    if (channelsType == Channels::AUDIO_CHANNELS)
-        buttonsManager = &audioButtonsManager;
-    else if (channelsType == Channels::RECORD_CHANNELS)
-        buttonsManager = &recordButtonsManager;
-    else if (channelsType == Channels::PARAM_CHANNELS)
-        buttonsManager = &parameterButtonsManager;
+    ChannelSelectorGrid* buttonsManager = getGridForChannelsType (sender->getChannelsType());
 
     jassert (buttonsManager != nullptr);
 
@@ -985,75 +903,411 @@ void EditorButton::paintButton(Graphics& g, bool isMouseOver, bool isButtonDown)
 }
 
 
-ChannelSelectorButton::ChannelSelectorButton(int num_, int type_, Font& f) : Button("name")
+ChannelSelectorGrid::ChannelSelectorGrid (int type_, const Font& font_)
+    : type                  (type_)
+    , font                  (font_)
+    , numChannels           (0)
+    , isActive              (true)
+    , isRadioMode           (false)
+    , cellWidth             (10)
+    , cellHeight            (10)
+    , scrollOffset          (0)
+    , mouseOverChannel      (-1)
+    , dragStartChannel      (-1)
+    , lastDraggedChannel    (-1)
+    , lastClickedChannel    (-1)
+    , isDragging            (false)
+    , listener              (nullptr)
 {
-    isActive = true;
-    num = num_;
-    displayNum = num_;
-    type = type_;
+    font.setHeight (11);
+}
 
-    setClickingTogglesState(true);
 
-    buttonFont = f;
-    buttonFont.setHeight (11);
+int ChannelSelectorGrid::getType() const
+{
+    return type;
 }
 
-ChannelSelectorButton::~ChannelSelectorButton() {}
 
-int ChannelSelectorButton::getType()
+void ChannelSelectorGrid::setNumChannels (int newNumChannels, bool newChannelState)
 {
-    return type;
+    if (newNumChannels > numChannels)
+        channelStates.setRange (numChannels, newNumChannels - numChannels, newChannelState);
+    else
+        channelStates.setRange (newNumChannels, numChannels - newNumChannels, false);
+
+    // display numbers of new channels default to their position, until setDisplayNumber() is called
+    for (int n = displayNumbers.size(); n < newNumChannels; ++n)
+        displayNumbers.add (n + 1);
+
+    displayNumbers.resize (newNumChannels);
+
+    numChannels = newNumChannels;
+
+    if (lastClickedChannel >= numChannels)
+        lastClickedChannel = -1;
+
+    setScrollOffset (scrollOffset);
+    repaint();
 }
 
-int ChannelSelectorButton::getChannel()
+
+int ChannelSelectorGrid::getNumChannels() const
 {
-    return num;
+    return numChannels;
 }
 
-void ChannelSelectorButton::setChannel(int n)
+
+void ChannelSelectorGrid::setDisplayNumber (int channel, int displayNumber)
 {
-    num = n;
-    displayNum = n;
+    if (isPositiveAndBelow (channel, numChannels) && displayNumbers.getUnchecked (channel) != displayNumber)
+    {
+        displayNumbers.set (channel, displayNumber);
+        repaint();
+    }
+}
+
+
+bool ChannelSelectorGrid::getChannelState (int channel) const
+{
+    return isPositiveAndBelow (channel, numChannels) && channelStates[channel];
+}
+
+
+void ChannelSelectorGrid::setChannelState (int channel, bool state, bool notify)
+{
+    if (! isPositiveAndBelow (channel, numChannels))
+        return;
+
+    if (notify)
+    {
+        if (changeChannel (channel, state) && listener != nullptr)
+            listener->channelSelectionChanged (this);
+    }
+    else if (channelStates[channel] != state)
+    {
+        channelStates.setBit (channel, state);
+        repaint();
+    }
+}
+
+
+void ChannelSelectorGrid::setAllChannels (bool state, bool notify)
+{
+    setChannelRange (0, numChannels - 1, 1, state, notify);
+}
+
+
+void ChannelSelectorGrid::setChannelRange (int first, int last, int step, bool state, bool notify)
+{
+    first = jmax (0, first);
+    last  = jmin (numChannels - 1, last);
+    step  = jmax (1, step);
+
+    if (! notify)
+    {
+        for (int i = first; i <= last; i += step)
+            channelStates.setBit (i, state);
+
+        repaint();
+        return;
+    }
+
+    bool anyChanged = false;
+
+    for (int i = first; i <= last; i += step)
+        anyChanged = changeChannel (i, state) || anyChanged;
+
+    if (anyChanged && listener != nullptr)
+        listener->channelSelectionChanged (this);
+}
+
+
+void ChannelSelectorGrid::setActive (bool shouldBeActive)
+{
+    isActive = shouldBeActive;
+    repaint();
+}
+
+
+void ChannelSelectorGrid::setRadioMode (bool shouldBeRadio)
+{
+    isRadioMode = shouldBeRadio;
 }
-void ChannelSelectorButton::setChannel(int n, int d)
+
+
+void ChannelSelectorGrid::setCellSize (int width, int height)
+{
+    cellWidth  = jmax (1, width);
+    cellHeight = jmax (1, height);
+
+    setScrollOffset (scrollOffset);
+    repaint();
+}
+
+
+void ChannelSelectorGrid::setListener (Listener* newListener)
+{
+    listener = newListener;
+}
+
+
+int ChannelSelectorGrid::getNumColumns() const
+{
+    return jmax (1, getWidth() / cellWidth);
+}
+
+
+int ChannelSelectorGrid::getColumnStep() const
+{
+    // spread the columns over the whole width, as the tiled buttons were
+    const int numColumns = getNumColumns();
+    return cellWidth + jmax (0, (getWidth() - numColumns * cellWidth) / jmax (numColumns - 1, 1));
+}
+
+
+int ChannelSelectorGrid::getRowStep() const
 {
-    num = n;
-    displayNum = d;
+    return cellHeight + jmax (0, getColumnStep() - cellWidth);
+}
+
+
+int ChannelSelectorGrid::getChannelAtPosition (Point<int> position) const
+{
+    const int columnStep = getColumnStep();
+    const int rowStep    = getRowStep();
+    const int y          = position.y + scrollOffset;
+
+    if (position.x < 0 || y < 0
+        || position.x % columnStep >= cellWidth
+        || y % rowStep >= cellHeight)
+        return -1;
+
+    const int column = position.x / columnStep;
+    if (column >= getNumColumns())
+        return -1;
+
+    const int channel = (y / rowStep) * getNumColumns() + column;
+    return channel < numChannels ? channel : -1;
+}
+
+
+void ChannelSelectorGrid::setScrollOffset (int newOffset)
+{
+    const int numRows = (numChannels + getNumColumns() - 1) / getNumColumns();
+    const int maxOffset = jmax (0, numRows * getRowStep() - getHeight());
+
+    newOffset = jlimit (0, maxOffset, newOffset);
+
+    if (newOffset != scrollOffset)
+    {
+        scrollOffset = newOffset;
+        repaint();
+    }
+}
+
+
+bool ChannelSelectorGrid::changeChannel (int channel, bool state)
+{
+    if (channelStates[channel] == state)
+        return false;
+
+    channelStates.setBit (channel, state);
+    repaint();
+
+    if (listener != nullptr)
+        listener->channelStateChanged (this, channel, state);
+
+    return true;
 }
 
-void ChannelSelectorButton::paintButton(Graphics& g, bool isMouseOver, bool isButtonDown)
+
+void ChannelSelectorGrid::paint (Graphics& g)
 {
-    if (isActive)
+    if (numChannels == 0)
+        return;
+
+    const int numColumns = getNumColumns();
+    const int columnStep = getColumnStep();
+    const int rowStep    = getRowStep();
+
+    // only the rows in view
+    const int firstChannel = jmax (0, scrollOffset / rowStep) * numColumns;
+    const int lastChannel  = jmin (numChannels, ((scrollOffset + getHeight()) / rowStep + 1) * numColumns);
+
+    g.setFont (font);
+
+    for (int channel = firstChannel; channel < lastChannel; ++channel)
     {
-        if (getToggleState() == true)
-            g.setColour(Colours::orange);
+        const bool isOn = channelStates[channel];
+
+        if (isActive)
+        {
+            if (channel == mouseOverChannel)
+                g.setColour (Colours::white);
+            else if (isOn)
+                g.setColour (Colours::orange);
+            else
+                g.setColour (Colours::darkgrey);
+        }
         else
-            g.setColour(Colours::darkgrey);
+        {
+            if (isOn)
+                g.setColour (Colours::yellow);
+            else
+                g.setColour (Colours::lightgrey);
+        }
+
+        g.drawText (String (displayNumbers.getUnchecked (channel)),
+                    (channel % numColumns) * columnStep,
+                    (channel / numColumns) * rowStep - scrollOffset,
+                    cellWidth, cellHeight,
+                    Justification::centred, true);
+    }
+}
+
+
+void ChannelSelectorGrid::resized()
+{
+    setScrollOffset (scrollOffset);
+}
+
+
+void ChannelSelectorGrid::mouseDown (const MouseEvent& e)
+{
+    dragStartChannel   = getChannelAtPosition (e.getPosition());
+    lastDraggedChannel = dragStartChannel;
+    isDragging = false;
+
+    if (e.mods.isPopupMenu())
+    {
+        const int channel = dragStartChannel;
+        dragStartChannel = -1;
+
+        if (channel >= 0 && listener != nullptr)
+            listener->channelMenuRequested (this, channel);
+    }
+}
+
+
+void ChannelSelectorGrid::mouseDrag (const MouseEvent& e)
+{
+    // dragging only selects ranges of channels that can be toggled one by one
+    if (! isActive || isRadioMode || e.mods.isPopupMenu())
+        return;
+
+    const int channel = getChannelAtPosition (e.getPosition());
+
+    if (dragStartChannel < 0)
+        dragStartChannel = channel;
+
+    if (channel < 0 || channel == lastDraggedChannel)
+        return;
+
+    isDragging = true;
+    lastDraggedChannel = channel;
+
+    // shift + drag deselects
+    const bool state = ! e.mods.isShiftDown();
+    setChannelRange (jmin (dragStartChannel, channel), jmax (dragStartChannel, channel), 1, state, true);
+}
+
+
+void ChannelSelectorGrid::mouseUp (const MouseEvent& e)
+{
+    const int channel = getChannelAtPosition (e.getPosition());
+
+    if (! isDragging && channel >= 0 && channel == dragStartChannel)
+        clickChannel (channel, e.mods);
+
+    dragStartChannel   = -1;
+    lastDraggedChannel = -1;
+    isDragging = false;
+}
+
+
+void ChannelSelectorGrid::clickChannel (int channel, const ModifierKeys& mods)
+{
+    if (! isActive)
+    {
+        // reported without being toggled, like a button that does not toggle on click
+        if (listener != nullptr)
+        {
+            listener->channelStateChanged (this, channel, channelStates[channel]);
+            listener->channelSelectionChanged (this);
+        }
+        return;
+    }
 
-        if (isMouseOver)
-            g.setColour(Colours::white);
+    if (isRadioMode)
+    {
+        for (int i = channelStates.findNextSetBit (0); i >= 0; i = channelStates.findNextSetBit (i + 1))
+        {
+            if (i != channel)
+                changeChannel (i, false);
+        }
+
+        // a radio button reports clicks on itself even when it was already selected
+        if (! changeChannel (channel, true) && listener != nullptr)
+            listener->channelStateChanged (this, channel, true);
+    }
+    else if (mods.isShiftDown() && lastClickedChannel >= 0 && lastClickedChannel != channel)
+    {
+        // the range takes the state of the channel it starts from
+        const bool state = channelStates[lastClickedChannel];
+        setChannelRange (jmin (lastClickedChannel, channel), jmax (lastClickedChannel, channel), 1, state, true);
+        lastClickedChannel = channel;
+        return;
     }
     else
     {
-        if (getToggleState() == true)
-            g.setColour(Colours::yellow);
-        else
-            g.setColour(Colours::lightgrey);
+        changeChannel (channel, ! channelStates[channel]);
     }
 
-    // g.fillRect(0,0,getWidth(),getHeight());
+    lastClickedChannel = channel;
 
-    g.setFont(buttonFont);
+    if (listener != nullptr)
+        listener->channelSelectionChanged (this);
+}
+
+
+void ChannelSelectorGrid::mouseMove (const MouseEvent& e)
+{
+    const int channel = getChannelAtPosition (e.getPosition());
+
+    if (channel != mouseOverChannel)
+    {
+        mouseOverChannel = channel;
+        repaint();
+    }
+}
 
-    // g.drawRect(0,0,getWidth(),getHeight(),1.0);
 
-    g.drawText(String(displayNum), 0, 0, getWidth(), getHeight(), Justification::centred, true);
+void ChannelSelectorGrid::mouseExit (const MouseEvent& e)
+{
+    if (mouseOverChannel != -1)
+    {
+        mouseOverChannel = -1;
+        repaint();
+    }
 }
 
-void ChannelSelectorButton::setActive(bool t)
+
+void ChannelSelectorGrid::mouseWheelMove (const MouseEvent& e, const MouseWheelDetails& wheel)
 {
-    isActive = t;
-    setClickingTogglesState(t);
+    const int previousOffset = scrollOffset;
+
+    int rows = roundToInt (wheel.deltaY * 8.0f);
+    if (rows == 0 && wheel.deltaY != 0)
+        rows = wheel.deltaY > 0 ? 1 : -1;
+
+    setScrollOffset (scrollOffset - rows * getRowStep());
+
+    // let the editor scroll when there is nothing left to scroll here
+    if (scrollOffset == previousOffset)
+        Component::mouseWheelMove (e, wheel);
+    else
+        mouseMove (e);
 }
 
 
@@ -26,13 +26,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "../../../JuceLibraryCode/JuceHeader.h"
 #include "../Editors/GenericEditor.h"
-#include "../../UI/Utils/TiledButtonGroupManager.h"
 #include "../Channel/InfoObjects.h"
 
 #include <stdio.h>
 
 class ChannelSelectorRegion;
-class ChannelSelectorButton;
 class EditorButton;
 class ChannelSelectorBox;
 class ShowAlertMessage;
@@ -115,6 +113,114 @@ private:
 };
 
 
+/**
+
+The channels of one of the tabs of the ChannelSelector.
+
+The channel states are kept in a bitset and the grid is drawn from it, only for
+the rows in view, so that neither memory use nor updates grow with the number of
+child components the way one button per channel did. Clicking toggles a channel,
+dragging selects every channel from the one the drag started on (shift+drag
+deselects them), and shift+click sets the range from the last channel clicked
+to the state of that channel.
+
+@see ChannelSelector
+
+*/
+class ChannelSelectorGrid : public Component
+{
+public:
+    ChannelSelectorGrid (int type, const Font& font);
+
+    class Listener
+    {
+    public:
+        virtual ~Listener() {}
+
+        /** Called for every channel clicked, or changed by a notifying setter */
+        virtual void channelStateChanged (ChannelSelectorGrid* grid, int channel, bool state) = 0;
+
+        /** Called once after a click, a drag step or a notifying setter, however many channels it changed */
+        virtual void channelSelectionChanged (ChannelSelectorGrid* grid) = 0;
+
+        /** Called when a channel is right-clicked, without changing its state */
+        virtual void channelMenuRequested (ChannelSelectorGrid* grid, int channel) {}
+    };
+
+    void paint (Graphics& g) override;
+    void resized() override;
+
+    void mouseDown (const MouseEvent& e) override;
+    void mouseDrag (const MouseEvent& e) override;
+    void mouseUp (const MouseEvent& e) override;
+    void mouseMove (const MouseEvent& e) override;
+    void mouseExit (const MouseEvent& e) override;
+    void mouseWheelMove (const MouseEvent& e, const MouseWheelDetails& wheel) override;
+
+    int getType() const;
+
+    /** Channels added get the given state */
+    void setNumChannels (int numChannels, bool newChannelState);
+    int getNumChannels() const;
+
+    /** The number drawn for a channel, which a channel mapper can make different from its index */
+    void setDisplayNumber (int channel, int displayNumber);
+
+    bool getChannelState (int channel) const;
+    void setChannelState (int channel, bool state, bool notify);
+    void setAllChannels (bool state, bool notify);
+
+    /** Sets the state of the channels from first to last, both included, at the given step */
+    void setChannelRange (int first, int last, int step, bool state, bool notify);
+
+    /** Inactive channels are drawn dimmed, and clicking them reports them without toggling them */
+    void setActive (bool isActive);
+
+    /** In radio mode clicking a channel deselects all the others */
+    void setRadioMode (bool isRadioMode);
+
+    void setCellSize (int width, int height);
+
+    void setListener (Listener* listener);
+
+private:
+    int getNumColumns() const;
+    int getColumnStep() const;
+    int getRowStep() const;
+    int getChannelAtPosition (Point<int> position) const;
+    void setScrollOffset (int newOffset);
+
+    /** Changes a channel and tells the listener, if its state was different */
+    bool changeChannel (int channel, bool state);
+
+    void clickChannel (int channel, const ModifierKeys& mods);
+
+    int type;
+    Font font;
+
+    BigInteger channelStates;
+    Array<int> displayNumbers;
+    int numChannels;
+
+    bool isActive;
+    bool isRadioMode;
+
+    int cellWidth;
+    int cellHeight;
+    int scrollOffset;
+
+    int mouseOverChannel;
+    int dragStartChannel;
+    int lastDraggedChannel;
+    int lastClickedChannel;
+    bool isDragging;
+
+    Listener* listener;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ChannelSelectorGrid)
+};
+
+
 /**
 Automatically creates an interactive editor for selecting channels.
 
@@ -127,6 +233,7 @@ channels to be selected for different purposes.
 class PLUGIN_API ChannelSelector : public Component
                                  , public Button::Listener
                                  , private SlicerChannelSelectorComponent::Listener
+                                 , private ChannelSelectorGrid::Listener
                                  , public Timer
 {
 public:
@@ -216,25 +323,22 @@ private:
     EditorButton* allButton;
     EditorButton* noneButton;
 
-    /** An array of ChannelSelectorButtons used to select the channels that
-    will be updated when a parameter is changed.
+    /** The channels that will be updated when a parameter is changed.
     paramBox: TextBox where user input is taken for param tab.
     */
-    TiledButtonGroupManager parameterButtonsManager;
+    ChannelSelectorGrid parameterChannelsGrid;
     SlicerChannelSelectorComponent parameterSlicerChannelSelector;
 
-    /** An array of ChannelSelectorButtons used to select the channels that
-    are sent to the audio monitor.
+    /** The channels that are sent to the audio monitor.
     audioBox: TextBox where user input is taken for audio tab
     */
-    TiledButtonGroupManager audioButtonsManager;
+    ChannelSelectorGrid audioChannelsGrid;
     SlicerChannelSelectorComponent audioSlicerChannelSelector;
 
-    /** An array of ChannelSelectorButtons used to select the channels that
-    will be written to disk when the record button is pressed.
+    /** The channels that will be written to disk when the record button is pressed.
     recordBox: TextBox where user input is taken for record tab
     */
-    TiledButtonGroupManager recordButtonsManager;
+    ChannelSelectorGrid recordChannelsGrid;
     SlicerChannelSelectorComponent recordSlicerChannelSelector;
 
     bool paramsToggled;
@@ -261,10 +365,11 @@ private:
 
     void resized();
 
-    void addButton();
-    void removeButton();
     void refreshButtonBoundaries();
 
+    /** Returns the grid a slicer component selects channels in */
+    ChannelSelectorGrid* getGridForChannelsType (Channels::ChannelsType channelsType);
+
     /** Controls the speed of animations. */
     void timerCallback();
 
@@ -283,6 +388,18 @@ private:
                                                bool isCollapsed)    override;
     // =================================================================================================
 
+    // ChannelSelectorGrid methods
+    // =================================================================================================
+    /** Passes a channel change on to the channel object, the record or audio node, or the editor */
+    void channelStateChanged (ChannelSelectorGrid* grid, int channel, bool state) override;
+
+    void channelSelectionChanged (ChannelSelectorGrid* grid) override;
+
+    /** On the record tab, shows the rates the channel, along with the other recorded ones if it is one of them,
+        can be recorded at */
+    void channelMenuRequested (ChannelSelectorGrid* grid, int channel) override;
+    // =================================================================================================
+
     Font& titleFont;
 
     enum { AUDIO, RECORD, PARAMETER };
@@ -328,39 +445,4 @@ private:
 };
 
 
-/**
-
-A button within the ChannelSelector representing an individual channel.
-
-@see ChannelSelector
-
-*/
-
-class ChannelSelectorButton : public Button
-{
-public:
-    ChannelSelectorButton(int num, int type, Font& f);
-    ~ChannelSelectorButton();
-
-    int getType();
-    int getChannel();
-    //Channel* getChannel() {return ch;}
-    void setActive(bool t);
-    void setChannel(int n);
-    void setChannel(int n, int d);
-
-private:
-    void paintButton(Graphics& g, bool isMouseOver, bool isButtonDown);
-
-    //Channel* ch;
-
-    int type;
-    int num;
-    int displayNum;
-    Font buttonFont;
-    bool isActive;
-};
-
-
-
 #endif  // __CHANNELSELECTOR_H_68124E35__
@@ -401,6 +401,20 @@ void GenericEditor::paint(Graphics& g)
         // else
         g.drawText (displayName.toUpperCase(), 10, 5, 500, 15, Justification::left, false);
 
+        // processing time of the last acquisition, refreshed by the GraphViewer
+        const ProcessorTimingStats::Snapshot timing = getProcessor()->getTimingStats().getSnapshot();
+
+        if (timing.numBlocks > 0)
+        {
+            const String summary = timing.getSummary();
+            const int titleWidth = g.getCurrentFont().getStringWidth (displayName.toUpperCase());
+
+            g.setFont (10);
+
+            if (10 + titleWidth + 8 + g.getCurrentFont().getStringWidth (summary) < getWidth() - 8)
+                g.drawText (summary, 10, 5, getWidth() - 18, 15, Justification::right, false);
+        }
+
     }
     else
     {
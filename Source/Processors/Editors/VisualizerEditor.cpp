@@ -180,6 +180,13 @@ void VisualizerEditor::updateVisualizer()
 
 void VisualizerEditor::windowClosed()
 {
+    getProcessor()->updateIdleState();
+}
+
+
+bool VisualizerEditor::isCanvasOpen() const
+{
+    return tabIndex > -1 || (dataWindow != nullptr && dataWindow->isVisible());
 }
 
 
@@ -266,7 +273,7 @@ void VisualizerEditor::buttonClicked (Button* button)
         }
     }
 
- 
+    getProcessor()->updateIdleState();
 }
 
 
@@ -369,6 +376,8 @@ void VisualizerEditor::removeTab (int tindex)
 {
     AccessClass::getDataViewport()->destroyTab (tindex);
     tabIndex = -1;
+
+    getProcessor()->updateIdleState();
 }
 
 
@@ -377,6 +386,8 @@ int VisualizerEditor::addTab (String textOfTab, Visualizer* contentComponent)
     tabText  = textOfTab;
     tabIndex = AccessClass::getDataViewport()->addTabToDataViewport (textOfTab, contentComponent, this);
 
+    getProcessor()->updateIdleState();
+
     return tabIndex;
 }
 
@@ -116,6 +116,13 @@ public:
 
     virtual void windowClosed();
 
+    /**
+        @brief      Returns true if the canvas is shown in a tab or in a visible window.
+        @details    Whenever this changes, the processor is told to check again
+                    whether it is idle, see GenericProcessor::isIdle().
+    */
+    bool isCanvasOpen() const;
+
     void saveCustomParameters (XmlElement* xml) override;
     void loadCustomParameters (XmlElement* xml) override;
 
@@ -0,0 +1,230 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "EventBlockIndex.h"
+
+//BlockEvent
+
+const uint8* BlockEvent::getData() const
+{
+	return m_data;
+}
+
+int BlockEvent::getDataSize() const
+{
+	return m_dataSize;
+}
+
+int BlockEvent::getSamplePosition() const
+{
+	return m_samplePosition;
+}
+
+EventType BlockEvent::getBaseType() const
+{
+	return static_cast<EventType>(m_baseType);
+}
+
+EventChannel::EventChannelTypes BlockEvent::getEventType() const
+{
+	return static_cast<EventChannel::EventChannelTypes>(m_subType);
+}
+
+SystemEventType BlockEvent::getSystemEventType() const
+{
+	return static_cast<SystemEventType>(m_subType);
+}
+
+int BlockEvent::getChannelIndex() const
+{
+	return m_channelIndex;
+}
+
+uint16 BlockEvent::getSourceID() const
+{
+	return *reinterpret_cast<const uint16*>(m_data + 2);
+}
+
+uint16 BlockEvent::getSubProcessorIdx() const
+{
+	return *reinterpret_cast<const uint16*>(m_data + 4);
+}
+
+uint16 BlockEvent::getSourceIndex() const
+{
+	return *reinterpret_cast<const uint16*>(m_data + 6);
+}
+
+int64 BlockEvent::getTimestamp() const
+{
+	return *reinterpret_cast<const int64*>(m_data + 8);
+}
+
+uint16 BlockEvent::getChannel() const
+{
+	return *reinterpret_cast<const uint16*>(m_data + 16);
+}
+
+const void* BlockEvent::getPayload() const
+{
+	return m_data + EVENT_BASE_SIZE;
+}
+
+bool BlockEvent::getTTLState() const
+{
+	uint16 channel = getChannel();
+	const uint8* word = m_data + EVENT_BASE_SIZE;
+	return (word[channel / 8] & (1 << (channel % 8))) != 0;
+}
+
+MidiMessage BlockEvent::toMidiMessage(int samplePosition) const
+{
+	return MidiMessage(m_data, m_dataSize, samplePosition);
+}
+
+//EventBlockIndex
+
+EventBlockIndex::Iterator::Iterator(const BlockEvent* events, const int* position, const int* end, int channelIndex)
+	: m_events(events), m_position(position), m_end(end), m_channelIndex(channelIndex)
+{
+	skipOtherChannels();
+}
+
+const BlockEvent& EventBlockIndex::Iterator::operator*() const
+{
+	return m_events[*m_position];
+}
+
+const BlockEvent* EventBlockIndex::Iterator::operator->() const
+{
+	return m_events + *m_position;
+}
+
+EventBlockIndex::Iterator& EventBlockIndex::Iterator::operator++()
+{
+	++m_position;
+	skipOtherChannels();
+	return *this;
+}
+
+bool EventBlockIndex::Iterator::operator!=(const Iterator& other) const
+{
+	return m_position != other.m_position;
+}
+
+void EventBlockIndex::Iterator::skipOtherChannels()
+{
+	if (m_channelIndex < 0)
+		return;
+	while (m_position != m_end && m_events[*m_position].m_channelIndex != m_channelIndex)
+		++m_position;
+}
+
+EventBlockIndex::Range::Range(const BlockEvent* events, const int* first, const int* end, int channelIndex)
+	: m_events(events), m_first(first), m_end(end), m_channelIndex(channelIndex)
+{
+}
+
+EventBlockIndex::Iterator EventBlockIndex::Range::begin() const
+{
+	return Iterator(m_events, m_first, m_end, m_channelIndex);
+}
+
+EventBlockIndex::Iterator EventBlockIndex::Range::end() const
+{
+	return Iterator(m_events, m_end, m_end, -1);
+}
+
+bool EventBlockIndex::Range::isEmpty() const
+{
+	return !(begin() != end());
+}
+
+EventBlockIndex::EventBlockIndex()
+{
+}
+
+void EventBlockIndex::clear()
+{
+	m_events.clearQuick();
+	m_processorEvents.clearQuick();
+	m_ttlEvents.clearQuick();
+	m_spikes.clearQuick();
+}
+
+void EventBlockIndex::addEvent(const uint8* data, int dataSize, int samplePosition, int channelIndex)
+{
+	if (dataSize < EVENT_BASE_SIZE)
+		return;
+
+	BlockEvent ev;
+	ev.m_data = data;
+	ev.m_dataSize = dataSize;
+	ev.m_samplePosition = samplePosition;
+	ev.m_channelIndex = channelIndex;
+	//the first bit of the type marks recorded events
+	ev.m_baseType = data[0] & 0x7F;
+	ev.m_subType = data[1];
+
+	int index = m_events.size();
+	m_events.add(ev);
+
+	if (ev.m_baseType == PROCESSOR_EVENT)
+	{
+		m_processorEvents.add(index);
+		if (ev.m_subType == EventChannel::TTL)
+			m_ttlEvents.add(index);
+	}
+	else if (ev.m_baseType == SPIKE_EVENT)
+		m_spikes.add(index);
+}
+
+int EventBlockIndex::getNumEvents() const
+{
+	return m_events.size();
+}
+
+const BlockEvent& EventBlockIndex::operator[](int index) const
+{
+	return m_events.getReference(index);
+}
+
+EventBlockIndex::Range EventBlockIndex::getProcessorEvents(int channelIndex) const
+{
+	return makeRange(m_processorEvents, channelIndex);
+}
+
+EventBlockIndex::Range EventBlockIndex::getTTLEvents(int channelIndex) const
+{
+	return makeRange(m_ttlEvents, channelIndex);
+}
+
+EventBlockIndex::Range EventBlockIndex::getSpikes(int channelIndex) const
+{
+	return makeRange(m_spikes, channelIndex);
+}
+
+EventBlockIndex::Range EventBlockIndex::makeRange(const Array<int>& positions, int channelIndex) const
+{
+	return Range(m_events.begin(), positions.begin(), positions.end(), channelIndex);
+}
@@ -0,0 +1,169 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef EVENTBLOCKINDEX_H_INCLUDED
+#define EVENTBLOCKINDEX_H_INCLUDED
+
+#include "Events.h"
+
+/**
+Fixed-width header of one serialized event of the current block, pointing into the
+packet held by the block's event buffer.
+
+Reading the header fields here avoids building a MidiMessage, which copies the packet
+to the heap, only to look at its first bytes.
+*/
+class PLUGIN_API BlockEvent
+{
+public:
+	/** The serialized packet, laid out as described in Events.h */
+	const uint8* getData() const;
+	int getDataSize() const;
+
+	/** Sample position of the event in the whole block */
+	int getSamplePosition() const;
+
+	EventType getBaseType() const;
+
+	/** Type of a PROCESSOR_EVENT. Meaningless for other base types */
+	EventChannel::EventChannelTypes getEventType() const;
+
+	/** Type of a SYSTEM_EVENT. Meaningless for other base types */
+	SystemEventType getSystemEventType() const;
+
+	/** Index of the event's channel in the processor's event or spike channel array,
+	or -1 if the processor has no such channel (and for system events) */
+	int getChannelIndex() const;
+
+	uint16 getSourceID() const;
+	uint16 getSubProcessorIdx() const;
+	uint16 getSourceIndex() const;
+	int64 getTimestamp() const;
+
+	/** The virtual channel of a processor event, or the sorted ID of a spike */
+	uint16 getChannel() const;
+
+	/** Payload following the common header: the data of a processor event, or the
+	thresholds and waveforms of a spike */
+	const void* getPayload() const;
+
+	/** State of the bit of a TTL event, as TTLEvent::getState() would return it */
+	bool getTTLState() const;
+
+	/** Copies the packet into a MidiMessage, for handleEvent() and handleSpike() and the
+	deserializeFromMessage() methods */
+	MidiMessage toMidiMessage(int samplePosition) const;
+
+private:
+	friend class EventBlockIndex;
+
+	const uint8* m_data;
+	int32 m_dataSize;
+	int32 m_samplePosition;
+	int32 m_channelIndex;
+	uint8 m_baseType;
+	uint8 m_subType;
+};
+
+/**
+Typed index of the events of a block, built by GenericProcessor in the single pass it already
+makes over the event buffer at the start of each block.
+
+Besides the events in buffer order, it keeps the positions of the processor events, TTL events
+and spikes separately, so a processor looking for one kind of event, possibly on a single channel,
+only walks that kind:
+
+for (const BlockEvent& ev : getBlockEvents().getTTLEvents(channelIndex))
+	if (ev.getTTLState()) ...
+
+Storage is kept between blocks, so once it has grown to the usual number of events per block
+building the index allocates nothing.
+
+@see GenericProcessor::getBlockEvents
+*/
+class PLUGIN_API EventBlockIndex
+{
+public:
+	/** Iterates the entries of one of the per-type lists, optionally restricted to one channel index */
+	class PLUGIN_API Iterator
+	{
+	public:
+		Iterator(const BlockEvent* events, const int* position, const int* end, int channelIndex);
+		const BlockEvent& operator*() const;
+		const BlockEvent* operator->() const;
+		Iterator& operator++();
+		bool operator!=(const Iterator& other) const;
+	private:
+		void skipOtherChannels();
+		const BlockEvent* m_events;
+		const int* m_position;
+		const int* m_end;
+		int m_channelIndex;
+	};
+
+	class PLUGIN_API Range
+	{
+	public:
+		Range(const BlockEvent* events, const int* first, const int* end, int channelIndex);
+		Iterator begin() const;
+		Iterator end() const;
+		bool isEmpty() const;
+	private:
+		const BlockEvent* m_events;
+		const int* m_first;
+		const int* m_end;
+		int m_channelIndex;
+	};
+
+	EventBlockIndex();
+
+	/** Empties the index, keeping its storage */
+	void clear();
+
+	/** Adds a packet. channelIndex is the index of its channel in the processor owning the index, or -1 */
+	void addEvent(const uint8* data, int dataSize, int samplePosition, int channelIndex);
+
+	int getNumEvents() const;
+
+	/** Events in buffer order, that is, by sample position */
+	const BlockEvent& operator[](int index) const;
+
+	/** Processor events of any type. A channelIndex of -1 means every channel */
+	Range getProcessorEvents(int channelIndex = -1) const;
+
+	Range getTTLEvents(int channelIndex = -1) const;
+
+	Range getSpikes(int channelIndex = -1) const;
+
+private:
+	Range makeRange(const Array<int>& positions, int channelIndex) const;
+
+	Array<BlockEvent> m_events;
+	Array<int> m_processorEvents;
+	Array<int> m_ttlEvents;
+	Array<int> m_spikes;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EventBlockIndex);
+};
+
+#endif
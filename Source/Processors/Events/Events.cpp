@@ -134,7 +134,13 @@ SystemEventType SystemEvent::getSystemEventType(const MidiMessage& msg)
 	return static_cast<SystemEventType>(*(data + 1));
 }
 
-size_t SystemEvent::fillTimestampAndSamplesData(HeapBlock<char>& data, const GenericProcessor* proc, int16 subProcessorIdx, int64 timestamp, uint32 nSamples)
+size_t SystemEvent::fillTimestampAndSamplesData(HeapBlock<char>& data, const GenericProcessor* proc, int16 subProcessorIdx, int64 timestamp, uint32 nSamples, int64 hostTicks)
+{
+	data.malloc(TIMESTAMP_AND_SAMPLES_SIZE);
+	return fillTimestampAndSamplesData(data.getData(), TIMESTAMP_AND_SAMPLES_SIZE, proc, subProcessorIdx, timestamp, nSamples, hostTicks);
+}
+
+size_t SystemEvent::fillTimestampAndSamplesData(void* dstBuffer, size_t dstSize, const GenericProcessor* proc, int16 subProcessorIdx, int64 timestamp, uint32 nSamples, int64 hostTicks)
 {
 	/** Event packet structure
 	* SYSTEM_EVENT - 1 byte
@@ -144,21 +150,38 @@ size_t SystemEvent::fillTimestampAndSamplesData(HeapBlock<char>& data, const Gen
 	* Zero-fill (to maintain aligment with other events) - 2 bytes
 	* Timestamp - 8 bytes
 	* Buffer sample number - 4 bytes
+	* Zero-fill - 4 bytes
+	* High resolution ticks at which the source processed the block - 8 bytes
 	*/
-	const int eventSize = 20;
-	data.malloc(eventSize);
+	if (dstSize < TIMESTAMP_AND_SAMPLES_SIZE)
+	{
+		jassertfalse;
+		return 0;
+	}
+	char* data = static_cast<char*>(dstBuffer);
 	data[0] = SYSTEM_EVENT;
 	data[1] = TIMESTAMP_AND_SAMPLES;
-	*reinterpret_cast<uint16*>(data.getData() + 2) = proc->getNodeId();
-	*reinterpret_cast<uint16*>(data.getData() + 4) = subProcessorIdx;
+	*reinterpret_cast<uint16*>(data + 2) = proc->getNodeId();
+	*reinterpret_cast<uint16*>(data + 4) = subProcessorIdx;
 	data[6] = 0;
 	data[7] = 0;
-	*reinterpret_cast<int64*>(data.getData() + 8) = timestamp;
-	*reinterpret_cast<uint32*>(data.getData() + 16) = nSamples;
-	return eventSize;
+	*reinterpret_cast<int64*>(data + 8) = timestamp;
+	*reinterpret_cast<uint32*>(data + 16) = nSamples;
+	*reinterpret_cast<uint32*>(data + 20) = 0;
+	*reinterpret_cast<int64*>(data + 24) = hostTicks;
+	return TIMESTAMP_AND_SAMPLES_SIZE;
 }
 
 size_t SystemEvent::fillTimestampSyncTextData(HeapBlock<char>& data, const GenericProcessor* proc, int16 subProcessorIdx, int64 timestamp, bool softwareTime)
+{
+	char buffer[MAX_SYNC_TEXT_SIZE];
+	size_t dataSize = fillTimestampSyncTextData(buffer, MAX_SYNC_TEXT_SIZE, proc, subProcessorIdx, timestamp, softwareTime);
+	data.malloc(dataSize);
+	memcpy(data.getData(), buffer, dataSize);
+	return dataSize;
+}
+
+size_t SystemEvent::fillTimestampSyncTextData(void* dstBuffer, size_t dstSize, const GenericProcessor* proc, int16 subProcessorIdx, int64 timestamp, bool softwareTime)
 {
 	/** Event packet structure
 	* SYSTEM_EVENT - 1 byte
@@ -167,37 +190,41 @@ size_t SystemEvent::fillTimestampSyncTextData(HeapBlock<char>& data, const Gener
 	* Source Subprocessor index - 2 bytes
 	* Zero-fill (to maintain aligment with other events) - 2 bytes
 	* Timestamp - 8 bytes
-	* string - variable
+	* string - variable, null-terminated
 	*/
-	String eventString;
+	if (dstSize < 17)
+	{
+		jassertfalse;
+		return 0;
+	}
+	char* data = static_cast<char*>(dstBuffer);
+	char* text = data + 16;
+	const size_t maxTextSize = dstSize - 17;
+
+	// formatted in place, the same as the String concatenation this replaces
+	int textSize;
 	if (softwareTime)
 	{
-		eventString = "Software time: " + String(timestamp) + "@" + String(Time::getHighResolutionTicksPerSecond()) + "Hz";
+		textSize = snprintf(text, maxTextSize + 1, "Software time: %lld@%lldHz",
+			(long long) timestamp, (long long) Time::getHighResolutionTicksPerSecond());
 	}
 	else
 	{
-		eventString = "Processor: "
-			+ proc->getName()
-			+ " Id: "
-			+ String(proc->getNodeId())
-			+ " subProcessor: "
-			+ String(subProcessorIdx)
-		+" start time: "
-			+ String(timestamp)
-			+ "@"
-			+ String(proc->getSampleRate())
-			+ "Hz";
-	}
-	size_t textSize = eventString.getNumBytesAsUTF8();
-	size_t dataSize = 17 + textSize;
-	data.allocate(dataSize, true);
+		textSize = snprintf(text, maxTextSize + 1, "Processor: %s Id: %d subProcessor: %d start time: %lld@%gHz",
+			proc->getName().toRawUTF8(), (int) proc->getNodeId(), (int) subProcessorIdx,
+			(long long) timestamp, (double) proc->getSampleRate());
+	}
+	textSize = jlimit(0, (int) maxTextSize, textSize);
+	text[textSize] = 0;
+
 	data[0] = SYSTEM_EVENT;
 	data[1] = TIMESTAMP_SYNC_TEXT;
-	*reinterpret_cast<uint16*>(data.getData() + 2) = proc->getNodeId();
-	*reinterpret_cast<uint16*>(data.getData() + 4) = subProcessorIdx;
-	*reinterpret_cast<int64*>(data.getData() + 8) = timestamp;
-	memcpy(data.getData() + 16, eventString.toUTF8(), textSize);
-	return dataSize;
+	*reinterpret_cast<uint16*>(data + 2) = proc->getNodeId();
+	*reinterpret_cast<uint16*>(data + 4) = subProcessorIdx;
+	data[6] = 0;
+	data[7] = 0;
+	*reinterpret_cast<int64*>(data + 8) = timestamp;
+	return 17 + textSize;
 }
 
 uint32 SystemEvent::getNumSamples(const MidiMessage& msg)
@@ -208,6 +235,14 @@ uint32 SystemEvent::getNumSamples(const MidiMessage& msg)
 	return *reinterpret_cast<const uint32*>(msg.getRawData() + 16);
 }
 
+int64 SystemEvent::getHostTicks(const MidiMessage& msg)
+{
+	if (getBaseType(msg) != SYSTEM_EVENT || getSystemEventType(msg) != TIMESTAMP_AND_SAMPLES || msg.getRawDataSize() < 32)
+		return 0;
+
+	return *reinterpret_cast<const int64*>(msg.getRawData() + 24);
+}
+
 String SystemEvent::getSyncText(const MidiMessage& msg)
 {
 	if (getBaseType(msg) != SYSTEM_EVENT && getSystemEventType(msg) != TIMESTAMP_SYNC_TEXT)
@@ -397,10 +432,35 @@ TTLEventPtr TTLEvent::createTTLEvent(const EventChannel* channelInfo, int64 time
 
 	TTLEvent* event = new TTLEvent(channelInfo, timestamp, channel, eventData);
 	
-	event->m_metaDataValues.addArray(metaData);
+	event->setMetaData(channelInfo, metaData);
 	return event;
 }
 
+bool TTLEvent::serializeTTLEvent(void* dstBuffer, size_t dstSize, const EventChannel* channelInfo, int64 timestamp, const void* eventData, uint16 channel)
+{
+	if (!createChecks(channelInfo, EventChannel::TTL, channel))
+		return false;
+
+	size_t dataSize = channelInfo->getDataSize();
+	if (dstSize < dataSize + EVENT_BASE_SIZE)
+	{
+		jassertfalse;
+		return false;
+	}
+
+	//Same layout as Event::serializeHeader
+	char* buffer = static_cast<char*>(dstBuffer);
+	*(buffer + 0) = PROCESSOR_EVENT;
+	*(buffer + 1) = static_cast<char>(EventChannel::TTL);
+	*(reinterpret_cast<uint16*>(buffer + 2)) = channelInfo->getSourceNodeID();
+	*(reinterpret_cast<uint16*>(buffer + 4)) = channelInfo->getSubProcessorIdx();
+	*(reinterpret_cast<uint16*>(buffer + 6)) = channelInfo->getSourceIndex();
+	*(reinterpret_cast<int64*>(buffer + 8)) = timestamp;
+	*(reinterpret_cast<uint16*>(buffer + 16)) = channel;
+	memcpy(buffer + EVENT_BASE_SIZE, eventData, dataSize);
+	return true;
+}
+
 TTLEventPtr TTLEvent::deserializeFromMessage(const MidiMessage& msg, const EventChannel* channelInfo)
 {
 	size_t totalSize = msg.getRawDataSize();
@@ -534,10 +594,51 @@ TextEventPtr TextEvent::createTextEvent(const EventChannel* channelInfo, int64 t
 
 	TextEvent* event = new TextEvent(channelInfo, timestamp, channel, text);
 	
-	event->m_metaDataValues.addArray(metaData);
+	event->setMetaData(channelInfo, metaData);
 	return event;
 }
 
+bool TextEvent::serializeTextEvent(void* dstBuffer, size_t dstSize, const EventChannel* channelInfo, int64 timestamp,
+	const char* text, int textSize, const void* metaData, uint16 channel)
+{
+	if (!channelInfo || channelInfo->getChannelType() != EventChannel::TEXT || channel >= channelInfo->getNumChannels())
+		return false;
+	if (channelInfo->getEventMetaDataCount() != 0 && metaData == nullptr)
+		return false;
+
+	size_t dataSize = channelInfo->getDataSize();
+	size_t metaDataSize = channelInfo->getEventMetaDataCount() != 0 ? channelInfo->getTotalEventMetaDataSize() : 0;
+	if (dstSize < dataSize + EVENT_BASE_SIZE + metaDataSize)
+	{
+		jassertfalse;
+		return false;
+	}
+
+	//Same layout as Event::serializeHeader
+	char* buffer = static_cast<char*>(dstBuffer);
+	*(buffer + 0) = PROCESSOR_EVENT;
+	*(buffer + 1) = static_cast<char>(EventChannel::TEXT);
+	*(reinterpret_cast<uint16*>(buffer + 2)) = channelInfo->getSourceNodeID();
+	*(reinterpret_cast<uint16*>(buffer + 4)) = channelInfo->getSubProcessorIdx();
+	*(reinterpret_cast<uint16*>(buffer + 6)) = channelInfo->getSourceIndex();
+	*(reinterpret_cast<int64*>(buffer + 8)) = timestamp;
+	*(reinterpret_cast<uint16*>(buffer + 16)) = channel;
+
+	//Like String::copyToUTF8, room is kept for the terminating null and no character is split
+	const size_t available = (textSize >= 0) ? (size_t) textSize : strlen(text);
+	size_t copied = jmin(available, dataSize > 0 ? dataSize - 1 : 0);
+	if (copied < available)
+	{
+		while (copied > 0 && (static_cast<uint8>(text[copied]) & 0xC0) == 0x80)
+			--copied;
+	}
+	memcpy(buffer + EVENT_BASE_SIZE, text, copied);
+	zeromem(buffer + EVENT_BASE_SIZE + copied, dataSize - copied);
+	if (metaDataSize > 0)
+		memcpy(buffer + EVENT_BASE_SIZE + dataSize, metaData, metaDataSize);
+	return true;
+}
+
 TextEventPtr TextEvent::deserializeFromMessage(const MidiMessage& msg, const EventChannel* channelInfo)
 {
 	size_t totalSize = msg.getRawDataSize();
@@ -708,7 +809,7 @@ BinaryEventPtr BinaryEvent::createBinaryEvent(const EventChannel* channelInfo, i
 	}
 
 	BinaryEvent* event = new BinaryEvent(channelInfo, timestamp, channel, data, type);
-	event->m_metaDataValues.addArray(metaData);
+	event->setMetaData(channelInfo, metaData);
 	return event;
 }
 
@@ -933,14 +1034,18 @@ SpikeEventPtr SpikeEvent::createSpikeEvent(const SpikeChannel* channelInfo, int6
 		return nullptr;
 	}
 
-	event->m_metaDataValues.addArray(metaData);
+	event->setMetaData(channelInfo, metaData);
 	return event;
 }
 
 SpikeEventPtr SpikeEvent::deserializeFromMessage(const MidiMessage& msg, const SpikeChannel* channelInfo)
+{
+	return deserializeFromData(msg.getRawData(), msg.getRawDataSize(), channelInfo);
+}
+
+bool SpikeEvent::checkSerializedSpike(const uint8* buffer, size_t totalSize, const SpikeChannel* channelInfo)
 {
 	int nChans = channelInfo->getNumChannels();
-	size_t totalSize = msg.getRawDataSize();
 	size_t dataSize = channelInfo->getDataSize();
 	size_t thresholdSize = nChans*sizeof(float);
 	size_t metaDataSize = channelInfo->getTotalEventMetaDataSize();
@@ -948,44 +1053,55 @@ SpikeEventPtr SpikeEvent::deserializeFromMessage(const MidiMessage& msg, const S
 	if (channelInfo->getChannelType() == SpikeChannel::INVALID)
 	{
 		jassertfalse;
-		return nullptr;
+		return false;
 	}
 
 	if (totalSize != (thresholdSize + dataSize + SPIKE_BASE_SIZE + metaDataSize))
 	{
 		jassertfalse;
-		return nullptr;
+		return false;
 	}
-	const uint8* buffer = msg.getRawData();
 	//TODO: remove the mask when the probe system is implemented
 	if (static_cast<EventType>(*(buffer + 0)&0x7F) != SPIKE_EVENT)
 	{
 		jassertfalse;
-		return nullptr;
+		return false;
 	}
 
 	if (static_cast<SpikeChannel::ElectrodeTypes>(*(buffer + 1)) != channelInfo->getChannelType())
 	{
 		jassertfalse;
-		return nullptr;
+		return false;
 	}
 
 	if (*reinterpret_cast<const uint16*>(buffer + 2) != channelInfo->getSourceNodeID())
 	{
 		jassertfalse;
-		return nullptr;
+		return false;
 	}
 
 	if (*reinterpret_cast<const uint16*>(buffer + 4) != channelInfo->getSubProcessorIdx())
 	{
 		jassertfalse;
-		return nullptr;
+		return false;
 	}
 	if (*reinterpret_cast<const uint16*>(buffer + 6) != channelInfo->getSourceIndex())
 	{
 		jassertfalse;
-		return nullptr;
+		return false;
 	}
+	return true;
+}
+
+SpikeEventPtr SpikeEvent::deserializeFromData(const uint8* buffer, size_t totalSize, const SpikeChannel* channelInfo)
+{
+	if (!checkSerializedSpike(buffer, totalSize, channelInfo))
+		return nullptr;
+
+	int nChans = channelInfo->getNumChannels();
+	size_t dataSize = channelInfo->getDataSize();
+	size_t thresholdSize = nChans*sizeof(float);
+	size_t metaDataSize = channelInfo->getTotalEventMetaDataSize();
 
 	int64 timestamp = *(reinterpret_cast<const int64*>(buffer + 8));
 	uint16 sortedID = *(reinterpret_cast<const uint16*>(buffer + 16));
@@ -1047,7 +1163,7 @@ void  SpikeEvent::SpikeBuffer::set(const int chan, const float* source, const in
 		return;
 	}
 	jassert(chan >= 0 && chan < m_nChans && n <= m_nSamps);
-	memcpy(m_data.getData(), source, n*sizeof(float));
+	memcpy(m_data.getData() + chan*m_nSamps, source, n*sizeof(float));
 }
 
 void  SpikeEvent::SpikeBuffer::set(const int chan, const int start, const float* source, const int n)
@@ -1058,7 +1174,7 @@ void  SpikeEvent::SpikeBuffer::set(const int chan, const int start, const float*
 		return;
 	}
 	jassert(chan >= 0 && chan < m_nChans && (n + start) <= m_nSamps);
-	memcpy(m_data.getData() + start, source, n*sizeof(float));
+	memcpy(m_data.getData() + chan*m_nSamps + start, source, n*sizeof(float));
 }
 
 float SpikeEvent::SpikeBuffer::get(const int chan, const int samp)
@@ -1115,3 +1231,84 @@ template PLUGIN_API BinaryEventPtr BinaryEvent::createBinaryEvent<int64>(const E
 template PLUGIN_API BinaryEventPtr BinaryEvent::createBinaryEvent<uint64>(const EventChannel*, int64, const uint64* data, int, const MetaDataValueArray&, uint16);
 template PLUGIN_API BinaryEventPtr BinaryEvent::createBinaryEvent<float>(const EventChannel*, int64, const float* data, int, const MetaDataValueArray&, uint16);
 template PLUGIN_API BinaryEventPtr BinaryEvent::createBinaryEvent<double>(const EventChannel*, int64, const double* data, int, const MetaDataValueArray&, uint16);
+
+//SpikeEventView
+SpikeEventView::SpikeEventView(const MidiMessage& msg, const SpikeChannel* channelInfo)
+	: SpikeEventView(msg.getRawData(), msg.getRawDataSize(), channelInfo)
+{
+}
+
+SpikeEventView::SpikeEventView(const void* data, size_t dataSize, const SpikeChannel* channelInfo)
+	: m_data(static_cast<const uint8*>(data)),
+	m_dataSize(dataSize),
+	m_channelInfo(channelInfo)
+{
+	m_valid = channelInfo != nullptr && SpikeEvent::checkSerializedSpike(m_data, m_dataSize, channelInfo);
+}
+
+bool SpikeEventView::isValid() const
+{
+	return m_valid;
+}
+
+const SpikeChannel* SpikeEventView::getChannelInfo() const
+{
+	return m_channelInfo;
+}
+
+int64 SpikeEventView::getTimestamp() const
+{
+	return *reinterpret_cast<const int64*>(m_data + 8);
+}
+
+uint16 SpikeEventView::getSourceID() const
+{
+	return *reinterpret_cast<const uint16*>(m_data + 2);
+}
+
+uint16 SpikeEventView::getSubProcessorIdx() const
+{
+	return *reinterpret_cast<const uint16*>(m_data + 4);
+}
+
+uint16 SpikeEventView::getSourceIndex() const
+{
+	return *reinterpret_cast<const uint16*>(m_data + 6);
+}
+
+uint16 SpikeEventView::getSortedID() const
+{
+	return *reinterpret_cast<const uint16*>(m_data + 16);
+}
+
+float SpikeEventView::getThreshold(int chan) const
+{
+	if ((chan < 0) || (chan >= (int) m_channelInfo->getNumChannels()))
+	{
+		jassertfalse;
+		return 0;
+	}
+	return reinterpret_cast<const float*>(m_data + SPIKE_BASE_SIZE)[chan];
+}
+
+const float* SpikeEventView::getDataPointer() const
+{
+	return reinterpret_cast<const float*>(m_data + SPIKE_BASE_SIZE + m_channelInfo->getNumChannels()*sizeof(float));
+}
+
+const float* SpikeEventView::getDataPointer(int channel) const
+{
+	if ((channel < 0) || (channel >= (int) m_channelInfo->getNumChannels()))
+	{
+		jassertfalse;
+		return nullptr;
+	}
+	return getDataPointer() + channel*m_channelInfo->getTotalSamples();
+}
+
+SpikeEventPtr SpikeEventView::createSpikeEvent() const
+{
+	if (!m_valid)
+		return nullptr;
+	return SpikeEvent::deserializeFromData(m_data, m_dataSize, m_channelInfo);
+}
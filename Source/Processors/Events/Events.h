@@ -63,6 +63,7 @@ class TTLEvent;
 class TextEvent;
 class BinaryEvent;
 class SpikeEvent;
+class SpikeEventView;
 
 enum EventType
 {
@@ -118,10 +119,25 @@ class PLUGIN_API SystemEvent
 	: public EventBase
 {
 public:
-	static size_t fillTimestampAndSamplesData(HeapBlock<char>& data, const GenericProcessor* proc, int16 subProcessorIdx, int64 timestamp, uint32 nSamples);
+	enum
+	{
+		TIMESTAMP_AND_SAMPLES_SIZE = 32,
+		/** Longer sync texts are cut */
+		MAX_SYNC_TEXT_SIZE = 256
+	};
+
+	static size_t fillTimestampAndSamplesData(HeapBlock<char>& data, const GenericProcessor* proc, int16 subProcessorIdx, int64 timestamp, uint32 nSamples, int64 hostTicks = 0);
 	static size_t fillTimestampSyncTextData(HeapBlock<char>& data, const GenericProcessor* proc, int16 subProcessorIdx, int64 timestamp, bool softwareTime = false);
+
+	/** Versions of the above writing to a buffer of dstSize bytes, at least TIMESTAMP_AND_SAMPLES_SIZE
+	or MAX_SYNC_TEXT_SIZE, instead of allocating one. They allocate nothing, so they are the ones to use
+	during acquisition. Return the size of the event, or 0 if the buffer is too small. */
+	static size_t fillTimestampAndSamplesData(void* dstBuffer, size_t dstSize, const GenericProcessor* proc, int16 subProcessorIdx, int64 timestamp, uint32 nSamples, int64 hostTicks = 0);
+	static size_t fillTimestampSyncTextData(void* dstBuffer, size_t dstSize, const GenericProcessor* proc, int16 subProcessorIdx, int64 timestamp, bool softwareTime = false);
 	static SystemEventType getSystemEventType(const MidiMessage& msg);
 	static uint32 getNumSamples(const MidiMessage& msg);
+	/** Returns the high resolution ticks at which the source sent its block, or 0 if unknown */
+	static int64 getHostTicks(const MidiMessage& msg);
 	static String getSyncText(const MidiMessage& msg);
 private:
 	SystemEvent() = delete;
@@ -183,6 +199,11 @@ public:
 	static TTLEventPtr createTTLEvent(const EventChannel* channelInfo, int64 timestamp, const void* eventData, int dataSize, uint16 channel);
 	static TTLEventPtr createTTLEvent(const EventChannel* channelInfo, int64 timestamp, const void* eventData, int dataSize, const MetaDataValueArray& metaData, uint16 channel);
 	static TTLEventPtr deserializeFromMessage(const MidiMessage& msg, const EventChannel* channelInfo);
+
+	/** Writes the same bytes serialize() would for an event built with the metadata-less createTTLEvent(),
+	without creating the event object. dstSize must be at least the channel data size plus EVENT_BASE_SIZE.
+	Returns false if the event could not be created (invalid channel, or a channel with event metadata) */
+	static bool serializeTTLEvent(void* dstBuffer, size_t dstSize, const EventChannel* channelInfo, int64 timestamp, const void* eventData, uint16 channel);
 private:
 	TTLEvent() = delete;
 	TTLEvent(const EventChannel* channelInfo, int64 timestamp, uint16 channel, const void* eventData);
@@ -205,6 +226,15 @@ public:
 	static TextEventPtr createTextEvent(const EventChannel* channelInfo, int64 timestamp, const String& text, uint16 channel = 0);
 	static TextEventPtr createTextEvent(const EventChannel* channelInfo, int64 timestamp, const String& text, const MetaDataValueArray& metaData, uint16 channel = 0);
 	static TextEventPtr deserializeFromMessage(const MidiMessage& msg, const EventChannel* channelInfo);
+
+	/** Writes the same bytes serialize() would for an event built with createTextEvent(), without creating
+	the event object or a String. The UTF-8 text, textSize bytes long or null-terminated if textSize is -1,
+	is cut at the last whole character fitting the channel's data size. metaData holds the channel's metadata
+	values back to back, getTotalEventMetaDataSize() bytes, and may only be nullptr if the channel has none.
+	dstSize must be at least the channel data size plus EVENT_BASE_SIZE plus the metadata size.
+	Returns false if the event could not be created (invalid channel, or missing metadata) */
+	static bool serializeTextEvent(void* dstBuffer, size_t dstSize, const EventChannel* channelInfo, int64 timestamp,
+		const char* text, int textSize = -1, const void* metaData = nullptr, uint16 channel = 0);
 private:
 	TextEvent() = delete;
 	TextEvent(const EventChannel* channelInfo, int64 timestamp, uint16 channel, const String& text);
@@ -301,9 +331,13 @@ public:
 
 	static SpikeEventPtr deserializeFromMessage(const MidiMessage& msg, const SpikeChannel* channelInfo);
 private:
+	friend class SpikeEventView;
 	SpikeEvent() = delete;
 	SpikeEvent(const SpikeChannel* channelInfo, int64 timestamp, Array<float> thresholds, HeapBlock<float>& data, uint16 sortedID);
 	static SpikeEvent* createBasicSpike(const SpikeChannel* channelInfo, int64 timestamp, Array<float> threshold, SpikeBuffer& dataSource, uint16 sortedID);
+	/** Checks that a serialized spike matches its channel */
+	static bool checkSerializedSpike(const uint8* buffer, size_t totalSize, const SpikeChannel* channelInfo);
+	static SpikeEventPtr deserializeFromData(const uint8* buffer, size_t totalSize, const SpikeChannel* channelInfo);
 
 	const Array<float> m_thresholds;
 	const SpikeChannel* m_channelInfo;
@@ -312,5 +346,48 @@ private:
 	JUCE_LEAK_DETECTOR(SpikeEvent);
 };
 
+/**
+Non-owning view of a serialized spike, reading its fields in place.
+
+Unlike SpikeEvent::deserializeFromMessage(), building a view allocates nothing, which matters
+for processors that look at every spike but keep few of them. The view is only valid as long
+as the message or buffer it was built from, typically for the duration of handleSpike().
+createSpikeEvent() makes an owning copy of the spikes worth keeping.
+*/
+class PLUGIN_API SpikeEventView
+{
+public:
+	SpikeEventView(const MidiMessage& msg, const SpikeChannel* channelInfo);
+	SpikeEventView(const void* data, size_t dataSize, const SpikeChannel* channelInfo);
+
+	/** False if the data is not a spike of the given channel, in which case nothing else may be called */
+	bool isValid() const;
+
+	const SpikeChannel* getChannelInfo() const;
+	int64 getTimestamp() const;
+	uint16 getSourceID() const;
+	uint16 getSubProcessorIdx() const;
+	uint16 getSourceIndex() const;
+	uint16 getSortedID() const;
+
+	float getThreshold(int chan) const;
+
+	/** The waveforms, one channel after the other, as in SpikeEvent::getDataPointer(). The samples
+	follow an 18-byte header and are not necessarily 4-byte aligned. */
+	const float* getDataPointer() const;
+	const float* getDataPointer(int channel) const;
+
+	/** Deep copy, including the metadata */
+	SpikeEventPtr createSpikeEvent() const;
+
+private:
+	SpikeEventView() = delete;
+
+	const uint8* m_data;
+	size_t m_dataSize;
+	const SpikeChannel* m_channelInfo;
+	bool m_valid;
+};
+
 
 #endif
\ No newline at end of file
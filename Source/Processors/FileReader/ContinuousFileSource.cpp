@@ -0,0 +1,443 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "ContinuousFileSource.h"
+#include "../RecordNode/OriginalRecording.h"
+
+// fewer channels than this per thread are decoded faster by the calling thread alone
+#define CONTINUOUS_MIN_CHANNELS_PER_JOB 8
+#define CONTINUOUS_MAX_DECODE_THREADS   4
+
+
+/** Returns the value of "header.<key> = <value>;" in a .continuous header, without its quotes */
+static String getHeaderValue (const String& header, const String& key)
+{
+    const String field = "header." + key + " = ";
+    const int start = header.indexOf (field);
+
+    if (start < 0)
+        return String::empty;
+
+    return header.substring (start + field.length())
+                 .upToFirstOccurrenceOf (";", false, false)
+                 .trim()
+                 .unquoted();
+}
+
+
+/** Returns "_2" for 100_CH1_2.continuous, a channel of the second experiment, or an empty string for the first */
+static String getExperimentSuffix (const File& file)
+{
+    const String name = file.getFileNameWithoutExtension();
+    const String channel = name.upToLastOccurrenceOf ("_", false, false);
+    const String number = name.fromLastOccurrenceOf ("_", false, false);
+
+    if (channel.containsChar ('_') && number.isNotEmpty() && number.containsOnly ("0123456789"))
+        return "_" + number;
+
+    return String::empty;
+}
+
+
+static int getNumDecodeThreads()
+{
+    return jlimit (1, CONTINUOUS_MAX_DECODE_THREADS, SystemStats::getNumCpus() - 1);
+}
+
+
+ContinuousFileSource::DecodeJob::DecodeJob()
+    : ThreadPoolJob ("Continuous file decoding")
+{
+}
+
+
+ThreadPoolJob::JobStatus ContinuousFileSource::DecodeJob::runJob()
+{
+    source->decodeChannels (buffer, startSample, numSamples, firstChannel, lastChannel);
+    return jobHasFinished;
+}
+
+
+ContinuousFileSource::ContinuousFileSource()
+    : sampleRate        (0)
+    , activeFirstRecord (0)
+    , samplePos         (0)
+    , pool              (getNumDecodeThreads())
+{
+    // the calling thread decodes its share too
+    for (int i = 0; i <= getNumDecodeThreads(); ++i)
+        jobs.add (new DecodeJob());
+}
+
+
+ContinuousFileSource::~ContinuousFileSource()
+{
+    pool.removeAllJobs (true, -1);
+}
+
+
+bool ContinuousFileSource::Open (File file)
+{
+    FileInputStream stream (file);
+
+    if (stream.failedToOpen())
+        return false;
+
+    HeapBlock<char> headerBytes (HEADER_SIZE + 1, true);
+    if (stream.read (headerBytes, HEADER_SIZE) != HEADER_SIZE)
+        return false;
+
+    const String header (CharPointer_UTF8 (headerBytes.getData()));
+
+    if (getHeaderValue (header, "format") != "Open Ephys Data Format"
+        || getHeaderValue (header, "header_bytes").getIntValue() != HEADER_SIZE
+        || getHeaderValue (header, "blockLength").getIntValue() != BLOCK_LENGTH)
+    {
+        std::cerr << file.getFullPathName() << " is not a continuous file of the Open Ephys format" << std::endl;
+        return false;
+    }
+
+    sampleRate = getHeaderValue (header, "sampleRate").getFloatValue();
+    channelFiles.clear();
+
+    if (! readChannelList (file))
+    {
+        ChannelFile* channel = new ChannelFile();
+        channel->name = getHeaderValue (header, "channel");
+        channel->bitVolts = getHeaderValue (header, "bitVolts").getFloatValue();
+        channel->file = file;
+        channelFiles.add (channel);
+    }
+
+    for (int i = 0; i < channelFiles.size(); ++i)
+    {
+        ChannelFile* channel = channelFiles[i];
+        channel->map = new MemoryMappedFile (channel->file, MemoryMappedFile::readOnly);
+
+        if (channel->map->getData() == nullptr || channel->map->getSize() < HEADER_SIZE)
+        {
+            std::cerr << "Could not map " << channel->file.getFullPathName() << std::endl;
+            channelFiles.clear();
+            return false;
+        }
+    }
+
+    buildRecordIndex();
+
+    return recordings.size() > 0;
+}
+
+
+bool ContinuousFileSource::readChannelList (const File& file)
+{
+    Array<File> structureFiles;
+    file.getParentDirectory().findChildFiles (structureFiles, File::findFiles, false, "Continuous_Data*.openephys");
+
+    for (int f = 0; f < structureFiles.size(); ++f)
+    {
+        ScopedPointer<XmlElement> xml = XmlDocument::parse (structureFiles[f]);
+
+        if (xml == nullptr || ! xml->hasTagName ("EXPERIMENT"))
+            continue;
+
+        forEachXmlChildElementWithTagName (*xml, recording, "RECORDING")
+        {
+            forEachXmlChildElementWithTagName (*recording, processor, "PROCESSOR")
+            {
+                if (processor->getChildByAttribute ("filename", file.getFileName()) == nullptr)
+                    continue;
+
+                forEachXmlChildElementWithTagName (*processor, channelXml, "CHANNEL")
+                {
+                    const File channelFile = file.getSiblingFile (channelXml->getStringAttribute ("filename"));
+
+                    if (! channelFile.existsAsFile())
+                        continue;
+
+                    ChannelFile* channel = new ChannelFile();
+                    channel->name = channelXml->getStringAttribute ("name");
+                    channel->bitVolts = float (channelXml->getDoubleAttribute ("bitVolts", 1.0));
+                    channel->file = channelFile;
+                    channelFiles.add (channel);
+                }
+
+                return channelFiles.size() > 0;
+            }
+        }
+    }
+
+    return false;
+}
+
+
+void ContinuousFileSource::buildRecordIndex()
+{
+    recordings.clear();
+
+    int64 numRecords = std::numeric_limits<int64>::max();
+    for (int i = 0; i < channelFiles.size(); ++i)
+        numRecords = jmin (numRecords, int64 (channelFiles[i]->map->getSize() - HEADER_SIZE) / RECORD_BYTES);
+
+    const uint8* records = static_cast<const uint8*> (channelFiles[0]->map->getData()) + HEADER_SIZE;
+
+    for (int64 r = 0; r < numRecords; ++r)
+    {
+        const uint8* record = records + r * RECORD_BYTES;
+
+        // records are always written full, anything else means the file is cut short or damaged from here
+        if (ByteOrder::littleEndianShort (record + 8) != BLOCK_LENGTH)
+            break;
+
+        const int recordingNumber = ByteOrder::littleEndianShort (record + 10);
+
+        if (recordings.size() == 0 || recordings.getLast().recordingNumber != recordingNumber)
+        {
+            RecordingIndex index;
+            index.recordingNumber = recordingNumber;
+            index.firstRecord = r;
+            index.numRecords = 0;
+            index.firstTimestamp = int64 (ByteOrder::littleEndianInt64 (record));
+            recordings.add (index);
+        }
+
+        ++recordings.getReference (recordings.size() - 1).numRecords;
+    }
+}
+
+
+void ContinuousFileSource::fillRecordInfo()
+{
+    for (int i = 0; i < recordings.size(); ++i)
+    {
+        RecordInfo info;
+        info.name = "Recording " + String (recordings[i].recordingNumber);
+        info.numSamples = recordings[i].numRecords * BLOCK_LENGTH;
+        info.sampleRate = sampleRate;
+
+        for (int c = 0; c < channelFiles.size(); ++c)
+        {
+            RecordedChannelInfo channel;
+            channel.name = channelFiles[c]->name;
+            channel.bitVolts = channelFiles[c]->bitVolts;
+            info.channels.add (channel);
+        }
+
+        infoArray.add (info);
+        ++numRecords;
+    }
+}
+
+
+void ContinuousFileSource::updateActiveRecord()
+{
+    activeFirstRecord = recordings[activeRecord.get()].firstRecord;
+    samplePos = 0;
+}
+
+
+void ContinuousFileSource::fillEventInfo()
+{
+    const File& file = channelFiles[0]->file;
+    const String suffix = getExperimentSuffix (file);
+
+    readTTLEvents (file.getSiblingFile ("all_channels" + suffix + ".events"));
+    readMessages (file.getSiblingFile ("messages" + suffix + ".events"));
+}
+
+
+void ContinuousFileSource::readTTLEvents (const File& file)
+{
+    MemoryMappedFile map (file, MemoryMappedFile::readOnly);
+
+    if (map.getData() == nullptr || map.getSize() < HEADER_SIZE)
+        return;
+
+    // timestamp, sample position, type, processor, state, channel and recording number
+    const int eventBytes = 16;
+    const int64 numEvents = int64 (map.getSize() - HEADER_SIZE) / eventBytes;
+    const uint8* events = static_cast<const uint8*> (map.getData()) + HEADER_SIZE;
+
+    // a track for each processor, with as many lines as the highest channel it used
+    int processorTracks[256];
+    for (int i = 0; i < 256; ++i)
+        processorTracks[i] = -1;
+
+    for (int64 i = 0; i < numEvents; ++i)
+    {
+        const uint8* event = events + i * eventBytes;
+
+        if (event[10] != EventChannel::TTL)
+            continue;
+
+        const int processor = event[11];
+        const int line = event[13];
+        const int record = findRecord (int64 (ByteOrder::littleEndianInt64 (event)), ByteOrder::littleEndianShort (event + 14));
+
+        if (record < 0 || line >= 64)
+            continue;
+
+        if (processorTracks[processor] < 0)
+            processorTracks[processor] = addEventTrack (RecordedEventTrack::TTL, "Processor " + String (processor) + " TTL", 0);
+
+        const int track = processorTracks[processor];
+        eventTracks.getReference (track).size = jmax (eventTracks[track].size, line + 1);
+
+        addTTLEvent (record, track, int64 (ByteOrder::littleEndianInt64 (event)) - recordings[record].firstTimestamp,
+                     line, event[12] != 0);
+    }
+}
+
+
+void ContinuousFileSource::readMessages (const File& file)
+{
+    StringArray lines;
+    file.readLines (lines);
+
+    int track = -1;
+
+    // "<timestamp> <text>" lines, without recording numbers
+    for (int i = 0; i < lines.size(); ++i)
+    {
+        const String& line = lines[i];
+        const String timestampText = line.upToFirstOccurrenceOf (" ", false, false);
+
+        if (timestampText.isEmpty() || ! timestampText.containsOnly ("0123456789"))
+            continue;
+
+        const int64 timestamp = timestampText.getLargeIntValue();
+        const int record = findRecord (timestamp, -1);
+
+        if (record < 0)
+            continue;
+
+        if (track < 0)
+            track = addEventTrack (RecordedEventTrack::TEXT, "Messages", 1);
+
+        addTextEvent (record, track, timestamp - recordings[record].firstTimestamp,
+                      line.fromFirstOccurrenceOf (" ", false, false));
+    }
+}
+
+
+int ContinuousFileSource::findRecord (int64 timestamp, int recordingNumber) const
+{
+    for (int i = 0; i < recordings.size(); ++i)
+    {
+        const RecordingIndex& recording = recordings.getReference (i);
+
+        if ((recordingNumber < 0 || recording.recordingNumber == recordingNumber)
+            && timestamp >= recording.firstTimestamp
+            && timestamp < recording.firstTimestamp + recording.numRecords * BLOCK_LENGTH)
+            return i;
+    }
+
+    return -1;
+}
+
+
+void ContinuousFileSource::seekTo (int64 sample)
+{
+    // an empty recording has no position to wrap around
+    const int64 numSamples = getActiveNumSamples();
+    samplePos = (numSamples > 0) ? sample % numSamples : 0;
+}
+
+
+int ContinuousFileSource::readData (int16* buffer, int nSamples)
+{
+    const int samplesToRead = int (jmin (int64 (nSamples), getActiveNumSamples() - samplePos));
+
+    if (samplesToRead <= 0)
+        return 0;
+
+    const int numChannels = channelFiles.size();
+    const int numJobs = jlimit (1, jobs.size(), numChannels / CONTINUOUS_MIN_CHANNELS_PER_JOB);
+
+    for (int j = 0; j < numJobs; ++j)
+    {
+        DecodeJob* job = jobs[j];
+        job->source = this;
+        job->buffer = buffer;
+        job->startSample = samplePos;
+        job->numSamples = samplesToRead;
+        job->firstChannel = int (int64 (numChannels) * j / numJobs);
+        job->lastChannel = int (int64 (numChannels) * (j + 1) / numJobs);
+
+        if (j > 0)
+            pool.addJob (job, false);
+    }
+
+    jobs[0]->runJob();
+
+    for (int j = 1; j < numJobs; ++j)
+        pool.waitForJobToFinish (jobs[j], -1);
+
+    samplePos += samplesToRead;
+    return samplesToRead;
+}
+
+
+void ContinuousFileSource::decodeChannels (int16* buffer, int64 startSample, int numSamples,
+                                           int firstChannel, int lastChannel) const
+{
+    const int numChannels = channelFiles.size();
+
+    for (int c = firstChannel; c < lastChannel; ++c)
+    {
+        const uint8* records = static_cast<const uint8*> (channelFiles[c]->map->getData()) + HEADER_SIZE;
+        int16* out = buffer + c;
+        int64 sample = startSample;
+        int samplesLeft = numSamples;
+
+        while (samplesLeft > 0)
+        {
+            const int64 record = activeFirstRecord + sample / BLOCK_LENGTH;
+            const int offset = int (sample % BLOCK_LENGTH);
+            const int count = jmin (samplesLeft, BLOCK_LENGTH - offset);
+            const uint8* samples = records + record * RECORD_BYTES + RECORD_HEADER_BYTES + 2 * offset;
+
+            for (int i = 0; i < count; ++i)
+                out[i * numChannels] = int16 (ByteOrder::bigEndianShort (samples + 2 * i));
+
+            out += count * numChannels;
+            sample += count;
+            samplesLeft -= count;
+        }
+    }
+}
+
+
+void ContinuousFileSource::processChannelData (int16* inBuffer, float* outBuffer, int channel, int64 numSamples)
+{
+    const int n = channelFiles.size();
+    const float bitVolts = getChannelInfo (channel).bitVolts;
+
+    for (int i = 0; i < numSamples; ++i)
+        outBuffer[i] = inBuffer[n * i + channel] * bitVolts;
+}
+
+
+void ContinuousFileSource::processAllChannelsData (int16* inBuffer, float* const* outBuffers, int64 numSamples)
+{
+    deinterleaveChannels (inBuffer, outBuffers, activeBitVolts.getRawDataPointer(), channelFiles.size(), numSamples);
+}
@@ -0,0 +1,126 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef CONTINUOUSFILESOURCE_H_INCLUDED
+#define CONTINUOUSFILESOURCE_H_INCLUDED
+
+#include "FileSource.h"
+
+
+/**
+    Reads the .continuous files of the Open Ephys format written by OriginalRecording.
+
+    Every channel has a file of its own: a text header, then records of a timestamp, a sample count,
+    a recording number and BLOCK_LENGTH big-endian samples. All channel files of the processor are
+    memory-mapped, and their records are indexed by recording number once when opening, each recording
+    becoming a record of the source, so that finding a sample takes no reads. The channels are those
+    listed along with the chosen file in the Continuous_Data.openephys files of its folder, or only the
+    chosen file if there are none.
+
+    The TTL events of the all_channels.events file of the same experiment are indexed when opening, as a
+    track for each processor that sent some, along with the texts of its messages.events file.
+
+    readData decodes the samples of all channels into the interleaved layout the File Reader expects,
+    spreading the channels over a few threads.
+
+    @see OriginalRecording
+*/
+class ContinuousFileSource : public FileSource
+{
+public:
+    ContinuousFileSource();
+    ~ContinuousFileSource();
+
+    int readData (int16* buffer, int nSamples) override;
+    void seekTo (int64 sample) override;
+
+    void processChannelData (int16* inBuffer, float* outBuffer, int channel, int64 numSamples) override;
+    void processAllChannelsData (int16* inBuffer, float* const* outBuffers, int64 numSamples) override;
+
+
+private:
+    bool Open (File file) override;
+    void fillRecordInfo() override;
+    void updateActiveRecord() override;
+    void fillEventInfo() override;
+
+    struct ChannelFile
+    {
+        String name;
+        float bitVolts;
+        File file;
+        ScopedPointer<MemoryMappedFile> map;
+    };
+
+    /** A run of records [firstRecord, firstRecord + numRecords) of the same recording number */
+    struct RecordingIndex
+    {
+        int recordingNumber;
+        int64 firstRecord;
+        int64 numRecords;
+        int64 firstTimestamp;
+    };
+
+    class DecodeJob : public ThreadPoolJob
+    {
+    public:
+        DecodeJob();
+        JobStatus runJob() override;
+
+        const ContinuousFileSource* source;
+        int16* buffer;
+        int64 startSample;
+        int numSamples;
+        int firstChannel;
+        int lastChannel;
+    };
+
+    /** Adds the channels recorded along with file, from the Continuous_Data.openephys files next to it */
+    bool readChannelList (const File& file);
+
+    /** Indexes the recordings from the records of the first channel, over the records every channel has */
+    void buildRecordIndex();
+
+    /** Index of the record holding a timestamp, searching only recordingNumber unless it is -1. Returns -1 if none does. */
+    int findRecord (int64 timestamp, int recordingNumber) const;
+
+    void readTTLEvents (const File& file);
+    void readMessages (const File& file);
+
+    /** Writes channels [firstChannel, lastChannel) of numSamples samples from startSample to the interleaved buffer */
+    void decodeChannels (int16* buffer, int64 startSample, int numSamples, int firstChannel, int lastChannel) const;
+
+    OwnedArray<ChannelFile> channelFiles;
+    Array<RecordingIndex> recordings;
+    float sampleRate;
+    int64 activeFirstRecord;
+    int64 samplePos;
+
+    ThreadPool pool;
+    OwnedArray<DecodeJob> jobs;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ContinuousFileSource);
+};
+
+
+#endif  // CONTINUOUSFILESOURCE_H_INCLUDED
@@ -0,0 +1,401 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "FileOverview.h"
+#include "FileSource.h"
+
+// the finest level has bins of at least this many samples, and no more than OVERVIEW_MAX_ENTRIES bins for all channels
+#define OVERVIEW_MIN_BIN 256
+#define OVERVIEW_MAX_ENTRIES (1 << 23)
+#define OVERVIEW_LEVEL_FACTOR 4
+// no coarser level is made once one has this few bins
+#define OVERVIEW_MIN_BINS 64
+// samples read from the file at a time
+#define OVERVIEW_READ_SAMPLES 4096
+// bins of the finest level looked at per value while it is still being built, so that drawing stays fast
+#define OVERVIEW_MAX_PARTIAL_BINS 8
+
+static const char overviewMagic[8] = { 'O', 'E', 'O', 'V', 'I', 'E', 'W', '1' };
+static const uint32 overviewVersion = 1;
+
+
+FileOverview::FileOverview()
+    : Thread        ("File overview")
+    , numChannels   (0)
+    , numSamples    (0)
+{
+}
+
+
+FileOverview::~FileOverview()
+{
+    clear();
+}
+
+
+void FileOverview::build (FileSource* newSource, int record, const File& data, const File& cache)
+{
+    clear();
+
+    source = newSource;
+    source->setActiveRecord (record);
+    dataFile = data;
+    cacheFile = cache;
+    numChannels = source->getActiveNumChannels();
+    numSamples = source->getActiveNumSamples();
+
+    if (numChannels <= 0 || numSamples <= 0)
+    {
+        source = nullptr;
+        return;
+    }
+
+    allocateLevels();
+
+    if (loadCache())
+    {
+        binsDone = levels[0]->numBins;
+        complete = 1;
+        source = nullptr;
+        return;
+    }
+
+    startThread (2);
+}
+
+
+void FileOverview::clear()
+{
+    stopThread (5000);
+
+    source = nullptr;
+    levels.clear();
+    numChannels = 0;
+    numSamples = 0;
+    binsDone = 0;
+    complete = 0;
+}
+
+
+void FileOverview::setPaused (bool shouldPause)
+{
+    paused = shouldPause ? 1 : 0;
+
+    // lets a read in progress finish before returning
+    const ScopedLock sl (readLock);
+}
+
+
+bool FileOverview::isComplete() const
+{
+    return complete.get() != 0;
+}
+
+
+float FileOverview::getProgress() const
+{
+    if (levels.size() == 0)
+        return 0;
+
+    return float (binsDone.get()) / float (levels[0]->numBins);
+}
+
+
+int FileOverview::getNumChannels() const
+{
+    return numChannels;
+}
+
+
+int64 FileOverview::getNumSamples() const
+{
+    return numSamples;
+}
+
+
+void FileOverview::allocateLevels()
+{
+    int64 binSamples = OVERVIEW_MIN_BIN;
+    while ((numSamples / binSamples) * numChannels > OVERVIEW_MAX_ENTRIES)
+        binSamples *= 2;
+
+    for (;;)
+    {
+        Level* level = new Level();
+        level->binSamples = binSamples;
+        level->numBins = int ((numSamples + binSamples - 1) / binSamples);
+        level->bins.malloc (size_t (level->numBins) * numChannels);
+        levels.add (level);
+
+        if (level->numBins <= OVERVIEW_MIN_BINS)
+            break;
+
+        binSamples *= OVERVIEW_LEVEL_FACTOR;
+    }
+}
+
+
+void FileOverview::run()
+{
+    Level& base = *levels[0];
+
+    HeapBlock<int16> chunk (size_t (OVERVIEW_READ_SAMPLES) * numChannels);
+    HeapBlock<int> minimum (numChannels);
+    HeapBlock<int> maximum (numChannels);
+    HeapBlock<double> sumSquares (numChannels);
+
+    {
+        const ScopedLock sl (readLock);
+        source->seekTo (0);
+    }
+
+    for (int bin = 0; bin < base.numBins && ! threadShouldExit(); ++bin)
+    {
+        for (int c = 0; c < numChannels; ++c)
+        {
+            minimum[c] = 32767;
+            maximum[c] = -32768;
+            sumSquares[c] = 0;
+        }
+
+        const int64 binStart = bin * base.binSamples;
+        const int64 binEnd = jmin (numSamples, binStart + base.binSamples);
+        int64 position = binStart;
+
+        while (position < binEnd && ! threadShouldExit())
+        {
+            if (paused.get())
+            {
+                wait (100);
+                continue;
+            }
+
+            const int samplesToRead = int (jmin (int64 (OVERVIEW_READ_SAMPLES), binEnd - position));
+            int samplesRead;
+            {
+                const ScopedLock sl (readLock);
+                if (paused.get())
+                    continue;
+                samplesRead = source->readData (chunk, samplesToRead);
+            }
+
+            if (samplesRead <= 0)
+                break;
+
+            for (int i = 0; i < samplesRead; ++i)
+            {
+                const int16* frame = chunk + size_t (i) * numChannels;
+                for (int c = 0; c < numChannels; ++c)
+                {
+                    const int value = frame[c];
+                    minimum[c] = jmin (minimum[c], value);
+                    maximum[c] = jmax (maximum[c], value);
+                    sumSquares[c] += double (value) * value;
+                }
+            }
+
+            position += samplesRead;
+        }
+
+        const int64 binLength = jmax (int64 (1), position - binStart);
+        Bin* bins = base.bins + size_t (bin) * numChannels;
+        for (int c = 0; c < numChannels; ++c)
+        {
+            bins[c].minValue = int16 (jmin (minimum[c], maximum[c]));
+            bins[c].maxValue = int16 (jmax (minimum[c], maximum[c]));
+            bins[c].rms = uint16 (jmin (65535.0, std::sqrt (sumSquares[c] / binLength)));
+        }
+
+        binsDone = bin + 1;
+    }
+
+    if (threadShouldExit())
+        return;
+
+    buildCoarseLevels();
+    complete = 1;
+    saveCache();
+}
+
+
+void FileOverview::buildCoarseLevels()
+{
+    for (int l = 1; l < levels.size(); ++l)
+    {
+        const Level& fine = *levels[l - 1];
+        Level& coarse = *levels[l];
+
+        for (int bin = 0; bin < coarse.numBins; ++bin)
+        {
+            const int first = bin * OVERVIEW_LEVEL_FACTOR;
+            const int last = jmin (fine.numBins, first + OVERVIEW_LEVEL_FACTOR);
+
+            for (int c = 0; c < numChannels; ++c)
+            {
+                int16 minValue = 32767;
+                int16 maxValue = -32768;
+                double sumSquares = 0;
+
+                for (int b = first; b < last; ++b)
+                {
+                    const Bin& part = fine.bins[size_t (b) * numChannels + c];
+                    minValue = jmin (minValue, part.minValue);
+                    maxValue = jmax (maxValue, part.maxValue);
+                    sumSquares += double (part.rms) * part.rms;
+                }
+
+                Bin& dest = coarse.bins[size_t (bin) * numChannels + c];
+                dest.minValue = minValue;
+                dest.maxValue = maxValue;
+                dest.rms = uint16 (std::sqrt (sumSquares / jmax (1, last - first)));
+            }
+        }
+    }
+}
+
+
+bool FileOverview::loadCache()
+{
+    // the bins are stored as they are in memory, which is little-endian everywhere we run
+    if (ByteOrder::isBigEndian() || ! cacheFile.existsAsFile())
+        return false;
+
+    FileInputStream stream (cacheFile);
+    if (stream.failedToOpen())
+        return false;
+
+    char magic[8];
+    if (stream.read (magic, 8) != 8 || memcmp (magic, overviewMagic, 8) != 0)
+        return false;
+
+    if (uint32 (stream.readInt()) != overviewVersion
+        || stream.readInt() != numChannels
+        || stream.readInt64() != numSamples
+        || stream.readInt64() != levels[0]->binSamples
+        || stream.readInt64() != dataFile.getSize()
+        || stream.readInt64() != dataFile.getLastModificationTime().toMilliseconds())
+        return false;
+
+    for (int l = 0; l < levels.size(); ++l)
+    {
+        const int bytes = int (levels[l]->numBins * numChannels * sizeof (Bin));
+        if (stream.read (levels[l]->bins, bytes) != bytes)
+            return false;
+    }
+
+    return true;
+}
+
+
+void FileOverview::saveCache() const
+{
+    if (ByteOrder::isBigEndian())
+        return;
+
+    TemporaryFile temp (cacheFile);
+    {
+        FileOutputStream stream (temp.getFile());
+        if (stream.failedToOpen())
+            return;
+
+        stream.write (overviewMagic, 8);
+        stream.writeInt (int (overviewVersion));
+        stream.writeInt (numChannels);
+        stream.writeInt64 (numSamples);
+        stream.writeInt64 (levels[0]->binSamples);
+        stream.writeInt64 (dataFile.getSize());
+        stream.writeInt64 (dataFile.getLastModificationTime().toMilliseconds());
+
+        for (int l = 0; l < levels.size(); ++l)
+            stream.write (levels[l]->bins, levels[l]->numBins * numChannels * sizeof (Bin));
+    }
+
+    if (! temp.overwriteTargetFileWithTemporary())
+        std::cout << "Could not save the overview of " << dataFile.getFileName() << std::endl;
+}
+
+
+bool FileOverview::getEnvelope (int channel, int64 startSample, int64 endSample, int numBins,
+                                float* minValues, float* maxValues, float* rmsValues) const
+{
+    const int done = binsDone.get();
+    const bool isBuilt = complete.get() != 0;
+
+    if (levels.size() == 0 || done == 0 || endSample <= startSample || numBins <= 0 || channel >= numChannels)
+        return false;
+
+    const double samplesPerValue = double (endSample - startSample) / numBins;
+
+    // the coarsest level with bins no wider than a value; only the finest one has data while building
+    int levelIndex = 0;
+    if (isBuilt)
+    {
+        while (levelIndex + 1 < levels.size() && levels[levelIndex + 1]->binSamples <= samplesPerValue)
+            ++levelIndex;
+    }
+
+    const Level& level = *levels[levelIndex];
+    const int available = isBuilt ? level.numBins : done;
+    const int firstChannel = channel < 0 ? 0 : channel;
+    const int lastChannel = channel < 0 ? numChannels : channel + 1;
+    bool anyData = false;
+
+    for (int i = 0; i < numBins; ++i)
+    {
+        const int64 valueStart = startSample + int64 (i * samplesPerValue);
+        const int64 valueEnd = jmax (valueStart + 1, startSample + int64 ((i + 1) * samplesPerValue));
+        const int first = int (valueStart / level.binSamples);
+        const int last = jmin (available, int ((valueEnd - 1) / level.binSamples) + 1);
+        const int step = isBuilt ? 1 : jmax (1, (last - first) / OVERVIEW_MAX_PARTIAL_BINS);
+
+        int minValue = 32767;
+        int maxValue = -32768;
+        double sumSquares = 0;
+        int count = 0;
+
+        for (int b = first; b < last; b += step)
+        {
+            const Bin* bins = level.bins + size_t (b) * numChannels;
+            for (int c = firstChannel; c < lastChannel; ++c)
+            {
+                minValue = jmin (minValue, int (bins[c].minValue));
+                maxValue = jmax (maxValue, int (bins[c].maxValue));
+                sumSquares += double (bins[c].rms) * bins[c].rms;
+                ++count;
+            }
+        }
+
+        if (count == 0)
+        {
+            minValues[i] = maxValues[i] = rmsValues[i] = 0;
+            continue;
+        }
+
+        minValues[i] = float (minValue);
+        maxValues[i] = float (maxValue);
+        rmsValues[i] = float (std::sqrt (sumSquares / count));
+        anyData = true;
+    }
+
+    return anyData;
+}
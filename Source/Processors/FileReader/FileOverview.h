@@ -0,0 +1,107 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef FILEOVERVIEW_H_INCLUDED
+#define FILEOVERVIEW_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+class FileSource;
+
+
+/**
+    A multi-resolution summary of one record of a file: the minimum, maximum and RMS of each
+    channel over bins of samples, each level combining OVERVIEW_LEVEL_FACTOR bins of the one below.
+
+    It is built on a thread of its own from a separate FileSource instance, so that the File Reader
+    can go on playing, and is saved next to the recording so that later opens load it at once.
+    Values are in raw sample units.
+
+    @see FileReader, FileReaderEditor
+*/
+class FileOverview : private Thread
+{
+public:
+    FileOverview();
+    ~FileOverview();
+
+    /** Loads the overview of a record from cacheFile if it matches, or else starts building it from
+        source, taking ownership of the source. Any overview in progress is dropped first. */
+    void build (FileSource* source, int record, const File& dataFile, const File& cacheFile);
+
+    void clear();
+
+    /** Holds off reading while the File Reader plays sources that can't be read from two threads */
+    void setPaused (bool paused);
+
+    bool isComplete()      const;
+    float getProgress()    const;
+    int getNumChannels()   const;
+    int64 getNumSamples()  const;
+
+    /** Fills numBins values spanning samples [startSample, endSample) from the coarsest level that
+        resolves them, using what has been built so far. A channel of -1 combines every channel.
+        Returns false if there is nothing to show yet. */
+    bool getEnvelope (int channel, int64 startSample, int64 endSample, int numBins,
+                      float* minValues, float* maxValues, float* rmsValues) const;
+
+private:
+    struct Bin
+    {
+        int16 minValue;
+        int16 maxValue;
+        uint16 rms;
+    };
+
+    struct Level
+    {
+        int64 binSamples;
+        int numBins;
+        HeapBlock<Bin> bins; // numBins x numChannels, bin major
+    };
+
+    void run() override;
+
+    /** Sizes the levels for the record, with no more than OVERVIEW_MAX_ENTRIES at the finest one */
+    void allocateLevels();
+    void buildCoarseLevels();
+    bool loadCache();
+    void saveCache() const;
+
+    ScopedPointer<FileSource> source;
+    File dataFile;
+    File cacheFile;
+    int numChannels;
+    int64 numSamples;
+    OwnedArray<Level> levels;
+
+    Atomic<int> binsDone;   // bins of the finest level computed so far
+    Atomic<int> complete;
+    Atomic<int> paused;
+    CriticalSection readLock;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FileOverview);
+};
+
+
+#endif  // FILEOVERVIEW_H_INCLUDED
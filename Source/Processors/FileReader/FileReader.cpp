@@ -1,391 +1,847 @@
-/*
-    ------------------------------------------------------------------
-
-    This file is part of the Open Ephys GUI
-    Copyright (C) 2016 Open Ephys
-
-    ------------------------------------------------------------------
-
-    This program is free software: you can redistribute it and/or modify
-    it under the terms of the GNU General Public License as published by
-    the Free Software Foundation, either version 3 of the License, or
-    (at your option) any later version.
-
-    This program is distributed in the hope that it will be useful,
-    but WITHOUT ANY WARRANTY; without even the implied warranty of
-    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
-    GNU General Public License for more details.
-
-    You should have received a copy of the GNU General Public License
-    along with this program.  If not, see <http://www.gnu.org/licenses/>.
-
-*/
-
-#include "FileReader.h"
-#include "FileReaderEditor.h"
-#include <stdio.h>
-#include "../../AccessClass.h"
-#include "../PluginManager/PluginManager.h"
-
-
-FileReader::FileReader()
-    : GenericProcessor ("File Reader")
-    , Thread ("filereader_Async_Reader")
-    , timestamp             (0)
-    , currentSampleRate     (0)
-    , currentNumChannels    (0)
-    , currentSample         (0)
-    , currentNumSamples     (0)
-    , startSample           (0)
-    , stopSample            (0)
-    , counter               (0)
-    , bufferCacheWindow     (0)
-    , m_shouldFillBackBuffer(false)
-{
-    setProcessorType (PROCESSOR_TYPE_SOURCE);
-
-    setEnabledState (false);
-
-    const int numFileSources = AccessClass::getPluginManager()->getNumFileSources();
-    for (int i = 0; i < numFileSources; ++i)
-    {
-        Plugin::FileSourceInfo info = AccessClass::getPluginManager()->getFileSourceInfo (i);
-
-        StringArray extensions;
-        extensions.addTokens (info.extensions, ";", "\"");
-
-        const int numExtensions = extensions.size();
-        for (int j = 0; j < numExtensions; ++j)
-        {
-            supportedExtensions.set (extensions[j].toLowerCase(), i + 1);
-        }
-    }
-}
-
-
-FileReader::~FileReader()
-{
-    signalThreadShouldExit();
-    notify();
-}
-
-
-AudioProcessorEditor* FileReader::createEditor()
-{
-    editor = new FileReaderEditor (this, true);
-
-    return editor;
-}
-
-void FileReader::createEventChannels()
-{
-    //editor = new FileReaderEditor (this, true);
-
-    //return editor;
-}
-
-bool FileReader::isReady()
-{
-    if (! input)
-    {
-        CoreServices::sendStatusMessage ("No file selected in File Reader.");
-        return false;
-    }
-    else
-    {
-        return input->isReady();
-    }
-}
-
-
-float FileReader::getDefaultSampleRate() const
-{
-    if (input)
-        return currentSampleRate;
-    else
-        return 44100.0;
-}
-
-
-int FileReader::getDefaultNumDataOutputs(DataChannel::DataChannelTypes type, int subproc) const
-{
-    if (subproc != 0) return 0;
-    if (type != DataChannel::HEADSTAGE_CHANNEL) return 0;
-    if (input)
-        return currentNumChannels;
-    else
-        return 16;
-}
-
-
-float FileReader::getBitVolts (const DataChannel* chan) const
-{
-    if (input)
-        return chan->getBitVolts();
-    else
-        return 0.05f;
-}
-
-
-void FileReader::setEnabledState (bool t)
-{
-    isEnabled = t;
-}
-
-
-bool FileReader::isFileSupported (const String& fileName) const
-{
-    const File file (fileName);
-    String ext = file.getFileExtension().toLowerCase().substring (1);
-
-    return isFileExtensionSupported (ext);
-}
-
-
-bool FileReader::isFileExtensionSupported (const String& ext) const
-{
-    const int index = supportedExtensions[ext] - 1;
-    const bool isExtensionSupported = index >= 0;
-
-    return isExtensionSupported;
-}
-
-
-bool FileReader::setFile (String fullpath)
-{
-    File file (fullpath);
-
-    String ext = file.getFileExtension().toLowerCase().substring (1);
-    const int index = supportedExtensions[ext] - 1;
-    const bool isExtensionSupported = index >= 0;
-
-    if (isExtensionSupported)
-    {
-        const int index = supportedExtensions[ext] - 1;
-        Plugin::FileSourceInfo sourceInfo = AccessClass::getPluginManager()->getFileSourceInfo (index);
-        input = sourceInfo.creator();
-    }
-    else
-    {
-        CoreServices::sendStatusMessage ("File type not supported");
-        return false;
-    }
-
-    if (! input->OpenFile (file))
-    {
-        input = nullptr;
-        CoreServices::sendStatusMessage ("Invalid file");
-
-        return false;
-    }
-
-    const bool isEmptyFile = input->getNumRecords() <= 0;
-    if (isEmptyFile)
-    {
-        input = nullptr;
-        CoreServices::sendStatusMessage ("Empty file. Inoring open operation");
-
-        return false;
-    }
-
-    static_cast<FileReaderEditor*> (getEditor())->populateRecordings (input);
-    setActiveRecording (0);
-    
-    m_samplesPerBuffer.set(float(BUFFER_SIZE) * (getDefaultSampleRate() / 44100.0f));
-    
-    readAndFillBufferCache(bufferA); // pre-fill the front buffer with a blocking read
-    
-    startThread(); // start async file reader thread
-
-    return true;
-}
-
-
-void FileReader::setActiveRecording (int index)
-{    
-    input->setActiveRecord (index);
-
-    currentNumChannels  = input->getActiveNumChannels();
-    currentNumSamples   = input->getActiveNumSamples();
-    currentSampleRate   = input->getActiveSampleRate();
-
-    currentSample   = 0;
-    startSample     = 0;
-    stopSample      = currentNumSamples;
-    bufferCacheWindow = 0;
-
-    for (int i = 0; i < currentNumChannels; ++i)
-    {
-        channelInfo.add (input->getChannelInfo (i));
-    }
-
-    static_cast<FileReaderEditor*> (getEditor())->setTotalTime (samplesToMilliseconds (currentNumSamples));
-
-    bufferA.malloc (currentNumChannels * BUFFER_SIZE * BUFFER_WINDOW_CACHE_SIZE);
-    bufferB.malloc (currentNumChannels * BUFFER_SIZE * BUFFER_WINDOW_CACHE_SIZE);
-    
-    // set the backbuffer so that on the next call to process() we start with bufferA and buffer
-    // cache window id = 0
-    readBuffer = &bufferB;
-    bufferCacheWindow = 0;
-}
-
-
-String FileReader::getFile() const
-{
-    if (input)
-        return input->getFileName();
-    else
-        return String::empty;
-}
-
-
-void FileReader::updateSettings()
-{
-     if (!input) return;
-
-     for (int i=0; i < currentNumChannels; i++)
-     {
-         dataChannelArray[i]->setBitVolts(channelInfo[i].bitVolts);
-         dataChannelArray[i]->setName(channelInfo[i].name);
-     }
-}
-
-void FileReader::process (AudioSampleBuffer& buffer)
-{
-    const int samplesNeededPerBuffer = int (float (buffer.getNumSamples()) * (getDefaultSampleRate() / 44100.0f));
-    m_samplesPerBuffer.set(samplesNeededPerBuffer);
-    // FIXME: needs to account for the fact that the ratio might not be an exact
-    //        integer value
-    
-    // if cache window id == 0, we need to read and cache BUFFER_WINDOW_CACHE_SIZE more buffer windows
-    if (bufferCacheWindow == 0)
-    {
-        switchBuffer();
-    }
-    
-    for (int i = 0; i < currentNumChannels; ++i)
-    {
-        // offset readBuffer index by current cache window count * buffer window size * num channels
-        input->processChannelData (*readBuffer + (samplesNeededPerBuffer * currentNumChannels * bufferCacheWindow),
-                                   buffer.getWritePointer (i, 0),
-                                   i,
-                                   samplesNeededPerBuffer);
-    }
-    
-    timestamp += samplesNeededPerBuffer;
-    setTimestampAndSamples(timestamp, samplesNeededPerBuffer);
-    
-    bufferCacheWindow += 1;
-    bufferCacheWindow %= BUFFER_WINDOW_CACHE_SIZE;
-}
-
-
-void FileReader::setParameter (int parameterIndex, float newValue)
-{
-    switch (parameterIndex)
-    {
-        //Change selected recording
-        case 0:
-            setActiveRecording (newValue);
-            break;
-
-        //set startTime
-        case 1: 
-            startSample = millisecondsToSamples (newValue);
-            currentSample = startSample;
-
-            static_cast<FileReaderEditor*> (getEditor())->setCurrentTime (samplesToMilliseconds (currentSample));
-            break;
-
-        //set stop time
-        case 2:
-            stopSample = millisecondsToSamples(newValue);
-            currentSample = startSample;
-
-            static_cast<FileReaderEditor*> (getEditor())->setCurrentTime (samplesToMilliseconds (currentSample));
-            break;
-    }
-}
-
-
-unsigned int FileReader::samplesToMilliseconds (int64 samples) const
-{
-    return (unsigned int) (1000.f * float (samples) / currentSampleRate);
-}
-
-
-int64 FileReader::millisecondsToSamples (unsigned int ms) const
-{
-    return (int64) (currentSampleRate * float (ms) / 1000.f);
-}
-
-void FileReader::switchBuffer()
-{
-    if (readBuffer == &bufferA)
-        readBuffer = &bufferB;
-    else
-        readBuffer = &bufferA;
-    
-    m_shouldFillBackBuffer.set(true);
-    notify();
-}
-
-HeapBlock<int16>* FileReader::getFrontBuffer()
-{
-    return readBuffer;
-}
-
-HeapBlock<int16>* FileReader::getBackBuffer()
-{
-    if (readBuffer == &bufferA) return &bufferB;
-    
-    return &bufferA;
-}
-
-void FileReader::run()
-{
-    while (!threadShouldExit())
-    {
-        if (m_shouldFillBackBuffer.compareAndSetBool(false, true))
-        {
-            readAndFillBufferCache(*getBackBuffer());
-        }
-        
-        wait(30);
-    }
-}
-
-void FileReader::readAndFillBufferCache(HeapBlock<int16> &cacheBuffer)
-{
-    const int samplesNeededPerBuffer = m_samplesPerBuffer.get();
-    const int samplesNeeded = samplesNeededPerBuffer * BUFFER_WINDOW_CACHE_SIZE;
-    
-    int samplesRead = 0;
-    
-    // should only loop if reached end of file and resuming from start
-    while (samplesRead < samplesNeeded)
-    {
-        int samplesToRead = samplesNeeded - samplesRead;
-        
-        // if reached end of file stream
-        if ( (currentSample + samplesToRead) > stopSample)
-        {
-            samplesToRead = stopSample - currentSample;
-            if (samplesToRead > 0)
-                input->readData (cacheBuffer + samplesRead * currentNumChannels, samplesToRead);
-            
-            // reset stream to beginning
-            input->seekTo (startSample);
-            currentSample = startSample;
-        }
-        else // else read the block needed
-        {
-            input->readData (cacheBuffer + samplesRead * currentNumChannels, samplesToRead);
-            
-            currentSample += samplesToRead;
-        }
-        
-        samplesRead += samplesToRead;
-    }
-}
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "FileReader.h"
+#include "FileReaderEditor.h"
+#include "ContinuousFileSource.h"
+#include <stdio.h>
+#include "../../AccessClass.h"
+#include "../PluginManager/PluginManager.h"
+#include "../../Audio/AudioComponent.h"
+
+
+FileReader::FileReader()
+    : GenericProcessor ("File Reader")
+    , Thread ("filereader_Async_Reader")
+    , timestamp             (0)
+    , currentSampleRate     (0)
+    , currentNumChannels    (0)
+    , currentSample         (0)
+    , playbackSample        (0)
+    , currentNumSamples     (0)
+    , startSample           (0)
+    , stopSample            (0)
+    , readSlotPosition      (0)
+    , sampleRemainder       (0)
+    , playbackSpeed         (1.0f)
+    , mappedInput           (false)
+    , offlineMode           (false)
+    , offlineSamplesLeft    (0)
+    , eventCursor           (0)
+    , eventCursorSample     (-1)
+    , offlineStopRequested  (false)
+    , counter               (0)
+    , sourceCreator         (nullptr)
+    , numRingSlots          (0)
+    , readSlot              (0)
+    , writeSlot             (0)
+    , m_peakReadMs          (0)
+{
+    setProcessorType (PROCESSOR_TYPE_SOURCE);
+
+    setEnabledState (false);
+
+    // the file source of the built-in record engine, replaced by any plugin reading the same extension
+    supportedExtensions.set ("continuous", CONTINUOUS_FILE_SOURCE);
+
+    const int numFileSources = AccessClass::getPluginManager()->getNumFileSources();
+    for (int i = 0; i < numFileSources; ++i)
+    {
+        // the cached extensions, the library is only loaded once one of its files is opened
+        StringArray extensions;
+        extensions.addTokens (AccessClass::getPluginManager()->getFileSourceExtensions (i), ";", "\"");
+
+        const int numExtensions = extensions.size();
+        for (int j = 0; j < numExtensions; ++j)
+        {
+            supportedExtensions.set (extensions[j].toLowerCase(), i + 1);
+        }
+    }
+}
+
+
+FileReader::~FileReader()
+{
+    signalThreadShouldExit();
+    notify();
+    stopThread (2000);
+}
+
+
+AudioProcessorEditor* FileReader::createEditor()
+{
+    editor = new FileReaderEditor (this, true);
+
+    return editor;
+}
+
+void FileReader::createEventChannels()
+{
+    moduleEventChannels.clearQuick();
+    ttlWords.clearQuick();
+
+    if (! input)
+        return;
+
+    const String fileName = File (input->getFileName()).getFileName();
+
+    for (int i = 0; i < input->getNumEventTracks(); ++i)
+    {
+        const RecordedEventTrack& track = input->getEventTrack (i);
+        EventChannel* chan;
+
+        if (track.type == RecordedEventTrack::TTL)
+        {
+            chan = new EventChannel (EventChannel::TTL, jlimit (1, 64, track.size), 0, currentSampleRate, this);
+            chan->setIdentifier ("filereader.ttl");
+        }
+        else
+        {
+            chan = new EventChannel (EventChannel::TEXT, 1, jmax (1, track.size), currentSampleRate, this);
+            chan->setIdentifier ("filereader.text");
+        }
+
+        chan->setName (track.name);
+        chan->setDescription ("Events replayed from " + fileName);
+
+        eventChannelArray.add (chan);
+        moduleEventChannels.add (chan);
+    }
+
+    ttlWords.insertMultiple (0, 0, moduleEventChannels.size());
+}
+
+bool FileReader::isReady()
+{
+    if (! input)
+    {
+        CoreServices::sendStatusMessage ("No file selected in File Reader.");
+        return false;
+    }
+    else
+    {
+        return input->isReady();
+    }
+}
+
+
+bool FileReader::enable()
+{
+    offlineSamplesLeft = stopSample - playbackSample;
+    offlineStopRequested = false;
+    sampleRemainder = 0;
+    m_underruns = 0;
+
+    eventCursorSample = -1;
+    for (int i = 0; i < ttlWords.size(); ++i)
+        ttlWords.set (i, 0);
+
+    // the reader thread and the overview can't both be reading such files
+    if (! input->canBeReadConcurrently())
+        overview.setPaused (true);
+
+    m_seekState = SEEK_NONE;
+    resetCache();
+
+    return true;
+}
+
+
+bool FileReader::disable()
+{
+    overview.setPaused (false);
+
+    return true;
+}
+
+
+bool FileReader::isOfflineMode() const
+{
+    return offlineMode;
+}
+
+
+float FileReader::getPlaybackSpeed() const
+{
+    return playbackSpeed;
+}
+
+
+int FileReader::getNumUnderruns() const
+{
+    return m_underruns.get();
+}
+
+
+int FileReader::getReadAheadMs() const
+{
+    if (currentSampleRate <= 0)
+        return 0;
+
+    return int (1000.0 * m_targetSlots.get() * m_slotSamples.get() / (currentSampleRate * playbackSpeed));
+}
+
+
+int64 FileReader::getPlaybackPosition() const
+{
+    return playbackSample;
+}
+
+
+int64 FileReader::getStartSample() const
+{
+    return startSample;
+}
+
+
+int64 FileReader::getStopSample() const
+{
+    return stopSample;
+}
+
+
+int64 FileReader::getNumSamples() const
+{
+    return currentNumSamples;
+}
+
+
+const FileOverview& FileReader::getOverview() const
+{
+    return overview;
+}
+
+
+void FileReader::seekPlayback (int64 sample)
+{
+    if (stopSample <= startSample)
+        return;
+
+    sample = jlimit (startSample, stopSample - 1, sample);
+
+    if (! isEnabled || ! CoreServices::getAcquisitionStatus())
+    {
+        currentSample = sample;
+        playbackSample = sample;
+        return;
+    }
+
+    m_seekTarget = sample;
+    m_seekState = SEEK_REQUESTED;
+}
+
+
+float FileReader::getDefaultSampleRate() const
+{
+    if (input)
+        return currentSampleRate;
+    else
+        return 44100.0;
+}
+
+
+int FileReader::getDefaultNumDataOutputs(DataChannel::DataChannelTypes type, int subproc) const
+{
+    if (subproc != 0) return 0;
+    if (type != DataChannel::HEADSTAGE_CHANNEL) return 0;
+    if (input)
+        return currentNumChannels;
+    else
+        return 16;
+}
+
+
+float FileReader::getBitVolts (const DataChannel* chan) const
+{
+    if (input)
+        return chan->getBitVolts();
+    else
+        return 0.05f;
+}
+
+
+void FileReader::setEnabledState (bool t)
+{
+    isEnabled = t;
+}
+
+
+bool FileReader::isFileSupported (const String& fileName) const
+{
+    const File file (fileName);
+    String ext = file.getFileExtension().toLowerCase().substring (1);
+
+    return isFileExtensionSupported (ext);
+}
+
+
+bool FileReader::isFileExtensionSupported (const String& ext) const
+{
+    return supportedExtensions[ext] != 0;
+}
+
+
+bool FileReader::setFile (String fullpath)
+{
+    File file (fullpath);
+
+    String ext = file.getFileExtension().toLowerCase().substring (1);
+    const int index = supportedExtensions[ext] - 1;
+
+    overview.clear();
+
+    if (index >= 0)
+    {
+        Plugin::FileSourceInfo sourceInfo = AccessClass::getPluginManager()->getFileSourceInfo (index);
+        if (sourceInfo.creator == nullptr)
+        {
+            CoreServices::sendStatusMessage ("Could not load the plugin for this file type");
+            return false;
+        }
+        input = sourceInfo.creator();
+        sourceCreator = sourceInfo.creator;
+    }
+    else if (index == CONTINUOUS_FILE_SOURCE - 1)
+    {
+        sourceCreator = &Plugin::createFileSource<ContinuousFileSource>;
+        input = sourceCreator();
+    }
+    else
+    {
+        CoreServices::sendStatusMessage ("File type not supported");
+        return false;
+    }
+
+    if (! input->OpenFile (file))
+    {
+        input = nullptr;
+        CoreServices::sendStatusMessage ("Invalid file");
+
+        return false;
+    }
+
+    const bool isEmptyFile = input->getNumRecords() <= 0;
+    if (isEmptyFile)
+    {
+        input = nullptr;
+        CoreServices::sendStatusMessage ("Empty file. Inoring open operation");
+
+        return false;
+    }
+
+    static_cast<FileReaderEditor*> (getEditor())->populateRecordings (input);
+    setActiveRecording (0);
+    
+    startThread(); // start async file reader thread, which fills the ring once acquisition starts
+
+    return true;
+}
+
+
+void FileReader::setActiveRecording (int index)
+{    
+    input->setActiveRecord (index);
+
+    currentNumChannels  = input->getActiveNumChannels();
+    currentNumSamples   = input->getActiveNumSamples();
+    currentSampleRate   = input->getActiveSampleRate();
+
+    currentSample   = 0;
+    playbackSample  = 0;
+    startSample     = 0;
+    stopSample      = currentNumSamples;
+    eventCursorSample = -1;
+
+    for (int i = 0; i < currentNumChannels; ++i)
+    {
+        channelInfo.add (input->getChannelInfo (i));
+    }
+
+    static_cast<FileReaderEditor*> (getEditor())->setTotalTime (samplesToMilliseconds (currentNumSamples));
+
+    // the ring is only allocated and filled when acquisition starts
+    channelPointers.malloc (jmax (1, currentNumChannels));
+
+    mappedInput = currentNumSamples > 0 && input->getMappedData (0, 1) != nullptr;
+
+    startOverview (index);
+}
+
+
+void FileReader::startOverview (int record)
+{
+    overview.clear();
+
+    if (sourceCreator == nullptr)
+        return;
+
+    const File file (input->getFileName());
+    ScopedPointer<FileSource> overviewSource = sourceCreator();
+
+    if (! overviewSource->OpenFile (file))
+        return;
+
+    // next to the recording, so that it is found again whenever the file is opened
+    const File cacheFile = file.getSiblingFile (file.getFileName() + "." + String (record) + ".overview");
+    overview.build (overviewSource.release(), record, file, cacheFile);
+}
+
+
+String FileReader::getFile() const
+{
+    if (input)
+        return input->getFileName();
+    else
+        return String::empty;
+}
+
+
+void FileReader::updateSettings()
+{
+     if (!input) return;
+
+     for (int i=0; i < currentNumChannels; i++)
+     {
+         dataChannelArray[i]->setBitVolts(channelInfo[i].bitVolts);
+         dataChannelArray[i]->setName(channelInfo[i].name);
+     }
+}
+
+void FileReader::resetCache()
+{
+    // waits for the slot the reader may be filling
+    const ScopedLock sl (m_readerLock);
+
+    currentSample = playbackSample;
+    input->seekTo (currentSample);
+
+    const int blockSize = AccessClass::getAudioComponent()->getBufferSize();
+    const int samplesPerBlock = jmax (1, int (std::ceil (blockSize * (getDefaultSampleRate() / 44100.0f))));
+
+    if (mappedInput)
+    {
+        numRingSlots = 0;
+        wrapBuffer.malloc (currentNumChannels * jmax (blockSize, samplesPerBlock));
+        return;
+    }
+
+    // faster playback empties the ring faster, so it holds proportionally more
+    const int slotSamples = samplesPerBlock * RING_SLOT_BLOCKS;
+    const double slotSeconds = slotSamples / (getDefaultSampleRate() * playbackSpeed);
+    numRingSlots = jmax (RING_MIN_SLOTS, int (std::ceil (RING_MAX_SECONDS / slotSeconds)));
+
+    ringData.malloc (size_t (numRingSlots) * slotSamples * currentNumChannels);
+    m_slotSamples = slotSamples;
+    m_targetSlots = RING_MIN_SLOTS - 1;
+    m_peakReadMs = 0;
+
+    readSlot = 0;
+    readSlotPosition = 0;
+    readAndFillBufferCache (getSlot (0));
+    writeSlot = 1 % numRingSlots;
+    m_filledSlots = 1;
+
+    notify();
+}
+
+
+int16* FileReader::getSlot (int slot) const
+{
+    return ringData + size_t (slot) * m_slotSamples.get() * currentNumChannels;
+}
+
+
+void FileReader::process (AudioSampleBuffer& buffer)
+{
+    // the recorded rate rarely gives a whole number of samples per block, so the fraction left over
+    // is carried to the next ones and the replay keeps in step with the recording
+    sampleRemainder += buffer.getNumSamples() * (getDefaultSampleRate() / 44100.0);
+    const int samplesNeededPerBuffer = jmin (int (sampleRemainder), buffer.getNumSamples());
+    sampleRemainder -= samplesNeededPerBuffer;
+
+    // a seek is done by the reader thread for the ring, process() sending empty blocks until it has rewound it
+    if (m_seekState.get() != SEEK_NONE)
+    {
+        if (m_seekState.get() == SEEK_REQUESTED)
+        {
+            offlineSamplesLeft = stopSample - m_seekTarget.get();
+
+            if (mappedInput)
+            {
+                currentSample = m_seekTarget.get();
+                playbackSample = currentSample;
+                m_seekState = SEEK_NONE;
+            }
+            else
+            {
+                m_seekState = SEEK_RING_RELEASED;
+                notify();
+            }
+        }
+
+        if (m_seekState.get() != SEEK_NONE)
+        {
+            setTimestampAndSamples (timestamp, 0);
+            return;
+        }
+    }
+
+    // offline, the samples up to the stop time are sent only once, the last block being cut short
+    int samplesToSend = samplesNeededPerBuffer;
+    if (offlineMode)
+    {
+        if (offlineSamplesLeft <= 0)
+        {
+            stopOfflineProcessing();
+            setTimestampAndSamples (timestamp, 0);
+            return;
+        }
+
+        samplesToSend = int (jmin (int64 (samplesNeededPerBuffer), offlineSamplesLeft));
+        offlineSamplesLeft -= samplesToSend;
+    }
+
+    if (mappedInput)
+    {
+        processMappedData (buffer, samplesNeededPerBuffer);
+    }
+    else
+    {
+        const int slotSamples = m_slotSamples.get();
+
+        // offline there's no hurry, so the reader is waited for. Otherwise a block is only sent
+        // if all of its samples have been read, one slot being played and the next one after it
+        const int slotsNeeded = (readSlotPosition + samplesNeededPerBuffer > slotSamples) ? 2 : 1;
+        while (offlineMode && m_filledSlots.get() < slotsNeeded && ! threadShouldExit())
+            m_slotFilled.wait (100);
+
+        if (m_filledSlots.get() < slotsNeeded)
+        {
+            ++m_underruns;
+            static_cast<FileReaderEditor*> (getEditor())->updatePlaybackStatus();
+            setTimestampAndSamples (timestamp, 0);
+            return;
+        }
+
+        int samplesDone = 0;
+
+        // a block can start at the end of a slot and carry on at the start of the next one
+        while (samplesDone < samplesNeededPerBuffer)
+        {
+            if (readSlotPosition >= slotSamples)
+            {
+                readSlot = (readSlot + 1) % numRingSlots;
+                readSlotPosition = 0;
+                --m_filledSlots;
+                notify();
+            }
+
+            const int samplesToProcess = jmin (samplesNeededPerBuffer - samplesDone, slotSamples - readSlotPosition);
+
+            for (int i = 0; i < currentNumChannels; ++i)
+                channelPointers[i] = buffer.getWritePointer (i, samplesDone);
+
+            input->processAllChannelsData (getSlot (readSlot) + (readSlotPosition * currentNumChannels),
+                                           channelPointers,
+                                           samplesToProcess);
+
+            samplesDone += samplesToProcess;
+            readSlotPosition += samplesToProcess;
+        }
+    }
+
+    const int64 blockStart = playbackSample;
+
+    playbackSample += samplesNeededPerBuffer;
+    if (playbackSample >= stopSample && stopSample > startSample)
+        playbackSample = startSample + (playbackSample - stopSample) % (stopSample - startSample);
+    
+    timestamp += samplesToSend;
+    setTimestampAndSamples(timestamp, samplesToSend);
+
+    addRecordedEvents (blockStart, samplesToSend, timestamp);
+}
+
+
+void FileReader::addRecordedEvents (int64 firstSample, int numSamples, int64 blockTimestamp)
+{
+    if (moduleEventChannels.size() == 0)
+        return;
+
+    const int numEvents = input->getActiveNumEvents();
+    int64 sample = firstSample;
+    int samplesDone = 0;
+
+    while (samplesDone < numSamples)
+    {
+        // the cursor is only searched for when playback jumped, after a seek, a loop or a change of record
+        if (sample != eventCursorSample)
+            eventCursor = input->findEvent (sample);
+
+        int64 spanEnd = sample + (numSamples - samplesDone);
+        if (stopSample > startSample)
+            spanEnd = jmin (spanEnd, stopSample);
+
+        for (; eventCursor < numEvents; ++eventCursor)
+        {
+            const RecordedEvent& event = input->getActiveEvent (eventCursor);
+
+            if (event.sample >= spanEnd)
+                break;
+
+            const int sampleNum = samplesDone + int (event.sample - sample);
+            const EventChannel* chan = moduleEventChannels[event.track];
+
+            if (chan->getChannelType() == EventChannel::TTL)
+            {
+                const uint64 bit = uint64 (1) << event.line;
+                uint64& word = ttlWords.getReference (event.track);
+                word = event.state ? (word | bit) : (word & ~bit);
+
+                addTTLEvent (chan, blockTimestamp + sampleNum, &word, uint16 (event.line), sampleNum);
+            }
+            else
+            {
+                addTextEvent (chan, blockTimestamp + sampleNum, input->getEventText (event), sampleNum);
+            }
+        }
+
+        samplesDone += int (spanEnd - sample);
+        sample = spanEnd;
+
+        eventCursorSample = sample;
+
+        if (sample >= stopSample && stopSample > startSample)
+        {
+            sample = startSample;
+            eventCursorSample = -1;
+        }
+    }
+}
+
+
+void FileReader::processMappedData (AudioSampleBuffer& buffer, int nSamples)
+{
+    const int16* data = nullptr;
+
+    if (currentSample + nSamples <= stopSample)
+    {
+        data = input->getMappedData (currentSample, nSamples);
+        currentSample += nSamples;
+    }
+    else if (stopSample > startSample)
+    {
+        // the block loops back to the start sample, so its two spans are pieced together
+        int samplesCopied = 0;
+        while (samplesCopied < nSamples)
+        {
+            const int samplesToCopy = int (jmin (int64 (nSamples - samplesCopied), stopSample - currentSample));
+            if (samplesToCopy > 0)
+            {
+                const int16* span = input->getMappedData (currentSample, samplesToCopy);
+                if (span == nullptr)
+                    break;
+                memcpy (wrapBuffer + samplesCopied * currentNumChannels, span, samplesToCopy * currentNumChannels * sizeof (int16));
+            }
+
+            samplesCopied += samplesToCopy;
+            currentSample += samplesToCopy;
+            if (currentSample >= stopSample)
+                currentSample = startSample;
+        }
+
+        if (samplesCopied == nSamples)
+            data = wrapBuffer;
+    }
+
+    if (currentSample >= stopSample)
+        currentSample = startSample;
+
+    // processAllChannelsData only reads from its input, so the read-only mapping can be passed in as it is
+    if (data != nullptr)
+    {
+        input->processAllChannelsData (const_cast<int16*> (data), buffer.getArrayOfWritePointers(), nSamples);
+    }
+    else
+    {
+        for (int i = 0; i < currentNumChannels; ++i)
+            buffer.clear (i, 0, nSamples);
+    }
+}
+
+
+void FileReader::stopOfflineProcessing()
+{
+    if (offlineStopRequested)
+        return;
+
+    offlineStopRequested = true;
+    MessageManager::callAsync ([] { CoreServices::setAcquisitionStatus (false); });
+}
+
+
+void FileReader::setParameter (int parameterIndex, float newValue)
+{
+    switch (parameterIndex)
+    {
+        //Change selected recording
+        case 0:
+            setActiveRecording (newValue);
+            break;
+
+        //set startTime
+        case 1: 
+            startSample = millisecondsToSamples (newValue);
+            currentSample = startSample;
+            playbackSample = startSample;
+
+            static_cast<FileReaderEditor*> (getEditor())->setCurrentTime (samplesToMilliseconds (currentSample));
+            break;
+
+        //set stop time
+        case 2:
+            stopSample = millisecondsToSamples(newValue);
+            currentSample = startSample;
+            playbackSample = startSample;
+
+            static_cast<FileReaderEditor*> (getEditor())->setCurrentTime (samplesToMilliseconds (currentSample));
+            break;
+
+        //set offline mode
+        case 3:
+            offlineMode = newValue > 0.5f;
+            break;
+
+        //set playback speed
+        case 4:
+            playbackSpeed = jlimit (MIN_PLAYBACK_SPEED, MAX_PLAYBACK_SPEED, newValue);
+            break;
+
+        //seek to a time
+        case 5:
+            seekPlayback (millisecondsToSamples (newValue));
+            break;
+    }
+}
+
+
+unsigned int FileReader::samplesToMilliseconds (int64 samples) const
+{
+    return (unsigned int) (1000.f * float (samples) / currentSampleRate);
+}
+
+
+int64 FileReader::millisecondsToSamples (unsigned int ms) const
+{
+    return (int64) (currentSampleRate * float (ms) / 1000.f);
+}
+
+void FileReader::run()
+{
+    while (!threadShouldExit())
+    {
+        if (m_seekState.get() == SEEK_RING_RELEASED && numRingSlots > 0)
+        {
+            const ScopedLock sl (m_readerLock);
+
+            playbackSample = m_seekTarget.get();
+            currentSample = playbackSample;
+            input->seekTo (currentSample);
+
+            readSlot = 0;
+            readSlotPosition = 0;
+            readAndFillBufferCache (getSlot (0));
+            writeSlot = 1 % numRingSlots;
+            m_filledSlots = 1;
+
+            m_seekState = SEEK_NONE;
+            m_slotFilled.signal();
+        }
+
+        // woken by process() as soon as it frees a slot
+        while (!threadShouldExit() && numRingSlots > 0 && m_filledSlots.get() < jmin (m_targetSlots.get(), numRingSlots))
+        {
+            const ScopedLock sl (m_readerLock);
+
+            const double startMs = Time::getMillisecondCounterHiRes();
+            readAndFillBufferCache (getSlot (writeSlot));
+            updateReadAhead (Time::getMillisecondCounterHiRes() - startMs);
+
+            writeSlot = (writeSlot + 1) % numRingSlots;
+            ++m_filledSlots;
+            m_slotFilled.signal();
+        }
+        
+        wait (100);
+    }
+}
+
+void FileReader::updateReadAhead (double readMs)
+{
+    // the peak decays slowly, so that one slow read keeps the ring deep for a while
+    m_peakReadMs = jmax (readMs, m_peakReadMs * 0.99);
+
+    const double slotMs = 1000.0 * m_slotSamples.get() / (getDefaultSampleRate() * playbackSpeed);
+    const int slotsForPeak = int (std::ceil (m_peakReadMs / slotMs));
+
+    const int targetSlots = jlimit (RING_MIN_SLOTS - 1, numRingSlots, slotsForPeak + RING_MIN_SLOTS - 1);
+
+    if (targetSlots != m_targetSlots.get())
+    {
+        m_targetSlots = targetSlots;
+        static_cast<FileReaderEditor*> (getEditor())->updatePlaybackStatus();
+    }
+}
+
+void FileReader::readAndFillBufferCache (int16* slotBuffer)
+{
+    const int samplesNeeded = m_slotSamples.get();
+    
+    int samplesRead = 0;
+    
+    // should only loop if reached end of file and resuming from start
+    while (samplesRead < samplesNeeded)
+    {
+        int samplesToRead = samplesNeeded - samplesRead;
+        
+        // if reached end of file stream
+        if ( (currentSample + samplesToRead) > stopSample)
+        {
+            samplesToRead = stopSample - currentSample;
+            if (samplesToRead > 0)
+                input->readData (slotBuffer + samplesRead * currentNumChannels, samplesToRead);
+            
+            // reset stream to beginning
+            input->seekTo (startSample);
+            currentSample = startSample;
+        }
+        else // else read the block needed
+        {
+            input->readData (slotBuffer + samplesRead * currentNumChannels, samplesToRead);
+            
+            currentSample += samplesToRead;
+        }
+        
+        samplesRead += samplesToRead;
+    }
+}
@@ -30,15 +30,26 @@
 
 #include "../GenericProcessor/GenericProcessor.h"
 #include "FileSource.h"
+#include "FileOverview.h"
 
-#define BUFFER_SIZE 1024
-#define BUFFER_WINDOW_CACHE_SIZE 10
+// each slot of the read-ahead ring holds this many blocks
+#define RING_SLOT_BLOCKS 4
+// the ring is sized to hold this much data at the playback speed
+#define RING_MAX_SECONDS 2
+#define RING_MIN_SLOTS 3
+#define MIN_PLAYBACK_SPEED 0.25f
+#define MAX_PLAYBACK_SPEED 16.0f
+// supportedExtensions entry of the built-in ContinuousFileSource
+#define CONTINUOUS_FILE_SOURCE -1
 
 
 /**
   Reads data from a file.
 
-  @see GenericProcessor
+  The event tracks of the file source get an event channel each, and their events are sent along
+  with the samples they were recorded at, through a cursor over the events of the active record.
+
+  @see GenericProcessor, FileSource
 */
 class FileReader : public GenericProcessor,
     private Thread
@@ -55,6 +66,8 @@ public:
     bool hasEditor()                const  override { return true; }
     bool isGeneratesTimestamps()    const  override { return true; }
     bool isReady()                  override;
+    bool enable()                   override;
+    bool disable()                  override;
 
     int getDefaultNumDataOutputs(DataChannel::DataChannelTypes type, int)        const override;
 
@@ -71,7 +84,31 @@ public:
     bool isFileExtensionSupported (const String& ext) const;
     void createEventChannels();
 
+    /** In offline mode the samples between the start and stop times are sent once, as fast as the chain
+        takes them, instead of being looped at the recorded rate. Acquisition stops at the stop time. */
+    bool isOfflineMode() const;
+
+    /** How many times faster than real time the file is played, between MIN_PLAYBACK_SPEED and MAX_PLAYBACK_SPEED.
+        The block size stays that of the recorded rate; the data clock runs the blocks faster or slower. */
+    float getPlaybackSpeed() const;
+
+    /** Number of blocks sent empty because the reader hadn't read their samples in time, since acquisition started */
+    int getNumUnderruns() const;
+
+    /** How far ahead of playback the reader currently tries to stay, in milliseconds */
+    int getReadAheadMs() const;
+
+    /** The next sample of the active record to be played */
+    int64 getPlaybackPosition() const;
+    int64 getStartSample() const;
+    int64 getStopSample() const;
+    int64 getNumSamples() const;
+
+    /** Min/max/RMS summary of the active record, built in the background when it is selected */
+    const FileOverview& getOverview() const;
+
 private:
+    /** The event channel of each event track of the source */
     Array<const EventChannel*> moduleEventChannels;
     unsigned int count = 0;
     
@@ -84,42 +121,90 @@ private:
 
     float currentSampleRate;
     int currentNumChannels;
-    int64 currentSample;
+    int64 currentSample;    // next sample to be read into the cache
+    int64 playbackSample;   // next sample to be sent down the chain
     int64 currentNumSamples;
     int64 startSample;
     int64 stopSample;
-    int64 bufferCacheWindow; // the current buffer window to read from readBuffer
+    int readSlotPosition;    // samples of the slot being played already sent
+    double sampleRemainder;  // fraction of a sample carried over to the next block
+    float playbackSpeed;
+    bool mappedInput; // the active record is read straight from the source's memory map, bypassing the cache
+    bool offlineMode;
+    int64 offlineSamplesLeft;   // samples still to send before stopping, in offline mode
+    int eventCursor;            // next event of the active record to send
+    int64 eventCursorSample;    // sample the cursor is at, -1 to find it again
+    Array<uint64> ttlWords;     // current state of the lines of each TTL track
+    bool offlineStopRequested;
     Array<RecordedChannelInfo> channelInfo;
 
     // for testing purposes only
     int counter;
 
     ScopedPointer<FileSource> input;
-
-    HeapBlock<int16> * readBuffer;      // Ptr to the current "front" buffer
-    HeapBlock<int16> bufferA;
-    HeapBlock<int16> bufferB;
-
+    FileSourceCreator sourceCreator;
+    FileOverview overview;
+
+    /** Ring of slots read ahead by the reader thread and played by process(). The reader keeps
+        m_targetSlots of them filled, more when its reads get slower, up to all numRingSlots. */
+    HeapBlock<int16> ringData;
+    int numRingSlots;
+    int readSlot;       // slot being played, process() only
+    int writeSlot;      // next slot to fill, reader thread only
+    HeapBlock<int16> wrapBuffer;        // pieces together mapped blocks that loop back to the start
+    HeapBlock<float*> channelPointers;
+
+    /** Plugin file source index + 1 for each extension, or CONTINUOUS_FILE_SOURCE */
     HashMap<String, int> supportedExtensions;
     
-    Atomic<int> m_shouldFillBackBuffer;
-    Atomic<int> m_samplesPerBuffer;
-    
-    /** Swaps the backbuffer to the front and flags the background reader
-        thread to update the new backbuffer */
-    void switchBuffer();
-    
-    HeapBlock<int16>* getFrontBuffer();
-    HeapBlock<int16>* getBackBuffer();
+    Atomic<int> m_slotSamples;      // samples read into each slot
+    Atomic<int> m_filledSlots;      // slots read and not played yet
+    Atomic<int> m_targetSlots;
+    Atomic<int> m_underruns;
+    Atomic<int64> m_seekTarget;
+    Atomic<int> m_seekState;        // SEEK_NONE, or a seek the ring has to be rewound for
+    double m_peakReadMs;            // slowest recent read, reader thread only
+    CriticalSection m_readerLock;   // held by the reader while it fills a slot
+    WaitableEvent m_slotFilled;
+
+    int16* getSlot (int slot) const;
+
+    enum SeekState
+    {
+        SEEK_NONE,
+        SEEK_REQUESTED,     // set by the message thread
+        SEEK_RING_RELEASED  // set by process(), which leaves the ring alone until the reader has rewound it
+    };
+
+    /** Moves playback to a sample, at once when stopped and through the reader thread while playing */
+    void seekPlayback (int64 sample);
+
+    /** Starts building the overview of the active record, from an instance of the source of its own */
+    void startOverview (int record);
+
+    /** Sets how many slots to keep filled from the time the last read took, with
+        enough margin for one read as slow as the slowest recent one */
+    void updateReadAhead (double readMs);
     
+    /** Hands the next samples of a mapped source to processChannelData without going through the cache */
+    void processMappedData (AudioSampleBuffer& buffer, int nSamples);
+
+    /** Sends the recorded events of the numSamples samples played from firstSample, looping back to the
+        start sample at the stop sample, with the timestamps of the block starting at blockTimestamp */
+    void addRecordedEvents (int64 firstSample, int numSamples, int64 blockTimestamp);
+
+    /** Asks the message thread to stop acquisition once an offline run has sent its last sample */
+    void stopOfflineProcessing();
+
     /** Executes the background thread task */
     void run() override;
     
-    /** Reads a chunk of the file that fills an entire buffer cache.
-     
-        This method will read into the buffer that passed in by the param 
-     */
-    void readAndFillBufferCache(HeapBlock<int16> &cacheBuffer);
+    /** Rewinds the ring to the playback position, filling its first slot with a blocking read */
+    void resetCache();
+
+    /** Reads the next samples of the file into a slot of the ring, looping back to the start sample
+        at the stop sample */
+    void readAndFillBufferCache (int16* slotBuffer);
 
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FileReader);
@@ -45,10 +45,42 @@ FileReaderEditor::FileReaderEditor (GenericProcessor* parentNode, bool useDefaul
     addAndMakeVisible (fileNameLabel);
 
     recordSelector = new ComboBox ("Recordings");
-    recordSelector->setBounds (30, 50, 120, 20);
+    recordSelector->setBounds (30, 50, 95, 20);
     recordSelector->addListener (this);
     addAndMakeVisible (recordSelector);
 
+    offlineButton = new UtilityButton ("OFFLINE", Font ("Very Small Text", 13, Font::plain));
+    offlineButton->setRadius (3.0f);
+    offlineButton->setBounds (130, 51, 45, 18);
+    offlineButton->addListener (this);
+    offlineButton->setClickingTogglesState (true);
+    offlineButton->setTooltip ("Process the file once, as fast as the signal chain allows, and stop at the stop time");
+    addAndMakeVisible (offlineButton);
+
+    speedLabel = new Label ("SpeedLabel", "Speed");
+    speedLabel->setFont (Font ("Small Text", 10, Font::plain));
+    speedLabel->setBounds (180, 27, 50, 20);
+    addAndMakeVisible (speedLabel);
+
+    speedSelector = new ComboBox ("Speed");
+    speedSelector->setBounds (180, 50, 50, 20);
+    speedSelector->setTooltip ("Playback speed, relative to the recorded rate");
+    for (float speed = MIN_PLAYBACK_SPEED; speed <= MAX_PLAYBACK_SPEED; speed *= 2)
+        speedSelector->addItem (String (speed) + "x", int (speed * 100));
+    speedSelector->setSelectedId (100, dontSendNotification);
+    speedSelector->addListener (this);
+    addAndMakeVisible (speedSelector);
+
+    underrunTitle = new Label ("UnderrunTitle", "Underruns");
+    underrunTitle->setFont (Font ("Small Text", 10, Font::plain));
+    underrunTitle->setBounds (183, 78, 50, 15);
+    addAndMakeVisible (underrunTitle);
+
+    underrunLabel = new Label ("UnderrunLabel", "0");
+    underrunLabel->setFont (Font ("Small Text", 10, Font::plain));
+    underrunLabel->setBounds (183, 93, 50, 15);
+    addAndMakeVisible (underrunLabel);
+
     currentTime = new DualTimeComponent (this, false);
     currentTime->setBounds (5, 80, 175, 20);
     addAndMakeVisible (currentTime);
@@ -57,7 +89,11 @@ FileReaderEditor::FileReaderEditor (GenericProcessor* parentNode, bool useDefaul
     timeLimits->setBounds (5, 105, 175, 20);
     addAndMakeVisible (timeLimits);
 
-    desiredWidth = 180;
+    overview = new OverviewComponent (this, fileReader);
+    overview->setBounds (240, 27, 145, 98);
+    addAndMakeVisible (overview);
+
+    desiredWidth = 390;
 
     setEnabledState (false);
 }
@@ -104,7 +140,11 @@ void FileReaderEditor::buttonEvent (Button* button)
 {
     if (! acquisitionIsActive)
     {
-        if (button == fileButton)
+        if (button == offlineButton)
+        {
+            fileReader->setParameter (3, offlineButton->getToggleState() ? 1.0f : 0.0f);
+        }
+        else if (button == fileButton)
         {
             FileChooser chooseFileReaderFile ("Please select the file you want to load...",
                                               lastFilePath,
@@ -166,6 +206,12 @@ void FileReaderEditor::setCurrentTime (unsigned int ms)
 
 void FileReaderEditor::comboBoxChanged (ComboBox* combo)
 {
+    if (combo == speedSelector)
+    {
+        fileReader->setParameter (4, combo->getSelectedId() / 100.0f);
+        return;
+    }
+
     fileReader->setParameter (0, combo->getSelectedId() - 1);
     CoreServices::updateSignalChain (this);
 }
@@ -186,6 +232,32 @@ void FileReaderEditor::populateRecordings (FileSource* source)
 }
 
 
+void FileReaderEditor::seekPlayback (unsigned int ms)
+{
+    fileReader->setParameter (5, ms);
+
+    if (! acquisitionIsActive)
+        currentTime->setTimeMilliseconds (0, ms);
+}
+
+
+void FileReaderEditor::updatePlaybackStatus()
+{
+    triggerAsyncUpdate();
+}
+
+
+void FileReaderEditor::handleAsyncUpdate()
+{
+    underrunLabel->setText (String (fileReader->getNumUnderruns()), dontSendNotification);
+
+    const String tooltip = "Blocks sent empty because the file couldn't be read in time. Reading "
+                           + String (fileReader->getReadAheadMs()) + " ms ahead";
+    underrunTitle->setTooltip (tooltip);
+    underrunLabel->setTooltip (tooltip);
+}
+
+
 void FileReaderEditor::clearEditor()
 {
     fileNameLabel->setText ("No file selected.", dontSendNotification);
@@ -203,6 +275,9 @@ void FileReaderEditor::clearEditor()
 void FileReaderEditor::startAcquisition()
 {
     recordSelector->setEnabled (false);
+    offlineButton->setEnabledState (false);
+    speedSelector->setEnabled (false);
+    updatePlaybackStatus();
     timeLimits->setEnable (false);
 }
 
@@ -210,6 +285,8 @@ void FileReaderEditor::startAcquisition()
 void FileReaderEditor::stopAcquisition()
 {
     recordSelector->setEnabled (true);
+    offlineButton->setEnabledState (true);
+    speedSelector->setEnabled (true);
     timeLimits->setEnable (true);
 }
 
@@ -225,6 +302,12 @@ void FileReaderEditor::saveCustomParameters (XmlElement* xml)
     childNode = xml->createNewChildElement ("TIME_LIMITS");
     childNode->setAttribute ("start_time",  (double)timeLimits->getTimeMilliseconds (0));
     childNode->setAttribute ("stop_time",   (double)timeLimits->getTimeMilliseconds (1));
+
+    childNode = xml->createNewChildElement ("OFFLINE");
+    childNode->setAttribute ("enabled", offlineButton->getToggleState());
+
+    childNode = xml->createNewChildElement ("PLAYBACK");
+    childNode->setAttribute ("speed", fileReader->getPlaybackSpeed());
 }
 
 
@@ -252,6 +335,17 @@ void FileReaderEditor::loadCustomParameters (XmlElement* xml)
             setPlaybackStopTime (time);
             timeLimits->setTimeMilliseconds (1, time);
         }
+        else if (element->hasTagName ("OFFLINE"))
+        {
+            const bool offline = element->getBoolAttribute ("enabled", false);
+            offlineButton->setToggleState (offline, dontSendNotification);
+            fileReader->setParameter (3, offline ? 1.0f : 0.0f);
+        }
+        else if (element->hasTagName ("PLAYBACK"))
+        {
+            fileReader->setParameter (4, (float) element->getDoubleAttribute ("speed", 1.0));
+            speedSelector->setSelectedId (int (fileReader->getPlaybackSpeed() * 100), dontSendNotification);
+        }
     }
 }
 
@@ -434,3 +528,110 @@ void DualTimeComponent::labelTextChanged (Label* label)
     else
         setTimeMilliseconds (index, getTimeMilliseconds (index));
 }
+
+
+// OverviewComponent
+// ================================================================================
+OverviewComponent::OverviewComponent (FileReaderEditor* e, FileReader* reader)
+    : numValues     (0)
+    , editor        (e)
+    , fileReader    (reader)
+{
+    setTooltip ("Click to seek");
+    startTimer (200);
+}
+
+
+OverviewComponent::~OverviewComponent()
+{
+}
+
+
+void OverviewComponent::paint (Graphics& g)
+{
+    g.fillAll (Colours::darkgrey);
+
+    const int width  = getWidth();
+    const int height = getHeight();
+    const FileOverview& fileOverview = fileReader->getOverview();
+    const int64 numSamples = fileOverview.getNumSamples();
+
+    if (fileOverview.getNumChannels() == 0 || numSamples <= 0)
+        return;
+
+    if (numValues != width)
+    {
+        minValues.malloc (width);
+        maxValues.malloc (width);
+        rmsValues.malloc (width);
+        numValues = width;
+    }
+
+    if (fileOverview.getEnvelope (-1, 0, numSamples, width, minValues, maxValues, rmsValues))
+    {
+        float peak = 1.0f;
+        for (int i = 0; i < width; ++i)
+            peak = jmax (peak, std::abs (minValues[i]), std::abs (maxValues[i]));
+
+        const float centre = height / 2.0f;
+        const float scale  = (height / 2.0f - 1.0f) / peak;
+
+        for (int x = 0; x < width; ++x)
+        {
+            g.setColour (Colours::lightgrey);
+            g.drawVerticalLine (x, centre - maxValues[x] * scale, centre - minValues[x] * scale + 1.0f);
+
+            g.setColour (Colours::white);
+            g.drawVerticalLine (x, centre - rmsValues[x] * scale, centre + rmsValues[x] * scale + 1.0f);
+        }
+    }
+
+    // samples outside of the playback limits are shaded
+    const float startX = float (width * fileReader->getStartSample() / numSamples);
+    const float stopX  = float (width * fileReader->getStopSample() / numSamples);
+
+    g.setColour (Colours::black.withAlpha (0.5f));
+    g.fillRect (0.0f, 0.0f, startX, float (height));
+    g.fillRect (stopX, 0.0f, width - stopX, float (height));
+
+    g.setColour (Colours::yellow);
+    g.drawVerticalLine (int (width * fileReader->getPlaybackPosition() / numSamples), 0.0f, float (height));
+
+    if (! fileOverview.isComplete())
+    {
+        g.setFont (Font ("Small Text", 10, Font::plain));
+        g.setColour (Colours::yellow);
+        g.drawText ("Building overview " + String (roundToInt (fileOverview.getProgress() * 100)) + "%",
+                    0, height - 12, width, 12, Justification::centred, false);
+    }
+}
+
+
+void OverviewComponent::mouseDown (const MouseEvent& event)
+{
+    seekToPosition (event.x);
+}
+
+
+void OverviewComponent::mouseDrag (const MouseEvent& event)
+{
+    seekToPosition (event.x);
+}
+
+
+void OverviewComponent::seekToPosition (int x)
+{
+    const int64 numSamples = fileReader->getNumSamples();
+
+    if (numSamples <= 0 || getWidth() <= 0)
+        return;
+
+    const double fraction = jlimit (0.0, 1.0, double (x) / getWidth());
+    editor->seekPlayback ((unsigned int) (fraction * numSamples * 1000.0 / fileReader->getDefaultSampleRate()));
+}
+
+
+void OverviewComponent::timerCallback()
+{
+    repaint();
+}
@@ -30,6 +30,7 @@
 
 class FileReader;
 class DualTimeComponent;
+class OverviewComponent;
 class FileSource;
 
 /**
@@ -43,6 +44,7 @@ class FileSource;
 class FileReaderEditor  : public GenericEditor
                         , public FileDragAndDropTarget
                         , public ComboBox::Listener
+                        , public AsyncUpdater
 {
 public:
     FileReaderEditor (GenericProcessor* parentNode, bool useDefaultParameterEditors);
@@ -67,6 +69,9 @@ public:
     void setTotalTime   (unsigned int ms);
     void setCurrentTime (unsigned int ms);
 
+    /** Moves playback to the given time, also while acquiring */
+    void seekPlayback (unsigned int ms);
+
 	void startAcquisition() override;
 	void stopAcquisition()  override;
 
@@ -75,6 +80,10 @@ public:
     void comboBoxChanged (ComboBox* combo);
     void populateRecordings (FileSource* source);
 
+    /** Shows the underrun count and read-ahead of the File Reader. Can be called from any thread */
+    void updatePlaybackStatus();
+    void handleAsyncUpdate() override;
+
 
 private:
     void clearEditor();
@@ -83,8 +92,14 @@ private:
     ScopedPointer<UtilityButton>        fileButton;
     ScopedPointer<Label>                fileNameLabel;
     ScopedPointer<ComboBox>             recordSelector;
+    ScopedPointer<UtilityButton>        offlineButton;
+    ScopedPointer<Label>                speedLabel;
+    ScopedPointer<ComboBox>             speedSelector;
+    ScopedPointer<Label>                underrunTitle;
+    ScopedPointer<Label>                underrunLabel;
     ScopedPointer<DualTimeComponent>    currentTime;
     ScopedPointer<DualTimeComponent>    timeLimits;
+    ScopedPointer<OverviewComponent>    overview;
 
     FileReader* fileReader;
     unsigned int recTotalTime;
@@ -127,5 +142,39 @@ private:
 };
 
 
+/**
+  Min/max envelope of the whole recording, with the RMS band, the playback limits and the playhead.
+  Clicking on it seeks playback there.
+
+  @see FileOverview
+*/
+class OverviewComponent : public Component
+                        , public SettableTooltipClient
+                        , public Timer
+{
+public:
+    OverviewComponent (FileReaderEditor* e, FileReader* reader);
+    ~OverviewComponent();
+
+    void paint (Graphics& g) override;
+    void mouseDown (const MouseEvent& event) override;
+    void mouseDrag (const MouseEvent& event) override;
+
+    void timerCallback() override;
+
+
+private:
+    void seekToPosition (int x);
+
+    HeapBlock<float> minValues;
+    HeapBlock<float> maxValues;
+    HeapBlock<float> rmsValues;
+    int numValues;
+
+    FileReaderEditor* editor;
+    FileReader* fileReader;
+};
+
+
 
 #endif  // __FILEREADEREDITOR_H_D6EC8B48__
@@ -22,6 +22,8 @@
 */
 
 #include "FileSource.h"
+#include <algorithm>
+#include "../Dsp/VectorOps.h"
 
 
 FileSource::FileSource() 
@@ -108,6 +110,11 @@ void FileSource::setActiveRecord (int index)
 {
 //    activeRecord = index;
     activeRecord.set(index);
+
+    activeBitVolts.clearQuick();
+    for (int i = 0; i < getRecordNumChannels (index); ++i)
+        activeBitVolts.add (getChannelInfo (index, i).bitVolts);
+
     updateActiveRecord();
 }
 
@@ -130,6 +137,15 @@ bool FileSource::OpenFile (File file)
     {
         fileOpened = true;
         fillRecordInfo();
+        fillEventInfo();
+
+        // a stable sort, so that events at the same sample keep the order they were recorded in
+        for (int i = 0; i < infoArray.size(); ++i)
+        {
+            Array<RecordedEvent>& events = infoArray.getReference (i).events;
+            std::stable_sort (events.begin(), events.end(),
+                              [] (const RecordedEvent& a, const RecordedEvent& b) { return a.sample < b.sample; });
+        }
 
         filename = file.getFullPathName();
     }
@@ -142,7 +158,131 @@ bool FileSource::OpenFile (File file)
     return fileOpened;
 }
 
+void FileSource::processAllChannelsData (int16* inBuffer, float* const* outBuffers, int64 numSamples)
+{
+    const int numChannels = getActiveNumChannels();
+
+    for (int i = 0; i < numChannels; ++i)
+        processChannelData (inBuffer, outBuffers[i], i, numSamples);
+}
+
+
+void FileSource::deinterleaveChannels (const int16* inBuffer, float* const* outBuffers, const float* bitVolts,
+                                       int numChannels, int64 numSamples)
+{
+    VectorOps::deinterleave (inBuffer, outBuffers, bitVolts, numChannels, numSamples);
+}
+
+
 bool FileSource::isReady()
 {
     return true;
 }
+
+
+bool FileSource::canBeReadConcurrently() const
+{
+    return true;
+}
+
+
+const int16* FileSource::getMappedData (int64 /*sample*/, int64 /*nSamples*/)
+{
+    return nullptr;
+}
+
+
+void FileSource::fillEventInfo()
+{
+}
+
+
+int FileSource::getNumEventTracks() const
+{
+    return eventTracks.size();
+}
+
+
+const RecordedEventTrack& FileSource::getEventTrack (int index) const
+{
+    return eventTracks.getReference (index);
+}
+
+
+int FileSource::getActiveNumEvents() const
+{
+    return infoArray.getReference (activeRecord.get()).events.size();
+}
+
+
+const RecordedEvent& FileSource::getActiveEvent (int index) const
+{
+    return infoArray.getReference (activeRecord.get()).events.getReference (index);
+}
+
+
+int FileSource::findEvent (int64 sample) const
+{
+    const Array<RecordedEvent>& events = infoArray.getReference (activeRecord.get()).events;
+
+    const RecordedEvent* first = std::lower_bound (events.begin(), events.end(), sample,
+                                                   [] (const RecordedEvent& e, int64 s) { return e.sample < s; });
+    return int (first - events.begin());
+}
+
+
+const char* FileSource::getEventText (const RecordedEvent& event) const
+{
+    // Strings hold UTF-8, so this doesn't convert anything
+    return eventTexts.strings.getReference (event.text).toRawUTF8();
+}
+
+
+int FileSource::addEventTrack (RecordedEventTrack::Type type, const String& name, int size)
+{
+    RecordedEventTrack track;
+    track.type = type;
+    track.name = name;
+    track.size = size;
+
+    eventTracks.add (track);
+    return eventTracks.size() - 1;
+}
+
+
+void FileSource::addTTLEvent (int record, int track, int64 sample, int line, bool state)
+{
+    if (! isPositiveAndBelow (record, infoArray.size()) || ! isPositiveAndBelow (track, eventTracks.size())
+        || sample < 0 || sample >= infoArray[record].numSamples)
+        return;
+
+    RecordedEvent event;
+    event.sample = sample;
+    event.track = track;
+    event.line = line;
+    event.state = state;
+    event.text = -1;
+
+    infoArray.getReference (record).events.add (event);
+}
+
+
+void FileSource::addTextEvent (int record, int track, int64 sample, const String& text)
+{
+    if (! isPositiveAndBelow (record, infoArray.size()) || ! isPositiveAndBelow (track, eventTracks.size())
+        || sample < 0 || sample >= infoArray[record].numSamples)
+        return;
+
+    RecordedEvent event;
+    event.sample = sample;
+    event.track = track;
+    event.line = 0;
+    event.state = false;
+    event.text = eventTexts.size();
+
+    eventTexts.add (text);
+    infoArray.getReference (record).events.add (event);
+
+    RecordedEventTrack& info = eventTracks.getReference (track);
+    info.size = jmax (info.size, int (text.getNumBytesAsUTF8()) + 1);
+}
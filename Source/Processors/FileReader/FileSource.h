@@ -35,6 +35,37 @@ struct RecordedChannelInfo
 };
 
 
+/** A stream of events recorded along with the samples, replayed by the File Reader on an event channel of its own */
+struct RecordedEventTrack
+{
+    enum Type
+    {
+        TTL,
+        TEXT
+    };
+
+    Type type;
+    String name;
+
+    /** TTL lines of a TTL track, or bytes of the longest text of a text track */
+    int size;
+};
+
+
+/** An event of a record, found through FileSource::findEvent() */
+struct RecordedEvent
+{
+    /** Sample of the record it happened at */
+    int64 sample;
+    int track;
+
+    /** TTL line and state, or the index of the text for FileSource::getEventText() */
+    int line;
+    bool state;
+    int text;
+};
+
+
 class PLUGIN_API FileSource
 {
 public:
@@ -65,10 +96,38 @@ public:
 
     virtual int readData (int16* buffer, int nSamples) = 0;
     virtual void processChannelData (int16* inBuffer, float* outBuffer, int channel, int64 numSamples) = 0;
+
+    /** Converts the interleaved samples of every channel of the active record at once, channel c going to
+        outBuffers[c], which saves walking the whole input once per channel. The default calls
+        processChannelData for each channel; sources storing plain scaled int16 can use deinterleaveChannels. */
+    virtual void processAllChannelsData (int16* inBuffer, float* const* outBuffers, int64 numSamples);
     virtual void seekTo (int64 sample) = 0;
 
+    /** Returns the interleaved samples [sample, sample + nSamples) of the active record where they lie in memory,
+        for sources that map their files. FileReader then hands them straight to processChannelData instead of
+        copying them through its read cache. The default returns nullptr, meaning readData must be used. */
+    virtual const int16* getMappedData (int64 sample, int64 nSamples);
+
     virtual bool isReady();
 
+    /** Returns false if two instances of the source can't read files from different threads at the same time,
+        as with the HDF5 library. The File Reader then holds off building its overview while it plays. */
+    virtual bool canBeReadConcurrently() const;
+
+    /** The event tracks found next to the file when it was opened, shared by all records */
+    int getNumEventTracks() const;
+    const RecordedEventTrack& getEventTrack (int index) const;
+
+    /** Events of the active record, ordered by sample */
+    int getActiveNumEvents() const;
+    const RecordedEvent& getActiveEvent (int index) const;
+
+    /** Index of the first event of the active record at or after a sample, or getActiveNumEvents() if there is none */
+    int findEvent (int64 sample) const;
+
+    /** UTF-8 text of a text event, valid for as long as the file stays open */
+    const char* getEventText (const RecordedEvent& event) const;
+
 protected:
     struct RecordInfo
     {
@@ -76,20 +135,43 @@ protected:
         Array<RecordedChannelInfo> channels;
         int64 numSamples;
         float sampleRate;
+        Array<RecordedEvent> events;
     };
     Array<RecordInfo> infoArray;
 
+    Array<RecordedEventTrack> eventTracks;
+    StringArray eventTexts;
+
+    /** Adds a track, returning its index. A text track grows to the longest text added to it. */
+    int addEventTrack (RecordedEventTrack::Type type, const String& name, int size);
+
+    /** Adds an event to a record, keeping a copy of a text in eventTexts. Events outside the record are left out. */
+    void addTTLEvent (int record, int track, int64 sample, int line, bool state);
+    void addTextEvent (int record, int track, int64 sample, const String& text);
+
     bool fileOpened;
     int numRecords;
     Atomic<int> activeRecord;       // atomic to protect against threaded data race in FileReader
     String filename;
 
+    /** Bit volts of each channel of the active record */
+    Array<float> activeBitVolts;
+
+    /** Writes channel c of the interleaved inBuffer, scaled by bitVolts[c], to outBuffers[c].
+        @see VectorOps::deinterleave */
+    static void deinterleaveChannels (const int16* inBuffer, float* const* outBuffers, const float* bitVolts,
+                                      int numChannels, int64 numSamples);
+
 
 private:
     virtual bool Open (File file) = 0;
     virtual void fillRecordInfo() = 0;
     virtual void updateActiveRecord() = 0;
 
+    /** Indexes the events recorded along with the file into eventTracks and the events of infoArray, once the records
+        are known. Called by OpenFile, which then sorts the events of each record. The default finds none. */
+    virtual void fillEventInfo();
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FileSource);
 };
 
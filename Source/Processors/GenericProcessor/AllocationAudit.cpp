@@ -0,0 +1,272 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "AllocationAudit.h"
+
+#if ALLOCATION_AUDIT && (JUCE_LINUX || JUCE_MAC)
+ #include <execinfo.h>
+ #define ALLOCATION_AUDIT_STACKS 1
+#else
+ #define ALLOCATION_AUDIT_STACKS 0
+#endif
+
+#if JUCE_MSVC && _MSC_VER < 1900
+ #define AUDIT_THREAD_LOCAL __declspec(thread)
+#else
+ #define AUDIT_THREAD_LOCAL thread_local
+#endif
+
+
+namespace
+{
+    /** Allocations kept with their call stacks; any more are only counted */
+    const int maxRecorded = 16;
+    const int maxFrames = 32;
+
+    struct Record
+    {
+        const char* threadName;
+        size_t size;
+        int64 block;
+        void* frames[maxFrames];
+        int numFrames;
+    };
+
+    Record records[maxRecorded];
+
+    // constant-initialized, so that allocations made before static construction find them
+    std::atomic<int> mode (ALLOCATION_AUDIT);
+    std::atomic<int> generation (1);
+    std::atomic<int64> numAllocations (0);
+
+    /** Plain data only: the allocator hook may run before any constructor, or within one */
+    struct ThreadState
+    {
+        const char* name;
+        int generation;
+        int64 blocks;
+        int exemptions;
+        bool inHook;
+    };
+
+    AUDIT_THREAD_LOCAL ThreadState threadState = { nullptr, 0, 0, 0, false };
+}
+
+
+bool AllocationAudit::isCompiledIn()
+{
+    return ALLOCATION_AUDIT != 0;
+}
+
+
+void AllocationAudit::setMode (Mode newMode)
+{
+    mode.store (newMode);
+}
+
+
+AllocationAudit::Mode AllocationAudit::getMode()
+{
+    return (Mode) mode.load();
+}
+
+
+void AllocationAudit::restart()
+{
+    numAllocations.store (0);
+    ++generation;
+}
+
+
+void AllocationAudit::endBlock (const char* threadName)
+{
+    if (! isCompiledIn())
+        return;
+
+    ThreadState& state = threadState;
+    const int currentGeneration = generation.load (std::memory_order_relaxed);
+
+    if (state.generation != currentGeneration)
+    {
+        state.generation = currentGeneration;
+        state.blocks = 0;
+    }
+
+    state.name = threadName;
+    ++state.blocks;
+}
+
+
+int64 AllocationAudit::getNumAllocations()
+{
+    return numAllocations.load();
+}
+
+
+void AllocationAudit::noteAllocation (size_t size)
+{
+    ThreadState& state = threadState;
+
+    if (state.name == nullptr || state.inHook || state.exemptions > 0
+        || state.blocks < ALLOCATION_AUDIT_WARMUP_BLOCKS
+        || state.generation != generation.load (std::memory_order_relaxed)
+        || mode.load (std::memory_order_relaxed) == DISABLED)
+        return;
+
+    // whatever the recording itself allocates isn't reported
+    state.inHook = true;
+
+    const int64 index = numAllocations++;
+
+    if (index < maxRecorded)
+    {
+        Record& record = records[index];
+        record.threadName = state.name;
+        record.size = size;
+        record.block = state.blocks;
+       #if ALLOCATION_AUDIT_STACKS
+        record.numFrames = backtrace (record.frames, maxFrames);
+       #else
+        record.numFrames = 0;
+       #endif
+    }
+
+    if (mode.load() == BREAK)
+        jassertfalse;
+
+    state.inHook = false;
+}
+
+
+String AllocationAudit::getReport()
+{
+    const int64 count = numAllocations.load();
+
+    if (count == 0)
+        return String::empty;
+
+    String report = String (count) + " allocations in audited threads after "
+        + String (ALLOCATION_AUDIT_WARMUP_BLOCKS) + " blocks:\n";
+
+    for (int i = 0; i < jmin<int64> (count, maxRecorded); ++i)
+    {
+        const Record& record = records[i];
+        report += "  " + String (record.threadName) + ", block " + String (record.block)
+            + ", " + String ((int64) record.size) + " bytes\n";
+
+       #if ALLOCATION_AUDIT_STACKS
+        // the hook and noteAllocation() come first
+        const int firstFrame = jmin (2, record.numFrames);
+
+        if (char** symbols = backtrace_symbols (record.frames, record.numFrames))
+        {
+            for (int frame = firstFrame; frame < record.numFrames; ++frame)
+                report += "      " + String (symbols[frame]) + "\n";
+
+            ::free (symbols);
+        }
+       #endif
+    }
+
+    if (count > maxRecorded)
+        report += "  and " + String (count - maxRecorded) + " more\n";
+
+    return report;
+}
+
+
+AllocationAudit::ScopedExemption::ScopedExemption()
+{
+    ++threadState.exemptions;
+}
+
+
+AllocationAudit::ScopedExemption::~ScopedExemption()
+{
+    --threadState.exemptions;
+}
+
+
+// =====================================================================
+
+#if ALLOCATION_AUDIT
+ #if JUCE_LINUX
+
+// glibc lets the executable replace malloc, and still provides its own under these names
+extern "C"
+{
+    void* __libc_malloc (size_t size);
+    void* __libc_calloc (size_t count, size_t size);
+    void* __libc_realloc (void* ptr, size_t size);
+
+    void* malloc (size_t size) __THROW
+    {
+        AllocationAudit::noteAllocation (size);
+        return __libc_malloc (size);
+    }
+
+    void* calloc (size_t count, size_t size) __THROW
+    {
+        AllocationAudit::noteAllocation (count * size);
+        return __libc_calloc (count, size);
+    }
+
+    void* realloc (void* ptr, size_t size) __THROW
+    {
+        // a size of 0 frees, while shrinking can't be told apart here from growing
+        if (size > 0)
+            AllocationAudit::noteAllocation (size);
+
+        return __libc_realloc (ptr, size);
+    }
+}
+
+ #else
+
+// elsewhere only what goes through operator new is seen
+void* operator new (size_t size)
+{
+    AllocationAudit::noteAllocation (size);
+
+    if (void* ptr = std::malloc (size > 0 ? size : 1))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[] (size_t size)
+{
+    return operator new (size);
+}
+
+void operator delete (void* ptr) throw()
+{
+    std::free (ptr);
+}
+
+void operator delete[] (void* ptr) throw()
+{
+    std::free (ptr);
+}
+
+ #endif
+#endif
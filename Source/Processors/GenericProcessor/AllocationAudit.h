@@ -0,0 +1,112 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __ALLOCATIONAUDIT_H_4E19A7C2__
+#define __ALLOCATIONAUDIT_H_4E19A7C2__
+
+#include <JuceHeader.h>
+#include "../PluginManager/OpenEphysPlugin.h"
+#include <atomic>
+
+/** Build with ALLOCATION_AUDIT=1 to report the allocations of the audited threads once
+    acquisition is stopped, or =2 to also assert on each of them as it happens */
+#ifndef ALLOCATION_AUDIT
+ #define ALLOCATION_AUDIT 0
+#endif
+
+/** Blocks an audited thread may allocate in, after acquisition starts, before its
+    allocations are reported */
+#define ALLOCATION_AUDIT_WARMUP_BLOCKS 64
+
+/**
+    Finds the memory allocations of the threads that must not allocate once acquisition
+    has settled: the audio callback, the DataThreads and the record threads.
+
+    Each of these threads calls endBlock() once per cycle, which makes it audited. After
+    ALLOCATION_AUDIT_WARMUP_BLOCKS cycles, every allocation it makes is counted, and the
+    first ones are kept with their call stacks for getReport(). restart() starts over,
+    every thread warming up again, and is called when acquisition starts.
+
+    The allocator is only hooked in builds with ALLOCATION_AUDIT set: on Linux malloc,
+    calloc and realloc themselves, which operator new goes through, elsewhere the global
+    operator new. Otherwise every method does nothing, and isCompiledIn() returns false.
+
+    Allocations a thread can't avoid, such as the objects record engines take, are made
+    within a ScopedExemption.
+
+    @see TraceRecorder, OverrunWatchdog
+*/
+class PLUGIN_API AllocationAudit
+{
+public:
+    enum Mode
+    {
+        DISABLED = 0,
+        REPORT,
+        /** Reports, and also breaks with jassertfalse where the allocation happens */
+        BREAK
+    };
+
+    /** Returns true if the allocator is hooked in this build */
+    static bool isCompiledIn();
+
+    /** Sets what happens to the allocations of audited threads, REPORT or BREAK by default
+        depending on ALLOCATION_AUDIT */
+    static void setMode (Mode mode);
+
+    static Mode getMode();
+
+    /** Clears the report, and makes every audited thread warm up again */
+    static void restart();
+
+    /** Ends a cycle of the calling thread, auditing it from now on under threadName, which
+        must be a literal */
+    static void endBlock (const char* threadName);
+
+    /** Number of allocations found since restart() */
+    static int64 getNumAllocations();
+
+    /** Describes the allocations found since restart(), the first ones with their call stacks,
+        or returns an empty string if there were none */
+    static String getReport();
+
+    /** Called by the allocator hook */
+    static void noteAllocation (size_t size);
+
+    /** Lets the calling thread allocate without it being reported, for as long as it exists */
+    class PLUGIN_API ScopedExemption
+    {
+    public:
+        ScopedExemption();
+        ~ScopedExemption();
+
+    private:
+        JUCE_DECLARE_NON_COPYABLE (ScopedExemption);
+    };
+
+private:
+    AllocationAudit() = delete;
+};
+
+
+#endif  // __ALLOCATIONAUDIT_H_4E19A7C2__
@@ -0,0 +1,161 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "ChannelThreadPool.h"
+#include "GenericProcessor.h"
+
+
+class ChannelThreadPool::PoolThread : public Thread
+{
+public:
+    PoolThread (ChannelThreadPool& p)
+        : Thread ("Channel processing thread")
+        , pool   (p)
+    {
+    }
+
+    ~PoolThread()
+    {
+        stopThread (4000);
+    }
+
+    void run() override
+    {
+        disableDenormals();
+
+        while (! threadShouldExit())
+        {
+            wait (-1);
+
+            if (! threadShouldExit())
+                pool.helpWithCurrentJob();
+        }
+    }
+
+private:
+    ChannelThreadPool& pool;
+
+    JUCE_DECLARE_NON_COPYABLE (PoolThread);
+};
+
+
+ChannelThreadPool::ChannelThreadPool()
+    : remainingTasks (0)
+{
+    for (int i = 0; i < 2; ++i)
+        jobs[i].numTasks = 0;
+
+    // the thread calling processChannels() does its share of the work
+    const int numThreads = jlimit (0, 7, SystemStats::getNumCpus() - 1);
+
+    for (int i = 0; i < numThreads; ++i)
+    {
+        threads.add (new PoolThread (*this));
+        threads.getLast()->startThread (9);
+    }
+}
+
+
+ChannelThreadPool::~ChannelThreadPool()
+{
+    threads.clear();
+}
+
+
+int ChannelThreadPool::getNumThreads() const
+{
+    return threads.size();
+}
+
+
+bool ChannelThreadPool::processChannels (GenericProcessor* processor, AudioSampleBuffer& buffer, int numChannels, int channelsPerTask,
+                                         int maxThreads)
+{
+    const GenericScopedTryLock<SpinLock> lock (jobLock);
+
+    if (! lock.isLocked())
+        return false;
+
+    // a job slot is only reused two jobs later, once every task of its job is done
+    const int64 jobNumber = (state.get() >> 32) + 1;
+    Job& job = jobs[jobNumber & 1];
+
+    job.processor = processor;
+    job.buffer = &buffer;
+    job.numChannels = numChannels;
+    job.channelsPerTask = channelsPerTask;
+    job.numTasks = (numChannels + channelsPerTask - 1) / channelsPerTask;
+
+    remainingTasks = job.numTasks;
+    state = jobNumber << 32;
+
+    const int numHelpers = (maxThreads < 0) ? threads.size() : jmin (maxThreads, threads.size());
+
+    for (int i = 0; i < numHelpers; ++i)
+        threads.getUnchecked (i)->notify();
+
+    helpWithCurrentJob();
+
+    while (remainingTasks.get() > 0)
+        jobFinished.wait();
+
+    return true;
+}
+
+
+void ChannelThreadPool::disableDenormals()
+{
+    FloatVectorOperations::disableDenormalisedNumberSupport();
+
+   #if JUCE_ARM && defined (__aarch64__) && defined (__GNUC__)
+    // the flush-to-zero bit of FPCR, which JUCE only sets on SSE
+    uint64 fpcr;
+    asm volatile ("mrs %0, fpcr" : "=r" (fpcr));
+    asm volatile ("msr fpcr, %0" : : "r" (fpcr | (uint64 (1) << 24)));
+   #endif
+}
+
+
+void ChannelThreadPool::helpWithCurrentJob()
+{
+    for (;;)
+    {
+        const int64 s = state.get();
+        const Job& job = jobs[(s >> 32) & 1];
+        const int task = (int) (s & 0xffffffff);
+
+        if (task >= job.numTasks)
+            return;
+
+        if (state.compareAndSetBool (s + 1, s))
+        {
+            const int firstChannel = task * job.channelsPerTask;
+            const int lastChannel = jmin (firstChannel + job.channelsPerTask, job.numChannels);
+
+            job.processor->processChannels (*job.buffer, firstChannel, lastChannel);
+
+            if (--remainingTasks == 0)
+                jobFinished.signal();
+        }
+    }
+}
@@ -0,0 +1,97 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __CHANNELTHREADPOOL_H_6B1D2E47__
+#define __CHANNELTHREADPOOL_H_6B1D2E47__
+
+#include <JuceHeader.h>
+
+class GenericProcessor;
+
+/**
+    Threads shared by all processors to run GenericProcessor::processChannels() on
+    several ranges of channels at once.
+
+    A job is split into tasks of consecutive channels that the calling thread and the pool
+    threads claim one at a time from a shared counter, so that whichever thread is free
+    picks up the next range and a slow thread never holds the others back. The counter
+    also holds the job number in its upper half, so a thread that wakes up late can never
+    claim a task from a job other than the current one.
+
+    Only one processor's job runs at a time; a processor that finds the pool busy (for
+    instance because the signal chain branches are being rendered in parallel) simply
+    processes its channels itself.
+
+    @see GenericProcessor::processChannelsInParallel
+*/
+class ChannelThreadPool
+{
+public:
+    ChannelThreadPool();
+    ~ChannelThreadPool();
+
+    /** Returns the number of threads helping the calling thread.*/
+    int getNumThreads() const;
+
+    /** Calls processor->processChannels() on consecutive ranges of channelsPerTask channels
+        covering [0, numChannels), and returns once all of them are done. Only the first
+        maxThreads pool threads are woken up to help, all of them if it is negative.
+
+        @return false, having processed nothing, if the pool is busy with another job.
+    */
+    bool processChannels (GenericProcessor* processor, AudioSampleBuffer& buffer, int numChannels, int channelsPerTask,
+                          int maxThreads = -1);
+
+    /** Makes the calling thread flush denormal results and inputs to zero, on SSE and on 64-bit ARM,
+        so that recursive filters decaying into silence don't slow down to a crawl. Every pool thread
+        calls it, and so does any thread running GenericProcessor::processChannelsInParallel().*/
+    static void disableDenormals();
+
+private:
+    class PoolThread;
+
+    struct Job
+    {
+        GenericProcessor* processor;
+        AudioSampleBuffer* buffer;
+        int numChannels;
+        int channelsPerTask;
+        int numTasks;
+    };
+
+    /** Claims and processes tasks of the current job until none are left.*/
+    void helpWithCurrentJob();
+
+    Job jobs[2];
+    Atomic<int64> state;
+    Atomic<int> remainingTasks;
+    WaitableEvent jobFinished;
+    SpinLock jobLock;
+
+    OwnedArray<PoolThread> threads;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ChannelThreadPool);
+};
+
+
+#endif  // __CHANNELTHREADPOOL_H_6B1D2E47__
@@ -21,13 +21,17 @@
 
 */
 #include "GenericProcessor.h"
+#include "ChannelThreadPool.h"
+#include "../Editors/VisualizerEditor.h"
 #include "../../UI/UIComponent.h"
 #include "../../AccessClass.h"
+#include "../ProcessorGraph/ProcessorGraph.h"
 
 #include <exception>
 
 
 const String GenericProcessor::m_unusedNameString ("xxx-UNUSED-OPEN-EPHYS-xxx");
+Atomic<int> GenericProcessor::m_measureEventLatency (0);
 
 GenericProcessor::GenericProcessor (const String& name)
     : sourceNode                    (0)
@@ -41,12 +45,31 @@ GenericProcessor::GenericProcessor (const String& name)
     , editor                        (nullptr)
     , parametersAsXml               (nullptr)
     , sendSampleCount               (true)
+    , m_oldestSourceHostTicks           (0)
+    , m_lastBlockTicks                  (0)
+    , m_parameterChangeBlockStart       (-1)
+    , m_displayTap                      (new DisplayTap())
+    , m_isIdle                          (0)
+    , m_traceName                       (nullptr)
+    , m_subBlockSize                    (0)
+    , m_subBlockStart                   (0)
+    , m_subBlockLength                  (-1)
+    , m_subscribedToSyncTexts           (true)
+    , m_eventArenaSize                  (0)
+    , m_eventArenaUsed                  (0)
+    , m_maxChannelThreads               (-1)
+    , m_blockEventBuffer                (nullptr)
+    , m_blockEventsValid                (false)
     , m_processorType                   (PROCESSOR_TYPE_UTILITY)
     , m_name                            (name)
     , m_isParamsWereLoaded              (false)
 {
     settings.numInputs = settings.numOutputs = 0;
 	m_lastProcessTime = Time::getHighResolutionTicks();
+
+	// room for a full queue of changes, so that taking them allocates nothing
+	m_pendingParameterChanges.ensureStorageAllocated (m_parameterChangeQueue.getCapacity());
+	m_poppedParameterChanges.malloc (m_parameterChangeQueue.getCapacity());
 }
 
 
@@ -282,17 +305,21 @@ void GenericProcessor::clearSettings()
 
     // std::cout << "Record status size = " << recordStatus.size() << std::endl;
 
-    if (m_recordStatus.size() < dataChannelArray.size())
-        m_recordStatus.resize (dataChannelArray.size());
+    if (m_recordStatus.getNumChannels() < dataChannelArray.size())
+        m_recordStatus.setNumChannels (dataChannelArray.size());
+
+    if (m_monitorStatus.getNumChannels() < dataChannelArray.size())
+        m_monitorStatus.setNumChannels (dataChannelArray.size());
 
-    if (m_monitorStatus.size() < dataChannelArray.size())
-        m_monitorStatus.resize (dataChannelArray.size());
+    while (m_recordDecimation.size() < dataChannelArray.size())
+        m_recordDecimation.add (1);
 
     for (int i = 0; i < dataChannelArray.size(); ++i)
     {
         // std::cout << channels[i]->getRecordState() << std::endl;
         m_recordStatus.set    (i, dataChannelArray[i]->getRecordState());
         m_monitorStatus.set   (i, dataChannelArray[i]->isMonitored());
+        m_recordDecimation.set (i, dataChannelArray[i]->getRecordDecimation());
     }
 
     dataChannelArray.clear();
@@ -323,13 +350,20 @@ void GenericProcessor::update()
             DataChannel* ch = new DataChannel (*sourceChan);
 			
 
-            if (i < m_recordStatus.size())
+            if (i < m_recordStatus.getNumChannels())
             {
                 ch->setRecordState (m_recordStatus[i]);
                 ch->setMonitored( m_monitorStatus[i]);
             }
 
+            if (i < m_recordDecimation.size())
+                ch->setRecordDecimation (m_recordDecimation[i]);
+
 			ch->addToHistoricString(getName());
+
+            if (! isDataPassThrough())
+                ch->setRawSamplesAvailable (false);
+
             dataChannelArray.add (ch);
         }
 
@@ -364,11 +398,14 @@ void GenericProcessor::update()
 
 		for (int i = 0; i < dataChannelArray.size(); i++)
 		{
-			if (i < m_recordStatus.size())
+			if (i < m_recordStatus.getNumChannels())
 				dataChannelArray[i]->setRecordState(m_recordStatus[i]);
 			else
 				if (isSource())
 					dataChannelArray[i]->setRecordState(true);
+
+			if (i < m_recordDecimation.size())
+				dataChannelArray[i]->setRecordDecimation(m_recordDecimation[i]);
 		}
     }
 
@@ -386,9 +423,32 @@ void GenericProcessor::update()
 
 	updateChannelIndexes();	
 
+	m_sourceAligner = nullptr;
+
+	if (sourceNode != nullptr && sourceNode->isAligningSources())
+	{
+		Array<float> sampleRates;
+		for (int i = 0; i < dataChannelArray.size(); ++i)
+			sampleRates.add (dataChannelArray[i]->getSampleRate());
+
+		m_sourceAligner = new SourceAligner();
+
+		if (! m_sourceAligner->prepare (m_dataChannelSourceSlots, m_sourceIds, sampleRates))
+		{
+			std::cout << getName() << " can't align sources of different sample rates, or fewer than two." << std::endl;
+			m_sourceAligner = nullptr;
+		}
+	}
+
+	updateIdleState();
+
+	m_displayTap->setSize (getNumOutputs(), DisplayTap::getLengthForSampleRate (getSampleRate()));
+
 	m_needsToSendTimestampMessages.clear();
 	m_needsToSendTimestampMessages.insertMultiple(-1, false, getNumSubProcessors());
 
+	resetEventArena();
+
     // required for the ProcessorGraph to know the
     // details of this processor:
     setPlayConfigDetails (getNumInputs(),  // numIns
@@ -445,6 +505,69 @@ void GenericProcessor::updateChannelIndexes(bool updateNodeID)
 		uint32 sourceID = getProcessorFullId(channel->getSourceNodeID(), channel->getSubProcessorIdx());
 		spikeChannelMap[sourceID][channel->getSourceIndex()] = i;
 	}
+
+	//Resolve the sources whose sample counts and timestamps this processor can be asked for
+	m_sourceIds.clearQuick();
+	m_dataChannelSourceSlots.clearQuick();
+	for (int i = 0; i < dataChannelArray.size(); i++)
+	{
+		uint32 sourceID = getProcessorFullId(dataChannelArray[i]->getSourceNodeID(), dataChannelArray[i]->getSubProcessorIdx());
+		m_sourceIds.addIfNotAlreadyThere(sourceID);
+		m_dataChannelSourceSlots.add(m_sourceIds.indexOf(sourceID));
+	}
+	for (int i = 0; i < eventChannelArray.size(); i++)
+		m_sourceIds.addIfNotAlreadyThere(getProcessorFullId(eventChannelArray[i]->getSourceNodeID(), eventChannelArray[i]->getSubProcessorIdx()));
+	for (int i = 0; i < spikeChannelArray.size(); i++)
+		m_sourceIds.addIfNotAlreadyThere(getProcessorFullId(spikeChannelArray[i]->getSourceNodeID(), spikeChannelArray[i]->getSubProcessorIdx()));
+	int nSub = getNumSubProcessors();
+	for (int sub = 0; sub < nSub; sub++)
+		m_sourceIds.addIfNotAlreadyThere(getProcessorFullId(nodeId, sub));
+
+	m_sourceNumSamples.clearQuick();
+	m_sourceNumSamples.insertMultiple(0, 0, m_sourceIds.size());
+	m_sourceTimestamps.clearQuick();
+	m_sourceTimestamps.insertMultiple(0, 0, m_sourceIds.size());
+	m_sourceHostTicks.clearQuick();
+	m_sourceHostTicks.insertMultiple(0, 0, m_sourceIds.size());
+	m_blockNumSamples.clearQuick();
+	m_blockNumSamples.insertMultiple(0, 0, m_sourceIds.size());
+	m_blockTimestamps.clearQuick();
+	m_blockTimestamps.insertMultiple(0, 0, m_sourceIds.size());
+
+	m_eventLatencyStats.clear();
+	for (int i = 0; i < eventChannelArray.size(); i++)
+		m_eventLatencyStats.add(new ProcessorTimingStats());
+
+	m_dataChannelTable.build(dataChannelArray);
+
+	updateEventSubscription();
+}
+
+void GenericProcessor::getEventSubscription(EventSubscription& subscription) const
+{
+}
+
+void GenericProcessor::updateEventSubscription()
+{
+	EventSubscription& subscription = m_eventSubscription;
+	subscription.reset();
+	getEventSubscription(subscription);
+
+	m_subscribedEventChannels.resize(eventChannelArray.size());
+	for (int i = 0; i < eventChannelArray.size(); i++)
+		m_subscribedEventChannels.setUnchecked(i, subscription.includesEventChannel(i, eventChannelArray[i]->getChannelType()));
+
+	m_subscribedSpikeChannels.resize(spikeChannelArray.size());
+	for (int i = 0; i < spikeChannelArray.size(); i++)
+		m_subscribedSpikeChannels.setUnchecked(i, subscription.includesSpikeChannel(i));
+
+	m_subscribedToSyncTexts = subscription.includesTimestampSyncTexts();
+}
+
+int GenericProcessor::getSourceSlot(uint32 fullSourceID) const
+{
+	//Processors rarely see more than a handful of sources, so a linear search beats a tree
+	return m_sourceIds.indexOf(fullSourceID);
 }
 
 void GenericProcessor::createDataChannels()
@@ -508,12 +631,8 @@ void GenericProcessor::createConfigurationObjects() {};
 
 void GenericProcessor::setAllChannelsToRecord()
 {
-    m_recordStatus.resize (dataChannelArray.size());
-
-    for (int i = 0; i < dataChannelArray.size(); ++i)
-    {
-        m_recordStatus.set (i, true);
-    }
+    m_recordStatus.setNumChannels (dataChannelArray.size());
+    m_recordStatus.setAll (true);
 
     // std::cout << "Setting all channels to record for source." << std::endl;
 }
@@ -550,6 +669,10 @@ void GenericProcessor::enableEditor()
 {
     GenericEditor* ed = getEditor();
 
+	m_timingStats.reset();
+	for (int i = 0; i < m_eventLatencyStats.size(); i++)
+		m_eventLatencyStats[i]->reset();
+
     if (ed != 0)
         ed->editorStartAcquisition();
 }
@@ -567,6 +690,9 @@ void GenericProcessor::disableEditor()
 /** Used to get the number of samples in a given buffer, for a given channel. */
 uint32 GenericProcessor::getNumSamples (int channelNum) const
 {
+    if (channelNum >= 0 && channelNum < m_dataChannelSourceSlots.size())
+        return m_sourceNumSamples.getUnchecked (m_dataChannelSourceSlots.getUnchecked (channelNum));
+
     int sourceNodeId = 0;
 	int subProcessorId = 0;
     int nSamples     = 0;
@@ -583,15 +709,7 @@ uint32 GenericProcessor::getNumSamples (int channelNum) const
     }
 
     // std::cout << "Requesting samples for channel " << channelNum << " with source node " << sourceNodeId << std::endl;
-	uint32 sourceID = getProcessorFullId(sourceNodeId, subProcessorId);
-    try
-    {
-        nSamples = numSamples.at (sourceID);
-    }
-    catch (...)
-    {
-        return 0;
-    }
+	nSamples = getNumSourceSamples(getProcessorFullId(sourceNodeId, subProcessorId));
 
     //std::cout << nSamples << " were found." << std::endl;
 
@@ -602,6 +720,9 @@ uint32 GenericProcessor::getNumSamples (int channelNum) const
 /** Used to get the timestamp for a given buffer, for a given source node. */
 uint64 GenericProcessor::getTimestamp (int channelNum) const
 {
+    if (channelNum >= 0 && channelNum < m_dataChannelSourceSlots.size())
+        return m_sourceTimestamps.getUnchecked (m_dataChannelSourceSlots.getUnchecked (channelNum));
+
     int sourceNodeId = 0;
 	int subProcessorIdx = 0;
     int64 ts         = 0;
@@ -617,15 +738,7 @@ uint64 GenericProcessor::getTimestamp (int channelNum) const
         return 0;
     }
 
-	uint32 sourceID = getProcessorFullId(sourceNodeId, subProcessorIdx);
-    try
-    {
-        ts = timestamps.at (sourceID);
-    }
-    catch (...)
-    {
-        return 0;
-    }
+	ts = getSourceTimestamp(getProcessorFullId(sourceNodeId, subProcessorIdx));
 
     return ts;
 }
@@ -637,6 +750,10 @@ uint32 GenericProcessor::getNumSourceSamples(uint16 processorID, uint16 subProce
 
 uint32 GenericProcessor::getNumSourceSamples(uint32 fullSourceID) const
 {
+	int slot = getSourceSlot(fullSourceID);
+	if (slot >= 0)
+		return m_sourceNumSamples.getUnchecked(slot);
+
 	uint32 nSamples;
 	try
 	{
@@ -656,6 +773,10 @@ uint64 GenericProcessor::getSourceTimestamp(uint16 processorID, uint16 subProces
 
 uint64 GenericProcessor::getSourceTimestamp(uint32 fullSourceID) const
 {
+	int slot = getSourceSlot(fullSourceID);
+	if (slot >= 0)
+		return m_sourceTimestamps.getUnchecked(slot);
+
 	uint64 ts;
 	try
 	{
@@ -676,24 +797,36 @@ void GenericProcessor::setTimestampAndSamples(uint64 timestamp, uint32 nSamples,
 	MidiBuffer& eventBuffer = *m_currentMidiBuffer;
     //std::cout << "Setting timestamp to " << timestamp << std:;endl;
 
-	HeapBlock<char> data;
-	size_t dataSize = SystemEvent::fillTimestampAndSamplesData(data, this, subProcessorIdx, timestamp, nSamples);
-	
+	// the events are copied into the buffer, so they are built on the stack to allocate nothing
+	char data[SystemEvent::TIMESTAMP_AND_SAMPLES_SIZE];
+	size_t dataSize = SystemEvent::fillTimestampAndSamplesData(data, sizeof(data), this, subProcessorIdx, timestamp, nSamples, m_lastProcessTime);
 
-	eventBuffer.addEvent(data, dataSize, 0);
+	eventBuffer.addEvent(data, (int) dataSize, 0);
+	m_blockEventsValid = false;
 
 	uint32 sourceID = getProcessorFullId(nodeId, subProcessorIdx);
 
-    //since the processor generating the timestamp won't get the event, add it to the map
-    timestamps[sourceID] = timestamp;
-	numSamples[sourceID] = nSamples;
+    //since the processor generating the timestamp won't get the event, store it here
+	int slot = getSourceSlot(sourceID);
+	if (slot >= 0)
+	{
+		m_sourceTimestamps.setUnchecked(slot, timestamp);
+		m_sourceNumSamples.setUnchecked(slot, nSamples);
+		m_sourceHostTicks.setUnchecked(slot, m_lastProcessTime);
+	}
+	else
+	{
+		timestamps[sourceID] = timestamp;
+		numSamples[sourceID] = nSamples;
+	}
 
     if (m_needsToSendTimestampMessages[subProcessorIdx])
     {
-		HeapBlock<char> data;
-		size_t dataSize = SystemEvent::fillTimestampSyncTextData(data, this, subProcessorIdx, timestamp, false);
+		char textData[SystemEvent::MAX_SYNC_TEXT_SIZE];
+		size_t textDataSize = SystemEvent::fillTimestampSyncTextData(textData, sizeof(textData), this, subProcessorIdx, timestamp, false);
 
-		eventBuffer.addEvent(data, dataSize, 0);
+		eventBuffer.addEvent(textData, (int) textDataSize, 0);
+		m_blockEventsValid = false;
 
 		m_needsToSendTimestampMessages.set(subProcessorIdx, false);
     }
@@ -712,91 +845,141 @@ int GenericProcessor::processEventBuffer()
 	//
 	int numRead = 0;
 
-	MidiBuffer& eventBuffer = *m_currentMidiBuffer;
-
-	if (eventBuffer.getNumEvents() > 0)
-	{
-		MidiBuffer::Iterator i(eventBuffer);
+	m_oldestSourceHostTicks = 0;
 
-		const uint8* dataptr;
-		int dataSize;
+	indexEventBuffer();
 
-		int samplePosition = -1;
+	for (int i = 0; i < m_blockEvents.getNumEvents(); ++i)
+	{
+		const BlockEvent& ev = m_blockEvents[i];
+		const uint8* dataptr = ev.getData();
 
-		while (i.getNextEvent(dataptr, dataSize, samplePosition))
+		if (ev.getBaseType() == SYSTEM_EVENT && ev.getSystemEventType() == TIMESTAMP_AND_SAMPLES)
 		{
-			//TODO: remove the mask when the probe system is implemented
-			if (static_cast<EventType>(*(dataptr + 0) & 0x7F) == SYSTEM_EVENT && static_cast<SystemEventType>(*(dataptr + 1) == TIMESTAMP_AND_SAMPLES))
-			{
-				uint16 sourceNodeID = *reinterpret_cast<const uint16*>(dataptr + 2);
-				uint16 sourceSubProcessorIdx = *reinterpret_cast<const uint16*>(dataptr + 4);
-				uint32 sourceID = getProcessorFullId(sourceNodeID, sourceSubProcessorIdx);
+			uint32 sourceID = getProcessorFullId(ev.getSourceID(), ev.getSubProcessorIdx());
 
-				uint64 timestamp = *reinterpret_cast<const uint64*>(dataptr + 8);
-				uint32 nSamples = *reinterpret_cast<const uint32*>(dataptr + 16);
+			uint64 timestamp = ev.getTimestamp();
+			uint32 nSamples = *reinterpret_cast<const uint32*>(dataptr + 16);
+			int64 hostTicks = ev.getDataSize() >= 32 ? *reinterpret_cast<const int64*>(dataptr + 24) : 0;
+			int slot = getSourceSlot(sourceID);
+			if (slot >= 0)
+			{
+				m_sourceNumSamples.setUnchecked(slot, nSamples);
+				m_sourceTimestamps.setUnchecked(slot, timestamp);
+				m_sourceHostTicks.setUnchecked(slot, hostTicks);
+			}
+			else
+			{
 				numSamples[sourceID] = nSamples;
 				timestamps[sourceID] = timestamp;
 			}
-			//set the "recorded" bit on the first byte. This will go away when the probe system is implemented.
-			//doing a const cast is always a bad idea, but there's no better way to do this until whe change the event record system
-			if (nodeId < 900) //If the processor is not a specialized one
-				*const_cast<uint8*>(dataptr + 0) = *(dataptr + 0) | 0x80;
+			if (hostTicks != 0 && (m_oldestSourceHostTicks == 0 || hostTicks < m_oldestSourceHostTicks))
+				m_oldestSourceHostTicks = hostTicks;
 		}
+		//set the "recorded" bit on the first byte. This will go away when the probe system is implemented.
+		//doing a const cast is always a bad idea, but there's no better way to do this until whe change the event record system
+		if (nodeId < 900) //If the processor is not a specialized one
+			*const_cast<uint8*>(dataptr + 0) = *(dataptr + 0) | 0x80;
 	}
 
 	return numRead;
 }
 
+void GenericProcessor::indexEventBuffer()
+{
+	m_blockEvents.clear();
+
+	MidiBuffer::Iterator i(*m_blockEventBuffer);
+
+	const uint8* dataptr;
+	int dataSize;
+	int samplePosition;
+
+	while (i.getNextEvent(dataptr, dataSize, samplePosition))
+	{
+		if (dataSize < EVENT_BASE_SIZE)
+			continue;
+
+		int channelIndex = -1;
+		EventType type = static_cast<EventType>(*(dataptr + 0) & 0x7F);
+		uint16 sourceID = *reinterpret_cast<const uint16*>(dataptr + 2);
+		uint16 subProcessorIdx = *reinterpret_cast<const uint16*>(dataptr + 4);
+		uint16 sourceIndex = *reinterpret_cast<const uint16*>(dataptr + 6);
+
+		if (type == PROCESSOR_EVENT)
+			channelIndex = getEventChannelIndex(sourceIndex, sourceID, subProcessorIdx);
+		else if (type == SPIKE_EVENT)
+			channelIndex = getSpikeChannelIndex(sourceIndex, sourceID, subProcessorIdx);
+
+		m_blockEvents.addEvent(dataptr, dataSize, samplePosition, channelIndex);
+	}
+	m_blockEventsValid = true;
+}
+
+const EventBlockIndex& GenericProcessor::getBlockEvents()
+{
+	//while checkForEvents() dispatches, new events go to a separate buffer and the index stays valid
+	if (!m_blockEventsValid && m_currentMidiBuffer == m_blockEventBuffer && m_blockEventBuffer != nullptr)
+		indexEventBuffer();
+	return m_blockEvents;
+}
+
 
 int GenericProcessor::checkForEvents(bool checkForSpikes)
 {
-    if (m_currentMidiBuffer->getNumEvents() > 0)
-    {
-		//Since adding events to the buffer inside this loop could be dangerous, create a temporal event buffer
+	const EventBlockIndex& events = getBlockEvents();
+
+	if (events.getNumEvents() > 0)
+	{
+		//Since adding events to the buffer inside this loop could be dangerous, use a temporal event buffer
 		//so any call to addEvent will operate on it;
-		MidiBuffer temporalEventBuffer;
+		MidiBuffer& temporalEventBuffer = m_handlerEventBuffer;
+		temporalEventBuffer.clear();
 		MidiBuffer* originalEventBuffer = m_currentMidiBuffer;
 		m_currentMidiBuffer = &temporalEventBuffer;
-        // int m = midiMessages.getNumEvents();
-        //std::cout << m << " events received by node " << getNodeId() << std::endl;
 
-		MidiBuffer::Iterator i(*originalEventBuffer);
-        MidiMessage message (0xf4);
+		for (int i = 0; i < events.getNumEvents(); ++i)
+		{
+			const BlockEvent& ev = events[i];
+			int samplePosition = ev.getSamplePosition();
+
+			// when processing sub-blocks, only the events of the current one
+			if (m_subBlockLength >= 0)
+			{
+				if (samplePosition < m_subBlockStart || samplePosition >= m_subBlockStart + m_subBlockLength)
+					continue;
 
-        int samplePosition = 0;
-        i.setNextSamplePosition (samplePosition);
+				samplePosition -= m_subBlockStart;
+			}
 
-        while (i.getNextEvent (message, samplePosition))
-        {
-			uint16 sourceId = EventBase::getSourceID(message);
-			uint16 subProc = EventBase::getSubProcessorIdx(message);
-			uint16 index = EventBase::getSourceIndex(message);
-			if (EventBase::getBaseType(message) == EventType::PROCESSOR_EVENT)
+			if (ev.getBaseType() == EventType::PROCESSOR_EVENT)
 			{
-				int eventIndex = getEventChannelIndex(index, sourceId, subProc);
-				if (eventIndex >= 0)
-					handleEvent(eventChannelArray[eventIndex], message, samplePosition);
+				if (ev.getChannelIndex() >= 0 && m_subscribedEventChannels[ev.getChannelIndex()])
+					handleEvent(eventChannelArray[ev.getChannelIndex()], ev.toMidiMessage(samplePosition), samplePosition);
 			}
-			else if (EventBase::getBaseType(message) == EventType::SYSTEM_EVENT && SystemEvent::getSystemEventType(message) == SystemEventType::TIMESTAMP_SYNC_TEXT)
+			else if (ev.getBaseType() == EventType::SYSTEM_EVENT && ev.getSystemEventType() == SystemEventType::TIMESTAMP_SYNC_TEXT)
 			{
-				handleTimestampSyncTexts(message);
+				if (m_subscribedToSyncTexts)
+					handleTimestampSyncTexts(ev.toMidiMessage(samplePosition));
 			}
-			else if (checkForSpikes && EventBase::getBaseType(message) == EventType::SPIKE_EVENT)
+			else if (checkForSpikes && ev.getBaseType() == EventType::SPIKE_EVENT)
 			{
-				int spikeIndex = getSpikeChannelIndex(index, sourceId, subProc);
-				if (spikeIndex >= 0)
-					handleSpike(spikeChannelArray[index], message, samplePosition);
+				if (ev.getChannelIndex() >= 0 && m_subscribedSpikeChannels[ev.getChannelIndex()])
+					handleSpike(spikeChannelArray[ev.getChannelIndex()], ev.toMidiMessage(samplePosition), samplePosition);
 			}
-        }
+		}
 		//Restore the original buffer pointer and, if some new event has been added here, copy it to the original buffer
 		m_currentMidiBuffer = originalEventBuffer;
 		if (temporalEventBuffer.getNumEvents() > 0)
+		{
 			m_currentMidiBuffer->addEvents(temporalEventBuffer, 0, -1, 0);
+			m_blockEventsValid = false;
+		}
 
 		return 0;
-    }
+	}
 
-    return -1;
+	return -1;
 }
 
 void GenericProcessor::addEvent(int channelIndex, const Event* event, int sampleNum)
@@ -807,9 +990,36 @@ void GenericProcessor::addEvent(int channelIndex, const Event* event, int sample
 void GenericProcessor::addEvent(const EventChannel* channel, const Event* event, int sampleNum)
 {
 	size_t size = channel->getDataSize() + channel->getTotalEventMetaDataSize() + EVENT_BASE_SIZE;
-	HeapBlock<char> buffer(size);
+	char* buffer = allocateEventData(size);
 	event->serialize(buffer, size);
-	m_currentMidiBuffer->addEvent(buffer, size, sampleNum);
+	m_currentMidiBuffer->addEvent(buffer, size, sampleNum + m_subBlockStart);
+	m_blockEventsValid = false;
+}
+
+void GenericProcessor::addTTLEvent(const EventChannel* channel, int64 timestamp, const void* ttlWord, uint16 bit, int sampleNum)
+{
+	size_t size = channel->getDataSize() + EVENT_BASE_SIZE;
+	char* buffer = allocateEventData(size);
+	if (!TTLEvent::serializeTTLEvent(buffer, size, channel, timestamp, ttlWord, bit))
+	{
+		jassertfalse;
+		return;
+	}
+	m_currentMidiBuffer->addEvent(buffer, size, sampleNum + m_subBlockStart);
+	m_blockEventsValid = false;
+}
+
+void GenericProcessor::addTextEvent(const EventChannel* channel, int64 timestamp, const char* text, int sampleNum, int textSize, const void* metaData)
+{
+	size_t size = channel->getDataSize() + channel->getTotalEventMetaDataSize() + EVENT_BASE_SIZE;
+	char* buffer = allocateEventData(size);
+	if (!TextEvent::serializeTextEvent(buffer, size, channel, timestamp, text, textSize, metaData))
+	{
+		jassertfalse;
+		return;
+	}
+	m_currentMidiBuffer->addEvent(buffer, size, sampleNum + m_subBlockStart);
+	m_blockEventsValid = false;
 }
 
 void GenericProcessor::addSpike(int channelIndex, const SpikeEvent* event, int sampleNum)
@@ -820,21 +1030,345 @@ void GenericProcessor::addSpike(int channelIndex, const SpikeEvent* event, int s
 void GenericProcessor::addSpike(const SpikeChannel* channel, const SpikeEvent* event, int sampleNum)
 {
 	size_t size = channel->getDataSize() + channel->getTotalEventMetaDataSize() + SPIKE_BASE_SIZE + channel->getNumChannels()*sizeof(float);
-	HeapBlock<char> buffer(size);
+	char* buffer = allocateEventData(size);
 	event->serialize(buffer, size);
-	m_currentMidiBuffer->addEvent(buffer, size, sampleNum);
+	m_currentMidiBuffer->addEvent(buffer, size, sampleNum + m_subBlockStart);
+	m_blockEventsValid = false;
+}
+
+
+char* GenericProcessor::allocateEventData(size_t size)
+{
+	if (m_eventArenaUsed + size > m_eventArenaSize)
+	{
+		//Earlier events of the block may still point to the full arena, so it is kept until the next block
+		MemoryBlock* full = new MemoryBlock();
+		full->swapWith(m_eventArena);
+		m_retiredEventArenas.add(full);
+
+		m_eventArenaSize = jmax(m_eventArenaSize * 2, size);
+		m_eventArena.setSize(m_eventArenaSize);
+		m_eventArenaUsed = 0;
+	}
+	char* data = static_cast<char*>(m_eventArena.getData()) + m_eventArenaUsed;
+	m_eventArenaUsed += size;
+	return data;
+}
+
+void GenericProcessor::resetEventArena()
+{
+	size_t maxEventSize = 0;
+	for (int i = 0; i < eventChannelArray.size(); i++)
+	{
+		const EventChannel* chan = eventChannelArray[i];
+		maxEventSize = jmax(maxEventSize, chan->getDataSize() + chan->getTotalEventMetaDataSize() + EVENT_BASE_SIZE);
+	}
+	for (int i = 0; i < spikeChannelArray.size(); i++)
+	{
+		const SpikeChannel* chan = spikeChannelArray[i];
+		maxEventSize = jmax(maxEventSize, chan->getDataSize() + chan->getTotalEventMetaDataSize() + SPIKE_BASE_SIZE + chan->getNumChannels()*sizeof(float));
+	}
+
+	//Room for a few hundred events of the largest kind per block before having to grow
+	m_eventArenaSize = jmax((size_t)16384, maxEventSize * 256);
+	m_eventArena.setSize(m_eventArenaSize);
+	m_eventArenaUsed = 0;
+	m_retiredEventArenas.clear();
+}
+
+bool GenericProcessor::isChannelParallelSafe() const
+{
+	return false;
+}
+
+void GenericProcessor::processChannels(AudioSampleBuffer& buffer, int firstChannel, int lastChannel)
+{
+	// processors calling processChannelsInParallel() must override this
+	jassertfalse;
+}
+
+void GenericProcessor::setMaxChannelThreads(int maxThreads)
+{
+	m_maxChannelThreads = jmax(-1, maxThreads);
+}
+
+int GenericProcessor::getMaxChannelThreads() const
+{
+	return m_maxChannelThreads.get();
+}
+
+int GenericProcessor::getNumChannelPoolThreads() const
+{
+	return m_channelThreadPool->getNumThreads();
 }
 
+void GenericProcessor::processChannelsInParallel(AudioSampleBuffer& buffer, int numChannels)
+{
+	// ranges are kept large enough to be worth a thread switch, and numerous enough
+	// for the threads that finish first to take over the remaining ones
+	const int minChannelsPerTask = 8;
+	const int maxThreads = m_maxChannelThreads.get();
+	const int numThreads = (maxThreads < 0) ? m_channelThreadPool->getNumThreads()
+		: jmin(maxThreads, m_channelThreadPool->getNumThreads());
+
+	// the calling thread may belong to an audio driver, which leaves denormals on
+	ChannelThreadPool::disableDenormals();
+
+	if (isChannelParallelSafe() && numThreads > 0 && numChannels >= 2 * minChannelsPerTask)
+	{
+		const int channelsPerTask = jmax(minChannelsPerTask, numChannels / (4 * (numThreads + 1)));
+
+		if (m_channelThreadPool->processChannels(this, buffer, numChannels, channelsPerTask, numThreads))
+			return;
+	}
+
+	processChannels(buffer, 0, numChannels);
+}
 
 void GenericProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& eventBuffer)
 {
+	const int64 blockStartTicks = Time::getHighResolutionTicks();
+
 	m_currentMidiBuffer = &eventBuffer;
+	m_blockEventBuffer = &eventBuffer;
+	m_dataChannelTable.refreshStates(dataChannelArray);
+	m_eventArenaUsed = 0;
+	m_retiredEventArenas.clearQuick(true);
+
+	if (m_sourceAligner != nullptr)
+		m_sourceAligner->startBlock (m_sourceNumSamples);
+
     processEventBuffer (); // extract buffer sizes and timestamps,
     // set flag on all TTL events to zero
+
+	if (m_sourceAligner != nullptr)
+		alignSources (buffer);
 	
+	int numSamples = 0;
+	for (int i = 0; i < m_sourceNumSamples.size(); ++i)
+		numSamples = jmax (numSamples, (int) m_sourceNumSamples.getUnchecked (i));
+
 	m_lastProcessTime = Time::getHighResolutionTicks();
-    process (buffer);
 
+	const bool hasTimedChanges = collectParameterChanges (numSamples);
+
+	if (isDisplayOnly() && OverrunWatchdog::getLevel() >= OverrunWatchdog::DROP_DISPLAY_BRANCHES)
+	{
+		// shed while the chain can't keep up, the changes still being applied
+		applyParameterChanges (numSamples);
+	}
+	else if (m_isIdle.get() != 0)
+	{
+		// the changes may end the idle state, in which case the next block is processed
+		applyParameterChanges (numSamples);
+	}
+	else if (((m_subBlockSize > 0 && numSamples > m_subBlockSize) || hasTimedChanges) && !isSource())
+	{
+		processSubBlocks (buffer, numSamples);
+	}
+	else
+	{
+		applyParameterChanges (0);
+		process (buffer);
+	}
+
+	if (m_displayTap->hasActiveReaders())
+		fillDisplayTap (buffer);
+
+	const int64 blockEndTicks = Time::getHighResolutionTicks();
+	m_timingStats.addBlock (blockEndTicks - blockStartTicks, numSamples);
+	m_lastBlockTicks = blockEndTicks - blockStartTicks;
+
+	if (TraceRecorder::isEnabled() && m_traceName != nullptr)
+		TraceRecorder::addSpan (m_traceName, blockStartTicks, blockEndTicks, "Audio");
+}
+
+void GenericProcessor::fillDisplayTap (const AudioSampleBuffer& buffer)
+{
+	const int numChannels = jmin (m_displayTap->getNumChannels(), buffer.getNumChannels());
+
+	for (int chan = 0; chan < numChannels; ++chan)
+		m_displayTap->write (chan, buffer.getReadPointer (chan), (int) getNumSamples (chan));
+}
+
+void GenericProcessor::alignSources (AudioSampleBuffer& buffer)
+{
+	m_sourceAligner->process (buffer, m_sourceNumSamples, m_sourceTimestamps);
+
+	for (int i = 0; i < m_blockEvents.getNumEvents(); ++i)
+	{
+		const BlockEvent& ev = m_blockEvents[i];
+
+		if (ev.getBaseType() != SYSTEM_EVENT || ev.getSystemEventType() != TIMESTAMP_AND_SAMPLES)
+			continue;
+
+		const int slot = getSourceSlot (getProcessorFullId (ev.getSourceID(), ev.getSubProcessorIdx()));
+
+		if (m_sourceAligner->isAlignedSlot (slot))
+		{
+			// the same in-place rewrite as the "recorded" bit of processEventBuffer()
+			uint8* dataptr = const_cast<uint8*> (ev.getData());
+			*reinterpret_cast<int64*> (dataptr + 8) = m_sourceTimestamps.getUnchecked (slot);
+			*reinterpret_cast<uint32*> (dataptr + 16) = m_sourceNumSamples.getUnchecked (slot);
+		}
+	}
+}
+
+DisplayTap* GenericProcessor::getDisplayTap() const
+{
+	return m_displayTap;
+}
+
+void GenericProcessor::processSubBlocks (AudioSampleBuffer& buffer, int numSamples)
+{
+	const int numSlots = m_sourceNumSamples.size();
+
+	// the block's own counts and timestamps, restored once all sub-blocks are done
+	for (int slot = 0; slot < numSlots; ++slot)
+	{
+		m_blockNumSamples.setUnchecked (slot, m_sourceNumSamples.getUnchecked (slot));
+		m_blockTimestamps.setUnchecked (slot, m_sourceTimestamps.getUnchecked (slot));
+	}
+
+	for (int start = 0; start < numSamples;)
+	{
+		applyParameterChanges (start);
+
+		// sub-blocks keep their fixed grid, and end early where a change is due
+		int end = (m_subBlockSize > 0) ? jmin (numSamples, (start / m_subBlockSize + 1) * m_subBlockSize) : numSamples;
+
+		for (int i = 0; i < m_pendingParameterChanges.size(); ++i)
+		{
+			const int64 offset = getParameterChangeOffset (m_pendingParameterChanges.getReference (i));
+
+			if (offset > start)
+			{
+				end = (int) jmin<int64> (end, offset);
+				break;
+			}
+		}
+
+		const int length = end - start;
+
+		// sources with fewer samples than others simply run out early
+		for (int slot = 0; slot < numSlots; ++slot)
+		{
+			const int remaining = (int) m_blockNumSamples.getUnchecked (slot) - start;
+			m_sourceNumSamples.setUnchecked (slot, (uint32) jlimit (0, length, remaining));
+			m_sourceTimestamps.setUnchecked (slot, m_blockTimestamps.getUnchecked (slot) + start);
+		}
+
+		m_subBlockStart = start;
+		m_subBlockLength = length;
+
+		AudioSampleBuffer subBlock (buffer.getArrayOfWritePointers(), buffer.getNumChannels(), start, length);
+		process (subBlock);
+
+		start = end;
+	}
+
+	m_subBlockStart = 0;
+	m_subBlockLength = -1;
+
+	for (int slot = 0; slot < numSlots; ++slot)
+	{
+		m_sourceNumSamples.setUnchecked (slot, m_blockNumSamples.getUnchecked (slot));
+		m_sourceTimestamps.setUnchecked (slot, m_blockTimestamps.getUnchecked (slot));
+	}
+}
+
+void GenericProcessor::setSubBlockSize(int numSamples)
+{
+	m_subBlockSize = jmax(0, numSamples);
+}
+
+int GenericProcessor::getSubBlockSize() const
+{
+	return m_subBlockSize;
+}
+
+bool GenericProcessor::queueParameterChange(int parameterIndex, float newValue, int channel, int64 timestamp)
+{
+	ParameterChangeQueue::Change change;
+	change.parameterIndex = parameterIndex;
+	change.channel = channel;
+	change.value = newValue;
+	change.timestamp = timestamp;
+
+	if (m_queueParameterChanges.get() == 0 && MessageManager::getInstance()->isThisTheMessageThread())
+	{
+		applyParameterChange (change);
+		return true;
+	}
+
+	return m_parameterChangeQueue.push (change);
+}
+
+bool GenericProcessor::collectParameterChanges(int numSamples)
+{
+	if (m_pendingParameterChanges.size() == 0 && m_parameterChangeQueue.getNumReady() == 0)
+		return false;
+
+	m_parameterChangeBlockStart = (!isSource() && dataChannelArray.size() > 0) ? int64 (getTimestamp (0)) : -1;
+
+	const int numPopped = m_parameterChangeQueue.pop (m_poppedParameterChanges, m_parameterChangeQueue.getCapacity());
+
+	for (int i = 0; i < numPopped; ++i)
+	{
+		const ParameterChangeQueue::Change& change = m_poppedParameterChanges[i];
+
+		// after the pending changes due at the same time or earlier, so they are applied in the order given
+		int index = m_pendingParameterChanges.size();
+		while (index > 0 && m_pendingParameterChanges.getReference (index - 1).timestamp > change.timestamp)
+			--index;
+
+		m_pendingParameterChanges.insert (index, change);
+	}
+
+	for (int i = 0; i < m_pendingParameterChanges.size(); ++i)
+	{
+		const int64 offset = getParameterChangeOffset (m_pendingParameterChanges.getReference (i));
+
+		if (offset > 0)
+			return offset < numSamples;
+	}
+
+	return false;
+}
+
+int64 GenericProcessor::getParameterChangeOffset(const ParameterChangeQueue::Change& change) const
+{
+	if (change.timestamp < 0 || m_parameterChangeBlockStart < 0)
+		return 0;
+
+	return jmax<int64> (0, change.timestamp - m_parameterChangeBlockStart);
+}
+
+void GenericProcessor::applyParameterChanges(int blockOffset)
+{
+	int numApplied = 0;
+
+	while (numApplied < m_pendingParameterChanges.size()
+		&& getParameterChangeOffset (m_pendingParameterChanges.getReference (numApplied)) <= blockOffset)
+	{
+		applyParameterChange (m_pendingParameterChanges.getReference (numApplied));
+		++numApplied;
+	}
+
+	if (numApplied > 0)
+		m_pendingParameterChanges.removeRange (0, numApplied);
+}
+
+void GenericProcessor::applyParameterChange(const ParameterChangeQueue::Change& change)
+{
+	const int previousChannel = currentChannel;
+
+	if (change.channel >= 0)
+		currentChannel = change.channel;
+
+	setParameter (change.parameterIndex, change.value);
+
+	currentChannel = previousChannel;
 }
 
 const DataChannel* GenericProcessor::getDataChannel(int index) const
@@ -842,6 +1376,11 @@ const DataChannel* GenericProcessor::getDataChannel(int index) const
 	return dataChannelArray[index];
 }
 
+const DataChannelTable& GenericProcessor::getDataChannelTable() const
+{
+	return m_dataChannelTable;
+}
+
 const EventChannel* GenericProcessor::getEventChannel(int index) const
 {
 	return eventChannelArray[index];
@@ -893,14 +1432,14 @@ int GenericProcessor::getDataChannelIndex(int channelIdx, int processorID, int s
 int GenericProcessor::getEventChannelIndex(int channelIdx, int processorID, int subProcessorIdx) const
 {
 	uint32 sourceID = getProcessorFullId(processorID, subProcessorIdx);
-	try
-	{
-		return eventChannelMap.at(sourceID).at(channelIdx);
-	}
-	catch (...)
-	{
+	//looked up without at(), as events from channels this processor doesn't know about are common
+	ChannelIndexMap::const_iterator source = eventChannelMap.find(sourceID);
+	if (source == eventChannelMap.end())
 		return -1;
-	}
+	ChannelIndexes::const_iterator channel = source->second.find(channelIdx);
+	if (channel == source->second.end())
+		return -1;
+	return channel->second;
 }
 
 int GenericProcessor::getEventChannelIndex(const Event* event) const
@@ -911,14 +1450,14 @@ int GenericProcessor::getEventChannelIndex(const Event* event) const
 int GenericProcessor::getSpikeChannelIndex(int channelIdx, int processorID, int subProcessorIdx) const
 {
 	uint32 sourceID = getProcessorFullId(processorID, subProcessorIdx);
-	try
-	{
-		return spikeChannelMap.at(sourceID).at(channelIdx);
-	}
-	catch (...)
-	{
+	//looked up without at(), as events from channels this processor doesn't know about are common
+	ChannelIndexMap::const_iterator source = spikeChannelMap.find(sourceID);
+	if (source == spikeChannelMap.end())
 		return -1;
-	}
+	ChannelIndexes::const_iterator channel = source->second.find(channelIdx);
+	if (channel == source->second.end())
+		return -1;
+	return channel->second;
 }
 
 int GenericProcessor::getSpikeChannelIndex(const SpikeEvent* event) const
@@ -926,6 +1465,11 @@ int GenericProcessor::getSpikeChannelIndex(const SpikeEvent* event) const
 	return getSpikeChannelIndex(event->getSourceIndex(), event->getSourceID(), event->getSubProcessorIdx());
 }
 
+int GenericProcessor::getSpikeChannelIndex(const SpikeEventView& event) const
+{
+	return getSpikeChannelIndex(event.getSourceIndex(), event.getSourceID(), event.getSubProcessorIdx());
+}
+
 
 /////// ---- LOADING AND SAVING ---- //////////
 
@@ -983,6 +1527,9 @@ void GenericProcessor::saveChannelParametersToXml (XmlElement* parentElement, in
         selectionState->setAttribute ("param", p);
         selectionState->setAttribute ("record", r);
         selectionState->setAttribute ("audio", a);
+
+        if (channelNumber < dataChannelArray.size() && dataChannelArray[channelNumber]->getRecordDecimation() > 1)
+            selectionState->setAttribute ("record_decimation", dataChannelArray[channelNumber]->getRecordDecimation());
     }
 	else if (type == InfoObjectCommon::EVENT_CHANNEL)
     {
@@ -1083,6 +1630,9 @@ void GenericProcessor::loadChannelParametersFromXml (XmlElement* channelInfo, In
                                                        subNode->getBoolAttribute ("param"),
                                                        subNode->getBoolAttribute ("record"),
                                                        subNode->getBoolAttribute ("audio"));
+
+                if (isPositiveAndBelow (channelNum, dataChannelArray.size()))
+                    dataChannelArray[channelNum]->setRecordDecimation (subNode->getIntAttribute ("record_decimation", 1));
             }
         }
     }
@@ -1161,6 +1711,32 @@ bool GenericProcessor::isSplitter()      const  { return getProcessorType() == P
 bool GenericProcessor::isMerger()        const  { return getProcessorType() == PROCESSOR_TYPE_MERGER;        }
 bool GenericProcessor::isUtility()       const  { return getProcessorType() == PROCESSOR_TYPE_UTILITY;       }
 
+bool GenericProcessor::isAligningSources() const { return false; }
+
+bool GenericProcessor::hasSourceAligner() const { return m_sourceAligner != nullptr; }
+
+bool GenericProcessor::isDataPassThrough() const { return isSink() || isSplitter() || isMerger(); }
+
+bool GenericProcessor::isDisplayOnly() const { return false; }
+
+bool GenericProcessor::isIdle() const { return false; }
+
+void GenericProcessor::updateIdleState()
+{
+	const int idle = isIdle() ? 1 : 0;
+
+	if (m_isIdle.exchange (idle) != idle)
+		idleStateChanged (idle != 0);
+}
+
+void GenericProcessor::idleStateChanged (bool) {}
+
+bool GenericProcessor::isIdleState() const { return m_isIdle.get() != 0; }
+
+bool GenericProcessor::isPassThroughChannel (int) const { return false; }
+
+const int16* GenericProcessor::getRawSampleData (int) const { return nullptr; }
+
 int GenericProcessor::getNumParameters()    { return parameters.size(); }
 int GenericProcessor::getNumPrograms()      { return 0; }
 int GenericProcessor::getCurrentProgram()   { return 0; }
@@ -1232,12 +1808,34 @@ void GenericProcessor::setEnabledState (bool t)
 bool GenericProcessor::enableProcessor()
 {
 	m_lastProcessTime = Time::getHighResolutionTicks();
+	m_traceName = TraceRecorder::internName (getName() + " (" + String (getNodeId()) + ")");
+
+	// the changes queued by other threads since acquisition last stopped
+	collectParameterChanges (0);
+	m_parameterChangeBlockStart = -1;
+	applyParameterChanges (0);
+	m_queueParameterChanges = 1;
+
+	if (m_sourceAligner != nullptr)
+	{
+		m_sourceAligner->setClockSynchronizer (&AccessClass::getProcessorGraph()->getClockSynchronizer());
+		m_sourceAligner->reset();
+	}
+
 	return enable();
 }
 
 bool GenericProcessor::disableProcessor()
 {
-	return disable();
+	const bool result = disable();
+
+	// whatever has not been applied yet, timed or not, is applied now that nothing is processed
+	m_queueParameterChanges = 0;
+	collectParameterChanges (0);
+	m_parameterChangeBlockStart = -1;
+	applyParameterChanges (0);
+
+	return result;
 }
 
 bool GenericProcessor::enable()
@@ -1265,6 +1863,77 @@ GenericProcessor::DefaultEventInfo::DefaultEventInfo()
 	sampleRate(44100)
 {}
 
+GenericProcessor::EventSubscription::EventSubscription()
+{
+	reset();
+}
+
+void GenericProcessor::EventSubscription::reset()
+{
+	m_allEventChannels = true;
+	m_allSpikeChannels = true;
+	m_spikes = true;
+	m_syncTexts = true;
+	m_eventTypes = ALL_EVENT_TYPES;
+	m_eventChannels.clearQuick();
+	m_spikeChannels.clearQuick();
+}
+
+void GenericProcessor::EventSubscription::clear()
+{
+	m_allEventChannels = false;
+	m_allSpikeChannels = false;
+	m_spikes = false;
+	m_syncTexts = false;
+	m_eventChannels.clearQuick();
+	m_spikeChannels.clearQuick();
+}
+
+void GenericProcessor::EventSubscription::addEventChannel(int channelIndex)
+{
+	m_allEventChannels = false;
+	m_eventChannels.addIfNotAlreadyThere(channelIndex);
+}
+
+void GenericProcessor::EventSubscription::addSpikeChannel(int channelIndex)
+{
+	m_allSpikeChannels = false;
+	m_spikes = true;
+	m_spikeChannels.addIfNotAlreadyThere(channelIndex);
+}
+
+void GenericProcessor::EventSubscription::setEventTypes(int typeMask)
+{
+	m_eventTypes = typeMask;
+}
+
+void GenericProcessor::EventSubscription::setSpikes(bool subscribe)
+{
+	m_spikes = subscribe;
+}
+
+void GenericProcessor::EventSubscription::setTimestampSyncTexts(bool subscribe)
+{
+	m_syncTexts = subscribe;
+}
+
+bool GenericProcessor::EventSubscription::includesEventChannel(int channelIndex, EventChannel::EventChannelTypes type) const
+{
+	if ((m_eventTypes & (1 << type)) == 0)
+		return false;
+	return m_allEventChannels || m_eventChannels.contains(channelIndex);
+}
+
+bool GenericProcessor::EventSubscription::includesSpikeChannel(int channelIndex) const
+{
+	return m_spikes && (m_allSpikeChannels || m_spikeChannels.contains(channelIndex));
+}
+
+bool GenericProcessor::EventSubscription::includesTimestampSyncTexts() const
+{
+	return m_syncTexts;
+}
+
 uint32 GenericProcessor::getProcessorFullId(uint16 sid, uint16 subid)
 {
 	return (uint32(sid) << 16) + subid;
@@ -1275,6 +1944,86 @@ int64 GenericProcessor::getLastProcessedsoftwareTime() const
 	return m_lastProcessTime;
 }
 
+const ProcessorTimingStats& GenericProcessor::getTimingStats() const
+{
+	return m_timingStats;
+}
+
+int64 GenericProcessor::getLastBlockTicks() const
+{
+	return m_lastBlockTicks;
+}
+
+int64 GenericProcessor::getMemoryFootprint() const
+{
+	// the change queue and the block's popped changes have the same capacity
+	int64 bytes = (int64) m_eventArenaSize
+		+ 2 * (int64) m_parameterChangeQueue.getCapacity() * (int64) sizeof (ParameterChangeQueue::Change)
+		+ MemoryFootprint::ofArray (m_pendingParameterChanges)
+		+ MemoryFootprint::ofArray (m_handlerEventBuffer.data)
+		+ m_displayTap->getMemoryFootprint();
+
+	if (m_sourceAligner != nullptr)
+		bytes += m_sourceAligner->getMemoryFootprint();
+
+	if (VisualizerEditor* visualizerEditor = dynamic_cast<VisualizerEditor*> (getEditor()))
+	{
+		if (visualizerEditor->canvas != nullptr)
+			bytes += visualizerEditor->canvas->getMemoryFootprint();
+	}
+
+	return bytes;
+}
+
+var GenericProcessor::getStatusInfo() const
+{
+	return var();
+}
+
+const ProcessorTimingStats* GenericProcessor::getEventLatencyStats(int eventChannelIndex) const
+{
+	return m_eventLatencyStats[eventChannelIndex];
+}
+
+void GenericProcessor::setEventLatencyMeasurementEnabled(bool enabled)
+{
+	m_measureEventLatency.set(enabled ? 1 : 0);
+}
+
+bool GenericProcessor::isEventLatencyMeasurementEnabled()
+{
+	return m_measureEventLatency.get() != 0;
+}
+
+int64 GenericProcessor::getSourceHostTicks(uint16 processorID, uint16 subProcessorIdx) const
+{
+	int slot = getSourceSlot(getProcessorFullId(processorID, subProcessorIdx));
+	if (slot >= 0 && m_sourceHostTicks.getUnchecked(slot) != 0)
+		return m_sourceHostTicks.getUnchecked(slot);
+
+	return m_oldestSourceHostTicks;
+}
+
+void GenericProcessor::measureEventLatency(const EventChannel* eventInfo)
+{
+	if (m_measureEventLatency.get() == 0)
+		return;
+
+	measureEventLatency(eventInfo, getSourceHostTicks(eventInfo->getSourceNodeID(), eventInfo->getSubProcessorIdx()));
+}
+
+void GenericProcessor::measureEventLatency(const EventChannel* eventInfo, int64 sourceTicks)
+{
+	if (m_measureEventLatency.get() == 0 || sourceTicks == 0)
+		return;
+
+	// the channels and their statistics only change outside of acquisition, and the statistics are atomic
+	ProcessorTimingStats* stats = m_eventLatencyStats[eventChannelArray.indexOf(const_cast<EventChannel*>(eventInfo))];
+
+	if (stats != nullptr)
+		stats->addBlock(Time::getHighResolutionTicks() - sourceTicks, 0);
+}
+
 void ChannelCreationIndexes::clearChannelCreationCounts()
 {
 	dataChannelCount = 0;
@@ -32,7 +32,18 @@
 #include "../../Processors/Dsp/LinearSmoothedValueAtomic.h"
 #include "../../Processors/PluginManager/PluginIDs.h"
 #include "../Channel/InfoObjects.h"
+#include "../Channel/ChannelMask.h"
 #include "../Events/Events.h"
+#include "../Events/EventBlockIndex.h"
+#include "ProcessorTimingStats.h"
+#include "MemoryFootprint.h"
+#include "TraceRecorder.h"
+#include "AllocationAudit.h"
+#include "SettingsBlob.h"
+#include "../ProcessorGraph/OverrunWatchdog.h"
+#include "../Visualization/DisplayTap.h"
+#include "../Merger/SourceAligner.h"
+#include "ParameterChangeQueue.h"
 
 #include <time.h>
 #include <stdio.h>
@@ -44,6 +55,7 @@ class DataViewport;
 class UIComponent;
 class GenericEditor;
 class Parameter;
+class ChannelThreadPool;
 
 
 using namespace Plugin;
@@ -117,7 +129,8 @@ public:
 
     /** Allows parameters to change while acquisition is active. If the user wants
     to change ANY variables that are used within the process() method, this must
-    be done through setParameter(). Otherwise the application will crash. */
+    be done through setParameter(). Otherwise the application will crash.
+    Use queueParameterChange() to have it called by the processing thread instead. */
     virtual void setParameter (int parameterIndex, float newValue) override;
 
     /** Creates a GenericEditor.*/
@@ -234,6 +247,26 @@ public:
     */
     virtual void process (AudioSampleBuffer& continuousBuffer) = 0;
 
+    /** Returns true if processChannels() can safely run on several threads at once for
+        disjoint ranges of channels, letting process() spread its work over several cores
+        with processChannelsInParallel(). */
+    virtual bool isChannelParallelSafe() const;
+
+    /** Processes the channels from firstChannel to lastChannel - 1 of the buffer.
+
+        Called by processChannelsInParallel(), possibly concurrently for other ranges, so it
+        must only touch the state of its own channels and must not add events.
+    */
+    virtual void processChannels (AudioSampleBuffer& buffer, int firstChannel, int lastChannel);
+
+    /** Limits the number of pool threads processChannelsInParallel() uses besides the calling
+        thread. 0 processes every channel on the calling thread; negative, the default, uses them all. */
+    void setMaxChannelThreads (int maxThreads);
+    int getMaxChannelThreads() const;
+
+    /** Returns the number of threads of the channel thread pool shared by all processors */
+    int getNumChannelPoolThreads() const;
+
     /** Pointer to a processor's immediate source node.*/
     GenericProcessor* sourceNode;
 
@@ -328,6 +361,55 @@ public:
     /** Returns true if a processor is a utility (non-merger or splitter), false otherwise.*/
     virtual bool isUtility() const;
 
+    /** Returns true if a merger makes the processor after it wait for all of its sources,
+        so that every channel of its blocks covers the same span of time (see SourceAligner).
+        False by default.*/
+    virtual bool isAligningSources() const;
+
+    /** Returns true if the blocks of this processor are aligned across the sources of the
+        merger before it. They are then rewritten in place, so never shared with upstream.*/
+    bool hasSourceAligner() const;
+
+    /** Returns true if a processor never modifies the continuous data going through it, false otherwise.
+
+        Channels going through a processor that is not pass-through lose their raw samples
+        (see DataChannel::hasRawSamples). By default only sinks, splitters and mergers are pass-through.*/
+    virtual bool isDataPassThrough() const;
+
+    /** Returns true if a processor only draws its inputs, so that its blocks can be skipped
+        while processing can't keep up (see OverrunWatchdog::DROP_DISPLAY_BRANCHES). False by
+        default: only sinks whose output nothing, recordings included, depends on should say so.*/
+    virtual bool isDisplayOnly() const;
+
+    /** Returns true if process() has nothing to do for now, e.g. because every channel is
+        bypassed or no visualizer is open. processBlock() then skips it, the block's data and
+        events going on untouched. False by default. Only asked by updateIdleState(). */
+    virtual bool isIdle() const;
+
+    /** Asks isIdle() again. Called by update(), and by processors and editors whenever
+        something isIdle() depends on changes, from the message thread or within process(). */
+    void updateIdleState();
+
+    /** Returns the result of isIdle() when updateIdleState() was last called */
+    bool isIdleState() const;
+
+    /** Called by updateIdleState() when the result of isIdle() changed, on the same thread */
+    virtual void idleStateChanged (bool isIdle);
+
+    /** Returns true if process() leaves an output channel holding the samples that came in on the
+        input channel of the same index, which lets the graph hand the processor the buffer of the
+        upstream processor rather than a copy of it when that buffer is also recorded or used
+        further on. A processor with fewer outputs than inputs can declare the outputs it keeps
+        untouched. False by default, processors being free to change their channels in place.
+        Only asked when the signal chain is rebuilt.*/
+    virtual bool isPassThroughChannel (int channel) const;
+
+    /** Returns the original integer codes of the samples output in the current block for one of
+        the channels created by this processor, or nullptr if they are not kept.
+
+        Only valid during the processing cycle in which the samples were output.*/
+    virtual const int16* getRawSampleData (int channel) const;
+
     /** Returns true if a processor is able to send its output to a given processor.
 
         Ideally, this should always return true, but there may be special cases
@@ -383,6 +465,11 @@ public:
     /** Returns a pointer to the processor's internal event buffer, if it exists. */
     virtual MidiBuffer* getEventBuffer() const;
 
+    /** Returns the tap keeping the recent samples of the processor's outputs, which visualizers
+        downstream can share by attaching a DisplayTap::Reader to it. It is sized by update(),
+        and only filled while an active reader is attached. */
+    DisplayTap* getDisplayTap() const;
+
     int nextAvailableChannel;
 
     /** Variable used to orchestrate saving the ProcessorGraph. */
@@ -488,6 +575,11 @@ public:
 	@see GenericProcessor::getProcessorFullId(uint16,uint16) */
 	uint64 getSourceTimestamp(uint32 fullSourceID) const;
 
+	/** Returns the high resolution ticks at which a source processed the current block, or
+	the oldest such time among the sources seen in this block if the given one isn't one of them.
+	0 if no source has reported a time. */
+	int64 getSourceHostTicks(uint16 processorID, uint16 subProcessorIdx) const;
+
 	virtual int getNumSubProcessors() const;
 
 	int getDataChannelIndex(int channelIdx, int processorID, int subProcessorIdx = 0) const;
@@ -500,8 +592,15 @@ public:
 
 	int getSpikeChannelIndex(const SpikeEvent*) const;
 
+	int getSpikeChannelIndex(const SpikeEventView&) const;
+
 	const DataChannel* getDataChannel(int index) const;
 
+	/** Returns the bitVolts, sample rates, sources and record and monitor flags of this processor's
+	data channels in contiguous arrays, for code looping over channels every block. Rebuilt when the
+	channel indexes are updated; the flags are kept current at the start of every block. */
+	const DataChannelTable& getDataChannelTable() const;
+
 	const EventChannel* getEventChannel(int index) const;
 
 	const SpikeChannel* getSpikeChannel(int index) const;
@@ -520,6 +619,55 @@ public:
 
 	int64 getLastProcessedsoftwareTime() const;
 
+	/** Returns how long this processor's process() calls took since acquisition last started. */
+	const ProcessorTimingStats& getTimingStats() const;
+
+	/** Returns how long the last processBlock() call took, in high resolution ticks */
+	int64 getLastBlockTicks() const;
+
+	/** Returns an estimate, in bytes, of the memory the processor holds: its event and parameter
+	buffers and those of its visualizer's canvas. Processors allocating buffers of their own add them
+	to GenericProcessor::getMemoryFootprint(), see MemoryFootprint. Called from the message thread,
+	possibly while the processing thread uses the buffers, so it must only read their sizes. */
+	virtual int64 getMemoryFootprint() const;
+
+	/** Returns what the processor itself has to say about the data for remote monitoring, reported by
+	CoreServices::getStatusSnapshot() along with its timing, or a void var if nothing. Called from the
+	message thread, so it must only read what the processing thread has published. */
+	virtual var getStatusInfo() const;
+
+	/** Returns the latencies measured with measureEventLatency() for the events of an event channel
+	since acquisition last started, or nullptr if the index is out of range. */
+	const ProcessorTimingStats* getEventLatencyStats(int eventChannelIndex) const;
+
+	/** Makes processBlock() call process() on consecutive sub-blocks of at most numSamples samples,
+	rather than once on the whole block, or restores the default if numSamples is 0.
+
+	During each call, getNumSamples() and getTimestamp() describe the sub-block, checkForEvents()
+	only hands over the events falling inside it, and the sample positions of the events added are
+	relative to it, so process() doesn't have to know about sub-blocks. Processors downstream still
+	receive the whole block. Ignored for sources. Not to be changed during acquisition. */
+	void setSubBlockSize(int numSamples);
+
+	int getSubBlockSize() const;
+
+	/** Changes a parameter from any thread without racing process().
+
+	During acquisition the change is queued, and the processing thread applies it through setParameter(),
+	with currentChannel set to channel if that isn't negative. It is applied at the start of the next block,
+	or, if timestamp isn't negative, at the sample with that timestamp in the clock of the first data channel,
+	the block being split there as with setSubBlockSize(). Sources, whose timestamps are only known once
+	process() has run, apply every change at the start of the next block.
+
+	Outside of acquisition the change is applied straight away when called from the message thread, and
+	otherwise when acquisition next starts. Returns false if the queue is full, dropping the change. */
+	bool queueParameterChange(int parameterIndex, float newValue, int channel = -1, int64 timestamp = -1);
+
+	/** Enables the event latency measurements of all processors. Can be changed at any time. */
+	static void setEventLatencyMeasurementEnabled(bool enabled);
+
+	static bool isEventLatencyMeasurementEnabled();
+
 	static uint32 getProcessorFullId(uint16 processorId, uint16 subprocessorIdx);
 
 	class PLUGIN_API DefaultEventInfo
@@ -536,6 +684,58 @@ public:
 		String identifier;
 	};
 
+	/** The events checkForEvents() hands over to handleEvent(), handleSpike() and handleTimestampSyncTexts(),
+	as declared by getEventSubscription(). A default-constructed subscription covers everything. */
+	class PLUGIN_API EventSubscription
+	{
+	public:
+		enum EventTypeMask
+		{
+			TTL_EVENTS = 1 << EventChannel::TTL,
+			TEXT_EVENTS = 1 << EventChannel::TEXT,
+			BINARY_EVENTS = ((1 << EventChannel::INVALID) - 1) & ~((1 << EventChannel::BINARY_BASE_VALUE) - 1),
+			ALL_EVENT_TYPES = TTL_EVENTS | TEXT_EVENTS | BINARY_EVENTS
+		};
+
+		EventSubscription();
+
+		/** Subscribes to everything again */
+		void reset();
+
+		/** Unsubscribes from everything */
+		void clear();
+
+		/** Adds an event channel, by its index in eventChannelArray. Once a channel is added, only
+		the channels added explicitly are subscribed to */
+		void addEventChannel(int channelIndex);
+
+		/** Adds a spike channel, by its index in spikeChannelArray. Once a channel is added, only
+		the channels added explicitly are subscribed to */
+		void addSpikeChannel(int channelIndex);
+
+		/** Restricts the event channels to those whose type is in an EventTypeMask combination */
+		void setEventTypes(int typeMask);
+
+		/** Whether spikes are dispatched when checkForEvents() is asked to. True by default */
+		void setSpikes(bool subscribe);
+
+		/** Whether handleTimestampSyncTexts() gets called. True by default */
+		void setTimestampSyncTexts(bool subscribe);
+
+		bool includesEventChannel(int channelIndex, EventChannel::EventChannelTypes type) const;
+		bool includesSpikeChannel(int channelIndex) const;
+		bool includesTimestampSyncTexts() const;
+
+	private:
+		bool m_allEventChannels;
+		bool m_allSpikeChannels;
+		bool m_spikes;
+		bool m_syncTexts;
+		int m_eventTypes;
+		Array<int> m_eventChannels;
+		Array<int> m_spikeChannels;
+	};
+
 protected:
 	/** Used to set the timestamp for a given buffer, for a given source node. */
 	void setTimestampAndSamples(uint64 timestamp, uint32 nSamples, int subProcessorIdx = 0);
@@ -554,9 +754,34 @@ protected:
 	Called by checkForEvents(). */
 	virtual void handleSpike(const SpikeChannel* spikeInfo, const MidiMessage& event, int samplePosition = 0);
 
+	/** Declares the events this processor's checkForEvents() calls should hand over, so that events
+	the handlers would discard are skipped without being copied into a MidiMessage. Called whenever
+	the channel indexes are updated and by updateEventSubscription(). The default keeps everything.*/
+	virtual void getEventSubscription(EventSubscription& subscription) const;
+
+	/** Resolves getEventSubscription() again, for processors whose subscription depends on parameters.
+	Allocates nothing once resolved at update(), so it can be called from process(). */
+	void updateEventSubscription();
+
+	/** Returns the index of this block's events, built once at the start of the block and rebuilt
+	if events have been added since. Sample positions are relative to the whole block, even when
+	processing sub-blocks. The events it points to stay valid until events are next added outside
+	of checkForEvents(). */
+	const EventBlockIndex& getBlockEvents();
+
 	/** Responds to TIMESTAMP_SYNC_TEXT system events, in case a processor needs to listen to them (useful for the record node) */
 	virtual void handleTimestampSyncTexts(const MidiMessage& event);
 
+	/** To be called by processors driving outputs (such as TTL lines or stimulators) right after they
+	act upon an event. If event latency measurement is enabled, records how long ago the source the
+	event descends from processed its block, in the statistics of the event's channel. */
+	void measureEventLatency(const EventChannel* eventInfo);
+
+	/** As measureEventLatency(), for outputs that act upon an event later, on a thread of their own.
+	sourceTicks is what getSourceHostTicks() returned for the event's source while the event was
+	handled, and the time from then until now is recorded. Can be called from any thread. */
+	void measureEventLatency(const EventChannel* eventInfo, int64 sourceTicks);
+
 	/** Returns the default number of datachannels outputs for a specific type and a specific subprocessor
 	Called by createDataChannels(). It is not needed to implement if createDataChannels() is overriden */
 	virtual int getDefaultNumDataOutputs(DataChannel::DataChannelTypes type, int subProcessorIdx = 0) const;
@@ -579,6 +804,20 @@ protected:
 	void addSpike(int channelIndex, const SpikeEvent* event, int sampleNum);
 	void addSpike(const SpikeChannel* channel, const SpikeEvent* event, int sampleNum);
 
+	/** Adds the event TTLEvent::createTTLEvent() would create for one bit of a TTL word, serialized
+	straight into the event buffer. No memory is allocated, so it is the way to emit TTLs at high rates.*/
+	void addTTLEvent(const EventChannel* channel, int64 timestamp, const void* ttlWord, uint16 bit, int sampleNum);
+
+	/** Adds the event TextEvent::createTextEvent() would create for a UTF-8 text, serialized straight into
+	the event buffer without allocating an event or a String. See TextEvent::serializeTextEvent() for the
+	text size and the metadata.*/
+	void addTextEvent(const EventChannel* channel, int64 timestamp, const char* text, int sampleNum, int textSize = -1, const void* metaData = nullptr);
+
+	/** Calls processChannels() for channels 0 to numChannels - 1, split in ranges processed by
+	the shared channel thread pool if isChannelParallelSafe() returns true. It only returns once
+	every channel is done, so process() can add the events found afterwards in a fixed order.*/
+	void processChannelsInParallel(AudioSampleBuffer& buffer, int numChannels);
+
 	/** Method to create the data channels pertaining to this processor, called automatically by update()*/
 	virtual void createDataChannels();
 
@@ -600,13 +839,109 @@ protected:
 	void updateChannelIndexes(bool updateNodeID = true);
 
 private:
+	/** Returns the slot of a source in m_sourceNumSamples and m_sourceTimestamps, or -1 if none of
+	this processor's channels come from it */
+	int getSourceSlot(uint32 fullSourceID) const;
+
+	/** Sources known at update() time have a slot in these dense arrays, indexed through
+	m_dataChannelSourceSlots for each data channel. Counts from any other source go to the maps. */
+	Array<uint32> m_sourceIds;
+	Array<uint32> m_sourceNumSamples;
+	Array<int64> m_sourceTimestamps;
+	Array<int64> m_sourceHostTicks;
+	int64 m_oldestSourceHostTicks;
+	Array<int> m_dataChannelSourceSlots;
+
+	DataChannelTable m_dataChannelTable;
+
 	std::map<uint32, uint32> numSamples;
 	std::map<uint32, int64> timestamps;
 
 	int64 m_lastProcessTime;
 
+	ProcessorTimingStats m_timingStats;
+	int64 m_lastBlockTicks;
+
+	/** Calls process() on the sub-blocks of the current block, see setSubBlockSize(), also splitting it
+	where queued parameter changes are due */
+	void processSubBlocks(AudioSampleBuffer& buffer, int numSamples);
+
+	/** Moves the queued parameter changes to m_pendingParameterChanges, in timestamp order, and returns
+	true if one of them is due after the start of the block but before its end */
+	bool collectParameterChanges(int numSamples);
+
+	/** Position in the current block at which a pending change is due, 0 if it is already due */
+	int64 getParameterChangeOffset(const ParameterChangeQueue::Change& change) const;
+
+	/** Applies, in order, the pending changes due up to the given position in the current block */
+	void applyParameterChanges(int blockOffset);
+
+	void applyParameterChange(const ParameterChangeQueue::Change& change);
+
+	ParameterChangeQueue m_parameterChangeQueue;
+	/** Changes taken from the queue but not yet due, only touched by the processing thread during acquisition */
+	Array<ParameterChangeQueue::Change> m_pendingParameterChanges;
+	HeapBlock<ParameterChangeQueue::Change> m_poppedParameterChanges;
+	/** Timestamp of the first data channel at the start of the current block, or -1 if changes can't be timed */
+	int64 m_parameterChangeBlockStart;
+	DisplayTap::Ptr m_displayTap;
+
+	/** Copies the block's outputs to the display tap */
+	void fillDisplayTap(const AudioSampleBuffer& buffer);
+
+	/** Set by update() when the source node is a merger aligning its sources */
+	ScopedPointer<SourceAligner> m_sourceAligner;
+
+	/** Replaces the block with its aligned samples, and the counts and timestamps of the
+	TIMESTAMP_AND_SAMPLES events with theirs, so that processors further on see the same */
+	void alignSources(AudioSampleBuffer& buffer);
+
+	/** Cached isIdle(), read by the processing thread */
+	Atomic<int> m_isIdle;
+	/** The name of the processor's spans in a TraceRecorder timeline, set when acquisition starts */
+	const char* m_traceName;
+	/** True while the processing thread is the one to apply queued changes */
+	Atomic<int> m_queueParameterChanges;
+
+	int m_subBlockSize;
+	/** Start and length of the sub-block being processed, or 0 and -1 outside of processSubBlocks() */
+	int m_subBlockStart;
+	int m_subBlockLength;
+	/** Copies of m_sourceNumSamples and m_sourceTimestamps for the whole block, sized alongside them */
+	Array<uint32> m_blockNumSamples;
+	Array<int64> m_blockTimestamps;
+	/** One per event channel, sized when the channel indexes are updated */
+	OwnedArray<ProcessorTimingStats> m_eventLatencyStats;
+
+	/** getEventSubscription() resolved per event and spike channel. The subscription is kept so that its storage is reused */
+	EventSubscription m_eventSubscription;
+	Array<bool> m_subscribedEventChannels;
+	Array<bool> m_subscribedSpikeChannels;
+	bool m_subscribedToSyncTexts;
+
+	/** Receives the events added while checkForEvents() dispatches. Kept so that its storage is reused */
+	MidiBuffer m_handlerEventBuffer;
+
+	static Atomic<int> m_measureEventLatency;
+
 	void createDataChannelsByType(DataChannel::DataChannelTypes type);
 
+	/** Returns space for one serialized event from the event arena, which is reset at the start of
+	each block. The space stays valid until then. */
+	char* allocateEventData(size_t size);
+
+	/** Sizes the event arena for the largest event this processor's channels can carry. */
+	void resetEventArena();
+
+	MemoryBlock m_eventArena;
+	size_t m_eventArenaSize;
+	size_t m_eventArenaUsed;
+	/** Arena blocks outgrown during the current block, freed when the next one starts */
+	OwnedArray<MemoryBlock> m_retiredEventArenas;
+
+	SharedResourcePointer<ChannelThreadPool> m_channelThreadPool;
+	Atomic<int> m_maxChannelThreads;
+
 	/** Each processor has a unique integer ID that can be used to identify it.*/
 	int nodeId;
 
@@ -617,6 +952,16 @@ private:
     /** Extracts sample counts and timestamps from the MidiBuffer. */
     int processEventBuffer ();
 
+	/** Rebuilds m_blockEvents from the events of the block's buffer */
+	void indexEventBuffer();
+
+	/** The event buffer passed to processBlock(), which m_currentMidiBuffer only differs from while
+	checkForEvents() dispatches */
+	MidiBuffer* m_blockEventBuffer;
+	EventBlockIndex m_blockEvents;
+	/** False once events have been added to the block's buffer since it was indexed */
+	bool m_blockEventsValid;
+
     /** The type of the processor. */
     PluginProcessorType m_processorType;
 
@@ -624,8 +969,9 @@ private:
     const String m_name;
 
     /** Saves the record status of individual channels, even when other parameters are updated. */
-    Array<bool> m_recordStatus;
-    Array<bool> m_monitorStatus;
+    ChannelMask m_recordStatus;
+    ChannelMask m_monitorStatus;
+    Array<int> m_recordDecimation;
 
     /** For getInputChannelName() and getOutputChannelName() */
     static const String m_unusedNameString;
@@ -0,0 +1,73 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __MEMORYFOOTPRINT_H_7D2B9E41__
+#define __MEMORYFOOTPRINT_H_7D2B9E41__
+
+#include <JuceHeader.h>
+
+/**
+    Helpers for the getMemoryFootprint() methods of processors and buffers, which add up
+    the bytes of the blocks they allocate.
+
+    Sizes are computed from the element counts, so they leave out the allocator's overhead
+    and any space a container keeps beyond its size: they are estimates, good to compare
+    processors and to follow over a session, not exact counts.
+
+    @see GenericProcessor::getMemoryFootprint
+*/
+namespace MemoryFootprint
+{
+    /** The samples of a buffer, and its array of channel pointers */
+    inline int64 ofBuffer (const AudioSampleBuffer& buffer)
+    {
+        return (int64) buffer.getNumChannels() * ((int64) buffer.getNumSamples() * (int64) sizeof (float) + (int64) sizeof (float*));
+    }
+
+    inline int64 ofBuffer (const AudioSampleBuffer* buffer)
+    {
+        return buffer != nullptr ? ofBuffer (*buffer) : 0;
+    }
+
+    /** numElements elements of a HeapBlock, 0 if it isn't allocated */
+    template <typename ElementType>
+    inline int64 ofBlock (const HeapBlock<ElementType>& block, int64 numElements)
+    {
+        return block.getData() != nullptr ? numElements * (int64) sizeof (ElementType) : 0;
+    }
+
+    /** The elements of an Array */
+    template <typename ArrayType>
+    inline int64 ofArray (const ArrayType& array)
+    {
+        return (int64) array.size() * (int64) sizeof (*array.begin());
+    }
+
+    /** Returns a size such as "12.5 MB" */
+    inline String describe (int64 bytes)
+    {
+        return File::descriptionOfSizeInBytes (bytes);
+    }
+}
+
+
+#endif  // __MEMORYFOOTPRINT_H_7D2B9E41__
@@ -0,0 +1,79 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "ParameterChangeQueue.h"
+
+
+ParameterChangeQueue::ParameterChangeQueue (int capacity)
+    : fifo (capacity)
+{
+    changes.malloc (capacity);
+}
+
+
+int ParameterChangeQueue::getCapacity() const
+{
+    // the fifo keeps one slot free to tell a full buffer from an empty one
+    return fifo.getTotalSize() - 1;
+}
+
+
+bool ParameterChangeQueue::push (const Change& change)
+{
+    const SpinLock::ScopedLockType lock (writeLock);
+
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite (1, start1, size1, start2, size2);
+
+    if (size1 + size2 < 1)
+        return false;
+
+    changes[size1 > 0 ? start1 : start2] = change;
+    fifo.finishedWrite (1);
+
+    return true;
+}
+
+
+int ParameterChangeQueue::pop (Change* dest, int maxNumChanges)
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToRead (maxNumChanges, start1, size1, start2, size2);
+
+    for (int i = 0; i < size1; ++i)
+        dest[i] = changes[start1 + i];
+
+    for (int i = 0; i < size2; ++i)
+        dest[size1 + i] = changes[start2 + i];
+
+    fifo.finishedRead (size1 + size2);
+
+    return size1 + size2;
+}
+
+
+int ParameterChangeQueue::getNumReady() const
+{
+    return fifo.getNumReady();
+}
@@ -0,0 +1,75 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef __PARAMETERCHANGEQUEUE_H_7D2B9E41__
+#define __PARAMETERCHANGEQUEUE_H_7D2B9E41__
+
+#include <JuceHeader.h>
+#include "../PluginManager/OpenEphysPlugin.h"
+
+/**
+    Fixed-size queue of parameter changes, handed from the threads changing a processor's
+    parameters to the thread rendering it.
+
+    Writers take a spin lock between themselves, so the message thread and, for instance, a
+    network thread can both queue changes. The reader never locks nor allocates.
+
+    @see GenericProcessor::queueParameterChange
+*/
+class PLUGIN_API ParameterChangeQueue
+{
+public:
+    struct Change
+    {
+        int parameterIndex;
+        /** The channel the change applies to, or -1 to leave currentChannel as it is */
+        int channel;
+        float value;
+        /** The sample at which the change applies, or -1 for the start of the next block */
+        int64 timestamp;
+    };
+
+    explicit ParameterChangeQueue (int capacity = 1024);
+
+    int getCapacity() const;
+
+    /** Adds a change from any thread. Returns false, dropping the change, if the queue is full.*/
+    bool push (const Change& change);
+
+    /** Moves up to maxNumChanges changes, oldest first, into dest and returns how many there were.
+        Only to be called by one thread at a time.*/
+    int pop (Change* dest, int maxNumChanges);
+
+    int getNumReady() const;
+
+private:
+    AbstractFifo fifo;
+    HeapBlock<Change> changes;
+    SpinLock writeLock;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ParameterChangeQueue);
+};
+
+
+#endif  // __PARAMETERCHANGEQUEUE_H_7D2B9E41__
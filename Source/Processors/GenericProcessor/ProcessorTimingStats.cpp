@@ -0,0 +1,170 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "ProcessorTimingStats.h"
+
+
+ProcessorTimingStats::ProcessorTimingStats()
+{
+    reset();
+}
+
+void ProcessorTimingStats::reset()
+{
+    numBlocks.store (0);
+    totalTicks.store (0);
+    minTicks.store (std::numeric_limits<int64>::max());
+    maxTicks.store (0);
+    totalSamples.store (0);
+
+    for (int i = 0; i < numBuckets; ++i)
+        histogram[i].store (0);
+}
+
+void ProcessorTimingStats::addBlock (int64 ticks, int numSamples)
+{
+    if (ticks < 0)
+        ticks = 0;
+
+    // Single writer: plain loads and stores are enough, relaxed ordering keeps them cheap
+    if (ticks < minTicks.load (std::memory_order_relaxed))
+        minTicks.store (ticks, std::memory_order_relaxed);
+
+    if (ticks > maxTicks.load (std::memory_order_relaxed))
+        maxTicks.store (ticks, std::memory_order_relaxed);
+
+    totalTicks.fetch_add (ticks, std::memory_order_relaxed);
+    totalSamples.fetch_add (numSamples, std::memory_order_relaxed);
+    histogram[getBucket (ticks)].fetch_add (1, std::memory_order_relaxed);
+    numBlocks.fetch_add (1, std::memory_order_release);
+}
+
+int ProcessorTimingStats::getBucket (int64 ticks)
+{
+    if (ticks < (1 << subBucketBits))
+        return (int) ticks;
+
+    int highestBit = 0;
+
+    for (uint64 t = (uint64) ticks; t > 1; t >>= 1)
+        ++highestBit;
+
+    const int subBucket = (int) (ticks >> (highestBit - subBucketBits)) & ((1 << subBucketBits) - 1);
+
+    return jmin ((int) numBuckets - 1, ((highestBit - subBucketBits + 1) << subBucketBits) + subBucket);
+}
+
+int64 ProcessorTimingStats::getBucketUpperBound (int bucket)
+{
+    if (bucket < (1 << subBucketBits))
+        return bucket;
+
+    const int highestBit = (bucket >> subBucketBits) + subBucketBits - 1;
+    const int64 subBucket = bucket & ((1 << subBucketBits) - 1);
+
+    if (highestBit >= 62)
+        return std::numeric_limits<int64>::max();
+
+    return (((int64) (1 << subBucketBits) + subBucket + 1) << (highestBit - subBucketBits)) - 1;
+}
+
+double ProcessorTimingStats::getPercentileMs (double fraction) const
+{
+    uint32 counts[numBuckets];
+    int64 total = 0;
+
+    for (int i = 0; i < numBuckets; ++i)
+    {
+        counts[i] = histogram[i].load (std::memory_order_relaxed);
+        total += counts[i];
+    }
+
+    if (total == 0)
+        return 0.0;
+
+    const int64 target = jmax ((int64) 1, (int64) std::ceil (jlimit (0.0, 1.0, fraction) * total));
+    int64 seen = 0;
+
+    for (int i = 0; i < numBuckets; ++i)
+    {
+        seen += counts[i];
+
+        if (seen >= target)
+        {
+            // The bucket bound can overshoot the slowest block actually seen
+            const int64 bound = jmin (getBucketUpperBound (i), maxTicks.load (std::memory_order_relaxed));
+            return Time::highResolutionTicksToSeconds (bound) * 1000.0;
+        }
+    }
+
+    return Time::highResolutionTicksToSeconds (maxTicks.load (std::memory_order_relaxed)) * 1000.0;
+}
+
+String ProcessorTimingStats::Snapshot::getSummary() const
+{
+    return "avg " + String (meanMs, 2) + "  p99 " + String (p99Ms, 2) + " ms";
+}
+
+void ProcessorTimingStats::getHistogram (Array<double>& upperBoundsMs, Array<int64>& counts) const
+{
+    upperBoundsMs.clearQuick();
+    counts.clearQuick();
+
+    for (int i = 0; i < numBuckets; ++i)
+    {
+        const uint32 count = histogram[i].load (std::memory_order_relaxed);
+
+        if (count > 0)
+        {
+            upperBoundsMs.add (Time::highResolutionTicksToSeconds (getBucketUpperBound (i)) * 1000.0);
+            counts.add (count);
+        }
+    }
+}
+
+ProcessorTimingStats::Snapshot ProcessorTimingStats::getSnapshot() const
+{
+    Snapshot s;
+
+    s.numBlocks = numBlocks.load (std::memory_order_acquire);
+
+    const int64 ticks   = totalTicks.load (std::memory_order_relaxed);
+    const int64 samples = totalSamples.load (std::memory_order_relaxed);
+
+    if (s.numBlocks == 0)
+    {
+        s.minMs = s.meanMs = s.p99Ms = s.maxMs = s.samplesPerSecond = 0.0;
+        return s;
+    }
+
+    s.minMs  = Time::highResolutionTicksToSeconds (minTicks.load (std::memory_order_relaxed)) * 1000.0;
+    s.maxMs  = Time::highResolutionTicksToSeconds (maxTicks.load (std::memory_order_relaxed)) * 1000.0;
+    s.meanMs = Time::highResolutionTicksToSeconds (ticks) * 1000.0 / s.numBlocks;
+    s.p99Ms  = getPercentileMs (0.99);
+
+    const double seconds = Time::highResolutionTicksToSeconds (ticks);
+    s.samplesPerSecond = seconds > 0.0 ? samples / seconds : 0.0;
+
+    return s;
+}
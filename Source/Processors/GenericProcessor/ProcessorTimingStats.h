@@ -0,0 +1,100 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef __PROCESSORTIMINGSTATS_H_4C8E1A93__
+#define __PROCESSORTIMINGSTATS_H_4C8E1A93__
+
+#include <JuceHeader.h>
+#include "../PluginManager/OpenEphysPlugin.h"
+#include <atomic>
+
+/**
+    Accumulates how long a processor's process() calls take.
+
+    Written only by the thread rendering the processor and read from any other thread
+    without locking: every counter is a separate atomic, so a reader may see a block
+    half-accounted for but never a torn value. Durations are also counted in a histogram
+    with four buckets per power of two of high resolution ticks, from which percentiles
+    are estimated as the upper bound of their bucket, at most 25% above the actual value.
+
+    @see GenericProcessor::getTimingStats
+*/
+class PLUGIN_API ProcessorTimingStats
+{
+public:
+    /** A consistent-enough copy of the statistics, with times in milliseconds.*/
+    struct Snapshot
+    {
+        int64 numBlocks;
+        double minMs;
+        double meanMs;
+        double p99Ms;
+        double maxMs;
+
+        /** Samples processed per second of processing time, that is, the sample rate this
+            processor alone could sustain on one core. */
+        double samplesPerSecond;
+
+        /** Returns the mean and 99th percentile, short enough for a title bar.*/
+        String getSummary() const;
+    };
+
+    ProcessorTimingStats();
+
+    /** Clears all counters. Not to be called while the processor is being rendered.*/
+    void reset();
+
+    /** Accounts for a process() call that took the given number of high resolution ticks
+        and handled numSamples samples per channel. Other durations, such as event latencies,
+        are added with a numSamples of 0.*/
+    void addBlock (int64 ticks, int numSamples);
+
+    Snapshot getSnapshot() const;
+
+    /** Returns the estimated duration, in milliseconds, below which the given fraction
+        (between 0 and 1) of the blocks lie.*/
+    double getPercentileMs (double fraction) const;
+
+    /** Fills the arrays with the upper bound, in milliseconds, and the count of every
+        non-empty histogram bucket, in increasing order.*/
+    void getHistogram (Array<double>& upperBoundsMs, Array<int64>& counts) const;
+
+private:
+    enum { subBucketBits = 2, numBuckets = 64 << subBucketBits };
+
+    static int getBucket (int64 ticks);
+    static int64 getBucketUpperBound (int bucket);
+
+    std::atomic<int64> numBlocks;
+    std::atomic<int64> totalTicks;
+    std::atomic<int64> minTicks;
+    std::atomic<int64> maxTicks;
+    std::atomic<int64> totalSamples;
+    std::atomic<uint32> histogram[numBuckets];
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ProcessorTimingStats);
+};
+
+
+#endif  // __PROCESSORTIMINGSTATS_H_4C8E1A93__
@@ -0,0 +1,125 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "SettingsBlob.h"
+
+
+SettingsBlobWriter::SettingsBlobWriter (int version_)
+    : version (version_)
+{
+}
+
+
+MemoryOutputStream& SettingsBlobWriter::getStream()
+{
+    return stream;
+}
+
+
+void SettingsBlobWriter::writeFloats (const float* values, int numValues)
+{
+    for (int i = 0; i < numValues; ++i)
+        stream.writeFloat (values[i]);
+}
+
+
+XmlElement* SettingsBlobWriter::addTo (XmlElement* parent, const String& tagName) const
+{
+    XmlElement* blobXml = parent->createNewChildElement (tagName);
+    blobXml->setAttribute ("Version", version);
+    blobXml->setAttribute ("Bytes", String ((int64) stream.getDataSize()));
+    blobXml->addTextElement (Base64::toBase64 (stream.getData(), stream.getDataSize()));
+
+    return blobXml;
+}
+
+
+// =====================================================================
+
+SettingsBlobReader::SettingsBlobReader (const XmlElement* parent, const String& tagName, int maxVersion)
+    : version (0)
+    , valid   (false)
+{
+    const XmlElement* blobXml = parent != nullptr ? parent->getChildByName (tagName) : nullptr;
+
+    if (blobXml != nullptr)
+    {
+        version = blobXml->getIntAttribute ("Version");
+
+        MemoryOutputStream decoded (data, false);
+
+        valid = version >= 1 && version <= maxVersion
+            && Base64::convertFromBase64 (decoded, blobXml->getAllSubText().trim());
+
+        decoded.flush();
+        valid = valid && (int64) data.getSize() == blobXml->getStringAttribute ("Bytes").getLargeIntValue();
+    }
+
+    stream = new MemoryInputStream (data, false);
+}
+
+
+bool SettingsBlobReader::isValid() const
+{
+    return valid;
+}
+
+
+int SettingsBlobReader::getVersion() const
+{
+    return version;
+}
+
+
+MemoryInputStream& SettingsBlobReader::getStream()
+{
+    return *stream;
+}
+
+
+int SettingsBlobReader::readCount (int bytesPerItem)
+{
+    const int count = stream->readInt();
+
+    if (! valid || count < 0 || (int64) count * jmax (1, bytesPerItem) > stream->getNumBytesRemaining())
+    {
+        valid = false;
+        return 0;
+    }
+
+    return count;
+}
+
+
+bool SettingsBlobReader::readFloats (float* values, int numValues)
+{
+    if (! valid || (int64) numValues * (int64) sizeof (float) > stream->getNumBytesRemaining())
+    {
+        valid = false;
+        return false;
+    }
+
+    for (int i = 0; i < numValues; ++i)
+        values[i] = stream->readFloat();
+
+    return true;
+}
@@ -0,0 +1,110 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __SETTINGSBLOB_H_B61E09D3__
+#define __SETTINGSBLOB_H_B61E09D3__
+
+#include <JuceHeader.h>
+#include "../PluginManager/OpenEphysPlugin.h"
+
+/**
+    Stores the bulk of a processor's settings, such as large tables or waveforms, as a
+    compact binary blob within its XML, in place of an element per entry.
+
+    The blob is a child element holding the base64 of the bytes written, with the version
+    of their layout and their count as attributes:
+
+        <MAPPING_DATA Version="1" Bytes="12000">AQAAAAIAAAA...</MAPPING_DATA>
+
+    The fields users read or edit by hand stay as ordinary attributes next to it. Values
+    are written with the little-endian methods of MemoryOutputStream, so that blobs load
+    on every platform.
+
+    A SettingsBlobReader refuses a blob of a newer version than it knows, or one that was
+    truncated, so that loading can fall back on the older XML layout.
+
+    @see SettingsBlobReader
+*/
+class PLUGIN_API SettingsBlobWriter
+{
+public:
+    explicit SettingsBlobWriter (int version);
+
+    /** The stream the values are written to */
+    MemoryOutputStream& getStream();
+
+    void writeFloats (const float* values, int numValues);
+
+    /** Adds the blob to parent as a child element with the given tag, and returns it */
+    XmlElement* addTo (XmlElement* parent, const String& tagName) const;
+
+private:
+    const int version;
+    MemoryOutputStream stream;
+
+    JUCE_DECLARE_NON_COPYABLE (SettingsBlobWriter);
+};
+
+
+/**
+    Reads back a blob written by a SettingsBlobWriter.
+
+    Counts are read with readCount(), which checks them against the bytes left, so that a
+    damaged blob can't make the caller allocate for items it doesn't hold. Once a read
+    fails, isValid() returns false: callers read everything into locals, and only apply
+    them if the blob was still valid at the end.
+*/
+class PLUGIN_API SettingsBlobReader
+{
+public:
+    /** Decodes the first child of parent with the given tag, if its version is between
+        1 and maxVersion */
+    SettingsBlobReader (const XmlElement* parent, const String& tagName, int maxVersion);
+
+    /** Returns true if the blob was found and decoded, and no read has failed */
+    bool isValid() const;
+
+    int getVersion() const;
+
+    /** The stream the values are read from */
+    MemoryInputStream& getStream();
+
+    /** Reads a count written with writeInt(), of items taking at least bytesPerItem each.
+        Returns 0 and invalidates the reader if it is negative or there aren't enough bytes left. */
+    int readCount (int bytesPerItem);
+
+    /** Reads values written with writeFloats(), returning false and invalidating the reader
+        if there aren't enough bytes left */
+    bool readFloats (float* values, int numValues);
+
+private:
+    int version;
+    bool valid;
+    MemoryBlock data;
+    ScopedPointer<MemoryInputStream> stream;
+
+    JUCE_DECLARE_NON_COPYABLE (SettingsBlobReader);
+};
+
+
+#endif  // __SETTINGSBLOB_H_B61E09D3__
@@ -0,0 +1,285 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "TraceRecorder.h"
+
+#if JUCE_MSVC && _MSC_VER < 1900
+ #define TRACE_THREAD_LOCAL __declspec(thread)
+#else
+ #define TRACE_THREAD_LOCAL thread_local
+#endif
+
+
+namespace
+{
+    /** Spans a ring holds, per thread */
+    const int64 ringSize = 1 << 14;
+
+    /** Threads that can record at once; the spans of any more are dropped */
+    const int maxRings = 256;
+
+    struct Span
+    {
+        const char* name;
+        int64 startTicks;
+        int64 endTicks;
+    };
+
+    struct Ring
+    {
+        Ring() : spans ((size_t) ringSize), written (0), exportFrom (0), inUse (false) {}
+
+        HeapBlock<Span> spans;
+        std::atomic<int64> written;     // spans ever written, the last ringSize of which are held
+        int64 exportFrom;               // the first written since tracing last started
+        String threadName;
+        bool inUse;
+    };
+
+    struct Registry
+    {
+        CriticalSection lock;
+        OwnedArray<Ring> rings;
+        StringPool names;
+    };
+
+    Registry& getRegistry()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    /** Claims a ring for the current thread: one left by a thread that has exited, or a new one */
+    Ring* claimRing (const char* threadName)
+    {
+        Registry& registry = getRegistry();
+        const ScopedLock sl (registry.lock);
+
+        Ring* ring = nullptr;
+
+        for (int i = 0; i < registry.rings.size() && ring == nullptr; ++i)
+        {
+            if (! registry.rings[i]->inUse)
+                ring = registry.rings[i];
+        }
+
+        if (ring == nullptr)
+        {
+            if (registry.rings.size() >= maxRings)
+                return nullptr;
+
+            ring = registry.rings.add (new Ring());
+        }
+
+        ring->inUse = true;
+        ring->written.store (0);
+        ring->exportFrom = 0;
+
+        MessageManager* messageManager = MessageManager::getInstanceWithoutCreating();
+
+        if (Thread* thread = Thread::getCurrentThread())
+            ring->threadName = thread->getThreadName();
+        else if (messageManager != nullptr && messageManager->isThisTheMessageThread())
+            ring->threadName = "Message thread";
+        else if (threadName != nullptr)
+            ring->threadName = threadName;
+        else
+            ring->threadName = "Thread " + String::toHexString ((int64) (pointer_sized_int) Thread::getCurrentThreadId());
+
+        return ring;
+    }
+
+    /** Gives the ring of a thread back when it exits */
+    struct RingHandle
+    {
+        RingHandle() : ring (nullptr), claimFailed (false) {}
+
+        ~RingHandle()
+        {
+            if (ring != nullptr)
+            {
+                const ScopedLock sl (getRegistry().lock);
+                ring->inUse = false;
+            }
+        }
+
+        Ring* ring;
+        bool claimFailed;
+    };
+
+#if JUCE_MSVC && _MSC_VER < 1900
+    // no thread-local destructors there, so the rings of exited threads are not reused
+    TRACE_THREAD_LOCAL Ring* currentRing = nullptr;
+    TRACE_THREAD_LOCAL bool currentClaimFailed = false;
+
+    Ring* getCurrentRing (const char* threadName)
+    {
+        if (currentRing == nullptr && ! currentClaimFailed)
+        {
+            currentRing = claimRing (threadName);
+            currentClaimFailed = (currentRing == nullptr);
+        }
+
+        return currentRing;
+    }
+#else
+    TRACE_THREAD_LOCAL RingHandle currentRing;
+
+    Ring* getCurrentRing (const char* threadName)
+    {
+        if (currentRing.ring == nullptr && ! currentRing.claimFailed)
+        {
+            currentRing.ring = claimRing (threadName);
+            currentRing.claimFailed = (currentRing.ring == nullptr);
+        }
+
+        return currentRing.ring;
+    }
+#endif
+}
+
+
+std::atomic<int> TraceRecorder::enabled (0);
+
+void TraceRecorder::setEnabled (bool shouldBeEnabled)
+{
+    if (shouldBeEnabled && ! isEnabled())
+    {
+        Registry& registry = getRegistry();
+        const ScopedLock sl (registry.lock);
+
+        // the spans are left to be overwritten, rather than cleared under their writers
+        for (int i = 0; i < registry.rings.size(); ++i)
+            registry.rings[i]->exportFrom = registry.rings[i]->written.load (std::memory_order_acquire);
+    }
+
+    enabled.store (shouldBeEnabled ? 1 : 0);
+}
+
+void TraceRecorder::addSpan (const char* name, int64 startTicks, int64 endTicks, const char* threadName)
+{
+    Ring* ring = getCurrentRing (threadName);
+
+    if (ring == nullptr)
+        return;
+
+    // single writer: the span is written before the count that publishes it
+    const int64 index = ring->written.load (std::memory_order_relaxed);
+    Span& span = ring->spans[index & (ringSize - 1)];
+    span.name = name;
+    span.startTicks = startTicks;
+    span.endTicks = endTicks;
+    ring->written.store (index + 1, std::memory_order_release);
+}
+
+const char* TraceRecorder::internName (const String& name)
+{
+    Registry& registry = getRegistry();
+    const ScopedLock sl (registry.lock);
+
+    return registry.names.getPooledString (name).getCharPointer().getAddress();
+}
+
+String TraceRecorder::exportChromeTrace (const File& file)
+{
+    Registry& registry = getRegistry();
+    const double microsecondsPerTick = 1.0e6 / (double) Time::getHighResolutionTicksPerSecond();
+
+    Array<var> events;
+    int64 firstTicks = std::numeric_limits<int64>::max();
+
+    struct ThreadSpans
+    {
+        String name;
+        Array<Span> spans;
+    };
+    OwnedArray<ThreadSpans> threads;
+
+    {
+        const ScopedLock sl (registry.lock);
+
+        for (int i = 0; i < registry.rings.size(); ++i)
+        {
+            Ring* ring = registry.rings[i];
+            ScopedPointer<ThreadSpans> thread = new ThreadSpans();
+            thread->name = ring->threadName;
+
+            const int64 written = ring->written.load (std::memory_order_acquire);
+            const int64 first = jmax (ring->exportFrom, written - ringSize);
+
+            for (int64 s = first; s < written; ++s)
+                thread->spans.add (ring->spans[s & (ringSize - 1)]);
+
+            // the spans the writer may have overwritten while they were copied are dropped
+            const int64 overwritten = ring->written.load (std::memory_order_acquire) - ringSize - first;
+
+            if (overwritten > 0)
+                thread->spans.removeRange (0, (int) overwritten);
+
+            for (int s = 0; s < thread->spans.size(); ++s)
+                firstTicks = jmin (firstTicks, thread->spans.getReference (s).startTicks);
+
+            if (thread->spans.size() > 0)
+                threads.add (thread.release());
+        }
+    }
+
+    int numSpans = 0;
+
+    for (int t = 0; t < threads.size(); ++t)
+    {
+        DynamicObject::Ptr threadName = new DynamicObject();
+        threadName->setProperty ("name", "thread_name");
+        threadName->setProperty ("ph", "M");
+        threadName->setProperty ("pid", 1);
+        threadName->setProperty ("tid", t + 1);
+
+        DynamicObject::Ptr args = new DynamicObject();
+        args->setProperty ("name", threads[t]->name);
+        threadName->setProperty ("args", var (args));
+        events.add (var (threadName));
+
+        for (int s = 0; s < threads[t]->spans.size(); ++s)
+        {
+            const Span& span = threads[t]->spans.getReference (s);
+
+            DynamicObject::Ptr event = new DynamicObject();
+            event->setProperty ("name", String (span.name));
+            event->setProperty ("ph", "X");
+            event->setProperty ("pid", 1);
+            event->setProperty ("tid", t + 1);
+            event->setProperty ("ts", (double) (span.startTicks - firstTicks) * microsecondsPerTick);
+            event->setProperty ("dur", (double) (span.endTicks - span.startTicks) * microsecondsPerTick);
+            events.add (var (event));
+            ++numSpans;
+        }
+    }
+
+    DynamicObject::Ptr root = new DynamicObject();
+    root->setProperty ("traceEvents", events);
+    root->setProperty ("displayTimeUnit", "ms");
+
+    if (! file.replaceWithText (JSON::toString (var (root), true)))
+        return "Could not write " + file.getFullPathName();
+
+    return "Saved " + String (numSpans) + " spans of " + String (threads.size()) + " threads to " + file.getFileName();
+}
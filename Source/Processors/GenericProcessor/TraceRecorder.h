@@ -0,0 +1,120 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __TRACERECORDER_H_7D2B5E14__
+#define __TRACERECORDER_H_7D2B5E14__
+
+#include <JuceHeader.h>
+#include "../PluginManager/OpenEphysPlugin.h"
+#include <atomic>
+
+/**
+    Records a timeline of what every thread was doing, to find the cause of a block
+    overrunning when it lies in another thread: a repaint holding a lock, a record engine
+    blocked on the disk, a DataThread stalling.
+
+    Spans are a name, which must outlive the recorder (a literal, or one from internName()),
+    and the high resolution ticks they started and ended at. Each thread writes its spans
+    to a ring of its own, without locking, which is claimed the first time the thread
+    records something and holds its last spans. Nothing is recorded while tracing is
+    disabled, when a span costs an atomic load.
+
+    The rings are exported as Chrome trace JSON, which chrome://tracing and Perfetto open.
+
+    @see ProcessorTimingStats
+*/
+class PLUGIN_API TraceRecorder
+{
+public:
+    /** Starts or stops recording. Starting again clears what was recorded. */
+    static void setEnabled (bool enabled);
+
+    static bool isEnabled() { return enabled.load (std::memory_order_relaxed) != 0; }
+
+    /** Records a span of the current thread. threadName names the thread, the first time it
+        records something, when it is neither a JUCE Thread nor the message thread. */
+    static void addSpan (const char* name, int64 startTicks, int64 endTicks, const char* threadName = nullptr);
+
+    /** Returns a copy of the name that stays valid as long as the application runs */
+    static const char* internName (const String& name);
+
+    /** Writes the spans of every thread to a Chrome trace JSON file, and returns a status message */
+    static String exportChromeTrace (const File& file);
+
+    /** Records the span of a scope */
+    class PLUGIN_API ScopedSpan
+    {
+    public:
+        ScopedSpan (const char* name_)
+            : name (name_), startTicks (TraceRecorder::isEnabled() ? Time::getHighResolutionTicks() : 0) {}
+
+        ~ScopedSpan()
+        {
+            if (startTicks != 0 && TraceRecorder::isEnabled())
+                TraceRecorder::addSpan (name, startTicks, Time::getHighResolutionTicks());
+        }
+
+    private:
+        const char* name;
+        const int64 startTicks;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedSpan);
+    };
+
+    /** A ScopedLock that records the time spent waiting for the lock, when it was held by
+        another thread. An uncontended lock costs a tryEnter(). */
+    template <class LockType>
+    class ScopedTracedLock
+    {
+    public:
+        ScopedTracedLock (const LockType& lock_, const char* name)
+            : lock (lock_)
+        {
+            if (lock.tryEnter())
+                return;
+
+            const int64 startTicks = Time::getHighResolutionTicks();
+            lock.enter();
+
+            if (TraceRecorder::isEnabled())
+                TraceRecorder::addSpan (name, startTicks, Time::getHighResolutionTicks());
+        }
+
+        ~ScopedTracedLock() { lock.exit(); }
+
+    private:
+        const LockType& lock;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedTracedLock);
+    };
+
+private:
+    TraceRecorder() = delete;
+
+    static std::atomic<int> enabled;
+};
+
+#define TRACE_SCOPE(name) const TraceRecorder::ScopedSpan JUCE_JOIN_MACRO (traceSpan, __LINE__) (name)
+
+
+#endif  // __TRACERECORDER_H_7D2B5E14__
@@ -32,6 +32,7 @@ Merger::Merger()
     : GenericProcessor("Merger"),
       mergeEventsA(true), mergeContinuousA(true),
       mergeEventsB(true), mergeContinuousB(true),
+      alignSources(false),
       sourceNodeA(0), sourceNodeB(0), activePath(0)
 {
     setProcessorType(PROCESSOR_TYPE_MERGER);
@@ -238,6 +239,11 @@ void Merger::updateSettings()
 
 }
 
+bool Merger::isAligningSources() const
+{
+    return alignSources;
+}
+
 void Merger::saveCustomParametersToXml(XmlElement* parentElement)
 {
     XmlElement* mainNode = parentElement->createNewChildElement("MERGER");
@@ -255,6 +261,7 @@ void Merger::saveCustomParametersToXml(XmlElement* parentElement)
     mainNode->setAttribute("MergeContinuousA", mergeContinuousA);
     mainNode->setAttribute("MergeEventsB", mergeEventsB);
     mainNode->setAttribute("MergeContinuousB", mergeContinuousB);
+    mainNode->setAttribute("AlignSources", alignSources);
 }
 
 
@@ -294,6 +301,7 @@ void Merger::loadCustomParametersFromXml()
                     mergeEventsB = mainNode->getBoolAttribute("MergeEventsB");
                     mergeContinuousA = mainNode->getBoolAttribute("MergeContinuousA");
                     mergeContinuousB = mainNode->getBoolAttribute("MergeContinuousB");
+                    alignSources = mainNode->getBoolAttribute("AlignSources", false);
 
                     updateSettings();
                 }
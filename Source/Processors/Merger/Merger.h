@@ -38,6 +38,9 @@
   it has no incoming or outgoing connections. It just allows the outputs from
   TWO source nodes to be connected to ONE destination.
 
+  When set to align its sources, the processor after it buffers the blocks of each
+  source so that they only reach process() once they cover the same span of time.
+
   @see GenericProcessor, ProcessorGraph
 
 */
@@ -74,8 +77,13 @@ public:
     bool sendContinuousForSource(GenericProcessor* sn);
     bool sendEventsForSource(GenericProcessor* sn);
 
+    bool isAligningSources() const override;
+
     bool mergeEventsA, mergeContinuousA, mergeEventsB, mergeContinuousB;
 
+    /** Makes the processor after the merger wait for both sources, see SourceAligner */
+    bool alignSources;
+
 private:
 
     GenericProcessor* sourceNodeA;
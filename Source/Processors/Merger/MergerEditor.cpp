@@ -157,6 +157,7 @@ void MergerEditor::mouseDown(const MouseEvent& e)
 
         int eventMerge = ++i;
         int continuousMerge = ++i;
+        int alignSources = ++i;
 
         bool* eventPtr;
         bool* continuousPtr;
@@ -172,6 +173,8 @@ void MergerEditor::mouseDown(const MouseEvent& e)
         
         m.addItem(eventMerge, "Events", !acquisitionIsActive, *eventPtr);
         m.addItem(continuousMerge, "Continuous", !acquisitionIsActive, *continuousPtr);
+        m.addSeparator();
+        m.addItem(alignSources, "Align sources in time", !acquisitionIsActive, merger->alignSources);
 
         const int result = m.show();
 
@@ -194,6 +197,10 @@ void MergerEditor::mouseDown(const MouseEvent& e)
         } else if (result == continuousMerge)
         {
             *continuousPtr = !(*continuousPtr);
+        } else if (result == alignSources)
+        {
+            merger->alignSources = !merger->alignSources;
+            CoreServices::updateSignalChain(this);
         }
     }
 
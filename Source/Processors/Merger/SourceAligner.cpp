@@ -0,0 +1,255 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "SourceAligner.h"
+#include "../ProcessorGraph/ClockSynchronizer.h"
+#include "../GenericProcessor/MemoryFootprint.h"
+
+
+SourceAligner::SourceAligner()
+    : capacity          (0)
+    , clockSynchronizer (nullptr)
+{
+}
+
+
+SourceAligner::~SourceAligner()
+{
+}
+
+
+bool SourceAligner::prepare (const Array<int>& channelSlots, const Array<uint32>& sourceIds,
+                             const Array<float>& channelSampleRates)
+{
+    sources.clear();
+    slotSources.clearQuick();
+    slotSources.insertMultiple (0, -1, sourceIds.size());
+
+    float sampleRate = 0.0f;
+    bool sameRates = true;
+
+    for (int chan = 0; chan < channelSlots.size(); ++chan)
+    {
+        const int slot = channelSlots[chan];
+
+        if (! isPositiveAndBelow (slot, sourceIds.size()))
+            continue;
+
+        if (slotSources[slot] < 0)
+        {
+            Source* source = new Source();
+            source->slot = slot;
+            source->sourceID = sourceIds[slot];
+
+            slotSources.set (slot, sources.size());
+            sources.add (source);
+        }
+
+        sources[slotSources[slot]]->channels.add (chan);
+
+        if (sampleRate == 0.0f)
+            sampleRate = channelSampleRates[chan];
+        else if (channelSampleRates[chan] != sampleRate)
+            sameRates = false;
+    }
+
+    if (sources.size() < 2 || ! sameRates || sampleRate <= 0.0f)
+    {
+        sources.clear();
+        slotSources.clearQuick();
+        rings.setSize (0, 0);
+        capacity = 0;
+
+        return false;
+    }
+
+    capacity = jmax (1, (int) (sampleRate * SOURCE_ALIGNER_MAX_DELAY_MS / 1000.0f));
+    rings.setSize (channelSlots.size(), capacity);
+
+    reset();
+
+    return true;
+}
+
+
+void SourceAligner::setClockSynchronizer (const ClockSynchronizer* synchronizer)
+{
+    clockSynchronizer = synchronizer;
+}
+
+
+void SourceAligner::reset()
+{
+    for (int i = 0; i < sources.size(); ++i)
+    {
+        Source& source = *sources[i];
+
+        source.origin = -1;
+        source.firstTimestamp = 0;
+        source.start = 0;
+        source.count = 0;
+    }
+}
+
+
+bool SourceAligner::isAlignedSlot (int slot) const
+{
+    return isPositiveAndBelow (slot, slotSources.size()) && slotSources.getUnchecked (slot) >= 0;
+}
+
+
+int64 SourceAligner::getMemoryFootprint() const
+{
+    return MemoryFootprint::ofBuffer (rings);
+}
+
+
+void SourceAligner::startBlock (Array<uint32>& slotNumSamples) const
+{
+    for (int i = 0; i < sources.size(); ++i)
+        slotNumSamples.setUnchecked (sources.getUnchecked (i)->slot, 0);
+}
+
+
+void SourceAligner::process (AudioSampleBuffer& buffer, Array<uint32>& slotNumSamples, Array<int64>& slotTimestamps)
+{
+    bool synchronized = clockSynchronizer != nullptr;
+    bool ready = true;
+
+    for (int i = 0; i < sources.size(); ++i)
+    {
+        Source& source = *sources.getUnchecked (i);
+
+        append (source, buffer, (int) slotNumSamples.getUnchecked (source.slot), slotTimestamps.getUnchecked (source.slot));
+
+        if (source.count == 0)
+            ready = false;
+        else if (synchronized && getTime (source, true) < 0)
+            synchronized = false;
+    }
+
+    int numReleased = 0;
+
+    if (ready)
+    {
+        int64 commonStart = getTime (*sources.getUnchecked (0), synchronized);
+
+        for (int i = 1; i < sources.size(); ++i)
+            commonStart = jmax (commonStart, getTime (*sources.getUnchecked (i), synchronized));
+
+        numReleased = buffer.getNumSamples();
+
+        for (int i = 0; i < sources.size(); ++i)
+        {
+            Source& source = *sources.getUnchecked (i);
+
+            drop (source, (int) jlimit<int64> (0, source.count, commonStart - getTime (source, synchronized)));
+            numReleased = jmin (numReleased, source.count);
+        }
+    }
+
+    for (int i = 0; i < sources.size(); ++i)
+    {
+        Source& source = *sources.getUnchecked (i);
+        const int toEnd = jmin (numReleased, capacity - source.start);
+
+        for (int c = 0; c < source.channels.size(); ++c)
+        {
+            const int chan = source.channels.getUnchecked (c);
+            const float* ring = rings.getReadPointer (chan);
+
+            buffer.copyFrom (chan, 0, ring + source.start, toEnd);
+            buffer.copyFrom (chan, toEnd, ring, numReleased - toEnd);
+        }
+
+        slotNumSamples.setUnchecked (source.slot, (uint32) numReleased);
+        slotTimestamps.setUnchecked (source.slot, source.firstTimestamp);
+
+        drop (source, numReleased);
+    }
+}
+
+
+void SourceAligner::append (Source& source, const AudioSampleBuffer& buffer, int numSamples, int64 timestamp)
+{
+    if (numSamples <= 0)
+        return;
+
+    if (source.origin < 0)
+        source.origin = timestamp;
+
+    // samples were lost, what is held can't be followed by this block
+    if (source.count > 0 && timestamp != source.firstTimestamp + source.count)
+        source.count = 0;
+
+    // only the most recent samples fit
+    const int skipped = jmax (0, numSamples - capacity);
+
+    if (source.count == 0 || skipped > 0)
+    {
+        source.start = 0;
+        source.count = 0;
+        source.firstTimestamp = timestamp + skipped;
+    }
+    else
+    {
+        drop (source, source.count + numSamples - capacity);
+    }
+
+    const int n = numSamples - skipped;
+    const int index = (source.start + source.count) % capacity;
+    const int toEnd = jmin (n, capacity - index);
+
+    for (int c = 0; c < source.channels.size(); ++c)
+    {
+        const int chan = source.channels.getUnchecked (c);
+        const float* samples = buffer.getReadPointer (chan, skipped);
+
+        rings.copyFrom (chan, index, samples, toEnd);
+        rings.copyFrom (chan, 0, samples + toEnd, n - toEnd);
+    }
+
+    source.count += n;
+}
+
+
+void SourceAligner::drop (Source& source, int numSamples)
+{
+    numSamples = jmin (numSamples, source.count);
+
+    if (numSamples <= 0)
+        return;
+
+    source.start = (source.start + numSamples) % capacity;
+    source.count -= numSamples;
+    source.firstTimestamp += numSamples;
+}
+
+
+int64 SourceAligner::getTime (const Source& source, bool synchronized) const
+{
+    if (synchronized)
+        return clockSynchronizer->getGlobalTimestamp (source.sourceID, source.firstTimestamp);
+
+    return source.firstTimestamp - source.origin;
+}
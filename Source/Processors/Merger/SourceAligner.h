@@ -0,0 +1,123 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __SOURCEALIGNER_H_3F8C21D4__
+#define __SOURCEALIGNER_H_3F8C21D4__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "../PluginManager/OpenEphysPlugin.h"
+
+class ClockSynchronizer;
+
+/** The longest a source's samples are held back waiting for the other sources, in milliseconds */
+#define SOURCE_ALIGNER_MAX_DELAY_MS 250
+
+/**
+
+  Turns the ragged blocks of several sources into blocks of the same length covering the
+  same span of time, for the processor after a Merger set to align its sources.
+
+  Each source gets a jitter buffer per data channel, to which every block it delivers is
+  appended. Once all sources have samples, the ones before the latest of their first
+  samples are dropped and as many samples as every source has are released, so that the
+  block handed to process() starts at the same time and has the same length on every
+  channel. Times are those of the ClockSynchronizer while every source is synchronized,
+  and otherwise the samples counted since each source's first block.
+
+  A gap in a source's timestamps restarts its buffer, and samples held for longer than
+  SOURCE_ALIGNER_MAX_DELAY_MS are dropped when a source stops delivering. Events go
+  through unchanged, so their sample positions refer to the blocks as they arrived.
+
+  Only used from the processing thread during acquisition.
+
+  @see Merger, GenericProcessor
+
+*/
+
+class PLUGIN_API SourceAligner
+{
+public:
+    SourceAligner();
+    ~SourceAligner();
+
+    /** Creates the jitter buffers of the sources with data channels, given the slot of
+        each data channel and the ID of each slot. Returns false, leaving nothing to
+        align, unless there are at least two such sources and they share a sample rate. */
+    bool prepare (const Array<int>& channelSlots, const Array<uint32>& sourceIds,
+                  const Array<float>& channelSampleRates);
+
+    /** Maps timestamps through a clock synchronizer, or compares them by sample counts if null */
+    void setClockSynchronizer (const ClockSynchronizer* synchronizer);
+
+    /** Empties the buffers, to be called before acquisition starts */
+    void reset();
+
+    /** Zeroes the counts of the aligned slots before the events of a block are read, so
+        that a source without a TIMESTAMP_AND_SAMPLES event in the block delivered nothing */
+    void startBlock (Array<uint32>& slotNumSamples) const;
+
+    /** Buffers the block just received, then replaces it with the aligned samples,
+        updating the count and timestamp of every aligned slot */
+    void process (AudioSampleBuffer& buffer, Array<uint32>& slotNumSamples, Array<int64>& slotTimestamps);
+
+    /** Returns true if the counts and timestamps of a slot are rewritten by process() */
+    bool isAlignedSlot (int slot) const;
+
+    /** The bytes of the jitter buffers */
+    int64 getMemoryFootprint() const;
+
+private:
+    struct Source
+    {
+        int slot;
+        uint32 sourceID;
+        Array<int> channels;
+
+        /** Timestamp of the first block since reset(), the origin of unsynchronized times */
+        int64 origin;
+        /** Timestamp of the oldest sample held */
+        int64 firstTimestamp;
+        /** Ring index of the oldest sample held, and number of samples held */
+        int start;
+        int count;
+    };
+
+    void append (Source& source, const AudioSampleBuffer& buffer, int numSamples, int64 timestamp);
+    void drop (Source& source, int numSamples);
+
+    /** Time of a source's oldest sample held, or -1 if it can't be mapped */
+    int64 getTime (const Source& source, bool synchronized) const;
+
+    OwnedArray<Source> sources;
+    Array<int> slotSources;     // index in sources of each slot, or -1
+
+    AudioSampleBuffer rings;    // one per data channel
+    int capacity;
+
+    const ClockSynchronizer* clockSynchronizer;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SourceAligner);
+};
+
+
+#endif  // __SOURCEALIGNER_H_3F8C21D4__
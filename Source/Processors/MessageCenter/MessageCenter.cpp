@@ -1,120 +1,129 @@
-/*
-    ------------------------------------------------------------------
-
-    This file is part of the Open Ephys GUI
-    Copyright (C) 2014 Open Ephys
-
-    ------------------------------------------------------------------
-
-    This program is free software: you can redistribute it and/or modify
-    it under the terms of the GNU General Public License as published by
-    the Free Software Foundation, either version 3 of the License, or
-    (at your option) any later version.
-
-    This program is distributed in the hope that it will be useful,
-    but WITHOUT ANY WARRANTY; without even the implied warranty of
-    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
-    GNU General Public License for more details.
-
-    You should have received a copy of the GNU General Public License
-    along with this program.  If not, see <http://www.gnu.org/licenses/>.
-
-*/
-
-#include "MessageCenter.h"
-#include "MessageCenterEditor.h"
-#include "../ProcessorGraph/ProcessorGraph.h"
-#include "../../AccessClass.h"
-#define MAX_MSG_LENGTH 512
-//---------------------------------------------------------------------
-
-MessageCenter::MessageCenter() :
-GenericProcessor("Message Center"), newEventAvailable(false), isRecording(false)
-{
-
-    setPlayConfigDetails(0, // number of inputs
-                         0, // number of outputs
-                         44100.0, // sampleRate
-                         128);    // blockSize
-}
-
-MessageCenter::~MessageCenter()
-{
-
-}
-
-void MessageCenter::addSpecialProcessorChannels(Array<EventChannel*>& channels) 
-{
-	EventChannel* chan = new EventChannel(EventChannel::TEXT, 1, MAX_MSG_LENGTH, CoreServices::getGlobalSampleRate(), this, 0);
-	chan->setName("GUI Messages");
-	chan->setDescription("Messages from the GUI Message Center");
-	channels.add(chan);
-	eventChannelArray.add(new EventChannel(*chan));
-	updateChannelIndexes();
-}
-
-AudioProcessorEditor* MessageCenter::createEditor()
-{
-
-    messageCenterEditor = new MessageCenterEditor(this);
-
-    return messageCenterEditor;
-
-}
-
-void MessageCenter::setParameter(int parameterIndex, float newValue)
-{
-    if (isRecording)
-    {
-        newEventAvailable = true;
-        messageCenterEditor->messageReceived(true);
-    }
-    else
-    {
-        messageCenterEditor->messageReceived(false);
-    }
-
-}
-
-bool MessageCenter::enable()
-{
-    messageCenterEditor->startAcquisition();
-    return true;
-}
-
-bool MessageCenter::disable()
-{
-    messageCenterEditor->stopAcquisition();
-    return true;
-}
-
-
-void MessageCenter::process(AudioSampleBuffer& buffer)
-{
-    if (needsToSendTimestampMessage)
-    {
-		MidiBuffer& eventBuffer = *AccessClass::ExternalProcessorAccessor::getMidiBuffer(this);
-		HeapBlock<char> data;
-		size_t dataSize = SystemEvent::fillTimestampSyncTextData(data, this, 0, CoreServices::getGlobalTimestamp(), true);
-
-		eventBuffer.addEvent(data, dataSize, 0);
-
-        needsToSendTimestampMessage = false;
-    }
-
-    if (newEventAvailable)
-    {
-        //int numBytes = 0;
-
-        String eventString = messageCenterEditor->getLabelString();
-
-		eventString = eventString.dropLastCharacters(eventString.length() - MAX_MSG_LENGTH);
-
-		TextEventPtr event = TextEvent::createTextEvent(getEventChannel(0), CoreServices::getGlobalTimestamp(), eventString);
-		addEvent(getEventChannel(0), event, 0);
-
-        newEventAvailable = false;
-    }
-
-
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "MessageCenter.h"
+#include "MessageCenterEditor.h"
+#include "../ProcessorGraph/ProcessorGraph.h"
+#include "../../AccessClass.h"
+#define MAX_MSG_LENGTH 512
+//---------------------------------------------------------------------
+
+MessageCenter::MessageCenter() :
+GenericProcessor("Message Center"), isRecording(false), needsToSendTimestampMessage(false)
+{
+    // room for the messages of a few blocks, so that the processing thread never frees the array
+    loggedMessages.ensureStorageAllocated(32);
+
+    setPlayConfigDetails(0, // number of inputs
+                         0, // number of outputs
+                         44100.0, // sampleRate
+                         128);    // blockSize
+}
+
+MessageCenter::~MessageCenter()
+{
+
+}
+
+void MessageCenter::addSpecialProcessorChannels(Array<EventChannel*>& channels) 
+{
+	EventChannel* chan = new EventChannel(EventChannel::TEXT, 1, MAX_MSG_LENGTH, CoreServices::getGlobalSampleRate(), this, 0);
+	chan->setName("GUI Messages");
+	chan->setDescription("Messages from the GUI Message Center");
+	channels.add(chan);
+	eventChannelArray.add(new EventChannel(*chan));
+	updateChannelIndexes();
+}
+
+AudioProcessorEditor* MessageCenter::createEditor()
+{
+
+    messageCenterEditor = new MessageCenterEditor(this);
+
+    return messageCenterEditor;
+
+}
+
+void MessageCenter::setParameter(int parameterIndex, float newValue)
+{
+    if (isRecording)
+    {
+        // the text is taken here, on the message thread, rather than by process()
+        logMessage(messageCenterEditor->getLabelString());
+        messageCenterEditor->messageReceived(true);
+    }
+    else
+    {
+        messageCenterEditor->messageReceived(false);
+    }
+
+}
+
+bool MessageCenter::enable()
+{
+    messageCenterEditor->startAcquisition();
+    return true;
+}
+
+bool MessageCenter::disable()
+{
+    messageCenterEditor->stopAcquisition();
+    return true;
+}
+
+
+void MessageCenter::logMessage(const String& message)
+{
+    if (!isRecording)
+        return;
+
+    const SpinLock::ScopedLockType lock(loggedMessagesLock);
+    loggedMessages.add(message);
+}
+
+void MessageCenter::process(AudioSampleBuffer& buffer)
+{
+    if (needsToSendTimestampMessage)
+    {
+		MidiBuffer& eventBuffer = *AccessClass::ExternalProcessorAccessor::getMidiBuffer(this);
+		char data[SystemEvent::MAX_SYNC_TEXT_SIZE];
+		size_t dataSize = SystemEvent::fillTimestampSyncTextData(data, sizeof(data), this, 0, CoreServices::getGlobalTimestamp(), true);
+
+		eventBuffer.addEvent(data, (int) dataSize, 0);
+
+        needsToSendTimestampMessage = false;
+    }
+
+    // messages logged while the lock is held are written in the next block
+    if (loggedMessagesLock.tryEnter())
+    {
+        // serialized straight from the strings, longer messages being cut to the channel's size
+        for (int i = 0; i < loggedMessages.size(); i++)
+            addTextEvent(getEventChannel(0), CoreServices::getGlobalTimestamp(), loggedMessages[i].toRawUTF8(), 0);
+
+        loggedMessages.clearQuick();
+        loggedMessagesLock.exit();
+    }
+
+
 }
\ No newline at end of file
@@ -48,30 +48,11 @@ void PluginClass::setPluginData(Plugin::PluginType type, int index)
     switch (type)
     {
         case Plugin::PLUGIN_TYPE_PROCESSOR:
-        {
-            Plugin::ProcessorInfo i = pm->getProcessorInfo(index);
-            name = i.name;
-            break;
-        }
-
         case Plugin::PLUGIN_TYPE_RECORD_ENGINE:
-        {
-            Plugin::RecordEngineInfo i = pm->getRecordEngineInfo(index);
-            name = i.name;
-            break;
-        }
-
         case Plugin::PLUGIN_TYPE_DATA_THREAD:
-        {
-            Plugin::DataThreadInfo i = pm->getDataThreadInfo(index);
-            name = i.name;
-            break;
-        }
-
         case Plugin::PLUGIN_TYPE_FILE_SOURCE:
         {
-            Plugin::FileSourceInfo i = pm->getFileSourceInfo(index);
-            name = i.name;
+            name = pm->getPluginName(type, index);
             break;
         }
 
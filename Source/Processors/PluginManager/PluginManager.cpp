@@ -70,76 +70,16 @@ static void errorMsg(const char *file, int line, const char *msg) {
 #define ERROR_MSG(msg) errorMsg(__FILE__, __LINE__, msg)
 
 
-PluginManager::PluginManager()
-{
-}
+#define PLUGIN_SCAN_MAX_THREADS 8
 
-PluginManager::~PluginManager()
-{
-}
-
-
-void PluginManager::loadAllPlugins()
-{
-    Array<File> paths;
-    
-#ifdef __APPLE__
-    paths.add(File::getSpecialLocation(File::currentApplicationFile).getChildFile("Contents/PlugIns"));
-    paths.add(File::getSpecialLocation(File::userApplicationDataDirectory).getChildFile("Application Support/open-ephys/PlugIns"));
-#else
-	paths.add(File::getSpecialLocation(File::currentApplicationFile).getParentDirectory().getChildFile("plugins"));
-#endif
-
-    for (auto &pluginPath : paths) {
-        if (!pluginPath.isDirectory()) {
-            std::cout << "Plugin path not found: " << pluginPath.getFullPathName() << std::endl;
-        } else {
-            loadPlugins(pluginPath);
-        }
-    }
-}
-
-void PluginManager::loadPlugins(const File &pluginPath) {
-    Array<File> foundDLLs;
-    
-#ifdef WIN32
-    String pluginExt("*.dll");
-#elif defined(__APPLE__)
-    String pluginExt("*.bundle");
-#else
-    String pluginExt("*.so");
-#endif
-    
-#ifdef __APPLE__
-    pluginPath.findChildFiles(foundDLLs, File::findDirectories, false, pluginExt);
-#else
-	pluginPath.findChildFiles(foundDLLs, File::findFiles, true, pluginExt);
-#endif
-
-	for (int i = 0; i < foundDLLs.size(); i++)
-	{
-		std::cout << "Loading Plugin: " << foundDLLs[i].getFileNameWithoutExtension() << "... " << std::flush;
-		int res = loadPlugin(foundDLLs[i].getFullPathName());
-		if (res < 0)
-		{
-			std::cout << " DLL Load FAILED" << std::endl;
-		}
-		else
-		{
-			std::cout << "Loaded with " << res << " plugins" << std::endl;
-		}
-	}
-}
 
 /*
-	 Takes the user-specified plugin and begins
-	 dynamic loading process. We want to ensure that
-	 no step is exectured without a checkpoint
-	 because dynamic loading calls for rellocation of RAM
-	 and works inside the same POSIX thread as the GUI.
+	Loads a library and checks that it is a plugin library of the current
+	API version. Only touches its own arguments, so that several libraries
+	can be opened at the same time.
  */
-
-int PluginManager::loadPlugin(const String& pluginLoc) {
+static bool openLibrary(const String& pluginLoc, decltype(LoadedLibInfo::handle)& handle, Plugin::LibraryInfo& libInfo, Array<Plugin::PluginInfo>& plugins)
+{
 	/*
 	Load in the selected processor. This takes the
 	dynamic object (.so) and copies it into RAM
@@ -149,7 +89,6 @@ int PluginManager::loadPlugin(const String& pluginLoc) {
 	const char* processorLocCString = static_cast<const char*>(pluginLoc.toUTF8());
 
 #ifdef WIN32
-	HINSTANCE handle;
 	handle = LoadLibrary(processorLocCString);
 #elif defined(__APPLE__)
     CFURLRef bundleURL = CFURLCreateFromFileSystemRepresentation(kCFAllocatorDefault,
@@ -157,7 +96,7 @@ int PluginManager::loadPlugin(const String& pluginLoc) {
                                                                  strlen(processorLocCString),
                                                                  true);
     assert(bundleURL);
-    CFBundleRef handle = CFBundleCreate(kCFAllocatorDefault, bundleURL);
+    handle = CFBundleCreate(kCFAllocatorDefault, bundleURL);
     CFRelease(bundleURL);
 #else
 	// Clear errors
@@ -169,14 +108,12 @@ int PluginManager::loadPlugin(const String& pluginLoc) {
 	processor stability and to ensure that it doesn't crash due
 	to memory mishaps.
 	*/
-	void *handle = 0;
 	handle = dlopen(processorLocCString,RTLD_GLOBAL|RTLD_NOW);
 #endif
 
 	if (!handle) {
 		ERROR_MSG("Failed to load plugin DLL");
-		closeHandle(handle);
-		return -1;
+		return false;
 	}
 
 	LibraryInfoFunction infoFunction = 0;
@@ -193,17 +130,18 @@ int PluginManager::loadPlugin(const String& pluginLoc) {
 	{
 		ERROR_MSG("Failed to load function 'getLibInfo'");
 		closeHandle(handle);
-		return -1;
+		handle = 0;
+		return false;
 	}
 
-	Plugin::LibraryInfo libInfo;
 	infoFunction(&libInfo);
 
 	if (libInfo.apiVersion != PLUGIN_API_VER)
 	{
 		std::cerr << pluginLoc << " invalid version" << std::endl;
 		closeHandle(handle);
-		return -1;
+		handle = 0;
+		return false;
 	}
 
 	PluginInfoFunction piFunction = 0;
@@ -220,73 +158,517 @@ int PluginManager::loadPlugin(const String& pluginLoc) {
 	{
         ERROR_MSG("Failed to load function 'getPluginInfo'");
 		closeHandle(handle);
-		return -1;
+		handle = 0;
+		return false;
+	}
+
+	Plugin::PluginInfo pInfo;
+	for (int i = 0; i < libInfo.numPlugins; i++)
+	{
+		if (piFunction(i, &pInfo)) //if somehow there are less plugins than stated, stop adding
+			break;
+		plugins.add(pInfo);
+	}
+	return true;
+}
+
+
+/*
+	The manifest entry is only trusted if the library file has not
+	changed since, going by its modification time and size.
+ */
+static XmlElement* findManifestEntry(XmlElement* manifest, const File& file, bool mustBeCurrent)
+{
+	const String path = file.getFullPathName();
+
+	forEachXmlChildElementWithTagName(*manifest, entry, "LIBRARY")
+	{
+		if (entry->getStringAttribute("path") != path)
+			continue;
+
+		if (!mustBeCurrent)
+			return entry;
+
+		if (entry->getStringAttribute("modified").getLargeIntValue() == file.getLastModificationTime().toMilliseconds()
+			&& entry->getStringAttribute("size").getLargeIntValue() == file.getSize())
+			return entry;
+
+		return nullptr;
+	}
+	return nullptr;
+}
+
+
+template<class T>
+static void resolveCreators(Array<LoadedPluginInfo<T>>& pluginArray, int libIndex, const Array<Plugin::PluginInfo>& plugins,
+	Plugin::PluginType type, T Plugin::PluginInfo::* member)
+{
+	for (int i = 0; i < pluginArray.size(); i++)
+	{
+		LoadedPluginInfo<T>& info = pluginArray.getReference(i);
+
+		if (info.libIndex != libIndex || !isPositiveAndBelow(info.libPluginIndex, plugins.size()))
+			continue;
+
+		const Plugin::PluginInfo& pInfo = plugins.getReference(info.libPluginIndex);
+		if (pInfo.type == type)
+			info.creator = (pInfo.*member).creator;
+	}
+}
+
+
+/**
+	Opens one library and reads the descriptions of its plugins.
+	The libraries that are not in the manifest are scanned in parallel.
+ */
+class PluginScanJob : public ThreadPoolJob
+{
+public:
+	PluginScanJob(const File& file_)
+		: ThreadPoolJob("Plugin scan: " + file_.getFileNameWithoutExtension())
+		, file(file_)
+		, handle(0)
+		, loaded(false)
+	{
+	}
+
+	JobStatus runJob() override
+	{
+		loaded = openLibrary(file.getFullPathName(), handle, libInfo, plugins);
+		return jobHasFinished;
+	}
+
+	XmlElement* createManifestEntry() const
+	{
+		XmlElement* entry = new XmlElement("LIBRARY");
+		entry->setAttribute("path", file.getFullPathName());
+		entry->setAttribute("modified", String(file.getLastModificationTime().toMilliseconds()));
+		entry->setAttribute("size", String(file.getSize()));
+		entry->setAttribute("name", libInfo.name);
+		entry->setAttribute("version", libInfo.libVersion);
+		entry->setAttribute("numPlugins", libInfo.numPlugins);
+
+		for (int i = 0; i < plugins.size(); i++)
+		{
+			const Plugin::PluginInfo& pInfo = plugins.getReference(i);
+			XmlElement* plugin = entry->createNewChildElement("PLUGIN");
+			plugin->setAttribute("index", i);
+			plugin->setAttribute("type", pInfo.type);
+
+			switch (pInfo.type)
+			{
+			case Plugin::PLUGIN_TYPE_PROCESSOR:
+				plugin->setAttribute("name", pInfo.processor.name);
+				plugin->setAttribute("processorType", pInfo.processor.type);
+				break;
+			case Plugin::PLUGIN_TYPE_RECORD_ENGINE:
+				plugin->setAttribute("name", pInfo.recordEngine.name);
+				break;
+			case Plugin::PLUGIN_TYPE_DATA_THREAD:
+				plugin->setAttribute("name", pInfo.dataThread.name);
+				break;
+			case Plugin::PLUGIN_TYPE_FILE_SOURCE:
+				plugin->setAttribute("name", pInfo.fileSource.name);
+				plugin->setAttribute("extensions", pInfo.fileSource.extensions);
+				break;
+			default:
+				break;
+			}
+		}
+		return entry;
+	}
+
+	File file;
+	decltype(LoadedLibInfo::handle) handle;
+	Plugin::LibraryInfo libInfo;
+	Array<Plugin::PluginInfo> plugins;
+	bool loaded;
+};
+
+
+/**
+	Shown before the main window appears while the plugin libraries
+	missing from the manifest are scanned.
+ */
+class PluginScanWindow : public ThreadWithProgressWindow
+{
+public:
+	PluginScanWindow(OwnedArray<PluginScanJob>& scans_)
+		: ThreadWithProgressWindow("Open Ephys", true, false)
+		, scans(scans_)
+	{
+		setStatusMessage("Loading " + String(scans.size()) + " new or updated plugin libraries...");
+	}
+
+	void run() override
+	{
+		ThreadPool pool(jlimit(1, PLUGIN_SCAN_MAX_THREADS, SystemStats::getNumCpus()));
+
+		for (int i = 0; i < scans.size(); i++)
+			pool.addJob(scans[i], false);
+
+		while (pool.getNumJobs() > 0)
+		{
+			setProgress(double(scans.size() - pool.getNumJobs()) / scans.size());
+			wait(20);
+		}
+		setProgress(1.0);
+	}
+
+private:
+	OwnedArray<PluginScanJob>& scans;
+};
+
+
+PluginManager::PluginManager()
+{
+}
+
+PluginManager::~PluginManager()
+{
+}
+
+
+void PluginManager::loadAllPlugins()
+{
+    Array<File> paths;
+    
+#ifdef __APPLE__
+    paths.add(File::getSpecialLocation(File::currentApplicationFile).getChildFile("Contents/PlugIns"));
+    paths.add(File::getSpecialLocation(File::userApplicationDataDirectory).getChildFile("Application Support/open-ephys/PlugIns"));
+#else
+	paths.add(File::getSpecialLocation(File::currentApplicationFile).getParentDirectory().getChildFile("plugins"));
+#endif
+
+    Array<File> foundDLLs;
+
+    for (auto &pluginPath : paths) {
+        if (!pluginPath.isDirectory()) {
+            std::cout << "Plugin path not found: " << pluginPath.getFullPathName() << std::endl;
+        } else {
+            findPluginFiles(pluginPath, foundDLLs);
+        }
+    }
+
+    // all the paths at once, so that their new libraries are loaded together
+    loadPluginFiles(foundDLLs);
+}
+
+void PluginManager::loadPlugins(const File &pluginPath) {
+    Array<File> foundDLLs;
+    findPluginFiles(pluginPath, foundDLLs);
+    loadPluginFiles(foundDLLs);
+}
+
+void PluginManager::findPluginFiles(const File& pluginPath, Array<File>& foundDLLs) const
+{
+#ifdef WIN32
+    String pluginExt("*.dll");
+#elif defined(__APPLE__)
+    String pluginExt("*.bundle");
+#else
+    String pluginExt("*.so");
+#endif
+    
+#ifdef __APPLE__
+    pluginPath.findChildFiles(foundDLLs, File::findDirectories, false, pluginExt);
+#else
+	pluginPath.findChildFiles(foundDLLs, File::findFiles, true, pluginExt);
+#endif
+}
+
+/*
+	Libraries that have not changed since they were last loaded are
+	registered from the manifest and only loaded when one of their
+	plugins is created. The others have to be loaded now to find out
+	what they contain, which is done on a thread pool while a progress
+	window is shown, as together they can take several seconds.
+ */
+
+void PluginManager::loadPluginFiles(const Array<File>& foundDLLs)
+{
+	loadManifest();
+
+	Array<XmlElement*> cachedEntries;
+	OwnedArray<PluginScanJob> scans;
+
+	for (int i = 0; i < foundDLLs.size(); i++)
+	{
+		XmlElement* entry = findManifestEntry(manifest, foundDLLs[i], true);
+		cachedEntries.add(entry);
+
+		if (entry == nullptr)
+			scans.add(new PluginScanJob(foundDLLs[i]));
+	}
+
+	if (scans.size() > 0)
+	{
+		PluginScanWindow window(scans);
+#if JUCE_MODAL_LOOPS_PERMITTED
+		window.runThread();
+#else
+		window.startThread();
+		window.waitForThreadToExit(-1);
+#endif
 	}
 
+	// registered in the order they were found, whichever way they were loaded
+	int scanIndex = 0;
+
+	for (int i = 0; i < foundDLLs.size(); i++)
+	{
+		std::cout << "Loading Plugin: " << foundDLLs[i].getFileNameWithoutExtension() << "... " << std::flush;
+
+		if (cachedEntries[i] != nullptr)
+		{
+			int res = addCachedLibrary(*cachedEntries[i], foundDLLs[i].getFullPathName());
+			std::cout << "Found in manifest with " << res << " plugins" << std::endl;
+			continue;
+		}
+
+		PluginScanJob* scan = scans[scanIndex++];
+		if (!scan->loaded)
+		{
+			std::cout << " DLL Load FAILED" << std::endl;
+			continue;
+		}
+
+		int res = addLibrary(*scan);
+		std::cout << "Loaded with " << res << " plugins" << std::endl;
+
+		if (XmlElement* stale = findManifestEntry(manifest, scan->file, false))
+			manifest->removeChildElement(stale, true);
+		manifest->addChildElement(scan->createManifestEntry());
+	}
+
+	saveManifest();
+}
+
+/*
+	 Takes the user-specified plugin and begins
+	 dynamic loading process. We want to ensure that
+	 no step is exectured without a checkpoint
+	 because dynamic loading calls for rellocation of RAM
+	 and works inside the same POSIX thread as the GUI.
+ */
+
+int PluginManager::loadPlugin(const String& pluginLoc) {
+	PluginScanJob scan((File(pluginLoc)));
+	scan.runJob();
+
+	if (!scan.loaded)
+		return -1;
+
+	return addLibrary(scan);
+}
+
+int PluginManager::addLibrary(const PluginScanJob& scan)
+{
 	LoadedLibInfo lib;
-	lib.apiVersion = libInfo.apiVersion;
-	lib.name = libInfo.name;
-	lib.libVersion = libInfo.libVersion;
-	lib.numPlugins = libInfo.numPlugins;
-	lib.handle = handle;
+	lib.apiVersion = scan.libInfo.apiVersion;
+	lib.name = scan.libInfo.name;
+	lib.libVersion = scan.libInfo.libVersion;
+	lib.numPlugins = scan.libInfo.numPlugins;
+	lib.handle = scan.handle;
+	lib.path = scan.file.getFullPathName();
 
 	libArray.add(lib);
 
-	Plugin::PluginInfo pInfo;
-	for (int i = 0; i < lib.numPlugins; i++)
+	for (int i = 0; i < scan.plugins.size(); i++)
+		addPlugin(scan.plugins.getReference(i), libArray.size() - 1, i, lib.path);
+
+	return lib.numPlugins;
+}
+
+int PluginManager::addCachedLibrary(const XmlElement& xml, const String& path)
+{
+	LoadedLibInfo lib;
+	lib.apiVersion = PLUGIN_API_VER;
+	lib.name = cacheString(xml.getStringAttribute("name"));
+	lib.libVersion = xml.getIntAttribute("version");
+	lib.numPlugins = xml.getIntAttribute("numPlugins");
+	lib.handle = 0;
+	lib.path = path;
+
+	libArray.add(lib);
+
+	forEachXmlChildElementWithTagName(xml, plugin, "PLUGIN")
 	{
-		if (piFunction(i, &pInfo)) //if somehow there are less plugins than stated, stop adding
-			break;
+		// the creators are filled in by loadLibrary()
+		Plugin::PluginInfo pInfo;
+		pInfo.type = (Plugin::PluginType)plugin->getIntAttribute("type", Plugin::NOT_A_PLUGIN_TYPE);
+		const char* name = cacheString(plugin->getStringAttribute("name"));
+
 		switch (pInfo.type)
 		{
 		case Plugin::PLUGIN_TYPE_PROCESSOR:
-		{
-			LoadedPluginInfo<Plugin::ProcessorInfo> info;
-			info.creator = pInfo.processor.creator;
-			info.name = pInfo.processor.name;
-			info.type = pInfo.processor.type;
-			info.libIndex = libArray.size()-1;
-			processorPlugins.add(info);
+			pInfo.processor.name = name;
+			pInfo.processor.creator = nullptr;
+			pInfo.processor.type = (Plugin::ProcessorType)plugin->getIntAttribute("processorType", Plugin::InvalidProcessor);
 			break;
-		}
 		case Plugin::PLUGIN_TYPE_RECORD_ENGINE:
-		{
-			LoadedPluginInfo<Plugin::RecordEngineInfo> info;
-			info.creator = pInfo.recordEngine.creator;
-			info.name = pInfo.recordEngine.name;
-			info.libIndex = libArray.size();
-			recordEnginePlugins.add(info);
+			pInfo.recordEngine.name = name;
+			pInfo.recordEngine.creator = nullptr;
 			break;
-		}
 		case Plugin::PLUGIN_TYPE_DATA_THREAD:
-		{
-			LoadedPluginInfo<Plugin::DataThreadInfo> info;
-			info.creator = pInfo.dataThread.creator;
-			info.name = pInfo.dataThread.name;
-			info.libIndex = libArray.size();
-			dataThreadPlugins.add(info);
+			pInfo.dataThread.name = name;
+			pInfo.dataThread.creator = nullptr;
 			break;
-		}
 		case Plugin::PLUGIN_TYPE_FILE_SOURCE:
-		{
-			LoadedPluginInfo<Plugin::FileSourceInfo> info;
-			info.creator = pInfo.fileSource.creator;
-			info.name = pInfo.fileSource.name;
-			info.extensions = pInfo.fileSource.extensions;
-			info.libIndex = libArray.size();
-			fileSourcePlugins.add(info);
+			pInfo.fileSource.name = name;
+			pInfo.fileSource.creator = nullptr;
+			pInfo.fileSource.extensions = cacheString(plugin->getStringAttribute("extensions"));
 			break;
-		}
 		default:
-		{
-			std::cerr << pluginLoc << " invalid plugin type: " << pInfo.type << std::endl;
 			break;
 		}
-		}
+
+		addPlugin(pInfo, libArray.size() - 1, plugin->getIntAttribute("index"), path);
 	}
+
 	return lib.numPlugins;
 }
 
+void PluginManager::addPlugin(const Plugin::PluginInfo& pInfo, int libIndex, int libPluginIndex, const String& pluginLoc)
+{
+	switch (pInfo.type)
+	{
+	case Plugin::PLUGIN_TYPE_PROCESSOR:
+	{
+		LoadedPluginInfo<Plugin::ProcessorInfo> info;
+		info.creator = pInfo.processor.creator;
+		info.name = pInfo.processor.name;
+		info.type = pInfo.processor.type;
+		info.libIndex = libIndex;
+		info.libPluginIndex = libPluginIndex;
+		processorPlugins.add(info);
+		break;
+	}
+	case Plugin::PLUGIN_TYPE_RECORD_ENGINE:
+	{
+		LoadedPluginInfo<Plugin::RecordEngineInfo> info;
+		info.creator = pInfo.recordEngine.creator;
+		info.name = pInfo.recordEngine.name;
+		info.libIndex = libIndex;
+		info.libPluginIndex = libPluginIndex;
+		recordEnginePlugins.add(info);
+		break;
+	}
+	case Plugin::PLUGIN_TYPE_DATA_THREAD:
+	{
+		LoadedPluginInfo<Plugin::DataThreadInfo> info;
+		info.creator = pInfo.dataThread.creator;
+		info.name = pInfo.dataThread.name;
+		info.libIndex = libIndex;
+		info.libPluginIndex = libPluginIndex;
+		dataThreadPlugins.add(info);
+		break;
+	}
+	case Plugin::PLUGIN_TYPE_FILE_SOURCE:
+	{
+		LoadedPluginInfo<Plugin::FileSourceInfo> info;
+		info.creator = pInfo.fileSource.creator;
+		info.name = pInfo.fileSource.name;
+		info.extensions = pInfo.fileSource.extensions;
+		info.libIndex = libIndex;
+		info.libPluginIndex = libPluginIndex;
+		fileSourcePlugins.add(info);
+		break;
+	}
+	default:
+	{
+		std::cerr << pluginLoc << " invalid plugin type: " << pInfo.type << std::endl;
+		break;
+	}
+	}
+}
+
+bool PluginManager::loadLibrary(int libIndex)
+{
+	if (libIndex < 0 || libIndex >= libArray.size())
+		return false;
+
+	LoadedLibInfo& lib = libArray.getReference(libIndex);
+	if (lib.handle)
+		return true;
+
+	std::cout << "Loading Plugin: " << File(lib.path).getFileNameWithoutExtension() << "... " << std::flush;
+
+	PluginScanJob scan((File(lib.path)));
+	scan.runJob();
+
+	// the file was checked against the manifest at startup, but could have been replaced since
+	if (!scan.loaded || String(scan.libInfo.name) != String(lib.name) || scan.libInfo.libVersion != lib.libVersion)
+	{
+		std::cout << " DLL Load FAILED" << std::endl;
+		closeHandle(scan.handle);
+		return false;
+	}
+
+	lib.handle = scan.handle;
+
+	resolveCreators(processorPlugins, libIndex, scan.plugins, Plugin::PLUGIN_TYPE_PROCESSOR, &Plugin::PluginInfo::processor);
+	resolveCreators(recordEnginePlugins, libIndex, scan.plugins, Plugin::PLUGIN_TYPE_RECORD_ENGINE, &Plugin::PluginInfo::recordEngine);
+	resolveCreators(dataThreadPlugins, libIndex, scan.plugins, Plugin::PLUGIN_TYPE_DATA_THREAD, &Plugin::PluginInfo::dataThread);
+	resolveCreators(fileSourcePlugins, libIndex, scan.plugins, Plugin::PLUGIN_TYPE_FILE_SOURCE, &Plugin::PluginInfo::fileSource);
+
+	std::cout << "Loaded" << std::endl;
+	return true;
+}
+
+const char* PluginManager::cacheString(const String& s)
+{
+	// the strings keep their text buffers when the array grows
+	cachedStrings.add(s);
+	return cachedStrings[cachedStrings.size() - 1].toRawUTF8();
+}
+
+File PluginManager::getManifestFile()
+{
+#if defined(__APPLE__)
+    File dir = File::getSpecialLocation(File::userApplicationDataDirectory).getChildFile("Application Support/open-ephys");
+    if (!dir.isDirectory()) {
+        dir.createDirectory();
+    }
+    return dir.getChildFile("pluginManifest.xml");
+#else
+    return File::getSpecialLocation(File::currentExecutableFile).getParentDirectory().getChildFile("pluginManifest.xml");
+#endif
+}
+
+void PluginManager::loadManifest()
+{
+	if (manifest != nullptr)
+		return;
+
+	File file = getManifestFile();
+	if (file.existsAsFile())
+		manifest = XmlDocument::parse(file);
+
+	// a manifest written for another API version would only list libraries that no longer load
+	if (manifest == nullptr || !manifest->hasTagName("PLUGINMANIFEST") || manifest->getIntAttribute("apiVersion") != PLUGIN_API_VER)
+		manifest = new XmlElement("PLUGINMANIFEST");
+
+	manifest->setAttribute("apiVersion", PLUGIN_API_VER);
+}
+
+void PluginManager::saveManifest()
+{
+	Array<XmlElement*> removed;
+	forEachXmlChildElementWithTagName(*manifest, entry, "LIBRARY")
+	{
+		if (!File(entry->getStringAttribute("path")).exists())
+			removed.add(entry);
+	}
+	for (int i = 0; i < removed.size(); i++)
+		manifest->removeChildElement(removed[i], true);
+
+	File file = getManifestFile();
+	if (!manifest->writeToFile(file, String::empty))
+		std::cout << "Could not write plugin manifest " << file.getFullPathName() << std::endl;
+}
+
+
 int PluginManager::getNumProcessors() const
 {
 	return processorPlugins.size();
@@ -307,66 +689,99 @@ int PluginManager::getNumFileSources() const
 	return fileSourcePlugins.size();
 }
 
-Plugin::ProcessorInfo PluginManager::getProcessorInfo(int index) const
+Plugin::ProcessorInfo PluginManager::getProcessorInfo(int index)
 {
-	if (index < processorPlugins.size())
+	if (index < processorPlugins.size() && loadLibrary(processorPlugins[index].libIndex))
 		return processorPlugins[index];
 	else
 		return getEmptyProcessorInfo();
 }
 
-Plugin::DataThreadInfo PluginManager::getDataThreadInfo(int index) const
+Plugin::DataThreadInfo PluginManager::getDataThreadInfo(int index)
 {
-	if (index < dataThreadPlugins.size())
+	if (index < dataThreadPlugins.size() && loadLibrary(dataThreadPlugins[index].libIndex))
 		return dataThreadPlugins[index];
 	else
 		return getEmptyDatathreadInfo();
 }
 
-Plugin::RecordEngineInfo PluginManager::getRecordEngineInfo(int index) const
+Plugin::RecordEngineInfo PluginManager::getRecordEngineInfo(int index)
 {
-	if (index < recordEnginePlugins.size())
+	if (index < recordEnginePlugins.size() && loadLibrary(recordEnginePlugins[index].libIndex))
 		return recordEnginePlugins[index];
 	else 
 		return getEmptyRecordengineInfo();
 }
 
-Plugin::FileSourceInfo PluginManager::getFileSourceInfo(int index) const
+Plugin::FileSourceInfo PluginManager::getFileSourceInfo(int index)
 {
-	if (index < fileSourcePlugins.size())
+	if (index < fileSourcePlugins.size() && loadLibrary(fileSourcePlugins[index].libIndex))
 		return fileSourcePlugins[index];
 	else
 		return getEmptyFileSourceInfo();
 }
 
-Plugin::ProcessorInfo PluginManager::getProcessorInfo(String name, String libName) const
+Plugin::ProcessorInfo PluginManager::getProcessorInfo(String name, String libName)
 {
 	Plugin::ProcessorInfo i = getEmptyProcessorInfo();
 	findPlugin<Plugin::ProcessorInfo>(name, libName, processorPlugins, i);
 	return i;
 }
 
-Plugin::DataThreadInfo PluginManager::getDataThreadInfo(String name, String libName) const
+Plugin::DataThreadInfo PluginManager::getDataThreadInfo(String name, String libName)
 {
 	Plugin::DataThreadInfo i = getEmptyDatathreadInfo();
 	findPlugin<Plugin::DataThreadInfo>(name, libName, dataThreadPlugins, i);
 	return i;
 }
 
-Plugin::RecordEngineInfo PluginManager::getRecordEngineInfo(String name, String libName) const
+Plugin::RecordEngineInfo PluginManager::getRecordEngineInfo(String name, String libName)
 {
 	Plugin::RecordEngineInfo i = getEmptyRecordengineInfo();
 	findPlugin<Plugin::RecordEngineInfo>(name, libName, recordEnginePlugins, i);
 	return i;
 }
 
-Plugin::FileSourceInfo PluginManager::getFileSourceInfo(String name, String libName) const
+Plugin::FileSourceInfo PluginManager::getFileSourceInfo(String name, String libName)
 {
 	Plugin::FileSourceInfo i = getEmptyFileSourceInfo();
 	findPlugin<Plugin::FileSourceInfo>(name, libName, fileSourcePlugins, i);
 	return i;
 }
 
+String PluginManager::getPluginName(Plugin::PluginType type, int index) const
+{
+	switch (type)
+	{
+	case Plugin::PLUGIN_TYPE_PROCESSOR:
+		return isPositiveAndBelow(index, processorPlugins.size()) ? String(processorPlugins[index].name) : String::empty;
+	case Plugin::PLUGIN_TYPE_RECORD_ENGINE:
+		return isPositiveAndBelow(index, recordEnginePlugins.size()) ? String(recordEnginePlugins[index].name) : String::empty;
+	case Plugin::PLUGIN_TYPE_DATA_THREAD:
+		return isPositiveAndBelow(index, dataThreadPlugins.size()) ? String(dataThreadPlugins[index].name) : String::empty;
+	case Plugin::PLUGIN_TYPE_FILE_SOURCE:
+		return isPositiveAndBelow(index, fileSourcePlugins.size()) ? String(fileSourcePlugins[index].name) : String::empty;
+	default:
+		return String::empty;
+	}
+}
+
+Plugin::ProcessorType PluginManager::getProcessorType(int index) const
+{
+	if (isPositiveAndBelow(index, processorPlugins.size()))
+		return processorPlugins[index].type;
+	else
+		return Plugin::InvalidProcessor;
+}
+
+String PluginManager::getFileSourceExtensions(int index) const
+{
+	if (isPositiveAndBelow(index, fileSourcePlugins.size()))
+		return fileSourcePlugins[index].extensions;
+	else
+		return String::empty;
+}
+
 String PluginManager::getLibraryName(int index) const
 {
 	if (index < 0 || index >= libArray.size())
@@ -434,7 +849,7 @@ Plugin::FileSourceInfo PluginManager::getEmptyFileSourceInfo()
 }
 
 template<class T>
-bool PluginManager::findPlugin(String name, String libName, const Array<LoadedPluginInfo<T>>& pluginArray, T& pluginInfo) const
+bool PluginManager::findPlugin(String name, String libName, const Array<LoadedPluginInfo<T>>& pluginArray, T& pluginInfo)
 {
 	for (int i = 0; i < pluginArray.size(); i++)
 	{
@@ -442,6 +857,8 @@ bool PluginManager::findPlugin(String name, String libName, const Array<LoadedPl
 		{
 			if ((libName.isEmpty()) || (libName == String(libArray[pluginArray[i].libIndex].name)))
 			{
+				if (!loadLibrary(pluginArray[i].libIndex))
+					return false;
 				pluginInfo = pluginArray[i];
 				return true;
 			}
@@ -46,22 +46,30 @@ struct LoadedLibInfo : public Plugin::LibraryInfo
 #else
 	void* handle;
 #endif
+	/* The handle stays null for libraries registered from the manifest until one
+	of their plugins is first created */
+	String path;
 };
 
 template<class T>
 struct LoadedPluginInfo : public T
 {
 	int libIndex;
+	int libPluginIndex; //index passed to the library's getPluginInfo
 };
 
 
 class GenericProcessor;
+class PluginScanJob;
 
 class PluginManager {
 
 public:
 	PluginManager();
 	~PluginManager();
+	/** Finds the plugins in the default locations. Libraries listed in the manifest with an
+	unchanged modification time and size are registered from it without being loaded, the others
+	are loaded concurrently while a progress window is shown. */
 	void loadAllPlugins();
     void loadPlugins(const File &pluginPath);
 	int loadPlugin(const String&);
@@ -71,14 +79,19 @@ public:
 	int getNumDataThreads() const;
 	int getNumRecordEngines() const;
 	int getNumFileSources() const;
-	Plugin::ProcessorInfo getProcessorInfo(int index) const;
-	Plugin::ProcessorInfo getProcessorInfo(String name, String libName = String::empty) const;
-	Plugin::DataThreadInfo getDataThreadInfo(int index) const;
-	Plugin::DataThreadInfo getDataThreadInfo(String name, String libName = String::empty) const;
-	Plugin::RecordEngineInfo getRecordEngineInfo(int index) const;
-	Plugin::RecordEngineInfo getRecordEngineInfo(String name, String libName = String::empty) const;
-	Plugin::FileSourceInfo getFileSourceInfo(int index) const;
-	Plugin::FileSourceInfo getFileSourceInfo(String name, String libName = String::empty) const;
+	/* These load the plugin's library if it has not been loaded yet, so that the creator is valid.
+	Use the methods below when only the plugin name or type is needed */
+	Plugin::ProcessorInfo getProcessorInfo(int index);
+	Plugin::ProcessorInfo getProcessorInfo(String name, String libName = String::empty);
+	Plugin::DataThreadInfo getDataThreadInfo(int index);
+	Plugin::DataThreadInfo getDataThreadInfo(String name, String libName = String::empty);
+	Plugin::RecordEngineInfo getRecordEngineInfo(int index);
+	Plugin::RecordEngineInfo getRecordEngineInfo(String name, String libName = String::empty);
+	Plugin::FileSourceInfo getFileSourceInfo(int index);
+	Plugin::FileSourceInfo getFileSourceInfo(String name, String libName = String::empty);
+	String getPluginName(Plugin::PluginType type, int index) const;
+	Plugin::ProcessorType getProcessorType(int index) const;
+	String getFileSourceExtensions(int index) const;
 	String getLibraryName(int index) const;
 	int getLibraryVersion(int index) const;
 	int getLibraryIndexFromPlugin(Plugin::PluginType type, int index);
@@ -90,8 +103,23 @@ private:
 	Array<LoadedPluginInfo<Plugin::RecordEngineInfo>> recordEnginePlugins;
 	Array<LoadedPluginInfo<Plugin::FileSourceInfo>> fileSourcePlugins;
 
+	/* Owns the names of the plugins registered from the manifest */
+	StringArray cachedStrings;
+	ScopedPointer<XmlElement> manifest;
+
+	void findPluginFiles(const File& pluginPath, Array<File>& foundDLLs) const;
+	void loadPluginFiles(const Array<File>& foundDLLs);
+	int addLibrary(const PluginScanJob& scan);
+	int addCachedLibrary(const XmlElement& xml, const String& path);
+	void addPlugin(const Plugin::PluginInfo& pInfo, int libIndex, int libPluginIndex, const String& pluginLoc);
+	const char* cacheString(const String& s);
+	bool loadLibrary(int libIndex);
+	void loadManifest();
+	void saveManifest();
+	static File getManifestFile();
+
 	template<class T>
-	bool findPlugin(String name, String libName, const Array<LoadedPluginInfo<T>>& pluginArray, T& pluginInfo) const;
+	bool findPlugin(String name, String libName, const Array<LoadedPluginInfo<T>>& pluginArray, T& pluginInfo);
 
 	/* Making the info structures have a constructor complicates the DLL interface. 
 	It's easier to just add some static methods to create empty structures for when the calls fail*/
@@ -0,0 +1,266 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "ClockSynchronizer.h"
+
+ClockSynchronizer::ClockSynchronizer()
+	: m_syncLine(-1),
+	m_referenceID(0),
+	m_referenceSampleRate(0),
+	m_numReferenceEdges(0),
+	m_nextReferenceEdge(0)
+{
+}
+
+ClockSynchronizer::~ClockSynchronizer()
+{
+}
+
+void ClockSynchronizer::setSyncLine(int line)
+{
+	m_syncLine = line;
+}
+
+int ClockSynchronizer::getSyncLine() const
+{
+	return m_syncLine;
+}
+
+void ClockSynchronizer::reset(uint32 referenceSourceID, float referenceSampleRate)
+{
+	const SpinLock::ScopedLockType lock(m_lock);
+	m_referenceID = referenceSourceID;
+	m_referenceSampleRate = referenceSampleRate;
+	m_numReferenceEdges = 0;
+	m_nextReferenceEdge = 0;
+	m_clocks.clear();
+}
+
+void ClockSynchronizer::addSource(uint32 sourceID, float sampleRate)
+{
+	if (sourceID == m_referenceID || sampleRate <= 0)
+		return;
+
+	const SpinLock::ScopedLockType lock(m_lock);
+
+	if (getClock(sourceID) != nullptr)
+		return;
+
+	SourceClock* clock = new SourceClock();
+	zerostruct(*clock);
+	clock->sourceID = sourceID;
+	clock->sampleRate = sampleRate;
+	m_clocks.add(clock);
+}
+
+ClockSynchronizer::SourceClock* ClockSynchronizer::getClock(uint32 sourceID)
+{
+	for (int i = 0; i < m_clocks.size(); i++)
+	{
+		if (m_clocks[i]->sourceID == sourceID)
+			return m_clocks[i];
+	}
+	return nullptr;
+}
+
+void ClockSynchronizer::addSyncEdge(uint32 sourceID, int64 timestamp, float sampleRate)
+{
+	if (m_syncLine < 0 || m_referenceSampleRate <= 0 || sampleRate <= 0)
+		return;
+
+	const SpinLock::ScopedLockType lock(m_lock);
+
+	if (sourceID == m_referenceID)
+	{
+		m_referenceEdges[m_nextReferenceEdge] = timestamp / double(m_referenceSampleRate);
+		m_nextReferenceEdge = (m_nextReferenceEdge + 1) % MAX_REFERENCE_EDGES;
+		m_numReferenceEdges = jmin(m_numReferenceEdges + 1, (int)MAX_REFERENCE_EDGES);
+
+		//edges of the other sources may have arrived before this one
+		for (int i = 0; i < m_clocks.size(); i++)
+			pairPendingEdges(m_clocks[i]);
+		return;
+	}
+
+	SourceClock* clock = getClock(sourceID);
+	if (clock == nullptr)
+		return;
+	if (clock->numPending == MAX_PENDING_EDGES)
+	{
+		memmove(clock->pending, clock->pending + 1, (MAX_PENDING_EDGES - 1) * sizeof(double));
+		clock->numPending--;
+	}
+	clock->pending[clock->numPending++] = timestamp / double(sampleRate);
+	pairPendingEdges(clock);
+}
+
+double ClockSynchronizer::getPulseInterval() const
+{
+	if (m_numReferenceEdges < 2)
+		return 0;
+	int last = (m_nextReferenceEdge + MAX_REFERENCE_EDGES - 1) % MAX_REFERENCE_EDGES;
+	int previous = (m_nextReferenceEdge + MAX_REFERENCE_EDGES - 2) % MAX_REFERENCE_EDGES;
+	return m_referenceEdges[last] - m_referenceEdges[previous];
+}
+
+void ClockSynchronizer::pairPendingEdges(SourceClock* clock)
+{
+	double interval = getPulseInterval();
+	if (interval <= 0)
+		return;
+
+	//before the first pairs the clocks are only assumed to have started together
+	const double tolerance = clock->synchronized ? interval * 0.1 : interval * 0.5;
+
+	int kept = 0;
+	for (int p = 0; p < clock->numPending; p++)
+	{
+		double local = clock->pending[p];
+		double predicted = clock->synchronized ? clock->mapping.slope * local + clock->mapping.offset : local;
+
+		double nearest = 0;
+		double distance = -1;
+		for (int r = 0; r < m_numReferenceEdges; r++)
+		{
+			double d = std::abs(m_referenceEdges[r] - predicted);
+			if (distance < 0 || d < distance)
+			{
+				distance = d;
+				nearest = m_referenceEdges[r];
+			}
+		}
+
+		if (distance >= 0 && distance < tolerance)
+		{
+			clock->pairLocal[clock->nextPair] = local;
+			clock->pairReference[clock->nextPair] = nearest;
+			clock->nextPair = (clock->nextPair + 1) % MAX_PAIRS;
+			clock->numPairs = jmin(clock->numPairs + 1, (int)MAX_PAIRS);
+			fit(clock);
+		}
+		else
+		{
+			//its reference edge may still be on its way, unless the reference is well past it
+			double latest = m_referenceEdges[(m_nextReferenceEdge + MAX_REFERENCE_EDGES - 1) % MAX_REFERENCE_EDGES];
+			if (latest - predicted < interval)
+				clock->pending[kept++] = local;
+		}
+	}
+	clock->numPending = kept;
+}
+
+void ClockSynchronizer::fit(SourceClock* clock)
+{
+	const int n = clock->numPairs;
+	double meanX = 0, meanY = 0;
+	for (int i = 0; i < n; i++)
+	{
+		meanX += clock->pairLocal[i];
+		meanY += clock->pairReference[i];
+	}
+	meanX /= n;
+	meanY /= n;
+
+	double slope = 1;
+	if (n >= 2)
+	{
+		double sxx = 0, sxy = 0;
+		for (int i = 0; i < n; i++)
+		{
+			double dx = clock->pairLocal[i] - meanX;
+			sxx += dx * dx;
+			sxy += dx * (clock->pairReference[i] - meanY);
+		}
+		if (sxx > 0)
+			slope = sxy / sxx;
+	}
+	double offset = meanY - slope * meanX;
+
+	double sumSq = 0;
+	for (int i = 0; i < n; i++)
+	{
+		double r = clock->pairReference[i] - (slope * clock->pairLocal[i] + offset);
+		sumSq += r * r;
+	}
+
+	clock->mapping.slope = slope;
+	clock->mapping.offset = offset;
+	clock->mapping.residualMs = std::sqrt(sumSq / n) * 1000.0;
+	clock->mapping.numPairs = n;
+	clock->synchronized = n >= 2;
+}
+
+bool ClockSynchronizer::getMapping(uint32 sourceID, Mapping& mapping) const
+{
+	const SpinLock::ScopedLockType lock(m_lock);
+	for (int i = 0; i < m_clocks.size(); i++)
+	{
+		const SourceClock* clock = m_clocks[i];
+		if (clock->sourceID == sourceID)
+		{
+			if (!clock->synchronized)
+				return false;
+			mapping = clock->mapping;
+			return true;
+		}
+	}
+	return false;
+}
+
+int64 ClockSynchronizer::getGlobalTimestamp(uint32 sourceID, int64 timestamp) const
+{
+	if (m_syncLine < 0)
+		return -1;
+	if (sourceID == m_referenceID)
+		return timestamp;
+
+	const SpinLock::ScopedLockType lock(m_lock);
+	for (int i = 0; i < m_clocks.size(); i++)
+	{
+		const SourceClock* clock = m_clocks[i];
+		if (clock->sourceID == sourceID && clock->synchronized)
+		{
+			double seconds = clock->mapping.slope * (timestamp / double(clock->sampleRate)) + clock->mapping.offset;
+			return static_cast<int64>(std::floor(seconds * m_referenceSampleRate + 0.5));
+		}
+	}
+	return -1;
+}
+
+String ClockSynchronizer::getDescription() const
+{
+	const SpinLock::ScopedLockType lock(m_lock);
+	String text;
+	for (int i = 0; i < m_clocks.size(); i++)
+	{
+		const SourceClock* clock = m_clocks[i];
+		text += "Clock sync: processor " + String(clock->sourceID >> 16) + " subprocessor " + String(clock->sourceID & 0xFFFF);
+		if (clock->synchronized)
+			text += " slope " + String(clock->mapping.slope, 9) + " offset " + String(clock->mapping.offset, 6) + " s residual "
+				+ String(clock->mapping.residualMs, 3) + " ms over " + String(clock->mapping.numPairs) + " pulses";
+		else
+			text += " not synchronized";
+		text += "\n";
+	}
+	return text;
+}
@@ -0,0 +1,130 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef CLOCKSYNCHRONIZER_H_INCLUDED
+#define CLOCKSYNCHRONIZER_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "../PluginManager/OpenEphysPlugin.h"
+
+/**
+Estimates, while acquiring, how the clock of each source maps onto the clock of the global
+timestamp source.
+
+Every source receiving the same sync pulses on one of its TTL lines (the sync line) reports the
+rising edges it sees. Each edge is paired with the nearest edge seen by the reference source,
+and a least-squares line is fitted through the latest pairs:
+
+	reference seconds = slope * source seconds + offset
+
+so that offset and drift are both followed continuously. A source is synchronized once two of
+its edges have been paired. Sync pulses should be spaced regularly and much further apart than
+the offset between sources when acquisition starts.
+
+Edges are added by the processing thread, and mappings read from any thread.
+
+@see ProcessorGraph::getClockSynchronizer
+*/
+class PLUGIN_API ClockSynchronizer
+{
+public:
+	/** The current estimate for one source */
+	struct Mapping
+	{
+		double slope;
+		double offset;
+		/** RMS of the fit residuals, in milliseconds */
+		double residualMs;
+		int numPairs;
+	};
+
+	ClockSynchronizer();
+	~ClockSynchronizer();
+
+	/** Selects the TTL line carrying the sync pulses on every source, or -1 to disable synchronization */
+	void setSyncLine(int line);
+
+	int getSyncLine() const;
+
+	/** Forgets every edge, mapping and source, and sets the source the others are mapped onto
+	and its sample rate. To be called before acquisition starts. */
+	void reset(uint32 referenceSourceID, float referenceSampleRate);
+
+	/** Adds a source whose edges are to be paired, given its full ID. To be called after reset(),
+	before acquisition starts, so that the processing thread never allocates */
+	void addSource(uint32 sourceID, float sampleRate);
+
+	/** Reports a rising edge on the sync line of a source, given its full ID. Edges of sources
+	that weren't added are ignored */
+	void addSyncEdge(uint32 sourceID, int64 timestamp, float sampleRate);
+
+	/** Returns true and fills mapping if the source has been synchronized */
+	bool getMapping(uint32 sourceID, Mapping& mapping) const;
+
+	/** Maps a timestamp of a source onto the reference source's samples, or returns -1
+	if the source is not synchronized yet. Reference timestamps are returned unchanged. */
+	int64 getGlobalTimestamp(uint32 sourceID, int64 timestamp) const;
+
+	/** One line per synchronized source, for logs and sync text files */
+	String getDescription() const;
+
+private:
+	enum { MAX_PAIRS = 64, MAX_REFERENCE_EDGES = 16, MAX_PENDING_EDGES = 8 };
+
+	struct SourceClock
+	{
+		uint32 sourceID;
+		float sampleRate;
+		double pairLocal[MAX_PAIRS];
+		double pairReference[MAX_PAIRS];
+		int numPairs;
+		int nextPair;
+		double pending[MAX_PENDING_EDGES];
+		int numPending;
+		bool synchronized;
+		Mapping mapping;
+	};
+
+	/** Returns the clock of an added source, or nullptr */
+	SourceClock* getClock(uint32 sourceID);
+	void pairPendingEdges(SourceClock* clock);
+	void fit(SourceClock* clock);
+
+	/** Spacing of the last two reference edges, in seconds, or 0 */
+	double getPulseInterval() const;
+
+	int m_syncLine;
+	uint32 m_referenceID;
+	float m_referenceSampleRate;
+
+	double m_referenceEdges[MAX_REFERENCE_EDGES];
+	int m_numReferenceEdges;
+	int m_nextReferenceEdge;
+
+	OwnedArray<SourceClock> m_clocks;
+	SpinLock m_lock;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ClockSynchronizer);
+};
+
+#endif
@@ -0,0 +1,300 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "OverrunWatchdog.h"
+#include "ProcessorGraph.h"
+#include "../GenericProcessor/GenericProcessor.h"
+#include "../MessageCenter/MessageCenter.h"
+#include "../Visualization/DisplayScheduler.h"
+#include "../../AccessClass.h"
+#include "../../CoreServices.h"
+
+namespace
+{
+	// the level of the acquisition, for the processors and plugins to read
+	Atomic<int> currentLevel;
+
+	const int windowMs = 250;
+}
+
+OverrunWatchdog::Policy::Policy()
+	: enabled(true),
+	maxOverrunFraction(0.05),
+	recoverySeconds(5.0)
+{
+	for (int i = 0; i < NUM_LEVELS; i++)
+		levels[i] = true;
+}
+
+OverrunWatchdog::OverrunWatchdog()
+	: m_lastCallbacks(0),
+	m_lastOverruns(0),
+	m_lastOverrunTime(0)
+{
+}
+
+OverrunWatchdog::~OverrunWatchdog()
+{
+	stopTimer();
+}
+
+int OverrunWatchdog::getLevel()
+{
+	return currentLevel.get();
+}
+
+String OverrunWatchdog::getLevelName(int level)
+{
+	switch (level)
+	{
+	case THROTTLE_DISPLAYS: return "throttling the displays";
+	case PAUSE_BACKGROUND_WORK: return "pausing background work";
+	case DROP_DISPLAY_BRANCHES: return "dropping the display-only processors";
+	case ALARM: return "alarm";
+	default: return "no degradation";
+	}
+}
+
+void OverrunWatchdog::setPolicy(const Policy& policy)
+{
+	m_policy = policy;
+
+	if (!m_policy.enabled)
+		setLevel(NO_DEGRADATION);
+}
+
+const OverrunWatchdog::Policy& OverrunWatchdog::getPolicy() const
+{
+	return m_policy;
+}
+
+void OverrunWatchdog::savePolicy(XmlElement* xml) const
+{
+	xml->setAttribute("enabled", m_policy.enabled);
+	xml->setAttribute("throttleDisplays", m_policy.levels[THROTTLE_DISPLAYS]);
+	xml->setAttribute("pauseBackgroundWork", m_policy.levels[PAUSE_BACKGROUND_WORK]);
+	xml->setAttribute("dropDisplayBranches", m_policy.levels[DROP_DISPLAY_BRANCHES]);
+	xml->setAttribute("alarm", m_policy.levels[ALARM]);
+	xml->setAttribute("maxOverrunFraction", m_policy.maxOverrunFraction);
+	xml->setAttribute("recoverySeconds", m_policy.recoverySeconds);
+}
+
+void OverrunWatchdog::loadPolicy(const XmlElement* xml)
+{
+	Policy policy;
+
+	policy.enabled = xml->getBoolAttribute("enabled", true);
+	policy.levels[THROTTLE_DISPLAYS] = xml->getBoolAttribute("throttleDisplays", true);
+	policy.levels[PAUSE_BACKGROUND_WORK] = xml->getBoolAttribute("pauseBackgroundWork", true);
+	policy.levels[DROP_DISPLAY_BRANCHES] = xml->getBoolAttribute("dropDisplayBranches", true);
+	policy.levels[ALARM] = xml->getBoolAttribute("alarm", true);
+	policy.maxOverrunFraction = jlimit(0.0, 1.0, xml->getDoubleAttribute("maxOverrunFraction", policy.maxOverrunFraction));
+	policy.recoverySeconds = jmax(0.0, xml->getDoubleAttribute("recoverySeconds", policy.recoverySeconds));
+
+	setPolicy(policy);
+}
+
+void OverrunWatchdog::start(const Array<GenericProcessor*>& processors)
+{
+	m_processors.clear();
+
+	for (int i = 0; i < processors.size(); i++)
+	{
+		WatchedProcessor* watched = new WatchedProcessor();
+		watched->processor = processors[i];
+		watched->nodeId = processors[i]->getNodeId();
+		m_processors.add(watched);
+	}
+
+	m_callbacks = 0;
+	m_overruns = 0;
+	m_lastCallbacks = 0;
+	m_lastOverruns = 0;
+	m_lastOverrunTime = Time::getMillisecondCounter();
+
+	setLevel(NO_DEGRADATION);
+	startTimer(windowMs);
+}
+
+void OverrunWatchdog::stop()
+{
+	stopTimer();
+	setLevel(NO_DEGRADATION);
+
+	if (m_overruns.get() == 0)
+		return;
+
+	std::cout << m_overruns.get() << " of " << m_callbacks.get() << " callbacks overran their block period." << std::endl;
+
+	for (int i = 0; i < m_processors.size(); i++)
+	{
+		if (m_processors[i]->overruns.get() > 0)
+			std::cout << "  " << m_processors[i]->processor->getName() << " (" << m_processors[i]->processor->getNodeId()
+				<< "): slowest in " << m_processors[i]->overruns.get() << std::endl;
+	}
+}
+
+void OverrunWatchdog::addCallback(int64 ticks, int numSamples, double sampleRate, double clockSpeed)
+{
+	if (sampleRate <= 0 || clockSpeed <= 0)
+		return;
+
+	++m_callbacks;
+
+	const double periodTicks = numSamples / (sampleRate * clockSpeed) * (double) Time::getHighResolutionTicksPerSecond();
+
+	if ((double) ticks <= periodTicks)
+		return;
+
+	++m_overruns;
+
+	// the callback is counted against the processor that took longest in it
+	WatchedProcessor* slowest = nullptr;
+	int64 slowestTicks = -1;
+
+	for (int i = 0; i < m_processors.size(); i++)
+	{
+		const int64 blockTicks = m_processors.getUnchecked(i)->processor->getLastBlockTicks();
+
+		if (blockTicks > slowestTicks)
+		{
+			slowest = m_processors.getUnchecked(i);
+			slowestTicks = blockTicks;
+		}
+	}
+
+	if (slowest != nullptr)
+		++slowest->overruns;
+}
+
+int64 OverrunWatchdog::getNumOverruns() const
+{
+	return m_overruns.get();
+}
+
+int64 OverrunWatchdog::getNumOverruns(int nodeId) const
+{
+	for (int i = 0; i < m_processors.size(); i++)
+	{
+		if (m_processors[i]->nodeId == nodeId)
+			return m_processors[i]->overruns.get();
+	}
+
+	return 0;
+}
+
+int64 OverrunWatchdog::getNumCallbacks() const
+{
+	return m_callbacks.get();
+}
+
+void OverrunWatchdog::timerCallback()
+{
+	const int64 callbacks = m_callbacks.get();
+	const int64 overruns = m_overruns.get();
+	const int64 windowCallbacks = callbacks - m_lastCallbacks;
+	const int64 windowOverruns = overruns - m_lastOverruns;
+	const uint32 now = Time::getMillisecondCounter();
+
+	m_lastCallbacks = callbacks;
+	m_lastOverruns = overruns;
+
+	if (windowOverruns > 0)
+		m_lastOverrunTime = now;
+
+	if (!m_policy.enabled || windowCallbacks == 0)
+		return;
+
+	const int level = getLevel();
+
+	if (windowOverruns > m_policy.maxOverrunFraction * windowCallbacks)
+	{
+		const int next = getNextLevel();
+
+		if (next != level)
+			setLevel(next);
+	}
+	else if (level > NO_DEGRADATION && now - m_lastOverrunTime >= uint32(m_policy.recoverySeconds * 1000.0))
+	{
+		int previous = level - 1;
+
+		while (previous > NO_DEGRADATION && !m_policy.levels[previous])
+			previous--;
+
+		// each level down waits for its own quiet time
+		m_lastOverrunTime = now;
+		setLevel(previous);
+	}
+}
+
+int OverrunWatchdog::getNextLevel() const
+{
+	for (int next = getLevel() + 1; next < NUM_LEVELS; next++)
+	{
+		if (m_policy.levels[next])
+			return next;
+	}
+
+	return getLevel();
+}
+
+void OverrunWatchdog::setLevel(int level)
+{
+	const int previous = getLevel();
+
+	if (level == previous)
+		return;
+
+	currentLevel = level;
+
+	DisplayScheduler::getInstance().setMinimumLevel(level >= THROTTLE_DISPLAYS ? DisplayScheduler::getMaxLevel() : 0);
+
+	if (level > previous)
+		std::cout << "Processing can't keep up with the data, " << getLevelName(level) << "." << std::endl;
+	else
+		std::cout << "Processing keeps up again, back to " << getLevelName(level) << "." << std::endl;
+
+	if (level == ALARM)
+		raiseAlarm();
+}
+
+void OverrunWatchdog::raiseAlarm()
+{
+	const WatchedProcessor* slowest = nullptr;
+
+	for (int i = 0; i < m_processors.size(); i++)
+	{
+		if (m_processors[i]->overruns.get() > 0
+			&& (slowest == nullptr || m_processors[i]->overruns.get() > slowest->overruns.get()))
+			slowest = m_processors[i];
+	}
+
+	String message = "Processing overruns: " + String(m_overruns.get()) + " of " + String(m_callbacks.get()) + " blocks late";
+
+	if (slowest != nullptr)
+		message += ", slowest processor " + slowest->processor->getName() + " (" + String(slowest->processor->getNodeId()) + ")";
+
+	CoreServices::sendStatusMessage(message);
+
+	if (ProcessorGraph* graph = AccessClass::getProcessorGraph())
+		graph->getMessageCenter()->logMessage(message);
+}
@@ -0,0 +1,144 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OVERRUNWATCHDOG_H_INCLUDED
+#define OVERRUNWATCHDOG_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "../PluginManager/OpenEphysPlugin.h"
+
+class GenericProcessor;
+
+/**
+Watches for audio callbacks that take longer than the data they process last, and sheds
+the work that can wait until processing keeps up again.
+
+Every callback's processing time is compared to its block period, the block's samples at
+the device sample rate. A callback that overruns it is counted against the processor that
+took longest in it. Four times a second, if more than the policy's fraction of the callbacks
+overran, the watchdog steps up to the next level the policy enables:
+
+	THROTTLE_DISPLAYS       the visualizers refresh at a quarter of their rate, with less detail
+	PAUSE_BACKGROUND_WORK   background computations, such as the Spike Sorter's PCA, wait
+	DROP_DISPLAY_BRANCHES   processors that only draw their inputs skip their blocks
+	ALARM                   a status message, also written to the recording as a GUI message
+
+It steps back down one level once no callback has overrun for the policy's recovery time.
+Recording always keeps priority: the record node and every processor whose channels it may
+write are never slowed down or skipped. Free running acquisitions, whose blocks are not run
+in real time, are not watched.
+
+Levels are read from any thread with getLevel(). Callbacks are added by the processing thread,
+everything else is done on the message thread.
+
+@see ProcessorGraph::getOverrunWatchdog, DisplayScheduler
+*/
+class PLUGIN_API OverrunWatchdog : private Timer
+{
+public:
+	enum Level
+	{
+		NO_DEGRADATION = 0,
+		THROTTLE_DISPLAYS,
+		PAUSE_BACKGROUND_WORK,
+		DROP_DISPLAY_BRANCHES,
+		ALARM,
+		NUM_LEVELS
+	};
+
+	struct Policy
+	{
+		Policy();
+
+		/** If the watchdog takes any step at all */
+		bool enabled;
+		/** For each level, if it is taken, NO_DEGRADATION's entry being ignored */
+		bool levels[NUM_LEVELS];
+		/** Part of a quarter second's callbacks that may overrun without stepping up */
+		double maxOverrunFraction;
+		/** Time without overruns before stepping down a level, in seconds */
+		double recoverySeconds;
+	};
+
+	OverrunWatchdog();
+	~OverrunWatchdog();
+
+	/** Returns the level of the current acquisition, NO_DEGRADATION while stopped */
+	static int getLevel();
+
+	static String getLevelName(int level);
+
+	void setPolicy(const Policy& policy);
+	const Policy& getPolicy() const;
+
+	/** Writes the policy as attributes, and reads it back from an element written so */
+	void savePolicy(XmlElement* xml) const;
+	void loadPolicy(const XmlElement* xml);
+
+	/** Starts watching the callbacks of the given processors. To be called before they start. */
+	void start(const Array<GenericProcessor*>& processors);
+
+	/** Stops watching once the callbacks have ended, logging the overruns if there were any */
+	void stop();
+
+	/** Accounts for a callback that took the given number of high resolution ticks to process
+	numSamples samples at sampleRate, run clockSpeed times faster than real time */
+	void addCallback(int64 ticks, int numSamples, double sampleRate, double clockSpeed);
+
+	/** The callbacks that overran since acquisition last started, overall or of one of the
+	processors, given its node ID */
+	int64 getNumOverruns() const;
+	int64 getNumOverruns(int nodeId) const;
+	int64 getNumCallbacks() const;
+
+private:
+	void timerCallback() override;
+
+	void setLevel(int level);
+
+	/** Returns the next level up the policy enables, or the current one if there's none */
+	int getNextLevel() const;
+
+	/** Shows the status message, and writes it to the recording */
+	void raiseAlarm();
+
+	struct WatchedProcessor
+	{
+		GenericProcessor* processor;   // only used during acquisition
+		int nodeId;
+		Atomic<int64> overruns;
+	};
+
+	Policy m_policy;
+	OwnedArray<WatchedProcessor> m_processors;
+
+	Atomic<int64> m_callbacks;
+	Atomic<int64> m_overruns;
+
+	int64 m_lastCallbacks;
+	int64 m_lastOverruns;
+	uint32 m_lastOverrunTime;    // millisecond counter at the end of the last window with overruns
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(OverrunWatchdog);
+};
+
+#endif
@@ -27,9 +27,13 @@
 #include "../../../JuceLibraryCode/JuceHeader.h"
 
 #include "../../AccessClass.h"
+#include "../../Audio/DataClockDevice.h"
+#include "ClockSynchronizer.h"
+#include "OverrunWatchdog.h"
 
 class GenericProcessor;
 class RecordNode;
+class SourceNode;
 class AudioNode;
 class MessageCenter;
 class SignalChainTabButton;
@@ -51,6 +55,7 @@ class TimestampSourceSelectionWindow;
 
 class ProcessorGraph    : public AudioProcessorGraph
                         , public ChangeListener
+                        , public DataClockSource
 {
 public:
     ProcessorGraph();
@@ -99,6 +104,52 @@ public:
 
 	void setTimestampWindow(TimestampSourceSelectionWindow* window);
 
+	/** Maps the timestamps of every source onto the global timestamp source, from the pulses
+	they all receive on a sync line. Reset, with the current global timestamp source as
+	reference, whenever acquisition starts. */
+	ClockSynchronizer& getClockSynchronizer();
+
+	/** Processes the independent branches of the signal chain on several threads at once.
+	Only to be changed while acquisition is stopped. */
+	void setParallelRendering(bool enabled);
+
+	bool isParallelRenderingEnabled() const;
+
+	/** Processes each independent signal chain, the processors of a tab or of tabs joined by a
+	Merger, on a thread of its own, the record and audio nodes gathering them on the audio thread.
+	Takes precedence over parallel rendering. Only to be changed while acquisition is stopped. */
+	void setChainThreading(bool enabled);
+
+	bool isChainThreadingEnabled() const;
+
+	/** The record and audio nodes, and the message center, are shared by every chain */
+	bool isChainSink(const Node& node) const override;
+
+	/** Asks the processor, see GenericProcessor::isPassThroughChannel(), when the rendering
+	sequence is built, so that pass-through processors read the buffers of their sources
+	instead of copies */
+	bool isPassThroughChannel(const Node& node, int channel) const override;
+
+	/** Counts the callbacks that overrun their block period and sheds work while they do */
+	OverrunWatchdog& getOverrunWatchdog();
+
+	/** Processes the graph, timing the callback for the OverrunWatchdog */
+	void processBlock(AudioSampleBuffer& buffer, MidiBuffer& midiMessages) override;
+	using AudioProcessorGraph::processBlock;
+
+	/** Writes the timing statistics of every processor, and the event latencies measured by
+	output processors, to a file, as JSON if its extension is .json and as CSV otherwise.
+	Returns a message describing the outcome. */
+	String exportTimingStats(const File& file);
+
+	/** DataClockSource methods, answered from the sources enabled for the current acquisition */
+	bool hasDataSources() override;
+	bool hasSamplesForBlock(int blockSize, double sampleRate) override;
+	/** True while an acquisition fed only by File Readers in offline mode is running */
+	bool isFreeRunning() override;
+	/** The playback speed of the File Readers, while they are the only sources */
+	double getClockSpeed() override;
+
 private:
     int currentNodeId;
 
@@ -110,8 +161,17 @@ private:
         MESSAGE_CENTER_ID = 904
     };
 
+    /** Resets the connection state of every processor and starts a new list of wanted
+    connections, holding the fixed audio output and message center ones. */
     void clearConnections();
 
+    /** Adds a connection to the list started by clearConnections(). */
+    void addPendingConnection(uint32 sourceNodeId, int sourceChannelIndex, uint32 destNodeId, int destChannelIndex);
+
+    /** Brings the graph's connections in line with the wanted ones. Connections present in
+    both are left alone, so an unchanged signal chain doesn't disturb the graph at all. */
+    void applyPendingConnections();
+
     void connectProcessors(GenericProcessor* source, GenericProcessor* dest);
     void connectProcessorToAudioAndRecordNodes(GenericProcessor* source);
 
@@ -120,6 +180,27 @@ private:
 	int m_timestampSourceSubIdx;
 	Array<const GenericProcessor*> m_validTimestampSources;
 	WeakReference<TimestampSourceSelectionWindow> m_timestampWindow;
+	ClockSynchronizer m_clockSynchronizer;
+	OverrunWatchdog m_overrunWatchdog;
+
+	struct PendingConnection
+	{
+		uint32 sourceNodeId;
+		int sourceChannelIndex;
+		uint32 destNodeId;
+		int destChannelIndex;
+
+		bool operator<(const PendingConnection& other) const;
+		bool operator==(const PendingConnection& other) const;
+	};
+
+	Array<PendingConnection> m_pendingConnections;
+
+	/** Sources with a data thread, for the data clock. Only set while acquisition is active. */
+	Array<SourceNode*> m_clockSources;
+	SpinLock m_clockSourceLock;
+	Atomic<int> m_freeRunning;
+	double m_clockSpeed{ 1.0 }; // only changed while the clock is stopped
 };
 
 
@@ -32,11 +32,12 @@
 #include "../Merger/Merger.h"
 #include "../Splitter/Splitter.h"
 #include "../DataThreads/RhythmNode/RHD2000Thread.h"
+#include "../DataThreads/SyntheticSource/SyntheticDataThread.h"
 
 #include "../PlaceholderProcessor/PlaceholderProcessor.h"
 
 /** Total number of builtin processors **/
-#define BUILTIN_PROCESSORS 4
+#define BUILTIN_PROCESSORS 5
 
 namespace ProcessorManager
 {
@@ -66,6 +67,10 @@ namespace ProcessorManager
 			name = "File Reader";
 			type = SourceProcessor;
 			break;
+		case 4:
+			name = "Synthetic Source";
+			type = SourceProcessor;
+			break;
 		default:
 			name = String::empty;
 			type = -1;
@@ -94,6 +99,9 @@ namespace ProcessorManager
 		case 3:
 			proc = new FileReader();
 			break;
+		case 4:
+			proc = new SourceNode("Synthetic Source", &SyntheticDataThread::createDataThread);
+			break;
 		default:
 			return nullptr;
 		}
@@ -128,15 +136,14 @@ namespace ProcessorManager
 			break;
 		case PluginProcessor:
 			{
-				Plugin::ProcessorInfo info = AccessClass::getPluginManager()->getProcessorInfo(index);
-				name = info.name;
-				type = info.type;
+				// only the cached names, so that filling the processor list does not load the libraries
+				name = AccessClass::getPluginManager()->getPluginName(Plugin::PLUGIN_TYPE_PROCESSOR, index);
+				type = AccessClass::getPluginManager()->getProcessorType(index);
 			}
 			break;
 		case DataThreadProcessor:
 		{
-			Plugin::DataThreadInfo info = AccessClass::getPluginManager()->getDataThreadInfo(index);
-			name = info.name;
+			name = AccessClass::getPluginManager()->getPluginName(Plugin::PLUGIN_TYPE_DATA_THREAD, index);
 			type = SourceProcessor;
 			break;
 		}
@@ -157,6 +164,8 @@ namespace ProcessorManager
 		case PluginProcessor:
 			{
 				Plugin::ProcessorInfo info = AccessClass::getPluginManager()->getProcessorInfo(index);
+				if (info.creator == nullptr)
+					return nullptr;
 				GenericProcessor* proc = info.creator();
 				proc->setPluginData(Plugin::PLUGIN_TYPE_PROCESSOR, index);
 				return proc;
@@ -165,6 +174,8 @@ namespace ProcessorManager
 		case DataThreadProcessor:
 		{
 			Plugin::DataThreadInfo info = AccessClass::getPluginManager()->getDataThreadInfo(index);
+			if (info.creator == nullptr)
+				return nullptr;
 			GenericProcessor* proc = new SourceNode(info.name, info.creator);
 			proc->setPluginData(Plugin::PLUGIN_TYPE_DATA_THREAD, index);
 			return proc;
@@ -190,12 +201,14 @@ namespace ProcessorManager
 			{
 				for (int i = 0; i < pm->getNumProcessors(); i++)
 				{
-					Plugin::ProcessorInfo info = pm->getProcessorInfo(i);
-					if (procName.equalsIgnoreCase(info.name))
+					if (procName.equalsIgnoreCase(pm->getPluginName(Plugin::PLUGIN_TYPE_PROCESSOR, i)))
 					{
 						int libIndex = pm->getLibraryIndexFromPlugin(Plugin::PLUGIN_TYPE_PROCESSOR, i);
 						if (libName.equalsIgnoreCase(pm->getLibraryName(libIndex)) && libVersion == pm->getLibraryVersion(libIndex))
 						{
+							Plugin::ProcessorInfo info = pm->getProcessorInfo(i);
+							if (info.creator == nullptr)
+								break;
 							proc = info.creator();
 							proc->setPluginData(Plugin::PLUGIN_TYPE_PROCESSOR, i);
 							return proc;
@@ -207,12 +220,14 @@ namespace ProcessorManager
 			{
 				for (int i = 0; i < pm->getNumDataThreads(); i++)
 				{
-					Plugin::DataThreadInfo info = pm->getDataThreadInfo(i);
-					if (procName.equalsIgnoreCase(info.name))
+					if (procName.equalsIgnoreCase(pm->getPluginName(Plugin::PLUGIN_TYPE_DATA_THREAD, i)))
 					{
 						int libIndex = pm->getLibraryIndexFromPlugin(Plugin::PLUGIN_TYPE_DATA_THREAD, i);
 						if (libName.equalsIgnoreCase(pm->getLibraryName(libIndex)) && libVersion == pm->getLibraryVersion(libIndex))
 						{
+							Plugin::DataThreadInfo info = pm->getDataThreadInfo(i);
+							if (info.creator == nullptr)
+								break;
 							proc = new SourceNode(info.name, info.creator);
 							proc->setPluginData(Plugin::PLUGIN_TYPE_DATA_THREAD, i);
 							return proc;
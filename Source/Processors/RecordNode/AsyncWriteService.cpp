@@ -0,0 +1,305 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2017 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "AsyncWriteService.h"
+
+#define MAX_SPARE_CHUNKS 2
+
+AsyncWriteFile::AsyncWriteFile(AsyncWriteService* service, const File& file, FileOutputStream* stream) :
+m_service(service),
+m_file(file),
+m_stream(stream),
+m_scheduled(false),
+m_idle(true),
+m_throttled(false),
+m_pendingBytes(0),
+m_failed(false)
+{
+	m_endPosition = m_stream->getPosition();
+	m_writtenEnd = m_endPosition;
+	m_idle.signal();
+}
+
+AsyncWriteFile::~AsyncWriteFile()
+{
+	flush();
+	//make sure the writer thread that has just signaled m_idle has left the lock
+	const ScopedLock sl(m_lock);
+}
+
+const File& AsyncWriteFile::getFile() const
+{
+	return m_file;
+}
+
+void AsyncWriteFile::write(const void* data, size_t size)
+{
+	queue(m_endPosition, data, size);
+	m_endPosition += size;
+}
+
+void AsyncWriteFile::writeAt(int64 position, const void* data, size_t size)
+{
+	queue(position, data, size);
+	m_endPosition = jmax(m_endPosition, position + int64(size));
+}
+
+void AsyncWriteFile::queue(int64 position, const void* data, size_t size)
+{
+	if (size == 0)
+		return;
+
+	//the queue is bounded, a single write larger than the bound still going through on its own
+	if (m_pendingBytes > 0 && m_pendingBytes + int64(size) > ASYNC_WRITE_MAX_PENDING_BYTES)
+	{
+		if (!m_throttled)
+		{
+			m_throttled = true;
+			std::cerr << "Writes to " << m_file.getFullPathName() << " are waiting for the disk to catch up" << std::endl;
+		}
+		while (m_pendingBytes > 0 && m_pendingBytes + int64(size) > ASYNC_WRITE_MAX_PENDING_BYTES)
+			m_chunksWritten.wait(100);
+	}
+
+	m_pendingBytes += size;
+	m_service->m_pendingBytes += size;
+
+	bool needsScheduling = false;
+	{
+		const ScopedLock sl(m_lock);
+		Chunk* chunk = m_queued.getLast();
+		if (chunk == nullptr || chunk->position + int64(chunk->size) != position || chunk->size + size > chunk->capacity)
+		{
+			chunk = nullptr;
+			for (int i = 0; i < m_spare.size(); i++)
+			{
+				if (m_spare[i]->capacity >= size)
+				{
+					chunk = m_spare.removeAndReturn(i);
+					break;
+				}
+			}
+			if (chunk == nullptr)
+			{
+				chunk = new Chunk();
+				chunk->capacity = jmax(size, size_t(ASYNC_WRITE_CHUNK_BYTES));
+				chunk->data.malloc(chunk->capacity);
+			}
+			chunk->position = position;
+			chunk->size = 0;
+			m_queued.add(chunk);
+		}
+		memcpy(chunk->data + chunk->size, data, size);
+		chunk->size += size;
+
+		if (!m_scheduled)
+		{
+			m_scheduled = true;
+			m_idle.reset();
+			needsScheduling = true;
+		}
+	}
+	if (needsScheduling)
+		m_service->schedule(this);
+}
+
+void AsyncWriteFile::writeQueuedChunks()
+{
+	for (;;)
+	{
+		{
+			const ScopedLock sl(m_lock);
+			m_writing.swapWith(m_queued);
+			if (m_writing.size() == 0)
+			{
+				m_scheduled = false;
+				m_idle.signal();
+				return;
+			}
+		}
+
+		{
+			//the stream is unbuffered, so the chunks go straight to the operating system. Flushing it would also
+			//wait for them to reach the disk, which is left to sync()
+			const ScopedLock streamLock(m_streamLock);
+			for (int i = 0; i < m_writing.size(); i++)
+			{
+				const Chunk* chunk = m_writing[i];
+				if (m_stream->getPosition() != chunk->position && !m_stream->setPosition(chunk->position))
+					m_failed = true;
+				else if (!m_stream->write(chunk->data, chunk->size))
+					m_failed = true;
+				else if (chunk->position + int64(chunk->size) > m_writtenEnd)
+					m_writtenEnd = chunk->position + int64(chunk->size);
+			}
+			if (m_stream->getStatus().failed())
+				m_failed = true;
+		}
+
+		const ScopedLock sl(m_lock);
+		while (m_writing.size() > 0)
+		{
+			Chunk* chunk = m_writing.removeAndReturn(m_writing.size() - 1);
+			m_pendingBytes -= chunk->size;
+			m_service->m_pendingBytes -= chunk->size;
+			if (m_spare.size() < MAX_SPARE_CHUNKS && chunk->capacity == ASYNC_WRITE_CHUNK_BYTES)
+				m_spare.add(chunk);
+			else
+				delete chunk;
+		}
+		m_chunksWritten.signal();
+	}
+}
+
+int64 AsyncWriteFile::getPosition() const
+{
+	return m_endPosition;
+}
+
+int64 AsyncWriteFile::getPendingBytes() const
+{
+	return m_pendingBytes;
+}
+
+bool AsyncWriteFile::flush()
+{
+	m_idle.wait(-1);
+	if (m_failed)
+		std::cerr << "Error writing to " << m_file.getFullPathName() << ": " << m_stream->getStatus().getErrorMessage() << std::endl;
+	return !m_failed;
+}
+
+int64 AsyncWriteFile::sync()
+{
+	const ScopedLock streamLock(m_streamLock);
+	int64 validBytes = m_writtenEnd;
+	m_stream->flush();
+	if (m_failed || m_stream->getStatus().failed())
+		return -1;
+	return validBytes;
+}
+
+bool AsyncWriteFile::hasFailed() const
+{
+	return m_failed;
+}
+
+
+AsyncWriteService::WriterThread::WriterThread(AsyncWriteService& service, int index) :
+Thread("Async file writer " + String(index)),
+m_service(service)
+{
+}
+
+void AsyncWriteService::WriterThread::run()
+{
+	while (!threadShouldExit())
+	{
+		if (!m_service.writeNextFile())
+			m_service.m_workAvailable.wait(100);
+	}
+}
+
+AsyncWriteService::AsyncWriteService(int numThreads) :
+m_pendingBytes(0)
+{
+	m_readyFiles.ensureStorageAllocated(64);
+	for (int i = 0; i < numThreads; i++)
+	{
+		WriterThread* thread = new WriterThread(*this, i);
+		m_threads.add(thread);
+		thread->startThread();
+	}
+}
+
+AsyncWriteService::~AsyncWriteService()
+{
+	for (int i = 0; i < m_threads.size(); i++)
+		m_threads[i]->signalThreadShouldExit();
+	for (int i = 0; i < m_threads.size(); i++)
+	{
+		m_workAvailable.signal();
+		m_threads[i]->waitForThreadToExit(-1);
+	}
+	while (writeNextFile());
+}
+
+AsyncWriteFile* AsyncWriteService::openFile(const File& file, bool append)
+{
+	if (!append && file.existsAsFile() && !file.deleteFile())
+	{
+		std::cerr << "Error replacing file " << file.getFullPathName() << std::endl;
+		return nullptr;
+	}
+	Result res = file.create();
+	if (res.failed())
+	{
+		std::cerr << "Error creating file " << file.getFullPathName() << ": " << res.getErrorMessage() << std::endl;
+		return nullptr;
+	}
+	//the chunks are large enough already
+	ScopedPointer<FileOutputStream> stream = new FileOutputStream(file, 0);
+	if (stream->failedToOpen())
+	{
+		std::cerr << "Error opening file " << file.getFullPathName() << ": " << stream->getStatus().getErrorMessage() << std::endl;
+		return nullptr;
+	}
+	return new AsyncWriteFile(this, file, stream.release());
+}
+
+int64 AsyncWriteService::getPendingBytes() const
+{
+	return m_pendingBytes;
+}
+
+int AsyncWriteService::getNumThreads() const
+{
+	return m_threads.size();
+}
+
+void AsyncWriteService::schedule(AsyncWriteFile* file)
+{
+	{
+		const ScopedLock sl(m_readyLock);
+		m_readyFiles.add(file);
+	}
+	m_workAvailable.signal();
+}
+
+bool AsyncWriteService::writeNextFile()
+{
+	AsyncWriteFile* file;
+	bool moreFiles;
+	{
+		const ScopedLock sl(m_readyLock);
+		if (m_readyFiles.size() == 0)
+			return false;
+		file = m_readyFiles.remove(0);
+		moreFiles = m_readyFiles.size() > 0;
+	}
+	//let another thread take the next file while this one writes
+	if (moreFiles)
+		m_workAvailable.signal();
+	file->writeQueuedChunks();
+	return true;
+}
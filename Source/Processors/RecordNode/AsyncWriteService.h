@@ -0,0 +1,172 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2017 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef ASYNCWRITESERVICE_H_INCLUDED
+#define ASYNCWRITESERVICE_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "../PluginManager/OpenEphysPlugin.h"
+#include <atomic>
+
+#define ASYNC_WRITE_THREADS 4
+#define ASYNC_WRITE_CHUNK_BYTES (1 << 16)
+/** Queued bytes past which the writes to a file wait for the disk */
+#define ASYNC_WRITE_MAX_PENDING_BYTES (int64(64) << 20)
+
+class AsyncWriteService;
+
+/**
+A file written in the background by an AsyncWriteService.
+
+Writes return as soon as their data has been copied to the queue of the file, and are carried out
+in the order they were issued. Small consecutive appends are merged into larger chunks. Only one
+thread should issue writes to a given file, but any number of files can be written at the same time.
+Once ASYNC_WRITE_MAX_PENDING_BYTES are queued for a file, a write waits for the disk to catch up
+instead, which is reported the first time.
+
+Destroying the file waits for its queued writes to complete.
+*/
+class PLUGIN_API AsyncWriteFile
+{
+public:
+	~AsyncWriteFile();
+
+	const File& getFile() const;
+
+	/** Queues data to be appended at the end of the file */
+	void write(const void* data, size_t size);
+
+	/** Queues data to be written at an absolute position of the file. Later appends still go to the end of the file */
+	void writeAt(int64 position, const void* data, size_t size);
+
+	/** Returns the size the file will have once all the queued writes are completed */
+	int64 getPosition() const;
+
+	/** Returns the number of queued bytes not yet written to disk */
+	int64 getPendingBytes() const;
+
+	/** Blocks until all queued writes are completed.
+	@return false if any write to this file has failed */
+	bool flush();
+
+	/** Makes the data the writer threads have written so far durable, without waiting for the queued writes.
+	Completed writes otherwise only reach the operating system, which writes them to disk in its own time.
+	Can be called from any thread.
+	@return how much of the file, from its start, is on disk and contiguous, or -1 on error */
+	int64 sync();
+
+	bool hasFailed() const;
+
+private:
+	friend class AsyncWriteService;
+
+	struct Chunk
+	{
+		int64 position;
+		size_t size;
+		HeapBlock<char> data;
+		size_t capacity;
+	};
+
+	AsyncWriteFile(AsyncWriteService* service, const File& file, FileOutputStream* stream);
+	void queue(int64 position, const void* data, size_t size);
+	/** Called by the service's threads. Writes chunks until the queue is empty */
+	void writeQueuedChunks();
+
+	AsyncWriteService* const m_service;
+	const File m_file;
+	ScopedPointer<FileOutputStream> m_stream;
+
+	CriticalSection m_lock;
+	OwnedArray<Chunk> m_queued;
+	OwnedArray<Chunk> m_writing;
+	OwnedArray<Chunk> m_spare;
+	bool m_scheduled;
+	WaitableEvent m_idle;
+	/** Signaled each time written chunks leave the queue, for a write waiting for room */
+	WaitableEvent m_chunksWritten;
+	bool m_throttled;
+
+	int64 m_endPosition;
+	/** The end of the appended data the writer threads have written. Appends are written in order */
+	std::atomic<int64> m_writtenEnd;
+	/** Held by the writer thread while it writes, so that a sync doesn't use the stream at the same time */
+	CriticalSection m_streamLock;
+	std::atomic<int64> m_pendingBytes;
+	std::atomic<bool> m_failed;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AsyncWriteFile);
+};
+
+/**
+Writes files in the background for the record engines.
+
+A small pool of threads takes the files with queued writes in turns, so the writes of different
+files are in flight at the same time instead of one after another on the record thread, letting
+the operating system and the disk schedule them together. The writes of a single file stay in order.
+
+RecordNode owns the shared instance, available to engines through AsyncRecordEngine.
+*/
+class PLUGIN_API AsyncWriteService
+{
+public:
+	AsyncWriteService(int numThreads = ASYNC_WRITE_THREADS);
+	/** Writes all the queued data before returning. Every file must have been destroyed before the service */
+	~AsyncWriteService();
+
+	/** Opens a file to be written through this service. The caller owns the returned object.
+	@param append if true, writes go after the existing contents of the file. Otherwise any existing file is replaced.
+	@return nullptr if the file couldn't be opened */
+	AsyncWriteFile* openFile(const File& file, bool append = false);
+
+	/** Returns the number of queued bytes not yet written to disk, across all files */
+	int64 getPendingBytes() const;
+
+	int getNumThreads() const;
+
+private:
+	friend class AsyncWriteFile;
+
+	class WriterThread : public Thread
+	{
+	public:
+		WriterThread(AsyncWriteService& service, int index);
+		void run() override;
+	private:
+		AsyncWriteService& m_service;
+	};
+
+	void schedule(AsyncWriteFile* file);
+	/** Takes the next file with queued writes and writes them. Returns false if there was none */
+	bool writeNextFile();
+
+	OwnedArray<WriterThread> m_threads;
+	CriticalSection m_readyLock;
+	Array<AsyncWriteFile*> m_readyFiles;
+	WaitableEvent m_workAvailable;
+	std::atomic<int64> m_pendingBytes;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AsyncWriteService);
+};
+
+#endif  // ASYNCWRITESERVICE_H_INCLUDED
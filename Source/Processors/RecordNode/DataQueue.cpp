@@ -22,62 +22,277 @@
 */
 #include "../../../JuceLibraryCode/JuceHeader.h"
 #include "DataQueue.h"
+#include "../GenericProcessor/MemoryFootprint.h"
+#include "../Dsp/VectorOps.h"
+
+//windows a gated group can hold before adding one allocates
+#define DATA_QUEUE_GATE_WINDOWS 256
 
 DataQueue::DataQueue(int blockSize, int nBlocks) :
 m_buffer(0, blockSize*nBlocks),
+m_int16Only(false),
+m_gated(false),
 m_numChans(0),
 m_blockSize(blockSize),
-m_readInProgress(false),
+m_numReaders(1),
 m_numBlocks(nBlocks),
-m_maxSize(blockSize*nBlocks)
-{}
+m_maxSize(blockSize*nBlocks),
+m_droppedSamples(0)
+{
+	m_readInProgress.add(false);
+	m_moreToRead.add(false);
+}
 
 DataQueue::~DataQueue()
 {}
 
-void DataQueue::setChannels(int nChans)
+bool DataQueue::anyReadInProgress() const
+{
+	return m_readInProgress.contains(true);
+}
+
+void DataQueue::resetReaders(ChannelGroup* group, int64 startPosition)
 {
-	if (m_readInProgress)
+	int64 startTimestamp = 0;
+	if (startPosition >= 0)
+	{
+		group->fifo.attachReaders(m_numReaders, startPosition);
+		if (startPosition > 0)
+		{
+			//only block starts have a timestamp
+			const int64 blockStart = startPosition - (startPosition % m_blockSize);
+			startTimestamp = group->timestamps[int((blockStart / m_blockSize) % m_numBlocks)] + (startPosition - blockStart);
+		}
+	}
+	else
+	{
+		group->fifo.setNumReaders(m_numReaders);
+		startPosition = 0;
+	}
+
+	group->readSamples.clearQuick();
+	group->readSamples.insertMultiple(0, 0, m_numReaders);
+	group->lastReadTimestamps.clearQuick();
+	group->lastReadTimestamps.insertMultiple(0, startTimestamp, m_numReaders);
+	group->readPositions.clearQuick();
+	group->readPositions.insertMultiple(0, startPosition, m_numReaders);
+	group->convertedEnd = startPosition;
+	group->startPosition = startPosition;
+	group->startTimestamp = startTimestamp;
+}
+
+void DataQueue::setChannels(const Array<int>& channelGroups, int nBlocks)
+{
+	if (anyReadInProgress())
 		return;
 
-	m_fifos.clear();
-	m_readSamples.clear();
-	m_numChans = nChans;
-	m_timestamps.clear();
-	m_lastReadTimestamps.clear();
+	if (nBlocks > 0)
+	{
+		m_numBlocks = nBlocks;
+		m_maxSize = m_blockSize*nBlocks;
+	}
+	m_droppedSamples = 0;
+
+	m_groups.clear();
+	m_gated = false;
+	m_channelGroups = channelGroups;
+	m_numChans = channelGroups.size();
+	m_rawChannels.clear();
+	m_conversionScales.clear();
+	m_rawBuffer.free();
 
-	for (int i = 0; i < nChans; ++i)
+	for (int i = 0; i < m_numChans; ++i)
+	{
+		int group = channelGroups[i];
+		jassert(group >= 0 && group <= m_groups.size());
+		while (m_groups.size() <= group)
+		{
+			ChannelGroup* g = new ChannelGroup(m_maxSize, m_numReaders);
+			g->timestamps.resize(m_numBlocks);
+			resetReaders(g);
+			m_groups.add(g);
+		}
+		m_groups[group]->channels.add(i);
+	}
+
+	if (m_int16Only)
 	{
-		m_fifos.add(new AbstractFifo(m_maxSize));
-		m_readSamples.add(0);
-		m_timestamps.add(new Array<int64>());
-		m_timestamps.getLast()->resize(m_numBlocks);
-		m_lastReadTimestamps.add(0);
+		m_samples.allocate(m_buffer, 0, 0, LargeSampleBlock::Placement());
+		m_rawBuffer.calloc(size_t(m_numChans) * m_maxSize);
 	}
-	m_buffer.setSize(nChans, m_maxSize);
+	else
+		m_samples.allocate(m_buffer, m_numChans, m_maxSize, LargeSampleBlock::Placement());
+}
+
+void DataQueue::setInt16Storage(bool int16Only)
+{
+	if (anyReadInProgress())
+		return;
+
+	m_int16Only = int16Only;
+}
+
+bool DataQueue::isInt16Storage() const
+{
+	return m_int16Only;
+}
+
+void DataQueue::setRawChannels(const Array<bool>& rawChannels)
+{
+	if (anyReadInProgress())
+		return;
+
+	m_rawChannels.clear();
+	bool anyRaw = false;
+	for (int i = 0; i < m_numChans; ++i)
+	{
+		bool raw = rawChannels[i];
+		m_rawChannels.add(raw);
+		anyRaw = anyRaw || raw;
+	}
+
+	m_conversionScales.clearQuick();
+	m_conversionScales.insertMultiple(0, 0.0f, m_numChans);
+	for (int i = 0; i < m_groups.size(); ++i)
+		m_groups[i]->convertedChannels.clearQuick();
+
+	if (anyRaw || m_int16Only)
+		m_rawBuffer.calloc(size_t(m_numChans) * m_maxSize);
+	else
+		m_rawBuffer.free();
+}
+
+void DataQueue::setConvertedChannels(const Array<float>& bitVolts)
+{
+	if (anyReadInProgress())
+		return;
+
+	bool anyConverted = false;
+	for (int i = 0; i < m_groups.size(); ++i)
+		m_groups[i]->convertedChannels.clearQuick();
+
+	for (int i = 0; i < m_numChans; ++i)
+	{
+		const float bv = bitVolts[i];
+		if (m_int16Only)
+		{
+			//raw channels too, for the blocks their source doesn't give the codes of
+			jassert(bv != 0.0f);
+			m_conversionScales.set(i, bv != 0.0f ? 1.0f / bv : 0.0f);
+			continue;
+		}
+
+		const bool converted = bv != 0.0f && !m_rawChannels[i];
+		m_conversionScales.set(i, converted ? 1.0f / bv : 0.0f);
+		if (converted)
+		{
+			m_groups[m_channelGroups[i]]->convertedChannels.add(i);
+			anyConverted = true;
+		}
+	}
+
+	if (anyConverted && m_rawBuffer == nullptr)
+		m_rawBuffer.calloc(size_t(m_numChans) * m_maxSize);
 }
 
 void DataQueue::resize(int nBlocks)
 {
-	if (m_readInProgress)
+	if (anyReadInProgress())
 		return;
 	
 	int size = m_blockSize*nBlocks;
 	m_maxSize = size;
 	m_numBlocks = nBlocks;
 
-	for (int i = 0; i < m_numChans; ++i)
+	for (int i = 0; i < m_groups.size(); ++i)
 	{
-		m_fifos[i]->setTotalSize(size);
-		m_fifos[i]->reset();
-		m_readSamples.set(i, 0);
-		m_timestamps[i]->resize(nBlocks);
-		m_lastReadTimestamps.set(i, 0);
+		ChannelGroup* g = m_groups[i];
+		g->fifo.setTotalSize(size);
+		g->timestamps.resize(nBlocks);
+		resetReaders(g);
 	}
-	m_buffer.setSize(m_numChans, size);
+	if (!m_int16Only)
+		m_samples.allocate(m_buffer, m_numChans, size, LargeSampleBlock::Placement());
+
+	if (m_rawBuffer != nullptr)
+		m_rawBuffer.calloc(size_t(m_numChans) * size);
 }
 
-void DataQueue::fillTimestamps(int channel, int index, int size, int64 timestamp)
+void DataQueue::setNumReaders(int numReaders)
+{
+	if (anyReadInProgress())
+		return;
+
+	m_numReaders = numReaders;
+	m_readInProgress.clearQuick();
+	m_readInProgress.insertMultiple(0, false, numReaders);
+	m_moreToRead.clearQuick();
+	m_moreToRead.insertMultiple(0, false, numReaders);
+	for (int i = 0; i < m_groups.size(); ++i)
+		resetReaders(m_groups[i]);
+}
+
+void DataQueue::attachReaders(int numReaders, int maxSamplesBack)
+{
+	if (anyReadInProgress())
+		return;
+
+	m_numReaders = numReaders;
+	m_readInProgress.clearQuick();
+	m_readInProgress.insertMultiple(0, false, numReaders);
+	m_moreToRead.clearQuick();
+	m_moreToRead.insertMultiple(0, false, numReaders);
+	for (int i = 0; i < m_groups.size(); ++i)
+	{
+		ChannelGroup* g = m_groups[i];
+		const int64 written = g->fifo.getWriteCount();
+		//the timestamp of the block the first sample is in must not have been overwritten yet
+		const int64 back = jmin(int64(maxSamplesBack), written, int64(m_maxSize - m_blockSize));
+		resetReaders(g, written - jmax(int64(0), back));
+	}
+}
+
+int DataQueue::getNumBlocks() const
+{
+	return m_numBlocks;
+}
+
+int DataQueue::getBlockSize() const
+{
+	return m_blockSize;
+}
+
+int64 DataQueue::getNumDroppedSamples() const
+{
+	return m_droppedSamples;
+}
+
+int64 DataQueue::getMemoryFootprint() const
+{
+	int64 bytes = MemoryFootprint::ofBuffer(m_buffer) + MemoryFootprint::ofBlock(m_rawBuffer, int64(m_numChans) * m_maxSize);
+
+	for (int i = 0; i < m_groups.size(); ++i)
+		bytes += MemoryFootprint::ofArray(m_groups[i]->timestamps);
+
+	return bytes;
+}
+
+int DataQueue::getNumReaders() const
+{
+	return m_numReaders;
+}
+
+int DataQueue::getNumGroups() const
+{
+	return m_groups.size();
+}
+
+const Array<int>& DataQueue::getGroupChannels(int group) const
+{
+	return m_groups[group]->channels;
+}
+
+void DataQueue::fillTimestamps(ChannelGroup* group, int index, int size, int64 timestamp)
 {
 	//Search for the next block start.
 	int blockMod = index % m_blockSize;
@@ -103,41 +318,81 @@ void DataQueue::fillTimestamps(int channel, int index, int size, int64 timestamp
 		if ((blockStartPos + i) < (index + size))
 		{
 			int64 ts = startTimestamp + (i*m_blockSize);
-			m_timestamps[channel]->set(blockIdx, ts);
+			group->timestamps.set(blockIdx, ts);
 		}
 
 	}
 }
 
-void DataQueue::writeChannel(const AudioSampleBuffer& buffer, int channel, int sourceChannel, int nSamples, int64 timestamp)
+void DataQueue::writeGroup(const AudioSampleBuffer& buffer, int group, const int* sourceChannels, const int16* const* rawData, int nSamples, int64 timestamp)
 {
+	ChannelGroup* g = m_groups[group];
 	int index1, size1, index2, size2;
-	m_fifos[channel]->prepareToWrite(nSamples, index1, size1, index2, size2);
+	g->fifo.prepareToWrite(nSamples, index1, size1, index2, size2);
+	const int nChans = g->channels.size();
 	if ((size1 + size2) < nSamples)
-	{ //TODO: turn this into a proper notification. Probably returning a bool.
-		std::cerr << "Recording Data Queue Overflow" << std::endl;
-	}
-	m_buffer.copyFrom(channel,
-		index1,
-		buffer,
-		sourceChannel,
-		0,
-		size1);
-	
-	fillTimestamps(channel, index1, size1, timestamp);
-	
-	if (size2 > 0)
 	{
+		//reported through getNumDroppedSamples(), the RecordNode raises the alarm. Groups differ in size,
+		//so the samples are counted for each of their channels
+		m_droppedSamples += int64(nSamples - (size1 + size2)) * nChans;
+	}
+
+	for (int i = 0; i < nChans; ++i)
+	{
+		int channel = g->channels.getUnchecked(i);
+		const int16* raw = (rawData != nullptr && m_rawChannels[channel]) ? rawData[i] : nullptr;
+
+		if (m_int16Only)
+		{
+			int16* dest = getInt16Buffer(channel);
+			if (raw != nullptr)
+			{
+				memcpy(dest + index1, raw, size1 * sizeof(int16));
+				if (size2 > 0)
+					memcpy(dest + index2, raw + size1, size2 * sizeof(int16));
+			}
+			else
+			{
+				const float* src = buffer.getReadPointer(sourceChannels[i]);
+				const float scale = m_conversionScales.getUnchecked(channel);
+				VectorOps::convertFloatToInt16(src, dest + index1, scale, size1);
+				if (size2 > 0)
+					VectorOps::convertFloatToInt16(src + size1, dest + index2, scale, size2);
+			}
+			continue;
+		}
+
 		m_buffer.copyFrom(channel,
-			index2,
+			index1,
 			buffer,
-			sourceChannel,
-			size1,
-			size2);
+			sourceChannels[i],
+			0,
+			size1);
+
+		if (size2 > 0)
+		{
+			m_buffer.copyFrom(channel,
+				index2,
+				buffer,
+				sourceChannels[i],
+				size1,
+				size2);
+		}
 
-		fillTimestamps(channel, index2, size2, timestamp + size1);
+		if (raw != nullptr)
+		{
+			int16* rawDest = getInt16Buffer(channel);
+			memcpy(rawDest + index1, raw, size1 * sizeof(int16));
+			if (size2 > 0)
+				memcpy(rawDest + index2, raw + size1, size2 * sizeof(int16));
+		}
 	}
-	m_fifos[channel]->finishedWrite(size1 + size2);
+
+	fillTimestamps(g, index1, size1, timestamp);
+	if (size2 > 0)
+		fillTimestamps(g, index2, size2, timestamp + size1);
+
+	g->fifo.finishedWrite(size1 + size2);
 }
 
 /* 
@@ -152,60 +407,257 @@ const AudioSampleBuffer& DataQueue::getAudioBufferReference() const
 	return m_buffer;
 }
 
-bool DataQueue::startRead(Array<CircularBufferIndexes>& indexes, Array<int64>& timestamps, int nMax)
+const int16* DataQueue::getRawBufferReference(int channel) const
+{
+	if (!m_rawChannels[channel])
+		return nullptr;
+
+	return getInt16Buffer(channel);
+}
+
+const int16* DataQueue::getConvertedBufferReference(int channel) const
+{
+	if (m_conversionScales[channel] == 0.0f)
+		return nullptr;
+
+	return getInt16Buffer(channel);
+}
+
+int16* DataQueue::getInt16Buffer(int channel) const
+{
+	return m_rawBuffer + (size_t(channel) * m_maxSize);
+}
+
+void DataQueue::convertRange(ChannelGroup* g, const CircularBufferIndexes& idx, int64 readStart)
+{
+	const int64 readEnd = readStart + idx.size1 + idx.size2;
+	const ScopedLock lock(g->convertLock);
+
+	//readers move forward from the same start, so the converted part is always at the beginning of the range,
+	//unless every reader skipped the samples before it in a gated queue
+	if (g->convertedEnd < readStart)
+		g->convertedEnd = readStart;
+	if (g->convertedEnd >= readEnd)
+		return;
+
+	int from = int(g->convertedEnd - readStart);
+	int remaining = int(readEnd - g->convertedEnd);
+
+	while (remaining > 0)
+	{
+		const bool first = from < idx.size1;
+		const int index = first ? idx.index1 + from : idx.index2 + (from - idx.size1);
+		const int n = jmin(remaining, first ? idx.size1 - from : idx.size2 - (from - idx.size1));
+
+		for (int i = 0; i < g->convertedChannels.size(); ++i)
+		{
+			const int channel = g->convertedChannels.getUnchecked(i);
+			VectorOps::convertFloatToInt16(m_buffer.getReadPointer(channel, index), getInt16Buffer(channel) + index,
+				m_conversionScales.getUnchecked(channel), n);
+		}
+
+		from += n;
+		remaining -= n;
+	}
+
+	g->convertedEnd = readEnd;
+}
+
+bool DataQueue::startRead(int reader, Array<CircularBufferIndexes>& indexes, Array<int64>& timestamps, int nMax)
 {
 	//This should never happen, but it never hurts to be on the safe side.
-	if (m_readInProgress)
+	if (m_readInProgress[reader])
 		return false;
 
-	m_readInProgress = true;
-	indexes.clear(); //Just in case it's not empty already
-	timestamps.clear();
+	m_readInProgress.setUnchecked(reader, true);
+	indexes.clearQuick(); //Just in case it's not empty already
+	indexes.insertMultiple(0, CircularBufferIndexes(), m_numChans);
+	timestamps.clearQuick();
+	timestamps.insertMultiple(0, 0, m_numChans);
+	bool moreToRead = false;
 
-	for (int chan = 0; chan < m_numChans; ++chan)
+	for (int group = 0; group < m_groups.size(); ++group)
 	{
+		ChannelGroup* g = m_groups[group];
 		CircularBufferIndexes idx;
-		int readyToRead = m_fifos[chan]->getNumReady();
+		int readyToRead = g->fifo.getNumReady(reader);
+		if (m_gated)
+		{
+			const int64 position = g->readPositions.getUnchecked(reader);
+			const int64 written = position + readyToRead;
+			bool moreAfter;
+			const int skip = getGatedRange(g, position, written, readyToRead, moreAfter);
+			if (skip > 0)
+				skipSamples(g, reader, position, written, skip);
+			moreToRead = moreToRead || moreAfter;
+		}
 		int samplesToRead = ((readyToRead > nMax) && (nMax > 0)) ? nMax : readyToRead;
 
-		m_fifos[chan]->prepareToRead(samplesToRead, idx.index1, idx.size1, idx.index2, idx.size2);
-		indexes.add(idx);
-		m_readSamples.set(chan, idx.size1 + idx.size2);
+		g->fifo.prepareToRead(reader, samplesToRead, idx.index1, idx.size1, idx.index2, idx.size2);
+		g->readSamples.setUnchecked(reader, idx.size1 + idx.size2);
 		
 		int blockMod = idx.index1 % m_blockSize;
 		int blockDiff = (blockMod == 0) ? 0 : (m_blockSize - blockMod);
+		int64 ts;
 
 		//If the next timestamp block is within the data we're reading, include the translated timestamp in the output
 		if (blockDiff < (idx.size1 + idx.size2))
 		{
 			int blockIdx = ((idx.index1 + blockDiff) / m_blockSize) % m_numBlocks;
-			int64 ts = m_timestamps[chan]->getUnchecked(blockIdx) - blockDiff;
-			timestamps.add(ts);
-			//update to the end of the block
-			m_lastReadTimestamps.set(chan, ts+ idx.size1 + idx.size2);
+			ts = g->timestamps.getUnchecked(blockIdx) - blockDiff;
 		}
 		//If not, copy the last sent again 
 		else
 		{
-			int64 ts = m_lastReadTimestamps[chan];
-			timestamps.add(ts);
-			m_lastReadTimestamps.set(chan, ts + idx.size1 + idx.size2);
+			ts = g->lastReadTimestamps.getUnchecked(reader);
+		}
+		//update to the end of the block
+		g->lastReadTimestamps.setUnchecked(reader, ts + idx.size1 + idx.size2);
+
+		if (g->convertedChannels.size() > 0 && idx.size1 + idx.size2 > 0)
+			convertRange(g, idx, g->readPositions.getUnchecked(reader));
+
+		for (int i = 0; i < g->channels.size(); ++i)
+		{
+			int chan = g->channels.getUnchecked(i);
+			indexes.setUnchecked(chan, idx);
+			timestamps.setUnchecked(chan, ts);
 		}
 	}
+	m_moreToRead.setUnchecked(reader, moreToRead);
 	return true;
 }
 
-void DataQueue::stopRead()
+void DataQueue::stopRead(int reader)
 {
-	if (!m_readInProgress)
+	if (!m_readInProgress[reader])
 		return;
 
-	for (int i = 0; i < m_numChans; ++i)
+	for (int i = 0; i < m_groups.size(); ++i)
+	{
+		ChannelGroup* g = m_groups[i];
+		g->fifo.finishedRead(reader, g->readSamples.getUnchecked(reader));
+		g->readPositions.setUnchecked(reader, g->readPositions.getUnchecked(reader) + g->readSamples.getUnchecked(reader));
+		g->readSamples.setUnchecked(reader, 0);
+	}
+	m_readInProgress.setUnchecked(reader, false);
+}
+
+float DataQueue::getBacklog(int reader) const
+{
+	if (reader < 0 || reader >= m_numReaders || m_maxSize <= 0)
+		return 0.0f;
+
+	int maxReady = 0;
+	for (int i = 0; i < m_groups.size(); ++i)
+		maxReady = jmax(maxReady, m_groups[i]->fifo.getNumReady(reader));
+
+	return float(maxReady) / float(m_maxSize);
+}
+
+void DataQueue::setGate(const Array<int>& holdSamples)
+{
+	if (anyReadInProgress())
+		return;
+
+	m_gated = holdSamples.size() > 0;
+	for (int i = 0; i < m_groups.size(); ++i)
+	{
+		ChannelGroup* g = m_groups[i];
+		const ScopedLock lock(g->gateLock);
+		g->gateWindows.clearQuick();
+		//so that adding windows doesn't allocate on the writer thread
+		g->gateWindows.ensureStorageAllocated(DATA_QUEUE_GATE_WINDOWS);
+		g->gateHold = m_gated ? jlimit(0, m_maxSize - m_blockSize, holdSamples[i]) : 0;
+	}
+}
+
+bool DataQueue::isGated() const
+{
+	return m_gated;
+}
+
+void DataQueue::addGateWindow(int group, int64 start, int64 end)
+{
+	ChannelGroup* g = m_groups[group];
+	start = jmax(start, g->fifo.getSlowestReadCount());
+	if (!m_gated || end <= start)
+		return;
+
+	const ScopedLock lock(g->gateLock);
+	//the windows every reader is done with
+	const int64 slowest = g->fifo.getSlowestReadCount();
+	int done = 0;
+	while (done < g->gateWindows.size() && g->gateWindows.getReference(done).getEnd() <= slowest)
+		++done;
+	g->gateWindows.removeRange(0, done);
+
+	if (g->gateWindows.size() > 0 && g->gateWindows.getReference(g->gateWindows.size() - 1).getEnd() >= start)
+	{
+		Range<int64>& last = g->gateWindows.getReference(g->gateWindows.size() - 1);
+		last = last.getUnionWith(Range<int64>(start, end));
+	}
+	else
+		g->gateWindows.add(Range<int64>(start, end));
+}
+
+int64 DataQueue::getWritePosition(int group) const
+{
+	return m_groups[group]->fifo.getWriteCount();
+}
+
+bool DataQueue::hasMoreToRead(int reader) const
+{
+	return m_moreToRead[reader];
+}
+
+int DataQueue::getGatedRange(ChannelGroup* g, int64 position, int64 written, int& available, bool& moreAfter)
+{
+	const ScopedLock lock(g->gateLock);
+	const int numWindows = g->gateWindows.size();
+	int w = 0;
+	while (w < numWindows && g->gateWindows.getReference(w).getEnd() <= position)
+		++w;
+
+	//later windows start after the ones already known, and no new window can start before the held back samples
+	int64 readStart = jmax(position, w < numWindows ? g->gateWindows.getReference(w).getStart() : written - g->gateHold);
+	readStart = jmin(readStart, written);
+
+	available = 0;
+	moreAfter = false;
+	if (w < numWindows && g->gateWindows.getReference(w).getStart() <= readStart)
+	{
+		const int64 readEnd = jmin(written, g->gateWindows.getReference(w).getEnd());
+		available = int(jmax(int64(0), readEnd - readStart));
+		moreAfter = readEnd < written && w + 1 < numWindows && g->gateWindows.getReference(w + 1).getStart() < written;
+	}
+	return int(readStart - position);
+}
+
+void DataQueue::skipSamples(ChannelGroup* g, int reader, int64 position, int64 written, int numSamples)
+{
+	//nothing past the reader has been overwritten yet, so the last block start skipped still has its timestamp
+	const int64 end = position + numSamples;
+	const int64 blockStart = end - (end % m_blockSize);
+	int64 ts;
+	if (blockStart >= position && blockStart < written)
+		ts = g->timestamps.getUnchecked(int((blockStart / m_blockSize) % m_numBlocks)) + (end - blockStart);
+	else
+		ts = g->lastReadTimestamps.getUnchecked(reader) + numSamples;
+
+	g->fifo.finishedRead(reader, numSamples);
+	g->readPositions.setUnchecked(reader, end);
+	g->lastReadTimestamps.setUnchecked(reader, ts);
+}
+
+void DataQueue::getStartTimestamps(Array<int64>& timestamps) const
+{
+	timestamps.clear();
+	for (int chan = 0; chan < m_numChans; ++chan)
 	{
-		m_fifos[i]->finishedRead(m_readSamples[i]);
-		m_readSamples.set(i, 0);
+		const ChannelGroup* g = m_groups[m_channelGroups[chan]];
+		timestamps.add(g->startPosition > 0 ? g->startTimestamp : g->timestamps[0]);
 	}
-	m_readInProgress = false;
 }
 
 void DataQueue::getTimestampsForBlock(int idx, Array<int64>& timestamps) const
@@ -213,6 +665,6 @@ void DataQueue::getTimestampsForBlock(int idx, Array<int64>& timestamps) const
 	timestamps.clear();
 	for (int chan = 0; chan < m_numChans; ++chan)
 	{
-		timestamps.add((*m_timestamps[chan])[idx]);
+		timestamps.add(m_groups[m_channelGroups[chan]]->timestamps[idx]);
 	}
 }
\ No newline at end of file
@@ -25,46 +25,159 @@
 #define DATAQUEUE_H_INCLUDED
 
 #include "../../../JuceLibraryCode/JuceHeader.h"
+#include "../DataThreads/DataBuffer.h"
+#include "../DataThreads/LargeSampleBlock.h"
+#include "MultiReaderFifo.h"
 
-struct CircularBufferIndexes
-{
-	int index1;
-	int size1;
-	int index2;
-	int size2;
-};
+/**
+Queue of continuous data between the RecordNode and the RecordThread.
+
+Channels are arranged in groups that always receive the same number of samples per block,
+typically all the channels of a subprocessor. Each group shares a single circular buffer cursor
+and block timestamp list, so writing or reading a block costs one FIFO operation per group instead
+of one per channel. A group can be as small as a single channel.
 
+Any number of readers, one per record engine, can read the queue independently, each with its own
+position. Space is only released to the writer once every reader has read it.
+*/
 class DataQueue
 {
 public:
 	DataQueue(int blockSize, int nBlocks);
 	~DataQueue();
-	void setChannels(int nChans);
+	/** Sets the number of channels and the group of each one. Groups must be numbered from 0 without gaps.
+	If nBlocks is positive the queue is resized to that many blocks at the same time */
+	void setChannels(const Array<int>& channelGroups, int nBlocks = 0);
+	/** Selects whether the samples are queued only as int16, converted by writeGroup() with the bitVolts given to
+	setConvertedChannels(), which must then cover every channel. This halves the memory needed for the same length,
+	but the audio buffer is left empty. Takes effect on the next setChannels() call */
+	void setInt16Storage(bool int16Only);
+	bool isInt16Storage() const;
+	/** Selects which channels also queue the original int16 codes of their samples. Must be called after setChannels */
+	void setRawChannels(const Array<bool>& rawChannels);
+	/** Gives the bitVolts of the channels, among those without original codes, whose samples the readers also get as int16,
+	rounded from the samples divided by bitVolts the way record engines storing integers do. A bitVolts of 0, or an empty
+	array, leaves channels out. Each range is converted only once, by the first reader to start reading it, so that
+	several engines don't repeat the same conversion. Must be called after setRawChannels */
+	void setConvertedChannels(const Array<float>& bitVolts);
 	void resize(int nBlocks);
+	int getNumBlocks() const;
+	int getBlockSize() const;
+	/** Sets the number of independent readers. Must be called after setChannels */
+	void setNumReaders(int numReaders);
+	/** Sets the number of readers without discarding what has been written, letting them start up to maxSamplesBack
+	samples before the current write position of each group, as far as the queue still holds. Meant for a queue that has
+	been written with no readers, so that they also get what came before they existed. Must be called after setChannels,
+	never at the same time as writeGroup() */
+	void attachReaders(int numReaders, int maxSamplesBack);
+	int getNumReaders() const;
 	void getTimestampsForBlock(int idx, Array<int64>& timestamps) const;
+	/** Makes the readers only get the samples of the windows given to addGateWindow(), skipping the rest. They hold
+	back from the last holdSamples[group] samples written to each group, though, since a window may still start there.
+	Disabled by an empty array. Must be called after setChannels */
+	void setGate(const Array<int>& holdSamples);
+	bool isGated() const;
+	/** Returns the timestamp of the first sample the readers get on each channel. Unless attachReaders() let them start
+	in the past, it's only valid once the first block has been written */
+	void getStartTimestamps(Array<int64>& timestamps) const;
+	int getNumGroups() const;
+	/** Returns the channels of a group, in increasing order */
+	const Array<int>& getGroupChannels(int group) const;
 
 	//Only the methods after this comment are considered thread-safe.
 	//Caution must be had to avoid calling more than one of the methods above simulatenously
-	void writeChannel(const AudioSampleBuffer& buffer, int channel, int sourceChannel, int nSamples, int64 timestamp);
-	bool startRead(Array<CircularBufferIndexes>& indexes, Array<int64>& timestamps, int nMax);
+	/** Writes the same number of samples for every channel of a group.
+	sourceChannels gives the buffer channel of each channel of the group, and rawData, if not null, the
+	raw codes of each of them, which can be null themselves */
+	void writeGroup(const AudioSampleBuffer& buffer, int group, const int* sourceChannels, const int16* const* rawData, int nSamples, int64 timestamp);
+	bool startRead(int reader, Array<CircularBufferIndexes>& indexes, Array<int64>& timestamps, int nMax);
+	/** Adds a window to a gated group, in positions of getWritePosition(). Windows must come in order of their end,
+	and start at most the group's hold samples before the write position. Called by the writer */
+	void addGateWindow(int group, int64 start, int64 end);
+	/** Returns the samples written to a group since the readers were reset */
+	int64 getWritePosition(int group) const;
+	/** Returns true if the last read of a gated queue stopped at the end of a window with more windows ready */
+	bool hasMoreToRead(int reader) const;
 	const AudioSampleBuffer& getAudioBufferReference() const;
-	void stopRead();
+	/** Returns the raw codes of a channel, indexed like the audio buffer, or nullptr if the channel doesn't queue them */
+	const int16* getRawBufferReference(int channel) const;
+	/** Returns the converted int16 samples of a channel, indexed like the audio buffer, or nullptr if it isn't converted.
+	Only the ranges handed out by startRead() are valid. With int16 storage, these are the only samples of a channel */
+	const int16* getConvertedBufferReference(int channel) const;
+	void stopRead(int reader);
+	/** Returns the fraction of the queue a reader still has to read, for its fullest group */
+	float getBacklog(int reader) const;
+	/** Returns the samples dropped because the queue was full, summed over the channels, since the last setChannels() */
+	int64 getNumDroppedSamples() const;
+	/** Returns the bytes allocated for the samples, their int16 codes and the block timestamps */
+	int64 getMemoryFootprint() const;
 	
 
 private:
-	void fillTimestamps(int channel, int index, int size, int64 timestamp);
-
-	OwnedArray<AbstractFifo> m_fifos;
+	struct ChannelGroup
+	{
+		ChannelGroup(int size, int numReaders) : fifo(size, numReaders), convertedEnd(0), startPosition(0), startTimestamp(0), gateHold(0) {}
+		MultiReaderFifo fifo;
+		Array<int> channels;
+		Array<int64> timestamps;
+		//per reader
+		Array<int> readSamples;
+		Array<int64> lastReadTimestamps;
+		/** Position of each reader, in samples written since the reset */
+		Array<int64> readPositions;
+		/** The channels converted to int16, and how far into the queue, in samples written since the reset, they are */
+		Array<int> convertedChannels;
+		int64 convertedEnd;
+		CriticalSection convertLock;
+		/** Where the readers started, and the timestamp there if it's past 0 */
+		int64 startPosition;
+		int64 startTimestamp;
+		/** The gate windows not yet read by every reader, sorted and without overlaps */
+		Array<Range<int64>> gateWindows;
+		int gateHold;
+		CriticalSection gateLock;
+	};
+
+	/** For a gated group, returns how many samples a reader at position has to skip, and in available
+	how many it can then read, with moreAfter telling if there are windows ready after those */
+	int getGatedRange(ChannelGroup* group, int64 position, int64 written, int& available, bool& moreAfter);
+	/** Skips the samples of a reader up to a gated range, keeping track of the timestamp */
+	void skipSamples(ChannelGroup* group, int reader, int64 position, int64 written, int numSamples);
+
+	/** Sets the readers of a group at startPosition, keeping what has been written, or, if it's negative,
+	resets the group discarding it */
+	void resetReaders(ChannelGroup* group, int64 startPosition = -1);
+
+	/** Converts the part of a reader's range that no other reader has converted yet */
+	void convertRange(ChannelGroup* group, const CircularBufferIndexes& idx, int64 readStart);
+
+	/** Int16 buffer of a channel in m_rawBuffer */
+	int16* getInt16Buffer(int channel) const;
+
+	void fillTimestamps(ChannelGroup* group, int index, int size, int64 timestamp);
+
+	OwnedArray<ChannelGroup> m_groups;
+	Array<int> m_channelGroups;
+	LargeSampleBlock m_samples;		// huge pages, placed as the processing thread first writes them
 	AudioSampleBuffer m_buffer;
-	Array<int> m_readSamples;
-	OwnedArray<Array<int64>> m_timestamps;
-	Array<int64> m_lastReadTimestamps;
+	/** Both the raw codes and the converted samples, one m_maxSize stretch per channel */
+	HeapBlock<int16> m_rawBuffer;
+	Array<bool> m_rawChannels;
+	/** 1/bitVolts for the converted channels, 0 for the others */
+	Array<float> m_conversionScales;
+	bool m_int16Only;
+	bool m_gated;
+	//per reader
+	Array<bool> m_moreToRead;
 
 	int m_numChans;
 	const int m_blockSize;
-	bool m_readInProgress;
+	Array<bool> m_readInProgress;
+	bool anyReadInProgress() const;
+	int m_numReaders;
 	int m_numBlocks;
 	int m_maxSize;
+	std::atomic<int64> m_droppedSamples;
 
 	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DataQueue);
 };
@@ -0,0 +1,203 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "EventQueue.h"
+#include "../GenericProcessor/MemoryFootprint.h"
+
+EventQueue::EventQueue(int numEvents, int numBytes)
+	: m_slotFifo(numEvents),
+	m_byteFifo(numBytes),
+	m_writeBytes(0),
+	m_droppedEvents(0)
+{
+	m_readSlots.add(0);
+	m_readBytes.add(0);
+	m_slots.calloc(numEvents);
+	m_bytes.calloc(numBytes);
+}
+
+EventQueue::~EventQueue()
+{
+}
+
+void EventQueue::reset()
+{
+	m_slotFifo.reset();
+	m_byteFifo.reset();
+	for (int i = 0; i < m_readSlots.size(); ++i)
+	{
+		m_readSlots.set(i, 0);
+		m_readBytes.set(i, 0);
+	}
+	m_droppedEvents = 0;
+}
+
+void EventQueue::setNumReaders(int numReaders)
+{
+	m_slotFifo.setNumReaders(numReaders);
+	m_byteFifo.setNumReaders(numReaders);
+	m_readSlots.clearQuick();
+	m_readSlots.insertMultiple(0, 0, numReaders);
+	m_readBytes.clearQuick();
+	m_readBytes.insertMultiple(0, 0, numReaders);
+	reset();
+}
+
+void EventQueue::resize(int numEvents, int numBytes)
+{
+	m_slotFifo.setTotalSize(numEvents);
+	m_byteFifo.setTotalSize(numBytes);
+	m_slots.calloc(numEvents);
+	m_bytes.calloc(numBytes);
+	reset();
+}
+
+int EventQueue::getRemainingEvents(int reader) const
+{
+	return m_slotFifo.getNumReady(reader);
+}
+
+int64 EventQueue::getNumDroppedEvents() const
+{
+	return m_droppedEvents;
+}
+
+int64 EventQueue::getMemoryFootprint() const
+{
+	return MemoryFootprint::ofBlock(m_slots, m_slotFifo.getTotalSize())
+		+ MemoryFootprint::ofBlock(m_bytes, m_byteFifo.getTotalSize());
+}
+
+uint8* EventQueue::prepareEvent(int dataSize, int64 t, int extra, const SpikeChannel* channel)
+{
+	int pos1, size1, pos2, size2;
+
+	m_slotFifo.prepareToWrite(1, pos1, size1, pos2, size2);
+	if (size1 < 1)
+	{
+		/* This means there is a buffer overrun. Instead of overwritting the existing data and risking a collision of both threads
+		we just skip the incoming event. */
+		m_droppedEvents++;
+		return nullptr;
+	}
+	Slot& slot = m_slots[pos1];
+
+	m_byteFifo.prepareToWrite(dataSize, pos1, size1, pos2, size2);
+	int padding = 0;
+	if (size1 < dataSize && size1 + size2 == dataSize)
+	{
+		//not enough room before the end of the ring: skip it and start over at the beginning
+		padding = size1;
+		m_byteFifo.prepareToWrite(padding + dataSize, pos1, size1, pos2, size2);
+		if (size2 < dataSize)
+		{
+			m_droppedEvents++;
+			return nullptr;
+		}
+		pos1 = pos2;
+	}
+	else if (size1 < dataSize)
+	{
+		m_droppedEvents++;
+		return nullptr;
+	}
+
+	slot.dataOffset = pos1;
+	slot.dataSize = dataSize;
+	slot.padding = padding;
+	slot.timestamp = t;
+	slot.extra = extra;
+	slot.channel = channel;
+	m_writeBytes = padding + dataSize;
+
+	return m_bytes + pos1;
+}
+
+void EventQueue::finishEvent()
+{
+	m_byteFifo.finishedWrite(m_writeBytes);
+	m_slotFifo.finishedWrite(1);
+}
+
+void EventQueue::addEvent(const MidiMessage& ev, int64 t, int extra)
+{
+	uint8* data = prepareEvent(ev.getRawDataSize(), t, extra, nullptr);
+	if (data == nullptr)
+		return;
+
+	memcpy(data, ev.getRawData(), ev.getRawDataSize());
+	finishEvent();
+}
+
+void EventQueue::addEvent(const SpikeEvent& ev, int64 t, int extra)
+{
+	const SpikeChannel* channel = ev.getChannelInfo();
+	int dataSize = SPIKE_BASE_SIZE + channel->getNumChannels() * sizeof(float) + channel->getDataSize() + channel->getTotalEventMetaDataSize();
+
+	uint8* data = prepareEvent(dataSize, t, extra, channel);
+	if (data == nullptr)
+		return;
+
+	ev.serialize(data, dataSize);
+	finishEvent();
+}
+
+int EventQueue::startRead(int reader, Array<QueuedEvent>& events, int max)
+{
+	//a read not released is released now
+	stopRead(reader);
+
+	int pos1, size1, pos2, size2;
+	int numAvailable = m_slotFifo.getNumReady(reader);
+	int numToRead = ((max < numAvailable) && (max > 0)) ? max : numAvailable;
+	m_slotFifo.prepareToRead(reader, numToRead, pos1, size1, pos2, size2);
+
+	int readBytes = 0;
+	events.clearQuick();
+	events.ensureStorageAllocated(numToRead);
+	for (int i = 0; i < size1 + size2; ++i)
+	{
+		const Slot& slot = m_slots[i < size1 ? pos1 + i : pos2 + i - size1];
+		QueuedEvent ev;
+		ev.data = m_bytes + slot.dataOffset;
+		ev.dataSize = slot.dataSize;
+		ev.timestamp = slot.timestamp;
+		ev.extra = slot.extra;
+		ev.channel = slot.channel;
+		events.add(ev);
+		readBytes += slot.padding + slot.dataSize;
+	}
+	m_readBytes.setUnchecked(reader, readBytes);
+	m_readSlots.setUnchecked(reader, size1 + size2);
+	return size1 + size2;
+}
+
+void EventQueue::stopRead(int reader)
+{
+	if (m_readSlots[reader] == 0)
+		return;
+	m_byteFifo.finishedRead(reader, m_readBytes[reader]);
+	m_slotFifo.finishedRead(reader, m_readSlots[reader]);
+	m_readSlots.setUnchecked(reader, 0);
+	m_readBytes.setUnchecked(reader, 0);
+}
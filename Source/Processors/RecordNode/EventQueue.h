@@ -26,116 +26,95 @@
 
 #include "../../../JuceLibraryCode/JuceHeader.h"
 #include "../Events/Events.h"
-#include <vector>
+#include "MultiReaderFifo.h"
+#include <atomic>
 
-template <class MsgContainer>
-class AsyncEventMessage :
-	public ReferenceCountedObject
+/**
+Single-producer, multiple-consumer queue handing serialized events and spikes from the
+processing thread to the record thread.
+
+Each entry is a fixed-size slot holding the timestamp and index of the event, pointing at its
+serialized bytes in a preallocated byte ring. Both are sized at construction, so adding an event
+allocates nothing: it is a copy of its bytes, and a dropped event if either is full. An entry
+never wraps around the end of the byte ring; the bytes left before the end are skipped instead.
+
+Each reader, one per record engine, gets the entries in place with startRead(), and releases them
+with stopRead(). An entry is only freed once every reader has released it.
+*/
+class EventQueue
 {
 public:
-	AsyncEventMessage(const MsgContainer& m, int64 t, int extra) : 
-		ReferenceCountedObject(),
-		m_data(m),
-		m_timestamp(t),
-		m_extra(extra)
-	{}
+	struct QueuedEvent
+	{
+		const uint8* data;
+		int dataSize;
+		int64 timestamp;
+		int extra;
+		/** The spike channel of a spike, nullptr for events */
+		const SpikeChannel* channel;
+	};
 
-	~AsyncEventMessage() {};
+	EventQueue(int numEvents, int numBytes);
+	~EventQueue();
 
-	const MsgContainer& getData() const { return m_data;  }
-	const int64& getTimestamp() const { return m_timestamp; }
-	const int& getExtra() const { return m_extra;  }
+	/** Empties the queue. Not to be called while either thread is using it */
+	void reset();
+	void resize(int numEvents, int numBytes);
+	/** Sets the number of independent readers and empties the queue. Not to be called while either thread is using it */
+	void setNumReaders(int numReaders);
 
-private:
-	const MsgContainer m_data;
-	const int64 m_timestamp;
-	const int m_extra;
+	int getRemainingEvents(int reader) const;
 
-};
+	/** Returns the number of events dropped because the queue was full, since the last reset() */
+	int64 getNumDroppedEvents() const;
 
-template <class EventClass>
-class EventQueue
-{
-public:
-	typedef AsyncEventMessage<EventClass> EventContainer;
-	typedef ReferenceCountedObjectPtr<EventContainer> EventClassPtr;
+	/** Returns the bytes allocated for the entries and their data */
+	int64 getMemoryFootprint() const;
 
-	EventQueue(int size) :
-		m_fifo(size)
-	{
-		m_data.resize(size);
-	}
+	//Only the methods after this comment are considered thread-safe, with one writer and one thread per reader.
+	void addEvent(const MidiMessage& ev, int64 t, int extra = 0);
+	void addEvent(const SpikeEvent& ev, int64 t, int extra = 0);
 
-	~EventQueue()
-	{}
+	/** Fills events with up to max entries (all of them if max is 0) pointing into the queue, which stay
+	valid until stopRead() */
+	int startRead(int reader, Array<QueuedEvent>& events, int max);
+	void stopRead(int reader);
 
-	int getRemainingEvents() const
+private:
+	struct Slot
 	{
-		return m_fifo.getNumReady();
-	}
+		int dataOffset;
+		int dataSize;
+		/** Bytes skipped at the end of the ring before the data */
+		int padding;
+		int64 timestamp;
+		int extra;
+		const SpikeChannel* channel;
+	};
 
-	void reset()
-	{
-		m_data.clear();
-		m_data.resize(m_fifo.getTotalSize());
-	}
+	/** Reserves dataSize contiguous bytes and a slot, returning the data pointer, or nullptr if full */
+	uint8* prepareEvent(int dataSize, int64 t, int extra, const SpikeChannel* channel);
+	void finishEvent();
 
-	void resize(int size)
-	{
-		m_data.clear();
-		m_fifo.setTotalSize(size);
-		m_data.resize(size);
-	}
+	HeapBlock<Slot> m_slots;
+	MultiReaderFifo m_slotFifo;
+	HeapBlock<uint8> m_bytes;
+	MultiReaderFifo m_byteFifo;
 
-	void addEvent(const EventClass& ev, int64 t, int extra = 0)
-	{
-		int pos1, size1, pos2, size2;
-		size1 = 0;
-		m_fifo.prepareToWrite(1, pos1, size1, pos2, size2);
-
-		/* This means there is a buffer overrun. Instead of overwritting the existing data and risking a collision of both threads
-			we just skip the incoming samples. TODO: use this to notify of the overrun and act consequently   */
-		if (size1 > 0)
-		{
-			m_data[pos1] = new EventContainer(ev, t, extra);
-			m_fifo.finishedWrite(1);
-		}
-	}
-
-	int getEvents(std::vector<EventClassPtr>& vec, int max)
-	{
-		int pos1, size1, pos2, size2;
-		int numAvailable = m_fifo.getNumReady();
-		int numToRead = ((max < numAvailable) && (max > 0)) ? max : numAvailable;
-		m_fifo.prepareToRead(numToRead, pos1, size1, pos2, size2);
-		vec.resize(numToRead);
-		for (int i = 0; i < size1; ++i)
-		{
-			vec[i] = m_data[pos1 + i];
-		}
-		if (size2 > 0)
-		{
-			for (int i = 0; i < size2; ++i)
-			{
-				vec[size1 + i] = m_data[pos2 + i];
-			}
-		}
-		m_fifo.finishedRead(numToRead);
-		return numToRead;
-	}
+	//writer side, between prepareEvent and finishEvent
+	int m_writeBytes;
 
-private:
-	std::vector<EventClassPtr> m_data;
-	AbstractFifo m_fifo;
+	//reader side, between startRead and stopRead, per reader
+	Array<int> m_readSlots;
+	Array<int> m_readBytes;
+
+	std::atomic<int64> m_droppedEvents;
 
 	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EventQueue);
 };
 //NOTE: Events are sent as midimessages while spikes as spike objects due to the difference on how they are passed to the record node.
-//Once the probe system is implemented, this will be normalized
-typedef EventQueue<MidiMessage> EventMsgQueue;
-typedef EventQueue<SpikeEvent> SpikeMsgQueue;
-typedef ReferenceCountedObjectPtr<AsyncEventMessage<MidiMessage>> EventMessagePtr;
-typedef ReferenceCountedObjectPtr<AsyncEventMessage<SpikeEvent>> SpikeMessagePtr;
+//Once the probe system is implemented, this will be normalized. Both are now queued serialized.
+typedef EventQueue EventMsgQueue;
+typedef EventQueue SpikeMsgQueue;
 
 #endif  // EVENTQUEUE_H_INCLUDED
-
@@ -0,0 +1,139 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2017 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "MultiReaderFifo.h"
+
+MultiReaderFifo::MultiReaderFifo(int capacity, int numReaders)
+	: m_bufferSize(capacity),
+	m_numReaders(0),
+	m_writeCount(0)
+{
+	setNumReaders(numReaders);
+}
+
+MultiReaderFifo::~MultiReaderFifo()
+{
+}
+
+int MultiReaderFifo::getTotalSize() const
+{
+	return m_bufferSize;
+}
+
+int MultiReaderFifo::getNumReaders() const
+{
+	return m_numReaders;
+}
+
+void MultiReaderFifo::setTotalSize(int capacity)
+{
+	m_bufferSize = capacity;
+	reset();
+}
+
+void MultiReaderFifo::setNumReaders(int numReaders)
+{
+	m_numReaders = numReaders;
+	m_readCounts.malloc(jmax(numReaders, 1));
+	reset();
+}
+
+void MultiReaderFifo::attachReaders(int numReaders, int64 readPosition)
+{
+	jassert(readPosition <= m_writeCount && m_writeCount - readPosition <= m_bufferSize);
+	m_numReaders = numReaders;
+	m_readCounts.malloc(jmax(numReaders, 1));
+	for (int i = 0; i < m_numReaders; ++i)
+		m_readCounts[i] = readPosition;
+}
+
+int64 MultiReaderFifo::getWriteCount() const
+{
+	return m_writeCount.load(std::memory_order_acquire);
+}
+
+int64 MultiReaderFifo::getSlowestReadCount() const
+{
+	int64 slowest = m_writeCount.load(std::memory_order_acquire);
+	for (int i = 0; i < m_numReaders; ++i)
+		slowest = jmin(slowest, m_readCounts[i].load(std::memory_order_acquire));
+	return slowest;
+}
+
+void MultiReaderFifo::reset()
+{
+	m_writeCount = 0;
+	for (int i = 0; i < m_numReaders; ++i)
+		m_readCounts[i] = 0;
+}
+
+int MultiReaderFifo::getFreeSpace() const
+{
+	const int64 written = m_writeCount.load(std::memory_order_relaxed);
+	int64 slowest = written;
+	for (int i = 0; i < m_numReaders; ++i)
+		slowest = jmin(slowest, m_readCounts[i].load(std::memory_order_acquire));
+
+	return m_bufferSize - int(written - slowest);
+}
+
+int MultiReaderFifo::getNumReady(int reader) const
+{
+	return int(m_writeCount.load(std::memory_order_acquire) - m_readCounts[reader].load(std::memory_order_relaxed));
+}
+
+void MultiReaderFifo::getBlocks(int64 position, int num, int& startIndex1, int& blockSize1, int& startIndex2, int& blockSize2) const
+{
+	if (num <= 0 || m_bufferSize <= 0)
+	{
+		startIndex1 = startIndex2 = 0;
+		blockSize1 = blockSize2 = 0;
+		return;
+	}
+	startIndex1 = int(position % m_bufferSize);
+	blockSize1 = jmin(num, m_bufferSize - startIndex1);
+	startIndex2 = 0;
+	blockSize2 = num - blockSize1;
+}
+
+void MultiReaderFifo::prepareToWrite(int numToWrite, int& startIndex1, int& blockSize1, int& startIndex2, int& blockSize2) const
+{
+	getBlocks(m_writeCount.load(std::memory_order_relaxed), jmin(numToWrite, getFreeSpace()),
+		startIndex1, blockSize1, startIndex2, blockSize2);
+}
+
+void MultiReaderFifo::finishedWrite(int numWritten)
+{
+	m_writeCount.store(m_writeCount.load(std::memory_order_relaxed) + numWritten, std::memory_order_release);
+}
+
+void MultiReaderFifo::prepareToRead(int reader, int numWanted, int& startIndex1, int& blockSize1, int& startIndex2, int& blockSize2) const
+{
+	getBlocks(m_readCounts[reader].load(std::memory_order_relaxed), jmin(numWanted, getNumReady(reader)),
+		startIndex1, blockSize1, startIndex2, blockSize2);
+}
+
+void MultiReaderFifo::finishedRead(int reader, int numRead)
+{
+	m_readCounts[reader].store(m_readCounts[reader].load(std::memory_order_relaxed) + numRead, std::memory_order_release);
+}
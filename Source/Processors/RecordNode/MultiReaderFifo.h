@@ -0,0 +1,85 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2017 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef MULTIREADERFIFO_H_INCLUDED
+#define MULTIREADERFIFO_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include <atomic>
+
+/**
+Index manager for a circular buffer with one writer and any number of independent readers.
+
+It works like AbstractFifo, except that each reader has its own read position and the space is
+only released to the writer once every reader has gone past it. A slow reader only delays the
+writer when the buffer is full, never the other readers. Positions are kept as total counts
+since the last reset, so the whole buffer can be filled.
+
+With no readers, every write is considered as read immediately.
+*/
+class MultiReaderFifo
+{
+public:
+	MultiReaderFifo(int capacity, int numReaders = 1);
+	~MultiReaderFifo();
+
+	int getTotalSize() const;
+	int getNumReaders() const;
+
+	//These methods are not thread-safe, and reset the positions.
+	void setTotalSize(int capacity);
+	void setNumReaders(int numReaders);
+	/** Sets the number of readers keeping the write position, with all of them at readPosition, which must
+	be at most getTotalSize() items behind it. Not thread-safe, but it doesn't reset anything */
+	void attachReaders(int numReaders, int64 readPosition);
+	void reset();
+
+	/** Returns the number of items written since the last reset */
+	int64 getWriteCount() const;
+	/** Returns the number of items the slowest reader has read since the last reset */
+	int64 getSlowestReadCount() const;
+
+	/** Returns the space available to the writer, limited by the slowest reader */
+	int getFreeSpace() const;
+	/** Returns the number of items written and not yet read by a reader */
+	int getNumReady(int reader) const;
+
+	void prepareToWrite(int numToWrite, int& startIndex1, int& blockSize1, int& startIndex2, int& blockSize2) const;
+	void finishedWrite(int numWritten);
+
+	void prepareToRead(int reader, int numWanted, int& startIndex1, int& blockSize1, int& startIndex2, int& blockSize2) const;
+	void finishedRead(int reader, int numRead);
+
+private:
+	void getBlocks(int64 position, int num, int& startIndex1, int& blockSize1, int& startIndex2, int& blockSize2) const;
+
+	int m_bufferSize;
+	int m_numReaders;
+	std::atomic<int64> m_writeCount;
+	HeapBlock<std::atomic<int64>> m_readCounts;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MultiReaderFifo);
+};
+
+
+#endif  // MULTIREADERFIFO_H_INCLUDED
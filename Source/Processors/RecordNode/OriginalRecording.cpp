@@ -33,7 +33,6 @@ OriginalRecording::OriginalRecording() : separateFiles(false),
     continuousDataFloatBuffer = new float[10000];
 
     recordMarker = new char[10];*/
-	continuousDataIntegerBuffer.malloc(10000);
 	continuousDataFloatBuffer.malloc(10000);
 	recordMarker.malloc(10);
 
@@ -48,15 +47,7 @@ OriginalRecording::OriginalRecording() : separateFiles(false),
 
 OriginalRecording::~OriginalRecording()
 {
-    //Cleanup just in case
-    for (int i=0; i < fileArray.size(); i++)
-    {
-        if (fileArray[i] != nullptr) fclose(fileArray[i]);
-    }
-    for (int i=0; i < spikeFileArray.size(); i++)
-    {
-        if (spikeFileArray[i] != nullptr) fclose(spikeFileArray[i]);
-    }
+    //Any file still open is closed by AsyncRecordEngine
  /*   delete continuousDataFloatBuffer;
     delete continuousDataIntegerBuffer;
     delete recordMarker;*/
@@ -76,6 +67,7 @@ void OriginalRecording::resetChannels()
 {
     fileArray.clear();
     spikeFileArray.clear();
+    channelRecords.clear();
     blockIndex.clear();
     processorArray.clear();
     samplesSinceLastTimestamp.clear();
@@ -102,6 +94,7 @@ void OriginalRecording::openFiles(File rootFolder, int experimentNumber, int rec
 		openFile(rootFolder, ch, getRealChannel(i));
 		blockIndex.add(0);
 		samplesSinceLastTimestamp.add(0);
+		channelRecords.add(new ChannelRecords());
 	}
     for (int i = 0; i < spikeFileArray.size(); i++)
     {
@@ -111,7 +104,7 @@ void OriginalRecording::openFiles(File rootFolder, int experimentNumber, int rec
 
 void OriginalRecording::openFile(File rootFolder, const InfoObjectCommon* ch, int channelIndex)
 {
-    FILE* chFile;
+    AsyncWriteFile* chFile;
     bool isEvent;
     String fullPath(rootFolder.getFullPathName() + rootFolder.separatorString);
     String fileName;
@@ -138,11 +131,9 @@ void OriginalRecording::openFile(File rootFolder, const InfoObjectCommon* ch, in
 
     bool fileExists = f.exists();
 
-    diskWriteLock.enter();
+    chFile = openAsyncFile(f, true);
 
-    chFile = fopen(fullPath.toUTF8(), "ab");
-
-    if (!fileExists)
+    if (!fileExists && chFile != nullptr)
     {
         // create and write header
         std::cout << "Writing header." << std::endl;
@@ -151,7 +142,7 @@ void OriginalRecording::openFile(File rootFolder, const InfoObjectCommon* ch, in
         std::cout << "File ID: " << chFile << ", number of bytes: " << header.getNumBytesAsUTF8() << std::endl;
 
 
-        fwrite(header.toUTF8(), 1, header.getNumBytesAsUTF8(), chFile);
+        chFile->write(header.toUTF8(), header.getNumBytesAsUTF8());
 
         std::cout << "Wrote header." << std::endl;
 
@@ -161,7 +152,6 @@ void OriginalRecording::openFile(File rootFolder, const InfoObjectCommon* ch, in
     else
     {
         std::cout << "File already exists, just opening." << std::endl;
-        fseek(chFile, 0, SEEK_END);
     }
 
     if (isEvent)
@@ -180,18 +170,17 @@ void OriginalRecording::openFile(File rootFolder, const InfoObjectCommon* ch, in
         ChannelInfo* c = new ChannelInfo();
         c->filename = fileName;
         c->name = ch->getName();
-        c->startPos = ftell(chFile);
+        c->startPos = chFile != nullptr ? long(chFile->getPosition()) : 0;
         c->bitVolts = dynamic_cast<const DataChannel*>(ch)->getBitVolts();
         processorArray.getLast()->channels.add(c);
     }
-    diskWriteLock.exit();
 
 }
 
 void OriginalRecording::openSpikeFile(File rootFolder, const SpikeChannel* elec, int channelIndex)
 {
 
-    FILE* spFile;
+    AsyncWriteFile* spFile;
     String fullPath(rootFolder.getFullPathName() + rootFolder.separatorString);
     fullPath += elec->getName().removeCharacters(" ");
 
@@ -208,23 +197,20 @@ void OriginalRecording::openSpikeFile(File rootFolder, const SpikeChannel* elec,
 
     bool fileExists = f.exists();
 
-    diskWriteLock.enter();
-
-    spFile = fopen(fullPath.toUTF8(),"ab");
+    spFile = openAsyncFile(f, true);
 
-    if (!fileExists)
+    if (!fileExists && spFile != nullptr)
     {
         String header = generateSpikeHeader(elec);
-        fwrite(header.toUTF8(), 1, header.getNumBytesAsUTF8(), spFile);
+        spFile->write(header.toUTF8(), header.getNumBytesAsUTF8());
     }
-    diskWriteLock.exit();
     spikeFileArray.set(channelIndex,spFile);
 
 }
 
 void OriginalRecording::openMessageFile(File rootFolder)
 {
-    FILE* mFile;
+    AsyncWriteFile* mFile;
     String fullPath(rootFolder.getFullPathName() + rootFolder.separatorString);
 
 	fullPath += "messages";
@@ -242,13 +228,10 @@ void OriginalRecording::openMessageFile(File rootFolder)
 
     //bool fileExists = f.exists();
 
-    diskWriteLock.enter();
-
-    mFile = fopen(fullPath.toUTF8(),"ab");
+    mFile = openAsyncFile(f, true);
 
     //If this file needs a header, it goes here
 
-    diskWriteLock.exit();
     messageFile = mFile;
 
 }
@@ -403,12 +386,10 @@ void OriginalRecording::writeMessage(String message, uint16 processorID, uint16
 
     String timestampText(timestamp);
 
-    diskWriteLock.enter();
-    fwrite(timestampText.toUTF8(),1,timestampText.length(),messageFile);
-    fwrite(" ",1,1,messageFile);
-    fwrite(message.toUTF8(),1,msgLength,messageFile);
-    fwrite("\n",1,1,messageFile);
-    diskWriteLock.exit();
+    messageFile->write(timestampText.toUTF8(), timestampText.length());
+    messageFile->write(" ", 1);
+    messageFile->write(message.toUTF8(), msgLength);
+    messageFile->write("\n", 1);
 
 }
 
@@ -434,18 +415,26 @@ void OriginalRecording::writeTTLEvent(int eventIndex, const MidiMessage& event)
 	*(data + 13) = static_cast<uint8>(ev->getChannel());
 	*reinterpret_cast<uint16*>(data + 14) = static_cast<uint16>(recordingNumber);
     
+    eventFile->write(&data, 16 * sizeof(uint8));
 
-    diskWriteLock.enter();
+}
 
-    fwrite(&data,					// ptr
-           sizeof(uint8),   							// size of each element
-           16, 		  						// count
-           eventFile);   			// ptr to FILE object
+void OriginalRecording::writeData(int writeChannel, int realChannel, const float* buffer, int size)
+{
+	writeChannelSamples(writeChannel, buffer, nullptr, size);
+}
 
-    diskWriteLock.exit();
+void OriginalRecording::writeDataInt16(int writeChannel, int realChannel, const float* buffer, const int16* samples, int size)
+{
+	writeChannelSamples(writeChannel, buffer, samples, size);
 }
 
-void OriginalRecording::writeData(int writeChannel, int realChannel, const float* buffer, int size)
+bool OriginalRecording::storesInt16Samples() const
+{
+	return true;
+}
+
+void OriginalRecording::writeChannelSamples(int writeChannel, const float* buffer, const int16* samples, int size)
 {
 	int samplesWritten = 0;
 
@@ -462,6 +451,7 @@ void OriginalRecording::writeData(int writeChannel, int realChannel, const float
 
                     // write buffer to disk!
                     writeContinuousBuffer(buffer + samplesWritten,
+                                          samples != nullptr ? samples + samplesWritten : nullptr,
                                           numSamplesToWrite,
                                           writeChannel);
 
@@ -478,6 +468,7 @@ void OriginalRecording::writeData(int writeChannel, int realChannel, const float
 
                     // write buffer to disk!
                     writeContinuousBuffer(buffer + samplesWritten,
+                                          samples != nullptr ? samples + samplesWritten : nullptr,
                                           numSamplesToWrite,
                                           writeChannel);
 
@@ -489,88 +480,79 @@ void OriginalRecording::writeData(int writeChannel, int realChannel, const float
                 }
             }
 
+	flushChannelRecords(writeChannel);
 
 }
 
-void OriginalRecording::writeContinuousBuffer(const float* data, int nSamples, int writeChannel)
+void OriginalRecording::writeContinuousBuffer(const float* data, const int16* samples, int nSamples, int writeChannel)
 {
     // check to see if the file exists
 	if (fileArray[writeChannel] == nullptr)
         return;
 
-    // scale the data back into the range of int16
-    float scaleFactor =  float(0x7fff) * getDataChannel(getRealChannel(writeChannel))->getBitVolts();
-
-    for (int n = 0; n < nSamples; n++)
+    ChannelRecords* records = channelRecords[writeChannel];
+    size_t needed = records->size + RECORD_BYTES;
+    if (needed > records->capacity)
     {
-        *(continuousDataFloatBuffer+n) = *(data+n) / scaleFactor;
+        records->capacity = jmax(needed, 2 * records->capacity);
+        records->data.realloc(records->capacity);
     }
-    AudioDataConverters::convertFloatToInt16BE(continuousDataFloatBuffer, continuousDataIntegerBuffer, nSamples);
 
 	if (blockIndex[writeChannel] == 0)
     {
-		writeTimestampAndSampleCount(fileArray[writeChannel], writeChannel);
+        // the timestamp of the record's first sample, its sample count and the recording number
+        char* header = records->data + records->size;
+        int64 ts = getTimestamp(writeChannel) + samplesSinceLastTimestamp[writeChannel];
+        uint16 samps = BLOCK_LENGTH;
+        uint16 recNum = uint16(recordingNumber);
+        memcpy(header, &ts, 8);
+        memcpy(header + 8, &samps, 2);
+        memcpy(header + 10, &recNum, 2);
+        records->size += RECORD_HEADER_BYTES;
     }
 
-    diskWriteLock.enter();
-
-    size_t count = fwrite(continuousDataIntegerBuffer, // ptr
-                          2,                               // size of each element
-                          nSamples,                        // count
-						  fileArray[writeChannel]); // ptr to FILE object
-
-    //std::cout << channel << " : " << nSamples << " : " << count << std::endl;
-
-    jassert(count == nSamples); // make sure all the data was written
-    (void)count;  // Suppress unused variable warning in release builds
-
-    diskWriteLock.exit();
+    if (samples != nullptr)
+    {
+        // already converted, only the byte order changes
+        char* dest = records->data + records->size;
+        for (int i = 0; i < nSamples; ++i)
+        {
+            const uint16 be = ByteOrder::swapIfLittleEndian(uint16(samples[i]));
+            memcpy(dest + 2 * i, &be, 2);
+        }
+    }
+    else
+    {
+        // scale the data back into the range of int16, straight into the record
+        float scaleFactor =  float(0x7fff) * getDataChannelTable().bitVolts[getRealChannel(writeChannel)];
+        FloatVectorOperations::multiply(continuousDataFloatBuffer, data, 1.0f / scaleFactor, nSamples);
+        AudioDataConverters::convertFloatToInt16BE(continuousDataFloatBuffer, records->data + records->size, nSamples);
+    }
+    records->size += 2 * nSamples;
 
 	if (blockIndex[writeChannel] + nSamples == BLOCK_LENGTH)
     {
-		writeRecordMarker(fileArray[writeChannel]);
+        // a 10-byte marker indicating the end of a record
+        memcpy(records->data + records->size, recordMarker, RECORD_MARKER_BYTES);
+        records->size += RECORD_MARKER_BYTES;
     }
 }
 
-void OriginalRecording::writeTimestampAndSampleCount(FILE* file, int channel)
-{
-    diskWriteLock.enter();
-
-    uint16 samps = BLOCK_LENGTH;
-
-   // int sourceNodeId = getChannel(channel)->sourceNodeId;
-
-    int64 ts = getTimestamp(channel) + samplesSinceLastTimestamp[channel];
-
-    fwrite(&ts,                       // ptr
-           8,                               // size of each element
-           1,                               // count
-           file); // ptr to FILE object
-
-    fwrite(&samps,                           // ptr
-           2,                               // size of each element
-           1,                               // count
-           file); // ptr to FILE object
-
-    fwrite(&recordingNumber,                         // ptr
-           2,                               // size of each element
-           1,                               // count
-           file); // ptr to FILE object
-
-    diskWriteLock.exit();
-}
-
-void OriginalRecording::writeRecordMarker(FILE* file)
+void OriginalRecording::flushChannelRecords(int channel)
 {
-    // write a 10-byte marker indicating the end of a record
+    if (fileArray[channel] == nullptr)
+        return;
 
-    diskWriteLock.enter();
-    fwrite(recordMarker,        // ptr
-           1,                   // size of each element
-           10,                  // count
-           file);               // ptr to FILE object
+    ChannelRecords* records = channelRecords[channel];
+    size_t partial = (blockIndex[channel] > 0) ? RECORD_HEADER_BYTES + 2 * blockIndex[channel] : 0;
+    size_t complete = records->size - partial;
+    if (complete == 0)
+        return;
 
-    diskWriteLock.exit();
+    fileArray[channel]->write(records->data, complete);
+    if (partial > 0)
+        memmove(records->data, records->data + complete, partial);
+    records->size = partial;
 }
 
 void OriginalRecording::closeFiles()
@@ -582,40 +564,24 @@ void OriginalRecording::closeFiles()
             if (blockIndex[i] < BLOCK_LENGTH)
             {
                 // fill out the rest of the current buffer
-                writeContinuousBuffer(zeroBuffer.getReadPointer(0), BLOCK_LENGTH - blockIndex[i], i);
-                diskWriteLock.enter();
-                fclose(fileArray[i]);
-                diskWriteLock.exit();
+                writeContinuousBuffer(zeroBuffer.getReadPointer(0), nullptr, BLOCK_LENGTH - blockIndex[i], i);
+                blockIndex.set(i, 0);
             }
+            flushChannelRecords(i);
         }
     }
 	fileArray.clear();
+	channelRecords.clear();
 	blockIndex.clear();
 	samplesSinceLastTimestamp.clear();
     for (int i = 0; i < spikeFileArray.size(); i++)
     {
-        if (spikeFileArray[i] != nullptr)
-        {
-            diskWriteLock.enter();
-            fclose(spikeFileArray[i]);
-            spikeFileArray.set(i,nullptr);
-            diskWriteLock.exit();
-        }
-    }
-    if (eventFile != nullptr)
-    {
-        diskWriteLock.enter();
-        fclose(eventFile);
-        eventFile = nullptr;
-        diskWriteLock.exit();
-    }
-    if (messageFile != nullptr)
-    {
-        diskWriteLock.enter();
-        fclose(messageFile);
-        messageFile = nullptr;
-        diskWriteLock.exit();
+        spikeFileArray.set(i,nullptr);
     }
+    eventFile = nullptr;
+    messageFile = nullptr;
+
+    closeAsyncFiles();
 
     writeXml();
 
@@ -681,16 +647,10 @@ void OriginalRecording::writeSpike(int electrodeIndex, const SpikeEvent* spike)
 		ptrIdx += sizeof(int16);
 	}
 
-    diskWriteLock.enter();
-
-    fwrite(spikeBuffer, 1, totalBytes, spikeFileArray[electrodeIndex]);
 
-    fwrite(&recordingNumber,                         // ptr
-           2,                               // size of each element
-           1,                               // count
-           spikeFileArray[electrodeIndex]); // ptr to FILE object
+    spikeFileArray[electrodeIndex]->write(spikeBuffer, totalBytes);
+    spikeFileArray[electrodeIndex]->write(&recordingNumber, 2);
 
-    diskWriteLock.exit();
 }
 
 void OriginalRecording::writeXml()
@@ -742,6 +702,8 @@ void OriginalRecording::setParameter(EngineParameter& parameter)
     boolParameter(0, separateFiles);
     boolParameter(1, renameFiles);
     strParameter(2, renamedPrefix);
+    if ((parameter.id == 3) && (parameter.type == EngineParameter::INT))
+        setWriterThreads(parameter.intParam.value);
 }
 
 RecordEngineManager* OriginalRecording::getEngineManager()
@@ -754,5 +716,7 @@ RecordEngineManager* OriginalRecording::getEngineManager()
     man->addParameter(param);
     param = new EngineParameter(EngineParameter::STR, 2, "Renamed files prefix", "CH");
     man->addParameter(param);
+    param = new EngineParameter(EngineParameter::INT, 3, "Writer threads (0 shares the common pool)", 0, 0, 16);
+    man->addParameter(param);
     return man;
 }
@@ -31,6 +31,10 @@
 
 #define HEADER_SIZE 1024
 #define BLOCK_LENGTH 1024
+//Timestamp, sample count and recording number, the samples and the record marker
+#define RECORD_HEADER_BYTES 12
+#define RECORD_MARKER_BYTES 10
+#define RECORD_BYTES (RECORD_HEADER_BYTES + BLOCK_LENGTH * 2 + RECORD_MARKER_BYTES)
 
 #define VERSION 0.4
 
@@ -38,7 +42,7 @@
 #define VSTR2(s) VSTR(s)
 #define VERSION_STRING VSTR2(VERSION)
 
-class OriginalRecording : public RecordEngine
+class OriginalRecording : public AsyncRecordEngine
 {
 public:
     OriginalRecording();
@@ -49,6 +53,8 @@ public:
     void openFiles(File rootFolder, int experimentNumber, int recordingNumber) override;
 	void closeFiles() override;
 	void writeData(int writeChannel, int realChannel, const float* buffer, int size) override;
+	void writeDataInt16(int writeChannel, int realChannel, const float* buffer, const int16* samples, int size) override;
+	bool storesInt16Samples() const override;
 	void writeEvent(int eventIndex, const MidiMessage& event) override;
 	void resetChannels() override;
 	void addSpikeElectrode(int index, const SpikeChannel* elec) override;
@@ -61,9 +67,12 @@ private:
     String getFileName(int channelIndex);
     void openFile(File rootFolder, const InfoObjectCommon* ch, int channelIndex);
     String generateHeader(const InfoObjectCommon* ch);
-    void writeContinuousBuffer(const float* data, int nSamples, int channel);
-    void writeTimestampAndSampleCount(FILE* file, int channel);
-    void writeRecordMarker(FILE* file);
+    /** Splits the samples of a channel into records. samples holds them already converted to int16, or is nullptr */
+    void writeChannelSamples(int writeChannel, const float* buffer, const int16* samples, int size);
+    /** Appends samples to the record being built for a channel, starting a new record or closing the current one as needed */
+    void writeContinuousBuffer(const float* data, const int16* samples, int nSamples, int channel);
+    /** Writes the complete records built for a channel at once, keeping the one still being filled */
+    void flushChannelRecords(int channel);
 
     void openSpikeFile(File rootFolder, const SpikeChannel* elec, int channelIndex);
     String generateSpikeHeader(const SpikeChannel* elec);
@@ -83,12 +92,6 @@ private:
     bool renameFiles;
     String renamedPrefix;
 
-    /** Holds data that has been converted from float to int16 before
-        saving.
-    */
-	HeapBlock<int16> continuousDataIntegerBuffer;
-    //int16* continuousDataIntegerBuffer;
-
     /** Holds data that has been converted from float to int16 before
         saving.
     */
@@ -101,12 +104,21 @@ private:
 
     AudioSampleBuffer zeroBuffer;
 
-    FILE* eventFile;
-    FILE* messageFile;
-    Array<FILE*> fileArray;
-    Array<FILE*> spikeFileArray;
+    /** Owned by AsyncRecordEngine */
+    AsyncWriteFile* eventFile;
+    AsyncWriteFile* messageFile;
+    Array<AsyncWriteFile*> fileArray;
+    Array<AsyncWriteFile*> spikeFileArray;
 
-    CriticalSection diskWriteLock;
+    /** The records of each channel, built in memory: the complete ones not yet written, then the one being filled.
+        All the files are written from the record thread only, and AsyncWriteFile guards its own state */
+    struct ChannelRecords
+    {
+        HeapBlock<char> data;
+        size_t capacity{ 0 };
+        size_t size{ 0 };
+    };
+    OwnedArray<ChannelRecords> channelRecords;
 
     struct ChannelInfo
     {
@@ -0,0 +1,153 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "RecordDecimator.h"
+#include <cmath>
+
+#if JUCE_INTEL && (defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2))
+ #define RECORD_DECIMATOR_SSE2 1
+ #include <emmintrin.h>
+#endif
+
+static float innerProduct(const float* taps, const float* input, int numTaps)
+{
+	int n = 0;
+	float sum = 0;
+#if RECORD_DECIMATOR_SSE2
+	__m128 acc = _mm_setzero_ps();
+	for (; n + 4 <= numTaps; n += 4)
+		acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(taps + n), _mm_loadu_ps(input + n)));
+	acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+	acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+	sum = _mm_cvtss_f32(acc);
+#endif
+	for (; n < numTaps; ++n)
+		sum += taps[n] * input[n];
+	return sum;
+}
+
+RecordDecimator::RecordDecimator(int factor) :
+	m_factor(jmax(2, factor)),
+	m_numSamples(0),
+	m_position(0),
+	m_nextInputTimestamp(-1),
+	m_nextOutputTimestamp(0)
+{
+	//as fractions of the input rate; the transition band of a Blackman window is about 5.5 / numTaps
+	const double passEdge = 0.4 / m_factor;
+	const double stopEdge = 0.5 / m_factor;
+	m_numTaps = int(std::ceil(5.5 / (stopEdge - passEdge))) | 1;
+	m_delaySamples = (m_numTaps - 1) / 2;
+	m_taps.malloc(m_numTaps);
+	m_samples.malloc(m_numTaps - 1 + RECORD_DECIMATOR_CHUNK_SAMPLES);
+
+	const double cutoff = 0.5 * (passEdge + stopEdge);
+	double sum = 0;
+	for (int n = 0; n < m_numTaps; n++)
+	{
+		const double t = n - m_delaySamples;
+		const double ideal = (t == 0) ? 2 * cutoff : std::sin(2 * double_Pi * cutoff * t) / (double_Pi * t);
+		const double w = 2 * double_Pi * n / (m_numTaps - 1);
+		const double window = 0.42 - 0.5 * std::cos(w) + 0.08 * std::cos(2 * w);
+		m_taps[n] = float(ideal * window);
+		sum += ideal * window;
+	}
+	//unit gain at DC; the kernel is symmetric, so it needs no reversing for the inner product
+	for (int n = 0; n < m_numTaps; n++)
+		m_taps[n] = float(m_taps[n] / sum);
+
+	reset(0);
+}
+
+RecordDecimator::~RecordDecimator()
+{
+}
+
+int RecordDecimator::getFactor() const
+{
+	return m_factor;
+}
+
+int64 RecordDecimator::reset(int64 inputTimestamp)
+{
+	const int history = m_numTaps - 1;
+	FloatVectorOperations::clear(m_samples, history);
+	m_numSamples = history;
+	m_position = history;
+	m_nextInputTimestamp = inputTimestamp;
+	m_nextOutputTimestamp = (inputTimestamp > m_delaySamples) ? (inputTimestamp - m_delaySamples) / m_factor : 0;
+	return m_nextOutputTimestamp;
+}
+
+int RecordDecimator::filter(int count, float* output)
+{
+	int numOutputs = 0;
+	m_numSamples += count;
+	for (; m_position < m_numSamples; m_position += m_factor)
+		output[numOutputs++] = innerProduct(m_taps, m_samples + m_position - (m_numTaps - 1), m_numTaps);
+
+	//only the history the next output needs is kept
+	const int first = m_position - (m_numTaps - 1);
+	memmove(m_samples, m_samples + first, sizeof(float) * (m_numSamples - first));
+	m_numSamples -= first;
+	m_position -= first;
+	return numOutputs;
+}
+
+int RecordDecimator::process(const float* input, int numInputs, int64 inputTimestamp, float* output, int64& outputTimestamp)
+{
+	if (inputTimestamp != m_nextInputTimestamp)
+		reset(inputTimestamp);
+	outputTimestamp = m_nextOutputTimestamp;
+
+	int numOutputs = 0;
+	for (int offset = 0; offset < numInputs; offset += RECORD_DECIMATOR_CHUNK_SAMPLES)
+	{
+		int count = jmin(RECORD_DECIMATOR_CHUNK_SAMPLES, numInputs - offset);
+		FloatVectorOperations::copy(m_samples + m_numSamples, input + offset, count);
+		numOutputs += filter(count, output + numOutputs);
+	}
+	m_nextInputTimestamp += numInputs;
+	m_nextOutputTimestamp += numOutputs;
+	return numOutputs;
+}
+
+int RecordDecimator::process(const int16* input, int numInputs, int64 inputTimestamp, float* output, int64& outputTimestamp)
+{
+	if (inputTimestamp != m_nextInputTimestamp)
+		reset(inputTimestamp);
+	outputTimestamp = m_nextOutputTimestamp;
+
+	int numOutputs = 0;
+	for (int offset = 0; offset < numInputs; offset += RECORD_DECIMATOR_CHUNK_SAMPLES)
+	{
+		int count = jmin(RECORD_DECIMATOR_CHUNK_SAMPLES, numInputs - offset);
+		float* dest = m_samples + m_numSamples;
+		for (int i = 0; i < count; i++)
+			dest[i] = float(input[offset + i]);
+		numOutputs += filter(count, output + numOutputs);
+	}
+	m_nextInputTimestamp += numInputs;
+	m_nextOutputTimestamp += numOutputs;
+	return numOutputs;
+}
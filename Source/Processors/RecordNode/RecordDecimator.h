@@ -0,0 +1,75 @@
+/*
+   ------------------------------------------------------------------
+
+   This file is part of the Open Ephys GUI
+   Copyright (C) 2016 Open Ephys
+
+   ------------------------------------------------------------------
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef RECORDDECIMATOR_H_INCLUDED
+#define RECORDDECIMATOR_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+//input samples are filtered this many at a time, bounding the size of the history buffer
+#define RECORD_DECIMATOR_CHUNK_SAMPLES 1024
+
+/**
+Lowers the rate of a recorded channel by an integer factor, on the record thread of an engine
+that supports it (see RecordEngine::supportsRecordDecimation).
+
+A single linear-phase low-pass FIR, of which only the outputs that are kept are computed. The
+passband is 40% of the lower rate and the stopband starts at its Nyquist frequency. The outputs
+are timestamped at the lower rate, shifted back by the delay of the filter. Inputs that don't follow
+on from the previous ones, as at the start of a gated window, restart the filter.
+*/
+class RecordDecimator
+{
+public:
+	explicit RecordDecimator(int factor);
+	~RecordDecimator();
+
+	int getFactor() const;
+
+	/** Clears the history of the filter, the next input being the one with the given timestamp.
+	Returns the timestamp of the first output at the lower rate */
+	int64 reset(int64 inputTimestamp);
+
+	/** Filters the inputs, writing at most numInputs / factor + 1 outputs, and returns their number.
+	outputTimestamp is set to the timestamp of the first of them */
+	int process(const float* input, int numInputs, int64 inputTimestamp, float* output, int64& outputTimestamp);
+	int process(const int16* input, int numInputs, int64 inputTimestamp, float* output, int64& outputTimestamp);
+
+private:
+	/** Runs the filter over the count samples just added after the history */
+	int filter(int count, float* output);
+
+	const int m_factor;
+	int m_numTaps;
+	HeapBlock<float> m_taps;
+	HeapBlock<float> m_samples;
+	int m_numSamples;
+	int m_position;
+	int m_delaySamples;
+	int64 m_nextInputTimestamp;
+	int64 m_nextOutputTimestamp;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RecordDecimator);
+};
+
+#endif  // RECORDDECIMATOR_H_INCLUDED
@@ -28,9 +28,11 @@
 
 #include "EngineConfigWindow.h"
 #include "OriginalRecording.h"
+#include "SpikeRecording.h"
 
 RecordEngine::RecordEngine()
-    : manager (nullptr)
+    : manager      (nullptr)
+    , channelTable (nullptr)
 {
 }
 
@@ -52,11 +54,50 @@ void RecordEngine::startChannelBlock (bool lastBlock) {}
 
 void RecordEngine::endChannelBlock (bool lastBlock) {}
 
+void RecordEngine::writeRawData (int writeChannel, int realChannel, const float* buffer, const int16* rawBuffer, int size)
+{
+    writeDataInt16 (writeChannel, realChannel, buffer, rawBuffer, size);
+}
+
+void RecordEngine::writeDataInt16 (int writeChannel, int realChannel, const float* buffer, const int16* samples, int size)
+{
+    writeData (writeChannel, realChannel, buffer, size);
+}
+
 const DataChannel* RecordEngine::getDataChannel (int index) const
 {
     return AccessClass::getProcessorGraph()->getRecordNode()->getDataChannel (index);
 }
 
+const DataChannelTable& RecordEngine::getDataChannelTable() const
+{
+    // set when recording starts, which is before any data gets written
+    if (channelTable != nullptr)
+        return *channelTable;
+
+    return AccessClass::getProcessorGraph()->getRecordNode()->getDataChannelTable();
+}
+
+int64 RecordEngine::getSynchronizedTimestamp (uint16 sourceID, uint16 subProcessorIdx, int64 timestamp) const
+{
+    return AccessClass::getProcessorGraph()->getClockSynchronizer().getGlobalTimestamp (GenericProcessor::getProcessorFullId (sourceID, subProcessorIdx), timestamp);
+}
+
+bool RecordEngine::isClockSyncEnabled() const
+{
+    return AccessClass::getProcessorGraph()->getClockSynchronizer().getSyncLine() >= 0;
+}
+
+bool RecordEngine::isRecordGated() const
+{
+    return AccessClass::getProcessorGraph()->getRecordNode()->isRecordGated();
+}
+
+String RecordEngine::getClockSyncDescription() const
+{
+    return AccessClass::getProcessorGraph()->getClockSynchronizer().getDescription();
+}
+
 const EventChannel* RecordEngine::getEventChannel(int index) const
 {
 	return AccessClass::getProcessorGraph()->getRecordNode()->getEventChannel(index);
@@ -86,6 +127,8 @@ void RecordEngine::setChannelMapping (const Array<int>& chans, const Array<int>&
     chanProcessorMap = chanProc;
     chanOrderMap = chanOrder;
     recordProcessors.swapWith(processors);
+
+    channelTable = &AccessClass::getProcessorGraph()->getRecordNode()->getDataChannelTable();
 }
 
 int64 RecordEngine::getTimestamp (int channel) const
@@ -144,6 +187,43 @@ void RecordEngine::startAcquisition() {}
 
 void RecordEngine::directoryChanged() {}
 
+Array<File> RecordEngine::getExtraDataDirectories() const
+{
+    return Array<File>();
+}
+
+bool RecordEngine::storesInt16Samples() const
+{
+    return false;
+}
+
+bool RecordEngine::supportsRecordDecimation() const
+{
+    return false;
+}
+
+bool RecordEngine::recordsContinuousData() const
+{
+    return true;
+}
+
+void RecordEngine::writeSpikeData (int electrodeIndex, const SpikeEventView& spike)
+{
+    // building the SpikeEvent here keeps the allocations off the processing thread
+    const AllocationAudit::ScopedExemption engineObjects;
+    SpikeEventPtr event = spike.createSpikeEvent();
+
+    if (event)
+        writeSpike (electrodeIndex, event);
+}
+
+int RecordEngine::getRecordDecimation (int channel) const
+{
+    if (! supportsRecordDecimation())
+        return 1;
+    return getDataChannel (getRealChannel (channel))->getRecordDecimation();
+}
+
 void RecordEngine::registerManager (RecordEngineManager* recordManager)
 {
     manager = recordManager;
@@ -158,6 +238,59 @@ void RecordEngine::configureEngine()
         setParameter (manager->getParameter (i));
 }
 
+AsyncRecordEngine::AsyncRecordEngine() : writerThreads (0) {}
+
+AsyncRecordEngine::~AsyncRecordEngine()
+{
+    closeAsyncFiles();
+}
+
+AsyncWriteFile* AsyncRecordEngine::openAsyncFile (const File& file, bool append)
+{
+    AsyncWriteFile* asyncFile = getEngineWriteService()->openFile (file, append);
+    if (asyncFile != nullptr)
+        asyncFiles.add (asyncFile);
+    return asyncFile;
+}
+
+bool AsyncRecordEngine::closeAsyncFiles()
+{
+    // flushing every file before deleting any lets all of them finish writing at the same time
+    bool ok = true;
+    for (int i = 0; i < asyncFiles.size(); ++i)
+        ok = asyncFiles[i]->flush() && ok;
+    asyncFiles.clear();
+    return ok;
+}
+
+void AsyncRecordEngine::setWriterThreads (int numThreads)
+{
+    writerThreads = jmax (0, numThreads);
+}
+
+AsyncWriteService* AsyncRecordEngine::getEngineWriteService()
+{
+    // the pool can only be replaced while none of its files are open
+    if (asyncFiles.size() == 0)
+    {
+        if (writerThreads == 0)
+            ownWriteService = nullptr;
+        else if (ownWriteService == nullptr || ownWriteService->getNumThreads() != writerThreads)
+            ownWriteService = new AsyncWriteService (writerThreads);
+    }
+    if (ownWriteService != nullptr)
+        return ownWriteService;
+    return AccessClass::getProcessorGraph()->getRecordNode()->getWriteService();
+}
+
+int64 AsyncRecordEngine::getPendingWriteBytes() const
+{
+    int64 bytes = 0;
+    for (int i = 0; i < asyncFiles.size(); ++i)
+        bytes += asyncFiles[i]->getPendingBytes();
+    return bytes;
+}
+
 //Manager
 
 EngineParameter::EngineParameter (EngineParameter::EngineParameterType paramType,
@@ -245,7 +378,7 @@ void RecordEngineManager::addParameter (EngineParameter* param)
 
 int RecordEngineManager::getNumOfBuiltInEngines()
 {
-    return 1;
+    return 2;
 }
 
 RecordEngineManager* RecordEngineManager::createBuiltInEngineManager (int index)
@@ -255,6 +388,9 @@ RecordEngineManager* RecordEngineManager::createBuiltInEngineManager (int index)
         case 0:
             return OriginalRecording::getEngineManager();
 
+        case 1:
+            return SpikeRecording::getEngineManager();
+
         default:
             return nullptr;
     }
@@ -270,6 +406,9 @@ RecordEngine* RecordEngineManager::instantiateEngine()
     if (id == "OPENEPHYS")
         return new OriginalRecording();
 
+    if (id == "SPIKES")
+        return new SpikeRecording();
+
     return nullptr;
 }
 
@@ -26,6 +26,7 @@
 
 #include "../../../JuceLibraryCode/JuceHeader.h"
 #include "../GenericProcessor/GenericProcessor.h"
+#include "AsyncWriteService.h"
 
 #include <map>
 
@@ -76,7 +77,7 @@ public:
         3-writeData* (per channel. Can be called more than once to account for the circular buffer wrap)
         4-endChannelBlock*
         4-writeEvent* (if needed)
-        5-writeSpike* (if needed)
+        5-writeSpikeData* (if needed, which calls writeSpike by default)
       When recording stops:
         closeFiles*
 
@@ -101,6 +102,37 @@ public:
         care must be taken to only read the specified number of bytes.  */
     virtual void writeData (int writeChannel, int realChannel, const float* buffer, int size) = 0;
 
+    /** Write continuous data for a channel whose samples have not been modified since they left their
+        source, along with their original integer codes (rawBuffer[i] * bitVolts == buffer[i]).
+        Engines storing integers can write the codes as they are. By default it calls writeDataInt16.  */
+    virtual void writeRawData (int writeChannel, int realChannel, const float* buffer, const int16* rawBuffer, int size);
+
+    /** Write continuous data for a channel along with its samples already converted to int16, as
+        roundToInt (buffer[i] / bitVolts) clipped to +-32767. When several engines record at once the
+        conversion is done once for all of them, so engines storing int16 samples should use these
+        rather than convert on their own. By default it just calls writeData.  */
+    virtual void writeDataInt16 (int writeChannel, int realChannel, const float* buffer, const int16* samples, int size);
+
+    /** Returns true if the engine only ever stores the int16 samples of writeDataInt16() and writeRawData(),
+        never reading their float buffer. When all recording engines do, the record node queues its data as
+        int16 only, which holds twice as long a backlog in the same memory, and buffer is then nullptr.  */
+    virtual bool storesInt16Samples() const;
+
+    /** Returns true if the engine can record channels at different rates within a recording, so that the
+        channels set to be recorded at a lower rate (see DataChannel::setRecordDecimation) are decimated on
+        its record thread before being written. Their timestamps are then counted at the lower rate, and
+        engines should keep them apart from the full rate channels of the same source. By default, false. */
+    virtual bool supportsRecordDecimation() const;
+
+    /** Returns false if the engine doesn't store continuous data at all. When no engine does, or no channel is
+        set to be recorded, the recording only holds spikes and events: the record node queues no continuous
+        data, and the record threads skip it entirely and take spikes in larger batches. By default, true. */
+    virtual bool recordsContinuousData() const;
+
+    /** Returns the factor the samples of a recorded channel are decimated by before they reach the engine,
+        1 if they are written at the channel's own rate */
+    int getRecordDecimation (int channel) const;
+
     /** Called by the record thread after it has written a channel block */
     virtual void endChannelBlock (bool lastBlock);
 
@@ -128,6 +160,11 @@ public:
     /** Write a spike to disk */
     virtual void writeSpike (int electrodeIndex, const SpikeEvent* spike) = 0;
 
+    /** Write a spike to disk from the bytes it is queued as, which are only valid during the call. By default
+        it makes a SpikeEvent of them for writeSpike(); engines writing spikes at high rates can read the view
+        in place instead, which allocates nothing. */
+    virtual void writeSpikeData (int electrodeIndex, const SpikeEventView& spike);
+
     /** Called when a new acquisition starts, to clean all channel data before registering the processors */
     virtual void resetChannels();
 
@@ -146,6 +183,10 @@ public:
     /** Called when the recording directory changes during an acquisition */
     virtual void directoryChanged();
 
+    /** Returns the folders, other than the recording directory, the engine writes data to,
+        so that their free space is accounted for. Called from the message thread. */
+    virtual Array<File> getExtraDataDirectories() const;
+
     void registerManager (RecordEngineManager* engineManager);
     void configureEngine();
 
@@ -158,12 +199,31 @@ protected:
     /** Gets the specified channel from the channel array stored in RecordNode */
     const DataChannel* getDataChannel (int index) const;
 
+    /** Gets the per-channel values of RecordNode's channels in contiguous arrays, indexed like
+        getDataChannel(). Cheaper than getDataChannel() for code called for every block. */
+    const DataChannelTable& getDataChannelTable() const;
+
 	/** Gets the specified event channel from the channel array stored in RecordNode */
 	const EventChannel* getEventChannel(int index) const;
 
     /** Gets the specified channel group info structure from the array stored in RecordNode */
     const SpikeChannel* getSpikeChannel (int index) const;
 
+    /** Maps a timestamp of a source onto the global timestamp source, as estimated by the clock
+        synchronizer from the sync pulses received so far. Returns -1 while the source is not
+        synchronized, or if no sync line is set. */
+    int64 getSynchronizedTimestamp (uint16 sourceID, uint16 subProcessorIdx, int64 timestamp) const;
+
+    /** True if a sync line is set, so that getSynchronizedTimestamp() can return mapped timestamps */
+    bool isClockSyncEnabled() const;
+
+    /** True if the recording only keeps windows of the continuous data, so that successive writes to a
+        channel can be far apart in time. See RecordNode::setRecordGate() */
+    bool isRecordGated() const;
+
+    /** Describes the current clock mappings, one line per source */
+    String getClockSyncDescription() const;
+
     /** Generate a Matlab-compatible datestring */
     String generateDateString() const;
 
@@ -212,11 +272,48 @@ private:
     Array<int> chanOrderMap;
 
     RecordEngineManager* manager;
+    const DataChannelTable* channelTable;
     OwnedArray<RecordProcessorInfo> recordProcessors;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RecordEngine);
 };
 
+/** A RecordEngine whose files are written in the background by RecordNode's AsyncWriteService,
+    so the record thread only copies the data and the writes of all the files overlap. */
+class PLUGIN_API AsyncRecordEngine : public RecordEngine
+{
+public:
+    AsyncRecordEngine();
+    /** Closes any file still open */
+    ~AsyncRecordEngine();
+
+protected:
+    /** Opens a file written through the shared write service. The engine keeps ownership
+        and closes it in closeAsyncFiles(). Returns nullptr if it couldn't be opened. */
+    AsyncWriteFile* openAsyncFile (const File& file, bool append = false);
+
+    /** Waits for the writes queued to every file opened with openAsyncFile() and closes them.
+        Returns false if any write has failed. */
+    bool closeAsyncFiles();
+
+    /** Returns the number of bytes queued to this engine's files and not yet on disk */
+    int64 getPendingWriteBytes() const;
+
+    /** Makes the engine write its files through a pool of its own with the given number of threads,
+        or through the shared write service if 0. Applies from the next file opened with no other file open. */
+    void setWriterThreads (int numThreads);
+
+private:
+    AsyncWriteService* getEngineWriteService();
+
+    int writerThreads;
+    /** Declared before the files, so that it outlives them */
+    ScopedPointer<AsyncWriteService> ownWriteService;
+    OwnedArray<AsyncWriteFile> asyncFiles;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AsyncRecordEngine);
+};
+
 typedef RecordEngine* (*EngineCreator)();
 
 struct PLUGIN_API EngineParameter
@@ -29,9 +29,62 @@
 #include "RecordEngine.h"
 #include "RecordThread.h"
 #include "DataQueue.h"
+#include "AsyncWriteService.h"
 
 #define EVERY_ENGINE for(int eng = 0; eng < engineArray.size(); eng++) engineArray[eng]
 
+/**
+Writes a snapshot of the settings to settings.xml, and keeps its text for the engines.
+
+The snapshot is an XmlElement built on the message thread, which is then only touched by this thread,
+so the document is created and written to disk while the first blocks of the recording are handled.
+*/
+class SettingsWriter : public Thread
+{
+public:
+	SettingsWriter() : Thread("Settings writer") {}
+
+	~SettingsWriter()
+	{
+		waitForThreadToExit(-1);
+	}
+
+	/** Takes ownership of the snapshot, and starts writing it once the previous one is written */
+	void write(XmlElement* snapshot, const File& file)
+	{
+		waitForThreadToExit(-1);
+		m_snapshot = snapshot;
+		m_file = file;
+		startThread();
+	}
+
+	/** Waits for the last snapshot to be written, and returns its text */
+	const String& getText()
+	{
+		waitForThreadToExit(-1);
+		return m_text;
+	}
+
+	void run() override
+	{
+		if (!m_snapshot->writeToFile(m_file, String::empty))
+			std::cerr << "Couldn't write to file " << m_file.getFullPathName() << std::endl;
+
+		m_text = m_snapshot->createDocument(String::empty);
+		if (m_text.isEmpty())
+			m_text = "Couldn't create configuration xml";
+
+		m_snapshot = nullptr;
+	}
+
+private:
+	ScopedPointer<XmlElement> m_snapshot;
+	File m_file;
+	String m_text;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SettingsWriter);
+};
+
 
 RecordNode::RecordNode()
     : GenericProcessor("Record Node"),
@@ -55,11 +108,26 @@ RecordNode::RecordNode()
 
     // 128 inputs, 0 outputs
     setPlayConfigDetails(getNumInputs(),getNumOutputs(),44100.0,128);
-	m_recordThread = new RecordThread(engineArray);
+	m_writeWakeupSamples = WRITE_WAKEUP_SAMPLES;
+	m_stallTolerance = DATA_BUFFER_STALL_SECONDS;
+	m_preTriggerSeconds = 0;
+	m_preTriggerArmed = false;
+	m_gateSettings.sourceID = -1;
+	m_gateSettings.preSeconds = m_gateSettings.postSeconds = 0;
+	m_gateChannel = nullptr;
+	m_gate = m_gateSettings;
+	m_gateEventTimes.ensureStorageAllocated(64);
+	m_incomingSampleRate = 0;
+	m_backlogAlarmLevel = 0;
+	m_samplesSinceWakeup = 0;
+	m_eventsSinceWakeup = 0;
+	m_writeService = new AsyncWriteService();
+	m_settingsWriter = new SettingsWriter();
 	m_dataQueue = new DataQueue(WRITE_BLOCK_LENGTH, DATA_BUFFER_NBLOCKS);
-	m_eventQueue = new EventMsgQueue(EVENT_BUFFER_NEVENTS);
-	m_spikeQueue = new SpikeMsgQueue(SPIKE_BUFFER_NSPIKES);
-	m_recordThread->setQueuePointers(m_dataQueue, m_eventQueue, m_spikeQueue);
+	m_eventQueue = new EventMsgQueue(EVENT_BUFFER_NEVENTS, EVENT_BUFFER_NBYTES);
+	m_spikeQueue = new SpikeMsgQueue(SPIKE_BUFFER_NSPIKES, SPIKE_BUFFER_NBYTES);
+	m_spikeQueueSpikes = SPIKE_BUFFER_NSPIKES;
+	m_spikeWakeupCount = SPIKE_BUFFER_NSPIKES / 4;
 }
 
 
@@ -148,6 +216,7 @@ void RecordNode::addInputChannel(const GenericProcessor* sourceNode, int chan)
 		const DataChannel* orig = sourceNode->getDataChannel(chan);
 		DataChannel* newChannel = new DataChannel(*orig);
 		newChannel->setRecordState(orig->getRecordState());
+		newChannel->setRecordDecimation(orig->getRecordDecimation());
         dataChannelArray.add(newChannel);
         setPlayConfigDetails(channelIndex+1,0,44100.0,128);
 
@@ -252,6 +321,20 @@ String RecordNode::generateDateString() const
 
 }
 
+int64 RecordNode::getMemoryFootprint() const
+{
+	int64 bytes = GenericProcessor::getMemoryFootprint();
+
+	if (m_dataQueue != nullptr)
+		bytes += m_dataQueue->getMemoryFootprint();
+	if (m_eventQueue != nullptr)
+		bytes += m_eventQueue->getMemoryFootprint();
+	if (m_spikeQueue != nullptr)
+		bytes += m_spikeQueue->getMemoryFootprint();
+
+	return bytes;
+}
+
 int RecordNode::getExperimentNumber() const
 {
 	return experimentNumber;
@@ -296,11 +379,13 @@ void RecordNode::setParameter(int parameterIndex, float newValue)
         if (settingsNeeded)
         {
             String settingsFileName = rootFolder.getFullPathName() + File::separator + "settings" + ((experimentNumber > 1) ? "_" + String(experimentNumber) : String::empty) + ".xml";
-            AccessClass::getEditorViewport()->saveState(File(settingsFileName), m_lastSettingsText);
+            //only the snapshot is taken here; it is written while the recording starts
+            m_settingsWriter->write(AccessClass::getEditorViewport()->createSettingsXml(), File(settingsFileName));
             settingsNeeded = false;
         }
 
-		m_recordThread->setFileComponents(rootFolder, experimentNumber, recordingNumber);
+		for (int i = 0; i < m_recordThreads.size(); ++i)
+			m_recordThreads[i]->setFileComponents(rootFolder, experimentNumber, recordingNumber);
 
 		channelMap.clear();
 		int totChans = dataChannelArray.size();
@@ -310,10 +395,12 @@ void RecordNode::setParameter(int parameterIndex, float newValue)
 		int lastProcessor = -1;
 		int procIndex = -1;
 		int chanProcOrder = 0;
+		//with no engine storing continuous data, none is queued at all
+		const bool recordsContinuous = anyEngineRecordsContinuousData();
 		for (int ch = 0; ch < totChans; ++ch)
 		{
 			DataChannel* chan = dataChannelArray[ch];
-			if (chan->getRecordState())
+			if (recordsContinuous && chan->getRecordState())
 			{
 				channelMap.add(ch);
 				//This is bassed on the assumption that all channels from the same processor are added contiguously
@@ -338,16 +425,42 @@ void RecordNode::setParameter(int parameterIndex, float newValue)
 
 		//WARNING: If at some point we record at more that one recordEngine at once, we should change this, as using OwnedArrays only works for the first
 		EVERY_ENGINE->setChannelMapping(channelMap, chanProcessorMap, chanOrderinProc, procInfo);
-		m_recordThread->setChannelMap(channelMap);
-		m_dataQueue->setChannels(numRecordedChannels);
-		m_eventQueue->reset();
-		m_spikeQueue->reset();
-		m_recordThread->setFirstBlockFlag(false);
+		for (int i = 0; i < m_recordThreads.size(); ++i)
+			m_recordThreads[i]->setChannelMap(channelMap);
+
+		//While armed, the queue already holds the pre-trigger data of these same channels
+		const bool keepQueue = isPreTriggerArmed() && channelMap == m_armedChannelMap
+			&& m_dataQueue->isInt16Storage() == allEnginesStoreInt16();
+		if (!keepQueue)
+		{
+			disarmPreTrigger();
+			configureDataQueue();
+		}
+		m_backlogAlarmLevel = 0;
+		configureRecordGate();
+		configureSpikeQueue(numRecordedChannels == 0);
+		m_eventQueue->setNumReaders(m_recordThreads.size());
+		m_spikeQueue->setNumReaders(m_recordThreads.size());
+		for (int i = 0; i < m_recordThreads.size(); ++i)
+			m_recordThreads[i]->setFirstBlockFlag(false);
 
 		setFirstBlock = false;
-		m_recordThread->startThread();
+		m_samplesSinceWakeup = 0;
+		m_eventsSinceWakeup = 0;
+		{
+			//the recording picks up right where the pre-trigger data ends
+			const SpinLock::ScopedLockType lock(m_queueWriteLock);
+			if (keepQueue)
+				m_dataQueue->attachReaders(m_recordThreads.size(), int(m_incomingSampleRate * m_preTriggerSeconds));
+			else
+				m_dataQueue->setNumReaders(m_recordThreads.size());
+			m_preTriggerArmed = false;
+			m_gateEventTimes.clearQuick();
+			isRecording = true;
+		}
+		for (int i = 0; i < m_recordThreads.size(); ++i)
+			m_recordThreads[i]->startThread();
 
-		isRecording = true;
 		hasRecorded = true;
 
     }
@@ -361,10 +474,27 @@ void RecordNode::setParameter(int parameterIndex, float newValue)
         {
 			isRecording = false;
 
-            // close the writing thread.
-			m_recordThread->signalThreadShouldExit();
-			m_recordThread->waitForThreadToExit(2000);
-			while (m_recordThread->isThreadRunning())
+            // close the writing threads.
+			for (int i = 0; i < m_recordThreads.size(); ++i)
+			{
+				m_recordThreads[i]->signalThreadShouldExit();
+				m_recordThreads[i]->notify();
+			}
+			for (int i = 0; i < m_recordThreads.size(); ++i)
+				m_recordThreads[i]->waitForThreadToExit(2000);
+			for (int i = 0; i < m_recordThreads.size(); ++i)
+			{
+				double rate = m_recordThreads[i]->getSustainedWriteRate();
+				if (rate > 0 && m_incomingSampleRate > 0)
+					std::cout << "Record engine " << m_recordThreads[i]->getRecordEngine()->getEngineID() << " sustained "
+					<< String(rate / m_incomingSampleRate, 1) << " times the incoming data rate" << std::endl;
+				String report = m_recordThreads[i]->isThreadRunning() ? String::empty : m_recordThreads[i]->getWriteReport();
+				if (report.isNotEmpty())
+					std::cout << report << std::endl;
+			}
+			if (m_dataQueue->getNumDroppedSamples() > 0)
+				std::cerr << "Recording dropped " << m_dataQueue->getNumDroppedSamples() << " samples, summed over the channels" << std::endl;
+			while (isAnyRecordThreadRunning())
 			{
 				std::cerr << "RecordEngine timeout" << std::endl;
 				if (AlertWindow::showOkCancelBox(AlertWindow::WarningIcon, "Record Thread timeout",
@@ -372,15 +502,23 @@ void RecordNode::setParameter(int parameterIndex, float newValue)
 					"shouldn't take this long.\nYou can either wait a bit more or forcefully close the thread. Note that data might be lost or corrupted"
 					"if forcibly closing the thread.", "Stop the thread", "Wait a bit more"))
 				{
-					m_recordThread->stopThread(100);
-					m_recordThread->forceCloseFiles();
+					for (int i = 0; i < m_recordThreads.size(); ++i)
+					{
+						m_recordThreads[i]->stopThread(100);
+						m_recordThreads[i]->forceCloseFiles();
+					}
 				}
 				else
 				{
-					m_recordThread->waitForThreadToExit(2000);
+					for (int i = 0; i < m_recordThreads.size(); ++i)
+						m_recordThreads[i]->waitForThreadToExit(2000);
 				}
 			}
 
+			m_gateChannel = nullptr;
+			//the pre-trigger data of the next recording starts accumulating now
+			armPreTrigger();
+
         }
     }
     else if (parameterIndex == 2)
@@ -408,6 +546,12 @@ void RecordNode::setParameter(int parameterIndex, float newValue)
             {
                 dataChannelArray[currentChannel]->setRecordState(true);
             }
+
+            if (m_preTriggerSeconds > 0)
+            {
+                disarmPreTrigger();
+                triggerAsyncUpdate();
+            }
         }
     }
 }
@@ -426,6 +570,7 @@ bool RecordNode::enable()
     EVERY_ENGINE->configureEngine();
     EVERY_ENGINE->startAcquisition();
     isProcessing = true;
+    armPreTrigger();
     return true;
 }
 
@@ -436,20 +581,351 @@ bool RecordNode::disable()
     setParameter(0, 10.0f);
 
     isProcessing = false;
+    cancelPendingUpdate();
+    disarmPreTrigger();
 
     return true;
 }
 
 float RecordNode::getFreeSpace() const
 {
-    return 1.0f - float(dataDirectory.getBytesFreeOnVolume())/float(dataDirectory.getVolumeTotalSize());
+	Array<File> folders;
+	folders.add(dataDirectory);
+	for (int i = 0; i < engineArray.size(); ++i)
+		folders.addArray(engineArray[i]->getExtraDataDirectories());
+
+	//folders on the same volume report the same sizes, and are only counted once
+	Array<int64> seenTotals, seenFrees;
+	int64 totalBytes = 0;
+	int64 freeBytes = 0;
+	for (int i = 0; i < folders.size(); ++i)
+	{
+		int64 total = folders[i].getVolumeTotalSize();
+		int64 free = folders[i].getBytesFreeOnVolume();
+		bool seen = false;
+		for (int j = 0; j < seenTotals.size() && !seen; ++j)
+			seen = seenTotals[j] == total && seenFrees[j] == free;
+		if (seen || total <= 0)
+			continue;
+		seenTotals.add(total);
+		seenFrees.add(free);
+		totalBytes += total;
+		freeBytes += free;
+	}
+	if (totalBytes <= 0)
+		return 0.0f;
+	return 1.0f - float(double(freeBytes) / double(totalBytes));
+}
+
+void RecordNode::getRecordBacklogs(StringArray& engines, Array<float>& backlogs, Array<float>& speedRatios) const
+{
+	engines.clearQuick();
+	backlogs.clearQuick();
+	speedRatios.clearQuick();
+	for (int i = 0; i < m_recordThreads.size(); ++i)
+	{
+		engines.add(m_recordThreads[i]->getRecordEngine()->getEngineID());
+		backlogs.add(isRecording ? m_recordThreads[i]->getBacklog() : 0.0f);
+		double rate = m_recordThreads[i]->getSustainedWriteRate();
+		speedRatios.add((rate > 0 && m_incomingSampleRate > 0) ? float(rate / m_incomingSampleRate) : 0.0f);
+	}
+}
+
+int RecordNode::updateBacklogAlarm()
+{
+	if (!isRecording)
+		return m_backlogAlarmLevel = 0;
+
+	float backlog = 0;
+	String engine;
+	for (int i = 0; i < m_recordThreads.size(); ++i)
+	{
+		float b = m_recordThreads[i]->getBacklog();
+		if (b > backlog)
+		{
+			backlog = b;
+			engine = m_recordThreads[i]->getRecordEngine()->getEngineID();
+		}
+	}
+
+	int level = (backlog >= 0.9f || m_dataQueue->getNumDroppedSamples() > 0) ? 2 : (backlog >= 0.5f ? 1 : 0);
+	if (level > m_backlogAlarmLevel)
+	{
+		String message;
+		if (m_dataQueue->getNumDroppedSamples() > 0)
+			message = "Recording is dropping data: the disk can't keep up";
+		else
+			message = "Record queue " + String(roundToInt(backlog * 100)) + "% full, " + engine + " is falling behind";
+		std::cerr << message << std::endl;
+		CoreServices::sendStatusMessage(message);
+	}
+	m_backlogAlarmLevel = level;
+	return level;
+}
+
+void RecordNode::setStallTolerance(float seconds)
+{
+	m_stallTolerance = jmax(0.0f, seconds);
+}
+
+float RecordNode::getStallTolerance() const
+{
+	return m_stallTolerance;
+}
+
+void RecordNode::configureDataQueue()
+{
+	const int numRecordedChannels = channelMap.size();
+
+	//Channels from the same subprocessor always get the same number of samples, so they share a queue cursor
+	Array<uint32> groupSources;
+	Array<int> channelGroups;
+	for (int ch = 0; ch < numRecordedChannels; ++ch)
+	{
+		const DataChannel* chan = dataChannelArray[channelMap[ch]];
+		uint32 sourceID = getProcessorFullId(chan->getSourceNodeID(), chan->getSubProcessorIdx());
+		int group = groupSources.indexOf(sourceID);
+		if (group < 0)
+		{
+			group = groupSources.size();
+			groupSources.add(sourceID);
+		}
+		channelGroups.add(group);
+	}
+	m_incomingSampleRate = 0;
+	for (int ch = 0; ch < numRecordedChannels; ++ch)
+		m_incomingSampleRate = jmax(m_incomingSampleRate, dataChannelArray[channelMap[ch]]->getSampleRate());
+	//The float samples are only queued if some engine needs them
+	const bool int16Only = allEnginesStoreInt16();
+	m_dataQueue->setInt16Storage(int16Only);
+	m_dataQueue->setChannels(channelGroups, getRequiredQueueBlocks(numRecordedChannels));
+
+	groupSourceChannels.clearQuick();
+	groupOffsets.clearQuick();
+	for (int group = 0; group < m_dataQueue->getNumGroups(); ++group)
+	{
+		groupOffsets.add(groupSourceChannels.size());
+		const Array<int>& channels = m_dataQueue->getGroupChannels(group);
+		for (int i = 0; i < channels.size(); ++i)
+			groupSourceChannels.add(channelMap[channels[i]]);
+	}
+	groupRawData.clearQuick();
+	groupRawData.insertMultiple(0, nullptr, numRecordedChannels);
+
+	//Channels whose data reaches this node untouched can be written from the original integer codes
+	rawSampleSources.clear();
+	Array<bool> rawChannels;
+	Array<GenericProcessor*> processors = AccessClass::getProcessorGraph()->getListOfProcessors();
+	for (int ch = 0; ch < numRecordedChannels; ++ch)
+	{
+		const DataChannel* chan = dataChannelArray[channelMap[ch]];
+		const GenericProcessor* source = nullptr;
+		if (chan->hasRawSamples())
+		{
+			for (int p = 0; p < processors.size(); ++p)
+			{
+				if (processors[p]->getNodeId() == chan->getSourceNodeID())
+				{
+					source = processors[p];
+					break;
+				}
+			}
+		}
+		rawSampleSources.add(source);
+		rawChannels.add(source != nullptr);
+	}
+	m_dataQueue->setRawChannels(rawChannels);
+
+	//With more than one engine, the int16 samples they store are converted once in the queue instead of by each of them.
+	//An int16 queue converts every channel as it is written
+	Array<float> conversionBitVolts;
+	if (int16Only || m_recordThreads.size() > 1)
+	{
+		for (int ch = 0; ch < numRecordedChannels; ++ch)
+			conversionBitVolts.add(rawChannels[ch] && !int16Only ? 0.0f : dataChannelArray[channelMap[ch]]->getBitVolts());
+	}
+	m_dataQueue->setConvertedChannels(conversionBitVolts);
+}
+
+void RecordNode::configureSpikeQueue(bool spikeOnly)
+{
+	//without continuous data the memory goes to the spikes instead, so that high spike rates get through a disk stall
+	const int numSpikes = spikeOnly ? SPIKE_ONLY_BUFFER_NSPIKES : SPIKE_BUFFER_NSPIKES;
+	const int numBytes = spikeOnly ? SPIKE_ONLY_BUFFER_NBYTES : SPIKE_BUFFER_NBYTES;
+	if (m_spikeQueueSpikes != numSpikes)
+	{
+		m_spikeQueue->resize(numSpikes, numBytes);
+		m_spikeQueueSpikes = numSpikes;
+	}
+	m_spikeWakeupCount = numSpikes / 4;
+}
+
+bool RecordNode::anyEngineRecordsContinuousData() const
+{
+	for (int eng = 0; eng < engineArray.size(); ++eng)
+	{
+		if (engineArray[eng]->recordsContinuousData())
+			return true;
+	}
+	return false;
+}
+
+bool RecordNode::allEnginesStoreInt16() const
+{
+	bool int16Only = engineArray.size() > 0;
+	for (int eng = 0; eng < engineArray.size(); ++eng)
+		int16Only = int16Only && engineArray[eng]->storesInt16Samples();
+	return int16Only;
+}
+
+void RecordNode::armPreTrigger()
+{
+	disarmPreTrigger();
+	if (!isProcessing || isRecording || m_preTriggerSeconds <= 0 || !anyEngineRecordsContinuousData())
+		return;
+
+	channelMap.clear();
+	for (int ch = 0; ch < dataChannelArray.size(); ++ch)
+	{
+		if (dataChannelArray[ch]->getRecordState())
+			channelMap.add(ch);
+	}
+	if (channelMap.size() == 0)
+		return;
+
+	configureDataQueue();
+	//with no readers, the oldest data is overwritten as the queue fills
+	m_dataQueue->setNumReaders(0);
+	m_armedChannelMap = channelMap;
+
+	const SpinLock::ScopedLockType lock(m_queueWriteLock);
+	m_preTriggerArmed = true;
+}
+
+void RecordNode::disarmPreTrigger()
+{
+	const SpinLock::ScopedLockType lock(m_queueWriteLock);
+	m_preTriggerArmed = false;
+}
+
+bool RecordNode::isPreTriggerArmed() const
+{
+	const SpinLock::ScopedLockType lock(m_queueWriteLock);
+	return m_preTriggerArmed;
+}
+
+void RecordNode::handleAsyncUpdate()
+{
+	armPreTrigger();
+}
+
+void RecordNode::setPreTriggerLength(float seconds)
+{
+	m_preTriggerSeconds = jmax(0.0f, seconds);
+	if (!isRecording)
+		armPreTrigger();
+}
+
+float RecordNode::getPreTriggerLength() const
+{
+	return m_preTriggerSeconds;
+}
+
+void RecordNode::setRecordGate(const EventChannel* channel, int line, float preMs, float postMs)
+{
+	m_gateSettings.sourceID = channel != nullptr ? channel->getSourceNodeID() : -1;
+	m_gateSettings.sourceIndex = channel != nullptr ? channel->getSourceIndex() : 0;
+	m_gateSettings.subProcessorIdx = channel != nullptr ? channel->getSubProcessorIdx() : 0;
+	m_gateSettings.line = line;
+	m_gateSettings.preSeconds = jmax(0.0f, preMs) / 1000.0f;
+	m_gateSettings.postSeconds = jmax(0.0f, postMs) / 1000.0f;
+}
+
+bool RecordNode::isRecordGated() const
+{
+	return m_gateChannel != nullptr;
+}
+
+void RecordNode::configureRecordGate()
+{
+	m_gate = m_gateSettings;
+	m_gateChannel = nullptr;
+	if (m_gate.sourceID >= 0)
+	{
+		int index = getEventChannelIndex(m_gate.sourceIndex, m_gate.sourceID, m_gate.subProcessorIdx);
+		if (index >= 0 && eventChannelArray[index]->getChannelType() == EventChannel::TTL)
+			m_gateChannel = eventChannelArray[index];
+		else
+			std::cerr << "Record gate channel not found, recording everything" << std::endl;
+	}
+
+	//the readers wait on the samples a window may still start in
+	Array<int> holdSamples;
+	if (m_gateChannel != nullptr)
+	{
+		for (int group = 0; group < m_dataQueue->getNumGroups(); ++group)
+		{
+			const float rate = dataChannelArray[groupSourceChannels[groupOffsets[group]]]->getSampleRate();
+			holdSamples.add(int(std::ceil(m_gate.preSeconds * rate)) + 1);
+		}
+	}
+	m_dataQueue->setGate(holdSamples);
+}
+
+int RecordNode::getRequiredQueueBlocks(int numRecordedChannels) const
+{
+	//the pre-trigger data, or the data held back for the gate windows, comes on top of the stall tolerance
+	const float heldSeconds = jmax(m_preTriggerSeconds, m_gateSettings.sourceID >= 0 ? m_gateSettings.preSeconds : 0.0f);
+	int64 blocks = int64(std::ceil(m_incomingSampleRate * (m_stallTolerance + heldSeconds) / WRITE_BLOCK_LENGTH));
+	//floats, plus the raw codes some channels keep, or only int16 samples
+	const int64 sampleBytes = m_dataQueue->isInt16Storage() ? sizeof(int16) : sizeof(float) + sizeof(int16);
+	int64 blockBytes = int64(WRITE_BLOCK_LENGTH) * jmax(1, numRecordedChannels) * sampleBytes;
+	int64 maxBlocks = DATA_BUFFER_MAX_BYTES / blockBytes;
+
+	if (blocks > maxBlocks)
+	{
+		std::cerr << "Record queue limited to " << String(maxBlocks * WRITE_BLOCK_LENGTH / m_incomingSampleRate, 1)
+			<< " s of data instead of " << m_stallTolerance + heldSeconds << " s" << std::endl;
+		blocks = maxBlocks;
+	}
+	return int(jmax(int64(DATA_BUFFER_NBLOCKS), blocks));
+}
+
+bool RecordNode::isAnyRecordThreadRunning() const
+{
+	for (int i = 0; i < m_recordThreads.size(); ++i)
+	{
+		if (m_recordThreads[i]->isThreadRunning())
+			return true;
+	}
+	return false;
 }
 
 
 void RecordNode::handleEvent(const EventChannel* eventInfo, const MidiMessage& event, int samplePosition)
 {
+	//every source's event channels reach the record node, so it reports the sync pulses, recording or not
+	ClockSynchronizer& clockSync = AccessClass::getProcessorGraph()->getClockSynchronizer();
+	const int syncLine = clockSync.getSyncLine();
+	if (syncLine >= 0 && eventInfo && eventInfo->getChannelType() == EventChannel::TTL
+		&& *reinterpret_cast<const uint16*>(event.getRawData() + 16) == syncLine && size_t(syncLine / 8) < eventInfo->getDataSize())
+	{
+		const uint8* word = event.getRawData() + EVENT_BASE_SIZE;
+		if ((word[syncLine / 8] >> (syncLine % 8)) & 1)
+			clockSync.addSyncEdge(getProcessorFullId(Event::getSourceID(event), Event::getSubProcessorIdx(event)),
+				Event::getTimestamp(event), eventInfo->getSampleRate());
+	}
+
     if (isRecording)
     {
+			//the gate channel is only changed when not recording
+			if (eventInfo != nullptr && eventInfo == m_gateChannel && size_t(m_gate.line / 8) < eventInfo->getDataSize()
+				&& *reinterpret_cast<const uint16*>(event.getRawData() + 16) == m_gate.line)
+			{
+				const uint8* word = event.getRawData() + EVENT_BASE_SIZE;
+				if ((word[m_gate.line / 8] >> (m_gate.line % 8)) & 1)
+					m_gateEventTimes.add(samplePosition / double(eventInfo->getSampleRate()));
+			}
 
             if ((*(event.getRawData()+0) & 0x80) == 0) // saving flag > 0 (i.e., event has not already been processed)
             {
@@ -460,6 +936,8 @@ void RecordNode::handleEvent(const EventChannel* eventInfo, const MidiMessage& e
 				else
 					eventIndex = -1;
 				m_eventQueue->addEvent(event, timestamp, eventIndex);
+				if (++m_eventsSinceWakeup >= EVENT_BUFFER_NEVENTS / 4)
+					wakeRecordThreads();
             }
     }
 }
@@ -475,22 +953,62 @@ void RecordNode::process(AudioSampleBuffer& buffer)
 	// FIRST: cycle through events -- extract the TTLs and the timestamps
     checkForEvents();
 
-    if (isRecording)
+    // while the pre-trigger is armed the data is also queued, with no one reading it
+    const SpinLock::ScopedLockType queueLock(m_queueWriteLock);
+    const bool recording = isRecording;
+
+    if (recording || m_preTriggerArmed)
     {
+		int numGroups = m_dataQueue->getNumGroups();
+
+		// the windows around the gate events start from the current write position of each group
+		if (m_gateEventTimes.size() > 0)
+		{
+			for (int group = 0; group < numGroups; ++group)
+			{
+				const double rate = dataChannelArray[groupSourceChannels.getUnchecked(groupOffsets.getUnchecked(group))]->getSampleRate();
+				const int64 blockStart = m_dataQueue->getWritePosition(group);
+				for (int i = 0; i < m_gateEventTimes.size(); ++i)
+				{
+					const int64 eventPos = blockStart + int64(m_gateEventTimes.getUnchecked(i) * rate);
+					m_dataQueue->addGateWindow(group, eventPos - int64(m_gate.preSeconds * rate), eventPos + int64(m_gate.postSeconds * rate));
+				}
+			}
+			m_gateEventTimes.clearQuick();
+		}
+
         // SECOND: write channel data
-		int recordChans = channelMap.size();
-		for (int chan = 0; chan < recordChans; ++chan)
+		int maxSamples = 0;
+		for (int group = 0; group < numGroups; ++group)
 		{
-			int realChan = channelMap[chan];
-			int nSamples = getNumSamples(realChan);
-			int timestamp = getTimestamp(realChan);
-			m_dataQueue->writeChannel(buffer, chan, realChan, nSamples, timestamp);
+			const Array<int>& channels = m_dataQueue->getGroupChannels(group);
+			const int offset = groupOffsets.getUnchecked(group);
+			const int firstChan = groupSourceChannels.getUnchecked(offset);
+			int nSamples = getNumSamples(firstChan);
+			int64 timestamp = getTimestamp(firstChan);
+			maxSamples = jmax(maxSamples, nSamples);
+			for (int i = 0; i < channels.size(); ++i)
+			{
+				const GenericProcessor* rawSource = rawSampleSources.getUnchecked(channels.getUnchecked(i));
+				const int realChan = groupSourceChannels.getUnchecked(offset + i);
+				groupRawData.setUnchecked(offset + i, rawSource ? rawSource->getRawSampleData(dataChannelArray[realChan]->getSourceIndex()) : nullptr);
+			}
+			m_dataQueue->writeGroup(buffer, group, groupSourceChannels.getRawDataPointer() + offset,
+				groupRawData.getRawDataPointer() + offset, nSamples, timestamp);
 		}
 
+		if (!recording)
+			return;
+
+		m_samplesSinceWakeup += maxSamples;
+		if (m_samplesSinceWakeup >= m_writeWakeupSamples)
+			wakeRecordThreads();
+
         //  std::cout << nSamples << " " << samplesWritten << " " << blockIndex << std::endl;
 		if (!setFirstBlock)
 		{
-			m_recordThread->setFirstBlockFlag(true);
+			for (int i = 0; i < m_recordThreads.size(); ++i)
+				m_recordThreads[i]->setFirstBlockFlag(true);
 			setFirstBlock = true;
 		}
         
@@ -508,6 +1026,9 @@ void RecordNode::registerProcessor(const GenericProcessor* sourceNode)
 void RecordNode::registerRecordEngine(RecordEngine* engine)
 {
     engineArray.add(engine);
+	RecordThread* thread = new RecordThread(engine, m_recordThreads.size());
+	thread->setQueuePointers(m_dataQueue, m_eventQueue, m_spikeQueue);
+	m_recordThreads.add(thread);
 }
 
 void RecordNode::registerSpikeSource(const GenericProcessor* processor) 
@@ -528,18 +1049,41 @@ void RecordNode::writeSpike(const SpikeEvent* spike, const SpikeChannel* spikeEl
 	{
 		int electrodeIndex = getSpikeChannelIndex(spikeElectrode->getSourceIndex(), spikeElectrode->getSourceNodeID(), spikeElectrode->getSubProcessorIdx());
 		if (electrodeIndex >= 0)
+		{
 			m_spikeQueue->addEvent(*spike, spike->getTimestamp(), electrodeIndex);
+			if (++m_eventsSinceWakeup >= m_spikeWakeupCount)
+				wakeRecordThreads();
+		}
 	}
 }
 
+void RecordNode::setWriteWakeupSamples(int numSamples)
+{
+	m_writeWakeupSamples = jmax(1, numSamples);
+}
+
+AsyncWriteService* RecordNode::getWriteService() const
+{
+	return m_writeService;
+}
+
+void RecordNode::wakeRecordThreads()
+{
+	m_samplesSinceWakeup = 0;
+	m_eventsSinceWakeup = 0;
+	for (int i = 0; i < m_recordThreads.size(); ++i)
+		m_recordThreads[i]->notify();
+}
+
 void RecordNode::clearRecordEngines()
 {
+    m_recordThreads.clear();
     engineArray.clear();
 }
 
 const String& RecordNode::getLastSettingsXml() const
 {
-	return m_lastSettingsText;
+	return m_settingsWriter->getText();
 }
 
 File RecordNode::getDataDirectory() const
@@ -34,12 +34,22 @@
 
 #define WRITE_BLOCK_LENGTH 1024
 #define DATA_BUFFER_NBLOCKS 300
+//The data queue is sized to hold this many seconds of incoming data, in case the disk stalls, up to the byte limit below
+#define DATA_BUFFER_STALL_SECONDS 10.0f
+#define DATA_BUFFER_MAX_BYTES (int64(1) << 31)
 #define EVENT_BUFFER_NEVENTS 512
 #define SPIKE_BUFFER_NSPIKES 512
+#define EVENT_BUFFER_NBYTES (EVENT_BUFFER_NEVENTS * 256)
+#define SPIKE_BUFFER_NBYTES (SPIKE_BUFFER_NSPIKES * 4096)
+//The spike queue of recordings without continuous data, which have to absorb much higher spike rates
+#define SPIKE_ONLY_BUFFER_NSPIKES 65536
+#define SPIKE_ONLY_BUFFER_NBYTES (SPIKE_ONLY_BUFFER_NSPIKES * 1024)
 
 class RecordEngine;
 class RecordThread;
 class DataQueue;
+class AsyncWriteService;
+class SettingsWriter;
 
 /**
 
@@ -53,7 +63,8 @@ class DataQueue;
 */
 
 class RecordNode : public GenericProcessor,
-    public FilenameComponentListener
+    public FilenameComponentListener,
+    private AsyncUpdater
 {
 public:
 
@@ -76,6 +87,9 @@ public:
     */
     void setParameter(int parameterIndex, float newValue) override;
 
+	/** Adds the queues handing the data to the record threads */
+	int64 getMemoryFootprint() const override;
+
 	/** returns current experiment number */
 	int getExperimentNumber() const;
 	/** returns current recording number */
@@ -94,11 +108,41 @@ public:
     /** returns channel names and whether we record them */
     void getChannelNamesAndRecordingStatus(StringArray& names, Array<bool>& recording);
 
-    /** Called by the ControlPanel to determine the amount of space
-        left in the current dataDirectory.
+    /** Called by the ControlPanel to determine the fraction of space used
+        in the current dataDirectory, together with any other volume the
+        record engines write to.
     */
     float getFreeSpace() const;
 
+    /** Gets the ID of each record engine, the fraction of the data queue it still has to write and how many
+        times faster than the incoming data it has been able to write it (0 if unknown) */
+    void getRecordBacklogs(StringArray& engines, Array<float>& backlogs, Array<float>& speedRatios) const;
+
+    /** Checks the record backlogs, and logs a warning when the fullest one goes past 50% or 90% of the
+        queue, or data is dropped. Called periodically from the message thread.
+        @return 0 if there's nothing to report, 1 past 50%, 2 past 90% or if data was dropped.*/
+    int updateBacklogAlarm();
+
+    /** Sets how many seconds of disk stall the data queue must absorb. Applies from the next recording */
+    void setStallTolerance(float seconds);
+    float getStallTolerance() const;
+
+    /** Sets how many seconds of data from before the recording starts are written with it, 0 to disable.
+        While acquiring and not recording, the data queue then keeps the most recent data of the recorded
+        channels, and the engines get it, with its own timestamps, as the start of the recording.
+        Only continuous data is kept. */
+    void setPreTriggerLength(float seconds);
+    float getPreTriggerLength() const;
+
+    /** Records only the continuous data from preMs before to postMs after each rising edge of a TTL line,
+        instead of all of it. The event channel is the one of the record node with the same source as
+        channel, which can belong to another processor; nullptr records everything. The engines write
+        the windows one after the other, and those that keep an index of the segments list them.
+        Events and spikes are still recorded in full. Applies from the next recording */
+    void setRecordGate(const EventChannel* channel, int line, float preMs, float postMs);
+    /** Returns true if the current recording only keeps the data around the gate events */
+    bool isRecordGated() const;
+
     /** Selects a channel relative to a particular processor with ID = id
     */
     void setChannel(const DataChannel* ch);
@@ -149,6 +193,13 @@ public:
     */
     void writeSpike(const SpikeEvent* spike, const SpikeChannel* spikeElectrode);
 
+    /** Sets how many samples per channel are queued before the record threads are woken up to write them.
+        Larger values mean fewer, larger writes. Data never waits longer than WRITE_MAX_DELAY_MS anyway. */
+    void setWriteWakeupSamples(int numSamples);
+
+    /** Returns the service writing files in the background, shared by all the record engines */
+    AsyncWriteService* getWriteService() const;
+
     /** Signals when to create a new data directory when recording starts.*/
     bool newDirectoryNeeded;
 
@@ -157,7 +208,9 @@ public:
     /** Generate a Matlab-compatible datestring */
     String generateDateString() const;
 
-	/** Get the last settings.xml in string form. Since the string will be large, returns a const ref.*/
+	/** Get the last settings.xml in string form. Since the string will be large, returns a const ref.
+	Waits for the settings taken at the start of the recording to be written if they aren't yet, so
+	it shouldn't be called from the processing thread */
 	const String& getLastSettingsXml() const;
 
 	//Called by ProcessorGraph
@@ -192,6 +245,12 @@ private:
     Time timer;
 
 	Array<int> channelMap;
+	/** For each recorded channel, the processor that provides the raw codes of its samples, if any */
+	Array<const GenericProcessor*> rawSampleSources;
+	/** Buffer channel and raw codes of every recorded channel, laid out group after group as in the DataQueue */
+	Array<int> groupSourceChannels;
+	Array<const int16*> groupRawData;
+	Array<int> groupOffsets;
 
     int spikeElectrodeIndex;
 
@@ -199,6 +258,61 @@ private:
     bool hasRecorded;
     bool settingsNeeded;
 	std::atomic<bool> setFirstBlock;
+
+	void wakeRecordThreads();
+	/** Returns the number of blocks the data queue needs to hold the stall tolerance */
+	int getRequiredQueueBlocks(int numRecordedChannels) const;
+	float m_stallTolerance;
+
+	/** Lays out the data queue for the channels in channelMap, discarding its contents */
+	void configureDataQueue();
+	bool allEnginesStoreInt16() const;
+	/** Returns false if no record engine stores continuous data, in which case none is queued */
+	bool anyEngineRecordsContinuousData() const;
+	/** Sizes the spike queue for a recording with or without continuous data. Before the recording starts */
+	void configureSpikeQueue(bool spikeOnly);
+	int m_spikeQueueSpikes;
+	//processing thread only, the spikes queued before the record threads are woken up
+	int m_spikeWakeupCount;
+	/** Starts queuing the data of the recorded channels with no readers if there's a pre-trigger length and
+	acquisition is running but not recording. Message thread only, like the disarm and isArmed methods */
+	void armPreTrigger();
+	void disarmPreTrigger();
+	bool isPreTriggerArmed() const;
+	/** Re-arms the pre-trigger once a series of channel toggles is over */
+	void handleAsyncUpdate() override;
+	float m_preTriggerSeconds;
+	/** The channelMap the queue was laid out for when armed */
+	Array<int> m_armedChannelMap;
+	//guarded by m_queueWriteLock, which the processing thread holds while writing to the queue
+	bool m_preTriggerArmed;
+	SpinLock m_queueWriteLock;
+
+	struct RecordGate
+	{
+		int sourceIndex;
+		int sourceID;
+		int subProcessorIdx;
+		int line;
+		float preSeconds;
+		float postSeconds;
+	};
+	/** The gate set for the next recordings, with a sourceID of -1 if there's none */
+	RecordGate m_gateSettings;
+	/** Finds the gate channel and sets up the data queue for it. Before the recording starts */
+	void configureRecordGate();
+	//the gate of the current recording, only changed when not recording
+	const EventChannel* m_gateChannel;
+	RecordGate m_gate;
+	//processing thread only, the times of the gate events of the current block, from its start
+	Array<double> m_gateEventTimes;
+	/** Highest sample rate of the recorded channels */
+	float m_incomingSampleRate;
+	int m_backlogAlarmLevel;
+	std::atomic<int> m_writeWakeupSamples;
+	//processing thread only, reset on every wakeup
+	int m_samplesSinceWakeup;
+	int m_eventsSinceWakeup;
     /** Generates a default directory name, based on the current date and time */
     String generateDirectoryName();
 
@@ -207,17 +321,23 @@ private:
 
 	virtual void handleTimestampSyncTexts(const MidiMessage& event);
 
+    /** Must outlive the engines, which may still have files open on it */
+    ScopedPointer<AsyncWriteService> m_writeService;
+
     /**RecordEngines loaded**/
     OwnedArray<RecordEngine> engineArray;
 
-	ScopedPointer<RecordThread> m_recordThread;
+	/** One writer thread per record engine, in the same order */
+	OwnedArray<RecordThread> m_recordThreads;
+	bool isAnyRecordThreadRunning() const;
 	ScopedPointer<DataQueue> m_dataQueue;
 	ScopedPointer<EventMsgQueue> m_eventQueue;
 	ScopedPointer<SpikeMsgQueue> m_spikeQueue;
 	
 	Array<int> m_recordedChannelMap;
 
-	String m_lastSettingsText;
+	/** Writes the settings taken when a recording starts in the background, and holds their text */
+	ScopedPointer<SettingsWriter> m_settingsWriter;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RecordNode);
 
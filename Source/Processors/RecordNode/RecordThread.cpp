@@ -26,16 +26,62 @@
 #include "../../AccessClass.h"
 #include "../ProcessorGraph/ProcessorGraph.h"
 #include "RecordNode.h"
+#include "../GenericProcessor/TraceRecorder.h"
+#include "../GenericProcessor/AllocationAudit.h"
 
-#define EVERY_ENGINE for(int eng = 0; eng < m_engineArray.size(); eng++) m_engineArray[eng]
+#if JUCE_WINDOWS
+ #include <windows.h>
+#elif JUCE_MAC
+ #include <mach/mach.h>
+#else
+ #include <time.h>
+#endif
 
+/** CPU time used so far by the calling thread, in seconds */
+static double getThreadCpuSeconds()
+{
+#if JUCE_WINDOWS
+	FILETIME creation, exit, kernel, user;
+	if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+		return 0;
+	uint64 kernelTime = (uint64(kernel.dwHighDateTime) << 32) | kernel.dwLowDateTime;
+	uint64 userTime = (uint64(user.dwHighDateTime) << 32) | user.dwLowDateTime;
+	return (kernelTime + userTime) * 1e-7;
+#elif JUCE_MAC
+	mach_port_t thread = mach_thread_self();
+	thread_basic_info_data_t info;
+	mach_msg_type_number_t count = THREAD_BASIC_INFO_COUNT;
+	kern_return_t res = thread_info(thread, THREAD_BASIC_INFO, (thread_info_t)&info, &count);
+	mach_port_deallocate(mach_task_self(), thread);
+	if (res != KERN_SUCCESS)
+		return 0;
+	return info.user_time.seconds + info.system_time.seconds + (info.user_time.microseconds + info.system_time.microseconds) * 1e-6;
+#else
+	timespec ts;
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+		return 0;
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+}
 
-RecordThread::RecordThread(const OwnedArray<RecordEngine>& engines) :
-Thread("Record Thread"),
-m_engineArray(engines),
+
+RecordThread::RecordThread(RecordEngine* engine, int reader) :
+Thread("Record Thread " + engine->getEngineID()),
+m_engine(engine),
+m_reader(reader),
+m_samplesWritten(0),
+m_busyTicks(0),
+m_numWriteCycles(0),
+m_eventsWritten(0),
+m_spikesWritten(0),
+m_recordSeconds(0),
+m_cpuSeconds(0),
 m_receivedFirstBlock(false),
-m_cleanExit(true)
+m_cleanExit(true),
+m_numChannels(0),
+m_traceName(TraceRecorder::internName("Write " + engine->getEngineID()))
 {
+	zeromem(m_latencyBins, sizeof(m_latencyBins));
 }
 
 RecordThread::~RecordThread()
@@ -77,6 +123,14 @@ void RecordThread::run()
 {
 	const AudioSampleBuffer& dataBuffer = m_dataQueue->getAudioBufferReference();
 	bool closeEarly = true;
+	m_samplesWritten = 0;
+	m_busyTicks = 0;
+	zeromem(m_latencyBins, sizeof(m_latencyBins));
+	m_numWriteCycles = 0;
+	m_eventsWritten = 0;
+	m_spikesWritten = 0;
+	m_recordSeconds = 0;
+	m_cpuSeconds = 0;
 	//1-Wait until the first block has arrived, so we can align the timestamps
 	while (!m_receivedFirstBlock && !threadShouldExit())
 	{
@@ -89,76 +143,210 @@ void RecordThread::run()
 		m_cleanExit = false;
 		closeEarly = false;
 		Array<int64> timestamps;
-		m_dataQueue->getTimestampsForBlock(0, timestamps);
-		EVERY_ENGINE->updateTimestamps(timestamps);
-		EVERY_ENGINE->openFiles(m_rootFolder, m_experimentNumber, m_recordingNumber);
+		m_dataQueue->getStartTimestamps(timestamps);
+		setupDecimators(timestamps);
+		m_engine->updateTimestamps(timestamps);
+		TRACE_SCOPE("Open files");
+		m_engine->openFiles(m_rootFolder, m_experimentNumber, m_recordingNumber);
 	}
+	const int64 startTicks = Time::getHighResolutionTicks();
+	const double startCpu = getThreadCpuSeconds();
+	//with no continuous data to pace the writes, spikes and events are taken in larger batches
+	const bool spikeOnly = m_numChannels == 0;
+	const int maxEvents = spikeOnly ? SPIKE_ONLY_MAX_WRITE_EVENTS : BLOCK_MAX_WRITE_EVENTS;
+	const int maxSpikes = spikeOnly ? SPIKE_ONLY_MAX_WRITE_SPIKES : BLOCK_MAX_WRITE_SPIKES;
 	//3-Normal loop
 	while (!threadShouldExit())
 	{
-		writeData(dataBuffer, BLOCK_MAX_WRITE_SAMPLES, BLOCK_MAX_WRITE_EVENTS, BLOCK_MAX_WRITE_SPIKES);
+		if (!writeData(dataBuffer, BLOCK_MAX_WRITE_SAMPLES, maxEvents, maxSpikes))
+			wait(WRITE_MAX_DELAY_MS);
+		AllocationAudit::endBlock("Record");
 	}
 	std::cout << "Exiting record thread" << std::endl;
 	//4-Before closing the thread, try to write the remaining samples
 	if (!closeEarly)
 	{
+		while (m_dataQueue->isGated() && writeData(dataBuffer, -1, -1, -1)) {}
 		writeData(dataBuffer, -1, -1, -1, true);
 
 		std::cout << "Closing files" << std::endl;
 		//5-Close files
-		EVERY_ENGINE->closeFiles();
+		TRACE_SCOPE("Close files");
+		m_engine->closeFiles();
+		m_recordSeconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks);
+		m_cpuSeconds = getThreadCpuSeconds() - startCpu;
 	}
 	m_cleanExit = true;
 	m_receivedFirstBlock = false;
 }
 
-void RecordThread::writeData(const AudioSampleBuffer& dataBuffer, int maxSamples, int maxEvents, int maxSpikes, bool lastBlock)
+void RecordThread::setupDecimators(Array<int64>& timestamps)
+{
+	m_decimators.clear();
+	bool decimated = false;
+	for (int chan = 0; chan < m_numChannels; ++chan)
+	{
+		int factor = m_engine->getRecordDecimation(chan);
+		RecordDecimator* decimator = nullptr;
+		if (factor > 1)
+		{
+			decimator = new RecordDecimator(factor);
+			timestamps.set(chan, decimator->reset(timestamps[chan]));
+			decimated = true;
+		}
+		m_decimators.add(decimator);
+	}
+	m_decimatedTimestamps = timestamps;
+	if (decimated)
+	{
+		//the channels are decimated at most BLOCK_MAX_WRITE_SAMPLES at a time, by at least 2
+		m_decimatedSamples.malloc(BLOCK_MAX_WRITE_SAMPLES / 2 + 1);
+		m_decimatedInt16.malloc(BLOCK_MAX_WRITE_SAMPLES / 2 + 1);
+	}
+}
+
+void RecordThread::writeDecimatedData(int chan, const float* buffer, const int16* samples, int size, int64 timestamp)
+{
+	RecordDecimator* decimator = m_decimators.getUnchecked(chan);
+	for (int offset = 0; offset < size; offset += BLOCK_MAX_WRITE_SAMPLES)
+	{
+		int count = jmin(BLOCK_MAX_WRITE_SAMPLES, size - offset);
+		int64 outputTimestamp;
+		int numOutputs = buffer ? decimator->process(buffer + offset, count, timestamp + offset, m_decimatedSamples, outputTimestamp)
+			: decimator->process(samples + offset, count, timestamp + offset, m_decimatedSamples, outputTimestamp);
+		if (numOutputs == 0)
+			continue;
+
+		m_decimatedTimestamps.set(chan, outputTimestamp);
+		m_engine->updateTimestamps(m_decimatedTimestamps, chan);
+		if (buffer)
+			m_engine->writeData(chan, m_channelArray[chan], m_decimatedSamples, numOutputs);
+		else
+		{
+			//the codes were filtered as they are, so they only need rounding back
+			for (int i = 0; i < numOutputs; i++)
+				m_decimatedInt16[i] = int16(jlimit(-32767, 32767, roundToInt(m_decimatedSamples[i])));
+			m_engine->writeDataInt16(chan, m_channelArray[chan], nullptr, m_decimatedInt16, numOutputs);
+		}
+	}
+}
+
+void RecordThread::writeChannelData(const AudioSampleBuffer& dataBuffer, int chan, int index, int size, int64 timestamp, const int16* rawBuffer, const int16* convertedBuffer)
 {
-	Array<int64> timestamps;
-	Array<CircularBufferIndexes> idx;
-	m_dataQueue->startRead(idx, timestamps, maxSamples);
-	EVERY_ENGINE->updateTimestamps(timestamps);
-	EVERY_ENGINE->startChannelBlock(lastBlock);
+	//an int16 queue has no float samples, in which case every channel has one of the int16 buffers
+	const float* buffer = dataBuffer.getNumChannels() > 0 ? dataBuffer.getReadPointer(chan, index) : nullptr;
+	if (m_decimators[chan] != nullptr)
+	{
+		const int16* samples = rawBuffer ? rawBuffer + index : (convertedBuffer ? convertedBuffer + index : nullptr);
+		writeDecimatedData(chan, buffer, samples, size, timestamp);
+	}
+	else if (rawBuffer)
+		m_engine->writeRawData(chan, m_channelArray[chan], buffer, rawBuffer + index, size);
+	else if (convertedBuffer)
+		m_engine->writeDataInt16(chan, m_channelArray[chan], buffer, convertedBuffer + index, size);
+	else
+		m_engine->writeData(chan, m_channelArray[chan], buffer, size);
+}
+
+bool RecordThread::writeData(const AudioSampleBuffer& dataBuffer, int maxSamples, int maxEvents, int maxSpikes, bool lastBlock)
+{
+	bool limitReached = false;
+	const int64 startTicks = Time::getHighResolutionTicks();
+	int numSamples = 0;
+	//a spikes and events only recording has no continuous data at all, and an engine
+	//without continuous data only releases its share of the queue
+	const bool readContinuous = m_numChannels > 0;
+	const bool writeContinuous = readContinuous && m_engine->recordsContinuousData();
+	Array<int64>& timestamps = m_readTimestamps;
+	Array<CircularBufferIndexes>& idx = m_readIndexes;
+	if (readContinuous)
+		m_dataQueue->startRead(m_reader, idx, timestamps, maxSamples);
+	if (writeContinuous)
+	{
+		m_engine->updateTimestamps(timestamps);
+		m_engine->startChannelBlock(lastBlock);
+	}
 	for (int chan = 0; chan < m_numChannels; ++chan)
 	{
+		numSamples = jmax(numSamples, idx[chan].size1 + idx[chan].size2);
+		if (maxSamples > 0 && idx[chan].size1 + idx[chan].size2 >= maxSamples)
+			limitReached = true;
+		if (!writeContinuous)
+			continue;
+		const int16* rawBuffer = m_dataQueue->getRawBufferReference(chan);
+		const int16* convertedBuffer = m_dataQueue->getConvertedBufferReference(chan);
 		if (idx[chan].size1 > 0)
 		{
-			EVERY_ENGINE->writeData(chan, m_channelArray[chan], dataBuffer.getReadPointer(chan, idx[chan].index1), idx[chan].size1);
+			writeChannelData(dataBuffer, chan, idx[chan].index1, idx[chan].size1, timestamps[chan], rawBuffer, convertedBuffer);
 			if (idx[chan].size2 > 0)
 			{
 				timestamps.set(chan, timestamps[chan] + idx[chan].size1);
-				EVERY_ENGINE->updateTimestamps(timestamps, chan);
-				EVERY_ENGINE->writeData(chan, m_channelArray[chan], dataBuffer.getReadPointer(chan, idx[chan].index2), idx[chan].size2);
+				m_engine->updateTimestamps(timestamps, chan);
+				writeChannelData(dataBuffer, chan, idx[chan].index2, idx[chan].size2, timestamps[chan], rawBuffer, convertedBuffer);
 			}
 		}
 	}
-	m_dataQueue->stopRead();
-	EVERY_ENGINE->endChannelBlock(lastBlock);
+	if (readContinuous)
+	{
+		//a gated read stops at the end of a window
+		limitReached = limitReached || m_dataQueue->hasMoreToRead(m_reader);
+		m_dataQueue->stopRead(m_reader);
+	}
+	if (writeContinuous)
+	{
+		m_engine->endChannelBlock(lastBlock);
+		if (numSamples > 0)
+		{
+			m_samplesWritten += numSamples;
+			m_busyTicks += Time::getHighResolutionTicks() - startTicks;
+		}
+	}
 
-	std::vector<EventMessagePtr> events;
-	int nEvents = m_eventQueue->getEvents(events, maxEvents);
+	Array<EventQueue::QueuedEvent>& events = m_readEvents;
+	int nEvents = m_eventQueue->startRead(m_reader, events, maxEvents);
+	if (maxEvents > 0 && nEvents >= maxEvents)
+		limitReached = true;
 	for (int ev = 0; ev < nEvents; ++ev)
 	{
-		const MidiMessage& event = events[ev]->getData();
+		//engines still take MidiMessages; building them here keeps the allocations off the processing thread
+		const AllocationAudit::ScopedExemption engineObjects;
+		const MidiMessage event(events[ev].data, events[ev].dataSize, 0);
 		if (SystemEvent::getBaseType(event) == SYSTEM_EVENT)
 		{
 			uint16 sourceID = SystemEvent::getSourceID(event);
 			uint16 subProcIdx = SystemEvent::getSubProcessorIdx(event);
 			int64 timestamp = SystemEvent::getTimestamp(event);
-			EVERY_ENGINE->writeTimestampSyncText(sourceID, subProcIdx, timestamp,
+			m_engine->writeTimestampSyncText(sourceID, subProcIdx, timestamp,
 				AccessClass::getProcessorGraph()->getRecordNode()->getSourceTimestamp(sourceID, subProcIdx),
 				SystemEvent::getSyncText(event));
 		}
 		else
-			EVERY_ENGINE->writeEvent(events[ev]->getExtra(), events[ev]->getData());
+			m_engine->writeEvent(events[ev].extra, event);
 	}
+	m_eventQueue->stopRead(m_reader);
 
-	std::vector<SpikeMessagePtr> spikes;
-	int nSpikes = m_spikeQueue->getEvents(spikes, maxSpikes);
+	Array<EventQueue::QueuedEvent>& spikes = m_readSpikes;
+	int nSpikes = m_spikeQueue->startRead(m_reader, spikes, maxSpikes);
+	if (maxSpikes > 0 && nSpikes >= maxSpikes)
+		limitReached = true;
 	for (int sp = 0; sp < nSpikes; ++sp)
 	{
-		EVERY_ENGINE->writeSpike(spikes[sp]->getExtra(), &spikes[sp]->getData());
+		const SpikeEventView spike(spikes[sp].data, spikes[sp].dataSize, spikes[sp].channel);
+		if (spike.isValid())
+			m_engine->writeSpikeData(spikes[sp].extra, spike);
+	}
+	m_spikeQueue->stopRead(m_reader);
+
+	if (numSamples > 0 || nEvents > 0 || nSpikes > 0)
+	{
+		const int64 endTicks = Time::getHighResolutionTicks();
+		addWriteLatency(endTicks - startTicks);
+		if (TraceRecorder::isEnabled())
+			TraceRecorder::addSpan(m_traceName, startTicks, endTicks);
+		m_eventsWritten += nEvents;
+		m_spikesWritten += nSpikes;
 	}
+	return limitReached;
 }
 
 void RecordThread::forceCloseFiles()
@@ -166,6 +354,67 @@ void RecordThread::forceCloseFiles()
 	if (isThreadRunning() || m_cleanExit)
 		return;
 
-	EVERY_ENGINE->closeFiles();
+	m_engine->closeFiles();
 	m_cleanExit = true;
-}
\ No newline at end of file
+}
+
+RecordEngine* RecordThread::getRecordEngine() const
+{
+	return m_engine;
+}
+
+float RecordThread::getBacklog() const
+{
+	return m_dataQueue->getBacklog(m_reader);
+}
+
+double RecordThread::getSustainedWriteRate() const
+{
+	const int64 ticks = m_busyTicks;
+	if (ticks <= 0)
+		return 0;
+	return double(m_samplesWritten) / Time::highResolutionTicksToSeconds(ticks);
+}
+
+void RecordThread::addWriteLatency(int64 ticks)
+{
+	double us = Time::highResolutionTicksToSeconds(ticks) * 1e6;
+	int bin = (us > 1) ? int(std::log2(us) * WRITE_LATENCY_STEPS_PER_OCTAVE) : 0;
+	m_latencyBins[jlimit(0, WRITE_LATENCY_BINS - 1, bin)]++;
+	m_numWriteCycles++;
+}
+
+double RecordThread::getLatencyPercentile(double fraction) const
+{
+	//the upper edge of the bin holding the percentile, so it is never underestimated
+	int64 target = int64(std::ceil(fraction * m_numWriteCycles));
+	int64 count = 0;
+	for (int bin = 0; bin < WRITE_LATENCY_BINS; bin++)
+	{
+		count += m_latencyBins[bin];
+		if (count >= target)
+			return std::pow(2.0, double(bin + 1) / WRITE_LATENCY_STEPS_PER_OCTAVE) * 1e-3;
+	}
+	return std::pow(2.0, double(WRITE_LATENCY_BINS) / WRITE_LATENCY_STEPS_PER_OCTAVE) * 1e-3;
+}
+
+String RecordThread::getWriteReport() const
+{
+	if (m_numWriteCycles == 0 || m_recordSeconds <= 0)
+		return String::empty;
+
+	//data throughput as 16-bit samples, whatever the engine actually stores
+	double megabytes = double(m_samplesWritten) * m_numChannels * sizeof(int16) / (1024.0 * 1024.0);
+	double busySeconds = Time::highResolutionTicksToSeconds(m_busyTicks);
+	String report = "Record engine " + m_engine->getEngineID() + ": ";
+	report += String(megabytes / m_recordSeconds, 2) + " MB/s recorded";
+	if (busySeconds > 0)
+		report += ", " + String(megabytes / busySeconds, 1) + " MB/s sustained while writing";
+	report += ", " + String(m_eventsWritten) + " events, " + String(m_spikesWritten) + " spikes. ";
+	report += String(m_numWriteCycles) + " write cycles, latency p50 " + String(getLatencyPercentile(0.5), 2)
+		+ " ms, p90 " + String(getLatencyPercentile(0.9), 2)
+		+ " ms, p99 " + String(getLatencyPercentile(0.99), 2)
+		+ " ms, p99.9 " + String(getLatencyPercentile(0.999), 2) + " ms. ";
+	report += "CPU " + String(100.0 * m_cpuSeconds / m_recordSeconds, 1) + "% of one core";
+	return report;
+}
@@ -27,19 +27,39 @@
 #include "../../../JuceLibraryCode/JuceHeader.h"
 #include "EventQueue.h"
 #include "DataQueue.h"
+#include "RecordDecimator.h"
 #include <atomic>
 
 #define BLOCK_MAX_WRITE_SAMPLES 4096
 #define BLOCK_MAX_WRITE_EVENTS 32
 #define BLOCK_MAX_WRITE_SPIKES 32
+//When there is no continuous data, as many are written per cycle
+#define SPIKE_ONLY_MAX_WRITE_EVENTS 256
+#define SPIKE_ONLY_MAX_WRITE_SPIKES 4096
+//The writer threads sleep until the RecordNode has queued this many samples per channel, or the delay below expires
+#define WRITE_WAKEUP_SAMPLES 2048
+#define WRITE_MAX_DELAY_MS 100
+//Write call latencies are binned in this many steps per doubling, from 1us up
+#define WRITE_LATENCY_STEPS_PER_OCTAVE 8
+#define WRITE_LATENCY_BINS (WRITE_LATENCY_STEPS_PER_OCTAVE * 28)
 
 class RecordEngine;
 
 
+/**
+Writes the queued data, events and spikes to disk through a single record engine.
+
+Every engine gets its own RecordThread, reading the shared queues with its own reader index,
+so a slow engine only falls behind by itself.
+
+The thread sleeps between writes. The RecordNode wakes it with notify() once enough data is
+queued, and it also wakes up on its own after WRITE_MAX_DELAY_MS, so queued data never waits longer
+than that. Once awake, it writes until the queues are empty.
+*/
 class RecordThread : public Thread
 {
 public:
-	RecordThread(const OwnedArray<RecordEngine>& engines);
+	RecordThread(RecordEngine* engine, int reader);
 	~RecordThread();
 	void setFileComponents(File rootFolder, int experimentNumber, int recordingNumber);
 	void setChannelMap(const Array<int>& channels);
@@ -50,16 +70,59 @@ public:
 	void setFirstBlockFlag(bool state);
 	void forceCloseFiles();
 
-private:
-	void writeData(const AudioSampleBuffer& buffer, int maxSamples, int maxEvents, int maxSpikes, bool lastBlock = false);
+	RecordEngine* getRecordEngine() const;
+	/** Returns the fraction of the data queue this thread still has to write */
+	float getBacklog() const;
+	/** Returns the samples per channel and second this thread has written while busy since it was started,
+	that is, the rate the engine could sustain. 0 if nothing has been written yet */
+	double getSustainedWriteRate() const;
+	/** Describes how the engine coped with the last recording: the data throughput it sustained, the percentiles
+	of the time each write cycle took and the CPU time the thread used. Only meaningful once the thread has exited */
+	String getWriteReport() const;
 
-	const OwnedArray<RecordEngine>& m_engineArray;
+private:
+	/** Returns true if any of the limits was reached, meaning there might be more to write */
+	bool writeData(const AudioSampleBuffer& buffer, int maxSamples, int maxEvents, int maxSpikes, bool lastBlock = false);
+	/** Hands a contiguous part of a channel to the engine, with its raw codes or converted samples if the queue has them */
+	void writeChannelData(const AudioSampleBuffer& buffer, int chan, int index, int size, int64 timestamp, const int16* rawBuffer, const int16* convertedBuffer);
+	/** Creates the decimators of the channels the engine records at a lower rate, and moves their start timestamps to that rate */
+	void setupDecimators(Array<int64>& timestamps);
+	/** Decimates a contiguous part of a channel, from its float samples or, in an int16 queue, its codes, and writes the result */
+	void writeDecimatedData(int chan, const float* buffer, const int16* samples, int size, int64 timestamp);
+
+	RecordEngine* const m_engine;
+	const int m_reader;
 	Array<int> m_channelArray;
+
+	/** One per channel, nullptr for those written at their own rate */
+	OwnedArray<RecordDecimator> m_decimators;
+	HeapBlock<float> m_decimatedSamples;
+	HeapBlock<int16> m_decimatedInt16;
+	Array<int64> m_decimatedTimestamps;
 	
 	DataQueue* m_dataQueue;
 	EventMsgQueue* m_eventQueue;
 	SpikeMsgQueue *m_spikeQueue;
 
+	/** Filled by the queues on each write cycle, kept so that their storage is reused */
+	Array<int64> m_readTimestamps;
+	Array<CircularBufferIndexes> m_readIndexes;
+	Array<EventQueue::QueuedEvent> m_readEvents;
+	Array<EventQueue::QueuedEvent> m_readSpikes;
+
+	std::atomic<int64> m_samplesWritten;
+	std::atomic<int64> m_busyTicks;
+
+	/** Statistics of the last recording, written only by the thread itself */
+	void addWriteLatency(int64 ticks);
+	double getLatencyPercentile(double fraction) const;
+	int64 m_latencyBins[WRITE_LATENCY_BINS];
+	int64 m_numWriteCycles;
+	int64 m_eventsWritten;
+	int64 m_spikesWritten;
+	double m_recordSeconds;
+	double m_cpuSeconds;
+
 	std::atomic<bool> m_receivedFirstBlock;
 	std::atomic<bool> m_cleanExit;
 
@@ -67,6 +130,8 @@ private:
 	int m_experimentNumber;
 	int m_recordingNumber;
 	int m_numChannels;
+	/** The name of the writes in a TraceRecorder timeline */
+	const char* const m_traceName;
 	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RecordThread);
 };
 
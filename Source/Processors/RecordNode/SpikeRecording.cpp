@@ -0,0 +1,272 @@
+/*
+	------------------------------------------------------------------
+
+	This file is part of the Open Ephys GUI
+	Copyright (C) 2014 Open Ephys
+
+	------------------------------------------------------------------
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+	*/
+
+#include "SpikeRecording.h"
+
+SpikeRecording::SpikeRecording()
+    : messageFile(nullptr), experimentNumber(0), recordingNumber(0)
+{
+}
+
+SpikeRecording::~SpikeRecording()
+{
+    //Any file still open is closed by AsyncRecordEngine
+}
+
+void SpikeRecording::setParameter(EngineParameter& parameter)
+{
+    if ((parameter.id == 0) && (parameter.type == EngineParameter::INT))
+        setWriterThreads(parameter.intParam.value);
+}
+
+String SpikeRecording::getEngineID() const
+{
+    return "SPIKES";
+}
+
+bool SpikeRecording::recordsContinuousData() const
+{
+    return false;
+}
+
+bool SpikeRecording::storesInt16Samples() const
+{
+    //so that the float samples aren't queued for nothing when another engine records them
+    return true;
+}
+
+void SpikeRecording::resetChannels()
+{
+    electrodes.clear();
+}
+
+void SpikeRecording::addSpikeElectrode(int index, const SpikeChannel* elec)
+{
+    electrodes.add(new Electrode());
+}
+
+void SpikeRecording::openFiles(File rootFolder, int experimentNumber_, int recordingNumber_)
+{
+    experimentNumber = experimentNumber_;
+    recordingNumber = recordingNumber_;
+
+    const String suffix = experimentNumber > 1 ? "_" + String(experimentNumber) : String::empty;
+
+    for (int i = 0; i < electrodes.size(); i++)
+    {
+        const SpikeChannel* elec = getSpikeChannel(i);
+        Electrode& electrode = *electrodes[i];
+
+        electrode.numChannels = elec->getNumChannels();
+        electrode.numSamples = elec->getTotalSamples();
+        electrode.recordBytes = SPIKE_RECORD_HEADER_BYTES + sizeof(int16) * electrode.numChannels * electrode.numSamples;
+        electrode.scales.malloc(electrode.numChannels);
+        for (int c = 0; c < electrode.numChannels; c++)
+            electrode.scales[c] = 1.0f / elec->getChannelBitVolts(c);
+        electrode.waveform.malloc(electrode.numChannels * electrode.numSamples);
+
+        String description = "header.description = 'Each record contains 1 int64 timestamp, 1 uint16 sortedID, 1 uint16 recordingNumber "
+            "and num_channels * num_samples int16 samples, channel after channel, in units of bit_volts'; \n";
+        description += "header.electrode = '" + elec->getName() + "';\n";
+        description += "header.num_channels = " + String(electrode.numChannels) + ";\n";
+        description += "header.num_samples = " + String(electrode.numSamples) + ";\n";
+        description += "header.record_bytes = " + String((int)electrode.recordBytes) + ";\n";
+        description += "header.sampleRate = " + String(elec->getSampleRate()) + ";\n";
+        description += "header.bit_volts = [";
+        for (int c = 0; c < electrode.numChannels; c++)
+            description += (c > 0 ? " " : "") + String(elec->getChannelBitVolts(c));
+        description += "];\n";
+
+        File file = rootFolder.getChildFile(elec->getName().removeCharacters(" ") + suffix + ".spk");
+        electrode.batch.file = openFile(file, generateHeader(description));
+        electrode.batch.size = 0;
+        if (electrode.batch.capacity == 0)
+        {
+            //whole records, and at least one
+            electrode.batch.capacity = jmax<size_t>(1, SPIKE_RECORDING_BATCH_BYTES / electrode.recordBytes) * electrode.recordBytes;
+            electrode.batch.data.malloc(electrode.batch.capacity);
+        }
+    }
+
+    String description = "header.description = 'Each record contains 1 int64 timestamp, 1 uint16 recordingNumber, "
+        "1 int16 event channel index (-1 for none), 1 uint16 size (n) and the n bytes of the serialized event'; \n";
+    events.file = openFile(rootFolder.getChildFile("events" + suffix + ".evt"), generateHeader(description));
+    events.size = 0;
+    if (events.capacity == 0)
+    {
+        events.capacity = SPIKE_RECORDING_BATCH_BYTES;
+        events.data.malloc(events.capacity);
+    }
+
+    messageFile = openAsyncFile(rootFolder.getChildFile("sync_messages" + suffix + ".txt"), true);
+}
+
+AsyncWriteFile* SpikeRecording::openFile(const File& file, const String& header)
+{
+    std::cout << "OPENING FILE: " << file.getFullPathName() << std::endl;
+
+    const bool fileExists = file.exists();
+    AsyncWriteFile* asyncFile = openAsyncFile(file, true);
+
+    if (!fileExists && asyncFile != nullptr)
+        asyncFile->write(header.toUTF8(), header.getNumBytesAsUTF8());
+
+    return asyncFile;
+}
+
+String SpikeRecording::generateHeader(const String& description) const
+{
+    String header = "header.format = 'Open Ephys Spike Recording'; \n";
+    header += "header.version = " + String(SPIKE_RECORDING_VERSION) + "; \n";
+    header += "header.header_bytes = " + String(SPIKE_RECORDING_HEADER_BYTES) + ";\n";
+    header += description;
+    header += "header.date_created = '" + generateDateString() + "';\n";
+
+    return header.paddedRight(' ', SPIKE_RECORDING_HEADER_BYTES);
+}
+
+void SpikeRecording::closeFiles()
+{
+    for (int i = 0; i < electrodes.size(); i++)
+    {
+        flush(electrodes[i]->batch);
+        electrodes[i]->batch.file = nullptr;
+    }
+    flush(events);
+    events.file = nullptr;
+    messageFile = nullptr;
+
+    if (!closeAsyncFiles())
+        std::cerr << "Spike recording: some writes have failed" << std::endl;
+}
+
+char* SpikeRecording::reserve(Batch& batch, size_t bytes)
+{
+    if (batch.size + bytes > batch.capacity)
+    {
+        flush(batch);
+
+        //an event larger than a whole batch
+        if (bytes > batch.capacity)
+        {
+            batch.capacity = bytes;
+            batch.data.realloc(batch.capacity);
+        }
+    }
+
+    char* dest = batch.data + batch.size;
+    batch.size += bytes;
+    return dest;
+}
+
+void SpikeRecording::flush(Batch& batch)
+{
+    if (batch.file != nullptr && batch.size > 0)
+        batch.file->write(batch.data, batch.size);
+
+    batch.size = 0;
+}
+
+void SpikeRecording::writeData(int writeChannel, int realChannel, const float* buffer, int size)
+{
+    //no continuous data is recorded
+}
+
+void SpikeRecording::writeSpike(int electrodeIndex, const SpikeEvent* spike)
+{
+    writeSpikeRecord(electrodeIndex, spike->getTimestamp(), spike->getSortedID(), spike->getDataPointer());
+}
+
+void SpikeRecording::writeSpikeData(int electrodeIndex, const SpikeEventView& spike)
+{
+    if (!isPositiveAndBelow(electrodeIndex, electrodes.size()))
+        return;
+
+    Electrode& electrode = *electrodes.getUnchecked(electrodeIndex);
+    memcpy(electrode.waveform, spike.getDataPointer(), sizeof(float) * electrode.numChannels * electrode.numSamples);
+
+    writeSpikeRecord(electrodeIndex, spike.getTimestamp(), spike.getSortedID(), electrode.waveform);
+}
+
+void SpikeRecording::writeSpikeRecord(int electrodeIndex, int64 timestamp, uint16 sortedID, const float* waveform)
+{
+    if (!isPositiveAndBelow(electrodeIndex, electrodes.size()))
+        return;
+
+    Electrode& electrode = *electrodes.getUnchecked(electrodeIndex);
+    if (electrode.batch.file == nullptr)
+        return;
+
+    char* record = reserve(electrode.batch, electrode.recordBytes);
+    const uint16 recording = uint16(recordingNumber);
+    memcpy(record, &timestamp, sizeof(int64));
+    memcpy(record + 8, &sortedID, sizeof(uint16));
+    memcpy(record + 10, &recording, sizeof(uint16));
+
+    //records are whole multiples of 2 bytes into a batch, so the samples are aligned
+    int16* samples = reinterpret_cast<int16*>(record + SPIKE_RECORD_HEADER_BYTES);
+    for (int c = 0; c < electrode.numChannels; c++)
+    {
+        const float scale = electrode.scales[c];
+        const float* channelWaveform = waveform + c * electrode.numSamples;
+        int16* channelSamples = samples + c * electrode.numSamples;
+        for (int s = 0; s < electrode.numSamples; s++)
+            channelSamples[s] = int16(jlimit(-32767, 32767, roundToInt(channelWaveform[s] * scale)));
+    }
+}
+
+void SpikeRecording::writeEvent(int eventIndex, const MidiMessage& event)
+{
+    if (events.file == nullptr)
+        return;
+
+    const uint16 size = uint16(jmin(event.getRawDataSize(), 0xffff));
+    const int64 timestamp = Event::getTimestamp(event);
+    const uint16 recording = uint16(recordingNumber);
+    const int16 index = int16(eventIndex);
+
+    char* record = reserve(events, 14 + size);
+    memcpy(record, &timestamp, sizeof(int64));
+    memcpy(record + 8, &recording, sizeof(uint16));
+    memcpy(record + 10, &index, sizeof(int16));
+    memcpy(record + 12, &size, sizeof(uint16));
+    memcpy(record + 14, event.getRawData(), size);
+}
+
+void SpikeRecording::writeTimestampSyncText(uint16 sourceID, uint16 sourceIdx, int64 timestamp, float sourceSampleRate, String text)
+{
+    if (messageFile == nullptr)
+        return;
+
+    const String line = String(timestamp) + " " + text + "\n";
+    messageFile->write(line.toUTF8(), line.getNumBytesAsUTF8());
+}
+
+RecordEngineManager* SpikeRecording::getEngineManager()
+{
+    RecordEngineManager* man = new RecordEngineManager("SPIKES", "Spikes and events only", nullptr);
+    EngineParameter* param;
+    param = new EngineParameter(EngineParameter::INT, 0, "Writer threads (0 shares the common pool)", 0, 0, 16);
+    man->addParameter(param);
+    return man;
+}
@@ -0,0 +1,117 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SPIKERECORDING_H_INCLUDED
+#define SPIKERECORDING_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "RecordEngine.h"
+
+#define SPIKE_RECORDING_VERSION 1
+#define SPIKE_RECORDING_HEADER_BYTES 1024
+//Timestamp, sorted ID and recording number, ahead of the samples of every spike record
+#define SPIKE_RECORD_HEADER_BYTES 12
+//The records of each file are gathered into writes of about this size
+#define SPIKE_RECORDING_BATCH_BYTES (1 << 18)
+
+/**
+Records only spikes and events, for long sessions that don't need the continuous data.
+
+As it stores no continuous data, a recording made with it alone skips the continuous path
+altogether (see RecordEngine::recordsContinuousData). Spikes are read in place from the record
+queue, without a SpikeEvent being built for each of them, and every electrode gets a file of
+fixed-size records:
+
+    int64 timestamp, uint16 sortedID, uint16 recordingNumber, then the int16 samples of each
+    channel in turn, in units of the channel's bitVolts
+
+after a text header of SPIKE_RECORDING_HEADER_BYTES giving the layout. Events are stored in
+the same way in one file, as their timestamp, recording number, event channel index, size and
+serialized bytes. The records of each file are gathered in memory and written in batches of
+SPIKE_RECORDING_BATCH_BYTES, so that the writes stay large and sequential whatever the spike rate.
+
+Files are appended to by every recording of an experiment, like those of OriginalRecording.
+*/
+class SpikeRecording : public AsyncRecordEngine
+{
+public:
+    SpikeRecording();
+    ~SpikeRecording();
+
+    void setParameter(EngineParameter& parameter) override;
+    String getEngineID() const override;
+    bool recordsContinuousData() const override;
+    bool storesInt16Samples() const override;
+    void openFiles(File rootFolder, int experimentNumber, int recordingNumber) override;
+    void closeFiles() override;
+    void writeData(int writeChannel, int realChannel, const float* buffer, int size) override;
+    void writeEvent(int eventIndex, const MidiMessage& event) override;
+    void writeTimestampSyncText(uint16 sourceID, uint16 sourceIdx, int64 timestamp, float sourceSampleRate, String text) override;
+    void resetChannels() override;
+    void addSpikeElectrode(int index, const SpikeChannel* elec) override;
+    void writeSpike(int electrodeIndex, const SpikeEvent* spike) override;
+    void writeSpikeData(int electrodeIndex, const SpikeEventView& spike) override;
+
+    static RecordEngineManager* getEngineManager();
+
+private:
+    /** The records not yet written to a file */
+    struct Batch
+    {
+        /** Owned by AsyncRecordEngine */
+        AsyncWriteFile* file{ nullptr };
+        HeapBlock<char> data;
+        size_t capacity{ 0 };
+        size_t size{ 0 };
+    };
+
+    struct Electrode
+    {
+        Batch batch;
+        int numChannels;
+        int numSamples;
+        size_t recordBytes;
+        /** 1 / bitVolts of each channel */
+        HeapBlock<float> scales;
+        /** The waveform of the spike being written, as the queue's samples aren't aligned */
+        HeapBlock<float> waveform;
+    };
+
+    /** Returns room for bytes more at the end of a batch, writing it first if it is full */
+    char* reserve(Batch& batch, size_t bytes);
+    void flush(Batch& batch);
+    void writeSpikeRecord(int electrodeIndex, int64 timestamp, uint16 sortedID, const float* waveform);
+
+    AsyncWriteFile* openFile(const File& file, const String& header);
+    String generateHeader(const String& description) const;
+
+    OwnedArray<Electrode> electrodes;
+    Batch events;
+    AsyncWriteFile* messageFile;
+    int experimentNumber;
+    int recordingNumber;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpikeRecording);
+};
+
+#endif  // SPIKERECORDING_H_INCLUDED
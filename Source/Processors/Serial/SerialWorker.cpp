@@ -0,0 +1,373 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "SerialWorker.h"
+
+
+SerialWorker::SerialWorker (const String& name, int inputBufferBytes, int outputBufferBytes)
+    : Thread (name)
+    , port (nullptr)
+    , reading (false)
+    , inputFifo (inputBufferBytes)
+    , outputFifo (outputBufferBytes)
+    , triggerFifo (SERIAL_WORKER_MAX_TRIGGERS)
+{
+    inputData.malloc (inputBufferBytes);
+    outputData.malloc (outputBufferBytes);
+    chunk.malloc (SERIAL_WORKER_MAX_CHUNK);
+    triggers.malloc (SERIAL_WORKER_MAX_TRIGGERS);
+
+    disarmAll();
+}
+
+
+SerialWorker::~SerialWorker()
+{
+    stop();
+}
+
+
+void SerialWorker::start (ofSerial* port_, bool shouldRead, int priority)
+{
+    stop();
+
+    port = port_;
+    reading = shouldRead;
+
+    inputFifo.reset();
+    outputFifo.reset();
+    triggerFifo.reset();
+    triggerLatency.reset();
+    failed = 0;
+    droppedBytes = 0;
+    droppedTriggers = 0;
+
+    startThread (priority);
+}
+
+
+void SerialWorker::stop()
+{
+    if (isThreadRunning())
+    {
+        signalThreadShouldExit();
+        notify();
+        stopThread (1000);
+    }
+
+    port = nullptr;
+}
+
+
+bool SerialWorker::isRunning() const
+{
+    return isThreadRunning();
+}
+
+
+bool SerialWorker::hasFailed() const
+{
+    return failed.get() != 0;
+}
+
+
+int SerialWorker::getNumDroppedBytes() const
+{
+    return droppedBytes.get();
+}
+
+
+bool SerialWorker::arm (int index, const void* data, int numBytes)
+{
+    // the worker thread reads the commands without locking
+    jassert (! isThreadRunning());
+
+    if (! isPositiveAndBelow (index, SERIAL_WORKER_MAX_ARMED)
+        || ! isPositiveAndNotGreaterThan (numBytes, SERIAL_WORKER_ARMED_BYTES))
+        return false;
+
+    memcpy (armed[index].bytes, data, numBytes);
+    armed[index].numBytes = numBytes;
+
+    return true;
+}
+
+
+void SerialWorker::disarmAll()
+{
+    jassert (! isThreadRunning());
+
+    for (int i = 0; i < SERIAL_WORKER_MAX_ARMED; ++i)
+        armed[i].numBytes = 0;
+}
+
+
+bool SerialWorker::isArmed (int index) const
+{
+    return isPositiveAndBelow (index, SERIAL_WORKER_MAX_ARMED) && armed[index].numBytes > 0;
+}
+
+
+bool SerialWorker::trigger (int index)
+{
+    const int64 ticks = Time::getHighResolutionTicks();
+
+    int start1, size1, start2, size2;
+    triggerFifo.prepareToWrite (1, start1, size1, start2, size2);
+
+    if (size1 == 0)
+    {
+        ++droppedTriggers;
+        return false;
+    }
+
+    triggers[start1].ticks = ticks;
+    triggers[start1].index = index;
+    triggerFifo.finishedWrite (1);
+
+    notify();
+    return true;
+}
+
+
+const ProcessorTimingStats& SerialWorker::getTriggerLatencyStats() const
+{
+    return triggerLatency;
+}
+
+
+int SerialWorker::getNumDroppedTriggers() const
+{
+    return droppedTriggers.get();
+}
+
+
+bool SerialWorker::write (const void* data, int numBytes)
+{
+    {
+        const SpinLock::ScopedLockType lock (writeLock);
+
+        if (numBytes > outputFifo.getFreeSpace())
+        {
+            droppedBytes += numBytes;
+            return false;
+        }
+
+        int start1, size1, start2, size2;
+        outputFifo.prepareToWrite (numBytes, start1, size1, start2, size2);
+
+        memcpy (outputData + start1, data, size1);
+
+        if (size2 > 0)
+            memcpy (outputData + start2, static_cast<const unsigned char*> (data) + size1, size2);
+
+        outputFifo.finishedWrite (size1 + size2);
+    }
+
+    notify();
+    return true;
+}
+
+
+int SerialWorker::read (unsigned char* dest, int maxBytes, int64& receivedTicks)
+{
+    const int headerBytes = sizeof (int64) + sizeof (int32);
+
+    if (inputFifo.getNumReady() < headerBytes)
+        return 0;
+
+    unsigned char header[sizeof (int64) + sizeof (int32)];
+    int32 size;
+
+    int start1, size1, start2, size2;
+    inputFifo.prepareToRead (headerBytes, start1, size1, start2, size2);
+    memcpy (header, inputData + start1, size1);
+
+    if (size2 > 0)
+        memcpy (header + size1, inputData + start2, size2);
+
+    inputFifo.finishedRead (size1 + size2);
+
+    memcpy (&receivedTicks, header, sizeof (int64));
+    memcpy (&size, header + sizeof (int64), sizeof (int32));
+
+    // the whole chunk is consumed, even the bytes that do not fit
+    const int numCopied = jmin (maxBytes, (int) size);
+
+    inputFifo.prepareToRead (size, start1, size1, start2, size2);
+
+    const int copy1 = jmin (numCopied, size1);
+    memcpy (dest, inputData + start1, copy1);
+
+    if (numCopied > copy1)
+        memcpy (dest + copy1, inputData + start2, numCopied - copy1);
+
+    inputFifo.finishedRead (size1 + size2);
+
+    return numCopied;
+}
+
+
+bool SerialWorker::writeTriggers()
+{
+    const int numReady = triggerFifo.getNumReady();
+
+    if (numReady == 0)
+        return false;
+
+    int start1, size1, start2, size2;
+    triggerFifo.prepareToRead (numReady, start1, size1, start2, size2);
+
+    for (int i = 0; i < size1 + size2; ++i)
+    {
+        const Trigger& t = triggers[i < size1 ? start1 + i : start2 + i - size1];
+
+        if (! isArmed (t.index))
+            continue;
+
+        ArmedCommand& command = armed[t.index];
+
+        if (port->writeBytes (command.bytes, command.numBytes) != command.numBytes)
+        {
+            failed = 1;
+            ++droppedTriggers;
+            continue;
+        }
+
+        // until the bytes have left the host, where the port supports waiting for it
+        port->drain();
+        triggerLatency.addBlock (Time::getHighResolutionTicks() - t.ticks, 0);
+    }
+
+    triggerFifo.finishedRead (size1 + size2);
+
+    return true;
+}
+
+
+bool SerialWorker::writePending()
+{
+    const int numReady = outputFifo.getNumReady();
+
+    if (numReady == 0)
+        return false;
+
+    int start1, size1, start2, size2;
+    outputFifo.prepareToRead (numReady, start1, size1, start2, size2);
+
+    int written = port->writeBytes (outputData + start1, size1);
+
+    if (written == size1 && size2 > 0)
+    {
+        const int written2 = port->writeBytes (outputData + start2, size2);
+        written = (written2 == OF_SERIAL_ERROR) ? OF_SERIAL_ERROR : written + written2;
+    }
+
+    if (written == OF_SERIAL_ERROR)
+    {
+        // what could not be written is dropped, not to retry it forever
+        failed = 1;
+        droppedBytes += numReady;
+        outputFifo.finishedRead (numReady);
+        return false;
+    }
+
+    outputFifo.finishedRead (jmax (0, written));
+
+    return written > 0;
+}
+
+
+bool SerialWorker::readAvailable()
+{
+    const int available = port->available();
+
+    if (available == OF_SERIAL_ERROR)
+    {
+        failed = 1;
+        return false;
+    }
+
+    if (available <= 0)
+        return false;
+
+    const int numRead = port->readBytes (chunk, jmin (available, SERIAL_WORKER_MAX_CHUNK));
+
+    if (numRead == OF_SERIAL_ERROR)
+    {
+        failed = 1;
+        return false;
+    }
+
+    if (numRead <= 0)
+        return false;
+
+    const int64 ticks = Time::getHighResolutionTicks();
+    const int32 size = numRead;
+    const int recordBytes = sizeof (int64) + sizeof (int32) + numRead;
+
+    if (recordBytes > inputFifo.getFreeSpace())
+    {
+        droppedBytes += numRead;
+        return true;
+    }
+
+    unsigned char record[sizeof (int64) + sizeof (int32) + SERIAL_WORKER_MAX_CHUNK];
+    memcpy (record, &ticks, sizeof (int64));
+    memcpy (record + sizeof (int64), &size, sizeof (int32));
+    memcpy (record + sizeof (int64) + sizeof (int32), chunk, numRead);
+
+    // the whole record at once, so that the reader never sees a header without its bytes
+    int start1, size1, start2, size2;
+    inputFifo.prepareToWrite (recordBytes, start1, size1, start2, size2);
+    memcpy (inputData + start1, record, size1);
+
+    if (size2 > 0)
+        memcpy (inputData + start2, record + size1, size2);
+
+    inputFifo.finishedWrite (size1 + size2);
+
+    return true;
+}
+
+
+void SerialWorker::run()
+{
+    while (! threadShouldExit())
+    {
+        bool busy = writeTriggers();
+        busy = writePending() || busy;
+
+        if (reading)
+            busy = readAvailable() || busy;
+
+        if (! busy)
+            wait (SERIAL_WORKER_POLL_MS);
+    }
+
+    // what was queued before stop() still goes out
+    while (writeTriggers() || writePending())
+    {
+    }
+}
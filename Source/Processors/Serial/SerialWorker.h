@@ -0,0 +1,167 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef __SERIALWORKER_H_3C9A7E15__
+#define __SERIALWORKER_H_3C9A7E15__
+
+#include <JuceHeader.h>
+#include "ofSerial.h"
+#include "../GenericProcessor/ProcessorTimingStats.h"
+
+#define SERIAL_WORKER_INPUT_BYTES (1 << 16)
+#define SERIAL_WORKER_OUTPUT_BYTES (1 << 14)
+#define SERIAL_WORKER_MAX_CHUNK 1024        // the most bytes handed over by one read()
+#define SERIAL_WORKER_POLL_MS 1
+#define SERIAL_WORKER_MAX_ARMED 16          // pre-armed commands
+#define SERIAL_WORKER_ARMED_BYTES 8         // the longest pre-armed command
+#define SERIAL_WORKER_MAX_TRIGGERS 256      // triggers waiting to be written
+
+/**
+    Does the reads and writes of a serial port on a thread of its own, so that a slow or
+    stalled USB-serial device never holds up the processing thread.
+
+    The port is set up by its owner, and handed over to the worker with start() until
+    stop(): in between, the owner only exchanges bytes with the worker, through two
+    lock-free queues. Received bytes are handed over in chunks of at most
+    SERIAL_WORKER_MAX_CHUNK bytes, each with the Time::getHighResolutionTicks() at which
+    it was read. The worker never reports errors itself: hasFailed() tells the owner,
+    which can warn about it from the message thread.
+
+    As ofSerial ports are non-blocking, the worker polls the port every
+    SERIAL_WORKER_POLL_MS, and is woken up at once by write() and trigger().
+
+    For triggers whose latency matters, commands can be formatted ahead of time with
+    arm(): trigger() then only queues the number of the command, which is written before
+    anything else the worker has to do. The time from trigger() until the command has been
+    transmitted by the host is measured for each of them.
+
+    @see ofSerial
+*/
+class PLUGIN_API SerialWorker : private Thread
+{
+public:
+    SerialWorker (const String& name,
+                  int inputBufferBytes = SERIAL_WORKER_INPUT_BYTES,
+                  int outputBufferBytes = SERIAL_WORKER_OUTPUT_BYTES);
+    ~SerialWorker();
+
+    /** Starts doing the I/O of a port that is set up already, reading from it only if
+        shouldRead is true. The port must not be used directly until stop() returns. */
+    void start (ofSerial* port, bool shouldRead, int priority = 9);
+
+    /** Writes what is left in the output queue, and stops using the port */
+    void stop();
+
+    bool isRunning() const;
+
+    /** Queues bytes to be written, from any thread.
+
+        @return false, queuing nothing, if the queue has no room for all of them.
+    */
+    bool write (const void* data, int numBytes);
+
+    /** Copies the next chunk of received bytes, from the thread that owns the worker.
+
+        @return the number of bytes copied, 0 if none was received. The bytes of a chunk
+                that do not fit in dest are dropped.
+    */
+    int read (unsigned char* dest, int maxBytes, int64& receivedTicks);
+
+    /** Formats the command trigger (index) will write. Only while the worker is stopped.
+
+        @return false if the index or the size are out of range.
+    */
+    bool arm (int index, const void* data, int numBytes);
+
+    /** Forgets the commands set with arm() */
+    void disarmAll();
+
+    bool isArmed (int index) const;
+
+    /** Queues a command set with arm(), from a single thread, normally the processing
+        thread. It is written before any byte queued with write().
+
+        @return false, queuing nothing, if too many triggers are waiting.
+    */
+    bool trigger (int index);
+
+    /** The time from trigger() until each command was transmitted, since the worker was started */
+    const ProcessorTimingStats& getTriggerLatencyStats() const;
+
+    int getNumDroppedTriggers() const;
+
+    /** True once a read or a write of the port failed, until the worker is started again */
+    bool hasFailed() const;
+
+    /** The number of bytes dropped since the worker was started, the queues being full */
+    int getNumDroppedBytes() const;
+
+private:
+    void run() override;
+
+    /** Writes the queued triggers, returning false if there was none */
+    bool writeTriggers();
+
+    /** Writes what the output queue holds, returning false if there was nothing to write */
+    bool writePending();
+
+    /** Reads what the port has, returning false if there was nothing to read */
+    bool readAvailable();
+
+    ofSerial* port;
+    bool reading;
+
+    AbstractFifo inputFifo;         // of chunks: int64 ticks, int32 size, then the bytes
+    HeapBlock<unsigned char> inputData;
+    AbstractFifo outputFifo;        // of bytes
+    HeapBlock<unsigned char> outputData;
+    SpinLock writeLock;             // so that write() can be called from several threads
+
+    HeapBlock<unsigned char> chunk; // only used by the worker thread
+
+    struct ArmedCommand
+    {
+        unsigned char bytes[SERIAL_WORKER_ARMED_BYTES];
+        int numBytes;
+    };
+
+    struct Trigger
+    {
+        int64 ticks;                // when trigger() was called
+        int index;
+    };
+
+    ArmedCommand armed[SERIAL_WORKER_MAX_ARMED];
+    AbstractFifo triggerFifo;
+    HeapBlock<Trigger> triggers;
+    ProcessorTimingStats triggerLatency;
+
+    Atomic<int> failed;
+    Atomic<int> droppedBytes;
+    Atomic<int> droppedTriggers;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SerialWorker);
+};
+
+#endif  // __SERIALWORKER_H_3C9A7E15__
@@ -1,435 +1,671 @@
-/*
-    ------------------------------------------------------------------
-
-    This file is part of the Open Ephys GUI
-    Copyright (C) 2016 Open Ephys
-
-    ------------------------------------------------------------------
-
-    This program is free software: you can redistribute it and/or modify
-    it under the terms of the GNU General Public License as published by
-    the Free Software Foundation, either version 3 of the License, or
-    (at your option) any later version.
-
-    This program is distributed in the hope that it will be useful,
-    but WITHOUT ANY WARRANTY; without even the implied warranty of
-    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
-    GNU General Public License for more details.
-
-    You should have received a copy of the GNU General Public License
-    along with this program.  If not, see <http://www.gnu.org/licenses/>.
-
-*/
-
-#include "SourceNode.h"
-#include "../SourceNode/SourceNodeEditor.h"
-#include <stdio.h>
-#include "../../AccessClass.h"
-#include "../PluginManager/OpenEphysPlugin.h"
-
-
-SourceNode::SourceNode (const String& name_, DataThreadCreator dt)
-    : GenericProcessor      (name_)
-    , sourceCheckInterval   (2000)
-    , wasDisabled           (true)
-    , dataThread            (nullptr)
-    , ttlState              (0)
-{
-    setProcessorType (PROCESSOR_TYPE_SOURCE);
-
-    dataThread = dt (this);
-
-    if (dataThread != nullptr)
-    {
-        if (! dataThread->foundInputSource())
-        {
-            setEnabledState (false);
-        }
-		resizeBuffers();
-    }
-    else
-    {
-        setEnabledState (false);
-        //   eventChannelState = 0;
-    }
-
-    // check for input source every few seconds
-    startTimer (sourceCheckInterval);
-
-    timestamp = 0;
-}
-
-
-SourceNode::~SourceNode()
-{
-    if (dataThread->isThreadRunning())
-    {
-        std::cout << "Forcing thread to stop." << std::endl;
-        dataThread->stopThread (500);
-    }
-}
-
-//This is going to be quite slow, since is reallocating everything, but it's the 
-//safest way to handle a possible varying number of subprocessors
-void SourceNode::resizeBuffers()
-{
-	inputBuffers.clear();
-	eventCodeBuffers.clear();
-	eventStates.clear();
-	if (dataThread != nullptr)
-	{
-		dataThread->resizeBuffers();
-		int numSubProcs = dataThread->getNumSubProcessors();
-		for (int i = 0; i < numSubProcs; i++)
-		{
-			inputBuffers.add(dataThread->getBufferAddress(i));
-			eventCodeBuffers.add(new MemoryBlock(10000*sizeof(uint64)));
-			eventStates.add(0);
-		}
-	}
-}
-
-
-void SourceNode::requestChainUpdate()
-{
-    CoreServices::updateSignalChain (getEditor());
-}
-
-
-void SourceNode::getEventChannelNames (StringArray& names)
-{
-    if (dataThread != 0)
-        dataThread->getEventChannelNames(names);
-}
-
-
-void SourceNode::updateSettings()
-{
-	if (dataThread)
-	{
-		dataThread->updateChannels();
-		resizeBuffers();
-		int nChans = dataChannelArray.size();
-		for (int i = 0; i < nChans; i++)
-		{
-			String unit = dataThread->getChannelUnits(i);
-			if (unit.isNotEmpty())
-				dataChannelArray[i]->setDataUnits(unit);
-		}
-	}
-}
-
-
-void SourceNode::actionListenerCallback (const String& msg)
-{
-    //std::cout << msg << std::endl;
-
-    if (msg.equalsIgnoreCase ("HI"))
-    {
-        // std::cout << "HI." << std::endl;
-        // dataThread->setOutputHigh();
-        ttlState = 1;
-    }
-    else if (msg.equalsIgnoreCase ("LO"))
-    {
-        // std::cout << "LO." << std::endl;
-        // dataThread->setOutputLow();
-        ttlState = 0;
-    }
-}
-
-
-float SourceNode::getSampleRate(int sub) const
-{
-    if (dataThread != nullptr)
-        return dataThread->getSampleRate(sub);
-    else
-        return 44100.0;
-}
-
-
-float SourceNode::getDefaultSampleRate() const
-{
-    if (dataThread != nullptr)
-        return dataThread->getSampleRate(0);
-    else
-        return 44100.0;
-}
-
-int SourceNode::getDefaultNumDataOutputs(DataChannel::DataChannelTypes type, int sub) const
-{
-	if (dataThread)
-		return dataThread->getNumDataOutputs(type, sub);
-	else return 0;
-}
-
-float SourceNode::getBitVolts (const DataChannel* chan) const
-{
-    if (dataThread != 0)
-        return dataThread->getBitVolts (chan);
-    else
-        return 1.0f;
-}
-
-void SourceNode::setChannelInfo(int channel, String name, float bitVolts)
-{
-	dataChannelArray[channel]->setName(name);
-	dataChannelArray[channel]->setBitVolts(bitVolts);
-}
-
-void SourceNode::createEventChannels()
-{
-	ttlChannels.clear();
-	if (dataThread)
-	{
-		//Create base TTL event channels
-		int nSubs = dataThread->getNumSubProcessors();
-		for (int i = 0; i < nSubs; i++)
-		{
-			int nChans = dataThread->getNumTTLOutputs(i);
-			nChans = jmin(nChans, 64); //Just 64 TTL channels per source for now
-			if (nChans > 0)
-			{
-				EventChannel* chan = new EventChannel(EventChannel::TTL, nChans, 0, dataThread->getSampleRate(i), this, i);
-				chan->setName(getName() + " source TTL events input");
-				chan->setDescription("TTL Events coming from the hardware source processor \"" + getName() + "\"");
-				chan->setIdentifier("sourceevent");
-				eventChannelArray.add(chan);
-				ttlChannels.add(chan);
-			}
-			else
-				ttlChannels.add(nullptr);
-		}
-		//Add other events that the source might create
-		Array<EventChannel*> events;
-		dataThread->createExtraEvents(events);
-		eventChannelArray.addArray(events);
-	}
-}
-
-void SourceNode::setEnabledState (bool newState)
-{
-    if (newState && ! dataThread->foundInputSource())
-    {
-        isEnabled = false;
-    }
-    else
-    {
-        isEnabled = newState;
-    }
-}
-
-
-void SourceNode::setParameter (int parameterIndex, float newValue)
-{
-    editor->updateParameterButtons (parameterIndex);
-    //std::cout << "Got parameter change notification";
-}
-
-
-AudioProcessorEditor* SourceNode::createEditor()
-{
-    if (dataThread != nullptr)
-    {
-        editor = dataThread->createEditor (this);
-    }
-    else
-    {
-        editor = nullptr;
-    }
-
-    if (editor == nullptr)
-    {
-        editor = new SourceNodeEditor (this, true);
-    }
-
-    return editor;
-}
-
-
-bool SourceNode::tryEnablingEditor()
-{
-    if (! isSourcePresent())
-    {
-        //std::cout << "No input source found." << std::endl;
-        return false;
-    }
-    else if (isEnabled)
-    {
-        // If we're already enabled (e.g. if we're being called again
-        // due to timerCallback()), then there's no need to go through
-        // the editor again.
-        return true;
-    }
-
-    std::cout << "Input source found." << std::endl;
-    setEnabledState (true);
-
-    GenericEditor* ed = getEditor();
-    CoreServices::highlightEditor (ed);
-    return true;
-}
-
-
-void SourceNode::timerCallback()
-{
-    if (! tryEnablingEditor() && isEnabled)
-    {
-        std::cout << "Input source lost." << std::endl;
-        setEnabledState (false);
-        GenericEditor* ed = getEditor();
-        CoreServices::highlightEditor (ed);
-    }
-}
-
-
-bool SourceNode::isReady()
-{
-    return isSourcePresent() && dataThread->isReady();
-}
-
-
-bool SourceNode::isSourcePresent() const
-{
-    return dataThread && dataThread->foundInputSource();
-}
-
-
-bool SourceNode::enable()
-{
-    std::cout << "Source node received enable signal" << std::endl;
-
-    wasDisabled = false;
-
-    stopTimer();
-
-    if (dataThread != nullptr)
-    {
-        dataThread->startAcquisition();
-        return true;
-    }
-    else
-    {
-        return false;
-    }
-}
-
-
-bool SourceNode::disable()
-{
-    std::cout << "Source node received disable signal" << std::endl;
-
-    if (dataThread != nullptr)
-        dataThread->stopAcquisition();
-
-    startTimer (2000); // timer to check for connected source
-
-    wasDisabled = true;
-
-    std::cout << "SourceNode returning true." << std::endl;
-
-    return true;
-}
-
-
-void SourceNode::acquisitionStopped()
-{
-    if (! wasDisabled)
-    {
-        std::cout << "Source node sending signal to UI." << std::endl;
-
-        AccessClass::getUIComponent()->disableCallbacks();
-        setEnabledState (false);
-
-        GenericEditor* ed = (GenericEditor*) getEditor();
-        CoreServices::highlightEditor (ed);
-    }
-}
-
-int SourceNode::getNumSubProcessors() const
-{
-	if (!dataThread) return 0;
-	return dataThread->getNumSubProcessors();
-}
-
-void SourceNode::process(AudioSampleBuffer& buffer)
-{
-	int nSubs = dataThread->getNumSubProcessors();
-	int copiedChannels = 0;
-	for (int sub = 0; sub < nSubs; sub++)
-	{
-		int channelsToCopy = getNumOutputs(sub);
-		int nSamples = inputBuffers[sub]->readAllFromBuffer(buffer, &timestamp, static_cast<uint64*>(eventCodeBuffers[sub]->getData()), buffer.getNumSamples(), copiedChannels, channelsToCopy);
-		copiedChannels += channelsToCopy;
-
-		setTimestampAndSamples(timestamp, nSamples, sub);
-
-		if (ttlChannels[sub])
-		{
-			int numEventChannels = ttlChannels[sub]->getNumChannels();
-			// fill event buffer
-			uint64 last = eventStates[sub];
-			for (int i = 0; i < nSamples; ++i)
-			{
-				uint64 current = *(static_cast<uint64*>(eventCodeBuffers[sub]->getData()) + i);
-				//If there has been no change to the TTL word, avoid doing anything at all here
-				if (last != current)
-				{
-					//Create a TTL event for each bit that has changed
-					for (int c = 0; c < numEventChannels; ++c)
-					{
-						if (((current >> c) & 0x01) != ((last >> c) & 0x01))
-						{
-							TTLEventPtr event = TTLEvent::createTTLEvent(ttlChannels[sub], timestamp + i, &current, sizeof(uint64), c);
-							addEvent(ttlChannels[sub], event, i);
-						}
-					}
-					last = current;
-				}
-			}
-			eventStates.set(sub, last);
-		}
-	}
-}
-
-
-void SourceNode::saveCustomParametersToXml (XmlElement* parentElement)
-{
-    XmlElement* channelXml = parentElement->createNewChildElement ("CHANNEL_INFO");
-    if (dataThread->usesCustomNames())
-    {
-        Array<ChannelCustomInfo> channelInfo;
-        dataThread->getChannelInfo (channelInfo);
-        for (int i = 0; i < channelInfo.size(); ++i)
-        {
-            XmlElement* chan = channelXml->createNewChildElement ("CHANNEL");
-            chan->setAttribute ("name",     channelInfo[i].name);
-            chan->setAttribute ("number",   i);
-            chan->setAttribute ("gain",     channelInfo[i].gain);
-        }
-    }
-}
-
-
-void SourceNode::loadCustomParametersFromXml()
-{
-    if (parametersAsXml != nullptr)
-    {
-        // use parametersAsXml to restore state
-        forEachXmlChildElement (*parametersAsXml, xmlNode)
-        {
-            if (xmlNode->hasTagName ("CHANNEL_INFO"))
-            {
-                forEachXmlChildElementWithTagName (*xmlNode, chan, "CHANNEL")
-                {
-                    const int number = chan->getIntAttribute ("number");
-                    const float gain = chan->getDoubleAttribute ("gain");
-                    String name = chan->getStringAttribute ("name");
-
-                    dataThread->modifyChannelGain (number, gain);
-                    dataThread->modifyChannelName (number, name);
-                }
-            }
-        }
-    }
-}
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "SourceNode.h"
+#include "../SourceNode/SourceNodeEditor.h"
+#include <stdio.h>
+#include "../../AccessClass.h"
+#include "../PluginManager/OpenEphysPlugin.h"
+
+//Upper limit for the automatic growth of the input buffers, in samples per channel
+#define MAX_INPUT_BUFFER_SIZE 160000
+
+#if JUCE_INTEL && (defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2))
+ #define SOURCE_NODE_SSE2 1
+ #include <emmintrin.h>
+#endif
+#if JUCE_MSVC
+ #include <intrin.h>
+#endif
+
+namespace
+{
+	/** Index of the lowest set bit of a non-zero word */
+	inline int findLowestSetBit(uint64 word)
+	{
+#if JUCE_MSVC && JUCE_64BIT
+		unsigned long index;
+		_BitScanForward64(&index, word);
+		return (int)index;
+#elif JUCE_MSVC
+		unsigned long index;
+		if (_BitScanForward(&index, (unsigned long)word))
+			return (int)index;
+		_BitScanForward(&index, (unsigned long)(word >> 32));
+		return (int)index + 32;
+#else
+		return __builtin_ctzll(word);
+#endif
+	}
+
+	/** Fills changes with the samples of a block whose event code differs from the previous sample's,
+	the first sample always included, and returns how many were found, at most maxChanges.
+	Runs of identical words are skipped four at a time where SSE2 is available. */
+	int findEventCodeChanges(const uint64* codes, int numSamples, DataBuffer::EventCodeChange* changes, int maxChanges)
+	{
+		int numChanges = 0;
+		int i = 0;
+		while (i < numSamples && numChanges < maxChanges)
+		{
+			if (i == 0 || codes[i] != codes[i - 1])
+			{
+				changes[numChanges].sampleOffset = i;
+				changes[numChanges].eventCode = codes[i];
+				++numChanges;
+			}
+			++i;
+#if SOURCE_NODE_SSE2
+			//compares words i to i + 3 with words i - 1 to i + 2
+			while (i >= 1 && i + 4 <= numSamples)
+			{
+				const __m128i a0 = _mm_loadu_si128((const __m128i*)(codes + i));
+				const __m128i a1 = _mm_loadu_si128((const __m128i*)(codes + i + 2));
+				const __m128i b0 = _mm_loadu_si128((const __m128i*)(codes + i - 1));
+				const __m128i b1 = _mm_loadu_si128((const __m128i*)(codes + i + 1));
+				const __m128i diff = _mm_or_si128(_mm_xor_si128(a0, b0), _mm_xor_si128(a1, b1));
+				if (_mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) != 0xFFFF)
+					break;
+				i += 4;
+			}
+#endif
+		}
+		return numChanges;
+	}
+}
+
+
+SourceNode::SourceNode (const String& name_, DataThreadCreator dt)
+    : GenericProcessor      (name_)
+    , sourceCheckInterval   (2000)
+    , wasDisabled           (true)
+    , dataThread            (nullptr)
+    , rawBlockSize          (10000)
+    , ttlState              (0)
+{
+    setProcessorType (PROCESSOR_TYPE_SOURCE);
+
+    dataThread = dt (this);
+
+    if (dataThread != nullptr)
+    {
+        if (! dataThread->foundInputSource())
+        {
+            setEnabledState (false);
+        }
+		resizeBuffers();
+    }
+    else
+    {
+        setEnabledState (false);
+        //   eventChannelState = 0;
+    }
+
+    // check for input source every few seconds
+    startTimer (sourceCheckInterval);
+
+    timestamp = 0;
+}
+
+
+SourceNode::~SourceNode()
+{
+    if (dataThread->isThreadRunning())
+    {
+        std::cout << "Forcing thread to stop." << std::endl;
+        dataThread->stopThread (500);
+    }
+}
+
+//This is going to be quite slow, since is reallocating everything, but it's the 
+//safest way to handle a possible varying number of subprocessors
+void SourceNode::resizeBuffers()
+{
+	inputBuffers.clear();
+	multiStreamInputBuffers.clear();
+	eventCodeBuffers.clear();
+	eventStates.clear();
+	if (dataThread != nullptr)
+	{
+		dataThread->resizeBuffers();
+		int numSubProcs = dataThread->getNumSubProcessors();
+		for (int i = 0; i < numSubProcs; i++)
+		{
+			inputBuffers.add(dataThread->getBufferAddress(i));
+			multiStreamInputBuffers.add(dataThread->getMultiStreamBufferAddress(i));
+			eventCodeBuffers.add(new MemoryBlock(10000*sizeof(uint64)));
+			eventStates.add(0);
+		}
+		eventCodeChanges.malloc(10000);
+	}
+}
+
+
+void SourceNode::autoResizeBuffers()
+{
+	//No thread is running at this point, so the buffers can be safely reallocated
+	const LargeSampleBlock::Placement placement = dataThread->getBufferPlacement();
+
+	forEachInputBuffer([&placement](DataBuffer* buffer, int index)
+	{
+		buffer->setPlacement(placement);
+
+		const int peak = buffer->getHighWaterMark();
+		const int64 dropped = buffer->getNumDroppedSamples();
+		const int size = buffer->getBufferSize();
+
+		if (buffer->autoResize(MAX_INPUT_BUFFER_SIZE))
+			std::cout << "Input buffer " << index << " peaked at " << peak << " of " << size << " samples ("
+			          << dropped << " dropped), growing to " << buffer->getBufferSize() << std::endl;
+
+		buffer->resetStatistics();
+	});
+}
+
+
+int64 SourceNode::getMemoryFootprint() const
+{
+	int64 bytes = GenericProcessor::getMemoryFootprint();
+
+	if (dataThread != nullptr)
+		bytes += dataThread->getMemoryFootprint();
+
+	for (int i = 0; i < eventCodeBuffers.size(); i++)
+		bytes += eventCodeBuffers[i]->getSize();
+
+	bytes += MemoryFootprint::ofBlock(eventCodeChanges, 10000);
+	bytes += MemoryFootprint::ofBlock(rawSamples, int64(dataChannelArray.size()) * rawBlockSize);
+
+	return bytes;
+}
+
+void SourceNode::getBufferStatistics(float& peakFill, int64& droppedSamples, float& latencyMs) const
+{
+	peakFill = 0.0f;
+	droppedSamples = 0;
+	latencyMs = 0.0f;
+
+	forEachInputBuffer([&](const DataBuffer* buffer, int sub)
+	{
+		if (buffer->getBufferSize() > 0)
+			peakFill = jmax(peakFill, float(buffer->getHighWaterMark()) / float(buffer->getBufferSize()));
+
+		droppedSamples += buffer->getNumDroppedSamples();
+
+		float sampleRate = dataThread->getSampleRate(sub);
+		if (sampleRate > 0)
+			latencyMs = jmax(latencyMs, 1000.0f * buffer->getReadLatency() / sampleRate);
+	});
+}
+
+
+bool SourceNode::hasSamplesForBlock(int blockSize, double blockSampleRate) const
+{
+	bool ready = true;
+
+	forEachInputBuffer([&](const DataBuffer* buffer, int sub)
+	{
+		const int needed = jmin(blockSize, int(std::ceil(blockSize * dataThread->getSampleRate(sub) / blockSampleRate)));
+
+		if (buffer->getNumSamples() < needed)
+			ready = false;
+	});
+
+	return ready;
+}
+
+
+void SourceNode::requestChainUpdate()
+{
+    CoreServices::updateSignalChain (getEditor());
+}
+
+
+void SourceNode::getEventChannelNames (StringArray& names)
+{
+    if (dataThread != 0)
+        dataThread->getEventChannelNames(names);
+}
+
+
+void SourceNode::updateSettings()
+{
+	if (dataThread)
+	{
+		dataThread->updateChannels();
+		resizeBuffers();
+		int nChans = dataChannelArray.size();
+		bool anyRawSamples = false;
+		for (int i = 0; i < nChans; i++)
+		{
+			DataChannel* chan = dataChannelArray[i];
+			String unit = dataThread->getChannelUnits(i);
+			if (unit.isNotEmpty())
+				chan->setDataUnits(unit);
+
+			//Raw codes are only meaningful while the channel keeps the scaling the thread used to produce its floats
+			DataBuffer* dataBuffer = inputBuffers[chan->getSubProcessorIdx()];
+			bool raw = dataBuffer != nullptr && dataBuffer->hasRawSamples() && dataThread->hasRawSamples(chan)
+				&& chan->getBitVolts() == dataThread->getBitVolts(chan);
+			chan->setRawSamplesAvailable(raw);
+			anyRawSamples = anyRawSamples || raw;
+		}
+		if (anyRawSamples)
+			rawSamples.calloc(nChans * rawBlockSize);
+		else
+			rawSamples.free();
+	}
+}
+
+
+void SourceNode::actionListenerCallback (const String& msg)
+{
+    //std::cout << msg << std::endl;
+
+    if (msg.equalsIgnoreCase ("HI"))
+    {
+        // std::cout << "HI." << std::endl;
+        // dataThread->setOutputHigh();
+        ttlState = 1;
+    }
+    else if (msg.equalsIgnoreCase ("LO"))
+    {
+        // std::cout << "LO." << std::endl;
+        // dataThread->setOutputLow();
+        ttlState = 0;
+    }
+}
+
+
+float SourceNode::getSampleRate(int sub) const
+{
+    if (dataThread != nullptr)
+        return dataThread->getSampleRate(sub);
+    else
+        return 44100.0;
+}
+
+
+float SourceNode::getDefaultSampleRate() const
+{
+    if (dataThread != nullptr)
+        return dataThread->getSampleRate(0);
+    else
+        return 44100.0;
+}
+
+int SourceNode::getDefaultNumDataOutputs(DataChannel::DataChannelTypes type, int sub) const
+{
+	if (dataThread)
+		return dataThread->getNumDataOutputs(type, sub);
+	else return 0;
+}
+
+float SourceNode::getBitVolts (const DataChannel* chan) const
+{
+    if (dataThread != 0)
+        return dataThread->getBitVolts (chan);
+    else
+        return 1.0f;
+}
+
+const int16* SourceNode::getRawSampleData(int channel) const
+{
+	if (rawSamples == nullptr || channel < 0 || channel >= dataChannelArray.size()
+		|| !dataChannelArray[channel]->hasRawSamples())
+		return nullptr;
+
+	return rawSamples + (channel * rawBlockSize);
+}
+
+void SourceNode::setChannelInfo(int channel, String name, float bitVolts)
+{
+	dataChannelArray[channel]->setName(name);
+	dataChannelArray[channel]->setBitVolts(bitVolts);
+}
+
+void SourceNode::createEventChannels()
+{
+	ttlChannels.clear();
+	if (dataThread)
+	{
+		//Create base TTL event channels
+		int nSubs = dataThread->getNumSubProcessors();
+		for (int i = 0; i < nSubs; i++)
+		{
+			int nChans = dataThread->getNumTTLOutputs(i);
+			nChans = jmin(nChans, 64); //Just 64 TTL channels per source for now
+			if (nChans > 0)
+			{
+				EventChannel* chan = new EventChannel(EventChannel::TTL, nChans, 0, dataThread->getSampleRate(i), this, i);
+				chan->setName(getName() + " source TTL events input");
+				chan->setDescription("TTL Events coming from the hardware source processor \"" + getName() + "\"");
+				chan->setIdentifier("sourceevent");
+				eventChannelArray.add(chan);
+				ttlChannels.add(chan);
+			}
+			else
+				ttlChannels.add(nullptr);
+		}
+		//Add other events that the source might create
+		Array<EventChannel*> events;
+		dataThread->createExtraEvents(events);
+		eventChannelArray.addArray(events);
+	}
+}
+
+void SourceNode::setEnabledState (bool newState)
+{
+    if (newState && ! dataThread->foundInputSource())
+    {
+        isEnabled = false;
+    }
+    else
+    {
+        isEnabled = newState;
+    }
+}
+
+
+void SourceNode::setParameter (int parameterIndex, float newValue)
+{
+    editor->updateParameterButtons (parameterIndex);
+    //std::cout << "Got parameter change notification";
+}
+
+
+AudioProcessorEditor* SourceNode::createEditor()
+{
+    if (dataThread != nullptr)
+    {
+        editor = dataThread->createEditor (this);
+    }
+    else
+    {
+        editor = nullptr;
+    }
+
+    if (editor == nullptr)
+    {
+        editor = new SourceNodeEditor (this, true);
+    }
+
+    return editor;
+}
+
+
+bool SourceNode::tryEnablingEditor()
+{
+    if (! isSourcePresent())
+    {
+        //std::cout << "No input source found." << std::endl;
+        return false;
+    }
+    else if (isEnabled)
+    {
+        // If we're already enabled (e.g. if we're being called again
+        // due to timerCallback()), then there's no need to go through
+        // the editor again.
+        return true;
+    }
+
+    std::cout << "Input source found." << std::endl;
+    setEnabledState (true);
+
+    GenericEditor* ed = getEditor();
+    CoreServices::highlightEditor (ed);
+    return true;
+}
+
+
+void SourceNode::timerCallback()
+{
+    if (! tryEnablingEditor() && isEnabled)
+    {
+        std::cout << "Input source lost." << std::endl;
+        setEnabledState (false);
+        GenericEditor* ed = getEditor();
+        CoreServices::highlightEditor (ed);
+    }
+}
+
+
+bool SourceNode::isReady()
+{
+    return isSourcePresent() && dataThread->isReady();
+}
+
+
+bool SourceNode::isSourcePresent() const
+{
+    return dataThread && dataThread->foundInputSource();
+}
+
+
+bool SourceNode::enable()
+{
+    std::cout << "Source node received enable signal" << std::endl;
+
+    wasDisabled = false;
+
+    stopTimer();
+
+    if (dataThread != nullptr)
+    {
+        autoResizeBuffers();
+        dataThread->startAcquisition();
+        return true;
+    }
+    else
+    {
+        return false;
+    }
+}
+
+
+bool SourceNode::disable()
+{
+    std::cout << "Source node received disable signal" << std::endl;
+
+    if (dataThread != nullptr)
+        dataThread->stopAcquisition();
+
+    startTimer (2000); // timer to check for connected source
+
+    wasDisabled = true;
+
+    std::cout << "SourceNode returning true." << std::endl;
+
+    return true;
+}
+
+
+void SourceNode::acquisitionStopped()
+{
+    if (! wasDisabled)
+    {
+        std::cout << "Source node sending signal to UI." << std::endl;
+
+        AccessClass::getUIComponent()->disableCallbacks();
+        setEnabledState (false);
+
+        GenericEditor* ed = (GenericEditor*) getEditor();
+        CoreServices::highlightEditor (ed);
+    }
+}
+
+int SourceNode::getNumSubProcessors() const
+{
+	if (!dataThread) return 0;
+	return dataThread->getNumSubProcessors();
+}
+
+void SourceNode::process(AudioSampleBuffer& buffer)
+{
+	int nSubs = dataThread->getNumSubProcessors();
+	int copiedChannels = 0;
+	for (int sub = 0; sub < nSubs; sub++)
+	{
+		int channelsToCopy = getNumOutputs(sub);
+		int nSamples;
+		if (multiStreamInputBuffers[sub] != nullptr)
+		{
+			uint64* eventCodes = static_cast<uint64*>(eventCodeBuffers[sub]->getData());
+			nSamples = multiStreamInputBuffers[sub]->readAllFromBuffer(buffer, &timestamp, eventCodes, buffer.getNumSamples(), copiedChannels, channelsToCopy);
+
+			setTimestampAndSamples(timestamp, nSamples, sub);
+
+			//The streams are merged sample by sample, so the changes have to be found here
+			int numChanges = findEventCodeChanges(eventCodes, nSamples, eventCodeChanges, 10000);
+			createTTLEvents(sub, eventCodeChanges, numChanges);
+		}
+		else
+		{
+			//Read straight from the ring segments: the samples are copied once into the
+			//graph buffer, and only the TTL word changes of the block are visited
+			DataBuffer* dataBuffer = inputBuffers[sub];
+			CircularBufferIndexes idx;
+			int maxSamples = buffer.getNumSamples();
+			if (rawSamples != nullptr)
+				maxSamples = jmin(maxSamples, rawBlockSize);
+			nSamples = dataBuffer->startRead(idx, maxSamples);
+
+			const AudioSampleBuffer& ringBuffer = dataBuffer->getAudioBufferReference();
+			for (int chan = 0; chan < channelsToCopy; ++chan)
+			{
+				if (idx.size1 > 0)
+					buffer.copyFrom(copiedChannels + chan, 0, ringBuffer, chan, idx.index1, idx.size1);
+				if (idx.size2 > 0)
+					buffer.copyFrom(copiedChannels + chan, idx.size1, ringBuffer, chan, idx.index2, idx.size2);
+			}
+
+			//Keep the original codes of the block around for the record engines
+			if (rawSamples != nullptr && dataBuffer->hasRawSamples())
+			{
+				for (int chan = 0; chan < channelsToCopy; ++chan)
+				{
+					const int16* ringRaw = dataBuffer->getRawBufferReference(chan);
+					int16* dest = rawSamples + ((copiedChannels + chan) * rawBlockSize);
+					if (idx.size1 > 0)
+						memcpy(dest, ringRaw + idx.index1, idx.size1 * sizeof(int16));
+					if (idx.size2 > 0)
+						memcpy(dest + idx.size1, ringRaw + idx.index2, idx.size2 * sizeof(int16));
+				}
+			}
+
+			timestamp = dataBuffer->getReadTimestamp();
+			setTimestampAndSamples(timestamp, nSamples, sub);
+
+			int numChanges = dataBuffer->getEventCodeChanges(eventCodeChanges, 10000);
+			createTTLEvents(sub, eventCodeChanges, numChanges);
+
+			dataBuffer->stopRead();
+		}
+		copiedChannels += channelsToCopy;
+	}
+}
+
+void SourceNode::createTTLEvents(int sub, const DataBuffer::EventCodeChange* changes, int numChanges)
+{
+	if (!ttlChannels[sub] || numChanges <= 0)
+		return;
+
+	int numEventChannels = ttlChannels[sub]->getNumChannels();
+	const uint64 channelMask = numEventChannels >= 64 ? ~uint64(0) : (uint64(1) << numEventChannels) - 1;
+	// fill event buffer
+	uint64 last = eventStates[sub];
+	for (int i = 0; i < numChanges; ++i)
+	{
+		uint64 current = changes[i].eventCode;
+		//The first word of a list can be the one already in effect
+		if (last != current)
+		{
+			int sampleIdx = changes[i].sampleOffset;
+			//Create a TTL event for each bit that has changed, visiting only those
+			for (uint64 flipped = (current ^ last) & channelMask; flipped != 0; flipped &= flipped - 1)
+			{
+				addTTLEvent(ttlChannels[sub], timestamp + sampleIdx, &current, findLowestSetBit(flipped), sampleIdx);
+			}
+			last = current;
+		}
+	}
+	eventStates.set(sub, last);
+}
+
+
+void SourceNode::saveCustomParametersToXml (XmlElement* parentElement)
+{
+    XmlElement* channelXml = parentElement->createNewChildElement ("CHANNEL_INFO");
+    if (dataThread->usesCustomNames())
+    {
+        Array<ChannelCustomInfo> channelInfo;
+        dataThread->getChannelInfo (channelInfo);
+        for (int i = 0; i < channelInfo.size(); ++i)
+        {
+            XmlElement* chan = channelXml->createNewChildElement ("CHANNEL");
+            chan->setAttribute ("name",     channelInfo[i].name);
+            chan->setAttribute ("number",   i);
+            chan->setAttribute ("gain",     channelInfo[i].gain);
+        }
+    }
+
+    XmlElement* schedulingXml = parentElement->createNewChildElement ("THREAD_SCHEDULING");
+    schedulingXml->setAttribute ("policy", (int) dataThread->getSchedulingPolicy());
+    schedulingXml->setAttribute ("core",   dataThread->getCpuCore());
+    schedulingXml->setAttribute ("pages",  (int) dataThread->getBufferPages());
+}
+
+
+void SourceNode::loadCustomParametersFromXml()
+{
+    if (parametersAsXml != nullptr)
+    {
+        // use parametersAsXml to restore state
+        forEachXmlChildElement (*parametersAsXml, xmlNode)
+        {
+            if (xmlNode->hasTagName ("CHANNEL_INFO"))
+            {
+                forEachXmlChildElementWithTagName (*xmlNode, chan, "CHANNEL")
+                {
+                    const int number = chan->getIntAttribute ("number");
+                    const float gain = chan->getDoubleAttribute ("gain");
+                    String name = chan->getStringAttribute ("name");
+
+                    dataThread->modifyChannelGain (number, gain);
+                    dataThread->modifyChannelName (number, name);
+                }
+            }
+            else if (xmlNode->hasTagName ("THREAD_SCHEDULING"))
+            {
+                const int policy = jlimit ((int) DataThread::NORMAL_PRIORITY, (int) DataThread::REALTIME_PRIORITY,
+                                           xmlNode->getIntAttribute ("policy", DataThread::HIGH_PRIORITY));
+
+                dataThread->setScheduling ((DataThread::SchedulingPolicy) policy, xmlNode->getIntAttribute ("core", -1));
+
+                const int pages = jlimit ((int) LargeSampleBlock::NORMAL_PAGES, (int) LargeSampleBlock::EXPLICIT_HUGE_PAGES,
+                                          xmlNode->getIntAttribute ("pages", LargeSampleBlock::TRANSPARENT_HUGE_PAGES));
+
+                dataThread->setBufferPages ((LargeSampleBlock::PageSize) pages);
+            }
+        }
+    }
+}
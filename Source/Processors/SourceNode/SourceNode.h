@@ -66,6 +66,8 @@ public:
 
     float getBitVolts (const DataChannel* chan) const override;
 
+    const int16* getRawSampleData (int channel) const override;
+
     void requestChainUpdate();
 
     bool hasEditor() const override { return true; }
@@ -88,6 +90,17 @@ public:
     bool tryEnablingEditor();
 
 	void setChannelInfo(int channel, String name, float bitVolts);
+
+	/** Gathers the occupancy statistics of all the input buffers since acquisition started:
+	the highest fill fraction of any buffer, the total of dropped samples and the largest read latency in ms. */
+	void getBufferStatistics(float& peakFill, int64& droppedSamples, float& latencyMs) const;
+
+	/** Adds the buffers the data thread fills and those the events and raw codes are read into */
+	int64 getMemoryFootprint() const override;
+
+	/** Returns true if every input buffer holds the samples of a block of blockSize samples at
+	blockSampleRate, capped to the blockSize samples that a single process() call can read. */
+	bool hasSamplesForBlock(int blockSize, double blockSampleRate) const;
 protected:
 	int getDefaultNumDataOutputs(DataChannel::DataChannelTypes type, int subProcessorIdx = 0) const override;
 
@@ -104,17 +117,45 @@ private:
 
     ScopedPointer<DataThread> dataThread;
     Array<DataBuffer*> inputBuffers;
+    Array<MultiStreamDataBuffer*> multiStreamInputBuffers;
 
     uint64 timestamp;
     //uint64* eventCodeBuffer;
     //int* eventChannelState;
     OwnedArray<MemoryBlock> eventCodeBuffers;
+	/** Event code changes of the current block, shared by all subprocessors */
+	HeapBlock<DataBuffer::EventCodeChange> eventCodeChanges;
+	/** Original integer codes of the current block, one run of rawBlockSize samples per output channel */
+	HeapBlock<int16> rawSamples;
+	int rawBlockSize;
 	Array<uint64> eventStates;
 	Array<EventChannel*> ttlChannels;
 
     int ttlState;
 	void resizeBuffers();
 
+	/** Grows the input buffers that came close to overflowing during the previous acquisition */
+	void autoResizeBuffers();
+
+	/** Calls fn on every DataBuffer the thread writes to, sub-stream buffers included */
+	template <typename Function>
+	void forEachInputBuffer(Function fn) const
+	{
+		for (int sub = 0; sub < inputBuffers.size(); sub++)
+		{
+			if (multiStreamInputBuffers[sub] != nullptr)
+			{
+				for (int s = 0; s < multiStreamInputBuffers[sub]->getNumStreams(); s++)
+					fn(multiStreamInputBuffers[sub]->getStreamBuffer(s), sub);
+			}
+			else if (inputBuffers[sub] != nullptr)
+				fn(inputBuffers[sub], sub);
+		}
+	}
+
+	/** Creates a TTL event for every bit that differs between consecutive TTL words of a list of changes in the current block */
+	void createTTLEvents(int subProcessor, const DataBuffer::EventCodeChange* changes, int numChanges);
+
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SourceNode);
 };
@@ -24,8 +24,13 @@
 
 #include "SourceNodeEditor.h"
 #include "../SourceNode/SourceNode.h"
+#include "../../CoreServices.h"
 #include <stdio.h>
 
+// the first items of the scheduling menu select the policy, the ones after them the CPU core
+#define NUM_SCHEDULING_POLICIES 3
+#define FIRST_PAGE_SIZE_ITEM (NUM_SCHEDULING_POLICIES + 33)
+
 
 SourceNodeEditor::SourceNodeEditor(GenericProcessor* parentNode, bool useDefaultParameterEditors=true)
     : GenericEditor(parentNode, useDefaultParameterEditors)
@@ -86,3 +91,63 @@ SourceNodeEditor::~SourceNodeEditor()
 {
     deleteAllChildren();
 }
+
+void SourceNodeEditor::addSchedulingMenuItems(PopupMenu& menu, SourceNode* source, int firstItemId)
+{
+    DataThread* thread = source->getThread();
+    if (thread == nullptr)
+        return;
+
+    // the settings are applied when the thread starts, so they can't change during acquisition
+    const bool canChange = ! CoreServices::getAcquisitionStatus();
+
+    PopupMenu priorityMenu;
+    for (int i = 0; i < NUM_SCHEDULING_POLICIES; i++)
+    {
+        DataThread::SchedulingPolicy policy = (DataThread::SchedulingPolicy) i;
+        priorityMenu.addItem(firstItemId + i, DataThread::getSchedulingPolicyName(policy),
+                             canChange, thread->getSchedulingPolicy() == policy);
+    }
+
+    PopupMenu coreMenu;
+    coreMenu.addItem(firstItemId + NUM_SCHEDULING_POLICIES, "Any", canChange, thread->getCpuCore() < 0);
+    const int numCores = jmin(32, SystemStats::getNumCpus());
+    for (int core = 0; core < numCores; core++)
+    {
+        // the buffers follow the thread to the node of its core
+        const int node = LargeSampleBlock::getNumaNodeOfCpu(core);
+        coreMenu.addItem(firstItemId + NUM_SCHEDULING_POLICIES + 1 + core,
+                         "Core " + String(core) + (node >= 0 ? " (node " + String(node) + ")" : String::empty),
+                         canChange, thread->getCpuCore() == core);
+    }
+
+    PopupMenu pagesMenu;
+    for (int i = 0; i < LargeSampleBlock::NUM_PAGE_SIZES; i++)
+    {
+        LargeSampleBlock::PageSize pageSize = (LargeSampleBlock::PageSize) i;
+        pagesMenu.addItem(firstItemId + FIRST_PAGE_SIZE_ITEM + i, LargeSampleBlock::getPageSizeName(pageSize),
+                          canChange, thread->getBufferPages() == pageSize);
+    }
+
+    menu.addSubMenu("Thread priority", priorityMenu);
+    menu.addSubMenu("Pin thread to", coreMenu);
+    menu.addSubMenu("Buffer pages", pagesMenu);
+}
+
+bool SourceNodeEditor::handleSchedulingMenuResult(int result, SourceNode* source, int firstItemId)
+{
+    DataThread* thread = source->getThread();
+    const int item = result - firstItemId;
+
+    if (thread == nullptr || item < 0 || item >= FIRST_PAGE_SIZE_ITEM + LargeSampleBlock::NUM_PAGE_SIZES)
+        return false;
+
+    if (item >= FIRST_PAGE_SIZE_ITEM)
+        thread->setBufferPages((LargeSampleBlock::PageSize) (item - FIRST_PAGE_SIZE_ITEM));
+    else if (item < NUM_SCHEDULING_POLICIES)
+        thread->setScheduling((DataThread::SchedulingPolicy) item, thread->getCpuCore());
+    else
+        thread->setScheduling(thread->getSchedulingPolicy(), item - NUM_SCHEDULING_POLICIES - 1);
+
+    return true;
+}
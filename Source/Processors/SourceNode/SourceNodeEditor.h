@@ -29,6 +29,7 @@
 #include "../Editors/ImageIcon.h"
 
 class ImageIcon;
+class SourceNode;
 
 /**
 
@@ -46,6 +47,16 @@ public:
     SourceNodeEditor(GenericProcessor* parentNode, bool useDefaultParameterEditors);
     virtual ~SourceNodeEditor();
 
+    /** Adds the scheduling options of a source's acquisition thread (priority, core
+        pinning and the pages of its buffers) to a popup menu, using item IDs from
+        firstItemId onwards.
+        Works for any source, whatever editor its DataThread provides.*/
+    static void addSchedulingMenuItems(PopupMenu& menu, SourceNode* source, int firstItemId);
+
+    /** Applies an item chosen from the menu built by addSchedulingMenuItems().
+        Returns false if the result doesn't belong to that menu.*/
+    static bool handleSchedulingMenuResult(int result, SourceNode* source, int firstItemId);
+
 private:
 
     ImageIcon* icon;
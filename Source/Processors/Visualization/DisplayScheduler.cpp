@@ -0,0 +1,127 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "DisplayScheduler.h"
+#include "../../AccessClass.h"
+#include "../../Audio/AudioComponent.h"
+
+namespace
+{
+    const int maxLevel = 3;
+
+    // windows in a row with both the load and the frame time low before stepping up a level
+    const int quietWindowsToRestore = 4;
+
+    double getProcessingLoad()
+    {
+        AudioComponent* audio = AccessClass::getAudioComponent();
+
+        if (audio == nullptr || !audio->callbacksAreActive())
+            return 0;
+
+        return audio->deviceManager.getCpuUsage();
+    }
+}
+
+DisplayScheduler& DisplayScheduler::getInstance()
+{
+    static DisplayScheduler instance;
+    return instance;
+}
+
+DisplayScheduler::DisplayScheduler()
+    : level(0), minimumLevel(0), quietWindows(0), frameTicks(0)
+{
+    windowLength = Time::getHighResolutionTicksPerSecond() / 4;
+    windowStart = Time::getHighResolutionTicks();
+}
+
+bool DisplayScheduler::shouldRefresh(int callbacksSinceRefresh)
+{
+    update();
+
+    // levels 2 and 3 halve and quarter the refresh rate
+    const int divider = 1 << jmax(0, getLevel() - 1);
+
+    if (callbacksSinceRefresh < divider)
+        return false;
+
+    return frameTicks < (int64) (DISPLAY_SCHEDULER_MAX_FRAME_TIME * windowLength);
+}
+
+void DisplayScheduler::addFrameTime(int64 ticks)
+{
+    frameTicks += ticks;
+}
+
+bool DisplayScheduler::isDetailReduced() const
+{
+    return getLevel() > 0;
+}
+
+int DisplayScheduler::getLevel() const
+{
+    return jmax(level, minimumLevel);
+}
+
+int DisplayScheduler::getMaxLevel()
+{
+    return maxLevel;
+}
+
+void DisplayScheduler::setMinimumLevel(int newMinimumLevel)
+{
+    minimumLevel = jlimit(0, maxLevel, newMinimumLevel);
+}
+
+void DisplayScheduler::update()
+{
+    const int64 now = Time::getHighResolutionTicks();
+
+    if (now - windowStart < windowLength)
+        return;
+
+    const double frameTime = (double) frameTicks / (double) (now - windowStart);
+    const double load = getProcessingLoad();
+
+    if (frameTime >= DISPLAY_SCHEDULER_MAX_FRAME_TIME || load > DISPLAY_SCHEDULER_HIGH_LOAD)
+    {
+        level = jmin(level + 1, maxLevel);
+        quietWindows = 0;
+    }
+    else if (frameTime < DISPLAY_SCHEDULER_MAX_FRAME_TIME / 2 && load < DISPLAY_SCHEDULER_LOW_LOAD)
+    {
+        if (++quietWindows >= quietWindowsToRestore && level > 0)
+        {
+            level--;
+            quietWindows = 0;
+        }
+    }
+    else
+    {
+        quietWindows = 0;
+    }
+
+    windowStart = now;
+    frameTicks = 0;
+}
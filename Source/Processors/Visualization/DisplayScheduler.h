@@ -0,0 +1,100 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __DISPLAYSCHEDULER_H_4E81C2B7__
+#define __DISPLAYSCHEDULER_H_4E81C2B7__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "../PluginManager/OpenEphysPlugin.h"
+
+/** The part of each second the refreshes of all visualizers together may take */
+#define DISPLAY_SCHEDULER_MAX_FRAME_TIME 0.3
+/** The processing load, as a part of the audio callback's time, over which the displays back off */
+#define DISPLAY_SCHEDULER_HIGH_LOAD 0.8
+/** The processing load under which the displays are restored */
+#define DISPLAY_SCHEDULER_LOW_LOAD 0.5
+
+/**
+
+  Shares the message thread's time between all the visualizers.
+
+  Every Visualizer asks it before refreshing and reports how long the refresh took. The
+  refreshes of all of them together are capped to DISPLAY_SCHEDULER_MAX_FRAME_TIME of each
+  second, the remaining refreshes of a second being skipped.
+
+  Four times a second, the scheduler looks at the time the displays took and at the load
+  of the processing thread, as measured by the audio device manager. When either is too
+  high, the displays step down one level: first drawing less detail, then refreshing at
+  half and then a quarter of their rate. They step back up one level at a time once both
+  stayed low for a second. The OverrunWatchdog can hold them at a minimum level while the
+  processing thread overruns its blocks.
+
+  Only used from the message thread.
+
+  @see Visualizer
+
+*/
+
+class PLUGIN_API DisplayScheduler
+{
+public:
+    /** Returns the scheduler shared by all visualizers */
+    static DisplayScheduler& getInstance();
+
+    /** Returns true if a visualizer may refresh now, callbacksSinceRefresh being the timer
+        callbacks it has had since it last did */
+    bool shouldRefresh(int callbacksSinceRefresh);
+
+    /** Adds the duration of a refresh, in high resolution ticks */
+    void addFrameTime(int64 ticks);
+
+    /** Returns true if the visualizers should draw less detail */
+    bool isDetailReduced() const;
+
+    /** Returns the level the displays are at, from 0 (full rate and detail) to getMaxLevel() */
+    int getLevel() const;
+
+    static int getMaxLevel();
+
+    /** Keeps the displays at least at the given level, whatever the loads */
+    void setMinimumLevel(int level);
+
+private:
+    DisplayScheduler();
+
+    /** Moves on to the next window once the current one is over, updating the level */
+    void update();
+
+    int level;
+    int minimumLevel;
+    int quietWindows;           // the windows in a row with both the load and the frame time low
+
+    int64 windowStart;          // in high resolution ticks
+    int64 windowLength;
+    int64 frameTicks;           // taken by the refreshes during the current window
+
+    JUCE_DECLARE_NON_COPYABLE(DisplayScheduler);
+};
+
+
+#endif  // __DISPLAYSCHEDULER_H_4E81C2B7__
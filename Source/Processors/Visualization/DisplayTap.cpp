@@ -0,0 +1,443 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "DisplayTap.h"
+#include "../GenericProcessor/MemoryFootprint.h"
+
+// each level gathers this many entries of the level below
+#define DISPLAY_TAP_LEVEL_STEP 10
+
+// the history of each level, long enough for the timebases drawn from it
+static const float levelSeconds[DISPLAY_TAP_NUM_LEVELS] = { DISPLAY_TAP_FULL_RATE_SECONDS, 4.0f, DISPLAY_TAP_SECONDS };
+
+
+DisplayTap::DisplayTap()
+    : numChannels       (0)
+    , numSamples        (0)
+    , numReaders        (0)
+    , numActiveReaders  (0)
+{
+}
+
+
+DisplayTap::~DisplayTap()
+{
+}
+
+
+int DisplayTap::getLengthForSampleRate (float sampleRate)
+{
+    return jmax (0, (int) (sampleRate * DISPLAY_TAP_FULL_RATE_SECONDS));
+}
+
+
+int DisplayTap::getLevelFactor (int level)
+{
+    int factor = 1;
+
+    for (int i = 0; i < level; ++i)
+        factor *= DISPLAY_TAP_LEVEL_STEP;
+
+    return factor;
+}
+
+
+float DisplayTap::getLevelSeconds (int level)
+{
+    return levelSeconds[jlimit (0, DISPLAY_TAP_NUM_LEVELS - 1, level)];
+}
+
+
+void DisplayTap::setSize (int newNumChannels, int newNumSamples)
+{
+    numChannels = jmax (0, newNumChannels);
+    numSamples = jmax (0, newNumSamples);
+
+    updateStorage();
+}
+
+
+void DisplayTap::updateStorage()
+{
+    levels.clear();
+
+    if (numReaders > 0 && numChannels > 0 && numSamples > 0)
+    {
+        samples.setSize (numChannels, numSamples);
+        samples.clear();
+        samplesWritten.calloc (numChannels);
+
+        for (int level = 1; level < DISPLAY_TAP_NUM_LEVELS; ++level)
+        {
+            Level* l = levels.add (new Level());
+
+            l->length = jmax (1, (int) std::ceil (numSamples * getLevelSeconds (level)
+                                                  / (DISPLAY_TAP_FULL_RATE_SECONDS * getLevelFactor (level))));
+            l->minima.setSize (numChannels, l->length);
+            l->maxima.setSize (numChannels, l->length);
+            l->minima.clear();
+            l->maxima.clear();
+            l->entriesWritten.calloc (numChannels);
+            l->pendingMin.calloc (numChannels);
+            l->pendingMax.calloc (numChannels);
+            l->pendingCount.calloc (numChannels);
+        }
+    }
+    else
+    {
+        samples.setSize (0, 0);
+        samplesWritten.free();
+    }
+}
+
+
+int DisplayTap::getNumChannels() const
+{
+    return numChannels;
+}
+
+
+int DisplayTap::getNumSamples() const
+{
+    return numSamples;
+}
+
+
+bool DisplayTap::hasActiveReaders() const
+{
+    return numActiveReaders.get() > 0;
+}
+
+
+void DisplayTap::write (int channel, const float* source, int nSamples)
+{
+    if (! isPositiveAndBelow (channel, samples.getNumChannels()) || nSamples <= 0)
+        return;
+
+    // only the most recent samples fit
+    const int skipped = jmax (0, nSamples - numSamples);
+    const int index = getWriteIndex (channel);
+    const int toEnd = jmin (nSamples - skipped, numSamples - index);
+
+    float* ring = samples.getWritePointer (channel);
+    FloatVectorOperations::copy (ring + index, source + skipped, toEnd);
+    FloatVectorOperations::copy (ring, source + skipped + toEnd, nSamples - skipped - toEnd);
+
+    addToLevels (channel, source, nSamples);
+    samplesWritten[channel] += nSamples;
+}
+
+
+float* DisplayTap::getWritePointer (int channel)
+{
+    return samples.getWritePointer (channel);
+}
+
+
+void DisplayTap::advance (int channel, int nSamples)
+{
+    // the samples written in place are read back for the levels
+    const int index = getWriteIndex (channel);
+    const int toEnd = jmin (nSamples, numSamples - index);
+    const float* ring = samples.getReadPointer (channel);
+
+    addToLevels (channel, ring + index, toEnd);
+    addToLevels (channel, ring, nSamples - toEnd);
+
+    samplesWritten[channel] += nSamples;
+}
+
+
+void DisplayTap::addToLevels (int channel, const float* newSamples, int nSamples)
+{
+    if (levels.size() == 0)
+        return;
+
+    Level& level = *levels.getUnchecked (0);
+    float& pendingMin = level.pendingMin[channel];
+    float& pendingMax = level.pendingMax[channel];
+    int& pendingCount = level.pendingCount[channel];
+
+    // whole runs at a time, so that the minima and maxima are found with SIMD
+    while (nSamples > 0)
+    {
+        const int n = jmin (nSamples, DISPLAY_TAP_LEVEL_STEP - pendingCount);
+        const Range<float> range = FloatVectorOperations::findMinAndMax (newSamples, n);
+
+        pendingMin = (pendingCount == 0) ? range.getStart() : jmin (pendingMin, range.getStart());
+        pendingMax = (pendingCount == 0) ? range.getEnd() : jmax (pendingMax, range.getEnd());
+        pendingCount += n;
+
+        newSamples += n;
+        nSamples -= n;
+
+        if (pendingCount == DISPLAY_TAP_LEVEL_STEP)
+        {
+            pendingCount = 0;
+
+            const int index = (int) (level.entriesWritten[channel].get() % level.length);
+            level.minima.setSample (channel, index, pendingMin);
+            level.maxima.setSample (channel, index, pendingMax);
+            level.entriesWritten[channel] += 1;
+
+            if (levels.size() > 1)
+                addToLevel (1, channel, pendingMin, pendingMax);
+        }
+    }
+}
+
+
+void DisplayTap::addToLevel (int levelIndex, int channel, float min, float max)
+{
+    Level& level = *levels.getUnchecked (levelIndex);
+    float& pendingMin = level.pendingMin[channel];
+    float& pendingMax = level.pendingMax[channel];
+    int& pendingCount = level.pendingCount[channel];
+
+    pendingMin = (pendingCount == 0) ? min : jmin (pendingMin, min);
+    pendingMax = (pendingCount == 0) ? max : jmax (pendingMax, max);
+
+    if (++pendingCount < DISPLAY_TAP_LEVEL_STEP)
+        return;
+
+    pendingCount = 0;
+
+    const int index = (int) (level.entriesWritten[channel].get() % level.length);
+    level.minima.setSample (channel, index, pendingMin);
+    level.maxima.setSample (channel, index, pendingMax);
+    level.entriesWritten[channel] += 1;
+
+    if (levelIndex + 1 < levels.size())
+        addToLevel (levelIndex + 1, channel, pendingMin, pendingMax);
+}
+
+
+const float* DisplayTap::getReadPointer (int channel) const
+{
+    return samples.getReadPointer (channel);
+}
+
+
+int DisplayTap::getWriteIndex (int channel) const
+{
+    if (! isPositiveAndBelow (channel, samples.getNumChannels()))
+        return 0;
+
+    return (int) (samplesWritten[channel].get() % numSamples);
+}
+
+
+int64 DisplayTap::getSamplesWritten (int channel) const
+{
+    if (! isPositiveAndBelow (channel, samples.getNumChannels()))
+        return 0;
+
+    return samplesWritten[channel].get();
+}
+
+
+int DisplayTap::getLevelLength (int level) const
+{
+    if (level <= 0)
+        return numSamples;
+
+    return isPositiveAndBelow (level - 1, levels.size()) ? levels[level - 1]->length : 0;
+}
+
+
+const float* DisplayTap::getLevelMinima (int level, int channel) const
+{
+    if (level <= 0)
+        return samples.getReadPointer (channel);
+
+    return levels[level - 1]->minima.getReadPointer (channel);
+}
+
+
+const float* DisplayTap::getLevelMaxima (int level, int channel) const
+{
+    if (level <= 0)
+        return samples.getReadPointer (channel);
+
+    return levels[level - 1]->maxima.getReadPointer (channel);
+}
+
+
+int DisplayTap::getLevelWriteIndex (int level, int channel) const
+{
+    if (level <= 0)
+        return getWriteIndex (channel);
+
+    const Level* l = levels[level - 1];
+
+    if (l == nullptr || ! isPositiveAndBelow (channel, samples.getNumChannels()))
+        return 0;
+
+    return (int) (l->entriesWritten[channel].get() % l->length);
+}
+
+
+int64 DisplayTap::getLevelEntriesWritten (int level, int channel) const
+{
+    if (level <= 0)
+        return getSamplesWritten (channel);
+
+    const Level* l = levels[level - 1];
+
+    if (l == nullptr || ! isPositiveAndBelow (channel, samples.getNumChannels()))
+        return 0;
+
+    return l->entriesWritten[channel].get();
+}
+
+
+int64 DisplayTap::getMemoryFootprint() const
+{
+    int64 bytes = MemoryFootprint::ofBuffer (samples)
+                + MemoryFootprint::ofBlock (samplesWritten, samples.getNumChannels());
+
+    for (int i = 0; i < levels.size(); ++i)
+        bytes += MemoryFootprint::ofBuffer (levels[i]->minima) + MemoryFootprint::ofBuffer (levels[i]->maxima);
+
+    return bytes;
+}
+
+
+void DisplayTap::addReader (bool isActive)
+{
+    if (++numReaders == 1)
+        updateStorage();
+
+    if (isActive)
+        ++numActiveReaders;
+}
+
+
+void DisplayTap::removeReader (bool wasActive)
+{
+    if (wasActive)
+        --numActiveReaders;
+
+    if (--numReaders == 0)
+        updateStorage();
+}
+
+
+void DisplayTap::setReaderActive (bool isActive)
+{
+    if (isActive)
+        ++numActiveReaders;
+    else
+        --numActiveReaders;
+}
+
+
+// =====================================================================
+
+
+DisplayTap::Reader::Reader (DisplayTap* tapToRead, bool isActive)
+    : tap           (tapToRead)
+    , numCursors    (0)
+    , active        (isActive ? 1 : 0)
+{
+    tap->addReader (isActive);
+}
+
+
+DisplayTap::Reader::~Reader()
+{
+    tap->removeReader (isActive());
+}
+
+
+DisplayTap* DisplayTap::Reader::getTap() const
+{
+    return tap;
+}
+
+
+void DisplayTap::Reader::setActive (bool isActive)
+{
+    const int newState = isActive ? 1 : 0;
+
+    if (active.exchange (newState) != newState)
+        tap->setReaderActive (isActive);
+}
+
+
+bool DisplayTap::Reader::isActive() const
+{
+    return active.get() != 0;
+}
+
+
+int DisplayTap::Reader::read (int channel, float* destSamples, int maxSamples)
+{
+    const int length = tap->getNumSamples();
+
+    if (! isPositiveAndBelow (channel, tap->samples.getNumChannels()) || maxSamples <= 0)
+        return 0;
+
+    // the tap grew since the last read
+    if (numCursors < tap->getNumChannels())
+    {
+        cursors.realloc (tap->getNumChannels());
+
+        for (int i = numCursors; i < tap->getNumChannels(); ++i)
+            cursors[i] = 0;
+
+        numCursors = tap->getNumChannels();
+    }
+
+    const int64 written = tap->getSamplesWritten (channel);
+    int64& cursor = cursors[channel];
+
+    // the tap was cleared since, or the writer went around the ring over unread samples
+    if (cursor > written || written - cursor > length)
+        cursor = written - jmin<int64> (written, length / 2);
+
+    const int n = (int) jmin<int64> (maxSamples, written - cursor);
+    const int index = (int) (cursor % length);
+    const int toEnd = jmin (n, length - index);
+
+    const float* ring = tap->getReadPointer (channel);
+    FloatVectorOperations::copy (destSamples, ring + index, toEnd);
+    FloatVectorOperations::copy (destSamples + toEnd, ring, n - toEnd);
+
+    // the oldest samples copied may have been written over meanwhile
+    if (tap->getSamplesWritten (channel) - cursor > length)
+    {
+        cursor = tap->getSamplesWritten (channel);
+        return 0;
+    }
+
+    cursor += n;
+    return n;
+}
+
+
+void DisplayTap::Reader::skipToEnd()
+{
+    for (int i = 0; i < numCursors; ++i)
+        cursors[i] = tap->getSamplesWritten (i);
+}
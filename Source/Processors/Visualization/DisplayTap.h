@@ -0,0 +1,221 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2016 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __DISPLAYTAP_H_5A0C93E1__
+#define __DISPLAYTAP_H_5A0C93E1__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "../PluginManager/OpenEphysPlugin.h"
+
+/** The seconds of history a display tap keeps in all, and at the full sample rate */
+#define DISPLAY_TAP_SECONDS 20.0f
+#define DISPLAY_TAP_FULL_RATE_SECONDS 1.0f
+
+/** The full rate ring, then the decimated levels of minima and maxima */
+#define DISPLAY_TAP_NUM_LEVELS 3
+
+/**
+
+  Keeps the recent samples of a point of the signal chain for any number of visualizers.
+
+  Every processor has one for its outputs (see GenericProcessor::getDisplayTap()), which
+  processBlock() fills after process() while at least one active Reader is attached, so
+  visualizers watching the same channels share one copy of them instead of each keeping
+  its own. A processor may also own taps of its own for what it computes.
+
+  Each channel is a ring written by a single thread without any lock: the samples of a
+  block are written first, then the channel's count of samples written is published
+  atomically, the write index following from it. Readers never hold the writer back.
+  They check the count again once done to know whether the writer went around the ring
+  over the samples they were reading.
+
+  Only the last DISPLAY_TAP_FULL_RATE_SECONDS are kept at the full sample rate. Older
+  samples live on as a pyramid of levels, each holding the minimum and maximum of runs of
+  10 entries of the level below, updated as the samples are published: level 1 holds runs
+  of 10 samples and level 2 runs of 100, the last covering DISPLAY_TAP_SECONDS. Long spans
+  are drawn from the coarsest levels at a fraction of the memory and of the reads that the
+  full rate samples would take. Level 0 is the full rate ring itself, its minima and maxima
+  being the samples.
+
+  The size only changes while the tap is neither written nor read, i.e. outside of
+  acquisition, and its memory is only allocated while readers are attached.
+
+  @see GenericProcessor, LfpDisplayNode
+
+*/
+
+class PLUGIN_API DisplayTap : public ReferenceCountedObject
+{
+public:
+    typedef ReferenceCountedObjectPtr<DisplayTap> Ptr;
+
+    DisplayTap();
+    ~DisplayTap();
+
+    /** Returns the number of samples a tap keeps at the full rate for channels of the given
+        sample rate */
+    static int getLengthForSampleRate (float sampleRate);
+
+    /** Returns the number of samples each entry of a level covers: 1, 10, 100... */
+    static int getLevelFactor (int level);
+
+    /** Returns the seconds of history a level covers */
+    static float getLevelSeconds (int level);
+
+    /** Sets the number of channels and of full rate samples per channel, the levels being
+        sized to match, clearing the history */
+    void setSize (int numChannels, int numSamples);
+
+    int getNumChannels() const;
+
+    /** Returns the length of the rings, even while no memory is allocated */
+    int getNumSamples() const;
+
+    // ---- writer ---- //
+
+    /** Returns true if at least one attached reader wants the tap to be filled */
+    bool hasActiveReaders() const;
+
+    /** Appends samples to a channel, and publishes them */
+    void write (int channel, const float* samples, int numSamples);
+
+    /** Returns the start of a channel's ring, for a writer filling it in place from
+        getWriteIndex() on, before publishing what it wrote with advance() */
+    float* getWritePointer (int channel);
+
+    /** Publishes numSamples samples written to a channel in place */
+    void advance (int channel, int numSamples);
+
+    // ---- readers ---- //
+
+    /** Returns the start of a channel's ring, for readers drawing from it in place */
+    const float* getReadPointer (int channel) const;
+
+    /** Returns the index the next sample of a channel will be written at, the samples
+        before it being complete. Safe to call from any thread. */
+    int getWriteIndex (int channel) const;
+
+    /** Returns the number of samples written to a channel since the last setSize().
+        Reading it before and after reading a range of the ring tells by how much the
+        writer moved meanwhile. Safe to call from any thread. */
+    int64 getSamplesWritten (int channel) const;
+
+    /** Returns the number of entries of the rings of a level */
+    int getLevelLength (int level) const;
+
+    /** Returns the start of a channel's ring of minima, or of maxima, at a level */
+    const float* getLevelMinima (int level, int channel) const;
+    const float* getLevelMaxima (int level, int channel) const;
+
+    /** Returns the index the next entry of a channel will be written at in a level. Safe to
+        call from any thread. */
+    int getLevelWriteIndex (int level, int channel) const;
+
+    /** Returns the number of entries written to a channel at a level since the last
+        setSize(), see getSamplesWritten(). Safe to call from any thread. */
+    int64 getLevelEntriesWritten (int level, int channel) const;
+
+    /** The bytes of the rings */
+    int64 getMemoryFootprint() const;
+
+    /**
+      Attaches to a tap for as long as it exists, keeping the tap alive and its memory
+      allocated, and remembers how far each channel was read.
+
+      Readers are created and destroyed outside of acquisition, from the message thread.
+    */
+    class PLUGIN_API Reader
+    {
+    public:
+        explicit Reader (DisplayTap* tap, bool isActive = true);
+        ~Reader();
+
+        DisplayTap* getTap() const;
+
+        /** Tells the tap whether to keep being filled on this reader's behalf. Safe to call
+            from any thread. */
+        void setActive (bool isActive);
+
+        bool isActive() const;
+
+        /** Copies up to maxSamples samples of a channel written since the last call,
+            oldest first, and returns how many were copied. Samples the writer went over
+            before they could be read are skipped. */
+        int read (int channel, float* destSamples, int maxSamples);
+
+        /** Skips all the samples written so far */
+        void skipToEnd();
+
+    private:
+        DisplayTap::Ptr tap;
+        HeapBlock<int64> cursors;   // samples read per channel
+        int numCursors;
+        Atomic<int> active;
+
+        JUCE_DECLARE_NON_COPYABLE (Reader);
+    };
+
+private:
+    /** A level above the full rate ring, its entries being the minima and maxima of runs of
+        10 entries of the level below */
+    struct Level
+    {
+        int length;
+        AudioSampleBuffer minima;
+        AudioSampleBuffer maxima;
+        HeapBlock<Atomic<int64>> entriesWritten;
+
+        // the entry being gathered, per channel
+        HeapBlock<float> pendingMin;
+        HeapBlock<float> pendingMax;
+        HeapBlock<int> pendingCount;
+    };
+
+    /** Allocates the rings if readers are attached, frees them otherwise */
+    void updateStorage();
+
+    /** Gathers samples just written into the entries of level 1 */
+    void addToLevels (int channel, const float* newSamples, int nSamples);
+
+    /** Gathers an entry into the level, appending it once complete, and so on up */
+    void addToLevel (int levelIndex, int channel, float min, float max);
+
+    void addReader (bool isActive);
+    void removeReader (bool wasActive);
+    void setReaderActive (bool isActive);
+
+    int numChannels;
+    int numSamples;
+
+    AudioSampleBuffer samples;
+    HeapBlock<Atomic<int64>> samplesWritten;
+    OwnedArray<Level> levels;   // levels[0] is level 1
+
+    int numReaders;             // only changed from the message thread
+    Atomic<int> numActiveReaders;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DisplayTap);
+};
+
+
+#endif  // __DISPLAYTAP_H_5A0C93E1__
@@ -624,6 +624,7 @@ XYline::XYline(float x0_, float dx_, std::vector<float> y_, float gain_, juce::C
 	xn = x0 + dx * (numpts-1);
 	verticalLine = false;
 	fixedDx = true;
+	buildPyramid();
 }
 
 XYline::XYline(float x0_, float ymin, float ymax, juce::Colour color_) : x0(x0_), color(color_) 
@@ -662,17 +663,93 @@ void XYline::smooth(std::vector<float> smoothKernel)
 		smoothy[k] = response;
 	}
 	y = smoothy;
+	buildPyramid();
+}
+
+void XYline::buildPyramid()
+{
+	minPyramid.clear();
+	maxPyramid.clear();
+
+	if (!fixedDx)
+		return;
+
+	// level 0 pairs the samples, each next level pairs the blocks of the previous one
+	const std::vector<float> *prevMin = &y;
+	const std::vector<float> *prevMax = &y;
+
+	while (prevMin->size() > 2)
+	{
+		int prevSize = prevMin->size();
+		int size = (prevSize+1)/2;
+
+		minPyramid.push_back(std::vector<float>(size));
+		maxPyramid.push_back(std::vector<float>(size));
+		std::vector<float> &levelMin = minPyramid.back();
+		std::vector<float> &levelMax = maxPyramid.back();
+
+		for (int i=0;i<size;i++)
+		{
+			int k = 2*i;
+			levelMin[i] = (*prevMin)[k];
+			levelMax[i] = (*prevMax)[k];
+			if (k+1 < prevSize)
+			{
+				levelMin[i] = MIN(levelMin[i], (*prevMin)[k+1]);
+				levelMax[i] = MAX(levelMax[i], (*prevMax)[k+1]);
+			}
+		}
+		prevMin = &levelMin;
+		prevMax = &levelMax;
+	}
+}
+
+void XYline::getMinMax(int from, int to, float &lo, float &hi)
+{
+	// level -1 is y itself. At each level, the unpaired blocks at both ends are
+	// taken, and the rest of the range is covered by the next level.
+	int level = -1;
+	while (from < to)
+	{
+		const std::vector<float> &levelMin = (level < 0) ? y : minPyramid[level];
+		const std::vector<float> &levelMax = (level < 0) ? y : maxPyramid[level];
+
+		if (to - from < 2 || level+1 >= (int) minPyramid.size())
+		{
+			for (int k=from;k<to;k++)
+			{
+				lo = MIN(lo, levelMin[k]);
+				hi = MAX(hi, levelMax[k]);
+			}
+			return;
+		}
+		if (from & 1)
+		{
+			lo = MIN(lo, levelMin[from]);
+			hi = MAX(hi, levelMax[from]);
+			from++;
+		}
+		if (to & 1)
+		{
+			to--;
+			lo = MIN(lo, levelMin[to]);
+			hi = MAX(hi, levelMax[to]);
+		}
+		from /= 2;
+		to /= 2;
+		level++;
+	}
 }
 
 void XYline::getYRange(float xmin, float xmax, double &lowestValue, double &highestValue)
 {
 	int startIndex = MIN(numpts,MAX(0, (xmin-x0)/dx));
 	int endIndex = MIN(numpts,MAX(0, (xmax-x0)/dx));
-	for (int k=startIndex;k<endIndex;k++)
-	{
-		lowestValue = MIN(lowestValue,y[k]);
-		highestValue =MAX(highestValue,y[k]);
-	}
+	float lo = lowestValue;
+	float hi = highestValue;
+	getMinMax(startIndex, endIndex, lo, hi);
+	lowestValue = lo;
+	highestValue = hi;
 }
 
 void XYline::removeMean()
@@ -691,6 +768,7 @@ void XYline::removeMean()
 	{
 		y[k] = (y[k]-mean)*gain;
 	}	
+	buildPyramid();
 }
 
 
@@ -1003,8 +1081,14 @@ void XYline::draw(Graphics &g, float xmin, float xmax, float ymin, float ymax, i
 		return;
 	}
 	// function is given in [x,y], where dx is fixed and known.
-	// use bilinear interpolation.
+	// when zoomed out, several samples fall in each pixel; draw their envelope instead
 	float xrange = xmax-xmin;
+	if (xrange / dx > 2 * plotWidth)
+	{
+		drawDecimated(g,xmin,xmax,ymin,ymax,plotWidth,plotHeight);
+		return;
+	}
+	// otherwise, use bilinear interpolation.
 	int screenQuantization ;
 	if (xrange  < 100 * 1e-3)  // if we are looking at a region that is smaller than 50 ms, try to get better visualization...
 	{
@@ -1054,13 +1138,9 @@ void XYline::draw(Graphics &g, float xmin, float xmax, float ymin, float ymax, i
 		// compute minimum and maximum in between each bins...
 		for (int i=0;i<screenx.size()-1;i++)
 		{
-			double minV = 1e10;
-			double maxV = -1e10;
-			for (int k=bins[i];k<=bins[i+1];k++)
-			{
-				minV = MIN(y[k],minV);
-				maxV = MAX(y[k],maxV);
-			}
+			float minV = 1e10;
+			float maxV = -1e10;
+			getMinMax(bins[i], MIN(numpts, bins[i+1]+1), minV, maxV);
 			min_in_bin.push_back(minV);
 			max_in_bin.push_back(maxV);
 		}
@@ -1084,6 +1164,39 @@ void XYline::draw(Graphics &g, float xmin, float xmax, float ymin, float ymax, i
 
 }
 
+// draws one vertical line per pixel column, between the lowest and highest samples of
+// that column, reaching back to the previous column so that the trace stays connected
+void XYline::drawDecimated(Graphics &g, float xmin, float xmax, float ymin, float ymax, int plotWidth, int plotHeight)
+{
+	float samplesPerPixel = (xmax-xmin) / dx / plotWidth;
+	float firstSample = (xmin-x0) / dx;
+	float scaley = plotHeight / (ymax-ymin);
+
+	bool hasPrev = false;
+	float prevLo = 0, prevHi = 0;
+	for (int i=0;i<plotWidth;i++)
+	{
+		int from = MAX(0, (int) floor(firstSample + i * samplesPerPixel));
+		int to = MIN(numpts, (int) floor(firstSample + (i+1) * samplesPerPixel));
+		if (from >= to)
+		{
+			hasPrev = false;
+			continue;
+		}
+		float lo = 1e10;
+		float hi = -1e10;
+		getMinMax(from, to, lo, hi);
+
+		float top = MAX(hi, (hasPrev) ? prevLo : hi);
+		float bottom = MIN(lo, (hasPrev) ? prevHi : lo);
+		g.drawVerticalLine(i, plotHeight - (top-ymin) * scaley, plotHeight - (bottom-ymin) * scaley + 1);
+
+		prevLo = lo;
+		prevHi = hi;
+		hasPrev = true;
+	}
+}
+
 /*************************************************************************/
 DrawComponent::DrawComponent(MatlabLikePlot *mlp_) : mlp(mlp_)
 {
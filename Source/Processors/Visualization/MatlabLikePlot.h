@@ -64,11 +64,19 @@ private:
 	float interp_bilinear(float x_sample, bool &inrange);
 
 	float interp_cubic(float x_sample, bool &inrange);
+
+	// min/max of y over every aligned block of 2, 4, 8... samples, rebuilt whenever y changes
+	void buildPyramid();
+	// lowest and highest sample in [from, to), in log(to-from) steps
+	void getMinMax(int from, int to, float &lo, float &hi);
+	void drawDecimated(Graphics &g, float xmin, float xmax, float ymin, float ymax, int plotWidth, int plotHeight);
+
 	bool sortedX, fixedDx,  verticalLine;
 	float gain,dx, x0,xn,mean;
 	int numpts;
 	std::vector<float> x;
 	std::vector<float> y;
+	std::vector<std::vector<float> > minPyramid, maxPyramid;
 	juce::Colour color;
 };
 
@@ -22,8 +22,11 @@
 */
 
 #include "Visualizer.h"
+#include "DisplayScheduler.h"
+#include "../GenericProcessor/TraceRecorder.h"
 
 Visualizer::Visualizer()
+    : callbacksSinceRefresh(0), detailReduced(false), traceName("Refresh")
 {
 	refreshRate = 10;    // 10 Hz default refresh rate
 }
@@ -32,6 +35,9 @@ Visualizer::~Visualizer() {}
 
 void Visualizer::startCallbacks()
 {
+	if (getName().isNotEmpty())
+		traceName = TraceRecorder::internName("Refresh " + getName());
+
 	startTimer(20);
 }
 
@@ -42,9 +48,32 @@ void Visualizer::stopCallbacks()
 
 void Visualizer::timerCallback()
 {
+	DisplayScheduler& scheduler = DisplayScheduler::getInstance();
+
+	if (!scheduler.shouldRefresh(++callbacksSinceRefresh))
+		return;
+
+	callbacksSinceRefresh = 0;
+
+	if (scheduler.isDetailReduced() != detailReduced)
+	{
+		detailReduced = scheduler.isDetailReduced();
+		setDetailReduced(detailReduced);
+	}
+
+	const int64 start = Time::getHighResolutionTicks();
 	refresh();
+	const int64 end = Time::getHighResolutionTicks();
+	scheduler.addFrameTime(end - start);
+
+	if (TraceRecorder::isEnabled())
+		TraceRecorder::addSpan(traceName, start, end);
 }
 
+void Visualizer::setDetailReduced(bool isReduced) { }
+
+int64 Visualizer::getMemoryFootprint() const { return 0; }
+
 void Visualizer::saveVisualizerParameters(XmlElement* xml) { }
 
 void Visualizer::loadVisualizerParameters(XmlElement* xml) { }
\ No newline at end of file
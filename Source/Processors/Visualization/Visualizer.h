@@ -31,7 +31,10 @@
 
   Abstract base class for displaying data.
 
-  @see LfpDisplayCanvas, SpikeDisplayCanvas
+  The timer callbacks only refresh when the DisplayScheduler lets them, which
+  shares the message thread's time between all the visualizers.
+
+  @see LfpDisplayCanvas, SpikeDisplayCanvas, DisplayScheduler
 
 */
 
@@ -73,6 +76,15 @@ public:
     /** Called whenever the timer is triggered. */
 	void timerCallback();
 
+    /** Called by the timer callbacks when the DisplayScheduler asks for less detail to
+        be drawn, for instance per-pixel drawing instead of supersampling, and again
+        once full detail can be drawn. Does nothing by default. */
+    virtual void setDetailReduced(bool isReduced);
+
+    /** Returns the bytes of the buffers the canvas draws from, counted with its processor's
+        (see GenericProcessor::getMemoryFootprint). 0 by default. */
+    virtual int64 getMemoryFootprint() const;
+
     /** Refresh rate in Hz. */
     float refreshRate;
 
@@ -83,6 +95,13 @@ public:
     /** Loads parameters from XML */
 	virtual void loadVisualizerParameters(XmlElement* xml);
 
+private:
+    int callbacksSinceRefresh;
+    bool detailReduced;
+
+    /** The name of the refreshes in a TraceRecorder timeline */
+    const char* traceName;
+
 };
 
 
@@ -28,6 +28,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../AccessClass.h"
 #include "../Processors/RecordNode/RecordEngine.h"
 #include "../Processors/PluginManager/PluginManager.h"
+#include "../Processors/SourceNode/SourceNode.h"
 
 
 const int SIZE_AUDIO_EDITOR_MAX_WIDTH = 500;
@@ -135,7 +136,7 @@ void CPUMeter::paint(Graphics& g)
 }
 
 
-DiskSpaceMeter::DiskSpaceMeter()
+DiskSpaceMeter::DiskSpaceMeter() : backlogAlarm(0)
 
 {
 
@@ -159,6 +160,25 @@ void DiskSpaceMeter::updateDiskSpace(float percent)
     diskFree = percent;
 }
 
+void DiskSpaceMeter::updateRecordBacklogs(const StringArray& engines, const Array<float>& backlogs, const Array<float>& speedRatios)
+{
+    String tooltip = "Disk space available";
+
+    for (int i = 0; i < engines.size(); ++i)
+    {
+        tooltip += "\n" + engines[i] + " write backlog: " + String(roundToInt(backlogs[i] * 100)) + "%";
+        if (speedRatios[i] > 0)
+            tooltip += ", writing at " + String(speedRatios[i], 1) + "x the data rate";
+    }
+
+    setTooltip(tooltip);
+}
+
+void DiskSpaceMeter::setBacklogAlarm(int level)
+{
+    backlogAlarm = level;
+}
+
 void DiskSpaceMeter::paint(Graphics& g)
 {
 
@@ -168,11 +188,52 @@ void DiskSpaceMeter::paint(Graphics& g)
     if (diskFree > 0)
         g.fillRect(0.0f,0.0f,getWidth()*diskFree,float(getHeight()));
 
+    g.setColour(backlogAlarm > 1 ? Colours::red : (backlogAlarm > 0 ? Colours::orange : Colours::black));
+    g.drawRect(0,0,getWidth(),getHeight(),backlogAlarm > 0 ? 2 : 1);
+
+    g.setColour(Colours::black);
+    g.setFont(font);
+    g.drawSingleLineText("DF",75,12);
+
+}
+
+BufferMeter::BufferMeter() : fill(0.0f), dropped(0)
+{
+
+    font = Font("Small Text", 12, Font::plain);
+
+    setTooltip("Peak buffer occupancy");
+}
+
+
+BufferMeter::~BufferMeter()
+{
+}
+
+void BufferMeter::updateBufferStatistics(float peakFill, int64 droppedSamples, float latencyMs)
+{
+    fill = peakFill;
+    dropped = droppedSamples;
+
+    setTooltip("Peak buffer occupancy: " + String(roundToInt(peakFill * 100)) + "%, "
+               + String(droppedSamples) + " samples dropped, "
+               + String(latencyMs, 1) + " ms latency");
+}
+
+void BufferMeter::paint(Graphics& g)
+{
+
+    g.fillAll(Colours::grey);
+
+    g.setColour(dropped > 0 ? Colours::red : Colours::yellow);
+    if (fill > 0)
+        g.fillRect(0.0f,0.0f,getWidth()*jmin(fill, 1.0f),float(getHeight()));
+
     g.setColour(Colours::black);
     g.drawRect(0,0,getWidth(),getHeight(),1);
 
     g.setFont(font);
-    g.drawSingleLineText("DF",75,12);
+    g.drawSingleLineText("BUF",65,12);
 
 }
 
@@ -405,6 +466,9 @@ ControlPanel::ControlPanel(ProcessorGraph* graph_, AudioComponent* audio_)
     diskMeter = new DiskSpaceMeter();
     addAndMakeVisible(diskMeter);
 
+    bufferMeter = new BufferMeter();
+    addAndMakeVisible(bufferMeter);
+
     cpb = new ControlPanelButton(this);
     addAndMakeVisible(cpb);
 
@@ -540,6 +604,8 @@ void ControlPanel::updateRecordEngineList()
 	{
 		Plugin::RecordEngineInfo info;
 		info = AccessClass::getPluginManager()->getRecordEngineInfo(i);
+		if (info.creator == nullptr)
+			continue;
 		recordSelector->addItem(info.name, id++);
 		recordEngines.add(info.creator());
 	}
@@ -625,8 +691,8 @@ void ControlPanel::resized()
 
     // We have 3 possible layout schemes:
     // when there are 1, 2 or 3 rows within which our elements are placed.
-    const int twoRowsWidth   = 750;
-    const int threeRowsWidth = 570;
+    const int twoRowsWidth   = 850;
+    const int threeRowsWidth = 670;
     int offset1 = twoRowsWidth - getWidth();
     if (offset1 > h)
         offset1 = h;
@@ -663,8 +729,9 @@ void ControlPanel::resized()
     }
 
     juce::Rectangle<int> meterBounds (meterComponentsMargin, meterComponentsY, meterComponentsWidth, meterComponentsHeight);
-    cpuMeter->setBounds  (meterBounds);
-    diskMeter->setBounds (meterBounds.translated (meterComponentsWidth + meterComponentsMargin, 0));
+    cpuMeter->setBounds    (meterBounds);
+    bufferMeter->setBounds (meterBounds.translated (meterComponentsWidth + meterComponentsMargin, 0));
+    diskMeter->setBounds   (meterBounds.translated ((meterComponentsWidth + meterComponentsMargin) * 2, 0));
     // ====================================================================
 
     // Set positions for controls and clock
@@ -1012,9 +1079,33 @@ void ControlPanel::refreshMeters()
 
     cpuMeter->repaint();
 
+    float peakFill = 0.0f;
+    int64 droppedSamples = 0;
+    float latencyMs = 0.0f;
+    Array<GenericProcessor*> processors = graph->getListOfProcessors();
+    for (int i = 0; i < processors.size(); ++i)
+    {
+        if (SourceNode* source = dynamic_cast<SourceNode*> (processors[i]))
+        {
+            float fill, latency;
+            int64 dropped;
+            source->getBufferStatistics (fill, dropped, latency);
+            peakFill = jmax (peakFill, fill);
+            droppedSamples += dropped;
+            latencyMs = jmax (latencyMs, latency);
+        }
+    }
+    bufferMeter->updateBufferStatistics (peakFill, droppedSamples, latencyMs);
+    bufferMeter->repaint();
+
     masterClock->repaint();
 
     diskMeter->updateDiskSpace(graph->getRecordNode()->getFreeSpace());
+    StringArray engines;
+    Array<float> backlogs, speedRatios;
+    graph->getRecordNode()->getRecordBacklogs(engines, backlogs, speedRatios);
+    diskMeter->updateRecordBacklogs(engines, backlogs, speedRatios);
+    diskMeter->setBacklogAlarm(graph->getRecordNode()->updateBacklogAlarm());
     diskMeter->repaint();
 
     if (initialize)
@@ -127,6 +127,11 @@ private:
 
   Note that the DiskSpaceMeter currently displays only relative, not absolute disk space.
 
+  While recording, the tooltip also shows how far behind each record engine's writer
+  thread is, as the fraction of the record queue it still has to write, and how much faster
+  than the incoming data it has been writing. The meter is outlined orange when the record
+  queue is half full and red when it is nearly full or data has been dropped.
+
   @see ControlPanel
 
 */
@@ -141,6 +146,14 @@ public:
     	the ControlPanel. */
     void updateDiskSpace(float percent);
 
+    /** Updates the backlog of each record engine shown in the tooltip. Called by
+    	the ControlPanel. */
+    void updateRecordBacklogs(const StringArray& engines, const Array<float>& backlogs, const Array<float>& speedRatios);
+
+    /** Sets the record backlog alarm level: 0 for none, 1 for a filling queue and 2 for
+        a full queue or dropped data. */
+    void setBacklogAlarm(int level);
+
     /** Draws the DiskSpaceMeter. */
     void paint(Graphics& g);
 
@@ -149,6 +162,42 @@ private:
     Font font;
 
     float diskFree;
+    int backlogAlarm;
+
+};
+
+/**
+
+  Displays how close the DataThread buffers came to overflowing.
+
+  The BufferMeter is located in the ControlPanel, next to the CPUMeter. While acquisition is
+  active, it shows the peak occupancy of the fullest input buffer of all the sources, and turns
+  red as soon as any samples are dropped because a buffer was full. The tooltip shows the
+  number of dropped samples and the current read latency.
+
+  @see ControlPanel, DataBuffer
+
+*/
+
+class BufferMeter : public Component, public SettableTooltipClient
+{
+public:
+    BufferMeter();
+    ~BufferMeter();
+
+    /** Updates the statistics displayed by the BufferMeter. Called by
+        the ControlPanel. */
+    void updateBufferStatistics(float peakFill, int64 droppedSamples, float latencyMs);
+
+    /** Draws the BufferMeter. */
+    void paint(Graphics& g);
+
+private:
+
+    Font font;
+
+    float fill;
+    int64 dropped;
 
 };
 
@@ -376,6 +425,7 @@ private:
     ScopedPointer<Clock> masterClock;
     ScopedPointer<CPUMeter> cpuMeter;
     ScopedPointer<DiskSpaceMeter> diskMeter;
+    ScopedPointer<BufferMeter> bufferMeter;
     ScopedPointer<FilenameComponent> filenameComponent;
     ScopedPointer<UtilityButton> newDirectoryButton;
     ScopedPointer<ControlPanelButton> cpb;
@@ -402,7 +452,7 @@ private:
 
     void timerCallback();
 
-    /** Updates the values displayed by the CPUMeter and DiskSpaceMeter.*/
+    /** Updates the values displayed by the CPUMeter, BufferMeter and DiskSpaceMeter.*/
     void refreshMeters();
 
     bool keyPressed(const KeyPress& key);
@@ -30,12 +30,14 @@
 #include "../Processors/MessageCenter/MessageCenterEditor.h"
 #include "ProcessorList.h"
 #include "../Processors/ProcessorGraph/ProcessorGraph.h"
+#include "../Processors/SourceNode/SourceNode.h"
+#include "../Processors/SourceNode/SourceNodeEditor.h"
 
 EditorViewport::EditorViewport()
     : leftmostEditor(0),
       message("Drag-and-drop some rows from the top-left box onto this component!"),
       somethingIsBeingDraggedOver(false), shiftDown(false), canEdit(true),
-      lastEditorClicked(0), selectionIndex(0), borderSize(6), tabSize(30),
+      isLoadingState(false), lastEditorClicked(0), selectionIndex(0), borderSize(6), tabSize(30),
       tabButtonSize(15), insertionPoint(0), componentWantsToMove(false),
       indexOfMovingComponent(-1), currentTab(-1)
 {
@@ -328,6 +330,10 @@ void EditorViewport::makeEditorVisible(GenericEditor* editor, bool highlight, bo
     else
         signalChainManager->updateVisibleEditors(editor, 0, 0, UPDATE);
 
+    // the editors are not laid out yet, so there is nothing to scroll to
+    if (isLoadingState)
+        return;
+
     refreshEditors();
 
     for (int i = 0; i < editorArray.size(); i++)
@@ -382,6 +388,9 @@ void EditorViewport::deleteNode(GenericEditor* editor)
 void EditorViewport::refreshEditors()
 {
 
+    if (isLoadingState)
+        return;
+
     int lastBound = borderSize+tabSize;
     int totalWidth = 0;
 
@@ -751,8 +760,18 @@ void EditorViewport::mouseDown(const MouseEvent& e)
 
                 m.addItem(1, "Rename", true);
 
+                SourceNode* source = dynamic_cast<SourceNode*>(editorArray[i]->getProcessor());
+                if (source != nullptr)
+                {
+                    m.addSeparator();
+                    SourceNodeEditor::addSchedulingMenuItems(m, source, 100);
+                }
+
                 const int result = m.show();
 
+                if (source != nullptr && SourceNodeEditor::handleSchedulingMenuResult(result, source, 100))
+                    return;
+
                 if (result == 1)
                 {
                     editorNamingLabel.setText("", dontSendNotification);
@@ -1237,7 +1256,6 @@ const String EditorViewport::saveState(File fileToUse, String& xmlText)
 
 const String EditorViewport::saveState(File fileToUse, String* xmlText)
 {
-
     String error;
 
     currentFile = fileToUse;
@@ -1259,6 +1277,27 @@ const String EditorViewport::saveState(File fileToUse, String* xmlText)
     //     return error;
     // }
 
+    ScopedPointer<XmlElement> xml = createSettingsXml();
+
+    if (! xml->writeToFile(currentFile, String::empty))
+        error = "Couldn't write to file ";
+    else
+        error = "Saved configuration as ";
+
+    error += currentFile.getFileName();
+
+	if (xmlText != nullptr)
+	{
+		(*xmlText) = xml->createDocument(String::empty);
+		if ((*xmlText).isEmpty())
+			(*xmlText) = "Couldn't create configuration xml";
+	}
+
+    return error;
+}
+
+XmlElement* EditorViewport::createSettingsXml()
+{
     Array<GenericProcessor*> splitPoints;
     /** Used to reset saveOrder at end, to allow saving the same processor multiple times*/
     Array<GenericProcessor*> allProcessors;
@@ -1399,6 +1438,7 @@ const String EditorViewport::saveState(File fileToUse, String* xmlText)
 	AccessClass::getProcessorGraph()->getTimestampSources(tsID, tsSubID);
 	timestampSettings->setAttribute("selected_index", tsID);
 	timestampSettings->setAttribute("selected_sub_index", tsSubID);
+	timestampSettings->setAttribute("sync_line", AccessClass::getProcessorGraph()->getClockSynchronizer().getSyncLine());
 	xml->addChildElement(timestampSettings);
 
     //Resets Save Order for processors, allowing them to be saved again without omitting themselves from the order.
@@ -1412,23 +1452,7 @@ const String EditorViewport::saveState(File fileToUse, String* xmlText)
     AccessClass::getProcessorList()->saveStateToXml(xml);
     AccessClass::getUIComponent()->saveStateToXml(xml);  // save the UI settings
 
-    if (! xml->writeToFile(currentFile, String::empty))
-        error = "Couldn't write to file ";
-    else
-        error = "Saved configuration as ";
-
-    error += currentFile.getFileName();
-
-	if (xmlText != nullptr)
-	{
-		(*xmlText) = xml->createDocument(String::empty);
-		if ((*xmlText).isEmpty())
-			(*xmlText) = "Couldn't create configuration xml";
-	}
-
-    delete xml;
-
-    return error;
+    return xml;
 }
 
 const String EditorViewport::loadState(File fileToLoad)
@@ -1512,9 +1536,16 @@ const String EditorViewport::loadState(File fileToLoad)
 
         responseString += ".\n This file may not load properly. Continue?";
 
-        bool response = AlertWindow::showOkCancelBox(AlertWindow::NoIcon,
-                                                     "Version mismatch", responseString,
-                                                     "Yes", "No", 0, 0);
+        // headless runs go on, as there is nobody to answer
+        bool response = true;
+
+        if (AccessClass::getUIComponent()->isHeadless())
+            std::cout << "Version mismatch: " << versionString << " instead of "
+                      << JUCEApplication::getInstance()->getApplicationVersion() << std::endl;
+        else
+            response = AlertWindow::showOkCancelBox(AlertWindow::NoIcon,
+                                                    "Version mismatch", responseString,
+                                                    "Yes", "No", 0, 0);
         if (!response)
             return "Failed To Open " + fileToLoad.getFileName();
 
@@ -1524,7 +1555,11 @@ const String EditorViewport::loadState(File fileToLoad)
 		String responseString = "Your configuration file was saved from a non-plugin version of the GUI.\n";
 		responseString += "Save files from non-plugin versions are incompatible with the current load system.\n";
 		responseString += "The chain file will not load.";
-		AlertWindow::showMessageBox(AlertWindow::WarningIcon, "Non-plugin save file", responseString);
+
+		if (AccessClass::getUIComponent()->isHeadless())
+			std::cout << responseString << std::endl;
+		else
+			AlertWindow::showMessageBox(AlertWindow::WarningIcon, "Non-plugin save file", responseString);
 		return "Failed To Open " + fileToLoad.getFileName();
 	}
     clearSignalChain();
@@ -1534,6 +1569,15 @@ const String EditorViewport::loadState(File fileToLoad)
 
     GenericProcessor* p;
 
+    // First every processor is created and connected, without updating any settings or laying
+    // out the editors, which for large configurations would otherwise be redone for every
+    // processor added. The settings are then updated in one pass, before the parameters are set.
+    Array<GenericProcessor*> loadedProcessors;
+    Array<XmlElement*> loadedProcessorXml;
+
+    isLoadingState = true;
+    signalChainManager->setSettingsUpdatesDeferred(true);
+
     forEachXmlChildElement(*xml, element)
     {
 
@@ -1580,8 +1624,8 @@ const String EditorViewport::loadState(File fileToLoad)
                     p->loadOrder = loadOrder;
                     p->parametersAsXml = processor;
 
-                    //Sets parameters based on XML files
-                    setParametersByXML(p, processor);
+                    loadedProcessors.add(p);
+                    loadedProcessorXml.add(processor);
                     loadOrder++;
 
                     if (p->isSplitter() || p->isMerger())
@@ -1589,8 +1633,6 @@ const String EditorViewport::loadState(File fileToLoad)
                         splitPoints.add(p);
                     }
 
-                    signalChainManager->updateVisibleEditors(editorArray[0], 0, 0, UPDATE);
-
                 }
                 else if (processor->hasTagName("SWITCH"))
                 {
@@ -1641,10 +1683,22 @@ const String EditorViewport::loadState(File fileToLoad)
 			int tsID = element->getIntAttribute("selected_index", -1);
 			int tsSubID = element->getIntAttribute("selected_sub_index");
 			AccessClass::getProcessorGraph()->setTimestampSource(tsID, tsSubID);
+			AccessClass::getProcessorGraph()->getClockSynchronizer().setSyncLine(element->getIntAttribute("sync_line", -1));
 		}
 
     }
 
+    isLoadingState = false;
+    signalChainManager->setSettingsUpdatesDeferred(false);
+
+    signalChainManager->updateProcessorSettings();
+
+    for (int i = 0; i < loadedProcessors.size(); i++)
+    {
+        //Sets parameters based on XML files
+        setParametersByXML(loadedProcessors[i], loadedProcessorXml[i]);
+    }
+
     for (int i = 0; i < editorArray.size(); i++)
     {
         // deselect everything initially
@@ -1658,7 +1712,10 @@ const String EditorViewport::loadState(File fileToLoad)
     AccessClass::getUIComponent()->loadStateFromXml(xml);  // save the UI settings
 
     if (editorArray.size() > 0)
-        signalChainManager->updateVisibleEditors(editorArray[0], 0, 0, UPDATE);
+        signalChainManager->updateVisibleEditors(editorArray[0], 0, 0, ACTIVATE);
+
+    // parameters of every signal chain have just been restored
+    signalChainManager->updateProcessorSettings();
 
     refreshEditors();
 
@@ -152,6 +152,10 @@ public:
 	/** Save the current configuration as an XML file. Reference wrapper*/
 	const String saveState(File filename, String& xmlText);
 
+    /** Returns the current configuration as saved by saveState(), without writing it anywhere.
+        Must be called on the message thread. The caller owns the returned element. */
+    XmlElement* createSettingsXml();
+
     /** Load a saved configuration from an XML file. */
     const String loadState(File filename);
 
@@ -182,6 +186,7 @@ private:
     bool shiftDown;
 
     bool canEdit;
+    bool isLoadingState; // editors are laid out once, at the end of loadState()
     GenericEditor* lastEditor;
     GenericEditor* lastEditorClicked;
     GenericEditor* editorToUpdate;
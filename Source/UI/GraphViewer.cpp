@@ -22,6 +22,7 @@
  */
 
 #include "GraphViewer.h"
+#include "../Processors/GenericProcessor/GenericProcessor.h"
 
 GraphViewer::GraphViewer()
 {
@@ -29,6 +30,8 @@ GraphViewer::GraphViewer()
     currentVersionText = "GUI version " + app->getApplicationVersion();
     
     rootNum = 0;
+    
+    startTimer (500);
 }
 
 
@@ -304,12 +307,20 @@ void GraphViewer::connectNodes (int node1, int node2, Graphics& g)
     g.strokePath (linePath, stroke);
 }
 
+void GraphViewer::timerCallback()
+{
+    for (int i = 0; i < availableNodes.size(); ++i)
+        availableNodes[i]->updateTimingStats();
+}
+
 /// ------------------------------------------------------
 
 GraphNode::GraphNode (GenericEditor* ed, GraphViewer* g)
-: editor        (ed)
-, gv            (g)
-, isMouseOver   (false)
+: editor                (ed)
+, gv                    (g)
+, isMouseOver           (false)
+, lastNumTimedBlocks    (0)
+, lastMemoryFootprint   (-1)
 {
 }
 
@@ -469,4 +480,69 @@ void GraphNode::paint (Graphics& g)
     g.fillEllipse (2, 2, 16, 16);
     
     g.drawText (getName(), 25, 0, getWidth() - 25, 20, Justification::left, true);
+    
+    if (timingText.isNotEmpty())
+    {
+        g.setFont (10);
+        g.setColour (Colours::grey);
+        g.drawText (timingText, 25, 17, getWidth() - 25, 12, Justification::left, true);
+    }
+}
+
+
+bool GraphNode::updateTimingStats()
+{
+    GenericProcessor* processor = editor->getProcessor();
+    
+    const ProcessorTimingStats::Snapshot s = processor->getTimingStats().getSnapshot();
+    const int64 memoryFootprint = processor->getMemoryFootprint();
+    
+    if (s.numBlocks == lastNumTimedBlocks && memoryFootprint == lastMemoryFootprint)
+        return false;
+    
+    lastNumTimedBlocks = s.numBlocks;
+    lastMemoryFootprint = memoryFootprint;
+    
+    const String memoryText = memoryFootprint > 0 ? MemoryFootprint::describe (memoryFootprint) : String::empty;
+    
+    if (s.numBlocks == 0)
+    {
+        timingText = memoryText;
+        setTooltip (memoryText.isNotEmpty() ? memoryText + " of buffers" : String::empty);
+    }
+    else
+    {
+        timingText = s.getSummary();
+        
+        if (memoryText.isNotEmpty())
+            timingText += ", " + memoryText;
+        
+        String tooltip = "min " + String (s.minMs, 3) + " ms, mean " + String (s.meanMs, 3)
+                         + " ms, p99 " + String (s.p99Ms, 3) + " ms, max " + String (s.maxMs, 3) + " ms\n"
+                         + String (s.samplesPerSecond / 1000.0, 0) + " kS/s over " + String (s.numBlocks) + " blocks";
+        
+        if (memoryText.isNotEmpty())
+            tooltip += "\n" + memoryText + " of buffers";
+        
+        for (int i = 0; i < processor->getTotalEventChannels(); ++i)
+        {
+            const ProcessorTimingStats* stats = processor->getEventLatencyStats (i);
+            
+            if (stats == nullptr)
+                continue;
+            
+            const ProcessorTimingStats::Snapshot latency = stats->getSnapshot();
+            
+            if (latency.numBlocks > 0)
+                tooltip += "\nlatency from " + processor->getEventChannel (i)->getSourceName() + ": "
+                           + latency.getSummary() + " (" + String (latency.numBlocks) + " events)";
+        }
+        
+        setTooltip (tooltip);
+    }
+    
+    repaint();
+    editor->repaint (0, 0, editor->getWidth(), 22);
+    
+    return true;
 }
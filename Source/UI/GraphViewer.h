@@ -41,6 +41,7 @@
 
 
 class GraphNode : public Component
+                , public SettableTooltipClient
 {
 public:
     GraphNode (GenericEditor* editor, GraphViewer* g);
@@ -73,6 +74,10 @@ public:
     void updateBoundaries();
     void switchIO (int path);
     
+    /** Refreshes the processing time and memory shown under the name, and the processing
+        time in the editor's title bar. Returns true if anything changed. */
+    bool updateTimingStats();
+    
     int horzShift;
     int vertShift;
     
@@ -81,10 +86,15 @@ private:
     GraphViewer* gv;
     
     bool isMouseOver;
+    
+    String timingText;
+    int64 lastNumTimedBlocks;
+    int64 lastMemoryFootprint;
 };
 
 
 class GraphViewer : public Component
+                  , private Timer
 {
 public:
     GraphViewer();
@@ -107,6 +117,8 @@ private:
     void connectNodes (int, int, Graphics&);
     void checkLayout (GraphNode*);
     
+    void timerCallback() override;
+    
     int getIndexOfEditor (GenericEditor* editor) const;
     
     int rootNum;
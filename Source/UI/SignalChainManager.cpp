@@ -32,7 +32,7 @@ SignalChainManager::SignalChainManager
  Array<GenericEditor*, CriticalSection>& editorArray_,
  Array<SignalChainTabButton*, CriticalSection>& signalChainArray_)
     : editorArray(editorArray_), signalChainArray(signalChainArray_),
-      ev(ev_), tabSize(30)
+      ev(ev_), tabSize(30), settingsUpdatesDeferred(false)
 {
     topTab = 0;
 }
@@ -507,8 +507,16 @@ void SignalChainManager::updateVisibleEditors(GenericEditor* activeEditor,
         }
     }
 
-    // Step 7: update all settings
-    if (action != ACTIVATE)
+    // Step 7: update the settings, only downstream of the editor if that's all that changed
+    if (settingsUpdatesDeferred)
+    {
+        return;
+    }
+    else if (action == UPDATE)
+    {
+		updateProcessorSettings(activeEditor->getProcessor());
+    }
+    else if (action != ACTIVATE)
     {
 
 		updateProcessorSettings();
@@ -519,8 +527,38 @@ void SignalChainManager::updateVisibleEditors(GenericEditor* activeEditor,
 
 }
 
-void SignalChainManager::updateProcessorSettings()
+void SignalChainManager::setSettingsUpdatesDeferred(bool shouldDefer)
+{
+	settingsUpdatesDeferred = shouldDefer;
+}
+
+void SignalChainManager::updateDownstreamSettings(GenericProcessor* p)
+{
+	while (p != nullptr)
+	{
+		p->update();
+
+		if (p->isSplitter())
+		{
+			p->switchIO(); // the path not currently selected
+			GenericProcessor* otherPath = p->getDestNode();
+			p->switchIO(); // switch it back
+
+			updateDownstreamSettings(otherPath);
+		}
+
+		p = p->getDestNode();
+	}
+}
+
+void SignalChainManager::updateProcessorSettings(GenericProcessor* changedProcessor)
 {
+	if (changedProcessor != nullptr)
+	{
+		updateDownstreamSettings(changedProcessor);
+		return;
+	}
+
 	// std::cout << "Updating settings." << std::endl;
 
 	Array<GenericProcessor*> splitters;
@@ -69,10 +69,19 @@ public:
     /** Clears the signal chain.*/
     void clearSignalChain();
 
-	void updateProcessorSettings();
+	/** Calls update() on the processors of every signal chain, in order. If a processor is given,
+	only that processor and the ones downstream of it are updated, as nothing else can depend on its settings. */
+	void updateProcessorSettings(GenericProcessor* changedProcessor = nullptr);
+
+	/** While set, updateVisibleEditors() only connects the processors and leaves their settings
+	alone, so that a configuration can be loaded with one updateProcessorSettings() at the end. */
+	void setSettingsUpdatesDeferred(bool shouldDefer);
 
 private:
 
+    /** Updates a processor and everything downstream of it, following both paths of splitters. */
+    void updateDownstreamSettings(GenericProcessor* processor);
+
     /** An array of all currently visible editors.*/
     Array<GenericEditor*, CriticalSection>& editorArray;
 
@@ -91,6 +100,7 @@ private:
 
     const int tabSize;
 
+	bool settingsUpdatesDeferred;
 
 };
 
@@ -30,7 +30,7 @@ TimestampSourceSelectionWindow::TimestampSourceSelectionWindow()
 	: DocumentWindow("Global timestamp source selection", Colours::red,
 	DocumentWindow::closeButton)
 {
-	centreWithSize(300, 200);
+	centreWithSize(300, 290);
 	setUsingNativeTitleBar(true);
 	setResizable(false, false);
 	m_selectorComponent = new TimestampSourceSelectionComponent();
@@ -63,11 +63,20 @@ void TimestampSourceSelectionWindow::closeButtonPressed()
 //Component
 TimestampSourceSelectionComponent::TimestampSourceSelectionComponent()
 {
-	setSize(300, 200);
+	setSize(300, 290);
 	m_selector = new ComboBox("Timestamp Sources");
 	m_selector->setBounds(50, 150, 200, 30);
 	m_selector->addListener(this);
 	addAndMakeVisible(m_selector);
+
+	m_syncLineSelector = new ComboBox("Sync Line");
+	m_syncLineSelector->setBounds(50, 245, 200, 30);
+	m_syncLineSelector->addItem("No clock synchronization", 1);
+	for (int i = 0; i < 64; i++)
+		m_syncLineSelector->addItem("Sync pulses on TTL line " + String(i + 1), i + 2);
+	m_syncLineSelector->setSelectedId(AccessClass::getProcessorGraph()->getClockSynchronizer().getSyncLine() + 2, dontSendNotification);
+	m_syncLineSelector->addListener(this);
+	addAndMakeVisible(m_syncLineSelector);
 	updateProcessorList();
 }
 
@@ -113,6 +122,12 @@ void TimestampSourceSelectionComponent::updateProcessorList()
 
 void TimestampSourceSelectionComponent::comboBoxChanged(ComboBox* c)
 {
+	if (c == m_syncLineSelector)
+	{
+		AccessClass::getProcessorGraph()->getClockSynchronizer().setSyncLine(c->getSelectedId() - 2);
+		return;
+	}
+
 	int selected = c->getSelectedId() - 2;
 	int sourceIdx, subIdx;
 	if (selected < 0)
@@ -131,6 +146,7 @@ void TimestampSourceSelectionComponent::comboBoxChanged(ComboBox* c)
 void TimestampSourceSelectionComponent::setAcquisitionState(bool s)
 {
 	m_selector->setEnabled(!s);
+	m_syncLineSelector->setEnabled(!s);
 }
 
 void TimestampSourceSelectionComponent::paint(Graphics& g)
@@ -142,4 +158,7 @@ void TimestampSourceSelectionComponent::paint(Graphics& g)
 		"Processors that generate events not based on any existing data streams but do not generate their "
 		"own timestamps will use both the timestamps and sample rate of the selected processor as reference.",
 		10, 30, 280);
+	g.drawMultiLineText("When every source receives the same sync pulses on one TTL line, the "
+		"timestamps of their events are also recorded mapped onto the selected source.",
+		10, 200, 280);
 }
\ No newline at end of file
@@ -23,6 +23,7 @@
 
 #include "UIComponent.h"
 #include "../Processors/PluginManager/PluginManager.h"
+#include "../Processors/GenericProcessor/TraceRecorder.h"
 #include <stdio.h>
 
 #include "InfoLabel.h"
@@ -97,12 +98,16 @@
 
 	processorGraph->updatePointers(); // needs to happen after processorGraph gets the right pointers
 
+	// without a window, when running headless, there is no menu either
+	if (mainWindow != nullptr)
+	{
 #if JUCE_MAC
-	MenuBarModel::setMacMainMenu(this);
-	mainWindow->setMenuBar(0);
+		MenuBarModel::setMacMainMenu(this);
+		mainWindow->setMenuBar(0);
 #else
-	mainWindow->setMenuBar(this);
+		mainWindow->setMenuBar(this);
 #endif
+	}
 
 }
 
@@ -336,6 +341,11 @@ void UIComponent::disableDataViewport()
 	dataViewport->disableConnectionToEditorViewport();
 }
 
+bool UIComponent::isHeadless() const
+{
+	return mainWindow == nullptr;
+}
+
 void UIComponent::childComponentChanged()
 {
 	resized();
@@ -369,6 +379,10 @@ PopupMenu UIComponent::getMenuForIndex(int menuIndex, const String& menuName)
 		menu.addCommandItem(commandManager, saveConfiguration);
 		menu.addCommandItem(commandManager, saveConfigurationAs);
 		menu.addSeparator();
+		menu.addCommandItem(commandManager, exportProcessorTimings);
+		menu.addCommandItem(commandManager, toggleTracing);
+		menu.addCommandItem(commandManager, exportTrace);
+		menu.addSeparator();
 		menu.addCommandItem(commandManager, reloadOnStartup);
 
 #if !JUCE_MAC
@@ -388,6 +402,10 @@ PopupMenu UIComponent::getMenuForIndex(int menuIndex, const String& menuName)
 		menu.addCommandItem(commandManager, clearSignalChain);
 		menu.addSeparator();
 		menu.addCommandItem(commandManager, openTimestampSelectionWindow);
+		menu.addCommandItem(commandManager, toggleParallelRendering);
+		menu.addCommandItem(commandManager, toggleChainThreading);
+		menu.addCommandItem(commandManager, toggleEventLatencyMeasurement);
+		menu.addCommandItem(commandManager, toggleOverrunDegradation);
 
 	}
 	else if (menuIndex == 2)
@@ -440,7 +458,14 @@ void UIComponent::getAllCommands(Array <CommandID>& commands)
 		toggleFileInfo,
 		showHelp,
 		resizeWindow,
-		openTimestampSelectionWindow
+		openTimestampSelectionWindow,
+		toggleParallelRendering,
+		exportProcessorTimings,
+		toggleEventLatencyMeasurement,
+		toggleTracing,
+		exportTrace,
+		toggleOverrunDegradation,
+		toggleChainThreading
 	};
 
 	commands.addArray(ids, numElementsInArray(ids));
@@ -528,6 +553,41 @@ void UIComponent::getCommandInfo(CommandID commandID, ApplicationCommandInfo& re
 			result.setInfo("Timestamp Source", "Show timestamp source selection window.", "General", 0);
 			break;
 
+		case toggleParallelRendering:
+			result.setInfo("Parallel signal chains", "Process independent branches of the signal chain on separate threads.", "General", 0);
+			result.setActive(!acquisitionStarted);
+			result.setTicked(processorGraph->isParallelRenderingEnabled());
+			break;
+
+		case toggleChainThreading:
+			result.setInfo("Threads per signal chain", "Process each independent signal chain on a thread of its own.", "General", 0);
+			result.setActive(!acquisitionStarted);
+			result.setTicked(processorGraph->isChainThreadingEnabled());
+			break;
+
+		case toggleEventLatencyMeasurement:
+			result.setInfo("Measure event latency", "Measure the time from a source processing a block to an output processor acting on the events it caused.", "General", 0);
+			result.setTicked(GenericProcessor::isEventLatencyMeasurementEnabled());
+			break;
+
+		case toggleOverrunDegradation:
+			result.setInfo("Degrade when overrunning", "Throttle the displays, pause background work and skip the display-only processors while processing can't keep up with the data.", "General", 0);
+			result.setTicked(processorGraph->getOverrunWatchdog().getPolicy().enabled);
+			break;
+
+		case exportProcessorTimings:
+			result.setInfo("Export processor timings...", "Save how long each processor took to process its blocks, as CSV or JSON.", "General", 0);
+			break;
+
+		case toggleTracing:
+			result.setInfo("Record timeline trace", "Record what every thread does, from the processors' blocks to the record engines' writes and the displays' refreshes.", "General", 0);
+			result.setTicked(TraceRecorder::isEnabled());
+			break;
+
+		case exportTrace:
+			result.setInfo("Export timeline trace...", "Save the recorded timeline as a Chrome trace, which chrome://tracing and Perfetto open.", "General", 0);
+			break;
+
 		case showHelp:
 			result.setInfo("Show help...", "Take me to the GUI wiki.", "General", 0);
 			result.setActive(true);
@@ -654,6 +714,68 @@ bool UIComponent::perform(const InvocationInfo& info)
 			mainWindow->centreWithSize(800, 600);
 			break;
 
+		case toggleParallelRendering:
+			processorGraph->setParallelRendering(!processorGraph->isParallelRenderingEnabled());
+			break;
+
+		case toggleChainThreading:
+			processorGraph->setChainThreading(!processorGraph->isChainThreadingEnabled());
+			break;
+
+		case toggleEventLatencyMeasurement:
+			GenericProcessor::setEventLatencyMeasurementEnabled(!GenericProcessor::isEventLatencyMeasurementEnabled());
+			break;
+
+		case toggleOverrunDegradation:
+			{
+				OverrunWatchdog::Policy policy = processorGraph->getOverrunWatchdog().getPolicy();
+				policy.enabled = !policy.enabled;
+				processorGraph->getOverrunWatchdog().setPolicy(policy);
+				break;
+			}
+
+		case toggleTracing:
+			TraceRecorder::setEnabled(!TraceRecorder::isEnabled());
+			break;
+
+		case exportTrace:
+			{
+				FileChooser fc("Choose the file name...",
+						CoreServices::getDefaultUserSaveDirectory().getChildFile("trace.json"),
+						"*.json",
+						true);
+
+				if (fc.browseForFileToSave(true))
+				{
+					sendActionMessage(TraceRecorder::exportChromeTrace(fc.getResult()));
+				}
+				else
+				{
+					sendActionMessage("No file chosen.");
+				}
+
+				break;
+			}
+
+		case exportProcessorTimings:
+			{
+				FileChooser fc("Choose the file name...",
+						CoreServices::getDefaultUserSaveDirectory().getChildFile("processor_timings.csv"),
+						"*.csv;*.json",
+						true);
+
+				if (fc.browseForFileToSave(true))
+				{
+					sendActionMessage(processorGraph->exportTimingStats(fc.getResult()));
+				}
+				else
+				{
+					sendActionMessage("No file chosen.");
+				}
+
+				break;
+			}
+
 		case openTimestampSelectionWindow:
 			if (timestampWindow == nullptr)
 			{
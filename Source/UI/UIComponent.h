@@ -49,6 +49,9 @@ class TimestampSourceSelectionWindow;
   The UIComponent is responsible for the layout of the user interface and
   for creating the application's menu bar.
 
+  When running headless, it has no MainWindow and is never shown, but still
+  owns the editors through which the signal chain is loaded and controlled.
+
   @see ControlPanel, ProcessorList, EditorViewport, DataViewport,
        MessageCenter
 
@@ -103,6 +106,10 @@ public:
     /** Disables the connection between the DataViewport and the EditorViewport. */
     void disableDataViewport();
 
+    /** Returns true if there is no MainWindow, nothing being shown, so that no dialog
+        must wait for the user. */
+    bool isHeadless() const;
+
     /**
     Called whenever a major change takes place within a child component, in order
     to make sure the UIComponent's other children get resized appropriately. */
@@ -189,7 +196,14 @@ private:
         resizeWindow            = 0x2012,
         reloadOnStartup         = 0x2013,
         saveConfigurationAs     = 0x2014,
-		openTimestampSelectionWindow = 0x2015
+		openTimestampSelectionWindow = 0x2015,
+		toggleParallelRendering = 0x2016,
+		exportProcessorTimings  = 0x2017,
+		toggleEventLatencyMeasurement = 0x2018,
+		toggleTracing           = 0x2019,
+		exportTrace             = 0x2020,
+		toggleOverrunDegradation = 0x2021,
+		toggleChainThreading    = 0x2022
     };
 
     File currentConfigFile;